@@ -38,29 +38,37 @@ static void version (void)
 static void usage (const char *path)
 {
     printf (
-"Usage: %s <path>\n"
-"Generate the LibVLC plugins cache for the specified plugins directory.\n",
+"Usage: %s [--update] <path>\n"
+"Generate the LibVLC plugins cache for the specified plugins directory.\n"
+"\n"
+"  -u, --update   only load the plug-ins modified since the existing cache\n",
             path);
 }
 
 int main (int argc, char *argv[])
 {
+    bool update = false;
+
 #ifdef HAVE_GETOPT_H
     static const struct option opts[] =
     {
         { "help",       no_argument,       NULL, 'h' },
+        { "update",     no_argument,       NULL, 'u' },
         { "version",    no_argument,       NULL, 'V' },
         { NULL,         no_argument,       NULL, '\0'}
     };
 
     int c;
 
-    while ((c = getopt_long (argc, argv, "hV", opts, NULL)) != -1)
+    while ((c = getopt_long (argc, argv, "huV", opts, NULL)) != -1)
         switch (c)
         {
             case 'h':
                 usage (argv[0]);
                 return 0;
+            case 'u':
+                update = true;
+                break;
             case 'V':
                 version ();
                 return 0;
@@ -83,7 +91,8 @@ int main (int argc, char *argv[])
         int vlc_argc = 0;
 
         vlc_argv[vlc_argc++] = "--quiet";
-        vlc_argv[vlc_argc++] = "--reset-plugins-cache";
+        vlc_argv[vlc_argc++] = update ? "--update-plugins-cache"
+                                      : "--reset-plugins-cache";
         vlc_argv[vlc_argc++] = "--"; /* end of options */
         vlc_argv[vlc_argc] = NULL;
 
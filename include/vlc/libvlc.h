@@ -345,6 +345,91 @@ LIBVLC_API void libvlc_event_detach( libvlc_event_manager_t *p_event_manager,
                                          libvlc_callback_t f_callback,
                                          void *p_user_data );
 
+/**
+ * Queue of events delivered by an application thread.
+ *
+ * By default, event callbacks are called synchronously by the LibVLC thread
+ * that triggers the event, so that a slow callback delays playback. Events
+ * attached with libvlc_event_attach_queued() are instead copied to a queue,
+ * and delivered by whichever thread calls libvlc_event_queue_dispatch().
+ *
+ * High frequency events that only matter for their latest value (time,
+ * position, length, duration, buffering, volume and loudness changes) are
+ * coalesced: if such an event is still pending when a new one is sent, only
+ * the newest one is delivered.
+ *
+ * Once libvlc_event_detach() returns, no further callbacks are invoked for
+ * the detached listener, and pending events are discarded.
+ *
+ * \version LibVLC 4.0.0 and later.
+ */
+typedef struct libvlc_event_queue_t libvlc_event_queue_t;
+
+/**
+ * Create an event queue.
+ *
+ * \return a new queue, or NULL on error
+ * \version LibVLC 4.0.0 and later.
+ */
+LIBVLC_API libvlc_event_queue_t *libvlc_event_queue_new( void );
+
+/**
+ * Release an event queue.
+ *
+ * The queue is destroyed once this was called and all the listeners
+ * attached to it are detached.
+ *
+ * \param p_queue the event queue
+ * \version LibVLC 4.0.0 and later.
+ */
+LIBVLC_API void libvlc_event_queue_release( libvlc_event_queue_t *p_queue );
+
+/**
+ * Register for an event notification delivered by an event queue.
+ *
+ * This works as libvlc_event_attach(), except that the callback is invoked
+ * by libvlc_event_queue_dispatch(). Only events whose data is plain values
+ * can be queued (not those pointing to media, strings or other objects).
+ *
+ * \param p_event_manager the event manager to which you want to attach to
+ * \param i_event_type the desired event to which we want to listen
+ * \param f_callback the function to call when i_event_type occurs
+ * \param user_data user provided data to carry with the event
+ * \param p_queue the queue to deliver the events through
+ * \return 0 on success, ENOMEM on error, EINVAL if the event cannot be queued
+ * \version LibVLC 4.0.0 and later.
+ */
+LIBVLC_API int libvlc_event_attach_queued( libvlc_event_manager_t *p_event_manager,
+                                           libvlc_event_type_t i_event_type,
+                                           libvlc_callback_t f_callback,
+                                           void *user_data,
+                                           libvlc_event_queue_t *p_queue );
+
+/**
+ * Deliver queued events.
+ *
+ * Waits until at least one event is pending, the timeout expires, or
+ * libvlc_event_queue_wakeup() is called, then invokes the callbacks of the
+ * events that are pending.
+ *
+ * \param p_queue the event queue
+ * \param i_timeout maximum time to wait in milliseconds, 0 not to wait,
+ *        or -1 to wait indefinitely
+ * \return the number of callbacks invoked
+ * \version LibVLC 4.0.0 and later.
+ */
+LIBVLC_API int libvlc_event_queue_dispatch( libvlc_event_queue_t *p_queue,
+                                            int i_timeout );
+
+/**
+ * Interrupt a libvlc_event_queue_dispatch() call waiting for events, or
+ * make the next one return immediately.
+ *
+ * \param p_queue the event queue
+ * \version LibVLC 4.0.0 and later.
+ */
+LIBVLC_API void libvlc_event_queue_wakeup( libvlc_event_queue_t *p_queue );
+
 /** @} */
 
 /** \defgroup libvlc_log LibVLC logging
@@ -119,6 +119,7 @@ enum libvlc_event_e {
     libvlc_MediaPlayerAudioVolume,
     libvlc_MediaPlayerAudioDevice,
     libvlc_MediaPlayerChapterChanged,
+    libvlc_MediaPlayerAudioLoudness,
 
     /**
      * A \link #libvlc_media_t media item\endlink was added to a
@@ -346,6 +347,15 @@ typedef struct libvlc_event_t
             const char *device;
         } media_player_audio_device;
 
+        struct
+        {
+            double momentary; /**< loudness over 400 ms (LUFS) */
+            double short_term; /**< loudness over 3 s (LUFS) */
+            double integrated; /**< gated loudness since the start (LUFS) */
+            double true_peak; /**< true peak over 100 ms (dBTP) */
+            double max_true_peak; /**< true peak since the start (dBTP) */
+        } media_player_audio_loudness;
+
         struct
         {
             libvlc_renderer_item_t *item;
@@ -140,6 +140,51 @@ typedef struct libvlc_media_stats_t
     float       f_send_bitrate;
 } libvlc_media_stats_t;
 
+/**
+ * Point of the decoding pipeline where a latency is measured
+ * \see libvlc_media_get_latency_stats
+ */
+typedef enum libvlc_media_latency_t
+{
+    libvlc_latency_fifo = 0,   /**< time spent by data waiting for the decoder */
+    libvlc_latency_decode,     /**< time spent decoding data */
+    libvlc_latency_wait,       /**< time spent waiting for the end of buffering */
+    libvlc_latency_vout_queue, /**< time spent by pictures waiting for display */
+    libvlc_latency_late,       /**< lateness of displayed pictures */
+    libvlc_latency_presentation, /**< distance between the expected and the
+                                      actual presentation on the screen */
+    libvlc_latency_demux_blocked, /**< time spent by the demuxer waiting for
+                                       room in the decoder input */
+    libvlc_latency_packetizer_blocked, /**< time spent by the packetizer
+                                            thread waiting for the decoder */
+} libvlc_media_latency_t;
+
+#define LIBVLC_MEDIA_LATENCY_BUCKETS 24
+
+typedef struct libvlc_media_latency_stats_t
+{
+    uint64_t    i_count;    /**< number of samples */
+    int64_t     i_total_us; /**< sum of all samples (in microseconds) */
+    int64_t     i_max_us;   /**< longest sample (in microseconds) */
+    /** Bucket 0 counts samples below 1 microsecond, bucket n counts samples
+     * from 2^(n-1) to 2^n - 1 microseconds, and the last bucket also counts
+     * all longer samples. */
+    uint64_t    i_buckets[LIBVLC_MEDIA_LATENCY_BUCKETS];
+} libvlc_media_latency_stats_t;
+
+/**
+ * Bytes held by the buffering subsystems of the whole LibVLC process
+ * \see libvlc_media_get_memory_stats
+ */
+typedef struct libvlc_media_memory_stats_t
+{
+    uint64_t    i_fifo_bytes;         /**< blocks queued in block FIFOs */
+    uint64_t    i_picture_pool_bytes; /**< pictures allocated by pools */
+    uint64_t    i_timeshift_bytes;    /**< timeshift storage */
+    uint64_t    i_adaptive_bytes;     /**< adaptive streaming buffers */
+    uint64_t    i_httpd_bytes;        /**< HTTP server stream buffers */
+} libvlc_media_memory_stats_t;
+
 typedef struct libvlc_audio_track_t
 {
     unsigned    i_channels;
@@ -625,6 +670,47 @@ LIBVLC_API libvlc_state_t libvlc_media_get_state(
 LIBVLC_API int libvlc_media_get_stats( libvlc_media_t *p_md,
                                            libvlc_media_stats_t *p_stats );
 
+/**
+ * Get the distribution of a latency of the decoding pipeline
+ *
+ * The samples of all the elementary streams of the given type are merged.
+ * Only video and audio are supported, and libvlc_latency_vout_queue,
+ * libvlc_latency_late and libvlc_latency_presentation are only measured for
+ * video. libvlc_latency_presentation is only measured with video outputs
+ * reporting when pictures actually reach the screen.
+ *
+ * \version LibVLC 4.0.0 and later.
+ *
+ * \param p_md media descriptor object
+ * \param i_type type of the elementary streams (video or audio)
+ * \param i_latency latency to get
+ * \param p_stats structure to fill (must be allocated by the caller)
+ * \return true if the statistics are available, false otherwise
+ *
+ * \libvlc_return_bool
+ */
+LIBVLC_API int libvlc_media_get_latency_stats( libvlc_media_t *p_md,
+                                           libvlc_track_type_t i_type,
+                                           libvlc_media_latency_t i_latency,
+                                           libvlc_media_latency_stats_t *p_stats );
+
+/**
+ * Get the memory accounting of the buffering subsystems
+ *
+ * The counters are process-wide: they are sampled along with the other
+ * statistics of the media, and cover all the medias being played.
+ *
+ * \version LibVLC 4.0.0 and later.
+ *
+ * \param p_md media descriptor object
+ * \param p_stats structure to fill (must be allocated by the caller)
+ * \return true if the statistics are available, false otherwise
+ *
+ * \libvlc_return_bool
+ */
+LIBVLC_API int libvlc_media_get_memory_stats( libvlc_media_t *p_md,
+                                           libvlc_media_memory_stats_t *p_stats );
+
 /* The following method uses libvlc_media_list_t, however, media_list usage is optionnal
  * and this is here for convenience */
 #define VLC_FORWARD_DECLARE_OBJECT(a) struct a
@@ -455,6 +455,249 @@ void libvlc_video_set_format_callbacks( libvlc_media_player_t *mp,
                                         libvlc_video_format_cb setup,
                                         libvlc_video_cleanup_cb cleanup );
 
+/**
+ * Opaque handle to a decoded video frame.
+ *
+ * A frame references the decoded picture itself, not a copy. Its pixels must
+ * not be modified.
+ *
+ * \version LibVLC 4.0.0 or later
+ */
+typedef struct libvlc_video_frame_t libvlc_video_frame_t;
+
+/** Maximum number of pixel planes of a \ref libvlc_video_frame_t */
+#define LIBVLC_VIDEO_FRAME_MAX_PLANES 5
+
+/**
+ * Callback prototype to receive a decoded video frame.
+ *
+ * This callback is invoked when the frame needs to be shown, as determined by
+ * the media playback clock. The frame is only valid for the duration of the
+ * call, unless it is retained with libvlc_video_frame_retain().
+ *
+ * \warning Frames are allocated from a bounded pool shared with the video
+ * decoder. Holding too many of them, or holding them for too long, stalls
+ * decoding.
+ *
+ * \param opaque private pointer as passed to
+ *               libvlc_video_set_frame_callback() [IN]
+ * \param frame the frame to show [IN]
+ * \version LibVLC 4.0.0 or later
+ */
+typedef void (*libvlc_video_frame_cb)(void *opaque,
+                                      libvlc_video_frame_t *frame);
+
+/**
+ * Set a callback to receive the decoded video frames without copying them.
+ *
+ * Unlike libvlc_video_set_callbacks(), LibVLC keeps the decoder chroma
+ * and dimensions, and hands out references to its own picture buffers.
+ * Hardware decoded frames are copied once to main memory, by the usual
+ * conversion process.
+ *
+ * This is mutually exclusive with libvlc_video_set_callbacks(), and must be
+ * called before the first call of libvlc_media_player_play() to take effect.
+ *
+ * \param mp the media player
+ * \param cb callback to receive frames (NULL to disable)
+ * \param opaque private pointer for the callback (as first parameter)
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API
+void libvlc_video_set_frame_callback( libvlc_media_player_t *mp,
+                                      libvlc_video_frame_cb cb,
+                                      void *opaque );
+
+/**
+ * Increment the reference count of a video frame.
+ *
+ * \param frame the frame
+ * \return the same frame
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API libvlc_video_frame_t *
+libvlc_video_frame_retain( libvlc_video_frame_t *frame );
+
+/**
+ * Decrement the reference count of a video frame, and give its buffers back
+ * to LibVLC when it reaches 0.
+ *
+ * \param frame the frame
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API void
+libvlc_video_frame_release( libvlc_video_frame_t *frame );
+
+/**
+ * Get the format of a video frame.
+ *
+ * \param frame the frame
+ * \param chroma a four-characters string identifying the chroma,
+ *               followed by a nul byte (e.g. "I420" or "NV12") [OUT]
+ * \param width visible pixel width [OUT]
+ * \param height visible pixel height [OUT]
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API void
+libvlc_video_frame_get_format( const libvlc_video_frame_t *frame,
+                               char chroma[5],
+                               unsigned *width, unsigned *height );
+
+/**
+ * Get the pixel planes of a video frame.
+ *
+ * The addresses point to the top-left pixel of the visible area of each
+ * plane. They remain valid until the frame is released.
+ *
+ * \param frame the frame
+ * \param planes table of LIBVLC_VIDEO_FRAME_MAX_PLANES plane addresses [OUT]
+ * \param pitches table of LIBVLC_VIDEO_FRAME_MAX_PLANES scanline pitches
+ *                in bytes [OUT]
+ * \param lines table of LIBVLC_VIDEO_FRAME_MAX_PLANES visible scanlines
+ *              counts [OUT]
+ * \return the number of planes
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API unsigned
+libvlc_video_frame_get_planes( const libvlc_video_frame_t *frame,
+                               const uint8_t **planes,
+                               unsigned *pitches, unsigned *lines );
+
+/**
+ * Get the presentation timestamp of a video frame.
+ *
+ * \param frame the frame
+ * \return the timestamp in microseconds, in the stream time base
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API int64_t
+libvlc_video_frame_get_pts( const libvlc_video_frame_t *frame );
+
+/**
+ * Opaque handle to an elementary stream packet.
+ *
+ * A packet references the data as demultiplexed (or transcoded), not a copy.
+ * Its data must not be modified.
+ *
+ * \version LibVLC 4.0.0 or later
+ */
+typedef struct libvlc_es_packet_t libvlc_es_packet_t;
+
+/** Elementary stream packet flags */
+typedef enum libvlc_es_packet_flag_t
+{
+    libvlc_es_packet_keyframe      = 0x1,
+    libvlc_es_packet_discontinuity = 0x2,
+    libvlc_es_packet_corrupted     = 0x4,
+} libvlc_es_packet_flag_t;
+
+/**
+ * Callback prototype to receive an elementary stream packet.
+ *
+ * The packet is only valid for the duration of the call, unless it is
+ * retained with libvlc_es_packet_retain(). This callback is invoked from
+ * the media player input thread, and must not block for long.
+ *
+ * \param opaque private pointer as passed to
+ *               libvlc_media_player_set_es_packet_callback() [IN]
+ * \param packet the packet [IN]
+ * \version LibVLC 4.0.0 or later
+ */
+typedef void (*libvlc_es_packet_cb)(void *opaque, libvlc_es_packet_t *packet);
+
+/**
+ * Set a callback to receive the packets of all elementary streams.
+ *
+ * The packets are handed out without copying them, instead of being decoded
+ * and rendered. This replaces any stream output chain of the media player.
+ *
+ * \note must be called before libvlc_media_player_play() to take effect.
+ *
+ * \param mp the media player
+ * \param cb callback to receive packets (NULL to disable)
+ * \param opaque private pointer for the callback (as first parameter)
+ * \return 0 on success, -1 on error
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API
+int libvlc_media_player_set_es_packet_callback( libvlc_media_player_t *mp,
+                                                libvlc_es_packet_cb cb,
+                                                void *opaque );
+
+/**
+ * Increment the reference count of an elementary stream packet.
+ *
+ * \param packet the packet
+ * \return the same packet
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API libvlc_es_packet_t *
+libvlc_es_packet_retain( libvlc_es_packet_t *packet );
+
+/**
+ * Decrement the reference count of an elementary stream packet, and free it
+ * when it reaches 0.
+ *
+ * \param packet the packet
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API void
+libvlc_es_packet_release( libvlc_es_packet_t *packet );
+
+/**
+ * Get the data of an elementary stream packet.
+ *
+ * \param packet the packet
+ * \param size the size of the data in bytes [OUT]
+ * \return the address of the data, valid until the packet is released
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API const uint8_t *
+libvlc_es_packet_get_data( const libvlc_es_packet_t *packet, size_t *size );
+
+/**
+ * Get the presentation timestamp of an elementary stream packet.
+ *
+ * \param packet the packet
+ * \return the timestamp in microseconds, or -1 if unknown
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API int64_t
+libvlc_es_packet_get_pts( const libvlc_es_packet_t *packet );
+
+/**
+ * Get the decoding timestamp of an elementary stream packet.
+ *
+ * \param packet the packet
+ * \return the timestamp in microseconds, or -1 if unknown
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API int64_t
+libvlc_es_packet_get_dts( const libvlc_es_packet_t *packet );
+
+/**
+ * Get the flags of an elementary stream packet.
+ *
+ * \param packet the packet
+ * \return a combination of \ref libvlc_es_packet_flag_t
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API unsigned
+libvlc_es_packet_get_flags( const libvlc_es_packet_t *packet );
+
+/**
+ * Get the elementary stream of a packet.
+ *
+ * \param packet the packet
+ * \param codec the four-character code of the stream codec [OUT]
+ * \param id the stream identifier, as in \ref libvlc_media_track_t [OUT]
+ * \return the stream type
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API libvlc_track_type_t
+libvlc_es_packet_get_track( const libvlc_es_packet_t *packet,
+                            uint32_t *codec, int *id );
+
 
 /**
  * Callback prototype called to initialize user data.
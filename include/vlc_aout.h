@@ -310,6 +310,24 @@ static const uint32_t pi_vlc_chan_order_wg4[] =
 #define AOUT_RESTART_OUTPUT         (AOUT_RESTART_FILTERS|0x2)
 #define AOUT_RESTART_STEREOMODE     (AOUT_RESTART_OUTPUT|0x4)
 
+/**
+ * Loudness measurements (EBU R128).
+ *
+ * They are reported every 100 ms by the "loudness" audio filter, through an
+ * address variable of the audio output, also named "loudness". The pointed
+ * data is only valid during the variable callbacks.
+ * Loudness values are in LUFS, peak values in dBTP, and all are -INFINITY
+ * on silence.
+ */
+struct vlc_audio_loudness
+{
+    double momentary; /**< loudness over the last 400 ms */
+    double short_term; /**< loudness over the last 3 seconds */
+    double integrated; /**< gated loudness since the beginning */
+    double true_peak; /**< true peak over the last 100 ms */
+    double max_true_peak; /**< true peak since the beginning */
+};
+
 /*****************************************************************************
  * Prototypes
  *****************************************************************************/
@@ -441,6 +459,20 @@ static inline void aout_RestartRequest(audio_output_t *aout, unsigned mode)
     aout->events->restart_request(aout, mode);
 }
 
+/**
+ * Requested period of the audio output.
+ *
+ * Audio output modules should size their device period after this value if
+ * it is non-zero, and keep only a few periods in their buffer, so that the
+ * latency of the output follows the period.
+ *
+ * \return the period requested by the user, or 0 for the module default
+ */
+static inline vlc_tick_t aout_PeriodRequest(audio_output_t *aout)
+{
+    return VLC_TICK_FROM_MS(var_InheritInteger(aout, "audio-period"));
+}
+
 /**
  * Default implementation for audio_output_t.time_get
  */
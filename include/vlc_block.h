@@ -92,6 +92,8 @@
 #define BLOCK_FLAG_BOTTOM_FIELD_FIRST 0x2000
 /** This block contains a single field from interlaced picture. */
 #define BLOCK_FLAG_SINGLE_FIELD  0x4000
+/** This block is not used as a reference to decode other blocks */
+#define BLOCK_FLAG_NON_REFERENCE 0x8000
 
 /** This block contains an interlaced picture */
 #define BLOCK_FLAG_INTERLACED_MASK \
@@ -231,6 +233,33 @@ static inline block_t *block_Duplicate( const block_t *p_block )
     return p_dup;
 }
 
+/**
+ * Shares a block.
+ *
+ * Creates a new reference to the payload of a block, without copying it.
+ * Unless it is already shared, the block is replaced with a shared block
+ * first. The payload is released when the last shared block is.
+ *
+ * The payload of a shared block must not be modified in place:
+ * block_Realloc() copies it whenever it has to grow, and block_Unshare()
+ * must be called before any other modification.
+ *
+ * @param pp_block pointer to the block to share, updated on success
+ * @return the new shared block on success, NULL on error.
+ */
+VLC_API block_t *block_Share(block_t **pp_block) VLC_USED;
+
+/**
+ * Makes the payload of a block writable.
+ *
+ * If the block shares its payload with other blocks, it is replaced with a
+ * writeable duplicate. Otherwise it is returned as is.
+ *
+ * @param block block to make writable (released on error)
+ * @return the writable block on success, NULL on error.
+ */
+VLC_API block_t *block_Unshare(block_t *block) VLC_USED;
+
 /**
  * Wraps heap in a block.
  *
@@ -448,6 +477,21 @@ static inline block_t *block_ChainGather( block_t *p_list )
  */
 VLC_API block_fifo_t *block_FifoNew(void) VLC_USED VLC_MALLOC;
 
+/**
+ * Creates a lock-less single producer single consumer FIFO queue of blocks.
+ *
+ * Only one thread may call block_FifoPut(), and only one other thread may
+ * call block_FifoGet(), block_FifoTryGet(), block_FifoShow() and
+ * block_FifoEmpty() on the queue.
+ * The consumer thread only sleeps on a lock if the queue is empty.
+ *
+ * @warning The vlc_fifo_Lock() family of functions must not be used
+ * with this type of queue.
+ *
+ * @return the FIFO or NULL on memory error
+ */
+VLC_API block_fifo_t *block_FifoNewSPSC(void) VLC_USED VLC_MALLOC;
+
 /**
  * Destroys a FIFO created by block_FifoNew().
  *
@@ -478,6 +522,13 @@ VLC_API void block_FifoPut(block_fifo_t *fifo, block_t *block);
  */
 VLC_API block_t *block_FifoGet(block_fifo_t *) VLC_USED;
 
+/**
+ * Dequeue the first block from the FIFO, if any, without waiting.
+ *
+ * @return a block, or NULL if the queue is empty
+ */
+VLC_API block_t *block_FifoTryGet(block_fifo_t *) VLC_USED;
+
 /**
  * Peeks the first block in the FIFO.
  *
@@ -113,12 +113,27 @@ struct decoder_t
     /* Tell the decoder if it is allowed to drop frames */
     bool                b_frame_drop_allowed;
 
+    /* Tell the packetizer if the closed captions retrieved with pf_get_cc
+     * are decoded. If not, it only needs to report the channels present. */
+    bool                b_cc_wanted;
+
     /**
      * Number of extra (ie in addition to the DPB) picture buffers
      * needed for decoding.
      */
     int                 i_extra_picture_buffers;
 
+    /**
+     * Size the decoded video will be shown at, if known to be smaller than
+     * the coded size, or 0 if unknown.
+     *
+     * This is only a hint: a video decoder may output pictures downscaled
+     * towards (but not below) this size, if that is cheaper than decoding
+     * them at full size.
+     */
+    unsigned            i_target_width;
+    unsigned            i_target_height;
+
     union
     {
 #       define VLCDEC_SUCCESS   VLC_SUCCESS
@@ -185,7 +200,8 @@ struct decoder_t
      * return CC for the pictures returned by the last pf_packetize call only,
      * channel bitmaps will be used to known which cc channel are present (but
      * globaly, not necessary for the current packet. Video decoders should use
-     * the decoder_QueueCc() function to pass closed captions. */
+     * the decoder_QueueCc() function to pass closed captions.
+     * The channel bitmaps are set even if no data is returned. */
     block_t *           ( * pf_get_cc )      ( decoder_t *, decoder_cc_desc_t * );
 
     /* Meta data at codec level
@@ -44,6 +44,7 @@ VLC_API unsigned vlc_CPU(void);
 #  define VLC_CPU_AVX2   0x00004000
 #  define VLC_CPU_XOP    0x00008000
 #  define VLC_CPU_FMA4   0x00010000
+#  define VLC_CPU_AVX512 0x00020000 /**< AVX-512 F, CD, BW, DQ and VL */
 
 # if defined (__MMX__)
 #  define vlc_CPU_MMX() (1)
@@ -129,6 +130,14 @@ VLC_API unsigned vlc_CPU(void);
 #  define vlc_CPU_FMA4() ((vlc_CPU() & VLC_CPU_FMA4) != 0)
 # endif
 
+# if defined (__AVX512F__) && defined (__AVX512CD__) \
+  && defined (__AVX512BW__) && defined (__AVX512DQ__) \
+  && defined (__AVX512VL__)
+#  define vlc_CPU_AVX512() (1)
+# else
+#  define vlc_CPU_AVX512() ((vlc_CPU() & VLC_CPU_AVX512) != 0)
+# endif
+
 # elif defined (__ppc__) || defined (__ppc64__) || defined (__powerpc__)
 #  define HAVE_FPU 1
 #  define VLC_CPU_ALTIVEC 2
@@ -172,6 +181,7 @@ VLC_API unsigned vlc_CPU(void);
 #  define HAVE_FPU 1
 #  define VLC_CPU_ARM_NEON 0x1
 #  define VLC_CPU_ARM_SVE  0x2
+#  define VLC_CPU_ARM_SVE2 0x4
 
 #  ifdef __ARM_NEON
 #   define vlc_CPU_ARM_NEON() (1)
@@ -185,6 +195,12 @@ VLC_API unsigned vlc_CPU(void);
 #   define vlc_CPU_ARM_SVE()   ((vlc_CPU() & VLC_CPU_ARM_SVE) != 0)
 #  endif
 
+#  ifdef __ARM_FEATURE_SVE2
+#   define vlc_CPU_ARM_SVE2()  (1)
+#  else
+#   define vlc_CPU_ARM_SVE2()  ((vlc_CPU() & VLC_CPU_ARM_SVE2) != 0)
+#  endif
+
 # elif defined (__sparc__)
 #  define HAVE_FPU 1
 
@@ -201,4 +217,38 @@ VLC_API unsigned vlc_CPU(void);
 
 # endif
 
+/**
+ * Implementation of a kernel for a given instruction set extension.
+ */
+struct vlc_cpu_kernel
+{
+    const char *isa; /**< Instruction set name (for debugging) */
+    unsigned flags; /**< Required VLC_CPU_* flags (0 for portable code) */
+    void (*func)(void); /**< Implementation (to be cast to its real type) */
+};
+
+#define VLC_CPU_KERNEL(isa, flags, func) \
+    { isa, flags, (void (*)(void))(func) }
+
+/**
+ * Selects the best supported implementation of a kernel.
+ *
+ * The implementations are tried in order, so the table should list the most
+ * specific ones first, and end with portable code (no required flags).
+ * Implementations requiring instructions above the "cpu-level" option of the
+ * object are skipped, so that the slower code paths can be benchmarked and
+ * tested on any machine.
+ *
+ * \param obj object selecting the kernel (for options and logging)
+ * \param name kernel name (for debugging)
+ * \param table implementations, most specific first
+ * \param count number of implementations in the table
+ * \return the selected implementation, or NULL if none is supported
+ */
+VLC_API const struct vlc_cpu_kernel *
+vlc_CPU_SelectKernel(vlc_object_t *obj, const char *name,
+                     const struct vlc_cpu_kernel *table, size_t count);
+#define vlc_CPU_SelectKernel(o, n, t, c) \
+    vlc_CPU_SelectKernel(VLC_OBJECT(o), n, t, c)
+
 #endif /* !VLC_CPU_H */
@@ -229,6 +229,18 @@ enum demux_query_e
      * arg1= bool */
     DEMUX_SET_RECORD_STATE,
 
+    /**
+     * Hints that only key frames of video elementary streams are needed,
+     * typically for trick play at high rate.
+     *
+     * Demuxers with an index may then skip the other video frames without
+     * reading them. This is only a hint: frames from streams without key
+     * frame information can still be sent.
+     * Can fail (assume that everything is sent).
+     *
+     * arg1= bool */
+    DEMUX_SET_KEYFRAMES_ONLY,
+
     /* II. Specific access_demux queries */
 
     /* DEMUX_CAN_CONTROL_RATE is called only if DEMUX_CAN_CONTROL_PACE has
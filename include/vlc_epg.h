@@ -109,6 +109,18 @@ VLC_API bool vlc_epg_AddEvent(vlc_epg_t *p_epg, vlc_epg_event_t *p_evt);
  */
 VLC_API void vlc_epg_SetCurrent(vlc_epg_t *p_epg, int64_t i_start);
 
+/**
+ * Returns whether two events have the same identifier, times and contents.
+ */
+VLC_API bool vlc_epg_event_Equals(const vlc_epg_event_t *a,
+                                  const vlc_epg_event_t *b);
+
+/**
+ * Returns whether two tables have the same attributes, current event and
+ * events, so that an update from \p b to \p a can be skipped.
+ */
+VLC_API bool vlc_epg_Equals(const vlc_epg_t *a, const vlc_epg_t *b);
+
 /**
  * Returns a duplicated \p p_src and its associated events.
  *
@@ -392,6 +392,9 @@ struct video_format_t
         uint16_t MaxFALL; /* max frame average light level */
     } lighting;
     uint32_t i_cubemap_padding; /**< padding in pixels of the cube map faces */
+    unsigned int i_dpb_size;  /**< decoded picture buffer size, 0 if unknown */
+    unsigned int i_max_width;  /**< largest picture width, 0 if unknown */
+    unsigned int i_max_height; /**< largest picture height, 0 if unknown */
 };
 
 /**
@@ -676,6 +679,16 @@ VLC_API void es_format_InitFromVideo( es_format_t *, const video_format_t * );
  */
 VLC_API int es_format_Copy( es_format_t *p_dst, const es_format_t *p_src );
 
+/**
+ * This function will replace an initialized es_format_t with a copy of
+ * another one.
+ *
+ * It is equivalent to es_format_Clean() followed by es_format_Copy(), but
+ * the buffers of the destination that already hold the same data (strings,
+ * extradata, palette) are kept rather than reallocated.
+ */
+VLC_API int es_format_Update( es_format_t *p_dst, const es_format_t *p_src );
+
 /**
  * This function will clean up a es_format_t and release all associated
  * resources.
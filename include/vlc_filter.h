@@ -26,6 +26,7 @@
 #define VLC_FILTER_H 1
 
 #include <vlc_es.h>
+#include <vlc_block.h>
 
 /**
  * \defgroup filter Filters
@@ -46,12 +47,18 @@ struct filter_subpicture_callbacks
     subpicture_t *(*buffer_new)(filter_t *);
 };
 
+struct filter_audio_callbacks
+{
+    block_t *(*buffer_new)(filter_t *, size_t);
+};
+
 typedef struct filter_owner_t
 {
     union
     {
         const struct filter_video_callbacks *video;
         const struct filter_subpicture_callbacks *sub;
+        const struct filter_audio_callbacks *audio;
     };
     void *sys;
 } filter_owner_t;
@@ -169,6 +176,22 @@ static inline picture_t *filter_NewPicture( filter_t *p_filter )
     return pic;
 }
 
+/**
+ * This function will return a new audio block usable by p_filter as an
+ * output buffer. The owner can recycle the blocks of a filter, as they
+ * usually have the same size from one call to the next; otherwise this is
+ * the same as block_Alloc().
+ * You have to release it using block_Release or by returning it to the
+ * caller as a pf_audio_filter return value.
+ */
+static inline block_t *filter_NewAudioBuffer( filter_t *p_filter,
+                                              size_t i_size )
+{
+    if( p_filter->owner.audio != NULL )
+        return p_filter->owner.audio->buffer_new( p_filter, i_size );
+    return block_Alloc( i_size );
+}
+
 /**
  * Flush a filter
  *
@@ -279,6 +302,41 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+/**
+ * Process the rows of a picture with several threads.
+ *
+ * The rows [0, rows) are split in bands of an even number of rows, that are
+ * processed concurrently by the shared executor threads and by the calling
+ * thread. The bands must be independent from one another. This returns once
+ * all the bands have been processed; the calling thread runs everything by
+ * itself if no other thread is available.
+ *
+ * \param rows number of rows
+ * \param pf_band callback processing the rows [first, first + count)
+ * \param opaque data for the callback
+ */
+VLC_API void filter_ParallelRows( unsigned rows,
+                                  void (*pf_band)( void *opaque,
+                                                   unsigned first,
+                                                   unsigned count ),
+                                  void *opaque );
+
+/**
+ * Run independent jobs with several threads.
+ *
+ * The jobs [0, jobs) are run concurrently by the shared executor threads and
+ * by the calling thread, each job running once. This returns once all the
+ * jobs have run.
+ *
+ * \param jobs number of jobs
+ * \param pf_job callback running the job of the given index
+ * \param opaque data for the callback
+ */
+VLC_API void filter_ParallelJobs( unsigned jobs,
+                                  void (*pf_job)( void *opaque,
+                                                  unsigned index ),
+                                  void *opaque );
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
@@ -420,6 +478,45 @@ VLC_API const es_format_t *filter_chain_GetFmtOut(const filter_chain_t *chain);
 VLC_API picture_t *filter_chain_VideoFilter(filter_chain_t *chain,
                                             picture_t *pic);
 
+/**
+ * Run each filter of a video chain on its own thread.
+ *
+ * Consecutive pictures are then processed concurrently by the different
+ * filters, each filter still seeing its pictures one at a time and in order.
+ * filter_chain_VideoFilter() queues the picture and returns one of the
+ * pictures that went through the whole chain, if any, without waiting for
+ * it; filter_chain_VideoDrain() waits for the pictures still in flight.
+ *
+ * The chain must not be modified while pipelined; filter_chain_Reset() and
+ * filter_chain_Delete() stop the threads.
+ *
+ * \param chain video filter chain, with all its filters appended
+ * \param depth maximum number of pictures queued before each filter,
+ *              or 0 to go back to running the filters sequentially
+ * \return VLC_SUCCESS, or an error if the threads cannot be started, in
+ *         which case the chain runs sequentially
+ */
+VLC_API int filter_chain_VideoPipeline(filter_chain_t *chain, unsigned depth);
+
+/**
+ * Get the next picture still in a video filter chain.
+ *
+ * With a pipelined chain, this waits until a picture gets out of the chain
+ * or until all the queued pictures have been filtered.
+ *
+ * \return a filtered picture, or NULL if the chain is empty
+ */
+VLC_API picture_t *filter_chain_VideoDrain(filter_chain_t *chain);
+
+/**
+ * Count the pictures in a pipelined video filter chain.
+ *
+ * \return the number of pictures queued or being filtered, plus the number
+ *         of pictures out of the chain but not retrieved yet, or 0 if the
+ *         chain is not pipelined
+ */
+VLC_API unsigned filter_chain_VideoPipelineCount(filter_chain_t *chain);
+
 /**
  * Flush a video filter chain.
  */
@@ -36,6 +36,7 @@ struct fingerprint_request_t
 {
     input_item_t *p_item;
     unsigned int i_duration; /* track length hint in seconds, 0 if unknown */
+    bool b_fingerprint_only; /* skip the web lookup, only compute the print */
     struct
     {
         char *psz_fingerprint;
@@ -51,6 +52,7 @@ static inline fingerprint_request_t *fingerprint_request_New( input_item_t *p_it
     if ( !p_r ) return NULL;
     p_r->results.psz_fingerprint = NULL;
     p_r->i_duration = 0;
+    p_r->b_fingerprint_only = false;
     input_item_Hold( p_item );
     p_r->p_item = p_item;
     vlc_array_init( & p_r->results.metas_array ); /* shouldn't be needed */
@@ -135,6 +135,12 @@ typedef struct httpd_redirect_t httpd_redirect_t;
 VLC_API httpd_redirect_t * httpd_RedirectNew( httpd_host_t *, const char *psz_url_dst, const char *psz_url_src ) VLC_USED;
 VLC_API void httpd_RedirectDelete( httpd_redirect_t * );
 
+/* Serves the regular files of a directory below the URL, with entity tags,
+ * conditional and byte range requests */
+typedef struct httpd_dir_t httpd_dir_t;
+VLC_API httpd_dir_t * httpd_DirNew( httpd_host_t *, const char *psz_url, const char *psz_path, const char *psz_user, const char *psz_password ) VLC_USED;
+VLC_API void httpd_DirDelete( httpd_dir_t * );
+
 
 typedef struct httpd_stream_t httpd_stream_t;
 VLC_API httpd_stream_t * httpd_StreamNew( httpd_host_t *, const char *psz_url, const char *psz_mime, const char *psz_user, const char *psz_password ) VLC_USED;
@@ -53,9 +53,10 @@ struct image_handler_t
 
     /* Private properties */
     vlc_object_t *p_parent;
-    decoder_t *p_dec;
+#define IMAGE_HANDLER_CACHE_SIZE 4
+    decoder_t *pp_dec[IMAGE_HANDLER_CACHE_SIZE]; /* most recently used first */
     encoder_t *p_enc;
-    filter_t  *p_converter;
+    filter_t  *pp_converter[IMAGE_HANDLER_CACHE_SIZE];
 
     picture_fifo_t *outfifo;
 };
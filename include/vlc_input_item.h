@@ -271,6 +271,27 @@ VLC_API void input_item_SetMeta( input_item_t *, vlc_meta_type_t meta_type, cons
 VLC_API bool input_item_MetaMatch( input_item_t *p_i, vlc_meta_type_t meta_type, const char *psz );
 VLC_API char * input_item_GetMeta( input_item_t *p_i, vlc_meta_type_t meta_type ) VLC_USED;
 VLC_API const char *input_item_GetMetaLocked(input_item_t *, vlc_meta_type_t meta_type);
+
+/**
+ * Returns a number that changes whenever the meta of an item change.
+ *
+ * This does not lock the item: user interfaces can poll it cheaply, and
+ * only take a new snapshot of the meta when it changed.
+ */
+VLC_API unsigned input_item_GetMetaGeneration( input_item_t * );
+
+/**
+ * Copies the meta of an item.
+ *
+ * The copy can then be read without locking the item. Repeated values
+ * (artist, album...) are shared with the item, which makes the copy cheap.
+ *
+ * \param generation the meta generation of the copy [OUT], or NULL
+ * \return the copy to release with vlc_meta_Delete(), or NULL if the item
+ * has no meta
+ */
+VLC_API vlc_meta_t *input_item_GetMetaSnapshot( input_item_t *,
+                                                unsigned *generation ) VLC_USED;
 VLC_API char * input_item_GetName( input_item_t * p_i ) VLC_USED;
 VLC_API char * input_item_GetTitleFbName( input_item_t * p_i ) VLC_USED;
 VLC_API char * input_item_GetURI( input_item_t * p_i ) VLC_USED;
@@ -412,6 +433,40 @@ VLC_API void libvlc_MetadataCancel( libvlc_int_t *, void * );
 /******************
  * Input stats
  ******************/
+#define INPUT_LATENCY_BUCKETS 24
+
+/**
+ * Latency measured at some point of the decoding pipeline
+ */
+enum input_latency_e
+{
+    INPUT_LATENCY_FIFO,       /**< Residency in the decoder input FIFO */
+    INPUT_LATENCY_DECODE,     /**< Decoding time of a block */
+    INPUT_LATENCY_WAIT,       /**< Wait for the end of buffering */
+    INPUT_LATENCY_VOUT_QUEUE, /**< Residency in the video output queue */
+    INPUT_LATENCY_LATE,       /**< Lateness of displayed pictures */
+    INPUT_LATENCY_PRESENTATION, /**< Error of the actual presentation time */
+    INPUT_LATENCY_DEMUX_BLOCKED, /**< Wait of the demuxer for FIFO room */
+    INPUT_LATENCY_PACKETIZER_BLOCKED, /**< Wait of the packetizer thread for
+                                           decoder FIFO room */
+};
+#define INPUT_LATENCY_COUNT (INPUT_LATENCY_PACKETIZER_BLOCKED + 1)
+
+/**
+ * Distribution of latencies
+ *
+ * Bucket 0 counts samples below 1 microsecond, bucket n counts samples from
+ * 2^(n-1) to 2^n - 1 microseconds, and the last bucket also counts all
+ * longer samples.
+ */
+typedef struct input_latency_t
+{
+    uint64_t i_count;
+    vlc_tick_t i_total;
+    vlc_tick_t i_max;
+    uint64_t i_buckets[INPUT_LATENCY_BUCKETS];
+} input_latency_t;
+
 struct input_stats_t
 {
     /* Input */
@@ -437,6 +492,17 @@ struct input_stats_t
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+
+    /* Memory held process-wide by each subsystem (see vlc_memstats.h) */
+    int64_t i_fifo_bytes;
+    int64_t i_picture_pool_bytes;
+    int64_t i_timeshift_bytes;
+    int64_t i_adaptive_bytes;
+    int64_t i_httpd_bytes;
+
+    /* Latencies (only collected if statistics are enabled) */
+    input_latency_t video_latency[INPUT_LATENCY_COUNT];
+    input_latency_t audio_latency[INPUT_LATENCY_COUNT];
 };
 
 /**
@@ -0,0 +1,57 @@
+/*****************************************************************************
+ * vlc_memstats.h: memory accounting
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_MEMSTATS_H
+#define VLC_MEMSTATS_H
+
+/**
+ * \defgroup memstats Memory accounting
+ * \ingroup os
+ *
+ * Process-wide counters of the bytes held by the main buffering subsystems.
+ * They are updated with relaxed atomic operations, so they are always
+ * enabled, and they are meant for monitoring, not for exact bookkeeping:
+ * a reader may observe a transient state.
+ * @{
+ */
+
+enum vlc_memstats_type
+{
+    VLC_MEMSTATS_FIFO, /**< Blocks queued in block FIFOs */
+    VLC_MEMSTATS_PICTURE_POOL, /**< Pictures allocated by picture pools */
+    VLC_MEMSTATS_TIMESHIFT, /**< Timeshift storage (usually on disk) */
+    VLC_MEMSTATS_ADAPTIVE, /**< Adaptive streaming download buffers */
+    VLC_MEMSTATS_HTTPD, /**< HTTP server stream buffers */
+};
+
+#define VLC_MEMSTATS_COUNT (VLC_MEMSTATS_HTTPD + 1)
+
+/**
+ * Accounts for allocated (if positive) or freed (if negative) bytes.
+ */
+VLC_API void vlc_memstats_Add(enum vlc_memstats_type type, ssize_t bytes);
+
+/**
+ * Gets the number of bytes currently accounted for a subsystem.
+ */
+VLC_API size_t vlc_memstats_Get(enum vlc_memstats_type type);
+
+/** @} */
+#endif /* VLC_MEMSTATS_H */
@@ -225,6 +225,21 @@ VLC_API void picture_Reset( picture_t * );
 VLC_API void picture_CopyPixels( picture_t *p_dst, const picture_t *p_src );
 VLC_API void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src );
 
+/**
+ * This function will copy a rectangle of the picture pixels, to the same
+ * position in the destination picture.
+ *
+ * The rectangle is expressed in pixels of the first plane; it is mapped to
+ * the subsampled planes, and clipped to the visible part of both pictures.
+ * Both pictures must have the same chroma.
+ */
+VLC_API void picture_CopyPixelsRect( picture_t *p_dst, const picture_t *p_src,
+                                     unsigned x, unsigned y,
+                                     unsigned width, unsigned height );
+VLC_API void plane_CopyPixelsRect( plane_t *p_dst, const plane_t *p_src,
+                                   unsigned x, unsigned y,
+                                   unsigned width, unsigned height );
+
 /**
  * This function will copy both picture dynamic properties and pixels.
  * You have to notice that sometime a simple picture_Hold may do what
@@ -247,6 +262,20 @@ VLC_API void picture_Copy( picture_t *p_dst, const picture_t *p_src );
  */
 VLC_API picture_t *picture_Clone(picture_t *pic);
 
+/**
+ * Perform a shallow copy of a part of a picture
+ *
+ * The clone has the given format, and its planes point inside the planes of
+ * the picture, from the given position in pixels of the first plane. The
+ * picture is held until the clone is released. The pixels are shared, so
+ * neither picture should be written while the clone is in use.
+ *
+ * \return A clone picture on success, NULL if the part does not fit in the
+ * picture, or if the picture pixels are not in memory.
+ */
+VLC_API picture_t *picture_CloneCrop(picture_t *pic, const video_format_t *fmt,
+                                     unsigned x, unsigned y);
+
 /**
  * This function will export a picture to an encoded bitstream.
  *
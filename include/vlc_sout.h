@@ -301,6 +301,15 @@ typedef struct sout_description_data_t
     vlc_sem_t *sem;
 } sout_description_data_t;
 
+/** Share module (inputs shared by several VLM broadcasts) */
+typedef struct sout_share_data_t
+{
+    void *opaque;
+    void *(*add)(void *opaque, const es_format_t *);
+    void (*del)(void *opaque, void *id);
+    int (*send)(void *opaque, void *id, block_t *);
+} sout_share_data_t;
+
 /** @} */
 
 #ifdef __cplusplus
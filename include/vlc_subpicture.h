@@ -103,6 +103,14 @@ struct vlc_spu_highlight_t
  */
 VLC_API subpicture_region_t * subpicture_region_New( const video_format_t *p_fmt );
 
+/**
+ * This function will create a new subpicture region sharing an existing
+ * picture, instead of allocating one.
+ *
+ * The picture is held by the region. It must not be modified afterward.
+ */
+VLC_API subpicture_region_t * subpicture_region_ForPicture( const video_format_t *p_fmt, picture_t *p_picture );
+
 /**
  * This function will destroy a subpicture region allocated by
  * subpicture_region_New.
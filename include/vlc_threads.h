@@ -1022,6 +1022,50 @@ VLC_API unsigned vlc_timer_getoverrun(vlc_timer_t) VLC_USED;
  */
 VLC_API unsigned vlc_GetCPUCount(void);
 
+/**
+ * Reserves threads from the process-wide decoding budget.
+ *
+ * Multithreaded decoders should call this when they choose their thread count
+ * automatically, so that concurrent decoders share the CPUs rather than each
+ * sizing itself for the whole machine. The budget is the CPU count. Requests
+ * are granted in full while the budget lasts; beyond that, each caller gets a
+ * fair share, i.e. the CPU count divided by the number of reservations.
+ *
+ * Releasing and reserving again rebalances a reservation against the current
+ * load, e.g. when the decoder is restarted.
+ *
+ * \param wanted number of threads the caller would use on an idle system
+ * \return the number of threads to use (at least 1 and at most wanted)
+ */
+VLC_API unsigned vlc_ReserveCPUThreads(unsigned wanted) VLC_USED;
+
+/**
+ * Releases threads reserved with vlc_ReserveCPUThreads().
+ *
+ * \param count the value returned by vlc_ReserveCPUThreads()
+ */
+VLC_API void vlc_ReleaseCPUThreads(unsigned count);
+
+/**
+ * Applies the configured CPU affinity to the calling thread.
+ *
+ * Pipeline threads call this when they start. The CPUs are read from the
+ * "<subsystem>-cpu-affinity" option of the given object, or if that is not
+ * set, from its "cpu-affinity" option. As options are inherited, setting
+ * them on an input item pins all of the threads of that input.
+ *
+ * The value is a comma-separated list of CPU numbers or ranges, and "node<N>"
+ * tokens for all of the CPUs of a NUMA node. The thread is left unchanged if
+ * no affinity is configured or if the platform does not support it.
+ *
+ * \param obj object whose options apply to the thread
+ * \param subsystem subsystem name ("input", "decoder", "vout", "encoder" or
+ *                  "sout")
+ */
+VLC_API void vlc_thread_set_affinity(vlc_object_t *obj, const char *subsystem);
+#define vlc_thread_set_affinity(o, s) \
+    vlc_thread_set_affinity(VLC_OBJECT(o), s)
+
 enum
 {
     VLC_CLEANUP_PUSH,
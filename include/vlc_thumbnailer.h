@@ -48,6 +48,16 @@ typedef void(*vlc_thumbnailer_cb)( void* data, picture_t* thumbnail );
  * \brief vlc_thumbnailer_Create Creates a thumbnailer object
  * \param parent A VLC object
  * \return A thumbnailer object, or NULL in case of failure
+ *
+ * Pending requests are processed in parallel, by up to "thumbnailer-threads"
+ * lightweight inputs (no audio, subtitles nor meta data), as inherited from
+ * the parent object.
+ *
+ * After a fast seek, the thumbnail is the first key frame, and the pictures
+ * before it are not decoded. Set "dec-target-width" and "dec-target-height"
+ * on the parent object to the thumbnail size to have the decoders that
+ * support it (avcodec lowres, JPEG DCT scaling) decode at a reduced
+ * resolution. The thumbnail is not scaled further.
  */
 VLC_API vlc_thumbnailer_t*
 vlc_thumbnailer_Create( vlc_object_t* p_parent )
@@ -419,6 +419,17 @@ static inline void vlc_tls_Close(vlc_tls_t *session)
  */
 VLC_API vlc_tls_t *vlc_tls_SocketOpen(int fd);
 
+/**
+ * Gets the socket of a plain transport-layer stream.
+ *
+ * This allows a TLS implementation to operate on the socket directly, e.g. to
+ * offload the record layer to the operating system kernel.
+ *
+ * @return the connected socket file descriptor underlying the stream,
+ * or -1 if the stream is not a plain connected socket
+ */
+VLC_API int vlc_tls_GetSocketFD(vlc_tls_t *);
+
 /**
  * Creates a connected pair of transport-layer sockets.
  */
@@ -457,8 +468,8 @@ VLC_API vlc_tls_t *vlc_tls_SocketOpenAddrInfo(const struct addrinfo *ai,
  * This function resolves a hostname, and attempts to establish a TCP/IP
  * connection to the specified host and port number.
  *
- * @note The function currently iterates through the addrinfo linked list.
- * Future versions may implement different behaviour (e.g. RFC6555).
+ * @note Connections to the different addresses of the host are raced as per
+ * RFC8305, and the resolution is cached for a short time.
  *
  * @return a transport layer socket on success or NULL on error
  */
@@ -0,0 +1,113 @@
+/*****************************************************************************
+ * vlc_tracer.h: tracing interface
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_TRACER_H
+#define VLC_TRACER_H
+
+#include <stdint.h>
+
+/**
+ * \defgroup tracer Tracer module and API
+ * \ingroup os
+ *
+ * Structured, timestamped events about the playback pipeline, for offline
+ * latency and synchronization analysis. Unlike log messages, trace events
+ * are not formatted: each one is a list of key/value entries.
+ *
+ * Tracing is disabled unless a tracer module is selected with "tracer".
+ * vlc_object_get_tracer() then returns NULL, and trace points cost a single
+ * test.
+ * @{
+ */
+
+struct vlc_tracer;
+
+enum vlc_tracer_value
+{
+    VLC_TRACER_INT,
+    VLC_TRACER_STRING,
+};
+
+/** Trace event entry */
+struct vlc_tracer_entry
+{
+    const char *key; /**< Entry name, NULL for the terminating entry */
+    enum vlc_tracer_value type;
+    union
+    {
+        int64_t integer;
+        const char *string;
+    } value;
+};
+
+/**
+ * Tracer module operations
+ */
+struct vlc_tracer_operations
+{
+    /**
+     * Records an event.
+     *
+     * This is called from any thread, concurrently.
+     *
+     * \param opaque tracer module private data
+     * \param ts event timestamp (vlc_tick_now() time base)
+     * \param entries event entries, terminated by a NULL key
+     */
+    void (*trace)(void *opaque, vlc_tick_t ts,
+                  const struct vlc_tracer_entry *entries);
+    void (*destroy)(void *opaque);
+};
+
+/**
+ * Records a trace event.
+ *
+ * \param tracer tracer (cannot be NULL)
+ * \param entries event entries, terminated by a NULL key
+ */
+VLC_API void vlc_tracer_Trace(struct vlc_tracer *tracer,
+                              const struct vlc_tracer_entry *entries);
+
+/**
+ * Gets the tracer of the instance of an object.
+ *
+ * \return the tracer, or NULL if tracing is disabled
+ */
+VLC_API struct vlc_tracer *vlc_object_get_tracer(vlc_object_t *obj);
+#define vlc_object_get_tracer(o) vlc_object_get_tracer(VLC_OBJECT(o))
+
+#ifndef __cplusplus
+# define VLC_TRACE_INT(k, v) \
+    { .key = (k), .type = VLC_TRACER_INT, .value.integer = (v) }
+# define VLC_TRACE_STRING(k, v) \
+    { .key = (k), .type = VLC_TRACER_STRING, .value.string = (v) }
+# define VLC_TRACE_END { .key = NULL }
+
+/**
+ * Records a trace event from a list of VLC_TRACE_INT() and
+ * VLC_TRACE_STRING() entries.
+ */
+# define vlc_tracer_TraceEntries(tracer, ...) \
+    vlc_tracer_Trace(tracer, (const struct vlc_tracer_entry[]) { \
+        __VA_ARGS__, VLC_TRACE_END })
+#endif
+
+/** @} */
+#endif /* VLC_TRACER_H */
@@ -109,6 +109,7 @@ typedef struct {
     bool has_double_click;                  /* Is double-click generated */
     bool has_pictures_invalid;              /* Can handle VOUT_DISPLAY_RESET_PICTURES */
     bool can_scale_spu;                     /* Handles subpictures with a non default zoom factor */
+    bool can_deinterlace;                   /* Deinterlaces interlaced pictures itself */
     const vlc_fourcc_t *subpicture_chromas; /* List of supported chromas for subpicture rendering. */
 } vout_display_info_t;
 
@@ -169,6 +170,7 @@ enum {
 enum {
     /* VR navigation */
     VOUT_DISPLAY_EVENT_VIEWPOINT_MOVED,
+    VOUT_DISPLAY_EVENT_PRESENTED,
 };
 
 /**
@@ -391,6 +393,28 @@ static inline void vout_display_SendEventViewpointMoved(vout_display_t *vd,
     vout_display_SendEvent(vd, VOUT_DISPLAY_EVENT_VIEWPOINT_MOVED, vp);
 }
 
+/**
+ * Reports when a picture actually reached the screen.
+ *
+ * Displays that get presentation feedback from the windowing system should
+ * report it for every displayed picture. The video output then schedules
+ * the following pictures on the refresh cycle of the screen.
+ *
+ * \param date system time the picture was due for,
+ *             as passed to vout_display_t::prepare
+ * \param presented system time of the refresh cycle that showed the picture
+ * \param period refresh period of the screen,
+ *               or 0 if variable (adaptive sync) or unknown
+ */
+static inline void vout_display_SendEventPresented(vout_display_t *vd,
+                                                   vlc_tick_t date,
+                                                   vlc_tick_t presented,
+                                                   vlc_tick_t period)
+{
+    vout_display_SendEvent(vd, VOUT_DISPLAY_EVENT_PRESENTED,
+                           date, presented, period);
+}
+
 /**
  * Helper function that applies the necessary transforms to the mouse position
  * and then calls vout_display_SendEventMouseMoved.
@@ -32,6 +32,8 @@
 #include "libvlc_internal.h"
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_list.h>
 
 /*
  * Event Handling
@@ -75,8 +77,152 @@ typedef struct libvlc_event_listener_t
     libvlc_event_type_t event_type;
     void *              p_user_data;
     libvlc_callback_t   pf_callback;
+    libvlc_event_queue_t *p_queue; /* NULL for synchronous listeners */
 } libvlc_event_listener_t;
 
+/*
+ * Event queues
+ *
+ * Events for queued listeners are copied to the queue by the thread sending
+ * them, and delivered later by whichever application thread calls
+ * libvlc_event_queue_dispatch(). Locking order is dispatch_lock, then the
+ * event manager lock, then the queue lock.
+ */
+
+typedef struct libvlc_event_entry_t
+{
+    struct vlc_list node;
+    const libvlc_event_listener_t *listener;
+    void *              p_user_data;
+    libvlc_callback_t   pf_callback;
+    libvlc_event_t      event;
+} libvlc_event_entry_t;
+
+struct libvlc_event_queue_t
+{
+    vlc_mutex_t         dispatch_lock; /* held while calling back */
+    vlc_mutex_t         lock;
+    vlc_cond_t          wait;
+    struct vlc_list     pending;
+    bool                b_wakeup;
+    vlc_atomic_rc_t     rc;
+};
+
+/* Events without pointers in their payload, which remain meaningful after
+ * the sending function returned */
+static bool libvlc_event_is_queueable(libvlc_event_type_t type)
+{
+    switch (type)
+    {
+        case libvlc_MediaMetaChanged:
+        case libvlc_MediaDurationChanged:
+        case libvlc_MediaParsedChanged:
+        case libvlc_MediaStateChanged:
+        case libvlc_MediaPlayerNothingSpecial:
+        case libvlc_MediaPlayerOpening:
+        case libvlc_MediaPlayerBuffering:
+        case libvlc_MediaPlayerPlaying:
+        case libvlc_MediaPlayerPaused:
+        case libvlc_MediaPlayerStopped:
+        case libvlc_MediaPlayerForward:
+        case libvlc_MediaPlayerBackward:
+        case libvlc_MediaPlayerEndReached:
+        case libvlc_MediaPlayerEncounteredError:
+        case libvlc_MediaPlayerTimeChanged:
+        case libvlc_MediaPlayerPositionChanged:
+        case libvlc_MediaPlayerSeekableChanged:
+        case libvlc_MediaPlayerPausableChanged:
+        case libvlc_MediaPlayerTitleChanged:
+        case libvlc_MediaPlayerLengthChanged:
+        case libvlc_MediaPlayerVout:
+        case libvlc_MediaPlayerScrambledChanged:
+        case libvlc_MediaPlayerESAdded:
+        case libvlc_MediaPlayerESDeleted:
+        case libvlc_MediaPlayerESSelected:
+        case libvlc_MediaPlayerCorked:
+        case libvlc_MediaPlayerUncorked:
+        case libvlc_MediaPlayerMuted:
+        case libvlc_MediaPlayerUnmuted:
+        case libvlc_MediaPlayerAudioVolume:
+        case libvlc_MediaPlayerChapterChanged:
+        case libvlc_MediaPlayerAudioLoudness:
+        case libvlc_MediaListEndReached:
+        case libvlc_MediaListPlayerPlayed:
+        case libvlc_MediaListPlayerStopped:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* Events that only matter for their latest value: a pending one is
+ * overwritten rather than queued again */
+static bool libvlc_event_is_coalesced(libvlc_event_type_t type)
+{
+    switch (type)
+    {
+        case libvlc_MediaDurationChanged:
+        case libvlc_MediaPlayerBuffering:
+        case libvlc_MediaPlayerTimeChanged:
+        case libvlc_MediaPlayerPositionChanged:
+        case libvlc_MediaPlayerLengthChanged:
+        case libvlc_MediaPlayerAudioVolume:
+        case libvlc_MediaPlayerAudioLoudness:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void libvlc_event_queue_push(libvlc_event_queue_t *q,
+                                    const libvlc_event_listener_t *listener,
+                                    const libvlc_event_t *event)
+{
+    libvlc_event_entry_t *entry;
+
+    vlc_mutex_lock(&q->lock);
+    if (libvlc_event_is_coalesced(event->type))
+        vlc_list_foreach(entry, &q->pending, node)
+            if (entry->listener == listener)
+            {
+                entry->event = *event;
+                vlc_mutex_unlock(&q->lock);
+                return;
+            }
+
+    entry = malloc(sizeof (*entry));
+    if (likely(entry != NULL))
+    {
+        entry->listener = listener;
+        entry->p_user_data = listener->p_user_data;
+        entry->pf_callback = listener->pf_callback;
+        entry->event = *event;
+        vlc_list_append(&entry->node, &q->pending);
+        vlc_cond_signal(&q->wait);
+    }
+    vlc_mutex_unlock(&q->lock);
+}
+
+/* Drops the pending events of a listener that is going away, and waits for
+ * any of its callbacks in progress to return (unless on the dispatching
+ * thread itself). */
+static void libvlc_event_queue_purge(libvlc_event_queue_t *q,
+                                     const libvlc_event_listener_t *listener)
+{
+    libvlc_event_entry_t *entry;
+
+    vlc_mutex_lock(&q->dispatch_lock);
+    vlc_mutex_lock(&q->lock);
+    vlc_list_foreach(entry, &q->pending, node)
+        if (entry->listener == listener)
+        {
+            vlc_list_remove(&entry->node);
+            free(entry);
+        }
+    vlc_mutex_unlock(&q->lock);
+    vlc_mutex_unlock(&q->dispatch_lock);
+}
+
 /*
  * Internal libvlc functions
  */
@@ -93,7 +239,17 @@ void libvlc_event_manager_destroy(libvlc_event_manager_t *em)
     vlc_mutex_destroy(&em->lock);
 
     for (size_t i = 0; i < vlc_array_count(&em->listeners); i++)
-        free(vlc_array_item_at_index(&em->listeners, i));
+    {
+        libvlc_event_listener_t *listener;
+
+        listener = vlc_array_item_at_index(&em->listeners, i);
+        if (listener->p_queue != NULL)
+        {
+            libvlc_event_queue_purge(listener->p_queue, listener);
+            libvlc_event_queue_release(listener->p_queue);
+        }
+        free(listener);
+    }
 
     vlc_array_clear(&em->listeners);
 }
@@ -115,7 +271,11 @@ void libvlc_event_send( libvlc_event_manager_t * p_em,
         libvlc_event_listener_t *listener;
 
         listener = vlc_array_item_at_index(&p_em->listeners, i);
-        if (listener->event_type == p_event->type)
+        if (listener->event_type != p_event->type)
+            continue;
+        if (listener->p_queue != NULL)
+            libvlc_event_queue_push(listener->p_queue, listener, p_event);
+        else
             listener->pf_callback(p_event, listener->p_user_data);
     }
     vlc_mutex_unlock(&p_em->lock);
@@ -130,8 +290,11 @@ void libvlc_event_send( libvlc_event_manager_t * p_em,
  *
  * Add a callback for an event.
  **************************************************************************/
-int libvlc_event_attach(libvlc_event_manager_t *em, libvlc_event_type_t type,
-                        libvlc_callback_t callback, void *opaque)
+static int libvlc_event_attach_listener(libvlc_event_manager_t *em,
+                                        libvlc_event_type_t type,
+                                        libvlc_callback_t callback,
+                                        void *opaque,
+                                        libvlc_event_queue_t *q)
 {
     libvlc_event_listener_t *listener = malloc(sizeof (*listener));
     if (unlikely(listener == NULL))
@@ -140,6 +303,7 @@ int libvlc_event_attach(libvlc_event_manager_t *em, libvlc_event_type_t type,
     listener->event_type = type;
     listener->p_user_data = opaque;
     listener->pf_callback = callback;
+    listener->p_queue = q;
 
     int i_ret;
     vlc_mutex_lock(&em->lock);
@@ -149,11 +313,36 @@ int libvlc_event_attach(libvlc_event_manager_t *em, libvlc_event_type_t type,
         free(listener);
     }
     else
+    {
         i_ret = VLC_SUCCESS;
+        if (q != NULL)
+            vlc_atomic_rc_inc(&q->rc);
+    }
     vlc_mutex_unlock(&em->lock);
     return i_ret;
 }
 
+int libvlc_event_attach(libvlc_event_manager_t *em, libvlc_event_type_t type,
+                        libvlc_callback_t callback, void *opaque)
+{
+    return libvlc_event_attach_listener(em, type, callback, opaque, NULL);
+}
+
+/**************************************************************************
+ *       libvlc_event_attach_queued (public) :
+ *
+ * Add a callback for an event, called from the dispatcher of a queue.
+ **************************************************************************/
+int libvlc_event_attach_queued(libvlc_event_manager_t *em,
+                               libvlc_event_type_t type,
+                               libvlc_callback_t callback, void *opaque,
+                               libvlc_event_queue_t *q)
+{
+    if (!libvlc_event_is_queueable(type))
+        return EINVAL;
+    return libvlc_event_attach_listener(em, type, callback, opaque, q);
+}
+
 /**************************************************************************
  *       libvlc_event_detach (public) :
  *
@@ -175,9 +364,99 @@ void libvlc_event_detach(libvlc_event_manager_t *em, libvlc_event_type_t type,
          {   /* that's our listener */
              vlc_array_remove(&em->listeners, i);
              vlc_mutex_unlock(&em->lock);
+             if (listener->p_queue != NULL)
+             {
+                 libvlc_event_queue_purge(listener->p_queue, listener);
+                 libvlc_event_queue_release(listener->p_queue);
+             }
              free(listener);
              return;
          }
     }
     abort();
 }
+
+/**************************************************************************
+ *       Event queues (public)
+ **************************************************************************/
+libvlc_event_queue_t *libvlc_event_queue_new(void)
+{
+    libvlc_event_queue_t *q = malloc(sizeof (*q));
+    if (unlikely(q == NULL))
+        return NULL;
+
+    vlc_mutex_init_recursive(&q->dispatch_lock);
+    vlc_mutex_init(&q->lock);
+    vlc_cond_init(&q->wait);
+    vlc_list_init(&q->pending);
+    q->b_wakeup = false;
+    vlc_atomic_rc_init(&q->rc);
+    return q;
+}
+
+void libvlc_event_queue_release(libvlc_event_queue_t *q)
+{
+    if (!vlc_atomic_rc_dec(&q->rc))
+        return;
+
+    libvlc_event_entry_t *entry;
+
+    vlc_list_foreach(entry, &q->pending, node)
+        free(entry);
+    vlc_cond_destroy(&q->wait);
+    vlc_mutex_destroy(&q->lock);
+    vlc_mutex_destroy(&q->dispatch_lock);
+    free(q);
+}
+
+int libvlc_event_queue_dispatch(libvlc_event_queue_t *q, int timeout)
+{
+    vlc_tick_t deadline = vlc_tick_now() + VLC_TICK_FROM_MS(timeout);
+
+    vlc_mutex_lock(&q->lock);
+    while (vlc_list_is_empty(&q->pending) && !q->b_wakeup && timeout != 0)
+    {
+        if (timeout < 0)
+            vlc_cond_wait(&q->wait, &q->lock);
+        else if (vlc_cond_timedwait(&q->wait, &q->lock, deadline))
+            break;
+    }
+    q->b_wakeup = false;
+
+    /* Only dispatch the events pending now, so that a steady stream of new
+     * events cannot keep the caller here forever. */
+    unsigned count = 0, n = 0;
+    libvlc_event_entry_t *entry;
+
+    vlc_list_foreach(entry, &q->pending, node)
+        n++;
+    vlc_mutex_unlock(&q->lock);
+
+    vlc_mutex_lock(&q->dispatch_lock);
+    vlc_mutex_lock(&q->lock);
+    while (count < n
+        && (entry = vlc_list_first_entry_or_null(&q->pending,
+                                                 libvlc_event_entry_t,
+                                                 node)) != NULL)
+    {
+        vlc_list_remove(&entry->node);
+        vlc_mutex_unlock(&q->lock);
+
+        entry->pf_callback(&entry->event, entry->p_user_data);
+        free(entry);
+        count++;
+
+        vlc_mutex_lock(&q->lock);
+    }
+    vlc_mutex_unlock(&q->lock);
+    vlc_mutex_unlock(&q->dispatch_lock);
+    return count;
+}
+
+void libvlc_event_queue_wakeup(libvlc_event_queue_t *q)
+{
+    vlc_mutex_lock(&q->lock);
+    q->b_wakeup = true;
+    vlc_cond_signal(&q->wait);
+    vlc_mutex_unlock(&q->lock);
+}
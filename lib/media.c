@@ -740,6 +740,97 @@ int libvlc_media_get_stats( libvlc_media_t *p_md,
     return true;
 }
 
+static_assert(LIBVLC_MEDIA_LATENCY_BUCKETS == INPUT_LATENCY_BUCKETS,
+              "Mismatched latency histogram size");
+
+int libvlc_media_get_latency_stats( libvlc_media_t *p_md,
+                                    libvlc_track_type_t i_type,
+                                    libvlc_media_latency_t i_latency,
+                                    libvlc_media_latency_stats_t *p_stats )
+{
+    input_item_t *item = p_md->p_input_item;
+    unsigned idx;
+
+    switch( i_latency )
+    {
+        case libvlc_latency_fifo:       idx = INPUT_LATENCY_FIFO;       break;
+        case libvlc_latency_decode:     idx = INPUT_LATENCY_DECODE;     break;
+        case libvlc_latency_wait:       idx = INPUT_LATENCY_WAIT;       break;
+        case libvlc_latency_vout_queue: idx = INPUT_LATENCY_VOUT_QUEUE; break;
+        case libvlc_latency_late:       idx = INPUT_LATENCY_LATE;       break;
+        case libvlc_latency_presentation:
+            idx = INPUT_LATENCY_PRESENTATION;
+            break;
+        case libvlc_latency_demux_blocked:
+            idx = INPUT_LATENCY_DEMUX_BLOCKED;
+            break;
+        case libvlc_latency_packetizer_blocked:
+            idx = INPUT_LATENCY_PACKETIZER_BLOCKED;
+            break;
+        default:
+            return false;
+    }
+
+    if( item == NULL )
+        return false;
+
+    vlc_mutex_lock( &item->lock );
+
+    const input_stats_t *p_itm_stats = item->p_stats;
+    const input_latency_t *lat;
+
+    if( p_itm_stats == NULL )
+        lat = NULL;
+    else if( i_type == libvlc_track_video )
+        lat = &p_itm_stats->video_latency[idx];
+    else if( i_type == libvlc_track_audio )
+        lat = &p_itm_stats->audio_latency[idx];
+    else
+        lat = NULL;
+
+    if( lat == NULL )
+    {
+        vlc_mutex_unlock( &item->lock );
+        return false;
+    }
+
+    p_stats->i_count = lat->i_count;
+    p_stats->i_total_us = US_FROM_VLC_TICK( lat->i_total );
+    p_stats->i_max_us = US_FROM_VLC_TICK( lat->i_max );
+    for( unsigned i = 0; i < LIBVLC_MEDIA_LATENCY_BUCKETS; i++ )
+        p_stats->i_buckets[i] = lat->i_buckets[i];
+
+    vlc_mutex_unlock( &item->lock );
+    return true;
+}
+
+int libvlc_media_get_memory_stats( libvlc_media_t *p_md,
+                                   libvlc_media_memory_stats_t *p_stats )
+{
+    input_item_t *item = p_md->p_input_item;
+
+    if( item == NULL )
+        return false;
+
+    vlc_mutex_lock( &item->lock );
+
+    const input_stats_t *p_itm_stats = item->p_stats;
+    if( p_itm_stats == NULL )
+    {
+        vlc_mutex_unlock( &item->lock );
+        return false;
+    }
+
+    p_stats->i_fifo_bytes = p_itm_stats->i_fifo_bytes;
+    p_stats->i_picture_pool_bytes = p_itm_stats->i_picture_pool_bytes;
+    p_stats->i_timeshift_bytes = p_itm_stats->i_timeshift_bytes;
+    p_stats->i_adaptive_bytes = p_itm_stats->i_adaptive_bytes;
+    p_stats->i_httpd_bytes = p_itm_stats->i_httpd_bytes;
+
+    vlc_mutex_unlock( &item->lock );
+    return true;
+}
+
 /**************************************************************************
  * event_manager
  **************************************************************************/
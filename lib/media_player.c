@@ -38,6 +38,8 @@
 #include <vlc_aout.h>
 #include <vlc_actions.h>
 #include <vlc_http.h>
+#include <vlc_atomic.h>
+#include <vlc_block.h>
 
 #include "libvlc_internal.h"
 #include "media_internal.h" // libvlc_media_set_state()
@@ -590,6 +592,28 @@ static int volume_changed(vlc_object_t *obj, const char *name, vlc_value_t old,
     return VLC_SUCCESS;
 }
 
+static int loudness_changed(vlc_object_t *obj, const char *name,
+                            vlc_value_t old, vlc_value_t cur, void *opaque)
+{
+    libvlc_media_player_t *mp = (libvlc_media_player_t *)obj;
+    const struct vlc_audio_loudness *loudness = cur.p_address;
+    libvlc_event_t event;
+
+    if (loudness == NULL)
+        return VLC_SUCCESS;
+
+    event.type = libvlc_MediaPlayerAudioLoudness;
+    event.u.media_player_audio_loudness.momentary = loudness->momentary;
+    event.u.media_player_audio_loudness.short_term = loudness->short_term;
+    event.u.media_player_audio_loudness.integrated = loudness->integrated;
+    event.u.media_player_audio_loudness.true_peak = loudness->true_peak;
+    event.u.media_player_audio_loudness.max_true_peak =
+        loudness->max_true_peak;
+    libvlc_event_send(&mp->event_manager, &event);
+    VLC_UNUSED(name); VLC_UNUSED(old); VLC_UNUSED(opaque);
+    return VLC_SUCCESS;
+}
+
 /**************************************************************************
  * Create a Media Instance object.
  *
@@ -634,6 +658,7 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     var_Create (mp, "vmem-data", VLC_VAR_ADDRESS);
     var_Create (mp, "vmem-setup", VLC_VAR_ADDRESS);
     var_Create (mp, "vmem-cleanup", VLC_VAR_ADDRESS);
+    var_Create (mp, "vmem-frame", VLC_VAR_ADDRESS);
     var_Create (mp, "vmem-chroma", VLC_VAR_STRING | VLC_VAR_DOINHERIT);
     var_Create (mp, "vmem-width", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
     var_Create (mp, "vmem-height", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
@@ -710,6 +735,7 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     var_Create (mp, "volume", VLC_VAR_FLOAT);
     var_Create (mp, "corks", VLC_VAR_INTEGER);
     var_Create (mp, "audio-filter", VLC_VAR_STRING);
+    var_Create (mp, "loudness", VLC_VAR_ADDRESS);
     var_Create (mp, "role", VLC_VAR_STRING | VLC_VAR_DOINHERIT);
     var_Create (mp, "amem-data", VLC_VAR_ADDRESS);
     var_Create (mp, "amem-setup", VLC_VAR_ADDRESS);
@@ -771,6 +797,7 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     var_AddCallback(mp, "audio-device", audio_device_changed, NULL);
     var_AddCallback(mp, "mute", mute_changed, NULL);
     var_AddCallback(mp, "volume", volume_changed, NULL);
+    var_AddCallback(mp, "loudness", loudness_changed, NULL);
 
     /* Snapshot initialization */
     /* Attach a var callback to the global object to provide the glue between
@@ -819,6 +846,7 @@ static void libvlc_media_player_destroy( libvlc_media_player_t *p_mi )
                      "snapshot-file", snapshot_was_taken, p_mi );
 
     /* Detach callback from the media player / input manager object */
+    var_DelCallback( p_mi, "loudness", loudness_changed, NULL );
     var_DelCallback( p_mi, "volume", volume_changed, NULL );
     var_DelCallback( p_mi, "mute", mute_changed, NULL );
     var_DelCallback( p_mi, "audio-device", audio_device_changed, NULL );
@@ -1139,11 +1167,214 @@ void libvlc_video_set_callbacks( libvlc_media_player_t *mp,
     var_SetAddress( mp, "vmem-unlock", unlock_cb );
     var_SetAddress( mp, "vmem-display", display_cb );
     var_SetAddress( mp, "vmem-data", opaque );
+    var_SetAddress( mp, "vmem-frame", NULL );
     var_SetString( mp, "avcodec-hw", "none" );
     var_SetString( mp, "vout", "vmem" );
     var_SetString( mp, "window", "dummy" );
 }
 
+struct libvlc_video_frame_t
+{
+    vlc_atomic_rc_t rc;
+    picture_t *pic;
+};
+
+/* Called by the vmem display, in its thread */
+static void video_frame_display( void *opaque, picture_t *pic )
+{
+    libvlc_media_player_t *mp = opaque;
+    libvlc_video_frame_t *frame = malloc( sizeof( *frame ) );
+    if( unlikely(frame == NULL) )
+        return;
+
+    vlc_atomic_rc_init( &frame->rc );
+    frame->pic = picture_Hold( pic );
+    mp->video_frame.cb( mp->video_frame.opaque, frame );
+    libvlc_video_frame_release( frame );
+}
+
+void libvlc_video_set_frame_callback( libvlc_media_player_t *mp,
+                                      libvlc_video_frame_cb cb,
+                                      void *opaque )
+{
+    mp->video_frame.cb = cb;
+    mp->video_frame.opaque = opaque;
+
+    var_SetAddress( mp, "vmem-lock", NULL );
+    var_SetAddress( mp, "vmem-frame", cb != NULL ? video_frame_display : NULL );
+    var_SetAddress( mp, "vmem-data", mp );
+    var_SetString( mp, "vout", cb != NULL ? "vmem" : "" );
+    var_SetString( mp, "window", cb != NULL ? "dummy" : "" );
+}
+
+libvlc_video_frame_t *libvlc_video_frame_retain( libvlc_video_frame_t *frame )
+{
+    vlc_atomic_rc_inc( &frame->rc );
+    return frame;
+}
+
+void libvlc_video_frame_release( libvlc_video_frame_t *frame )
+{
+    if( !vlc_atomic_rc_dec( &frame->rc ) )
+        return;
+    picture_Release( frame->pic );
+    free( frame );
+}
+
+void libvlc_video_frame_get_format( const libvlc_video_frame_t *frame,
+                                    char chroma[5],
+                                    unsigned *width, unsigned *height )
+{
+    const video_format_t *fmt = &frame->pic->format;
+
+    memcpy( chroma, &fmt->i_chroma, 4 );
+    chroma[4] = '\0';
+    *width = fmt->i_visible_width;
+    *height = fmt->i_visible_height;
+}
+
+unsigned libvlc_video_frame_get_planes( const libvlc_video_frame_t *frame,
+                                        const uint8_t **planes,
+                                        unsigned *pitches, unsigned *lines )
+{
+    const picture_t *pic = frame->pic;
+    const video_format_t *fmt = &pic->format;
+    const vlc_chroma_description_t *desc =
+        vlc_fourcc_GetChromaDescription( fmt->i_chroma );
+    int count = __MIN( pic->i_planes, LIBVLC_VIDEO_FRAME_MAX_PLANES );
+
+    for( int i = 0; i < count; i++ )
+    {
+        const plane_t *p = &pic->p[i];
+        size_t offset = 0;
+
+        if( desc != NULL && i < (int)desc->plane_count )
+            offset = (size_t)p->i_pitch * fmt->i_y_offset
+                         * desc->p[i].h.num / desc->p[i].h.den
+                   + (size_t)p->i_pixel_pitch * fmt->i_x_offset
+                         * desc->p[i].w.num / desc->p[i].w.den;
+        planes[i] = p->p_pixels + offset;
+        pitches[i] = p->i_pitch;
+        lines[i] = p->i_visible_lines;
+    }
+    return count;
+}
+
+int64_t libvlc_video_frame_get_pts( const libvlc_video_frame_t *frame )
+{
+    return US_FROM_VLC_TICK( frame->pic->date );
+}
+
+struct libvlc_es_packet_t
+{
+    vlc_atomic_rc_t rc;
+    block_t *block;
+    libvlc_track_type_t type;
+    uint32_t codec;
+    int id;
+};
+
+/* Called by the smem stream output, in the input thread */
+static void es_packet_send( void *opaque, const es_format_t *fmt,
+                            block_t *block )
+{
+    libvlc_media_player_t *mp = opaque;
+    libvlc_es_packet_t *packet = malloc( sizeof( *packet ) );
+    if( unlikely(packet == NULL) )
+    {
+        block_Release( block );
+        return;
+    }
+
+    vlc_atomic_rc_init( &packet->rc );
+    packet->block = block;
+    switch( fmt->i_cat )
+    {
+        case AUDIO_ES: packet->type = libvlc_track_audio; break;
+        case VIDEO_ES: packet->type = libvlc_track_video; break;
+        case SPU_ES:   packet->type = libvlc_track_text;  break;
+        default:       packet->type = libvlc_track_unknown;
+    }
+    packet->codec = fmt->i_codec;
+    packet->id = fmt->i_id;
+    mp->es_packet.cb( mp->es_packet.opaque, packet );
+    libvlc_es_packet_release( packet );
+}
+
+int libvlc_media_player_set_es_packet_callback( libvlc_media_player_t *mp,
+                                                libvlc_es_packet_cb cb,
+                                                void *opaque )
+{
+    char *chain = NULL;
+
+    if( cb != NULL
+     && asprintf( &chain, "#smem{block-callback=%"PRIdPTR","
+                  "block-data=%"PRIdPTR"}",
+                  (intptr_t)es_packet_send, (intptr_t)mp ) == -1 )
+        return -1;
+
+    mp->es_packet.cb = cb;
+    mp->es_packet.opaque = opaque;
+    var_SetString( mp, "sout", chain != NULL ? chain : "" );
+    free( chain );
+    return 0;
+}
+
+libvlc_es_packet_t *libvlc_es_packet_retain( libvlc_es_packet_t *packet )
+{
+    vlc_atomic_rc_inc( &packet->rc );
+    return packet;
+}
+
+void libvlc_es_packet_release( libvlc_es_packet_t *packet )
+{
+    if( !vlc_atomic_rc_dec( &packet->rc ) )
+        return;
+    block_Release( packet->block );
+    free( packet );
+}
+
+const uint8_t *libvlc_es_packet_get_data( const libvlc_es_packet_t *packet,
+                                          size_t *size )
+{
+    *size = packet->block->i_buffer;
+    return packet->block->p_buffer;
+}
+
+int64_t libvlc_es_packet_get_pts( const libvlc_es_packet_t *packet )
+{
+    vlc_tick_t pts = packet->block->i_pts;
+    return pts != VLC_TICK_INVALID ? US_FROM_VLC_TICK( pts ) : -1;
+}
+
+int64_t libvlc_es_packet_get_dts( const libvlc_es_packet_t *packet )
+{
+    vlc_tick_t dts = packet->block->i_dts;
+    return dts != VLC_TICK_INVALID ? US_FROM_VLC_TICK( dts ) : -1;
+}
+
+unsigned libvlc_es_packet_get_flags( const libvlc_es_packet_t *packet )
+{
+    uint32_t flags = packet->block->i_flags;
+    unsigned ret = 0;
+
+    if( flags & BLOCK_FLAG_TYPE_I )
+        ret |= libvlc_es_packet_keyframe;
+    if( flags & BLOCK_FLAG_DISCONTINUITY )
+        ret |= libvlc_es_packet_discontinuity;
+    if( flags & BLOCK_FLAG_CORRUPTED )
+        ret |= libvlc_es_packet_corrupted;
+    return ret;
+}
+
+libvlc_track_type_t libvlc_es_packet_get_track( const libvlc_es_packet_t *packet,
+                                                uint32_t *codec, int *id )
+{
+    *codec = packet->codec;
+    *id = packet->id;
+    return packet->type;
+}
+
 void libvlc_video_set_format_callbacks( libvlc_media_player_t *mp,
                                         libvlc_video_format_cb setup,
                                         libvlc_video_cleanup_cb cleanup )
@@ -56,6 +56,18 @@ struct libvlc_media_player_t
     libvlc_state_t state;
     vlc_viewpoint_t viewpoint;
     int selected_es[3];
+
+    struct
+    {
+        libvlc_video_frame_cb cb;
+        void *opaque;
+    } video_frame;
+
+    struct
+    {
+        libvlc_es_packet_cb cb;
+        void *opaque;
+    } es_packet;
 };
 
 /* Media player - audio, video */
@@ -92,6 +92,13 @@ static const char *const ppsz_audioconns_text[] = {
     N_("Embedded"), N_("AES/EBU"), N_("Analog")
 };
 
+#define ZERO_COPY_TEXT N_("Zero-copy capture")
+#define ZERO_COPY_LONGTEXT N_( \
+    "Pass the capture buffers of the card downstream instead of copying " \
+    "them, when the format allows. The card has a limited number of " \
+    "buffers, so this should be disabled if frames are held for a long " \
+    "time (e.g. with large caching values).")
+
 #define ASPECT_RATIO_TEXT N_("Aspect ratio")
 #define ASPECT_RATIO_LONGTEXT N_(\
     "Aspect ratio (4:3, 16:9). Default assumes square pixels.")
@@ -119,6 +126,8 @@ vlc_module_begin ()
     add_string("decklink-aspect-ratio", NULL,
                 ASPECT_RATIO_TEXT, ASPECT_RATIO_LONGTEXT, true)
     add_bool("decklink-tenbits", false, N_("10 bits"), N_("10 bits"), true)
+    add_bool("decklink-zero-copy", true,
+             ZERO_COPY_TEXT, ZERO_COPY_LONGTEXT, true)
 
     add_shortcut("decklink")
     set_capability("access", 0)
@@ -157,10 +166,51 @@ struct demux_sys_t
     int audio_streams;
 
     bool tenbits;
+    bool zero_copy;
+};
+
+} // namespace
+
+/*
+ * Data blocks wrapping DeckLink buffers: the video frame or audio packet
+ * is referenced until the block is released.
+ */
+namespace {
+
+struct decklink_block_t
+{
+    block_t self;
+    IUnknown *buffer;
 };
 
 } // namespace
 
+static void ReleaseDeckLinkBlock(block_t *block)
+{
+    decklink_block_t *b = reinterpret_cast<decklink_block_t *>(block);
+
+    b->buffer->Release();
+    free(b);
+}
+
+static const struct vlc_block_callbacks decklink_block_cbs =
+{
+    ReleaseDeckLinkBlock,
+};
+
+static block_t *WrapDeckLinkBuffer(IUnknown *buffer, void *data, size_t size)
+{
+    decklink_block_t *b =
+        static_cast<decklink_block_t *>(malloc(sizeof (*b)));
+    if (unlikely(b == NULL))
+        return NULL;
+
+    block_Init(&b->self, &decklink_block_cbs, data, size);
+    buffer->AddRef();
+    b->buffer = buffer;
+    return &b->self;
+}
+
 static const char *GetFieldDominance(BMDFieldDominance dom, uint32_t *flags)
 {
     switch(dom)
@@ -335,13 +385,23 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame
                 bpp = 2;
                 break;
         };
-        block_t *video_frame = block_Alloc(width * height * bpp);
+        uint32_t *frame_bytes;
+        videoFrame->GetBytes((void**)&frame_bytes);
+
+        /* Packed formats without row padding can be used in place */
+        const bool in_place = sys->zero_copy
+                           && sys->video_fmt.i_codec != VLC_CODEC_I422_10L
+                           && stride == width * bpp;
+        block_t *video_frame;
+
+        if (in_place)
+            video_frame = WrapDeckLinkBuffer(videoFrame, frame_bytes,
+                                             width * height * bpp);
+        else
+            video_frame = block_Alloc(width * height * bpp);
         if (!video_frame)
             return S_OK;
 
-        const uint32_t *frame_bytes;
-        videoFrame->GetBytes((void**)&frame_bytes);
-
         BMDTimeValue stream_time, frame_duration;
         videoFrame->GetStreamTime(&stream_time, &frame_duration, CLOCK_FREQ);
         video_frame->i_flags = BLOCK_FLAG_TYPE_I | sys->dominance_flags;
@@ -380,6 +440,8 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame
                 }
                 vanc->Release();
             }
+        } else if (in_place) {
+            /* nothing to do */
         } else if (sys->video_fmt.i_codec == VLC_CODEC_UYVY) {
             for (int y = 0; y < height; ++y) {
                 const uint8_t *src = (const uint8_t *)frame_bytes + stride * y;
@@ -430,10 +492,19 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame
         }
         else
         {
-            block_t *audio_frame = block_Alloc(bytes);
+            block_t *audio_frame;
+
+            if (sys->zero_copy)
+                audio_frame = WrapDeckLinkBuffer(audioFrame, frame_bytes,
+                                                 bytes);
+            else
+            {
+                audio_frame = block_Alloc(bytes);
+                if (likely(audio_frame != NULL))
+                    memcpy(audio_frame->p_buffer, frame_bytes, bytes);
+            }
             if (!audio_frame)
                 return S_OK;
-            memcpy(audio_frame->p_buffer, frame_bytes, bytes);
             audio_frame->i_pts = audio_frame->i_dts = VLC_TICK_0 + packet_time;
             es_out_Send(demux_->out, sys->audio_es[0], audio_frame);
         }
@@ -538,6 +609,7 @@ static int Open(vlc_object_t *p_this)
     vlc_mutex_init(&sys->pts_lock);
 
     sys->tenbits = var_InheritBool(p_this, "decklink-tenbits");
+    sys->zero_copy = var_InheritBool(p_this, "decklink-zero-copy");
 
     IDeckLinkIterator *decklink_iterator = CreateDeckLinkIteratorInstance();
     if (!decklink_iterator) {
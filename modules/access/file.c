@@ -51,6 +51,9 @@
 #   include <unistd.h>
 #endif
 #include <dirent.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "fs.h"
@@ -63,11 +66,38 @@
 #include <vlc_url.h>
 #include <vlc_interrupt.h>
 
+/* Size and alignment of the read-ahead reads */
+#define FILE_READAHEAD_SIZE (1 << 20)
+/* Size and alignment of the memory mapped blocks */
+#define FILE_MMAP_SIZE (1 << 20)
+/* Sequential data after which random access hints are dropped */
+#define FILE_MMAP_SEQUENTIAL (8 << 20)
+
 typedef struct
 {
     int fd;
 
     bool b_pace_control;
+
+    /* Read-ahead thread */
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait; /* data available */
+    vlc_cond_t space; /* room for more data, seek or close */
+    block_t *queue;
+    block_t **queue_last;
+    unsigned queued; /* number of queued blocks */
+    unsigned depth; /* maximum number of queued blocks */
+    uint64_t offset; /* offset of the next read */
+    unsigned generation; /* incremented on each seek */
+    int error;
+    bool eof;
+    bool closing;
+
+    /* Memory mapping */
+    block_t *map; /* the whole file, shared with the returned blocks */
+    uint64_t sequential; /* bytes read since the last far seek */
+    bool random; /* access pattern hint */
 } access_sys_t;
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -128,6 +158,16 @@ static bool IsRemote (const char *path)
 
 static ssize_t Read (stream_t *, void *, size_t);
 static int FileSeek (stream_t *, uint64_t);
+#ifdef HAVE_MMAP
+static int MmapRemap (stream_t *, uint64_t);
+static block_t *MmapBlock (stream_t *, bool *);
+static int MmapSeek (stream_t *, uint64_t);
+#endif
+#ifdef HAVE_PREAD
+static void *ReadAheadThread (void *);
+static block_t *ReadAheadBlock (stream_t *, bool *);
+static int ReadAheadSeek (stream_t *, uint64_t);
+#endif
 static int NoSeek (stream_t *, uint64_t);
 static int FileControl (stream_t *, int, va_list);
 
@@ -204,7 +244,7 @@ int FileOpen( vlc_object_t *p_this )
 #endif
     }
 
-    access_sys_t *p_sys = vlc_obj_malloc(p_this, sizeof (*p_sys));
+    access_sys_t *p_sys = vlc_obj_calloc(p_this, 1, sizeof (*p_sys));
     if (unlikely(p_sys == NULL))
         goto error;
     p_access->pf_read = Read;
@@ -230,6 +270,49 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        if (S_ISREG (st.st_mode) && st.st_size > 0
+         && var_InheritBool (p_access, "file-mmap"))
+        {
+            p_sys->offset = lseek (fd, 0, SEEK_CUR);
+            if (MmapRemap (p_access, st.st_size) == 0)
+            {
+                p_access->pf_read = NULL;
+                p_access->pf_block = MmapBlock;
+                p_access->pf_seek = MmapSeek;
+            }
+            else
+                msg_Warn (p_access, "cannot map the file: %s",
+                          vlc_strerror_c(errno));
+        }
+#endif
+#ifdef HAVE_PREAD
+        p_sys->depth = var_InheritInteger (p_access, "file-readahead");
+        if (p_sys->depth > 0 && p_access->pf_block == NULL)
+        {
+            vlc_mutex_init (&p_sys->lock);
+            vlc_cond_init (&p_sys->wait);
+            vlc_cond_init (&p_sys->space);
+            p_sys->queue_last = &p_sys->queue;
+            p_sys->offset = lseek (fd, 0, SEEK_CUR);
+
+            if (vlc_clone (&p_sys->thread, ReadAheadThread, p_access,
+                           VLC_THREAD_PRIORITY_INPUT) == 0)
+            {
+                posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+                p_access->pf_read = NULL;
+                p_access->pf_block = ReadAheadBlock;
+                p_access->pf_seek = ReadAheadSeek;
+            }
+            else
+            {
+                vlc_cond_destroy (&p_sys->space);
+                vlc_cond_destroy (&p_sys->wait);
+                vlc_mutex_destroy (&p_sys->lock);
+                p_sys->depth = 0;
+            }
+        }
 #endif
     }
     else
@@ -252,7 +335,7 @@ void FileClose (vlc_object_t * p_this)
 {
     stream_t     *p_access = (stream_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_read == NULL && p_access->pf_block == NULL)
     {
         DirClose (p_this);
         return;
@@ -260,6 +343,26 @@ void FileClose (vlc_object_t * p_this)
 
     access_sys_t *p_sys = p_access->p_sys;
 
+#ifdef HAVE_MMAP
+    if (p_sys->map != NULL)
+        block_Release (p_sys->map);
+#endif
+#ifdef HAVE_PREAD
+    if (p_sys->depth > 0)
+    {
+        vlc_mutex_lock (&p_sys->lock);
+        p_sys->closing = true;
+        vlc_cond_signal (&p_sys->space);
+        vlc_mutex_unlock (&p_sys->lock);
+        vlc_join (p_sys->thread, NULL);
+
+        block_ChainRelease (p_sys->queue);
+        vlc_cond_destroy (&p_sys->space);
+        vlc_cond_destroy (&p_sys->wait);
+        vlc_mutex_destroy (&p_sys->lock);
+    }
+#endif
+
     vlc_close (p_sys->fd);
 }
 
@@ -298,6 +401,219 @@ static int FileSeek (stream_t *p_access, uint64_t i_pos)
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_MMAP
+/*****************************************************************************
+ * Memory mapping: the blocks share the private mapping of the file, so that
+ * the data is not copied. Private pages remain writable by the consumers.
+ *****************************************************************************/
+static int MmapRemap (stream_t *p_access, uint64_t size)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    if (size > SIZE_MAX)
+    {
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    void *addr = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       sys->fd, 0);
+    block_t *map = block_mmap_Alloc (addr, size);
+    if (map == NULL)
+        return -1;
+
+#ifdef HAVE_POSIX_MADVISE
+    posix_madvise (addr, size, sys->random ? POSIX_MADV_RANDOM
+                                           : POSIX_MADV_SEQUENTIAL);
+#endif
+    /* Blocks still using the previous mapping keep it alive */
+    if (sys->map != NULL)
+        block_Release (sys->map);
+    sys->map = map;
+    return 0;
+}
+
+static block_t *MmapBlock (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    if (sys->offset >= sys->map->i_buffer)
+    {   /* The file may have grown since it was mapped */
+        struct stat st;
+
+        if (fstat (sys->fd, &st) || (uint64_t)st.st_size <= sys->offset
+         || MmapRemap (p_access, st.st_size))
+        {
+            *eof = true;
+            return NULL;
+        }
+    }
+
+    block_t *block = block_Share (&sys->map);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    size_t len = FILE_MMAP_SIZE - (sys->offset % FILE_MMAP_SIZE);
+    len = __MIN(len, sys->map->i_buffer - sys->offset);
+    block->p_buffer += sys->offset;
+    block->i_buffer = len;
+    sys->offset += len;
+
+    sys->sequential += len;
+    if (sys->random && sys->sequential >= FILE_MMAP_SEQUENTIAL)
+    {
+        sys->random = false;
+#ifdef HAVE_POSIX_MADVISE
+        posix_madvise (sys->map->p_buffer, sys->map->i_buffer,
+                       POSIX_MADV_SEQUENTIAL);
+#endif
+    }
+    return block;
+}
+
+static int MmapSeek (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *sys = p_access->p_sys;
+    uint64_t distance = i_pos > sys->offset ? i_pos - sys->offset
+                                            : sys->offset - i_pos;
+
+    /* Far seeks (index, boxes or elements all over the file) defeat the
+     * read-ahead of the sequential hint */
+    if (distance > FILE_MMAP_SIZE)
+    {
+        sys->sequential = 0;
+        if (!sys->random)
+        {
+            sys->random = true;
+#ifdef HAVE_POSIX_MADVISE
+            posix_madvise (sys->map->p_buffer, sys->map->i_buffer,
+                           POSIX_MADV_RANDOM);
+#endif
+        }
+    }
+    sys->offset = i_pos;
+    return VLC_SUCCESS;
+}
+#endif
+
+#ifdef HAVE_PREAD
+/*****************************************************************************
+ * Read-ahead: a thread keeps a queue of large aligned reads ahead of the
+ * demuxer, so that the storage is kept busy while the data is processed.
+ *****************************************************************************/
+static void *ReadAheadThread (void *data)
+{
+    stream_t *p_access = data;
+    access_sys_t *sys = p_access->p_sys;
+
+    vlc_mutex_lock (&sys->lock);
+    for (;;)
+    {
+        while (!sys->closing
+            && (sys->eof || sys->error || sys->queued >= sys->depth))
+            vlc_cond_wait (&sys->space, &sys->lock);
+        if (sys->closing)
+            break;
+
+        uint64_t offset = sys->offset;
+        unsigned generation = sys->generation;
+        vlc_mutex_unlock (&sys->lock);
+
+        /* Stop at the next aligned offset */
+        size_t len = FILE_READAHEAD_SIZE - (offset % FILE_READAHEAD_SIZE);
+        block_t *block = block_Alloc (len);
+        ssize_t val = -1;
+
+        if (likely(block != NULL))
+            val = pread (sys->fd, block->p_buffer, len, offset);
+        else
+            errno = ENOMEM;
+
+        vlc_mutex_lock (&sys->lock);
+        if (generation != sys->generation || val <= 0)
+        {   /* Seek in the mean time, end of file or error */
+            if (block != NULL)
+                block_Release (block);
+            if (generation != sys->generation || (val < 0 && errno == EINTR))
+                continue;
+            if (val == 0)
+                sys->eof = true;
+            else
+                sys->error = errno;
+        }
+        else
+        {
+            block->i_buffer = val;
+            *sys->queue_last = block;
+            sys->queue_last = &block->p_next;
+            sys->queued++;
+            sys->offset += val;
+        }
+        vlc_cond_signal (&sys->wait);
+    }
+    vlc_mutex_unlock (&sys->lock);
+    return NULL;
+}
+
+static void ReadAheadInterrupt (void *data)
+{
+    access_sys_t *sys = data;
+
+    vlc_mutex_lock (&sys->lock);
+    vlc_cond_broadcast (&sys->wait);
+    vlc_mutex_unlock (&sys->lock);
+}
+
+static block_t *ReadAheadBlock (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *sys = p_access->p_sys;
+    block_t *block;
+
+    vlc_interrupt_register (ReadAheadInterrupt, sys);
+    vlc_mutex_lock (&sys->lock);
+    while (sys->queue == NULL && !sys->eof && !sys->error && !vlc_killed ())
+        vlc_cond_wait (&sys->wait, &sys->lock);
+
+    block = sys->queue;
+    if (block != NULL)
+    {
+        sys->queue = block->p_next;
+        if (sys->queue == NULL)
+            sys->queue_last = &sys->queue;
+        block->p_next = NULL;
+        sys->queued--;
+        vlc_cond_signal (&sys->space);
+    }
+    else if (sys->eof || sys->error)
+    {
+        if (sys->error)
+            msg_Err (p_access, "read error: %s", vlc_strerror_c(sys->error));
+        *eof = true;
+    }
+    vlc_mutex_unlock (&sys->lock);
+    vlc_interrupt_unregister ();
+    return block;
+}
+
+static int ReadAheadSeek (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    vlc_mutex_lock (&sys->lock);
+    block_ChainRelease (sys->queue);
+    sys->queue = NULL;
+    sys->queue_last = &sys->queue;
+    sys->queued = 0;
+    sys->offset = i_pos;
+    sys->generation++;
+    sys->eof = false;
+    sys->error = 0;
+    vlc_cond_signal (&sys->space);
+    vlc_mutex_unlock (&sys->lock);
+    return VLC_SUCCESS;
+}
+#endif
+
 static int NoSeek (stream_t *p_access, uint64_t i_pos)
 {
     /* vlc_assert_unreachable(); ?? */
@@ -39,6 +39,15 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+    add_integer( "file-readahead", 0, N_("Read-ahead depth"),
+                 N_("Number of 1 MiB reads kept in flight ahead of the "
+                    "demuxer by a separate thread (0 disables). This helps "
+                    "keeping fast storage busy with many inputs."), true )
+        change_integer_range( 0, 64 )
+    add_bool( "file-mmap", false, N_("Memory map files"),
+              N_("Map regular files in memory and pass the data along "
+                 "without copying it. The files must not be truncated "
+                 "while they are read."), true )
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
@@ -39,12 +39,14 @@
 #include "connmgr.h"
 #include "resource.h"
 #include "file.h"
+#include "ranges.h"
 #include "live.h"
 
 typedef struct
 {
     struct vlc_http_mgr *manager;
     struct vlc_http_resource *resource;
+    struct vlc_http_ranges *ranges;
 } access_sys_t;
 
 static block_t *FileRead(stream_t *access, bool *restrict eof)
@@ -66,6 +68,25 @@ static int FileSeek(stream_t *access, uint64_t pos)
     return VLC_SUCCESS;
 }
 
+static block_t *RangesRead(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    block_t *b = vlc_http_ranges_read(sys->ranges);
+    if (b == NULL)
+        *eof = true;
+    return b;
+}
+
+static int RangesSeek(stream_t *access, uint64_t pos)
+{
+    access_sys_t *sys = access->p_sys;
+
+    if (vlc_http_ranges_seek(sys->ranges, pos))
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+
 static int FileControl(stream_t *access, int query, va_list args)
 {
     access_sys_t *sys = access->p_sys;
@@ -169,6 +190,7 @@ static int Open(vlc_object_t *obj)
 
     sys->manager = NULL;
     sys->resource = NULL;
+    sys->ranges = NULL;
 
     void *jar = NULL;
     if (var_InheritBool(obj, "http-forward-cookies"))
@@ -258,8 +280,22 @@ static int Open(vlc_object_t *obj)
     }
     else
     {
-        access->pf_block = FileRead;
-        access->pf_seek = FileSeek;
+        unsigned parallel = var_InheritInteger(obj, "http-parallel");
+
+        if (parallel > 1 && vlc_http_file_can_seek(sys->resource))
+            sys->ranges = vlc_http_ranges_create(obj, jar, sys->resource,
+                parallel, var_InheritInteger(obj, "http-parallel-window") << 10);
+
+        if (sys->ranges != NULL)
+        {
+            access->pf_block = RangesRead;
+            access->pf_seek = RangesSeek;
+        }
+        else
+        {
+            access->pf_block = FileRead;
+            access->pf_seek = FileSeek;
+        }
         access->pf_control = FileControl;
     }
     access->p_sys = sys;
@@ -282,6 +318,8 @@ static void Close(vlc_object_t *obj)
     stream_t *access = (stream_t *)obj;
     access_sys_t *sys = access->p_sys;
 
+    if (sys->ranges != NULL)
+        vlc_http_ranges_destroy(sys->ranges);
     vlc_http_res_destroy(sys->resource);
     vlc_http_mgr_destroy(sys->manager);
     free(sys);
@@ -313,4 +351,13 @@ vlc_module_begin()
                   "e.g. \"FooBar/1.2.3\"."), true)
         change_safe()
         change_private()
+    add_integer("http-parallel", 1, N_("Parallel requests"),
+                N_("Number of concurrent byte range requests, each on its "
+                   "own connection, used to fetch seekable files. This can "
+                   "improve throughput on high latency servers."), true)
+        change_integer_range(1, 16)
+    add_integer("http-parallel-window", 1 << 14, N_("Parallel requests window"),
+                N_("Amount of data fetched ahead of the read position when "
+                   "using parallel requests (KiB)."), true)
+        change_integer_range(256, 1 << 20)
 vlc_module_end()
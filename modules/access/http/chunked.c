@@ -148,6 +148,7 @@ static struct vlc_http_stream_cbs vlc_chunked_callbacks =
     vlc_chunked_wait,
     vlc_chunked_read,
     vlc_chunked_close,
+    NULL,
 };
 
 struct vlc_http_stream *vlc_chunked_open(struct vlc_http_stream *parent,
@@ -103,6 +103,7 @@ struct vlc_http_mgr
     vlc_tls_client_t *creds;
     struct vlc_http_cookie_jar_t *jar;
     struct vlc_http_conn *conn;
+    vlc_mutex_t lock; /**< Serializes requests */
 };
 
 static struct vlc_http_conn *vlc_http_mgr_find(struct vlc_http_mgr *mgr,
@@ -260,7 +261,12 @@ struct vlc_http_msg *vlc_http_mgr_request(struct vlc_http_mgr *mgr, bool https,
                                           const char *host, unsigned port,
                                           const struct vlc_http_msg *m)
 {
-    return (https ? vlc_https_request : vlc_http_request)(mgr, host, port, m);
+    struct vlc_http_msg *resp;
+
+    vlc_mutex_lock(&mgr->lock);
+    resp = (https ? vlc_https_request : vlc_http_request)(mgr, host, port, m);
+    vlc_mutex_unlock(&mgr->lock);
+    return resp;
 }
 
 struct vlc_http_cookie_jar_t *vlc_http_mgr_get_jar(struct vlc_http_mgr *mgr)
@@ -280,6 +286,7 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
     mgr->creds = NULL;
     mgr->jar = jar;
     mgr->conn = NULL;
+    vlc_mutex_init(&mgr->lock);
     return mgr;
 }
 
@@ -289,5 +296,6 @@ void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr)
         vlc_http_mgr_release(mgr, mgr->conn);
     if (mgr->creds != NULL)
         vlc_tls_ClientDelete(mgr->creds);
+    vlc_mutex_destroy(&mgr->lock);
     free(mgr);
 }
@@ -46,6 +46,10 @@ struct vlc_http_cookie_jar_t;
  * @param port TCP server port number, or 0 for the default port number
  * @param req HTTP request header to send
  *
+ * Requests can be sent concurrently from different threads. On an HTTP/2
+ * connection, they are multiplexed on the same connection. An HTTP/1.x
+ * connection still busy with another stream is replaced by a new one.
+ *
  * @return The initial HTTP response header, or NULL in case of failure.
  */
 struct vlc_http_msg *vlc_http_mgr_request(struct vlc_http_mgr *mgr, bool https,
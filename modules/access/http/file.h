@@ -63,6 +63,17 @@ uintmax_t vlc_http_file_get_size(struct vlc_http_resource *);
  */
 bool vlc_http_file_can_seek(struct vlc_http_resource *);
 
+/**
+ * Sets the last byte to request.
+ *
+ * Limits the byte range requested by subsequent requests, so that the server
+ * does not send data past the given offset. By default, the range is
+ * open-ended.
+ *
+ * @param end byte offset of the last byte to read (inclusive)
+ */
+void vlc_http_file_set_end(struct vlc_http_resource *, uintmax_t end);
+
 /**
  * Sets the read offset.
  *
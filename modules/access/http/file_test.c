@@ -43,6 +43,7 @@ static const char ua[] = PACKAGE_NAME "/" PACKAGE_VERSION " (test suite)";
 
 static const char *replies[2] = { NULL, NULL };
 static uintmax_t offset = 0;
+static uintmax_t range_end = UINTMAX_MAX;
 static bool secure = true;
 static bool etags = false;
 static int lang = -1;
@@ -121,6 +122,18 @@ int main(void)
     assert(vlc_http_file_get_size(f) == 3456);
     assert(vlc_http_file_read(f) == NULL);
 
+    /* Bounded range */
+    replies[0] = "HTTP/1.1 206 Partial Content\r\n"
+                 "Content-Range: bytes 2345-2999/3456\r\n"
+                 "ETag: W/\"foobar42\"\r\n"
+                 "Last-Modified: Mon, 21 Oct 2013 20:13:22 GMT\r\n"
+                 "\r\n";
+    vlc_http_file_set_end(f, range_end = 2999);
+    assert(vlc_http_file_seek(f, offset = 2345) == 0);
+    assert(vlc_http_file_get_size(f) == 3456);
+    assert(vlc_http_file_read(f) == NULL);
+    vlc_http_file_set_end(f, range_end = UINTMAX_MAX);
+
     /* Seek too far */
     replies[0] = "HTTP/1.1 416 Range Not Satisfiable\r\n"
                  "Content-Range: bytes */4567\r\n"
@@ -327,6 +340,7 @@ static const struct vlc_http_stream_cbs stream_callbacks =
     stream_read_headers,
     stream_read,
     stream_close,
+    NULL,
 };
 
 static struct vlc_http_stream stream = { &stream_callbacks };
@@ -372,6 +386,10 @@ struct vlc_http_msg *vlc_http_mgr_request(struct vlc_http_mgr *mgr, bool https,
     str = vlc_http_msg_get_header(req, "Range");
     assert(str != NULL && !strncmp(str, "bytes=", 6)
         && strtoul(str + 6, &end, 10) == offset && *end == '-');
+    if (range_end != UINTMAX_MAX)
+        assert(strtoumax(end + 1, &end, 10) == range_end && *end == '\0');
+    else
+        assert(end[1] == '\0');
 
     time_t mtime = vlc_http_msg_get_time(req, "If-Unmodified-Since");
     str = vlc_http_msg_get_header(req, "If-Match");
@@ -56,6 +56,11 @@ struct vlc_h2_conn
     uint32_t next_id; /**< Next free stream identifier */
     bool released; /**< Connection released by owner */
 
+    vlc_tick_t rtt; /**< Smoothed round-trip time (0 if unknown) */
+    vlc_tick_t rtt_time; /**< Time of the last round-trip time sample */
+    vlc_tick_t ping_time; /**< Time the pending PING was sent (if any) */
+    uint64_t ping_seq; /**< Payload of the last sent PING */
+
     vlc_mutex_t lock; /**< State machine lock */
     vlc_thread_t thread; /**< Receive thread */
 };
@@ -77,6 +82,11 @@ struct vlc_h2_stream
     struct vlc_http_msg *recv_hdr; /**< Latest received headers (or NULL) */
 
     size_t recv_cwnd; /**< Free space in receive congestion window */
+    size_t recv_window; /**< Receive congestion window size */
+    vlc_tick_t recv_credit; /**< Time of the last window credit */
+    uintmax_t recv_bytes; /**< Received payload bytes */
+    vlc_tick_t recv_first; /**< Time of the first payload bytes */
+    vlc_tick_t recv_last; /**< Time of the latest payload bytes */
     struct vlc_h2_frame *recv_head; /**< Earliest pending received buffer */
     struct vlc_h2_frame **recv_tailp; /**< Tail of receive queue */
     vlc_cond_t recv_wait;
@@ -95,6 +105,19 @@ static int vlc_h2_conn_queue_prio(struct vlc_h2_conn *conn,
     return vlc_h2_output_send_prio(conn->out, f);
 }
 
+/** Measures the round-trip time, unless a recent sample exists */
+static void vlc_h2_conn_ping(struct vlc_h2_conn *conn, vlc_tick_t now)
+{
+    if (conn->ping_time != VLC_TICK_INVALID)
+        return; /* measurement in progress */
+    if (conn->rtt != 0 && now - conn->rtt_time < VLC_TICK_FROM_SEC(10))
+        return;
+
+    if (vlc_h2_conn_queue_prio(conn,
+                               vlc_h2_frame_ping(++conn->ping_seq)) == 0)
+        conn->ping_time = now;
+}
+
 
 /* Stream callbacks */
 
@@ -178,6 +201,11 @@ static int vlc_h2_stream_data(void *ctx, struct vlc_h2_frame *f)
     }
     s->recv_cwnd -= len;
 
+    s->recv_last = vlc_tick_now();
+    if (s->recv_first == VLC_TICK_INVALID)
+        s->recv_first = s->recv_last;
+    s->recv_bytes += len;
+
     *(s->recv_tailp) = f;
     s->recv_tailp = &f->next;
     vlc_cond_signal(&s->recv_wait);
@@ -303,10 +331,29 @@ static block_t *vlc_h2_stream_read(struct vlc_http_stream *stream)
     }
 
     /* Credit the receive window if missing credit exceeds 50%. */
-    uint_fast32_t credit = VLC_H2_INIT_WINDOW - s->recv_cwnd;
-    if (credit >= (VLC_H2_INIT_WINDOW / 2)
-     && !vlc_h2_conn_queue(conn, vlc_h2_frame_window_update(s->id, credit)))
-        s->recv_cwnd += credit;
+    if (s->recv_window - s->recv_cwnd >= s->recv_window / 2)
+    {
+        vlc_tick_t now = vlc_tick_now();
+        size_t window = s->recv_window;
+
+        /* If half the window was consumed within two round trips, the window
+         * rather than the link limits the throughput: grow the window. */
+        if (conn->rtt != 0 && now - s->recv_credit < 2 * conn->rtt)
+            window = __MIN(2 * window, VLC_H2_MAX_WINDOW);
+
+        uint_fast32_t credit = window - s->recv_cwnd;
+        if (!vlc_h2_conn_queue(conn,
+                               vlc_h2_frame_window_update(s->id, credit)))
+        {
+            if (window != s->recv_window)
+                vlc_http_dbg(SO(s), "stream %"PRIu32" receive window: %zu "
+                             "bytes", s->id, window);
+            s->recv_cwnd += credit;
+            s->recv_window = window;
+        }
+        s->recv_credit = now;
+        vlc_h2_conn_ping(conn, now);
+    }
 
     vlc_h2_stream_unlock(s);
 
@@ -378,11 +425,29 @@ static void vlc_h2_stream_close(struct vlc_http_stream *stream, bool aborted)
         vlc_h2_conn_destroy(conn);
 }
 
+/** Reports stream receive statistics */
+static int vlc_h2_stream_get_stats(struct vlc_http_stream *stream,
+                                   struct vlc_http_stream_stats *restrict st)
+{
+    struct vlc_h2_stream *s =
+        container_of(stream, struct vlc_h2_stream, stream);
+    struct vlc_h2_conn *conn = s->conn;
+
+    vlc_mutex_lock(&conn->lock);
+    st->bytes = s->recv_bytes;
+    st->duration = s->recv_last - s->recv_first;
+    st->rtt = conn->rtt;
+    st->window = s->recv_window;
+    vlc_mutex_unlock(&conn->lock);
+    return 0;
+}
+
 static const struct vlc_http_stream_cbs vlc_h2_stream_callbacks =
 {
     vlc_h2_stream_wait,
     vlc_h2_stream_read,
     vlc_h2_stream_close,
+    vlc_h2_stream_get_stats,
 };
 
 /**
@@ -412,6 +477,11 @@ static struct vlc_http_stream *vlc_h2_stream_open(struct vlc_http_conn *c,
     s->recv_err = 0;
     s->recv_hdr = NULL;
     s->recv_cwnd = VLC_H2_INIT_WINDOW;
+    s->recv_window = VLC_H2_INIT_WINDOW;
+    s->recv_credit = vlc_tick_now();
+    s->recv_bytes = 0;
+    s->recv_first = VLC_TICK_INVALID;
+    s->recv_last = VLC_TICK_INVALID;
     s->recv_head = NULL;
     s->recv_tailp = &s->recv_head;
     vlc_cond_init(&s->recv_wait);
@@ -475,6 +545,25 @@ static int vlc_h2_ping(void *ctx, uint_fast64_t opaque)
     return vlc_h2_conn_queue_prio(conn, vlc_h2_frame_pong(opaque));
 }
 
+/** Reports a ping acknowledged by HTTP/2 peer */
+static void vlc_h2_pong(void *ctx, uint_fast64_t opaque)
+{
+    struct vlc_h2_conn *conn = ctx;
+
+    if (conn->ping_time == VLC_TICK_INVALID || opaque != conn->ping_seq)
+        return; /* unsolicited or stale acknowledgement */
+
+    vlc_tick_t now = vlc_tick_now();
+    vlc_tick_t rtt = now - conn->ping_time;
+
+    /* Smooth the samples as TCP does (RFC 6298) */
+    conn->rtt = (conn->rtt != 0) ? (7 * conn->rtt + rtt) / 8 : rtt;
+    conn->rtt_time = now;
+    conn->ping_time = VLC_TICK_INVALID;
+    vlc_http_dbg(CO(conn), "round-trip time: %"PRId64" us",
+                 US_FROM_VLC_TICK(conn->rtt));
+}
+
 /** Reports a local HTTP/2 connection failure */
 static void vlc_h2_error(void *ctx, uint_fast32_t code)
 {
@@ -518,7 +607,7 @@ static void vlc_h2_window_status(void *ctx, uint32_t *restrict rcwd)
     struct vlc_h2_conn *conn = ctx;
 
     /* Maintain connection receive window to insanely large values.
-     * Congestion control is done per stream instead. */
+     * Congestion control is done (and autotuned) per stream instead. */
     if (*rcwd < (1 << 30)
      && vlc_h2_conn_queue_prio(conn,
                                vlc_h2_frame_window_update(0, 1 << 30)) == 0)
@@ -531,6 +620,7 @@ static const struct vlc_h2_parser_cbs vlc_h2_parser_callbacks =
     vlc_h2_setting,
     vlc_h2_settings_done,
     vlc_h2_ping,
+    vlc_h2_pong,
     vlc_h2_error,
     vlc_h2_reset,
     vlc_h2_window_status,
@@ -732,6 +822,10 @@ struct vlc_http_conn *vlc_h2_conn_create(void *ctx, struct vlc_tls *tls)
     conn->streams = NULL;
     conn->next_id = 1; /* TODO: server side */
     conn->released = false;
+    conn->rtt = 0;
+    conn->rtt_time = VLC_TICK_INVALID;
+    conn->ping_time = VLC_TICK_INVALID;
+    conn->ping_seq = 0;
 
     if (unlikely(conn->out == NULL))
         goto error;
@@ -106,6 +106,15 @@ static int vlc_h2_ping(void *ctx, uint_fast64_t opaque)
     return 0;
 }
 
+static unsigned pongs;
+
+static void vlc_h2_pong(void *ctx, uint_fast64_t opaque)
+{
+    assert(ctx == CTX);
+    assert(opaque == 42);
+    pongs++;
+}
+
 static uint_fast32_t remote_error;
 
 static void vlc_h2_error(void *ctx, uint_fast32_t code)
@@ -313,6 +322,7 @@ static const struct vlc_h2_parser_cbs vlc_h2_frame_test_callbacks =
     vlc_h2_setting,
     vlc_h2_settings_done,
     vlc_h2_ping,
+    vlc_h2_pong,
     vlc_h2_error,
     vlc_h2_reset,
     vlc_h2_window_status,
@@ -332,6 +342,7 @@ static unsigned test_seq(void *ctx, ...)
 
     settings = settings_acked = 0;
     pings = 0;
+    pongs = 0;
     remote_error = -1;
     stream_header_tables = stream_blocks = stream_ends = 0;
 
@@ -412,6 +423,7 @@ int main(void)
     ret = test_seq(CTX, ping(), vlc_h2_frame_pong(42), ping(), NULL);
     assert(ret == 3);
     assert(pings == 2);
+    assert(pongs == 1);
     assert(stream_header_tables == 0);
     assert(stream_blocks == 0);
     assert(stream_ends == 0);
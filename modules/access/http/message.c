@@ -293,6 +293,15 @@ block_t *vlc_http_msg_read(struct vlc_http_msg *m)
     return vlc_http_stream_read(m->payload);
 }
 
+int vlc_http_msg_get_stats(const struct vlc_http_msg *m,
+                           struct vlc_http_stream_stats *restrict st)
+{
+    if (m->payload == NULL)
+        return -1;
+
+    return vlc_http_stream_get_stats(m->payload, st);
+}
+
 /* Serialization and deserialization */
 
 char *vlc_http_msg_format(const struct vlc_http_msg *m, size_t *restrict lenp,
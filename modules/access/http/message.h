@@ -32,6 +32,15 @@ struct vlc_http_msg;
 struct block_t;
 struct vlc_http_cookie_jar_t;
 
+/** HTTP stream receive statistics */
+struct vlc_http_stream_stats
+{
+    uintmax_t bytes; /**< Payload bytes received so far */
+    vlc_tick_t duration; /**< Time from the first to the last payload bytes */
+    vlc_tick_t rtt; /**< Smoothed connection round-trip time (0 if unknown) */
+    size_t window; /**< Current receive window size */
+};
+
 /**
  * Creates an HTTP request.
  *
@@ -288,6 +297,18 @@ struct vlc_http_msg *vlc_http_msg_get_final(struct vlc_http_msg *) VLC_USED;
  */
 struct block_t *vlc_http_msg_read(struct vlc_http_msg *) VLC_USED;
 
+/**
+ * Gets transfer statistics.
+ *
+ * Retrieves the receive statistics of the payload of an HTTP message, as
+ * measured by the underlying HTTP stream.
+ *
+ * @retval 0 on success
+ * @retval -1 if the stream does not provide statistics
+ */
+int vlc_http_msg_get_stats(const struct vlc_http_msg *,
+                           struct vlc_http_stream_stats *);
+
 /** @} */
 
 /**
@@ -335,6 +356,8 @@ struct vlc_http_stream_cbs
     struct vlc_http_msg *(*read_headers)(struct vlc_http_stream *);
     struct block_t *(*read)(struct vlc_http_stream *);
     void (*close)(struct vlc_http_stream *, bool abort);
+    int (*get_stats)(struct vlc_http_stream *,
+                     struct vlc_http_stream_stats *); /**< optional */
 };
 
 /** HTTP stream */
@@ -374,6 +397,23 @@ static inline struct block_t *vlc_http_stream_read(struct vlc_http_stream *s)
     return s->cbs->read(s);
 }
 
+/**
+ * Gets stream statistics.
+ *
+ * Retrieves the receive statistics of an HTTP stream, if the underlying
+ * connection measures them.
+ *
+ * @retval 0 on success
+ * @retval -1 if statistics are not available
+ */
+static inline int vlc_http_stream_get_stats(struct vlc_http_stream *s,
+                                            struct vlc_http_stream_stats *st)
+{
+    if (s->cbs->get_stats == NULL)
+        return -1;
+    return s->cbs->get_stats(s, st);
+}
+
 /**
  * Closes an HTTP stream.
  *
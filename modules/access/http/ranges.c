@@ -0,0 +1,526 @@
+/*****************************************************************************
+ * ranges.c: HTTP parallel byte ranges
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_interrupt.h>
+#include "conn.h"
+#include "connmgr.h"
+#include "message.h"
+#include "resource.h"
+#include "file.h"
+#include "ranges.h"
+
+#pragma GCC visibility push(default)
+
+/** Maximum consecutive failures to fetch a given chunk */
+#define VLC_HTTP_RANGES_RETRIES 3
+#define VLC_HTTP_RANGES_CHUNK_MIN (64 << 10)
+
+struct vlc_http_chunk
+{
+    struct vlc_http_chunk *next;
+    uintmax_t offset; /**< offset of the first queued byte */
+    uintmax_t received; /**< offset past the last received byte */
+    uintmax_t end; /**< offset past the last byte */
+    block_t *blocks;
+    block_t **blocks_last;
+    unsigned failures;
+    bool busy; /**< being fetched by a worker */
+    bool orphan; /**< discarded while busy, the worker frees it */
+};
+
+struct vlc_http_range
+{
+    struct vlc_http_resource resource;
+    const struct vlc_http_ranges *owner;
+    uintmax_t start;
+    uintmax_t end; /**< inclusive, as in the Range header */
+};
+
+struct vlc_http_worker
+{
+    struct vlc_http_ranges *owner;
+    struct vlc_http_mgr *manager;
+    struct vlc_http_range *range;
+    vlc_interrupt_t *interrupt;
+    vlc_thread_t thread;
+};
+
+struct vlc_http_ranges
+{
+    struct vlc_logger *logger;
+    vlc_mutex_t lock;
+    vlc_cond_t wait_data;
+    vlc_cond_t wait_work;
+
+    /** Chunks in offset order. The first one contains the read offset. */
+    struct vlc_http_chunk *chunks;
+    struct vlc_http_chunk **chunks_last;
+    uintmax_t offset; /**< read offset */
+    uintmax_t next; /**< start of the next chunk to schedule */
+    uintmax_t size;
+    size_t window;
+    size_t chunk_size;
+    bool failed;
+    bool closing;
+
+    /* Validators, so that all chunks come from the same entity */
+    char *etag;
+    time_t mtime;
+
+    unsigned count;
+    struct vlc_http_worker workers[];
+};
+
+static int vlc_http_range_req(const struct vlc_http_resource *res,
+                              struct vlc_http_msg *req, void *opaque)
+{
+    const struct vlc_http_range *range = opaque;
+    const struct vlc_http_ranges *r = range->owner;
+
+    if (r->etag != NULL)
+        vlc_http_msg_add_header(req, "If-Match", "%s", r->etag);
+    else if (r->mtime != -1)
+        vlc_http_msg_add_time(req, "If-Unmodified-Since", &r->mtime);
+
+    (void) res;
+    return vlc_http_msg_add_header(req, "Range", "bytes=%" PRIuMAX "-%" PRIuMAX,
+                                   range->start, range->end);
+}
+
+static int vlc_http_range_resp(const struct vlc_http_resource *res,
+                               const struct vlc_http_msg *resp, void *opaque)
+{
+    const struct vlc_http_range *range = opaque;
+    const char *str;
+    uintmax_t start, end;
+
+    /* Only accept the exact range that was asked for, or a prefix of it. */
+    if (vlc_http_msg_get_status(resp) != 206
+     || (str = vlc_http_msg_get_header(resp, "Content-Range")) == NULL
+     || sscanf(str, "bytes %" SCNuMAX "-%" SCNuMAX, &start, &end) != 2
+     || start != range->start || end < start || end > range->end)
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    (void) res;
+    return 0;
+}
+
+static const struct vlc_http_resource_cbs vlc_http_range_callbacks =
+{
+    vlc_http_range_req,
+    vlc_http_range_resp,
+};
+
+static void vlc_http_chunk_discard(struct vlc_http_chunk *c)
+{
+    block_ChainRelease(c->blocks);
+    c->blocks = NULL;
+    c->blocks_last = &c->blocks;
+
+    if (c->busy)
+        c->orphan = true;
+    else
+        free(c);
+}
+
+static void vlc_http_ranges_pop(struct vlc_http_ranges *r)
+{
+    struct vlc_http_chunk *c = r->chunks;
+
+    r->chunks = c->next;
+    if (r->chunks == NULL)
+        r->chunks_last = &r->chunks;
+    vlc_http_chunk_discard(c);
+}
+
+/** Adds chunks until the window is full. */
+static void vlc_http_ranges_schedule(struct vlc_http_ranges *r)
+{
+    while (r->next < r->size && r->next - r->offset < r->window)
+    {
+        struct vlc_http_chunk *c = malloc(sizeof (*c));
+        if (unlikely(c == NULL))
+            break;
+
+        c->next = NULL;
+        c->offset = c->received = r->next;
+        c->end = r->next + __MIN(r->size - r->next, r->chunk_size);
+        c->blocks = NULL;
+        c->blocks_last = &c->blocks;
+        c->failures = 0;
+        c->busy = false;
+        c->orphan = false;
+
+        *r->chunks_last = c;
+        r->chunks_last = &c->next;
+        r->next = c->end;
+    }
+}
+
+static void vlc_http_worker_fetch(struct vlc_http_worker *w,
+                                  struct vlc_http_chunk *c)
+{
+    struct vlc_http_ranges *r = w->owner;
+    struct vlc_http_msg *resp;
+
+    resp = vlc_http_res_open(&w->range->resource, w->range);
+    if (resp == NULL)
+        return;
+
+    for (;;)
+    {
+        block_t *block = vlc_http_msg_read(resp);
+        if (block == NULL || block == vlc_http_error)
+            break;
+
+        vlc_mutex_lock(&r->lock);
+        if (c->orphan || r->closing)
+        {
+            vlc_mutex_unlock(&r->lock);
+            block_Release(block);
+            break;
+        }
+
+        if (block->i_buffer > c->end - c->received)
+            block->i_buffer = c->end - c->received;
+        c->received += block->i_buffer;
+        *c->blocks_last = block;
+        c->blocks_last = &block->p_next;
+
+        bool full = c->received >= c->end;
+        vlc_cond_signal(&r->wait_data);
+        vlc_mutex_unlock(&r->lock);
+
+        if (full)
+            break;
+    }
+    vlc_http_msg_destroy(resp);
+}
+
+static void *vlc_http_worker_thread(void *data)
+{
+    struct vlc_http_worker *w = data;
+    struct vlc_http_ranges *r = w->owner;
+
+    vlc_interrupt_set(w->interrupt);
+    vlc_mutex_lock(&r->lock);
+
+    while (!r->closing)
+    {
+        struct vlc_http_chunk *c = NULL;
+
+        if (!r->failed)
+        {
+            vlc_http_ranges_schedule(r);
+
+            for (c = r->chunks; c != NULL; c = c->next)
+                if (!c->busy && c->received < c->end)
+                    break;
+        }
+
+        if (c == NULL)
+        {
+            vlc_cond_wait(&r->wait_work, &r->lock);
+            continue;
+        }
+
+        c->busy = true;
+        w->range->start = c->received;
+        w->range->end = c->end - 1;
+        vlc_mutex_unlock(&r->lock);
+
+        vlc_http_worker_fetch(w, c);
+
+        vlc_mutex_lock(&r->lock);
+        c->busy = false;
+
+        if (c->orphan)
+            free(c);
+        else if (c->received < c->end && !r->closing)
+        {   /* Incomplete: let any worker resume it, up to a point. */
+            if (c->received > w->range->start)
+                c->failures = 0; /* progress was made */
+            if (++c->failures > VLC_HTTP_RANGES_RETRIES)
+            {
+                vlc_http_err(r->logger, "cannot fetch range %" PRIuMAX "-%"
+                             PRIuMAX, c->received, c->end - 1);
+                r->failed = true;
+            }
+            vlc_cond_broadcast(&r->wait_data);
+        }
+        else
+            c->failures = 0;
+    }
+
+    vlc_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+static int vlc_http_worker_init(struct vlc_http_worker *w,
+                                struct vlc_http_ranges *r, vlc_object_t *obj,
+                                struct vlc_http_cookie_jar_t *jar,
+                                const struct vlc_http_resource *file,
+                                const char *url)
+{
+    w->owner = r;
+
+    w->manager = vlc_http_mgr_create(obj, jar);
+    if (w->manager == NULL)
+        return -1;
+
+    w->range = malloc(sizeof (*w->range));
+    if (unlikely(w->range == NULL))
+        goto error;
+
+    if (vlc_http_res_init(&w->range->resource, &vlc_http_range_callbacks,
+                          w->manager, url, file->agent, file->referrer))
+    {
+        free(w->range);
+        goto error;
+    }
+
+    w->range->owner = w->owner;
+    if (vlc_http_res_set_login(&w->range->resource, file->username,
+                               file->password))
+        goto error_res;
+
+    w->interrupt = vlc_interrupt_create();
+    if (unlikely(w->interrupt == NULL))
+        goto error_res;
+
+    if (vlc_clone(&w->thread, vlc_http_worker_thread, w,
+                  VLC_THREAD_PRIORITY_INPUT))
+    {
+        vlc_interrupt_destroy(w->interrupt);
+        goto error_res;
+    }
+    return 0;
+
+error_res:
+    vlc_http_res_destroy(&w->range->resource);
+error:
+    vlc_http_mgr_destroy(w->manager);
+    return -1;
+}
+
+struct vlc_http_ranges *vlc_http_ranges_create(vlc_object_t *obj,
+                                               struct vlc_http_cookie_jar_t *jar,
+                                               struct vlc_http_resource *file,
+                                               unsigned count, size_t window)
+{
+    assert(count > 0);
+
+    uintmax_t size = vlc_http_file_get_size(file);
+    if (size == (uintmax_t)-1 || !vlc_http_file_can_seek(file))
+        return NULL;
+
+    struct vlc_http_ranges *r = malloc(sizeof (*r)
+                                       + count * sizeof (r->workers[0]));
+    if (unlikely(r == NULL))
+        return NULL;
+
+    r->logger = obj->obj.logger;
+    vlc_mutex_init(&r->lock);
+    vlc_cond_init(&r->wait_data);
+    vlc_cond_init(&r->wait_work);
+    r->chunks = NULL;
+    r->chunks_last = &r->chunks;
+    r->offset = 0;
+    r->next = 0;
+    r->size = size;
+    r->window = window;
+    /* At least two chunks per worker fit in the window, so that workers
+     * do not idle while the oldest chunk is being read. */
+    r->chunk_size = __MAX(window / (2 * count), VLC_HTTP_RANGES_CHUNK_MIN);
+    r->failed = false;
+    r->closing = false;
+    r->etag = NULL;
+    r->mtime = -1;
+    r->count = 0;
+
+    const char *str = vlc_http_msg_get_header(file->response, "ETag");
+    if (str != NULL)
+    {
+        if (!memcmp(str, "W/", 2))
+            str += 2; /* skip weak mark */
+        r->etag = strdup(str);
+        if (unlikely(r->etag == NULL))
+            goto error;
+    }
+    else
+        r->mtime = vlc_http_msg_get_mtime(file->response);
+
+    char *url;
+    if (unlikely(asprintf(&url, "http%s://%s%s", file->secure ? "s" : "",
+                          file->authority, file->path) == -1))
+        goto error;
+
+    while (r->count < count
+        && vlc_http_worker_init(&r->workers[r->count], r, obj, jar, file,
+                                url) == 0)
+        r->count++;
+    free(url);
+
+    if (r->count < count)
+        goto error;
+
+    vlc_http_dbg(r->logger, "fetching with %u parallel ranges of %zu bytes",
+                 count, r->chunk_size);
+    return r;
+error:
+    vlc_http_ranges_destroy(r);
+    return NULL;
+}
+
+void vlc_http_ranges_destroy(struct vlc_http_ranges *r)
+{
+    vlc_mutex_lock(&r->lock);
+    r->closing = true;
+    vlc_cond_broadcast(&r->wait_work);
+    vlc_mutex_unlock(&r->lock);
+
+    for (unsigned i = 0; i < r->count; i++)
+    {
+        struct vlc_http_worker *w = &r->workers[i];
+
+        vlc_interrupt_kill(w->interrupt);
+        vlc_join(w->thread, NULL);
+        vlc_interrupt_destroy(w->interrupt);
+        vlc_http_res_destroy(&w->range->resource);
+        vlc_http_mgr_destroy(w->manager);
+    }
+
+    while (r->chunks != NULL)
+        vlc_http_ranges_pop(r);
+
+    free(r->etag);
+    vlc_cond_destroy(&r->wait_work);
+    vlc_cond_destroy(&r->wait_data);
+    vlc_mutex_destroy(&r->lock);
+    free(r);
+}
+
+int vlc_http_ranges_seek(struct vlc_http_ranges *r, uintmax_t offset)
+{
+    vlc_mutex_lock(&r->lock);
+
+    if (r->chunks == NULL || offset < r->chunks->offset || offset >= r->next)
+    {   /* Outside of the window: start over */
+        while (r->chunks != NULL)
+            vlc_http_ranges_pop(r);
+        r->next = offset;
+    }
+    else
+    {   /* Keep the chunks from the new offset onward */
+        while (r->chunks->end <= offset)
+            vlc_http_ranges_pop(r);
+    }
+
+    r->offset = offset;
+    r->failed = false;
+    vlc_http_ranges_schedule(r);
+    vlc_cond_broadcast(&r->wait_work);
+    vlc_mutex_unlock(&r->lock);
+    return 0;
+}
+
+static void vlc_http_ranges_wake_up(void *data)
+{
+    struct vlc_http_ranges *r = data;
+
+    vlc_mutex_lock(&r->lock);
+    vlc_cond_broadcast(&r->wait_data);
+    vlc_mutex_unlock(&r->lock);
+}
+
+block_t *vlc_http_ranges_read(struct vlc_http_ranges *r)
+{
+    block_t *block = NULL;
+
+    vlc_interrupt_register(vlc_http_ranges_wake_up, r);
+    vlc_mutex_lock(&r->lock);
+
+    while (r->offset < r->size && !r->failed)
+    {
+        vlc_http_ranges_schedule(r);
+
+        struct vlc_http_chunk *c = r->chunks;
+        if (unlikely(c == NULL))
+            break; /* out of memory */
+        assert(c->offset <= r->offset && r->offset < c->end);
+
+        block = c->blocks;
+        if (block == NULL)
+        {
+            if (vlc_killed())
+                break;
+            vlc_cond_wait(&r->wait_data, &r->lock);
+            continue;
+        }
+
+        c->blocks = block->p_next;
+        if (c->blocks == NULL)
+            c->blocks_last = &c->blocks;
+        block->p_next = NULL;
+
+        uintmax_t start = c->offset;
+        uintmax_t end = start + block->i_buffer;
+
+        c->offset = end;
+        if (end >= c->end)
+        {   /* Chunk consumed, make room for another one */
+            vlc_http_ranges_pop(r);
+            vlc_cond_broadcast(&r->wait_work);
+        }
+
+        if (end <= r->offset)
+        {   /* Skipped by a seek within the chunk */
+            block_Release(block);
+            block = NULL;
+            continue;
+        }
+
+        block->p_buffer += r->offset - start;
+        block->i_buffer -= r->offset - start;
+        r->offset += block->i_buffer;
+        break;
+    }
+
+    vlc_mutex_unlock(&r->lock);
+    vlc_interrupt_unregister();
+    return block;
+}
@@ -0,0 +1,85 @@
+/*****************************************************************************
+ * ranges.h: HTTP parallel byte ranges
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <stdint.h>
+
+/**
+ * \defgroup http_ranges Parallel ranges
+ * Concurrent byte range requests for HTTP files
+ * \ingroup http_file
+ * @{
+ */
+
+struct vlc_http_resource;
+struct vlc_http_cookie_jar_t;
+struct vlc_http_ranges;
+struct block_t;
+
+/**
+ * Creates a parallel ranges reader.
+ *
+ * Starts fetching an HTTP file with several concurrent Range requests. Each
+ * worker has its own connection manager, hence its own HTTP connection.
+ * The upcoming part of the file, up to the window size, is split in chunks
+ * which are fetched out of order, and delivered in order.
+ *
+ * @param obj parent VLC object
+ * @param jar HTTP cookies jar (NULL to disable cookies)
+ * @param file HTTP file, which must have been successfully opened,
+ *             must support seeking and must have a known size
+ * @param count number of concurrent requests
+ * @param window maximum bytes count fetched ahead of the read offset
+ *
+ * @return a parallel ranges reader, or NULL on error
+ */
+struct vlc_http_ranges *vlc_http_ranges_create(vlc_object_t *obj,
+                                               struct vlc_http_cookie_jar_t *,
+                                               struct vlc_http_resource *file,
+                                               unsigned count, size_t window);
+
+/**
+ * Destroys a parallel ranges reader.
+ *
+ * Aborts any pending request, and releases all resources.
+ */
+void vlc_http_ranges_destroy(struct vlc_http_ranges *);
+
+/**
+ * Sets the read offset.
+ *
+ * Data already fetched or being fetched beyond the new offset is kept.
+ * Anything else is discarded.
+ *
+ * @param offset byte offset of next read
+ * @retval 0 if seek succeeded
+ * @retval -1 if seek failed
+ */
+int vlc_http_ranges_seek(struct vlc_http_ranges *, uintmax_t offset);
+
+/**
+ * Reads data.
+ *
+ * Waits for the data at the read offset, and updates the offset.
+ *
+ * @return data block, or NULL on end-of-file, error or interruption
+ */
+struct block_t *vlc_http_ranges_read(struct vlc_http_ranges *);
+
+/** @} */
@@ -328,6 +328,15 @@ struct block_t *vlc_http_res_read(struct vlc_http_resource *res)
     return vlc_http_msg_read(res->response);
 }
 
+int vlc_http_res_get_stats(struct vlc_http_resource *res,
+                           struct vlc_http_stream_stats *restrict st)
+{
+    if (res->response == NULL)
+        return -1;
+
+    return vlc_http_msg_get_stats(res->response, st);
+}
+
 int vlc_http_res_set_login(struct vlc_http_resource *res,
                            const char *username, const char *password)
 {
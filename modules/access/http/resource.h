@@ -31,6 +31,7 @@
 struct vlc_http_msg;
 struct vlc_http_mgr;
 struct vlc_http_resource;
+struct vlc_http_stream_stats;
 
 struct vlc_http_resource_cbs
 {
@@ -96,6 +97,15 @@ char *vlc_http_res_get_type(struct vlc_http_resource *);
  */
 struct block_t *vlc_http_res_read(struct vlc_http_resource *);
 
+/**
+ * Gets transfer statistics.
+ *
+ * @retval 0 on success
+ * @retval -1 if no statistics are available for the current response
+ */
+int vlc_http_res_get_stats(struct vlc_http_resource *,
+                           struct vlc_http_stream_stats *);
+
 int vlc_http_res_set_login(struct vlc_http_resource *res,
                            const char *username, const char *password);
 char *vlc_http_res_get_basic_realm(struct vlc_http_resource *res);
@@ -60,6 +60,8 @@
 #define NACK_INTERVAL 5 /*ms*/
 /* Calculate and print stats once per second */
 #define STATS_INTERVAL 1000 /*ms*/
+/* Maximum number of packets output in a single block */
+#define RIST_MAX_BATCH 32
 
 static const int nack_type[] = {
     0, 1,
@@ -83,6 +85,8 @@ typedef struct
     uint64_t         last_nack_tx;
     vlc_thread_t     thread;
     int              i_max_packet_size;
+    size_t           i_batch_size;
+    uint8_t          *p_rtcp_buf;
     int              i_poll_timeout;
     int              i_poll_timeout_current;
     bool             b_ismulticast;
@@ -590,21 +594,25 @@ static void rtcp_input(stream_t *p_access, struct rist_flow *flow, uint8_t *buf_
     }
 }
 
-static bool rist_input(stream_t *p_access, struct rist_flow *flow, uint8_t *buf, size_t len)
+static bool rist_input(stream_t *p_access, struct rist_flow *flow, block_t *block)
 {
     stream_sys_t *p_sys = p_access->p_sys;
+    const uint8_t *buf = block->p_buffer;
+    size_t len = block->i_buffer;
 
     /* safety checks */
     if ( len < RTP_HEADER_SIZE )
     {
         /* check if packet size >= rtp header size */
-        msg_Err(p_access, "Rist rtp packet must have at least 12 bytes, we have %lu", len);
+        msg_Err(p_access, "Rist rtp packet must have at least 12 bytes, we have %zu", len);
+        block_Release(block);
         return false;
     }
     else if (!rtp_check_hdr(buf))
     {
         /* check for a valid rtp header */
         msg_Err(p_access, "Malformed rtp packet header starting with %02x, ignoring.", buf[0]);
+        block_Release(block);
         return false;
     }
 
@@ -657,20 +665,13 @@ static bool rist_input(stream_t *p_access, struct rist_flow *flow, uint8_t *buf,
         }
     }
 
-    /* Always replace the existing one with the new one */
+    /* Always replace the existing one with the new one. The received block
+     * is queued as is, the payload is only copied once, on output. */
     struct rtp_pkt *pkt;
     pkt = &(flow->buffer[idx]);
-    if (pkt->buffer && pkt->buffer->i_buffer > 0)
-    {
+    if (pkt->buffer)
         block_Release(pkt->buffer);
-        pkt->buffer = NULL;
-    }
-    pkt->buffer = block_Alloc(len);
-    if (!pkt->buffer)
-        return false;
-
-    pkt->buffer->i_buffer = len;
-    memcpy(pkt->buffer->p_buffer, buf, len);
+    pkt->buffer = block;
     pkt->rtp_ts = pkt_ts;
     p_sys->last_data_rx = vlc_tick_now();
     /* Reset the try counter regardless of wether it was a retransmit or not */
@@ -708,14 +709,14 @@ static bool rist_input(stream_t *p_access, struct rist_flow *flow, uint8_t *buf,
     return success;
 }
 
-static block_t *rist_dequeue(stream_t *p_access, struct rist_flow *flow)
+/* Appends the payload of the next packet due for output to pktout, if it fits */
+static bool rist_dequeue(stream_t *p_access, struct rist_flow *flow, block_t *pktout)
 {
     stream_sys_t *p_sys = p_access->p_sys;
-    block_t *pktout = NULL;
     struct rtp_pkt *pkt;
     uint16_t idx;
     if (flow->ri == flow->wi || flow->reset > 0)
-        return NULL;
+        return false;
 
     idx = flow->ri;
     bool found_data = false;
@@ -739,17 +740,16 @@ static block_t *rist_dequeue(stream_t *p_access, struct rist_flow *flow)
         if (flow->hi_timestamp > (uint32_t)(pkt->rtp_ts + flow->rtp_latency))
         {
             /* Populate output packet now but remove rtp header from source */
-            int newSize = pkt->buffer->i_buffer - RTP_HEADER_SIZE;
-            pktout = block_Alloc(newSize);
-            if (pktout)
-            {
-                pktout->i_buffer = newSize;
-                memcpy(pktout->p_buffer, pkt->buffer->p_buffer + RTP_HEADER_SIZE, newSize);
-                /* free the buffer and increase the read index */
-                flow->ri = idx;
-                /* TODO: calculate average duration using buffer average (bring from sender) */
-                found_data = true;
-            }
+            size_t newSize = pkt->buffer->i_buffer - RTP_HEADER_SIZE;
+            if (pktout->i_buffer + newSize > p_sys->i_batch_size)
+                return false; /* left for the next block */
+            memcpy(pktout->p_buffer + pktout->i_buffer,
+                   pkt->buffer->p_buffer + RTP_HEADER_SIZE, newSize);
+            pktout->i_buffer += newSize;
+            /* free the buffer and increase the read index */
+            flow->ri = idx;
+            /* TODO: calculate average duration using buffer average (bring from sender) */
+            found_data = true;
             block_Release(pkt->buffer);
             pkt->buffer = NULL;
             break;
@@ -766,7 +766,26 @@ static block_t *rist_dequeue(stream_t *p_access, struct rist_flow *flow)
         p_sys->b_flag_discontinuity = true;
     }
 
-    return pktout;
+    return found_data;
+}
+
+/* Outputs all the packets that are due at once, up to RIST_MAX_BATCH of them */
+static void rist_dequeue_batch(stream_t *p_access, struct rist_flow *flow, block_t *pktout)
+{
+    stream_sys_t *p_sys = p_access->p_sys;
+    bool found_data = false;
+
+    while (rist_dequeue(p_access, flow, pktout))
+        found_data = true;
+
+    /* if there is data, we need to come back faster to finish emptying it */
+    if (found_data) {
+        p_sys->i_poll_timeout_current = 0;
+        p_sys->i_poll_timeout_zero_count++;
+    } else {
+        p_sys->i_poll_timeout_current = p_sys->i_poll_timeout;
+        p_sys->i_poll_timeout_nonzero_count++;
+    }
 }
 
 static void *rist_thread(void *data)
@@ -844,25 +863,20 @@ static block_t *BlockRIST(stream_t *p_access, bool *restrict eof)
     ret = vlc_poll_i11e(pfd, poll_sockets, p_sys->i_poll_timeout_current);
     if (unlikely(ret < 0))
         return NULL;
-    else if (ret == 0)
+
+    pktout = block_Alloc(p_sys->i_batch_size);
+    if (unlikely(pktout == NULL))
+        return NULL;
+    pktout->i_buffer = 0;
+
+    if (ret == 0)
     {
-        /* Poll timeout, check the queue for the next packet that needs to be delivered */
-        pktout = rist_dequeue(p_access, flow);
-        /* if there is data, we need to come back faster to finish emptying it */
-        if (pktout) {
-            p_sys->i_poll_timeout_current = 0;
-            p_sys->i_poll_timeout_zero_count++;
-        } else {
-            p_sys->i_poll_timeout_current = p_sys->i_poll_timeout;
-            p_sys->i_poll_timeout_nonzero_count++;
-        }
+        /* Poll timeout, check the queue for the next packets that need to be delivered */
+        rist_dequeue_batch(p_access, flow, pktout);
     }
     else
     {
-
-        uint8_t *buf = malloc(p_sys->i_max_packet_size);
-        if ( unlikely( buf == NULL ) )
-            return NULL;
+        uint8_t *buf = p_sys->p_rtcp_buf;
 
         /* Process rctp incoming data */
         if (pfd[1].revents & POLLIN)
@@ -892,30 +906,27 @@ static block_t *BlockRIST(stream_t *p_access, bool *restrict eof)
         /* Process regular incoming data */
         if (pfd[0].revents & POLLIN)
         {
-            r = rist_Read_i11e(flow->fd_in, buf, p_sys->i_max_packet_size);
+            block_t *pkt = block_Alloc(p_sys->i_max_packet_size);
+            if (unlikely(pkt == NULL))
+                r = -1;
+            else
+                r = rist_Read_i11e(flow->fd_in, pkt->p_buffer, p_sys->i_max_packet_size);
             if (unlikely(r == -1)) {
                 msg_Err(p_access, "socket %d error: %s\n", flow->fd_in, gai_strerror(errno));
+                if (pkt)
+                    block_Release(pkt);
             }
             else
             {
+                pkt->i_buffer = r;
                 /* rist_input will process and queue the pkt */
-                if (rist_input(p_access, flow, buf, r))
+                if (rist_input(p_access, flow, pkt))
                 {
-                    /* Check the queue for the next packet that needs to be delivered */
-                    pktout = rist_dequeue(p_access, flow);
-                    if (pktout) {
-                        p_sys->i_poll_timeout_current = 0;
-                        p_sys->i_poll_timeout_zero_count++;
-                    } else {
-                        p_sys->i_poll_timeout_current = p_sys->i_poll_timeout;
-                        p_sys->i_poll_timeout_nonzero_count++;
-                    }
+                    /* Check the queue for the next packets that need to be delivered */
+                    rist_dequeue_batch(p_access, flow, pktout);
                 }
             }
         }
-
-        free(buf);
-        buf = NULL;
     }
 
     now = vlc_tick_now();
@@ -997,7 +1008,7 @@ static block_t *BlockRIST(stream_t *p_access, bool *restrict eof)
         flow->reset = 1;
     }
 
-    if (pktout)
+    if (pktout->i_buffer > 0)
     {
         if (p_sys->b_flag_discontinuity) {
             pktout->i_flags |= BLOCK_FLAG_DISCONTINUITY;
@@ -1005,8 +1016,9 @@ static block_t *BlockRIST(stream_t *p_access, bool *restrict eof)
         }
         return pktout;
     }
-    else
-        return NULL;
+
+    block_Release(pktout);
+    return NULL;
 }
 
 static void Clean( stream_t *p_access )
@@ -1034,6 +1046,7 @@ static void Clean( stream_t *p_access )
         free(p_sys->flow->buffer);
         free(p_sys->flow);
     }
+    free(p_sys->p_rtcp_buf);
 
     vlc_mutex_destroy( &p_sys->lock );
 }
@@ -1091,6 +1104,12 @@ static int Open(vlc_object_t *p_this)
     p_sys->nack_type = var_InheritInteger( p_access, "nack-type" );
     p_sys->i_max_packet_size = var_InheritInteger( p_access, "packet-size" );
     p_sys->i_poll_timeout = var_InheritInteger( p_access, "maximum-jitter" );
+    if (p_sys->i_max_packet_size <= RTP_HEADER_SIZE)
+        p_sys->i_max_packet_size = RIST_MAX_PACKET_SIZE;
+    p_sys->i_batch_size = RIST_MAX_BATCH * (p_sys->i_max_packet_size - RTP_HEADER_SIZE);
+    p_sys->p_rtcp_buf = malloc(p_sys->i_max_packet_size);
+    if (unlikely(p_sys->p_rtcp_buf == NULL))
+        goto failed;
     p_sys->flow->retry_interval = var_InheritInteger( p_access, "retry-interval" );
     p_sys->flow->max_retries = var_InheritInteger( p_access, "max-retries" );
     p_sys->flow->latency = var_InheritInteger( p_access, "latency" );
@@ -0,0 +1,271 @@
+/**
+ * @file fec.c
+ * @brief SMPTE 2022-1 forward error correction for RTP
+ */
+/*****************************************************************************
+ * Copyright © 2020 VLC authors and VideoLAN
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_network.h>
+
+#include "rtp.h"
+
+/* Media packets are kept long enough to cover the largest FEC matrix
+ * (L x D <= 100 for SMPTE 2022-1) plus a generous amount of misordering. */
+#define FEC_MEDIA_HISTORY 1024
+/* FEC packets are kept until all the packets they protect are too old */
+#define FEC_PACKET_HISTORY 64
+
+#define FEC_HEADER_SIZE 16
+
+struct rtp_fec_t
+{
+    block_t *media[FEC_MEDIA_HISTORY]; /* copies indexed by sequence */
+    block_t *fec[FEC_PACKET_HISTORY]; /* FEC packets, oldest first */
+    unsigned fec_next;
+};
+
+static inline uint16_t fec_rtp_seq (const block_t *block)
+{
+    return GetWBE (block->p_buffer + 2);
+}
+
+rtp_fec_t *rtp_fec_create (void)
+{
+    return calloc (1, sizeof (rtp_fec_t));
+}
+
+void rtp_fec_destroy (rtp_fec_t *fec)
+{
+    for (unsigned i = 0; i < FEC_MEDIA_HISTORY; i++)
+        if (fec->media[i] != NULL)
+            block_Release (fec->media[i]);
+    for (unsigned i = 0; i < FEC_PACKET_HISTORY; i++)
+        if (fec->fec[i] != NULL)
+            block_Release (fec->fec[i]);
+    free (fec);
+}
+
+static const block_t *fec_find_media (const rtp_fec_t *fec, uint16_t seq)
+{
+    const block_t *block = fec->media[seq % FEC_MEDIA_HISTORY];
+
+    if (block != NULL && fec_rtp_seq (block) == seq)
+        return block;
+    return NULL;
+}
+
+/**
+ * Keeps a copy of a received media packet, including its RTP header and
+ * padding, as the FEC payload protects both.
+ */
+void rtp_fec_media (rtp_fec_t *fec, const block_t *block)
+{
+    assert (block->i_buffer >= 12);
+
+    block_t **slot = &fec->media[fec_rtp_seq (block) % FEC_MEDIA_HISTORY];
+    if (*slot != NULL)
+    {
+        if (fec_rtp_seq (*slot) == fec_rtp_seq (block))
+            return; /* duplicate */
+        block_Release (*slot);
+    }
+
+    *slot = block_Alloc (block->i_buffer);
+    if (likely(*slot != NULL))
+        memcpy ((*slot)->p_buffer, block->p_buffer, block->i_buffer);
+}
+
+/* FEC header fields (see SMPTE 2022-1 section 8.3 and RFC 2733) */
+static inline const uint8_t *fec_header (const block_t *block)
+{
+    return block->p_buffer + 12;
+}
+
+static inline uint16_t fec_sn_base (const block_t *block)
+{
+    return GetWBE (fec_header (block));
+}
+
+static inline uint8_t fec_offset (const block_t *block)
+{
+    return fec_header (block)[13];
+}
+
+static inline uint8_t fec_count (const block_t *block)
+{
+    return fec_header (block)[14];
+}
+
+/**
+ * Finds the sequence number of the only media packet missing from the set
+ * protected by an FEC packet.
+ * @return 0 if exactly one packet is missing, -1 otherwise.
+ */
+static int fec_missing (const rtp_fec_t *fec, const block_t *block,
+                        uint16_t *restrict missing)
+{
+    const uint16_t base = fec_sn_base (block);
+    const uint8_t offset = fec_offset (block), count = fec_count (block);
+    unsigned n = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        uint16_t seq = base + i * offset;
+
+        if (fec_find_media (fec, seq) == NULL)
+        {
+            if (++n > 1)
+                return -1;
+            *missing = seq;
+        }
+    }
+    return (n == 1) ? 0 : -1;
+}
+
+/**
+ * Rebuilds a missing media packet from an FEC packet and the other packets
+ * it protects. All of them are XOR'ed together.
+ */
+static block_t *fec_rebuild (const rtp_fec_t *fec, const block_t *block,
+                             uint16_t missing)
+{
+    const uint8_t *hdr = fec_header (block);
+    const uint8_t *payload = hdr + FEC_HEADER_SIZE;
+    const size_t payload_size = block->i_buffer - 12 - FEC_HEADER_SIZE;
+    const uint16_t base = fec_sn_base (block);
+    const uint8_t offset = fec_offset (block), count = fec_count (block);
+
+    /* Header fields recovery. P, X, CC and M come from the FEC RTP header. */
+    uint8_t b0 = block->p_buffer[0] & 0x3F;
+    uint8_t b1 = (block->p_buffer[1] & 0x80) | (hdr[4] & 0x7F);
+    uint16_t length = GetWBE (hdr + 2);
+    uint32_t ts = GetDWBE (hdr + 8);
+    uint32_t ssrc = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        uint16_t seq = base + i * offset;
+        if (seq == missing)
+            continue;
+
+        const block_t *media = fec_find_media (fec, seq);
+        assert (media != NULL);
+        b0 ^= media->p_buffer[0] & 0x3F;
+        b1 ^= media->p_buffer[1];
+        length ^= media->i_buffer - 12;
+        ts ^= GetDWBE (media->p_buffer + 4);
+        ssrc = GetDWBE (media->p_buffer + 8);
+    }
+
+    if (length > payload_size)
+        return NULL; /* inconsistent FEC packet */
+
+    block_t *out = block_Alloc (12 + length);
+    if (unlikely(out == NULL))
+        return NULL;
+
+    uint8_t *p = out->p_buffer;
+    p[0] = 0x80 | b0;
+    p[1] = b1;
+    SetWBE (p + 2, missing);
+    SetDWBE (p + 4, ts);
+    SetDWBE (p + 8, ssrc);
+    memcpy (p + 12, payload, length);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        uint16_t seq = base + i * offset;
+        if (seq == missing)
+            continue;
+
+        const block_t *media = fec_find_media (fec, seq);
+        size_t len = media->i_buffer - 12;
+        if (len > length)
+            len = length;
+        for (size_t j = 0; j < len; j++)
+            p[12 + j] ^= media->p_buffer[12 + j];
+    }
+    return out;
+}
+
+/**
+ * Receives an FEC packet (including its RTP header).
+ * @return a rebuilt media packet if that FEC packet protects exactly one
+ * missing packet, or NULL.
+ */
+block_t *rtp_fec_input (rtp_fec_t *fec, block_t *block)
+{
+    if (block->i_buffer < 12 + FEC_HEADER_SIZE
+     || (block->p_buffer[0] >> 6) != 2 /* RTP version */
+     || (block->p_buffer[0] & 0x0F) != 0 /* CSRC count */)
+        goto drop;
+
+    const uint8_t *hdr = fec_header (block);
+    if (((hdr[12] >> 3) & 7) != 0 /* XOR type */
+     || fec_count (block) == 0 || fec_offset (block) == 0)
+        goto drop;
+
+    block_t **slot = &fec->fec[fec->fec_next];
+    if (*slot != NULL)
+        block_Release (*slot);
+    *slot = block;
+    fec->fec_next = (fec->fec_next + 1) % FEC_PACKET_HISTORY;
+
+    uint16_t missing;
+    if (fec_missing (fec, block, &missing))
+        return NULL;
+    return fec_rebuild (fec, block, missing);
+
+drop:
+    block_Release (block);
+    return NULL;
+}
+
+/**
+ * Tries to rebuild a missing media packet from the FEC packets received so
+ * far, before the jitter buffer gives up on it.
+ */
+block_t *rtp_fec_recover (rtp_fec_t *fec, uint16_t seq)
+{
+    for (unsigned i = 0; i < FEC_PACKET_HISTORY; i++)
+    {
+        const block_t *block = fec->fec[i];
+        if (block == NULL)
+            continue;
+
+        uint16_t d = seq - fec_sn_base (block);
+        if (d % fec_offset (block) != 0
+         || d / fec_offset (block) >= fec_count (block))
+            continue;
+
+        uint16_t missing;
+        if (fec_missing (fec, block, &missing) == 0 && missing == seq)
+            return fec_rebuild (fec, block, missing);
+    }
+    return NULL;
+}
@@ -30,6 +30,7 @@
 #include <vlc_network.h>
 
 #include <limits.h>
+#include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #ifdef HAVE_POLL
@@ -100,6 +101,49 @@ static int rtp_timeout (vlc_tick_t deadline)
     return t;
 }
 
+/**
+ * Sends an RTCP packet back to the source of the RTP packets.
+ */
+void rtcp_send (demux_t *demux, const void *buf, size_t len)
+{
+    demux_sys_t *sys = demux->p_sys;
+    struct sockaddr_storage addr;
+    int fd = sys->fd;
+
+    if (sys->peerlen == 0)
+        return; /* no packets received yet */
+#ifdef HAVE_SRTP
+    if (sys->srtp != NULL)
+        return; /* SRTCP is not implemented */
+#endif
+
+    memcpy (&addr, &sys->peer, sys->peerlen);
+    if (sys->rtcp_fd != -1)
+    {   /* Not multiplexed: assume RTCP uses the next port (RFC 3550 §11) */
+        fd = sys->rtcp_fd;
+        switch (addr.ss_family)
+        {
+            case AF_INET:
+            {
+                struct sockaddr_in *sin = (struct sockaddr_in *)&addr;
+                sin->sin_port = htons (ntohs (sin->sin_port) + 1);
+                break;
+            }
+#ifdef AF_INET6
+            case AF_INET6:
+            {
+                struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&addr;
+                sin6->sin6_port = htons (ntohs (sin6->sin6_port) + 1);
+                break;
+            }
+#endif
+        }
+    }
+
+    if (sendto (fd, buf, len, 0, (struct sockaddr *)&addr, sys->peerlen) < 0)
+        msg_Dbg (demux, "RTCP send error: %s", vlc_strerror_c(errno));
+}
+
 /**
  * RTP/RTCP session thread for datagram sockets
  */
@@ -121,17 +165,26 @@ void *rtp_dgram_thread (void *opaque)
     };
     struct msghdr msg =
     {
+        .msg_name = &sys->peer,
         .msg_iov = &iov,
         .msg_iovlen = 1,
     };
 
-    struct pollfd ufd[1];
+    struct pollfd ufd[3];
+    unsigned nfd = 1;
     ufd[0].fd = rtp_fd;
     ufd[0].events = POLLIN;
+    for (unsigned i = 0; i < 2; i++)
+        if (sys->fec_fd[i] != -1)
+        {
+            ufd[nfd].fd = sys->fec_fd[i];
+            ufd[nfd].events = POLLIN;
+            nfd++;
+        }
 
     for (;;)
     {
-        int n = poll (ufd, 1, rtp_timeout (deadline));
+        int n = poll (ufd, nfd, rtp_timeout (deadline));
         if (n == -1)
             continue;
 
@@ -155,6 +208,7 @@ void *rtp_dgram_thread (void *opaque)
             }
 
             iov.iov_base = block->p_buffer;
+            msg.msg_namelen = sizeof (sys->peer);
             msg.msg_flags = trunc_flag;
 
             ssize_t len = recvmsg (rtp_fd, &msg, trunc_flag);
@@ -170,6 +224,7 @@ void *rtp_dgram_thread (void *opaque)
                 else
                     block->i_buffer = len;
 
+                sys->peerlen = msg.msg_namelen;
                 rtp_process (demux, block);
             }
             else
@@ -180,6 +235,31 @@ void *rtp_dgram_thread (void *opaque)
             }
         }
 
+        /* FEC packets */
+        for (unsigned i = 1; i < nfd && n > 0; i++)
+        {
+            if (!ufd[i].revents)
+                continue;
+            n--;
+
+            block_t *block = block_Alloc (iov.iov_len);
+            if (unlikely(block == NULL))
+                break;
+
+            ssize_t len = recv (ufd[i].fd, block->p_buffer, block->i_buffer, 0);
+            if (len != -1)
+            {
+                block->i_buffer = len;
+                rtp_queue_fec (demux, sys->session, block);
+            }
+            else
+            {
+                msg_Warn (demux, "FEC network error: %s",
+                          vlc_strerror_c(errno));
+                block_Release (block);
+            }
+        }
+
     dequeue:
         if (!rtp_dequeue (demux, sys->session, &deadline))
             deadline = VLC_TICK_INVALID;
@@ -75,6 +75,23 @@
     "RTP packets will be discarded if they are too far behind (i.e. in the " \
     "past) by this many packets from the last received packet." )
 
+#define RTP_FEC_TEXT N_("SMPTE 2022-1 forward error correction")
+#define RTP_FEC_LONGTEXT N_( \
+    "Column and row FEC packets will be received on the ports two and " \
+    "four above the RTP port respectively, and used to recover lost " \
+    "RTP packets.")
+
+#define RTP_RTX_PT_TEXT N_("RTP retransmission payload type")
+#define RTP_RTX_PT_LONGTEXT N_( \
+    "Lost RTP packets will be requested with RTCP negative " \
+    "acknowledgements, and packets with this payload type will be " \
+    "handled as retransmissions (RFC 4588). Zero disables retransmissions.")
+
+#define RTP_RECOVERY_DELAY_TEXT N_("RTP packet recovery delay (ms)")
+#define RTP_RECOVERY_DELAY_LONGTEXT N_( \
+    "How long to wait at most for lost RTP packets to be recovered by " \
+    "FEC or retransmission.")
+
 #define RTP_DYNAMIC_PT_TEXT N_("RTP payload format assumed for dynamic " \
                                "payloads")
 #define RTP_DYNAMIC_PT_LONGTEXT N_( \
@@ -122,6 +139,13 @@ vlc_module_begin ()
     add_integer ("rtp-max-misorder", 100, RTP_MAX_MISORDER_TEXT,
                  RTP_MAX_MISORDER_LONGTEXT, true)
         change_integer_range (0, 32767)
+    add_bool ("rtp-fec", false, RTP_FEC_TEXT, RTP_FEC_LONGTEXT, true)
+    add_integer ("rtp-rtx-pt", 0, RTP_RTX_PT_TEXT,
+                 RTP_RTX_PT_LONGTEXT, true)
+        change_integer_range (0, 127)
+    add_integer ("rtp-recovery-delay", 200, RTP_RECOVERY_DELAY_TEXT,
+                 RTP_RECOVERY_DELAY_LONGTEXT, true)
+        change_integer_range (0, 10000)
     add_string ("rtp-dynamic-pt", NULL, RTP_DYNAMIC_PT_TEXT,
                 RTP_DYNAMIC_PT_LONGTEXT, true)
         change_string_list (dynamic_pt_list, dynamic_pt_list_text)
@@ -208,7 +232,7 @@ static int Open (vlc_object_t *obj)
     int rtcp_dport = var_CreateGetInteger (obj, "rtcp-port");
 
     /* Try to connect */
-    int fd = -1, rtcp_fd = -1;
+    int fd = -1, rtcp_fd = -1, fec_fd[2] = { -1, -1 };
 
     switch (tp)
     {
@@ -219,6 +243,13 @@ static int Open (vlc_object_t *obj)
                 break;
             if (rtcp_dport > 0) /* XXX: source port is unknown */
                 rtcp_fd = net_OpenDgram (obj, dhost, rtcp_dport, shost, 0, tp);
+            if (var_CreateGetBool (obj, "rtp-fec"))
+            {   /* XXX: source ports are unknown */
+                fec_fd[0] = net_OpenDgram (obj, dhost, dport + 2, shost, 0, tp);
+                fec_fd[1] = net_OpenDgram (obj, dhost, dport + 4, shost, 0, tp);
+                if (fec_fd[0] == -1 && fec_fd[1] == -1)
+                    msg_Warn (obj, "cannot receive FEC packets");
+            }
             break;
 
          case IPPROTO_DCCP:
@@ -253,6 +284,9 @@ static int Open (vlc_object_t *obj)
         net_Close (fd);
         if (rtcp_fd != -1)
             net_Close (rtcp_fd);
+        for (unsigned i = 0; i < 2; i++)
+            if (fec_fd[i] != -1)
+                net_Close (fec_fd[i]);
         return VLC_EGENERIC;
     }
 
@@ -262,10 +296,16 @@ static int Open (vlc_object_t *obj)
 #endif
     p_sys->fd           = fd;
     p_sys->rtcp_fd      = rtcp_fd;
+    p_sys->fec_fd[0]    = fec_fd[0];
+    p_sys->fec_fd[1]    = fec_fd[1];
+    p_sys->peerlen      = 0;
     p_sys->max_src      = var_CreateGetInteger (obj, "rtp-max-src");
     p_sys->timeout      = vlc_tick_from_sec( var_CreateGetInteger (obj, "rtp-timeout") );
     p_sys->max_dropout  = var_CreateGetInteger (obj, "rtp-max-dropout");
     p_sys->max_misorder = var_CreateGetInteger (obj, "rtp-max-misorder");
+    p_sys->rtx_pt       = var_CreateGetInteger (obj, "rtp-rtx-pt");
+    p_sys->recovery_delay = VLC_TICK_FROM_MS(
+                    var_CreateGetInteger (obj, "rtp-recovery-delay"));
     p_sys->thread_ready = false;
     p_sys->autodetect   = true;
 
@@ -338,6 +378,9 @@ static void Close (vlc_object_t *obj)
         rtp_session_destroy (demux, p_sys->session);
     if (p_sys->rtcp_fd != -1)
         net_Close (p_sys->rtcp_fd);
+    for (unsigned i = 0; i < 2; i++)
+        if (p_sys->fec_fd[i] != -1)
+            net_Close (p_sys->fec_fd[i]);
     net_Close (p_sys->fd);
     free (p_sys);
 }
@@ -54,12 +54,23 @@ void xiph_decode (demux_t *demux, void *data, block_t *block);
 rtp_session_t *rtp_session_create (demux_t *);
 void rtp_session_destroy (demux_t *, rtp_session_t *);
 void rtp_queue (demux_t *, rtp_session_t *, block_t *);
-bool rtp_dequeue (demux_t *, const rtp_session_t *, vlc_tick_t *);
-void rtp_dequeue_force (demux_t *, const rtp_session_t *);
+void rtp_queue_fec (demux_t *, rtp_session_t *, block_t *);
+bool rtp_dequeue (demux_t *, rtp_session_t *, vlc_tick_t *);
+void rtp_dequeue_force (demux_t *, rtp_session_t *);
 int rtp_add_type (demux_t *demux, rtp_session_t *ses, const rtp_pt_t *pt);
 
 void *rtp_dgram_thread (void *data);
 void *rtp_stream_thread (void *data);
+void rtcp_send (demux_t *, const void *, size_t);
+
+/** @section Forward error correction (SMPTE 2022-1) */
+typedef struct rtp_fec_t rtp_fec_t;
+
+rtp_fec_t *rtp_fec_create (void);
+void rtp_fec_destroy (rtp_fec_t *);
+void rtp_fec_media (rtp_fec_t *, const block_t *);
+block_t *rtp_fec_input (rtp_fec_t *, block_t *);
+block_t *rtp_fec_recover (rtp_fec_t *, uint16_t);
 
 /* Global data */
 typedef struct
@@ -71,12 +82,18 @@ typedef struct
 #endif
     int           fd;
     int           rtcp_fd;
+    int           fec_fd[2]; /**< Column and row FEC sockets */
     vlc_thread_t  thread;
 
+    struct sockaddr_storage peer; /**< Source address of the last packet */
+    socklen_t     peerlen;
+
     vlc_tick_t    timeout;
+    vlc_tick_t    recovery_delay; /**< Max wait for FEC or retransmission */
     uint16_t      max_dropout; /**< Max packet forward misordering */
     uint16_t      max_misorder; /**< Max packet backward misordering */
     uint8_t       max_src; /**< Max simultaneous RTP sources */
+    uint8_t       rtx_pt; /**< Retransmission payload type (0 if none) */
     bool          thread_ready;
     bool          autodetect; /**< Payload type autodetection pending */
 } demux_sys_t;
@@ -25,11 +25,14 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <errno.h>
 
 #include <vlc_common.h>
 #include <vlc_demux.h>
+#include <vlc_network.h>
+#include <vlc_rand.h>
 
 #include "rtp.h"
 
@@ -42,6 +45,8 @@ struct rtp_session_t
     unsigned       srcc;
     uint8_t        ptc;
     rtp_pt_t      *ptv;
+    rtp_fec_t     *fec; /* NULL if FEC is not enabled */
+    uint32_t       ssrc; /* for RTCP feedback */
 };
 
 static rtp_source_t *
@@ -49,7 +54,8 @@ rtp_source_create (demux_t *, const rtp_session_t *, uint32_t, uint16_t);
 static void
 rtp_source_destroy (demux_t *, const rtp_session_t *, rtp_source_t *);
 
-static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
+static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *,
+                        block_t *);
 
 /**
  * Creates a new RTP session.
@@ -57,6 +63,7 @@ static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
 rtp_session_t *
 rtp_session_create (demux_t *demux)
 {
+    demux_sys_t *p_sys = demux->p_sys;
     rtp_session_t *session = malloc (sizeof (*session));
     if (session == NULL)
         return NULL;
@@ -65,8 +72,18 @@ rtp_session_create (demux_t *demux)
     session->srcc = 0;
     session->ptc = 0;
     session->ptv = NULL;
+    session->fec = NULL;
+    vlc_rand_bytes (&session->ssrc, sizeof (session->ssrc));
 
-    (void)demux;
+    if (p_sys->fec_fd[0] != -1 || p_sys->fec_fd[1] != -1)
+    {
+        session->fec = rtp_fec_create ();
+        if (session->fec == NULL)
+        {
+            free (session);
+            return NULL;
+        }
+    }
     return session;
 }
 
@@ -79,6 +96,8 @@ void rtp_session_destroy (demux_t *demux, rtp_session_t *session)
     for (unsigned i = 0; i < session->srcc; i++)
         rtp_source_destroy (demux, session, session->srcv[i]);
 
+    if (session->fec != NULL)
+        rtp_fec_destroy (session->fec);
     free (session->srcv);
     free (session->ptv);
     free (session);
@@ -134,6 +153,9 @@ int rtp_add_type (demux_t *demux, rtp_session_t *ses, const rtp_pt_t *pt)
     return 0;
 }
 
+/* Size of the per-source re-ordering window, must be a power of two */
+#define RTP_RING_SIZE 2048
+
 /** State for an RTP source */
 struct rtp_source_t
 {
@@ -148,8 +170,26 @@ struct rtp_source_t
     uint16_t bad_seq; /* tentatively next expected sequence for resync */
     uint16_t max_seq; /* next expected sequence */
 
-    uint16_t last_seq; /* sequence of the next dequeued packet */
-    block_t *blocks; /* re-ordered blocks queue */
+    uint16_t last_seq; /* sequence of the last dequeued packet */
+    uint16_t next_seq; /* lowest sequence that can still be queued */
+    unsigned pending; /* number of queued blocks */
+    bool     discontinuity; /* flag the next dequeued packet */
+    uint8_t  last_pt; /* payload type of the original packets */
+
+    vlc_tick_t nack_time; /* time of the last retransmission request */
+    vlc_tick_t rtx_delay; /* retransmission delay estimate */
+
+    struct
+    {
+        uint64_t received;
+        uint64_t lost;
+        uint64_t late;
+        uint64_t duplicates;
+        uint64_t fec;
+        uint64_t rtx;
+    } stats;
+
+    block_t *ring[RTP_RING_SIZE]; /* re-ordered blocks, indexed by sequence */
     void    *opaque[]; /* Per-source private payload data */
 };
 
@@ -168,11 +208,20 @@ rtp_source_create (demux_t *demux, const rtp_session_t *session,
 
     source->ssrc = ssrc;
     source->jitter = 0;
+    source->last_rx = VLC_TICK_INVALID;
     source->ref_rtp = 0;
     source->ref_ntp = UINT64_C (1) << 62;
     source->max_seq = source->bad_seq = init_seq;
     source->last_seq = init_seq - 1;
-    source->blocks = NULL;
+    source->next_seq = init_seq;
+    source->pending = 0;
+    source->discontinuity = false;
+    source->last_pt = 0;
+    source->nack_time = VLC_TICK_INVALID;
+    source->rtx_delay = 0;
+    memset (&source->stats, 0, sizeof (source->stats));
+    for (unsigned i = 0; i < RTP_RING_SIZE; i++)
+        source->ring[i] = NULL;
 
     /* Initializes all payload */
     for (unsigned i = 0; i < session->ptc; i++)
@@ -182,6 +231,19 @@ rtp_source_create (demux_t *demux, const rtp_session_t *session,
     return source;
 }
 
+static void rtp_source_flush (rtp_source_t *source)
+{
+    for (unsigned i = 0; source->pending > 0; i++)
+    {
+        assert (i < RTP_RING_SIZE);
+        if (source->ring[i] != NULL)
+        {
+            block_Release (source->ring[i]);
+            source->ring[i] = NULL;
+            source->pending--;
+        }
+    }
+}
 
 /**
  * Destroys an RTP source and its associated streams.
@@ -191,10 +253,15 @@ rtp_source_destroy (demux_t *demux, const rtp_session_t *session,
                     rtp_source_t *source)
 {
     msg_Dbg (demux, "removing RTP source (%08x)", source->ssrc);
+    msg_Dbg (demux, "%"PRIu64" packet(s) received, %"PRIu64" lost, "
+             "%"PRIu64" late, %"PRIu64" duplicate(s), "
+             "%"PRIu64" recovered by FEC, %"PRIu64" retransmitted",
+             source->stats.received, source->stats.lost, source->stats.late,
+             source->stats.duplicates, source->stats.fec, source->stats.rtx);
 
     for (unsigned i = 0; i < session->ptc; i++)
         session->ptv[i].destroy (demux, source->opaque[i]);
-    block_ChainRelease (source->blocks);
+    rtp_source_flush (source);
     free (source);
 }
 
@@ -210,6 +277,25 @@ static inline uint32_t rtp_timestamp (const block_t *block)
     return GetDWBE (block->p_buffer + 4);
 }
 
+static inline block_t **rtp_slot (rtp_source_t *source, uint16_t seq)
+{
+    return &source->ring[seq & (RTP_RING_SIZE - 1)];
+}
+
+/**
+ * Removes the block of the given sequence from the re-ordering window.
+ */
+static block_t *rtp_pop (rtp_source_t *source, uint16_t seq)
+{
+    block_t **slot = rtp_slot (source, seq);
+    block_t *block = *slot;
+
+    assert (block != NULL && source->pending > 0);
+    *slot = NULL;
+    source->pending--;
+    return block;
+}
+
 static const struct rtp_pt_t *
 rtp_find_ptype (const rtp_session_t *session, rtp_source_t *source,
                 const block_t *block, void **pt_data)
@@ -228,85 +314,87 @@ rtp_find_ptype (const rtp_session_t *session, rtp_source_t *source,
     return NULL;
 }
 
+/** Origin of a queued packet */
+enum rtp_origin
+{
+    RTP_RECEIVED,
+    RTP_RETRANSMITTED, /**< RFC 4588 retransmission */
+    RTP_RECOVERED, /**< rebuilt from FEC packets */
+};
+
 /**
- * Receives an RTP packet and queues it. Not a cancellation point.
- *
- * @param demux VLC demux object
- * @param session RTP session receiving the packet
- * @param block RTP packet including the RTP header
+ * Computes the size of the RTP header, including CSRCs and extension.
+ * @return the header size, or 0 if the packet is too short.
  */
-void
-rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
+static size_t rtp_header_size (const block_t *block)
 {
-    demux_sys_t *p_sys = demux->p_sys;
-
-    /* RTP header sanity checks (see RFC 3550) */
-    if (block->i_buffer < 12)
-        goto drop;
-    if ((block->p_buffer[0] >> 6 ) != 2) /* RTP version number */
-        goto drop;
+    /* CSRC count */
+    size_t skip = 12u + (block->p_buffer[0] & 0x0F) * 4;
 
-    /* Remove padding if present */
-    if (block->p_buffer[0] & 0x20)
+    /* Extension header (ignored for now) */
+    if (block->p_buffer[0] & 0x10)
     {
-        uint8_t padding = block->p_buffer[block->i_buffer - 1];
-        if ((padding == 0) || (block->i_buffer < (12u + padding)))
-            goto drop; /* illegal value */
+        skip += 4;
+        if (block->i_buffer < skip)
+            return 0;
 
-        block->i_buffer -= padding;
+        skip += 4 * GetWBE (block->p_buffer + skip - 2);
     }
 
-    vlc_tick_t     now = vlc_tick_now ();
-    rtp_source_t  *src  = NULL;
-    const uint16_t seq  = rtp_seq (block);
-    const uint32_t ssrc = GetDWBE (block->p_buffer + 8);
-
-    /* In most case, we know this source already */
-    for (unsigned i = 0, max = session->srcc; i < max; i++)
-    {
-        rtp_source_t *tmp = session->srcv[i];
-        if (tmp->ssrc == ssrc)
-        {
-            src = tmp;
-            break;
-        }
+    if (block->i_buffer < skip)
+        return 0;
+    return skip;
+}
 
-        /* RTP source garbage collection */
-        if ((tmp->last_rx + p_sys->timeout) < now)
-        {
-            rtp_source_destroy (demux, session, tmp);
-            if (--session->srcc > 0)
-                session->srcv[i] = session->srcv[session->srcc - 1];
-        }
-    }
+/**
+ * Sends a generic negative acknowledgement (RFC 4585 section 6.2.1)
+ * for count packets starting from sequence first.
+ */
+static void rtp_nack (demux_t *demux, const rtp_session_t *session,
+                      rtp_source_t *src, uint16_t first, unsigned count)
+{
+    uint8_t buf[12 + 4 * 16];
+    size_t len = 12;
 
-    if (src == NULL)
+    /* Each FCI entry covers a packet and a bit mask of the 16 next ones */
+    while (count > 0)
     {
-        /* New source */
-        if (session->srcc >= p_sys->max_src)
-        {
-            msg_Warn (demux, "too many RTP sessions");
-            goto drop;
-        }
+        unsigned n = (count > 17) ? 17 : count;
+        uint16_t blp = (1u << (n - 1)) - 1;
+
+        assert (len < sizeof (buf));
+        SetWBE (buf + len, first);
+        SetWBE (buf + len + 2, blp);
+        len += 4;
+        first += n;
+        count -= n;
+    }
 
-        rtp_source_t **tab;
-        tab = realloc (session->srcv, (session->srcc + 1) * sizeof (*tab));
-        if (tab == NULL)
-            goto drop;
-        session->srcv = tab;
+    buf[0] = 0x81; /* V = 2, FMT = 1 (Generic NACK) */
+    buf[1] = 205; /* RTPFB */
+    SetWBE (buf + 2, (len / 4) - 1);
+    SetDWBE (buf + 4, session->ssrc);
+    SetDWBE (buf + 8, src->ssrc);
+    rtcp_send (demux, buf, len);
+    src->nack_time = vlc_tick_now ();
+}
 
-        src = rtp_source_create (demux, session, ssrc, seq);
-        if (src == NULL)
-            goto drop;
+/**
+ * Queues a packet of an existing source in its re-ordering window.
+ */
+static void
+rtp_source_queue (demux_t *demux, const rtp_session_t *session,
+                  rtp_source_t *src, block_t *block, enum rtp_origin origin)
+{
+    demux_sys_t *p_sys = demux->p_sys;
+    const uint16_t seq = rtp_seq (block);
+    vlc_tick_t now = vlc_tick_now ();
 
-        tab[session->srcc++] = src;
-        /* Cannot compute jitter yet */
-    }
-    else
+    if (origin == RTP_RECEIVED)
     {
         const rtp_pt_t *pt = rtp_find_ptype (session, src, block, NULL);
 
-        if (pt != NULL)
+        if (pt != NULL && src->last_rx != VLC_TICK_INVALID)
         {
             /* Recompute jitter estimate.
              * That is computed from the RTP timestamps and the system clock.
@@ -318,15 +406,34 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
             if (d < 0) d = -d;
             src->jitter += ((d - src->jitter) + 8) >> 4;
         }
+        src->last_rx = now;
+        src->last_ts = rtp_timestamp (block);
+        src->last_pt = rtp_ptype (block);
+    }
+    else
+    if (origin == RTP_RETRANSMITTED && src->nack_time != VLC_TICK_INVALID)
+    {
+        vlc_tick_t delay = now - src->nack_time;
+
+        if (src->rtx_delay == 0)
+            src->rtx_delay = delay;
+        else
+            src->rtx_delay += (delay - src->rtx_delay) / 8;
     }
-    src->last_rx = now;
     block->i_pts = now; /* store reception time until dequeued */
-    src->last_ts = rtp_timestamp (block);
 
     /* Check sequence number */
     /* NOTE: the sequence number is per-source,
      * but is independent from the payload type. */
     int16_t delta_seq = seq - src->max_seq;
+    if (origin != RTP_RECEIVED)
+    {   /* Recovered packets fill holes, however old, but never resync */
+        if (delta_seq > p_sys->max_dropout)
+            goto drop;
+        if (delta_seq >= 0)
+            src->max_seq = seq + 1;
+    }
+    else
     if ((delta_seq > 0) ? (delta_seq > p_sys->max_dropout)
                         : (-delta_seq > p_sys->max_misorder))
     {
@@ -335,10 +442,11 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         if (seq == src->bad_seq)
         {
             src->max_seq = src->bad_seq = seq + 1;
-            src->last_seq = seq - 0x7fffe; /* hack for rtp_decode() */
             msg_Warn (demux, "sequence resynchronized");
-            block_ChainRelease (src->blocks);
-            src->blocks = NULL;
+            rtp_source_flush (src);
+            src->last_seq = seq - 1;
+            src->next_seq = seq;
+            src->discontinuity = true;
         }
         else
         {
@@ -348,35 +456,285 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
     }
     else
     if (delta_seq >= 0)
+    {
+        /* Request the missing packets for retransmission right away */
+        if (delta_seq > 0 && origin == RTP_RECEIVED && p_sys->rtx_pt != 0
+         && delta_seq <= 16 * 17)
+            rtp_nack (demux, session, src, src->max_seq, delta_seq);
         src->max_seq = seq + 1;
+    }
 
     /* Queues the block in sequence order,
      * hence there is a single queue for all payload types. */
-    block_t **pp = &src->blocks;
-    for (block_t *prev = *pp; prev != NULL; prev = *pp)
+    uint16_t offset = seq - src->next_seq;
+    if (offset >= 0x8000)
+    {   /* Trash too late packets (and PIM Assert duplicates) */
+        if (origin == RTP_RECEIVED)
+        {
+            msg_Dbg (demux, "ignoring late packet (sequence: %"PRIu16")",
+                     seq);
+            src->stats.late++;
+        }
+        else /* merely re-ordered packet retransmitted or recovered */
+            src->stats.duplicates++;
+        goto drop;
+    }
+
+    if (offset >= RTP_RING_SIZE)
+    {   /* Make room by giving up on the oldest missing packets */
+        const uint16_t head = seq - (RTP_RING_SIZE - 1);
+
+        while (src->pending > 0 && src->next_seq != head)
+        {
+            if (*rtp_slot (src, src->next_seq) != NULL)
+                rtp_decode (demux, session, src,
+                            rtp_pop (src, src->next_seq));
+            else
+                src->next_seq++;
+        }
+        src->next_seq = head;
+    }
+
+    block_t **slot = rtp_slot (src, seq);
+    if (*slot != NULL)
+    {
+        msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
+        src->stats.duplicates++;
+        goto drop; /* duplicate */
+    }
+    *slot = block;
+    src->pending++;
+    src->stats.received++;
+    if (origin == RTP_RETRANSMITTED)
+        src->stats.rtx++;
+    if (origin == RTP_RECOVERED)
+        src->stats.fec++;
+    return;
+
+drop:
+    block_Release (block);
+}
+
+/**
+ * Converts an RFC 4588 retransmission packet back to the original packet.
+ * @return the source of the original packet, or NULL if not found.
+ */
+static rtp_source_t *
+rtp_unwrap_rtx (rtp_session_t *session, block_t *block)
+{
+    const uint32_t ssrc = GetDWBE (block->p_buffer + 8);
+    rtp_source_t *src = NULL;
+
+    if (session->srcc == 0)
+        return NULL;
+
+    /* Session-multiplexed retransmissions keep the original SSRC.
+     * Otherwise, assume they belong to the main source. */
+    for (unsigned i = 0; i < session->srcc; i++)
+        if (session->srcv[i]->ssrc == ssrc)
+            src = session->srcv[i];
+    if (src == NULL)
+        src = session->srcv[0];
+
+    size_t skip = rtp_header_size (block);
+    if (skip == 0 || block->i_buffer < skip + 2)
+        return NULL;
+
+    /* Strip the original sequence number out of the payload */
+    const uint16_t osn = GetWBE (block->p_buffer + skip);
+    memmove (block->p_buffer + 2, block->p_buffer, skip);
+    block->p_buffer += 2;
+    block->i_buffer -= 2;
+
+    SetWBE (block->p_buffer + 2, osn);
+    block->p_buffer[1] = (block->p_buffer[1] & 0x80) | src->last_pt;
+    SetDWBE (block->p_buffer + 8, src->ssrc);
+    return src;
+}
+
+static void
+rtp_queue_origin (demux_t *demux, rtp_session_t *session, block_t *block,
+                  enum rtp_origin origin)
+{
+    demux_sys_t *p_sys = demux->p_sys;
+
+    /* RTP header sanity checks (see RFC 3550) */
+    if (block->i_buffer < 12)
+        goto drop;
+    if ((block->p_buffer[0] >> 6 ) != 2) /* RTP version number */
+        goto drop;
+
+    if (p_sys->rtx_pt != 0 && rtp_ptype (block) == p_sys->rtx_pt)
+        origin = RTP_RETRANSMITTED;
+
+    /* FEC protects the packets as sent, including padding */
+    if (session->fec != NULL && origin != RTP_RETRANSMITTED)
+        rtp_fec_media (session->fec, block);
+
+    /* Remove padding if present */
+    if (block->p_buffer[0] & 0x20)
     {
-        delta_seq = seq - rtp_seq (prev);
-        if (delta_seq < 0)
+        uint8_t padding = block->p_buffer[block->i_buffer - 1];
+        if ((padding == 0) || (block->i_buffer < (12u + padding)))
+            goto drop; /* illegal value */
+
+        block->i_buffer -= padding;
+    }
+
+    rtp_source_t *src = NULL;
+
+    if (origin == RTP_RETRANSMITTED)
+    {
+        src = rtp_unwrap_rtx (session, block);
+        if (src == NULL)
+            goto drop;
+        rtp_source_queue (demux, session, src, block, origin);
+        return;
+    }
+
+    const uint32_t ssrc = GetDWBE (block->p_buffer + 8);
+    unsigned i;
+
+    /* In most case, we know this source already.
+     * Keep the most recently active source first to find it right away. */
+    for (i = 0; i < session->srcc; i++)
+        if (session->srcv[i]->ssrc == ssrc)
             break;
-        if (delta_seq == 0)
+
+    if (i < session->srcc)
+    {
+        src = session->srcv[i];
+        session->srcv[i] = session->srcv[0];
+        session->srcv[0] = src;
+    }
+    else
+    {
+        vlc_tick_t now = vlc_tick_now ();
+
+        /* RTP source garbage collection */
+        for (i = 0; i < session->srcc;)
         {
-            msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
-            goto drop; /* duplicate */
+            rtp_source_t *tmp = session->srcv[i];
+
+            if ((tmp->last_rx + p_sys->timeout) < now)
+            {
+                rtp_source_destroy (demux, session, tmp);
+                session->srcv[i] = session->srcv[--session->srcc];
+            }
+            else
+                i++;
+        }
+
+        /* New source */
+        if (session->srcc >= p_sys->max_src)
+        {
+            msg_Warn (demux, "too many RTP sessions");
+            goto drop;
         }
-        pp = &prev->p_next;
+
+        rtp_source_t **tab;
+        tab = realloc (session->srcv, (session->srcc + 1) * sizeof (*tab));
+        if (tab == NULL)
+            goto drop;
+        session->srcv = tab;
+
+        src = rtp_source_create (demux, session, ssrc, rtp_seq (block));
+        if (src == NULL)
+            goto drop;
+
+        tab[session->srcc++] = src;
+        /* Cannot compute jitter yet */
     }
-    block->p_next = *pp;
-    *pp = block;
 
-    /*rtp_decode (demux, session, src);*/
+    rtp_source_queue (demux, session, src, block, origin);
     return;
 
 drop:
     block_Release (block);
 }
 
+/**
+ * Receives an RTP packet and queues it. Not a cancellation point.
+ *
+ * @param demux VLC demux object
+ * @param session RTP session receiving the packet
+ * @param block RTP packet including the RTP header
+ */
+void
+rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
+{
+    rtp_queue_origin (demux, session, block, RTP_RECEIVED);
+}
+
+/**
+ * Receives an SMPTE 2022-1 FEC packet, and queues the media packet it
+ * recovers, if any. Not a cancellation point.
+ *
+ * @param demux VLC demux object
+ * @param session RTP session receiving the packet
+ * @param block FEC packet including the RTP header
+ */
+void
+rtp_queue_fec (demux_t *demux, rtp_session_t *session, block_t *block)
+{
+    if (session->fec == NULL)
+    {
+        block_Release (block);
+        return;
+    }
 
-static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
+    block = rtp_fec_input (session->fec, block);
+    if (block != NULL)
+        rtp_queue_origin (demux, session, block, RTP_RECOVERED);
+}
+
+/**
+ * Tries to recover the packets missing before a given sequence with the FEC
+ * packets received so far.
+ * @return true if at least one packet was recovered.
+ */
+static bool rtp_recover (demux_t *demux, const rtp_session_t *session,
+                         rtp_source_t *src, uint16_t seq)
+{
+    bool recovered = false;
+
+    for (uint16_t missing = src->next_seq; missing != seq; missing++)
+    {
+        block_t *block = rtp_fec_recover (session->fec, missing);
+        if (block == NULL)
+            continue;
+
+        /* Remove padding if present */
+        if (block->p_buffer[0] & 0x20)
+        {
+            uint8_t padding = block->p_buffer[block->i_buffer - 1];
+            if ((padding == 0) || (block->i_buffer < (12u + padding)))
+            {
+                block_Release (block);
+                continue;
+            }
+            block->i_buffer -= padding;
+        }
+
+        if (GetDWBE (block->p_buffer + 8) != src->ssrc)
+        {
+            block_Release (block);
+            continue;
+        }
+
+        rtp_fec_media (session->fec, block);
+        rtp_source_queue (demux, session, src, block, RTP_RECOVERED);
+
+        /* Do not wait any longer than for the next received packet */
+        block = *rtp_slot (src, missing);
+        if (block != NULL)
+        {
+            block->i_pts = (*rtp_slot (src, seq))->i_pts;
+            recovered = true;
+        }
+    }
+    return recovered;
+}
 
 /**
  * Dequeues RTP packets and pass them to decoder. Not cancellation-safe(?).
@@ -390,9 +748,10 @@ static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
  * @return true if the buffer is not empty, false otherwise.
  * In the later case, *deadlinep is undefined.
  */
-bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
+bool rtp_dequeue (demux_t *demux, rtp_session_t *session,
                   vlc_tick_t *restrict deadlinep)
 {
+    demux_sys_t *p_sys = demux->p_sys;
     vlc_tick_t now = vlc_tick_now ();
     bool pending = false;
 
@@ -401,7 +760,6 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
     for (unsigned i = 0, max = session->srcc; i < max; i++)
     {
         rtp_source_t *src = session->srcv[i];
-        block_t *block;
 
         /* Because of IP packet delay variation (IPDV), we need to guesstimate
          * how long to wait for a missing packet in the RTP sequence
@@ -419,14 +777,23 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
          * LibVLC E/S-out clock synchronization. Here, we need to bother about
          * re-ordering packets, as decoders can't cope with mis-ordered data.
          */
-        while (((block = src->blocks)) != NULL)
+        while (src->pending > 0)
         {
-            if ((int16_t)(rtp_seq (block) - (src->last_seq + 1)) <= 0)
-            {   /* Next (or earlier) block ready, no need to wait */
-                rtp_decode (demux, session, src);
+            if (*rtp_slot (src, src->next_seq) != NULL)
+            {   /* Next block ready, no need to wait */
+                rtp_decode (demux, session, src,
+                            rtp_pop (src, src->next_seq));
                 continue;
             }
 
+            /* Find the first non-missing packet */
+            uint16_t seq = src->next_seq;
+            do
+                seq++;
+            while (*rtp_slot (src, seq) == NULL);
+
+            block_t *block = *rtp_slot (src, seq);
+
             /* Wait for 3 times the inter-arrival delay variance (about 99.7%
              * match for random gaussian jitter).
              */
@@ -441,6 +808,20 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
             if (deadline < VLC_TICK_FROM_MS(25))
                 deadline = VLC_TICK_FROM_MS(25);
 
+            /* Leave time for FEC or retransmissions to recover the missing
+             * packets. Retransmissions should take about a round trip;
+             * FEC packets come after their whole matrix was sent. */
+            if (session->fec != NULL || p_sys->rtx_pt != 0)
+            {
+                vlc_tick_t recovery = p_sys->recovery_delay;
+
+                if (session->fec == NULL && src->rtx_delay > 0
+                 && 2 * src->rtx_delay < recovery)
+                    recovery = 2 * src->rtx_delay;
+                if (deadline < recovery)
+                    deadline = recovery;
+            }
+
             /* Additionnaly, we implicitly wait for the packetization time
              * multiplied by the number of missing packets. block is the first
              * non-missing packet (lowest sequence number). We have no better
@@ -449,7 +830,11 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
             deadline += block->i_pts;
             if (now >= deadline)
             {
-                rtp_decode (demux, session, src);
+                if (session->fec != NULL
+                 && rtp_recover (demux, session, src, seq))
+                    continue;
+
+                rtp_decode (demux, session, src, rtp_pop (src, seq));
                 continue;
             }
             if (*deadlinep > deadline)
@@ -465,15 +850,20 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
  * Dequeues all RTP packets and pass them to decoder. Not cancellation-safe(?).
  * This function can be used when the packet source is known not to reorder.
  */
-void rtp_dequeue_force (demux_t *demux, const rtp_session_t *session)
+void rtp_dequeue_force (demux_t *demux, rtp_session_t *session)
 {
     for (unsigned i = 0, max = session->srcc; i < max; i++)
     {
         rtp_source_t *src = session->srcv[i];
-        block_t *block;
 
-        while (((block = src->blocks)) != NULL)
-            rtp_decode (demux, session, src);
+        while (src->pending > 0)
+        {
+            uint16_t seq = src->next_seq;
+
+            while (*rtp_slot (src, seq) == NULL)
+                seq++;
+            rtp_decode (demux, session, src, rtp_pop (src, seq));
+        }
     }
 }
 
@@ -481,28 +871,26 @@ void rtp_dequeue_force (demux_t *demux, const rtp_session_t *session)
  * Decodes one RTP packet.
  */
 static void
-rtp_decode (demux_t *demux, const rtp_session_t *session, rtp_source_t *src)
+rtp_decode (demux_t *demux, const rtp_session_t *session, rtp_source_t *src,
+            block_t *block)
 {
-    block_t *block = src->blocks;
-
-    assert (block);
-    src->blocks = block->p_next;
-    block->p_next = NULL;
+    const uint16_t seq = rtp_seq (block);
 
     /* Discontinuity detection */
-    uint16_t delta_seq = rtp_seq (block) - (src->last_seq + 1);
+    uint16_t delta_seq = seq - (src->last_seq + 1);
     if (delta_seq != 0)
     {
-        if (delta_seq >= 0x8000)
-        {   /* Trash too late packets (and PIM Assert duplicates) */
-            msg_Dbg (demux, "ignoring late packet (sequence: %"PRIu16")",
-                      rtp_seq (block));
-            goto drop;
-        }
         msg_Warn (demux, "%"PRIu16" packet(s) lost", delta_seq);
+        src->stats.lost += delta_seq;
+        src->discontinuity = true;
+    }
+    if (src->discontinuity)
+    {
         block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+        src->discontinuity = false;
     }
-    src->last_seq = rtp_seq (block);
+    src->last_seq = seq;
+    src->next_seq = seq + 1;
 
     /* Match the payload type */
     void *pt_data;
@@ -528,20 +916,8 @@ rtp_decode (demux_t *demux, const rtp_session_t *session, rtp_source_t *src)
     src->ref_ntp = block->i_pts;
     src->ref_rtp = timestamp;
 
-    /* CSRC count */
-    size_t skip = 12u + (block->p_buffer[0] & 0x0F) * 4;
-
-    /* Extension header (ignored for now) */
-    if (block->p_buffer[0] & 0x10)
-    {
-        skip += 4;
-        if (block->i_buffer < skip)
-            goto drop;
-
-        skip += 4 * GetWBE (block->p_buffer + skip - 2);
-    }
-
-    if (block->i_buffer < skip)
+    size_t skip = rtp_header_size (block);
+    if (skip == 0)
         goto drop;
 
     block->p_buffer += skip;
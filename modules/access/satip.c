@@ -53,6 +53,8 @@
 #define VLEN 100
 #define KEEPALIVE_INTERVAL 60
 #define KEEPALIVE_MARGIN 5
+/* Most servers cannot filter more PIDs than this; beyond, ask for all */
+#define SATIP_MAX_PIDS 32
 
 static int satip_open(vlc_object_t *);
 static void satip_close(vlc_object_t *);
@@ -116,6 +118,10 @@ typedef struct
     uint16_t last_seq_nr;
 
     bool woken;
+
+    vlc_mutex_t pid_lock;
+    uint32_t pid_filter[0x2000 / 32];
+    bool pid_filter_changed;
 } access_sys_t;
 
 VLC_FORMAT(3, 4)
@@ -437,6 +443,47 @@ static void satip_teardown(void *data) {
     }
 }
 
+/* Reprograms the server PID filter after the demuxer changed its selection.
+ * This must only be called from the worker thread, which owns the RTSP
+ * connection once the session is playing. */
+static void satip_update_pids(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+    uint32_t filter[ARRAY_SIZE(sys->pid_filter)];
+    char pids[SATIP_MAX_PIDS * 5 + 1] = "none";
+    size_t len = 0;
+    unsigned count = 0;
+
+    vlc_mutex_lock(&sys->pid_lock);
+    if (!sys->pid_filter_changed) {
+        vlc_mutex_unlock(&sys->pid_lock);
+        return;
+    }
+    memcpy(filter, sys->pid_filter, sizeof (filter));
+    sys->pid_filter_changed = false;
+    vlc_mutex_unlock(&sys->pid_lock);
+
+    for (unsigned pid = 0; pid < 0x2000; pid++) {
+        if (!(filter[pid / 32] & (UINT32_C(1) << (pid % 32))))
+            continue;
+
+        if (++count > SATIP_MAX_PIDS) {
+            strcpy(pids, "all");
+            break;
+        }
+        len += sprintf(pids + len, "%s%u", len ? "," : "", pid);
+    }
+
+    msg_Dbg(access, "setting PID filter to %s", pids);
+    net_Printf(access, sys->tcp_sock,
+            "PLAY %s?pids=%s RTSP/1.0\r\n"
+            "CSeq: %d\r\n"
+            "Session: %s\r\n\r\n",
+            sys->control, pids, sys->cseq++, sys->session_id);
+    if (rtsp_handle(access, NULL) != RTSP_RESULT_OK)
+        msg_Warn(access, "Failed to update PID filter");
+}
+
 #define RECV_TIMEOUT VLC_TICK_FROM_SEC(2)
 static void *satip_thread(void *data) {
     stream_t *access = data;
@@ -538,6 +585,8 @@ static void *satip_thread(void *data) {
 
             next_keepalive = vlc_tick_now() + vlc_tick_from_sec(sys->keepalive_interval);
         }
+
+        satip_update_pids(access);
     }
 
 #ifdef HAVE_RECVMMSG
@@ -573,6 +622,7 @@ static block_t* satip_block(stream_t *access, bool *restrict eof) {
 }
 
 static int satip_control(stream_t *access, int i_query, va_list args) {
+    access_sys_t *sys = access->p_sys;
     bool *pb_bool;
 
     switch(i_query)
@@ -589,6 +639,39 @@ static int satip_control(stream_t *access, int i_query, va_list args) {
                 VLC_TICK_FROM_MS(var_InheritInteger(access, "live-caching"));
             break;
 
+        case STREAM_SET_PRIVATE_ID_STATE:
+        {
+            unsigned pid = va_arg(args, int);
+            bool add = va_arg(args, int);
+            uint32_t mask = UINT32_C(1) << (pid % 32);
+
+            if (unlikely(pid > 0x1FFF))
+                return VLC_EGENERIC;
+
+            /* The RTSP connection belongs to the worker thread: only record
+             * the new filter here, the thread sends it to the server. */
+            vlc_mutex_lock(&sys->pid_lock);
+            if (add)
+                sys->pid_filter[pid / 32] |= mask;
+            else
+                sys->pid_filter[pid / 32] &= ~mask;
+            sys->pid_filter_changed = true;
+            vlc_mutex_unlock(&sys->pid_lock);
+            break;
+        }
+
+        case STREAM_GET_PRIVATE_ID_STATE:
+        {
+            unsigned pid = va_arg(args, int);
+            bool *on = va_arg(args, bool *);
+
+            vlc_mutex_lock(&sys->pid_lock);
+            *on = likely(pid <= 0x1FFF)
+               && (sys->pid_filter[pid / 32] & (UINT32_C(1) << (pid % 32)));
+            vlc_mutex_unlock(&sys->pid_lock);
+            break;
+        }
+
         default:
             return VLC_EGENERIC;
 
@@ -653,6 +736,7 @@ static int satip_open(vlc_object_t *obj)
     sys->udp_sock = -1;
     sys->rtcp_sock = -1;
     sys->tcp_sock = -1;
+    vlc_mutex_init(&sys->pid_lock);
 
     /* convert url to lowercase, some famous m3u playlists for satip contain
      * uppercase parameters while most (all?) satip servers do only understand
@@ -662,6 +746,7 @@ static int satip_open(vlc_object_t *obj)
     if (psz_lower_url == NULL)
     {
         free( psz_host );
+        vlc_mutex_destroy(&sys->pid_lock);
         return VLC_ENOMEM;
     }
 
@@ -823,6 +908,7 @@ error:
 
     free(sys->content_base);
     free(sys->control);
+    vlc_mutex_destroy(&sys->pid_lock);
     return VLC_EGENERIC;
 }
 
@@ -842,4 +928,5 @@ static void satip_close(vlc_object_t *obj)
     net_Close(sys->tcp_sock);
     free(sys->content_base);
     free(sys->control);
+    vlc_mutex_destroy(&sys->pid_lock);
 }
@@ -28,6 +28,9 @@
 #include <errno.h>
 #include <xcb/xcb.h>
 #include <xcb/composite.h>
+#ifdef HAVE_XCB_DAMAGE
+# include <xcb/damage.h>
+#endif
 #ifdef HAVE_SYS_SHM_H
 # include <sys/shm.h>
 # include <xcb/shm.h>
@@ -60,6 +63,11 @@
 #define FOLLOW_MOUSE_LONGTEXT N_( \
     "Follow the mouse when capturing a subscreen." )
 
+#define DAMAGE_TEXT N_("Skip unchanged frames")
+#define DAMAGE_LONGTEXT N_( \
+    "Only capture the screen when the X server reports changes within " \
+    "the capture region (requires the X Damage extension).")
+
 static int  Open (vlc_object_t *);
 static void Close (vlc_object_t *);
 
@@ -89,6 +97,7 @@ vlc_module_begin ()
         change_safe ()
     add_bool ("screen-follow-mouse", false, FOLLOW_MOUSE_TEXT,
               FOLLOW_MOUSE_LONGTEXT, true)
+    add_bool ("screen-damage", true, DAMAGE_TEXT, DAMAGE_LONGTEXT, true)
 
     add_shortcut ("screen", "window")
 vlc_module_end ()
@@ -116,6 +125,12 @@ typedef struct
     bool              shm; /**< Whether to use MIT-SHM */
     bool              follow_mouse;
     uint16_t          cur_w, cur_h; /**< Actual capture pixel dimensions */
+#ifdef HAVE_XCB_DAMAGE
+    xcb_damage_damage_t damage; /**< Damage object XID, or 0 if unused */
+    uint8_t           damage_event; /**< Damage extension first event */
+    int16_t           dmg_x, dmg_y; /**< Damaged area top-left coordinates */
+    uint16_t          dmg_w, dmg_h; /**< Damaged area dimensions (0 = none) */
+#endif
     /* Timer does not use this, only input thread: */
     vlc_timer_t       timer;
 } demux_sys_t;
@@ -136,6 +151,83 @@ static bool CheckSHM (xcb_connection_t *conn)
 #endif
 }
 
+#ifdef HAVE_XCB_DAMAGE
+/** Starts tracking changes of the captured window with X Damage */
+static void InitDamage (vlc_object_t *obj, demux_sys_t *sys)
+{
+    xcb_connection_t *conn = sys->conn;
+    const xcb_query_extension_reply_t *ext =
+        xcb_get_extension_data (conn, &xcb_damage_id);
+
+    sys->damage = 0;
+    if (ext == NULL || !ext->present)
+        return;
+
+    xcb_damage_query_version_reply_t *r =
+        xcb_damage_query_version_reply (conn,
+            xcb_damage_query_version (conn, 1, 1), NULL);
+    if (r == NULL)
+        return;
+    msg_Dbg (obj, "using Damage extension v%"PRIu32".%"PRIu32,
+             r->major_version, r->minor_version);
+    free (r);
+
+    sys->damage = xcb_generate_id (conn);
+    sys->damage_event = ext->first_event;
+    xcb_damage_create (conn, sys->damage, sys->window,
+                       XCB_DAMAGE_REPORT_LEVEL_BOUNDING_BOX);
+    /* Capture the first frame unconditionally */
+    sys->dmg_x = sys->dmg_y = 0;
+    sys->dmg_w = sys->dmg_h = UINT16_MAX;
+}
+
+/** Accumulates the damaged area reported since the last capture */
+static void PollDamage (demux_sys_t *sys)
+{
+    xcb_generic_event_t *ev;
+
+    while ((ev = xcb_poll_for_event (sys->conn)) != NULL)
+    {
+        if ((ev->response_type & 0x7F)
+                                  == sys->damage_event + XCB_DAMAGE_NOTIFY)
+        {
+            const xcb_damage_notify_event_t *dn = (void *)ev;
+            const xcb_rectangle_t *a = &dn->area;
+
+            if (sys->dmg_w == 0 || sys->dmg_h == 0)
+            {
+                sys->dmg_x = a->x;
+                sys->dmg_y = a->y;
+                sys->dmg_w = a->width;
+                sys->dmg_h = a->height;
+            }
+            else
+            {
+                int x1 = __MIN(sys->dmg_x, a->x);
+                int y1 = __MIN(sys->dmg_y, a->y);
+                int x2 = __MAX(sys->dmg_x + sys->dmg_w, a->x + a->width);
+                int y2 = __MAX(sys->dmg_y + sys->dmg_h, a->y + a->height);
+
+                sys->dmg_x = x1;
+                sys->dmg_y = y1;
+                sys->dmg_w = __MIN(x2 - x1, UINT16_MAX);
+                sys->dmg_h = __MIN(y2 - y1, UINT16_MAX);
+            }
+        }
+        free (ev);
+    }
+}
+
+/** Checks whether the damaged area intersects the capture region */
+static bool IsDamaged (const demux_sys_t *sys, int x, int y,
+                       unsigned w, unsigned h)
+{
+    return sys->dmg_w > 0 && sys->dmg_h > 0
+        && sys->dmg_x < x + (int)w && x < sys->dmg_x + sys->dmg_w
+        && sys->dmg_y < y + (int)h && y < sys->dmg_y + sys->dmg_h;
+}
+#endif
+
 /**
  * Probes and initializes.
  */
@@ -216,6 +308,13 @@ static int Open (vlc_object_t *obj)
     else
         goto error;
 
+#ifdef HAVE_XCB_DAMAGE
+    if (var_InheritBool (obj, "screen-damage"))
+        InitDamage (obj, p_sys);
+    else
+        p_sys->damage = 0;
+#endif
+
     /* Window properties */
     p_sys->pixmap = xcb_generate_id (conn);
     p_sys->segment = xcb_generate_id (conn);
@@ -403,9 +502,20 @@ discard:
             h = max;
     }
 
+    bool changed = true;
+#ifdef HAVE_XCB_DAMAGE
+    if (sys->damage != 0)
+    {
+        PollDamage (sys);
+        changed = IsDamaged (sys, x, y, w, h);
+    }
+#endif
+
     /* Update elementary stream format (if needed) */
     if (w != sys->cur_w || h != sys->cur_h)
     {
+        changed = true;
+
         if (sys->es != NULL)
             es_out_Del (demux->out, sys->es);
 
@@ -427,6 +537,21 @@ discard:
         }
     }
 
+    if (!changed)
+    {   /* Nothing new to capture, but keep the clock running */
+        free (geo);
+        if (sys->es != NULL)
+            es_out_SetPCR (demux->out, vlc_tick_now ());
+        return;
+    }
+#ifdef HAVE_XCB_DAMAGE
+    if (sys->damage != 0)
+    {   /* Changes after this request will be reported anew */
+        xcb_damage_subtract (conn, sys->damage, XCB_NONE, XCB_NONE);
+        sys->dmg_w = sys->dmg_h = 0;
+    }
+#endif
+
     /* Capture screen */
     xcb_drawable_t drawable =
         (sys->window != geo->root) ? sys->pixmap : sys->window;
@@ -27,6 +27,7 @@
 #include <vlc_plugin.h>
 #include <vlc_access.h>
 #include <vlc_interrupt.h>
+#include <vlc_list.h>
 
 #include <vlc_network.h>
 #include <vlc_url.h>
@@ -42,6 +43,7 @@ typedef struct
     char       *psz_host;
     int         i_port;
     int         i_chunks; /* Number of chunks to allocate in the next read */
+    struct srt_feed *p_feed; /* listener mode only */
 } stream_sys_t;
 
 
@@ -89,53 +91,25 @@ static int Control(stream_t *p_stream, int i_query, va_list args)
     return i_ret;
 }
 
-static bool srt_schedule_reconnect(stream_t *p_stream)
+/**
+ * Applies the receiver settings, from the module options or the URL, to
+ * a new socket.
+ */
+static void srt_configure_socket(stream_t *p_stream, SRTSOCKET sock,
+                                 bool b_caller)
 {
     vlc_object_t *strm_obj = (vlc_object_t *) p_stream;
     int i_latency=var_InheritInteger( p_stream, SRT_PARAM_LATENCY );
     int i_payload_size = var_InheritInteger( p_stream, SRT_PARAM_PAYLOAD_SIZE );
-    int stat;
     char *psz_passphrase = var_InheritString( p_stream, SRT_PARAM_PASSPHRASE );
     bool passphrase_needs_free = true;
+    const char *psz_streamid = NULL;
     char *url = NULL;
     srt_params_t params;
-    struct addrinfo hints = {
-        .ai_socktype = SOCK_DGRAM,
-    }, *res = NULL;
-
-    stream_sys_t *p_sys = p_stream->p_sys;
-    bool failed = false;
-
-    stat = vlc_getaddrinfo( p_sys->psz_host, p_sys->i_port, &hints, &res );
-    if ( stat )
-    {
-        msg_Err( p_stream, "Cannot resolve [%s]:%d (reason: %s)",
-                 p_sys->psz_host,
-                 p_sys->i_port,
-                 gai_strerror( stat ) );
-
-        failed = true;
-        goto out;
-    }
-
-    /* Always start with a fresh socket */
-    if (p_sys->sock != SRT_INVALID_SOCK)
-    {
-        srt_epoll_remove_usock( p_sys->i_poll_id, p_sys->sock );
-        srt_close( p_sys->sock );
-    }
-
-    p_sys->sock = srt_socket( res->ai_family, SOCK_DGRAM, 0 );
-    if ( p_sys->sock == SRT_INVALID_SOCK )
-    {
-        msg_Err( p_stream, "Failed to open socket." );
-        failed = true;
-        goto out;
-    }
 
     if (p_stream->psz_url) {
         url = strdup( p_stream->psz_url );
-        if (srt_parse_url( url, &params )) {
+        if (url != NULL && srt_parse_url( url, &params )) {
             if (params.latency != -1)
                 i_latency = params.latency;
             if (params.payload_size != -1)
@@ -145,42 +119,92 @@ static bool srt_schedule_reconnect(stream_t *p_stream)
                 passphrase_needs_free = false;
                 psz_passphrase = (char *) params.passphrase;
             }
+            if (b_caller)
+                psz_streamid = params.streamid;
         }
     }
 
     /* Make SRT non-blocking */
-    srt_setsockopt( p_sys->sock, 0, SRTO_SNDSYN,
+    srt_setsockopt( sock, 0, SRTO_SNDSYN,
         &(bool) { false }, sizeof( bool ) );
-    srt_setsockopt( p_sys->sock, 0, SRTO_RCVSYN,
+    srt_setsockopt( sock, 0, SRTO_RCVSYN,
         &(bool) { false }, sizeof( bool ) );
 
     /* Make sure TSBPD mode is enable (SRT mode) */
-    srt_setsockopt( p_sys->sock, 0, SRTO_TSBPDMODE,
+    srt_setsockopt( sock, 0, SRTO_TSBPDMODE,
         &(int) { 1 }, sizeof( int ) );
 
     /* This is an access module so it is always a receiver */
-    srt_setsockopt( p_sys->sock, 0, SRTO_SENDER,
+    srt_setsockopt( sock, 0, SRTO_SENDER,
         &(int) { 0 }, sizeof( int ) );
 
     /* Set latency */
-    srt_set_socket_option( strm_obj, SRT_PARAM_LATENCY, p_sys->sock,
+    srt_set_socket_option( strm_obj, SRT_PARAM_LATENCY, sock,
             SRTO_TSBPDDELAY, &i_latency, sizeof(i_latency) );
 
     /* set passphrase */
     if (psz_passphrase != NULL && psz_passphrase[0] != '\0') {
         int i_key_length = var_InheritInteger( p_stream, SRT_PARAM_KEY_LENGTH );
 
-        srt_set_socket_option( strm_obj, SRT_PARAM_KEY_LENGTH, p_sys->sock,
+        srt_set_socket_option( strm_obj, SRT_PARAM_KEY_LENGTH, sock,
                 SRTO_PBKEYLEN, &i_key_length, sizeof(i_key_length) );
 
-        srt_set_socket_option( strm_obj, SRT_PARAM_PASSPHRASE, p_sys->sock,
+        srt_set_socket_option( strm_obj, SRT_PARAM_PASSPHRASE, sock,
                 SRTO_PASSPHRASE, psz_passphrase, strlen(psz_passphrase) );
     }
 
     /* set maximum payload size */
-    srt_set_socket_option( strm_obj, SRT_PARAM_PAYLOAD_SIZE, p_sys->sock,
+    srt_set_socket_option( strm_obj, SRT_PARAM_PAYLOAD_SIZE, sock,
             SRTO_PAYLOADSIZE, &i_payload_size, sizeof(i_payload_size) );
 
+    /* let the listener know which stream we want */
+    if (psz_streamid != NULL)
+        srt_set_socket_option( strm_obj, SRT_PARAM_STREAMID, sock,
+                SRTO_STREAMID, psz_streamid, strlen(psz_streamid) );
+
+    if (passphrase_needs_free)
+        free( psz_passphrase );
+    free( url );
+}
+
+static bool srt_schedule_reconnect(stream_t *p_stream)
+{
+    int stat;
+    struct addrinfo hints = {
+        .ai_socktype = SOCK_DGRAM,
+    }, *res = NULL;
+
+    stream_sys_t *p_sys = p_stream->p_sys;
+    bool failed = false;
+
+    stat = vlc_getaddrinfo( p_sys->psz_host, p_sys->i_port, &hints, &res );
+    if ( stat )
+    {
+        msg_Err( p_stream, "Cannot resolve [%s]:%d (reason: %s)",
+                 p_sys->psz_host,
+                 p_sys->i_port,
+                 gai_strerror( stat ) );
+
+        failed = true;
+        goto out;
+    }
+
+    /* Always start with a fresh socket */
+    if (p_sys->sock != SRT_INVALID_SOCK)
+    {
+        srt_epoll_remove_usock( p_sys->i_poll_id, p_sys->sock );
+        srt_close( p_sys->sock );
+    }
+
+    p_sys->sock = srt_socket( res->ai_family, SOCK_DGRAM, 0 );
+    if ( p_sys->sock == SRT_INVALID_SOCK )
+    {
+        msg_Err( p_stream, "Failed to open socket." );
+        failed = true;
+        goto out;
+    }
+
+    srt_configure_socket( p_stream, p_sys->sock, true );
 
     srt_epoll_add_usock( p_sys->i_poll_id, p_sys->sock,
         &(int) { SRT_EPOLL_ERR | SRT_EPOLL_IN });
@@ -209,10 +233,8 @@ out:
         p_sys->sock = SRT_INVALID_SOCK;
     }
 
-    if (passphrase_needs_free)
-        free( psz_passphrase );
-    freeaddrinfo( res );
-    free( url );
+    if (res != NULL)
+        freeaddrinfo( res );
 
     return !failed;
 }
@@ -222,6 +244,9 @@ static block_t *BlockSRT(stream_t *p_stream, bool *restrict eof)
     stream_sys_t *p_sys = p_stream->p_sys;
     int i_chunk_size = var_InheritInteger( p_stream, "chunk-size" );
     int i_poll_timeout = var_InheritInteger( p_stream, "poll-timeout" );
+    int i_batch_latency = var_InheritInteger( p_stream, SRT_PARAM_BATCH_LATENCY );
+    vlc_tick_t i_deadline = VLC_TICK_INVALID;
+    int i_wait = i_poll_timeout;
     /* SRT doesn't have a concept of EOF for live streams. */
     VLC_UNUSED(eof);
 
@@ -247,9 +272,10 @@ static block_t *BlockSRT(stream_t *p_stream, bool *restrict eof)
 
     SRTSOCKET ready[1];
     int readycnt = 1;
+    pkt->i_buffer = 0;
     while ( srt_epoll_wait( p_sys->i_poll_id,
         ready, &readycnt, 0, 0,
-        i_poll_timeout, NULL, 0, NULL, 0 ) >= 0)
+        i_wait, NULL, 0, NULL, 0 ) >= 0)
     {
         if ( readycnt < 0  || ready[0] != p_sys->sock )
         {
@@ -281,7 +307,6 @@ static block_t *BlockSRT(stream_t *p_stream, bool *restrict eof)
          * grow until it reads fast enough to keep the library empty after
          * each iteration.
          */
-        pkt->i_buffer = 0;
         while ( ( bufsize - pkt->i_buffer ) >= i_chunk_size_actual )
         {
             int stat = srt_recvmsg( p_sys->sock,
@@ -294,6 +319,25 @@ static block_t *BlockSRT(stream_t *p_stream, bool *restrict eof)
             pkt->i_buffer += (size_t)stat;
         }
 
+        /* Keep filling the same block until the batch latency has elapsed
+         * since the first message, so that the demuxer gets fewer and
+         * larger blocks at low bit rates too. */
+        if ( i_batch_latency > 0 && pkt->i_buffer > 0
+          && ( bufsize - pkt->i_buffer ) >= i_chunk_size_actual )
+        {
+            vlc_tick_t now = vlc_tick_now();
+
+            if ( i_deadline == VLC_TICK_INVALID )
+                i_deadline = now + VLC_TICK_FROM_MS( i_batch_latency );
+            if ( now < i_deadline )
+            {
+                i_wait = MS_FROM_VLC_TICK( i_deadline - now ) + 1;
+                if ( i_poll_timeout >= 0 && i_wait > i_poll_timeout )
+                    i_wait = i_poll_timeout;
+                continue;
+            }
+        }
+
         msg_Dbg ( p_stream, "Read %zu bytes out of a max of %zu"
             " (%d chunks of %zu bytes)", pkt->i_buffer,
             p_sys->i_chunks * i_chunk_size_actual, p_sys->i_chunks,
@@ -317,9 +361,9 @@ static block_t *BlockSRT(stream_t *p_stream, bool *restrict eof)
     }
 
     /* if the poll reports errors for any reason at all,
-     * including a timeout, we skip the turn.
+     * including a timeout, we skip the turn, and return whatever was
+     * batched so far.
      */
-    pkt->i_buffer = 0;
 
 out:
     if (pkt->i_buffer == 0) {
@@ -342,6 +386,421 @@ out:
     return pkt;
 }
 
+/*
+ * Listener mode
+ *
+ * All the inputs listening on the same port share a single SRT listener
+ * socket, and a single thread polling it and all the accepted callers. Each
+ * caller is handed to the input waiting for its stream ID, so that a single
+ * process can receive many feeds without a socket and epoll per feed.
+ */
+
+/* Maximum data received but not read yet by an input */
+#define SRT_FEED_MAX_QUEUE (4 << 20)
+/* Callers are read this many messages at a time */
+#define SRT_FEED_CHUNKS 32
+
+typedef struct srt_feed
+{
+    struct vlc_list node;
+    struct srt_listener *p_listener;
+    vlc_object_t *obj;
+    const char   *psz_streamid; /* empty to accept any caller */
+    SRTSOCKET     sock; /* current caller, if any */
+    block_t      *p_queue;
+    block_t     **pp_last;
+    size_t        i_queued;
+    vlc_cond_t    wait;
+    bool          b_interrupted;
+} srt_feed_t;
+
+typedef struct srt_listener
+{
+    struct vlc_list node;
+    char         *psz_host;
+    int           i_port;
+    unsigned      i_refs;
+    SRTSOCKET     sock;
+    int           i_poll_id;
+    bool          b_closing;
+    vlc_thread_t  thread;
+    struct vlc_list feeds;
+} srt_listener_t;
+
+/* Listeners and their feeds are protected by a single lock */
+static vlc_mutex_t listeners_lock = VLC_STATIC_MUTEX;
+static struct vlc_list listeners = VLC_LIST_INITIALIZER(&listeners);
+
+static void srt_feed_disconnect(srt_listener_t *p_lst, srt_feed_t *p_feed)
+{
+    srt_epoll_remove_usock( p_lst->i_poll_id, p_feed->sock );
+    srt_close( p_feed->sock );
+    p_feed->sock = SRT_INVALID_SOCK;
+}
+
+static void srt_listener_accept(srt_listener_t *p_lst)
+{
+    SRTSOCKET sock;
+
+    while ( (sock = srt_accept( p_lst->sock, NULL, NULL )) != SRT_INVALID_SOCK )
+    {
+        char psz_streamid[513];
+        int i_len = sizeof( psz_streamid ) - 1;
+
+        if ( srt_getsockflag( sock, SRTO_STREAMID, psz_streamid, &i_len ) )
+            i_len = 0;
+        psz_streamid[i_len] = '\0';
+
+        vlc_mutex_lock( &listeners_lock );
+
+        srt_feed_t *p_feed, *p_match = NULL;
+        vlc_list_foreach( p_feed, &p_lst->feeds, node )
+        {
+            if ( p_feed->sock != SRT_INVALID_SOCK )
+                continue;
+            if ( strcmp( p_feed->psz_streamid, psz_streamid ) == 0 )
+            {
+                p_match = p_feed;
+                break;
+            }
+            if ( p_feed->psz_streamid[0] == '\0' && p_match == NULL )
+                p_match = p_feed;
+        }
+
+        if ( p_match != NULL )
+        {
+            msg_Dbg( p_match->obj, "SRT caller connected (stream ID: %s)",
+                     psz_streamid );
+            p_match->sock = sock;
+            srt_epoll_add_usock( p_lst->i_poll_id, sock,
+                &(int) { SRT_EPOLL_ERR | SRT_EPOLL_IN } );
+        }
+        else
+        {
+            p_feed = vlc_list_first_entry_or_null( &p_lst->feeds,
+                                                   srt_feed_t, node );
+            if ( p_feed != NULL )
+                msg_Warn( p_feed->obj, "Rejecting SRT caller for unknown "
+                          "stream ID: %s", psz_streamid );
+            srt_close( sock );
+        }
+        vlc_mutex_unlock( &listeners_lock );
+    }
+}
+
+static void srt_listener_read(srt_listener_t *p_lst, SRTSOCKET sock)
+{
+    vlc_mutex_lock( &listeners_lock );
+
+    srt_feed_t *p_feed, *p_match = NULL;
+    vlc_list_foreach( p_feed, &p_lst->feeds, node )
+        if ( p_feed->sock == sock )
+        {
+            p_match = p_feed;
+            break;
+        }
+
+    if ( p_match == NULL )
+        goto out; /* the input was closed meanwhile */
+
+    bool b_more = true;
+    while ( b_more )
+    {
+        const size_t bufsize = SRT_FEED_CHUNKS * SRT_LIVE_MAX_PLSIZE;
+        block_t *pkt = block_Alloc( bufsize );
+        if ( unlikely( pkt == NULL ) )
+            break;
+
+        pkt->i_buffer = 0;
+        while ( ( bufsize - pkt->i_buffer ) >= SRT_LIVE_MAX_PLSIZE )
+        {
+            int stat = srt_recvmsg( sock,
+                (char *)( pkt->p_buffer + pkt->i_buffer ),
+                bufsize - pkt->i_buffer );
+            if ( stat <= 0 )
+            {
+                b_more = false;
+                break;
+            }
+            pkt->i_buffer += (size_t)stat;
+        }
+
+        if ( pkt->i_buffer == 0 )
+        {
+            block_Release( pkt );
+            break;
+        }
+
+        *p_match->pp_last = pkt;
+        p_match->pp_last = &pkt->p_next;
+        p_match->i_queued += pkt->i_buffer;
+    }
+
+    /* Drop the oldest data if the input does not keep up */
+    while ( p_match->i_queued > SRT_FEED_MAX_QUEUE )
+    {
+        block_t *pkt = p_match->p_queue;
+
+        p_match->p_queue = pkt->p_next;
+        p_match->i_queued -= pkt->i_buffer;
+        block_Release( pkt );
+    }
+    if ( p_match->p_queue == NULL )
+        p_match->pp_last = &p_match->p_queue;
+    else
+        vlc_cond_signal( &p_match->wait );
+
+    switch( srt_getsockstate( sock ) )
+    {
+        case SRTS_BROKEN:
+        case SRTS_NONEXIST:
+        case SRTS_CLOSED:
+            /* Wait for the caller to come back */
+            msg_Dbg( p_match->obj, "SRT caller disconnected" );
+            srt_feed_disconnect( p_lst, p_match );
+            break;
+        default:
+            break;
+    }
+out:
+    vlc_mutex_unlock( &listeners_lock );
+}
+
+static void *srt_listener_thread(void *data)
+{
+    srt_listener_t *p_lst = data;
+
+    for (;;)
+    {
+        SRTSOCKET ready[16];
+        int readycnt = ARRAY_SIZE( ready );
+
+        /* SRT epoll cannot be woken up, check for closing periodically */
+        int val = srt_epoll_wait( p_lst->i_poll_id, ready, &readycnt,
+                                  NULL, NULL, 100, NULL, NULL, NULL, NULL );
+
+        vlc_mutex_lock( &listeners_lock );
+        bool b_closing = p_lst->b_closing;
+        vlc_mutex_unlock( &listeners_lock );
+        if ( b_closing )
+            break;
+        if ( val < 0 )
+            continue;
+
+        if ( readycnt > (int) ARRAY_SIZE( ready ) )
+            readycnt = ARRAY_SIZE( ready );
+        for ( int i = 0; i < readycnt; i++ )
+        {
+            if ( ready[i] == p_lst->sock )
+                srt_listener_accept( p_lst );
+            else
+                srt_listener_read( p_lst, ready[i] );
+        }
+    }
+    return NULL;
+}
+
+static void srt_listener_destroy(srt_listener_t *p_lst)
+{
+    if ( p_lst->i_poll_id != -1 )
+        srt_epoll_release( p_lst->i_poll_id );
+    if ( p_lst->sock != SRT_INVALID_SOCK )
+        srt_close( p_lst->sock );
+    free( p_lst->psz_host );
+    free( p_lst );
+}
+
+static srt_listener_t *srt_listener_create(stream_t *p_stream,
+                                           const char *psz_host, int i_port)
+{
+    struct addrinfo hints = {
+        .ai_socktype = SOCK_DGRAM,
+        .ai_flags = AI_PASSIVE,
+    }, *res = NULL;
+
+    srt_listener_t *p_lst = malloc( sizeof( *p_lst ) );
+    if ( unlikely( p_lst == NULL ) )
+        return NULL;
+
+    p_lst->psz_host = strdup( psz_host );
+    p_lst->i_port = i_port;
+    p_lst->i_refs = 1;
+    p_lst->sock = SRT_INVALID_SOCK;
+    p_lst->i_poll_id = -1;
+    p_lst->b_closing = false;
+    vlc_list_init( &p_lst->feeds );
+    if ( unlikely( p_lst->psz_host == NULL ) )
+        goto error;
+
+    int stat = vlc_getaddrinfo( psz_host[0] ? psz_host : NULL, i_port,
+                                &hints, &res );
+    if ( stat )
+    {
+        msg_Err( p_stream, "Cannot resolve [%s]:%d (reason: %s)",
+                 psz_host, i_port, gai_strerror( stat ) );
+        goto error;
+    }
+
+    p_lst->sock = srt_socket( res->ai_family, SOCK_DGRAM, 0 );
+    if ( p_lst->sock == SRT_INVALID_SOCK )
+    {
+        msg_Err( p_stream, "Failed to open socket." );
+        goto error;
+    }
+
+    /* Accepted callers inherit the listener settings */
+    srt_configure_socket( p_stream, p_lst->sock, false );
+
+    if ( srt_bind( p_lst->sock, res->ai_addr, res->ai_addrlen ) == SRT_ERROR
+      || srt_listen( p_lst->sock, SRT_LISTEN_BACKLOG ) == SRT_ERROR )
+    {
+        msg_Err( p_stream, "Failed to listen on port %d (reason: %s)",
+                 i_port, srt_getlasterror_str() );
+        goto error;
+    }
+
+    p_lst->i_poll_id = srt_epoll_create();
+    if ( p_lst->i_poll_id == -1 )
+    {
+        msg_Err( p_stream, "Failed to create poll id for SRT socket." );
+        goto error;
+    }
+    srt_epoll_add_usock( p_lst->i_poll_id, p_lst->sock,
+        &(int) { SRT_EPOLL_ERR | SRT_EPOLL_IN } );
+
+    if ( vlc_clone( &p_lst->thread, srt_listener_thread, p_lst,
+                    VLC_THREAD_PRIORITY_INPUT ) )
+        goto error;
+
+    msg_Dbg( p_stream, "Listening for SRT callers on port %d", i_port );
+    freeaddrinfo( res );
+    return p_lst;
+
+error:
+    if ( res != NULL )
+        freeaddrinfo( res );
+    srt_listener_destroy( p_lst );
+    return NULL;
+}
+
+/**
+ * Registers a feed with the listener for the given address, creating the
+ * listener if this is the first feed on that address.
+ */
+static int srt_feed_register(stream_t *p_stream, srt_feed_t *p_feed,
+                             const char *psz_host, int i_port)
+{
+    srt_listener_t *p_lst;
+    int i_ret = VLC_SUCCESS;
+
+    vlc_mutex_lock( &listeners_lock );
+    vlc_list_foreach( p_lst, &listeners, node )
+        if ( p_lst->i_port == i_port && strcmp( p_lst->psz_host, psz_host ) == 0 )
+        {
+            p_lst->i_refs++;
+            goto found;
+        }
+
+    p_lst = srt_listener_create( p_stream, psz_host, i_port );
+    if ( p_lst == NULL )
+    {
+        i_ret = VLC_EGENERIC;
+        goto out;
+    }
+    vlc_list_append( &p_lst->node, &listeners );
+
+found:
+    p_feed->p_listener = p_lst;
+    vlc_list_append( &p_feed->node, &p_lst->feeds );
+    msg_Dbg( p_stream, "Waiting for SRT caller (stream ID: %s)",
+             p_feed->psz_streamid );
+out:
+    vlc_mutex_unlock( &listeners_lock );
+    return i_ret;
+}
+
+static void srt_feed_unregister(srt_feed_t *p_feed)
+{
+    vlc_mutex_lock( &listeners_lock );
+
+    srt_listener_t *p_lst = p_feed->p_listener;
+
+    if ( p_feed->sock != SRT_INVALID_SOCK )
+        srt_feed_disconnect( p_lst, p_feed );
+    vlc_list_remove( &p_feed->node );
+    block_ChainRelease( p_feed->p_queue );
+
+    bool b_last = --p_lst->i_refs == 0;
+    if ( b_last )
+    {
+        vlc_list_remove( &p_lst->node );
+        p_lst->b_closing = true;
+    }
+    vlc_mutex_unlock( &listeners_lock );
+
+    if ( b_last )
+    {
+        vlc_join( p_lst->thread, NULL );
+        srt_listener_destroy( p_lst );
+    }
+}
+
+static void srt_feed_interrupted(void *p_data)
+{
+    srt_feed_t *p_feed = p_data;
+
+    vlc_mutex_lock( &listeners_lock );
+    p_feed->b_interrupted = true;
+    vlc_cond_signal( &p_feed->wait );
+    vlc_mutex_unlock( &listeners_lock );
+}
+
+static block_t *BlockFeed(stream_t *p_stream, bool *restrict eof)
+{
+    stream_sys_t *p_sys = p_stream->p_sys;
+    srt_feed_t *p_feed = p_sys->p_feed;
+    int i_poll_timeout = var_InheritInteger( p_stream, "poll-timeout" );
+    vlc_tick_t deadline = VLC_TICK_INVALID;
+    block_t *pkt;
+    /* SRT doesn't have a concept of EOF for live streams. */
+    VLC_UNUSED(eof);
+
+    if ( vlc_killed() )
+    {
+        /* We are told to stop. Stop. */
+        return NULL;
+    }
+
+    if ( i_poll_timeout >= 0 )
+        deadline = vlc_tick_now() + VLC_TICK_FROM_MS( i_poll_timeout );
+
+    vlc_interrupt_register( srt_feed_interrupted, p_feed );
+    vlc_mutex_lock( &listeners_lock );
+    while ( p_feed->p_queue == NULL && !p_feed->b_interrupted )
+    {
+        if ( deadline == VLC_TICK_INVALID )
+            vlc_cond_wait( &p_feed->wait, &listeners_lock );
+        else if ( vlc_cond_timedwait( &p_feed->wait, &listeners_lock,
+                                      deadline ) )
+            break;
+    }
+    p_feed->b_interrupted = false;
+
+    pkt = p_feed->p_queue;
+    if ( pkt != NULL )
+    {
+        p_feed->p_queue = pkt->p_next;
+        if ( p_feed->p_queue == NULL )
+            p_feed->pp_last = &p_feed->p_queue;
+        p_feed->i_queued -= pkt->i_buffer;
+        pkt->p_next = NULL;
+    }
+    vlc_mutex_unlock( &listeners_lock );
+    vlc_interrupt_unregister();
+
+    return pkt;
+}
+
 static int Open(vlc_object_t *p_this)
 {
     stream_t     *p_stream = (stream_t*)p_this;
@@ -356,6 +815,8 @@ static int Open(vlc_object_t *p_this)
 
     vlc_mutex_init( &p_sys->lock );
 
+    p_sys->sock = SRT_INVALID_SOCK;
+    p_sys->i_poll_id = -1;
     p_stream->p_sys = p_sys;
 
     if ( vlc_UrlParse( &parsed_url, p_stream->psz_url ) == -1 )
@@ -370,6 +831,45 @@ static int Open(vlc_object_t *p_this)
 
     vlc_UrlClean( &parsed_url );
 
+    char *url = strdup( p_stream->psz_url );
+    if ( unlikely( url == NULL ) )
+        goto failed;
+
+    srt_params_t params;
+    srt_parse_url( url, &params );
+    if ( srt_params_listener( &params, p_sys->psz_host ) )
+    {
+        srt_feed_t *p_feed = vlc_obj_calloc( p_this, 1, sizeof( *p_feed ) );
+        if ( unlikely( p_feed == NULL ) )
+        {
+            free( url );
+            goto failed;
+        }
+
+        p_feed->obj = p_this;
+        p_feed->psz_streamid = vlc_obj_strdup( p_this,
+            params.streamid != NULL ? params.streamid : "" );
+        p_feed->sock = SRT_INVALID_SOCK;
+        p_feed->pp_last = &p_feed->p_queue;
+        vlc_cond_init( &p_feed->wait );
+        free( url );
+
+        if ( p_feed->psz_streamid == NULL
+          || srt_feed_register( p_stream, p_feed,
+                    p_sys->psz_host != NULL ? p_sys->psz_host : "",
+                    p_sys->i_port ? p_sys->i_port : SRT_DEFAULT_PORT ) )
+        {
+            vlc_cond_destroy( &p_feed->wait );
+            goto failed;
+        }
+
+        p_sys->p_feed = p_feed;
+        p_stream->pf_block = BlockFeed;
+        p_stream->pf_control = Control;
+        return VLC_SUCCESS;
+    }
+    free( url );
+
     p_sys->i_poll_id = srt_epoll_create();
     if ( p_sys->i_poll_id == -1 )
     {
@@ -394,6 +894,7 @@ failed:
 
     if ( p_sys->sock != -1 ) srt_close( p_sys->sock );
     if ( p_sys->i_poll_id != -1 ) srt_epoll_release( p_sys->i_poll_id );
+    srt_cleanup();
 
     return VLC_EGENERIC;
 }
@@ -405,6 +906,14 @@ static void Close(vlc_object_t *p_this)
 
     vlc_mutex_destroy( &p_sys->lock );
 
+    if ( p_sys->p_feed != NULL )
+    {
+        srt_feed_unregister( p_sys->p_feed );
+        vlc_cond_destroy( &p_sys->p_feed->wait );
+        srt_cleanup();
+        return;
+    }
+
     srt_epoll_remove_usock( p_sys->i_poll_id, p_sys->sock );
     srt_close( p_sys->sock );
     srt_epoll_release( p_sys->i_poll_id );
@@ -424,6 +933,8 @@ vlc_module_begin ()
     add_integer( SRT_PARAM_POLL_TIMEOUT, SRT_DEFAULT_POLL_TIMEOUT,
             N_( "Return poll wait after timeout milliseconds (-1 = infinite)" ),
             NULL, true )
+    add_integer( SRT_PARAM_BATCH_LATENCY, SRT_DEFAULT_BATCH_LATENCY,
+            SRT_BATCH_LATENCY_TEXT, SRT_BATCH_LATENCY_LONGTEXT, true )
     add_integer( SRT_PARAM_LATENCY, SRT_DEFAULT_LATENCY,
             N_( "SRT latency (ms)" ), NULL, true )
     add_password( SRT_PARAM_PASSPHRASE, "",
@@ -107,6 +107,8 @@ bool srt_parse_url(char* url, srt_params_t* params)
     params->key_length = -1;
     params->payload_size = -1;
     params->bandwidth_overhead_limit = -1;
+    params->mode = NULL;
+    params->streamid = NULL;
 
     /* Parse URL parameters */
     query = find( url, '?' );
@@ -145,6 +147,11 @@ bool srt_parse_url(char* url, srt_params_t* params)
                     if (temp >= 0)
                         params->bandwidth_overhead_limit = temp;
 
+                } else if (strcmp( local_params[i].key, SRT_PARAM_MODE ) == 0) {
+                    params->mode = val;
+                } else if (strcmp( local_params[i].key, SRT_PARAM_STREAMID )
+                        == 0) {
+                    params->streamid = val;
                 }
             }
         }
@@ -153,6 +160,17 @@ bool srt_parse_url(char* url, srt_params_t* params)
     return rc;
 }
 
+/**
+ * Tells whether the URL asks to wait for callers rather than to connect:
+ * either explicitly with mode=listener, or with no host to connect to.
+ */
+bool srt_params_listener(const srt_params_t* params, const char* host)
+{
+    if (params->mode != NULL)
+        return strcmp( params->mode, "listener" ) == 0;
+    return host == NULL || host[0] == '\0' || strcmp( host, "@" ) == 0;
+}
+
 int srt_set_socket_option(vlc_object_t *this, const char *srt_param,
         SRTSOCKET u, SRT_SOCKOPT opt, const void *optval, int optlen)
 {
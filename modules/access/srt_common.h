@@ -39,6 +39,9 @@
 #define SRT_PARAM_CHUNK_SIZE                  "chunk-size"
 #define SRT_PARAM_POLL_TIMEOUT                "poll-timeout"
 #define SRT_PARAM_KEY_LENGTH                  "key-length"
+#define SRT_PARAM_MODE                        "mode"
+#define SRT_PARAM_STREAMID                    "streamid"
+#define SRT_PARAM_BATCH_LATENCY               "batch-latency"
 
 
 #define SRT_DEFAULT_BANDWIDTH_OVERHEAD_LIMIT 25
@@ -47,14 +50,23 @@
 #define SRT_DEFAULT_CHUNK_SIZE SRT_LIVE_DEF_PLSIZE
 /* libsrt tutorial uses 9000 as a default binding port */
 #define SRT_DEFAULT_PORT 9000
+/* Pending connections on listener sockets */
+#define SRT_LISTEN_BACKLOG 32
 /* Minimum/Maximum chunks to allow reading at a time from libsrt */
 #define SRT_MIN_CHUNKS_TRYREAD 10
 #define SRT_MAX_CHUNKS_TRYREAD 100
 /* The default timeout is -1 (infinite) */
 #define SRT_DEFAULT_POLL_TIMEOUT -1
+/* No batching beyond what libsrt already received by default */
+#define SRT_DEFAULT_BATCH_LATENCY 0
 /* The default latency which srt library uses internally */
 #define SRT_DEFAULT_LATENCY       SRT_LIVE_DEF_LATENCY_MS
 #define SRT_DEFAULT_PAYLOAD_SIZE  SRT_LIVE_DEF_PLSIZE
+#define SRT_BATCH_LATENCY_TEXT N_("Receive batch latency (ms)")
+#define SRT_BATCH_LATENCY_LONGTEXT N_( \
+    "Maximum time to wait for more messages before returning the data " \
+    "received so far as one block. This trades some latency for fewer " \
+    "and larger blocks at low bit rates.")
 /* Crypto key length in bytes. */
 #define SRT_KEY_LENGTH_TEXT N_("Crypto key length in bytes")
 #define SRT_DEFAULT_KEY_LENGTH 16
@@ -68,9 +80,12 @@ typedef struct srt_params {
     int key_length;
     int payload_size;
     int bandwidth_overhead_limit;
+    const char* mode;
+    const char* streamid;
 } srt_params_t;
 
 bool srt_parse_url(char* url, srt_params_t* params);
+bool srt_params_listener(const srt_params_t* params, const char* host);
 
 int srt_set_socket_option(vlc_object_t *this, const char *srt_param,
         SRTSOCKET u, SRT_SOCKOPT opt, const void *optval, int optlen);
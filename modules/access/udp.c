@@ -58,6 +58,9 @@ static void Close( vlc_object_t * );
 #define BUFFER_TEXT N_("Receive buffer")
 #define BUFFER_LONGTEXT N_("UDP receive buffer size (bytes)" )
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Datagrams per receive call")
+#define BATCH_LONGTEXT N_("Maximum number of UDP datagrams received " \
+    "with a single system call. Set to 1 to receive one datagram at a time." )
 
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
@@ -68,6 +71,10 @@ vlc_module_begin ()
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
     add_obsolete_integer( "udp-buffer" ) /* since 3.0.0 */
     add_integer( "udp-timeout", -1, TIMEOUT_TEXT, NULL, true )
+#ifdef HAVE_RECVMMSG
+    add_integer_with_range( "udp-batch", 16, 1, 1024,
+                            BATCH_TEXT, BATCH_LONGTEXT, true )
+#endif
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -81,12 +88,29 @@ typedef struct
     int timeout;
     size_t mtu;
     block_t *overflow_block;
+#ifdef HAVE_RECVMMSG
+    struct
+    {
+        unsigned size; /* datagrams per receive call */
+        unsigned head; /* next received datagram */
+        unsigned count; /* received datagrams not returned yet */
+        unsigned overflow; /* datagram owning overflow_block data */
+        block_t **blocks;
+        struct mmsghdr *msgs;
+        struct iovec *iovecs;
+        uint64_t calls;
+        uint64_t datagrams;
+    } batch;
+#endif
 } access_sys_t;
 
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static block_t *BlockUDP( stream_t *, bool * );
+#ifdef HAVE_RECVMMSG
+static block_t *BlockUDPBatch( stream_t *, bool * );
+#endif
 static int Control( stream_t *, int, va_list );
 
 /*****************************************************************************
@@ -181,6 +205,35 @@ static int Open( vlc_object_t *p_this )
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+#ifdef HAVE_RECVMMSG
+    sys->batch.size = var_InheritInteger( p_access, "udp-batch" );
+    sys->batch.head = sys->batch.count = 0;
+    sys->batch.calls = sys->batch.datagrams = 0;
+    sys->batch.blocks = NULL;
+    if( sys->batch.size > 1 )
+    {
+        sys->batch.blocks = vlc_obj_calloc( p_this, sys->batch.size,
+                                            sizeof (*sys->batch.blocks) );
+        sys->batch.msgs = vlc_obj_calloc( p_this, sys->batch.size,
+                                          sizeof (*sys->batch.msgs) );
+        sys->batch.iovecs = vlc_obj_calloc( p_this, 2 * sys->batch.size,
+                                            sizeof (*sys->batch.iovecs) );
+        if( unlikely(sys->batch.blocks == NULL || sys->batch.msgs == NULL
+                  || sys->batch.iovecs == NULL) )
+        {
+            net_Close( sys->fd );
+            return VLC_ENOMEM;
+        }
+
+        for( unsigned i = 0; i < sys->batch.size; i++ )
+        {
+            sys->batch.msgs[i].msg_hdr.msg_iov = &sys->batch.iovecs[2 * i];
+            sys->batch.msgs[i].msg_hdr.msg_iovlen = 2;
+        }
+        p_access->pf_block = BlockUDPBatch;
+    }
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -194,6 +247,21 @@ static void Close( vlc_object_t *p_this )
     if( sys->overflow_block )
         block_Release( sys->overflow_block );
 
+#ifdef HAVE_RECVMMSG
+    if( sys->batch.blocks != NULL )
+    {
+        for( unsigned i = 0; i < sys->batch.size; i++ )
+            if( sys->batch.blocks[i] != NULL )
+                block_Release( sys->batch.blocks[i] );
+
+        if( sys->batch.calls > 0 )
+            msg_Dbg( p_access, "received %"PRIu64" datagrams in %"PRIu64
+                     " calls (%.1f per call)", sys->batch.datagrams,
+                     sys->batch.calls,
+                     (double)sys->batch.datagrams / sys->batch.calls );
+    }
+#endif
+
     net_Close( sys->fd );
 }
 
@@ -300,3 +368,119 @@ skip:
 
     return pkt;
 }
+
+#ifdef HAVE_RECVMMSG
+/*****************************************************************************
+ * BlockUDPBatch: receives several datagrams per system call
+ *****************************************************************************/
+static block_t *BlockUDPBatch(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    while (sys->batch.count == 0)
+    {
+        unsigned n;
+
+        /* Refill the ring of receive buffers */
+        for (n = 0; n < sys->batch.size; n++)
+        {
+            block_t *pkt = sys->batch.blocks[n];
+
+            if (pkt == NULL)
+            {
+                pkt = sys->batch.blocks[n] = block_Alloc(sys->mtu);
+                if (unlikely(pkt == NULL))
+                    break;
+            }
+
+            /* All datagrams share the overflow block, see below */
+            sys->batch.iovecs[2 * n].iov_base = pkt->p_buffer;
+            sys->batch.iovecs[2 * n].iov_len = pkt->i_buffer;
+            sys->batch.iovecs[2 * n + 1].iov_base = sys->overflow_block->p_buffer;
+            sys->batch.iovecs[2 * n + 1].iov_len = sys->overflow_block->i_buffer;
+        }
+
+        if (unlikely(n == 0))
+        {   /* OOM - dequeue and discard one packet */
+            char dummy;
+            recv(sys->fd, &dummy, 1, 0);
+            return NULL;
+        }
+
+        struct pollfd ufd[1];
+
+        ufd[0].fd = sys->fd;
+        ufd[0].events = POLLIN;
+
+        switch (vlc_poll_i11e(ufd, 1, sys->timeout))
+        {
+            case 0:
+                msg_Err(access, "receive time-out");
+                *eof = true;
+                /* fall through */
+            case -1:
+                return NULL;
+        }
+
+        int val = recvmmsg(sys->fd, sys->batch.msgs, n, MSG_DONTWAIT, NULL);
+        if (val <= 0)
+        {
+            if (val == 0 || errno == EINTR || errno == EAGAIN
+             || errno == EWOULDBLOCK)
+                continue;
+            msg_Err(access, "receive error: %s", vlc_strerror_c(errno));
+            return NULL;
+        }
+
+        sys->batch.head = 0;
+        sys->batch.count = val;
+        sys->batch.overflow = val;
+        sys->batch.calls++;
+        sys->batch.datagrams += val;
+
+        /* Only the last oversized datagram has its tail intact in the
+         * overflow block. Earlier ones were overwritten and are dropped. */
+        for (unsigned i = val; i-- > 0;)
+        {
+            const block_t *pkt = sys->batch.blocks[i];
+
+            if (sys->batch.msgs[i].msg_len <= pkt->i_buffer)
+                continue;
+            if (sys->batch.overflow == (unsigned)val)
+                sys->batch.overflow = i;
+            else
+            {
+                msg_Warn(access, "%u bytes packet lost (MTU was %zu)",
+                         sys->batch.msgs[i].msg_len, sys->mtu);
+                sys->batch.msgs[i].msg_len = 0;
+            }
+        }
+    }
+
+    unsigned i = sys->batch.head++;
+    size_t len = sys->batch.msgs[i].msg_len;
+    block_t *pkt = sys->batch.blocks[i];
+
+    sys->batch.blocks[i] = NULL;
+    sys->batch.count--;
+
+    if (unlikely(i == sys->batch.overflow))
+    {
+        msg_Warn(access, "%zu bytes packet received (MTU was %zu), adjusting mtu",
+                 len, sys->mtu);
+        block_t *gather_block = sys->overflow_block;
+
+        sys->overflow_block = block_Alloc(65507 - len);
+
+        gather_block->i_buffer = len - pkt->i_buffer;
+        pkt->p_next = gather_block;
+        pkt = block_ChainGather( pkt );
+
+        sys->mtu = len;
+    }
+    else
+        pkt->i_buffer = len;
+
+    return pkt;
+}
+#endif
@@ -69,6 +69,11 @@
     "(if both width and height are strictly positive)." )
 #define FPS_TEXT N_( "Frame rate" )
 #define FPS_LONGTEXT N_( "Maximum frame rate to use (0 = no limits)." )
+#define BUFFERS_TEXT N_( "Capture buffers" )
+#define BUFFERS_LONGTEXT N_( \
+    "Number of memory-mapped buffers to request from the driver. " \
+    "Captured frames are passed on without copy as long as enough " \
+    "buffers remain available to the driver." )
 
 #define RADIO_DEVICE_TEXT N_( "Radio device" )
 #define RADIO_DEVICE_LONGTEXT N_("Radio tuner device node." )
@@ -312,6 +317,10 @@ vlc_module_begin ()
         change_safe()
     add_string( CFG_PREFIX "fps", "60", FPS_TEXT, FPS_LONGTEXT, false )
         change_safe()
+    add_integer( CFG_PREFIX "buffers", 8, BUFFERS_TEXT, BUFFERS_LONGTEXT,
+                 true )
+        change_integer_range( 2, VIDEO_MAX_FRAME )
+        change_safe()
     add_obsolete_bool( CFG_PREFIX "use-libv4l2" ) /* since 2.1.0 */
 
     set_section( N_( "Tuner" ), NULL )
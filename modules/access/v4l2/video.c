@@ -30,6 +30,8 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 
@@ -577,11 +579,91 @@ vlc_tick_t GetBufferPTS (const struct v4l2_buffer *buf)
     return pts;
 }
 
+/* Memory-mapped buffers are shared with the blocks wrapping them, so that
+ * captured frames need not be copied. A buffer is given back to the driver
+ * when its block is released. The mappings live until the last block is
+ * released, even if streaming was stopped and the device closed meanwhile. */
+struct vlc_v4l2_buffers
+{
+    int fd;
+    uint32_t count;
+    atomic_uint refs; /* one for the owner, one per block in use */
+    atomic_uint queued; /* buffers currently queued in the driver */
+    vlc_mutex_t lock; /* protects streaming (and thus fd) */
+    bool streaming;
+
+    /* Capture statistics, only used by the capture thread */
+    uint64_t frames;
+    uint64_t copies;
+    uint64_t latency_frames;
+    vlc_tick_t latency_sum;
+    vlc_tick_t latency_max;
+
+    struct
+    {
+        void *start;
+        size_t length;
+    } bufv[];
+};
+
+/* Number of buffers left to the driver below which frames are copied, so
+ * that the blocks held downstream cannot starve the capture. */
+#define V4L2_MIN_QUEUED 2
+
+typedef struct
+{
+    block_t self;
+    vlc_v4l2_buffers_t *pool;
+    uint32_t index;
+} v4l2_block_t;
+
+static void ReleaseBuffers (vlc_v4l2_buffers_t *pool)
+{
+    if (atomic_fetch_sub_explicit (&pool->refs, 1, memory_order_acq_rel) != 1)
+        return;
+
+    for (uint32_t i = 0; i < pool->count; i++)
+        v4l2_munmap (pool->bufv[i].start, pool->bufv[i].length);
+    vlc_mutex_destroy (&pool->lock);
+    free (pool);
+}
+
+static int QueueBuffer (vlc_v4l2_buffers_t *pool, uint32_t index)
+{
+    struct v4l2_buffer buf = {
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .memory = V4L2_MEMORY_MMAP,
+        .index = index,
+    };
+
+    if (v4l2_ioctl (pool->fd, VIDIOC_QBUF, &buf) < 0)
+        return -1;
+    atomic_fetch_add_explicit (&pool->queued, 1, memory_order_relaxed);
+    return 0;
+}
+
+static void ReleaseBlock (block_t *block)
+{
+    v4l2_block_t *b = container_of (block, v4l2_block_t, self);
+    vlc_v4l2_buffers_t *pool = b->pool;
+
+    vlc_mutex_lock (&pool->lock);
+    if (pool->streaming)
+        QueueBuffer (pool, b->index);
+    vlc_mutex_unlock (&pool->lock);
+    free (b);
+    ReleaseBuffers (pool);
+}
+
+static const struct vlc_block_callbacks v4l2_block_cbs =
+{
+    ReleaseBlock,
+};
+
 /*****************************************************************************
  * GrabVideo: Grab a video frame
  *****************************************************************************/
-block_t *GrabVideo (vlc_object_t *demux, int fd,
-                    const struct buffer_t *restrict bufv)
+block_t *GrabVideo (vlc_object_t *demux, vlc_v4l2_buffers_t *pool)
 {
     struct v4l2_buffer buf = {
         .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
@@ -589,7 +671,7 @@ block_t *GrabVideo (vlc_object_t *demux, int fd,
     };
 
     /* Wait for next frame */
-    if (v4l2_ioctl (fd, VIDIOC_DQBUF, &buf) < 0)
+    if (v4l2_ioctl (pool->fd, VIDIOC_DQBUF, &buf) < 0)
     {
         switch (errno)
         {
@@ -604,21 +686,58 @@ block_t *GrabVideo (vlc_object_t *demux, int fd,
         }
     }
 
-    /* Copy frame */
-    block_t *block = block_Alloc (buf.bytesused);
-    if (unlikely(block == NULL))
-        return NULL;
-    block->i_pts = block->i_dts = GetBufferPTS (&buf);
-    memcpy (block->p_buffer, bufv[buf.index].start, buf.bytesused);
+    unsigned queued = atomic_fetch_sub_explicit (&pool->queued, 1,
+                                                 memory_order_relaxed) - 1;
+    vlc_tick_t pts = GetBufferPTS (&buf);
 
-    /* Unlock */
-    if (v4l2_ioctl (fd, VIDIOC_QBUF, &buf) < 0)
+    pool->frames++;
+    if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK)
+                                         == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
     {
-        msg_Err (demux, "queue error: %s", vlc_strerror_c(errno));
-        block_Release (block);
-        return NULL;
+        vlc_tick_t latency = vlc_tick_now () - pts;
+
+        pool->latency_frames++;
+        pool->latency_sum += latency;
+        if (latency > pool->latency_max)
+            pool->latency_max = latency;
+    }
+
+    void *data = pool->bufv[buf.index].start;
+    block_t *block;
+
+    if (queued >= V4L2_MIN_QUEUED)
+    {   /* Lend the buffer */
+        v4l2_block_t *b = malloc (sizeof (*b));
+        if (unlikely(b == NULL))
+            goto requeue;
+
+        block = block_Init (&b->self, &v4l2_block_cbs, data, buf.bytesused);
+        b->pool = pool;
+        b->index = buf.index;
+        atomic_fetch_add_explicit (&pool->refs, 1, memory_order_relaxed);
     }
+    else
+    {   /* Copy frame */
+        block = block_Alloc (buf.bytesused);
+        if (unlikely(block == NULL))
+            goto requeue;
+        memcpy (block->p_buffer, data, buf.bytesused);
+        pool->copies++;
+
+        /* Unlock */
+        if (QueueBuffer (pool, buf.index))
+        {
+            msg_Err (demux, "queue error: %s", vlc_strerror_c(errno));
+            block_Release (block);
+            return NULL;
+        }
+    }
+    block->i_pts = block->i_dts = pts;
     return block;
+
+requeue:
+    QueueBuffer (pool, buf.index);
+    return NULL;
 }
 
 /**
@@ -648,13 +767,13 @@ int StartUserPtr (vlc_object_t *obj, int fd)
 
 /**
  * Allocates memory-mapped buffers, queues them and start streaming.
- * @param n requested buffers count [IN], allocated buffers count [OUT]
- * @return array of allocated buffers (use free()), or NULL on error.
+ * @param count requested buffers count
+ * @return shared buffers (use StopMmap()), or NULL on error.
  */
-struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
+vlc_v4l2_buffers_t *StartMmap (vlc_object_t *obj, int fd, uint32_t count)
 {
     struct v4l2_requestbuffers req = {
-        .count = *n,
+        .count = count,
         .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
         .memory = V4L2_MEMORY_MMAP,
     };
@@ -671,41 +790,55 @@ struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
         return NULL;
     }
 
-    struct buffer_t *bufv = vlc_alloc (req.count, sizeof (*bufv));
-    if (unlikely(bufv == NULL))
+    vlc_v4l2_buffers_t *pool = malloc (sizeof (*pool)
+                                       + req.count * sizeof (pool->bufv[0]));
+    if (unlikely(pool == NULL))
         return NULL;
 
-    uint32_t bufc = 0;
-    while (bufc < req.count)
+    pool->fd = fd;
+    pool->count = 0;
+    atomic_init (&pool->refs, 1);
+    atomic_init (&pool->queued, 0);
+    vlc_mutex_init (&pool->lock);
+    pool->streaming = true;
+    pool->frames = 0;
+    pool->copies = 0;
+    pool->latency_frames = 0;
+    pool->latency_sum = 0;
+    pool->latency_max = 0;
+
+    while (pool->count < req.count)
     {
         struct v4l2_buffer buf = {
             .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
             .memory = V4L2_MEMORY_MMAP,
-            .index = bufc,
+            .index = pool->count,
         };
+        uint32_t i = pool->count;
 
         if (v4l2_ioctl (fd, VIDIOC_QUERYBUF, &buf) < 0)
         {
-            msg_Err (obj, "cannot query buffer %"PRIu32": %s", bufc,
+            msg_Err (obj, "cannot query buffer %"PRIu32": %s", i,
                      vlc_strerror_c(errno));
             goto error;
         }
 
-        bufv[bufc].start = v4l2_mmap (NULL, buf.length, PROT_READ | PROT_WRITE,
-                                      MAP_SHARED, fd, buf.m.offset);
-        if (bufv[bufc].start == MAP_FAILED)
+        pool->bufv[i].start = v4l2_mmap (NULL, buf.length,
+                                         PROT_READ | PROT_WRITE, MAP_SHARED,
+                                         fd, buf.m.offset);
+        if (pool->bufv[i].start == MAP_FAILED)
         {
-            msg_Err (obj, "cannot map buffer %"PRIu32": %s", bufc,
+            msg_Err (obj, "cannot map buffer %"PRIu32": %s", i,
                      vlc_strerror_c(errno));
             goto error;
         }
-        bufv[bufc].length = buf.length;
-        bufc++;
+        pool->bufv[i].length = buf.length;
+        pool->count++;
 
         /* Some drivers refuse to queue buffers before they are mapped. Bug? */
-        if (v4l2_ioctl (fd, VIDIOC_QBUF, &buf) < 0)
+        if (QueueBuffer (pool, i))
         {
-            msg_Err (obj, "cannot queue buffer %"PRIu32": %s", bufc,
+            msg_Err (obj, "cannot queue buffer %"PRIu32": %s", i,
                      vlc_strerror_c(errno));
             goto error;
         }
@@ -717,20 +850,36 @@ struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
         msg_Err (obj, "cannot start streaming: %s", vlc_strerror_c(errno));
         goto error;
     }
-    *n = bufc;
-    return bufv;
+    msg_Dbg (obj, "streaming with %"PRIu32" memory-mapped buffers",
+             pool->count);
+    return pool;
 error:
-    StopMmap (fd, bufv, bufc);
+    StopMmap (obj, pool);
     return NULL;
 }
 
-void StopMmap (int fd, struct buffer_t *bufv, uint32_t bufc)
+/**
+ * Stops streaming and releases the buffers. Buffers still in use by blocks
+ * remain mapped until those blocks are released. The device can be closed
+ * as soon as this function returns.
+ */
+void StopMmap (vlc_object_t *obj, vlc_v4l2_buffers_t *pool)
 {
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
+    vlc_mutex_lock (&pool->lock);
     /* STREAMOFF implicitly dequeues all buffers */
-    v4l2_ioctl (fd, VIDIOC_STREAMOFF, &type);
-    for (uint32_t i = 0; i < bufc; i++)
-        v4l2_munmap (bufv[i].start, bufv[i].length);
-    free (bufv);
+    v4l2_ioctl (pool->fd, VIDIOC_STREAMOFF, &type);
+    pool->streaming = false;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (pool->frames > 0)
+        msg_Dbg (obj, "captured %"PRIu64" frames, %"PRIu64" copied",
+                 pool->frames, pool->copies);
+    if (pool->latency_frames > 0)
+        msg_Dbg (obj, "capture latency: average %"PRId64" us, "
+                 "maximum %"PRId64" us",
+                 US_FROM_VLC_TICK(pool->latency_sum / pool->latency_frames),
+                 US_FROM_VLC_TICK(pool->latency_max));
+    ReleaseBuffers (pool);
 }
@@ -58,12 +58,54 @@
 
 #define SOUT_CFG_PREFIX "sout-file-"
 
+/* Most iovecs per write system call */
+#define FILE_IOV_MAX 64
+/* Data queued for the asynchronous writer before Write() blocks */
+#define FILE_ASYNC_MAX (16 << 20)
+/* Size and alignment of the direct I/O writes */
+#define FILE_DIRECT_SIZE (1 << 20)
+#define FILE_DIRECT_ALIGN 4096
+
+typedef struct
+{
+    int fd;
+    off_t pos; /* current offset, for preallocation */
+    off_t prealloc_end;
+    off_t prealloc;
+
+    /* Statistics of the write system calls */
+    uint64_t writes;
+    uint64_t bytes;
+    vlc_tick_t latency;
+    vlc_tick_t latency_max;
+
+    /* Asynchronous writer */
+    bool async;
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    vlc_cond_t space;
+    block_t *queue;
+    block_t **queue_last;
+    size_t queued;
+    bool busy;
+    bool flush; /* drain all data, including buffered direct I/O */
+    bool closing;
+    int error; /* errno of the failed asynchronous write, or 0 */
+
+    /* Direct I/O, from the writer thread only */
+    bool direct;
+    uint8_t *direct_buf;
+    size_t direct_len;
+} access_sys_t;
+
 /*****************************************************************************
  * Read: standard read on a file descriptor.
  *****************************************************************************/
 static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
 {
-    int *fdp = p_access->p_sys, fd = *fdp;
+    access_sys_t *sys = p_access->p_sys;
+    int fd = sys->fd;
     ssize_t val;
 
     do
@@ -73,44 +115,294 @@ static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
 }
 
 /*****************************************************************************
- * Write: standard write on a file descriptor.
+ * WriteVec: vectorized write to the regular file, with statistics.
  *****************************************************************************/
-static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
+static ssize_t WriteVec(access_sys_t *sys, const struct iovec *iov, int iovcnt)
+{
+#ifdef FALLOC_FL_KEEP_SIZE
+    if (sys->prealloc > 0 && sys->pos >= sys->prealloc_end)
+    {   /* Reserve the next extent, without changing the file size */
+        sys->prealloc_end = sys->pos + sys->prealloc;
+        if (fallocate(sys->fd, FALLOC_FL_KEEP_SIZE, sys->pos, sys->prealloc))
+            sys->prealloc = 0; /* not supported, give up */
+    }
+#endif
+
+    vlc_tick_t start = vlc_tick_now();
+    ssize_t val = vlc_writev(sys->fd, iov, iovcnt);
+    vlc_tick_t latency = vlc_tick_now() - start;
+
+    sys->writes++;
+    sys->latency += latency;
+    if (latency > sys->latency_max)
+        sys->latency_max = latency;
+    if (val > 0)
+    {
+        sys->bytes += val;
+        sys->pos += val;
+    }
+    return val;
+}
+
+/* Writes a chain of blocks, coalescing them, and releases it */
+static ssize_t WriteChain(access_sys_t *sys, block_t *p_buffer)
 {
-    int *fdp = p_access->p_sys, fd = *fdp;
     size_t i_write = 0;
 
-    while( p_buffer )
+    while (p_buffer != NULL)
     {
-        ssize_t val = write(fd, p_buffer->p_buffer, p_buffer->i_buffer);
-        if (val <= 0)
+        struct iovec iov[FILE_IOV_MAX];
+        int iovcnt = 0;
+
+        for (block_t *b = p_buffer; b != NULL && iovcnt < FILE_IOV_MAX;
+             b = b->p_next)
         {
-            if (errno == EINTR)
+            if (b->i_buffer == 0)
                 continue;
-            block_ChainRelease (p_buffer);
-            msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
-            return -1;
+            iov[iovcnt].iov_base = b->p_buffer;
+            iov[iovcnt].iov_len = b->i_buffer;
+            iovcnt++;
+        }
+
+        ssize_t val = 0;
+        if (iovcnt > 0)
+        {
+            val = WriteVec(sys, iov, iovcnt);
+            if (val <= 0)
+            {
+                if (val < 0 && errno == EINTR)
+                    continue;
+                if (val == 0)
+                    errno = ENOSPC;
+                block_ChainRelease(p_buffer);
+                return -1;
+            }
         }
+        i_write += val;
 
-        if ((size_t)val >= p_buffer->i_buffer)
+        /* Release what was written */
+        while (p_buffer != NULL && (size_t)val >= p_buffer->i_buffer)
         {
             block_t *p_next = p_buffer->p_next;
-            block_Release (p_buffer);
+
+            val -= p_buffer->i_buffer;
+            block_Release(p_buffer);
             p_buffer = p_next;
         }
-        else
+        if (p_buffer != NULL)
         {
             p_buffer->p_buffer += val;
             p_buffer->i_buffer -= val;
         }
-        i_write += val;
     }
     return i_write;
 }
 
+/*****************************************************************************
+ * Write: standard write on a file descriptor.
+ *****************************************************************************/
+static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    ssize_t val = WriteChain(sys, p_buffer);
+    if (val < 0)
+        msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
+    return val;
+}
+
+#ifdef O_DIRECT
+/* Writes the full direct I/O buffer */
+static int DirectWrite(access_sys_t *sys)
+{
+    size_t done = 0;
+
+    while (done < sys->direct_len)
+    {
+        struct iovec iov = {
+            .iov_base = sys->direct_buf + done,
+            .iov_len = sys->direct_len - done,
+        };
+        ssize_t val = WriteVec(sys, &iov, 1);
+        if (val < 0 && errno == EINTR)
+            continue;
+        if (val < 0 && errno == EINVAL && sys->direct)
+        {   /* Unaligned file offset, or not supported by the file system */
+            sys->direct = false;
+            fcntl(sys->fd, F_SETFL, fcntl(sys->fd, F_GETFL) & ~O_DIRECT);
+            continue;
+        }
+        if (val <= 0)
+        {
+            if (val == 0)
+                errno = ENOSPC;
+            return -1;
+        }
+        done += val;
+    }
+    sys->direct_len = 0;
+    return 0;
+}
+
+/* Gathers a chain of blocks into aligned writes, and releases it */
+static int DirectWriteChain(access_sys_t *sys, block_t *p_buffer)
+{
+    int ret = 0;
+
+    while (p_buffer != NULL)
+    {
+        size_t len = __MIN(p_buffer->i_buffer,
+                           FILE_DIRECT_SIZE - sys->direct_len);
+
+        memcpy(sys->direct_buf + sys->direct_len, p_buffer->p_buffer, len);
+        sys->direct_len += len;
+        p_buffer->p_buffer += len;
+        p_buffer->i_buffer -= len;
+
+        if (sys->direct_len == FILE_DIRECT_SIZE && DirectWrite(sys))
+        {
+            ret = -1;
+            break;
+        }
+
+        if (p_buffer->i_buffer == 0)
+        {
+            block_t *p_next = p_buffer->p_next;
+            block_Release(p_buffer);
+            p_buffer = p_next;
+        }
+    }
+    block_ChainRelease(p_buffer);
+    return ret;
+}
+
+/* Writes the unaligned tail, and stops using direct I/O */
+static int DirectFlush(access_sys_t *sys)
+{
+    if (sys->direct)
+    {
+        sys->direct = false;
+        fcntl(sys->fd, F_SETFL, fcntl(sys->fd, F_GETFL) & ~O_DIRECT);
+    }
+    return DirectWrite(sys);
+}
+#endif
+
+/*****************************************************************************
+ * WriterThread: asynchronous writes to the regular file
+ *****************************************************************************/
+static void *WriterThread(void *data)
+{
+    sout_access_out_t *p_access = data;
+    access_sys_t *sys = p_access->p_sys;
+
+    vlc_mutex_lock(&sys->lock);
+    for (;;)
+    {
+        while (sys->queue == NULL && !sys->flush && !sys->closing)
+            vlc_cond_wait(&sys->wait, &sys->lock);
+
+        block_t *chain = sys->queue;
+        size_t queued = sys->queued;
+        bool drain = sys->flush || sys->closing;
+
+        if (chain == NULL && !drain)
+            continue;
+        sys->queue = NULL;
+        sys->queue_last = &sys->queue;
+        sys->busy = true;
+        vlc_mutex_unlock(&sys->lock);
+
+        int ret = 0;
+#ifdef O_DIRECT
+        if (sys->direct_buf != NULL)
+        {
+            if (chain != NULL)
+                ret = DirectWriteChain(sys, chain);
+            if (ret == 0 && drain)
+                ret = DirectFlush(sys);
+            if (drain)
+            {   /* Seek or close: the rest of the file is written normally */
+                aligned_free(sys->direct_buf);
+                sys->direct_buf = NULL;
+            }
+        }
+        else
+#endif
+        if (chain != NULL && WriteChain(sys, chain) < 0)
+            ret = -1;
+
+        if (ret)
+            msg_Err(p_access, "cannot write: %s", vlc_strerror_c(errno));
+
+        vlc_mutex_lock(&sys->lock);
+        if (ret && sys->error == 0)
+            sys->error = errno;
+        sys->queued -= queued;
+        sys->busy = false;
+        if (drain)
+            sys->flush = false;
+        vlc_cond_broadcast(&sys->space);
+
+        if (sys->closing && sys->queue == NULL)
+            break;
+    }
+    vlc_mutex_unlock(&sys->lock);
+    return NULL;
+}
+
+/*****************************************************************************
+ * WriteAsync: queue the data for the writer thread.
+ *****************************************************************************/
+static ssize_t WriteAsync(sout_access_out_t *p_access, block_t *p_buffer)
+{
+    access_sys_t *sys = p_access->p_sys;
+    size_t i_write = 0;
+    block_t **pp_last = &p_buffer;
+
+    for (block_t *b = p_buffer; b != NULL; b = b->p_next)
+    {
+        i_write += b->i_buffer;
+        pp_last = &b->p_next;
+    }
+
+    vlc_mutex_lock(&sys->lock);
+    /* Only block when the storage cannot keep up for a long time */
+    while (sys->queued >= FILE_ASYNC_MAX && sys->error == 0)
+        vlc_cond_wait(&sys->space, &sys->lock);
+
+    if (sys->error != 0)
+    {
+        vlc_mutex_unlock(&sys->lock);
+        block_ChainRelease(p_buffer);
+        return -1;
+    }
+
+    *sys->queue_last = p_buffer;
+    sys->queue_last = pp_last;
+    sys->queued += i_write;
+    vlc_cond_signal(&sys->wait);
+    vlc_mutex_unlock(&sys->lock);
+    return i_write;
+}
+
+/* Waits until all the queued data is written */
+static int Drain(access_sys_t *sys)
+{
+    vlc_mutex_lock(&sys->lock);
+    sys->flush = true;
+    vlc_cond_signal(&sys->wait);
+    while (sys->queue != NULL || sys->busy || sys->flush)
+        vlc_cond_wait(&sys->space, &sys->lock);
+    int error = sys->error;
+    vlc_mutex_unlock(&sys->lock);
+    return error;
+}
+
 static ssize_t WritePipe(sout_access_out_t *access, block_t *block)
 {
-    int *fdp = access->p_sys, fd = *fdp;
+    access_sys_t *sys = access->p_sys;
+    int fd = sys->fd;
     ssize_t total = 0;
 
     while (block != NULL)
@@ -149,7 +441,8 @@ static ssize_t WritePipe(sout_access_out_t *access, block_t *block)
 #ifdef S_ISSOCK
 static ssize_t Send(sout_access_out_t *access, block_t *block)
 {
-    int *fdp = access->p_sys, fd = *fdp;
+    access_sys_t *sys = access->p_sys;
+    int fd = sys->fd;
     size_t total = 0;
 
     while (block != NULL)
@@ -188,9 +481,15 @@ static ssize_t Send(sout_access_out_t *access, block_t *block)
  *****************************************************************************/
 static int Seek( sout_access_out_t *p_access, off_t i_pos )
 {
-    int *fdp = p_access->p_sys, fd = *fdp;
+    access_sys_t *sys = p_access->p_sys;
+
+    if (sys->async && Drain(sys) != 0)
+        return -1;
 
-    return lseek(fd, i_pos, SEEK_SET);
+    off_t pos = lseek(sys->fd, i_pos, SEEK_SET);
+    if (pos != (off_t)-1)
+        sys->pos = pos;
+    return pos;
 }
 
 static int Control( sout_access_out_t *p_access, int i_query, va_list args )
@@ -223,6 +522,13 @@ static const char *const ppsz_sout_options[] = {
     "overwrite",
 #ifdef O_SYNC
     "sync",
+#endif
+    "async",
+#ifdef O_DIRECT
+    "direct",
+#endif
+#ifdef FALLOC_FL_KEEP_SIZE
+    "prealloc",
 #endif
     NULL
 };
@@ -234,9 +540,9 @@ static int Open( vlc_object_t *p_this )
 {
     sout_access_out_t   *p_access = (sout_access_out_t*)p_this;
     int fd;
-    int *fdp = vlc_obj_malloc(p_this, sizeof (*fdp));
+    access_sys_t *sys = vlc_obj_calloc(p_this, 1, sizeof (*sys));
 
-    if (unlikely(fdp == NULL))
+    if (unlikely(sys == NULL))
         return VLC_ENOMEM;
 
     config_ChainParse( p_access, SOUT_CFG_PREFIX, ppsz_sout_options, p_access->p_cfg );
@@ -321,8 +627,8 @@ static int Open( vlc_object_t *p_this )
             return VLC_EGENERIC;
     }
 
-    *fdp = fd;
-    p_access->p_sys = fdp;
+    sys->fd = fd;
+    p_access->p_sys = sys;
 
     struct stat st;
 
@@ -339,6 +645,57 @@ static int Open( vlc_object_t *p_this )
     {
         p_access->pf_write = Write;
         p_access->pf_seek  = Seek;
+
+        if (append)
+            sys->pos = lseek (fd, 0, SEEK_END);
+#ifdef FALLOC_FL_KEEP_SIZE
+        if (S_ISREG(st.st_mode))
+            sys->prealloc = (off_t)var_GetInteger (p_access,
+                                           SOUT_CFG_PREFIX"prealloc") << 20;
+#endif
+        if (var_GetBool (p_access, SOUT_CFG_PREFIX"async"))
+        {
+#ifdef O_DIRECT
+            if (var_GetBool (p_access, SOUT_CFG_PREFIX"direct"))
+            {
+                sys->direct_buf = aligned_alloc (FILE_DIRECT_ALIGN,
+                                                 FILE_DIRECT_SIZE);
+                if (sys->direct_buf != NULL
+                 && fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_DIRECT) == 0)
+                    sys->direct = true;
+                else
+                    msg_Warn (p_access, "direct I/O not available");
+            }
+#endif
+            vlc_mutex_init (&sys->lock);
+            vlc_cond_init (&sys->wait);
+            vlc_cond_init (&sys->space);
+            sys->queue_last = &sys->queue;
+
+            if (vlc_clone (&sys->thread, WriterThread, p_access,
+                           VLC_THREAD_PRIORITY_OUTPUT) == 0)
+            {
+                sys->async = true;
+                p_access->pf_write = WriteAsync;
+            }
+            else
+            {
+                vlc_cond_destroy (&sys->space);
+                vlc_cond_destroy (&sys->wait);
+                vlc_mutex_destroy (&sys->lock);
+                msg_Warn (p_access, "cannot start the writer thread");
+            }
+#ifdef O_DIRECT
+            if (!sys->async)
+            {
+                if (sys->direct)
+                    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) & ~O_DIRECT);
+                sys->direct = false;
+                aligned_free (sys->direct_buf);
+                sys->direct_buf = NULL;
+            }
+#endif
+        }
     }
 #ifdef S_ISSOCK
     else if (S_ISSOCK(st.st_mode))
@@ -355,7 +712,7 @@ static int Open( vlc_object_t *p_this )
     p_access->pf_control = Control;
 
     msg_Dbg( p_access, "file access output opened (%s)", p_access->psz_path );
-    if (append)
+    if (append && p_access->pf_seek == NULL)
         lseek (fd, 0, SEEK_END);
 
     return VLC_SUCCESS;
@@ -367,9 +724,38 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t * p_this )
 {
     sout_access_out_t *p_access = (sout_access_out_t*)p_this;
-    int *fdp = p_access->p_sys, fd = *fdp;
+    access_sys_t *sys = p_access->p_sys;
 
-    vlc_close(fd);
+    if (sys->async)
+    {
+        vlc_mutex_lock(&sys->lock);
+        sys->closing = true;
+        vlc_cond_signal(&sys->wait);
+        vlc_mutex_unlock(&sys->lock);
+        vlc_join(sys->thread, NULL);
+
+        block_ChainRelease(sys->queue);
+        vlc_cond_destroy(&sys->space);
+        vlc_cond_destroy(&sys->wait);
+        vlc_mutex_destroy(&sys->lock);
+    }
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    struct stat st;
+    /* Release the space reserved beyond the end of the file */
+    if (sys->prealloc_end > 0 && fstat(sys->fd, &st) == 0
+     && sys->prealloc_end > st.st_size && ftruncate(sys->fd, st.st_size))
+        msg_Warn(p_access, "cannot release the reserved space: %s",
+                 vlc_strerror_c(errno));
+#endif
+
+    if (sys->writes > 0)
+        msg_Dbg(p_access, "%"PRIu64" bytes in %"PRIu64" writes, latency "
+                "average %"PRId64" us, maximum %"PRId64" us", sys->bytes,
+                sys->writes, US_FROM_VLC_TICK(sys->latency / sys->writes),
+                US_FROM_VLC_TICK(sys->latency_max));
+
+    vlc_close(sys->fd);
     msg_Dbg( p_access, "file access output closed" );
 }
 
@@ -384,6 +770,15 @@ static void Close( vlc_object_t * p_this )
     "on the file path")
 #define SYNC_TEXT N_("Synchronous writing")
 #define SYNC_LONGTEXT N_( "Open the file with synchronous writing.")
+#define ASYNC_TEXT N_("Asynchronous writing")
+#define ASYNC_LONGTEXT N_( "Write the file from a separate thread, so that " \
+    "storage stalls do not hold the stream output up.")
+#define DIRECT_TEXT N_("Direct I/O")
+#define DIRECT_LONGTEXT N_( "Bypass the operating system cache with large " \
+    "aligned writes. This requires asynchronous writing.")
+#define PREALLOC_TEXT N_("Preallocation size (MiB)")
+#define PREALLOC_LONGTEXT N_( "Reserve disk space by extents of this " \
+    "size ahead of the writes, to limit fragmentation (0 disables).")
 
 vlc_module_begin ()
     set_description( N_("File stream output") )
@@ -401,6 +796,17 @@ vlc_module_begin ()
 #ifdef O_SYNC
     add_bool( SOUT_CFG_PREFIX "sync", false, SYNC_TEXT,SYNC_LONGTEXT,
               false )
+#endif
+    add_bool( SOUT_CFG_PREFIX "async", false, ASYNC_TEXT, ASYNC_LONGTEXT,
+              true )
+#ifdef O_DIRECT
+    add_bool( SOUT_CFG_PREFIX "direct", false, DIRECT_TEXT, DIRECT_LONGTEXT,
+              true )
+#endif
+#ifdef FALLOC_FL_KEEP_SIZE
+    add_integer( SOUT_CFG_PREFIX "prealloc", 0, PREALLOC_TEXT,
+                 PREALLOC_LONGTEXT, true )
+        change_integer_range( 0, 1024 )
 #endif
     set_callbacks( Open, Close )
 vlc_module_end ()
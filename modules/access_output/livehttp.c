@@ -35,6 +35,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
+#include <assert.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -43,6 +44,8 @@
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_charset.h>
+#include <vlc_list.h>
+#include <vlc_httpd.h>
 
 #include <gcrypt.h>
 #include <vlc_gcrypt.h>
@@ -57,6 +60,11 @@
 
 #define MAX_RENAME_RETRIES        10
 
+/* Completed segments waiting for the writer thread before Write() blocks */
+#define MAX_PENDING_SEGMENTS      4
+/* Most blocks gathered per write system call */
+#define MAX_WRITE_BLOCKS          64
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -105,6 +113,32 @@ static void Close( vlc_object_t * );
 #define INTITIAL_SEG_TEXT N_("Number of first segment")
 #define INITIAL_SEG_LONGTEXT N_("The number of the first segment generated")
 
+#define MASTER_TEXT N_("Master playlist")
+#define MASTER_LONGTEXT N_("Path to a master playlist shared by several outputs. "\
+                           "Each output adds its index as a variant, and all "\
+                           "the variants are split on the same boundaries.")
+
+#define VARIANTURL_TEXT N_("Variant URL")
+#define VARIANTURL_LONGTEXT N_("URL of the index file in the master playlist. "\
+                               "Defaults to the name of the index file.")
+
+#define BANDWIDTH_TEXT N_("Variant bandwidth")
+#define BANDWIDTH_LONGTEXT N_("Peak bitrate of the variant in bits per second. "\
+                              "If 0, it is measured on the written segments.")
+
+#define CODECS_TEXT N_("Variant codecs")
+#define CODECS_LONGTEXT N_("Codecs of the variant, as in RFC 6381 "\
+                           "(e.g. avc1.4d401f,mp4a.40.2)")
+
+#define RESOLUTION_TEXT N_("Variant resolution")
+#define RESOLUTION_LONGTEXT N_("Video resolution of the variant (e.g. 1280x720)")
+
+#define SERVE_TEXT N_("Serve over HTTP")
+#define SERVE_LONGTEXT N_("URL path (e.g. /live/) under which the built-in "\
+                          "HTTP server serves the directory of the index "\
+                          "file, with keep-alive, entity tags and byte "\
+                          "ranges. See --http-host and --http-port.")
+
 vlc_module_begin ()
     set_description( N_("HTTP Live streaming output") )
     set_shortname( N_("LiveHTTP" ))
@@ -135,6 +169,18 @@ vlc_module_begin ()
                  KEYFILE_TEXT, KEYFILE_LONGTEXT)
     add_loadfile(SOUT_CFG_PREFIX "key-loadfile", NULL,
                  KEYLOADFILE_TEXT, KEYLOADFILE_LONGTEXT)
+    add_string( SOUT_CFG_PREFIX "master", NULL,
+                MASTER_TEXT, MASTER_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "variant-url", NULL,
+                VARIANTURL_TEXT, VARIANTURL_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "bandwidth", 0,
+                 BANDWIDTH_TEXT, BANDWIDTH_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "codecs", NULL,
+                CODECS_TEXT, CODECS_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "resolution", NULL,
+                RESOLUTION_TEXT, RESOLUTION_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "serve", NULL,
+                SERVE_TEXT, SERVE_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -156,6 +202,12 @@ static const char *const ppsz_sout_options[] = {
     "key-loadfile",
     "generate-iv",
     "initial-segment-number",
+    "master",
+    "variant-url",
+    "bandwidth",
+    "codecs",
+    "resolution",
+    "serve",
     NULL
 };
 
@@ -173,18 +225,55 @@ typedef struct output_segment
     uint8_t aes_ivs[16];
 } output_segment_t;
 
+/* Variant of a master playlist, owned by one livehttp output */
+typedef struct livehttp_variant
+{
+    char *psz_uri;
+    char *psz_codecs;
+    char *psz_resolution;
+    uint64_t i_bandwidth;
+    bool b_measured; /* bandwidth is the peak of the written segments */
+    struct vlc_list node;
+} livehttp_variant_t;
+
+/* Outputs sharing a master playlist, cut on the same segment boundaries */
+typedef struct livehttp_group
+{
+    char *psz_master;
+    vlc_tick_t i_origin; /* dts of the first segment of the group */
+    struct vlc_list variants;
+    struct vlc_list node;
+} livehttp_group_t;
+
+static vlc_mutex_t groups_lock = VLC_STATIC_MUTEX;
+static struct vlc_list groups = { &groups, &groups };
+
+/* Work handed over to the writer thread */
+typedef struct livehttp_job
+{
+    block_t *p_chain;   /* segment or init section data, may be NULL */
+    size_t i_size;
+    float f_seglen;
+    bool b_init;
+    bool b_isend;
+    struct livehttp_job *p_next;
+} livehttp_job_t;
+
 typedef struct
 {
     char *psz_cursegPath;
     char *psz_indexPath;
     char *psz_indexUrl;
     char *psz_keyfile;
+    char *psz_initPath;
+    char *psz_initUri;
     vlc_tick_t i_keyfile_modification;
     vlc_tick_t i_opendts;
+    vlc_tick_t i_boundary;
     vlc_tick_t  i_seglenm;
     uint32_t i_segment;
+    uint32_t i_first_segment;
     size_t  i_seglen;
-    float   f_seglen;
     block_t *full_segments;
     block_t **full_segments_end;
     block_t *ongoing_segment;
@@ -198,19 +287,52 @@ typedef struct
     bool b_caching;
     bool b_generate_iv;
     bool b_segment_has_data;
+    bool b_segment_open;
+    bool b_fmp4;
+    bool b_init_map; /* writer thread: segments need EXT-X-MAP */
     uint8_t aes_ivs[16];
     gcry_cipher_hd_t aes_ctx;
     char *key_uri;
     uint8_t stuffing_bytes[16];
     ssize_t stuffing_size;
     vlc_array_t segments_t;
+
+    livehttp_group_t *group;
+    livehttp_variant_t *variant;
+
+    /* Built-in HTTP origin, or NULL */
+    httpd_host_t *p_httpd_host;
+    httpd_dir_t *p_httpd_dir;
+
+    /* Segments are written to disk by a separate thread, so that a slow
+     * storage does not stall the muxer */
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    vlc_cond_t space;
+    livehttp_job_t *jobs;
+    livehttp_job_t **jobs_end;
+    unsigned i_jobs;
+    bool b_closing;
+
+    /* writer thread: next segment file, opened while waiting for data */
+    output_segment_t *next_segment;
+    int i_next_handle;
 } sout_access_out_sys_t;
 
 static int LoadCryptFile( sout_access_out_t *p_access);
 static int CryptSetup( sout_access_out_t *p_access, char *keyfile );
 static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer );
-static ssize_t writeSegment( sout_access_out_t *p_access );
+static ssize_t writeSegment( sout_access_out_t *p_access, block_t *output );
 static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys );
+static char *formatInitPath( const char *psz_path );
+static int JoinGroup( sout_access_out_t *p_access, const char *psz_master );
+static void LeaveGroup( sout_access_out_t *p_access );
+static int StartServer( sout_access_out_t *p_access, const char *psz_url );
+static void StopServer( sout_access_out_t *p_access );
+static void *WriterThread( void * );
+static void startSegment( sout_access_out_t *p_access, block_t *p_buffer );
+static ssize_t queueSegment( sout_access_out_t *p_access, vlc_tick_t i_enddts, bool b_isend );
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -297,12 +419,133 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->i_handle = -1;
     p_sys->i_segment = p_sys->i_initial_segment-1;
+    p_sys->i_first_segment = p_sys->i_initial_segment;
     p_sys->psz_cursegPath = NULL;
+    p_sys->b_segment_open = false;
+    p_sys->b_fmp4 = false;
+    p_sys->b_init_map = false;
+
+    /* The fMP4 initialization section is named after the segments, with
+     * "init" in place of the segment number */
+    p_sys->psz_initPath = formatInitPath( p_access->psz_path );
+    p_sys->psz_initUri = formatInitPath( p_sys->psz_indexUrl ?
+                                         p_sys->psz_indexUrl : p_access->psz_path );
+
+    char *psz_master = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "master" );
+    if( psz_master )
+    {
+        int ret = JoinGroup( p_access, psz_master );
+        free( psz_master );
+        if( ret != VLC_SUCCESS )
+            goto error;
+    }
+
+    char *psz_serve = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "serve" );
+    if( psz_serve )
+    {
+        int ret = StartServer( p_access, psz_serve );
+        free( psz_serve );
+        if( ret != VLC_SUCCESS )
+        {
+            LeaveGroup( p_access );
+            goto error;
+        }
+    }
+
+    vlc_mutex_init( &p_sys->lock );
+    vlc_cond_init( &p_sys->wait );
+    vlc_cond_init( &p_sys->space );
+    p_sys->jobs = NULL;
+    p_sys->jobs_end = &p_sys->jobs;
+    p_sys->i_jobs = 0;
+    p_sys->b_closing = false;
+    p_sys->next_segment = NULL;
+    p_sys->i_next_handle = -1;
+
+    if( vlc_clone( &p_sys->thread, WriterThread, p_access,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_cond_destroy( &p_sys->space );
+        vlc_cond_destroy( &p_sys->wait );
+        vlc_mutex_destroy( &p_sys->lock );
+        StopServer( p_access );
+        LeaveGroup( p_access );
+        goto error;
+    }
 
     p_access->pf_write = Write;
     p_access->pf_control = Control;
 
     return VLC_SUCCESS;
+
+error:
+    if( p_sys->key_uri )
+    {
+        gcry_cipher_close( p_sys->aes_ctx );
+        free( p_sys->key_uri );
+    }
+    free( p_sys->psz_initUri );
+    free( p_sys->psz_initPath );
+    free( p_sys->psz_keyfile );
+    free( p_sys->psz_indexUrl );
+    free( p_sys->psz_indexPath );
+    free( p_sys );
+    return VLC_EGENERIC;
+}
+
+/************************************************************************
+ * StartServer: serve the index and segments with the built-in HTTP server
+ ************************************************************************/
+static int StartServer( sout_access_out_t *p_access, const char *psz_url )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    const char *psz_file = p_sys->psz_indexPath ? p_sys->psz_indexPath
+                                                : p_access->psz_path;
+    const char *psz_sep = strrchr( psz_file, '/' );
+    char *psz_dir;
+
+    if( psz_sep == psz_file )
+        psz_dir = strdup( "/" );
+    else if( psz_sep )
+        psz_dir = strndup( psz_file, psz_sep - psz_file );
+    else
+        psz_dir = strdup( "." );
+    if( unlikely( !psz_dir ) )
+        return VLC_ENOMEM;
+
+    p_sys->p_httpd_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+    if( !p_sys->p_httpd_host )
+    {
+        msg_Err( p_access, "cannot start HTTP server" );
+        free( psz_dir );
+        return VLC_EGENERIC;
+    }
+
+    p_sys->p_httpd_dir = httpd_DirNew( p_sys->p_httpd_host, psz_url, psz_dir,
+                                       NULL, NULL );
+    if( !p_sys->p_httpd_dir )
+    {
+        msg_Err( p_access, "cannot serve %s at %s", psz_dir, psz_url );
+        httpd_HostDelete( p_sys->p_httpd_host );
+        p_sys->p_httpd_host = NULL;
+        free( psz_dir );
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( p_access, "serving %s at %s", psz_dir, psz_url );
+    free( psz_dir );
+    return VLC_SUCCESS;
+}
+
+static void StopServer( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( !p_sys->p_httpd_host )
+        return;
+    httpd_DirDelete( p_sys->p_httpd_dir );
+    httpd_HostDelete( p_sys->p_httpd_host );
+    p_sys->p_httpd_host = NULL;
 }
 
 /************************************************************************
@@ -502,6 +745,199 @@ static char *formatSegmentPath( char *psz_path, uint32_t i_seg )
     return psz_result;
 }
 
+/*****************************************************************************
+ * formatInitPath: create init section path name, or NULL if the segment
+ * path has no number placeholder
+ *****************************************************************************/
+static char *formatInitPath( const char *psz_path )
+{
+    char *psz_result;
+    char *psz_firstNumSign;
+
+    if ( ! ( psz_result = vlc_strftime( psz_path ) ) )
+        return NULL;
+
+    psz_firstNumSign = psz_result + strcspn( psz_result, SEG_NUMBER_PLACEHOLDER );
+    if ( !*psz_firstNumSign )
+    {
+        free( psz_result );
+        return NULL;
+    }
+
+    char *psz_newResult;
+    int i_cnt = strspn( psz_firstNumSign, SEG_NUMBER_PLACEHOLDER );
+    *psz_firstNumSign = '\0';
+    if ( asprintf( &psz_newResult, "%sinit%s", psz_result, psz_firstNumSign + i_cnt ) < 0 )
+        psz_newResult = NULL;
+    free( psz_result );
+    return psz_newResult;
+}
+
+/************************************************************************
+ * writeMasterPlaylist: Rewrite the master playlist of a group
+ ************************************************************************/
+static void writeMasterPlaylist( vlc_object_t *p_obj, livehttp_group_t *group )
+{
+    vlc_mutex_assert( &groups_lock );
+
+    char *psz_tmp;
+    if ( asprintf( &psz_tmp, "%s.tmp", group->psz_master ) < 0 )
+        return;
+
+    FILE *fp = vlc_fopen( psz_tmp, "wt" );
+    if ( !fp )
+    {
+        msg_Err( p_obj, "cannot open master playlist `%s'", psz_tmp );
+        free( psz_tmp );
+        return;
+    }
+
+    bool b_error = fputs( "#EXTM3U\n#EXT-X-VERSION:3\n", fp ) < 0;
+
+    livehttp_variant_t *variant;
+    vlc_list_foreach( variant, &group->variants, node )
+    {
+        /* BANDWIDTH is mandatory, wait for the first measured segment */
+        if ( b_error || variant->i_bandwidth == 0 )
+            continue;
+
+        b_error = fprintf( fp, "#EXT-X-STREAM-INF:BANDWIDTH=%"PRIu64"%s%s%s%s%s\n%s\n",
+                           variant->i_bandwidth,
+                           variant->psz_codecs ? ",CODECS=\"" : "",
+                           variant->psz_codecs ? variant->psz_codecs : "",
+                           variant->psz_codecs ? "\"" : "",
+                           variant->psz_resolution ? ",RESOLUTION=" : "",
+                           variant->psz_resolution ? variant->psz_resolution : "",
+                           variant->psz_uri ) < 0;
+    }
+    fclose( fp );
+
+    if ( b_error || vlc_rename( psz_tmp, group->psz_master ) < 0 )
+    {
+        vlc_unlink( psz_tmp );
+        msg_Err( p_obj, "Error writing master playlist `%s'", group->psz_master );
+    }
+    free( psz_tmp );
+}
+
+/************************************************************************
+ * JoinGroup: Add this output as a variant of a master playlist
+ ************************************************************************/
+static int JoinGroup( sout_access_out_t *p_access, const char *psz_master )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    livehttp_variant_t *variant = calloc( 1, sizeof( *variant ) );
+    if( unlikely( !variant ) )
+        return VLC_ENOMEM;
+
+    variant->psz_uri = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "variant-url" );
+    if( !variant->psz_uri && p_sys->psz_indexPath )
+    {
+        const char *psz_name = strrchr( p_sys->psz_indexPath, '/' );
+        variant->psz_uri = strdup( psz_name ? psz_name + 1 : p_sys->psz_indexPath );
+    }
+    if( !variant->psz_uri )
+    {
+        msg_Err( p_access, "master playlist requires an index file" );
+        free( variant );
+        return VLC_EGENERIC;
+    }
+    variant->psz_codecs = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "codecs" );
+    variant->psz_resolution = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "resolution" );
+    variant->i_bandwidth = var_GetInteger( p_access, SOUT_CFG_PREFIX "bandwidth" );
+    variant->b_measured = variant->i_bandwidth == 0;
+
+    vlc_mutex_lock( &groups_lock );
+    livehttp_group_t *group = NULL, *it;
+    vlc_list_foreach( it, &groups, node )
+    {
+        if( !strcmp( it->psz_master, psz_master ) )
+        {
+            group = it;
+            break;
+        }
+    }
+
+    if( !group )
+    {
+        group = malloc( sizeof( *group ) );
+        if( unlikely( !group ) || !( group->psz_master = strdup( psz_master ) ) )
+        {
+            vlc_mutex_unlock( &groups_lock );
+            free( group );
+            free( variant->psz_codecs );
+            free( variant->psz_resolution );
+            free( variant->psz_uri );
+            free( variant );
+            return VLC_ENOMEM;
+        }
+        group->i_origin = VLC_TICK_INVALID;
+        vlc_list_init( &group->variants );
+        vlc_list_append( &group->node, &groups );
+    }
+
+    vlc_list_append( &variant->node, &group->variants );
+    writeMasterPlaylist( VLC_OBJECT(p_access), group );
+    vlc_mutex_unlock( &groups_lock );
+
+    msg_Dbg( p_access, "variant %s of master playlist %s", variant->psz_uri, psz_master );
+    p_sys->group = group;
+    p_sys->variant = variant;
+    return VLC_SUCCESS;
+}
+
+static void LeaveGroup( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    livehttp_group_t *group = p_sys->group;
+    livehttp_variant_t *variant = p_sys->variant;
+
+    if( !group )
+        return;
+
+    /* The master playlist is left as is, like the index of the variant */
+    vlc_mutex_lock( &groups_lock );
+    vlc_list_remove( &variant->node );
+    if( vlc_list_is_empty( &group->variants ) )
+    {
+        vlc_list_remove( &group->node );
+        free( group->psz_master );
+        free( group );
+    }
+    vlc_mutex_unlock( &groups_lock );
+
+    free( variant->psz_codecs );
+    free( variant->psz_resolution );
+    free( variant->psz_uri );
+    free( variant );
+    p_sys->group = NULL;
+    p_sys->variant = NULL;
+}
+
+/************************************************************************
+ * updateVariantBandwidth: Track the peak bitrate of a measured variant
+ ************************************************************************/
+static void updateVariantBandwidth( sout_access_out_t *p_access, size_t i_size,
+                                    float f_seglen )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( !p_sys->group || !p_sys->variant->b_measured || f_seglen <= 0.f )
+        return;
+
+    uint64_t i_bandwidth = (uint64_t)( i_size * 8 / f_seglen );
+
+    vlc_mutex_lock( &groups_lock );
+    /* Do not rewrite the master playlist for small variations */
+    if( i_bandwidth > p_sys->variant->i_bandwidth + p_sys->variant->i_bandwidth / 10 )
+    {
+        p_sys->variant->i_bandwidth = i_bandwidth;
+        writeMasterPlaylist( VLC_OBJECT(p_access), p_sys->group );
+    }
+    vlc_mutex_unlock( &groups_lock );
+}
+
 static void destroySegment( output_segment_t *segment )
 {
     free( segment->psz_filename );
@@ -563,9 +999,9 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     unsigned i_index_offset = 0;
 
     if ( p_sys->i_numsegs == 0 ||
-         p_sys->i_segment < ( p_sys->i_numsegs + p_sys->i_initial_segment ) )
+         p_sys->i_segment < ( p_sys->i_numsegs + p_sys->i_first_segment ) )
     {
-        i_firstseg = p_sys->i_initial_segment;
+        i_firstseg = p_sys->i_first_segment;
     }
     else
     {
@@ -591,11 +1027,17 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
             return -1;
         }
 
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
-                          "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
+        /* fMP4 segments need EXT-X-MAP, and version 7 for the format */
+        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:%d\n#EXT-X-ALLOW-CACHE:%s"
+                          "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s%s%s%s", p_sys->i_seglen,
+                          p_sys->b_init_map ? 7 : 3,
                           p_sys->b_caching ? "YES" : "NO",
                           p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
-                          i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
+                          i_firstseg,
+                          p_sys->b_init_map ? "#EXT-X-MAP:URI=\"" : "",
+                          p_sys->b_init_map ? p_sys->psz_initUri : "",
+                          p_sys->b_init_map ? "\"\n" : "",
+                          ((p_sys->i_initial_segment > 1) && (p_sys->i_first_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
                           ) < 0 )
         {
             free( psz_idxTmp );
@@ -706,7 +1148,7 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
 /*****************************************************************************
  * closeCurrentSegment: Close the segment file
  *****************************************************************************/
-static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, float f_seglen, bool b_isend )
 {
     if ( p_sys->i_handle >= 0 )
     {
@@ -733,12 +1175,12 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
         vlc_close( p_sys->i_handle );
         p_sys->i_handle = -1;
 
-        if( ! ( us_asprintf( &segment->psz_duration, "%.2f", p_sys->f_seglen ) ) )
+        if( ! ( us_asprintf( &segment->psz_duration, "%.2f", f_seglen ) ) )
         {
             msg_Err( p_access, "Couldn't set duration on closed segment");
             return;
         }
-        segment->f_seglength = p_sys->f_seglen;
+        segment->f_seglength = f_seglen;
 
         segment->i_segment_number = p_sys->i_segment;
 
@@ -784,17 +1226,21 @@ static void Close( vlc_object_t * p_this )
         p_sys->ongoing_segment_end = &p_sys->ongoing_segment;
     }
 
-    ssize_t writevalue = writeSegment( p_access );
+    /* Hand the last segment over, the writer then ends the index */
+    if( p_sys->full_segments && !p_sys->b_segment_open )
+        startSegment( p_access, p_sys->full_segments );
+    ssize_t writevalue = queueSegment( p_access, VLC_TICK_INVALID, true );
     msg_Dbg( p_access, "Writing.. %zd", writevalue );
-    if( unlikely( writevalue < 0 ) )
-    {
-        if( p_sys->full_segments )
-            block_ChainRelease( p_sys->full_segments );
-        if( p_sys->ongoing_segment )
-            block_ChainRelease( p_sys->ongoing_segment );
-    }
 
-    closeCurrentSegment( p_access, p_sys, true );
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_closing = true;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+    vlc_join( p_sys->thread, NULL );
+
+    vlc_cond_destroy( &p_sys->space );
+    vlc_cond_destroy( &p_sys->wait );
+    vlc_mutex_destroy( &p_sys->lock );
 
     if( p_sys->key_uri )
     {
@@ -814,7 +1260,15 @@ static void Close( vlc_object_t * p_this )
 
         destroySegment( segment );
     }
+    if( p_sys->b_delsegs && p_sys->i_numsegs && p_sys->b_fmp4 )
+        vlc_unlink( p_sys->psz_initPath );
 
+    StopServer( p_access );
+    LeaveGroup( p_access );
+
+    free( p_sys->psz_initUri );
+    free( p_sys->psz_initPath );
+    free( p_sys->psz_keyfile );
     free( p_sys->psz_indexUrl );
     free( p_sys->psz_indexPath );
     free( p_sys );
@@ -843,9 +1297,9 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
 }
 
 /*****************************************************************************
- * openNextFile: Open the segment file
+ * prepareNextFile: Create the next segment file ahead of time
  *****************************************************************************/
-static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys )
+static int prepareNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys )
 {
     int fd;
 
@@ -878,6 +1332,42 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
         return -1;
     }
 
+    p_sys->next_segment = segment;
+    p_sys->i_next_handle = fd;
+    return fd;
+}
+
+/*****************************************************************************
+ * dropNextFile: Remove the segment file opened ahead of time, if any
+ *****************************************************************************/
+static void dropNextFile( sout_access_out_sys_t *p_sys )
+{
+    output_segment_t *segment = p_sys->next_segment;
+    if( !segment )
+        return;
+
+    vlc_close( p_sys->i_next_handle );
+    vlc_unlink( segment->psz_filename );
+    destroySegment( segment );
+    p_sys->next_segment = NULL;
+    p_sys->i_next_handle = -1;
+}
+
+/*****************************************************************************
+ * openNextFile: Open the segment file
+ *****************************************************************************/
+static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys )
+{
+    if( !p_sys->next_segment && prepareNextFile( p_access, p_sys ) < 0 )
+        return -1;
+
+    output_segment_t *segment = p_sys->next_segment;
+    int fd = p_sys->i_next_handle;
+    uint32_t i_newseg = segment->i_segment_number;
+
+    p_sys->next_segment = NULL;
+    p_sys->i_next_handle = -1;
+
     vlc_array_append_or_abort( &p_sys->segments_t, segment );
 
     if( p_sys->psz_keyfile )
@@ -897,129 +1387,361 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
     p_sys->psz_cursegPath = strdup(segment->psz_filename);
     p_sys->i_handle = fd;
     p_sys->i_segment = i_newseg;
-    p_sys->b_segment_has_data = false;
     return fd;
 }
 /*****************************************************************************
- * CheckSegmentChange: Check if segment needs to be closed and new opened
+ * pushJob: Queue work for the writer thread
  *****************************************************************************/
-static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
+static void pushJob( sout_access_out_sys_t *p_sys, livehttp_job_t *job )
+{
+    job->p_next = NULL;
+
+    vlc_mutex_lock( &p_sys->lock );
+    /* Do not pile up segments in memory if the storage cannot keep up */
+    while( p_sys->i_jobs >= MAX_PENDING_SEGMENTS )
+        vlc_cond_wait( &p_sys->space, &p_sys->lock );
+
+    *p_sys->jobs_end = job;
+    p_sys->jobs_end = &job->p_next;
+    p_sys->i_jobs++;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+}
+
+/*****************************************************************************
+ * queueInit: Hand the fMP4 initialization section over to the writer
+ *****************************************************************************/
+static ssize_t queueInit( sout_access_out_t *p_access, block_t *p_header )
+{
+    livehttp_job_t *job = calloc( 1, sizeof( *job ) );
+    if( unlikely( !job ) )
+    {
+        block_Release( p_header );
+        return -1;
+    }
+
+    size_t i_size = p_header->i_buffer;
+    job->p_chain = p_header;
+    job->i_size = i_size;
+    job->b_init = true;
+    pushJob( p_access->p_sys, job );
+    return i_size;
+}
+
+/*****************************************************************************
+ * queueSegment: Hand the gathered segment over to the writer
+ *****************************************************************************/
+static ssize_t queueSegment( sout_access_out_t *p_access, vlc_tick_t i_enddts,
+                             bool b_isend )
 {
     sout_access_out_sys_t *p_sys = p_access->p_sys;
-    ssize_t writevalue = 0;
+    block_t *p_chain = p_sys->full_segments;
 
-    if( p_sys->i_handle > 0 && p_sys->b_segment_has_data &&
-       (( p_buffer->i_length + p_buffer->i_dts - p_sys->i_opendts ) >= p_sys->i_seglenm ) )
+    p_sys->full_segments = NULL;
+    p_sys->full_segments_end = &p_sys->full_segments;
+    p_sys->b_segment_open = false;
+
+    if( !p_chain && !b_isend )
+        return 0;
+
+    livehttp_job_t *job = calloc( 1, sizeof( *job ) );
+    if( unlikely( !job ) )
     {
-        writevalue = writeSegment( p_access );
-        if( unlikely( writevalue < 0 ) )
-        {
-            block_ChainRelease ( p_buffer );
-            return -1;
-        }
-        closeCurrentSegment( p_access, p_sys, false );
-        return writevalue;
+        block_ChainRelease( p_chain );
+        return -1;
     }
 
-    if ( unlikely( p_sys->i_handle < 0 ) )
+    block_t *p_last = NULL;
+    for( block_t *p_block = p_chain; p_block; p_block = p_block->p_next )
     {
-        p_sys->i_opendts = p_buffer->i_dts;
+        job->i_size += p_block->i_buffer;
+        p_last = p_block;
+    }
 
-        if( p_sys->ongoing_segment && ( p_sys->ongoing_segment->i_dts < p_sys->i_opendts) )
-            p_sys->i_opendts = p_sys->ongoing_segment->i_dts;
+    /* The segment ends where the next one starts, or after its last block */
+    if( i_enddts == VLC_TICK_INVALID && p_last )
+        i_enddts = p_last->i_dts + p_last->i_length;
+    if( p_chain )
+        job->f_seglen = secf_from_vlc_tick( i_enddts - p_sys->i_opendts );
+
+    size_t i_size = job->i_size;
+    job->p_chain = p_chain;
+    job->b_isend = b_isend;
+    /* the writer owns the job from now on */
+    pushJob( p_sys, job );
+    return i_size;
+}
 
-        if( p_sys->full_segments && ( p_sys->full_segments->i_dts < p_sys->i_opendts) )
-            p_sys->i_opendts = p_sys->full_segments->i_dts;
+static vlc_tick_t earliestDts( vlc_tick_t i_dts, const block_t *p_block )
+{
+    if( !p_block || p_block->i_dts == VLC_TICK_INVALID )
+        return i_dts;
+    if( i_dts == VLC_TICK_INVALID || p_block->i_dts < i_dts )
+        return p_block->i_dts;
+    return i_dts;
+}
 
-        msg_Dbg( p_access, "Setting new opendts %"PRId64, p_sys->i_opendts );
+/*****************************************************************************
+ * startSegment: Start gathering a new segment
+ *****************************************************************************/
+static void startSegment( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    bool b_first = p_sys->i_opendts == VLC_TICK_INVALID;
 
-        if ( openNextFile( p_access, p_sys ) < 0 )
-           return -1;
+    p_sys->i_opendts = earliestDts( VLC_TICK_INVALID, p_buffer );
+    p_sys->i_opendts = earliestDts( p_sys->i_opendts, p_sys->ongoing_segment );
+    p_sys->i_opendts = earliestDts( p_sys->i_opendts, p_sys->full_segments );
+
+    msg_Dbg( p_access, "Setting new opendts %"PRId64, p_sys->i_opendts );
+
+    if( p_sys->group && p_sys->i_opendts != VLC_TICK_INVALID )
+    {
+        vlc_mutex_lock( &groups_lock );
+        if( p_sys->group->i_origin == VLC_TICK_INVALID )
+            p_sys->group->i_origin = p_sys->i_opendts;
+        vlc_tick_t i_origin = p_sys->group->i_origin;
+        vlc_mutex_unlock( &groups_lock );
+
+        /* Cut on a grid shared by all the variants, so that renditions of the
+         * same source, with the same keyframes, get the same segments */
+        int64_t i_slot = 0;
+        if( p_sys->i_opendts > i_origin )
+            i_slot = ( p_sys->i_opendts - i_origin ) / p_sys->i_seglenm;
+        p_sys->i_boundary = i_origin + ( i_slot + 1 ) * p_sys->i_seglenm;
+
+        /* A variant starting late keeps the numbering of the group. The
+         * writer thread has not used the numbers yet. */
+        if( b_first )
+        {
+            p_sys->i_first_segment = p_sys->i_initial_segment + i_slot;
+            p_sys->i_segment = p_sys->i_first_segment - 1;
+        }
     }
-    return writevalue;
+
+    p_sys->b_segment_open = true;
+    p_sys->b_segment_has_data = false;
 }
 
-static ssize_t writeSegment( sout_access_out_t *p_access )
+static bool isSegmentComplete( sout_access_out_sys_t *p_sys, const block_t *p_buffer )
+{
+    if( p_sys->group )
+        return p_buffer->i_dts != VLC_TICK_INVALID &&
+               p_buffer->i_dts >= p_sys->i_boundary;
+
+    return ( p_buffer->i_length + p_buffer->i_dts - p_sys->i_opendts ) >= p_sys->i_seglenm;
+}
+
+/*****************************************************************************
+ * CheckSegmentChange: Check if segment needs to be closed and new opened
+ *****************************************************************************/
+static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
 {
     sout_access_out_sys_t *p_sys = p_access->p_sys;
-    msg_Dbg( p_access, "Writing all full segments" );
 
-    block_t *output = p_sys->full_segments;
-    vlc_tick_t output_last_length;
-    if( *p_sys->full_segments_end )
-        output_last_length = (*p_sys->full_segments_end)->i_length;
-    else if( output )
-        output_last_length = output->i_length;
-    else
-        output_last_length = 0;
-    p_sys->full_segments = NULL;
-    p_sys->full_segments_end = &p_sys->full_segments;
+    if( p_sys->b_segment_open && p_sys->b_segment_has_data &&
+        isSegmentComplete( p_sys, p_buffer ) )
+        return queueSegment( p_access, p_buffer->i_dts, false );
 
-    ssize_t i_write=0;
-    bool crypted = false;
-    while( output )
+    if ( unlikely( !p_sys->b_segment_open ) )
+        startSegment( p_access, p_buffer );
+    return 0;
+}
+
+static ssize_t writeSegment( sout_access_out_t *p_access, block_t *output )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    msg_Dbg( p_access, "Writing all full segments" );
+
+    /* Encrypt everything first, so that blocks can be written together */
+    if( p_sys->key_uri )
     {
-        if( p_sys->key_uri && !crypted )
+        for( block_t **pp = &output; *pp; pp = &(*pp)->p_next )
         {
             if( p_sys->stuffing_size )
             {
-                output = block_Realloc( output, p_sys->stuffing_size, output->i_buffer );
-                if( unlikely(!output ) )
+                block_t *p_next = (*pp)->p_next;
+                *pp = block_Realloc( *pp, p_sys->stuffing_size, (*pp)->i_buffer );
+                if( unlikely(!*pp) )
+                {
+                    block_ChainRelease( p_next );
+                    block_ChainRelease( output );
                     return VLC_ENOMEM;
-                memcpy( output->p_buffer, p_sys->stuffing_bytes, p_sys->stuffing_size );
+                }
+                memcpy( (*pp)->p_buffer, p_sys->stuffing_bytes, p_sys->stuffing_size );
                 p_sys->stuffing_size = 0;
             }
-            size_t original = output->i_buffer;
-            size_t padded = (output->i_buffer + 15 ) & ~15;
+
+            block_t *p_block = *pp;
+            size_t original = p_block->i_buffer;
+            size_t padded = (p_block->i_buffer + 15 ) & ~15;
             size_t pad = padded - original;
             if( pad )
             {
                 p_sys->stuffing_size = 16-pad;
-                output->i_buffer -= p_sys->stuffing_size;
-                memcpy(p_sys->stuffing_bytes, &output->p_buffer[output->i_buffer], p_sys->stuffing_size);
+                p_block->i_buffer -= p_sys->stuffing_size;
+                memcpy(p_sys->stuffing_bytes, &p_block->p_buffer[p_block->i_buffer], p_sys->stuffing_size);
             }
 
             gcry_error_t err = gcry_cipher_encrypt( p_sys->aes_ctx,
-                                output->p_buffer, output->i_buffer, NULL, 0 );
+                                p_block->p_buffer, p_block->i_buffer, NULL, 0 );
             if( err )
             {
                 msg_Err( p_access, "Encryption failure: %s ", gpg_strerror(err) );
+                block_ChainRelease( output );
                 return -1;
             }
-            crypted=true;
+        }
+    }
 
+    ssize_t i_write=0;
+    while( output )
+    {
+        struct iovec iov[MAX_WRITE_BLOCKS];
+        int iovcnt = 0;
+
+        for( block_t *p_block = output; p_block && iovcnt < MAX_WRITE_BLOCKS;
+             p_block = p_block->p_next )
+        {
+            iov[iovcnt].iov_base = p_block->p_buffer;
+            iov[iovcnt].iov_len = p_block->i_buffer;
+            iovcnt++;
         }
 
-        ssize_t val = vlc_write( p_sys->i_handle, output->p_buffer, output->i_buffer );
+        ssize_t val = vlc_writev( p_sys->i_handle, iov, iovcnt );
         if ( val == -1 )
         {
            if ( errno == EINTR )
               continue;
+           msg_Err( p_access, "cannot write segment: %s", vlc_strerror_c(errno) );
+           block_ChainRelease( output );
            return -1;
         }
+        i_write += val;
 
-        p_sys->f_seglen = secf_from_vlc_tick(output_last_length +
-                                    output->i_dts - p_sys->i_opendts);
-
-        if ( (size_t)val >= output->i_buffer )
+        while( output && (size_t)val >= output->i_buffer )
         {
            block_t *p_next = output->p_next;
+           val -= output->i_buffer;
            block_Release (output);
            output = p_next;
-           crypted=false;
         }
-        else
+        if( output )
         {
            output->p_buffer += val;
            output->i_buffer -= val;
         }
-        i_write += val;
     }
     return i_write;
 }
 
 /*****************************************************************************
- * Write: standard write on a file descriptor.
+ * writeInitSection: Write the fMP4 initialization section
+ *****************************************************************************/
+static void writeInitSection( sout_access_out_t *p_access, block_t *p_chain )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    /* Segments refer to it from now on, even if it fails */
+    p_sys->b_init_map = true;
+
+    int fd = vlc_open( p_sys->psz_initPath, O_WRONLY | O_CREAT | O_LARGEFILE |
+                       O_TRUNC, 0666 );
+    if ( fd == -1 )
+    {
+        msg_Err( p_access, "cannot open `%s' (%s)", p_sys->psz_initPath,
+                 vlc_strerror_c(errno) );
+        block_ChainRelease( p_chain );
+        return;
+    }
+
+    for( block_t *p_block = p_chain; p_block; p_block = p_block->p_next )
+    {
+        size_t i_done = 0;
+        while( i_done < p_block->i_buffer )
+        {
+            ssize_t val = vlc_write( fd, &p_block->p_buffer[i_done],
+                                     p_block->i_buffer - i_done );
+            if ( val == -1 )
+            {
+                if ( errno == EINTR )
+                    continue;
+                msg_Err( p_access, "cannot write `%s' (%s)", p_sys->psz_initPath,
+                         vlc_strerror_c(errno) );
+                break;
+            }
+            i_done += val;
+        }
+    }
+    vlc_close( fd );
+    block_ChainRelease( p_chain );
+
+    msg_Dbg( p_access, "LiveHttpInitComplete: %s", p_sys->psz_initPath );
+}
+
+/*****************************************************************************
+ * WriterThread: Write segments, update the index and delete old segments
+ *****************************************************************************/
+static void *WriterThread( void *data )
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    for( ;; )
+    {
+        while( !p_sys->jobs && !p_sys->b_closing )
+            vlc_cond_wait( &p_sys->wait, &p_sys->lock );
+
+        livehttp_job_t *job = p_sys->jobs;
+        if( !job )
+            break;
+        p_sys->jobs = job->p_next;
+        if( !p_sys->jobs )
+            p_sys->jobs_end = &p_sys->jobs;
+        vlc_mutex_unlock( &p_sys->lock );
+
+        if( job->b_init )
+            writeInitSection( p_access, job->p_chain );
+        else if( job->p_chain )
+        {
+            if( openNextFile( p_access, p_sys ) < 0 )
+                block_ChainRelease( job->p_chain );
+            else
+            {
+                ssize_t val = writeSegment( p_access, job->p_chain );
+                closeCurrentSegment( p_access, p_sys, job->f_seglen, job->b_isend );
+                if( val >= 0 )
+                    updateVariantBandwidth( p_access, val, job->f_seglen );
+            }
+        }
+        else if( job->b_isend && vlc_array_count( &p_sys->segments_t ) > 0 )
+            updateIndexAndDel( p_access, p_sys, true );
+        bool b_more = !job->b_isend;
+        free( job );
+
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->i_jobs--;
+        vlc_cond_signal( &p_sys->space );
+
+        /* Create the next segment file while the muxer gathers its data, so
+         * that the file system is not in the way when it is handed over */
+        if( b_more && !p_sys->jobs && !p_sys->b_closing &&
+            !p_sys->next_segment && vlc_array_count( &p_sys->segments_t ) > 0 )
+        {
+            vlc_mutex_unlock( &p_sys->lock );
+            prepareNextFile( p_access, p_sys );
+            vlc_mutex_lock( &p_sys->lock );
+        }
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+
+    dropNextFile( p_sys );
+    return NULL;
+}
+
+/*****************************************************************************
+ * Write: gather blocks into segments for the writer thread.
  *****************************************************************************/
 static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 {
@@ -1027,10 +1749,32 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
     sout_access_out_sys_t *p_sys = p_access->p_sys;
     while( p_buffer )
     {
+        /* The fMP4 header is the initialization section of all the segments,
+         * which then start on each fragment */
+        if( ( p_buffer->i_flags & BLOCK_FLAG_HEADER ) &&
+            p_sys->psz_initPath && p_sys->psz_initUri &&
+            p_buffer->i_buffer >= 8 && !memcmp( &p_buffer->p_buffer[4], "ftyp", 4 ) )
+        {
+            block_t *p_temp = p_buffer->p_next;
+            p_buffer->p_next = NULL;
+            p_sys->b_fmp4 = true;
+
+            ssize_t ret = queueInit( p_access, p_buffer );
+            if( ret < 0 )
+            {
+                block_ChainRelease( p_temp );
+                return ret;
+            }
+            i_write += ret;
+            p_buffer = p_temp;
+            continue;
+        }
+
         /* Check if current block is already past segment-length
             and we want to write gathered blocks into segment
             and update playlist */
-        if( p_sys->ongoing_segment && ( p_sys->b_splitanywhere  || ( p_buffer->i_flags & BLOCK_FLAG_HEADER ) ) )
+        if( p_sys->ongoing_segment && ( p_sys->b_splitanywhere ||
+            ( p_buffer->i_flags & ( p_sys->b_fmp4 ? BLOCK_FLAG_TYPE_I : BLOCK_FLAG_HEADER ) ) ) )
         {
             msg_Dbg( p_access, "Moving ongoing segment to full segments-queue" );
             block_ChainLastAppend( &p_sys->full_segments_end, p_sys->ongoing_segment );
@@ -1043,6 +1787,7 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
         if( ret < 0 )
         {
             msg_Err( p_access, "Error in write loop");
+            block_ChainRelease( p_buffer );
             return ret;
         }
         i_write += ret;
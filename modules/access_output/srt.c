@@ -37,6 +37,11 @@ typedef struct
     int           i_poll_id;
     bool          b_interrupted;
     vlc_mutex_t   lock;
+
+    /* listener mode */
+    SRTSOCKET    *p_callers;
+    size_t        i_callers;
+    char         *psz_streamid;
 } sout_access_out_sys_t;
 
 static void srt_wait_interrupted(void *p_data)
@@ -336,6 +341,211 @@ out:
     return i_len;
 }
 
+/*
+ * Listener mode: the stream is muxed once and sent to every caller.
+ */
+
+static bool srt_listen_callers(sout_access_out_t *p_access,
+                               const char *psz_path)
+{
+    vlc_object_t *access_obj = (vlc_object_t *) p_access;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    int i_latency=var_InheritInteger( p_access, SRT_PARAM_LATENCY );
+    int i_payload_size = var_InheritInteger( p_access, SRT_PARAM_PAYLOAD_SIZE );
+    char *psz_passphrase = var_InheritString( p_access, SRT_PARAM_PASSPHRASE );
+    int i_max_bandwidth_limit =
+    var_InheritInteger( p_access, SRT_PARAM_BANDWIDTH_OVERHEAD_LIMIT );
+    struct addrinfo hints = {
+        .ai_socktype = SOCK_DGRAM,
+        .ai_flags = AI_PASSIVE,
+    }, *res = NULL;
+    bool failed = true;
+    int i_port = SRT_DEFAULT_PORT;
+
+    char *psz_host = strdup( psz_path );
+    if ( psz_host == NULL )
+        goto out;
+
+    char *psz_parser = strchr( psz_host, '?' );
+    if ( psz_parser != NULL )
+        *psz_parser = '\0'; /* drop the parameters, parsed already */
+
+    psz_parser = psz_host;
+    if ( psz_parser[0] == '@' )
+        psz_parser++;
+    if ( psz_parser[0] == '[' )
+        psz_parser = strchr( psz_parser, ']' );
+
+    psz_parser = strchr( psz_parser ? psz_parser : psz_host, ':' );
+    if ( psz_parser != NULL )
+    {
+        *psz_parser++ = '\0';
+        i_port = atoi( psz_parser );
+    }
+
+    const char *psz_bind = psz_host[0] == '@' ? psz_host + 1 : psz_host;
+    int stat = vlc_getaddrinfo( psz_bind[0] ? psz_bind : NULL, i_port,
+                                &hints, &res );
+    if ( stat )
+    {
+        msg_Err( p_access, "Cannot resolve [%s]:%d (reason: %s)",
+                 psz_bind, i_port, gai_strerror( stat ) );
+        goto out;
+    }
+
+    p_sys->sock = srt_socket( res->ai_family, SOCK_DGRAM, 0 );
+    if ( p_sys->sock == SRT_INVALID_SOCK )
+    {
+        msg_Err( p_access, "Failed to open socket." );
+        goto out;
+    }
+
+    /* Callers inherit these settings. Without blocking, a slow caller only
+     * loses its own packets, not the others'. */
+    srt_setsockopt( p_sys->sock, 0, SRTO_SNDSYN,
+        &(bool) { false }, sizeof( bool ) );
+    srt_setsockopt( p_sys->sock, 0, SRTO_RCVSYN,
+        &(bool) { false }, sizeof( bool ) );
+    srt_setsockopt( p_sys->sock, 0, SRTO_TSBPDMODE,
+        &(int) { 1 }, sizeof( int ) );
+    srt_setsockopt( p_sys->sock, 0, SRTO_SENDER,
+        &(int) { 1 }, sizeof( int ) );
+
+    srt_set_socket_option( access_obj, SRT_PARAM_LATENCY, p_sys->sock,
+            SRTO_TSBPDDELAY, &i_latency, sizeof(i_latency) );
+
+    if (psz_passphrase != NULL && psz_passphrase[0] != '\0') {
+        int i_key_length = var_InheritInteger( access_obj, SRT_PARAM_KEY_LENGTH );
+
+        srt_set_socket_option( access_obj, SRT_PARAM_KEY_LENGTH, p_sys->sock,
+                SRTO_PBKEYLEN, &i_key_length, sizeof(i_key_length) );
+
+        srt_set_socket_option( access_obj, SRT_PARAM_PASSPHRASE, p_sys->sock,
+                SRTO_PASSPHRASE, psz_passphrase, strlen(psz_passphrase) );
+    }
+
+    srt_set_socket_option( access_obj, SRT_PARAM_PAYLOAD_SIZE, p_sys->sock,
+            SRTO_PAYLOADSIZE, &i_payload_size, sizeof(i_payload_size) );
+
+    srt_set_socket_option( access_obj, SRT_PARAM_BANDWIDTH_OVERHEAD_LIMIT,
+            p_sys->sock, SRTO_OHEADBW, &i_max_bandwidth_limit,
+            sizeof(i_max_bandwidth_limit) );
+
+    if ( srt_bind( p_sys->sock, res->ai_addr, res->ai_addrlen ) == SRT_ERROR
+      || srt_listen( p_sys->sock, SRT_LISTEN_BACKLOG ) == SRT_ERROR )
+    {
+        msg_Err( p_access, "Failed to listen on port %d (reason: %s)",
+                 i_port, srt_getlasterror_str() );
+        goto out;
+    }
+
+    msg_Dbg( p_access, "Listening for SRT callers on port %d", i_port );
+    failed = false;
+
+out:
+    if (failed && p_sys->sock != SRT_INVALID_SOCK)
+    {
+        srt_close(p_sys->sock);
+        p_sys->sock = SRT_INVALID_SOCK;
+    }
+
+    free( psz_passphrase );
+    free( psz_host );
+    if ( res != NULL )
+        freeaddrinfo( res );
+
+    return !failed;
+}
+
+static void srt_accept_callers(sout_access_out_t *p_access)
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    SRTSOCKET sock;
+
+    while ( (sock = srt_accept( p_sys->sock, NULL, NULL )) != SRT_INVALID_SOCK )
+    {
+        if ( p_sys->psz_streamid != NULL )
+        {
+            char psz_streamid[513];
+            int i_len = sizeof( psz_streamid ) - 1;
+
+            if ( srt_getsockflag( sock, SRTO_STREAMID, psz_streamid, &i_len ) )
+                i_len = 0;
+            psz_streamid[i_len] = '\0';
+
+            if ( strcmp( psz_streamid, p_sys->psz_streamid ) )
+            {
+                msg_Warn( p_access, "Rejecting SRT caller for unknown "
+                          "stream ID: %s", psz_streamid );
+                srt_close( sock );
+                continue;
+            }
+        }
+
+        SRTSOCKET *p_callers = realloc( p_sys->p_callers,
+            ( p_sys->i_callers + 1 ) * sizeof( *p_callers ) );
+        if ( unlikely( p_callers == NULL ) )
+        {
+            srt_close( sock );
+            break;
+        }
+
+        p_callers[p_sys->i_callers++] = sock;
+        p_sys->p_callers = p_callers;
+        msg_Dbg( p_access, "SRT caller connected (%zu callers)",
+                 p_sys->i_callers );
+    }
+}
+
+static ssize_t WriteListener( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    size_t i_chunk_size = var_InheritInteger( p_access, SRT_PARAM_CHUNK_SIZE);
+    ssize_t i_len = 0;
+
+    if ( i_chunk_size == 0 )
+        i_chunk_size = SRT_DEFAULT_CHUNK_SIZE;
+
+    srt_accept_callers( p_access );
+
+    while( p_buffer )
+    {
+        block_t *p_next = p_buffer->p_next;
+
+        i_len += p_buffer->i_buffer;
+
+        for ( size_t i_offset = 0; i_offset < p_buffer->i_buffer;
+              i_offset += i_chunk_size )
+        {
+            size_t i_write = __MIN( p_buffer->i_buffer - i_offset,
+                                    i_chunk_size );
+
+            for ( size_t i = 0; i < p_sys->i_callers; )
+            {
+                SRTSOCKET sock = p_sys->p_callers[i];
+
+                if ( srt_sendmsg2( sock, (char *)p_buffer->p_buffer + i_offset,
+                                   i_write, 0 ) == SRT_ERROR
+                  && srt_getlasterror( NULL ) != SRT_EASYNCSND )
+                {
+                    /* Caller gone */
+                    srt_close( sock );
+                    p_sys->p_callers[i] = p_sys->p_callers[--p_sys->i_callers];
+                    msg_Dbg( p_access, "SRT caller disconnected (%zu callers)",
+                             p_sys->i_callers );
+                    continue;
+                }
+                i++;
+            }
+        }
+
+        block_Release( p_buffer );
+        p_buffer = p_next;
+    }
+
+    return i_len;
+}
+
 static int Control( sout_access_out_t *p_access, int i_query, va_list args )
 {
     VLC_UNUSED( p_access );
@@ -378,8 +588,35 @@ static int Open( vlc_object_t *p_this )
 
     vlc_mutex_init( &p_sys->lock );
 
+    p_sys->sock = SRT_INVALID_SOCK;
+    p_sys->i_poll_id = -1;
     p_access->p_sys = p_sys;
 
+    char *url = strdup( p_access->psz_path );
+    if ( unlikely( url == NULL ) )
+        goto failed;
+
+    srt_params_t params;
+    srt_parse_url( url, &params );
+
+    /* No host to connect to, as in srt://:port, means listening */
+    const char *psz_path = p_access->psz_path;
+    bool b_listener = srt_params_listener( &params,
+        strchr( ":@?", *psz_path ) != NULL ? "" : psz_path );
+    if ( b_listener && params.streamid != NULL )
+        p_sys->psz_streamid = vlc_obj_strdup( p_this, params.streamid );
+    free( url );
+
+    if ( b_listener )
+    {
+        if ( !srt_listen_callers( p_access, p_access->psz_path ) )
+            goto failed;
+
+        p_access->pf_write = WriteListener;
+        p_access->pf_control = Control;
+        return VLC_SUCCESS;
+    }
+
     p_sys->i_poll_id = srt_epoll_create();
     if ( p_sys->i_poll_id == -1 )
     {
@@ -406,6 +643,7 @@ failed:
 
     if ( p_sys->sock != -1 ) srt_close( p_sys->sock );
     if ( p_sys->i_poll_id != -1 ) srt_epoll_release( p_sys->i_poll_id );
+    srt_cleanup();
 
     return VLC_EGENERIC;
 }
@@ -417,9 +655,16 @@ static void Close( vlc_object_t * p_this )
 
     vlc_mutex_destroy( &p_sys->lock );
 
-    srt_epoll_remove_usock( p_sys->i_poll_id, p_sys->sock );
+    for ( size_t i = 0; i < p_sys->i_callers; i++ )
+        srt_close( p_sys->p_callers[i] );
+    free( p_sys->p_callers );
+
+    if ( p_sys->i_poll_id != -1 )
+    {
+        srt_epoll_remove_usock( p_sys->i_poll_id, p_sys->sock );
+        srt_epoll_release( p_sys->i_poll_id );
+    }
     srt_close( p_sys->sock );
-    srt_epoll_release( p_sys->i_poll_id );
 
     srt_cleanup();
 }
@@ -50,6 +50,9 @@
 
 #define MAX_EMPTY_BLOCKS 200
 
+/* Maximum number of datagrams sent with a single system call */
+#define UDP_BATCH_MAX 64
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -118,8 +121,22 @@ typedef struct
     block_t      *p_buffer;
 
     vlc_thread_t  thread;
+
+    /* output statistics, owned by the thread */
+    uint64_t      i_calls;
+    uint64_t      i_datagrams;
+    uint64_t      i_late;       /* datagrams sent more than 20ms late */
+    vlc_tick_t    i_late_max;
+    vlc_tick_t    i_late_total; /* sum of the positive send delays */
 } sout_access_out_sys_t;
 
+typedef struct
+{
+    block_t      *p_blocks[UDP_BATCH_MAX];
+    unsigned      i_count;
+    block_t      *p_pending; /* dequeued, but not due yet */
+} udp_batch_t;
+
 #define DEFAULT_PORT 1234
 
 /*****************************************************************************
@@ -206,8 +223,13 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
+    p_sys->p_fifo = block_FifoNewSPSC();
     p_sys->p_buffer = NULL;
+    p_sys->i_calls = 0;
+    p_sys->i_datagrams = 0;
+    p_sys->i_late = 0;
+    p_sys->i_late_max = 0;
+    p_sys->i_late_total = 0;
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
@@ -237,6 +259,13 @@ static void Close( vlc_object_t * p_this )
     vlc_join( p_sys->thread, NULL );
     block_FifoRelease( p_sys->p_fifo );
 
+    if( p_sys->i_datagrams > 0 )
+        msg_Dbg( p_access, "sent %"PRIu64" datagrams in %"PRIu64" calls, "
+                 "%"PRIu64" late, mean delay %"PRId64" us, max %"PRId64" us",
+                 p_sys->i_datagrams, p_sys->i_calls, p_sys->i_late,
+                 p_sys->i_late_total / (vlc_tick_t)p_sys->i_datagrams,
+                 p_sys->i_late_max );
+
     if( p_sys->p_buffer ) block_Release( p_sys->p_buffer );
 
     net_Close( p_sys->i_handle );
@@ -345,8 +374,121 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
     return i_len;
 }
 
+static void BatchCleanup( void *data )
+{
+    udp_batch_t *p_batch = data;
+
+    for( unsigned i = 0; i < p_batch->i_count; i++ )
+        block_Release( p_batch->p_blocks[i] );
+    p_batch->i_count = 0;
+
+    if( p_batch->p_pending )
+    {
+        block_Release( p_batch->p_pending );
+        p_batch->p_pending = NULL;
+    }
+}
+
+/* Checks the date of a packet against the previous one,
+ * returns false if the packet is dropped */
+static bool CheckDate( sout_access_out_t *p_access, block_t *p_pk,
+                       vlc_tick_t *pi_date_last, unsigned *pi_dropped )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    vlc_tick_t i_date = p_sys->i_caching + p_pk->i_dts;
+
+    if( *pi_date_last > 0 )
+    {
+        if( i_date - *pi_date_last > VLC_TICK_FROM_SEC(2) )
+        {
+            if( !*pi_dropped )
+                msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                         i_date - *pi_date_last );
+
+            block_Release( p_pk );
+
+            *pi_date_last = i_date;
+            (*pi_dropped)++;
+            return false;
+        }
+        else if( i_date - *pi_date_last < VLC_TICK_FROM_MS(-1) )
+        {
+            if( !*pi_dropped )
+                msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
+                         *pi_date_last - i_date );
+        }
+    }
+
+    *pi_date_last = i_date;
+    return true;
+}
+
+static void BatchSend( sout_access_out_t *p_access, udp_batch_t *p_batch )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    const unsigned i_count = p_batch->i_count;
+
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[UDP_BATCH_MAX];
+    struct iovec iovecs[UDP_BATCH_MAX];
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        iovecs[i].iov_base = p_batch->p_blocks[i]->p_buffer;
+        iovecs[i].iov_len = p_batch->p_blocks[i]->i_buffer;
+        memset( &msgs[i], 0, sizeof( msgs[i] ) );
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for( unsigned i = 0; i < i_count; )
+    {
+        int val = sendmmsg( p_sys->i_handle, &msgs[i], i_count - i, 0 );
+        p_sys->i_calls++;
+        if( val <= 0 )
+        {
+            if( val < 0 && errno == EINTR )
+                continue;
+            /* skip the failing datagram */
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            val = 1;
+        }
+        i += val;
+    }
+#else
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        block_t *p_pk = p_batch->p_blocks[i];
+
+        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+        p_sys->i_calls++;
+    }
+#endif
+
+    const vlc_tick_t now = vlc_tick_now();
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        vlc_tick_t i_delay = now - ( p_sys->i_caching + p_batch->p_blocks[i]->i_dts );
+        if( i_delay > 0 )
+        {
+            p_sys->i_late_total += i_delay;
+            if( i_delay > p_sys->i_late_max )
+                p_sys->i_late_max = i_delay;
+            if( i_delay > VLC_TICK_FROM_MS(20) )
+                p_sys->i_late++;
+        }
+        block_Release( p_batch->p_blocks[i] );
+    }
+    p_sys->i_datagrams += i_count;
+    p_batch->i_count = 0;
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
+ *****************************************************************************
+ * The datagrams of a group, and those which are already due, are sent
+ * together with a single system call when possible.
  *****************************************************************************/
 static void* ThreadWrite( void *data )
 {
@@ -355,47 +497,51 @@ static void* ThreadWrite( void *data )
     vlc_tick_t i_date_last = -1;
     const unsigned i_group = var_GetInteger( p_access,
                                              SOUT_CFG_PREFIX "group" );
-    int i_to_send = i_group;
     unsigned i_dropped_packets = 0;
+    udp_batch_t batch = { .i_count = 0, .p_pending = NULL };
+
+    vlc_thread_set_affinity( p_access, "sout" );
 
+    vlc_cleanup_push( BatchCleanup, &batch );
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
-        vlc_tick_t    i_date;
+        block_t *p_pk = batch.p_pending;
+        batch.p_pending = NULL;
+        if( p_pk == NULL )
+            p_pk = block_FifoGet( p_sys->p_fifo );
 
-        i_date = p_sys->i_caching + p_pk->i_dts;
-        if( i_date_last > 0 )
-        {
-            if( i_date - i_date_last > VLC_TICK_FROM_SEC(2) )
-            {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
-                             i_date - i_date_last );
+        if( !CheckDate( p_access, p_pk, &i_date_last, &i_dropped_packets ) )
+            continue;
 
-                block_Release( p_pk );
+        vlc_tick_t i_date = p_sys->i_caching + p_pk->i_dts;
+        batch.p_blocks[batch.i_count++] = p_pk;
+        vlc_tick_wait( i_date );
 
-                i_date_last = i_date;
-                i_dropped_packets++;
-                continue;
-            }
-            else if( i_date - i_date_last < VLC_TICK_FROM_MS(-1) )
+        /* gather the rest of the group, and the packets already due */
+        unsigned i_group_left = i_group > 1 ? i_group - 1 : 0;
+        while( batch.i_count < UDP_BATCH_MAX )
+        {
+            block_t *p_next = block_FifoTryGet( p_sys->p_fifo );
+            if( p_next == NULL )
+                break;
+
+            bool b_grouped = i_group_left > 0 &&
+                             !(p_next->i_flags & BLOCK_FLAG_CLOCK);
+            if( !b_grouped &&
+                p_sys->i_caching + p_next->i_dts > vlc_tick_now() )
             {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
-                             i_date_last - i_date );
+                batch.p_pending = p_next;
+                break;
             }
-        }
 
-        block_cleanup_push( p_pk );
-        i_to_send--;
-        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
-        {
-            vlc_tick_wait( i_date );
-            i_to_send = i_group;
+            if( !CheckDate( p_access, p_next, &i_date_last, &i_dropped_packets ) )
+                continue;
+            if( i_group_left > 0 )
+                i_group_left--;
+            batch.p_blocks[batch.i_count++] = p_next;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
+
+        BatchSend( p_access, &batch );
 
         if( i_dropped_packets )
         {
@@ -403,8 +549,6 @@ static void* ThreadWrite( void *data )
             i_dropped_packets = 0;
         }
 
-        i_date_last = i_date;
-
 #if 1
         i_date = vlc_tick_now() - i_date;
         if ( i_date > VLC_TICK_FROM_MS(20) )
@@ -413,9 +557,7 @@ static void* ThreadWrite( void *data )
                      i_date );
         }
 #endif
-
-        block_Release( p_pk );
-
     }
+    vlc_cleanup_pop();
     return NULL;
 }
@@ -0,0 +1,356 @@
+/*****************************************************************************
+ * biquad.c: multichannel biquad filters
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The lanes of a frame are filtered 4 at a time, one vector per group of 4
+ * lanes, in transposed direct form II. The state of a group stays in
+ * registers for the whole buffer: each stage of each sample is 5 vector
+ * multiplies, whatever the number of channels or bands.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef BIQUAD_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "biquad.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+
+#define LANES      4
+#define MAX_STAGES 8
+
+struct biquad4
+{
+    float b0[LANES], b1[LANES], b2[LANES], a1[LANES], a2[LANES];
+};
+
+struct biquad4_state
+{
+    float z1[LANES], z2[LANES];
+};
+
+typedef void (*process_group_t)(const struct biquad4 *, struct biquad4_state *,
+                                unsigned stages, float *dst, const float *src,
+                                size_t frames, unsigned width, unsigned lanes);
+
+struct biquad_bank
+{
+    unsigned width;
+    unsigned groups;
+    unsigned stages;
+    process_group_t process_group;
+    struct biquad4 *coeffs; /* stages per group */
+    struct biquad4_state *state; /* stages per group */
+};
+
+static void ProcessGroup(const struct biquad4 *c, struct biquad4_state *state,
+                         unsigned stages, float *dst, const float *src,
+                         size_t frames, unsigned width, unsigned lanes)
+{
+    float z1[MAX_STAGES][LANES], z2[MAX_STAGES][LANES];
+
+    for (unsigned s = 0; s < stages; s++)
+    {
+        memcpy(z1[s], state[s].z1, sizeof (z1[s]));
+        memcpy(z2[s], state[s].z2, sizeof (z2[s]));
+    }
+
+    for (size_t f = 0; f < frames; f++)
+    {
+        float x[LANES] = { 0.f };
+
+        for (unsigned l = 0; l < lanes; l++)
+            x[l] = src[f * width + l];
+
+        for (unsigned s = 0; s < stages; s++)
+            for (unsigned l = 0; l < LANES; l++)
+            {
+                float y = c[s].b0[l] * x[l] + z1[s][l];
+
+                z1[s][l] = c[s].b1[l] * x[l] - c[s].a1[l] * y + z2[s][l];
+                z2[s][l] = c[s].b2[l] * x[l] - c[s].a2[l] * y;
+                x[l] = y;
+            }
+
+        for (unsigned l = 0; l < lanes; l++)
+            dst[f * width + l] = x[l];
+    }
+
+    for (unsigned s = 0; s < stages; s++)
+    {
+        memcpy(state[s].z1, z1[s], sizeof (z1[s]));
+        memcpy(state[s].z2, z2[s], sizeof (z2[s]));
+    }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static void ProcessGroup_SSE2(const struct biquad4 *c,
+                              struct biquad4_state *state, unsigned stages,
+                              float *dst, const float *src, size_t frames,
+                              unsigned width, unsigned lanes)
+{
+    __m128 z1[MAX_STAGES], z2[MAX_STAGES];
+
+    for (unsigned s = 0; s < stages; s++)
+    {
+        z1[s] = _mm_load_ps(state[s].z1);
+        z2[s] = _mm_load_ps(state[s].z2);
+    }
+
+    for (size_t f = 0; f < frames; f++)
+    {
+        float buf[LANES] = { 0.f };
+        __m128 x;
+
+        if (lanes == LANES)
+            x = _mm_loadu_ps(src + f * width);
+        else
+        {
+            for (unsigned l = 0; l < lanes; l++)
+                buf[l] = src[f * width + l];
+            x = _mm_loadu_ps(buf);
+        }
+
+        for (unsigned s = 0; s < stages; s++)
+        {
+            __m128 y = _mm_add_ps(_mm_mul_ps(_mm_load_ps(c[s].b0), x), z1[s]);
+
+            z1[s] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_load_ps(c[s].b1), x),
+                                          _mm_mul_ps(_mm_load_ps(c[s].a1), y)),
+                               z2[s]);
+            z2[s] = _mm_sub_ps(_mm_mul_ps(_mm_load_ps(c[s].b2), x),
+                               _mm_mul_ps(_mm_load_ps(c[s].a2), y));
+            x = y;
+        }
+
+        if (lanes == LANES)
+            _mm_storeu_ps(dst + f * width, x);
+        else
+        {
+            _mm_storeu_ps(buf, x);
+            for (unsigned l = 0; l < lanes; l++)
+                dst[f * width + l] = buf[l];
+        }
+    }
+
+    for (unsigned s = 0; s < stages; s++)
+    {
+        _mm_store_ps(state[s].z1, z1[s]);
+        _mm_store_ps(state[s].z2, z2[s]);
+    }
+}
+#endif
+
+void biquad_bank_Process(struct biquad_bank *b, float *dst, const float *src,
+                         size_t frames)
+{
+    for (unsigned g = 0; g < b->groups; g++)
+    {
+        unsigned lanes = __MIN(b->width - g * LANES, LANES);
+
+        b->process_group(b->coeffs + g * b->stages, b->state + g * b->stages,
+                         b->stages, dst + g * LANES, src + g * LANES, frames,
+                         b->width, lanes);
+    }
+}
+
+void biquad_bank_Set(struct biquad_bank *b, unsigned stage, unsigned lane,
+                     const struct biquad_coeffs *coeffs)
+{
+    assert(stage < b->stages && lane < b->width);
+
+    struct biquad4 *c = &b->coeffs[(lane / LANES) * b->stages + stage];
+    unsigned l = lane % LANES;
+
+    c->b0[l] = coeffs->b0;
+    c->b1[l] = coeffs->b1;
+    c->b2[l] = coeffs->b2;
+    c->a1[l] = coeffs->a1;
+    c->a2[l] = coeffs->a2;
+}
+
+void biquad_bank_Reset(struct biquad_bank *b)
+{
+    memset(b->state, 0, b->groups * b->stages * sizeof (*b->state));
+}
+
+static struct biquad_bank *BiquadBankNew(unsigned width, unsigned stages,
+                                         bool simd)
+{
+    if (width == 0 || stages == 0 || stages > MAX_STAGES)
+        return NULL;
+
+    struct biquad_bank *b = malloc(sizeof (*b));
+    if (unlikely(b == NULL))
+        return NULL;
+
+    b->width = width;
+    b->groups = (width + LANES - 1) / LANES;
+    b->stages = stages;
+    b->process_group = ProcessGroup;
+#ifdef HAVE_SSE2_INTRINSICS
+    if (simd && vlc_CPU_SSE2())
+        b->process_group = ProcessGroup_SSE2;
+#else
+    (void) simd;
+#endif
+
+    size_t count = b->groups * stages;
+    b->coeffs = aligned_alloc(16, count * sizeof (*b->coeffs));
+    b->state = aligned_alloc(16, count * sizeof (*b->state));
+    if (unlikely(b->coeffs == NULL || b->state == NULL))
+    {
+        biquad_bank_Delete(b);
+        return NULL;
+    }
+
+    /* Identity, also for the unused lanes of the last group */
+    memset(b->coeffs, 0, count * sizeof (*b->coeffs));
+    for (size_t i = 0; i < count; i++)
+        for (unsigned l = 0; l < LANES; l++)
+            b->coeffs[i].b0[l] = 1.f;
+    biquad_bank_Reset(b);
+    return b;
+}
+
+struct biquad_bank *biquad_bank_New(unsigned width, unsigned stages)
+{
+    return BiquadBankNew(width, stages, true);
+}
+
+void biquad_bank_Delete(struct biquad_bank *b)
+{
+    aligned_free(b->coeffs);
+    aligned_free(b->state);
+    free(b);
+}
+
+#ifdef BIQUAD_TEST
+# include <math.h>
+# include <stdio.h>
+
+static double Random(unsigned *seed)
+{
+    int val = rand_r(seed);
+    return (double)val / RAND_MAX;
+}
+
+/* Checks both implementations against a direct form I reference */
+static void Test(unsigned width, unsigned stages, bool simd)
+{
+    const size_t frames = 1000;
+    unsigned seed = width * 10 + stages;
+    struct biquad_coeffs c[MAX_STAGES][16];
+    double ref[MAX_STAGES][16][4] = { { { 0. } } };
+    float *buf = malloc(frames * width * sizeof (float));
+    assert(buf != NULL && width <= 16);
+
+    struct biquad_bank *b = BiquadBankNew(width, stages, simd);
+    assert(b != NULL);
+
+    /* Random stable filters: poles of radius below 0.95 */
+    for (unsigned s = 0; s < stages; s++)
+        for (unsigned l = 0; l < width; l++)
+        {
+            double r = .95 * Random(&seed);
+            double theta = M_PI * Random(&seed);
+
+            c[s][l].b0 = Random(&seed);
+            c[s][l].b1 = Random(&seed) - .5;
+            c[s][l].b2 = Random(&seed) - .5;
+            c[s][l].a1 = -2. * r * cos(theta);
+            c[s][l].a2 = r * r;
+            biquad_bank_Set(b, s, l, &c[s][l]);
+        }
+
+    for (size_t i = 0; i < frames * width; i++)
+        buf[i] = Random(&seed) - .5;
+
+    double err = 0.;
+    for (size_t f = 0, count = 1; f < frames; f += count, count = count * 7 % 97)
+    {
+        count = __MIN(count, frames - f);
+
+        float in[97 * 16];
+        memcpy(in, buf + f * width, count * width * sizeof (float));
+        biquad_bank_Process(b, buf + f * width, buf + f * width, count);
+
+        for (size_t i = 0; i < count; i++)
+            for (unsigned l = 0; l < width; l++)
+            {
+                double x = in[i * width + l];
+
+                for (unsigned s = 0; s < stages; s++)
+                {
+                    double *z = ref[s][l];
+                    double y = c[s][l].b0 * x + c[s][l].b1 * z[0]
+                             + c[s][l].b2 * z[1] - c[s][l].a1 * z[2]
+                             - c[s][l].a2 * z[3];
+                    z[1] = z[0]; z[0] = x;
+                    z[3] = z[2]; z[2] = y;
+                    x = y;
+                }
+                err = fmax(err, fabs(x - buf[(f + i) * width + l]));
+            }
+    }
+
+    fprintf(stderr, "%2u lanes %u stages%s: error %g\n", width, stages,
+            simd ? " simd" : "", err);
+    assert(err < 1e-3);
+
+    biquad_bank_Reset(b);
+    memset(buf, 0, width * sizeof (float));
+    biquad_bank_Process(b, buf, buf, 1);
+    for (unsigned l = 0; l < width; l++)
+        assert(buf[l] == 0.f);
+
+    biquad_bank_Delete(b);
+    free(buf);
+}
+
+int main(void)
+{
+    for (unsigned simd = 0; simd < 2; simd++)
+    {
+        Test(1, 1, simd);
+        Test(2, 5, simd);
+        Test(6, 2, simd);
+        Test(8, 3, simd);
+        Test(12, 1, simd);
+        Test(16, 8, simd);
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,64 @@
+/*****************************************************************************
+ * biquad.h: multichannel biquad filters
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_BIQUAD_H
+#define VLC_AUDIO_BIQUAD_H 1
+
+/**
+ * Coefficients of a biquad normalized by a0:
+ * H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+ */
+struct biquad_coeffs
+{
+    float b0, b1, b2, a1, a2;
+};
+
+struct biquad_bank;
+
+/**
+ * Creates a bank of cascaded biquads for frames of \p width interleaved
+ * lanes, e.g. one lane per channel, or one lane per band of a channel.
+ * Each lane has its own coefficients and state, and runs through \p stages
+ * biquads in series. Lanes are processed 4 at a time with SIMD.
+ *
+ * \return the bank, all filters set to identity, or NULL on error
+ */
+struct biquad_bank *biquad_bank_New(unsigned width, unsigned stages);
+
+void biquad_bank_Delete(struct biquad_bank *);
+
+/**
+ * Sets the coefficients of a stage of one lane.
+ */
+void biquad_bank_Set(struct biquad_bank *, unsigned stage, unsigned lane,
+                     const struct biquad_coeffs *);
+
+/**
+ * Filters frames of \p width floats (in place if \p dst equals \p src).
+ */
+void biquad_bank_Process(struct biquad_bank *, float *dst, const float *src,
+                         size_t frames);
+
+/**
+ * Clears the filters state (e.g. on flush).
+ */
+void biquad_bank_Reset(struct biquad_bank *);
+
+#endif
@@ -0,0 +1,556 @@
+/*****************************************************************************
+ * convolver.c: uniformly partitioned FFT convolution
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Uniformly partitioned overlap-save convolution: every filter is cut in
+ * partitions of B taps, each transformed once to the frequency domain.
+ * Every B input frames, the last 2B frames of each input are transformed
+ * (one real FFT of 2B points, computed as a complex FFT of B points) and
+ * stored in a frequency-domain delay line. Each output is then the sum of
+ * the delayed input spectra multiplied by the matching filter partitions,
+ * transformed back once. Partitions without any tap are skipped.
+ *
+ * Spectra are kept as separate real and imaginary arrays, padded to a
+ * multiple of 4 floats, so that the multiply-accumulate is plain vector
+ * arithmetic.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef CONVOLVER_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "convolver.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+
+typedef void (*multiply_add_t)(float *restrict, float *restrict,
+                               const float *, const float *,
+                               const float *, const float *, size_t);
+
+struct convolver
+{
+    unsigned block; /* B, frames per partition */
+    unsigned inputs;
+    unsigned outputs;
+    unsigned parts; /* partitions per filter */
+    unsigned stride; /* floats per real or imaginary spectrum array */
+    unsigned pos; /* frames in the current block */
+    unsigned slot; /* newest spectrum in the delay lines */
+    multiply_add_t multiply_add;
+
+    unsigned *bitrev; /* B */
+    float *twiddles; /* B/2 cosines, B/2 sines */
+    float *post; /* B+1 cosines, B+1 sines for the real transform */
+
+    float *time; /* 2B per input: previous and current blocks */
+    float *fdl; /* parts spectra per input */
+    float **filters; /* inputs x outputs x parts spectra, NULL if zero */
+    float *acc; /* one spectrum */
+    float *work; /* 2B, complex FFT */
+    float *frame; /* 2B, inverse transform */
+    float *out; /* B per output: current output block */
+};
+
+static float *AllocFloats(size_t count)
+{
+    size_t size = ((count + 3) & ~(size_t)3) * sizeof (float);
+    float *p = aligned_alloc(16, size);
+    if (likely(p != NULL))
+        memset(p, 0, size);
+    return p;
+}
+
+/* In-place complex FFT of B points, radix 2 */
+static void FFT(const struct convolver *c, float *re, float *im)
+{
+    const unsigned n = c->block;
+    const float *cosines = c->twiddles, *sines = c->twiddles + n / 2;
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        unsigned j = c->bitrev[i];
+        if (j > i)
+        {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (unsigned size = 2; size <= n; size *= 2)
+    {
+        const unsigned half = size / 2, step = n / size;
+
+        for (unsigned i = 0; i < n; i += size)
+            for (unsigned j = 0; j < half; j++)
+            {
+                const float wr = cosines[j * step], wi = -sines[j * step];
+                const unsigned a = i + j, b = a + half;
+                const float tr = re[b] * wr - im[b] * wi;
+                const float ti = re[b] * wi + im[b] * wr;
+
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+    }
+}
+
+/* Transforms 2B real samples to B+1 bins */
+static void RealFFT(const struct convolver *c, const float *x,
+                    float *xr, float *xi)
+{
+    const unsigned n = c->block;
+    const float *cosines = c->post, *sines = c->post + n + 1;
+    float *zr = c->work, *zi = c->work + n;
+
+    /* Even samples as real parts, odd samples as imaginary parts */
+    for (unsigned k = 0; k < n; k++)
+    {
+        zr[k] = x[2 * k];
+        zi[k] = x[2 * k + 1];
+    }
+    FFT(c, zr, zi);
+
+    for (unsigned k = 0; k <= n; k++)
+    {
+        const unsigned k1 = k & (n - 1), k2 = (n - k) & (n - 1);
+        /* Z[k] and conj(Z[B-k]) */
+        const float ar = zr[k1], ai = zi[k1], br = zr[k2], bi = -zi[k2];
+        /* even and odd samples spectra */
+        const float er = .5f * (ar + br), ei = .5f * (ai + bi);
+        const float odr = .5f * (ai - bi), odi = -.5f * (ar - br);
+        const float wr = cosines[k], wi = -sines[k];
+
+        xr[k] = er + odr * wr - odi * wi;
+        xi[k] = ei + odr * wi + odi * wr;
+    }
+}
+
+/* Transforms B+1 bins back to 2B real samples */
+static void RealIFFT(const struct convolver *c, const float *xr,
+                     const float *xi, float *x)
+{
+    const unsigned n = c->block;
+    const float *cosines = c->post, *sines = c->post + n + 1;
+    float *zr = c->work, *zi = c->work + n;
+
+    for (unsigned k = 0; k < n; k++)
+    {
+        /* X[k] and conj(X[B-k]) */
+        const float ar = xr[k], ai = xi[k], br = xr[n - k], bi = -xi[n - k];
+        const float er = ar + br, ei = ai + bi;
+        const float dr = ar - br, di = ai - bi;
+        const float wr = cosines[k], wi = sines[k];
+        const float odr = dr * wr - di * wi, odi = dr * wi + di * wr;
+
+        /* conjugated, so that the forward FFT computes the inverse one */
+        zr[k] = er - odi;
+        zi[k] = -(ei + odr);
+    }
+    FFT(c, zr, zi);
+
+    const float scale = .5f / n;
+    for (unsigned k = 0; k < n; k++)
+    {
+        x[2 * k] = zr[k] * scale;
+        x[2 * k + 1] = -zi[k] * scale;
+    }
+}
+
+static void MultiplyAdd(float *restrict yr, float *restrict yi,
+                        const float *xr, const float *xi,
+                        const float *hr, const float *hi, size_t count)
+{
+    for (size_t k = 0; k < count; k++)
+    {
+        yr[k] += xr[k] * hr[k] - xi[k] * hi[k];
+        yi[k] += xr[k] * hi[k] + xi[k] * hr[k];
+    }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static void MultiplyAdd_SSE2(float *restrict yr, float *restrict yi,
+                             const float *xr, const float *xi,
+                             const float *hr, const float *hi, size_t count)
+{
+    for (size_t k = 0; k < count; k += 4)
+    {
+        __m128 ar = _mm_load_ps(xr + k), ai = _mm_load_ps(xi + k);
+        __m128 br = _mm_load_ps(hr + k), bi = _mm_load_ps(hi + k);
+        __m128 re = _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi));
+        __m128 im = _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br));
+
+        _mm_store_ps(yr + k, _mm_add_ps(_mm_load_ps(yr + k), re));
+        _mm_store_ps(yi + k, _mm_add_ps(_mm_load_ps(yi + k), im));
+    }
+}
+#endif
+
+static float *Spectrum(const struct convolver *c, float *base, size_t index)
+{
+    return base + index * 2 * c->stride;
+}
+
+static void ProcessBlock(struct convolver *c)
+{
+    const unsigned n = c->block;
+
+    c->slot = (c->slot + 1) % c->parts;
+
+    for (unsigned i = 0; i < c->inputs; i++)
+    {
+        float *time = c->time + i * 2 * n;
+        float *spec = Spectrum(c, c->fdl, (size_t)i * c->parts + c->slot);
+
+        RealFFT(c, time, spec, spec + c->stride);
+        memcpy(time, time + n, n * sizeof (float));
+    }
+
+    for (unsigned o = 0; o < c->outputs; o++)
+    {
+        float *out = c->out + o * n;
+        bool silent = true;
+
+        memset(c->acc, 0, 2 * c->stride * sizeof (float));
+
+        for (unsigned i = 0; i < c->inputs; i++)
+        {
+            float *const *filters =
+                c->filters + ((size_t)i * c->outputs + o) * c->parts;
+
+            for (unsigned p = 0; p < c->parts; p++)
+            {
+                const float *h = filters[p];
+                if (h == NULL)
+                    continue;
+
+                unsigned slot = (c->slot + c->parts - p) % c->parts;
+                const float *x = Spectrum(c, c->fdl,
+                                          (size_t)i * c->parts + slot);
+
+                c->multiply_add(c->acc, c->acc + c->stride, x, x + c->stride,
+                                h, h + c->stride, c->stride);
+                silent = false;
+            }
+        }
+
+        if (silent)
+        {
+            memset(out, 0, n * sizeof (float));
+            continue;
+        }
+
+        /* Overlap-save: only the second half is free of aliasing */
+        RealIFFT(c, c->acc, c->acc + c->stride, c->frame);
+        memcpy(out, c->frame + n, n * sizeof (float));
+    }
+}
+
+void convolver_Process(struct convolver *c, const float *in, float *out,
+                       size_t frames)
+{
+    const unsigned n = c->block;
+
+    while (frames > 0)
+    {
+        size_t count = __MIN(frames, n - c->pos);
+
+        for (unsigned i = 0; i < c->inputs; i++)
+        {
+            float *time = c->time + i * 2 * n + n + c->pos;
+            for (size_t f = 0; f < count; f++)
+                time[f] = in[f * c->inputs + i];
+        }
+
+        for (unsigned o = 0; o < c->outputs; o++)
+        {
+            const float *block = c->out + o * n + c->pos;
+            for (size_t f = 0; f < count; f++)
+                out[f * c->outputs + o] = block[f];
+        }
+
+        in += count * c->inputs;
+        out += count * c->outputs;
+        frames -= count;
+        c->pos += count;
+
+        if (c->pos == n)
+        {
+            ProcessBlock(c);
+            c->pos = 0;
+        }
+    }
+}
+
+int convolver_SetFilter(struct convolver *c, unsigned in, unsigned out,
+                        const float *ir, size_t count, size_t stride)
+{
+    const unsigned n = c->block;
+    float **filters = c->filters + ((size_t)in * c->outputs + out) * c->parts;
+
+    assert(in < c->inputs && out < c->outputs);
+
+    for (unsigned p = 0; p < c->parts; p++)
+    {
+        size_t first = (size_t)p * n;
+        size_t taps = (ir != NULL && count > first) ? __MIN(count - first, n)
+                                                    : 0;
+        bool zero = true;
+
+        /* Partition padded with as many zeroes */
+        memset(c->frame, 0, 2 * n * sizeof (float));
+        for (size_t k = 0; k < taps; k++)
+        {
+            c->frame[k] = ir[(first + k) * stride];
+            if (c->frame[k] != 0.f)
+                zero = false;
+        }
+
+        if (zero)
+        {
+            aligned_free(filters[p]);
+            filters[p] = NULL;
+            continue;
+        }
+
+        if (filters[p] == NULL)
+        {
+            filters[p] = AllocFloats(2 * c->stride);
+            if (unlikely(filters[p] == NULL))
+                return VLC_ENOMEM;
+        }
+        RealFFT(c, c->frame, filters[p], filters[p] + c->stride);
+    }
+    return VLC_SUCCESS;
+}
+
+void convolver_Reset(struct convolver *c)
+{
+    const unsigned n = c->block;
+
+    memset(c->time, 0, (size_t)c->inputs * 2 * n * sizeof (float));
+    memset(c->fdl, 0,
+           (size_t)c->inputs * c->parts * 2 * c->stride * sizeof (float));
+    memset(c->out, 0, (size_t)c->outputs * n * sizeof (float));
+    c->pos = 0;
+    c->slot = 0;
+}
+
+static struct convolver *ConvolverNew(unsigned block, unsigned inputs,
+                                      unsigned outputs, size_t length,
+                                      bool simd)
+{
+    if (block < 4 || (block & (block - 1)) || inputs == 0 || outputs == 0
+     || length == 0)
+        return NULL;
+
+    struct convolver *c = calloc(1, sizeof (*c));
+    if (unlikely(c == NULL))
+        return NULL;
+
+    const unsigned n = block;
+    c->block = n;
+    c->inputs = inputs;
+    c->outputs = outputs;
+    c->parts = (length + n - 1) / n;
+    c->stride = (n + 1 + 3) & ~3u;
+    c->multiply_add = MultiplyAdd;
+#ifdef HAVE_SSE2_INTRINSICS
+    if (simd && vlc_CPU_SSE2())
+        c->multiply_add = MultiplyAdd_SSE2;
+#else
+    (void) simd;
+#endif
+
+    c->bitrev = malloc(n * sizeof (*c->bitrev));
+    c->twiddles = AllocFloats(n);
+    c->post = AllocFloats(2 * (n + 1));
+    c->time = AllocFloats((size_t)inputs * 2 * n);
+    c->fdl = AllocFloats((size_t)inputs * c->parts * 2 * c->stride);
+    c->filters = calloc((size_t)inputs * outputs * c->parts,
+                        sizeof (*c->filters));
+    c->acc = AllocFloats(2 * c->stride);
+    c->work = AllocFloats(2 * n);
+    c->frame = AllocFloats(2 * n);
+    c->out = AllocFloats((size_t)outputs * n);
+
+    if (unlikely(c->bitrev == NULL || c->twiddles == NULL || c->post == NULL
+              || c->time == NULL || c->fdl == NULL || c->filters == NULL
+              || c->acc == NULL || c->work == NULL || c->frame == NULL
+              || c->out == NULL))
+    {
+        convolver_Delete(c);
+        return NULL;
+    }
+
+    unsigned bits = 0;
+    while ((1u << bits) < n)
+        bits++;
+    for (unsigned i = 0; i < n; i++)
+    {
+        unsigned r = 0;
+        for (unsigned b = 0; b < bits; b++)
+            if (i & (1u << b))
+                r |= 1u << (bits - 1 - b);
+        c->bitrev[i] = r;
+    }
+
+    for (unsigned k = 0; k < n / 2; k++)
+    {
+        c->twiddles[k] = cos(2. * M_PI * k / n);
+        c->twiddles[n / 2 + k] = sin(2. * M_PI * k / n);
+    }
+    for (unsigned k = 0; k <= n; k++)
+    {
+        c->post[k] = cos(M_PI * k / n);
+        c->post[n + 1 + k] = sin(M_PI * k / n);
+    }
+    return c;
+}
+
+struct convolver *convolver_New(unsigned block, unsigned inputs,
+                                unsigned outputs, size_t length)
+{
+    return ConvolverNew(block, inputs, outputs, length, true);
+}
+
+void convolver_Delete(struct convolver *c)
+{
+    if (c->filters != NULL)
+        for (size_t i = 0; i < (size_t)c->inputs * c->outputs * c->parts; i++)
+            aligned_free(c->filters[i]);
+    free(c->filters);
+    free(c->bitrev);
+    aligned_free(c->twiddles);
+    aligned_free(c->post);
+    aligned_free(c->time);
+    aligned_free(c->fdl);
+    aligned_free(c->acc);
+    aligned_free(c->work);
+    aligned_free(c->frame);
+    aligned_free(c->out);
+    free(c);
+}
+
+#ifdef CONVOLVER_TEST
+# include <stdio.h>
+
+static float Random(unsigned *seed)
+{
+    int val = rand_r(seed);
+    return (float)val / RAND_MAX - .5f;
+}
+
+/* Checks the output against a direct convolution */
+static void Test(unsigned block, unsigned inputs, unsigned outputs,
+                 size_t length, bool sparse, bool simd)
+{
+    const size_t frames = 5 * length + 3 * block + 17;
+    unsigned seed = block + length;
+
+    float *ir = calloc(length * inputs * outputs, sizeof (float));
+    float *in = malloc(frames * inputs * sizeof (float));
+    float *out = malloc(frames * outputs * sizeof (float));
+    assert(ir != NULL && in != NULL && out != NULL);
+
+    /* Filters interleaved as input x output, as in a HRIR file */
+    for (size_t t = 0; t < length; t++)
+        for (unsigned k = 0; k < inputs * outputs; k++)
+            if (!sparse || t == (k * 131) % length)
+                ir[t * inputs * outputs + k] = Random(&seed);
+    for (size_t f = 0; f < frames * inputs; f++)
+        in[f] = Random(&seed);
+
+    struct convolver *c = ConvolverNew(block, inputs, outputs, length, simd);
+    assert(c != NULL);
+    for (unsigned i = 0; i < inputs; i++)
+        for (unsigned o = 0; o < outputs; o++)
+            assert(convolver_SetFilter(c, i, o, ir + i * outputs + o, length,
+                                       inputs * outputs) == VLC_SUCCESS);
+
+    /* Uneven chunks */
+    for (size_t done = 0, count = 1; done < frames; count = count * 3 % 1001)
+    {
+        count = __MIN(count, frames - done);
+        convolver_Process(c, in + done * inputs, out + done * outputs, count);
+        done += count;
+    }
+
+    double err = 0.;
+    for (size_t f = block; f < frames; f++)
+        for (unsigned o = 0; o < outputs; o++)
+        {
+            double ref = 0.;
+            for (unsigned i = 0; i < inputs; i++)
+                for (size_t t = 0; t < length && t <= f - block; t++)
+                    ref += ir[t * inputs * outputs + i * outputs + o]
+                         * in[(f - block - t) * inputs + i];
+            err = fmax(err, fabs(ref - out[f * outputs + o]));
+        }
+    for (size_t f = 0; f < block; f++)
+        for (unsigned o = 0; o < outputs; o++)
+            assert(out[f * outputs + o] == 0.f);
+
+    fprintf(stderr, "B %4u %ux%u taps %5zu%s%s: error %g\n", block, inputs,
+            outputs, length, sparse ? " sparse" : "", simd ? " simd" : "",
+            err);
+    assert(err < 1e-3);
+
+    convolver_Reset(c);
+    convolver_Process(c, in, out, block);
+    for (size_t f = 0; f < block * outputs; f++)
+        assert(out[f] == 0.f);
+
+    convolver_Delete(c);
+    free(out);
+    free(in);
+    free(ir);
+}
+
+int main(void)
+{
+    for (unsigned simd = 0; simd < 2; simd++)
+    {
+        Test(4, 1, 1, 1, false, simd);
+        Test(64, 1, 1, 64, false, simd);
+        Test(64, 2, 2, 1000, false, simd);
+        Test(256, 8, 2, 1100, true, simd);
+        Test(128, 16, 2, 512, false, simd);
+    }
+    return 0;
+}
+#endif
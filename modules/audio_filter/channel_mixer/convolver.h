@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * convolver.h: uniformly partitioned FFT convolution
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_CONVOLVER_H
+#define VLC_CONVOLVER_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct convolver;
+
+/**
+ * Creates a convolver mixing interleaved input channels into interleaved
+ * output channels through a matrix of FIR filters (e.g. HRIRs).
+ *
+ * The filters are cut in partitions of a block of frames, so that the cost
+ * per frame grows with the number of partitions, not of taps. A block is
+ * also the latency of the convolver.
+ *
+ * \param block frames per block, a power of two of at least 4
+ * \param inputs number of input channels
+ * \param outputs number of output channels
+ * \param length maximum length of the filters in taps
+ * \return the convolver, all filters set to zero, or NULL on error
+ */
+struct convolver *convolver_New(unsigned block, unsigned inputs,
+                                unsigned outputs, size_t length);
+
+void convolver_Delete(struct convolver *);
+
+/**
+ * Sets the filter from an input channel to an output channel.
+ *
+ * \param ir impulse response, NULL to clear the filter
+ * \param count number of taps (taps beyond the convolver length are ignored)
+ * \param stride distance between two taps in \p ir, in floats
+ * \return VLC_SUCCESS or VLC_ENOMEM
+ */
+int convolver_SetFilter(struct convolver *, unsigned in, unsigned out,
+                        const float *ir, size_t count, size_t stride);
+
+/**
+ * Filters frames. The output lags the input by one block.
+ */
+void convolver_Process(struct convolver *, const float *in, float *out,
+                       size_t frames);
+
+/**
+ * Drops the buffered input and output (e.g. on flush).
+ */
+void convolver_Reset(struct convolver *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
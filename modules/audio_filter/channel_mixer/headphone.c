@@ -29,6 +29,7 @@
 # include "config.h"
 #endif
 
+#include <errno.h>
 #include <math.h>                                        /* sqrt */
 
 #include <vlc_common.h>
@@ -36,6 +37,9 @@
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 #include <vlc_block.h>
+#include <vlc_fs.h>
+
+#include "convolver.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -43,6 +47,7 @@
 static int  OpenFilter ( vlc_object_t * );
 static void CloseFilter( vlc_object_t * );
 static block_t *Convert( filter_t *, block_t * );
+static void Flush( filter_t * );
 
 /*****************************************************************************
  * Module descriptor
@@ -70,6 +75,13 @@ static block_t *Convert( filter_t *, block_t * );
      "Dolby Surround encoded streams won't be decoded before being " \
      "processed by this filter. Enabling this setting is not recommended.")
 
+#define HEADPHONE_HRIR_TEXT N_("HRIR file")
+#define HEADPHONE_HRIR_LONGTEXT N_( \
+     "Measured head-related impulse responses to use instead of the " \
+     "built-in model: raw 32-bits floats in native byte order, at the " \
+     "sample rate of the input, interleaved with the left then right ear " \
+     "response of each input channel.")
+
 vlc_module_begin ()
     set_description( N_("Headphone virtual spatialization effect") )
     set_shortname( N_("Headphone effect") )
@@ -83,6 +95,8 @@ vlc_module_begin ()
               HEADPHONE_COMPENSATE_LONGTEXT, true )
     add_bool( "headphone-dolby", false, HEADPHONE_DOLBY_TEXT,
               HEADPHONE_DOLBY_LONGTEXT, true )
+    add_loadfile( "headphone-hrir", NULL, HEADPHONE_HRIR_TEXT,
+                  HEADPHONE_HRIR_LONGTEXT )
 
     set_capability( "audio filter", 0 )
     set_callbacks( OpenFilter, CloseFilter )
@@ -107,8 +121,14 @@ typedef struct
     float * p_overflow_buffer;
     unsigned int i_nb_atomic_operations;
     struct atomic_operation_t * p_atomic_operations;
+    struct convolver * p_convolver; /* HRIR file, if any */
 } filter_sys_t;
 
+/* Latency in HRIR mode */
+#define HEADPHONE_HRIR_BLOCK 256
+/* 2^18 taps at 48 kHz, more than 5 seconds */
+#define HEADPHONE_HRIR_MAX_LENGTH (1 << 18)
+
 /*****************************************************************************
  * Init: initialize internal data structures
  * and computes the needed atomic operations
@@ -325,6 +345,65 @@ static int Init( vlc_object_t *p_this, filter_sys_t * p_data
     return 0;
 }
 
+/*****************************************************************************
+ * LoadHRIR: set up the convolution with the measured impulse responses
+ *****************************************************************************/
+static struct convolver * LoadHRIR( filter_t * p_filter, const char * psz_path,
+                                    unsigned int i_nb_channels )
+{
+    FILE * p_file = vlc_fopen( psz_path, "rb" );
+    if( p_file == NULL )
+    {
+        msg_Err( p_filter, "cannot open HRIR file %s: %s", psz_path,
+                 vlc_strerror_c( errno ) );
+        return NULL;
+    }
+
+    struct convolver * p_convolver = NULL;
+    float * p_ir = NULL;
+    const size_t i_frame = 2 * i_nb_channels * sizeof (float);
+    long i_size = -1;
+
+    if( fseek( p_file, 0, SEEK_END ) == 0 )
+        i_size = ftell( p_file );
+    rewind( p_file );
+
+    if( i_size <= 0 || (size_t)i_size % i_frame
+     || (size_t)i_size / i_frame > HEADPHONE_HRIR_MAX_LENGTH )
+    {
+        msg_Err( p_filter, "invalid HRIR file size (%ld bytes for %u channels)",
+                 i_size, i_nb_channels );
+        goto out;
+    }
+
+    const size_t i_length = (size_t)i_size / i_frame;
+    p_ir = malloc( i_size );
+    if( p_ir == NULL || fread( p_ir, i_frame, i_length, p_file ) != i_length )
+        goto out;
+
+    p_convolver = convolver_New( HEADPHONE_HRIR_BLOCK, i_nb_channels, 2,
+                                 i_length );
+    if( p_convolver == NULL )
+        goto out;
+
+    for( unsigned int i = 0; i < i_nb_channels; i++ )
+        for( unsigned int i_ear = 0; i_ear < 2; i_ear++ )
+            if( convolver_SetFilter( p_convolver, i, i_ear,
+                                     p_ir + 2 * i + i_ear, i_length,
+                                     2 * i_nb_channels ) )
+            {
+                convolver_Delete( p_convolver );
+                p_convolver = NULL;
+                goto out;
+            }
+
+    msg_Dbg( p_filter, "using %zu taps HRIRs from %s", i_length, psz_path );
+out:
+    free( p_ir );
+    fclose( p_file );
+    return p_convolver;
+}
+
 /*****************************************************************************
  * DoWork: convert a buffer
  *****************************************************************************/
@@ -354,6 +433,13 @@ static void DoWork( filter_t * p_filter,
     p_out = (float *)p_out_buf->p_buffer;
     i_out_size = p_out_buf->i_buffer;
 
+    if( p_sys->p_convolver != NULL )
+    {
+        convolver_Process( p_sys->p_convolver, p_in, p_out,
+                           p_out_buf->i_nb_samples );
+        return;
+    }
+
     /* Slide the overflow buffer */
     p_overflow = (uint8_t *) p_sys->p_overflow_buffer;
     i_overflow_size = p_sys->i_overflow_buffer_size;
@@ -456,6 +542,7 @@ static int OpenFilter( vlc_object_t *p_this )
     p_sys->p_overflow_buffer = NULL;
     p_sys->i_nb_atomic_operations = 0;
     p_sys->p_atomic_operations = NULL;
+    p_sys->p_convolver = NULL;
 
     if( Init( VLC_OBJECT(p_filter), p_sys
                 , aout_FormatNbChannels ( &(p_filter->fmt_in.audio) )
@@ -479,10 +566,21 @@ static int OpenFilter( vlc_object_t *p_this )
         p_filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_5_0;
     }
     p_filter->pf_audio_filter = Convert;
+    p_filter->pf_flush = Flush;
 
     aout_FormatPrepare(&p_filter->fmt_in.audio);
     aout_FormatPrepare(&p_filter->fmt_out.audio);
 
+    char *psz_hrir = var_InheritString( p_filter, "headphone-hrir" );
+    if( psz_hrir != NULL )
+    {
+        p_sys->p_convolver = LoadHRIR( p_filter, psz_hrir,
+                                aout_FormatNbChannels( &p_filter->fmt_in.audio ) );
+        if( p_sys->p_convolver == NULL )
+            msg_Warn( p_filter, "falling back to the built-in model" );
+        free( psz_hrir );
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -494,11 +592,23 @@ static void CloseFilter( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    if( p_sys->p_convolver != NULL )
+        convolver_Delete( p_sys->p_convolver );
     free( p_sys->p_overflow_buffer );
     free( p_sys->p_atomic_operations );
     free( p_sys );
 }
 
+static void Flush( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_convolver != NULL )
+        convolver_Reset( p_sys->p_convolver );
+    if( p_sys->p_overflow_buffer != NULL )
+        memset( p_sys->p_overflow_buffer, 0, p_sys->i_overflow_buffer_size );
+}
+
 static block_t *Convert( filter_t *p_filter, block_t *p_block )
 {
     if( !p_block || !p_block->i_nb_samples )
@@ -512,7 +622,7 @@ static block_t *Convert( filter_t *p_filter, block_t *p_block )
         aout_FormatNbChannels( &(p_filter->fmt_out.audio) ) /
         aout_FormatNbChannels( &(p_filter->fmt_in.audio) );
 
-    block_t *p_out = block_Alloc( i_out_size );
+    block_t *p_out = filter_NewAudioBuffer( p_filter, i_out_size );
     if( !p_out )
     {
         msg_Warn( p_filter, "can't get output buffer" );
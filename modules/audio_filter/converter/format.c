@@ -30,56 +30,29 @@
 #ifdef HAVE_CONFIG_H
 # include "config.h"
 #endif
+#ifdef AUDIO_FORMAT_TEST
+# undef NDEBUG
+#endif
 #include <math.h>
 #include <assert.h>
 
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_block.h>
 #include <vlc_filter.h>
 
-/*****************************************************************************
- * Module descriptor
- *****************************************************************************/
-static int  Open(vlc_object_t *);
-
-vlc_module_begin()
-    set_description(N_("Audio filter for PCM format conversion"))
-    set_category(CAT_AUDIO)
-    set_subcategory(SUBCAT_AUDIO_MISC)
-    set_capability("audio converter", 1)
-    set_callbacks(Open, NULL)
-vlc_module_end()
-
-/*****************************************************************************
- * Local prototypes
- *****************************************************************************/
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
 
 typedef block_t *(*cvt_t)(filter_t *, block_t *);
-static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst);
-
-static int Open(vlc_object_t *object)
-{
-    filter_t     *filter = (filter_t *)object;
-
-    const es_format_t *src = &filter->fmt_in;
-    es_format_t       *dst = &filter->fmt_out;
-
-    if (!AOUT_FMTS_SIMILAR(&src->audio, &dst->audio))
-        return VLC_EGENERIC;
-    if (src->i_codec == dst->i_codec)
-        return VLC_EGENERIC;
-
-    filter->pf_audio_filter = FindConversion(src->i_codec, dst->i_codec);
-    if (filter->pf_audio_filter == NULL)
-        return VLC_EGENERIC;
-
-    msg_Dbg(filter, "%4.4s->%4.4s, bits per sample: %i->%i",
-            (char *)&src->i_codec, (char *)&dst->i_codec,
-            src->audio.i_bitspersample, dst->audio.i_bitspersample);
-    return VLC_SUCCESS;
-}
 
 
 /*** from U8 ***/
@@ -153,6 +126,21 @@ out:
 
 
 /*** from S16N ***/
+static inline float S16toFl32Sample(int16_t s)
+{
+#if 0
+    /* Slow version */
+    return (float)s / 32768.f;
+#else
+    /* This is Walken's trick based on IEEE float format. On my PIII
+     * this takes 16 seconds to perform one billion conversions, instead
+     * of 19 seconds for the above division. */
+    union { float f; int32_t i; } u;
+    u.i = s + 0x43c00000;
+    return u.f - 384.f;
+#endif
+}
+
 static block_t *S16toU8(filter_t *filter, block_t *b)
 {
     VLC_UNUSED(filter);
@@ -175,18 +163,7 @@ static block_t *S16toFl32(filter_t *filter, block_t *bsrc)
     int16_t *src = (int16_t *)bsrc->p_buffer;
     float   *dst = (float *)bdst->p_buffer;
     for (size_t i = bsrc->i_buffer / 2; i--;)
-#if 0
-        /* Slow version */
-        *dst++ = (float)*src++ / 32768.f;
-#else
-    {   /* This is Walken's trick based on IEEE float format. On my PIII
-         * this takes 16 seconds to perform one billion conversions, instead
-         * of 19 seconds for the above division. */
-        union { float f; int32_t i; } u;
-        u.i = *src++ + 0x43c00000;
-        *dst++ = u.f - 384.f;
-    }
-#endif
+        *dst++ = S16toFl32Sample(*src++);
 out:
     block_Release(bsrc);
     VLC_UNUSED(filter);
@@ -218,7 +195,7 @@ static block_t *S16toFl64(filter_t *filter, block_t *bsrc)
 
     block_CopyProperties(bdst, bsrc);
     int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
+    double  *dst = (double *)bdst->p_buffer;
     for (size_t i = bsrc->i_buffer / 2; i--;)
         *dst++ = (double)*src++ / 32768.;
 out:
@@ -249,49 +226,55 @@ static block_t *Fl32toU8(filter_t *filter, block_t *b)
     return b;
 }
 
+static inline int16_t Fl32toS16Sample(float f)
+{
+#if 0
+    /* Slow version. */
+    if (f >= 1.0) return 32767;
+    else if (f < -1.0) return -32768;
+    else return lroundf(f * 32768.f);
+#else
+    /* This is Walken's trick based on IEEE float format. */
+    union { float f; int32_t i; } u;
+    u.f = f + 384.f;
+    if (u.i > 0x43c07fff)
+        return 32767;
+    else if (u.i < 0x43bf8000)
+        return -32768;
+    else
+        return u.i - 0x43c00000;
+#endif
+}
+
 static block_t *Fl32toS16(filter_t *filter, block_t *b)
 {
     VLC_UNUSED(filter);
     float   *src = (float *)b->p_buffer;
     int16_t *dst = (int16_t *)src;
-    for (int i = b->i_buffer / 4; i--;) {
-#if 0
-        /* Slow version. */
-        if (*src >= 1.0) *dst = 32767;
-        else if (*src < -1.0) *dst = -32768;
-        else *dst = lroundf(*src * 32768.f);
-        src++; dst++;
-#else
-        /* This is Walken's trick based on IEEE float format. */
-        union { float f; int32_t i; } u;
-        u.f = *src++ + 384.f;
-        if (u.i > 0x43c07fff)
-            *dst++ = 32767;
-        else if (u.i < 0x43bf8000)
-            *dst++ = -32768;
-        else
-            *dst++ = u.i - 0x43c00000;
-#endif
-    }
+    for (int i = b->i_buffer / 4; i--;)
+        *dst++ = Fl32toS16Sample(*src++);
     b->i_buffer /= 2;
     return b;
 }
 
+static inline int32_t Fl32toS32Sample(float f)
+{
+    float s = f * 2147483648.f;
+    if (s >= 2147483647.f)
+        return 2147483647;
+    else
+    if (s <= -2147483648.f)
+        return -2147483648;
+    else
+        return lroundf(s);
+}
+
 static block_t *Fl32toS32(filter_t *filter, block_t *b)
 {
     float   *src = (float *)b->p_buffer;
     int32_t *dst = (int32_t *)src;
     for (size_t i = b->i_buffer / 4; i--;)
-    {
-        float s = *(src++) * 2147483648.f;
-        if (s >= 2147483647.f)
-            *(dst++) = 2147483647;
-        else
-        if (s <= -2147483648.f)
-            *(dst++) = -2147483648;
-        else
-            *(dst++) = lroundf(s);
-    }
+        *(dst++) = Fl32toS32Sample(*(src++));
     VLC_UNUSED(filter);
     return b;
 }
@@ -438,7 +421,236 @@ static block_t *Fl64toS32(filter_t *filter, block_t *b)
 }
 
 
-/* */
+/*** SIMD versions ***/
+/* These give the same results as the C versions above, including when
+ * clipping. The in-place conversions never write further than they read. */
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static block_t *S16toFl32_SSE2(filter_t *filter, block_t *bsrc)
+{
+    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    if (unlikely(bdst == NULL))
+        goto out;
+
+    block_CopyProperties(bdst, bsrc);
+    int16_t *src = (int16_t *)bsrc->p_buffer;
+    float   *dst = (float *)bdst->p_buffer;
+    size_t i = bsrc->i_buffer / 2;
+    const __m128 scale = _mm_set1_ps(1.f / 32768.f);
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)src);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        _mm_storeu_ps(dst,     _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    for (; i > 0; i--)
+        *dst++ = S16toFl32Sample(*src++);
+out:
+    block_Release(bsrc);
+    VLC_UNUSED(filter);
+    return bdst;
+}
+
+VLC_SSE2
+static block_t *Fl32toS16_SSE2(filter_t *filter, block_t *b)
+{
+    VLC_UNUSED(filter);
+    float   *src = (float *)b->p_buffer;
+    int16_t *dst = (int16_t *)src;
+    size_t i = b->i_buffer / 4;
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+    const __m128 max = _mm_set1_ps(32767.f);
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+    {
+        __m128 f0 = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        __m128 f1 = _mm_mul_ps(_mm_loadu_ps(src + 4), scale);
+        f0 = _mm_min_ps(_mm_max_ps(f0, min), max);
+        f1 = _mm_min_ps(_mm_max_ps(f1, min), max);
+        _mm_storeu_si128((__m128i *)dst,
+                         _mm_packs_epi32(_mm_cvtps_epi32(f0),
+                                         _mm_cvtps_epi32(f1)));
+    }
+    for (; i > 0; i--)
+        *dst++ = Fl32toS16Sample(*src++);
+    b->i_buffer /= 2;
+    return b;
+}
+
+/* Rounds half away from zero like lroundf(), and saturates */
+VLC_SSE2
+static inline __m128i Fl32toS32_SSE2_Vector(__m128 f)
+{
+    const __m128 scale = _mm_set1_ps(2147483648.f);
+    const __m128 half = _mm_set1_ps(.5f);
+    const __m128 mhalf = _mm_set1_ps(-.5f);
+
+    __m128 s = _mm_mul_ps(f, scale);
+    __m128i t = _mm_cvttps_epi32(s);
+    __m128 d = _mm_sub_ps(s, _mm_cvtepi32_ps(t));
+    t = _mm_sub_epi32(t, _mm_castps_si128(_mm_cmpge_ps(d, half)));
+    t = _mm_add_epi32(t, _mm_castps_si128(_mm_cmple_ps(d, mhalf)));
+
+    /* saturate: the truncation gives INT32_MIN for all the values out of
+     * range, and then the rounding is wrong for them */
+    __m128i over = _mm_castps_si128(_mm_cmpge_ps(s, scale));
+    __m128i under = _mm_castps_si128(_mm_cmple_ps(s, _mm_set1_ps(-2147483648.f)));
+    t = _mm_or_si128(_mm_andnot_si128(over, t), _mm_srli_epi32(over, 1));
+    return _mm_or_si128(_mm_andnot_si128(under, t), _mm_slli_epi32(under, 31));
+}
+
+VLC_SSE2
+static block_t *Fl32toS32_SSE2(filter_t *filter, block_t *b)
+{
+    float   *src = (float *)b->p_buffer;
+    int32_t *dst = (int32_t *)src;
+    size_t i = b->i_buffer / 4;
+
+    for (; i >= 4; i -= 4, src += 4, dst += 4)
+        _mm_storeu_si128((__m128i *)dst,
+                         Fl32toS32_SSE2_Vector(_mm_loadu_ps(src)));
+    for (; i > 0; i--)
+        *(dst++) = Fl32toS32Sample(*(src++));
+    VLC_UNUSED(filter);
+    return b;
+}
+
+VLC_SSE2
+static block_t *S32toFl32_SSE2(filter_t *filter, block_t *b)
+{
+    VLC_UNUSED(filter);
+    int32_t *src = (int32_t*)b->p_buffer;
+    float   *dst = (float *)src;
+    size_t i = b->i_buffer / 4;
+    const __m128 scale = _mm_set1_ps(1.f / 2147483648.f);
+
+    for (; i >= 4; i -= 4, src += 4, dst += 4)
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(
+                      _mm_loadu_si128((const __m128i *)src)), scale));
+    for (; i > 0; i--)
+        *dst++ = (float)(*src++) / 2147483648.f;
+    return b;
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static block_t *S16toFl32_AVX2(filter_t *filter, block_t *bsrc)
+{
+    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    if (unlikely(bdst == NULL))
+        goto out;
+
+    block_CopyProperties(bdst, bsrc);
+    int16_t *src = (int16_t *)bsrc->p_buffer;
+    float   *dst = (float *)bdst->p_buffer;
+    size_t i = bsrc->i_buffer / 2;
+    const __m256 scale = _mm256_set1_ps(1.f / 32768.f);
+
+    for (; i >= 16; i -= 16, src += 16, dst += 16)
+    {
+        __m256i lo = _mm256_cvtepi16_epi32(
+                        _mm_loadu_si128((const __m128i *)src));
+        __m256i hi = _mm256_cvtepi16_epi32(
+                        _mm_loadu_si128((const __m128i *)(src + 8)));
+        _mm256_storeu_ps(dst,     _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(dst + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+    for (; i > 0; i--)
+        *dst++ = S16toFl32Sample(*src++);
+out:
+    block_Release(bsrc);
+    VLC_UNUSED(filter);
+    return bdst;
+}
+
+VLC_AVX2
+static block_t *Fl32toS16_AVX2(filter_t *filter, block_t *b)
+{
+    VLC_UNUSED(filter);
+    float   *src = (float *)b->p_buffer;
+    int16_t *dst = (int16_t *)src;
+    size_t i = b->i_buffer / 4;
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 min = _mm256_set1_ps(-32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f);
+
+    for (; i >= 16; i -= 16, src += 16, dst += 16)
+    {
+        __m256 f0 = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+        __m256 f1 = _mm256_mul_ps(_mm256_loadu_ps(src + 8), scale);
+        f0 = _mm256_min_ps(_mm256_max_ps(f0, min), max);
+        f1 = _mm256_min_ps(_mm256_max_ps(f1, min), max);
+        /* the packing interleaves the 128-bits lanes of its operands */
+        __m256i s = _mm256_packs_epi32(_mm256_cvtps_epi32(f0),
+                                       _mm256_cvtps_epi32(f1));
+        _mm256_storeu_si256((__m256i *)dst,
+                            _mm256_permute4x64_epi64(s, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    for (; i > 0; i--)
+        *dst++ = Fl32toS16Sample(*src++);
+    b->i_buffer /= 2;
+    return b;
+}
+
+VLC_AVX2
+static block_t *Fl32toS32_AVX2(filter_t *filter, block_t *b)
+{
+    float   *src = (float *)b->p_buffer;
+    int32_t *dst = (int32_t *)src;
+    size_t i = b->i_buffer / 4;
+    const __m256 scale = _mm256_set1_ps(2147483648.f);
+    const __m256 mscale = _mm256_set1_ps(-2147483648.f);
+    const __m256 half = _mm256_set1_ps(.5f);
+    const __m256 mhalf = _mm256_set1_ps(-.5f);
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+    {
+        /* same as Fl32toS32_SSE2_Vector() */
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+        __m256i t = _mm256_cvttps_epi32(s);
+        __m256 d = _mm256_sub_ps(s, _mm256_cvtepi32_ps(t));
+        t = _mm256_sub_epi32(t, _mm256_castps_si256(
+                                    _mm256_cmp_ps(d, half, _CMP_GE_OQ)));
+        t = _mm256_add_epi32(t, _mm256_castps_si256(
+                                    _mm256_cmp_ps(d, mhalf, _CMP_LE_OQ)));
+
+        __m256i over = _mm256_castps_si256(_mm256_cmp_ps(s, scale, _CMP_GE_OQ));
+        __m256i under = _mm256_castps_si256(_mm256_cmp_ps(s, mscale, _CMP_LE_OQ));
+        t = _mm256_or_si256(_mm256_andnot_si256(over, t),
+                            _mm256_srli_epi32(over, 1));
+        _mm256_storeu_si256((__m256i *)dst,
+                            _mm256_or_si256(_mm256_andnot_si256(under, t),
+                                            _mm256_slli_epi32(under, 31)));
+    }
+    for (; i > 0; i--)
+        *(dst++) = Fl32toS32Sample(*(src++));
+    VLC_UNUSED(filter);
+    return b;
+}
+
+VLC_AVX2
+static block_t *S32toFl32_AVX2(filter_t *filter, block_t *b)
+{
+    VLC_UNUSED(filter);
+    int32_t *src = (int32_t*)b->p_buffer;
+    float   *dst = (float *)src;
+    size_t i = b->i_buffer / 4;
+    const __m256 scale = _mm256_set1_ps(1.f / 2147483648.f);
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+        _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(
+                         _mm256_loadu_si256((const __m256i *)src)), scale));
+    for (; i > 0; i--)
+        *dst++ = (float)(*src++) / 2147483648.f;
+    return b;
+}
+#endif
+
 /* */
 static const struct {
     vlc_fourcc_t src;
@@ -473,8 +685,38 @@ static const struct {
     { 0, 0, NULL }
 };
 
-static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst)
+static const struct {
+    vlc_fourcc_t src;
+    vlc_fourcc_t dst;
+    cvt_t sse2;
+    cvt_t avx2;
+} cvt_simd[] = {
+#ifdef HAVE_SSE2_INTRINSICS
+# ifdef HAVE_AVX2_INTRINSICS
+#  define CVT_SIMD(a, b) a##to##b##_SSE2, a##to##b##_AVX2
+# else
+#  define CVT_SIMD(a, b) a##to##b##_SSE2, NULL
+# endif
+    { VLC_CODEC_S16N, VLC_CODEC_FL32, CVT_SIMD(S16, Fl32) },
+    { VLC_CODEC_FL32, VLC_CODEC_S16N, CVT_SIMD(Fl32, S16) },
+    { VLC_CODEC_FL32, VLC_CODEC_S32N, CVT_SIMD(Fl32, S32) },
+    { VLC_CODEC_S32N, VLC_CODEC_FL32, CVT_SIMD(S32, Fl32) },
+# undef CVT_SIMD
+#endif
+    { 0, 0, NULL, NULL }
+};
+
+static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst, bool simd)
 {
+    for (int i = 0; simd && cvt_simd[i].sse2; i++) {
+        if (cvt_simd[i].src != src || cvt_simd[i].dst != dst)
+            continue;
+        if (cvt_simd[i].avx2 && vlc_CPU_AVX2())
+            return cvt_simd[i].avx2;
+        if (vlc_CPU_SSE2())
+            return cvt_simd[i].sse2;
+    }
+
     for (int i = 0; cvt_directs[i].convert; i++) {
         if (cvt_directs[i].src == src &&
             cvt_directs[i].dst == dst)
@@ -482,3 +724,54 @@ static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst)
     }
     return NULL;
 }
+
+#ifndef AUDIO_FORMAT_TEST
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open(vlc_object_t *);
+
+vlc_module_begin()
+    set_description(N_("Audio filter for PCM format conversion"))
+    set_category(CAT_AUDIO)
+    set_subcategory(SUBCAT_AUDIO_MISC)
+    set_capability("audio converter", 1)
+    set_callbacks(Open, NULL)
+vlc_module_end()
+
+static int Open(vlc_object_t *object)
+{
+    filter_t     *filter = (filter_t *)object;
+
+    const es_format_t *src = &filter->fmt_in;
+    es_format_t       *dst = &filter->fmt_out;
+
+    if (!AOUT_FMTS_SIMILAR(&src->audio, &dst->audio))
+        return VLC_EGENERIC;
+    if (src->i_codec == dst->i_codec)
+        return VLC_EGENERIC;
+
+    filter->pf_audio_filter = FindConversion(src->i_codec, dst->i_codec, true);
+    if (filter->pf_audio_filter == NULL)
+        return VLC_EGENERIC;
+
+    msg_Dbg(filter, "%4.4s->%4.4s, bits per sample: %i->%i",
+            (char *)&src->i_codec, (char *)&dst->i_codec,
+            src->audio.i_bitspersample, dst->audio.i_bitspersample);
+    return VLC_SUCCESS;
+}
+
+#else /* AUDIO_FORMAT_TEST */
+#include "../kernel_test.h"
+
+int main(int argc, char **argv)
+{
+    static const vlc_fourcc_t formats[] = {
+        VLC_CODEC_U8, VLC_CODEC_S16N, VLC_CODEC_S32N,
+        VLC_CODEC_FL32, VLC_CODEC_FL64,
+    };
+
+    return AudioKernelTestConvert(argc, argv, formats, ARRAY_SIZE(formats),
+                                  FindConversion);
+}
+#endif /* AUDIO_FORMAT_TEST */
@@ -38,6 +38,7 @@
 #include <vlc_filter.h>
 
 #include "equalizer_presets.h"
+#include "biquad.h"
 
 /* TODO:
  *  - optimize a bit (you can hardly do slower ;)
@@ -113,13 +114,11 @@ typedef struct
     float f_gamp;   /* Global preamp */
     bool b_2eqz;
 
-    /* Filter state */
-    float x[32][2];
-    float y[32][128][2];
-
-    /* Second filter state */
-    float x2[32][2];
-    float y2[32][128][2];
+    /* Filters, one lane per band of each channel, for each pass */
+    int i_channels;
+    struct biquad_bank *p_bank;
+    struct biquad_bank *p_bank2;
+    float *p_lanes; /* EQZ_CHUNK frames of lanes */
 
     vlc_mutex_t lock;
 } filter_sys_t;
@@ -127,8 +126,11 @@ typedef struct
 static block_t *DoWork( filter_t *, block_t * );
 
 #define EQZ_IN_FACTOR (0.25f)
-static int  EqzInit( filter_t *, int );
-static void EqzFilter( filter_t *, float *, float *, int, int );
+/* Bands of a channel, rounded up to whole vectors of lanes */
+#define EQZ_LANES ((EQZ_BANDS_MAX + 3) & ~3)
+#define EQZ_CHUNK 256
+static int  EqzInit( filter_t *, int, int );
+static void EqzFilter( filter_t *, float *, const float *, int );
 static void EqzClean( filter_t * );
 
 static int PresetCallback ( vlc_object_t *, char const *, vlc_value_t,
@@ -155,7 +157,8 @@ static int Open( vlc_object_t *p_this )
         return VLC_ENOMEM;
 
     vlc_mutex_init( &p_sys->lock );
-    if( EqzInit( p_filter, p_filter->fmt_in.audio.i_rate ) != VLC_SUCCESS )
+    if( EqzInit( p_filter, p_filter->fmt_in.audio.i_rate,
+                 aout_FormatNbChannels( &p_filter->fmt_in.audio ) ) != VLC_SUCCESS )
     {
         vlc_mutex_destroy( &p_sys->lock );
         free( p_sys );
@@ -191,8 +194,7 @@ static void Close( vlc_object_t *p_this )
 static block_t * DoWork( filter_t * p_filter, block_t * p_in_buf )
 {
     EqzFilter( p_filter, (float*)p_in_buf->p_buffer,
-               (float*)p_in_buf->p_buffer, p_in_buf->i_nb_samples,
-               aout_FormatNbChannels( &p_filter->fmt_in.audio ) );
+               (float*)p_in_buf->p_buffer, p_in_buf->i_nb_samples );
     return p_in_buf;
 }
 
@@ -276,7 +278,7 @@ static inline float EqzConvertdB( float db )
     return EQZ_IN_FACTOR * ( powf( 10.0f, db / 20.0f ) - 1.0f );
 }
 
-static int EqzInit( filter_t *p_filter, int i_rate )
+static int EqzInit( filter_t *p_filter, int i_rate, int i_channels )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     eqz_config_t cfg;
@@ -285,6 +287,11 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     vlc_object_t *p_aout = vlc_object_parent(p_filter);
     int i_ret = VLC_ENOMEM;
 
+    p_sys->p_bank = p_sys->p_bank2 = NULL;
+    p_sys->p_lanes = NULL;
+    if( i_channels <= 0 || i_channels > AOUT_CHAN_MAX )
+        return VLC_EGENERIC;
+
     bool b_vlcFreqs = var_InheritBool( p_aout, "equalizer-vlcfreqs" );
     EqzCoeffs( i_rate, 1.0f, b_vlcFreqs, &cfg );
 
@@ -315,20 +322,29 @@ static int EqzInit( filter_t *p_filter, int i_rate )
         p_sys->f_amp[i] = 0.0f;
     }
 
-    /* Filter state */
-    for( ch = 0; ch < 32; ch++ )
+    /* Filter state: each band is a resonator
+     * y[n] = alpha * (x[n] - x[n-2]) + gamma * y[n-1] - beta * y[n-2] */
+    p_sys->i_channels = i_channels;
+    p_sys->p_bank = biquad_bank_New( i_channels * EQZ_LANES, 1 );
+    p_sys->p_bank2 = biquad_bank_New( i_channels * EQZ_LANES, 1 );
+    p_sys->p_lanes = vlc_alloc( EQZ_CHUNK * i_channels * EQZ_LANES,
+                                sizeof(float) );
+    if( !p_sys->p_bank || !p_sys->p_bank2 || !p_sys->p_lanes )
     {
-        p_sys->x[ch][0]  =
-        p_sys->x[ch][1]  =
-        p_sys->x2[ch][0] =
-        p_sys->x2[ch][1] = 0.0f;
+        free( p_sys->f_amp );
+        goto error;
+    }
 
+    for( ch = 0; ch < i_channels; ch++ )
+    {
         for( i = 0; i < p_sys->i_band; i++ )
         {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0f;
+            const struct biquad_coeffs band = {
+                .b0 = p_sys->f_alpha[i], .b1 = 0.0f, .b2 = -p_sys->f_alpha[i],
+                .a1 = -p_sys->f_gamma[i], .a2 = p_sys->f_beta[i],
+            };
+            biquad_bank_Set( p_sys->p_bank, 0, ch * EQZ_LANES + i, &band );
+            biquad_bank_Set( p_sys->p_bank2, 0, ch * EQZ_LANES + i, &band );
         }
     }
 
@@ -379,71 +395,83 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     return VLC_SUCCESS;
 
 error:
+    if( p_sys->p_bank )
+        biquad_bank_Delete( p_sys->p_bank );
+    if( p_sys->p_bank2 )
+        biquad_bank_Delete( p_sys->p_bank2 );
+    free( p_sys->p_lanes );
     free( p_sys->f_alpha );
     free( p_sys->f_beta );
     free( p_sys->f_gamma );
     return i_ret;
 }
 
-static void EqzFilter( filter_t *p_filter, float *out, float *in,
-                       int i_samples, int i_channels )
+/* Runs the bands of each channel on an input, and mixes them */
+static void EqzBands( filter_sys_t *p_sys, struct biquad_bank *p_bank,
+                      const float *in, float *o, int i_samples )
+{
+    const int i_channels = p_sys->i_channels;
+    float *p_lanes = p_sys->p_lanes;
+
+    for( int i = 0; i < i_samples; i++ )
+        for( int ch = 0; ch < i_channels; ch++ )
+        {
+            float *p_band = &p_lanes[(i * i_channels + ch) * EQZ_LANES];
+            for( int j = 0; j < EQZ_LANES; j++ )
+                p_band[j] = in[i * i_channels + ch];
+        }
+
+    biquad_bank_Process( p_bank, p_lanes, p_lanes, i_samples );
+
+    for( int i = 0; i < i_samples * i_channels; i++ )
+    {
+        const float *p_band = &p_lanes[i * EQZ_LANES];
+        float f_sum = 0.0f;
+
+        for( int j = 0; j < p_sys->i_band; j++ )
+            f_sum += p_band[j] * p_sys->f_amp[j];
+        o[i] = f_sum;
+    }
+}
+
+static void EqzFilter( filter_t *p_filter, float *out, const float *in,
+                       int i_samples )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    int i, ch, j;
+    const int i_channels = p_sys->i_channels;
+    float o[EQZ_CHUNK * AOUT_CHAN_MAX];
 
     vlc_mutex_lock( &p_sys->lock );
-    for( i = 0; i < i_samples; i++ )
+    while( i_samples > 0 )
     {
-        for( ch = 0; ch < i_channels; ch++ )
+        const int i_count = __MIN( i_samples, EQZ_CHUNK );
+        const int i_values = i_count * i_channels;
+
+        EqzBands( p_sys, p_sys->p_bank, in, o, i_count );
+
+        if( p_sys->b_2eqz )
         {
-            const float x = in[ch];
-            float o = 0.0f;
-
-            for( j = 0; j < p_sys->i_band; j++ )
-            {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
-
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
-
-                o += y * p_sys->f_amp[j];
-            }
-            p_sys->x[ch][1] = p_sys->x[ch][0];
-            p_sys->x[ch][0] = x;
-
-            /* Second filter */
-            if( p_sys->b_2eqz )
-            {
-                const float x2 = EQZ_IN_FACTOR * x + o;
-                o = 0.0f;
-                for( j = 0; j < p_sys->i_band; j++ )
-                {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
-
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
-
-                    o += y * p_sys->f_amp[j];
-                }
-                p_sys->x2[ch][1] = p_sys->x2[ch][0];
-                p_sys->x2[ch][0] = x2;
-
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp * p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
-            }
-            else
-            {
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
-            }
+            /* Second filter on the output of the first one */
+            for( int i = 0; i < i_values; i++ )
+                out[i] = EQZ_IN_FACTOR * in[i] + o[i];
+
+            EqzBands( p_sys, p_sys->p_bank2, out, o, i_count );
+
+            /* We add source PCM + filtered PCM */
+            for( int i = 0; i < i_values; i++ )
+                out[i] = p_sys->f_gamp * p_sys->f_gamp *
+                         ( EQZ_IN_FACTOR * out[i] + o[i] );
+        }
+        else
+        {
+            /* We add source PCM + filtered PCM */
+            for( int i = 0; i < i_values; i++ )
+                out[i] = p_sys->f_gamp * ( EQZ_IN_FACTOR * in[i] + o[i] );
         }
 
-        in  += i_channels;
-        out += i_channels;
+        in  += i_values;
+        out += i_values;
+        i_samples -= i_count;
     }
     vlc_mutex_unlock( &p_sys->lock );
 }
@@ -463,6 +491,10 @@ static void EqzClean( filter_t *p_filter )
     free( p_sys->f_gamma );
 
     free( p_sys->f_amp );
+
+    biquad_bank_Delete( p_sys->p_bank );
+    biquad_bank_Delete( p_sys->p_bank2 );
+    free( p_sys->p_lanes );
 }
 
 
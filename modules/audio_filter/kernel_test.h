@@ -0,0 +1,250 @@
+/*****************************************************************************
+ * kernel_test.h: checks and benchmarks of the vectorized audio kernels
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Included by the audio volume and converter modules when built as tests:
+ * the vectorized kernels are checked against the C ones on random samples,
+ * and the throughput of both is reported with "bench" as first argument. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_tick.h>
+#include <vlc_aout_volume.h>
+
+static const size_t test_counts[] = { 0, 1, 3, 7, 15, 16, 17, 31, 33, 1000, 4099 };
+#define BENCH_SAMPLES (1 << 18)
+
+static double RandomFloat(unsigned *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    int v = (int)(*seed >> 8) - (1 << 23);
+
+    switch ((*seed >> 4) & 3)
+    {
+        case 0: /* exact halves of the 16-bits steps */
+            return ldexp(v >> 6, -16);
+        case 1: /* exact halves of the 32-bits steps */
+            return ldexp(v, -32);
+        default: /* including out of range values */
+            return ldexp(v, -22);
+    }
+}
+
+static block_t *RandomBlock(vlc_fourcc_t format, size_t count, unsigned *seed)
+{
+    const unsigned bytes = aout_BitsPerSample(format) / 8;
+    block_t *block = block_Alloc(count * bytes);
+    assert(block != NULL);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        void *p = &block->p_buffer[i * bytes];
+
+        if (format == VLC_CODEC_FL32)
+            *(float *)p = RandomFloat(seed);
+        else if (format == VLC_CODEC_FL64)
+            *(double *)p = RandomFloat(seed);
+        else
+            for (unsigned j = 0; j < bytes; j++)
+            {
+                *seed = *seed * 1103515245 + 12345;
+                ((uint8_t *)p)[j] = *seed >> 16;
+            }
+    }
+    return block;
+}
+
+static block_t *CopyBlock(const block_t *block)
+{
+    block_t *copy = block_Alloc(block->i_buffer);
+    assert(copy != NULL);
+    memcpy(copy->p_buffer, block->p_buffer, block->i_buffer);
+    return copy;
+}
+
+static void CheckSame(const block_t *ref, const block_t *out)
+{
+    assert(ref->i_buffer == out->i_buffer);
+    assert(!memcmp(ref->p_buffer, out->p_buffer, ref->i_buffer));
+}
+
+static double Throughput(vlc_tick_t duration, unsigned loops)
+{
+    return (double) loops * BENCH_SAMPLES * CLOCK_FREQ
+           / __MAX(duration, 1) / 1000000.;
+}
+
+typedef void (*test_amplify_t)(audio_volume_t *, block_t *, float);
+
+static double BenchVolume(test_amplify_t amplify, vlc_fourcc_t format,
+                          unsigned loops)
+{
+    unsigned seed = 1;
+    block_t *block = RandomBlock(format, BENCH_SAMPLES, &seed);
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned n = 0; n < loops; n++)
+        amplify(NULL, block, (n & 1) ? .5f : 2.f);
+    vlc_tick_t duration = vlc_tick_now() - start;
+
+    block_Release(block);
+    return Throughput(duration, loops);
+}
+
+static inline int AudioKernelTestVolume(int argc, char **argv,
+                                        const vlc_fourcc_t *formats,
+                                        size_t count,
+                                        test_amplify_t (*find)(vlc_fourcc_t,
+                                                               bool))
+{
+    static const float volumes[] = {
+        0.f, .25f, .5f, .7f, 1.f, 1.3f, 2.f, 100.f, 200.f,
+    };
+    const bool bench = argc > 1 && !strcmp(argv[1], "bench");
+    const unsigned loops = argc > 2 ? atoi(argv[2]) : 200;
+    unsigned seed = 1;
+    bool tested = false;
+
+    alarm(bench ? 0 : 30);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        test_amplify_t c = find(formats[i], false);
+        test_amplify_t simd = find(formats[i], true);
+
+        if (bench)
+        {
+            printf("%4.4s volume: C %8.1f Msamples/s",
+                   (const char *)&formats[i], BenchVolume(c, formats[i], loops));
+            if (simd != c)
+                printf(", SIMD %8.1f Msamples/s",
+                       BenchVolume(simd, formats[i], loops));
+            printf("\n");
+            continue;
+        }
+        if (simd == c)
+            continue;
+        tested = true;
+
+        fprintf(stderr, "testing: %4.4s volume\n", (const char *)&formats[i]);
+        for (size_t j = 0; j < ARRAY_SIZE(test_counts); j++)
+            for (size_t k = 0; k < ARRAY_SIZE(volumes); k++)
+            {
+                block_t *ref = RandomBlock(formats[i], test_counts[j], &seed);
+                block_t *out = CopyBlock(ref);
+
+                c(NULL, ref, volumes[k]);
+                simd(NULL, out, volumes[k]);
+                CheckSame(ref, out);
+                block_Release(out);
+                block_Release(ref);
+            }
+    }
+
+    if (!bench && !tested)
+    {
+        fprintf(stderr, "WARNING: could not test any vectorized kernel\n");
+        return 77;
+    }
+    return 0;
+}
+
+typedef block_t *(*test_convert_t)(filter_t *, block_t *);
+
+static double BenchConvert(test_convert_t convert, vlc_fourcc_t src,
+                           unsigned loops)
+{
+    unsigned seed = 1;
+    block_t *block = RandomBlock(src, BENCH_SAMPLES, &seed);
+    vlc_tick_t duration = 0;
+
+    for (unsigned n = 0; n < loops; n++)
+    {
+        block_t *in = CopyBlock(block);
+        vlc_tick_t start = vlc_tick_now();
+        block_t *out = convert(NULL, in);
+        duration += vlc_tick_now() - start;
+        block_Release(out);
+    }
+
+    block_Release(block);
+    return Throughput(duration, loops);
+}
+
+static inline int AudioKernelTestConvert(int argc, char **argv,
+                                         const vlc_fourcc_t *formats,
+                                         size_t count,
+                                         test_convert_t (*find)(vlc_fourcc_t,
+                                                                vlc_fourcc_t,
+                                                                bool))
+{
+    const bool bench = argc > 1 && !strcmp(argv[1], "bench");
+    const unsigned loops = argc > 2 ? atoi(argv[2]) : 200;
+    unsigned seed = 1;
+    bool tested = false;
+
+    alarm(bench ? 0 : 30);
+
+    for (size_t i = 0; i < count; i++)
+        for (size_t j = 0; j < count; j++)
+        {
+            if (i == j)
+                continue;
+
+            test_convert_t c = find(formats[i], formats[j], false);
+            test_convert_t simd = find(formats[i], formats[j], true);
+            if (c == NULL || simd == c)
+                continue;
+
+            if (bench)
+            {
+                printf("%4.4s->%4.4s: C %8.1f Msamples/s, "
+                       "SIMD %8.1f Msamples/s\n",
+                       (const char *)&formats[i], (const char *)&formats[j],
+                       BenchConvert(c, formats[i], loops),
+                       BenchConvert(simd, formats[i], loops));
+                continue;
+            }
+            tested = true;
+
+            fprintf(stderr, "testing: %4.4s->%4.4s\n",
+                    (const char *)&formats[i], (const char *)&formats[j]);
+            for (size_t k = 0; k < ARRAY_SIZE(test_counts); k++)
+            {
+                block_t *in = RandomBlock(formats[i], test_counts[k], &seed);
+                block_t *ref = c(NULL, CopyBlock(in));
+                block_t *out = simd(NULL, in);
+
+                assert(ref != NULL && out != NULL);
+                CheckSame(ref, out);
+                block_Release(out);
+                block_Release(ref);
+            }
+        }
+
+    if (!bench && !tested)
+    {
+        fprintf(stderr, "WARNING: could not test any vectorized kernel\n");
+        return 77;
+    }
+    return 0;
+}
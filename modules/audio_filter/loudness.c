@@ -0,0 +1,669 @@
+/*****************************************************************************
+ * loudness.c: EBU R128 loudness and true peak meter
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The loudness is measured as specified by ITU-R BS.1770-4 and EBU R128:
+ * the K-weighted mean square of each channel is summed over 100 ms blocks,
+ * from which the momentary (400 ms) and short-term (3 s) loudness are
+ * derived. The integrated loudness is gated (-70 LUFS absolute gate, -10 LU
+ * relative gate) over the 400 ms momentary blocks, which are accounted in a
+ * histogram of 0.1 LU bins, so that the memory use does not grow with the
+ * duration of the program.
+ *
+ * The true peak is the peak of the signal oversampled 4 times (2 times from
+ * 96 kHz, not at all from 192 kHz). The 4 phases of the interpolation filter
+ * are computed together: that is a single vector multiply-add per tap.
+ *
+ * The audio passes through unchanged. The measurements are reported every
+ * 100 ms through the "loudness" variable of the audio output.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef LOUDNESS_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+
+#include "biquad.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+
+#define BLOCK_MS        100
+#define MOMENTARY_BLOCKS  4 /* 400 ms */
+#define SHORT_TERM_BLOCKS 30 /* 3 s */
+
+#define HIST_MIN  (-70.)    /* absolute gate */
+#define HIST_MAX  (+10.)
+#define HIST_STEP (.1)
+#define HIST_BINS 800
+
+#define KW_FRAMES 256       /* frames K-weighted at a time */
+
+#define TP_TAPS  12         /* taps per phase of the oversampling filter */
+#define TP_LANES 4          /* maximum oversampling factor */
+
+typedef float (*true_peak_t)(float *win, unsigned *pos, const float *src,
+                             size_t frames, unsigned stride,
+                             const float (*coefs)[TP_LANES]);
+
+struct loudness_channel
+{
+    double weight;          /**< 0 for the LFE */
+    double sum;             /**< sum of squares of the current block */
+    unsigned tp_pos;
+    float tp_win[2 * TP_TAPS];
+};
+
+struct loudness_meter
+{
+    unsigned channels;
+    unsigned block_frames;
+    unsigned block_pos;
+    struct biquad_bank *kweighting; /**< one lane per channel */
+    float *kw;                      /**< K-weighted samples */
+
+    unsigned tp_factor;
+    float tp_coefs[TP_TAPS][TP_LANES];
+    true_peak_t true_peak;
+    float block_peak;
+
+    double energies[SHORT_TERM_BLOCKS]; /**< ring of the last blocks */
+    unsigned blocks;                    /**< number of blocks so far */
+
+    uint64_t hist_count[HIST_BINS];
+    double hist_energy[HIST_BINS];
+
+    struct vlc_audio_loudness report;
+    struct loudness_channel ch[];
+};
+
+static double EnergyToLoudness(double energy)
+{
+    return energy > 0. ? -0.691 + 10. * log10(energy) : -INFINITY;
+}
+
+static double LinearToDecibels(double value)
+{
+    return value > 0. ? 20. * log10(value) : -INFINITY;
+}
+
+/* K-weighting filter coefficients, for any sample rate */
+static void KWeightingInit(struct biquad_coeffs *stage, unsigned rate)
+{
+    /* High shelf */
+    double f0 = 1681.974450955533, gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / rate);
+    double vh = pow(10., gain / 20.);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1. + k / q + k * k;
+
+    stage[0].b0 = (vh + vb * k / q + k * k) / a0;
+    stage[0].b1 = 2. * (k * k - vh) / a0;
+    stage[0].b2 = (vh - vb * k / q + k * k) / a0;
+    stage[0].a1 = 2. * (k * k - 1.) / a0;
+    stage[0].a2 = (1. - k / q + k * k) / a0;
+
+    /* High pass */
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / rate);
+    a0 = 1. + k / q + k * k;
+
+    stage[1].b0 = 1.;
+    stage[1].b1 = -2.;
+    stage[1].b2 = 1.;
+    stage[1].a1 = 2. * (k * k - 1.) / a0;
+    stage[1].a2 = (1. - k / q + k * k) / a0;
+}
+
+/* Windowed sinc interpolation filter, one lane per phase */
+static void TruePeakInit(struct loudness_meter *m, unsigned rate)
+{
+    m->tp_factor = rate < 96000 ? 4 : rate < 192000 ? 2 : 1;
+    memset(m->tp_coefs, 0, sizeof (m->tp_coefs));
+
+    const unsigned factor = m->tp_factor;
+    const unsigned len = factor * TP_TAPS;
+
+    for (unsigned p = 0; p < factor; p++)
+    {
+        double sum = 0.;
+
+        for (unsigned k = 0; k < TP_TAPS; k++)
+        {
+            unsigned n = p + factor * (TP_TAPS - 1 - k);
+            double x = (n - (len - 1) / 2.) / factor;
+            double h = fabs(x) < 1e-9 ? 1. : sin(M_PI * x) / (M_PI * x);
+            double w = .5 - .5 * cos(2. * M_PI * (n + .5) / len);
+
+            m->tp_coefs[k][p] = h * w;
+            sum += h * w;
+        }
+        for (unsigned k = 0; k < TP_TAPS; k++)
+            m->tp_coefs[k][p] /= sum;
+    }
+}
+
+static float TruePeak(float *win, unsigned *restrict pos, const float *src,
+                      size_t frames, unsigned stride,
+                      const float (*coefs)[TP_LANES])
+{
+    unsigned p = *pos;
+    float peak = 0.f;
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        win[p] = win[p + TP_TAPS] = src[i * stride];
+        p = (p + 1) % TP_TAPS;
+
+        const float *w = win + p;
+        float acc[TP_LANES] = { 0.f, 0.f, 0.f, 0.f };
+
+        for (unsigned k = 0; k < TP_TAPS; k++)
+            for (unsigned l = 0; l < TP_LANES; l++)
+                acc[l] += w[k] * coefs[k][l];
+        for (unsigned l = 0; l < TP_LANES; l++)
+            peak = __MAX(peak, fabsf(acc[l]));
+    }
+    *pos = p;
+    return peak;
+}
+
+static float SamplePeak(float *win, unsigned *restrict pos, const float *src,
+                        size_t frames, unsigned stride,
+                        const float (*coefs)[TP_LANES])
+{
+    float peak = 0.f;
+
+    for (size_t i = 0; i < frames; i++)
+        peak = __MAX(peak, fabsf(src[i * stride]));
+    (void) win; (void) pos; (void) coefs;
+    return peak;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static float TruePeak_SSE2(float *win, unsigned *restrict pos,
+                           const float *src, size_t frames, unsigned stride,
+                           const float (*coefs)[TP_LANES])
+{
+    const __m128 sign = _mm_set1_ps(-0.f);
+    __m128 c[TP_TAPS];
+    __m128 peak = _mm_setzero_ps();
+    unsigned p = *pos;
+
+    for (unsigned k = 0; k < TP_TAPS; k++)
+        c[k] = _mm_loadu_ps(coefs[k]);
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        win[p] = win[p + TP_TAPS] = src[i * stride];
+        p = (p + 1) % TP_TAPS;
+
+        const float *w = win + p;
+        __m128 acc = _mm_mul_ps(_mm_set1_ps(w[0]), c[0]);
+
+        for (unsigned k = 1; k < TP_TAPS; k++)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), c[k]));
+        peak = _mm_max_ps(peak, _mm_andnot_ps(sign, acc));
+    }
+    *pos = p;
+
+    peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+    peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, 1));
+    return _mm_cvtss_f32(peak);
+}
+#endif
+
+static true_peak_t FindTruePeak(unsigned factor, bool simd)
+{
+    if (factor == 1)
+        return SamplePeak;
+#ifdef HAVE_SSE2_INTRINSICS
+    if (simd && vlc_CPU_SSE2())
+        return TruePeak_SSE2;
+#endif
+    (void) simd;
+    return TruePeak;
+}
+
+static struct loudness_meter *LoudnessNew(unsigned rate, unsigned channels,
+                                          const double *weights, bool simd)
+{
+    struct loudness_meter *m = calloc(1, sizeof (*m)
+                                         + channels * sizeof (m->ch[0]));
+    if (unlikely(m == NULL))
+        return NULL;
+
+    m->kweighting = biquad_bank_New(channels, 2);
+    m->kw = malloc(KW_FRAMES * channels * sizeof (*m->kw));
+    if (unlikely(m->kweighting == NULL || m->kw == NULL))
+    {
+        if (m->kweighting != NULL)
+            biquad_bank_Delete(m->kweighting);
+        free(m->kw);
+        free(m);
+        return NULL;
+    }
+
+    struct biquad_coeffs stage[2];
+
+    KWeightingInit(stage, rate);
+    for (unsigned i = 0; i < channels; i++)
+    {
+        biquad_bank_Set(m->kweighting, 0, i, &stage[0]);
+        biquad_bank_Set(m->kweighting, 1, i, &stage[1]);
+    }
+
+    m->channels = channels;
+    m->block_frames = (rate * BLOCK_MS + 999) / 1000;
+    TruePeakInit(m, rate);
+    m->true_peak = FindTruePeak(m->tp_factor, simd);
+    for (unsigned i = 0; i < channels; i++)
+        m->ch[i].weight = weights[i];
+
+    m->report.momentary = m->report.short_term =
+    m->report.integrated = -INFINITY;
+    m->report.true_peak = m->report.max_true_peak = -INFINITY;
+    return m;
+}
+
+static void LoudnessDelete(struct loudness_meter *m)
+{
+    biquad_bank_Delete(m->kweighting);
+    free(m->kw);
+    free(m);
+}
+
+static double IntegratedLoudness(const struct loudness_meter *m)
+{
+    uint64_t count = 0;
+    double energy = 0.;
+
+    for (unsigned i = 0; i < HIST_BINS; i++)
+    {
+        count += m->hist_count[i];
+        energy += m->hist_energy[i];
+    }
+    if (count == 0)
+        return -INFINITY;
+
+    /* Relative gate */
+    double gate = EnergyToLoudness(energy / count) - 10.;
+    long first = lround(ceil((gate - HIST_MIN) / HIST_STEP));
+
+    count = 0;
+    energy = 0.;
+    for (long i = __MAX(first, 0); i < HIST_BINS; i++)
+    {
+        count += m->hist_count[i];
+        energy += m->hist_energy[i];
+    }
+    return count > 0 ? EnergyToLoudness(energy / count) : -INFINITY;
+}
+
+static void LoudnessEndBlock(struct loudness_meter *m)
+{
+    double energy = 0.;
+
+    for (unsigned i = 0; i < m->channels; i++)
+    {
+        energy += m->ch[i].weight * m->ch[i].sum;
+        m->ch[i].sum = 0.;
+    }
+    energy /= m->block_frames;
+
+    m->energies[m->blocks % SHORT_TERM_BLOCKS] = energy;
+    m->blocks++;
+    m->block_pos = 0;
+
+    double momentary = 0., short_term = 0.;
+    for (unsigned i = 0; i < SHORT_TERM_BLOCKS; i++)
+    {
+        double e = m->energies[(m->blocks - 1 - i) % SHORT_TERM_BLOCKS];
+
+        if (i < MOMENTARY_BLOCKS)
+            momentary += e;
+        short_term += e;
+    }
+    momentary /= MOMENTARY_BLOCKS;
+    short_term /= SHORT_TERM_BLOCKS;
+
+    struct vlc_audio_loudness *r = &m->report;
+
+    r->momentary = EnergyToLoudness(momentary);
+    r->short_term = EnergyToLoudness(short_term);
+
+    if (m->blocks >= MOMENTARY_BLOCKS && r->momentary >= HIST_MIN)
+    {
+        unsigned bin = (r->momentary - HIST_MIN) / HIST_STEP;
+
+        bin = __MIN(bin, HIST_BINS - 1);
+        m->hist_count[bin]++;
+        m->hist_energy[bin] += momentary;
+        r->integrated = IntegratedLoudness(m);
+    }
+
+    r->true_peak = LinearToDecibels(m->block_peak);
+    r->max_true_peak = __MAX(r->max_true_peak, r->true_peak);
+    m->block_peak = 0.f;
+}
+
+/**
+ * Measures interleaved samples.
+ * \return whether the report has been updated, i.e. a block was completed
+ */
+static bool LoudnessProcess(struct loudness_meter *m, const float *samples,
+                            size_t frames)
+{
+    const unsigned channels = m->channels;
+    bool updated = false;
+
+    while (frames > 0)
+    {
+        size_t count = __MIN(frames, m->block_frames - m->block_pos);
+
+        /* All channels are K-weighted together, the sums stay in double */
+        for (size_t done = 0; done < count; done += KW_FRAMES)
+        {
+            size_t n = __MIN(count - done, KW_FRAMES);
+
+            biquad_bank_Process(m->kweighting, m->kw,
+                                samples + done * channels, n);
+            for (unsigned c = 0; c < channels; c++)
+            {
+                const float *kw = m->kw + c;
+                double sum = 0.;
+
+                for (size_t i = 0; i < n; i++)
+                    sum += (double)kw[i * channels] * kw[i * channels];
+                m->ch[c].sum += sum;
+            }
+        }
+
+        for (unsigned c = 0; c < channels; c++)
+        {
+            struct loudness_channel *ch = &m->ch[c];
+            const float *src = samples + c;
+
+            float peak = m->true_peak(ch->tp_win, &ch->tp_pos, src, count,
+                                      channels, m->tp_coefs);
+            m->block_peak = __MAX(m->block_peak, peak);
+        }
+
+        samples += count * channels;
+        frames -= count;
+        m->block_pos += count;
+        if (m->block_pos == m->block_frames)
+        {
+            LoudnessEndBlock(m);
+            updated = true;
+        }
+    }
+    return updated;
+}
+
+static void LoudnessReset(struct loudness_meter *m)
+{
+    biquad_bank_Reset(m->kweighting);
+    for (unsigned i = 0; i < m->channels; i++)
+    {
+        struct loudness_channel *ch = &m->ch[i];
+
+        memset(ch->tp_win, 0, sizeof (ch->tp_win));
+    }
+}
+
+#ifndef LOUDNESS_TEST
+typedef struct
+{
+    struct loudness_meter *meter;
+    vlc_object_t *aout;
+} filter_sys_t;
+
+static block_t *Process(filter_t *filter, block_t *block)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    if (LoudnessProcess(sys->meter, (const float *)block->p_buffer,
+                        block->i_nb_samples))
+        var_SetAddress(sys->aout, "loudness", &sys->meter->report);
+    return block;
+}
+
+static void Flush(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    LoudnessReset(sys->meter);
+}
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    const audio_format_t *fmt = &filter->fmt_in.audio;
+    const unsigned channels = aout_FormatNbChannels(fmt);
+    double weights[AOUT_CHAN_MAX];
+
+    if (channels == 0 || channels > AOUT_CHAN_MAX)
+        return VLC_EGENERIC;
+
+    /* BS.1770 channel weights: the surround channels count for +1.5 dB,
+     * the LFE is ignored. */
+    for (unsigned i = 0; i < channels; i++)
+        weights[i] = 1.;
+    if (fmt->channel_type == AUDIO_CHANNEL_TYPE_BITMAP)
+        for (unsigned i = 0, j = 0; pi_vlc_chan_order_wg4[i]; i++)
+        {
+            uint32_t chan = pi_vlc_chan_order_wg4[i];
+
+            if (!(fmt->i_physical_channels & chan))
+                continue;
+            if (chan & AOUT_CHAN_LFE)
+                weights[j] = 0.;
+            else if (chan & (AOUT_CHANS_MIDDLE | AOUT_CHANS_REAR
+                           | AOUT_CHAN_REARCENTER))
+                weights[j] = 1.41;
+            j++;
+        }
+
+    filter_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->meter = LoudnessNew(fmt->i_rate, channels, weights, true);
+    if (unlikely(sys->meter == NULL))
+    {
+        free(sys);
+        return VLC_ENOMEM;
+    }
+    sys->aout = vlc_object_parent(filter);
+
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    filter->fmt_out.audio = filter->fmt_in.audio;
+
+    msg_Dbg(filter, "measuring %u channels, true peak oversampled %ux",
+            channels, sys->meter->tp_factor);
+
+    filter->p_sys = sys;
+    filter->pf_audio_filter = Process;
+    filter->pf_flush = Flush;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    filter_sys_t *sys = filter->p_sys;
+    const struct vlc_audio_loudness *r = &sys->meter->report;
+
+    msg_Dbg(filter, "integrated loudness %.1f LUFS, true peak %.1f dBTP",
+            r->integrated, r->max_true_peak);
+    var_SetAddress(sys->aout, "loudness", NULL);
+    LoudnessDelete(sys->meter);
+    free(sys);
+}
+
+vlc_module_begin()
+    set_shortname(N_("Loudness meter"))
+    set_description(N_("EBU R128 loudness and true peak meter"))
+    set_category(CAT_AUDIO)
+    set_subcategory(SUBCAT_AUDIO_AFILTER)
+    set_capability("audio filter", 0)
+    set_callbacks(Open, Close)
+    add_shortcut("loudness", "ebur128")
+vlc_module_end()
+
+#else /* LOUDNESS_TEST */
+# include <stdio.h>
+# include <unistd.h>
+
+# define RATE 48000
+
+static const double stereo[2] = { 1., 1. };
+
+/* Feeds a sine wave, given its level in dBFS, and returns the meter */
+static void Sine(struct loudness_meter *m, double freq, double dbfs,
+                 double phase, double seconds)
+{
+    const size_t frames = seconds * RATE;
+    const double amp = pow(10., dbfs / 20.);
+    float *buf = malloc(sizeof (float) * 2 * 4800);
+    assert(buf != NULL);
+
+    for (size_t done = 0; done < frames;)
+    {
+        size_t count = __MIN(frames - done, 4321);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            double t = (double)(done + i) / RATE;
+            buf[2 * i] = buf[2 * i + 1] = amp * sin(2. * M_PI * freq * t
+                                                    + phase);
+        }
+        LoudnessProcess(m, buf, count);
+        done += count;
+    }
+    free(buf);
+}
+
+static void TestLevels(bool simd)
+{
+    /* A stereo 1 kHz sine wave reads its own peak level in LUFS */
+    struct loudness_meter *m = LoudnessNew(RATE, 2, stereo, simd);
+    assert(m != NULL);
+    Sine(m, 1000., -23., 0., 20.);
+    fprintf(stderr, "-23 dBFS: M %.2f S %.2f I %.2f TP %.2f\n",
+            m->report.momentary, m->report.short_term, m->report.integrated,
+            m->report.max_true_peak);
+    assert(fabs(m->report.momentary + 23.) < .1);
+    assert(fabs(m->report.short_term + 23.) < .1);
+    assert(fabs(m->report.integrated + 23.) < .1);
+    LoudnessDelete(m);
+
+    /* EBU Tech 3341 case 3: the quiet parts are gated out */
+    m = LoudnessNew(RATE, 2, stereo, simd);
+    assert(m != NULL);
+    Sine(m, 1000., -36., 0., 10.);
+    Sine(m, 1000., -23., 0., 60.);
+    LoudnessReset(m); /* a flush does not restart the program */
+    Sine(m, 1000., -36., 0., 10.);
+    fprintf(stderr, "gating: I %.2f\n", m->report.integrated);
+    assert(fabs(m->report.integrated + 23.) < .1);
+    LoudnessDelete(m);
+
+    /* Silence is below the absolute gate */
+    m = LoudnessNew(RATE, 2, stereo, simd);
+    assert(m != NULL);
+    Sine(m, 1000., -200., 0., 2.);
+    assert(m->report.integrated == -INFINITY);
+    LoudnessDelete(m);
+
+    /* Samples of a sine at a quarter of the rate miss its peak by 3 dB
+     * with a 45 degrees phase: the true peak does not */
+    m = LoudnessNew(RATE, 2, stereo, simd);
+    assert(m != NULL);
+    Sine(m, RATE / 4., -6., M_PI / 4., 1.);
+    fprintf(stderr, "true peak: %.2f dBTP\n", m->report.max_true_peak);
+    assert(fabs(m->report.max_true_peak + 6.) < .5);
+    LoudnessDelete(m);
+}
+
+static void TestSIMD(void)
+{
+    struct loudness_meter *m = LoudnessNew(RATE, 1, stereo, false);
+    assert(m != NULL);
+    if (m->true_peak == FindTruePeak(m->tp_factor, true))
+    {
+        LoudnessDelete(m);
+        return;
+    }
+
+    unsigned seed = 1;
+    float src[1000];
+    float win_c[2 * TP_TAPS] = { 0 }, win_simd[2 * TP_TAPS] = { 0 };
+    unsigned pos_c = 0, pos_simd = 0;
+    true_peak_t simd = FindTruePeak(m->tp_factor, true);
+
+    for (unsigned n = 0; n < 100; n++)
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(src); i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            src[i] = ((int)(seed >> 8) - (1 << 23)) / (float)(1 << 23);
+        }
+
+        size_t count = 1 + n * 7 % ARRAY_SIZE(src);
+        float ref = TruePeak(win_c, &pos_c, src, count, 1, m->tp_coefs);
+        float out = simd(win_simd, &pos_simd, src, count, 1, m->tp_coefs);
+
+        assert(pos_c == pos_simd);
+        assert(fabsf(ref - out) <= 1e-5f * ref);
+    }
+    LoudnessDelete(m);
+}
+
+int main(void)
+{
+    alarm(30);
+    TestLevels(false);
+    TestLevels(true);
+    TestSIMD();
+    return 0;
+}
+#endif
@@ -0,0 +1,810 @@
+/*****************************************************************************
+ * polyphase.c: polyphase FIR audio resampler
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The low-pass filter is a Kaiser-windowed sinc, sampled at a fixed number
+ * of phases between two input samples. The filter of each output sample is
+ * linearly interpolated between the two closest phases, so that any (and
+ * varying) rate ratio can be used: the input rate of the resampler is changed
+ * on the fly by the audio output to catch up with its clock.
+ *
+ * The input is kept deinterleaved, so that each output sample is a single
+ * dot product of contiguous samples with the interpolated filter.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef RESAMPLER_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+
+/* The kernels process the taps 16 by 16 */
+#define TAPS_ALIGN 16
+#define MAX_TAPS 1024
+
+static const char *const quality_texts[] = {
+    N_("Fast"), N_("Medium"), N_("High"), N_("Very high"),
+};
+
+static const struct polyphase_quality
+{
+    unsigned taps;      /**< filter length, in samples of the lower rate */
+    unsigned phases;    /**< number of filters between two input samples */
+    double cutoff;      /**< pass band, relative to the lower Nyquist rate */
+    double beta;        /**< Kaiser window parameter */
+} qualities[] = {
+    {  16,  128, .80,  6. },
+    {  32,  256, .90,  8. },
+    {  64,  512, .94, 10. },
+    { 128, 1024, .96, 12. },
+};
+
+struct polyphase
+{
+    unsigned channels;
+    bool     s16;         /**< S16N instead of FL32 input and output */
+    unsigned taps;        /**< multiple of TAPS_ALIGN */
+    unsigned phases;
+    float   *bank;        /**< (phases + 1) filters of taps coefficients */
+    float   *coefs;       /**< filter of the current output sample */
+
+    float   *history;     /**< planar input samples */
+    size_t   capacity;    /**< history frames per channel (stride) */
+    size_t   frames;      /**< valid history frames */
+    uint64_t pos;         /**< next output position in the history, 32.32 */
+
+    void   (*interpolate)(float *, const float *, float, unsigned);
+    float  (*dot)(const float *, const float *, unsigned);
+};
+
+/*****************************************************************************
+ * Kernels
+ *****************************************************************************/
+/* Interpolates between a filter and the next one in the bank */
+static void Interpolate(float *restrict dst, const float *restrict row,
+                        float w, unsigned taps)
+{
+    for (unsigned k = 0; k < taps; k++)
+        dst[k] = row[k] + w * (row[k + taps] - row[k]);
+}
+
+static float Dot(const float *restrict x, const float *restrict h,
+                 unsigned taps)
+{
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+
+    for (unsigned k = 0; k < taps; k += 4)
+    {
+        s0 += x[k + 0] * h[k + 0];
+        s1 += x[k + 1] * h[k + 1];
+        s2 += x[k + 2] * h[k + 2];
+        s3 += x[k + 3] * h[k + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static void Interpolate_SSE2(float *restrict dst, const float *restrict row,
+                             float w, unsigned taps)
+{
+    const __m128 vw = _mm_set1_ps(w);
+
+    for (unsigned k = 0; k < taps; k += 4)
+    {
+        __m128 a = _mm_loadu_ps(&row[k]);
+        __m128 b = _mm_loadu_ps(&row[k + taps]);
+        _mm_storeu_ps(&dst[k], _mm_add_ps(a, _mm_mul_ps(vw, _mm_sub_ps(b, a))));
+    }
+}
+
+VLC_SSE2
+static float Dot_SSE2(const float *restrict x, const float *restrict h,
+                      unsigned taps)
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    __m128 s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+
+    for (unsigned k = 0; k < taps; k += 16)
+    {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(&x[k + 0]),
+                                       _mm_loadu_ps(&h[k + 0])));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(&x[k + 4]),
+                                       _mm_loadu_ps(&h[k + 4])));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(&x[k + 8]),
+                                       _mm_loadu_ps(&h[k + 8])));
+        s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(&x[k + 12]),
+                                       _mm_loadu_ps(&h[k + 12])));
+    }
+    __m128 s = _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static void Interpolate_AVX2(float *restrict dst, const float *restrict row,
+                             float w, unsigned taps)
+{
+    const __m256 vw = _mm256_set1_ps(w);
+
+    for (unsigned k = 0; k < taps; k += 8)
+    {
+        __m256 a = _mm256_loadu_ps(&row[k]);
+        __m256 b = _mm256_loadu_ps(&row[k + taps]);
+        _mm256_storeu_ps(&dst[k],
+                         _mm256_add_ps(a, _mm256_mul_ps(vw, _mm256_sub_ps(b, a))));
+    }
+}
+
+VLC_AVX2
+static float Dot_AVX2(const float *restrict x, const float *restrict h,
+                      unsigned taps)
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+
+    for (unsigned k = 0; k < taps; k += 16)
+    {
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(&x[k]),
+                                             _mm256_loadu_ps(&h[k])));
+        s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(&x[k + 8]),
+                                             _mm256_loadu_ps(&h[k + 8])));
+    }
+    __m256 s8 = _mm256_add_ps(s0, s1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(s8),
+                          _mm256_extractf128_ps(s8, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#endif
+
+/*****************************************************************************
+ * Resampler
+ *****************************************************************************/
+/* Zeroth order modified Bessel function of the first kind */
+static double BesselI0(double x)
+{
+    double sum = 1., term = 1.;
+
+    for (unsigned k = 1; term > sum * 1e-12; k++)
+    {
+        term *= (x / (2. * k)) * (x / (2. * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static void ComputeBank(float *bank, unsigned taps, unsigned phases,
+                        double cutoff, double beta)
+{
+    const double i0_beta = BesselI0(beta);
+
+    for (unsigned p = 0; p <= phases; p++)
+    {
+        float *row = &bank[p * taps];
+        double sum = 0.;
+
+        for (unsigned k = 0; k < taps; k++)
+        {
+            /* distance to the output sample, in input samples */
+            const double x = (double)k - (taps / 2 - 1) - (double)p / phases;
+            const double t = 2. * x / taps;
+            double h = cutoff;
+
+            if (x != 0.)
+                h = sin(M_PI * cutoff * x) / (M_PI * x);
+            h *= t < 1. && t > -1. ? BesselI0(beta * sqrt(1. - t * t)) / i0_beta
+                                   : 0.;
+            row[k] = h;
+            sum += h;
+        }
+
+        /* unity gain for all phases */
+        for (unsigned k = 0; k < taps; k++)
+            row[k] /= sum;
+    }
+}
+
+static void PolyphaseReset(struct polyphase *p)
+{
+    /* Start with silence, so that the first output sample is centered on
+     * the first input sample */
+    p->frames = p->taps / 2 - 1;
+    for (unsigned c = 0; c < p->channels; c++)
+        memset(&p->history[c * p->capacity], 0, p->frames * sizeof (float));
+    p->pos = (uint64_t)p->frames << 32;
+}
+
+static int PolyphaseInit(struct polyphase *p, unsigned in_rate,
+                         unsigned out_rate, unsigned channels,
+                         unsigned quality, bool simd)
+{
+    const struct polyphase_quality *q = &qualities[quality];
+    /* When downsampling, the cut-off frequency falls, and the filter gets
+     * longer in input samples */
+    const double ratio = __MIN(1., (double)out_rate / in_rate);
+    unsigned taps = ceil(q->taps / ratio);
+
+    taps = (taps + TAPS_ALIGN - 1) & ~(TAPS_ALIGN - 1);
+    if (taps > MAX_TAPS)
+        taps = MAX_TAPS;
+
+    p->channels = channels;
+    p->s16 = false;
+    p->taps = taps;
+    p->phases = q->phases;
+    p->bank = vlc_alloc((q->phases + 1) * taps, sizeof (float));
+    p->coefs = vlc_alloc(taps, sizeof (float));
+    p->capacity = 2 * taps;
+    p->history = vlc_alloc(channels * p->capacity, sizeof (float));
+    if (unlikely(p->bank == NULL || p->coefs == NULL || p->history == NULL))
+    {
+        free(p->history);
+        free(p->coefs);
+        free(p->bank);
+        return VLC_ENOMEM;
+    }
+
+    ComputeBank(p->bank, taps, q->phases, q->cutoff * ratio, q->beta);
+    PolyphaseReset(p);
+
+    p->interpolate = Interpolate;
+    p->dot = Dot;
+#ifdef HAVE_SSE2_INTRINSICS
+    if (simd && vlc_CPU_SSE2())
+    {
+        p->interpolate = Interpolate_SSE2;
+        p->dot = Dot_SSE2;
+    }
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if (simd && vlc_CPU_AVX2())
+    {
+        p->interpolate = Interpolate_AVX2;
+        p->dot = Dot_AVX2;
+    }
+#endif
+    (void) simd;
+    return VLC_SUCCESS;
+}
+
+static void PolyphaseClean(struct polyphase *p)
+{
+    free(p->history);
+    free(p->coefs);
+    free(p->bank);
+}
+
+/* Input frames advanced per output frame, in 32.32 fixed point */
+static uint64_t PolyphaseStep(unsigned in_rate, unsigned out_rate)
+{
+    return ((uint64_t)in_rate << 32) / out_rate;
+}
+
+/* Upper bound of the number of output frames once the input is pushed */
+static size_t PolyphaseMaxOutput(const struct polyphase *p, uint64_t step,
+                                 size_t in_frames)
+{
+    const uint64_t end = (uint64_t)(p->frames + in_frames) << 32;
+
+    return end > p->pos ? (end - p->pos) / step + 1 : 0;
+}
+
+static int PolyphasePush(struct polyphase *p, const void *in, size_t frames)
+{
+    if (p->frames + frames > p->capacity)
+    {
+        size_t capacity = __MAX(p->frames + frames, 2 * p->capacity);
+        float *history = vlc_alloc(p->channels * capacity, sizeof (float));
+        if (unlikely(history == NULL))
+            return VLC_ENOMEM;
+
+        for (unsigned c = 0; c < p->channels; c++)
+            memcpy(&history[c * capacity], &p->history[c * p->capacity],
+                   p->frames * sizeof (float));
+        free(p->history);
+        p->history = history;
+        p->capacity = capacity;
+    }
+
+    for (unsigned c = 0; c < p->channels; c++)
+    {
+        float *dst = &p->history[c * p->capacity + p->frames];
+
+        if (in != NULL && p->s16)
+            for (size_t i = 0; i < frames; i++)
+                dst[i] = ((const int16_t *)in)[i * p->channels + c]
+                         * (1.f / 32768.f);
+        else if (in != NULL)
+            for (size_t i = 0; i < frames; i++)
+                dst[i] = ((const float *)in)[i * p->channels + c];
+        else
+            memset(dst, 0, frames * sizeof (float));
+    }
+    p->frames += frames;
+    return VLC_SUCCESS;
+}
+
+/* Computes the output samples available from the history, and drops the
+ * input samples that are not needed anymore */
+static size_t PolyphasePull(struct polyphase *p, uint64_t step,
+                            void *restrict out, size_t max)
+{
+    const unsigned half = p->taps / 2;
+    float *out_fl32 = out;
+    int16_t *out_s16 = out;
+    size_t n = 0;
+
+    for (; n < max; n++)
+    {
+        const size_t i = p->pos >> 32;
+        if (i + half >= p->frames)
+            break;
+
+        const uint64_t phase = (p->pos & UINT32_MAX) * p->phases;
+        p->interpolate(p->coefs, &p->bank[(phase >> 32) * p->taps],
+                       (phase & UINT32_MAX) * 0x1.p-32f, p->taps);
+
+        const float *x = &p->history[i - (half - 1)];
+        for (unsigned c = 0; c < p->channels; c++)
+        {
+            float v = p->dot(&x[c * p->capacity], p->coefs, p->taps);
+
+            if (p->s16)
+            {
+                v *= 32768.f;
+                *(out_s16++) = v >= 32767.f ? 32767 :
+                               v <= -32768.f ? -32768 : lroundf(v);
+            }
+            else
+                *(out_fl32++) = v;
+        }
+        p->pos += step;
+    }
+
+    size_t drop = __MIN((size_t)(p->pos >> 32) - (half - 1), p->frames);
+    if (drop > 0)
+    {
+        p->frames -= drop;
+        for (unsigned c = 0; c < p->channels; c++)
+        {
+            float *row = &p->history[c * p->capacity];
+            memmove(row, &row[drop], p->frames * sizeof (float));
+        }
+        p->pos -= (uint64_t)drop << 32;
+    }
+    return n;
+}
+
+#ifndef RESAMPLER_TEST
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define QUALITY_TEXT N_("Resampling quality")
+#define QUALITY_LONGTEXT N_("Resampling quality, from fastest to best. " \
+    "Higher qualities use longer filters with a sharper cut-off.")
+
+static const int quality_values[] = { 0, 1, 2, 3 };
+
+static int OpenConverter(vlc_object_t *);
+static int OpenResampler(vlc_object_t *);
+static void Close(vlc_object_t *);
+
+vlc_module_begin()
+    set_shortname(N_("Polyphase resampler"))
+    set_description(N_("Polyphase FIR audio resampler"))
+    set_category(CAT_AUDIO)
+    set_subcategory(SUBCAT_AUDIO_RESAMPLER)
+    add_integer("polyphase-resampler-quality", 2,
+                QUALITY_TEXT, QUALITY_LONGTEXT, true)
+        change_integer_list(quality_values, quality_texts)
+    set_capability("audio converter", 40)
+    set_callbacks(OpenConverter, Close)
+
+    add_submodule()
+    set_capability("audio resampler", 40)
+    set_callbacks(OpenResampler, Close)
+    add_shortcut("polyphase")
+vlc_module_end()
+
+typedef struct
+{
+    struct polyphase resampler;
+    unsigned out_rate;
+    vlc_tick_t next_pts; /**< date of the next output frame */
+} filter_sys_t;
+
+static block_t *Process(filter_t *filter, block_t *in, size_t in_frames)
+{
+    filter_sys_t *sys = filter->p_sys;
+    struct polyphase *p = &sys->resampler;
+    const unsigned in_rate = filter->fmt_in.audio.i_rate;
+    const uint64_t step = PolyphaseStep(in_rate, sys->out_rate);
+
+    /* Date of the next output frame, from the date of the input */
+    if (in != NULL && in->i_pts != VLC_TICK_INVALID)
+    {
+        const int64_t offset = p->pos - ((uint64_t)p->frames << 32);
+        sys->next_pts = in->i_pts
+                      + llround(offset * (CLOCK_FREQ / 4294967296.) / in_rate);
+    }
+
+    size_t max = PolyphaseMaxOutput(p, step, in_frames);
+    block_t *out = filter_NewAudioBuffer(filter, max * filter->fmt_out.audio.i_bytes_per_frame);
+
+    if (unlikely(out == NULL)
+     || PolyphasePush(p, in ? in->p_buffer : NULL, in_frames))
+    {
+        if (out != NULL)
+            block_Release(out);
+        out = NULL;
+        goto out;
+    }
+
+    size_t n = PolyphasePull(p, step, out->p_buffer, max);
+    if (n == 0)
+    {
+        block_Release(out);
+        out = NULL;
+        goto out;
+    }
+
+    out->i_nb_samples = n;
+    out->i_buffer = n * filter->fmt_out.audio.i_bytes_per_frame;
+    out->i_pts = out->i_dts = sys->next_pts;
+    out->i_length = vlc_tick_from_samples(n, sys->out_rate);
+    if (sys->next_pts != VLC_TICK_INVALID)
+        sys->next_pts += out->i_length;
+    if (in != NULL)
+        out->i_flags = in->i_flags & BLOCK_FLAG_DISCONTINUITY;
+out:
+    if (in != NULL)
+        block_Release(in);
+    return out;
+}
+
+static block_t *Resample(filter_t *filter, block_t *in)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    if (in->i_flags & BLOCK_FLAG_DISCONTINUITY)
+        PolyphaseReset(&sys->resampler);
+    return Process(filter, in, in->i_nb_samples);
+}
+
+static void Flush(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    PolyphaseReset(&sys->resampler);
+    sys->next_pts = VLC_TICK_INVALID;
+}
+
+static block_t *Drain(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    /* Push silence to output the samples waiting for the end of their
+     * filter */
+    block_t *out = Process(filter, NULL, sys->resampler.taps / 2);
+    Flush(filter);
+    return out;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+
+    /* Cannot remix nor convert */
+    if (filter->fmt_in.audio.i_channels != filter->fmt_out.audio.i_channels
+     || filter->fmt_in.audio.i_format != filter->fmt_out.audio.i_format
+     || filter->fmt_in.audio.i_channels == 0)
+        return VLC_EGENERIC;
+
+    switch (filter->fmt_in.audio.i_format)
+    {
+        case VLC_CODEC_FL32: break;
+        case VLC_CODEC_S16N: break;
+        default:             return VLC_EGENERIC;
+    }
+
+    filter_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    int64_t quality = var_InheritInteger(obj, "polyphase-resampler-quality");
+    if (quality < 0)
+        quality = 0;
+    else if (quality >= (int64_t)ARRAY_SIZE(qualities))
+        quality = ARRAY_SIZE(qualities) - 1;
+
+    if (PolyphaseInit(&sys->resampler, filter->fmt_in.audio.i_rate,
+                      filter->fmt_out.audio.i_rate,
+                      filter->fmt_in.audio.i_channels, quality, true))
+    {
+        free(sys);
+        return VLC_ENOMEM;
+    }
+    sys->resampler.s16 = filter->fmt_in.audio.i_format == VLC_CODEC_S16N;
+    sys->out_rate = filter->fmt_out.audio.i_rate;
+    sys->next_pts = VLC_TICK_INVALID;
+
+    msg_Dbg(filter, "%uHz -> %uHz, %u channels, %s quality (%u taps)",
+            filter->fmt_in.audio.i_rate, filter->fmt_out.audio.i_rate,
+            filter->fmt_in.audio.i_channels, quality_texts[quality],
+            sys->resampler.taps);
+
+    filter->p_sys = sys;
+    filter->pf_audio_filter = Resample;
+    filter->pf_flush = Flush;
+    filter->pf_audio_drain = Drain;
+    return VLC_SUCCESS;
+}
+
+static int OpenConverter(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+
+    if (filter->fmt_in.audio.i_rate == filter->fmt_out.audio.i_rate)
+        return VLC_EGENERIC;
+    return Open(obj);
+}
+
+static int OpenResampler(vlc_object_t *obj)
+{
+    return Open(obj);
+}
+
+static void Close(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    filter_sys_t *sys = filter->p_sys;
+
+    PolyphaseClean(&sys->resampler);
+    free(sys);
+}
+
+#else /* RESAMPLER_TEST */
+#include <stdio.h>
+#include <unistd.h>
+
+/* Resamples a buffer in chunks of random sizes */
+static size_t Run(struct polyphase *p, unsigned in_rate, unsigned out_rate,
+                  const float *in, size_t frames, float *out, unsigned *seed)
+{
+    const uint64_t step = PolyphaseStep(in_rate, out_rate);
+    size_t done = 0;
+
+    for (size_t i = 0; i < frames;)
+    {
+        size_t chunk = 1;
+        if (seed != NULL)
+        {
+            *seed = *seed * 1103515245 + 12345;
+            chunk += (*seed >> 16) % 2000;
+        }
+        else
+            chunk = frames;
+        chunk = __MIN(chunk, frames - i);
+
+        size_t max = PolyphaseMaxOutput(p, step, chunk);
+        int ret = PolyphasePush(p, &in[i * p->channels], chunk);
+        assert(ret == VLC_SUCCESS);
+        done += PolyphasePull(p, step, &out[done * p->channels], max);
+        i += chunk;
+    }
+    return done;
+}
+
+static float *Sine(double freq, unsigned rate, unsigned channels, size_t frames)
+{
+    float *buf = malloc(frames * channels * sizeof (*buf));
+    assert(buf != NULL);
+
+    for (size_t i = 0; i < frames; i++)
+        for (unsigned c = 0; c < channels; c++)
+            buf[i * channels + c] = .5 * sin(2. * M_PI * freq * i / rate + c);
+    return buf;
+}
+
+/* Signal to error ratio of a resampled sine, in dB, skipping the edges */
+static double SineSNR(struct polyphase *p, double freq, unsigned in_rate,
+                      unsigned out_rate)
+{
+    const size_t frames = in_rate;
+    const unsigned channels = p->channels;
+    float *in = Sine(freq, in_rate, channels, frames);
+    float *out = malloc((frames * 2 * out_rate / in_rate + 2) * channels
+                        * sizeof (*out));
+    assert(out != NULL);
+
+    size_t n = Run(p, in_rate, out_rate, in, frames, out, NULL);
+    const uint64_t step = PolyphaseStep(in_rate, out_rate);
+    double signal = 0., noise = 0.;
+
+    for (size_t i = n / 8; i < n - n / 8; i++)
+    {
+        const double t = (double)(i * step) / 4294967296.;
+        for (unsigned c = 0; c < channels; c++)
+        {
+            const double ref = .5 * sin(2. * M_PI * freq * t / in_rate + c);
+            const double err = out[i * channels + c] - ref;
+            signal += ref * ref;
+            noise += err * err;
+        }
+    }
+    free(out);
+    free(in);
+    return 10. * log10(signal / __MAX(noise, 1e-30));
+}
+
+static double Bench(unsigned quality, bool simd, unsigned channels,
+                    unsigned loops)
+{
+    const unsigned in_rate = 44100, out_rate = 48000;
+    struct polyphase p;
+    int ret = PolyphaseInit(&p, in_rate, out_rate, channels, quality, simd);
+    assert(ret == VLC_SUCCESS);
+
+    float *in = Sine(1000., in_rate, channels, in_rate);
+    float *out = malloc((out_rate + 2) * channels * sizeof (*out));
+    assert(out != NULL);
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned n = 0; n < loops; n++)
+        Run(&p, in_rate, out_rate, in, in_rate, out, NULL);
+    vlc_tick_t duration = __MAX(vlc_tick_now() - start, 1);
+
+    free(out);
+    free(in);
+    PolyphaseClean(&p);
+    /* seconds of audio per second */
+    return (double) loops * CLOCK_FREQ / duration;
+}
+
+/* Checks the quality of the resampler, its continuity across input blocks,
+ * and the vectorized kernels against the C ones. With "bench" as first
+ * argument, reports the speed of each quality instead. */
+int main(int argc, char **argv)
+{
+    /* minimum pass band SNR of each quality, in dB */
+    static const double min_snr[] = { 55., 75., 95., 110. };
+    static const unsigned rates[][2] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 8000, 48000 }, { 96000, 44100 },
+    };
+    const bool bench = argc > 1 && !strcmp(argv[1], "bench");
+    const unsigned loops = argc > 2 ? atoi(argv[2]) : 10;
+    unsigned seed = 1;
+
+    if (bench)
+    {
+        for (unsigned q = 0; q < ARRAY_SIZE(qualities); q++)
+            for (unsigned channels = 2; channels <= 8; channels += 6)
+                printf("%-9s 44.1->48 kHz, %u channels: "
+                       "C %7.1fx, SIMD %7.1fx real time\n", quality_texts[q],
+                       channels, Bench(q, false, channels, loops),
+                       Bench(q, true, channels, loops));
+        return 0;
+    }
+
+    alarm(60);
+
+    for (unsigned q = 0; q < ARRAY_SIZE(qualities); q++)
+        for (size_t r = 0; r < ARRAY_SIZE(rates); r++)
+        {
+            const unsigned in_rate = rates[r][0], out_rate = rates[r][1];
+            const unsigned channels = 3;
+            struct polyphase c, simd, split;
+            int ret;
+
+            ret = PolyphaseInit(&c, in_rate, out_rate, channels, q, false);
+            assert(ret == VLC_SUCCESS);
+            ret = PolyphaseInit(&simd, in_rate, out_rate, channels, q, true);
+            assert(ret == VLC_SUCCESS);
+            ret = PolyphaseInit(&split, in_rate, out_rate, channels, q, true);
+            assert(ret == VLC_SUCCESS);
+
+            /* pass band tone at a fifth of the lower rate */
+            const double freq = __MIN(in_rate, out_rate) / 5.;
+            double snr = SineSNR(&c, freq, in_rate, out_rate);
+            fprintf(stderr, "testing: %s %u->%u Hz, %.0f Hz SNR %.1f dB\n",
+                    quality_texts[q], in_rate, out_rate, freq, snr);
+            assert(snr >= min_snr[q]);
+
+            /* The same input in one or more blocks gives the same output,
+             * and the vectorized kernels are close to the C ones */
+            const size_t frames = in_rate / 2;
+            float *in = Sine(freq, in_rate, channels, frames);
+            const size_t max = (frames * 2 * out_rate / in_rate + 2) * channels;
+            float *a = malloc(max * sizeof (*a));
+            float *b = malloc(max * sizeof (*b));
+            assert(in != NULL && a != NULL && b != NULL);
+
+            size_t na = Run(&simd, in_rate, out_rate, in, frames, a, NULL);
+            size_t nb = Run(&split, in_rate, out_rate, in, frames, b, &seed);
+            assert(na == nb);
+            assert(!memcmp(a, b, na * channels * sizeof (*a)));
+
+            PolyphaseReset(&c);
+            nb = Run(&c, in_rate, out_rate, in, frames, b, NULL);
+            assert(na == nb);
+            for (size_t i = 0; i < na * channels; i++)
+                assert(fabsf(a[i] - b[i]) < 1e-5f);
+
+            /* The number of output frames follows the input rate, minus
+             * the ones waiting for the end of their filter */
+            const size_t expected = (uint64_t)frames * out_rate / in_rate;
+            const size_t waiting = (simd.taps / 2 + 1) * out_rate / in_rate + 1;
+            assert(na + waiting >= expected && na <= expected + 1);
+
+            free(b);
+            free(a);
+            free(in);
+            PolyphaseClean(&split);
+            PolyphaseClean(&simd);
+            PolyphaseClean(&c);
+        }
+
+    /* Dynamic rate adjustment: 2% faster input for half of the stream */
+    struct polyphase p;
+    int ret = PolyphaseInit(&p, 44100, 48000, 2, 2, true);
+    assert(ret == VLC_SUCCESS);
+
+    float *in = Sine(1000., 44100, 2, 44100);
+    float *out = malloc(2 * 48000 * 2 * sizeof (*out));
+    assert(in != NULL && out != NULL);
+    size_t n = Run(&p, 44100, 48000, in, 22050, out, &seed);
+    n += Run(&p, 44982, 48000, &in[2 * 22050], 22050, &out[2 * n], &seed);
+    const double expected = 24000. + 22050. * 48000. / 44982.;
+    fprintf(stderr, "testing: dynamic rate, %zu frames for %.0f\n",
+            n, expected);
+    assert(fabs(n - expected) <= (p.taps / 2 + 1) * 48000. / 44100. + 1);
+    free(out);
+    free(in);
+    PolyphaseClean(&p);
+    return 0;
+}
+
+#endif /* RESAMPLER_TEST */
@@ -27,16 +27,31 @@
 # include "config.h"
 #endif
 
+#ifdef SCALETEMPO_TEST
+# undef NDEBUG
+#endif
+
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_atomic.h>
 #include <vlc_filter.h>
 #include <vlc_modules.h>
 
+#include <assert.h>
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -55,6 +70,7 @@ static block_t *DoPitchWork( filter_t *, block_t * );
 # define MODULES_SHORTNAME N_("Scaletempo")
 #endif
 
+#ifndef SCALETEMPO_TEST
 vlc_module_begin ()
     set_description( MODULE_DESC )
     set_shortname( MODULES_SHORTNAME )
@@ -77,6 +93,9 @@ vlc_module_begin ()
 #endif
 
 vlc_module_end ()
+#else
+const char vlc_module_name[] = "scaletempo";
+#endif
 
 /*
  * Scaletempo works by producing audio in constant sized chunks (a "stride") but
@@ -94,6 +113,8 @@ vlc_module_end ()
  * frame: a single set of samples, one for each channel
  * VLC uses these terms differently
  */
+typedef float (*dot_t)( const float *, const float *, unsigned );
+
 typedef struct
 {
     /* Filter static config */
@@ -129,6 +150,7 @@ typedef struct
     void     *buf_pre_corr;
     void     *table_window;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    dot_t     dot;
 #ifdef PITCH_SHIFTER
     /* pitch */
     filter_t * resampler;
@@ -136,6 +158,87 @@ typedef struct
 #endif
 } filter_sys_t;
 
+/*****************************************************************************
+ * dot: correlation of the overlap with one search position
+ *****************************************************************************/
+static float dot_c( const float *a, const float *b, unsigned n )
+{
+    float corr = 0;
+    for( unsigned i = 0; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static float dot_sse2( const float *a, const float *b, unsigned n )
+{
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    unsigned i = 0;
+
+    for( ; i + 8 <= n; i += 8 )
+    {
+        acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_loadu_ps( a + i ),
+                                             _mm_loadu_ps( b + i ) ) );
+        acc1 = _mm_add_ps( acc1, _mm_mul_ps( _mm_loadu_ps( a + i + 4 ),
+                                             _mm_loadu_ps( b + i + 4 ) ) );
+    }
+    acc0 = _mm_add_ps( acc0, acc1 );
+    acc0 = _mm_add_ps( acc0, _mm_movehl_ps( acc0, acc0 ) );
+    acc0 = _mm_add_ss( acc0, _mm_shuffle_ps( acc0, acc0, 1 ) );
+
+    float corr = _mm_cvtss_f32( acc0 );
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static float dot_avx2( const float *a, const float *b, unsigned n )
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    unsigned i = 0;
+
+    for( ; i + 16 <= n; i += 16 )
+    {
+        acc0 = _mm256_add_ps( acc0, _mm256_mul_ps( _mm256_loadu_ps( a + i ),
+                                                   _mm256_loadu_ps( b + i ) ) );
+        acc1 = _mm256_add_ps( acc1, _mm256_mul_ps( _mm256_loadu_ps( a + i + 8 ),
+                                                   _mm256_loadu_ps( b + i + 8 ) ) );
+    }
+    acc0 = _mm256_add_ps( acc0, acc1 );
+
+    __m128 acc = _mm_add_ps( _mm256_castps256_ps128( acc0 ),
+                             _mm256_extractf128_ps( acc0, 1 ) );
+    for( ; i + 4 <= n; i += 4 )
+        acc = _mm_add_ps( acc, _mm_mul_ps( _mm_loadu_ps( a + i ),
+                                           _mm_loadu_ps( b + i ) ) );
+    acc = _mm_add_ps( acc, _mm_movehl_ps( acc, acc ) );
+    acc = _mm_add_ss( acc, _mm_shuffle_ps( acc, acc, 1 ) );
+
+    float corr = _mm_cvtss_f32( acc );
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+#endif
+
+static dot_t find_dot( bool simd )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if( simd && vlc_CPU_AVX2() )
+        return dot_avx2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if( simd && vlc_CPU_SSE2() )
+        return dot_sse2;
+#endif
+    VLC_UNUSED( simd );
+    return dot_c;
+}
+
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
@@ -146,6 +249,7 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     float best_corr = INT_MIN;
     unsigned best_off = 0;
     unsigned i, off;
+    const unsigned samples = p->samples_overlap - p->samples_per_frame;
 
     pw  = p->table_window;
     po  = p->buf_overlap;
@@ -157,12 +261,7 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
 
     search_start = (float *)p->buf_queue + p->samples_per_frame;
     for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
+      float corr = p->dot( p->buf_pre_corr, search_start, samples );
       if( corr > best_corr ) {
         best_corr = corr;
         best_off  = off;
@@ -434,6 +533,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->bytes_queued   = 0;
     p_sys->bytes_to_slide = 0;
     p_sys->frames_stride_error = 0;
+    p_sys->dot = find_dot( true );
 
     if( reinit_buffers( p_filter ) != VLC_SUCCESS )
     {
@@ -572,7 +672,7 @@ static block_t *DoWork( filter_t * p_filter, block_t * p_in_buf )
                                    p_in_buf->i_buffer, 0 );
     if( i_outsize > 0 )
     {
-        p_out_buf = block_Alloc( i_outsize );
+        p_out_buf = filter_NewAudioBuffer( p_filter, i_outsize );
         if( p_out_buf == NULL )
         {
             block_Release( p_in_buf );
@@ -617,3 +717,187 @@ static block_t *DoPitchWork( filter_t * p_filter, block_t * p_in_buf )
     return DoWork( p_filter, p_in_buf );
 }
 #endif
+
+#ifdef SCALETEMPO_TEST
+# include <math.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <unistd.h>
+# include "../../lib/libvlc_internal.h"
+
+# define RATE 44100
+
+static const struct
+{
+    int   stride;
+    float overlap;
+    int   search;
+} settings[] = {
+    { 30, .20f, 14, }, /* defaults */
+    { 30, .50f, 28, },
+    { 60, .20f, 14, },
+    { 60, .40f, 40, },
+    { 100, .30f, 60, },
+};
+
+static filter_t *CreateScaletempo( vlc_object_t *parent, unsigned channels,
+                                   int stride, float overlap, int search,
+                                   bool simd )
+{
+    filter_t *p_filter = vlc_object_create( parent, sizeof (*p_filter) );
+    assert( p_filter != NULL );
+
+    var_Create( p_filter, "scaletempo-stride", VLC_VAR_INTEGER );
+    var_SetInteger( p_filter, "scaletempo-stride", stride );
+    var_Create( p_filter, "scaletempo-overlap", VLC_VAR_FLOAT );
+    var_SetFloat( p_filter, "scaletempo-overlap", overlap );
+    var_Create( p_filter, "scaletempo-search", VLC_VAR_INTEGER );
+    var_SetInteger( p_filter, "scaletempo-search", search );
+
+    audio_format_t *fmt = &p_filter->fmt_in.audio;
+    fmt->i_format = VLC_CODEC_FL32;
+    fmt->i_rate = RATE;
+    fmt->i_physical_channels = channels == 1 ? AOUT_CHAN_CENTER
+                                             : AOUT_CHANS_STEREO;
+    fmt->i_channels = channels;
+    aout_FormatPrepare( fmt );
+    p_filter->fmt_out = p_filter->fmt_in;
+
+    int ret = Open( VLC_OBJECT(p_filter) );
+    assert( ret == VLC_SUCCESS );
+    if( !simd )
+    {
+        filter_sys_t *p_sys = p_filter->p_sys;
+        p_sys->dot = dot_c;
+    }
+    return p_filter;
+}
+
+static void DestroyScaletempo( filter_t *p_filter )
+{
+    Close( VLC_OBJECT(p_filter) );
+    vlc_object_delete( p_filter );
+}
+
+static void FillNoise( float *buf, size_t count, unsigned *seed )
+{
+    /* Noise with a slow sine, so that the correlation has a clear peak */
+    for( size_t i = 0; i < count; i++ )
+    {
+        *seed = *seed * 1103515245 + 12345;
+        buf[i] = ((int)(*seed >> 8) - (1 << 23)) / (float)(1 << 24)
+               + .5f * sinf( i * .01f );
+    }
+}
+
+/* Plays the given duration at the given rate, returns the output frames */
+static size_t Run( filter_t *p_filter, double rate, double seconds,
+                   block_t **pout, vlc_tick_t *duration )
+{
+    const unsigned channels = p_filter->fmt_in.audio.i_channels;
+    const size_t frames = seconds * RATE;
+    unsigned seed = 1;
+    size_t out_frames = 0;
+    block_t *out = NULL;
+
+    p_filter->fmt_in.audio.i_rate = RATE * rate;
+    *duration = 0;
+
+    for( size_t done = 0; done < frames; )
+    {
+        size_t count = __MIN( frames - done, 1024 + done % 777 );
+        block_t *in = block_Alloc( count * channels * sizeof (float) );
+        assert( in != NULL );
+        FillNoise( (float *)in->p_buffer, count * channels, &seed );
+        in->i_nb_samples = count;
+        in->i_pts = in->i_dts = VLC_TICK_0 + vlc_tick_from_samples( done, RATE );
+        done += count;
+
+        vlc_tick_t start = vlc_tick_now();
+        block_t *res = DoWork( p_filter, in );
+        *duration += vlc_tick_now() - start;
+
+        if( res == NULL )
+            continue;
+        out_frames += res->i_nb_samples;
+        if( pout != NULL )
+            block_ChainAppend( &out, res );
+        else
+            block_Release( res );
+    }
+
+    if( pout != NULL )
+        *pout = block_ChainGather( out );
+    return out_frames;
+}
+
+int main( int argc, char **argv )
+{
+    const bool bench = argc > 1 && !strcmp( argv[1], "bench" );
+    const double seconds = argc > 2 ? atof( argv[2] ) : 20.;
+    static const double rates[] = { .75, 1.5, 2. };
+
+    alarm( bench ? 0 : 60 );
+
+    libvlc_int_t *vlc = libvlc_InternalCreate();
+    assert( vlc != NULL );
+
+    const bool has_simd = find_dot( true ) != dot_c;
+    if( !bench && !has_simd )
+        fprintf( stderr, "WARNING: no vectorized correlation to compare\n" );
+
+    for( size_t i = 0; i < ARRAY_SIZE(settings); i++ )
+        for( size_t j = 0; j < ARRAY_SIZE(rates); j++ )
+            for( unsigned channels = 1; channels <= 2; channels++ )
+            {
+                if( bench && channels == 1 )
+                    continue;
+
+                filter_t *c = CreateScaletempo( VLC_OBJECT(vlc), channels,
+                                                settings[i].stride,
+                                                settings[i].overlap,
+                                                settings[i].search, false );
+                filter_t *simd = CreateScaletempo( VLC_OBJECT(vlc), channels,
+                                                   settings[i].stride,
+                                                   settings[i].overlap,
+                                                   settings[i].search, true );
+                const double len = bench ? seconds : 2.;
+                block_t *ref, *out;
+                vlc_tick_t dc, ds;
+                size_t nc = Run( c, rates[j], len, bench ? NULL : &ref, &dc );
+                size_t ns = Run( simd, rates[j], len, bench ? NULL : &out, &ds );
+
+                assert( nc == ns );
+                /* The output duration follows the rate */
+                assert( fabs( nc * rates[j] - len * RATE )
+                        < 2. * (settings[i].stride + settings[i].search
+                                + 10) * RATE / 1000. * rates[j] );
+
+                if( bench )
+                    printf( "stride %3d ms, overlap %.2f, search %2d ms, "
+                            "rate %.2f: C %6.1fx, SIMD %6.1fx real time\n",
+                            settings[i].stride, settings[i].overlap,
+                            settings[i].search, rates[j],
+                            len * CLOCK_FREQ / __MAX(dc, 1),
+                            len * CLOCK_FREQ / __MAX(ds, 1) );
+                else
+                {
+                    /* Only rounding differences, unless the best overlap
+                     * of the C and vectorized searches differ */
+                    const float *a = (const float *)ref->p_buffer;
+                    const float *b = (const float *)out->p_buffer;
+                    assert( ref->i_buffer == out->i_buffer );
+                    for( size_t k = 0; k < ref->i_buffer / sizeof (float); k++ )
+                        assert( fabsf( a[k] - b[k] ) < 1e-4f );
+                    block_Release( out );
+                    block_Release( ref );
+                }
+
+                DestroyScaletempo( simd );
+                DestroyScaletempo( c );
+            }
+
+    libvlc_InternalDestroy( vlc );
+    return bench || has_simd ? 0 : 77;
+}
+#endif
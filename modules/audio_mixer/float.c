@@ -28,27 +28,26 @@
 # include "config.h"
 #endif
 
+#ifdef FLOAT_MIXER_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
 #include <stddef.h>
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
-/*****************************************************************************
- * Local prototypes
- *****************************************************************************/
-static int Create( vlc_object_t * );
-
-/*****************************************************************************
- * Module descriptor
- *****************************************************************************/
-vlc_module_begin ()
-    set_category( CAT_AUDIO )
-    set_subcategory( SUBCAT_AUDIO_MISC )
-    set_description( N_("Single precision audio volume") )
-    set_capability( "audio volume", 10 )
-    set_callbacks( Create, NULL )
-vlc_module_end ()
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
 
 /**
  * Mixes a new output buffer
@@ -80,6 +79,145 @@ static void FilterFL64( audio_volume_t *p_volume, block_t *p_buffer,
     (void) p_volume;
 }
 
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static void FilterFL32_SSE2( audio_volume_t *p_volume, block_t *p_buffer,
+                             float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i = p_buffer->i_buffer / sizeof(*p);
+    const __m128 mult = _mm_set1_ps( f_multiplier );
+
+    for( ; i >= 8; i -= 8, p += 8 )
+    {
+        _mm_storeu_ps( p,     _mm_mul_ps( _mm_loadu_ps( p ),     mult ) );
+        _mm_storeu_ps( p + 4, _mm_mul_ps( _mm_loadu_ps( p + 4 ), mult ) );
+    }
+    for( ; i > 0; i-- )
+        *(p++) *= f_multiplier;
+
+    (void) p_volume;
+}
+
+VLC_SSE2
+static void FilterFL64_SSE2( audio_volume_t *p_volume, block_t *p_buffer,
+                             float f_multiplier )
+{
+    double *p = (double *)p_buffer->p_buffer;
+    double mult = f_multiplier;
+    if( mult == 1. )
+        return; /* nothing to do */
+
+    size_t i = p_buffer->i_buffer / sizeof(*p);
+    const __m128d vmult = _mm_set1_pd( mult );
+
+    for( ; i >= 4; i -= 4, p += 4 )
+    {
+        _mm_storeu_pd( p,     _mm_mul_pd( _mm_loadu_pd( p ),     vmult ) );
+        _mm_storeu_pd( p + 2, _mm_mul_pd( _mm_loadu_pd( p + 2 ), vmult ) );
+    }
+    for( ; i > 0; i-- )
+        *(p++) *= mult;
+
+    (void) p_volume;
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static void FilterFL32_AVX2( audio_volume_t *p_volume, block_t *p_buffer,
+                             float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i = p_buffer->i_buffer / sizeof(*p);
+    const __m256 mult = _mm256_set1_ps( f_multiplier );
+
+    for( ; i >= 16; i -= 16, p += 16 )
+    {
+        _mm256_storeu_ps( p,     _mm256_mul_ps( _mm256_loadu_ps( p ),     mult ) );
+        _mm256_storeu_ps( p + 8, _mm256_mul_ps( _mm256_loadu_ps( p + 8 ), mult ) );
+    }
+    for( ; i > 0; i-- )
+        *(p++) *= f_multiplier;
+
+    (void) p_volume;
+}
+
+VLC_AVX2
+static void FilterFL64_AVX2( audio_volume_t *p_volume, block_t *p_buffer,
+                             float f_multiplier )
+{
+    double *p = (double *)p_buffer->p_buffer;
+    double mult = f_multiplier;
+    if( mult == 1. )
+        return; /* nothing to do */
+
+    size_t i = p_buffer->i_buffer / sizeof(*p);
+    const __m256d vmult = _mm256_set1_pd( mult );
+
+    for( ; i >= 8; i -= 8, p += 8 )
+    {
+        _mm256_storeu_pd( p,     _mm256_mul_pd( _mm256_loadu_pd( p ),     vmult ) );
+        _mm256_storeu_pd( p + 4, _mm256_mul_pd( _mm256_loadu_pd( p + 4 ), vmult ) );
+    }
+    for( ; i > 0; i-- )
+        *(p++) *= mult;
+
+    (void) p_volume;
+}
+#endif
+
+typedef void (*amplify_t)( audio_volume_t *, block_t *, float );
+
+static amplify_t FindAmplify( vlc_fourcc_t format, bool simd )
+{
+    switch( format )
+    {
+        case VLC_CODEC_FL32:
+#ifdef HAVE_AVX2_INTRINSICS
+            if( simd && vlc_CPU_AVX2() )
+                return FilterFL32_AVX2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+            if( simd && vlc_CPU_SSE2() )
+                return FilterFL32_SSE2;
+#endif
+            return FilterFL32;
+        case VLC_CODEC_FL64:
+#ifdef HAVE_AVX2_INTRINSICS
+            if( simd && vlc_CPU_AVX2() )
+                return FilterFL64_AVX2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+            if( simd && vlc_CPU_SSE2() )
+                return FilterFL64_SSE2;
+#endif
+            return FilterFL64;
+    }
+    (void) simd;
+    return NULL;
+}
+
+#ifndef FLOAT_MIXER_TEST
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int Create( vlc_object_t * );
+
+vlc_module_begin ()
+    set_category( CAT_AUDIO )
+    set_subcategory( SUBCAT_AUDIO_MISC )
+    set_description( N_("Single precision audio volume") )
+    set_capability( "audio volume", 10 )
+    set_callbacks( Create, NULL )
+vlc_module_end ()
+
 /**
  * Initializes the mixer
  */
@@ -87,16 +225,20 @@ static int Create( vlc_object_t *p_this )
 {
     audio_volume_t *p_volume = (audio_volume_t *)p_this;
 
-    switch (p_volume->format)
-    {
-        case VLC_CODEC_FL32:
-            p_volume->amplify = FilterFL32;
-            break;
-        case VLC_CODEC_FL64:
-            p_volume->amplify = FilterFL64;
-            break;
-        default:
-            return -1;
-    }
+    p_volume->amplify = FindAmplify( p_volume->format, true );
+    if( p_volume->amplify == NULL )
+        return -1;
     return 0;
 }
+
+#else /* FLOAT_MIXER_TEST */
+#include "../audio_filter/kernel_test.h"
+
+int main( int argc, char **argv )
+{
+    static const vlc_fourcc_t formats[] = { VLC_CODEC_FL32, VLC_CODEC_FL64 };
+
+    return AudioKernelTestVolume( argc, argv, formats, ARRAY_SIZE(formats),
+                                  FindAmplify );
+}
+#endif /* FLOAT_MIXER_TEST */
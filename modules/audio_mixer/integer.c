@@ -22,23 +22,28 @@
 # include "config.h"
 #endif
 
+#ifdef INTEGER_MIXER_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
 #include <math.h>
 #include <limits.h>
 
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
-static int Activate (vlc_object_t *);
-
-vlc_module_begin ()
-    set_category (CAT_AUDIO)
-    set_subcategory (SUBCAT_AUDIO_MISC)
-    set_description (N_("Integer audio volume"))
-    set_capability ("audio volume", 9)
-    set_callbacks (Activate, NULL)
-vlc_module_end ()
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
 
 static void FilterS32N (audio_volume_t *vol, block_t *block, float volume)
 {
@@ -103,23 +108,136 @@ static void FilterU8 (audio_volume_t *vol, block_t *block, float volume)
     (void) vol;
 }
 
-static int Activate (vlc_object_t *obj)
+/* The vector versions multiply by a 16-bits factor, and defer to the C
+ * version for the (unusual) volumes of 128 and more. */
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static void FilterS16N_SSE2 (audio_volume_t *vol, block_t *block, float volume)
 {
-    audio_volume_t *vol = (audio_volume_t *)obj;
+    int16_t *p = (int16_t *)block->p_buffer;
+
+    int_fast32_t mult = lroundf (volume * 0x1.p8f);
+    if (mult == (1 << 8))
+        return;
+    if (mult > INT16_MAX)
+    {
+        FilterS16N (vol, block, volume);
+        return;
+    }
+
+    const __m128i m = _mm_set1_epi16 (mult);
+    size_t n = block->i_buffer / sizeof (*p);
+
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        __m128i s = _mm_loadu_si128 ((const __m128i *)p);
+        __m128i lo = _mm_mullo_epi16 (s, m);
+        __m128i hi = _mm_mulhi_epi16 (s, m);
+        __m128i s0 = _mm_srai_epi32 (_mm_unpacklo_epi16 (lo, hi), 8);
+        __m128i s1 = _mm_srai_epi32 (_mm_unpackhi_epi16 (lo, hi), 8);
+        _mm_storeu_si128 ((__m128i *)p, _mm_packs_epi32 (s0, s1));
+    }
+    for (; n > 0; n--)
+    {
+        int_fast32_t s = (*p * (int_fast32_t)mult) >> 8;
+        *(p++) = __MIN(__MAX(s, INT16_MIN), INT16_MAX);
+    }
+    (void) vol;
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static void FilterS16N_AVX2 (audio_volume_t *vol, block_t *block, float volume)
+{
+    int16_t *p = (int16_t *)block->p_buffer;
+
+    int_fast32_t mult = lroundf (volume * 0x1.p8f);
+    if (mult == (1 << 8))
+        return;
+    if (mult > INT16_MAX)
+    {
+        FilterS16N (vol, block, volume);
+        return;
+    }
 
-    switch (vol->format)
+    const __m256i m = _mm256_set1_epi16 (mult);
+    size_t n = block->i_buffer / sizeof (*p);
+
+    /* The unpacking and the packing both work within 128-bits lanes, so
+     * they preserve the order of the samples. */
+    for (; n >= 16; n -= 16, p += 16)
+    {
+        __m256i s = _mm256_loadu_si256 ((const __m256i *)p);
+        __m256i lo = _mm256_mullo_epi16 (s, m);
+        __m256i hi = _mm256_mulhi_epi16 (s, m);
+        __m256i s0 = _mm256_srai_epi32 (_mm256_unpacklo_epi16 (lo, hi), 8);
+        __m256i s1 = _mm256_srai_epi32 (_mm256_unpackhi_epi16 (lo, hi), 8);
+        _mm256_storeu_si256 ((__m256i *)p, _mm256_packs_epi32 (s0, s1));
+    }
+    for (; n > 0; n--)
+    {
+        int_fast32_t s = (*p * (int_fast32_t)mult) >> 8;
+        *(p++) = __MIN(__MAX(s, INT16_MIN), INT16_MAX);
+    }
+    (void) vol;
+}
+#endif
+
+typedef void (*amplify_t) (audio_volume_t *, block_t *, float);
+
+static amplify_t FindAmplify (vlc_fourcc_t format, bool simd)
+{
+    switch (format)
     {
         case VLC_CODEC_S32N:
-            vol->amplify = FilterS32N;
-            break;
+            return FilterS32N;
         case VLC_CODEC_S16N:
-            vol->amplify = FilterS16N;
-            break;
+#ifdef HAVE_AVX2_INTRINSICS
+            if (simd && vlc_CPU_AVX2 ())
+                return FilterS16N_AVX2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+            if (simd && vlc_CPU_SSE2 ())
+                return FilterS16N_SSE2;
+#endif
+            return FilterS16N;
         case VLC_CODEC_U8:
-            vol->amplify = FilterU8;
-            break;
-        default:
-            return -1;
+            return FilterU8;
     }
+    (void) simd;
+    return NULL;
+}
+
+#ifndef INTEGER_MIXER_TEST
+static int Activate (vlc_object_t *);
+
+vlc_module_begin ()
+    set_category (CAT_AUDIO)
+    set_subcategory (SUBCAT_AUDIO_MISC)
+    set_description (N_("Integer audio volume"))
+    set_capability ("audio volume", 9)
+    set_callbacks (Activate, NULL)
+vlc_module_end ()
+
+static int Activate (vlc_object_t *obj)
+{
+    audio_volume_t *vol = (audio_volume_t *)obj;
+
+    vol->amplify = FindAmplify (vol->format, true);
+    if (vol->amplify == NULL)
+        return -1;
     return 0;
 }
+
+#else /* INTEGER_MIXER_TEST */
+#include "../audio_filter/kernel_test.h"
+
+int main (int argc, char **argv)
+{
+    static const vlc_fourcc_t formats[] = { VLC_CODEC_S16N };
+
+    return AudioKernelTestVolume (argc, argv, formats, ARRAY_SIZE(formats),
+                                  FindAmplify);
+}
+#endif /* INTEGER_MIXER_TEST */
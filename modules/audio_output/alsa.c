@@ -523,8 +523,11 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
     sys->rate = fmt->i_rate;
 
+    /* In low latency mode, keep only a few periods in the buffer */
+    const vlc_tick_t period = aout_PeriodRequest(aout);
+
 #if 1 /* work-around for period-long latency outputs (e.g. PulseAudio): */
-    param = AOUT_MIN_PREPARE_TIME;
+    param = period ? period : AOUT_MIN_PREPARE_TIME;
     val = snd_pcm_hw_params_set_period_time_near (pcm, hw, &param, NULL);
     if (val)
     {
@@ -533,7 +536,7 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
 #endif
     /* Set buffer size */
-    param = AOUT_MAX_ADVANCE_TIME;
+    param = period ? 4 * period : AOUT_MAX_ADVANCE_TIME;
     val = snd_pcm_hw_params_set_buffer_time_near (pcm, hw, &param, NULL);
     if (val)
     {
@@ -574,8 +577,19 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     snd_pcm_sw_params_current (pcm, sw);
     Dump (aout, "initial software parameters:\n", snd_pcm_sw_params_dump, sw);
 
+    if (period)
+    {   /* Wake up once per period */
+        snd_pcm_uframes_t period_size;
+
+        val = snd_pcm_hw_params_get_period_size (hw, &period_size, NULL);
+        if (val == 0)
+            val = snd_pcm_sw_params_set_avail_min (pcm, sw, period_size);
+        if (val < 0)
+            msg_Warn (aout, "cannot set minimum available samples: %s",
+                      snd_strerror (val));
+    }
+
     /* START REVISIT */
-    //snd_pcm_sw_params_set_avail_min( pcm, sw, i_period_size );
     // FIXME: useful?
     val = snd_pcm_sw_params_set_start_threshold (pcm, sw, 1);
     if( val < 0 )
@@ -785,10 +785,16 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
     /* PulseAudio goes berserk if the target length (tlength) is not
      * significantly longer than 2 periods (minreq), or when the period length
      * is unspecified and the target length is short. */
-    attr.tlength = pa_usec_to_bytes(3 * AOUT_MIN_PREPARE_TIME, &ss);
+    const vlc_tick_t period = aout_PeriodRequest(aout);
+    const vlc_tick_t minreq = period ? period : AOUT_MIN_PREPARE_TIME;
+
+    attr.tlength = pa_usec_to_bytes(3 * minreq, &ss);
     attr.prebuf = 0; /* trigger manually */
-    attr.minreq = pa_usec_to_bytes(AOUT_MIN_PREPARE_TIME, &ss);
+    attr.minreq = pa_usec_to_bytes(minreq, &ss);
     attr.fragsize = 0; /* not used for output */
+    if (period)
+        /* Make the server latency follow the target length */
+        flags |= PA_STREAM_ADJUST_LATENCY;
 
     pa_cvolume *cvolume = NULL, cvolumebuf;
     if (PA_VOLUME_IS_VALID(sys->volume_force))
@@ -814,7 +820,7 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
         /* Setup low latency in order to quickly react to ambisonics
          * filters viewpoint changes. */
         flags |= PA_STREAM_ADJUST_LATENCY;
-        attr.tlength = pa_usec_to_bytes(3 * AOUT_MIN_PREPARE_TIME, &ss);
+        attr.tlength = pa_usec_to_bytes(3 * minreq, &ss);
     }
 
     if (encoding != PA_ENCODING_PCM)
@@ -532,8 +532,14 @@ static HRESULT Start(aout_stream_t *s, audio_sample_format_t *restrict pfmt,
         }
         else
         {
+            /* same as aout_PeriodRequest() */
+            vlc_tick_t period =
+                VLC_TICK_FROM_MS(var_InheritInteger(s, "audio-period"));
+
             vlc_ToWave(pwfe, &fmt);
-            buffer_duration = MSFTIME_FROM_VLC_TICK(AOUT_MAX_PREPARE_TIME);
+            /* In low latency mode, keep only a few periods in the buffer */
+            buffer_duration = MSFTIME_FROM_VLC_TICK(period ? 4 * period
+                                                    : AOUT_MAX_PREPARE_TIME);
         }
     }
     else
@@ -234,6 +234,10 @@ vlc_module_begin ()
                 ENC_PROFILE_TEXT, ENC_PROFILE_LONGTEXT, true )
 
     add_string( ENC_CFG_PREFIX "options", NULL, AV_OPTIONS_TEXT, AV_OPTIONS_LONGTEXT, true )
+#if AVCODEC_HW_ENCODER
+    add_string( ENC_CFG_PREFIX "hw-device", NULL,
+                ENC_HW_DEVICE_TEXT, ENC_HW_DEVICE_LONGTEXT, true )
+#endif
 #endif /* ENABLE_SOUT */
 
 #ifdef MERGE_FFMPEG
@@ -232,6 +232,17 @@ int ffmpeg_OpenCodec( decoder_t *p_dec, AVCodecContext *, const AVCodec * );
    "main, low, ssr (not supported),ltp, hev1, hev2 (default: low). " \
    "hev1 and hev2 are currently supported only with libfdk-aac enabled libavcodec" )
 
+#define ENC_HW_DEVICE_TEXT N_( "Hardware encoding device" )
+#define ENC_HW_DEVICE_LONGTEXT N_( "Device used by hardware encoders " \
+  "such as h264_vaapi or h264_qsv, for instance a DRM render node. " \
+  "Pictures are uploaded to it before encoding (default: system default)." )
+
+/* Hardware-only encoders need avcodec_get_hw_config() (FFmpeg 4.0) */
+#define AVCODEC_HW_ENCODER \
+    ( LIBAVCODEC_VERSION_MICRO >= 100 /* FFmpeg only */ && \
+      LIBAVCODEC_VERSION_INT >= AV_VERSION_INT( 58, 18, 100 ) && \
+      LIBAVUTIL_VERSION_CHECK( 56, 0, 0, 14, 100 ) )
+
 #ifndef AV_VERSION_INT
 #   define AV_VERSION_INT(a, b, c) ((a)<<16 | (b)<<8 | (c))
 #endif
@@ -330,6 +330,15 @@ int directx_va_Setup(vlc_va_t *va, directx_sys_t *dx_sys, const AVCodecContext *
     if ( avctx->active_thread_type & FF_THREAD_FRAME )
         surface_count += avctx->thread_count;
 
+    /* The demuxer may announce the largest size of the stream, for instance
+     * the adaptation set of an adaptive stream. Pictures from the display pool
+     * cannot be made larger. */
+    if (!dx_sys->can_extern_pool)
+    {
+        dx_sys->va_pool.hint_width  = fmt->video.i_max_width;
+        dx_sys->va_pool.hint_height = fmt->video.i_max_height;
+    }
+
     int err = va_pool_SetupDecoder(va, &dx_sys->va_pool, avctx, surface_count, surface_alignment);
     if (err != VLC_SUCCESS)
         return err;
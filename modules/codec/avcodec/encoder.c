@@ -49,6 +49,11 @@
 
 #include <libavutil/channel_layout.h>
 
+#if AVCODEC_HW_ENCODER
+# include <libavutil/hwcontext.h>
+# include <libavutil/pixdesc.h>
+#endif
+
 #define HURRY_UP_GUARD1 VLC_TICK_FROM_MS(450)
 #define HURRY_UP_GUARD2 VLC_TICK_FROM_MS(300)
 #define HURRY_UP_GUARD3 VLC_TICK_FROM_MS(100)
@@ -143,6 +148,12 @@ typedef struct
     int        i_aac_profile; /* AAC profile to use.*/
 
     AVFrame    *frame;
+
+#if AVCODEC_HW_ENCODER
+    /* Hardware encoders: pictures are uploaded to these frames */
+    AVBufferRef *hw_device;
+    AVBufferRef *hw_frames;
+#endif
 } encoder_sys_t;
 
 
@@ -191,6 +202,9 @@ static const char *const ppsz_enc_options[] = {
     "trellis", "qscale", "strict", "lumi-masking", "dark-masking",
     "p-masking", "border-masking",
     "aac-profile", "options",
+#if AVCODEC_HW_ENCODER
+    "hw-device",
+#endif
     NULL
 };
 
@@ -288,6 +302,94 @@ static void add_av_option_float( encoder_t *p_enc, AVDictionary** pp_dict, const
         msg_Warn( p_enc, "Failed to set encoder option %s", psz_name );
 }
 
+#if AVCODEC_HW_ENCODER
+/*****************************************************************************
+ * OpenHwFrames: set up the frames pool of a hardware-only encoder
+ *****************************************************************************
+ * Encoders such as h264_vaapi only accept frames living in device memory.
+ * The pictures handed by the transcoder are in system memory, so create a
+ * device and a frames pool, and let EncodeVideo upload each picture.
+ * Returns the software pixel format to request from the transcoder.
+ *****************************************************************************/
+static enum AVPixelFormat OpenHwFrames( encoder_t *p_enc, encoder_sys_t *p_sys,
+                                        enum AVPixelFormat hw_fmt )
+{
+    AVCodecContext *p_context = p_sys->p_context;
+    const AVCodecHWConfig *cfg = NULL;
+
+    for( int i = 0; (cfg = avcodec_get_hw_config( p_sys->p_codec, i )); i++ )
+        if( cfg->pix_fmt == hw_fmt &&
+            (cfg->methods & AV_CODEC_HW_CONFIG_METHOD_HW_FRAMES_CTX) )
+            break;
+    if( cfg == NULL || cfg->device_type == AV_HWDEVICE_TYPE_NONE )
+        return AV_PIX_FMT_NONE;
+
+    char *psz_device = var_GetNonEmptyString( p_enc, ENC_CFG_PREFIX "hw-device" );
+    int ret = av_hwdevice_ctx_create( &p_sys->hw_device, cfg->device_type,
+                                      psz_device, NULL, 0 );
+    free( psz_device );
+    if( ret < 0 )
+    {
+        msg_Err( p_enc, "cannot open %s device for encoding",
+                 av_hwdevice_get_type_name( cfg->device_type ) );
+        return AV_PIX_FMT_NONE;
+    }
+
+    /* Prefer a layout the transcoder can output without conversion */
+    enum AVPixelFormat sw_fmt = AV_PIX_FMT_NV12;
+    AVHWFramesConstraints *constraints =
+        av_hwdevice_get_hwframe_constraints( p_sys->hw_device, NULL );
+    if( constraints && constraints->valid_sw_formats )
+    {
+        video_format_t fmt;
+        sw_fmt = AV_PIX_FMT_NONE;
+        for( const enum AVPixelFormat *p = constraints->valid_sw_formats;
+             *p != AV_PIX_FMT_NONE; p++ )
+        {
+            if( *p == AV_PIX_FMT_NV12 || *p == AV_PIX_FMT_YUV420P )
+            {
+                sw_fmt = *p;
+                break;
+            }
+            if( sw_fmt == AV_PIX_FMT_NONE && GetVlcChroma( &fmt, *p ) == VLC_SUCCESS )
+                sw_fmt = *p;
+        }
+    }
+    av_hwframe_constraints_free( &constraints );
+    if( sw_fmt == AV_PIX_FMT_NONE )
+        goto error;
+
+    p_sys->hw_frames = av_hwframe_ctx_alloc( p_sys->hw_device );
+    if( p_sys->hw_frames == NULL )
+        goto error;
+
+    AVHWFramesContext *frames = (AVHWFramesContext *)p_sys->hw_frames->data;
+    frames->format = hw_fmt;
+    frames->sw_format = sw_fmt;
+    frames->width = p_context->width;
+    frames->height = p_context->height;
+    /* Some APIs (QSV) need a fixed pool: leave room for the look-ahead */
+    frames->initial_pool_size = 20;
+
+    if( av_hwframe_ctx_init( p_sys->hw_frames ) < 0 )
+        goto error;
+
+    p_context->hw_frames_ctx = av_buffer_ref( p_sys->hw_frames );
+    if( p_context->hw_frames_ctx == NULL )
+        goto error;
+
+    msg_Dbg( p_enc, "using %s frames for encoding",
+             av_hwdevice_get_type_name( cfg->device_type ) );
+    return sw_fmt;
+error:
+    msg_Err( p_enc, "cannot create %s frames for encoding",
+             av_hwdevice_get_type_name( cfg->device_type ) );
+    av_buffer_unref( &p_sys->hw_frames );
+    av_buffer_unref( &p_sys->hw_device );
+    return AV_PIX_FMT_NONE;
+}
+#endif
+
 int InitVideoEnc( vlc_object_t *p_this )
 {
     encoder_t *p_enc = (encoder_t *)p_this;
@@ -567,7 +669,22 @@ int InitVideoEnc( vlc_object_t *p_this )
                 }
             }
             if (!found) p_context->pix_fmt = p_codec->pix_fmts[0];
-            GetVlcChroma( &p_enc->fmt_in.video, p_context->pix_fmt );
+
+            enum AVPixelFormat sw_fmt = p_context->pix_fmt;
+#if AVCODEC_HW_ENCODER
+            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get( sw_fmt );
+            if( desc && (desc->flags & AV_PIX_FMT_FLAG_HWACCEL) )
+            {
+                sw_fmt = OpenHwFrames( p_enc, p_sys, p_context->pix_fmt );
+                if( sw_fmt == AV_PIX_FMT_NONE )
+                {
+                    avcodec_free_context( &p_context );
+                    free( p_sys );
+                    return VLC_EGENERIC;
+                }
+            }
+#endif
+            GetVlcChroma( &p_enc->fmt_in.video, sw_fmt );
             p_enc->fmt_in.i_codec = p_enc->fmt_in.video.i_chroma;
         }
 
@@ -1050,6 +1167,10 @@ error:
     av_free( p_sys->p_buffer );
     av_free( p_sys->p_interleave_buf );
     avcodec_free_context( &p_context );
+#if AVCODEC_HW_ENCODER
+    av_buffer_unref( &p_sys->hw_frames );
+    av_buffer_unref( &p_sys->hw_device );
+#endif
     free( p_sys );
     return VLC_ENOMEM;
 }
@@ -1232,7 +1353,31 @@ static block_t *EncodeVideo( encoder_t *p_enc, picture_t *p_pict )
         frame->quality = p_sys->i_quality;
     }
 
+#if AVCODEC_HW_ENCODER
+    AVFrame *hw_frame = NULL;
+    if( p_sys->hw_frames && frame )
+    {
+        /* Upload the picture to a frame of the device pool */
+        hw_frame = av_frame_alloc();
+        if( unlikely(hw_frame == NULL) )
+            return NULL;
+        frame->format = ((AVHWFramesContext *)p_sys->hw_frames->data)->sw_format;
+        if( av_hwframe_get_buffer( p_sys->hw_frames, hw_frame, 0 ) < 0 ||
+            av_hwframe_transfer_data( hw_frame, frame, 0 ) < 0 ||
+            av_frame_copy_props( hw_frame, frame ) < 0 )
+        {
+            msg_Warn( p_enc, "cannot upload one frame to the encoder" );
+            av_frame_free( &hw_frame );
+            return NULL;
+        }
+        frame = hw_frame;
+    }
+#endif
+
     block_t *p_block = encode_avframe( p_enc, p_sys, frame );
+#if AVCODEC_HW_ENCODER
+    av_frame_free( &hw_frame );
+#endif
 
     if( p_block )
     {
@@ -1467,7 +1612,10 @@ void EndVideoEnc( vlc_object_t *p_this )
     avcodec_close( p_sys->p_context );
     vlc_avcodec_unlock();
     avcodec_free_context( &p_sys->p_context );
-
+#if AVCODEC_HW_ENCODER
+    av_buffer_unref( &p_sys->hw_frames );
+    av_buffer_unref( &p_sys->hw_device );
+#endif
 
     av_free( p_sys->p_interleave_buf );
     av_free( p_sys->p_buffer );
@@ -42,16 +42,35 @@ typedef struct
 
 #include "avcodec.h"
 
+/* Surfaces of a pool handed to the decoder and not released yet. It is shared
+ * with the surfaces as they can outlive the pool. */
+struct va_pool_usage {
+    atomic_uint          refcount;
+    atomic_uint          in_use;
+};
+
 struct vlc_va_surface_t {
     atomic_uintptr_t     refcount;
+    struct va_pool_usage *usage;
 };
 
+static void va_pool_usage_Release(struct va_pool_usage *usage)
+{
+    if (atomic_fetch_sub(&usage->refcount, 1) == 1)
+        free(usage);
+}
+
 static void DestroyVideoDecoder(vlc_va_t *va, va_pool_t *va_pool)
 {
     for (unsigned i = 0; i < va_pool->surface_count; i++)
         va_surface_Release(va_pool->surface[i]->va_surface);
     va_pool->pf_destroy_surfaces(va);
     va_pool->surface_count = 0;
+    if (va_pool->usage != NULL)
+    {
+        va_pool_usage_Release(va_pool->usage);
+        va_pool->usage = NULL;
+    }
 }
 
 /* */
@@ -73,11 +92,25 @@ int va_pool_SetupDecoder(vlc_va_t *va, va_pool_t *va_pool, const AVCodecContext
                   surface_width, surface_height,
                   avctx->coded_width, avctx->coded_height);
 
+    /* Create for the largest size of the stream, so that a later resolution
+     * switch within that size ends up with the same decoder and surfaces */
+    if (va_pool->hint_width > 0 && va_pool->hint_height > 0)
+    {
+        int hint_width  = ALIGN(va_pool->hint_width,  alignment);
+        int hint_height = ALIGN(va_pool->hint_height, alignment);
+        if (hint_width > surface_width)
+            surface_width = hint_width;
+        if (hint_height > surface_height)
+            surface_height = hint_height;
+    }
+
+    /* The decoder was created along with the surfaces, for their size */
     if ( va_pool->surface_count >= count &&
          va_pool->surface_width == surface_width &&
          va_pool->surface_height == surface_height )
     {
         msg_Dbg(va, "reusing surface pool");
+        va_pool->stats.reuses++;
         err = VLC_SUCCESS;
         goto done;
     }
@@ -104,6 +137,7 @@ int va_pool_SetupDecoder(vlc_va_t *va, va_pool_t *va_pool, const AVCodecContext
     {
         va_pool->surface_width  = surface_width;
         va_pool->surface_height = surface_height;
+        va_pool->stats.allocations++;
     }
 
 done:
@@ -119,6 +153,15 @@ int va_pool_SetupSurfaces(vlc_va_t *va, va_pool_t *va_pool, unsigned count)
     int err = VLC_ENOMEM;
     unsigned i = va_pool->surface_count;
 
+    if (va_pool->usage == NULL)
+    {
+        va_pool->usage = malloc(sizeof(*va_pool->usage));
+        if (unlikely(va_pool->usage == NULL))
+            return VLC_ENOMEM;
+        atomic_init(&va_pool->usage->refcount, 1);
+        atomic_init(&va_pool->usage->in_use, 0);
+    }
+
     for (i = 0; i < count; i++) {
         struct vlc_va_surface_t *p_surface = malloc(sizeof(*p_surface));
         if (unlikely(p_surface==NULL))
@@ -131,6 +174,8 @@ int va_pool_SetupSurfaces(vlc_va_t *va, va_pool_t *va_pool, unsigned count)
         }
         va_pool->surface[i]->va_surface = p_surface;
         atomic_init(&va_pool->surface[i]->va_surface->refcount, 1);
+        atomic_fetch_add(&va_pool->usage->refcount, 1);
+        p_surface->usage = va_pool->usage;
     }
     err = VLC_SUCCESS;
 
@@ -150,6 +195,10 @@ static picture_context_t *GetSurface(va_pool_t *va_pool)
 
         if (atomic_compare_exchange_strong(&surface->va_surface->refcount, &expected, 2))
         {
+            unsigned used = atomic_fetch_add(&va_pool->usage->in_use, 1) + 1;
+            if (used > va_pool->stats.peak)
+                va_pool->stats.peak = used;
+
             picture_context_t *field = surface->s.copy(&surface->s);
             /* the copy should have added an extra reference */
             atomic_fetch_sub(&surface->va_surface->refcount, 1);
@@ -169,12 +218,14 @@ int va_pool_Get(va_pool_t *va_pool, picture_t *pic)
 
     while ((field = GetSurface(va_pool)) == NULL)
     {
+        va_pool->stats.waits++;
         if (--tries == 0)
             return VLC_ENOITEM;
         /* Pool empty. Wait for some time as in src/input/decoder.c.
          * XXX: Both this and the core should use a semaphore or a CV. */
         vlc_tick_sleep(VOUT_OUTMEM_SLEEP);
     }
+    va_pool->stats.gets++;
     pic->context = field;
     return VLC_SUCCESS;
 }
@@ -186,13 +237,24 @@ void va_surface_AddRef(vlc_va_surface_t *surface)
 
 void va_surface_Release(vlc_va_surface_t *surface)
 {
-    if (atomic_fetch_sub(&surface->refcount, 1) != 1)
+    uintptr_t refs = atomic_fetch_sub(&surface->refcount, 1);
+
+    if (refs == 2) /* only the pool reference is left */
+        atomic_fetch_sub(&surface->usage->in_use, 1);
+    if (refs != 1)
         return;
+    va_pool_usage_Release(surface->usage);
     free(surface);
 }
 
 void va_pool_Close(vlc_va_t *va, va_pool_t *va_pool)
 {
+    if (va_pool->stats.allocations > 0)
+        msg_Dbg(va, "surface pool: %u allocation(s), %u reuse(s), "
+                "%u/%u surfaces peak usage, %lu surfaces used, %lu waits",
+                va_pool->stats.allocations, va_pool->stats.reuses,
+                va_pool->stats.peak, va_pool->surface_count,
+                va_pool->stats.gets, va_pool->stats.waits);
     DestroyVideoDecoder(va, va_pool);
     va_pool->pf_destroy_video_service(va);
     if (va_pool->pf_destroy_device_manager)
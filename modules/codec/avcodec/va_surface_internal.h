@@ -43,7 +43,23 @@ typedef struct
     int          surface_width;
     int          surface_height;
 
+    /* largest picture size expected from the stream, 0 if unknown; the
+     * decoder and its surfaces are created at least this large so that they
+     * can be kept if the coded size changes within it */
+    int          hint_width;
+    int          hint_height;
+
     struct va_pic_context  *surface[MAX_SURFACE_COUNT];
+    struct va_pool_usage   *usage;
+
+    struct
+    {
+        unsigned allocations; /* surface pools created */
+        unsigned reuses;      /* setups served by the existing pool */
+        unsigned long gets;   /* surfaces handed to the decoder */
+        unsigned long waits;  /* times the pool was found empty */
+        unsigned peak;        /* maximum surfaces in use at once */
+    } stats;
 
     int (*pf_create_device)(vlc_va_t *);
     void (*pf_destroy_device)(vlc_va_t *);
@@ -108,6 +108,9 @@ typedef struct
     int level;
 
     vlc_sem_t sem_mt;
+
+    /* Threads reserved from the process-wide budget */
+    unsigned i_reserved_threads;
 } decoder_sys_t;
 
 static inline void wait_mt(decoder_sys_t *sys)
@@ -147,8 +150,8 @@ static int lavc_GetVideoFormat(decoder_t *dec, video_format_t *restrict fmt,
                                AVCodecContext *ctx, enum AVPixelFormat pix_fmt,
                                enum AVPixelFormat sw_pix_fmt)
 {
-    int width = ctx->coded_width;
-    int height = ctx->coded_height;
+    int width = AV_CEIL_RSHIFT(ctx->coded_width, ctx->lowres);
+    int height = AV_CEIL_RSHIFT(ctx->coded_height, ctx->lowres);
 
     video_format_Init(fmt, 0);
 
@@ -440,6 +443,65 @@ static int lavc_CopyPicture(decoder_t *dec, picture_t *pic, AVFrame *frame)
     return VLC_SUCCESS;
 }
 
+static void lavc_ReleaseWrappedFrame(picture_t *pic)
+{
+    AVFrame *frame = pic->p_sys;
+
+    av_frame_free(&frame);
+}
+
+/**
+ * Wraps a reference-counted libavcodec frame into a picture_t, so that it
+ * need not be copied. This is used when not in direct rendering mode.
+ * @return a picture referencing the frame buffers, or NULL if the frame
+ * cannot be wrapped (and must be copied).
+ */
+static picture_t *lavc_WrapFrame(decoder_t *dec, const AVFrame *frame)
+{
+    video_format_t fmt = dec->fmt_out.video;
+
+    if (frame->buf[0] == NULL
+     || !chroma_compatible(FindVlcChroma(frame->format), fmt.i_chroma)
+     || (unsigned) frame->width < fmt.i_x_offset + fmt.i_visible_width
+     || (unsigned) frame->height < fmt.i_y_offset + fmt.i_visible_height)
+        return NULL;
+
+    const vlc_chroma_description_t *desc =
+        vlc_fourcc_GetChromaDescription(fmt.i_chroma);
+    if (desc == NULL || desc->plane_count == 0
+     || desc->plane_count > PICTURE_PLANE_MAX)
+        return NULL;
+
+    picture_resource_t res = {
+        .pf_destroy = lavc_ReleaseWrappedFrame,
+    };
+
+    for (unsigned i = 0; i < desc->plane_count; i++)
+    {
+        if (frame->data[i] == NULL || frame->linesize[i] <= 0)
+            return NULL;
+
+        res.p[i].p_pixels = frame->data[i];
+        res.p[i].i_pitch = frame->linesize[i];
+        res.p[i].i_lines = (frame->height * desc->p[i].h.num
+                            + desc->p[i].h.den - 1) / desc->p[i].h.den;
+    }
+
+    AVFrame *ref = av_frame_clone(frame);
+    if (unlikely(ref == NULL))
+        return NULL;
+    res.p_sys = ref;
+
+    /* Do not claim lines beyond the frame buffers */
+    fmt.i_width = frame->width;
+    fmt.i_height = frame->height;
+
+    picture_t *pic = picture_NewFromResource(&fmt, &res);
+    if (unlikely(pic == NULL))
+        av_frame_free(&ref);
+    return pic;
+}
+
 static int OpenVideoCodec( decoder_t *p_dec )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
@@ -464,6 +526,22 @@ static int OpenVideoCodec( decoder_t *p_dec )
     ctx->coded_width = p_dec->fmt_in.video.i_width;
     ctx->coded_height = p_dec->fmt_in.video.i_height;
 
+    /* Decode at a reduced resolution if the pictures will be shown much
+     * smaller anyway. Hardware decoding is not used in that case. */
+    int lowres = 0;
+    if( p_dec->i_target_width != 0 || p_dec->i_target_height != 0 )
+        while( lowres < codec->max_lowres
+            && (p_dec->fmt_in.video.i_visible_width >> (lowres + 1))
+                   >= p_dec->i_target_width
+            && (p_dec->fmt_in.video.i_visible_height >> (lowres + 1))
+                   >= p_dec->i_target_height )
+            lowres++;
+    if( lowres > 0 )
+    {
+        msg_Dbg( p_dec, "decoding at 1/%d of the resolution", 1 << lowres );
+        ctx->lowres = lowres;
+    }
+
     ctx->bits_per_coded_sample = p_dec->fmt_in.video.i_bits_per_pixel;
     p_sys->pix_fmt = AV_PIX_FMT_NONE;
     p_sys->profile = -1;
@@ -616,15 +694,18 @@ int InitVideoDec( vlc_object_t *obj )
     if( i_thread_count <= 0 )
     {
         i_thread_count = vlc_GetCPUCount();
-        if( i_thread_count > 1 )
-            i_thread_count++;
 
         //FIXME: take in count the decoding time
 #if VLC_WINSTORE_APP
-        i_thread_count = __MIN( i_thread_count, 6 );
+        i_thread_count = __MIN( i_thread_count, 5 );
 #else
-        i_thread_count = __MIN( i_thread_count, p_codec->id == AV_CODEC_ID_HEVC ? 10 : 6 );
+        i_thread_count = __MIN( i_thread_count, p_codec->id == AV_CODEC_ID_HEVC ? 9 : 5 );
 #endif
+        /* Share the CPUs with the other decoders of the process */
+        p_sys->i_reserved_threads = vlc_ReserveCPUThreads( i_thread_count );
+        i_thread_count = p_sys->i_reserved_threads;
+        if( i_thread_count > 1 )
+            i_thread_count++;
     }
     i_thread_count = __MIN( i_thread_count, p_codec->id == AV_CODEC_ID_HEVC ? 32 : 16 );
     msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
@@ -686,6 +767,8 @@ int InitVideoDec( vlc_object_t *obj )
     /* ***** Open the codec ***** */
     if( OpenVideoCodec( p_dec ) < 0 )
     {
+        if( p_sys->i_reserved_threads > 0 )
+            vlc_ReleaseCPUThreads( p_sys->i_reserved_threads );
         vlc_sem_destroy( &p_sys->sem_mt );
         free( p_sys );
         avcodec_free_context( &p_context );
@@ -1242,10 +1325,19 @@ static int DecodeBlock( decoder_t *p_dec, block_t **pp_block )
         {   /* When direct rendering is not used, get_format() and get_buffer()
              * might not be called. The output video format must be set here
              * then picture buffer can be allocated. */
+            bool b_wrapped = false;
+
             if (p_sys->p_va == NULL
              && lavc_UpdateVideoFormat(p_dec, p_context, p_context->pix_fmt,
                                        p_context->pix_fmt) == 0)
-                p_pic = decoder_NewPicture(p_dec);
+            {
+                /* Pass the frame buffers by reference if possible */
+                p_pic = lavc_WrapFrame(p_dec, frame);
+                if (p_pic != NULL)
+                    b_wrapped = true;
+                else
+                    p_pic = decoder_NewPicture(p_dec);
+            }
 
             if( !p_pic )
             {
@@ -1254,7 +1346,8 @@ static int DecodeBlock( decoder_t *p_dec, block_t **pp_block )
             }
 
             /* Fill picture_t from AVFrame */
-            if( lavc_CopyPicture( p_dec, p_pic, frame ) != VLC_SUCCESS )
+            if( !b_wrapped
+             && lavc_CopyPicture( p_dec, p_pic, frame ) != VLC_SUCCESS )
             {
                 av_frame_free(&frame);
                 picture_Release( p_pic );
@@ -1383,6 +1476,8 @@ void EndVideoDec( vlc_object_t *obj )
     if( p_sys->p_va )
         vlc_va_Delete( p_sys->p_va, &hwaccel_context );
 
+    if( p_sys->i_reserved_threads > 0 )
+        vlc_ReleaseCPUThreads( p_sys->i_reserved_threads );
     vlc_sem_destroy( &p_sys->sem_mt );
     free( p_sys );
 }
@@ -1681,7 +1776,7 @@ no_reuse:
     p_sys->profile = p_context->profile;
     p_sys->level = p_context->level;
 
-    if (!can_hwaccel)
+    if (!can_hwaccel || p_context->lowres)
         return swfmt;
 
 #if (LIBAVCODEC_VERSION_MICRO >= 100) \
@@ -47,6 +47,9 @@ typedef struct
     /* */
     bool b_reorder;
 
+    /* Only keep track of the channels, not of the data (no one decodes it) */
+    bool b_channels_only;
+
     /* */
     enum cc_payload_type_e i_payload_type;
     int i_payload_other_count;
@@ -66,6 +69,7 @@ static inline void cc_Init( cc_data_t *c )
     c->i_708channels = 0;
     c->i_data = 0;
     c->b_reorder = false;
+    c->b_channels_only = false;
     c->i_payload_type = CC_PAYLOAD_NONE;
     c->i_payload_other_count = 0;
 }
@@ -87,6 +91,9 @@ static inline void cc_AppendData( cc_data_t *c, uint8_t cc_preamble, const uint8
     else
         c->i_708channels |= 1;
 
+    if( c->b_channels_only )
+        return;
+
     c->p_data[c->i_data++] = cc_preamble;
     c->p_data[c->i_data++] = cc[0];
     c->p_data[c->i_data++] = cc[1];
@@ -76,6 +76,7 @@ typedef struct
 {
     Dav1dSettings s;
     Dav1dContext *c;
+    unsigned reserved_threads; /* from the process-wide budget */
 } decoder_sys_t;
 
 static const struct
@@ -284,12 +285,21 @@ static int OpenDecoder(vlc_object_t *p_this)
         return VLC_ENOMEM;
 
     dav1d_default_settings(&p_sys->s);
-    p_sys->s.n_tile_threads = var_InheritInteger(p_this, "dav1d-thread-tiles");
-    if (p_sys->s.n_tile_threads == 0)
-        p_sys->s.n_tile_threads = VLC_CLIP(vlc_GetCPUCount(), 1, 4);
+    p_sys->reserved_threads = 0;
     p_sys->s.n_frame_threads = var_InheritInteger(p_this, "dav1d-thread-frames");
     if (p_sys->s.n_frame_threads == 0)
-        p_sys->s.n_frame_threads = __MAX(1, vlc_GetCPUCount());
+    {
+        /* Share the CPUs with the other decoders of the process */
+        p_sys->reserved_threads = vlc_ReserveCPUThreads(vlc_GetCPUCount());
+        p_sys->s.n_frame_threads = p_sys->reserved_threads;
+    }
+    p_sys->s.n_tile_threads = var_InheritInteger(p_this, "dav1d-thread-tiles");
+    if (p_sys->s.n_tile_threads == 0)
+    {
+        unsigned cpus = p_sys->reserved_threads ? p_sys->reserved_threads
+                                                : vlc_GetCPUCount();
+        p_sys->s.n_tile_threads = VLC_CLIP(cpus, 1, 4);
+    }
     p_sys->s.allocator.cookie = dec;
     p_sys->s.allocator.alloc_picture_callback = NewPicture;
     p_sys->s.allocator.release_picture_callback = FreePicture;
@@ -297,6 +307,8 @@ static int OpenDecoder(vlc_object_t *p_this)
     if (dav1d_open(&p_sys->c, &p_sys->s) < 0)
     {
         msg_Err(p_this, "Could not open the Dav1d decoder");
+        if (p_sys->reserved_threads > 0)
+            vlc_ReleaseCPUThreads(p_sys->reserved_threads);
         return VLC_EGENERIC;
     }
 
@@ -336,5 +348,7 @@ static void CloseDecoder(vlc_object_t *p_this)
     FlushDecoder(dec);
 
     dav1d_close(&p_sys->c);
+    if (p_sys->reserved_threads > 0)
+        vlc_ReleaseCPUThreads(p_sys->reserved_threads);
 }
 
@@ -525,6 +525,17 @@ static int DecodeBlock(decoder_t *p_dec, block_t *p_block)
 
     p_sys->p_jpeg.out_color_space = JCS_RGB;
 
+    /* Let libjpeg skip the DCT coefficients that would be scaled out */
+    p_sys->p_jpeg.scale_num = 1;
+    p_sys->p_jpeg.scale_denom = 1;
+    while (p_sys->p_jpeg.scale_denom < 8
+        && p_sys->p_jpeg.image_width / (p_sys->p_jpeg.scale_denom * 2)
+               >= p_dec->i_target_width
+        && p_sys->p_jpeg.image_height / (p_sys->p_jpeg.scale_denom * 2)
+               >= p_dec->i_target_height
+        && (p_dec->i_target_width != 0 || p_dec->i_target_height != 0))
+        p_sys->p_jpeg.scale_denom *= 2;
+
     jpeg_start_decompress(&p_sys->p_jpeg);
 
     /* Set output properties */
@@ -82,8 +82,19 @@ typedef struct
     } display;
 }  ttml_style_t;
 
+/* Live streams repeat the same <head> in every document: it is kept
+ * across samples, along with what is derived from it */
 typedef struct
 {
+    tt_node_t *      p_node; /* owned, lent to the current document */
+    vlc_dictionary_t ids; /* xml:id to <style> and <region> nodes */
+    vlc_dictionary_t images; /* smpte:image xml:id to decoded picture_t */
+} ttml_head_t;
+
+typedef struct
+{
+    decoder_t *      p_dec;
+    ttml_head_t *    p_head;
     vlc_dictionary_t regions;
     tt_node_t *      p_rootnode; /* for now. FIXME: split header */
     ttml_length_t    root_extent_h, root_extent_v;
@@ -95,17 +106,14 @@ typedef struct
 {
     substext_updater_region_t updt;
     text_segment_t **pp_last_segment;
-    struct
-    {
-        uint8_t *p_bytes;
-        size_t   i_bytes;
-    } bgbitmap; /* SMPTE-TT */
+    picture_t *p_bgpic; /* SMPTE-TT */
 } ttml_region_t;
 
 typedef struct
 {
     int                     i_align;
     struct ttml_in_pes_ctx  pes;
+    ttml_head_t             head;
 } decoder_sys_t;
 
 enum
@@ -124,6 +132,7 @@ enum
  * style, and sets from parent node.
  */
 static tt_node_t *ParseTTML( decoder_t *, const uint8_t *, size_t );
+static picture_t * picture_CreateFromPNG( decoder_t *, const uint8_t *, size_t );
 
 static void ttml_style_Delete( ttml_style_t* p_ttml_style )
 {
@@ -155,7 +164,8 @@ static ttml_style_t * ttml_style_New( )
 static void ttml_region_Delete( ttml_region_t *p_region )
 {
     SubpictureUpdaterSysRegionClean( &p_region->updt );
-    free( p_region->bgbitmap.p_bytes );
+    if( p_region->p_bgpic )
+        picture_Release( p_region->p_bgpic );
     free( p_region );
 }
 
@@ -279,6 +289,14 @@ static bool ttml_read_coords( const char *value, ttml_length_t *h, ttml_length_t
     return false;
 }
 
+static const char * GetNodeID( const tt_node_t *p_node )
+{
+    const char *psz = vlc_dictionary_value_for_key( &p_node->attr_dict, "xml:id" );
+    if( !psz ) /* People can't do xml properly */
+        psz = vlc_dictionary_value_for_key( &p_node->attr_dict, "id" );
+    return psz;
+}
+
 static tt_node_t * FindNode( tt_node_t *p_node, const char *psz_nodename,
                              size_t i_maxdepth, const char *psz_id )
 {
@@ -286,9 +304,7 @@ static tt_node_t * FindNode( tt_node_t *p_node, const char *psz_nodename,
     {
         if( psz_id != NULL )
         {
-            char *psz = vlc_dictionary_value_for_key( &p_node->attr_dict, "xml:id" );
-            if( !psz ) /* People can't do xml properly */
-                psz = vlc_dictionary_value_for_key( &p_node->attr_dict, "id" );
+            const char *psz = GetNodeID( p_node );
             if( psz && !strcmp( psz, psz_id ) )
                 return p_node;
         }
@@ -312,6 +328,111 @@ static tt_node_t * FindNode( tt_node_t *p_node, const char *psz_nodename,
     return NULL;
 }
 
+static void ttml_head_Init( ttml_head_t *p_head )
+{
+    p_head->p_node = NULL;
+    vlc_dictionary_init( &p_head->ids, 0 );
+    vlc_dictionary_init( &p_head->images, 0 );
+}
+
+static void ttml_head_ReleasePicture( void *p_value, void *p_obj )
+{
+    VLC_UNUSED( p_obj );
+    picture_Release( p_value );
+}
+
+static void ttml_head_Clean( ttml_head_t *p_head )
+{
+    if( p_head->p_node )
+        tt_node_RecursiveDelete( p_head->p_node );
+    p_head->p_node = NULL;
+    vlc_dictionary_clear( &p_head->ids, NULL, NULL );
+    vlc_dictionary_clear( &p_head->images, ttml_head_ReleasePicture, NULL );
+}
+
+static void ttml_head_Index( ttml_head_t *p_head, tt_node_t *p_node )
+{
+    if( !tt_node_NameCompare( p_node->psz_node_name, "style" ) ||
+        !tt_node_NameCompare( p_node->psz_node_name, "region" ) )
+    {
+        /* first one in document order wins, as with FindNode */
+        const char *psz_id = GetNodeID( p_node );
+        if( psz_id && !vlc_dictionary_has_key( &p_head->ids, psz_id ) )
+            vlc_dictionary_insert( &p_head->ids, psz_id, p_node );
+    }
+
+    for( tt_basenode_t *p_child = p_node->p_child;
+                        p_child; p_child = p_child->p_next )
+    {
+        if( p_child->i_type != TT_NODE_TYPE_TEXT )
+            ttml_head_Index( p_head, (tt_node_t *) p_child );
+    }
+}
+
+static void ReplaceChild( tt_node_t *p_parent, tt_node_t *p_old, tt_node_t *p_new )
+{
+    tt_basenode_t **pp_node = &p_parent->p_child;
+    while( *pp_node != (tt_basenode_t *) p_old )
+        pp_node = &(*pp_node)->p_next;
+    *pp_node = (tt_basenode_t *) p_new;
+    p_new->p_next = p_old->p_next;
+    p_new->p_parent = p_parent;
+    p_old->p_next = NULL;
+    p_old->p_parent = NULL;
+}
+
+/* Takes the document <head>, or swaps in the cached one when identical */
+static void ttml_head_Attach( ttml_head_t *p_head, tt_node_t *p_rootnode )
+{
+    if( tt_node_NameCompare( p_rootnode->psz_node_name, "tt" ) )
+        return;
+
+    tt_node_t *p_node = NULL;
+    for( tt_basenode_t *p_child = p_rootnode->p_child;
+                        p_child && !p_node; p_child = p_child->p_next )
+    {
+        if( p_child->i_type != TT_NODE_TYPE_TEXT &&
+           !tt_node_NameCompare( ((tt_node_t *) p_child)->psz_node_name, "head" ) )
+            p_node = (tt_node_t *) p_child;
+    }
+    if( p_node == NULL )
+        return;
+
+    if( p_head->p_node && tt_node_Equals( p_head->p_node, p_node ) )
+    {
+        ReplaceChild( p_rootnode, p_node, p_head->p_node );
+        tt_node_RecursiveDelete( p_node );
+        return;
+    }
+
+    ttml_head_Clean( p_head );
+    p_head->p_node = p_node;
+    ttml_head_Index( p_head, p_node );
+}
+
+/* Gives back the cached <head> before the document gets deleted */
+static void ttml_head_Detach( ttml_head_t *p_head, tt_node_t *p_rootnode )
+{
+    if( p_head->p_node == NULL || p_head->p_node->p_parent != p_rootnode )
+        return;
+
+    tt_basenode_t **pp_node = &p_rootnode->p_child;
+    while( *pp_node != (tt_basenode_t *) p_head->p_node )
+        pp_node = &(*pp_node)->p_next;
+    *pp_node = p_head->p_node->p_next;
+    p_head->p_node->p_next = NULL;
+    p_head->p_node->p_parent = NULL;
+}
+
+static tt_node_t * FindNodeByID( ttml_context_t *p_ctx, const char *psz_nodename,
+                                 const char *psz_id )
+{
+    tt_node_t *p_node = vlc_dictionary_value_for_key( &p_ctx->p_head->ids, psz_id );
+    if( p_node && !tt_node_NameCompare( p_node->psz_node_name, psz_nodename ) )
+        return p_node;
+    return FindNode( p_ctx->p_rootnode, psz_nodename, -1, psz_id );
+}
+
 static void FillTextStyle( const char *psz_attr, const char *psz_val,
                            text_style_t *p_text_style )
 {
@@ -611,8 +732,7 @@ static void DictMergeWithStyleID( ttml_context_t *p_ctx, const char *psz_styles,
         while( psz_id )
         {
             /* Lookup referenced style ID */
-            const tt_node_t *p_node = FindNode( p_ctx->p_rootnode,
-                                                "style", -1, psz_id );
+            const tt_node_t *p_node = FindNodeByID( p_ctx, "style", psz_id );
             if( p_node )
                 DictionaryMerge( &p_node->attr_dict, &tempdict, true );
 
@@ -633,8 +753,7 @@ static void DictMergeWithRegionID( ttml_context_t *p_ctx, const char *psz_id,
     assert(p_ctx->p_rootnode);
     if( psz_id && p_ctx->p_rootnode )
     {
-        const tt_node_t *p_regionnode = FindNode( p_ctx->p_rootnode,
-                                                 "region", -1, psz_id );
+        const tt_node_t *p_regionnode = FindNodeByID( p_ctx, "region", psz_id );
         if( !p_regionnode )
             return;
 
@@ -934,6 +1053,34 @@ static const char * GetSMPTEImage( ttml_context_t *p_ctx, const char *psz_id )
     return NULL;
 }
 
+/* Returns a reference to the decoded image, decoding it once per <head> */
+static picture_t * GetSMPTEPicture( ttml_context_t *p_ctx, const char *psz_id )
+{
+    picture_t *p_pic = vlc_dictionary_value_for_key( &p_ctx->p_head->images, psz_id );
+    if( p_pic == NULL )
+    {
+        const char *psz_base64 = GetSMPTEImage( p_ctx, psz_id );
+        if( !psz_base64 )
+            return NULL;
+
+        uint8_t *p_bytes = NULL;
+        size_t i_bytes = vlc_b64_decode_binary( &p_bytes, psz_base64 );
+        if( p_bytes )
+        {
+            p_pic = picture_CreateFromPNG( p_ctx->p_dec, p_bytes, i_bytes );
+            free( p_bytes );
+        }
+        if( !p_pic )
+            return NULL;
+
+        /* only images from the cached head can outlive the document */
+        if( p_ctx->p_head->p_node == NULL )
+            return p_pic;
+        vlc_dictionary_insert( &p_ctx->p_head->images, psz_id, p_pic );
+    }
+    return picture_Hold( p_pic );
+}
+
 static void ConvertNodesToRegionContent( ttml_context_t *p_ctx, const tt_node_t *p_node,
                                          ttml_region_t *p_region,
                                          const ttml_style_t *p_upper_set_styles,
@@ -954,18 +1101,13 @@ static void ConvertNodesToRegionContent( ttml_context_t *p_ctx, const tt_node_t
     if( !tt_node_NameCompare( p_node->psz_node_name, "div" ) &&
          vlc_dictionary_has_key( &p_node->attr_dict, "smpte:backgroundImage" ) )
     {
-        if( !p_region->bgbitmap.p_bytes )
+        if( !p_region->p_bgpic )
         {
             const char *psz_id = vlc_dictionary_value_for_key( &p_node->attr_dict,
                                                                "smpte:backgroundImage" );
             /* Seems SMPTE can't make diff between html and xml.. */
             if( psz_id && *psz_id == '#' )
-            {
-                const char *psz_base64 = GetSMPTEImage( p_ctx, &psz_id[1] );
-                if( psz_base64 )
-                    p_region->bgbitmap.i_bytes =
-                        vlc_b64_decode_binary( &p_region->bgbitmap.p_bytes, psz_base64 );
-            }
+                p_region->p_bgpic = GetSMPTEPicture( p_ctx, &psz_id[1] );
         }
     }
 
@@ -1078,8 +1220,10 @@ static void InitTTMLContext( tt_node_t *p_rootnode, ttml_context_t *p_ctx )
     }
 }
 
-static ttml_region_t *GenerateRegions( tt_node_t *p_rootnode, tt_time_t playbacktime )
+static ttml_region_t *GenerateRegions( decoder_t *p_dec, tt_node_t *p_rootnode,
+                                       tt_time_t playbacktime )
 {
+    decoder_sys_t *p_sys = p_dec->p_sys;
     ttml_region_t*  p_regions = NULL;
     ttml_region_t** pp_region_last = &p_regions;
 
@@ -1091,6 +1235,8 @@ static ttml_region_t *GenerateRegions( tt_node_t *p_rootnode, tt_time_t playback
             ttml_context_t context;
             InitTTMLContext( p_rootnode, &context );
             context.p_rootnode = p_rootnode;
+            context.p_dec = p_dec;
+            context.p_head = &p_sys->head;
 
             vlc_dictionary_init( &context.regions, 1 );
             ConvertNodesToRegionContent( &context, p_bodynode, NULL, NULL, playbacktime );
@@ -1193,12 +1339,13 @@ static picture_t * picture_CreateFromPNG( decoder_t *p_dec,
 static void TTMLRegionsToSpuBitmapRegions( decoder_t *p_dec, subpicture_t *p_spu,
                                            ttml_region_t *p_regions )
 {
+    VLC_UNUSED(p_dec);
     /* Create region update info from each ttml region */
     for( ttml_region_t *p_region = p_regions;
                         p_region; p_region = (ttml_region_t *) p_region->updt.p_next )
     {
-        picture_t *p_pic = picture_CreateFromPNG( p_dec, p_region->bgbitmap.p_bytes,
-                                                         p_region->bgbitmap.i_bytes );
+        picture_t *p_pic = p_region->p_bgpic;
+        p_region->p_bgpic = NULL;
         if( p_pic )
         {
             ttml_image_updater_region_t *r = TTML_ImageUpdaterRegionNew( p_pic );
@@ -1254,6 +1401,9 @@ static int ParseBlock( decoder_t *p_dec, const block_t *p_block )
     tt_timings_Resolve( (tt_basenode_t *) p_rootnode, &temporal_extent,
                         &p_timings_array, &i_timings_count );
 
+    /* Reuse the styling and layout of the previous document if unchanged */
+    ttml_head_Attach( &p_sys->head, p_rootnode );
+
 #ifdef TTML_DEBUG
     for( size_t i=0; i<i_timings_count; i++ )
         printf("%ld ", tt_time_Convert( &p_timings_array[i] ) );
@@ -1279,10 +1429,10 @@ static int ParseBlock( decoder_t *p_dec, const block_t *p_block )
 
         bool b_bitmap_regions = false;
         subpicture_t *p_spu = NULL;
-        ttml_region_t *p_regions = GenerateRegions( p_rootnode, p_timings_array[i] );
+        ttml_region_t *p_regions = GenerateRegions( p_dec, p_rootnode, p_timings_array[i] );
         if( p_regions )
         {
-            if( p_regions->bgbitmap.i_bytes > 0 && p_regions->updt.p_segments == NULL )
+            if( p_regions->p_bgpic && p_regions->updt.p_segments == NULL )
             {
                 b_bitmap_regions = true;
                 p_spu = decoder_NewTTML_ImageSpu( p_dec );
@@ -1320,6 +1470,7 @@ static int ParseBlock( decoder_t *p_dec, const block_t *p_block )
             decoder_QueueSub( p_dec, p_spu );
     }
 
+    ttml_head_Detach( &p_sys->head, p_rootnode );
     tt_node_RecursiveDelete( p_rootnode );
 
     free( p_timings_array );
@@ -1387,6 +1538,7 @@ int tt_OpenDecoder( vlc_object_t *p_this )
     p_dec->pf_flush = Flush;
     p_sys->i_align = var_InheritInteger( p_dec, "ttml-align" );
     ttml_in_pes_Init( &p_sys->pes );
+    ttml_head_Init( &p_sys->head );
 
     return VLC_SUCCESS;
 }
@@ -1399,5 +1551,6 @@ void tt_CloseDecoder( vlc_object_t *p_this )
     decoder_t *p_dec = (decoder_t *)p_this;
     decoder_sys_t *p_sys = p_dec->p_sys;
 
+    ttml_head_Clean( &p_sys->head );
     free( p_sys );
 }
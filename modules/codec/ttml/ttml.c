@@ -73,6 +73,52 @@ bool tt_node_HasChild( const tt_node_t *p_node )
     return p_node->p_child;
 }
 
+static bool tt_dictionaries_Equal( const vlc_dictionary_t *p_a, const vlc_dictionary_t *p_b )
+{
+    if( vlc_dictionary_keys_count( p_a ) != vlc_dictionary_keys_count( p_b ) )
+        return false;
+
+    for( int i = 0; i < p_a->i_size; ++i )
+    {
+        for( const vlc_dictionary_entry_t *p_entry = p_a->p_entries[i];
+                                           p_entry; p_entry = p_entry->p_next )
+        {
+            const char *psz_value = vlc_dictionary_value_for_key( p_b, p_entry->psz_key );
+            if( psz_value == NULL || strcmp( psz_value, p_entry->p_value ) )
+                return false;
+        }
+    }
+    return true;
+}
+
+bool tt_node_Equals( const tt_node_t *p_a, const tt_node_t *p_b )
+{
+    if( tt_node_NameCompare( p_a->psz_node_name, p_b->psz_node_name ) ||
+        !tt_dictionaries_Equal( &p_a->attr_dict, &p_b->attr_dict ) )
+        return false;
+
+    const tt_basenode_t *p_childa = p_a->p_child;
+    const tt_basenode_t *p_childb = p_b->p_child;
+    for( ; p_childa && p_childb; p_childa = p_childa->p_next,
+                                 p_childb = p_childb->p_next )
+    {
+        if( p_childa->i_type != p_childb->i_type )
+            return false;
+
+        if( p_childa->i_type == TT_NODE_TYPE_TEXT )
+        {
+            const char *psz_a = ((const tt_textnode_t *) p_childa)->psz_text;
+            const char *psz_b = ((const tt_textnode_t *) p_childb)->psz_text;
+            if( !psz_a || !psz_b || strcmp( psz_a, psz_b ) )
+                return false;
+        }
+        else if( !tt_node_Equals( (const tt_node_t *) p_childa,
+                                  (const tt_node_t *) p_childb ) )
+            return false;
+    }
+    return p_childa == p_childb;
+}
+
 static inline bool tt_ScanReset( unsigned *a, unsigned *b, unsigned *c,
                                  char *d,  unsigned *e )
 {
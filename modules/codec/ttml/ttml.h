@@ -92,6 +92,7 @@ tt_node_t * tt_node_New( xml_reader_t* reader, tt_node_t* p_parent, const char*
 void tt_node_RecursiveDelete( tt_node_t *p_node );
 int  tt_node_NameCompare( const char* psz_tagname, const char* psz_pattern );
 bool tt_node_HasChild( const tt_node_t *p_node );
+bool tt_node_Equals( const tt_node_t *, const tt_node_t * );
 
 int tt_nodes_Read( xml_reader_t *p_reader, tt_node_t *p_root_node );
 
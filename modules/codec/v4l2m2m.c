@@ -0,0 +1,929 @@
+/*****************************************************************************
+ * v4l2m2m.c: Video4Linux2 memory-to-memory hardware video decoder
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * This drives stateful memory-to-memory decoders, as found on many ARM SoCs
+ * (Qualcomm Venus, Amlogic, MediaTek, i.MX, CODA...), with the
+ * multi-planar API. Compressed data is queued on the OUTPUT queue, and
+ * decoded pictures are dequeued from the CAPTURE queue, then copied into
+ * pictures of the video output. Stateless decoders, which need the parsed
+ * slice parameters through the media request API, are not supported.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_codec.h>
+#include <vlc_fs.h>
+
+#include "hxxx_helper.h"
+
+#define V4L2M2M_OUTPUT_BUFFERS 8
+#define V4L2M2M_OUTPUT_SIZE    (2 << 20)
+/* Pictures held by the decoder in addition to its own minimum */
+#define V4L2M2M_EXTRA_CAPTURE_BUFFERS 2
+/* Time waited for the hardware before giving up, in milliseconds */
+#define V4L2M2M_TIMEOUT 1000
+
+static int  OpenDecoder(vlc_object_t *);
+static void CloseDecoder(vlc_object_t *);
+
+#define DEV_TEXT N_("Device")
+#define DEV_LONGTEXT N_( \
+    "Memory-to-memory decoder device node. By default, the first video " \
+    "device supporting the input codec is used.")
+
+vlc_module_begin()
+    set_shortname(N_("V4L2 M2M"))
+    set_description(N_("Video4Linux2 memory-to-memory video decoder"))
+    set_category(CAT_INPUT)
+    set_subcategory(SUBCAT_INPUT_VCODEC)
+    set_capability("video decoder", 80)
+    set_callbacks(OpenDecoder, CloseDecoder)
+    add_shortcut("v4l2m2m")
+    add_loadfile("v4l2m2m-dev", NULL, DEV_TEXT, DEV_LONGTEXT)
+vlc_module_end()
+
+typedef struct
+{
+    void    *start[VIDEO_MAX_PLANES];
+    size_t   length[VIDEO_MAX_PLANES];
+    unsigned planes;
+    bool     queued;
+    picture_t *pic; /**< CAPTURE buffer wrapped as a picture, for copies */
+} v4l2m2m_buffer_t;
+
+typedef struct
+{
+    int      fd;
+    uint32_t pixelformat; /**< compressed V4L2 format */
+
+    bool     b_hxxx;
+    struct hxxx_helper hh;
+    bool     b_send_config;
+
+    v4l2m2m_buffer_t out[V4L2M2M_OUTPUT_BUFFERS];
+    unsigned out_count;
+
+    v4l2m2m_buffer_t *cap;
+    unsigned cap_count;
+    bool     cap_streaming;
+    video_format_t cap_fmt;
+} decoder_sys_t;
+
+static const struct
+{
+    vlc_fourcc_t codec;
+    uint32_t     pixelformat;
+} codecs[] = {
+    { VLC_CODEC_H264, V4L2_PIX_FMT_H264 },
+#ifdef V4L2_PIX_FMT_HEVC
+    { VLC_CODEC_HEVC, V4L2_PIX_FMT_HEVC },
+#endif
+    { VLC_CODEC_MPGV, V4L2_PIX_FMT_MPEG2 },
+    { VLC_CODEC_MP4V, V4L2_PIX_FMT_MPEG4 },
+    { VLC_CODEC_VP8,  V4L2_PIX_FMT_VP8 },
+#ifdef V4L2_PIX_FMT_VP9
+    { VLC_CODEC_VP9,  V4L2_PIX_FMT_VP9 },
+#endif
+};
+
+/* Decoded picture formats */
+static const struct
+{
+    uint32_t     pixelformat;
+    vlc_fourcc_t chroma;
+} chromas[] = {
+    { V4L2_PIX_FMT_NV12,    VLC_CODEC_NV12 },
+    { V4L2_PIX_FMT_NV12M,   VLC_CODEC_NV12 },
+    { V4L2_PIX_FMT_NV21,    VLC_CODEC_NV21 },
+    { V4L2_PIX_FMT_NV21M,   VLC_CODEC_NV21 },
+    { V4L2_PIX_FMT_YUV420,  VLC_CODEC_I420 },
+    { V4L2_PIX_FMT_YUV420M, VLC_CODEC_I420 },
+};
+
+static int xioctl(int fd, unsigned long request, void *arg)
+{
+    int ret;
+
+    do
+        ret = ioctl(fd, request, arg);
+    while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+/**
+ * Checks that a device is a multi-planar M2M decoder for the given format.
+ */
+static bool ProbeDevice(int fd, uint32_t pixelformat)
+{
+    struct v4l2_capability cap;
+
+    if (xioctl(fd, VIDIOC_QUERYCAP, &cap))
+        return false;
+
+    uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS)
+                  ? cap.device_caps : cap.capabilities;
+    if ((caps & (V4L2_CAP_VIDEO_M2M_MPLANE | V4L2_CAP_STREAMING))
+     != (V4L2_CAP_VIDEO_M2M_MPLANE | V4L2_CAP_STREAMING))
+        return false;
+
+    struct v4l2_fmtdesc desc = { .type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE };
+
+    for (desc.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &desc) == 0;
+         desc.index++)
+        if (desc.pixelformat == pixelformat)
+            return true;
+    return false;
+}
+
+static int OpenDevice(decoder_t *dec, uint32_t pixelformat)
+{
+    char *path = var_InheritString(dec, "v4l2m2m-dev");
+    int fd;
+
+    if (path != NULL)
+    {
+        fd = vlc_open(path, O_RDWR | O_NONBLOCK);
+        if (fd == -1)
+            msg_Err(dec, "cannot open device %s: %s", path,
+                    vlc_strerror_c(errno));
+        else if (!ProbeDevice(fd, pixelformat))
+        {
+            msg_Dbg(dec, "device %s cannot decode %4.4s", path,
+                    (const char *)&pixelformat);
+            vlc_close(fd);
+            fd = -1;
+        }
+        free(path);
+        return fd;
+    }
+
+    for (unsigned i = 0; i < 64; i++)
+    {
+        char name[sizeof ("/dev/video64")];
+
+        snprintf(name, sizeof (name), "/dev/video%u", i);
+        fd = vlc_open(name, O_RDWR | O_NONBLOCK);
+        if (fd == -1)
+        {
+            if (errno == ENOENT)
+                continue;
+            break;
+        }
+        if (ProbeDevice(fd, pixelformat))
+        {
+            msg_Dbg(dec, "using device %s", name);
+            return fd;
+        }
+        vlc_close(fd);
+    }
+    return -1;
+}
+
+static void UnmapBuffers(v4l2m2m_buffer_t *bufs, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (bufs[i].pic != NULL)
+            picture_Release(bufs[i].pic);
+        for (unsigned j = 0; j < bufs[i].planes; j++)
+            munmap(bufs[i].start[j], bufs[i].length[j]);
+    }
+}
+
+/**
+ * Allocates and maps the buffers of a queue.
+ * @return the number of buffers, or 0 on error
+ */
+static unsigned MapBuffers(decoder_t *dec, enum v4l2_buf_type type,
+                           v4l2m2m_buffer_t *bufs, unsigned count)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    struct v4l2_requestbuffers req = {
+        .count = count,
+        .type = type,
+        .memory = V4L2_MEMORY_MMAP,
+    };
+
+    if (xioctl(sys->fd, VIDIOC_REQBUFS, &req) || req.count == 0)
+    {
+        msg_Err(dec, "cannot allocate buffers: %s", vlc_strerror_c(errno));
+        return 0;
+    }
+    if (req.count > count)
+        req.count = count;
+
+    for (unsigned i = 0; i < req.count; i++)
+    {
+        struct v4l2_plane planes[VIDEO_MAX_PLANES];
+        struct v4l2_buffer buf = {
+            .index = i,
+            .type = type,
+            .memory = V4L2_MEMORY_MMAP,
+            .length = VIDEO_MAX_PLANES,
+            .m.planes = planes,
+        };
+
+        memset(&bufs[i], 0, sizeof (bufs[i]));
+        if (xioctl(sys->fd, VIDIOC_QUERYBUF, &buf))
+            goto error;
+
+        for (unsigned j = 0; j < buf.length; j++)
+        {
+            void *p = mmap(NULL, planes[j].length, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, sys->fd, planes[j].m.mem_offset);
+            if (p == MAP_FAILED)
+                goto error;
+            bufs[i].start[j] = p;
+            bufs[i].length[j] = planes[j].length;
+            bufs[i].planes = j + 1;
+        }
+        continue;
+error:
+        msg_Err(dec, "cannot map buffer %u: %s", i, vlc_strerror_c(errno));
+        UnmapBuffers(bufs, i + 1);
+        req.count = 0;
+        xioctl(sys->fd, VIDIOC_REQBUFS, &req);
+        return 0;
+    }
+    return req.count;
+}
+
+static void ReleaseBuffers(decoder_t *dec, enum v4l2_buf_type type,
+                           v4l2m2m_buffer_t *bufs, unsigned count)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    struct v4l2_requestbuffers req = {
+        .count = 0,
+        .type = type,
+        .memory = V4L2_MEMORY_MMAP,
+    };
+
+    UnmapBuffers(bufs, count);
+    xioctl(sys->fd, VIDIOC_REQBUFS, &req);
+}
+
+static int QueueCapture(decoder_t *dec, unsigned index)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    struct v4l2_plane planes[VIDEO_MAX_PLANES] = { 0 };
+    struct v4l2_buffer buf = {
+        .index = index,
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+        .memory = V4L2_MEMORY_MMAP,
+        .length = sys->cap[index].planes,
+        .m.planes = planes,
+    };
+
+    if (xioctl(sys->fd, VIDIOC_QBUF, &buf))
+    {
+        msg_Err(dec, "cannot queue picture buffer: %s",
+                vlc_strerror_c(errno));
+        return VLC_EGENERIC;
+    }
+    sys->cap[index].queued = true;
+    return VLC_SUCCESS;
+}
+
+static void StopCapture(decoder_t *dec)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+
+    if (sys->cap == NULL)
+        return;
+
+    xioctl(sys->fd, VIDIOC_STREAMOFF, &type);
+    ReleaseBuffers(dec, type, sys->cap, sys->cap_count);
+    free(sys->cap);
+    sys->cap = NULL;
+    sys->cap_count = 0;
+    sys->cap_streaming = false;
+}
+
+/**
+ * Wraps a mapped CAPTURE buffer as a picture, so that it can be copied with
+ * picture_CopyPixels().
+ */
+static picture_t *WrapCapture(decoder_t *dec, const v4l2m2m_buffer_t *b,
+                              const struct v4l2_pix_format_mplane *pix)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    const vlc_chroma_description_t *desc =
+        vlc_fourcc_GetChromaDescription(sys->cap_fmt.i_chroma);
+    picture_resource_t res = { .p_sys = NULL };
+    uint8_t *p = b->start[0];
+
+    if (desc == NULL || desc->plane_count > PICTURE_PLANE_MAX)
+        return NULL;
+
+    for (unsigned i = 0; i < desc->plane_count; i++)
+    {
+        unsigned pitch, lines = pix->height * desc->p[i].h.num
+                                            / desc->p[i].h.den;
+
+        if (b->planes > 1)
+        {   /* one memory plane per picture plane */
+            p = b->start[i];
+            pitch = pix->plane_fmt[i].bytesperline;
+        }
+        else
+        {   /* contiguous planes, with proportional pitches */
+            pitch = pix->plane_fmt[0].bytesperline * desc->p[i].w.num
+                                                   / desc->p[i].w.den;
+            if (i > 0)
+                p += res.p[i - 1].i_pitch * res.p[i - 1].i_lines;
+        }
+
+        res.p[i].p_pixels = p;
+        res.p[i].i_pitch = pitch;
+        res.p[i].i_lines = lines;
+    }
+    return picture_NewFromResource(&sys->cap_fmt, &res);
+}
+
+/**
+ * (Re)configures the CAPTURE queue after a source change event.
+ */
+static int SetupCapture(decoder_t *dec)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    struct v4l2_format fmt = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE };
+    vlc_fourcc_t chroma = 0;
+
+    StopCapture(dec);
+
+    if (xioctl(sys->fd, VIDIOC_G_FMT, &fmt))
+    {
+        msg_Err(dec, "cannot get picture format: %s", vlc_strerror_c(errno));
+        return VLC_EGENERIC;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(chromas) && chroma == 0; i++)
+        if (chromas[i].pixelformat == fmt.fmt.pix_mp.pixelformat)
+            chroma = chromas[i].chroma;
+
+    if (chroma == 0)
+    {   /* Ask for the most common format instead */
+        fmt.fmt.pix_mp.pixelformat = V4L2_PIX_FMT_NV12;
+        if (xioctl(sys->fd, VIDIOC_S_FMT, &fmt) == 0)
+            for (size_t i = 0; i < ARRAY_SIZE(chromas) && chroma == 0; i++)
+                if (chromas[i].pixelformat == fmt.fmt.pix_mp.pixelformat)
+                    chroma = chromas[i].chroma;
+    }
+    if (chroma == 0)
+    {
+        msg_Err(dec, "unsupported picture format %4.4s",
+                (const char *)&fmt.fmt.pix_mp.pixelformat);
+        return VLC_EGENERIC;
+    }
+
+    const struct v4l2_pix_format_mplane *pix = &fmt.fmt.pix_mp;
+    struct v4l2_selection sel = {
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .target = V4L2_SEL_TGT_COMPOSE,
+    };
+
+    video_format_Init(&sys->cap_fmt, chroma);
+    sys->cap_fmt.i_width = pix->width;
+    sys->cap_fmt.i_height = pix->height;
+    if (xioctl(sys->fd, VIDIOC_G_SELECTION, &sel) == 0
+     && sel.r.width > 0 && sel.r.height > 0)
+    {
+        sys->cap_fmt.i_x_offset = sel.r.left;
+        sys->cap_fmt.i_y_offset = sel.r.top;
+        sys->cap_fmt.i_visible_width = sel.r.width;
+        sys->cap_fmt.i_visible_height = sel.r.height;
+    }
+    else
+    {
+        sys->cap_fmt.i_visible_width = pix->width;
+        sys->cap_fmt.i_visible_height = pix->height;
+    }
+
+    msg_Dbg(dec, "decoding to %4.4s %ux%u (visible %ux%u)",
+            (const char *)&pix->pixelformat, pix->width, pix->height,
+            sys->cap_fmt.i_visible_width, sys->cap_fmt.i_visible_height);
+
+    /* Update the output format */
+    video_format_t *out = &dec->fmt_out.video;
+
+    dec->fmt_out.i_codec = chroma;
+    out->i_chroma = chroma;
+    out->i_width = sys->cap_fmt.i_width;
+    out->i_height = sys->cap_fmt.i_height;
+    out->i_x_offset = sys->cap_fmt.i_x_offset;
+    out->i_y_offset = sys->cap_fmt.i_y_offset;
+    out->i_visible_width = sys->cap_fmt.i_visible_width;
+    out->i_visible_height = sys->cap_fmt.i_visible_height;
+    if (dec->fmt_in.video.i_sar_num != 0 && dec->fmt_in.video.i_sar_den != 0)
+    {
+        out->i_sar_num = dec->fmt_in.video.i_sar_num;
+        out->i_sar_den = dec->fmt_in.video.i_sar_den;
+    }
+    else
+        out->i_sar_num = out->i_sar_den = 1;
+    out->i_frame_rate = dec->fmt_in.video.i_frame_rate;
+    out->i_frame_rate_base = dec->fmt_in.video.i_frame_rate_base;
+
+    if (decoder_UpdateVideoFormat(dec))
+        return VLC_EGENERIC;
+
+    /* Allocate the decoder picture buffers */
+    struct v4l2_control ctrl = { .id = V4L2_CID_MIN_BUFFERS_FOR_CAPTURE };
+    unsigned count = V4L2M2M_EXTRA_CAPTURE_BUFFERS;
+
+    if (xioctl(sys->fd, VIDIOC_G_CTRL, &ctrl) == 0 && ctrl.value > 0)
+        count += ctrl.value;
+    else
+        count += 4;
+
+    sys->cap = calloc(count, sizeof (*sys->cap));
+    if (unlikely(sys->cap == NULL))
+        return VLC_ENOMEM;
+
+    sys->cap_count = MapBuffers(dec, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+                                sys->cap, count);
+    if (sys->cap_count == 0)
+    {
+        free(sys->cap);
+        sys->cap = NULL;
+        return VLC_EGENERIC;
+    }
+
+    for (unsigned i = 0; i < sys->cap_count; i++)
+    {
+        sys->cap[i].pic = WrapCapture(dec, &sys->cap[i], pix);
+        if (sys->cap[i].pic == NULL || QueueCapture(dec, i))
+            goto error;
+    }
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    if (xioctl(sys->fd, VIDIOC_STREAMON, &type))
+    {
+        msg_Err(dec, "cannot start decoding: %s", vlc_strerror_c(errno));
+        goto error;
+    }
+    sys->cap_streaming = true;
+    return VLC_SUCCESS;
+error:
+    StopCapture(dec);
+    return VLC_EGENERIC;
+}
+
+static bool ProcessCapture(decoder_t *dec);
+
+static int ProcessEvents(decoder_t *dec)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    struct v4l2_event ev;
+    int ret = VLC_SUCCESS;
+
+    while (xioctl(sys->fd, VIDIOC_DQEVENT, &ev) == 0)
+        if (ev.type == V4L2_EVENT_SOURCE_CHANGE
+         && (ev.u.src_change.changes & V4L2_EVENT_SRC_CH_RESOLUTION))
+        {   /* Output the pictures decoded before the change first */
+            ProcessCapture(dec);
+            ret = SetupCapture(dec);
+        }
+    return ret;
+}
+
+/**
+ * Dequeues the decoded pictures that are ready, and sends them to the video
+ * output.
+ * @return true if the last picture of a drain was dequeued
+ */
+static bool ProcessCapture(decoder_t *dec)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    bool last = false;
+
+    if (!sys->cap_streaming)
+        return false;
+
+    for (;;)
+    {
+        struct v4l2_plane planes[VIDEO_MAX_PLANES];
+        struct v4l2_buffer buf = {
+            .type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+            .memory = V4L2_MEMORY_MMAP,
+            .length = VIDEO_MAX_PLANES,
+            .m.planes = planes,
+        };
+
+        if (xioctl(sys->fd, VIDIOC_DQBUF, &buf))
+        {
+            if (errno == EPIPE) /* already drained */
+                last = true;
+            break;
+        }
+
+        v4l2m2m_buffer_t *b = &sys->cap[buf.index];
+
+        b->queued = false;
+        if (buf.flags & V4L2_BUF_FLAG_LAST)
+            last = true;
+
+        if (planes[0].bytesused > 0 && !(buf.flags & V4L2_BUF_FLAG_ERROR))
+        {
+            picture_t *pic = decoder_NewPicture(dec);
+
+            if (pic != NULL)
+            {
+                picture_CopyPixels(pic, b->pic);
+                pic->date = vlc_tick_from_sec(buf.timestamp.tv_sec)
+                          + VLC_TICK_FROM_US(buf.timestamp.tv_usec);
+                pic->b_progressive = buf.field == V4L2_FIELD_NONE
+                                  || buf.field == V4L2_FIELD_ANY;
+                pic->b_top_field_first = buf.field != V4L2_FIELD_INTERLACED_BT;
+                decoder_QueueVideo(dec, pic);
+            }
+        }
+
+        if (last)
+            break;
+        QueueCapture(dec, buf.index);
+    }
+    return last;
+}
+
+/**
+ * Waits for the hardware to return a compressed data buffer, dequeuing the
+ * decoded pictures meanwhile.
+ * @return the index of a free OUTPUT buffer, or -1 on error
+ */
+static int GetOutputBuffer(decoder_t *dec)
+{
+    decoder_sys_t *sys = dec->p_sys;
+
+    for (unsigned i = 0; i < sys->out_count; i++)
+        if (!sys->out[i].queued)
+            return i;
+
+    for (;;)
+    {
+        struct v4l2_plane planes[VIDEO_MAX_PLANES];
+        struct v4l2_buffer buf = {
+            .type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+            .memory = V4L2_MEMORY_MMAP,
+            .length = VIDEO_MAX_PLANES,
+            .m.planes = planes,
+        };
+
+        if (xioctl(sys->fd, VIDIOC_DQBUF, &buf) == 0)
+        {
+            sys->out[buf.index].queued = false;
+            return buf.index;
+        }
+        if (errno != EAGAIN)
+        {
+            msg_Err(dec, "cannot dequeue data buffer: %s",
+                    vlc_strerror_c(errno));
+            return -1;
+        }
+
+        struct pollfd ufd = {
+            .fd = sys->fd,
+            .events = POLLIN | POLLOUT | POLLPRI,
+        };
+
+        if (poll(&ufd, 1, V4L2M2M_TIMEOUT) <= 0)
+        {
+            msg_Err(dec, "hardware decoder timed out");
+            return -1;
+        }
+        if ((ufd.revents & POLLPRI) && ProcessEvents(dec))
+            return -1;
+        if (ufd.revents & POLLIN)
+            ProcessCapture(dec);
+    }
+}
+
+static int QueueOutput(decoder_t *dec, const uint8_t *data, size_t size,
+                       vlc_tick_t ts)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    int index = GetOutputBuffer(dec);
+
+    if (index < 0)
+        return VLC_EGENERIC;
+
+    v4l2m2m_buffer_t *b = &sys->out[index];
+
+    if (size > b->length[0])
+    {
+        msg_Warn(dec, "dropping oversized data (%zu bytes)", size);
+        return VLC_SUCCESS;
+    }
+
+    memcpy(b->start[0], data, size);
+
+    struct v4l2_plane planes[VIDEO_MAX_PLANES] = {
+        { .bytesused = size, .length = b->length[0] },
+    };
+    struct v4l2_buffer buf = {
+        .index = index,
+        .type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+        .memory = V4L2_MEMORY_MMAP,
+        .length = 1,
+        .m.planes = planes,
+    };
+
+    /* The timestamp is copied to the matching decoded picture. */
+    if (ts != VLC_TICK_INVALID)
+    {
+        int64_t us = US_FROM_VLC_TICK(ts);
+
+        buf.timestamp.tv_sec = us / 1000000;
+        buf.timestamp.tv_usec = us % 1000000;
+    }
+
+    if (xioctl(sys->fd, VIDIOC_QBUF, &buf))
+    {
+        msg_Err(dec, "cannot queue data buffer: %s", vlc_strerror_c(errno));
+        return VLC_EGENERIC;
+    }
+    b->queued = true;
+    return VLC_SUCCESS;
+}
+
+static block_t *GetConfig(decoder_t *dec)
+{
+    decoder_sys_t *sys = dec->p_sys;
+
+    if (sys->b_hxxx)
+    {
+        block_t *config = (dec->fmt_in.i_codec == VLC_CODEC_H264)
+                        ? h264_helper_get_annexb_config(&sys->hh)
+                        : hevc_helper_get_annexb_config(&sys->hh);
+        return (config != NULL) ? block_ChainGather(config) : NULL;
+    }
+
+    if (dec->fmt_in.i_extra > 0)
+    {
+        block_t *config = block_Alloc(dec->fmt_in.i_extra);
+        if (likely(config != NULL))
+            memcpy(config->p_buffer, dec->fmt_in.p_extra,
+                   dec->fmt_in.i_extra);
+        return config;
+    }
+    return NULL;
+}
+
+static void Drain(decoder_t *dec)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    struct v4l2_decoder_cmd cmd = { .cmd = V4L2_DEC_CMD_STOP };
+
+    if (!sys->cap_streaming)
+        return;
+
+    if (xioctl(sys->fd, VIDIOC_DECODER_CMD, &cmd))
+    {   /* Not supported: only output what is ready */
+        ProcessCapture(dec);
+        return;
+    }
+
+    for (;;)
+    {
+        struct pollfd ufd = { .fd = sys->fd, .events = POLLIN | POLLPRI };
+
+        if (poll(&ufd, 1, V4L2M2M_TIMEOUT) <= 0)
+        {
+            msg_Warn(dec, "hardware decoder drain timed out");
+            break;
+        }
+        if (ufd.revents & POLLPRI)
+            ProcessEvents(dec);
+        if ((ufd.revents & POLLIN) && ProcessCapture(dec))
+            break;
+        if (!sys->cap_streaming)
+            return;
+    }
+
+    /* Resume decoding, with the buffer of the last picture */
+    cmd.cmd = V4L2_DEC_CMD_START;
+    xioctl(sys->fd, VIDIOC_DECODER_CMD, &cmd);
+    for (unsigned i = 0; i < sys->cap_count; i++)
+        if (!sys->cap[i].queued)
+            QueueCapture(dec, i);
+}
+
+static int Decode(decoder_t *dec, block_t *block)
+{
+    decoder_sys_t *sys = dec->p_sys;
+
+    if (block == NULL)
+    {
+        Drain(dec);
+        return VLCDEC_SUCCESS;
+    }
+
+    if (block->i_flags & BLOCK_FLAG_CORRUPTED)
+    {
+        block_Release(block);
+        return VLCDEC_SUCCESS;
+    }
+
+    if (sys->b_hxxx)
+    {
+        block = sys->hh.pf_process_block(&sys->hh, block, NULL);
+        if (block == NULL)
+            return VLCDEC_SUCCESS;
+    }
+
+    /* The gathered block takes the properties of the configuration. */
+    vlc_tick_t ts = (block->i_pts != VLC_TICK_INVALID) ? block->i_pts
+                                                     : block->i_dts;
+
+    if (sys->b_send_config)
+    {
+        block_t *config = GetConfig(dec);
+
+        if (config != NULL)
+        {
+            block->p_next = NULL;
+            config->p_next = block;
+            block = block_ChainGather(config);
+            if (block == NULL)
+                return VLCDEC_SUCCESS;
+        }
+        sys->b_send_config = false;
+    }
+
+    if (QueueOutput(dec, block->p_buffer, block->i_buffer, ts))
+    {
+        block_Release(block);
+        return VLCDEC_ECRITICAL;
+    }
+    block_Release(block);
+
+    if (ProcessEvents(dec))
+        return VLCDEC_ECRITICAL;
+    ProcessCapture(dec);
+    return VLCDEC_SUCCESS;
+}
+
+static void Flush(decoder_t *dec)
+{
+    decoder_sys_t *sys = dec->p_sys;
+    enum v4l2_buf_type type;
+
+    /* Stopping a queue returns all its buffers */
+    type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    xioctl(sys->fd, VIDIOC_STREAMOFF, &type);
+    for (unsigned i = 0; i < sys->out_count; i++)
+        sys->out[i].queued = false;
+    xioctl(sys->fd, VIDIOC_STREAMON, &type);
+
+    if (sys->cap_streaming)
+    {
+        type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        xioctl(sys->fd, VIDIOC_STREAMOFF, &type);
+        for (unsigned i = 0; i < sys->cap_count; i++)
+        {
+            sys->cap[i].queued = false;
+            QueueCapture(dec, i);
+        }
+        xioctl(sys->fd, VIDIOC_STREAMON, &type);
+    }
+    sys->b_send_config = true;
+}
+
+static int OpenDecoder(vlc_object_t *obj)
+{
+    decoder_t *dec = (decoder_t *)obj;
+    uint32_t pixelformat = 0;
+
+    if (dec->fmt_in.i_cat != VIDEO_ES)
+        return VLC_EGENERIC;
+
+    for (size_t i = 0; i < ARRAY_SIZE(codecs); i++)
+        if (codecs[i].codec == dec->fmt_in.i_codec)
+            pixelformat = codecs[i].pixelformat;
+    if (pixelformat == 0)
+        return VLC_EGENERIC;
+
+    decoder_sys_t *sys = calloc(1, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    dec->p_sys = sys;
+    sys->pixelformat = pixelformat;
+    sys->b_send_config = true;
+
+    sys->fd = OpenDevice(dec, pixelformat);
+    if (sys->fd == -1)
+    {
+        free(sys);
+        return VLC_EGENERIC;
+    }
+
+    if (dec->fmt_in.i_codec == VLC_CODEC_H264
+     || dec->fmt_in.i_codec == VLC_CODEC_HEVC)
+    {
+        hxxx_helper_init(&sys->hh, obj, dec->fmt_in.i_codec, false);
+        sys->b_hxxx = true;
+        if (hxxx_helper_set_extra(&sys->hh, dec->fmt_in.p_extra,
+                                  dec->fmt_in.i_extra))
+            goto error;
+    }
+
+    /* Configure the compressed data queue */
+    struct v4l2_format fmt = { .type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE };
+
+    fmt.fmt.pix_mp.pixelformat = pixelformat;
+    fmt.fmt.pix_mp.width = dec->fmt_in.video.i_width;
+    fmt.fmt.pix_mp.height = dec->fmt_in.video.i_height;
+    fmt.fmt.pix_mp.num_planes = 1;
+    fmt.fmt.pix_mp.plane_fmt[0].sizeimage = V4L2M2M_OUTPUT_SIZE;
+    if (xioctl(sys->fd, VIDIOC_S_FMT, &fmt))
+    {
+        msg_Err(dec, "cannot set data format: %s", vlc_strerror_c(errno));
+        goto error;
+    }
+
+    struct v4l2_event_subscription sub = {
+        .type = V4L2_EVENT_SOURCE_CHANGE,
+    };
+    if (xioctl(sys->fd, VIDIOC_SUBSCRIBE_EVENT, &sub))
+    {
+        msg_Err(dec, "cannot subscribe to events: %s",
+                vlc_strerror_c(errno));
+        goto error;
+    }
+
+    sys->out_count = MapBuffers(dec, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+                                sys->out, V4L2M2M_OUTPUT_BUFFERS);
+    if (sys->out_count == 0)
+        goto error;
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    if (xioctl(sys->fd, VIDIOC_STREAMON, &type))
+    {
+        msg_Err(dec, "cannot start data queue: %s", vlc_strerror_c(errno));
+        ReleaseBuffers(dec, type, sys->out, sys->out_count);
+        goto error;
+    }
+
+    /* The actual picture format is known after the first source change
+     * event, see SetupCapture(). */
+    dec->fmt_out.i_codec = VLC_CODEC_NV12;
+    dec->fmt_out.video.i_chroma = VLC_CODEC_NV12;
+
+    dec->pf_decode = Decode;
+    dec->pf_flush = Flush;
+    return VLC_SUCCESS;
+error:
+    if (sys->b_hxxx)
+        hxxx_helper_clean(&sys->hh);
+    vlc_close(sys->fd);
+    free(sys);
+    return VLC_EGENERIC;
+}
+
+static void CloseDecoder(vlc_object_t *obj)
+{
+    decoder_t *dec = (decoder_t *)obj;
+    decoder_sys_t *sys = dec->p_sys;
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+
+    StopCapture(dec);
+    xioctl(sys->fd, VIDIOC_STREAMOFF, &type);
+    ReleaseBuffers(dec, type, sys->out, sys->out_count);
+    if (sys->b_hxxx)
+        hxxx_helper_clean(&sys->hh);
+    vlc_close(sys->fd);
+    free(sys);
+}
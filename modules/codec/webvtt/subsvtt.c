@@ -127,6 +127,8 @@ struct webvtt_dom_cue_t
     webvtt_cue_settings_t settings;
     unsigned i_lines;
     text_style_t *p_cssstyle;
+    bool b_styled; /* CSS rules already applied to the cue nodes */
+    text_segment_t *p_segments; /* cached rendering, or NULL */
     webvtt_dom_node_t *p_child;
 };
 
@@ -157,6 +159,7 @@ typedef struct
 #ifdef HAVE_CSS
     /* CSS */
     vlc_css_rule_t *p_css_rules;
+    bool b_css_static; /* matching depends neither on time nor on siblings */
 #endif
 } decoder_sys_t;
 
@@ -843,6 +846,10 @@ static void webvtt_domnode_SelectNodesInTree( decoder_t *p_dec, const vlc_css_se
     if( p_root == NULL )
         return;
 
+    /* Already styled cues keep their computed styles */
+    if( p_root->type == NODE_CUE && ((const webvtt_dom_cue_t *)p_root)->b_styled )
+        return;
+
     if( webvtt_domnode_MatchType( p_dec, p_root, p_sel, i_playbacktime ) )
     {
         if( p_sel->specifiers.p_first == NULL )
@@ -940,13 +947,23 @@ static webvtt_dom_cue_t * webvtt_dom_cue_New( vlc_tick_t i_start, vlc_tick_t i_e
         p_cue->p_child = NULL;
         p_cue->i_lines = 0;
         p_cue->p_cssstyle = NULL;
+        p_cue->b_styled = false;
+        p_cue->p_segments = NULL;
         webvtt_cue_settings_Init( &p_cue->settings );
     }
     return p_cue;
 }
 
+static void webvtt_dom_cue_ClearSegments( webvtt_dom_cue_t *p_cue )
+{
+    if( p_cue->p_segments )
+        text_segment_ChainDelete( p_cue->p_segments );
+    p_cue->p_segments = NULL;
+}
+
 static void webvtt_dom_cue_ClearText( webvtt_dom_cue_t *p_cue )
 {
+    webvtt_dom_cue_ClearSegments( p_cue );
     webvtt_domnode_ChainDelete( p_cue->p_child );
     p_cue->p_child = NULL;
     p_cue->i_lines = 0;
@@ -967,6 +984,8 @@ static unsigned webvtt_dom_cue_Reduced( webvtt_dom_cue_t *p_cue )
     if( p_cue->i_lines < 1 )
         return 0;
 
+    webvtt_dom_cue_ClearSegments( p_cue );
+
     for( webvtt_dom_node_t *p_node = p_cue->p_child;
                            p_node; p_node = p_node->p_next )
     {
@@ -1554,11 +1573,30 @@ static text_segment_t *ConvertNodesToSegments( decoder_t *p_dec,
     return p_head;
 }
 
+/* Whether computed styles only change with the cues themselves */
+static bool HasStaticStyles( decoder_t *p_dec )
+{
+#ifdef HAVE_CSS
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    return p_sys->b_css_static;
+#else
+    VLC_UNUSED(p_dec);
+    return true;
+#endif
+}
+
 static text_segment_t *ConvertCueToSegments( decoder_t *p_dec,
                                              struct render_variables_s *p_vars,
-                                             const webvtt_dom_cue_t *p_cue )
+                                             webvtt_dom_cue_t *p_cue )
 {
-    return ConvertNodesToSegments( p_dec, p_vars, p_cue, p_cue->p_child );
+    if( !HasStaticStyles( p_dec ) )
+        return ConvertNodesToSegments( p_dec, p_vars, p_cue, p_cue->p_child );
+
+    /* Reuse the segments as long as the cue does not change */
+    if( p_cue->p_segments == NULL )
+        p_cue->p_segments = ConvertNodesToSegments( p_dec, p_vars, p_cue,
+                                                    p_cue->p_child );
+    return text_segment_Copy( p_cue->p_segments );
 }
 
 static void ChainCueSegments( const webvtt_dom_cue_t *p_cue, text_segment_t *p_new,
@@ -1598,13 +1636,13 @@ static void ChainCueSegments( const webvtt_dom_cue_t *p_cue, text_segment_t *p_n
 
 static text_segment_t * ConvertCuesToSegments( decoder_t *p_dec, vlc_tick_t i_start, vlc_tick_t i_stop,
                                                struct render_variables_s *p_vars,
-                                               const webvtt_dom_cue_t *p_cue )
+                                               webvtt_dom_cue_t *p_cue )
 {
     text_segment_t *p_segments = NULL;
     text_segment_t **pp_append = &p_segments;
     VLC_UNUSED(i_stop);
 
-    for( ; p_cue; p_cue = (const webvtt_dom_cue_t *) p_cue->p_next )
+    for( ; p_cue; p_cue = (webvtt_dom_cue_t *) p_cue->p_next )
     {
         if( p_cue->type != NODE_CUE )
             continue;
@@ -1677,7 +1715,61 @@ static void ClearCSSStyles( webvtt_dom_node_t *p_node )
         ClearCSSStyles( p_child );
 }
 
+static void MarkCuesStyled( webvtt_dom_node_t *p_node )
+{
+    for( ; p_node; p_node = p_node->p_next )
+    {
+        if( p_node->type == NODE_CUE )
+            ((webvtt_dom_cue_t *)p_node)->b_styled = true;
+        else if( p_node->type == NODE_REGION )
+            MarkCuesStyled( ((webvtt_region_t *)p_node)->p_child );
+    }
+}
+
+static void InvalidateCues( webvtt_dom_node_t *p_node )
+{
+    for( ; p_node; p_node = p_node->p_next )
+    {
+        if( p_node->type == NODE_CUE )
+        {
+            webvtt_dom_cue_t *p_cue = (webvtt_dom_cue_t *)p_node;
+            p_cue->b_styled = false;
+            webvtt_dom_cue_ClearSegments( p_cue );
+        }
+        else if( p_node->type == NODE_REGION )
+            InvalidateCues( ((webvtt_region_t *)p_node)->p_child );
+    }
+}
+
 #ifdef HAVE_CSS
+static bool IsStaticSelector( const vlc_css_selector_t *p_sel )
+{
+    for( ; p_sel; p_sel = p_sel->p_next )
+    {
+        if( p_sel->type == SELECTOR_PSEUDOCLASS || /* :past, :future */
+            p_sel->combinator == RELATION_DIRECTADJACENT ||
+            p_sel->combinator == RELATION_INDIRECTADJACENT ||
+            !IsStaticSelector( p_sel->specifiers.p_first ) )
+            return false;
+    }
+    return true;
+}
+
+/* Rules changed: styles are computed again, once per cue when possible */
+static void UpdateCSSRules( decoder_t *p_dec )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    p_sys->b_css_static = true;
+    for( const vlc_css_rule_t *p_rule = p_sys->p_css_rules;
+                               p_rule; p_rule = p_rule->p_next )
+        if( !IsStaticSelector( p_rule->p_selectors ) )
+            p_sys->b_css_static = false;
+
+    ClearCSSStyles( (webvtt_dom_node_t *)p_sys->p_root );
+    InvalidateCues( p_sys->p_root->p_child );
+}
+
 static void ApplyCSSRules( decoder_t *p_dec, const vlc_css_rule_t *p_rule,
                            vlc_tick_t i_playbacktime )
 {
@@ -1724,14 +1816,17 @@ static void RenderRegions( decoder_t *p_dec, vlc_tick_t i_start, vlc_tick_t i_st
 #ifdef HAVE_CSS
     ApplyCSSRules( p_dec, p_sys->p_css_rules, i_start );
 #endif
+    /* Static styles are computed once per cue */
+    if( HasStaticStyles( p_dec ) )
+        MarkCuesStyled( p_sys->p_root->p_child );
 
-    const webvtt_dom_cue_t *p_rlcue = NULL;
-    for( const webvtt_dom_node_t *p_node = p_sys->p_root->p_child;
-                                  p_node; p_node = p_node->p_next )
+    webvtt_dom_cue_t *p_rlcue = NULL;
+    for( webvtt_dom_node_t *p_node = p_sys->p_root->p_child;
+                            p_node; p_node = p_node->p_next )
     {
         if( p_node->type == NODE_REGION )
         {
-            const webvtt_region_t *p_vttregion = (const webvtt_region_t *) p_node;
+            webvtt_region_t *p_vttregion = (webvtt_region_t *) p_node;
             /* Variables */
             struct render_variables_s v;
             v.p_region = p_vttregion;
@@ -1744,7 +1839,7 @@ static void RenderRegions( decoder_t *p_dec, vlc_tick_t i_start, vlc_tick_t i_st
 
             text_segment_t *p_segments =
                     ConvertCuesToSegments( p_dec, i_start, i_stop, &v,
-                                          (const webvtt_dom_cue_t *)p_vttregion->p_child );
+                                          (webvtt_dom_cue_t *)p_vttregion->p_child );
             if( !p_segments )
                 continue;
 
@@ -1768,7 +1863,7 @@ static void RenderRegions( decoder_t *p_dec, vlc_tick_t i_start, vlc_tick_t i_st
         else if ( p_node->type == NODE_CUE )
         {
             if( p_rlcue == NULL )
-                p_rlcue = ( const webvtt_dom_cue_t * ) p_node;
+                p_rlcue = ( webvtt_dom_cue_t * ) p_node;
         }
     }
 
@@ -1784,8 +1879,8 @@ static void RenderRegions( decoder_t *p_dec, vlc_tick_t i_start, vlc_tick_t i_st
         v.i_top = 0.0;
         /* !Variables */
 
-        for( const webvtt_dom_cue_t *p_cue = p_rlcue; p_cue;
-             p_cue = (const webvtt_dom_cue_t *) p_cue->p_next )
+        for( webvtt_dom_cue_t *p_cue = p_rlcue; p_cue;
+             p_cue = (webvtt_dom_cue_t *) p_cue->p_next )
         {
             if( p_cue->type != NODE_CUE )
                 continue;
@@ -1865,7 +1960,7 @@ static void Render( decoder_t *p_dec, vlc_tick_t i_start, vlc_tick_t i_stop )
                  (const webvtt_dom_tag_t *) vlc_array_item_at_index( &timedtags, i );
          if( p_tag->i_start != i_substart ) /* might be duplicates */
          {
-             if( i > 0 )
+             if( i > 0 && !HasStaticStyles( p_dec ) )
                  ClearCSSStyles( (webvtt_dom_node_t *)p_sys->p_root );
              RenderRegions( p_dec, i_substart, p_tag->i_start );
              i_substart = p_tag->i_start;
@@ -1873,7 +1968,7 @@ static void Render( decoder_t *p_dec, vlc_tick_t i_start, vlc_tick_t i_stop )
     }
     if( i_substart != i_stop )
     {
-        if( i_substart != i_start )
+        if( i_substart != i_start && !HasStaticStyles( p_dec ) )
             ClearCSSStyles( (webvtt_dom_node_t *)p_sys->p_root );
         RenderRegions( p_dec, i_substart, i_stop );
     }
@@ -1988,6 +2083,7 @@ static void ParserHeaderHandler( void *priv, enum webvtt_header_line_e s,
                     pp_append = &((*pp_append)->p_next);
                 *pp_append = p.rules.p_first;
                 p.rules.p_first = NULL;
+                UpdateCSSRules( p_dec );
 
                 vlc_css_parser_Clean(&p);
                 free( ctx->css.ptr );
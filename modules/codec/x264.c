@@ -407,6 +407,15 @@ static void x264_log( void *, int i_level, const char *psz, va_list );
 #define LOOKAHEAD_LONGTEXT N_("Framecount to use on frametype lookahead. " \
     "Currently default can cause sync-issues on unmuxable output, like rtsp-output without ts-mux" )
 
+#define LOOKAHEAD_THREADS_TEXT N_("Lookahead threads")
+#define LOOKAHEAD_THREADS_LONGTEXT N_("Number of threads used for frametype " \
+    "lookahead. 0 is automatic, based on number of threads." )
+
+#define SLICED_THREADS_TEXT N_("Sliced threads")
+#define SLICED_THREADS_LONGTEXT N_("Use slice-based threading instead of " \
+    "frame-based threading. This reduces latency at the cost of throughput " \
+    "and compression efficiency." )
+
 #define HRD_TEXT N_("HRD-timing information")
 #define TUNE_TEXT N_("Default tune setting used" )
 #define PRESET_TEXT N_("Default preset setting used" )
@@ -664,6 +673,13 @@ vlc_module_begin ()
                  LOOKAHEAD_LONGTEXT, true )
         change_integer_range( 0, 60 )
 
+    add_integer( SOUT_CFG_PREFIX "lookahead-threads", 0,
+                 LOOKAHEAD_THREADS_TEXT, LOOKAHEAD_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 16 )
+
+    add_bool( SOUT_CFG_PREFIX "sliced-threads", false, SLICED_THREADS_TEXT,
+              SLICED_THREADS_LONGTEXT, true )
+
     add_bool( SOUT_CFG_PREFIX "intra-refresh", false, INTRAREFRESH_TEXT,
               INTRAREFRESH_LONGTEXT, true )
 
@@ -748,6 +764,7 @@ static const char *const ppsz_sout_options[] = {
     "sps-id", "ssim", "stats", "subme", "trellis",
     "verbose", "vbv-bufsize", "vbv-init", "vbv-maxrate", "weightb", "weightp",
     "aq-mode", "aq-strength", "psy-rd", "psy", "profile", "lookahead", "slices",
+    "lookahead-threads", "sliced-threads",
     "slice-max-size", "slice-max-mbs", "intra-refresh", "mbtree", "hrd",
     "tune","preset", "opengop", "bluray-compat", "frame-packing", "options",
     "fullrange",
@@ -1330,6 +1347,14 @@ static int  Open ( vlc_object_t *p_this )
        default unless ofcourse transcode threads is explicitly specified.. */
     p_sys->param.i_threads = p_enc->i_threads;
 
+    /* Do not override the tune setting (zerolatency) unless requested */
+    if( var_GetBool( p_enc, SOUT_CFG_PREFIX "sliced-threads" ) )
+        p_sys->param.b_sliced_threads = 1;
+
+    i_val = var_GetInteger( p_enc, SOUT_CFG_PREFIX "lookahead-threads" );
+    if( i_val > 0 )
+        p_sys->param.i_lookahead_threads = i_val;
+
     psz_val = var_GetString( p_enc, SOUT_CFG_PREFIX "stats" );
     if( psz_val )
     {
@@ -1525,7 +1550,8 @@ static block_t *Encode( encoder_t *p_enc, picture_t *p_pict )
        free( p_sys->p_sei );
        p_sys->p_sei = NULL;
     }
-    /* copy encoded data directly to block */
+    /* copy encoded data directly to block: the NAL payloads are only valid
+     * until the next call to x264_encoder_encode() */
     memcpy( p_block->p_buffer + i_offset, nal[0].p_payload, i_out );
 
     if( pic.b_keyframe )
@@ -36,6 +36,7 @@
 #include "logic/AlwaysLowestAdaptationLogic.hpp"
 #include "logic/PredictiveAdaptationLogic.hpp"
 #include "logic/NearOptimalAdaptationLogic.hpp"
+#include "logic/HybridAdaptationLogic.hpp"
 #include "tools/Debug.hpp"
 #include <vlc_stream.h>
 #include <vlc_demux.h>
@@ -65,6 +66,9 @@ PlaylistManager::PlaylistManager( demux_t *p_demux_,
     failedupdates = 0;
     b_thread = false;
     b_buffering = false;
+    b_canceled = false;
+    b_updating = false;
+    updateinterrupt = NULL;
     nextPlaylistupdate = 0;
     demux.i_nzpcr = VLC_TICK_INVALID;
     demux.i_firstpcr = VLC_TICK_INVALID;
@@ -183,6 +187,11 @@ void PlaylistManager::stop()
 {
     if(b_thread)
     {
+        vlc_mutex_lock(&lock);
+        b_canceled = true;
+        if(updateinterrupt)
+            vlc_interrupt_kill(updateinterrupt);
+        vlc_mutex_unlock(&lock);
         vlc_cancel(thread);
         vlc_join(thread, NULL);
         b_thread = false;
@@ -611,7 +620,15 @@ void PlaylistManager::setBufferingRunState(bool b)
 {
     vlc_mutex_lock(&lock);
     b_buffering = b;
-    vlc_cond_signal(&waitcond);
+    if(!b)
+    {
+        /* Don't wait for a blocking playlist reload to return */
+        if(updateinterrupt)
+            vlc_interrupt_kill(updateinterrupt);
+        while(b_updating)
+            vlc_cond_wait(&waitcond, &lock);
+    }
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock(&lock);
 }
 
@@ -628,14 +645,36 @@ void PlaylistManager::Run()
         vlc_testcancel();
         vlc_cleanup_pop();
 
-        if(needsUpdate())
+        if(!b_canceled && needsUpdate())
         {
+            /* Reloads can block until the server publishes new segments
+             * (HLS blocking reloads), so they run unlocked and can be
+             * interrupted by stop() and by the demux controls */
+            b_updating = true;
+            updateinterrupt = vlc_interrupt_create();
+            vlc_interrupt_t *ctx = updateinterrupt;
+            vlc_mutex_unlock(&lock);
+
             int canc = vlc_savecancel();
+            vlc_interrupt_t *prevctx = ctx ? vlc_interrupt_set(ctx) : NULL;
             if(updatePlaylist())
                 scheduleNextUpdate();
-            else
+            else if(!vlc_killed())
                 failedupdates++;
+            if(ctx)
+                vlc_interrupt_set(prevctx);
             vlc_restorecancel(canc);
+
+            vlc_mutex_lock(&lock);
+            updateinterrupt = NULL;
+            b_updating = false;
+            vlc_cond_broadcast(&waitcond);
+            if(ctx)
+                vlc_interrupt_destroy(ctx);
+
+            /* stopped while unlocked, let the controls run first */
+            if(!b_buffering)
+                continue;
         }
 
         vlc_mutex_lock(&demux.lock);
@@ -756,6 +795,16 @@ AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::L
             if(predictivelogic)
                 conn->setDownloadRateObserver(predictivelogic);
             logic = predictivelogic;
+            break;
+        }
+        case AbstractAdaptationLogic::Hybrid:
+        {
+            HybridAdaptationLogic *hybridlogic =
+                    new (std::nothrow) HybridAdaptationLogic(VLC_OBJECT(p_demux));
+            if(hybridlogic)
+                conn->setDownloadRateObserver(hybridlogic);
+            logic = hybridlogic;
+            break;
         }
 
         default:
@@ -24,6 +24,7 @@
 
 #include "logic/AbstractAdaptationLogic.h"
 #include "Streams.hpp"
+#include <vlc_interrupt.h>
 #include <vector>
 
 namespace adaptive
@@ -136,6 +137,9 @@ namespace adaptive
             bool         b_thread;
             vlc_cond_t   waitcond;
             bool         b_buffering;
+            bool         b_canceled;
+            bool         b_updating; /* playlist reload in progress, unlocked */
+            vlc_interrupt_t *updateinterrupt; /* aborts the reload, or NULL */
     };
 
 }
@@ -29,6 +29,14 @@
 #include "playlist/Segment.h"
 #include "playlist/SegmentChunk.hpp"
 #include "logic/AbstractAdaptationLogic.h"
+#include "http/HTTPConnectionManager.h"
+
+#include <algorithm>
+
+/* Budget reserved for segments whose size can't be estimated */
+#define PREFETCH_DEFAULT_SIZE (1 << 20)
+/* Budget reserved for initialization segments */
+#define PREFETCH_INIT_SIZE (64 << 10)
 
 using namespace adaptive;
 using namespace adaptive::logic;
@@ -76,8 +84,22 @@ SegmentTrackerEvent::SegmentTrackerEvent(const ID &id, vlc_tick_t duration)
     u.segment.id = &id;
 }
 
+SegmentTracker::PrefetchedChunk::PrefetchedChunk(BaseRepresentation *rep_,
+                                                 ISegment *segment_, uint64_t number_,
+                                                 SegmentChunk *chunk_, size_t size_,
+                                                 bool init_)
+{
+    rep = rep_;
+    segment = segment_;
+    number = number_;
+    chunk = chunk_;
+    size = size_;
+    init = init_;
+}
+
 SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet)
 {
+    prefetchManager = NULL;
     first = true;
     curNumber = next = 0;
     initializing = true;
@@ -115,6 +137,20 @@ StreamFormat SegmentTracker::getCurrentFormat() const
     return StreamFormat();
 }
 
+void SegmentTracker::getMaxResolution(unsigned *width, unsigned *height) const
+{
+    *width = *height = 0;
+    const std::vector<BaseRepresentation *> &reps = adaptationSet->getRepresentations();
+    std::vector<BaseRepresentation *>::const_iterator it;
+    for(it = reps.begin(); it != reps.end(); ++it)
+    {
+        if((*it)->getWidth() > 0 && (unsigned)(*it)->getWidth() > *width)
+            *width = (*it)->getWidth();
+        if((*it)->getHeight() > 0 && (unsigned)(*it)->getHeight() > *height)
+            *height = (*it)->getHeight();
+    }
+}
+
 bool SegmentTracker::segmentsListReady() const
 {
     BaseRepresentation *rep = curRepresentation;
@@ -127,6 +163,7 @@ bool SegmentTracker::segmentsListReady() const
 
 void SegmentTracker::reset()
 {
+    flushPrefetched();
     notify(SegmentTrackerEvent(curRepresentation, NULL));
     curRepresentation = NULL;
     init_sent = false;
@@ -221,7 +258,12 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         init_sent = true;
         segment = rep->getSegment(BaseRepresentation::INFOTYPE_INIT);
         if(segment)
+        {
+            SegmentChunk *chunk = takePrefetched(rep, segment, next, true);
+            if(chunk)
+                return chunk;
             return segment->toChunk(next, rep, connManager);
+        }
     }
 
     if(!index_sent)
@@ -246,7 +288,9 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         initializing = false;
     }
 
-    SegmentChunk *chunk = segment->toChunk(next, rep, connManager);
+    SegmentChunk *chunk = takePrefetched(rep, segment, next, false);
+    if(!chunk)
+        chunk = segment->toChunk(next, rep, connManager);
 
     /* Notify new segment length for stats / logic */
     if(chunk)
@@ -273,11 +317,167 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        /* Request the following segments now, so we don't stall on
+         * the next segment boundary */
+        prefetch(rep, connManager);
+        prefetchInit(rep, connManager);
     }
 
     return chunk;
 }
 
+SegmentChunk * SegmentTracker::takePrefetched(BaseRepresentation *rep, ISegment *segment,
+                                              uint64_t number, bool init)
+{
+    SegmentChunk *chunk = NULL;
+    std::list<PrefetchedChunk>::iterator it = prefetched.begin();
+    while(it != prefetched.end())
+    {
+        PrefetchedChunk &entry = *it;
+        bool b_drop = false;
+        if(!chunk && entry.rep == rep && entry.segment == segment &&
+           entry.init == init && (init || entry.number == number))
+        {
+            chunk = entry.chunk;
+            entry.chunk = NULL;
+            b_drop = true;
+        }
+        /* Media segments of another representation, or behind us */
+        else if(!entry.init && (entry.rep != rep || (!init && entry.number <= number)))
+        {
+            b_drop = true;
+        }
+
+        if(b_drop)
+        {
+            releasePrefetched(entry);
+            it = prefetched.erase(it);
+        }
+        else ++it;
+    }
+    return chunk;
+}
+
+void SegmentTracker::prefetch(BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    const unsigned max = connManager->getMaxPrefetch();
+    unsigned count = 0;
+    uint64_t number = next;
+
+    std::list<PrefetchedChunk>::const_iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+    {
+        if(!(*it).init && (*it).rep == rep)
+        {
+            count++;
+            number = std::max(number, (*it).number + 1);
+        }
+    }
+
+    /* Live segments can't be requested before being available */
+    vlc_tick_t availableEnd = VLC_TICK_INVALID;
+    if(rep->getPlaylist()->isLive())
+    {
+        vlc_tick_t time, duration;
+        if(!rep->getPlaybackTimeDurationBySegmentNumber(curNumber, &time, &duration))
+            return;
+        availableEnd = time + duration + rep->getMinAheadTime(curNumber);
+    }
+
+    while(count < max)
+    {
+        bool b_gap = false;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &number, &b_gap);
+        if(!segment)
+            break;
+
+        vlc_tick_t time, duration;
+        if(!rep->getPlaybackTimeDurationBySegmentNumber(number, &time, &duration))
+            time = duration = VLC_TICK_INVALID;
+
+        if(availableEnd != VLC_TICK_INVALID &&
+           (duration == VLC_TICK_INVALID || time + duration > availableEnd))
+            break;
+
+        size_t size = PREFETCH_DEFAULT_SIZE;
+        if(duration != VLC_TICK_INVALID && duration > 0 && rep->getBandwidth())
+            size = rep->getBandwidth() * duration / (CLOCK_FREQ * 8);
+
+        if(!connManager->reservePrefetch(size))
+            break;
+
+        SegmentChunk *chunk = segment->toChunk(number, rep, connManager);
+        if(!chunk)
+        {
+            connManager->releasePrefetch(size);
+            break;
+        }
+
+        prefetchManager = connManager;
+        prefetched.push_back(PrefetchedChunk(rep, segment, number, chunk, size, false));
+        number++;
+        count++;
+    }
+}
+
+void SegmentTracker::prefetchInit(BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    if(connManager->getMaxPrefetch() == 0 ||
+       rep->getSwitchPolicy() == SegmentInformation::SWITCH_UNAVAILABLE)
+        return;
+
+    /* Pre-warm the switch to the representation the logic would pick now */
+    BaseRepresentation *nextRep = logic->getNextRepresentation(adaptationSet, rep);
+    if(!nextRep || nextRep == rep || nextRep->needsUpdate())
+        return;
+
+    ISegment *segment = nextRep->getSegment(BaseRepresentation::INFOTYPE_INIT);
+
+    std::list<PrefetchedChunk>::iterator it = prefetched.begin();
+    while(it != prefetched.end())
+    {
+        PrefetchedChunk &entry = *it;
+        if(entry.init)
+        {
+            if(entry.rep == nextRep && entry.segment == segment)
+                return; /* already requested */
+            releasePrefetched(entry);
+            it = prefetched.erase(it);
+        }
+        else ++it;
+    }
+
+    if(!segment || !connManager->reservePrefetch(PREFETCH_INIT_SIZE))
+        return;
+
+    SegmentChunk *chunk = segment->toChunk(next, nextRep, connManager);
+    if(!chunk)
+    {
+        connManager->releasePrefetch(PREFETCH_INIT_SIZE);
+        return;
+    }
+
+    prefetchManager = connManager;
+    prefetched.push_back(PrefetchedChunk(nextRep, segment, next, chunk,
+                                         PREFETCH_INIT_SIZE, true));
+}
+
+void SegmentTracker::releasePrefetched(PrefetchedChunk &entry)
+{
+    delete entry.chunk;
+    entry.chunk = NULL;
+    prefetchManager->releasePrefetch(entry.size);
+}
+
+void SegmentTracker::flushPrefetched()
+{
+    std::list<PrefetchedChunk>::iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+        releasePrefetched(*it);
+    prefetched.clear();
+}
+
 bool SegmentTracker::setPositionByTime(vlc_tick_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
@@ -297,6 +497,7 @@ bool SegmentTracker::setPositionByTime(vlc_tick_t time, bool restarted, bool try
 
 void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
 {
+    flushPrefetched();
     if(restarted)
     {
         initializing = true;
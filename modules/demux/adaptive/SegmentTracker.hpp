@@ -43,6 +43,7 @@ namespace adaptive
     {
         class BaseAdaptationSet;
         class BaseRepresentation;
+        class ISegment;
         class SegmentChunk;
     }
 
@@ -116,6 +117,7 @@ namespace adaptive
             ~SegmentTracker();
 
             StreamFormat getCurrentFormat() const;
+            void getMaxResolution(unsigned *, unsigned *) const;
             bool segmentsListReady() const;
             void reset();
             SegmentChunk* getNextChunk(bool, AbstractConnectionManager *);
@@ -129,8 +131,25 @@ namespace adaptive
             void updateSelected();
 
         private:
+            class PrefetchedChunk
+            {
+                public:
+                    PrefetchedChunk(BaseRepresentation *, ISegment *, uint64_t,
+                                    SegmentChunk *, size_t, bool);
+                    BaseRepresentation *rep;
+                    ISegment *segment;
+                    uint64_t number;
+                    SegmentChunk *chunk;
+                    size_t size; /* reserved prefetch budget */
+                    bool init;
+            };
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            SegmentChunk * takePrefetched(BaseRepresentation *, ISegment *, uint64_t, bool);
+            void prefetch(BaseRepresentation *, AbstractConnectionManager *);
+            void prefetchInit(BaseRepresentation *, AbstractConnectionManager *);
+            void releasePrefetched(PrefetchedChunk &);
+            void flushPrefetched();
             bool first;
             bool initializing;
             bool index_sent;
@@ -142,6 +161,8 @@ namespace adaptive
             BaseAdaptationSet *adaptationSet;
             BaseRepresentation *curRepresentation;
             std::list<SegmentTrackerListenerInterface *> listeners;
+            std::list<PrefetchedChunk> prefetched;
+            AbstractConnectionManager *prefetchManager;
     };
 }
 
@@ -563,6 +563,10 @@ void AbstractStream::fillExtraFMTInfo( es_format_t *p_fmt ) const
         p_fmt->psz_language = strdup(language.c_str());
     if(!p_fmt->psz_description && !description.empty())
         p_fmt->psz_description = strdup(description.c_str());
+    /* Let the decoder allocate for the largest representation */
+    if(p_fmt->i_cat == VIDEO_ES && segmentTracker)
+        segmentTracker->getMaxResolution(&p_fmt->video.i_max_width,
+                                         &p_fmt->video.i_max_height);
 }
 
 void AbstractStream::setTimeOffset(vlc_tick_t i_offset)
@@ -76,10 +76,33 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using HTTP access instead of custom HTTP code")
 
+#define ADAPT_H2_TEXT N_("Use HTTP/2 for HTTPS")
+#define ADAPT_H2_LONGTEXT N_("Download HTTPS segments with the HTTP/2 capable " \
+                             "client, multiplexing requests to a same server")
+
+#define ADAPT_PREFETCH_TEXT N_("Prefetched segments")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of upcoming segments downloaded " \
+                                   "ahead of playback for each stream")
+
+#define ADAPT_PREFETCH_BUDGET_TEXT N_("Prefetch budget (KiB)")
+#define ADAPT_PREFETCH_BUDGET_LONGTEXT N_("Maximum amount of data held by " \
+                                          "prefetched segments of all streams")
+
+#define ADAPT_CACHE_SIZE_TEXT N_("Shared segment cache (KiB)")
+#define ADAPT_CACHE_SIZE_LONGTEXT N_("Maximum amount of segments kept for " \
+    "the other adaptive inputs of the process, so that inputs of a same " \
+    "stream download each segment once. 0 disables the cache.")
+
+#define ADAPT_DOWNLOADERS_TEXT N_("Parallel downloads")
+#define ADAPT_DOWNLOADERS_LONGTEXT N_("Maximum number of segments downloaded " \
+    "at the same time. Each stream (audio, video, subtitles...) downloads " \
+    "at most one segment at a time.")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
                                 AbstractAdaptationLogic::NearOptimal,
+                                AbstractAdaptationLogic::Hybrid,
                                 AbstractAdaptationLogic::RateBased,
                                 AbstractAdaptationLogic::FixedRate,
                                 AbstractAdaptationLogic::AlwaysLowest,
@@ -89,6 +112,7 @@ static const char *const ppsz_logics_values[] = {
                                 "",
                                 "predictive",
                                 "nearoptimal",
+                                "hybrid",
                                 "rate",
                                 "fixedrate",
                                 "lowest",
@@ -97,6 +121,7 @@ static const char *const ppsz_logics_values[] = {
 static const char *const ppsz_logics[] = { N_("Default"),
                                            N_("Predictive"),
                                            N_("Near Optimal"),
+                                           N_("Latency aware hybrid"),
                                            N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
@@ -122,6 +147,17 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_bool   ( "adaptive-use-h2", true, ADAPT_H2_TEXT, ADAPT_H2_LONGTEXT, true )
+        add_integer( "adaptive-downloaders", 3, ADAPT_DOWNLOADERS_TEXT,
+                     ADAPT_DOWNLOADERS_LONGTEXT, true )
+            change_integer_range( 1, 16 )
+        add_integer( "adaptive-prefetch", 1, ADAPT_PREFETCH_TEXT,
+                     ADAPT_PREFETCH_LONGTEXT, true )
+            change_integer_range( 0, 10 )
+        add_integer( "adaptive-prefetch-budget", 32768, ADAPT_PREFETCH_BUDGET_TEXT,
+                     ADAPT_PREFETCH_BUDGET_LONGTEXT, true )
+        add_integer( "adaptive-cache-size", 32768, ADAPT_CACHE_SIZE_TEXT,
+                     ADAPT_CACHE_SIZE_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -268,7 +304,11 @@ static PlaylistManager * HandleDash(demux_t *p_demux,
                                     const std::string & playlisturl,
                                     AbstractAdaptationLogic::LogicType logic)
 {
-    if(!xmlParser.reset(p_demux->s) || !xmlParser.parse(true))
+    IsoffMainTimelineFolder folder;
+    xmlParser.setElementListener(&folder);
+    bool b_parsed = xmlParser.reset(p_demux->s) && xmlParser.parse(true);
+    xmlParser.setElementListener(NULL);
+    if(!b_parsed)
     {
         msg_Err(p_demux, "Cannot parse MPD");
         return NULL;
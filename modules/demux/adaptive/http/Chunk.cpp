@@ -29,11 +29,14 @@
 #include "HTTPConnection.hpp"
 #include "HTTPConnectionManager.h"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_memstats.h>
 
 #include <algorithm>
+#include <sstream>
 
 using namespace adaptive::http;
 
@@ -223,10 +226,11 @@ block_t * HTTPChunkSource::read(size_t readsize)
     {
         p_block->i_buffer = (size_t) ret;
         consumed += p_block->i_buffer;
-        if((size_t)ret < readsize)
+        /* short reads only mean that no more data was received yet */
+        if(ret == 0 || (contentLength && consumed >= contentLength))
             eof = true;
         if(ret && time)
-            connManager->updateDownloadRate(sourceid, p_block->i_buffer, time);
+            connManager->updateDownloadRate(sourceid, p_block->i_buffer, time, 0);
     }
 
     return p_block;
@@ -252,7 +256,7 @@ bool HTTPChunkSource::prepare()
     ConnectionParams connparams = params; /* can be changed on 301 */
 
     unsigned int i_redirects = 0;
-    while(i_redirects++ < HTTPConnection::MAX_REDIRECTS)
+    while(i_redirects++ < AbstractConnection::MAX_REDIRECTS)
     {
         if(!connection)
         {
@@ -266,13 +270,10 @@ bool HTTPChunkSource::prepare()
         {
             if(requeststatus == RequestStatus::Redirection)
             {
-                HTTPConnection *httpconn = dynamic_cast<HTTPConnection *>(connection);
-                if(httpconn)
-                    connparams = httpconn->getRedirection();
+                connparams = connection->getRedirection();
                 connection->setUsed(false);
                 connection = NULL;
-                if(httpconn)
-                    continue;
+                continue;
             }
             break;
         }
@@ -287,6 +288,20 @@ bool HTTPChunkSource::prepare()
     return false;
 }
 
+std::string HTTPChunkSource::getCacheKey() const
+{
+    vlc_mutex_locker locker(&lock);
+    if(eof)
+        return std::string();
+
+    std::ostringstream os;
+    os.imbue(std::locale("C"));
+    os << params.getUrl();
+    if(bytesRange.isValid())
+        os << "@" << bytesRange.getStartByte() << "-" << bytesRange.getEndByte();
+    return os.str();
+}
+
 block_t * HTTPChunkSource::readBlock()
 {
     return read(HTTPChunkSource::CHUNK_SIZE);
@@ -303,11 +318,22 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     done = false;
     eof = false;
     held = false;
+    waiting = 0;
     downloadstart = 0;
+    downloadlatency = 0;
+    cache = NULL;
+    cacheentry = NULL;
+    cacheable = !HTTPChunkSource::eof;
+    publishing = false;
+    resumeoffset = 0;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
 {
+    /* stop feeding, or being fed by, the other inputs */
+    if(cache)
+        cache->detach(this);
+
     /* cancel ourself if in queue */
     connManager->cancel(this);
 
@@ -322,6 +348,7 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
         p_head = NULL;
         pp_tail = &p_head;
     }
+    vlc_memstats_Add(VLC_MEMSTATS_ADAPTIVE, -(ssize_t)buffered);
     buffered = 0;
     vlc_mutex_unlock(&lock);
 
@@ -334,6 +361,12 @@ bool HTTPChunkBufferedSource::isDone() const
     return done;
 }
 
+bool HTTPChunkBufferedSource::isStarving() const
+{
+    vlc_mutex_locker locker( &lock );
+    return waiting > 0;
+}
+
 void HTTPChunkBufferedSource::hold()
 {
     vlc_mutex_locker locker( &lock );
@@ -347,6 +380,74 @@ void HTTPChunkBufferedSource::release()
     vlc_cond_signal(&avail);
 }
 
+bool HTTPChunkBufferedSource::isCacheable() const
+{
+    vlc_mutex_locker locker( &lock );
+    return cacheable;
+}
+
+void HTTPChunkBufferedSource::feedStart(const std::string &type)
+{
+    vlc_mutex_locker locker( &lock );
+    cachedtype = type;
+    if(!downloadstart)
+        downloadstart = vlc_tick_now();
+}
+
+void HTTPChunkBufferedSource::feed(block_t *p_block)
+{
+    vlc_mutex_locker locker( &lock );
+    if(done)
+    {
+        block_Release(p_block);
+        return;
+    }
+    buffered += p_block->i_buffer;
+    vlc_memstats_Add(VLC_MEMSTATS_ADAPTIVE, p_block->i_buffer);
+    block_ChainLastAppend(&pp_tail, p_block);
+    vlc_cond_signal(&avail);
+}
+
+void HTTPChunkBufferedSource::feedEnd()
+{
+    vlc_mutex_lock(&lock);
+    done = true;
+    size_t size = buffered + consumed;
+    vlc_tick_t time = vlc_tick_now() - downloadstart;
+    vlc_cond_signal(&avail);
+    vlc_mutex_unlock(&lock);
+
+    /* the logic sees how fast the segment was obtained */
+    if(size && time)
+        connManager->updateDownloadRate(sourceid, size, time, 0);
+}
+
+void HTTPChunkBufferedSource::resume()
+{
+    vlc_mutex_lock(&lock);
+    cacheable = false;
+    if(done)
+    {
+        vlc_mutex_unlock(&lock);
+        return;
+    }
+
+    /* request what was not received from the cache */
+    resumeoffset = buffered + consumed;
+    if(resumeoffset)
+    {
+        if(bytesRange.isValid())
+            bytesRange = BytesRange(bytesRange.getStartByte() + resumeoffset,
+                                    bytesRange.getEndByte());
+        else
+            bytesRange = BytesRange(resumeoffset, 0);
+    }
+    downloadstart = 0;
+    vlc_mutex_unlock(&lock);
+
+    connManager->start(this);
+}
+
 void HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
     vlc_mutex_lock(&lock);
@@ -356,14 +457,16 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         eof = true;
         vlc_cond_signal(&avail);
         vlc_mutex_unlock(&lock);
+        if(cache)
+            cache->finish(this, false);
         return;
     }
 
     if(readsize < HTTPChunkSource::CHUNK_SIZE)
         readsize = HTTPChunkSource::CHUNK_SIZE;
 
-    if(contentLength && readsize > contentLength - buffered)
-        readsize = contentLength - buffered;
+    if(contentLength && readsize > contentLength - buffered - consumed)
+        readsize = contentLength - buffered - consumed;
 
     vlc_mutex_unlock(&lock);
 
@@ -378,7 +481,11 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     {
         size_t size;
         vlc_tick_t time;
-    } rate = {0,0};
+        vlc_tick_t latency;
+    } rate = {0,0,0};
+    block_t *p_cached = NULL;
+    bool b_finished = false;
+    bool b_complete = false;
 
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
     if(ret <= 0)
@@ -387,28 +494,57 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         p_block = NULL;
         vlc_mutex_locker locker( &lock );
         done = true;
+        b_finished = true;
+        b_complete = ret == 0 && (!contentLength || buffered + consumed >= contentLength);
         rate.size = buffered + consumed;
         rate.time = vlc_tick_now() - downloadstart;
+        rate.latency = downloadlatency;
         downloadstart = 0;
     }
     else
     {
         p_block->i_buffer = (size_t) ret;
         vlc_mutex_locker locker( &lock );
+        /* copy before the reader can consume it */
+        if(publishing)
+            p_cached = block_Duplicate(p_block);
         buffered += p_block->i_buffer;
+        vlc_memstats_Add(VLC_MEMSTATS_ADAPTIVE, p_block->i_buffer);
         block_ChainLastAppend(&pp_tail, p_block);
-        if((size_t) ret < readsize)
+        /* Data is queued as soon as received, so that the demuxer can
+         * consume chunked transfers progressively. Short reads are not the
+         * end of the content, an empty read is. */
+        if(contentLength && buffered + consumed >= contentLength)
         {
             done = true;
+            b_finished = true;
+            b_complete = true;
             rate.size = buffered + consumed;
             rate.time = vlc_tick_now() - downloadstart;
+            rate.latency = downloadlatency;
             downloadstart = 0;
         }
     }
 
+    /* Prefer the transport measurement of the transfer when available,
+     * as HTTP/2 streams are received ahead of our reads */
+    size_t statsBytes;
+    vlc_tick_t statsDuration;
+    if(rate.size && connection->getTransferStats(&statsBytes, &statsDuration) &&
+       statsDuration > 0)
+    {
+        rate.size = statsBytes;
+        rate.time = rate.latency + statsDuration;
+    }
+
+    if(p_cached)
+        cache->publish(this, p_cached);
+    if(b_finished && cache)
+        cache->finish(this, b_complete);
+
     if(rate.size && rate.time)
     {
-        connManager->updateDownloadRate(sourceid, rate.size, rate.time);
+        connManager->updateDownloadRate(sourceid, rate.size, rate.time, rate.latency);
     }
 
     vlc_cond_signal(&avail);
@@ -419,7 +555,12 @@ bool HTTPChunkBufferedSource::prepare()
     if(!prepared)
     {
         downloadstart = vlc_tick_now();
-        return HTTPChunkSource::prepare();
+        if(!HTTPChunkSource::prepare())
+            return false;
+        downloadlatency = vlc_tick_now() - downloadstart;
+        /* resumed after the cache, contentLength covers the remainder */
+        if(resumeoffset && contentLength)
+            contentLength += resumeoffset;
     }
     return true;
 }
@@ -430,14 +571,26 @@ bool HTTPChunkBufferedSource::hasMoreData() const
     return !eof;
 }
 
+std::string HTTPChunkBufferedSource::getContentType() const
+{
+    {
+        vlc_mutex_locker locker( &lock );
+        if(!cachedtype.empty())
+            return cachedtype;
+    }
+    return HTTPChunkSource::getContentType();
+}
+
 block_t * HTTPChunkBufferedSource::readBlock()
 {
     block_t *p_block = NULL;
 
     vlc_mutex_locker locker(&lock);
 
+    waiting++;
     while(!p_head && !done)
         vlc_cond_wait(&avail, &lock);
+    waiting--;
 
     if(!p_head && done)
     {
@@ -460,6 +613,7 @@ block_t * HTTPChunkBufferedSource::readBlock()
 
     consumed += p_block->i_buffer;
     buffered -= p_block->i_buffer;
+    vlc_memstats_Add(VLC_MEMSTATS_ADAPTIVE, -(ssize_t)p_block->i_buffer);
 
     return p_block;
 }
@@ -468,8 +622,10 @@ block_t * HTTPChunkBufferedSource::read(size_t readsize)
 {
     vlc_mutex_locker locker(&lock);
 
+    waiting++;
     while(readsize > buffered && !done)
         vlc_cond_wait(&avail, &lock);
+    waiting--;
 
     block_t *p_block = NULL;
     if(!readsize || !buffered || !(p_block = block_Alloc(readsize)) )
@@ -486,6 +642,7 @@ block_t * HTTPChunkBufferedSource::read(size_t readsize)
         copied += toconsume;
         readsize -= toconsume;
         buffered -= toconsume;
+        vlc_memstats_Add(VLC_MEMSTATS_ADAPTIVE, -(ssize_t)toconsume);
         p_head->i_buffer -= toconsume;
         p_head->p_buffer += toconsume;
         if(p_head->i_buffer == 0)
@@ -41,6 +41,8 @@ namespace adaptive
         class AbstractConnection;
         class AbstractConnectionManager;
         class AbstractChunk;
+        class SegmentCache;
+        class SegmentCacheEntry;
 
         class AbstractChunkSource
         {
@@ -102,6 +104,7 @@ namespace adaptive
 
             protected:
                 virtual bool        prepare();
+                std::string         getCacheKey() const;
                 AbstractConnection    *connection;
                 AbstractConnectionManager *connManager;
                 mutable vlc_mutex_t lock;
@@ -118,6 +121,7 @@ namespace adaptive
         class HTTPChunkBufferedSource : public HTTPChunkSource
         {
             friend class Downloader;
+            friend class SegmentCache;
 
             public:
                 HTTPChunkBufferedSource(const std::string &url, AbstractConnectionManager *,
@@ -126,13 +130,21 @@ namespace adaptive
                 virtual block_t *  readBlock       (); /* reimpl */
                 virtual block_t *  read            (size_t); /* reimpl */
                 virtual bool       hasMoreData     () const; /* impl */
+                virtual std::string getContentType () const; /* reimpl */
                 void               hold();
                 void               release();
+                bool               isCacheable() const;
 
             protected:
                 virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                bool               isStarving() const;
+                /* fed by SegmentCache when another input downloads it */
+                void               feedStart(const std::string &);
+                void               feed(block_t *);
+                void               feedEnd();
+                void               resume();
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -141,8 +153,16 @@ namespace adaptive
                 bool                done;
                 bool                eof;
                 vlc_tick_t          downloadstart;
+                vlc_tick_t          downloadlatency; /* time to first byte */
                 vlc_cond_t          avail;
                 bool                held;
+                unsigned            waiting; /* readers waiting for data */
+                SegmentCache       *cache;
+                SegmentCacheEntry  *cacheentry; /* protected by the cache lock */
+                bool                cacheable;
+                bool                publishing;
+                std::string         cachedtype;
+                size_t              resumeoffset;
         };
 
         class HTTPChunk : public AbstractChunk
@@ -25,41 +25,45 @@
 
 #include <vlc_threads.h>
 
-#include <atomic>
+#include <algorithm>
 
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned maxthreads_)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&updatedcond);
     killed = false;
-    thread_handle_valid = false;
+    maxthreads = maxthreads_ ? maxthreads_ : 1;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(threads.size() < maxthreads)
     {
-        return false;
+        vlc_thread_t thread_handle;
+        if(vlc_clone(&thread_handle, downloaderThread,
+                     static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        threads.push_back(thread_handle);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    std::vector<vlc_thread_t>::const_iterator it;
+    for(it = threads.begin(); it != threads.end(); ++it)
+        vlc_join(*it, NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&updatedcond);
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
@@ -73,6 +77,9 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
+    /* wait for the slice being downloaded, if any */
+    while(isDownloading(source))
+        vlc_cond_wait(&updatedcond, &lock);
     source->release();
     chunks.remove(source);
     vlc_mutex_unlock(&lock);
@@ -93,27 +100,88 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
+bool Downloader::isDownloading(const HTTPChunkBufferedSource *source) const
+{
+    return std::find(current.begin(), current.end(), source) != current.end();
+}
+
+bool Downloader::isStreamDownloading(const ID &id) const
+{
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = current.begin(); it != current.end(); ++it)
+        if((*it)->sourceid == id)
+            return true;
+    return false;
+}
+
+HTTPChunkBufferedSource * Downloader::getNextSource() const
+{
+    HTTPChunkBufferedSource *next = NULL;
+    std::vector<ID> seen;
+
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
+    {
+        HTTPChunkBufferedSource *source = *it;
+        /* only the oldest source of each stream is a candidate */
+        if(std::find(seen.begin(), seen.end(), source->sourceid) != seen.end())
+            continue;
+        seen.push_back(source->sourceid);
+
+        if(isStreamDownloading(source->sourceid))
+            continue;
+
+        if(source->isStarving())
+            return source;
+        if(!next)
+            next = source;
+    }
+    return next;
+}
+
+void Downloader::rotate(const ID &id)
+{
+    /* move the stream behind the others, preserving the order of its sources */
+    std::list<HTTPChunkBufferedSource *> tail;
+    std::list<HTTPChunkBufferedSource *>::iterator it = chunks.begin();
+    while(it != chunks.end())
+    {
+        std::list<HTTPChunkBufferedSource *>::iterator cur = it++;
+        if((*cur)->sourceid == id)
+            tail.splice(tail.end(), chunks, cur);
+    }
+    chunks.splice(chunks.end(), tail);
+}
+
 void Downloader::Run()
 {
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source;
+        while(!killed && (source = getNextSource()) == NULL)
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        if(!chunks.empty())
+        current.push_back(source);
+        vlc_mutex_unlock(&lock);
+
+        DownloadSource(source);
+
+        vlc_mutex_lock(&lock);
+        current.remove(source);
+        if(source->isDone())
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-            {
-                chunks.pop_front();
-                source->release();
-            }
+            chunks.remove(source);
+            source->release();
         }
+        else rotate(source->sourceid);
+
+        /* the stream can be picked up again */
+        vlc_cond_signal(&waitcond);
+        vlc_cond_broadcast(&updatedcond);
     }
     vlc_mutex_unlock(&lock);
 }
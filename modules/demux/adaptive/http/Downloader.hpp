@@ -24,6 +24,7 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <vector>
 
 namespace adaptive
 {
@@ -31,10 +32,15 @@ namespace adaptive
     namespace http
     {
 
+        /* Downloads the queued sources over a pool of threads.
+         * A stream (sources sharing the same ID) has at most one source
+         * being downloaded at a time, so its chunks complete in order, and
+         * streams take turns when there are fewer threads than streams.
+         * Streams whose reader is blocked waiting for data go first. */
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
@@ -44,12 +50,18 @@ namespace adaptive
                 static void * downloaderThread(void *);
                 void Run();
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * getNextSource() const;
+                bool isDownloading(const HTTPChunkBufferedSource *) const;
+                bool isStreamDownloading(const ID &) const;
+                void rotate(const ID &);
+                std::vector<vlc_thread_t> threads;
+                unsigned     maxthreads;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                bool         thread_handle_valid;
+                vlc_cond_t   updatedcond;
                 bool         killed;
                 std::list<HTTPChunkBufferedSource *> chunks;
+                std::list<HTTPChunkBufferedSource *> current;
         };
 
     }
@@ -30,6 +30,15 @@
 #include <cstdio>
 #include <sstream>
 #include <vlc_stream.h>
+#include <vlc_block.h>
+
+extern "C"
+{
+    #include "../../../access/http/connmgr.h"
+    #include "../../../access/http/resource.h"
+    #include "../../../access/http/file.h"
+    #include "../../../access/http/message.h"
+}
 
 using namespace adaptive::http;
 
@@ -65,6 +74,16 @@ const std::string & AbstractConnection::getContentType() const
     return contentType;
 }
 
+bool AbstractConnection::getTransferStats(size_t *, vlc_tick_t *) const
+{
+    return false;
+}
+
+const ConnectionParams & AbstractConnection::getRedirection() const
+{
+    return locationparams;
+}
+
 HTTPConnection::HTTPConnection(vlc_object_t *p_object_, AuthStorage *auth,
                                Transport *socket_, const ConnectionParams &proxy, bool persistent)
     : AbstractConnection( p_object_ )
@@ -225,7 +244,7 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
     if(ret >= 0)
         bytesRead += ret;
 
-    if(ret < 0 || (size_t)ret < len || /* set EOF */
+    if(ret < 0 || (chunked ? chunked_eof : (size_t)ret < len) || /* set EOF */
        (contentLength == bytesRead && connectionClose))
     {
         transport->disconnect();
@@ -306,6 +325,11 @@ ssize_t HTTPConnection::readChunk(void *p_buffer, size_t len)
 
     for( ; copied < len && !chunked_eof; )
     {
+        /* Return at chunk boundaries, as the next chunk might only be sent
+         * once produced (low latency live) */
+        if(chunkLength == 0 && copied > 0)
+            break;
+
         /* adapted from access/http/chunked.c */
         if(chunkLength == 0)
         {
@@ -454,11 +478,6 @@ std::string HTTPConnection::extraRequestHeaders() const
     return ss.str();
 }
 
-const ConnectionParams & HTTPConnection::getRedirection() const
-{
-    return locationparams;
-}
-
 StreamUrlConnection::StreamUrlConnection(vlc_object_t *p_object)
     : AbstractConnection(p_object)
 {
@@ -570,6 +589,242 @@ void StreamUrlConnection::setUsed( bool b )
        reset();
 }
 
+LibVLCHTTPConnection::LibVLCHTTPConnection(vlc_object_t *p_object_,
+                                           struct vlc_http_mgr *mgr)
+    : AbstractConnection(p_object_)
+{
+    http_mgr = mgr;
+    resource = NULL;
+    p_block = NULL;
+    psz_useragent = var_InheritString(p_object_, "http-user-agent");
+    b_stats = false;
+    statsBytes = 0;
+    statsDuration = 0;
+}
+
+LibVLCHTTPConnection::~LibVLCHTTPConnection()
+{
+    reset();
+    free(psz_useragent);
+}
+
+void LibVLCHTTPConnection::reset()
+{
+    if(p_block)
+        block_Release(p_block);
+    p_block = NULL;
+    if(resource)
+        vlc_http_res_destroy(resource);
+    resource = NULL;
+    bytesRead = 0;
+    contentLength = 0;
+    contentType = std::string();
+    bytesRange = BytesRange();
+}
+
+bool LibVLCHTTPConnection::canReuse(const ConnectionParams &params_) const
+{
+    return available && !params_.usesAccess() &&
+           params_.getScheme() == params.getScheme() &&
+           params_.getHostname() == params.getHostname() &&
+           params_.getPort() == params.getPort();
+}
+
+enum RequestStatus LibVLCHTTPConnection::open(const BytesRange &range)
+{
+    resource = vlc_http_file_create(http_mgr, params.getUrl().c_str(),
+                                    psz_useragent, NULL);
+    if(!resource)
+        return RequestStatus::GenericError;
+
+    const uintmax_t offset = range.isValid() ? range.getStartByte() : 0;
+    if(range.isValid() && range.getEndByte() > 0)
+        vlc_http_file_set_end(resource, range.getEndByte());
+
+    if(offset > 0 && vlc_http_file_seek(resource, offset))
+        return RequestStatus::GenericError;
+
+    int status = vlc_http_res_get_status(resource);
+    if(status < 0)
+        return RequestStatus::GenericError;
+
+    char *psz_redirect = vlc_http_res_get_redirect(resource);
+    if(psz_redirect)
+    {
+        locationparams = ConnectionParams(psz_redirect);
+        free(psz_redirect);
+        return RequestStatus::Redirection;
+    }
+
+    if(status == 401)
+        return RequestStatus::Unauthorized;
+    else if(status == 404)
+        return RequestStatus::NotFound;
+    else if(status >= 300)
+        return RequestStatus::GenericError;
+
+    char *psz_type = vlc_http_res_get_type(resource);
+    if(psz_type)
+    {
+        contentType = std::string(psz_type);
+        free(psz_type);
+    }
+
+    uintmax_t i_size = vlc_http_file_get_size(resource);
+    if(i_size != (uintmax_t)-1 && i_size > offset)
+        contentLength = i_size - offset;
+
+    return RequestStatus::Success;
+}
+
+enum RequestStatus
+    LibVLCHTTPConnection::request(const std::string &path, const BytesRange &range)
+{
+    reset();
+    b_stats = false;
+
+    /* Set new path for this query */
+    params.setPath(path);
+
+    msg_Dbg(p_object, "Retrieving %s @%zu", params.getUrl().c_str(),
+                      range.isValid() ? range.getStartByte() : 0);
+
+    enum RequestStatus status = open(range);
+    if(status != RequestStatus::Success)
+    {
+        reset();
+        return status;
+    }
+
+    if(range.isValid() && range.getEndByte() > 0)
+    {
+        const size_t rangeLength = range.getEndByte() - range.getStartByte() + 1;
+        if(!contentLength || contentLength > rangeLength)
+            contentLength = rangeLength;
+        bytesRange = range;
+    }
+
+    return RequestStatus::Success;
+}
+
+ssize_t LibVLCHTTPConnection::read(void *p_buffer, size_t len)
+{
+    if( !resource )
+        return VLC_EGENERIC;
+
+    if(len == 0)
+        return VLC_SUCCESS;
+
+    const size_t toRead = (contentLength) ? contentLength - bytesRead : len;
+    if (toRead == 0)
+        return VLC_SUCCESS;
+
+    if(len > toRead)
+        len = toRead;
+
+    size_t copied = 0;
+    bool b_eof = false;
+    while(copied < len)
+    {
+        if(!p_block)
+        {
+            /* Don't wait for more data than what was received */
+            if(copied > 0)
+                break;
+            p_block = vlc_http_res_read(resource);
+            if(p_block == vlc_http_error)
+                p_block = NULL;
+
+            /* Keep the transport figures, as the resource is gone at EOF */
+            struct vlc_http_stream_stats stats;
+            b_stats = vlc_http_res_get_stats(resource, &stats) == 0;
+            if(b_stats)
+            {
+                statsBytes = stats.bytes;
+                statsDuration = stats.duration;
+            }
+
+            if(!p_block)
+            {
+                b_eof = true;
+                break;
+            }
+        }
+
+        const size_t toconsume = std::min(p_block->i_buffer, len - copied);
+        memcpy(&((uint8_t *)p_buffer)[copied], p_block->p_buffer, toconsume);
+        copied += toconsume;
+        p_block->p_buffer += toconsume;
+        p_block->i_buffer -= toconsume;
+        if(p_block->i_buffer == 0)
+        {
+            block_Release(p_block);
+            p_block = NULL;
+        }
+    }
+
+    bytesRead += copied;
+
+    if(b_eof || contentLength == bytesRead) /* set EOF */
+        reset();
+
+    return copied;
+}
+
+bool LibVLCHTTPConnection::getTransferStats(size_t *bytes, vlc_tick_t *duration) const
+{
+    if(!b_stats)
+        return false;
+    *bytes = statsBytes;
+    *duration = statsDuration;
+    return true;
+}
+
+void LibVLCHTTPConnection::setUsed( bool b )
+{
+    available = !b;
+    if(available)
+        reset(); /* the manager keeps the connection to the origin */
+}
+
+LibVLCHTTPConnectionFactory::LibVLCHTTPConnectionFactory( AuthStorage *auth )
+    : AbstractConnectionFactory()
+{
+    authStorage = auth;
+}
+
+LibVLCHTTPConnectionFactory::~LibVLCHTTPConnectionFactory()
+{
+    std::map<std::string, struct vlc_http_mgr *>::const_iterator it;
+    for(it = managers.begin(); it != managers.end(); ++it)
+        vlc_http_mgr_destroy((*it).second);
+}
+
+AbstractConnection * LibVLCHTTPConnectionFactory::createConnection(vlc_object_t *p_object,
+                                                                   const ConnectionParams &params)
+{
+    if(params.getScheme() != "https" || params.getHostname().empty())
+        return NULL;
+
+    std::ostringstream os;
+    os.imbue(std::locale("C"));
+    os << params.getHostname() << ':' << params.getPort();
+    const std::string origin = os.str();
+
+    struct vlc_http_mgr *mgr;
+    std::map<std::string, struct vlc_http_mgr *>::const_iterator it = managers.find(origin);
+    if(it == managers.end())
+    {
+        mgr = vlc_http_mgr_create(p_object, authStorage ? authStorage->getJar() : NULL);
+        if(!mgr)
+            return NULL;
+        managers[origin] = mgr;
+    }
+    else mgr = (*it).second;
+
+    return new (std::nothrow) LibVLCHTTPConnection(p_object, mgr);
+}
+
 NativeConnectionFactory::NativeConnectionFactory( AuthStorage *auth )
     : AbstractConnectionFactory()
 {
@@ -631,12 +886,14 @@ ConnectionFactory::ConnectionFactory( AuthStorage *authstorage )
 {
     native = new NativeConnectionFactory( authstorage );
     streamurl = new StreamUrlConnectionFactory();
+    libvlchttp = new LibVLCHTTPConnectionFactory( authstorage );
 }
 
 ConnectionFactory::~ConnectionFactory()
 {
     delete native;
     delete streamurl;
+    delete libvlchttp;
 }
 
 AbstractConnection * ConnectionFactory::createConnection(vlc_object_t *p_object,
@@ -645,6 +902,14 @@ AbstractConnection * ConnectionFactory::createConnection(vlc_object_t *p_object,
     bool b_streamurl = var_InheritBool(p_object, "adaptive-use-access");
     if(!b_streamurl && !params.usesAccess())
     {
+        /* HTTPS negotiates HTTP/2 if the server supports it */
+        if(params.getScheme() == "https" &&
+           var_InheritBool(p_object, "adaptive-use-h2"))
+        {
+            AbstractConnection *conn = libvlchttp->createConnection(p_object, params);
+            if(conn)
+                return conn;
+        }
         return native->createConnection(p_object, params);
     }
     else
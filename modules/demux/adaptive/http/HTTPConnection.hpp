@@ -28,8 +28,13 @@
 #include "ConnectionParams.hpp"
 #include "BytesRange.hpp"
 #include <vlc_common.h>
+#include <map>
 #include <string>
 
+struct vlc_http_mgr;
+struct vlc_http_resource;
+struct vlc_http_cookie_jar_t;
+
 namespace adaptive
 {
     namespace http
@@ -52,11 +57,15 @@ namespace adaptive
 
                 virtual size_t  getContentLength() const;
                 virtual const std::string & getContentType() const;
+                virtual bool    getTransferStats(size_t *, vlc_tick_t *) const;
                 virtual void    setUsed( bool ) = 0;
+                const ConnectionParams &getRedirection() const;
+                static const unsigned MAX_REDIRECTS = 3;
 
             protected:
                 vlc_object_t      *p_object;
                 ConnectionParams   params;
+                ConnectionParams   locationparams;
                 bool               available;
                 size_t             contentLength;
                 std::string        contentType;
@@ -77,8 +86,6 @@ namespace adaptive
                 virtual ssize_t read        (void *p_buffer, size_t len);
 
                 void setUsed( bool );
-                const ConnectionParams &getRedirection() const;
-                static const unsigned MAX_REDIRECTS = 3;
 
             protected:
                 virtual bool    connected   () const;
@@ -98,7 +105,6 @@ namespace adaptive
                 char * psz_useragent;
 
                 AuthStorage        *authStorage;
-                ConnectionParams    locationparams;
                 ConnectionParams    proxyparams;
                 bool                connectionClose;
                 bool                chunked;
@@ -131,6 +137,36 @@ namespace adaptive
                 stream_t *p_streamurl;
        };
 
+       /* Connection using the HTTP stack of the https module. The manager is
+        * shared by all the connections to a same origin, so that their
+        * requests are multiplexed on a single HTTP/2 connection */
+       class LibVLCHTTPConnection : public AbstractConnection
+       {
+            public:
+                LibVLCHTTPConnection(vlc_object_t *, struct vlc_http_mgr *);
+                virtual ~LibVLCHTTPConnection();
+
+                virtual bool    canReuse     (const ConnectionParams &) const;
+
+                virtual enum RequestStatus
+                                request     (const std::string& path, const BytesRange & = BytesRange());
+                virtual ssize_t read        (void *p_buffer, size_t len);
+                virtual bool    getTransferStats(size_t *, vlc_tick_t *) const;
+
+                virtual void    setUsed( bool );
+
+            protected:
+                void reset();
+                enum RequestStatus open(const BytesRange &);
+                struct vlc_http_mgr *http_mgr;
+                struct vlc_http_resource *resource;
+                block_t *p_block; /* pending data */
+                char *psz_useragent;
+                bool b_stats; /* transport measured the transfer */
+                size_t statsBytes;
+                vlc_tick_t statsDuration;
+       };
+
        class AbstractConnectionFactory
        {
            public:
@@ -157,6 +193,18 @@ namespace adaptive
                virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
        };
 
+       class LibVLCHTTPConnectionFactory : public AbstractConnectionFactory
+       {
+           public:
+               LibVLCHTTPConnectionFactory( AuthStorage * );
+               virtual ~LibVLCHTTPConnectionFactory();
+               virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
+           private:
+               AuthStorage *authStorage;
+               /* one manager per origin, outliving the connections */
+               std::map<std::string, struct vlc_http_mgr *> managers;
+       };
+
        class ConnectionFactory : public AbstractConnectionFactory
        {
            public:
@@ -166,6 +214,7 @@ namespace adaptive
            private:
                NativeConnectionFactory *native;
                StreamUrlConnectionFactory *streamurl;
+               LibVLCHTTPConnectionFactory *libvlchttp;
        };
     }
 }
@@ -30,9 +30,12 @@
 #include "ConnectionParams.hpp"
 #include "Transport.hpp"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 #include <vlc_url.h>
 #include <vlc_http.h>
 
+#include <cassert>
+
 using namespace adaptive::http;
 
 AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
@@ -40,17 +43,51 @@ AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
 {
     p_object = p_object_;
     rateObserver = NULL;
+    vlc_mutex_init(&prefetch_lock);
+    int64_t max = var_InheritInteger(p_object, "adaptive-prefetch");
+    prefetch_max = (max > 0) ? max : 0;
+    int64_t budget = var_InheritInteger(p_object, "adaptive-prefetch-budget");
+    prefetch_budget = (budget > 0) ? budget * 1024 : 0;
+    prefetch_used = 0;
 }
 
 AbstractConnectionManager::~AbstractConnectionManager()
 {
+    assert(prefetch_used == 0);
+    vlc_mutex_destroy(&prefetch_lock);
+}
+
+unsigned AbstractConnectionManager::getMaxPrefetch() const
+{
+    return prefetch_max;
+}
+
+bool AbstractConnectionManager::reservePrefetch(size_t size)
+{
+    bool b_ret = false;
+    vlc_mutex_lock(&prefetch_lock);
+    if(size <= prefetch_budget - prefetch_used)
+    {
+        prefetch_used += size;
+        b_ret = true;
+    }
+    vlc_mutex_unlock(&prefetch_lock);
+    return b_ret;
+}
 
+void AbstractConnectionManager::releasePrefetch(size_t size)
+{
+    vlc_mutex_lock(&prefetch_lock);
+    assert(prefetch_used >= size);
+    prefetch_used -= size;
+    vlc_mutex_unlock(&prefetch_lock);
 }
 
-void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid, size_t size, vlc_tick_t time)
+void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid, size_t size,
+                                                   vlc_tick_t time, vlc_tick_t latency)
 {
     if(rateObserver)
-        rateObserver->updateDownloadRate(sourceid, size, time);
+        rateObserver->updateDownloadRate(sourceid, size, time, latency);
 }
 
 void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *obs)
@@ -62,8 +99,10 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Abstra
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    segmentCache = SegmentCache::hold(p_object);
+    downloader = new (std::nothrow) Downloader(getDownloadersCount());
+    if(downloader)
+        downloader->start();
     factory = factory_;
 }
 
@@ -71,19 +110,29 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AuthSt
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    segmentCache = SegmentCache::hold(p_object);
+    downloader = new (std::nothrow) Downloader(getDownloadersCount());
+    if(downloader)
+        downloader->start();
     factory = new ConnectionFactory(storage);
 }
 
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
     delete downloader;
-    delete factory;
     this->closeAllConnections();
+    delete factory;
+    if(segmentCache)
+        segmentCache->release();
     vlc_mutex_destroy(&lock);
 }
 
+unsigned HTTPConnectionManager::getDownloadersCount() const
+{
+    int64_t count = var_InheritInteger(p_object, "adaptive-downloaders");
+    return (count > 0) ? count : 1;
+}
+
 void HTTPConnectionManager::closeAllConnections      ()
 {
     vlc_mutex_lock(&lock);
@@ -144,8 +193,13 @@ AbstractConnection * HTTPConnectionManager::getConnection(ConnectionParams &para
 void HTTPConnectionManager::start(AbstractChunkSource *source)
 {
     HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
-    if(src)
-        downloader->schedule(src);
+    if(!src)
+        return;
+
+    /* another input may already download it for us */
+    if(segmentCache && src->isCacheable() && segmentCache->attach(src))
+        return;
+    downloader->schedule(src);
 }
 
 void HTTPConnectionManager::cancel(AbstractChunkSource *source)
@@ -42,6 +42,7 @@ namespace adaptive
         class AuthStorage;
         class Downloader;
         class AbstractChunkSource;
+        class SegmentCache;
 
         class AbstractConnectionManager : public IDownloadRateObserver
         {
@@ -53,14 +54,23 @@ namespace adaptive
                 virtual void start(AbstractChunkSource *) = 0;
                 virtual void cancel(AbstractChunkSource *) = 0;
 
-                virtual void updateDownloadRate(const ID &, size_t, vlc_tick_t); /* impl */
+                virtual void updateDownloadRate(const ID &, size_t, vlc_tick_t, vlc_tick_t); /* impl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
 
+                /* Segments lookahead, with a byte budget shared by all streams */
+                unsigned getMaxPrefetch() const;
+                bool reservePrefetch(size_t);
+                void releasePrefetch(size_t);
+
             protected:
                 vlc_object_t                                       *p_object;
 
             private:
                 IDownloadRateObserver                              *rateObserver;
+                vlc_mutex_t                                         prefetch_lock;
+                unsigned                                            prefetch_max;
+                size_t                                              prefetch_budget;
+                size_t                                              prefetch_used;
         };
 
         class HTTPConnectionManager : public AbstractConnectionManager
@@ -78,7 +88,9 @@ namespace adaptive
 
             private:
                 void    releaseAllConnections ();
+                unsigned getDownloadersCount() const;
                 Downloader                                         *downloader;
+                SegmentCache                                       *segmentCache;
                 vlc_mutex_t                                         lock;
                 std::vector<AbstractConnection *>                   connectionPool;
                 AbstractConnectionFactory                          *factory;
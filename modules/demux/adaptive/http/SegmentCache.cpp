@@ -0,0 +1,318 @@
+/*
+ * SegmentCache.cpp
+ *****************************************************************************
+ * Copyright (C) 2019 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SegmentCache.hpp"
+#include "Chunk.h"
+
+#include <vlc_block.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace adaptive
+{
+    namespace http
+    {
+        class SegmentCacheEntry
+        {
+            public:
+                SegmentCacheEntry(const std::string &key_, HTTPChunkBufferedSource *producer_)
+                    : key(key_), producer(producer_)
+                {
+                    p_data = NULL;
+                    pp_tail = &p_data;
+                    size = 0;
+                    complete = false;
+                    overflow = false;
+                }
+
+                ~SegmentCacheEntry()
+                {
+                    if(p_data)
+                        block_ChainRelease(p_data);
+                }
+
+                std::string key;
+                std::string contentType;
+                HTTPChunkBufferedSource *producer; /* NULL once complete */
+                std::list<HTTPChunkBufferedSource *> followers;
+                block_t *p_data;
+                block_t **pp_tail;
+                size_t size;
+                bool complete;
+                bool overflow; /* too large to be kept, only fed to current followers */
+        };
+    }
+}
+
+using namespace adaptive::http;
+
+vlc_mutex_t SegmentCache::instance_lock = VLC_STATIC_MUTEX;
+SegmentCache * SegmentCache::instance = NULL;
+
+SegmentCache::SegmentCache(size_t maxsize_)
+{
+    vlc_mutex_init(&lock);
+    refs = 0;
+    maxsize = maxsize_;
+    cachedsize = 0;
+}
+
+SegmentCache::~SegmentCache()
+{
+    std::list<SegmentCacheEntry *>::const_iterator it;
+    for(it = entries.begin(); it != entries.end(); ++it)
+    {
+        /* sources detach before their connection manager releases us */
+        assert((*it)->complete);
+        delete *it;
+    }
+    vlc_mutex_destroy(&lock);
+}
+
+SegmentCache * SegmentCache::hold(vlc_object_t *obj)
+{
+    vlc_mutex_locker locker(&instance_lock);
+    if(instance == NULL)
+    {
+        int64_t size = var_InheritInteger(obj, "adaptive-cache-size");
+        if(size <= 0)
+            return NULL;
+        instance = new (std::nothrow) SegmentCache(size * 1024);
+        if(instance == NULL)
+            return NULL;
+    }
+
+    vlc_mutex_lock(&instance->lock);
+    instance->refs++;
+    vlc_mutex_unlock(&instance->lock);
+    return instance;
+}
+
+void SegmentCache::release()
+{
+    vlc_mutex_locker locker(&instance_lock);
+    vlc_mutex_lock(&lock);
+    assert(refs > 0);
+    bool b_last = (--refs == 0);
+    vlc_mutex_unlock(&lock);
+    if(b_last)
+    {
+        assert(instance == this);
+        instance = NULL;
+        delete this;
+    }
+}
+
+SegmentCacheEntry * SegmentCache::find(const std::string &key) const
+{
+    std::list<SegmentCacheEntry *>::const_iterator it;
+    for(it = entries.begin(); it != entries.end(); ++it)
+    {
+        if((*it)->key == key)
+            return *it;
+    }
+    return NULL;
+}
+
+bool SegmentCache::attach(HTTPChunkBufferedSource *source)
+{
+    const std::string key = source->getCacheKey();
+    if(key.empty())
+        return false;
+
+    vlc_mutex_locker locker(&lock);
+
+    SegmentCacheEntry *entry = find(key);
+    if(entry && !entry->overflow)
+    {
+        entries.remove(entry);
+        entries.push_front(entry);
+
+        source->cache = this;
+        source->feedStart(entry->contentType);
+        for(const block_t *p_block = entry->p_data; p_block; p_block = p_block->p_next)
+        {
+            block_t *p_dup = block_Duplicate(p_block);
+            if(p_dup)
+                source->feed(p_dup);
+        }
+
+        if(entry->complete)
+        {
+            source->feedEnd();
+        }
+        else
+        {
+            source->cacheentry = entry;
+            entry->followers.push_back(source);
+        }
+        return true;
+    }
+
+    /* Nobody else would reuse the data */
+    if(entry || refs < 2)
+        return false;
+
+    entry = new (std::nothrow) SegmentCacheEntry(key, source);
+    if(entry)
+    {
+        entries.push_front(entry);
+        source->cache = this;
+        source->cacheentry = entry;
+        source->publishing = true;
+    }
+    return false;
+}
+
+void SegmentCache::detach(HTTPChunkBufferedSource *source)
+{
+    vlc_mutex_locker locker(&lock);
+
+    SegmentCacheEntry *entry = source->cacheentry;
+    if(entry == NULL)
+        return;
+    source->cacheentry = NULL;
+
+    if(entry->producer == source)
+        abandon(entry);
+    else
+        entry->followers.remove(source);
+}
+
+void SegmentCache::publish(HTTPChunkBufferedSource *source, block_t *p_block)
+{
+    vlc_mutex_locker locker(&lock);
+
+    SegmentCacheEntry *entry = source->cacheentry;
+    if(entry == NULL || entry->producer != source)
+    {
+        block_Release(p_block);
+        return;
+    }
+
+    if(entry->contentType.empty())
+    {
+        entry->contentType = source->getContentType();
+        std::list<HTTPChunkBufferedSource *>::const_iterator it;
+        for(it = entry->followers.begin(); it != entry->followers.end(); ++it)
+            (*it)->feedStart(entry->contentType);
+    }
+
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = entry->followers.begin(); it != entry->followers.end(); ++it)
+    {
+        block_t *p_dup = block_Duplicate(p_block);
+        if(p_dup)
+            (*it)->feed(p_dup);
+    }
+
+    if(!entry->overflow && entry->size + p_block->i_buffer > maxsize)
+    {
+        entry->overflow = true;
+        cachedsize -= entry->size;
+        entry->size = 0;
+        if(entry->p_data)
+            block_ChainRelease(entry->p_data);
+        entry->p_data = NULL;
+        entry->pp_tail = &entry->p_data;
+    }
+
+    if(entry->overflow)
+    {
+        block_Release(p_block);
+        return;
+    }
+
+    entry->size += p_block->i_buffer;
+    cachedsize += p_block->i_buffer;
+    block_ChainLastAppend(&entry->pp_tail, p_block);
+    evict();
+}
+
+void SegmentCache::finish(HTTPChunkBufferedSource *source, bool b_complete)
+{
+    vlc_mutex_locker locker(&lock);
+
+    SegmentCacheEntry *entry = source->cacheentry;
+    if(entry == NULL || entry->producer != source)
+        return;
+    source->cacheentry = NULL;
+
+    if(!b_complete)
+    {
+        abandon(entry);
+        return;
+    }
+
+    entry->producer = NULL;
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = entry->followers.begin(); it != entry->followers.end(); ++it)
+    {
+        (*it)->cacheentry = NULL;
+        (*it)->feedEnd();
+    }
+    entry->followers.clear();
+
+    if(entry->overflow)
+    {
+        entries.remove(entry);
+        delete entry;
+    }
+    else
+    {
+        entry->complete = true;
+        evict();
+    }
+}
+
+void SegmentCache::abandon(SegmentCacheEntry *entry)
+{
+    /* The producer failed or went away: the followers download the
+     * remaining data by themselves */
+    entries.remove(entry);
+    cachedsize -= entry->size;
+
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = entry->followers.begin(); it != entry->followers.end(); ++it)
+    {
+        (*it)->cacheentry = NULL;
+        (*it)->resume();
+    }
+    delete entry;
+}
+
+void SegmentCache::evict()
+{
+    std::list<SegmentCacheEntry *>::iterator it = entries.end();
+    while(cachedsize > maxsize && it != entries.begin())
+    {
+        --it;
+        SegmentCacheEntry *entry = *it;
+        if(!entry->complete)
+            continue;
+        cachedsize -= entry->size;
+        it = entries.erase(it);
+        delete entry;
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * SegmentCache.hpp
+ *****************************************************************************
+ * Copyright (C) 2019 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef SEGMENTCACHE_HPP
+#define SEGMENTCACHE_HPP
+
+#include <vlc_common.h>
+#include <list>
+#include <string>
+
+namespace adaptive
+{
+
+    namespace http
+    {
+        class HTTPChunkBufferedSource;
+        class SegmentCacheEntry;
+
+        /* Process wide cache of the downloaded segments, keyed by URL and
+         * byte range, so that concurrent inputs of a same manifest download
+         * each segment once. A source whose segment is cached, or is being
+         * downloaded by another input, is fed with copies of that data
+         * instead of requesting it.
+         * Data is only retained while more than one connection manager holds
+         * the cache, and complete segments are evicted, least recently used
+         * first, when the size limit is reached. */
+        class SegmentCache
+        {
+            public:
+                static SegmentCache * hold(vlc_object_t *);
+                void release();
+
+                /* Returns true if the source is fed by the cache. Otherwise,
+                 * the source downloads and may become the producer of its
+                 * segment for the other inputs. */
+                bool attach(HTTPChunkBufferedSource *);
+                void detach(HTTPChunkBufferedSource *);
+                /* producer side, the cache takes ownership of the block */
+                void publish(HTTPChunkBufferedSource *, block_t *);
+                void finish(HTTPChunkBufferedSource *, bool);
+
+            private:
+                SegmentCache(size_t);
+                ~SegmentCache();
+                SegmentCacheEntry * find(const std::string &) const;
+                void abandon(SegmentCacheEntry *);
+                void evict();
+
+                static vlc_mutex_t instance_lock;
+                static SegmentCache *instance;
+
+                vlc_mutex_t lock;
+                unsigned refs;
+                size_t maxsize;
+                size_t cachedsize;
+                std::list<SegmentCacheEntry *> entries; /* most recently used first */
+        };
+
+    }
+
+}
+
+#endif // SEGMENTCACHE_HPP
@@ -0,0 +1,309 @@
+/*
+ * HybridAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2019 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "HybridAdaptationLogic.hpp"
+#include "Representationselectors.hpp"
+
+#include "../playlist/BaseAdaptationSet.h"
+#include "../playlist/BaseRepresentation.h"
+#include "../SegmentTracker.hpp"
+#include "../tools/Debug.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace adaptive::logic;
+using namespace adaptive;
+
+/*
+ * Throughput rule while the buffer is low, BOLA once it is comfortable
+ * (as BOLA-O in "From Theory to Practice: Improving Bitrate Adaptation
+ * in the DASH Reference Player").
+ *
+ * Unlike the other logics, the request latency (time to first byte) is
+ * kept apart from the transfer time: the throughput estimate only covers
+ * the transfer, and the latency is charged once per segment. This avoids
+ * underestimating the link with short segments on high latency networks.
+ */
+
+#define bolaMinBufferS     VLC_TICK_FROM_SEC(6)   /* Qmin, leave BOLA below */
+#define bolaEnterBufferS   VLC_TICK_FROM_SEC(12)  /* enter BOLA above */
+#define defaultSegmentS    VLC_TICK_FROM_SEC(4)
+#define throughputSafety   0.9
+#define fastAlpha          0.5
+#define slowAlpha          0.125
+#define latencyAlpha       0.25
+
+HybridContext::HybridContext()
+    : buffering_level( 0 )
+    , buffering_target( 0 )
+    , segment_duration( 0 )
+    , fast_bps( 0 )
+    , slow_bps( 0 )
+    , latency( 0 )
+    , bola( false )
+{ }
+
+HybridAdaptationLogic::HybridAdaptationLogic(vlc_object_t *p_obj_)
+    : AbstractAdaptationLogic()
+    , currentBps( 0 )
+    , usedBps( 0 )
+    , p_obj( p_obj_ )
+{
+    vlc_mutex_init(&lock);
+}
+
+HybridAdaptationLogic::~HybridAdaptationLogic()
+{
+    vlc_mutex_destroy(&lock);
+}
+
+BaseRepresentation *
+HybridAdaptationLogic::getThroughputRepresentation(BaseAdaptationSet *adaptSet,
+                                                   RepresentationSelector &selector,
+                                                   const HybridContext &ctx,
+                                                   unsigned bps) const
+{
+    const vlc_tick_t duration = ctx.segment_duration ? ctx.segment_duration
+                                                     : defaultSegmentS;
+    /* Segment must be fetched, latency included, within the safety margin */
+    const double budget = throughputSafety * duration - ctx.latency;
+    if(budget <= 0)
+        return selector.lowest(adaptSet);
+    return selector.select(adaptSet, (uint64_t)(bps * budget / duration));
+}
+
+BaseRepresentation *
+HybridAdaptationLogic::getBufferRepresentation(BaseAdaptationSet *adaptSet,
+                                               RepresentationSelector &selector,
+                                               const HybridContext &ctx) const
+{
+    BaseRepresentation *lowest = selector.lowest(adaptSet);
+    BaseRepresentation *highest = selector.highest(adaptSet);
+    if(!lowest || !highest || lowest->getBandwidth() == 0)
+        return lowest;
+
+    /* utilities are ln(S/Smin) + 1 */
+    const double lnmin = std::log((double)lowest->getBandwidth());
+    const double umax = std::log((double)highest->getBandwidth()) - lnmin + 1.0;
+    const double target = secf_from_vlc_tick(std::max(ctx.buffering_target, 2 * bolaMinBufferS));
+    const double qmin = secf_from_vlc_tick(bolaMinBufferS);
+    const double gp = (umax - 1.0) / (target / qmin - 1.0);
+    const double Vp = qmin / gp;
+    const double Q = secf_from_vlc_tick(ctx.buffering_level);
+
+    BaseRepresentation *ret = NULL;
+    BaseRepresentation *prev = NULL;
+    double argmax = 0;
+    for(BaseRepresentation *rep = lowest;
+                            rep && rep != prev; rep = selector.higher(adaptSet, rep))
+    {
+        const double u = std::log((double)rep->getBandwidth()) - lnmin + 1.0;
+        const double arg = (Vp * (u + gp) - Q) / rep->getBandwidth();
+        if(ret == NULL || argmax <= arg)
+        {
+            ret = rep;
+            argmax = arg;
+        }
+        prev = rep;
+    }
+    return ret;
+}
+
+BaseRepresentation *HybridAdaptationLogic::getNextRepresentation(BaseAdaptationSet *adaptSet, BaseRepresentation *prevRep)
+{
+    RepresentationSelector selector(maxwidth, maxheight);
+
+    vlc_mutex_lock(&lock);
+
+    std::map<ID, HybridContext>::iterator it = streams.find(adaptSet->getID());
+    if(it == streams.end())
+    {
+        vlc_mutex_unlock(&lock);
+        return selector.lowest(adaptSet);
+    }
+
+    HybridContext &ctx = (*it).second;
+    if(ctx.bola && ctx.buffering_level < bolaMinBufferS)
+        ctx.bola = false;
+    else if(!ctx.bola && ctx.buffering_level >= bolaEnterBufferS)
+        ctx.bola = true;
+    HybridContext ctxcopy = ctx;
+
+    const unsigned bps = getAvailableBw(currentBps, prevRep);
+
+    vlc_mutex_unlock(&lock);
+
+    BaseRepresentation *m = getThroughputRepresentation(adaptSet, selector, ctxcopy, bps);
+    if(ctxcopy.bola && prevRep && m)
+    {
+        BaseRepresentation *b = getBufferRepresentation(adaptSet, selector, ctxcopy);
+        /* don't let buffer based decisions overshoot the network */
+        if(b && b->getBandwidth() > m->getBandwidth())
+        {
+            if(b->getBandwidth() > prevRep->getBandwidth())
+                b = (prevRep->getBandwidth() > m->getBandwidth()) ? prevRep : m;
+            /* nor drain the buffer below Qmin while fetching it */
+            const vlc_tick_t duration = ctxcopy.segment_duration ? ctxcopy.segment_duration
+                                                                 : defaultSegmentS;
+            const double fetch = ctxcopy.latency +
+                    (bps ? (double) b->getBandwidth() * duration / bps : INFINITY);
+            if(fetch > ctxcopy.buffering_level - bolaMinBufferS)
+                b = m;
+        }
+        if(b)
+            m = b;
+    }
+
+    BwDebug( msg_Info(p_obj, "%s buffering %.2fs latency %.0fms rep %" PRIu64 " kBps %u kBps",
+                      ctxcopy.bola ? "bola" : "throughput",
+                      secf_from_vlc_tick(ctxcopy.buffering_level),
+                      ctxcopy.latency / (CLOCK_FREQ / 1000),
+                      m ? m->getBandwidth() / 8000 : 0, bps / 8000); );
+
+    return m;
+}
+
+unsigned HybridAdaptationLogic::getAvailableBw(unsigned i_bw, const BaseRepresentation *curRep) const
+{
+    unsigned i_remain = i_bw;
+    if(i_remain > usedBps)
+        i_remain -= usedBps;
+    else
+        i_remain = 0;
+    if(curRep)
+        i_remain += curRep->getBandwidth();
+    return i_remain > i_bw ? i_bw : i_remain;
+}
+
+unsigned HybridAdaptationLogic::getMaxCurrentBw() const
+{
+    unsigned i_max_bitrate = 0;
+    for(std::map<ID, HybridContext>::const_iterator it = streams.begin();
+                                                    it != streams.end(); ++it)
+    {
+        const HybridContext &ctx = (*it).second;
+        i_max_bitrate = std::max(i_max_bitrate,
+                                 (unsigned) std::min(ctx.fast_bps, ctx.slow_bps));
+    }
+    return i_max_bitrate;
+}
+
+void HybridAdaptationLogic::updateDownloadRate(const ID &id, size_t dlsize,
+                                               vlc_tick_t time, vlc_tick_t latency)
+{
+    if(unlikely(time <= 0))
+        return;
+
+    /* latency is within time, a missing or bogus one counts as transfer */
+    vlc_tick_t transfer = time - latency;
+    if(latency < 0 || transfer <= 0)
+    {
+        transfer = time;
+        latency = 0;
+    }
+
+    const double bps = (double) CLOCK_FREQ * dlsize * 8 / transfer;
+
+    vlc_mutex_lock(&lock);
+    std::map<ID, HybridContext>::iterator it = streams.find(id);
+    if(it != streams.end())
+    {
+        HybridContext &ctx = (*it).second;
+        if(ctx.slow_bps == 0)
+        {
+            ctx.fast_bps = ctx.slow_bps = bps;
+            ctx.latency = latency;
+        }
+        else
+        {
+            ctx.fast_bps = fastAlpha * bps + (1.0 - fastAlpha) * ctx.fast_bps;
+            ctx.slow_bps = slowAlpha * bps + (1.0 - slowAlpha) * ctx.slow_bps;
+            ctx.latency = latencyAlpha * latency + (1.0 - latencyAlpha) * ctx.latency;
+        }
+    }
+    currentBps = getMaxCurrentBw();
+    vlc_mutex_unlock(&lock);
+}
+
+void HybridAdaptationLogic::trackerEvent(const SegmentTrackerEvent &event)
+{
+    switch(event.type)
+    {
+    case SegmentTrackerEvent::SWITCHING:
+        {
+            vlc_mutex_lock(&lock);
+            if(event.u.switching.prev)
+                usedBps -= event.u.switching.prev->getBandwidth();
+            if(event.u.switching.next)
+                usedBps += event.u.switching.next->getBandwidth();
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case SegmentTrackerEvent::BUFFERING_STATE:
+        {
+            const ID &id = *event.u.buffering.id;
+            vlc_mutex_lock(&lock);
+            if(event.u.buffering.enabled)
+            {
+                if(streams.find(id) == streams.end())
+                    streams.insert(std::pair<ID, HybridContext>(id, HybridContext()));
+            }
+            else
+            {
+                std::map<ID, HybridContext>::iterator it = streams.find(id);
+                if(it != streams.end())
+                    streams.erase(it);
+            }
+            currentBps = getMaxCurrentBw();
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+        {
+            const ID &id = *event.u.buffering_level.id;
+            vlc_mutex_lock(&lock);
+            HybridContext &ctx = streams[id];
+            ctx.buffering_level = event.u.buffering_level.current;
+            ctx.buffering_target = event.u.buffering_level.target;
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case SegmentTrackerEvent::SEGMENT_CHANGE:
+        {
+            const ID &id = *event.u.segment.id;
+            vlc_mutex_lock(&lock);
+            std::map<ID, HybridContext>::iterator it = streams.find(id);
+            if(it != streams.end() && event.u.segment.duration > 0)
+                (*it).second.segment_duration = event.u.segment.duration;
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    default:
+            break;
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * HybridAdaptationLogic.hpp
+ *****************************************************************************
+ * Copyright (C) 2019 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef HYBRIDADAPTATIONLOGIC_HPP
+#define HYBRIDADAPTATIONLOGIC_HPP
+
+#include "AbstractAdaptationLogic.h"
+#include "Representationselectors.hpp"
+#include <map>
+
+namespace adaptive
+{
+    namespace logic
+    {
+        class HybridContext
+        {
+            friend class HybridAdaptationLogic;
+
+            public:
+                HybridContext();
+
+            private:
+                vlc_tick_t buffering_level;
+                vlc_tick_t buffering_target;
+                vlc_tick_t segment_duration;
+                double     fast_bps;  /* throughput, excluding latency */
+                double     slow_bps;
+                double     latency;
+                bool       bola;      /* buffer based mode */
+        };
+
+        class HybridAdaptationLogic : public AbstractAdaptationLogic
+        {
+            public:
+                HybridAdaptationLogic(vlc_object_t *);
+                virtual ~HybridAdaptationLogic();
+
+                virtual BaseRepresentation* getNextRepresentation(BaseAdaptationSet *, BaseRepresentation *);
+                virtual void                updateDownloadRate     (const ID &, size_t, vlc_tick_t, vlc_tick_t); /* reimpl */
+                virtual void                trackerEvent           (const SegmentTrackerEvent &); /* reimpl */
+
+            private:
+                BaseRepresentation *        getThroughputRepresentation(BaseAdaptationSet *, RepresentationSelector &,
+                                                                        const HybridContext &, unsigned) const;
+                BaseRepresentation *        getBufferRepresentation(BaseAdaptationSet *, RepresentationSelector &,
+                                                                    const HybridContext &) const;
+                unsigned                    getAvailableBw(unsigned, const BaseRepresentation *) const;
+                unsigned                    getMaxCurrentBw() const;
+                std::map<adaptive::ID, HybridContext> streams;
+                unsigned                    currentBps;
+                unsigned                    usedBps;
+                vlc_object_t *              p_obj;
+                vlc_mutex_t                 lock;
+        };
+    }
+}
+
+#endif // HYBRIDADAPTATIONLOGIC_HPP
@@ -34,7 +34,16 @@ namespace adaptive
     class IDownloadRateObserver
     {
         public:
-            virtual void updateDownloadRate(const ID &, size_t, vlc_tick_t) = 0;
+            /**
+             * Reports a completed download
+             *
+             * @param size downloaded bytes
+             * @param time duration from the request to the last byte
+             * @param latency part of that duration spent waiting for the
+             *                response (time to first byte)
+             */
+            virtual void updateDownloadRate(const ID &, size_t size,
+                                            vlc_tick_t time, vlc_tick_t latency) = 0;
             virtual ~IDownloadRateObserver(){}
     };
 }
@@ -0,0 +1,320 @@
+/*
+ * logic_test.cpp: adaptation logics simulator
+ *****************************************************************************
+ * Copyright (C) 2019 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Replays bandwidth traces against the adaptation logics and reports their
+ * rebuffering ratio and average bitrate.
+ *
+ * Usage: adaptive_logic_test [trace [latency_ms [segment_ms]]]
+ * where each line of the trace file is "<duration ms> <bandwidth kbps>".
+ * Without arguments, a set of synthetic traces is checked.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+
+#include <vlc_common.h>
+
+#include "AbstractAdaptationLogic.h"
+#include "RateBasedAdaptationLogic.h"
+#include "PredictiveAdaptationLogic.hpp"
+#include "NearOptimalAdaptationLogic.hpp"
+#include "HybridAdaptationLogic.hpp"
+#include "../playlist/AbstractPlaylist.hpp"
+#include "../playlist/BasePeriod.h"
+#include "../playlist/BaseAdaptationSet.h"
+#include "../playlist/BaseRepresentation.h"
+#include "../SegmentTracker.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+using namespace adaptive;
+using namespace adaptive::logic;
+using namespace adaptive::playlist;
+
+const char vlc_module_name[] = "adaptive_logic_test";
+
+#define SIM_DURATION    VLC_TICK_FROM_SEC(600)
+#define SIM_BUFFER_MIN  VLC_TICK_FROM_SEC(6)
+#define SIM_BUFFER_MAX  VLC_TICK_FROM_SEC(30)
+
+class TestPlaylist : public AbstractPlaylist
+{
+    public:
+        TestPlaylist() : AbstractPlaylist(NULL) {}
+        virtual bool isLive() const { return false; }
+        virtual void debug() {}
+};
+
+struct TracePoint
+{
+    vlc_tick_t duration;
+    uint64_t   bps;
+};
+
+class Trace
+{
+    public:
+        Trace(const char *name_, vlc_tick_t latency_, vlc_tick_t segment_)
+            : name(name_), latency(latency_), segment(segment_) {}
+
+        void add(unsigned ms, unsigned kbps)
+        {
+            TracePoint p = { VLC_TICK_FROM_MS(ms), (uint64_t) kbps * 1000 };
+            points.push_back(p);
+        }
+
+        /* time to receive size bytes from now, the trace loops */
+        vlc_tick_t transfer(vlc_tick_t now, size_t size) const
+        {
+            vlc_tick_t period = 0;
+            for(size_t i=0; i<points.size(); i++)
+                period += points[i].duration;
+
+            vlc_tick_t t = now % period;
+            size_t i = 0;
+            while(t >= points[i].duration)
+                t -= points[i++].duration;
+
+            double bits = (double) size * 8;
+            vlc_tick_t elapsed = 0;
+            for(;;)
+            {
+                const TracePoint &p = points[i];
+                const vlc_tick_t left = p.duration - t;
+                const double capacity = (double) p.bps * left / CLOCK_FREQ;
+                if(p.bps && capacity >= bits)
+                    return elapsed + bits * CLOCK_FREQ / p.bps;
+                bits -= capacity;
+                elapsed += left;
+                t = 0;
+                i = (i + 1) % points.size();
+            }
+        }
+
+        const char *name;
+        vlc_tick_t latency;
+        vlc_tick_t segment;
+        std::vector<TracePoint> points;
+};
+
+struct Result
+{
+    double rebuffer_ratio;
+    uint64_t average_bps;
+    unsigned switches;
+};
+
+static Result Simulate(AbstractAdaptationLogic *logic, BaseAdaptationSet *set,
+                       const Trace &trace)
+{
+    const ID &id = set->getID();
+    vlc_tick_t now = 0;
+    vlc_tick_t buffer = 0;
+    vlc_tick_t played = 0;
+    vlc_tick_t stalled = 0;
+    double bits = 0;
+    unsigned segments = 0;
+    unsigned switches = 0;
+    BaseRepresentation *rep = NULL;
+
+    logic->trackerEvent(SegmentTrackerEvent(id, true));
+
+    while(played + buffer < SIM_DURATION)
+    {
+        BaseRepresentation *next = logic->getNextRepresentation(set, rep);
+        assert(next);
+        if(next != rep)
+        {
+            logic->trackerEvent(SegmentTrackerEvent(rep, next));
+            if(rep)
+                switches++;
+            rep = next;
+        }
+        logic->trackerEvent(SegmentTrackerEvent(id, trace.segment));
+
+        const size_t size = rep->getBandwidth() * trace.segment / CLOCK_FREQ / 8;
+        const vlc_tick_t time = trace.latency + trace.transfer(now + trace.latency, size);
+
+        /* playback drains while downloading, startup delay is not a stall */
+        if(buffer >= time)
+        {
+            buffer -= time;
+            played += time;
+        }
+        else
+        {
+            if(segments)
+                stalled += time - buffer;
+            played += buffer;
+            buffer = 0;
+        }
+        now += time;
+        buffer += trace.segment;
+        bits += rep->getBandwidth() * secf_from_vlc_tick(trace.segment);
+        segments++;
+
+        logic->updateDownloadRate(id, size, time, trace.latency);
+
+        /* idle until there's room for the next segment */
+        if(buffer > SIM_BUFFER_MAX)
+        {
+            played += buffer - SIM_BUFFER_MAX;
+            now += buffer - SIM_BUFFER_MAX;
+            buffer = SIM_BUFFER_MAX;
+        }
+        logic->trackerEvent(SegmentTrackerEvent(id, SIM_BUFFER_MIN, buffer, SIM_BUFFER_MAX));
+    }
+
+    logic->trackerEvent(SegmentTrackerEvent(rep, NULL));
+    logic->trackerEvent(SegmentTrackerEvent(id, false));
+
+    Result r;
+    r.rebuffer_ratio = (double) stalled / (played + stalled);
+    r.average_bps = bits / secf_from_vlc_tick(segments * trace.segment);
+    r.switches = switches;
+    return r;
+}
+
+static Result Run(AbstractAdaptationLogic::LogicType type, const char *name,
+                  BaseAdaptationSet *set, const Trace &trace)
+{
+    AbstractAdaptationLogic *logic;
+    switch(type)
+    {
+        case AbstractAdaptationLogic::RateBased:
+            logic = new RateBasedAdaptationLogic(NULL);
+            break;
+        case AbstractAdaptationLogic::Predictive:
+            logic = new PredictiveAdaptationLogic(NULL);
+            break;
+        case AbstractAdaptationLogic::NearOptimal:
+            logic = new NearOptimalAdaptationLogic();
+            break;
+        case AbstractAdaptationLogic::Hybrid:
+        default:
+            logic = new HybridAdaptationLogic(NULL);
+            break;
+    }
+
+    Result r = Simulate(logic, set, trace);
+    printf("%-12s %-14s rebuffer %6.2f%% bitrate %5" PRIu64 " kbps switches %u\n",
+           trace.name, name, 100 * r.rebuffer_ratio, r.average_bps / 1000, r.switches);
+    delete logic;
+    return r;
+}
+
+static Result RunAll(BaseAdaptationSet *set, const Trace &trace)
+{
+    Run(AbstractAdaptationLogic::RateBased, "rate", set, trace);
+    Run(AbstractAdaptationLogic::Predictive, "predictive", set, trace);
+    Run(AbstractAdaptationLogic::NearOptimal, "nearoptimal", set, trace);
+    return Run(AbstractAdaptationLogic::Hybrid, "hybrid", set, trace);
+}
+
+static bool LoadTrace(Trace &trace, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if(!f)
+        return false;
+    unsigned ms, kbps;
+    while(fscanf(f, "%u %u", &ms, &kbps) == 2)
+        if(ms)
+            trace.add(ms, kbps);
+    fclose(f);
+    return !trace.points.empty();
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint64_t bitrates[] = { 300000, 750000, 1500000, 3000000, 6000000 };
+
+    /* keep the results on failed assertions */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    TestPlaylist *playlist = new TestPlaylist();
+    BasePeriod *period = new BasePeriod(playlist);
+    playlist->addPeriod(period);
+    BaseAdaptationSet *set = new BaseAdaptationSet(period);
+    set->setID(ID("video"));
+    for(size_t i=0; i<ARRAY_SIZE(bitrates); i++)
+    {
+        BaseRepresentation *rep = new BaseRepresentation(set);
+        rep->setBandwidth(bitrates[i]);
+        set->addRepresentation(rep);
+    }
+    period->addAdaptationSet(set);
+
+    if(argc > 1)
+    {
+        Trace trace(argv[1],
+                    VLC_TICK_FROM_MS(argc > 2 ? atoi(argv[2]) : 50),
+                    VLC_TICK_FROM_MS(argc > 3 ? atoi(argv[3]) : 4000));
+        if(!LoadTrace(trace, argv[1]) || trace.segment <= 0)
+        {
+            fprintf(stderr, "cannot load trace %s\n", argv[1]);
+            delete playlist;
+            return 1;
+        }
+        RunAll(set, trace);
+        delete playlist;
+        return 0;
+    }
+
+    /* Steady link, must reach the matching quality without stalling */
+    Trace steady("steady", VLC_TICK_FROM_MS(50), VLC_TICK_FROM_SEC(4));
+    steady.add(1000, 5000);
+    Result r = RunAll(set, steady);
+    assert(r.rebuffer_ratio == 0.0);
+    assert(r.average_bps >= 3000000 * 9 / 10);
+
+    /* Sudden drops, must recover without stalling for long */
+    Trace drops("drops", VLC_TICK_FROM_MS(50), VLC_TICK_FROM_SEC(4));
+    drops.add(60000, 8000);
+    drops.add(45000, 1500);
+    r = RunAll(set, drops);
+    assert(r.rebuffer_ratio < 0.01);
+    assert(r.average_bps >= 1500000);
+
+    /* Short segments on a high latency link: the time to first byte
+     * must not be mistaken for a lack of bandwidth */
+    Trace latency("latency", VLC_TICK_FROM_MS(400), VLC_TICK_FROM_SEC(2));
+    latency.add(1000, 8000);
+    r = RunAll(set, latency);
+    assert(r.rebuffer_ratio == 0.0);
+    assert(r.average_bps >= 3000000 * 9 / 10);
+
+    /* Fluctuating link */
+    Trace fluctuating("fluctuating", VLC_TICK_FROM_MS(100), VLC_TICK_FROM_SEC(4));
+    fluctuating.add(3000, 4000);
+    fluctuating.add(2000, 1000);
+    fluctuating.add(5000, 2500);
+    fluctuating.add(1000, 200);
+    r = RunAll(set, fluctuating);
+    assert(r.rebuffer_ratio < 0.01);
+
+    delete playlist;
+    return 0;
+}
@@ -42,6 +42,7 @@ MediaSegmentTemplate::MediaSegmentTemplate( SegmentInformation *parent ) :
     debugName = "SegmentTemplate";
     classId = Segment::CLASSID_SEGMENT;
     startNumber.Set( 1 );
+    availabilityTimeOffset.Set( 0 );
     initialisationSegment.Set( NULL );
     templated = true;
     parentSegmentInformation = parent;
@@ -88,7 +89,10 @@ uint64_t MediaSegmentTemplate::getCurrentLiveTemplateNumber() const
         const Timescale timescale = inheritTimescale();
         time_t streamstart = parentSegmentInformation->getPlaylist()->availabilityStartTime.Get();
         streamstart += parentSegmentInformation->getPeriodStart();
-        stime_t elapsed = timescale.ToScaled(vlc_tick_from_sec(playbacktime - streamstart));
+        /* segments being produced can already be requested when
+         * they are transferred chunk by chunk */
+        stime_t elapsed = timescale.ToScaled(vlc_tick_from_sec(playbacktime - streamstart) +
+                                             availabilityTimeOffset.Get());
         number += elapsed / dur;
     }
 
@@ -57,6 +57,7 @@ namespace adaptive
                 size_t pruneBySequenceNumber(uint64_t);
                 virtual void debug(vlc_object_t *, int = 0) const; /* reimpl */
                 Property<size_t>        startNumber;
+                Property<vlc_tick_t>    availabilityTimeOffset; /* low latency, chunked segments */
 
             protected:
                 SegmentInformation *parentSegmentInformation;
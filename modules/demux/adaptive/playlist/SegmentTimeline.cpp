@@ -26,6 +26,7 @@
 #include "SegmentTimeline.h"
 
 #include <algorithm>
+#include <limits>
 
 using namespace adaptive::playlist;
 
@@ -49,16 +50,19 @@ SegmentTimeline::~SegmentTimeline()
 
 void SegmentTimeline::addElement(uint64_t number, stime_t d, uint64_t r, stime_t t)
 {
+    if(!elements.empty())
+    {
+        Element *el = elements.back();
+        if(!t)
+            t = el->t + (el->d * (el->r + 1));
+        /* Some packagers never use @r, keep the timeline compact */
+        if(el->extend(number, d, r, t))
+            return;
+    }
+
     Element *element = new (std::nothrow) Element(number, d, r, t);
     if(element)
-    {
-        if(!elements.empty() && !t)
-        {
-            const Element *el = elements.back();
-            element->t = el->t + (el->d * (el->r + 1));
-        }
         elements.push_back(element);
-    }
 }
 
 stime_t SegmentTimeline::getMinAheadScaledTime(uint64_t number) const
@@ -240,8 +244,13 @@ void SegmentTimeline::mergeWith(SegmentTimeline &other)
         }
         else /* Did not exist in previous list */
         {
-            elements.push_back(el);
             el->number = last->number + last->r + 1;
+            if(last->extend(el->number, el->d, el->r, el->t))
+            {
+                delete el;
+                continue;
+            }
+            elements.push_back(el);
             last = el;
         }
     }
@@ -273,6 +282,17 @@ bool SegmentTimeline::Element::contains(stime_t time) const
     return false;
 }
 
+bool SegmentTimeline::Element::extend(uint64_t number_, stime_t d_, uint64_t r_, stime_t t_)
+{
+    /* r is also used as an unbounded repeat by the parser */
+    const uint64_t maxrepeat = std::numeric_limits<unsigned>::max();
+    if(d_ != d || number_ != number + r + 1 || t_ != t + (stime_t)(r + 1) * d ||
+       r >= maxrepeat || r_ >= maxrepeat - r - 1)
+        return false;
+    r += r_ + 1;
+    return true;
+}
+
 void SegmentTimeline::Element::debug(vlc_object_t *obj, int indent) const
 {
     std::stringstream ss;
@@ -29,8 +29,89 @@
 #include <vlc_stream.h>
 #include <vlc_demux.h>
 
+#include <atomic>
+#include <new>
+
 using namespace adaptive;
 
+/* Downloaded blocks are shared between the seekable backlog and the blocks
+ * handed out to the demuxer, which can outlive the stream */
+namespace
+{
+    struct SharedBlockData
+    {
+        std::atomic<unsigned> refs;
+        block_t *p_block;
+    };
+
+    struct SharedBlockView
+    {
+        block_t self;
+        SharedBlockData *data;
+    };
+
+    void SharedBlockView_Release(block_t *p_block)
+    {
+        SharedBlockView *view = container_of(p_block, SharedBlockView, self);
+        if(view->data->refs.fetch_sub(1) == 1)
+        {
+            block_Release(view->data->p_block);
+            delete view->data;
+        }
+        delete view;
+    }
+
+    const struct vlc_block_callbacks SharedBlockView_cbs =
+    {
+        SharedBlockView_Release,
+    };
+
+    block_t * SharedBlockView_New(SharedBlockData *data, size_t i_offset, size_t i_size)
+    {
+        SharedBlockView *view = new (std::nothrow) SharedBlockView;
+        if(!view)
+            return NULL;
+        data->refs++;
+        view->data = data;
+        return block_Init(&view->self, &SharedBlockView_cbs,
+                          data->p_block->p_buffer + i_offset, i_size);
+    }
+
+    /* Takes ownership of the downloaded block */
+    block_t * SharedBlock_Wrap(block_t *p_block)
+    {
+        SharedBlockData *data = new (std::nothrow) SharedBlockData;
+        if(!data)
+            return p_block;
+        data->refs = 0;
+        data->p_block = p_block;
+        block_t *p_view = SharedBlockView_New(data, 0, p_block->i_buffer);
+        if(!p_view)
+        {
+            delete data;
+            return p_block;
+        }
+        return p_view;
+    }
+
+    /* Returns a new reference to part of a backlog block, or a copy */
+    block_t * SharedBlock_Sub(block_t *p_block, size_t i_offset, size_t i_size)
+    {
+        if(p_block->cbs == &SharedBlockView_cbs)
+        {
+            SharedBlockView *view = container_of(p_block, SharedBlockView, self);
+            size_t i_base = p_block->p_buffer - view->data->p_block->p_buffer;
+            block_t *p_sub = SharedBlockView_New(view->data, i_base + i_offset, i_size);
+            if(p_sub)
+                return p_sub;
+        }
+        block_t *p_copy = block_Alloc(i_size);
+        if(p_copy)
+            memcpy(p_copy->p_buffer, &p_block->p_buffer[i_offset], i_size);
+        return p_copy;
+    }
+}
+
 ChunksSourceStream::ChunksSourceStream(vlc_object_t *p_obj_, ChunksSource *source_)
     : b_eof( false )
     , p_obj( p_obj_ )
@@ -58,6 +139,8 @@ stream_t * ChunksSourceStream::makeStream()
     {
         p_stream->pf_control = control_Callback;
         p_stream->pf_read = read_Callback;
+        /* lets the demuxer take the downloaded data by reference */
+        p_stream->pf_block = block_Callback;
         p_stream->pf_readdir = NULL;
         p_stream->pf_seek = seek_Callback;
         p_stream->p_sys = this;
@@ -111,6 +194,26 @@ ssize_t ChunksSourceStream::Read(uint8_t *buf, size_t size)
     return i_copied;
 }
 
+block_t * ChunksSourceStream::Block()
+{
+    if(b_eof)
+        return NULL;
+
+    block_t *p_ret = p_block;
+    p_block = NULL;
+    while(!p_ret || p_ret->i_buffer == 0)
+    {
+        if(p_ret)
+            block_Release(p_ret);
+        if(!(p_ret = source->readNextBlock()))
+        {
+            b_eof = true;
+            break;
+        }
+    }
+    return p_ret;
+}
+
 int ChunksSourceStream::Seek(uint64_t)
 {
     return VLC_EGENERIC;
@@ -122,6 +225,14 @@ ssize_t ChunksSourceStream::read_Callback(stream_t *s, void *buf, size_t size)
     return me->Read(reinterpret_cast<uint8_t *>(buf), size);
 }
 
+block_t * ChunksSourceStream::block_Callback(stream_t *s, bool *eof)
+{
+    ChunksSourceStream *me = reinterpret_cast<ChunksSourceStream *>(s->p_sys);
+    block_t *p_block = me->Block();
+    *eof = me->b_eof;
+    return p_block;
+}
+
 int ChunksSourceStream::seek_Callback(stream_t *s, uint64_t i_pos)
 {
     ChunksSourceStream *me = reinterpret_cast<ChunksSourceStream *>(s->p_sys);
@@ -190,6 +301,33 @@ void BufferedChunksSourceStream::Reset()
     b_eof = false;
 }
 
+bool BufferedChunksSourceStream::Fill()
+{
+    block_t *p_add = source->readNextBlock();
+    if(!p_add)
+    {
+        b_eof = true;
+        return false;
+    }
+    block_BytestreamPush(&bs, SharedBlock_Wrap(p_add));
+    return true;
+}
+
+void BufferedChunksSourceStream::Trim()
+{
+    if(i_bytestream_offset > MAX_BACKEND)
+    {
+        const size_t i_drop = i_bytestream_offset - MAX_BACKEND;
+        if(i_drop >= MIN_BACKEND_CLEANUP) /* Dont flush for few bytes */
+        {
+            block_GetBytes(&bs, NULL, i_drop);
+            block_BytestreamFlush(&bs);
+            i_bytestream_offset -= i_drop;
+            i_global_offset += i_drop;
+        }
+    }
+}
+
 ssize_t BufferedChunksSourceStream::Read(uint8_t *buf, size_t size)
 {
     size_t i_copied = 0;
@@ -201,14 +339,9 @@ ssize_t BufferedChunksSourceStream::Read(uint8_t *buf, size_t size)
 
         if(i_remain < i_toread)
         {
-            block_t *p_add = source->readNextBlock();
-            if(!p_add)
-            {
-                b_eof = true;
+            if(!Fill())
                 break;
-            }
-            i_remain += p_add->i_buffer;
-            block_BytestreamPush(&bs, p_add);
+            i_remain = block_BytestreamRemaining(&bs) - i_bytestream_offset;
         }
 
         size_t i_read;
@@ -224,19 +357,35 @@ ssize_t BufferedChunksSourceStream::Read(uint8_t *buf, size_t size)
         i_toread -= i_read;
     }
 
-    if(i_bytestream_offset > MAX_BACKEND)
+    Trim();
+
+    return i_copied;
+}
+
+block_t * BufferedChunksSourceStream::Block()
+{
+    while(block_BytestreamRemaining(&bs) == i_bytestream_offset)
     {
-        const size_t i_drop = i_bytestream_offset - MAX_BACKEND;
-        if(i_drop >= MIN_BACKEND_CLEANUP) /* Dont flush for few bytes */
-        {
-            block_GetBytes(&bs, NULL, i_drop);
-            block_BytestreamFlush(&bs);
-            i_bytestream_offset -= i_drop;
-            i_global_offset += i_drop;
-        }
+        if(b_eof || !Fill())
+            return NULL;
     }
 
-    return i_copied;
+    /* Hand out the rest of the backlog block at the read offset */
+    size_t i_offset = bs.i_block_offset + i_bytestream_offset;
+    block_t *p_cur = bs.p_block;
+    while(i_offset >= p_cur->i_buffer)
+    {
+        i_offset -= p_cur->i_buffer;
+        p_cur = p_cur->p_next;
+    }
+
+    block_t *p_ret = SharedBlock_Sub(p_cur, i_offset, p_cur->i_buffer - i_offset);
+    if(p_ret)
+    {
+        i_bytestream_offset += p_ret->i_buffer;
+        Trim();
+    }
+    return p_ret;
 }
 
 int BufferedChunksSourceStream::Seek(uint64_t i_seek)
@@ -48,6 +48,7 @@ namespace adaptive
         protected:
             std::string getContentType();
             virtual ssize_t Read(uint8_t *, size_t);
+            virtual block_t *Block();
             virtual int     Seek(uint64_t);
             bool b_eof;
             vlc_object_t *p_obj;
@@ -56,6 +57,7 @@ namespace adaptive
         private:
             block_t *p_block;
             static ssize_t read_Callback(stream_t *, void *, size_t);
+            static block_t *block_Callback(stream_t *, bool *);
             static int seek_Callback(stream_t *, uint64_t);
             static int control_Callback( stream_t *, int i_query, va_list );
             static void delete_Callback( stream_t * );
@@ -70,9 +72,12 @@ namespace adaptive
 
         protected:
             virtual ssize_t Read(uint8_t *, size_t); /* reimpl */
+            virtual block_t *Block(); /* reimpl */
             virtual int     Seek(uint64_t); /* reimpl */
 
         private:
+            bool Fill();
+            void Trim();
             static const int MAX_BACKEND = 5 * 1024 * 1024;
             static const int MIN_BACKEND_CLEANUP = 50 * 1024;
             uint64_t i_global_offset;
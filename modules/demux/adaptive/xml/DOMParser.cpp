@@ -36,14 +36,16 @@ using namespace adaptive::xml;
 DOMParser::DOMParser() :
     root( NULL ),
     stream( NULL ),
-    vlc_reader( NULL )
+    vlc_reader( NULL ),
+    listener( NULL )
 {
 }
 
 DOMParser::DOMParser    (stream_t *stream) :
     root( NULL ),
     stream( stream ),
-    vlc_reader( NULL )
+    vlc_reader( NULL ),
+    listener( NULL )
 {
 }
 
@@ -77,6 +79,19 @@ bool    DOMParser::parse                    (bool b)
     return true;
 }
 
+void DOMParser::setElementListener(DOMElementListener *l)
+{
+    listener = l;
+}
+
+void DOMParser::endNode(Node *parent, Node *node)
+{
+    if(listener && listener->elementEnded(parent, node))
+        delete node;
+    else
+        parent->addSubNode(node);
+}
+
 bool DOMParser::reset(stream_t *s)
 {
     stream = s;
@@ -106,16 +121,18 @@ Node* DOMParser::processNode(bool b_strict)
                 Node *node = new (std::nothrow) Node();
                 if(node)
                 {
-                    if(!lifo.empty())
-                        lifo.top()->addSubNode(node);
                     lifo.push(node);
 
                     node->setName(std::string(data));
                     addAttributesToNode(node);
-                }
 
-                if(empty && lifo.size() > 1)
-                    lifo.pop();
+                    /* children are attached to their parent once complete */
+                    if(empty && lifo.size() > 1)
+                    {
+                        lifo.pop();
+                        endNode(lifo.top(), node);
+                    }
+                }
                 break;
             }
 
@@ -135,6 +152,7 @@ Node* DOMParser::processNode(bool b_strict)
                 lifo.pop();
                 if(lifo.empty())
                     return node;
+                endNode(lifo.top(), node);
             }
 
             default:
@@ -143,7 +161,11 @@ Node* DOMParser::processNode(bool b_strict)
     }
 
     while( lifo.size() > 1 )
+    {
+        Node *node = lifo.top();
         lifo.pop();
+        lifo.top()->addSubNode(node);
+    }
 
     Node *node = (!lifo.empty()) ? lifo.top() : NULL;
 
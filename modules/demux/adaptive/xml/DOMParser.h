@@ -34,6 +34,20 @@ namespace adaptive
 {
     namespace xml
     {
+        class DOMElementListener
+        {
+            public:
+                virtual ~DOMElementListener() {}
+                /**
+                 * Called once an element and all its children are read,
+                 * before it gets attached to its parent
+                 *
+                 * @return true if the element has been consumed, and must
+                 *         not be kept in the tree
+                 */
+                virtual bool elementEnded(Node *parent, Node *element) = 0;
+        };
+
         class DOMParser
         {
             public:
@@ -45,14 +59,17 @@ namespace adaptive
                 bool                reset       (stream_t *);
                 Node*               getRootNode ();
                 void                print       ();
+                void                setElementListener(DOMElementListener *);
 
             private:
                 Node                *root;
                 stream_t            *stream;
 
                 xml_reader_t        *vlc_reader;
+                DOMElementListener  *listener;
 
                 Node*   processNode             (bool);
+                void    endNode                 (Node *parent, Node *node);
                 void    addAttributesToNode     (Node *node);
                 void    print                   (Node *node, int offset);
         };
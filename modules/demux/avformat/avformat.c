@@ -44,6 +44,9 @@ vlc_module_begin ()
     set_section( N_("Demuxer"), NULL )
     add_string( "avformat-format", NULL, FORMAT_TEXT, FORMAT_LONGTEXT, true )
     add_obsolete_string("ffmpeg-format") /* removed since 2.1.0 */
+    add_integer( "avformat-iobuffer-size", 32768, IOBUFFER_TEXT,
+                 IOBUFFER_LONGTEXT, true )
+        change_integer_range( 4096, 1 << 24 )
     add_string( "avformat-options", NULL, AV_OPTIONS_TEXT, AV_OPTIONS_LONGTEXT, true )
 
 #ifdef ENABLE_SOUT
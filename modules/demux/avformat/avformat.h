@@ -35,3 +35,7 @@ void avformat_CloseMux( vlc_object_t * );
 #define MUX_LONGTEXT N_("Force use of a specific avformat muxer.")
 #define FORMAT_TEXT N_( "Format name" )
 #define FORMAT_LONGTEXT N_( "Internal libavcodec format name" )
+#define IOBUFFER_TEXT N_( "Input buffer size" )
+#define IOBUFFER_LONGTEXT N_( "Size of the buffer through which the " \
+    "demuxer reads its input, in bytes. Larger values reduce the read " \
+    "overhead but increase the start-up delay of live streams." )
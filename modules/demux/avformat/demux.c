@@ -81,7 +81,45 @@ typedef struct
     unsigned i_update;
 } demux_sys_t;
 
-#define AVFORMAT_IOBUFFER_SIZE 32768  /* FIXME */
+/* Block referencing a demuxed packet, to avoid copying its data */
+typedef struct
+{
+    block_t self;
+    AVPacket *pkt;
+} avformat_block_t;
+
+static void PacketBlockRelease( block_t *p_block )
+{
+    avformat_block_t *b = container_of( p_block, avformat_block_t, self );
+
+    av_packet_free( &b->pkt );
+    free( b );
+}
+
+static const struct vlc_block_callbacks packet_block_cbs =
+{
+    PacketBlockRelease,
+};
+
+static block_t *BuildPacketBlock( const AVPacket *p_pkt )
+{
+    if( p_pkt->buf == NULL )
+        return NULL; /* not reference-counted */
+
+    avformat_block_t *b = malloc( sizeof( *b ) );
+    if( unlikely(b == NULL) )
+        return NULL;
+
+    b->pkt = av_packet_alloc();
+    if( unlikely(b->pkt == NULL) || av_packet_ref( b->pkt, p_pkt ) )
+    {
+        av_packet_free( &b->pkt );
+        free( b );
+        return NULL;
+    }
+    return block_Init( &b->self, &packet_block_cbs, b->pkt->data,
+                       b->pkt->size );
+}
 
 /*****************************************************************************
  * Local prototypes
@@ -299,7 +337,8 @@ int avformat_OpenDemux( vlc_object_t *p_this )
     p_sys->i_update = 0;
 
     /* Create I/O wrapper */
-    unsigned char * p_io_buffer = av_malloc( AVFORMAT_IOBUFFER_SIZE );
+    int i_io_buffer = var_InheritInteger( p_demux, "avformat-iobuffer-size" );
+    unsigned char * p_io_buffer = av_malloc( i_io_buffer );
     if( !p_io_buffer )
     {
         avformat_CloseDemux( p_this );
@@ -315,7 +354,7 @@ int avformat_OpenDemux( vlc_object_t *p_this )
     }
 
     AVIOContext *pb = p_sys->ic->pb = avio_alloc_context( p_io_buffer,
-        AVFORMAT_IOBUFFER_SIZE, 0, p_demux, IORead, NULL, IOSeek );
+        i_io_buffer, 0, p_demux, IORead, NULL, IOSeek );
     if( !pb )
     {
         av_free( p_io_buffer );
@@ -813,7 +852,7 @@ static int Demux( demux_t *p_demux )
         memcpy( &p_frame->p_buffer[2], pkt.data, pkt.size );
         p_frame->p_buffer[p_frame->i_buffer - 1] = 0x3f;
     }
-    else
+    else if( ( p_frame = BuildPacketBlock( &pkt ) ) == NULL )
     {
         if( ( p_frame = block_Alloc( pkt.size ) ) == NULL )
         {
@@ -29,7 +29,9 @@
 #endif
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <limits.h>
+#include <sys/stat.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -37,6 +39,10 @@
 #include <vlc_input.h>
 
 #include <vlc_dialog.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_url.h>
 
 #include <vlc_meta.h>
 #include <vlc_codecs.h>
@@ -57,6 +63,17 @@
     "Recreate a index for the AVI file. Use this if your AVI file is damaged "\
     "or incomplete (not seekable)." )
 
+#define INDEX_CACHE_TEXT N_("Cache created indexes")
+#define INDEX_CACHE_LONGTEXT N_( \
+    "Save the indexes created for broken or unindexed AVI files, so that " \
+    "they are not created again the next time the same file is opened. " \
+    "Only local files are cached." )
+
+#define INDEX_BACKGROUND_TEXT N_("Create indexes in the background")
+#define INDEX_BACKGROUND_LONGTEXT N_( \
+    "Start playing large broken or unindexed AVI files immediately, while " \
+    "their index is created. Seeking is approximate until it is ready." )
+
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
@@ -79,6 +96,10 @@ vlc_module_begin ()
     add_integer( "avi-index", 0,
               INDEX_TEXT, INDEX_LONGTEXT, false )
         change_integer_list( pi_index, ppsz_indexes )
+    add_bool( "avi-index-cache", true,
+              INDEX_CACHE_TEXT, INDEX_CACHE_LONGTEXT, true )
+    add_bool( "avi-index-background", false,
+              INDEX_BACKGROUND_TEXT, INDEX_BACKGROUND_LONGTEXT, true )
 
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -167,6 +188,8 @@ typedef struct
 
 } avi_track_t;
 
+typedef struct avi_indexer_t avi_indexer_t;
+
 typedef struct
 {
     vlc_tick_t i_time;
@@ -194,6 +217,9 @@ typedef struct
 
     unsigned int       i_attachment;
     input_attachment_t **attachment;
+
+    /* index being created in the background */
+    avi_indexer_t *p_indexer;
 } demux_sys_t;
 
 #define __EVEN(x) (((x) & 1) ? (x) + 1 : (x))
@@ -219,6 +245,8 @@ static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static void AVI_IndexerPoll  ( demux_t * );
+static void AVI_IndexerStop  ( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -251,6 +279,8 @@ static void Close ( vlc_object_t * p_this )
     demux_t *    p_demux = (demux_t *)p_this;
     demux_sys_t *p_sys = p_demux->p_sys  ;
 
+    AVI_IndexerStop( p_demux );
+
     for( unsigned int i = 0; i < p_sys->i_track; i++ )
     {
         if( p_sys->track[i] )
@@ -909,6 +939,7 @@ static int Demux_Seekable( demux_t *p_demux )
     /* cannot be more than 100 stream (dcXX or wbXX) */
     avi_track_toread_t toread[100];
 
+    AVI_IndexerPoll( p_demux );
 
     /* detect new selected/unselected streams */
     for( i_track = 0; i_track < p_sys->i_track; i_track++ )
@@ -1586,6 +1617,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     bool b;
     vlc_meta_t *p_meta;
 
+    AVI_IndexerPoll( p_demux );
+
     switch( i_query )
     {
         case DEMUX_CAN_SEEK:
@@ -2550,135 +2583,625 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
-static void AVI_IndexCreate( demux_t *p_demux )
-{
-    demux_sys_t *p_sys = p_demux->p_sys;
-
-    avi_chunk_list_t *p_riff;
-    avi_chunk_list_t *p_movi;
+#define AVI_SCAN_WINDOW (256 * 1024)
+#define AVI_CACHE_MAGIC "VLCAVIX2"
 
-    unsigned int i_stream;
-    uint32_t i_movi_end;
+typedef struct
+{
+    enum es_format_category_e i_cat;
+    vlc_fourcc_t i_codec;
+    avi_index_t  idx;
+} avi_indexer_track_t;
 
-    vlc_tick_t i_dialog_update;
-    vlc_dialog_id *p_dialog_id = NULL;
+struct avi_indexer_t
+{
+    vlc_object_t *p_obj;
+    stream_t     *s;
+    char         *psz_cache;
+
+    unsigned int        i_track;
+    avi_indexer_track_t *track;
+
+    uint64_t i_movi_start;  /* first chunk */
+    uint64_t i_movi_end;    /* 0 when the RIFF extensions are scanned */
+    uint64_t i_avix_start;  /* first chunk after the first RIFF, or 0 */
+    uint64_t i_stream_size;
+    int64_t  i_stream_mtime;
+    uint64_t i_lastchunk_pos;
+
+    vlc_dialog_id *p_dialog;
+    vlc_thread_t   thread;
+    atomic_bool    b_stop;
+    atomic_bool    b_done;
+    int            i_status;
+};
+
+/* Reads the movi list in large windows instead of peeking each chunk header
+ * separately. */
+typedef struct
+{
+    stream_t *s;
+    uint8_t  *p_buffer;
+    uint64_t  i_start;  /* stream position of p_buffer[0] */
+    size_t    i_length; /* valid bytes in p_buffer */
+} avi_scanner_t;
+
+static const uint8_t *AVI_ScannerPeek( avi_scanner_t *p_sc, uint64_t i_pos,
+                                       size_t i_size )
+{
+    const uint64_t i_end = p_sc->i_start + p_sc->i_length;
 
-    p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0, true );
-    p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0, true );
+    if( i_pos >= p_sc->i_start && i_pos + i_size <= i_end )
+        return p_sc->p_buffer + ( i_pos - p_sc->i_start );
 
-    if( !p_movi )
-    {
-        msg_Err( p_demux, "cannot find p_movi" );
-        return;
+    size_t i_keep = 0;
+    if( i_pos >= p_sc->i_start && i_pos < i_end )
+    {   /* Keep the tail, the stream is already positioned after it */
+        i_keep = i_end - i_pos;
+        memmove( p_sc->p_buffer, p_sc->p_buffer + ( i_pos - p_sc->i_start ),
+                 i_keep );
     }
+    else if( i_pos != i_end && vlc_stream_Seek( p_sc->s, i_pos ) )
+        return NULL;
 
-    for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
-        avi_index_Init( &p_sys->track[i_stream]->idx );
+    p_sc->i_start = i_pos;
+    p_sc->i_length = i_keep;
 
-    i_movi_end = __MIN( (uint32_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
-                        stream_Size( p_demux->s ) );
+    ssize_t i_read = vlc_stream_Read( p_sc->s, p_sc->p_buffer + i_keep,
+                                      AVI_SCAN_WINDOW - i_keep );
+    if( i_read > 0 )
+        p_sc->i_length += i_read;
 
-    vlc_stream_Seek( p_demux->s, p_movi->i_chunk_pos + 12 );
-    msg_Warn( p_demux, "creating index from LIST-movi, will take time !" );
+    return ( p_sc->i_length >= i_size ) ? p_sc->p_buffer : NULL;
+}
 
+static bool AVI_IndexerIsChunk( const avi_indexer_t *p_idx,
+                                const uint8_t *p_peek )
+{
+    vlc_fourcc_t i_fourcc = VLC_FOURCC( p_peek[0], p_peek[1],
+                                        p_peek[2], p_peek[3] );
+    unsigned int i_stream;
+    enum es_format_category_e i_cat;
 
-    /* Only show dialog if AVI is > 10MB */
-    i_dialog_update = vlc_tick_now();
-    if( stream_Size( p_demux->s ) > 10000000 )
+    switch( i_fourcc )
     {
-        p_dialog_id =
-            vlc_dialog_display_progress( p_demux, false, 0.0, _("Cancel"),
-                                         _("Broken or missing AVI Index"),
-                                         _("Fixing AVI Index...") );
+        case AVIFOURCC_JUNK:
+        case AVIFOURCC_LIST:
+        case AVIFOURCC_RIFF:
+        case AVIFOURCC_idx1:
+            return true;
     }
+    AVI_ParseStreamHeader( i_fourcc, &i_stream, &i_cat );
+    return i_stream < p_idx->i_track
+        && ( i_cat == AUDIO_ES || i_cat == VIDEO_ES );
+}
+
+static int AVI_IndexerScan( avi_indexer_t *p_idx )
+{
+    avi_scanner_t sc = {
+        .s = p_idx->s,
+        .p_buffer = malloc( AVI_SCAN_WINDOW ),
+        .i_start = vlc_stream_Tell( p_idx->s ),
+        .i_length = 0,
+    };
+    if( unlikely(sc.p_buffer == NULL) )
+        return VLC_ENOMEM;
+
+    uint64_t i_pos = p_idx->i_movi_start;
+    vlc_tick_t i_dialog_update = vlc_tick_now();
+    int i_ret = VLC_SUCCESS;
 
     for( ;; )
     {
-        avi_packet_t pk;
+        if( atomic_load_explicit( &p_idx->b_stop, memory_order_relaxed ) )
+        {
+            i_ret = VLC_EGENERIC;
+            break;
+        }
 
         /* Don't update/check dialog too often */
-        if( p_dialog_id != NULL && vlc_tick_now() - i_dialog_update > VLC_TICK_FROM_MS(100) )
+        if( p_idx->p_dialog != NULL
+         && vlc_tick_now() - i_dialog_update > VLC_TICK_FROM_MS(100) )
         {
-            if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            if( vlc_dialog_is_cancelled( p_idx->p_obj, p_idx->p_dialog ) )
+            {
+                i_ret = VLC_EGENERIC;
                 break;
-
-            double f_current = vlc_stream_Tell( p_demux->s );
-            double f_size    = stream_Size( p_demux->s );
-            double f_pos     = f_current / f_size;
-            vlc_dialog_update_progress( p_demux, p_dialog_id, f_pos );
-
+            }
+            vlc_dialog_update_progress( p_idx->p_obj, p_idx->p_dialog,
+                                        (double)i_pos / p_idx->i_stream_size );
             i_dialog_update = vlc_tick_now();
         }
 
-        if( AVI_PacketGetHeader( p_demux, &pk ) )
+        const uint8_t *p_peek = AVI_ScannerPeek( &sc, i_pos, 16 );
+        if( p_peek == NULL )
             break;
 
-        if( pk.i_stream < p_sys->i_track &&
-            pk.i_cat == p_sys->track[pk.i_stream]->fmt.i_cat )
+        vlc_fourcc_t i_fourcc = VLC_FOURCC( p_peek[0], p_peek[1],
+                                            p_peek[2], p_peek[3] );
+        uint32_t i_size = GetDWLE( p_peek + 4 );
+        uint64_t i_next = i_pos + 8 + __EVEN( (uint64_t)i_size );
+        unsigned int i_stream;
+        enum es_format_category_e i_cat;
+
+        AVI_ParseStreamHeader( i_fourcc, &i_stream, &i_cat );
+
+        if( i_stream < p_idx->i_track && i_cat == p_idx->track[i_stream].i_cat )
         {
-            avi_track_t *tk = p_sys->track[pk.i_stream];
+            avi_indexer_track_t *tk = &p_idx->track[i_stream];
+            uint8_t i_key[8];
+
+            memcpy( i_key, p_peek + 8, 8 );
 
             avi_entry_t index;
-            index.i_id      = pk.i_fourcc;
-            index.i_flags   = AVI_GetKeyFlag(tk->fmt.i_codec, pk.i_peek);
-            index.i_pos     = pk.i_pos;
-            index.i_length  = pk.i_size;
-            index.i_lengthtotal = pk.i_size;
-            avi_index_Append( &tk->idx, &p_sys->i_movi_lastchunk_pos, &index );
+            index.i_id      = i_fourcc;
+            index.i_flags   = AVI_GetKeyFlag( tk->i_codec, i_key );
+            index.i_pos     = i_pos;
+            index.i_length  = i_size;
+            index.i_lengthtotal = i_size;
+            avi_index_Append( &tk->idx, &p_idx->i_lastchunk_pos, &index );
         }
-        else
+        else switch( i_fourcc )
         {
-            switch( pk.i_fourcc )
-            {
             case AVIFOURCC_idx1:
-                if( p_sys->b_odml )
-                {
-                    avi_chunk_list_t *p_sysx;
-                    p_sysx = AVI_ChunkFind( &p_sys->ck_root,
-                                            AVIFOURCC_RIFF, 1, true );
-
-                    msg_Dbg( p_demux, "looking for new RIFF chunk" );
-                    if( !p_sysx || vlc_stream_Seek( p_demux->s,
-                                         p_sysx->i_chunk_pos + 24 ) )
-                        goto print_stat;
-                    break;
-                }
-                goto print_stat;
+                if( p_idx->i_avix_start == 0 )
+                    goto end;
+                msg_Dbg( p_idx->p_obj, "looking for new RIFF chunk" );
+                i_next = p_idx->i_avix_start;
+                p_idx->i_avix_start = 0;
+                break;
 
             case AVIFOURCC_RIFF:
-                    msg_Dbg( p_demux, "new RIFF chunk found" );
-                    break;
+                msg_Dbg( p_idx->p_obj, "new RIFF chunk found" );
+                i_next = i_pos + 24;
+                break;
+
+            case AVIFOURCC_LIST:
+            {
+                vlc_fourcc_t i_type = VLC_FOURCC( p_peek[8],  p_peek[9],
+                                                  p_peek[10], p_peek[11] );
+                if( i_type == AVIFOURCC_rec || i_type == AVIFOURCC_movi )
+                    i_next = i_pos + 12;
+                break;
+            }
 
-            case AVIFOURCC_rec:
             case AVIFOURCC_JUNK:
                 break;
 
             default:
-                msg_Warn( p_demux, "need resync, probably broken avi" );
-                if( AVI_PacketSearch( p_demux ) )
+                msg_Warn( p_idx->p_obj, "need resync, probably broken avi" );
+                for( i_next = i_pos + 1; ; i_next++ )
                 {
-                    msg_Warn( p_demux, "lost sync, abord index creation" );
-                    goto print_stat;
+                    p_peek = AVI_ScannerPeek( &sc, i_next, 16 );
+                    if( p_peek == NULL )
+                    {
+                        msg_Warn( p_idx->p_obj,
+                                  "lost sync, abord index creation" );
+                        goto end;
+                    }
+                    if( AVI_IndexerIsChunk( p_idx, p_peek ) )
+                        break;
                 }
+        }
+
+        if( p_idx->i_movi_end != 0 && i_next >= p_idx->i_movi_end )
+            break;
+        i_pos = i_next;
+    }
+end:
+    free( sc.p_buffer );
+    return i_ret;
+}
+
+static char *AVI_IndexCachePath( demux_t *p_demux, uint64_t i_movi_start,
+                                 int64_t *pi_mtime )
+{
+    if( !var_InheritBool( p_demux, "avi-index-cache" )
+     || p_demux->psz_url == NULL )
+        return NULL;
+
+    /* Only local files have a modification time to detect replaced files */
+    char *psz_file = vlc_uri2path( p_demux->psz_url );
+    if( psz_file == NULL )
+        return NULL;
+
+    struct stat st;
+    int i_ret = vlc_stat( psz_file, &st );
+    free( psz_file );
+    if( i_ret )
+        return NULL;
+    *pi_mtime = st.st_mtime;
+
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_dir == NULL )
+        return NULL;
+
+    /* The cache is keyed by the location, the layout and the modification
+     * time of the file */
+    uint8_t key[24];
+    struct md5_s md5;
+
+    SetQWLE( key, stream_Size( p_demux->s ) );
+    SetQWLE( key + 8, i_movi_start );
+    SetQWLE( key + 16, *pi_mtime );
+    InitMD5( &md5 );
+    AddMD5( &md5, p_demux->psz_url, strlen( p_demux->psz_url ) );
+    AddMD5( &md5, key, sizeof( key ) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_path;
+
+    if( psz_hash == NULL
+     || asprintf( &psz_path, "%s"DIR_SEP"avi-index"DIR_SEP"%s",
+                  psz_dir, psz_hash ) < 0 )
+        psz_path = NULL;
+    free( psz_hash );
+    free( psz_dir );
+    return psz_path;
+}
+
+static int AVI_IndexCacheLoad( avi_indexer_t *p_idx )
+{
+    FILE *p_file = vlc_fopen( p_idx->psz_cache, "rb" );
+    if( p_file == NULL )
+        return VLC_EGENERIC;
+
+    uint8_t hdr[28];
+    if( fread( hdr, 1, sizeof( hdr ), p_file ) != sizeof( hdr )
+     || memcmp( hdr, AVI_CACHE_MAGIC, 8 )
+     || GetQWLE( hdr + 8 ) != p_idx->i_stream_size
+     || (int64_t)GetQWLE( hdr + 16 ) != p_idx->i_stream_mtime
+     || GetDWLE( hdr + 24 ) != p_idx->i_track )
+        goto error;
+
+    uint32_t *pi_count = vlc_alloc( p_idx->i_track, sizeof( *pi_count ) );
+    if( unlikely(pi_count == NULL) )
+        goto error;
+
+    for( unsigned int i = 0; i < p_idx->i_track; i++ )
+    {
+        uint8_t track[8];
+        if( fread( track, 1, sizeof( track ), p_file ) != sizeof( track )
+         || GetDWLE( track ) != p_idx->track[i].i_codec )
+        {
+            free( pi_count );
+            goto error;
+        }
+        pi_count[i] = GetDWLE( track + 4 );
+    }
+
+    for( unsigned int i = 0; i < p_idx->i_track; i++ )
+    {
+        for( uint32_t j = 0; j < pi_count[i]; j++ )
+        {
+            uint8_t entry[20];
+            if( fread( entry, 1, sizeof( entry ), p_file ) != sizeof( entry ) )
+            {
+                free( pi_count );
+                goto error;
             }
+
+            avi_entry_t index;
+            index.i_id     = GetDWLE( entry );
+            index.i_flags  = GetDWLE( entry + 4 );
+            index.i_pos    = GetQWLE( entry + 8 );
+            index.i_length = GetDWLE( entry + 16 );
+            index.i_lengthtotal = index.i_length;
+            avi_index_Append( &p_idx->track[i].idx, &p_idx->i_lastchunk_pos,
+                              &index );
         }
+    }
+    free( pi_count );
+    fclose( p_file );
+    msg_Dbg( p_idx->p_obj, "index loaded from %s", p_idx->psz_cache );
+    return VLC_SUCCESS;
+
+error:
+    fclose( p_file );
+    for( unsigned int i = 0; i < p_idx->i_track; i++ )
+    {
+        avi_index_Clean( &p_idx->track[i].idx );
+        avi_index_Init( &p_idx->track[i].idx );
+    }
+    p_idx->i_lastchunk_pos = 0;
+    msg_Warn( p_idx->p_obj, "ignoring invalid index cache %s",
+              p_idx->psz_cache );
+    return VLC_EGENERIC;
+}
+
+static void AVI_IndexCacheSave( avi_indexer_t *p_idx )
+{
+    char *psz_dir = strdup( p_idx->psz_cache );
+    char *psz_sep = psz_dir ? strrchr( psz_dir, DIR_SEP_CHAR ) : NULL;
+    if( psz_sep == NULL )
+    {
+        free( psz_dir );
+        return;
+    }
+    *psz_sep = '\0';
+    /* Create the missing parent directories as well */
+    for( char *p = strchr( psz_dir + 1, DIR_SEP_CHAR ); p != NULL;
+         p = strchr( p + 1, DIR_SEP_CHAR ) )
+    {
+        *p = '\0';
+        vlc_mkdir( psz_dir, 0700 );
+        *p = DIR_SEP_CHAR;
+    }
+    vlc_mkdir( psz_dir, 0700 );
+    free( psz_dir );
+
+    char *psz_tmp;
+    if( asprintf( &psz_tmp, "%s.tmp", p_idx->psz_cache ) < 0 )
+        return;
 
-        if( ( !p_sys->b_odml && pk.i_pos + pk.i_size >= i_movi_end ) ||
-            AVI_PacketNext( p_demux ) )
+    FILE *p_file = vlc_fopen( psz_tmp, "wb" );
+    if( p_file == NULL )
+    {
+        msg_Warn( p_idx->p_obj, "cannot create index cache %s: %s",
+                  psz_tmp, vlc_strerror_c( errno ) );
+        free( psz_tmp );
+        return;
+    }
+
+    uint8_t hdr[28];
+    memcpy( hdr, AVI_CACHE_MAGIC, 8 );
+    SetQWLE( hdr + 8, p_idx->i_stream_size );
+    SetQWLE( hdr + 16, p_idx->i_stream_mtime );
+    SetDWLE( hdr + 24, p_idx->i_track );
+    bool b_error = fwrite( hdr, 1, sizeof( hdr ), p_file ) != sizeof( hdr );
+
+    for( unsigned int i = 0; i < p_idx->i_track && !b_error; i++ )
+    {
+        uint8_t track[8];
+        SetDWLE( track, p_idx->track[i].i_codec );
+        SetDWLE( track + 4, p_idx->track[i].idx.i_size );
+        b_error = fwrite( track, 1, sizeof( track ), p_file ) != sizeof( track );
+    }
+
+    for( unsigned int i = 0; i < p_idx->i_track && !b_error; i++ )
+    {
+        const avi_index_t *idx = &p_idx->track[i].idx;
+        for( uint32_t j = 0; j < idx->i_size && !b_error; j++ )
         {
-            break;
+            uint8_t entry[20];
+            SetDWLE( entry, idx->p_entry[j].i_id );
+            SetDWLE( entry + 4, idx->p_entry[j].i_flags );
+            SetQWLE( entry + 8, idx->p_entry[j].i_pos );
+            SetDWLE( entry + 16, idx->p_entry[j].i_length );
+            b_error = fwrite( entry, 1, sizeof( entry ), p_file )
+                          != sizeof( entry );
         }
     }
 
-print_stat:
-    if( p_dialog_id != NULL )
-        vlc_dialog_release( p_demux, p_dialog_id );
+    if( fclose( p_file ) )
+        b_error = true;
+    if( b_error || vlc_rename( psz_tmp, p_idx->psz_cache ) )
+    {
+        msg_Warn( p_idx->p_obj, "cannot write index cache %s",
+                  p_idx->psz_cache );
+        vlc_unlink( psz_tmp );
+    }
+    free( psz_tmp );
+}
 
-    for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+static avi_indexer_t *AVI_IndexerNew( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_chunk_list_t *p_riff = AVI_ChunkFind( &p_sys->ck_root,
+                                              AVIFOURCC_RIFF, 0, true );
+    avi_chunk_list_t *p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0, true );
+
+    if( !p_movi )
+    {
+        msg_Err( p_demux, "cannot find p_movi" );
+        return NULL;
+    }
+
+    avi_indexer_t *p_idx = malloc( sizeof( *p_idx ) );
+    if( unlikely(p_idx == NULL) )
+        return NULL;
+
+    p_idx->track = vlc_alloc( p_sys->i_track, sizeof( *p_idx->track ) );
+    if( unlikely(p_idx->track == NULL) )
+    {
+        free( p_idx );
+        return NULL;
+    }
+    p_idx->i_track = p_sys->i_track;
+    for( unsigned int i = 0; i < p_sys->i_track; i++ )
+    {
+        p_idx->track[i].i_cat = p_sys->track[i]->fmt.i_cat;
+        p_idx->track[i].i_codec = p_sys->track[i]->fmt.i_codec;
+        avi_index_Init( &p_idx->track[i].idx );
+    }
+
+    p_idx->p_obj = VLC_OBJECT(p_demux);
+    p_idx->s = p_demux->s;
+    p_idx->i_stream_size = stream_Size( p_demux->s );
+    p_idx->i_movi_start = p_movi->i_chunk_pos + 12;
+    p_idx->i_movi_end = 0;
+    p_idx->i_avix_start = 0;
+    if( p_sys->b_odml )
+    {
+        avi_chunk_list_t *p_sysx = AVI_ChunkFind( &p_sys->ck_root,
+                                                  AVIFOURCC_RIFF, 1, true );
+        if( p_sysx )
+            p_idx->i_avix_start = p_sysx->i_chunk_pos + 24;
+    }
+    else
+        p_idx->i_movi_end = __MIN( p_movi->i_chunk_pos + p_movi->i_chunk_size,
+                                   p_idx->i_stream_size );
+    p_idx->i_lastchunk_pos = 0;
+    p_idx->i_stream_mtime = 0;
+    p_idx->psz_cache = AVI_IndexCachePath( p_demux, p_idx->i_movi_start,
+                                           &p_idx->i_stream_mtime );
+    p_idx->p_dialog = NULL;
+    atomic_init( &p_idx->b_stop, false );
+    atomic_init( &p_idx->b_done, false );
+    p_idx->i_status = VLC_EGENERIC;
+    return p_idx;
+}
+
+static void AVI_IndexerDelete( avi_indexer_t *p_idx )
+{
+    if( p_idx->s != NULL && p_idx->s != ((demux_t *)p_idx->p_obj)->s )
+        vlc_stream_Delete( p_idx->s );
+    for( unsigned int i = 0; i < p_idx->i_track; i++ )
+        avi_index_Clean( &p_idx->track[i].idx );
+    free( p_idx->track );
+    free( p_idx->psz_cache );
+    free( p_idx );
+}
+
+static int AVI_IndexerRun( avi_indexer_t *p_idx )
+{
+    msg_Warn( p_idx->p_obj, "creating index from LIST-movi, will take time !" );
+
+    vlc_tick_t i_start = vlc_tick_now();
+    int i_ret = AVI_IndexerScan( p_idx );
+    if( i_ret == VLC_SUCCESS )
+    {
+        msg_Dbg( p_idx->p_obj, "index created in %"PRId64" ms",
+                 MS_FROM_VLC_TICK( vlc_tick_now() - i_start ) );
+        if( p_idx->psz_cache != NULL )
+            AVI_IndexCacheSave( p_idx );
+    }
+    return i_ret;
+}
+
+static void *AVI_IndexerThread( void *p_data )
+{
+    avi_indexer_t *p_idx = p_data;
+
+    p_idx->i_status = AVI_IndexerRun( p_idx );
+    atomic_store_explicit( &p_idx->b_done, true, memory_order_release );
+    return NULL;
+}
+
+/* Moves the entries built by the indexer to the tracks */
+static void AVI_IndexerApply( demux_t *p_demux, avi_indexer_t *p_idx )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    /* Entries found while playing are a prefix of the complete index */
+    for( unsigned int i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_track_t *tk = p_sys->track[i];
+
+        if( p_idx->track[i].idx.i_size >= tk->idx.i_size )
+        {
+            avi_index_t idx = tk->idx;
+            tk->idx = p_idx->track[i].idx;
+            p_idx->track[i].idx = idx;
+        }
+        msg_Dbg( p_demux, "stream[%u] creating %u index entries",
+                 i, tk->idx.i_size );
+    }
+    p_sys->i_movi_lastchunk_pos = __MAX( p_sys->i_movi_lastchunk_pos,
+                                         p_idx->i_lastchunk_pos );
+}
+
+/* Installs the index once the background indexer is done */
+static void AVI_IndexerPoll( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_indexer_t *p_idx = p_sys->p_indexer;
+
+    if( p_idx == NULL
+     || !atomic_load_explicit( &p_idx->b_done, memory_order_acquire ) )
+        return;
+
+    vlc_join( p_idx->thread, NULL );
+    if( p_idx->i_status == VLC_SUCCESS )
     {
-        msg_Dbg( p_demux, "stream[%d] creating %d index entries",
-                i_stream, p_sys->track[i_stream]->idx.i_size );
+        AVI_IndexerApply( p_demux, p_idx );
+        p_sys->i_length = AVI_MovieGetLength( p_demux );
     }
+    AVI_IndexerDelete( p_idx );
+    p_sys->p_indexer = NULL;
+}
+
+static void AVI_IndexerStop( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_indexer_t *p_idx = p_sys->p_indexer;
+
+    if( p_idx == NULL )
+        return;
+
+    atomic_store_explicit( &p_idx->b_stop, true, memory_order_relaxed );
+    vlc_join( p_idx->thread, NULL );
+    AVI_IndexerDelete( p_idx );
+    p_sys->p_indexer = NULL;
+}
+
+static bool AVI_IndexCreateBackground( demux_t *p_demux, avi_indexer_t *p_idx )
+{
+    if( !var_InheritBool( p_demux, "avi-index-background" )
+     || p_demux->psz_url == NULL )
+        return false;
+
+    /* The indexer reads through its own stream, while the demuxer plays */
+    p_idx->s = vlc_stream_NewURL( p_demux, p_demux->psz_url );
+    if( p_idx->s == NULL )
+        return false;
+
+    if( vlc_clone( &p_idx->thread, AVI_IndexerThread, p_idx,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_stream_Delete( p_idx->s );
+        p_idx->s = p_demux->s;
+        return false;
+    }
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    msg_Dbg( p_demux, "creating index in the background" );
+    p_sys->p_indexer = p_idx;
+    return true;
+}
+
+static void AVI_IndexCreate( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->p_indexer != NULL )
+        return;
+
+    avi_indexer_t *p_idx = AVI_IndexerNew( p_demux );
+    if( p_idx == NULL )
+        return;
+
+    for( unsigned int i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_index_Clean( &p_sys->track[i]->idx );
+        avi_index_Init( &p_sys->track[i]->idx );
+    }
+
+    if( p_idx->psz_cache != NULL && !AVI_IndexCacheLoad( p_idx ) )
+        goto done;
+
+    /* Only index large files in the background, or show a dialog */
+    if( p_idx->i_stream_size > 10000000 )
+    {
+        if( AVI_IndexCreateBackground( p_demux, p_idx ) )
+            return;
+
+        p_idx->p_dialog =
+            vlc_dialog_display_progress( p_demux, false, 0.0, _("Cancel"),
+                                         _("Broken or missing AVI Index"),
+                                         _("Fixing AVI Index...") );
+    }
+
+    AVI_IndexerRun( p_idx );
+
+    if( p_idx->p_dialog != NULL )
+        vlc_dialog_release( p_demux, p_idx->p_dialog );
+
+done:
+    /* Even an interrupted scan provides a partial index */
+    AVI_IndexerApply( p_demux, p_idx );
+    AVI_IndexerDelete( p_idx );
 }
 
 /* */
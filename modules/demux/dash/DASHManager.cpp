@@ -43,6 +43,7 @@
 #include "../adaptive/tools/Retrieve.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <ctime>
 
 using namespace dash;
@@ -56,10 +57,13 @@ DASHManager::DASHManager(demux_t *demux_,
                          AbstractAdaptationLogic::LogicType type) :
              PlaylistManager(demux_, auth, mpd, factory, type)
 {
+    lastManifest = NULL;
 }
 
 DASHManager::~DASHManager   ()
 {
+    if(lastManifest)
+        block_Release(lastManifest);
 }
 
 void DASHManager::scheduleNextUpdate()
@@ -106,6 +110,15 @@ bool DASHManager::updatePlaylist()
         if(!p_block)
             return false;
 
+        /* Servers often republish the same manifest many times before the
+         * next segment is available. Don't parse and merge it again. */
+        if(lastManifest && lastManifest->i_buffer == p_block->i_buffer &&
+           !memcmp(lastManifest->p_buffer, p_block->p_buffer, p_block->i_buffer))
+        {
+            block_Release(p_block);
+            return true;
+        }
+
         stream_t *mpdstream = vlc_stream_MemoryNew(p_demux, p_block->p_buffer, p_block->i_buffer, true);
         if(!mpdstream)
         {
@@ -114,6 +127,8 @@ bool DASHManager::updatePlaylist()
         }
 
         xml::DOMParser parser(mpdstream);
+        IsoffMainTimelineFolder folder;
+        parser.setElementListener(&folder);
         if(!parser.parse(true))
         {
             vlc_stream_Delete(mpdstream);
@@ -137,9 +152,16 @@ bool DASHManager::updatePlaylist()
         {
             playlist->mergeWith(newmpd, minsegmentTime);
             delete newmpd;
+            /* Only a manifest that made it into the playlist can be skipped */
+            if(lastManifest)
+                block_Release(lastManifest);
+            lastManifest = p_block;
+        }
+        else
+        {
+            block_Release(p_block);
         }
         vlc_stream_Delete(mpdstream);
-        block_Release(p_block);
     }
 
     return true;
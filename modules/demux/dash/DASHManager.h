@@ -59,6 +59,9 @@ namespace dash
 
         protected:
             virtual int doControl(int, va_list); /* reimpl */
+
+        private:
+            block_t *lastManifest; /* last refreshed MPD, to skip unchanged ones */
     };
 
 }
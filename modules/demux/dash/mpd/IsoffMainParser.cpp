@@ -44,8 +44,10 @@
 #include "../adaptive/tools/Debug.hpp"
 #include "../adaptive/tools/Conversions.hpp"
 #include <vlc_stream.h>
+#include <vlc_charset.h>
 #include <cstdio>
 #include <limits>
+#include <sstream>
 
 using namespace dash::mpd;
 using namespace adaptive::xml;
@@ -179,6 +181,14 @@ size_t IsoffMainParser::parseSegmentTemplate(Node *templateNode, SegmentInformat
     if(templateNode->hasAttribute("duration"))
         mediaTemplate->duration.Set(Integer<stime_t>(templateNode->getAttributeValue("duration")));
 
+    if(templateNode->hasAttribute("availabilityTimeOffset"))
+    {
+        /* INF would mean always available, which does not apply to live */
+        double offset = us_strtod(templateNode->getAttributeValue("availabilityTimeOffset").c_str(), NULL);
+        if(offset > 0 && offset < std::numeric_limits<int32_t>::max())
+            mediaTemplate->availabilityTimeOffset.Set(vlc_tick_from_sec(offset));
+    }
+
     InitSegmentTemplate *initTemplate = NULL;
 
     if(templateNode->hasAttribute("initialization"))
@@ -487,6 +497,52 @@ void IsoffMainParser::parseTimeline(Node *node, MediaSegmentTemplate *templ)
     }
 }
 
+bool IsoffMainTimelineFolder::elementEnded(Node *parent, Node *s)
+{
+    if(s->getName() != "S" || parent->getName() != "SegmentTimeline" ||
+       parent->getSubNodes().empty())
+        return false;
+
+    Node *prev = parent->getSubNodes().back();
+    if(prev->getName() != "S")
+        return false;
+    const std::map<std::string, std::string> &attrs = s->getAttributes();
+    const std::map<std::string, std::string> &prevattrs = prev->getAttributes();
+
+    /* Only fold plain entries, without any attribute we would lose */
+    std::map<std::string, std::string>::const_iterator it;
+    for(it = attrs.begin(); it != attrs.end(); ++it)
+        if((*it).first != "d" && (*it).first != "r" && (*it).first != "t")
+            return false;
+    for(it = prevattrs.begin(); it != prevattrs.end(); ++it)
+        if((*it).first != "d" && (*it).first != "r" && (*it).first != "t")
+            return false;
+
+    if(!s->hasAttribute("d") || s->getAttributeValue("d") != prev->getAttributeValue("d"))
+        return false;
+
+    const stime_t d = Integer<stime_t>(s->getAttributeValue("d"));
+    const int64_t r = s->hasAttribute("r") ? Integer<int64_t>(s->getAttributeValue("r")) : 0;
+    const int64_t prevr = prev->hasAttribute("r") ? Integer<int64_t>(prev->getAttributeValue("r")) : 0;
+    if(d <= 0 || r < 0 || prevr < 0 || r + prevr + 1 >= std::numeric_limits<unsigned>::max())
+        return false;
+
+    /* An explicit time must match the end of the previous entry */
+    if(s->hasAttribute("t"))
+    {
+        if(!prev->hasAttribute("t") ||
+           Integer<stime_t>(s->getAttributeValue("t")) !=
+           Integer<stime_t>(prev->getAttributeValue("t")) + d * (prevr + 1))
+            return false;
+    }
+
+    std::ostringstream os;
+    os.imbue(std::locale("C"));
+    os << (prevr + r + 1);
+    prev->addAttribute("r", os.str());
+    return true;
+}
+
 void IsoffMainParser::parseProgramInformation(Node * node, MPD *mpd)
 {
     if(!node)
@@ -30,6 +30,7 @@
 #endif
 
 #include "../adaptive/playlist/SegmentInfoCommon.h"
+#include "../adaptive/xml/DOMParser.h"
 #include "Profile.hpp"
 
 #include <cstdlib>
@@ -60,6 +61,14 @@ namespace dash
         using namespace adaptive::playlist;
         using namespace adaptive;
 
+        /* Folds SegmentTimeline entries into repeated ones while the MPD is
+         * read, so that the document tree does not grow with the timeline */
+        class IsoffMainTimelineFolder : public xml::DOMElementListener
+        {
+            public:
+                virtual bool elementEnded(xml::Node *, xml::Node *); /* impl */
+        };
+
         class IsoffMainParser
         {
             public:
@@ -171,7 +171,19 @@ void M3U8Parser::createAndFillRepresentation(vlc_object_t *p_obj, BaseAdaptation
 
 bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representation *rep)
 {
-    block_t *p_block = Retrieve::HTTP(p_obj, auth, rep->getPlaylistUrl().toString());
+    std::string uri = rep->getPlaylistUrl().toString();
+    if(rep->b_loaded && rep->b_live && rep->b_blockreload)
+    {
+        /* Low latency blocking reload, returning once the next
+         * media sequence is available */
+        std::ostringstream os;
+        os.imbue(std::locale("C"));
+        os << ((uri.find('?') == std::string::npos) ? '?' : '&')
+           << "_HLS_msn=" << rep->nextSequence;
+        uri.append(os.str());
+    }
+
+    block_t *p_block = Retrieve::HTTP(p_obj, auth, uri);
     if(p_block)
     {
         stream_t *substream = vlc_stream_MemoryNew(p_obj, p_block->p_buffer, p_block->i_buffer, true);
@@ -194,8 +206,13 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
 {
     SegmentList *segmentList = new (std::nothrow) SegmentList(rep);
 
+    /* On refreshes, only the new segments need to be created */
+    const bool b_refresh = rep->b_loaded && rep->nextSequence > 0;
+    const uint64_t knownSequence = rep->nextSequence - 1;
+
     rep->setTimescale(100);
     rep->b_loaded = true;
+    rep->b_blockreload = false;
 
     vlc_tick_t totalduration = 0;
     vlc_tick_t nzStartTime = 0;
@@ -236,14 +253,6 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
                     break;
                 }
 
-                HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber++);
-                if(!segment)
-                    break;
-
-                segment->setSourceUrl(uritag->getValue().value);
-                if((unsigned)rep->getStreamFormat() == StreamFormat::UNKNOWN)
-                    setFormatFromExtension(rep, uritag->getValue().value);
-
                 /* Need to use EXTXTARGETDURATION as default as some can't properly set segment one */
                 double duration = rep->targetDuration;
                 if(ctx_extinf)
@@ -254,6 +263,36 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
                     ctx_extinf = NULL;
                 }
                 const vlc_tick_t nzDuration = vlc_tick_from_sec( duration );
+
+                if(b_refresh && sequenceNumber <= knownSequence)
+                {
+                    /* Already in the list, and would be dropped by the merge:
+                     * only keep track of the timings and offsets */
+                    sequenceNumber++;
+                    nzStartTime += nzDuration;
+                    totalduration += nzDuration;
+                    if(absReferenceTime != VLC_TICK_INVALID)
+                        absReferenceTime += nzDuration;
+                    if(ctx_byterange)
+                    {
+                        std::pair<std::size_t,std::size_t> range = ctx_byterange->getValue().getByteRange();
+                        if(range.first == 0)
+                            range.first = prevbyterangeoffset;
+                        prevbyterangeoffset = range.first + range.second;
+                        ctx_byterange = NULL;
+                    }
+                    discontinuity = false;
+                    break;
+                }
+
+                HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber++);
+                if(!segment)
+                    break;
+
+                segment->setSourceUrl(uritag->getValue().value);
+                if((unsigned)rep->getStreamFormat() == StreamFormat::UNKNOWN)
+                    setFormatFromExtension(rep, uritag->getValue().value);
+
                 segment->duration.Set(duration * (uint64_t) rep->getTimescale());
                 segment->startTime.Set(rep->getTimescale().ToScaled(nzStartTime));
                 nzStartTime += nzDuration;
@@ -367,12 +406,22 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
                 discontinuity  = true;
                 break;
 
+            case AttributesTag::EXTXSERVERCONTROL:
+            {
+                const Attribute *blockAttr = static_cast<const AttributesTag *>(tag)
+                                             ->getAttributeByName("CAN-BLOCK-RELOAD");
+                rep->b_blockreload = (blockAttr && blockAttr->value == "YES");
+            }
+            break;
+
             case Tag::EXTXENDLIST:
                 rep->b_live = false;
                 break;
         }
     }
 
+    rep->nextSequence = sequenceNumber;
+
     if(rep->isLive())
     {
         rep->getPlaylist()->duration.Set(0);
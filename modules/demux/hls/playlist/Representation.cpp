@@ -42,6 +42,8 @@ Representation::Representation  ( BaseAdaptationSet *set ) :
 {
     b_live = true;
     b_loaded = false;
+    b_blockreload = false;
+    nextSequence = 0;
     switchpolicy = SegmentInformation::SWITCH_SEGMENT_ALIGNED; /* FIXME: based on streamformat */
     nextUpdateTime = 0;
     targetDuration = 0;
@@ -107,9 +109,18 @@ void Representation::scheduleNextUpdate(uint64_t number)
     /* Compute new update time */
     vlc_tick_t minbuffer = getMinAheadTime(number);
 
+    if(b_blockreload)
+    {
+        /* The server holds blocking reloads until the next segment is
+         * published, so we can reload as soon as we reach the last one */
+        if(minbuffer > vlc_tick_from_sec( targetDuration ))
+            minbuffer -= vlc_tick_from_sec( targetDuration );
+        else
+            minbuffer = 0;
+    }
     /* Update frequency must always be at least targetDuration (if any)
      * but we need to update before reaching that last segment, thus -1 */
-    if(targetDuration)
+    else if(targetDuration)
     {
         if(minbuffer > vlc_tick_from_sec( 2 * targetDuration + 1 ))
             minbuffer -= vlc_tick_from_sec( targetDuration + 1 );
@@ -57,6 +57,8 @@ namespace hls
                 StreamFormat streamFormat;
                 bool b_live;
                 bool b_loaded;
+                bool b_blockreload;
+                uint64_t nextSequence; /* first sequence not in the playlist yet */
                 time_t nextUpdateTime;
                 time_t targetDuration;
                 Url playlistUrl;
@@ -97,6 +97,7 @@ namespace hls
                     EXTXMAP,
                     EXTXMEDIA,
                     EXTXSTREAMINF,
+                    EXTXSERVERCONTROL,
                 };
                 AttributesTag(int, const std::string &);
                 virtual ~AttributesTag();
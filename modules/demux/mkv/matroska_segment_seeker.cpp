@@ -62,7 +62,7 @@ SegmentSeeker::add_cluster_position( fptr_t fpos )
     return _cluster_positions.insert( insertion_point, fpos );
 }
 
-SegmentSeeker::cluster_map_t::iterator
+SegmentSeeker::clusters_t::iterator
 SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
 {
     Cluster cinfo = {
@@ -76,15 +76,15 @@ SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
 
     add_cluster_position( cinfo.fpos );
 
-    cluster_map_t::iterator it = _clusters.lower_bound( cinfo.pts );
+    clusters_t::iterator it = std::lower_bound( _clusters.begin(), _clusters.end(), cinfo );
 
-    if( it != _clusters.end() && it->second.pts == cinfo.pts )
+    if( it != _clusters.end() && it->pts == cinfo.pts )
     {
         // cluster already known
     }
     else
     {
-        it = _clusters.insert( cluster_map_t::value_type( cinfo.pts, cinfo ) ).first;
+        it = _clusters.insert( it, cinfo );
     }
 
     // ------------------------------------------------------------------
@@ -101,12 +101,12 @@ SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
 
     if( it != _clusters.begin() )
     {
-        Duration::fix( prev_( it )->second, it->second );
+        Duration::fix( *prev_( it ), *it );
     }
 
     if( it != _clusters.end() && next_( it ) != _clusters.end() )
     {
-        Duration::fix( it->second, next_( it )->second );
+        Duration::fix( *it, *next_( it ) );
     }
 
     return it;
@@ -115,7 +115,8 @@ SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
 void
 SegmentSeeker::add_seekpoint( track_id_t track_id, Seekpoint sp )
 {
-    seekpoints_t&  seekpoints = _tracks_seekpoints[ track_id ];
+    TrackSeekpoints& track = _tracks_seekpoints[ track_id ];
+    seekpoints_t&  seekpoints = track.all;
     seekpoints_t::iterator it = std::lower_bound( seekpoints.begin(), seekpoints.end(), sp );
 
     if( it != seekpoints.end() && it->pts == sp.pts )
@@ -129,6 +130,17 @@ SegmentSeeker::add_seekpoint( track_id_t track_id, Seekpoint sp )
     {
         seekpoints.insert( it, sp );
     }
+
+    if( sp.trust_level >= Seekpoint::TRUSTED )
+    {
+        seekpoints_t& trusted = track.trusted;
+        it = std::lower_bound( trusted.begin(), trusted.end(), sp );
+
+        if( it != trusted.end() && it->pts == sp.pts )
+            *it = sp;
+        else
+            trusted.insert( it, sp );
+    }
 }
 
 SegmentSeeker::tracks_seekpoint_t
@@ -173,31 +185,22 @@ SegmentSeeker::find_greatest_seekpoints_in_range( fptr_t start_fpos, vlc_tick_t
 }
 
 SegmentSeeker::Seekpoint
-SegmentSeeker::get_first_seekpoint_around( vlc_tick_t pts, seekpoints_t const& seekpoints,
-                                           Seekpoint::TrustLevel trust_level )
+SegmentSeeker::get_first_seekpoint_around( vlc_tick_t pts, TrackSeekpoints const& track )
 {
-    if( seekpoints.empty() )
+    if( track.all.empty() )
     {
         return Seekpoint();
     }
 
-    typedef seekpoints_t::const_iterator iterator;
-
     Seekpoint const needle ( std::numeric_limits<fptr_t>::max(), pts );
 
-    iterator const it_begin  = seekpoints.begin();
-    iterator const it_end    = seekpoints.end();
-    iterator const it_middle = greatest_lower_bound( it_begin, it_end, needle );
+    // _previous_ trusted seekpoint, if any, or the first known one
+    seekpoints_t::const_iterator it = std::upper_bound( track.trusted.begin(), track.trusted.end(), needle );
 
-    iterator it_before;
+    if( it == track.trusted.begin() )
+        return track.all.front();
 
-    // rewrind to _previous_ seekpoint with appropriate trust
-    for( it_before = it_middle; it_before != it_begin; --it_before )
-    {
-        if( it_before->trust_level >= trust_level )
-            return *it_before;
-    }
-    return *it_begin;
+    return *--it;
 }
 
 SegmentSeeker::seekpoint_pair_t
@@ -245,7 +248,7 @@ SegmentSeeker::get_seekpoints_around( vlc_tick_t target_pts, track_ids_t const&
 
         for( track_iterator it = begin; it != end; ++it )
         {
-            seekpoint_pair_t track_points = get_seekpoints_around( target_pts, _tracks_seekpoints[ *it ] );
+            seekpoint_pair_t track_points = get_seekpoints_around( target_pts, _tracks_seekpoints[ *it ].all );
 
             if( it == begin ) {
                 points = track_points;
@@ -264,11 +267,12 @@ SegmentSeeker::get_seekpoints_around( vlc_tick_t target_pts, track_ids_t const&
 
     { // check if we got a cluster which is closer to target_pts than the found cues //
 
-        cluster_map_t::iterator it = _clusters.lower_bound( target_pts );
+        Cluster const needle = { 0, target_pts, 0, 0 };
+        clusters_t::const_iterator it = std::lower_bound( _clusters.begin(), _clusters.end(), needle );
 
         if( it != _clusters.begin() && --it != _clusters.end() )
         {
-            Cluster const& cluster = it->second;
+            Cluster const& cluster = *it;
 
             if( cluster.fpos > points.first.fpos )
             {
@@ -85,6 +85,11 @@ class SegmentSeeker
             vlc_tick_t pts;
             vlc_tick_t duration;
             fptr_t  size;
+
+            bool operator<( Cluster const& rhs ) const
+            {
+                return pts < rhs.pts;
+            }
         };
 
     public:
@@ -93,23 +98,30 @@ class SegmentSeeker
         typedef std::vector<Seekpoint> seekpoints_t;
         typedef std::vector<fptr_t> cluster_positions_t;
 
+        /* Both sorted by pts, the trusted seekpoints are also kept on their
+         * own so that looking one up does not need to skip the others */
+        struct TrackSeekpoints {
+            seekpoints_t all;
+            seekpoints_t trusted;
+        };
+
         typedef std::map<track_id_t, Seekpoint> tracks_seekpoint_t;
-        typedef std::map<track_id_t, seekpoints_t> tracks_seekpoints_t;
-        typedef std::map<vlc_tick_t, Cluster> cluster_map_t;
+        typedef std::map<track_id_t, TrackSeekpoints> tracks_seekpoints_t;
+        typedef std::vector<Cluster> clusters_t; /* sorted by pts */
 
         typedef std::pair<Seekpoint, Seekpoint> seekpoint_pair_t;
 
         void add_seekpoint( track_id_t, Seekpoint );
 
         seekpoint_pair_t get_seekpoints_around( vlc_tick_t, seekpoints_t const& );
-        Seekpoint get_first_seekpoint_around( vlc_tick_t, seekpoints_t const&, Seekpoint::TrustLevel = Seekpoint::TRUSTED );
+        Seekpoint get_first_seekpoint_around( vlc_tick_t, TrackSeekpoints const& );
         seekpoint_pair_t get_seekpoints_around( vlc_tick_t, track_ids_t const& );
 
         tracks_seekpoint_t get_seekpoints( matroska_segment_c&, vlc_tick_t, track_ids_t const&, track_ids_t const& );
         tracks_seekpoint_t find_greatest_seekpoints_in_range( fptr_t , vlc_tick_t, track_ids_t const& filter_tracks );
 
         cluster_positions_t::iterator add_cluster_position( fptr_t pos );
-        cluster_map_t      ::iterator add_cluster( KaxCluster * const );
+        clusters_t         ::iterator add_cluster( KaxCluster * const );
 
         void mkv_jump_to( matroska_segment_c&, fptr_t );
 
@@ -123,7 +135,7 @@ class SegmentSeeker
         ranges_t            _ranges_searched;
         tracks_seekpoints_t _tracks_seekpoints;
         cluster_positions_t _cluster_positions;
-        cluster_map_t       _clusters;
+        clusters_t          _clusters;
 };
 
 } // namespace
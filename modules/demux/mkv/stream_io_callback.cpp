@@ -32,21 +32,54 @@ vlc_stream_io_callback::vlc_stream_io_callback( stream_t *s_, bool b_owner_ )
                        : s( s_), b_owner( b_owner_ )
 {
     mb_eof = false;
+    i_buffered = 0;
+    i_read = 0;
 }
 
-uint32 vlc_stream_io_callback::read( void *p_buffer, size_t i_size )
+uint32 vlc_stream_io_callback::read( void *p_dst, size_t i_size )
 {
     if( i_size <= 0 || mb_eof )
         return 0;
 
-    int i_ret = vlc_stream_Read( s, p_buffer, i_size );
-    return i_ret < 0 ? 0 : i_ret;
+    uint8_t *p_out = static_cast<uint8_t *>( p_dst );
+    size_t i_done = 0;
+
+    while( i_done < i_size )
+    {
+        if( i_read < i_buffered )
+        {
+            size_t i_copy = __MIN( i_size - i_done, i_buffered - i_read );
+            memcpy( p_out + i_done, p_buffer + i_read, i_copy );
+            i_read += i_copy;
+            i_done += i_copy;
+            continue;
+        }
+
+        i_buffered = i_read = 0;
+
+        /* large payloads are read straight into the destination */
+        if( i_size - i_done >= sizeof( p_buffer ) )
+        {
+            ssize_t i_ret = vlc_stream_Read( s, p_out + i_done, i_size - i_done );
+            if( i_ret > 0 )
+                i_done += i_ret;
+            break;
+        }
+
+        /* do not wait for more data than requested on live streams */
+        ssize_t i_ret = vlc_stream_ReadPartial( s, p_buffer, sizeof( p_buffer ) );
+        if( i_ret <= 0 )
+            break;
+        i_buffered = i_ret;
+    }
+
+    return i_done;
 }
 
 void vlc_stream_io_callback::setFilePointer(int64_t i_offset, seek_mode mode )
 {
     int64_t i_pos, i_size;
-    int64_t i_current = vlc_stream_Tell( s );
+    int64_t i_current = getFilePointer();
 
     switch( mode )
     {
@@ -68,11 +101,22 @@ void vlc_stream_io_callback::setFilePointer(int64_t i_offset, seek_mode mode )
             // if previous setFilePointer() failed we may be back in the available data
             i_size = stream_Size( s );
             if ( i_size != 0 && i_pos < i_size )
+            {
+                i_buffered = i_read = 0;
                 mb_eof = vlc_stream_Seek( s, i_pos ) != VLC_SUCCESS;
+            }
         }
         return;
     }
 
+    /* still within the read-ahead */
+    int64_t i_buffer_start = vlc_stream_Tell( s ) - i_buffered;
+    if( !mb_eof && i_pos >= i_buffer_start && i_pos < i_buffer_start + (int64_t) i_buffered )
+    {
+        i_read = i_pos - i_buffer_start;
+        return;
+    }
+
     if( i_pos < 0 || ( ( i_size = stream_Size( s ) ) != 0 && i_pos >= i_size ) )
     {
         mb_eof = true;
@@ -80,6 +124,7 @@ void vlc_stream_io_callback::setFilePointer(int64_t i_offset, seek_mode mode )
     }
 
     mb_eof = false;
+    i_buffered = i_read = 0;
     if( vlc_stream_Seek( s, i_pos ) )
     {
         mb_eof = true;
@@ -91,7 +136,7 @@ uint64 vlc_stream_io_callback::getFilePointer( void )
 {
     if ( s == NULL )
         return 0;
-    return vlc_stream_Tell( s );
+    return vlc_stream_Tell( s ) - ( i_buffered - i_read );
 }
 
 size_t vlc_stream_io_callback::write(const void *, size_t )
@@ -111,7 +156,7 @@ uint64 vlc_stream_io_callback::toRead( void )
     if( i_size <= 0 )
         return UINT64_MAX;
 
-    return static_cast<uint64>( i_size - vlc_stream_Tell( s ) );
+    return static_cast<uint64>( i_size - getFilePointer() );
 }
 
 } // namespace
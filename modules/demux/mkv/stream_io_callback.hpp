@@ -46,6 +46,12 @@ class vlc_stream_io_callback: public IOCallback
     bool           mb_eof;
     bool           b_owner;
 
+    /* read-ahead of the stream, so that the many small reads of the EBML
+     * headers do not each go down the stream chain */
+    uint8_t        p_buffer[65536];
+    size_t         i_buffered; /* valid bytes, ending at the stream position */
+    size_t         i_read; /* bytes of the buffer already read */
+
   public:
     vlc_stream_io_callback( stream_t *, bool owner );
 
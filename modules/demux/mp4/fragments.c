@@ -22,6 +22,7 @@
 #endif
 
 #include "fragments.h"
+#include <assert.h>
 #include <limits.h>
 
 void MP4_Fragments_Index_Delete( mp4_fragments_index_t *p_index )
@@ -30,6 +31,7 @@ void MP4_Fragments_Index_Delete( mp4_fragments_index_t *p_index )
     {
         free( p_index->pi_pos );
         free( p_index->p_times );
+        free( p_index->p_next_times );
         free( p_index );
     }
 }
@@ -43,31 +45,75 @@ mp4_fragments_index_t * MP4_Fragments_Index_New( unsigned i_tracks, unsigned i_n
     {
         p_index->p_times = calloc( (size_t)i_num * i_tracks, sizeof(*p_index->p_times) );
         p_index->pi_pos = calloc( i_num, sizeof(*p_index->pi_pos) );
-        if( !p_index->p_times || !p_index->pi_pos )
+        p_index->p_next_times = calloc( i_tracks, sizeof(*p_index->p_next_times) );
+        if( !p_index->p_times || !p_index->pi_pos || !p_index->p_next_times )
         {
             MP4_Fragments_Index_Delete( p_index );
             return NULL;
         }
-        p_index->i_entries = i_num;
+        p_index->i_entries = 0;
+        p_index->i_max = i_num;
         p_index->i_last_time = 0;
         p_index->i_tracks = i_tracks;
     }
     return p_index;
 }
 
-stime_t MP4_Fragment_Index_GetTrackStartTime( mp4_fragments_index_t *p_index,
-                                              unsigned i_track_index, uint64_t i_moof_pos )
+stime_t * MP4_Fragments_Index_Append( mp4_fragments_index_t *p_index, uint64_t i_pos )
 {
-    for( size_t i=0; i<p_index->i_entries; i++ )
+    assert( p_index->i_entries == 0 ||
+            p_index->pi_pos[p_index->i_entries - 1] < i_pos );
+
+    if( p_index->i_entries == p_index->i_max )
     {
-        if( p_index->pi_pos[i] >= i_moof_pos )
-            return p_index->p_times[i * p_index->i_tracks + i_track_index];
+        if( p_index->i_max > UINT_MAX / 2 ||
+            SIZE_MAX / (p_index->i_max * 2) < p_index->i_tracks )
+            return NULL;
+        const unsigned i_max = p_index->i_max * 2;
+
+        uint64_t *pi_pos = realloc( p_index->pi_pos, sizeof(*pi_pos) * i_max );
+        if( !pi_pos )
+            return NULL;
+        p_index->pi_pos = pi_pos;
+
+        stime_t *p_times = realloc( p_index->p_times,
+                                    sizeof(*p_times) * i_max * p_index->i_tracks );
+        if( !p_times )
+            return NULL;
+        p_index->p_times = p_times;
+        p_index->i_max = i_max;
     }
-    return 0;
+
+    stime_t *p_times = &p_index->p_times[(size_t)p_index->i_entries * p_index->i_tracks];
+    p_index->pi_pos[p_index->i_entries++] = i_pos;
+    return p_times;
+}
+
+bool MP4_Fragment_Index_GetTrackStartTime( mp4_fragments_index_t *p_index,
+                                           unsigned i_track_index, uint64_t i_moof_pos,
+                                           stime_t *pi_time )
+{
+    /* first entry at or after i_moof_pos */
+    size_t i_low = 0, i_high = p_index->i_entries;
+    while( i_low < i_high )
+    {
+        size_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_index->pi_pos[i_mid] < i_moof_pos )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    if( i_low == p_index->i_entries )
+        return false;
+
+    *pi_time = p_index->p_times[i_low * p_index->i_tracks + i_track_index];
+    return true;
 }
 
 stime_t MP4_Fragment_Index_GetTrackDuration( mp4_fragments_index_t *p_index, unsigned i )
 {
+    if( p_index->i_entries == 0 )
+        return 0;
     return p_index->p_times[(size_t)(p_index->i_entries - 1) * p_index->i_tracks + i];
 }
 
@@ -78,14 +124,22 @@ bool MP4_Fragments_Index_Lookup( mp4_fragments_index_t *p_index, stime_t *pi_tim
         i_track_index >= p_index->i_tracks )
         return false;
 
-    for( size_t i=1; i<p_index->i_entries; i++ )
+    /* first entry starting after the time */
+    size_t i_low = 1, i_high = p_index->i_entries;
+    while( i_low < i_high )
     {
-        if( p_index->p_times[i * p_index->i_tracks + i_track_index] > *pi_time )
-        {
-            *pi_time = p_index->p_times[(i - 1) * p_index->i_tracks + i_track_index];
-            *pi_pos = p_index->pi_pos[i - 1];
-            return true;
-        }
+        size_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_index->p_times[i_mid * p_index->i_tracks + i_track_index] > *pi_time )
+            i_high = i_mid;
+        else
+            i_low = i_mid + 1;
+    }
+
+    if( i_low < p_index->i_entries )
+    {
+        *pi_time = p_index->p_times[(i_low - 1) * p_index->i_tracks + i_track_index];
+        *pi_pos = p_index->pi_pos[i_low - 1];
+        return true;
     }
 
     *pi_time = p_index->p_times[(size_t)(p_index->i_entries - 1) * p_index->i_tracks];
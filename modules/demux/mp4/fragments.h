@@ -23,20 +23,28 @@
 #include <vlc_common.h>
 #include "libmp4.h"
 
+/* Index of the fragments from the first one of the file, either probed or
+ * built while reading them in sequence. Entries are sorted by position. */
 typedef struct mp4_fragments_index_t
 {
     uint64_t *pi_pos;
     stime_t  *p_times; // movie scaled
     unsigned i_entries;
+    unsigned i_max;
     stime_t i_last_time; // movie scaled
+    stime_t *p_next_times; // track scaled, end of the last entry
     unsigned i_tracks;
 } mp4_fragments_index_t;
 
 void MP4_Fragments_Index_Delete( mp4_fragments_index_t *p_index );
 mp4_fragments_index_t * MP4_Fragments_Index_New( unsigned i_tracks, unsigned i_num );
 
-stime_t MP4_Fragment_Index_GetTrackStartTime( mp4_fragments_index_t *p_index,
-                                              unsigned i_track_index, uint64_t i_moof_pos );
+/* Adds an entry after the last one, returns the i_tracks start times to set */
+stime_t * MP4_Fragments_Index_Append( mp4_fragments_index_t *p_index, uint64_t i_pos );
+
+bool MP4_Fragment_Index_GetTrackStartTime( mp4_fragments_index_t *p_index,
+                                           unsigned i_track_index, uint64_t i_moof_pos,
+                                           stime_t *pi_time );
 stime_t MP4_Fragment_Index_GetTrackDuration( mp4_fragments_index_t *p_index, unsigned i_track_index );
 
 bool MP4_Fragments_Index_Lookup( mp4_fragments_index_t *p_index,
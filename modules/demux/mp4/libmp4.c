@@ -362,6 +362,47 @@ static int MP4_PeekBoxHeader( stream_t *p_stream, MP4_Box_t *p_box )
     return 1;
 }
 
+/* Checks against the set of payloads the root is read without */
+static bool MP4_BoxIsDeferrable( const MP4_Box_t *p_box )
+{
+    const MP4_Box_t *p_father = p_box->p_father;
+    const MP4_Box_t *p_root = p_father;
+    while( p_root && p_root->p_father )
+        p_root = p_root->p_father;
+    if( !p_root || p_root->i_type != ATOM_root )
+        return false;
+
+    if( (p_root->e_flags & BOX_FLAG_DEFER_SAMPLETABLES) &&
+        p_father->i_type == ATOM_stbl )
+    {
+        switch( p_box->i_type )
+        {
+            case ATOM_stsc:
+            case ATOM_ctts:
+            case ATOM_cslg:
+            case ATOM_stsz:
+            case ATOM_stz2:
+            case ATOM_stco:
+            case ATOM_co64:
+            case ATOM_stss:
+            case ATOM_stsh:
+            case ATOM_sdtp:
+            case ATOM_sbgp:
+            case ATOM_sgpd:
+                return true;
+            default:
+                break;
+        }
+    }
+
+    if( (p_root->e_flags & BOX_FLAG_DEFER_USERDATA) &&
+        ( p_box->i_type == ATOM_udta || p_box->i_type == ATOM_meta ) &&
+        ( p_father == p_root || p_father->i_type == ATOM_moov ) )
+        return true;
+
+    return false;
+}
+
 /*****************************************************************************
  * MP4_ReadBoxRestricted : Reads box from current position
  *****************************************************************************
@@ -423,7 +464,12 @@ static MP4_Box_t *MP4_ReadBoxRestricted( stream_t *p_stream, MP4_Box_t *p_father
 
     const uint64_t i_next = p_box->i_pos + p_box->i_size;
     p_box->p_father = p_father;
-    if( MP4_Box_Read_Specific( p_stream, p_box, p_father ) != VLC_SUCCESS )
+    if( MP4_BoxIsDeferrable( p_box ) )
+    {
+        /* only keep the header, it will be skipped below */
+        p_box->e_flags |= BOX_FLAG_DEFERRED;
+    }
+    else if( MP4_Box_Read_Specific( p_stream, p_box, p_father ) != VLC_SUCCESS )
     {
         msg_Warn( p_stream, "Failed reading box %4.4s", (char*) &peekbox.i_type );
         MP4_BoxFree( p_box );
@@ -5333,6 +5379,11 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t *s )
  *  level boxes for the file, a sort of virtual contener
  *****************************************************************************/
 MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
+{
+    return MP4_BoxGetRootDeferred( p_stream, 0 );
+}
+
+MP4_Box_t *MP4_BoxGetRootDeferred( stream_t *p_stream, int i_defer )
 {
     int i_result;
 
@@ -5341,6 +5392,13 @@ MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
         return NULL;
 
     p_vroot->i_shortsize = 1;
+
+    /* Deferred boxes are loaded later by seeking back */
+    bool b_canseek;
+    if( i_defer &&
+        vlc_stream_Control( p_stream, STREAM_CAN_SEEK, &b_canseek ) == VLC_SUCCESS &&
+        b_canseek )
+        p_vroot->e_flags = i_defer & (BOX_FLAG_DEFER_SAMPLETABLES|BOX_FLAG_DEFER_USERDATA);
     uint64_t i_size;
     if( vlc_stream_GetSize( p_stream, &i_size ) == 0 )
         p_vroot->i_size = i_size;
@@ -5421,6 +5479,56 @@ error:
     return NULL;
 }
 
+static int MP4_BoxLoadDeferredInternal( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    if( p_box->e_flags & BOX_FLAG_DEFERRED )
+    {
+        p_box->e_flags &= ~BOX_FLAG_DEFERRED;
+        if( MP4_Seek( p_stream, p_box->i_pos ) == VLC_SUCCESS &&
+            MP4_Box_Read_Specific( p_stream, p_box, p_box->p_father ) == VLC_SUCCESS )
+            return VLC_SUCCESS;
+
+        msg_Warn( p_stream, "Failed reading deferred box %4.4s",
+                  (char*) &p_box->i_type );
+
+        /* keep an empty box in the tree */
+        for( MP4_Box_t *p_child = p_box->p_first; p_child != NULL; )
+        {
+            MP4_Box_t *p_next = p_child->p_next;
+            MP4_BoxFree( p_child );
+            p_child = p_next;
+        }
+        p_box->p_first = p_box->p_last = NULL;
+        if( p_box->pf_free )
+            p_box->pf_free( p_box );
+        free( p_box->data.p_payload );
+        p_box->data.p_payload = NULL;
+        p_box->pf_free = NULL;
+        return VLC_EGENERIC;
+    }
+
+    int i_ret = VLC_SUCCESS;
+    for( MP4_Box_t *p_child = p_box->p_first; p_child; p_child = p_child->p_next )
+    {
+        if( MP4_BoxLoadDeferredInternal( p_stream, p_child ) != VLC_SUCCESS )
+            i_ret = VLC_EGENERIC;
+    }
+    return i_ret;
+}
+
+int MP4_BoxLoadDeferred( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    const uint64_t i_pos = vlc_stream_Tell( p_stream );
+
+    int i_ret = MP4_BoxLoadDeferredInternal( p_stream, p_box );
+
+    if( vlc_stream_Tell( p_stream ) != i_pos &&
+        MP4_Seek( p_stream, i_pos ) != VLC_SUCCESS )
+        i_ret = VLC_EGENERIC;
+    return i_ret;
+}
+
+
 
 static void MP4_BoxDumpStructure_Internal( stream_t *s, const MP4_Box_t *p_box,
                                            unsigned int i_level )
@@ -5449,7 +5557,8 @@ static void MP4_BoxDumpStructure_Internal( stream_t *s, const MP4_Box_t *p_box,
         snprintf( &str[i_level * 4], sizeof(str) - 4*i_level,
                   "+ %4.4s size %"PRIu64" offset %"PRIu64"%s",
                   (char *)&i_displayedtype, p_box->i_size, p_box->i_pos,
-                  p_box->e_flags & BOX_FLAG_INCOMPLETE ? " (\?\?\?\?)" : "" );
+                  p_box->e_flags & BOX_FLAG_INCOMPLETE ? " (\?\?\?\?)" :
+                  p_box->e_flags & BOX_FLAG_DEFERRED ? " (deferred)" : "" );
         msg_Dbg( s, "%s", str );
     }
     p_child = p_box->p_first;
@@ -1837,7 +1837,11 @@ struct MP4_Box_s
     enum
     {
         BOX_FLAG_NONE = 0,
-        BOX_FLAG_INCOMPLETE,
+        BOX_FLAG_INCOMPLETE = 1 << 0,
+        BOX_FLAG_DEFERRED   = 1 << 1, /* not parsed yet, see MP4_BoxLoadDeferred */
+        /* root only, payloads left unparsed by MP4_BoxGetRootDeferred */
+        BOX_FLAG_DEFER_SAMPLETABLES = 1 << 2, /* stbl tables but stsd and stts */
+        BOX_FLAG_DEFER_USERDATA     = 1 << 3, /* file level udta and meta */
     }            e_flags;
 
     UUID_t       i_uuid;  /* Set if i_type == "uuid" */
@@ -1905,6 +1909,24 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t * );
  *****************************************************************************/
 MP4_Box_t *MP4_BoxGetRoot( stream_t * );
 
+/*****************************************************************************
+ * MP4_BoxGetRootDeferred : Same as MP4_BoxGetRoot, but some boxes are only
+ *                          parsed on request
+ *****************************************************************************
+ *  i_defer is a set of BOX_FLAG_DEFER_* values. The matching boxes are
+ *  inserted with their position and size only, and flagged with
+ *  BOX_FLAG_DEFERRED. Nothing is deferred on non seekable streams.
+ *****************************************************************************/
+MP4_Box_t *MP4_BoxGetRootDeferred( stream_t *, int i_defer );
+
+/*****************************************************************************
+ * MP4_BoxLoadDeferred : parse the deferred boxes of a tree
+ *****************************************************************************
+ *  Loads p_box, if deferred, and all the deferred boxes below it.
+ *  The stream position is restored on return.
+ *****************************************************************************/
+int MP4_BoxLoadDeferred( stream_t *, MP4_Box_t *p_box );
+
 /*****************************************************************************
  * MP4_BoxNew : Allocates a new MP4 Box with its atom type
  *****************************************************************************
@@ -108,10 +108,14 @@ typedef struct
     bool         b_seekable;
     bool         b_fastseekable;
     bool         b_error;        /* unrecoverable */
+    bool         b_keyframes_only; /* trick play, video sync samples only */
 
     bool            b_index_probed;     /* mFra sync points index */
     bool            b_fragments_probed; /* moof segments index created */
 
+    bool            b_sampletables_deferred; /* preparsing, no samples index */
+    bool            b_userdata_deferred;     /* meta and chapters not loaded yet */
+
     MP4_Box_t *p_moov;
 
     struct
@@ -120,6 +124,7 @@ typedef struct
         MP4_Box_t      *p_fragment_atom;
         uint64_t        i_post_mdat_offset;
         uint32_t        i_lastseqnumber;
+        bool            b_index_tail; /* fragment atom is the last indexed one */
     } context;
 
     /* */
@@ -198,6 +203,8 @@ static int FragGetMoofBySidxIndex( demux_t *p_demux, vlc_tick_t i_target_time,
 static int FragGetMoofByTfraIndex( demux_t *p_demux, const vlc_tick_t i_target_time, unsigned i_track_ID,
                                    uint64_t *pi_moof_pos, vlc_tick_t *pi_sampletime );
 static void FragResetContext( demux_sys_t * );
+static int FragIndexAddMoof( demux_t *, MP4_Box_t * );
+static bool FragIndexIsTail( demux_sys_t *, const MP4_Box_t * );
 
 /* ASF Handlers */
 static asf_track_info_t * MP4ASF_GetTrackInfo( asf_packet_sys_t *p_packetsys, uint8_t i_stream_number );
@@ -326,32 +333,69 @@ static es_out_id_t * MP4_AddTrackES( es_out_t *out, mp4_track_t *p_track )
     return p_es;
 }
 
-/* Return time in microsecond of a track */
-static inline vlc_tick_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+/* Moves a position in a stts/ctts table by i_samples, and returns the sum
+ * of the values of the samples stepped over */
+static stime_t xTTS_Step( const mp4_xtts_t *p_table, uint32_t *pi_index,
+                          uint32_t *pi_skip, uint32_t i_samples )
 {
-    demux_sys_t *p_sys = p_demux->p_sys;
-    const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
-
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
-    int64_t sdts = p_chunk->i_first_dts;
+    stime_t i_total = 0;
 
-    while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
+    while( i_samples > 0 && *pi_index < p_table->i_entries )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
-        {
-            sdts += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
+        const uint32_t i_value = p_table->pi_value[*pi_index];
+        const uint32_t i_left = p_table->pi_count[*pi_index] - *pi_skip;
+        if( i_samples < i_left )
         {
-            sdts += i_sample * p_chunk->p_sample_delta_dts[i_index];
+            i_total += (stime_t) i_samples * i_value;
+            *pi_skip += i_samples;
             break;
         }
+        i_total += (stime_t) i_left * i_value;
+        i_samples -= i_left;
+        *pi_index += 1;
+        *pi_skip = 0;
+    }
+
+    return i_total;
+}
+
+/* Returns the track scaled dts of the current sample, and its stts position */
+static stime_t MP4_TrackGetSampleDTS( mp4_track_t *p_track,
+                                      uint32_t *pi_index, uint32_t *pi_skip )
+{
+    const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
+    const uint32_t i_sample = p_track->i_sample - p_chunk->i_sample_first;
+
+    /* usually continue from the previous sample */
+    if( p_track->dts_cursor.i_chunk != p_track->i_chunk ||
+        p_track->dts_cursor.i_sample > i_sample )
+    {
+        p_track->dts_cursor.i_chunk = p_track->i_chunk;
+        p_track->dts_cursor.i_sample = 0;
+        p_track->dts_cursor.i_index = p_chunk->i_dts_index;
+        p_track->dts_cursor.i_skip = p_chunk->i_dts_skip;
+        p_track->dts_cursor.i_dts = p_chunk->i_first_dts;
     }
 
+    p_track->dts_cursor.i_dts += xTTS_Step( &p_track->dts_table,
+                                            &p_track->dts_cursor.i_index,
+                                            &p_track->dts_cursor.i_skip,
+                                            i_sample - p_track->dts_cursor.i_sample );
+    p_track->dts_cursor.i_sample = i_sample;
+
+    *pi_index = p_track->dts_cursor.i_index;
+    *pi_skip = p_track->dts_cursor.i_skip;
+    return p_track->dts_cursor.i_dts;
+}
+
+/* Return time in microsecond of a track */
+static inline vlc_tick_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    uint32_t i_index, i_skip;
+
+    int64_t sdts = MP4_TrackGetSampleDTS( p_track, &i_index, &i_skip );
+
     vlc_tick_t i_dts = MP4_rescale_mtime( sdts, p_track->i_timescale );
 
     /* now handle elst */
@@ -380,26 +424,19 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
                                          vlc_tick_t *pi_delta )
 {
     VLC_UNUSED( p_demux );
-    mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+    const mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
 
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
+    uint32_t i_index = ck->i_pts_index;
+    uint32_t i_skip = ck->i_pts_skip;
+    xTTS_Step( &p_track->pts_table, &i_index, &i_skip,
+               p_track->i_sample - ck->i_sample_first );
 
-    if( ck->p_sample_count_pts == NULL || ck->p_sample_offset_pts == NULL )
+    if( i_index >= p_track->pts_table.i_entries )
         return false;
 
-    for( i_index = 0; i_index < ck->i_entries_pts ; i_index++ )
-    {
-        if( i_sample < ck->p_sample_count_pts[i_index] )
-        {
-            *pi_delta = MP4_rescale_mtime( ck->p_sample_offset_pts[i_index],
-                                           p_track->i_timescale );
-            return true;
-        }
-
-        i_sample -= ck->p_sample_count_pts[i_index];
-    }
-    return false;
+    *pi_delta = MP4_rescale_mtime( p_track->pts_table.pi_value[i_index] +
+                                   p_track->i_cts_shift, p_track->i_timescale );
+    return true;
 }
 
 static inline vlc_tick_t MP4_GetSamplesDuration( demux_t *p_demux, mp4_track_t *p_track,
@@ -408,43 +445,17 @@ static inline vlc_tick_t MP4_GetSamplesDuration( demux_t *p_demux, mp4_track_t *
     VLC_UNUSED( p_demux );
 
     const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
-    stime_t i_duration = 0;
+    const uint32_t i_sample = p_track->i_sample - p_chunk->i_sample_first;
+    if( i_sample >= p_chunk->i_sample_count )
+        return 0;
 
-    /* Forward to right index, and set remaining count in that index */
-    unsigned i_index = 0;
-    unsigned i_remain = 0;
-    for( unsigned i = p_chunk->i_sample_first;
-         i<p_track->i_sample && i_index < p_chunk->i_entries_dts; )
-    {
-        if( p_track->i_sample - i >= p_chunk->p_sample_count_dts[i_index] )
-        {
-            i += p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
-        {
-            i_remain = p_track->i_sample - i;
-            break;
-        }
-    }
+    /* Only count the samples of this chunk */
+    i_nb_samples = __MIN( i_nb_samples, p_chunk->i_sample_count - i_sample );
 
-    /* Compute total duration from all samples from index */
-    while( i_nb_samples > 0 && i_index < p_chunk->i_entries_dts )
-    {
-        if( i_nb_samples >= p_chunk->p_sample_count_dts[i_index] - i_remain )
-        {
-            i_duration += (p_chunk->p_sample_count_dts[i_index] - i_remain) *
-                          (int64_t) p_chunk->p_sample_delta_dts[i_index];
-            i_nb_samples -= (p_chunk->p_sample_count_dts[i_index] - i_remain);
-            i_index++;
-            i_remain = 0;
-        }
-        else
-        {
-            i_duration += i_nb_samples * p_chunk->p_sample_delta_dts[i_index];
-            break;
-        }
-    }
+    uint32_t i_index, i_skip;
+    MP4_TrackGetSampleDTS( p_track, &i_index, &i_skip );
+    stime_t i_duration = xTTS_Step( &p_track->dts_table, &i_index, &i_skip,
+                                    i_nb_samples );
 
     return MP4_rescale_mtime( i_duration, p_track->i_timescale );
 }
@@ -455,13 +466,22 @@ static inline vlc_tick_t MP4_GetMoviePTS(demux_sys_t *p_sys )
 }
 
 static void LoadChapter( demux_t  *p_demux );
+static void LoadUserData( demux_t *p_demux );
 
 static int LoadInitFrag( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    /* Headers only opens leave out what they will not use: the samples
+     * tables when preparsing, the file meta data when thumbnailing */
+    int i_defer = 0;
+    if( p_demux->b_preparsing )
+        i_defer |= BOX_FLAG_DEFER_SAMPLETABLES;
+    else if( var_InheritBool( p_demux, "demux-headers-only" ) )
+        i_defer |= BOX_FLAG_DEFER_USERDATA;
+
     /* Load all boxes ( except raw data ) */
-    MP4_Box_t *p_root = MP4_BoxGetRoot( p_demux->s );
+    MP4_Box_t *p_root = MP4_BoxGetRootDeferred( p_demux->s, i_defer );
     if( p_root == NULL || !MP4_BoxGet( p_root, "/moov" ) )
     {
         MP4_BoxFree( p_root );
@@ -469,6 +489,10 @@ static int LoadInitFrag( demux_t *p_demux )
     }
 
     p_sys->p_root = p_root;
+    if( p_root->e_flags & BOX_FLAG_DEFER_SAMPLETABLES )
+        p_sys->b_sampletables_deferred = true;
+    if( p_root->e_flags & BOX_FLAG_DEFER_USERDATA )
+        p_sys->b_userdata_deferred = true;
 
     return VLC_SUCCESS;
 
@@ -995,7 +1019,7 @@ static int Open( vlc_object_t * p_this )
     }
 
     /* Set and store metadata */
-    if( (p_sys->p_meta = vlc_meta_New()) )
+    if( !p_sys->b_userdata_deferred && (p_sys->p_meta = vlc_meta_New()) )
         MP4_LoadMeta( p_sys, p_sys->p_meta );
 
     /* now process each track and extract all useful information */
@@ -1104,8 +1128,10 @@ static int Open( vlc_object_t * p_this )
             msg_Warn( p_demux, "that media doesn't look properly interleaved, will need to seek");
     }
 
-    /* */
-    LoadChapter( p_demux );
+    /* Titles are not used by the preparser, and are loaded on request
+     * after a headers only open */
+    if( !p_sys->b_userdata_deferred && !p_sys->b_sampletables_deferred )
+        LoadChapter( p_demux );
 
     p_sys->asfpacketsys.p_demux = p_demux;
     p_sys->asfpacketsys.pi_preroll = &p_sys->i_preroll;
@@ -1266,6 +1292,28 @@ static block_t * MP4_RTPHint_Convert( demux_t *p_demux, block_t *p_block, vlc_fo
  *****************************************************************************
  * TODO check for newly selected track (ie audio upt to now )
  *****************************************************************************/
+/* Returns the first sync sample from i_sample on */
+static uint32_t TrackGetNextSyncSample( const mp4_track_t *tk, uint32_t i_sample )
+{
+    const MP4_Box_t *p_stss = MP4_BoxGet( tk->p_stbl, "stss" );
+    if( !p_stss || !BOXDATA(p_stss) )
+        return i_sample; /* every sample is a sync sample */
+
+    const MP4_Box_data_stss_t *p_stss_data = BOXDATA(p_stss);
+    uint32_t i_low = 0, i_high = p_stss_data->i_entry_count;
+    while( i_low < i_high )
+    {
+        const uint32_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_stss_data->i_sample_number[i_mid] < i_sample )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+
+    return i_low < p_stss_data->i_entry_count
+         ? p_stss_data->i_sample_number[i_low] : tk->i_sample_count;
+}
+
 static int DemuxTrack( demux_t *p_demux, mp4_track_t *tk, uint64_t i_readpos,
                        vlc_tick_t i_max_preload )
 {
@@ -1296,6 +1344,24 @@ static int DemuxTrack( demux_t *p_demux, mp4_track_t *tk, uint64_t i_readpos,
                  MP4_GetMoviePTS( p_demux->p_sys ), i_readpos );
 #endif
 
+        if( p_sys->b_keyframes_only && tk->fmt.i_cat == VIDEO_ES )
+        {
+            const uint32_t i_sync = TrackGetNextSyncSample( tk, tk->i_sample );
+            if( i_sync > tk->i_sample )
+            {
+                /* Skip to the next sync sample, without reading anything */
+                while( tk->i_sample < i_sync )
+                    if( MP4_TrackNextSample( p_demux, tk, 1 ) )
+                        goto end;
+
+                if( MP4_TrackGetRunSeq( tk ) != i_run_seq )
+                    break;
+                i_current_nzdts = MP4_TrackGetDTS( p_demux, tk );
+                i_readpos = MP4_TrackGetPos( tk );
+                continue;
+            }
+        }
+
         i_samplessize = MP4_TrackGetReadSize( tk, &i_nb_samples );
         if( i_samplessize > 0 )
         {
@@ -1655,6 +1721,7 @@ static int FragSeekLoadFragment( demux_t *p_demux, uint32_t i_moox, stime_t i_mo
     /* map context */
     p_sys->context.p_fragment_atom = p_moox;
     p_sys->context.i_current_box_type = i_moox;
+    p_sys->context.b_index_tail = FragIndexIsTail( p_sys, p_moox );
 
     if( i_moox == ATOM_moof )
     {
@@ -1772,6 +1839,9 @@ static int FragSeekToTime( demux_t *p_demux, vlc_tick_t i_nztime, bool b_accurat
     else
     {
         bool b_buildindex = false;
+        /* fragments read so far are indexed */
+        const bool b_indexed = p_sys->p_fragsindex &&
+                MP4_rescale_qtime( i_nztime, p_sys->i_timescale ) < p_sys->p_fragsindex->i_last_time;
 
         if( FragGetMoofByTfraIndex( p_demux, i_nztime, i_seek_track_ID, &i64, &i_sync_time ) == VLC_SUCCESS )
         {
@@ -1779,7 +1849,7 @@ static int FragSeekToTime( demux_t *p_demux, vlc_tick_t i_nztime, bool b_accurat
             msg_Dbg( p_demux, "seeking to sync point %" PRId64, i_sync_time );
             b_iframesync = true;
         }
-        else if( !p_sys->b_fragments_probed && !p_sys->b_fastseekable )
+        else if( !b_indexed && !p_sys->b_fragments_probed && !p_sys->b_fastseekable )
         {
             const char *psz_msg = _(
                 "Because this file index is broken or missing, "
@@ -1797,10 +1867,15 @@ static int FragSeekToTime( demux_t *p_demux, vlc_tick_t i_nztime, bool b_accurat
                                                      "%s", psz_msg );
         }
 
-        if( !p_sys->b_fragments_probed && ( p_sys->b_fastseekable || b_buildindex ) )
+        if( !b_indexed && !p_sys->b_fragments_probed &&
+            ( p_sys->b_fastseekable || b_buildindex ) )
         {
             bool foo;
-            int i_ret = vlc_stream_Seek( p_demux->s, p_sys->p_moov->i_pos + p_sys->p_moov->i_size );
+            /* resume from the last indexed fragment */
+            uint64_t i_probe_pos = p_sys->p_moov->i_pos + p_sys->p_moov->i_size;
+            if( p_sys->p_fragsindex && p_sys->p_fragsindex->i_entries )
+                i_probe_pos = p_sys->p_fragsindex->pi_pos[p_sys->p_fragsindex->i_entries - 1];
+            int i_ret = vlc_stream_Seek( p_demux->s, i_probe_pos );
             if( i_ret == VLC_SUCCESS )
             {
                 i_ret = ProbeFragments( p_demux, true, &foo );
@@ -1813,7 +1888,7 @@ static int FragSeekToTime( demux_t *p_demux, vlc_tick_t i_nztime, bool b_accurat
             }
         }
 
-        if( p_sys->b_fragments_probed && p_sys->p_fragsindex )
+        if( ( b_indexed || p_sys->b_fragments_probed ) && p_sys->p_fragsindex )
         {
             stime_t i_basetime = MP4_rescale_qtime( i_sync_time, p_sys->i_timescale );
             if( !MP4_Fragments_Index_Lookup( p_sys->p_fragsindex, &i_basetime, &i64, i_seek_track_index ) )
@@ -2028,6 +2103,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             input_attachment_t ***ppp_attach = va_arg( args, input_attachment_t*** );
             int *pi_int = va_arg( args, int * );
 
+            LoadUserData( p_demux );
+
             MP4_Box_t *p_udta = NULL;
             size_t i_count = 0;
             int i_index = 0;
@@ -2141,6 +2218,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         {
             vlc_meta_t *p_meta = va_arg( args, vlc_meta_t *);
 
+            LoadUserData( p_demux );
             if( !p_sys->p_meta )
                 return VLC_EGENERIC;
 
@@ -2156,6 +2234,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             int *pi_title_offset = va_arg( args, int* );
             int *pi_seekpoint_offset = va_arg( args, int* );
 
+            LoadUserData( p_demux );
             if( !p_sys->p_title )
                 return VLC_EGENERIC;
 
@@ -2218,6 +2297,12 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         case DEMUX_CAN_RECORD:
             return VLC_EGENERIC;
 
+        case DEMUX_SET_KEYFRAMES_ONLY:
+            if( p_sys->b_fragmented )
+                return VLC_EGENERIC;
+            p_sys->b_keyframes_only = (bool) va_arg( args, int );
+            return VLC_SUCCESS;
+
         case DEMUX_CAN_PAUSE:
         case DEMUX_SET_PAUSE_STATE:
         case DEMUX_CAN_CONTROL_PACE:
@@ -2360,6 +2445,22 @@ static void LoadChapterApple( demux_t  *p_demux, mp4_track_t *tk )
             tk->i_chunk++;
     }
 }
+/* Loads the meta data and chapters left out by a headers only open */
+static void LoadUserData( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->b_userdata_deferred )
+        return;
+    p_sys->b_userdata_deferred = false;
+
+    MP4_BoxLoadDeferred( p_demux->s, p_sys->p_root );
+
+    if( (p_sys->p_meta = vlc_meta_New()) )
+        MP4_LoadMeta( p_sys, p_sys->p_meta );
+    LoadChapter( p_demux );
+}
+
 static void LoadChapter( demux_t  *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2445,12 +2546,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         ck->i_offset = BOXDATA(p_co64)->i_chunk_offset[i_chunk];
 
         ck->i_first_dts = 0;
-        ck->i_entries_dts = 0;
-        ck->p_sample_count_dts = NULL;
-        ck->p_sample_delta_dts = NULL;
-        ck->i_entries_pts = 0;
-        ck->p_sample_count_pts = NULL;
-        ck->p_sample_offset_pts = NULL;
     }
 
     /* now we read index for SampleEntry( soun vide mp4a mp4v ...)
@@ -2512,54 +2607,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
-{
-    uint32_t i_array_offset;
-    while( i_sample_count > 0 )
-    {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
-
-        if ( i_array_offset >= i_table_count )
-        {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_ENOVAR;
-        }
-
-        if ( i_index_samples_left )
-        {
-            if ( i_index_samples_left > i_sample_count )
-            {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
-            }
-            else
-            {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
-            }
-        }
-        else
-        {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
-        }
-    }
-
-    return VLC_SUCCESS;
-}
-
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
@@ -2599,16 +2646,7 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     {
         /* 2: each sample can have a different size */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
     }
 
     if ( p_demux_track->i_chunk_count && p_demux_track->i_sample_size == 0 )
@@ -2621,14 +2659,10 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         }
     }
 
-    /* Use stts table to create a sample number -> dts table.
-     * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
+    /* The stts and ctts tables are not expanded: each chunk only records
+     * the table position of its first sample, and sample times are
+     * computed from there when needed (raw audio can have a lot of samples) */
+    p_demux_track->dts_cursor.i_chunk = UINT32_MAX;
 
     int64_t i_next_dts = 0;
     /* Find stts
@@ -2646,100 +2680,26 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
+        p_demux_track->dts_table.i_entries = stts->i_entry_count;
+        p_demux_track->dts_table.pi_count = stts->pi_sample_count;
+        p_demux_track->dts_table.pi_value = stts->pi_sample_delta;
+
         uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        uint32_t i_skip = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
 
-            /* save first dts */
             ck->i_first_dts = i_next_dts;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            ck->i_entries_dts = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_dts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            {
-                free( ck->p_sample_count_dts );
-                free( ck->p_sample_delta_dts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_current_index_samples_left ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( stts->pi_sample_count[i_index] ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-            }
+            ck->i_dts_index = i_index;
+            ck->i_dts_skip = i_skip;
+            ck->i_duration = xTTS_Step( &p_demux_track->dts_table,
+                                        &i_index, &i_skip, ck->i_sample_count );
+            i_next_dts += ck->i_duration;
         }
     }
 
-
     /* Find ctts
      *  Gives the delta between decoding time (dts) and composition table (pts)
      */
@@ -2750,90 +2710,26 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "CTTS table of %"PRIu32" entries", ctts->i_entry_count );
 
-        int64_t i_cts_shift = 0;
+        p_demux_track->i_cts_shift = 0;
         const MP4_Box_t *p_cslg = MP4_BoxGet( p_demux_track->p_stbl, "cslg" );
         if( p_cslg && BOXDATA(p_cslg) )
-            i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
+            p_demux_track->i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
+
+        p_demux_track->pts_table.i_entries = ctts->i_entry_count;
+        p_demux_track->pts_table.pi_count = ctts->pi_sample_count;
+        p_demux_track->pts_table.pi_value = ctts->pi_sample_offset;
 
-        /* Create pts-dts table per chunk */
         uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        uint32_t i_skip = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            ck->i_entries_pts = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_pts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( ck->i_entries_pts, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( ck->i_entries_pts, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-            {
-                free( ck->p_sample_count_pts );
-                free( ck->p_sample_offset_pts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
 
-            }
+            ck->i_pts_index = i_index;
+            ck->i_pts_skip = i_skip;
+            xTTS_Step( &p_demux_track->pts_table, &i_index, &i_skip,
+                       ck->i_sample_count );
         }
     }
 
@@ -3090,7 +2986,6 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     uint64_t     i_dts;
     unsigned int i_sample;
     unsigned int i_chunk;
-    int          i_index;
     stime_t      i_start;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
@@ -3154,29 +3049,30 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
-    {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
+    const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    const mp4_xtts_t *stts = &p_track->dts_table;
+    uint32_t i_index = ck->i_dts_index;
+    uint32_t i_skip = ck->i_dts_skip;
+    uint32_t i_remain = ck->i_sample_count;
+    i_sample = ck->i_sample_first;
+    i_dts    = ck->i_first_dts;
+    while( i_remain > 0 && i_index < stts->i_entries )
+    {
+        const uint32_t i_count = __MIN( stts->pi_count[i_index] - i_skip, i_remain );
+        const uint32_t i_delta = stts->pi_value[i_index];
+
+        if( i_dts + (uint64_t) i_count * i_delta < (uint64_t)i_start )
+        {
+            i_dts    += (uint64_t) i_count * i_delta;
+            i_sample += i_count;
+            i_remain -= i_count;
             i_index++;
+            i_skip = 0;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
-            {
-                break;
-            }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+            if( i_delta > 0 )
+                i_sample += ( i_start - i_dts ) / i_delta;
             break;
         }
     }
@@ -3513,9 +3409,21 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
         }
     }
 
+    if( p_sys->b_sampletables_deferred )
+    {
+        /* Preparsing: no samples index, but the count for the frame rate */
+        const MP4_Box_t *p_stts = MP4_BoxGet( p_track->p_stbl, "stts" );
+        if( p_stts && BOXDATA(p_stts) )
+        {
+            uint64_t i_count = 0;
+            for( uint32_t i = 0; i < BOXDATA(p_stts)->i_entry_count; i++ )
+                i_count += BOXDATA(p_stts)->pi_sample_count[i];
+            p_track->i_sample_count = __MIN( i_count, UINT32_MAX );
+        }
+    }
     /* Create chunk index table and sample index table */
-    if( TrackCreateChunksIndex( p_demux,p_track  ) ||
-        TrackCreateSamplesIndex( p_demux, p_track ) )
+    else if( TrackCreateChunksIndex( p_demux,p_track  ) ||
+             TrackCreateSamplesIndex( p_demux, p_track ) )
     {
         msg_Err( p_demux, "cannot create chunks index" );
         return; /* cannot create chunks index */
@@ -3612,15 +3520,6 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
     p_track->b_ok = true;
 }
 
-static void DestroyChunk( mp4_chunk_t *ck )
-{
-    free( ck->p_sample_count_dts );
-    free( ck->p_sample_delta_dts );
-    free( ck->p_sample_count_pts );
-    free( ck->p_sample_offset_pts );
-    free( ck->p_sample_size );
-}
-
 /****************************************************************************
  * MP4_TrackClean:
  ****************************************************************************
@@ -3633,16 +3532,8 @@ static void MP4_TrackClean( es_out_t *out, mp4_track_t *p_track )
     if( p_track->p_es )
         es_out_Del( out, p_track->p_es );
 
-    if( p_track->chunk )
-    {
-        for( unsigned int i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-            DestroyChunk( &p_track->chunk[i_chunk] );
-    }
     free( p_track->chunk );
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
-
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
 
@@ -4085,6 +3976,18 @@ static int ReInitDecoder( demux_t *p_demux, const MP4_Box_t *p_root,
 }
 #endif
 
+static bool MoovTrakHasSamples( const MP4_Box_t *p_trak )
+{
+    const MP4_Box_t *p_stsz = MP4_BoxGet( p_trak, "mdia/minf/stbl/stsz" );
+    if( !p_stsz )
+        return false;
+    if( BOXDATA(p_stsz) )
+        return BOXDATA(p_stsz)->i_sample_count > 0;
+    /* deferred sample sizes, rely on the decoding times */
+    const MP4_Box_t *p_stts = MP4_BoxGet( p_trak, "mdia/minf/stbl/stts" );
+    return p_stts && BOXDATA(p_stts) && BOXDATA(p_stts)->i_entry_count > 0;
+}
+
 static stime_t GetCumulatedDuration( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -4094,12 +3997,10 @@ static stime_t GetCumulatedDuration( demux_t *p_demux )
     {
         stime_t i_track_duration = 0;
         MP4_Box_t *p_trak = MP4_GetTrakByTrackID( p_sys->p_moov, p_sys->track[i].i_track_ID );
-        const MP4_Box_t *p_stsz;
         const MP4_Box_t *p_tkhd;
         if ( (p_tkhd = MP4_BoxGet( p_trak, "tkhd" )) &&
-             (p_stsz = MP4_BoxGet( p_trak, "mdia/minf/stbl/stsz" )) &&
              /* duration might be wrong an be set to whole duration :/ */
-             BOXDATA(p_stsz)->i_sample_count > 0 )
+             MoovTrakHasSamples( p_trak ) )
         {
             i_max_duration = __MAX( (uint64_t)i_max_duration, BOXDATA(p_tkhd)->i_duration );
         }
@@ -4156,12 +4057,10 @@ static int ProbeIndex( demux_t *p_demux )
 static stime_t GetMoovTrackDuration( demux_sys_t *p_sys, unsigned i_track_ID )
 {
     MP4_Box_t *p_trak = MP4_GetTrakByTrackID( p_sys->p_moov, i_track_ID );
-    const MP4_Box_t *p_stsz;
     const MP4_Box_t *p_tkhd;
     if ( (p_tkhd = MP4_BoxGet( p_trak, "tkhd" )) &&
-         (p_stsz = MP4_BoxGet( p_trak, "mdia/minf/stbl/stsz" )) &&
          /* duration might be wrong an be set to whole duration :/ */
-         BOXDATA(p_stsz)->i_sample_count > 0 )
+         MoovTrakHasSamples( p_trak ) )
     {
         if( BOXDATA(p_tkhd)->i_duration <= p_sys->i_moov_duration )
             return BOXDATA(p_tkhd)->i_duration; /* In movie / mvhd scale */
@@ -4255,6 +4154,70 @@ static bool GetMoofTrackDuration( MP4_Box_t *p_moov, MP4_Box_t *p_moof,
     return true;
 }
 
+/* Appends a moof following the last indexed fragment */
+static int FragIndexAddMoof( demux_t *p_demux, MP4_Box_t *p_moof )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->p_fragsindex )
+    {
+        p_sys->p_fragsindex = MP4_Fragments_Index_New( p_sys->i_tracks, 64 );
+        if( !p_sys->p_fragsindex )
+            return VLC_ENOMEM;
+    }
+    mp4_fragments_index_t *p_index = p_sys->p_fragsindex;
+
+    if( p_index->i_entries &&
+        p_index->pi_pos[p_index->i_entries - 1] >= p_moof->i_pos )
+        return VLC_SUCCESS; /* already indexed */
+
+    const bool b_first = ( p_index->i_entries == 0 );
+    stime_t *p_times = MP4_Fragments_Index_Append( p_index, p_moof->i_pos );
+    if( !p_times )
+        return VLC_ENOMEM;
+
+    for( unsigned i=0; i<p_sys->i_tracks; i++ )
+    {
+        stime_t *pi_track_time = &p_index->p_next_times[i];
+        MP4_Box_t *p_tfdt = NULL;
+        MP4_Box_t *p_traf = MP4_GetTrafByTrackID( p_moof, p_sys->track[i].i_track_ID );
+        if( p_traf )
+            p_tfdt = MP4_BoxGet( p_traf, "tfdt" );
+
+        if( p_tfdt && BOXDATA(p_tfdt) )
+        {
+            *pi_track_time = p_tfdt->data.p_tfdt->i_base_media_decode_time;
+        }
+        else if( b_first ) /* Set first fragment time offset from moov */
+        {
+            stime_t i_duration = GetMoovTrackDuration( p_sys, p_sys->track[i].i_track_ID );
+            *pi_track_time = MP4_rescale( i_duration, p_sys->i_timescale, p_sys->track[i].i_timescale );
+        }
+
+        p_times[i] = MP4_rescale( *pi_track_time, p_sys->track[i].i_timescale, p_sys->i_timescale );
+
+        stime_t i_duration = 0;
+        if( GetMoofTrackDuration( p_sys->p_moov, p_moof, p_sys->track[i].i_track_ID, &i_duration ) )
+            *pi_track_time += i_duration;
+
+        stime_t i_movietime = MP4_rescale( *pi_track_time, p_sys->track[i].i_timescale, p_sys->i_timescale );
+        if( p_index->i_last_time < i_movietime )
+            p_index->i_last_time = i_movietime;
+    }
+
+    return VLC_SUCCESS;
+}
+
+/* Checks if the next fragment in sequence can be appended to the index */
+static bool FragIndexIsTail( demux_sys_t *p_sys, const MP4_Box_t *p_moox )
+{
+    const mp4_fragments_index_t *p_index = p_sys->p_fragsindex;
+    if( p_moox->i_type == ATOM_moov )
+        return !p_index || p_index->i_entries == 0;
+    return p_index && p_index->i_entries &&
+           p_index->pi_pos[p_index->i_entries - 1] == p_moox->i_pos;
+}
+
 static int ProbeFragments( demux_t *p_demux, bool b_force, bool *pb_fragmented )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -4269,76 +4232,30 @@ static int ProbeFragments( demux_t *p_demux, bool b_force, bool *pb_fragmented )
 
     if( p_sys->b_seekable && (p_sys->b_fastseekable || b_force) )
     {
-        MP4_ReadBoxContainerChildren( p_demux->s, p_vroot, NULL ); /* Get the rest of the file */
-        p_sys->b_fragments_probed = true;
-
-        const unsigned i_moof = MP4_BoxCount( p_vroot, "/moof" );
-        if( i_moof )
+        /* Get the rest of the file, one fragment at a time */
+        MP4_Box_t *p_chunk;
+        while( (p_chunk = MP4_BoxGetNextChunk( p_demux->s )) )
         {
-            *pb_fragmented = true;
-            p_sys->p_fragsindex = MP4_Fragments_Index_New( p_sys->i_tracks, i_moof );
-            if( !p_sys->p_fragsindex )
-            {
-                MP4_BoxFree( p_vroot );
-                return VLC_EGENERIC;
-            }
-
-            stime_t *pi_track_times = calloc( p_sys->i_tracks, sizeof(*pi_track_times) );
-            if( !pi_track_times )
-            {
-                MP4_Fragments_Index_Delete( p_sys->p_fragsindex );
-                p_sys->p_fragsindex = NULL;
-                MP4_BoxFree( p_vroot );
-                return VLC_EGENERIC;
-            }
-
-            unsigned index = 0;
-
-            for( MP4_Box_t *p_moof = p_vroot->p_first; p_moof; p_moof = p_moof->p_next )
+            for( MP4_Box_t *p_moof = p_chunk->p_first; p_moof; p_moof = p_moof->p_next )
             {
                 if( p_moof->i_type != ATOM_moof )
                     continue;
-
-                for( unsigned i=0; i<p_sys->i_tracks; i++ )
+                *pb_fragmented = true;
+                if( FragIndexAddMoof( p_demux, p_moof ) != VLC_SUCCESS )
                 {
-                    MP4_Box_t *p_tfdt = NULL;
-                    MP4_Box_t *p_traf = MP4_GetTrafByTrackID( p_moof, p_sys->track[i].i_track_ID );
-                    if( p_traf )
-                        p_tfdt = MP4_BoxGet( p_traf, "tfdt" );
-
-                    if( p_tfdt && BOXDATA(p_tfdt) )
-                    {
-                        pi_track_times[i] = p_tfdt->data.p_tfdt->i_base_media_decode_time;
-                    }
-                    else if( index == 0 ) /* Set first fragment time offset from moov */
-                    {
-                        stime_t i_duration = GetMoovTrackDuration( p_sys, p_sys->track[i].i_track_ID );
-                        pi_track_times[i] = MP4_rescale( i_duration, p_sys->i_timescale, p_sys->track[i].i_timescale );
-                    }
-
-                    stime_t i_movietime = MP4_rescale( pi_track_times[i], p_sys->track[i].i_timescale, p_sys->i_timescale );
-                    p_sys->p_fragsindex->p_times[index * p_sys->i_tracks + i] = i_movietime;
-
-                    stime_t i_duration = 0;
-                    if( GetMoofTrackDuration( p_sys->p_moov, p_moof, p_sys->track[i].i_track_ID, &i_duration ) )
-                        pi_track_times[i] += i_duration;
+                    MP4_BoxFree( p_chunk );
+                    MP4_BoxFree( p_vroot );
+                    return VLC_EGENERIC;
                 }
-
-                p_sys->p_fragsindex->pi_pos[index++] = p_moof->i_pos;
-            }
-
-            for( unsigned i=0; i<p_sys->i_tracks; i++ )
-            {
-                stime_t i_movietime = MP4_rescale( pi_track_times[i], p_sys->track[i].i_timescale, p_sys->i_timescale );
-                if( p_sys->p_fragsindex->i_last_time < i_movietime )
-                    p_sys->p_fragsindex->i_last_time = i_movietime;
             }
+            MP4_BoxFree( p_chunk );
+        }
+        p_sys->b_fragments_probed = true;
 
-            free( pi_track_times );
 #ifdef MP4_VERBOSE
+        if( p_sys->p_fragsindex )
             MP4_Fragments_Index_Dump( VLC_OBJECT(p_demux), p_sys->p_fragsindex, p_sys->i_timescale );
 #endif
-        }
     }
     else
     {
@@ -4668,11 +4585,13 @@ static int FragCreateTrunIndex( demux_t *p_demux, MP4_Box_t *p_moof,
             {
                 unsigned i_track_index = (p_track - p_sys->track);
                 assert(&p_sys->track[i_track_index] == p_track);
-                i_traf_start_time = MP4_Fragment_Index_GetTrackStartTime( p_sys->p_fragsindex,
-                                                                          i_track_index, p_moof->i_pos );
-                i_traf_start_time = MP4_rescale( i_traf_start_time,
-                                                 p_sys->i_timescale, p_track->i_timescale );
-                b_has_base_media_decode_time = true;
+                if( MP4_Fragment_Index_GetTrackStartTime( p_sys->p_fragsindex, i_track_index,
+                                                          p_moof->i_pos, &i_traf_start_time ) )
+                {
+                    i_traf_start_time = MP4_rescale( i_traf_start_time,
+                                                     p_sys->i_timescale, p_track->i_timescale );
+                    b_has_base_media_decode_time = true;
+                }
             }
 
             if( !b_has_base_media_decode_time && p_chunksidx )
@@ -5029,11 +4948,19 @@ static int DemuxFrag( demux_t *p_demux )
                 if( p_box->i_type == ATOM_moov )
                 {
                     p_sys->context.p_fragment_atom = p_sys->p_moov;
+                    p_sys->context.b_index_tail = FragIndexIsTail( p_sys, p_sys->p_moov );
                 }
                 else
                 {
                     p_sys->context.p_fragment_atom = MP4_BoxExtract( &p_vroot->p_first, p_box->i_type );
 
+                    /* Extend the index while reading fragments in sequence */
+                    if( p_sys->context.b_index_tail && p_sys->b_seekable &&
+                        FragIndexAddMoof( p_demux, p_sys->context.p_fragment_atom ) != VLC_SUCCESS )
+                        p_sys->context.b_index_tail = false;
+                    else
+                        p_sys->context.b_index_tail = FragIndexIsTail( p_sys, p_sys->context.p_fragment_atom );
+
                     /* Detect and Handle Passive Seek */
                     const uint32_t i_sequence_number = FragGetMoofSequenceNumber( p_sys->context.p_fragment_atom );
                     const bool b_discontinuity = ( i_sequence_number != p_sys->context.i_lastseqnumber + 1 );
@@ -40,27 +40,27 @@ typedef struct
     uint32_t     i_sample; /* index of the next sample to read in this chunk */
     uint32_t     i_virtual_run_number; /* chunks interleaving sequence */
 
-    /* now provide way to calculate pts, dts, and offset without too
-        much memory and with fast access */
-
     /* with this we can calculate dts/pts without waste memory */
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_duration;    /* total duration of all samples */
 
-    uint32_t     i_entries_dts;
-    uint32_t     *p_sample_count_dts;
-    uint32_t     *p_sample_delta_dts;   /* dts delta */
-
-    uint32_t     i_entries_pts;
-    uint32_t     *p_sample_count_pts;
-    int32_t      *p_sample_offset_pts;  /* pts-dts */
-
-    uint32_t     *p_sample_size;
-    /* TODO if needed add pts
-        but quickly *add* support for edts and seeking */
+    /* position of the first sample in the track stts/ctts tables:
+       entry index, and samples of that entry used by previous chunks */
+    uint32_t     i_dts_index;
+    uint32_t     i_dts_skip;
+    uint32_t     i_pts_index;
+    uint32_t     i_pts_skip;
 
 } mp4_chunk_t;
 
+/* stts or ctts table, in its run-length coded form */
+typedef struct
+{
+    uint32_t        i_entries;
+    const uint32_t *pi_count;
+    const int32_t  *pi_value; /* dts delta or pts-dts */
+} mp4_xtts_t;
+
 typedef struct
 {
     uint64_t i_offset;
@@ -121,8 +121,20 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-//                                    too much time to do sumations each time*/
+    const uint32_t   *p_sample_size; /* points to the stsz table */
+
+    /* sample times, decoded on demand from the stbl tables */
+    mp4_xtts_t       dts_table;
+    mp4_xtts_t       pts_table;
+    int64_t          i_cts_shift;
+    struct
+    {
+        uint32_t i_chunk;
+        uint32_t i_sample; /* in chunk */
+        uint32_t i_index;
+        uint32_t i_skip;
+        stime_t  i_dts;
+    } dts_cursor; /* last computed dts, for sequential reads */
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
@@ -625,7 +625,11 @@ static bool Parse( demux_t *p_demux, block_t **pp_output )
             return true;
     }
 
-    p_block_in = vlc_stream_Block( p_demux->s, p_sys->i_packet_size );
+    /* Take the data by reference when the stream provides blocks */
+    if( p_demux->s->pf_block != NULL && !p_sys->codec.b_use_word )
+        p_block_in = vlc_stream_ReadBlock( p_demux->s );
+    else
+        p_block_in = vlc_stream_Block( p_demux->s, p_sys->i_packet_size );
     bool b_eof = p_block_in == NULL;
 
     if( p_block_in )
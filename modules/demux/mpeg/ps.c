@@ -28,9 +28,19 @@
 # include "config.h"
 #endif
 
+#ifdef PS_TEST
+# undef NDEBUG
+#endif
+
+#include <errno.h>
+#include <stdatomic.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_demux.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
 
 #include "pes.h"
 #include "ps.h"
@@ -45,6 +55,17 @@
     "to calculate position and duration. However sometimes this might not " \
     "be usable. Disable this option to calculate from the bitrate instead." )
 
+#define INDEX_CACHE_TEXT N_("Cache seek indexes")
+#define INDEX_CACHE_LONGTEXT N_( \
+    "Save the positions of the timestamps found while playing and " \
+    "seeking, so that seeking is fast the next time the same file is " \
+    "opened." )
+
+#define INDEX_BACKGROUND_TEXT N_("Index in the background")
+#define INDEX_BACKGROUND_LONGTEXT N_( \
+    "Sample the timestamps of large files in the background after " \
+    "opening them, so that the first seeks do not need to search." )
+
 #define PS_PACKET_PROBE 3
 #define CDXA_HEADER_SIZE 44
 #define CDXA_SECTOR_SIZE 2352
@@ -69,6 +90,10 @@ vlc_module_begin ()
     add_bool( "ps-trust-timestamps", true, TIME_TEXT,
                  TIME_LONGTEXT, true )
         change_safe ()
+    add_bool( "ps-index-cache", true, INDEX_CACHE_TEXT,
+              INDEX_CACHE_LONGTEXT, true )
+    add_bool( "ps-index-background", false, INDEX_BACKGROUND_TEXT,
+              INDEX_BACKGROUND_LONGTEXT, true )
 
     add_submodule ()
     set_description( N_("MPEG-PS demuxer") )
@@ -81,6 +106,34 @@ vlc_module_end ()
  * Local prototypes
  *****************************************************************************/
 
+/* SCR index: the position of a pack header about every second, sorted by
+ * position. It is filled while playing, by the seeks and by the optional
+ * background indexer, and only used while the SCR increase with the
+ * position (no discontinuity, no wrap around). */
+#define PS_INDEX_INTERVAL   VLC_TICK_FROM_SEC(1)
+#define PS_SEEK_PRECISION   VLC_TICK_FROM_MS(500)
+#define PS_PROBE_WINDOW     (64 * 1024)
+#define PS_INDEX_PROBES     4096    /* samples of the background indexer */
+#define PS_INDEX_MIN_SIZE   10000000
+#define PS_CACHE_MAGIC      "VLCPSX01"
+
+typedef struct
+{
+    vlc_tick_t i_scr;
+    uint64_t   i_pos;   /* of the pack header */
+} ps_index_entry_t;
+
+typedef struct
+{
+    ps_index_entry_t *p_entries;
+    size_t  i_count;
+    size_t  i_alloc;
+    bool    b_changed;  /* entries added since loaded */
+    bool    b_broken;   /* SCR not monotonic, unusable */
+} ps_index_t;
+
+typedef struct ps_indexer_t ps_indexer_t;
+
 typedef struct
 {
     ps_psm_t    psm;
@@ -96,6 +149,10 @@ typedef struct
     vlc_tick_t  i_current_pts;
     uint64_t    i_start_byte;
     uint64_t    i_lastpack_byte;
+    vlc_tick_t  i_last_scr; /* near the end of the file */
+
+    ps_index_t    index;
+    ps_indexer_t *p_indexer;
 
     int         i_aob_mlp_count;
 
@@ -121,6 +178,16 @@ static int Control( demux_t *p_demux, int i_query, va_list args );
 static int      ps_pkt_resynch( stream_t *, int, bool );
 static block_t *ps_pkt_read   ( stream_t * );
 
+static void ps_index_Init  ( ps_index_t * );
+static void ps_index_Clean ( ps_index_t * );
+static void ps_index_Add   ( ps_index_t *, vlc_tick_t, uint64_t );
+static void IndexCacheLoad ( demux_t * );
+static void IndexCacheSave ( demux_t * );
+static void IndexerStart   ( demux_t * );
+static void IndexerPoll    ( demux_t * );
+static void IndexerStop    ( demux_t * );
+static int  SeekTime       ( demux_t *, vlc_tick_t );
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -220,6 +287,9 @@ static int OpenCommon( vlc_object_t *p_this, bool b_force )
     p_sys->i_aob_mlp_count = 0;
     p_sys->i_start_byte = i_skip;
     p_sys->i_lastpack_byte = i_skip;
+    p_sys->i_last_scr = VLC_TICK_INVALID;
+    ps_index_Init( &p_sys->index );
+    p_sys->p_indexer = NULL;
 
     p_sys->b_lost_sync = false;
     p_sys->b_have_pack = false;
@@ -237,6 +307,12 @@ static int OpenCommon( vlc_object_t *p_this, bool b_force )
 
     /* TODO prescanning of ES */
 
+    if( p_sys->b_seekable && !p_demux->b_preparsing )
+    {
+        IndexCacheLoad( p_demux );
+        IndexerStart( p_demux );
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -259,6 +335,10 @@ static void Close( vlc_object_t *p_this )
     demux_sys_t *p_sys = p_demux->p_sys;
     int i;
 
+    IndexerStop( p_demux );
+    IndexCacheSave( p_demux );
+    ps_index_Clean( &p_sys->index );
+
     for( i = 0; i < PS_TK_COUNT; i++ )
     {
         ps_track_t *tk = &p_sys->tk[i];
@@ -297,6 +377,7 @@ static int Probe( demux_t *p_demux, bool b_end )
     if( p_sys->b_lost_sync ) msg_Warn( p_demux, "found sync code" );
     p_sys->b_lost_sync = false;
 
+    uint64_t i_pos = vlc_stream_Tell( p_demux->s );
     if( ( p_pkt = ps_pkt_read( p_demux->s ) ) == NULL )
     {
         return VLC_DEMUXER_EOF;
@@ -322,10 +403,17 @@ static int Probe( demux_t *p_demux, bool b_end )
     else if( i_id == PS_STREAM_ID_PACK_HEADER )
     {
         vlc_tick_t i_scr; int dummy;
-        if( !b_end && !ps_pkt_parse_pack( p_pkt, &i_scr, &dummy ) )
+        if( !ps_pkt_parse_pack( p_pkt, &i_scr, &dummy ) )
         {
-            if( p_sys->i_first_scr == VLC_TICK_INVALID )
+            if( b_end )
+            {
+                if( p_sys->i_last_scr == VLC_TICK_INVALID ||
+                    i_scr > p_sys->i_last_scr )
+                    p_sys->i_last_scr = i_scr;
+            }
+            else if( p_sys->i_first_scr == VLC_TICK_INVALID )
                 p_sys->i_first_scr = i_scr;
+            ps_index_Add( &p_sys->index, i_scr, i_pos );
         }
         p_sys->b_have_pack = true;
     }
@@ -380,6 +468,16 @@ static bool FindLength( demux_t *p_demux )
             }
         }
     }
+
+    /* Without PTS, use the SCR at both ends */
+    if( p_sys->i_length == VLC_TICK_0 && !p_sys->b_bad_scr &&
+        p_sys->i_first_scr != VLC_TICK_INVALID &&
+        p_sys->i_last_scr > p_sys->i_first_scr )
+    {
+        p_sys->i_length = p_sys->i_last_scr - p_sys->i_first_scr;
+        msg_Dbg( p_demux, "we found a SCR length of: %"PRId64 "s",
+                 SEC_FROM_VLC_TICK(p_sys->i_length) );
+    }
     return true;
 }
 
@@ -414,6 +512,8 @@ static int Demux( demux_t *p_demux )
     int i_ret, i_mux_rate;
     block_t *p_pkt;
 
+    IndexerPoll( p_demux );
+
     i_ret = ps_pkt_resynch( p_demux->s, p_sys->format, p_sys->b_have_pack );
     if( i_ret < 0 )
     {
@@ -441,6 +541,7 @@ static int Demux( demux_t *p_demux )
             return VLC_DEMUXER_EGENERIC;
     }
 
+    const uint64_t i_pkt_pos = vlc_stream_Tell( p_demux->s );
     if( ( p_pkt = ps_pkt_read( p_demux->s ) ) == NULL )
     {
         return VLC_DEMUXER_EOF;
@@ -471,6 +572,8 @@ static int Demux( demux_t *p_demux )
             /* done later on to work around bad vcd/svcd streams */
             /* es_out_SetPCR( p_demux->out, p_sys->i_scr ); */
             if( i_mux_rate > 0 ) p_sys->i_mux_rate = i_mux_rate;
+            if( !p_sys->b_bad_scr )
+                ps_index_Add( &p_sys->index, p_sys->i_pack_scr, i_pkt_pos );
         }
         block_Release( p_pkt );
         break;
@@ -675,6 +778,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     int64_t i64;
     int i_ret;
 
+    IndexerPoll( p_demux );
+
     switch( i_query )
     {
         case DEMUX_CAN_SEEK:
@@ -765,6 +870,17 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
         {
+            if( p_sys->b_seekable && !p_sys->b_bad_scr && !p_sys->index.b_broken &&
+                p_sys->b_have_pack && p_sys->i_first_scr != VLC_TICK_INVALID )
+            {
+                va_list ap;
+
+                va_copy( ap, args );
+                i_ret = SeekTime( p_demux, va_arg( ap, vlc_tick_t ) );
+                va_end( ap );
+                if( i_ret == VLC_SUCCESS )
+                    return VLC_SUCCESS;
+            }
             if( p_sys->i_time_track_index >= 0 && p_sys->i_current_pts != VLC_TICK_INVALID &&
                 p_sys->i_length > VLC_TICK_0)
             {
@@ -820,6 +936,483 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     return VLC_EGENERIC;
 }
 
+/*****************************************************************************
+ * SCR index:
+ *****************************************************************************/
+static void ps_index_Init( ps_index_t *p_index )
+{
+    p_index->p_entries = NULL;
+    p_index->i_count = 0;
+    p_index->i_alloc = 0;
+    p_index->b_changed = false;
+    p_index->b_broken = false;
+}
+
+static void ps_index_Clean( ps_index_t *p_index )
+{
+    free( p_index->p_entries );
+}
+
+/* Returns the first entry at or after i_pos */
+static size_t ps_index_Lookup( const ps_index_t *p_index, uint64_t i_pos )
+{
+    size_t i_low = 0, i_high = p_index->i_count;
+
+    while( i_low < i_high )
+    {
+        size_t i_mid = (i_low + i_high) / 2;
+        if( p_index->p_entries[i_mid].i_pos < i_pos )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+/* Returns the last entry with an SCR at or before i_scr, or -1 */
+static ssize_t ps_index_Find( const ps_index_t *p_index, vlc_tick_t i_scr )
+{
+    size_t i_low = 0, i_high = p_index->i_count;
+
+    while( i_low < i_high )
+    {
+        size_t i_mid = (i_low + i_high) / 2;
+        if( p_index->p_entries[i_mid].i_scr <= i_scr )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return (ssize_t)i_low - 1;
+}
+
+static void ps_index_Add( ps_index_t *p_index, vlc_tick_t i_scr,
+                          uint64_t i_pos )
+{
+    if( p_index->b_broken || i_scr == VLC_TICK_INVALID )
+        return;
+
+    size_t i = ps_index_Lookup( p_index, i_pos );
+    const ps_index_entry_t *p_prev = i > 0 ? &p_index->p_entries[i - 1] : NULL;
+    const ps_index_entry_t *p_next = i < p_index->i_count ?
+                                     &p_index->p_entries[i] : NULL;
+
+    if( p_next != NULL && p_next->i_pos == i_pos )
+        return;
+
+    if( ( p_prev != NULL && p_prev->i_scr > i_scr ) ||
+        ( p_next != NULL && p_next->i_scr < i_scr ) )
+    {
+        /* Concatenated programs or 33 bits wrap around: the SCR cannot
+         * locate a position anymore. */
+        p_index->b_broken = true;
+        return;
+    }
+
+    /* Keep about one entry per interval */
+    if( ( p_prev != NULL && i_scr - p_prev->i_scr < PS_INDEX_INTERVAL ) ||
+        ( p_next != NULL && p_next->i_scr - i_scr < PS_INDEX_INTERVAL ) )
+        return;
+
+    if( p_index->i_count == p_index->i_alloc )
+    {
+        size_t i_alloc = p_index->i_alloc ? p_index->i_alloc * 2 : 256;
+        ps_index_entry_t *p_entries = realloc( p_index->p_entries,
+                                               i_alloc * sizeof( *p_entries ) );
+        if( unlikely(p_entries == NULL) )
+            return;
+        p_index->p_entries = p_entries;
+        p_index->i_alloc = i_alloc;
+    }
+
+    memmove( &p_index->p_entries[i + 1], &p_index->p_entries[i],
+             ( p_index->i_count - i ) * sizeof( *p_index->p_entries ) );
+    p_index->p_entries[i].i_scr = i_scr;
+    p_index->p_entries[i].i_pos = i_pos;
+    p_index->i_count++;
+    p_index->b_changed = true;
+}
+
+/* Finds the first pack header from i_pos, starting before i_end.
+ * p_buf must hold PS_PROBE_WINDOW bytes. */
+static int ProbePack( stream_t *s, uint8_t *p_buf, uint64_t i_pos,
+                      uint64_t i_end, ps_index_entry_t *p_entry )
+{
+    while( i_pos < i_end )
+    {
+        if( vlc_stream_Seek( s, i_pos ) != VLC_SUCCESS )
+            return VLC_EGENERIC;
+
+        /* Large reads, so that a pack is found in one request */
+        size_t i_want = __MIN( i_end - i_pos + 13, PS_PROBE_WINDOW );
+        ssize_t i_read = vlc_stream_Read( s, p_buf, i_want );
+        if( i_read < 14 )
+            return VLC_EGENERIC;
+
+        for( ssize_t i = 0; i <= i_read - 14 && i_pos + i < i_end; i++ )
+        {
+            int i_mux_rate;
+
+            if( p_buf[i] == 0x00 && p_buf[i+1] == 0x00 && p_buf[i+2] == 0x01 &&
+                p_buf[i+3] == PS_STREAM_ID_PACK_HEADER &&
+                !ps_parse_pack( &p_buf[i], i_read - i,
+                                &p_entry->i_scr, &i_mux_rate ) )
+            {
+                p_entry->i_pos = i_pos + i;
+                return VLC_SUCCESS;
+            }
+        }
+        i_pos += i_read - 13;
+    }
+    return VLC_EGENERIC;
+}
+
+/* Seeks to the last pack before a time, found in the index or by searching
+ * the file: the probes are placed by interpolating the SCR at the bounds,
+ * and fall back to bisection when that does not halve the segment. */
+static int SeekTime( demux_t *p_demux, vlc_tick_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ps_index_t *p_index = &p_sys->index;
+    const vlc_tick_t i_target = p_sys->i_first_scr + i_time;
+    const uint64_t i_size = stream_Size( p_demux->s );
+
+    ps_index_entry_t lower = { p_sys->i_first_scr, p_sys->i_start_byte };
+    ps_index_entry_t upper = { p_sys->i_last_scr, i_size };
+
+    if( i_size <= p_sys->i_start_byte )
+        return VLC_EGENERIC;
+
+    ssize_t i = ps_index_Find( p_index, i_target );
+    if( i >= 0 )
+        lower = p_index->p_entries[i];
+    if( (size_t)(i + 1) < p_index->i_count )
+        upper = p_index->p_entries[i + 1];
+    if( upper.i_scr != VLC_TICK_INVALID && upper.i_scr <= lower.i_scr )
+        upper.i_scr = VLC_TICK_INVALID;
+
+    uint8_t *p_buf = malloc( PS_PROBE_WINDOW );
+    if( unlikely(p_buf == NULL) )
+        return VLC_ENOMEM;
+
+    bool b_interpolate = true;
+    unsigned i_probes = 0;
+
+    while( i_target - lower.i_scr > PS_SEEK_PRECISION &&
+           upper.i_pos - lower.i_pos > PS_PROBE_WINDOW )
+    {
+        const uint64_t i_span = upper.i_pos - lower.i_pos;
+        uint64_t i_probe = lower.i_pos + i_span / 2;
+
+        if( b_interpolate && upper.i_scr != VLC_TICK_INVALID )
+        {
+            double f = (double)( i_target - lower.i_scr )
+                     / ( upper.i_scr - lower.i_scr );
+            i_probe = lower.i_pos + (uint64_t)( f * i_span );
+            i_probe = __MAX( i_probe, lower.i_pos + i_span / 16 );
+            i_probe = __MIN( i_probe, upper.i_pos - i_span / 16 );
+        }
+
+        ps_index_entry_t found;
+        i_probes++;
+        if( ProbePack( p_demux->s, p_buf, i_probe, upper.i_pos, &found ) )
+        {
+            /* No pack up to the upper bound */
+            upper.i_pos = i_probe;
+            b_interpolate = false;
+            continue;
+        }
+
+        if( found.i_scr < lower.i_scr ||
+            ( upper.i_scr != VLC_TICK_INVALID && found.i_scr > upper.i_scr ) )
+        {
+            msg_Dbg( p_demux, "SCR discontinuity, cannot seek by time" );
+            p_index->b_broken = true;
+            free( p_buf );
+            return VLC_EGENERIC;
+        }
+        ps_index_Add( p_index, found.i_scr, found.i_pos );
+
+        if( found.i_scr <= i_target )
+        {
+            b_interpolate = found.i_pos - lower.i_pos >= i_span / 2;
+            lower = found;
+        }
+        else
+        {
+            b_interpolate = upper.i_pos - found.i_pos >= i_span / 2;
+            upper = found;
+        }
+    }
+    free( p_buf );
+
+    msg_Dbg( p_demux, "seek to %"PRId64" ms: pack at %"PRIu64" (%"PRId64
+             " ms before), %u probes", MS_FROM_VLC_TICK( i_time ),
+             lower.i_pos, MS_FROM_VLC_TICK( i_target - lower.i_scr ),
+             i_probes );
+
+    if( vlc_stream_Seek( p_demux->s, lower.i_pos ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
+
+    p_sys->i_current_pts = VLC_TICK_INVALID;
+    p_sys->i_scr = VLC_TICK_INVALID;
+    NotifyDiscontinuity( p_sys->tk, p_demux->out );
+    return VLC_SUCCESS;
+}
+
+/* The index is saved in the user cache directory, keyed by the location
+ * and the size of the file. */
+static char *IndexCachePath( demux_t *p_demux )
+{
+    if( p_demux->psz_url == NULL ||
+        !var_InheritBool( p_demux, "ps-index-cache" ) )
+        return NULL;
+
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_dir == NULL )
+        return NULL;
+
+    uint8_t key[8];
+    struct md5_s md5;
+
+    SetQWLE( key, stream_Size( p_demux->s ) );
+    InitMD5( &md5 );
+    AddMD5( &md5, p_demux->psz_url, strlen( p_demux->psz_url ) );
+    AddMD5( &md5, key, sizeof( key ) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_path;
+
+    if( psz_hash == NULL ||
+        asprintf( &psz_path, "%s"DIR_SEP"ps-index"DIR_SEP"%s",
+                  psz_dir, psz_hash ) < 0 )
+        psz_path = NULL;
+    free( psz_hash );
+    free( psz_dir );
+    return psz_path;
+}
+
+static void IndexCacheLoad( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    char *psz_path = IndexCachePath( p_demux );
+    if( psz_path == NULL )
+        return;
+
+    FILE *p_file = vlc_fopen( psz_path, "rb" );
+    if( p_file == NULL )
+    {
+        free( psz_path );
+        return;
+    }
+
+    uint8_t hdr[12];
+    if( fread( hdr, 1, sizeof( hdr ), p_file ) != sizeof( hdr ) ||
+        memcmp( hdr, PS_CACHE_MAGIC, 8 ) )
+        goto end;
+
+    for( uint32_t i_count = GetDWLE( hdr + 8 ); i_count > 0; i_count-- )
+    {
+        uint8_t entry[16];
+        if( fread( entry, 1, sizeof( entry ), p_file ) != sizeof( entry ) )
+            break;
+        ps_index_Add( &p_sys->index, GetQWLE( entry ), GetQWLE( entry + 8 ) );
+    }
+    p_sys->index.b_changed = false;
+    msg_Dbg( p_demux, "%zu index entries loaded from %s",
+             p_sys->index.i_count, psz_path );
+
+end:
+    fclose( p_file );
+    free( psz_path );
+}
+
+static void IndexCacheSave( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const ps_index_t *p_index = &p_sys->index;
+
+    if( !p_index->b_changed || p_index->b_broken || p_sys->b_bad_scr ||
+        p_index->i_count < 2 )
+        return;
+
+    char *psz_path = IndexCachePath( p_demux );
+    if( psz_path == NULL )
+        return;
+
+    /* Create the missing parent directories */
+    for( char *p = strchr( psz_path + 1, DIR_SEP_CHAR ); p != NULL;
+         p = strchr( p + 1, DIR_SEP_CHAR ) )
+    {
+        *p = '\0';
+        vlc_mkdir( psz_path, 0700 );
+        *p = DIR_SEP_CHAR;
+    }
+
+    char *psz_tmp;
+    if( asprintf( &psz_tmp, "%s.tmp", psz_path ) < 0 )
+    {
+        free( psz_path );
+        return;
+    }
+
+    FILE *p_file = vlc_fopen( psz_tmp, "wb" );
+    if( p_file == NULL )
+    {
+        msg_Warn( p_demux, "cannot create seek index cache %s: %s",
+                  psz_tmp, vlc_strerror_c( errno ) );
+        goto end;
+    }
+
+    uint8_t hdr[12];
+    memcpy( hdr, PS_CACHE_MAGIC, 8 );
+    SetDWLE( hdr + 8, p_index->i_count );
+    bool b_error = fwrite( hdr, 1, sizeof( hdr ), p_file ) != sizeof( hdr );
+
+    for( size_t i = 0; i < p_index->i_count && !b_error; i++ )
+    {
+        uint8_t entry[16];
+        SetQWLE( entry, p_index->p_entries[i].i_scr );
+        SetQWLE( entry + 8, p_index->p_entries[i].i_pos );
+        b_error = fwrite( entry, 1, sizeof( entry ), p_file ) != sizeof( entry );
+    }
+
+    if( fclose( p_file ) )
+        b_error = true;
+    if( b_error || vlc_rename( psz_tmp, psz_path ) )
+    {
+        msg_Warn( p_demux, "cannot write seek index cache %s", psz_path );
+        vlc_unlink( psz_tmp );
+    }
+
+end:
+    free( psz_tmp );
+    free( psz_path );
+}
+
+/* Samples the SCR over the whole file through a second stream */
+struct ps_indexer_t
+{
+    vlc_object_t *p_obj;
+    stream_t     *s;
+    uint64_t      i_start;
+    uint64_t      i_size;
+    ps_index_t    index;
+
+    vlc_thread_t  thread;
+    atomic_bool   b_stop;
+    atomic_bool   b_done;
+};
+
+static void *IndexerThread( void *p_data )
+{
+    ps_indexer_t *p_idx = p_data;
+    uint8_t *p_buf = malloc( PS_PROBE_WINDOW );
+    const uint64_t i_span = p_idx->i_size - p_idx->i_start;
+    vlc_tick_t i_begin = vlc_tick_now();
+
+    for( unsigned i = 0; p_buf != NULL && i < PS_INDEX_PROBES &&
+         !p_idx->index.b_broken; i++ )
+    {
+        if( atomic_load_explicit( &p_idx->b_stop, memory_order_relaxed ) )
+            break;
+
+        uint64_t i_pos = p_idx->i_start + i_span * i / PS_INDEX_PROBES;
+        uint64_t i_end = p_idx->i_start + i_span * (i + 1) / PS_INDEX_PROBES;
+        ps_index_entry_t found;
+
+        if( !ProbePack( p_idx->s, p_buf, i_pos, i_end, &found ) )
+            ps_index_Add( &p_idx->index, found.i_scr, found.i_pos );
+    }
+    free( p_buf );
+
+    msg_Dbg( p_idx->p_obj, "%zu index entries sampled in %"PRId64" ms",
+             p_idx->index.i_count,
+             MS_FROM_VLC_TICK( vlc_tick_now() - i_begin ) );
+    atomic_store_explicit( &p_idx->b_done, true, memory_order_release );
+    return NULL;
+}
+
+static void IndexerDelete( ps_indexer_t *p_idx )
+{
+    vlc_stream_Delete( p_idx->s );
+    ps_index_Clean( &p_idx->index );
+    free( p_idx );
+}
+
+static void IndexerStart( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    uint64_t i_size = stream_Size( p_demux->s );
+
+    /* Small files are searched quickly enough, and cached ones do not
+     * need it */
+    if( !var_InheritBool( p_demux, "ps-index-background" ) ||
+        p_demux->psz_url == NULL || i_size < PS_INDEX_MIN_SIZE ||
+        p_sys->index.i_count > 0 )
+        return;
+
+    ps_indexer_t *p_idx = malloc( sizeof( *p_idx ) );
+    if( unlikely(p_idx == NULL) )
+        return;
+
+    p_idx->s = vlc_stream_NewURL( p_demux, p_demux->psz_url );
+    if( p_idx->s == NULL )
+    {
+        free( p_idx );
+        return;
+    }
+    p_idx->p_obj = VLC_OBJECT(p_demux);
+    p_idx->i_start = p_sys->i_start_byte;
+    p_idx->i_size = i_size;
+    ps_index_Init( &p_idx->index );
+    atomic_init( &p_idx->b_stop, false );
+    atomic_init( &p_idx->b_done, false );
+
+    if( vlc_clone( &p_idx->thread, IndexerThread, p_idx,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        IndexerDelete( p_idx );
+        return;
+    }
+    msg_Dbg( p_demux, "indexing in the background" );
+    p_sys->p_indexer = p_idx;
+}
+
+/* Merges the sampled entries once the background indexer is done */
+static void IndexerPoll( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ps_indexer_t *p_idx = p_sys->p_indexer;
+
+    if( p_idx == NULL ||
+        !atomic_load_explicit( &p_idx->b_done, memory_order_acquire ) )
+        return;
+
+    vlc_join( p_idx->thread, NULL );
+    if( p_idx->index.b_broken )
+        p_sys->index.b_broken = true;
+    for( size_t i = 0; i < p_idx->index.i_count; i++ )
+        ps_index_Add( &p_sys->index, p_idx->index.p_entries[i].i_scr,
+                      p_idx->index.p_entries[i].i_pos );
+    IndexerDelete( p_idx );
+    p_sys->p_indexer = NULL;
+}
+
+static void IndexerStop( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ps_indexer_t *p_idx = p_sys->p_indexer;
+
+    if( p_idx == NULL )
+        return;
+
+    atomic_store_explicit( &p_idx->b_stop, true, memory_order_relaxed );
+    vlc_join( p_idx->thread, NULL );
+    IndexerDelete( p_idx );
+    p_sys->p_indexer = NULL;
+}
+
 /*****************************************************************************
  * Divers:
  *****************************************************************************/
@@ -923,3 +1516,210 @@ static block_t *ps_pkt_read( stream_t *s )
 
     return NULL;
 }
+
+#ifdef PS_TEST
+# include <assert.h>
+# include <unistd.h>
+# include "../../lib/libvlc_internal.h"
+
+# define PACK_DURATION  3600    /* 40 ms at 90 kHz */
+# define PACK_COUNT     4500    /* 3 minutes */
+
+typedef struct
+{
+    uint8_t    *p_data;
+    size_t      i_size;
+    uint64_t    pi_pos[PACK_COUNT];
+    vlc_tick_t  pi_scr[PACK_COUNT];
+} ps_test_stream_t;
+
+/* One pack header followed by a padding packet, i_size bytes in total */
+static size_t WritePack( uint8_t *p, int64_t i_scr, size_t i_size )
+{
+    static const uint8_t header[] = { 0x00, 0x00, 0x01, 0xBA };
+    memcpy( p, header, 4 );
+    p[4] = 0x44 | ((i_scr >> 27) & 0x38) | ((i_scr >> 28) & 0x03);
+    p[5] = i_scr >> 20;
+    p[6] = ((i_scr >> 12) & 0xF8) | 0x04 | ((i_scr >> 13) & 0x03);
+    p[7] = i_scr >> 5;
+    p[8] = ((i_scr << 3) & 0xF8) | 0x04;
+    p[9] = 0x01;
+    p[10] = 0x01; p[11] = 0x89; p[12] = 0xC3; /* 10.08 Mbit/s */
+    p[13] = 0xF8;
+
+    const size_t i_padding = i_size - 14 - 6;
+    p[14] = 0x00; p[15] = 0x00; p[16] = 0x01; p[17] = 0xBE;
+    SetWBE( &p[18], i_padding );
+    memset( &p[20], 0xFF, i_padding );
+    return i_size;
+}
+
+/* Packs every 40 ms, of pfn_size(i) bytes */
+static void Generate( ps_test_stream_t *p_ts, size_t (*pfn_size)( unsigned ) )
+{
+    p_ts->i_size = 0;
+    for( unsigned i = 0; i < PACK_COUNT; i++ )
+        p_ts->i_size += pfn_size( i );
+    p_ts->p_data = malloc( p_ts->i_size );
+    assert( p_ts->p_data != NULL );
+
+    uint64_t i_pos = 0;
+    for( unsigned i = 0; i < PACK_COUNT; i++ )
+    {
+        int i_mux_rate;
+        p_ts->pi_pos[i] = i_pos;
+        i_pos += WritePack( &p_ts->p_data[i_pos],
+                            90000 + (int64_t)i * PACK_DURATION, pfn_size( i ) );
+        assert( !ps_parse_pack( &p_ts->p_data[p_ts->pi_pos[i]], 14,
+                                &p_ts->pi_scr[i], &i_mux_rate ) );
+    }
+}
+
+static size_t ConstantSize( unsigned i )
+{
+    VLC_UNUSED( i );
+    return 2048;
+}
+
+/* Dense first fifth, sparse rest: interpolating the bounds misses */
+static size_t VariableSize( unsigned i )
+{
+    return i < PACK_COUNT / 5 ? 8192 : 512 + (i * 7919) % 256;
+}
+
+static demux_t *CreateDemux( vlc_object_t *parent, ps_test_stream_t *p_ts )
+{
+    demux_t *p_demux = vlc_object_create( parent, sizeof (*p_demux) );
+    assert( p_demux != NULL );
+    p_demux->s = vlc_stream_MemoryNew( p_demux, p_ts->p_data,
+                                       p_ts->i_size, true );
+    assert( p_demux->s != NULL );
+
+    demux_sys_t *p_sys = calloc( 1, sizeof (*p_sys) );
+    assert( p_sys != NULL );
+    ps_index_Init( &p_sys->index );
+    p_sys->i_first_scr = p_ts->pi_scr[0];
+    p_sys->i_last_scr = p_ts->pi_scr[PACK_COUNT - 1];
+    p_sys->i_start_byte = 0;
+    p_sys->b_have_pack = true;
+    p_sys->b_seekable = true;
+    p_demux->p_sys = p_sys;
+    return p_demux;
+}
+
+static void DestroyDemux( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ps_index_Clean( &p_sys->index );
+    free( p_sys );
+    vlc_stream_Delete( p_demux->s );
+    vlc_object_delete( p_demux );
+}
+
+/* Seeks, and checks it landed on the last pack before the time, or on a
+ * pack close enough for the demuxer to read up to it */
+static void CheckSeek( demux_t *p_demux, const ps_test_stream_t *p_ts,
+                       vlc_tick_t i_time )
+{
+    const vlc_tick_t i_target = p_ts->pi_scr[0] + i_time;
+    assert( SeekTime( p_demux, i_time ) == VLC_SUCCESS );
+
+    const uint64_t i_pos = vlc_stream_Tell( p_demux->s );
+    unsigned i = 0, i_exact = 0;
+    while( i < PACK_COUNT && p_ts->pi_pos[i] != i_pos )
+        i++;
+    assert( i < PACK_COUNT );
+    while( i_exact + 1 < PACK_COUNT && p_ts->pi_scr[i_exact + 1] <= i_target )
+        i_exact++;
+
+    assert( p_ts->pi_scr[i] <= i_target );
+    assert( i_target - p_ts->pi_scr[i] <= PS_SEEK_PRECISION ||
+            p_ts->pi_pos[i_exact] - i_pos <= PS_PROBE_WINDOW );
+
+    /* The index stays sorted by position and by SCR */
+    const demux_sys_t *p_sys = p_demux->p_sys;
+    const ps_index_t *p_index = &p_sys->index;
+    assert( !p_index->b_broken );
+    for( size_t j = 1; j < p_index->i_count; j++ )
+    {
+        assert( p_index->p_entries[j].i_pos > p_index->p_entries[j - 1].i_pos );
+        assert( p_index->p_entries[j].i_scr >= p_index->p_entries[j - 1].i_scr
+                                             + PS_INDEX_INTERVAL );
+    }
+}
+
+static void TestIndex( void )
+{
+    ps_index_t index;
+    ps_index_Init( &index );
+
+    ps_index_Add( &index, VLC_TICK_FROM_SEC(10), 10000 );
+    ps_index_Add( &index, VLC_TICK_FROM_SEC(2), 2000 );
+    ps_index_Add( &index, VLC_TICK_FROM_SEC(5), 5000 );
+    /* too close to a neighbour, or already known */
+    ps_index_Add( &index, VLC_TICK_FROM_MS(5500), 5500 );
+    ps_index_Add( &index, VLC_TICK_FROM_SEC(5), 5000 );
+    assert( index.i_count == 3 );
+    assert( index.p_entries[0].i_pos == 2000 );
+    assert( index.p_entries[2].i_pos == 10000 );
+
+    assert( ps_index_Find( &index, VLC_TICK_FROM_SEC(1) ) == -1 );
+    assert( ps_index_Find( &index, VLC_TICK_FROM_SEC(5) ) == 1 );
+    assert( ps_index_Find( &index, VLC_TICK_FROM_SEC(7) ) == 1 );
+    assert( ps_index_Find( &index, VLC_TICK_FROM_SEC(60) ) == 2 );
+
+    /* An SCR going back with the position makes it unusable */
+    ps_index_Add( &index, VLC_TICK_FROM_SEC(1), 7000 );
+    assert( index.b_broken );
+    ps_index_Add( &index, VLC_TICK_FROM_SEC(20), 20000 );
+    assert( index.i_count == 3 );
+
+    ps_index_Clean( &index );
+}
+
+static void TestSeek( vlc_object_t *parent, size_t (*pfn_size)( unsigned ),
+                      size_t i_max_entries )
+{
+    static const unsigned times[] = { 37, 1, 179, 90, 0, 120, 45, 150, 2 };
+    ps_test_stream_t *p_ts = malloc( sizeof (*p_ts) );
+    assert( p_ts != NULL );
+    Generate( p_ts, pfn_size );
+
+    /* From an empty index */
+    demux_t *p_demux = CreateDemux( parent, p_ts );
+    CheckSeek( p_demux, p_ts, VLC_TICK_FROM_MS(37420) );
+    demux_sys_t *p_sys = p_demux->p_sys;
+    assert( p_sys->index.i_count <= i_max_entries );
+    DestroyDemux( p_demux );
+
+    /* With the entries of the previous seeks */
+    p_demux = CreateDemux( parent, p_ts );
+    for( size_t i = 0; i < ARRAY_SIZE(times); i++ )
+    {
+        CheckSeek( p_demux, p_ts, VLC_TICK_FROM_SEC(times[i]) );
+        CheckSeek( p_demux, p_ts, VLC_TICK_FROM_SEC(times[i])
+                                  + VLC_TICK_FROM_MS(730) );
+    }
+    DestroyDemux( p_demux );
+
+    free( p_ts->p_data );
+    free( p_ts );
+}
+
+int main( void )
+{
+    alarm( 60 );
+
+    libvlc_int_t *vlc = libvlc_InternalCreate();
+    assert( vlc != NULL );
+
+    TestIndex();
+    /* Constant rate: the interpolation brackets the pack at once */
+    TestSeek( VLC_OBJECT(vlc), ConstantSize, 2 );
+    /* Variable rate: the bisection still converges */
+    TestSeek( VLC_OBJECT(vlc), VariableSize, 20 );
+
+    libvlc_InternalDestroy( vlc );
+    return 0;
+}
+#endif
@@ -428,17 +428,16 @@ static inline int ps_pkt_size( const uint8_t *p, int i_peek )
     return -1;
 }
 
-/* parse a PACK PES */
-static inline int ps_pkt_parse_pack( block_t *p_pkt, vlc_tick_t *pi_scr,
-                                     int *pi_mux_rate )
+/* parse a PACK header from a buffer */
+static inline int ps_parse_pack( const uint8_t *p, size_t i_buffer,
+                                 vlc_tick_t *pi_scr, int *pi_mux_rate )
 {
-    uint8_t *p = p_pkt->p_buffer;
-    if( p_pkt->i_buffer >= 14 && (p[4] >> 6) == 0x01 )
+    if( i_buffer >= 14 && (p[4] >> 6) == 0x01 )
     {
         *pi_scr = FROM_SCALE( ExtractPackHeaderTimestamp( &p[4] ) );
         *pi_mux_rate = ( p[10] << 14 )|( p[11] << 6 )|( p[12] >> 2);
     }
-    else if( p_pkt->i_buffer >= 12 && (p[4] >> 4) == 0x02 ) /* MPEG-1 Pack SCR, same bits as PES/PTS */
+    else if( i_buffer >= 12 && (p[4] >> 4) == 0x02 ) /* MPEG-1 Pack SCR, same bits as PES/PTS */
     {
         stime_t i_scr;
         if(!ExtractPESTimestamp( &p[4], 0x02, &i_scr ))
@@ -453,6 +452,14 @@ static inline int ps_pkt_parse_pack( block_t *p_pkt, vlc_tick_t *pi_scr,
     return VLC_SUCCESS;
 }
 
+/* parse a PACK PES */
+static inline int ps_pkt_parse_pack( block_t *p_pkt, vlc_tick_t *pi_scr,
+                                     int *pi_mux_rate )
+{
+    return ps_parse_pack( p_pkt->p_buffer, p_pkt->i_buffer,
+                          pi_scr, pi_mux_rate );
+}
+
 /* Parse a SYSTEM PES */
 static inline int ps_pkt_parse_system( block_t *p_pkt, ps_psm_t *p_psm,
                                        ps_track_t tk[PS_TK_COUNT] )
@@ -45,6 +45,7 @@
 #include "ts_hotfixes.h"
 #include "ts_sl.h"
 #include "ts_metadata.h"
+#include "ts_split.h"
 #include "sections.h"
 #include "pes.h"
 #include "timestamps.h"
@@ -60,6 +61,7 @@
 #endif
 
 #include <assert.h>
+#include <stdatomic.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -118,6 +120,12 @@ static void Close ( vlc_object_t * );
 #define TS_SKIP_GHOST_PROGRAM_TEXT "Only create ES on program sending data"
 #define TS_OFFSETFIX_TEXT   "Try to fix too early PCR (or late DTS)"
 
+#define PROGRAM_OUT_TEXT N_("Per program output")
+#define PROGRAM_OUT_LONGTEXT N_( \
+    "Also write each program of the stream, as a single program transport " \
+    "stream, to its own output (access://location, where %d is replaced " \
+    "by the program number, e.g. file:///tmp/program-%d.ts)." )
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -152,6 +160,8 @@ vlc_module_begin ()
         change_safe()
     add_integer( "ts-csa-pkt", 188, CPKT_TEXT, CPKT_LONGTEXT, true )
         change_safe()
+    add_string( "ts-program-out", NULL, PROGRAM_OUT_TEXT,
+                PROGRAM_OUT_LONGTEXT, true )
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
@@ -192,6 +202,8 @@ static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, stime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static uint64_t TSTell( demux_sys_t * );
+static int TSSeek( demux_sys_t *, uint64_t );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, stime_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, stime_t );
@@ -400,6 +412,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->p_batch = NULL;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -494,6 +507,13 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_split_es = var_InheritBool( p_demux, "ts-split-es" );
 
+    psz_string = var_InheritString( p_demux, "ts-program-out" );
+    if( psz_string )
+    {
+        p_sys->p_split = ts_split_New( p_demux, psz_string );
+        free( psz_string );
+    }
+
     p_sys->b_canseek = false;
     p_sys->b_canfastseek = false;
     p_sys->b_ignore_time_for_positions = var_InheritBool( p_demux, "ts-seek-percent" );
@@ -582,9 +602,14 @@ static void Close( vlc_object_t *p_this )
 
     vlc_mutex_destroy( &p_sys->csa_lock );
 
+    FlushPacketBatch( p_sys );
+
     /* Release all non default pids */
     ts_pid_list_Release( p_demux, &p_sys->pids );
 
+    if( p_sys->p_split )
+        ts_split_Delete( p_sys->p_split );
+
     /* Clear up attachments */
     vlc_dictionary_clear( &p_sys->attachments, FreeDictAttachment, NULL );
 
@@ -642,7 +667,9 @@ static int Demux( demux_t *p_demux )
 
         if( p_sys->b_start_record )
         {
-            /* Enable recording once synchronized */
+            /* Enable recording once synchronized, from the next packet */
+            if( UnreadPacketBatch( p_sys ) != VLC_SUCCESS )
+                msg_Warn( p_demux, "recording starts after the buffered packets" );
             vlc_stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE, true,
                                 "ts" );
             p_sys->b_start_record = false;
@@ -680,6 +707,9 @@ static int Demux( demux_t *p_demux )
         if( !p_pkt )
             continue;
 
+        if( p_sys->p_split )
+            ts_split_Packet( p_demux, p_sys->p_split, p_pkt );
+
         if( !SCRAMBLED(*p_pid) != !(p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) )
         {
             UpdatePIDScrambledState( p_demux, p_pid, p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED );
@@ -950,7 +980,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            uint64_t offset = vlc_stream_Tell( p_sys->stream );
+            uint64_t offset = TSTell( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -997,7 +1027,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         i64 = stream_Size( p_sys->stream );
         if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            TSSeek( p_sys, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
             ReadyQueuesPostSeek( p_demux );
             return VLC_SUCCESS;
@@ -1129,9 +1159,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 
     case DEMUX_SET_TITLE:
+        FlushPacketBatch( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_TITLE, args );
 
     case DEMUX_SET_SEEKPOINT:
+        FlushPacketBatch( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_SEEKPOINT,
                                      args );
 
@@ -1155,8 +1187,12 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         b_bool = va_arg( args, int );
 
         if( !b_bool )
+        {
+            /* Leave the stream where the demuxer is */
+            UnreadPacketBatch( p_sys );
             vlc_stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE,
                                 false );
+        }
         p_sys->b_start_record = b_bool;
         return VLC_SUCCESS;
 
@@ -1727,79 +1763,315 @@ static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool
     return b_ret;
 }
 
-static block_t* ReadTSPacket( demux_t *p_demux )
+/*
+ * TS packets are read from the stream in batches of up to
+ * TS_PACKET_BATCH_COUNT packets. Each packet handed to the demuxer is a
+ * block_t view into the batch buffer, so that there is no per-packet
+ * allocation or copy. The batch memory is released along with its last view.
+ * When the stream provides blocks, a batch borrows the stream block instead
+ * of copying it, and only packets straddling two blocks are copied.
+ */
+#define TS_PACKET_BATCH_COUNT 128
+
+typedef struct
 {
-    demux_sys_t *p_sys = p_demux->p_sys;
+    block_t self;
+    ts_packet_batch_t *p_batch;
+} ts_packet_view_t;
 
-    block_t     *p_pkt;
+struct ts_packet_batch_t
+{
+    atomic_uint refs;
+    size_t      i_size;   /* buffer capacity */
+    size_t      i_data;   /* bytes read into the buffer */
+    size_t      i_offset; /* bytes already handed out or skipped */
+    size_t      i_descrambled; /* end of the packets already descrambled */
+    unsigned    i_views;
+    unsigned    i_max_views;
+    block_t    *p_source; /* borrowed data, or NULL if owned */
+    uint8_t    *p_data;
+    ts_packet_view_t views[];
+};
+
+static ts_packet_batch_t * NewPacketBatch( size_t i_packet_size )
+{
+    const size_t i_views = sizeof(ts_packet_view_t) * TS_PACKET_BATCH_COUNT;
+    const size_t i_size = i_packet_size * TS_PACKET_BATCH_COUNT;
 
-    /* Get a new TS packet */
-    if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
-    {
-        int64_t size = stream_Size( p_sys->stream );
-        if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
-            msg_Dbg( p_demux, "EOF at %"PRIu64, vlc_stream_Tell( p_sys->stream ) );
-        else
-            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, vlc_stream_Tell(p_sys->stream) );
+    ts_packet_batch_t *p_batch = malloc( sizeof(*p_batch) + i_views + i_size );
+    if( unlikely(p_batch == NULL) )
         return NULL;
+
+    atomic_init( &p_batch->refs, 1 );
+    p_batch->i_size = i_size;
+    p_batch->i_data = 0;
+    p_batch->i_offset = 0;
+    p_batch->i_descrambled = 0;
+    p_batch->i_views = 0;
+    p_batch->i_max_views = TS_PACKET_BATCH_COUNT;
+    p_batch->p_source = NULL;
+    p_batch->p_data = ((uint8_t *) p_batch->views) + i_views;
+    return p_batch;
+}
+
+static ts_packet_batch_t * NewSourcePacketBatch( block_t *p_source,
+                                                 size_t i_packet_size )
+{
+    const unsigned i_max_views = p_source->i_buffer / i_packet_size;
+
+    ts_packet_batch_t *p_batch = malloc( sizeof(*p_batch) +
+                                         sizeof(ts_packet_view_t) * i_max_views );
+    if( unlikely(p_batch == NULL) )
+        return NULL;
+
+    atomic_init( &p_batch->refs, 1 );
+    p_batch->i_size = p_source->i_buffer;
+    p_batch->i_data = p_source->i_buffer;
+    p_batch->i_offset = 0;
+    p_batch->i_descrambled = 0;
+    p_batch->i_views = 0;
+    p_batch->i_max_views = i_max_views;
+    p_batch->p_source = p_source;
+    p_batch->p_data = p_source->p_buffer;
+    return p_batch;
+}
+
+static void ReleasePacketBatch( ts_packet_batch_t *p_batch )
+{
+    if( atomic_fetch_sub( &p_batch->refs, 1 ) == 1 )
+    {
+        if( p_batch->p_source )
+            block_Release( p_batch->p_source );
+        free( p_batch );
     }
+}
+
+static void PacketViewRelease( block_t *p_block )
+{
+    ts_packet_view_t *p_view = container_of( p_block, ts_packet_view_t, self );
+    ReleasePacketBatch( p_view->p_batch );
+}
+
+static const struct vlc_block_callbacks packet_view_cbs =
+{
+    PacketViewRelease,
+};
 
-    if( p_pkt->i_buffer < TS_HEADER_SIZE + p_sys->i_packet_header_size )
+void FlushPacketBatch( demux_sys_t *p_sys )
+{
+    if( p_sys->p_batch )
     {
-        block_Release( p_pkt );
-        return NULL;
+        ReleasePacketBatch( p_sys->p_batch );
+        p_sys->p_batch = NULL;
     }
+}
 
-    /* Skip header (BluRay streams).
-     * re-sync logic would do this (by adjusting packet start), but this would result in losing first and last ts packets.
-     * First packet is usually PAT, and losing it means losing whole first GOP. This is fatal with still-image based menus.
-     */
-    p_pkt->p_buffer += p_sys->i_packet_header_size;
-    p_pkt->i_buffer -= p_sys->i_packet_header_size;
+/* Stream position of the next unread TS packet */
+static uint64_t TSTell( demux_sys_t *p_sys )
+{
+    uint64_t i_pos = vlc_stream_Tell( p_sys->stream );
+    if( p_sys->p_batch )
+        i_pos -= p_sys->p_batch->i_data - p_sys->p_batch->i_offset;
+    return i_pos;
+}
+
+static int TSSeek( demux_sys_t *p_sys, uint64_t i_pos )
+{
+    FlushPacketBatch( p_sys );
+    return vlc_stream_Seek( p_sys->stream, i_pos );
+}
+
+/* Gives the buffered packets back to the stream, before the data read from
+ * it changes (descrambling, recording). The packets stay buffered if the
+ * stream cannot seek back. */
+int UnreadPacketBatch( demux_sys_t *p_sys )
+{
+    if( p_sys->p_batch == NULL )
+        return VLC_SUCCESS;
+
+    const uint64_t i_pos = TSTell( p_sys );
+    if( i_pos != vlc_stream_Tell( p_sys->stream ) &&
+        vlc_stream_Seek( p_sys->stream, i_pos ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
+
+    FlushPacketBatch( p_sys );
+    return VLC_SUCCESS;
+}
+
+/* Ensures at least i_need unread bytes are buffered in the current batch */
+static bool FillPacketBatch( demux_sys_t *p_sys, size_t i_need )
+{
+    ts_packet_batch_t *p_batch = p_sys->p_batch;
 
-    /* Check sync byte and re-sync if needed */
-    if( p_pkt->p_buffer[0] != 0x47 )
+    /* Streams providing blocks can lend their data */
+    const bool b_borrow = p_sys->stream->pf_block != NULL;
+
+    while( p_batch == NULL || p_batch->i_data - p_batch->i_offset < i_need )
     {
-        msg_Warn( p_demux, "lost synchro" );
-        block_Release( p_pkt );
-        for( ;; )
+        const size_t i_left = p_batch ? p_batch->i_data - p_batch->i_offset : 0;
+
+        if( b_borrow && i_left == 0 )
         {
-            const uint8_t *p_peek;
-            int i_peek = 0;
-            unsigned i_skip = 0;
+            block_t *p_block = vlc_stream_ReadBlock( p_sys->stream );
+            if( p_block == NULL )
+                return false;
 
-            i_peek = vlc_stream_Peek( p_sys->stream, &p_peek,
-                    p_sys->i_packet_size * 10 );
-            if( i_peek < 0 || (unsigned)i_peek < p_sys->i_packet_size + 1 )
+            ts_packet_batch_t *p_new = NewSourcePacketBatch( p_block,
+                                                             p_sys->i_packet_size );
+            if( unlikely(p_new == NULL) )
             {
-                msg_Dbg( p_demux, "eof ?" );
-                return NULL;
+                block_Release( p_block );
+                return false;
             }
+            if( p_batch )
+                ReleasePacketBatch( p_batch );
+            p_sys->p_batch = p_batch = p_new;
+            continue;
+        }
 
-            while( i_skip < i_peek - p_sys->i_packet_size )
+        if( p_batch == NULL || p_batch->i_size - p_batch->i_offset < i_need )
+        {
+            if( p_batch && !p_batch->p_source && atomic_load( &p_batch->refs ) == 1 )
             {
-                if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
-                {
-                    break;
-                }
-                i_skip++;
+                /* No packet view left: recycle the buffer */
+                memmove( p_batch->p_data, &p_batch->p_data[p_batch->i_offset], i_left );
+                p_batch->i_views = 0;
             }
-            msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
-            if (vlc_stream_Read( p_sys->stream, NULL, i_skip ) != i_skip)
-                return NULL;
-
-            if( i_skip < i_peek - p_sys->i_packet_size )
+            else
             {
-                break;
+                ts_packet_batch_t *p_new = NewPacketBatch( p_sys->i_packet_size );
+                if( unlikely(p_new == NULL) )
+                    return false;
+                if( p_batch )
+                {
+                    memcpy( p_new->p_data, &p_batch->p_data[p_batch->i_offset], i_left );
+                    ReleasePacketBatch( p_batch );
+                }
+                p_sys->p_batch = p_batch = p_new;
             }
+            p_batch->i_data = i_left;
+            p_batch->i_offset = 0;
+            p_batch->i_descrambled = 0;
         }
-        if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+
+        /* Only take what is available, so that live streams are not delayed.
+         * When borrowing, only complete the straddling packet. */
+        size_t i_toread = p_batch->i_size - p_batch->i_data;
+        if( b_borrow )
+            i_toread = __MIN( i_toread, i_need - (p_batch->i_data - p_batch->i_offset) );
+        ssize_t i_read = vlc_stream_ReadPartial( p_sys->stream,
+                                                 &p_batch->p_data[p_batch->i_data],
+                                                 i_toread );
+        if( i_read <= 0 )
+            return false;
+        p_batch->i_data += i_read;
+    }
+
+    return true;
+}
+
+/* Descrambles the buffered packets from the current one on, all at once.
+ * Descrambled packets have their scrambling control bits cleared, so they
+ * are left alone by ProcessTSPacket(). */
+static void DescramblePacketBatch( demux_sys_t *p_sys,
+                                   ts_packet_batch_t *p_batch )
+{
+    const size_t i_size = p_sys->i_packet_size;
+    const size_t i_header = p_sys->i_packet_header_size;
+    uint8_t *pp_pkts[TS_PACKET_BATCH_COUNT];
+    size_t i_pos = p_batch->i_offset;
+    int i_pkts = 0;
+
+    while( i_pkts < TS_PACKET_BATCH_COUNT &&
+           p_batch->i_data - i_pos >= i_size &&
+           p_batch->p_data[i_pos + i_header] == 0x47 )
+    {
+        uint8_t *p = &p_batch->p_data[i_pos + i_header];
+
+        /* Same packets as rejected by Demux() before descrambling */
+        if( (p[3] & 0x80) && !(p[1] & 0x80) &&
+            i_size - i_header >= TS_PACKET_SIZE_188 )
+            pp_pkts[i_pkts++] = p;
+        i_pos += i_size;
+    }
+    p_batch->i_descrambled = i_pos;
+
+    if( i_pkts > 0 )
+    {
+        vlc_mutex_lock( &p_sys->csa_lock );
+        csa_DecryptBatch( p_sys->csa, pp_pkts, i_pkts, p_sys->i_csa_pkt_size );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+    }
+}
+
+static block_t* ReadTSPacket( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_size = p_sys->i_packet_size;
+    const size_t i_header = p_sys->i_packet_header_size;
+    bool b_lost = false;
+
+    ts_packet_batch_t *p_batch;
+    const uint8_t *p;
+
+    for( ;; )
+    {
+        /* Re-sync needs the next packet sync byte as well */
+        if( !FillPacketBatch( p_sys, b_lost ? i_size + i_header + 1 : i_size ) )
         {
-            msg_Dbg( p_demux, "eof ?" );
+            uint64_t i_pos = TSTell( p_sys );
+            int64_t size = stream_Size( p_sys->stream );
+            if( size >= 0 && (uint64_t)size == i_pos )
+                msg_Dbg( p_demux, "EOF at %"PRIu64, i_pos );
+            else
+                msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, i_pos );
             return NULL;
         }
+
+        p_batch = p_sys->p_batch;
+        p = &p_batch->p_data[p_batch->i_offset];
+
+        /* Check sync byte and re-sync if needed
+         * The header (BluRay streams) is skipped but kept in the packet.
+         * Re-sync logic would do this (by adjusting packet start), but this
+         * would result in losing first and last ts packets. First packet is
+         * usually PAT, and losing it means losing whole first GOP. This is
+         * fatal with still-image based menus.
+         */
+        if( p[i_header] == 0x47 && ( !b_lost || p[i_header + i_size] == 0x47 ) )
+            break;
+
+        if( !b_lost )
+        {
+            msg_Warn( p_demux, "lost synchro" );
+            b_lost = true;
+            continue;
+        }
+
+        const size_t i_avail = p_batch->i_data - p_batch->i_offset;
+        size_t i_skip = 1;
+        while( i_skip + i_header + i_size < i_avail &&
+               ( p[i_skip + i_header] != 0x47 ||
+                 p[i_skip + i_header + i_size] != 0x47 ) )
+            i_skip++;
+
+        msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+        p_batch->i_offset += i_skip;
     }
+
+    if( p_sys->csa && p_batch->i_descrambled <= p_batch->i_offset )
+        DescramblePacketBatch( p_sys, p_batch );
+
+    assert( p_batch->i_views < p_batch->i_max_views );
+    ts_packet_view_t *p_view = &p_batch->views[p_batch->i_views++];
+    p_view->p_batch = p_batch;
+    atomic_fetch_add( &p_batch->refs, 1 );
+    p_batch->i_offset += i_size;
+
+    block_t *p_pkt = block_Init( &p_view->self, &packet_view_cbs,
+                                 (uint8_t *) p, i_size );
+    p_pkt->p_buffer += i_header;
+    p_pkt->i_buffer -= i_header;
     return p_pkt;
 }
 
@@ -1910,13 +2182,13 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
-        return vlc_stream_Seek( p_sys->stream, 0 );
+        return TSSeek( p_sys, 0 );
 
     const int64_t i_stream_size = stream_Size( p_sys->stream );
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TSTell( p_sys );
 
     /* Find the time position by using binary search algorithm. */
     uint64_t i_head_pos = 0;
@@ -1932,7 +2204,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
         uint64_t i_div = i_splitpos % p_sys->i_packet_size;
         i_splitpos -= i_div;
 
-        if ( vlc_stream_Seek( p_sys->stream, i_splitpos ) != VLC_SUCCESS )
+        if ( TSSeek( p_sys, i_splitpos ) != VLC_SUCCESS )
             break;
 
         uint64_t i_pos = i_splitpos;
@@ -1946,7 +2218,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
                 break;
             }
             else
-                i_pos = vlc_stream_Tell( p_sys->stream );
+                i_pos = TSTell( p_sys );
 
             int i_pid = PIDGet( p_pkt );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
@@ -2003,7 +2275,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
-        vlc_stream_Seek( p_sys->stream, i_initial_pos );
+        TSSeek( p_sys, i_initial_pos );
         return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
@@ -2084,7 +2356,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, stime_t *pi_
                         if( b_end )
                         {
                             p_pmt->i_last_dts = *pi_pcr;
-                            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                            p_pmt->i_last_dts_byte = TSTell( p_sys );
                         }
                         /* Start, only keep first */
                         else if( b_pcrresult && p_pmt->pcr.i_first == -1 )
@@ -2112,7 +2384,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, stime_t *pi_
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TSTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = 0;
@@ -2125,7 +2397,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_pos = p_sys->i_packet_size * i_probe_count;
         i_pos = __MIN( i_pos, i_stream_size );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TSSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, false, &i_pcr, &b_found );
@@ -2135,7 +2407,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
     } while( i_pos < i_stream_size && !b_found &&
              i_probe_count < PROBE_MAX );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TSSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2144,7 +2416,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TSTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = PROBE_CHUNK_COUNT;
@@ -2157,7 +2429,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_pos = i_stream_size - (p_sys->i_packet_size * i_probe_count);
         i_pos = __MAX( i_pos, 0 );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TSSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, true, &i_pcr, &b_found );
@@ -2167,7 +2439,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
     } while( i_pos > 0 && !b_found &&
              i_probe_count < PROBE_MAX );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TSSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2218,14 +2490,14 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, stime_t i_pcr )
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            TSTell( p_sys ) > p_pmt->i_last_dts_byte )
         {
             if( p_pmt->i_last_dts_byte == 0 ) /* first run */
                 p_pmt->i_last_dts_byte = stream_Size( p_sys->stream );
             else
             {
                 p_pmt->i_last_dts = i_pcr;
-                p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                p_pmt->i_last_dts_byte = TSTell( p_sys );
             }
         }
     }
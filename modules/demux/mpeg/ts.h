@@ -24,6 +24,8 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_packet_batch_t ts_packet_batch_t;
+typedef struct ts_split_t ts_split_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -70,6 +72,9 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* pending TS packets read from the stream */
+    ts_packet_batch_t *p_batch;
+
     bool        b_cc_check;
     bool        b_ignore_time_for_positions;
 
@@ -111,6 +116,9 @@ struct demux_sys_t
     bool        b_access_control;
     bool        b_end_preparse;
 
+    /* Per program outputs, if any */
+    ts_split_t  *p_split;
+
     /* */
     time_t      i_network_time;
     time_t      i_network_time_update; /* for network time interpolation */
@@ -146,6 +154,9 @@ void TsChangeStandard( demux_sys_t *, ts_standards_e );
 
 bool ProgramIsSelected( demux_sys_t *, uint16_t i_pgrm );
 
+void FlushPacketBatch( demux_sys_t * );
+int UnreadPacketBatch( demux_sys_t * );
+
 void UpdatePESFilters( demux_t *p_demux, bool b_all );
 
 int ProbeStart( demux_t *p_demux, int i_program );
@@ -28,6 +28,7 @@
 #include "timestamps.h"
 
 #include "ts.h"
+#include "ts_split.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -42,8 +43,8 @@ void ts_pid_list_Init( ts_pid_list_t *p_list )
     p_list->pp_all = NULL;
     p_list->i_all = 0;
     p_list->i_all_alloc = 0;
-    p_list->i_last_pid = 0;
-    p_list->p_last = NULL;
+    for( size_t i = 0; i < ARRAY_SIZE(p_list->pp_lut); i++ )
+        p_list->pp_lut[i] = NULL;
 }
 
 void ts_pid_list_Release( demux_t *p_demux, ts_pid_list_t *p_list )
@@ -60,6 +61,8 @@ void ts_pid_list_Release( demux_t *p_demux, ts_pid_list_t *p_list )
         free( pid );
     }
     free( p_list->pp_all );
+    for( size_t i = 0; i < ARRAY_SIZE(p_list->pp_lut); i++ )
+        free( p_list->pp_lut[i] );
 }
 
 struct searchkey
@@ -89,14 +92,31 @@ ts_pid_t * ts_pid_Get( ts_pid_list_t *p_list, uint16_t i_pid )
         case 0x1FFF:
             return &p_list->dummy;
         default:
-            if( p_list->i_last_pid == i_pid )
-                return p_list->p_last;
+            if( unlikely(i_pid > 0x1FFF) )
+                return &p_list->dummy;
         break;
     }
 
+    ts_pid_t **pp_lut = p_list->pp_lut[i_pid / PID_LUT_BLOCK];
+    if( likely(pp_lut) && likely(pp_lut[i_pid % PID_LUT_BLOCK]) )
+        return pp_lut[i_pid % PID_LUT_BLOCK];
+
+    /* First use of the PID */
     size_t i_index = 0;
-    ts_pid_t *p_pid = NULL;
 
+    if( pp_lut == NULL )
+    {
+        pp_lut = calloc( PID_LUT_BLOCK, sizeof(*pp_lut) );
+        if( !pp_lut )
+        {
+            abort();
+            //return NULL;
+        }
+        p_list->pp_lut[i_pid / PID_LUT_BLOCK] = pp_lut;
+    }
+
+    /* Keep the list sorted for ts_pid_Next(): the lookup only finds the
+     * insertion point, as the PID is not in the list yet */
     if( p_list->pp_all )
     {
         struct searchkey pidkey;
@@ -105,56 +125,49 @@ ts_pid_t * ts_pid_Get( ts_pid_list_t *p_list, uint16_t i_pid )
 
         ts_pid_t **pp_pidk = bsearch( &pidkey, p_list->pp_all, p_list->i_all,
                                       sizeof(ts_pid_t *), ts_bsearch_searchkey_Compare );
-        if ( pp_pidk )
-            p_pid = *pp_pidk;
-        else
-            i_index = (pidkey.pp_last - p_list->pp_all); /* Last visited index */
+        assert( pp_pidk == NULL );
+        VLC_UNUSED(pp_pidk);
+        i_index = (pidkey.pp_last - p_list->pp_all); /* Last visited index */
     }
 
-    if( p_pid == NULL )
+    if( p_list->i_all >= p_list->i_all_alloc )
     {
-        if( p_list->i_all >= p_list->i_all_alloc )
-        {
-            ts_pid_t **p_realloc = realloc( p_list->pp_all,
-                                            (p_list->i_all_alloc + PID_ALLOC_CHUNK) * sizeof(ts_pid_t *) );
-            if( !p_realloc )
-            {
-                abort();
-                //return NULL;
-            }
-            p_list->pp_all = p_realloc;
-            p_list->i_all_alloc += PID_ALLOC_CHUNK;
-        }
-
-        p_pid = calloc( 1, sizeof(*p_pid) );
-        if( !p_pid )
+        ts_pid_t **p_realloc = realloc( p_list->pp_all,
+                                        (p_list->i_all_alloc + PID_ALLOC_CHUNK) * sizeof(ts_pid_t *) );
+        if( !p_realloc )
         {
             abort();
             //return NULL;
         }
+        p_list->pp_all = p_realloc;
+        p_list->i_all_alloc += PID_ALLOC_CHUNK;
+    }
 
-        p_pid->i_cc  = 0xff;
-        p_pid->i_pid = i_pid;
-
-        /* Do insertion based on last bsearch mid point */
-        if( p_list->i_all )
-        {
-            if( p_list->pp_all[i_index]->i_pid < i_pid )
-                i_index++;
+    ts_pid_t *p_pid = calloc( 1, sizeof(*p_pid) );
+    if( !p_pid )
+    {
+        abort();
+        //return NULL;
+    }
 
-            memmove( &p_list->pp_all[i_index + 1],
-                    &p_list->pp_all[i_index],
-                    (p_list->i_all - i_index) * sizeof(ts_pid_t *) );
-        }
+    p_pid->i_cc  = 0xff;
+    p_pid->i_pid = i_pid;
 
-        p_list->pp_all[i_index] = p_pid;
-        p_list->i_all++;
+    /* Do insertion based on last bsearch mid point */
+    if( p_list->i_all )
+    {
+        if( p_list->pp_all[i_index]->i_pid < i_pid )
+            i_index++;
 
+        memmove( &p_list->pp_all[i_index + 1],
+                &p_list->pp_all[i_index],
+                (p_list->i_all - i_index) * sizeof(ts_pid_t *) );
     }
 
-    p_list->p_last = p_pid;
-    p_list->i_last_pid = i_pid;
+    p_list->pp_all[i_index] = p_pid;
+    p_list->i_all++;
 
+    pp_lut[i_pid % PID_LUT_BLOCK] = p_pid;
     return p_pid;
 }
 
@@ -317,8 +330,12 @@ int UpdateHWFilter( demux_sys_t *p_sys, ts_pid_t *p_pid )
     if( !p_sys->b_access_control )
         return VLC_EGENERIC;
 
+    /* Per program outputs may need PIDs that are not decoded */
+    bool b_on = (p_pid->i_flags & FLAG_FILTERED) ||
+                (p_sys->p_split && ts_split_HasPID( p_sys->p_split, p_pid->i_pid ));
+
     return vlc_stream_Control( p_sys->stream, STREAM_SET_PRIVATE_ID_STATE,
-                           p_pid->i_pid, !!(p_pid->i_flags & FLAG_FILTERED) );
+                               p_pid->i_pid, b_on );
 }
 
 int SetPIDFilter( demux_sys_t *p_sys, ts_pid_t *p_pid, bool b_selected )
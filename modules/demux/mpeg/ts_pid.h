@@ -24,6 +24,8 @@
 #define MIN_ES_PID 4    /* Should be 32.. broken muxers */
 #define MAX_ES_PID 8190
 
+#define PID_LUT_BLOCK 256
+
 #include "ts_streams.h"
 
 typedef struct demux_sys_t demux_sys_t;
@@ -93,9 +95,8 @@ struct ts_pid_list_t
     ts_pid_t **pp_all;
     int        i_all;
     int        i_all_alloc;
-    /* last recently used */
-    uint16_t   i_last_pid;
-    ts_pid_t  *p_last;
+    /* direct lookup table, by blocks of PID_LUT_BLOCK allocated on use */
+    ts_pid_t **pp_lut[(0x1FFF + PID_LUT_BLOCK) / PID_LUT_BLOCK];
 
 };
 
@@ -54,6 +54,7 @@
 #include "ts_psip.h"
 #include "ts_si.h"
 #include "ts_metadata.h"
+#include "ts_split.h"
 #include "ts_descriptions.h"
 
 #include "../access/dtv/en50221_capmt.h"
@@ -216,6 +217,26 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_dvbpsipat )
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP, p_sys->programs.p_elems[0] );
     }
 
+    if( p_sys->p_split )
+    {
+        const size_t i_programs = p_pat->programs.i_size;
+        uint16_t *pi_numbers = vlc_alloc( 2 * i_programs + 1, sizeof(uint16_t) );
+        if( likely(pi_numbers) )
+        {
+            uint16_t *pi_pmt_pids = &pi_numbers[i_programs];
+            for( size_t i = 0; i < i_programs; i++ )
+            {
+                const ts_pid_t *pmtpid = p_pat->programs.p_elems[i];
+                pi_numbers[i] = pmtpid->u.p_pmt->i_number;
+                pi_pmt_pids[i] = pmtpid->i_pid;
+            }
+            ts_split_SetPAT( p_demux, p_sys->p_split, p_pat->i_ts_id,
+                             p_pat->i_version, i_programs,
+                             pi_numbers, pi_pmt_pids );
+            free( pi_numbers );
+        }
+    }
+
     dvbpsi_pat_delete( p_dvbpsipat );
 }
 
@@ -2044,8 +2065,17 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
                 en50221_capmt_Delete( p_en );
                 if ( p_sys->standard == TS_STANDARD_ARIB && !p_sys->arib.b25stream )
                 {
+                    /* The buffered packets must go through the descrambler */
+                    bool b_unread = UnreadPacketBatch( p_sys ) == VLC_SUCCESS;
                     p_sys->arib.b25stream = vlc_stream_FilterNew( p_demux->s, "aribcam" );
                     p_sys->stream = ( p_sys->arib.b25stream ) ? p_sys->arib.b25stream : p_demux->s;
+                    /* or be dropped, as they are still scrambled, and not
+                     * accounted for in the position of the new stream */
+                    if( p_sys->arib.b25stream && !b_unread )
+                    {
+                        msg_Warn( p_demux, "dropping the buffered scrambled packets" );
+                        FlushPacketBatch( p_sys );
+                    }
                 }
             }
         }
@@ -2140,6 +2170,24 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
                   p_pmt->i_number, i_cand );
     }
 
+    if( p_sys->p_split )
+    {
+        size_t i_pids = 0;
+        for( const dvbpsi_pmt_es_t *p_es = p_dvbpsipmt->p_first_es; p_es; p_es = p_es->p_next )
+            i_pids++;
+
+        uint16_t *pi_pids = vlc_alloc( i_pids + 1, sizeof(uint16_t) );
+        if( likely(pi_pids) )
+        {
+            i_pids = 0;
+            for( const dvbpsi_pmt_es_t *p_es = p_dvbpsipmt->p_first_es; p_es; p_es = p_es->p_next )
+                pi_pids[i_pids++] = p_es->i_pid;
+            ts_split_SetPMT( p_demux, p_sys->p_split, p_pmt->i_number,
+                             p_dvbpsipmt->i_pcr_pid, i_pids, pi_pids );
+            free( pi_pids );
+        }
+    }
+
     UpdatePESFilters( p_demux, p_sys->seltype == PROGRAM_ALL );
 
     /* Probe Boundaries */
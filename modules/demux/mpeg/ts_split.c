@@ -0,0 +1,361 @@
+/*****************************************************************************
+ * ts_split.c: per program Transport Stream outputs
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_sout.h>
+#include <vlc_memstream.h>
+
+#ifndef _DVBPSI_DVBPSI_H_
+ #include <dvbpsi/dvbpsi.h>
+#endif
+#include <dvbpsi/descriptor.h>
+#include <dvbpsi/pat.h>
+
+#include "../../mux/mpeg/streams.h"
+#include "../../mux/mpeg/tsutil.h"
+#include "../../mux/mpeg/tables.h"
+
+#include "ts_pid.h"
+#include "ts_streams_private.h"
+#include "ts.h"
+#include "ts_split.h"
+
+#include <assert.h>
+
+#define TS_PACKET_SIZE_188 188
+
+/* Packets written at once, as for an UDP datagram */
+#define SPLIT_PACKETS 7
+
+typedef struct
+{
+    uint16_t i_number;
+    uint16_t i_pmt_pid;
+    uint32_t pids[0x2000 / 32];
+    tsmux_stream_t pat;
+    sout_access_out_t *p_access; /* NULL if it could not be opened */
+    block_t *p_pending;
+} ts_split_output_t;
+
+struct ts_split_t
+{
+    char *psz_access;
+    char *psz_path; /* "%d" is replaced by the program number */
+    int i_ts_id;
+    int i_version;
+    uint16_t refs[0x2000]; /* number of outputs for each PID */
+    DECL_ARRAY(ts_split_output_t *) outputs;
+};
+
+static bool OutputHasPID( const ts_split_output_t *p_out, uint16_t i_pid )
+{
+    return p_out->pids[i_pid / 32] & (UINT32_C(1) << (i_pid % 32));
+}
+
+/* Updates the PIDs of an output, and the access filters of the PIDs
+ * no other output nor the demuxer itself was already using */
+static void OutputSetPIDs( demux_t *p_demux, ts_split_t *p_split,
+                           ts_split_output_t *p_out,
+                           const uint32_t pids[0x2000 / 32] )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( uint16_t i_pid = 0; i_pid < 0x2000; i_pid++ )
+    {
+        bool b_old = OutputHasPID( p_out, i_pid );
+        bool b_new = pids[i_pid / 32] & (UINT32_C(1) << (i_pid % 32));
+
+        if( b_old == b_new )
+            continue;
+
+        if( b_new )
+        {
+            p_out->pids[i_pid / 32] |= UINT32_C(1) << (i_pid % 32);
+            if( p_split->refs[i_pid]++ > 0 )
+                continue;
+        }
+        else
+        {
+            p_out->pids[i_pid / 32] &= ~(UINT32_C(1) << (i_pid % 32));
+            assert( p_split->refs[i_pid] > 0 );
+            if( --p_split->refs[i_pid] > 0 )
+                continue;
+        }
+        UpdateHWFilter( p_sys, GetPID( p_sys, i_pid ) );
+    }
+}
+
+static void OutputFlush( ts_split_output_t *p_out )
+{
+    block_t *p_block = p_out->p_pending;
+
+    p_out->p_pending = NULL;
+    if( p_block == NULL )
+        return;
+    p_block->i_dts = vlc_tick_now();
+    sout_AccessOutWrite( p_out->p_access, p_block );
+}
+
+static void OutputWrite( ts_split_output_t *p_out, const uint8_t *p_pkt )
+{
+    if( p_out->p_pending == NULL )
+    {
+        p_out->p_pending = block_Alloc( SPLIT_PACKETS * TS_PACKET_SIZE_188 );
+        if( unlikely(p_out->p_pending == NULL) )
+            return;
+        p_out->p_pending->i_buffer = 0;
+    }
+
+    block_t *p_block = p_out->p_pending;
+    memcpy( &p_block->p_buffer[p_block->i_buffer], p_pkt, TS_PACKET_SIZE_188 );
+    p_block->i_buffer += TS_PACKET_SIZE_188;
+    if( p_block->i_buffer == SPLIT_PACKETS * TS_PACKET_SIZE_188 )
+        OutputFlush( p_out );
+}
+
+static char *OutputPath( const ts_split_t *p_split, uint16_t i_number )
+{
+    struct vlc_memstream stream;
+    const char *psz = p_split->psz_path;
+
+    vlc_memstream_open( &stream );
+    for( const char *psz_fmt; (psz_fmt = strstr( psz, "%d" )) != NULL;
+         psz = psz_fmt + 2 )
+    {
+        vlc_memstream_write( &stream, psz, psz_fmt - psz );
+        vlc_memstream_printf( &stream, "%"PRIu16, i_number );
+    }
+    vlc_memstream_puts( &stream, psz );
+
+    if( vlc_memstream_close( &stream ) )
+        return NULL;
+    return stream.ptr;
+}
+
+static ts_split_output_t *OutputNew( demux_t *p_demux, ts_split_t *p_split,
+                                     uint16_t i_number, uint16_t i_pmt_pid )
+{
+    ts_split_output_t *p_out = calloc( 1, sizeof(*p_out) );
+    if( unlikely(p_out == NULL) )
+        return NULL;
+
+    p_out->i_number = i_number;
+    p_out->i_pmt_pid = i_pmt_pid;
+    p_out->pat.i_pid = TS_PSI_PAT_PID;
+
+    char *psz_path = OutputPath( p_split, i_number );
+    if( psz_path != NULL )
+    {
+        msg_Dbg( p_demux, "program %"PRIu16" output to %s://%s",
+                 i_number, p_split->psz_access, psz_path );
+        p_out->p_access = sout_AccessOutNew( p_demux, p_split->psz_access,
+                                             psz_path );
+        if( p_out->p_access == NULL )
+            msg_Err( p_demux, "cannot open program %"PRIu16" output %s://%s",
+                     i_number, p_split->psz_access, psz_path );
+        free( psz_path );
+    }
+
+    if( p_out->p_access != NULL )
+    {
+        uint32_t pids[0x2000 / 32] = { 0 };
+
+        pids[TS_PSI_PAT_PID / 32] |= UINT32_C(1) << (TS_PSI_PAT_PID % 32);
+        pids[i_pmt_pid / 32] |= UINT32_C(1) << (i_pmt_pid % 32);
+        OutputSetPIDs( p_demux, p_split, p_out, pids );
+    }
+    return p_out;
+}
+
+static void OutputDelete( demux_t *p_demux, ts_split_t *p_split,
+                          ts_split_output_t *p_out )
+{
+    if( p_out->p_access != NULL )
+    {
+        const uint32_t none[0x2000 / 32] = { 0 };
+
+        if( p_demux != NULL )
+            OutputSetPIDs( p_demux, p_split, p_out, none );
+        OutputFlush( p_out );
+        sout_AccessOutDelete( p_out->p_access );
+    }
+    free( p_out );
+}
+
+ts_split_t * ts_split_New( demux_t *p_demux, const char *psz_dst )
+{
+    const char *psz_sep = strstr( psz_dst, "://" );
+    if( psz_sep == NULL || psz_sep == psz_dst )
+    {
+        msg_Err( p_demux, "invalid program output %s", psz_dst );
+        return NULL;
+    }
+
+    ts_split_t *p_split = calloc( 1, sizeof(*p_split) );
+    if( unlikely(p_split == NULL) )
+        return NULL;
+
+    p_split->psz_access = strndup( psz_dst, psz_sep - psz_dst );
+    p_split->psz_path = strdup( psz_sep + 3 );
+    if( unlikely(p_split->psz_access == NULL || p_split->psz_path == NULL) )
+    {
+        free( p_split->psz_access );
+        free( p_split->psz_path );
+        free( p_split );
+        return NULL;
+    }
+    p_split->i_ts_id = 0;
+    p_split->i_version = 0;
+    ARRAY_INIT( p_split->outputs );
+    return p_split;
+}
+
+void ts_split_Delete( ts_split_t *p_split )
+{
+    /* The demuxer PIDs are gone by now, leave the access filters alone */
+    for( int i = 0; i < p_split->outputs.i_size; i++ )
+        OutputDelete( NULL, p_split, p_split->outputs.p_elems[i] );
+    ARRAY_RESET( p_split->outputs );
+    free( p_split->psz_access );
+    free( p_split->psz_path );
+    free( p_split );
+}
+
+void ts_split_SetPAT( demux_t *p_demux, ts_split_t *p_split,
+                      int i_ts_id, int i_version, size_t i_programs,
+                      const uint16_t *pi_numbers, const uint16_t *pi_pmt_pids )
+{
+    p_split->i_ts_id = i_ts_id;
+    p_split->i_version = i_version;
+
+    /* Close the outputs of removed or moved programs */
+    for( int i = 0; i < p_split->outputs.i_size; )
+    {
+        ts_split_output_t *p_out = p_split->outputs.p_elems[i];
+        bool b_found = false;
+
+        for( size_t j = 0; j < i_programs && !b_found; j++ )
+            b_found = pi_numbers[j] == p_out->i_number &&
+                      pi_pmt_pids[j] == p_out->i_pmt_pid;
+        if( b_found )
+        {
+            i++;
+            continue;
+        }
+
+        msg_Dbg( p_demux, "closing program %"PRIu16" output", p_out->i_number );
+        ARRAY_REMOVE( p_split->outputs, i );
+        OutputDelete( p_demux, p_split, p_out );
+    }
+
+    /* Open the new ones */
+    for( size_t j = 0; j < i_programs; j++ )
+    {
+        bool b_found = false;
+
+        for( int i = 0; i < p_split->outputs.i_size && !b_found; i++ )
+            b_found = p_split->outputs.p_elems[i]->i_number == pi_numbers[j];
+        if( b_found || pi_numbers[j] == 0 /* NIT */ )
+            continue;
+
+        ts_split_output_t *p_out = OutputNew( p_demux, p_split, pi_numbers[j],
+                                              pi_pmt_pids[j] );
+        if( likely(p_out != NULL) )
+            ARRAY_APPEND( p_split->outputs, p_out );
+    }
+}
+
+void ts_split_SetPMT( demux_t *p_demux, ts_split_t *p_split, uint16_t i_number,
+                      uint16_t i_pcr_pid, size_t i_pids, const uint16_t *pi_pids )
+{
+    for( int i = 0; i < p_split->outputs.i_size; i++ )
+    {
+        ts_split_output_t *p_out = p_split->outputs.p_elems[i];
+        uint32_t pids[0x2000 / 32] = { 0 };
+
+        if( p_out->i_number != i_number || p_out->p_access == NULL )
+            continue;
+
+        pids[TS_PSI_PAT_PID / 32] |= UINT32_C(1) << (TS_PSI_PAT_PID % 32);
+        pids[p_out->i_pmt_pid / 32] |= UINT32_C(1) << (p_out->i_pmt_pid % 32);
+        if( i_pcr_pid < 0x1FFF )
+            pids[i_pcr_pid / 32] |= UINT32_C(1) << (i_pcr_pid % 32);
+        for( size_t j = 0; j < i_pids; j++ )
+            if( pi_pids[j] < 0x1FFF )
+                pids[pi_pids[j] / 32] |= UINT32_C(1) << (pi_pids[j] % 32);
+
+        OutputSetPIDs( p_demux, p_split, p_out, pids );
+    }
+}
+
+bool ts_split_HasPID( const ts_split_t *p_split, uint16_t i_pid )
+{
+    return i_pid < 0x2000 && p_split->refs[i_pid] > 0;
+}
+
+static void PATCallback( void *p_opaque, block_t *p_ts )
+{
+    OutputWrite( p_opaque, p_ts->p_buffer );
+    block_Release( p_ts );
+}
+
+void ts_split_Packet( demux_t *p_demux, ts_split_t *p_split, const block_t *p_pkt )
+{
+    const uint8_t *p = p_pkt->p_buffer;
+    const uint16_t i_pid = ((p[1] & 0x1f) << 8) | p[2];
+
+    if( p_split->refs[i_pid] == 0 )
+        return;
+
+    if( i_pid == TS_PSI_PAT_PID )
+    {
+        /* Send each program's own PAT, as often as the source one */
+        if( !(p[1] & 0x40) )
+            return;
+
+        demux_sys_t *p_sys = p_demux->p_sys;
+        dvbpsi_t *p_handle = GetPID( p_sys, 0 )->u.p_pat->handle;
+        for( int i = 0; i < p_split->outputs.i_size; i++ )
+        {
+            ts_split_output_t *p_out = p_split->outputs.p_elems[i];
+            tsmux_stream_t pmt = { .i_pid = p_out->i_pmt_pid };
+            int i_number = p_out->i_number;
+
+            if( p_out->p_access == NULL )
+                continue;
+            BuildPAT( p_handle, p_out, PATCallback,
+                      p_split->i_ts_id, p_split->i_version, &p_out->pat,
+                      1, &pmt, &i_number );
+        }
+        return;
+    }
+
+    for( int i = 0; i < p_split->outputs.i_size; i++ )
+    {
+        ts_split_output_t *p_out = p_split->outputs.p_elems[i];
+
+        if( OutputHasPID( p_out, i_pid ) )
+            OutputWrite( p_out, p );
+    }
+}
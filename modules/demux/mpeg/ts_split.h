@@ -0,0 +1,46 @@
+/*****************************************************************************
+ * ts_split.h: per program Transport Stream outputs
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_TS_SPLIT_H
+#define VLC_TS_SPLIT_H
+
+/*
+ * Each program of the multiplex is written as a single program transport
+ * stream to its own access output, without going through the elementary
+ * streams output. Packets of the program PIDs are passed as is, next to a
+ * PAT rewritten with only that program.
+ */
+
+ts_split_t * ts_split_New( demux_t *, const char *psz_dst );
+void ts_split_Delete( ts_split_t * );
+
+/* Programs of the current PAT. Outputs of the removed programs are closed. */
+void ts_split_SetPAT( demux_t *, ts_split_t *, int i_ts_id, int i_version,
+                      size_t i_programs, const uint16_t *pi_numbers,
+                      const uint16_t *pi_pmt_pids );
+/* PIDs of a program, from its current PMT. */
+void ts_split_SetPMT( demux_t *, ts_split_t *, uint16_t i_number,
+                      uint16_t i_pcr_pid, size_t i_pids, const uint16_t *pi_pids );
+
+/* Whether any output needs the PID, even if it is not selected for decoding */
+bool ts_split_HasPID( const ts_split_t *, uint16_t i_pid );
+
+void ts_split_Packet( demux_t *, ts_split_t *, const block_t * );
+
+#endif
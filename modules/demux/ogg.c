@@ -56,6 +56,11 @@
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define INDEX_CACHE_TEXT N_("Cache seek indexes")
+#define INDEX_CACHE_LONGTEXT N_( \
+    "Save the positions found while seeking, so that seeking to them again " \
+    "is immediate the next time the same file is opened." )
+
 vlc_module_begin ()
     set_shortname ( "OGG" )
     set_description( N_("OGG demuxer" ) )
@@ -64,6 +69,8 @@ vlc_module_begin ()
     set_capability( "demux", 50 )
     set_callbacks( Open, Close )
     add_shortcut( "ogg" )
+    add_bool( "ogg-index-cache", true,
+              INDEX_CACHE_TEXT, INDEX_CACHE_LONGTEXT, true )
 vlc_module_end ()
 
 
@@ -426,7 +433,10 @@ static int Demux( demux_t * p_demux )
             /* Find the real duration */
             vlc_stream_Control( p_demux->s, STREAM_CAN_SEEK, &b_canseek );
             if ( b_canseek )
+            {
                 Oggseek_ProbeEnd( p_demux );
+                Oggseek_IndexLoad( p_demux );
+            }
         }
         else
         {
@@ -2217,6 +2227,8 @@ static void Ogg_EndOfStream( demux_t *p_demux )
     demux_sys_t *p_ogg = p_demux->p_sys  ;
     int i_stream;
 
+    Oggseek_IndexSave( p_demux );
+
     for( i_stream = 0 ; i_stream < p_ogg->i_streams; i_stream++ )
         Ogg_LogicalStreamDelete( p_demux, p_ogg->pp_stream[i_stream] );
     free( p_ogg->pp_stream );
@@ -222,6 +222,9 @@ typedef struct
     /* Length in second, if available. */
     int64_t i_length;
 
+    /* seek index entries were added since it was loaded */
+    bool b_index_changed;
+
     bool b_slave;
 
 } demux_sys_t;
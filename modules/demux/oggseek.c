@@ -36,8 +36,12 @@
 
 #include <vlc_common.h>
 #include <vlc_demux.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
 
 #include <ogg/ogg.h>
+#include <errno.h>
 #include <limits.h>
 
 #include <assert.h>
@@ -171,6 +175,171 @@ static bool OggSeekIndexFind ( logical_stream_t *p_stream, vlc_tick_t i_timestam
     return false;
 }
 
+/* The index is saved in the user cache directory, keyed by the location
+ * and the size of the file, and the serial number of its first logical
+ * stream. */
+#define OGGSEEK_CACHE_MAGIC "VLCOGGX1"
+
+static char *OggSeekIndexCachePath( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if ( p_sys->i_streams == 0 || p_demux->psz_url == NULL ||
+         !var_InheritBool( p_demux, "ogg-index-cache" ) )
+        return NULL;
+
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    if ( psz_dir == NULL )
+        return NULL;
+
+    uint8_t key[12];
+    struct md5_s md5;
+
+    SetQWLE( key, p_sys->i_total_length );
+    SetDWLE( key + 8, p_sys->pp_stream[0]->os.serialno );
+    InitMD5( &md5 );
+    AddMD5( &md5, p_demux->psz_url, strlen( p_demux->psz_url ) );
+    AddMD5( &md5, key, sizeof( key ) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_path;
+
+    if ( psz_hash == NULL ||
+         asprintf( &psz_path, "%s"DIR_SEP"ogg-index"DIR_SEP"%s",
+                   psz_dir, psz_hash ) < 0 )
+        psz_path = NULL;
+    free( psz_hash );
+    free( psz_dir );
+    return psz_path;
+}
+
+void Oggseek_IndexLoad( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    char *psz_path = OggSeekIndexCachePath( p_demux );
+    if ( psz_path == NULL )
+        return;
+
+    FILE *p_file = vlc_fopen( psz_path, "rb" );
+    if ( p_file == NULL )
+    {
+        free( psz_path );
+        return;
+    }
+
+    uint8_t hdr[12];
+    if ( fread( hdr, 1, sizeof( hdr ), p_file ) != sizeof( hdr ) ||
+         memcmp( hdr, OGGSEEK_CACHE_MAGIC, 8 ) )
+        goto end;
+
+    for ( uint32_t i_count = GetDWLE( hdr + 8 ); i_count > 0; i_count-- )
+    {
+        uint8_t stream[8];
+        if ( fread( stream, 1, sizeof( stream ), p_file ) != sizeof( stream ) )
+            goto end;
+
+        logical_stream_t *p_stream = NULL;
+        for ( int i = 0; i < p_sys->i_streams; i++ )
+            if ( p_sys->pp_stream[i]->os.serialno == (int)GetDWLE( stream ) )
+                p_stream = p_sys->pp_stream[i];
+
+        for ( uint32_t i_entries = GetDWLE( stream + 4 ); i_entries > 0;
+              i_entries-- )
+        {
+            uint8_t entry[16];
+            if ( fread( entry, 1, sizeof( entry ), p_file ) != sizeof( entry ) )
+                goto end;
+            if ( p_stream != NULL )
+                OggSeek_IndexAdd( p_stream, GetQWLE( entry ),
+                                  GetQWLE( entry + 8 ) );
+        }
+    }
+    msg_Dbg( p_demux, "seek index loaded from %s", psz_path );
+
+end:
+    fclose( p_file );
+    free( psz_path );
+}
+
+void Oggseek_IndexSave( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if ( !p_sys->b_index_changed )
+        return;
+    p_sys->b_index_changed = false;
+
+    char *psz_path = OggSeekIndexCachePath( p_demux );
+    if ( psz_path == NULL )
+        return;
+
+    /* Create the missing parent directories */
+    for ( char *p = strchr( psz_path + 1, DIR_SEP_CHAR ); p != NULL;
+          p = strchr( p + 1, DIR_SEP_CHAR ) )
+    {
+        *p = '\0';
+        vlc_mkdir( psz_path, 0700 );
+        *p = DIR_SEP_CHAR;
+    }
+
+    char *psz_tmp;
+    if ( asprintf( &psz_tmp, "%s.tmp", psz_path ) < 0 )
+    {
+        free( psz_path );
+        return;
+    }
+
+    FILE *p_file = vlc_fopen( psz_tmp, "wb" );
+    if ( p_file == NULL )
+    {
+        msg_Warn( p_demux, "cannot create seek index cache %s: %s",
+                  psz_tmp, vlc_strerror_c( errno ) );
+        goto end;
+    }
+
+    uint8_t hdr[12];
+    memcpy( hdr, OGGSEEK_CACHE_MAGIC, 8 );
+    SetDWLE( hdr + 8, p_sys->i_streams );
+    bool b_error = fwrite( hdr, 1, sizeof( hdr ), p_file ) != sizeof( hdr );
+
+    for ( int i = 0; i < p_sys->i_streams && !b_error; i++ )
+    {
+        const logical_stream_t *p_stream = p_sys->pp_stream[i];
+        uint32_t i_entries = 0;
+
+        for ( const demux_index_entry_t *idx = p_stream->idx; idx != NULL;
+              idx = idx->p_next )
+            i_entries++;
+
+        uint8_t stream[8];
+        SetDWLE( stream, p_stream->os.serialno );
+        SetDWLE( stream + 4, i_entries );
+        b_error = fwrite( stream, 1, sizeof( stream ), p_file ) != sizeof( stream );
+
+        for ( const demux_index_entry_t *idx = p_stream->idx;
+              idx != NULL && !b_error; idx = idx->p_next )
+        {
+            uint8_t entry[16];
+            SetQWLE( entry, idx->i_value );
+            SetQWLE( entry + 8, idx->i_pagepos );
+            b_error = fwrite( entry, 1, sizeof( entry ), p_file ) != sizeof( entry );
+        }
+    }
+
+    if ( fclose( p_file ) )
+        b_error = true;
+    if ( b_error || vlc_rename( psz_tmp, psz_path ) )
+    {
+        msg_Warn( p_demux, "cannot write seek index cache %s", psz_path );
+        vlc_unlink( psz_tmp );
+    }
+
+end:
+    free( psz_tmp );
+    free( psz_path );
+}
+
 /*********************************************************************
  * private functions
  **********************************************************************/
@@ -339,7 +508,9 @@ static int64_t find_first_page_granule( demux_t *p_demux,
     if ( i_pos1 == p_stream->i_data_start )
         return p_sys->i_input_position;
 
-    if ( i_bytes_to_read > OGGSEEK_BYTES_TO_READ ) i_bytes_to_read = OGGSEEK_BYTES_TO_READ;
+    /* Large reads, so that a page is found in one request, also over HTTP */
+    if ( i_bytes_to_read > OGGSEEK_BISECT_BYTES_TO_READ )
+        i_bytes_to_read = OGGSEEK_BISECT_BYTES_TO_READ;
 
     while ( 1 )
     {
@@ -357,7 +528,7 @@ static int64_t find_first_page_granule( demux_t *p_demux,
             return -1;
         }
 
-        i_bytes_to_read = OGGSEEK_BYTES_TO_READ;
+        i_bytes_to_read = OGGSEEK_BISECT_BYTES_TO_READ;
 
         i_result = ogg_sync_pageseek( &p_sys->oy, &p_sys->current_page );
 
@@ -514,7 +685,8 @@ static int64_t OggForwardSeekToFrame( demux_t *p_demux, int64_t i_pos1, int64_t
 
     i_bytes_to_read = i_pos2 - i_pos1 + 1;
     seek_byte( p_demux, i_pos1 );
-    if ( i_bytes_to_read > OGGSEEK_BYTES_TO_READ ) i_bytes_to_read = OGGSEEK_BYTES_TO_READ;
+    if ( i_bytes_to_read > OGGSEEK_BISECT_BYTES_TO_READ )
+        i_bytes_to_read = OGGSEEK_BISECT_BYTES_TO_READ;
 
     OggDebug(
         msg_Dbg( p_demux, "Probing Fwd %"PRId64" %"PRId64" for granule %"PRId64,
@@ -531,7 +703,7 @@ static int64_t OggForwardSeekToFrame( demux_t *p_demux, int64_t i_pos1, int64_t
         if ( ! ( i_bytes_read = get_data( p_demux, i_bytes_to_read ) ) )
             return SEGMENT_NOT_FOUND;
 
-        i_bytes_to_read = OGGSEEK_BYTES_TO_READ;
+        i_bytes_to_read = OGGSEEK_BISECT_BYTES_TO_READ;
 
         i_result = ogg_sync_pageseek( &p_sys->oy, &p_sys->current_page );
 
@@ -629,10 +801,6 @@ restart:
 static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stream,
             vlc_tick_t i_targettime, int64_t i_pos_lower, int64_t i_pos_upper)
 {
-    int64_t i_start_pos;
-    int64_t i_end_pos;
-    int64_t i_segsize;
-
     struct
     {
         int64_t i_pos;
@@ -648,33 +816,43 @@ static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stre
     i_pos_upper = __MIN( i_pos_upper, p_sys->i_total_length );
     if ( i_pos_upper < 0 ) i_pos_upper = p_sys->i_total_length;
 
-    i_start_pos = i_pos_lower;
-    i_end_pos = i_pos_upper;
+    if ( i_pos_upper <= i_pos_lower )
+        return i_pos_lower;
+
+    /* Times at the bounds, when known, to interpolate the next probe */
+    int64_t i_lower = i_pos_lower;
+    int64_t i_upper = i_pos_upper;
+    vlc_tick_t i_lower_time = VLC_TICK_INVALID;
+    vlc_tick_t i_upper_time = VLC_TICK_INVALID;
+    bool b_interpolate = true;
 
-    i_segsize = ( i_end_pos - i_start_pos + 1 ) >> 1;
-    i_start_pos += i_segsize;
+    if ( i_lower == p_stream->i_data_start )
+        i_lower_time = VLC_TICK_0;
+    if ( i_upper == p_sys->i_total_length && p_sys->i_length > 0 )
+        i_upper_time = VLC_TICK_0 + vlc_tick_from_sec( p_sys->i_length );
 
     OggDebug( msg_Dbg(p_demux, "Bisecting for time=%"PRId64" between %"PRId64" and %"PRId64,
             i_targettime, i_pos_lower, i_pos_upper ) );
 
-    do
+    while ( i_upper - i_lower > 64 )
     {
-        /* see if the frame lies in current segment */
-        i_start_pos = __MAX( i_start_pos, i_pos_lower );
-        i_end_pos = __MIN( i_end_pos, i_pos_upper );
+        const int64_t i_span = i_upper - i_lower;
+        int64_t i_probe = i_lower + i_span / 2;
 
-        if ( i_start_pos >= i_end_pos )
+        if ( b_interpolate && i_lower_time != VLC_TICK_INVALID &&
+             i_upper_time > i_lower_time )
         {
-            if ( i_start_pos == i_pos_lower)
-            {
-                return i_start_pos;
-            }
-            return -1;
+            /* Assume a constant bitrate between the bounds, but keep away
+             * from them in case it is not */
+            double f = (double)( i_targettime - i_lower_time )
+                     / ( i_upper_time - i_lower_time );
+            i_probe = i_lower + (int64_t)( f * i_span );
+            i_probe = __MAX( i_probe, i_lower + i_span / 16 );
+            i_probe = __MIN( i_probe, i_upper - i_span / 16 );
         }
 
-
         current.i_pos = find_first_page_granule( p_demux,
-                                                 i_start_pos, i_end_pos,
+                                                 i_probe, i_upper,
                                                  p_stream,
                                                  &current.i_granule );
 
@@ -700,33 +878,33 @@ static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stre
                 /* set our lower bound */
                 if ( current.i_timestamp > bestlower.i_timestamp )
                     bestlower = current;
-                i_start_pos = current.i_pos;
+                i_lower = current.i_pos;
+                i_lower_time = current.i_timestamp;
             }
             else
             {
                 if ( lowestupper.i_timestamp == VLC_TICK_INVALID ||
                      current.i_timestamp < lowestupper.i_timestamp )
                     lowestupper = current;
-                /* check lower half of segment */
-                i_start_pos -= i_segsize;
-                i_end_pos -= i_segsize;
+                /* check lower part of segment */
+                i_upper = i_probe;
+                i_upper_time = current.i_timestamp;
             }
         }
         else
         {
-            /* no keyframe found, check lower segment */
-            i_end_pos -= i_segsize;
-            i_start_pos -= i_segsize;
+            /* no keyframe found, check lower part of segment */
+            i_upper = i_probe;
         }
 
-        OggDebug( msg_Dbg(p_demux, "Bisect restart i_segsize=%"PRId64" between %"PRId64
-                                   " and %"PRId64 " bl %"PRId64" lu %"PRId64,
-                i_segsize, i_start_pos, i_end_pos, bestlower.i_granule, lowestupper.i_granule  ) );
-
-        i_segsize = ( i_end_pos - i_start_pos + 1 ) >> 1;
-        i_start_pos += i_segsize;
+        /* Bisect after an interpolation that did not halve the segment, as
+         * the bitrate is obviously not constant there */
+        b_interpolate = !b_interpolate || ( i_upper - i_lower ) * 2 <= i_span;
 
-    } while ( i_segsize > 64 );
+        OggDebug( msg_Dbg(p_demux, "Bisect restart between %"PRId64
+                                   " and %"PRId64 " bl %"PRId64" lu %"PRId64,
+                i_lower, i_upper, bestlower.i_granule, lowestupper.i_granule  ) );
+    }
 
     if ( bestlower.i_granule == -1 )
     {
@@ -907,8 +1085,9 @@ int Oggseek_SeektoAbsolutetime( demux_t *p_demux, logical_stream_t *p_stream,
     }
     /* Insert keyframe position into index */
     OggNoDebug(
-    if ( i_pagepos >= p_stream->i_data_start )
-        OggSeek_IndexAdd( p_stream, i_time, i_pagepos )
+    if ( i_pagepos >= p_stream->i_data_start &&
+         OggSeek_IndexAdd( p_stream, i_time, i_pagepos ) != NULL )
+        p_sys->b_index_changed = true;
     );
 
     OggDebug( msg_Dbg( p_demux, "=================== Seeked To %"PRId64" time %"PRId64, i_pagepos, i_time ) );
@@ -38,6 +38,7 @@
 #define PAGE_HEADER_BYTES 27
 
 #define OGGSEEK_BYTES_TO_READ 8500
+#define OGGSEEK_BISECT_BYTES_TO_READ 65536
 
 /* index entries are structured as follows:
  *   - for theora, highest granulepos -> pagepos (bytes) where keyframe begins
@@ -63,6 +64,8 @@ int     Oggseek_BlindSeektoPosition ( demux_t *, logical_stream_t *, double f, b
 int     Oggseek_SeektoAbsolutetime ( demux_t *, logical_stream_t *, vlc_tick_t );
 const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *, vlc_tick_t, int64_t );
 void    Oggseek_ProbeEnd( demux_t * );
+void    Oggseek_IndexLoad( demux_t * );
+void    Oggseek_IndexSave( demux_t * );
 
 void oggseek_index_entries_free ( demux_index_entry_t * );
 
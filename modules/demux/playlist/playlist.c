@@ -132,6 +132,60 @@ vlc_module_begin ()
         set_callbacks( Import_WPL, Close_WPL )
 vlc_module_end ()
 
+static bool IsURIAlnum(unsigned char c)
+{
+    return ((unsigned char)(c - 'a') < 26) || ((unsigned char)(c - 'A') < 26)
+        || ((unsigned char)(c - '0') < 10);
+}
+
+/* Unreserved and sub-delimiter characters (RFC3986), and the given extras */
+static bool IsURIUnescaped(unsigned char c, const char *extras)
+{
+    return IsURIAlnum(c)
+        || (c != '\0' && strchr("-._~!$&'()*+,;=", c) != NULL)
+        || (c != '\0' && strchr(extras, c) != NULL);
+}
+
+static bool IsURIHex(unsigned char c)
+{
+    return ((unsigned char)(c - '0') < 10) || ((unsigned char)(c - 'A') < 6)
+        || ((unsigned char)(c - 'a') < 6);
+}
+
+/**
+ * Checks if a location is an absolute URL with an authority that
+ * vlc_uri_fixup() would leave as is. Such locations are by far the most
+ * common in large (typically IPTV) playlists, and need no resolution.
+ */
+static bool IsPlainAbsoluteURL(const char *str)
+{
+    const char *p = str;
+
+    if (((unsigned char)(*p - 'a') >= 26) && ((unsigned char)(*p - 'A') >= 26))
+        return false; /* a scheme starts with a letter */
+    while (IsURIAlnum(*p) || (*p != '\0' && strchr("+-.", *p) != NULL))
+        p++;
+    if (p == str || strncmp(p, "://", 3))
+        return false;
+    p += 3;
+
+    const char *extras = ":[]@"; /* authority */
+    for (; *p != '\0'; p++)
+    {
+        if (*p == '/' || *p == '?' || *p == '#')
+            extras = "/?#@"; /* path, query and fragment */
+
+        if (*p == '%')
+        {
+            if (!IsURIHex(p[1]) || !IsURIHex(p[2]))
+                return false;
+        }
+        else if (!IsURIUnescaped(*p, extras))
+            return false;
+    }
+    return true;
+}
+
 /**
  * Resolves a playlist location.
  *
@@ -155,6 +209,9 @@ char *ProcessMRL(const char *str, const char *base)
     /* TODO: drive-relative path: if (str[0] == '\\') */
 #endif
 
+    if (IsPlainAbsoluteURL(str))
+        return strdup(str);
+
     /* The base URL is always an URL: it is the URL of the playlist.
      *
      * However it is not always known if the input string is a valid URL, a
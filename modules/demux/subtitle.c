@@ -105,15 +105,21 @@ enum subtitle_type_e
     SUB_TYPE_SCC,      /* Scenarist Closed Caption */
 };
 
+/* Lines are read from the stream on demand. Only the lines of the entry
+ * being parsed are kept, plus the last line of the previous entry so that
+ * parsers can step back once. */
 typedef struct
 {
+    stream_t *s;
     size_t  i_line_count;
     size_t  i_line;
+    size_t  i_line_max;
     char    **line;
 } text_t;
 
-static int  TextLoad( text_t *, stream_t *s );
+static void TextInit( text_t *, stream_t *s );
 static void TextUnload( text_t * );
+static void TextTrim( text_t * );
 
 typedef struct
 {
@@ -167,14 +173,19 @@ typedef struct
     {
         subtitle_t *p_array;
         size_t      i_count;
+        size_t      i_max;
         size_t      i_current;
+        bool        b_loaded; /* the whole file has been parsed */
+        bool        b_sorted; /* entries are in increasing start order */
     } subtitles;
 
     vlc_tick_t  i_length;
 
     /* */
     subs_properties_t props;
+    text_t            txt;
 
+    int  (*pf_read)( vlc_object_t *, subs_properties_t *, text_t *, subtitle_t*, size_t );
     block_t * (*pf_convert)( const subtitle_t * );
 } demux_sys_t;
 
@@ -234,6 +245,7 @@ static const struct
 static int Demux( demux_t * );
 static int Control( demux_t *, int, va_list );
 
+static int  Load( demux_t *, vlc_tick_t );
 static void Fix( demux_t * );
 static char * get_language_from_filename( const char * );
 
@@ -293,7 +305,6 @@ static int Open ( vlc_object_t *p_this )
     es_format_t    fmt;
     float          f_fps;
     char           *psz_type;
-    int  (*pf_read)( vlc_object_t *, subs_properties_t *, text_t *, subtitle_t*, size_t );
 
     if( !p_demux->obj.force )
     {
@@ -316,7 +327,12 @@ static int Open ( vlc_object_t *p_this )
 
     p_sys->subtitles.i_current= 0;
     p_sys->subtitles.i_count  = 0;
+    p_sys->subtitles.i_max    = 0;
     p_sys->subtitles.p_array  = NULL;
+    p_sys->subtitles.b_loaded = false;
+    p_sys->subtitles.b_sorted = true;
+
+    TextInit( &p_sys->txt, p_demux->s );
 
     p_sys->props.psz_header         = NULL;
     p_sys->props.i_microsecperframe = VLC_TICK_FROM_MS(40);
@@ -620,13 +636,11 @@ static int Open ( vlc_object_t *p_this )
         {
             msg_Dbg( p_demux, "detected %s format",
                      sub_read_subtitle_function[i].psz_name );
-            pf_read = sub_read_subtitle_function[i].pf_read;
+            p_sys->pf_read = sub_read_subtitle_function[i].pf_read;
             break;
         }
     }
 
-    msg_Dbg( p_demux, "loading all subtitles..." );
-
     if( e_bom == UTF8BOM && /* skip BOM */
         vlc_stream_Read( p_demux->s, NULL, 3 ) != 3 )
     {
@@ -634,42 +648,26 @@ static int Open ( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
-    /* Load the whole file */
-    text_t txtlines;
-    TextLoad( &txtlines, p_demux->s );
+    const bool b_ssa = p_sys->props.i_type == SUB_TYPE_SSA1 ||
+                       p_sys->props.i_type == SUB_TYPE_SSA2_4 ||
+                       p_sys->props.i_type == SUB_TYPE_ASS;
 
-    /* Parse it */
-    for( size_t i_max = 0; i_max < SIZE_MAX - 500 * sizeof(subtitle_t); )
+    /* SSA events need not be in order, and are sorted once all loaded.
+     * Other formats are parsed as playback or seeking reaches them; the
+     * first entry is parsed now, as some parsers read headers with it. */
+    if( b_ssa )
+        msg_Dbg( p_demux, "loading all subtitles..." );
+    if( Load( p_demux, b_ssa ? INT64_MAX : INT64_MIN ) )
     {
-        if( p_sys->subtitles.i_count >= i_max )
-        {
-            i_max += 500;
-            subtitle_t *p_realloc = realloc( p_sys->subtitles.p_array, sizeof(subtitle_t) * i_max );
-            if( p_realloc == NULL )
-            {
-                TextUnload( &txtlines );
-                Close( p_this );
-                return VLC_ENOMEM;
-            }
-            p_sys->subtitles.p_array = p_realloc;
-        }
-
-        if( pf_read( VLC_OBJECT(p_demux), &p_sys->props, &txtlines,
-                     &p_sys->subtitles.p_array[p_sys->subtitles.i_count],
-                     p_sys->subtitles.i_count ) )
-            break;
-
-        p_sys->subtitles.i_count++;
+        Close( p_this );
+        return VLC_ENOMEM;
     }
-    /* Unload */
-    TextUnload( &txtlines );
 
-    msg_Dbg(p_demux, "loaded %zu subtitles", p_sys->subtitles.i_count );
+    if( b_ssa )
+        msg_Dbg( p_demux, "loaded %zu subtitles", p_sys->subtitles.i_count );
 
     /* *** add subtitle ES *** */
-    if( p_sys->props.i_type == SUB_TYPE_SSA1 ||
-             p_sys->props.i_type == SUB_TYPE_SSA2_4 ||
-             p_sys->props.i_type == SUB_TYPE_ASS )
+    if( b_ssa )
     {
         Fix( p_demux );
         es_format_Init( &fmt, SPU_ES, VLC_CODEC_SSA );
@@ -683,9 +681,6 @@ static int Open ( vlc_object_t *p_this )
         es_format_Init( &fmt, SPU_ES, VLC_CODEC_SUBT );
 
     p_sys->subtitles.i_current = 0;
-    p_sys->i_length = 0;
-    if( p_sys->subtitles.i_count > 0 )
-        p_sys->i_length = p_sys->subtitles.p_array[p_sys->subtitles.i_count-1].i_stop;
 
     /* Stupid language detection in the filename */
     char * psz_language = get_language_from_filename( p_demux->psz_filepath );
@@ -731,21 +726,111 @@ static void Close( vlc_object_t *p_this )
         free( p_sys->subtitles.p_array[i].psz_text );
     free( p_sys->subtitles.p_array );
     free( p_sys->props.psz_header );
+    TextUnload( &p_sys->txt );
 
     free( p_sys );
 }
 
+/*****************************************************************************
+ * Load: parse entries until one starts after the given (rate scaled) date
+ *****************************************************************************/
+static int Load( demux_t *p_demux, vlc_tick_t i_date )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    while( !p_sys->subtitles.b_loaded )
+    {
+        size_t i_count = p_sys->subtitles.i_count;
+
+        if( i_count > 0 &&
+            p_sys->subtitles.p_array[i_count - 1].i_start * p_sys->f_rate > i_date )
+            break;
+
+        if( i_count >= p_sys->subtitles.i_max )
+        {
+            if( p_sys->subtitles.i_max >= SIZE_MAX / sizeof(subtitle_t) - 500 )
+                return VLC_ENOMEM;
+
+            size_t i_max = p_sys->subtitles.i_max + 500;
+            subtitle_t *p_realloc = realloc( p_sys->subtitles.p_array,
+                                             sizeof(subtitle_t) * i_max );
+            if( p_realloc == NULL )
+                return VLC_ENOMEM;
+            p_sys->subtitles.p_array = p_realloc;
+            p_sys->subtitles.i_max = i_max;
+        }
+
+        subtitle_t *p_subtitle = &p_sys->subtitles.p_array[i_count];
+        if( p_sys->pf_read( VLC_OBJECT(p_demux), &p_sys->props, &p_sys->txt,
+                            p_subtitle, i_count ) )
+        {
+            p_sys->subtitles.b_loaded = true;
+            TextUnload( &p_sys->txt );
+            msg_Dbg( p_demux, "parsed %zu subtitles", i_count );
+            break;
+        }
+        TextTrim( &p_sys->txt );
+
+        if( i_count > 0 &&
+            p_subtitle->i_start < p_sys->subtitles.p_array[i_count - 1].i_start )
+            p_sys->subtitles.b_sorted = false;
+        p_sys->subtitles.i_count++;
+    }
+
+    /* Until the end of the file is reached, extrapolate the length from the
+     * byte position of the last parsed entry. */
+    size_t i_count = p_sys->subtitles.i_count;
+    p_sys->i_length = 0;
+    if( i_count > 0 )
+    {
+        const subtitle_t *p_last = &p_sys->subtitles.p_array[i_count - 1];
+        p_sys->i_length = p_last->i_stop;
+
+        uint64_t i_size;
+        uint64_t i_pos = vlc_stream_Tell( p_demux->s );
+        if( !p_sys->subtitles.b_loaded && i_pos > 0 &&
+            vlc_stream_GetSize( p_demux->s, &i_size ) == VLC_SUCCESS &&
+            i_size > i_pos )
+        {
+            vlc_tick_t i_end = __MAX( p_last->i_start, p_last->i_stop );
+            p_sys->i_length = i_end * ( (double)i_size / i_pos );
+        }
+    }
+    return VLC_SUCCESS;
+}
+
 static void
 ResetCurrentIndex( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    for( size_t i = 0; i < p_sys->subtitles.i_count; i++ )
+
+    if( Load( p_demux, p_sys->i_next_demux_date ) )
+        msg_Err( p_demux, "cannot load subtitles" );
+
+    if( !p_sys->subtitles.b_sorted )
     {
-        if( p_sys->subtitles.p_array[i].i_start * p_sys->f_rate >
-            p_sys->i_next_demux_date && i > 0 )
-            break;
-        p_sys->subtitles.i_current = i;
+        for( size_t i = 0; i < p_sys->subtitles.i_count; i++ )
+        {
+            if( p_sys->subtitles.p_array[i].i_start * p_sys->f_rate >
+                p_sys->i_next_demux_date && i > 0 )
+                break;
+            p_sys->subtitles.i_current = i;
+        }
+        return;
     }
+
+    /* Find the last entry starting at or before the date, if any */
+    size_t i_low = 0, i_high = p_sys->subtitles.i_count;
+    while( i_low < i_high )
+    {
+        size_t i_mid = i_low + ( i_high - i_low ) / 2;
+        if( p_sys->subtitles.p_array[i_mid].i_start * p_sys->f_rate >
+            p_sys->i_next_demux_date )
+            i_high = i_mid;
+        else
+            i_low = i_mid + 1;
+    }
+    p_sys->subtitles.i_current = i_low > 0 ? i_low - 1 : 0;
 }
 
 /*****************************************************************************
@@ -844,6 +929,9 @@ static int Demux( demux_t *p_demux )
 
     vlc_tick_t i_barrier = p_sys->i_next_demux_date;
 
+    if( Load( p_demux, i_barrier ) )
+        return VLC_DEMUXER_EGENERIC;
+
     while( p_sys->subtitles.i_current < p_sys->subtitles.i_count &&
            ( p_sys->subtitles.p_array[p_sys->subtitles.i_current].i_start *
              p_sys->f_rate ) <= i_barrier )
@@ -879,7 +967,8 @@ static int Demux( demux_t *p_demux )
         p_sys->i_next_demux_date += VLC_TICK_FROM_MS(125);
     }
 
-    if( p_sys->subtitles.i_current >= p_sys->subtitles.i_count )
+    if( p_sys->subtitles.b_loaded &&
+        p_sys->subtitles.i_current >= p_sys->subtitles.i_count )
         return VLC_DEMUXER_EOF;
 
     return VLC_DEMUXER_SUCCESS;
@@ -904,61 +993,72 @@ static void Fix( demux_t *p_demux )
     qsort( p_sys->subtitles.p_array, p_sys->subtitles.i_count, sizeof( p_sys->subtitles.p_array[0] ), subtitle_cmp);
 }
 
-static int TextLoad( text_t *txt, stream_t *s )
+static void TextInit( text_t *txt, stream_t *s )
 {
-    size_t i_line_max;
-
-    /* init txt */
-    i_line_max          = 500;
-    txt->i_line_count   = 0;
-    txt->i_line         = 0;
-    txt->line           = calloc( i_line_max, sizeof( char * ) );
-    if( !txt->line )
-        return VLC_ENOMEM;
-
-    /* load the complete file */
-    for( ;; )
-    {
-        char *psz = vlc_stream_ReadLine( s );
+    txt->s            = s;
+    txt->i_line_count = 0;
+    txt->i_line       = 0;
+    txt->i_line_max   = 0;
+    txt->line         = NULL;
+}
+static void TextUnload( text_t *txt )
+{
+    for( size_t i = 0; i < txt->i_line_count; i++ )
+        free( txt->line[i] );
+    free( txt->line );
+    txt->line         = NULL;
+    txt->i_line       = 0;
+    txt->i_line_count = 0;
+    txt->i_line_max   = 0;
+}
 
-        if( psz == NULL )
-            break;
+/* Releases the lines consumed by the previous entries but the last one */
+static void TextTrim( text_t *txt )
+{
+    if( txt->i_line < 2 )
+        return;
+
+    size_t i_drop = txt->i_line - 1;
+    for( size_t i = 0; i < i_drop; i++ )
+        free( txt->line[i] );
+    memmove( txt->line, &txt->line[i_drop],
+             ( txt->i_line_count - i_drop ) * sizeof( char * ) );
+    txt->i_line_count -= i_drop;
+    txt->i_line       -= i_drop;
+}
 
-        txt->line[txt->i_line_count] = psz;
-        if( txt->i_line_count + 1 >= i_line_max )
-        {
-            i_line_max += 100;
-            char **p_realloc = realloc( txt->line, i_line_max * sizeof( char * ) );
-            if( p_realloc == NULL )
-                return VLC_ENOMEM;
-            txt->line = p_realloc;
-        }
-        txt->i_line_count++;
-    }
+/* Makes the next line available, returns false at the end of the stream */
+static bool TextFill( text_t *txt )
+{
+    if( txt->i_line < txt->i_line_count )
+        return true;
 
-    if( txt->i_line_count == 0 )
+    if( txt->i_line_count >= txt->i_line_max )
     {
-        free( txt->line );
-        return VLC_EGENERIC;
+        size_t i_max = txt->i_line_max + 16;
+        char **p_realloc = realloc( txt->line, i_max * sizeof( char * ) );
+        if( p_realloc == NULL )
+            return false;
+        txt->line = p_realloc;
+        txt->i_line_max = i_max;
     }
 
-    return VLC_SUCCESS;
+    char *psz = vlc_stream_ReadLine( txt->s );
+    if( psz == NULL )
+        return false;
+
+    txt->line[txt->i_line_count++] = psz;
+    return true;
 }
-static void TextUnload( text_t *txt )
+
+static bool TextIsEOF( text_t *txt )
 {
-    if( txt->i_line_count )
-    {
-        for( size_t i = 0; i < txt->i_line_count; i++ )
-            free( txt->line[i] );
-        free( txt->line );
-    }
-    txt->i_line       = 0;
-    txt->i_line_count = 0;
+    return !TextFill( txt );
 }
 
 static char *TextGetLine( text_t *txt )
 {
-    if( txt->i_line >= txt->i_line_count )
+    if( !TextFill( txt ) )
         return( NULL );
 
     return txt->line[txt->i_line++];
@@ -1623,7 +1723,7 @@ static int ParseAQT(vlc_object_t *p_obj, subs_properties_t *p_props, text_t *txt
                  return VLC_ENOMEM;
             strcat( psz_text, s );
             strcat( psz_text, "\n" );
-            if( txt->i_line == txt->i_line_count )
+            if( TextIsEOF( txt ) )
                 break;
         }
     }
@@ -0,0 +1,178 @@
+/*****************************************************************************
+ * json.c: JSON tracer plugin
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_fs.h>
+#include <vlc_tracer.h>
+
+/*
+ * Events are written in the Trace Event format of the Chromium project, as
+ * instant events, so that they can be loaded as is in chrome://tracing or
+ * other timeline viewers. The "name" entry, if any, is the event name; the
+ * other entries are the event arguments.
+ */
+
+typedef struct
+{
+    FILE *stream;
+    bool first;
+    int pid;
+} vlc_tracer_sys_t;
+
+#define JSON_FILENAME "vlc-trace.json"
+
+static void JsonString(FILE *stream, const char *str)
+{
+    putc_unlocked('"', stream);
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++)
+    {
+        switch (*p)
+        {
+            case '"':
+            case '\\':
+                putc_unlocked('\\', stream);
+                putc_unlocked(*p, stream);
+                break;
+            case '\n':
+                fputs("\\n", stream);
+                break;
+            default:
+                if (*p < 0x20)
+                    fprintf(stream, "\\u%04x", *p);
+                else
+                    putc_unlocked(*p, stream);
+        }
+    }
+    putc_unlocked('"', stream);
+}
+
+static void Trace(void *opaque, vlc_tick_t ts,
+                  const struct vlc_tracer_entry *entries)
+{
+    vlc_tracer_sys_t *sys = opaque;
+    FILE *stream = sys->stream;
+    const char *name = "event";
+    unsigned long tid = vlc_thread_id();
+
+    for (const struct vlc_tracer_entry *e = entries; e->key != NULL; e++)
+        if (e->type == VLC_TRACER_STRING && !strcmp(e->key, "name"))
+            name = e->value.string;
+
+    flockfile(stream);
+    fputs(sys->first ? "\n" : ",\n", stream);
+    sys->first = false;
+    fputs("{\"name\":", stream);
+    JsonString(stream, name);
+    fprintf(stream, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%"PRId64
+            ",\"pid\":%d,\"tid\":%lu,\"args\":{", US_FROM_VLC_TICK(ts),
+            sys->pid, tid);
+
+    bool sep = false;
+    for (const struct vlc_tracer_entry *e = entries; e->key != NULL; e++)
+    {
+        if (e->type == VLC_TRACER_STRING && !strcmp(e->key, "name"))
+            continue;
+        if (sep)
+            putc_unlocked(',', stream);
+        sep = true;
+        JsonString(stream, e->key);
+        putc_unlocked(':', stream);
+        switch (e->type)
+        {
+            case VLC_TRACER_INT:
+                fprintf(stream, "%"PRId64, e->value.integer);
+                break;
+            case VLC_TRACER_STRING:
+                JsonString(stream, e->value.string);
+                break;
+        }
+    }
+    fputs("}}", stream);
+    funlockfile(stream);
+}
+
+static void Close(void *opaque)
+{
+    vlc_tracer_sys_t *sys = opaque;
+
+    fputs("\n]\n", sys->stream);
+    fclose(sys->stream);
+    free(sys);
+}
+
+static const struct vlc_tracer_operations json_ops =
+{
+    Trace,
+    Close
+};
+
+static const struct vlc_tracer_operations *Open(vlc_object_t *obj,
+                                                void **restrict sysp)
+{
+    vlc_tracer_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return NULL;
+
+    char *path = var_InheritString(obj, "json-tracer-file");
+    const char *filename = (path != NULL) ? path : JSON_FILENAME;
+
+    msg_Dbg(obj, "opening trace file `%s'", filename);
+    sys->stream = vlc_fopen(filename, "wt");
+    if (sys->stream == NULL)
+    {
+        msg_Err(obj, "error opening trace file `%s': %s", filename,
+                vlc_strerror_c(errno));
+        free(path);
+        free(sys);
+        return NULL;
+    }
+    free(path);
+
+    sys->first = true;
+    sys->pid = getpid();
+    fputc('[', sys->stream);
+
+    *sysp = sys;
+    return &json_ops;
+}
+
+#define FILE_TEXT N_("Trace filename")
+#define FILE_LONGTEXT N_("Specify the trace events output filename.")
+
+vlc_module_begin()
+    set_shortname(N_("JSON"))
+    set_description(N_("JSON tracer"))
+    set_category(CAT_ADVANCED)
+    set_subcategory(SUBCAT_ADVANCED_MISC)
+    set_capability("tracer", 0)
+    set_callbacks(Open, NULL)
+
+    add_savefile("json-tracer-file", NULL, FILE_TEXT, FILE_LONGTEXT)
+vlc_module_end ()
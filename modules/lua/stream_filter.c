@@ -33,6 +33,7 @@
 
 #include <vlc_common.h>
 #include <vlc_access.h>
+#include <vlc_fs.h>
 
 #include "vlc.h"
 #include "libs.h"
@@ -43,7 +44,12 @@
 struct vlclua_playlist
 {
     lua_State *L;
+    int env_ref; /**< environment table of the selected script */
     char *filename;
+    char *package_path;
+    char *catalogue_dir;
+    char **catalogue;
+    size_t catalogue_count;
     char *access;
     const char *path;
 };
@@ -117,6 +123,128 @@ static const luaL_Reg p_reg_parse[] =
     { NULL, NULL }
 };
 
+/*****************************************************************************
+ * Host name hints of the scripts, see share/lua/playlist/README.txt
+ *****************************************************************************/
+static void catalogue_Clean( struct vlclua_playlist *sys )
+{
+    for( size_t i = 0; i < sys->catalogue_count; i++ )
+        free( sys->catalogue[i] );
+    free( sys->catalogue );
+    sys->catalogue = NULL;
+    sys->catalogue_count = 0;
+    free( sys->catalogue_dir );
+    sys->catalogue_dir = NULL;
+}
+
+static void catalogue_Load( struct vlclua_playlist *sys, const char *dir,
+                            size_t dirlen )
+{
+    catalogue_Clean( sys );
+
+    sys->catalogue_dir = strndup( dir, dirlen );
+    if( unlikely(sys->catalogue_dir == NULL) )
+        return;
+
+    char *path;
+    if( asprintf( &path, "%s" DIR_SEP "catalogue", sys->catalogue_dir ) == -1 )
+        return;
+
+    FILE *stream = vlc_fopen( path, "rt" );
+    free( path );
+    if( stream == NULL )
+        return; /* no hints, every script will be probed */
+
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+
+    while( (len = getline( &line, &size, stream )) != -1 )
+    {
+        if( len > 0 && line[len - 1] == '\n' )
+            line[len - 1] = '\0';
+
+        char **tab = realloc( sys->catalogue,
+                              (sys->catalogue_count + 1) * sizeof (*tab) );
+        if( unlikely(tab == NULL) )
+            break;
+        sys->catalogue = tab;
+
+        tab[sys->catalogue_count] = strdup( line );
+        if( unlikely(tab[sys->catalogue_count] == NULL) )
+            break;
+        sys->catalogue_count++;
+    }
+    free( line );
+    fclose( stream );
+}
+
+/**
+ * Checks whether a script declared host name hints, none of which match
+ * the host name of the URL, so that it is not worth probing.
+ */
+static bool catalogue_Skip( struct vlclua_playlist *sys, const char *filename )
+{
+    const char *base = strrchr( filename, DIR_SEP_CHAR );
+    if( base == NULL )
+        return false;
+
+    size_t dirlen = base - filename;
+    if( sys->catalogue_dir == NULL
+     || strncmp( sys->catalogue_dir, filename, dirlen )
+     || sys->catalogue_dir[dirlen] != '\0' )
+        catalogue_Load( sys, filename, dirlen );
+
+    base++;
+    size_t baselen = strcspn( base, "." );
+    const char *host = (sys->path != NULL) ? sys->path : "";
+    size_t hostlen = strcspn( host, "/:?#" );
+
+    for( size_t i = 0; i < sys->catalogue_count; i++ )
+    {
+        const char *hint = sys->catalogue[i];
+
+        if( strncmp( hint, base, baselen ) || hint[baselen] != ' ' )
+            continue;
+
+        hint += baselen;
+        for( ;; )
+        {
+            hint += strspn( hint, " " );
+            size_t len = strcspn( hint, " " );
+            if( len == 0 )
+                break;
+
+            /* A host name matches itself and its subdomains */
+            if( len <= hostlen
+             && !strncasecmp( host + hostlen - len, hint, len )
+             && (len == hostlen || host[hostlen - len - 1] == '.') )
+                return false;
+            hint += len;
+        }
+        return true;
+    }
+    return false;
+}
+
+/*****************************************************************************
+ * Pushes a fresh environment table for a script onto the stack. Globals the
+ * script defines end up in this table, while lookups of anything else fall
+ * through to the shared globals (Lua libraries and the vlc namespace).
+ *****************************************************************************/
+static void vlclua_push_env( lua_State *L )
+{
+    lua_newtable( L );
+    lua_newtable( L );
+#if LUA_VERSION_NUM >= 502
+    lua_pushglobaltable( L );
+#else
+    lua_pushvalue( L, LUA_GLOBALSINDEX );
+#endif
+    lua_setfield( L, -2, "__index" );
+    lua_setmetatable( L, -2 );
+}
+
 /*****************************************************************************
  * Called through lua_scripts_batch_execute to call 'probe' on
  * the script pointed by psz_filename.
@@ -126,37 +254,16 @@ static int probe_luascript(vlc_object_t *obj, const char *filename,
 {
     stream_t *s = (stream_t *)obj;
     struct vlclua_playlist *sys = s->p_sys;
+    lua_State *L = sys->L;
+    int top = lua_gettop( L );
 
-    /* Initialise Lua state structure */
-    lua_State *L = luaL_newstate();
-    if( !L )
-        return VLC_ENOMEM;
-
-    sys->L = L;
-
-    /* Load Lua libraries */
-    luaL_openlibs( L ); /* FIXME: Don't open all the libs? */
-
-    vlclua_set_this(L, s);
-    luaL_register_namespace( L, "vlc", p_reg );
-    luaopen_msg( L );
-    luaopen_strings( L );
-    luaopen_stream( L );
-    luaopen_variables( L );
-    luaopen_xml( L );
+    if( catalogue_Skip( sys, filename ) )
+        return VLC_EGENERIC;
 
-    if (sys->path != NULL)
-        lua_pushstring(L, sys->path);
-    else
-        lua_pushnil(L);
+    /* Reset the module search path left by the previous script */
+    lua_getglobal( L, "package" );
+    lua_pushstring( L, sys->package_path );
     lua_setfield( L, -2, "path" );
-
-    if (sys->access != NULL)
-        lua_pushstring(L, sys->access);
-    else
-        lua_pushnil(L);
-    lua_setfield( L, -2, "access" );
-
     lua_pop( L, 1 );
 
     /* Setup the module search path */
@@ -166,15 +273,29 @@ static int probe_luascript(vlc_object_t *obj, const char *filename,
         goto error;
     }
 
-    /* Load and run the script(s) */
-    if (vlclua_dofile(VLC_OBJECT(s), L, filename))
+    /* Load the script and run it in its own environment */
+    vlclua_push_env( L );
+    if (vlclua_loadfile(VLC_OBJECT(s), L, filename))
+    {
+        msg_Warn(s, "error loading script %s: %s", filename,
+                 lua_tostring(L, lua_gettop(L)));
+        goto error;
+    }
+
+    lua_pushvalue( L, -2 );
+#if LUA_VERSION_NUM >= 502
+    lua_setupvalue( L, -2, 1 ); /* _ENV */
+#else
+    lua_setfenv( L, -2 );
+#endif
+    if (lua_pcall( L, 0, 0, 0 ))
     {
         msg_Warn(s, "error loading script %s: %s", filename,
                  lua_tostring(L, lua_gettop(L)));
         goto error;
     }
 
-    lua_getglobal( L, "probe" );
+    lua_getfield( L, -1, "probe" );
     if( !lua_isfunction( L, -1 ) )
     {
         msg_Warn(s, "error running script %s: function %s(): %s",
@@ -189,22 +310,21 @@ static int probe_luascript(vlc_object_t *obj, const char *filename,
         goto error;
     }
 
-    if( lua_gettop( L ) )
+    if( lua_toboolean( L, -1 ) )
     {
-        if( lua_toboolean( L, 1 ) )
-        {
-            msg_Dbg(s, "Lua playlist script %s's "
-                    "probe() function was successful", filename );
-            lua_pop( L, 1 );
-            sys->filename = strdup(filename);
-            return VLC_SUCCESS;
-        }
+        msg_Dbg(s, "Lua playlist script %s's "
+                "probe() function was successful", filename );
+        lua_pop( L, 1 );
+        sys->env_ref = luaL_ref( L, LUA_REGISTRYINDEX );
+        lua_settop( L, top );
+        sys->filename = strdup(filename);
+        return VLC_SUCCESS;
     }
 
     (void) ctx;
 error:
-    lua_pop( L, 1 );
-    lua_close(sys->L);
+    /* Drop the environment, and with it whatever the script defined */
+    lua_settop( L, top );
     return VLC_EGENERIC;
 }
 
@@ -215,7 +335,9 @@ static int ReadDir(stream_t *s, input_item_node_t *node)
 
     luaL_register_namespace( L, "vlc", p_reg_parse );
 
-    lua_getglobal( L, "parse" );
+    lua_rawgeti( L, LUA_REGISTRYINDEX, sys->env_ref );
+    lua_getfield( L, -1, "parse" );
+    lua_remove( L, -2 );
 
     if( !lua_isfunction( L, -1 ) )
     {
@@ -288,6 +410,9 @@ int Import_LuaPlaylist(vlc_object_t *obj)
     s->p_sys = sys;
     sys->access = NULL;
     sys->path = NULL;
+    sys->catalogue_dir = NULL;
+    sys->catalogue = NULL;
+    sys->catalogue_count = 0;
 
     if (s->psz_url != NULL)
     {   /* Backward compatibility hack: Lua scripts expect the URI scheme and
@@ -300,10 +425,56 @@ int Import_LuaPlaylist(vlc_object_t *obj)
         }
     }
 
-    int ret = vlclua_scripts_batch_execute(VLC_OBJECT(s), "playlist",
+    /* All scripts are probed in a single Lua state, so that the libraries
+     * are only opened once. Each script gets its own global environment. */
+    lua_State *L = luaL_newstate();
+    if (L == NULL)
+    {
+        free(sys->access);
+        free(sys);
+        return VLC_ENOMEM;
+    }
+    sys->L = L;
+
+    /* Load Lua libraries */
+    luaL_openlibs( L ); /* FIXME: Don't open all the libs? */
+
+    vlclua_set_this(L, s);
+    luaL_register_namespace( L, "vlc", p_reg );
+    luaopen_msg( L );
+    luaopen_strings( L );
+    luaopen_stream( L );
+    luaopen_variables( L );
+    luaopen_xml( L );
+
+    if (sys->path != NULL)
+        lua_pushstring(L, sys->path);
+    else
+        lua_pushnil(L);
+    lua_setfield( L, -2, "path" );
+
+    if (sys->access != NULL)
+        lua_pushstring(L, sys->access);
+    else
+        lua_pushnil(L);
+    lua_setfield( L, -2, "access" );
+
+    lua_pop( L, 1 );
+
+    lua_getglobal( L, "package" );
+    lua_getfield( L, -1, "path" );
+    sys->package_path = strdup(lua_tostring( L, -1 ));
+    lua_pop( L, 2 );
+
+    int ret = VLC_ENOMEM;
+    if (likely(sys->package_path != NULL))
+        ret = vlclua_scripts_batch_execute(VLC_OBJECT(s), "playlist",
                                            probe_luascript, NULL);
+    catalogue_Clean(sys);
     if (ret != VLC_SUCCESS)
     {
+        lua_close(L);
+        free(sys->package_path);
         free(sys->access);
         free(sys);
         return ret;
@@ -322,6 +493,7 @@ void Close_LuaPlaylist(vlc_object_t *obj)
     free(sys->filename);
     assert(sys->L != NULL);
     lua_close(sys->L);
+    free(sys->package_path);
     free(sys->access);
     free(sys);
 }
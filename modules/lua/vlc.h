@@ -174,6 +174,8 @@ char *vlclua_find_file( const char *psz_luadirname, const char *psz_name );
  * Replace Lua file reader by VLC input. Allows loadings scripts in Zip pkg.
  *****************************************************************************/
 int vlclua_dofile( vlc_object_t *p_this, lua_State *L, const char *url );
+/* Same as vlclua_dofile(), but only pushes the compiled chunk */
+int vlclua_loadfile( vlc_object_t *p_this, lua_State *L, const char *url );
 
 /*****************************************************************************
  * Playlist and meta data internal utilities.
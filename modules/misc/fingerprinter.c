@@ -39,23 +39,42 @@
  * Local prototypes
  *****************************************************************************/
 
+/* The AcoustID web service accepts 3 requests per second */
+#define LOOKUP_INTERVAL VLC_TICK_FROM_MS(334)
+#define MAX_WORKERS 16
+
 struct fingerprinter_sys_t
 {
-    vlc_thread_t thread;
-
     struct
     {
         vlc_array_t         queue;
         vlc_mutex_t         lock;
-    } incoming, results;
+    } results;
 
     struct
     {
         vlc_array_t         queue;
         vlc_mutex_t         lock;
         vlc_cond_t          cond;
-        bool                b_working;
+        bool                b_exit;
     } processing;
+
+    struct
+    {
+        vlc_mutex_t         lock;
+        vlc_tick_t          i_last;
+    } lookup;
+
+    unsigned int i_length;
+    unsigned int i_workers;
+    vlc_thread_t workers[MAX_WORKERS];
+};
+
+/* A fingerprint being computed by a worker */
+struct fingerprint_job
+{
+    fingerprinter_sys_t *p_sys;
+    bool                 b_working;
 };
 
 static int  Open            (vlc_object_t *);
@@ -66,6 +85,14 @@ static void *Run(void *);
 /*****************************************************************************
  * Module descriptor
  ****************************************************************************/
+#define THREADS_TEXT N_("Fingerprinting threads")
+#define THREADS_LONGTEXT N_( \
+    "Number of tracks fingerprinted at the same time " \
+    "(0 for the number of CPUs)." )
+#define LENGTH_TEXT N_("Fingerprinted length")
+#define LENGTH_LONGTEXT N_( \
+    "Seconds of audio decoded from the start of each track." )
+
 vlc_module_begin ()
     set_category(CAT_ADVANCED)
     set_subcategory(SUBCAT_ADVANCED_MISC)
@@ -73,6 +100,12 @@ vlc_module_begin ()
     set_description(N_("Track fingerprinter (based on Acoustid)"))
     set_capability("fingerprinter", 10)
     set_callbacks(Open, Close)
+    add_integer("fingerprinter-threads", 0, THREADS_TEXT,
+                THREADS_LONGTEXT, true)
+        change_integer_range(0, MAX_WORKERS)
+    add_integer("fingerprinter-length", 90, LENGTH_TEXT,
+                LENGTH_LONGTEXT, true)
+        change_integer_range(10, 600)
 vlc_module_end ()
 
 /*****************************************************************************
@@ -82,26 +115,14 @@ vlc_module_end ()
 static int EnqueueRequest( fingerprinter_thread_t *f, fingerprint_request_t *r )
 {
     fingerprinter_sys_t *p_sys = f->p_sys;
-    vlc_mutex_lock( &p_sys->incoming.lock );
-    int i_ret = vlc_array_append( &p_sys->incoming.queue, r );
-    vlc_mutex_unlock( &p_sys->incoming.lock );
+    vlc_mutex_lock( &p_sys->processing.lock );
+    int i_ret = vlc_array_append( &p_sys->processing.queue, r );
+    if( i_ret == 0 )
+        vlc_cond_broadcast( &p_sys->processing.cond );
+    vlc_mutex_unlock( &p_sys->processing.lock );
     return i_ret;
 }
 
-static void QueueIncomingRequests( fingerprinter_sys_t *p_sys )
-{
-    vlc_mutex_lock( &p_sys->incoming.lock );
-
-    for( size_t i = vlc_array_count( &p_sys->incoming.queue ); i > 0 ; i-- )
-    {
-        fingerprint_request_t *r = vlc_array_item_at_index( &p_sys->incoming.queue, i - 1 );
-        if( vlc_array_append( &p_sys->processing.queue, r ) )
-            fingerprint_request_Delete( r );
-    }
-    vlc_array_clear( &p_sys->incoming.queue );
-    vlc_mutex_unlock(&p_sys->incoming.lock);
-}
-
 static fingerprint_request_t * GetResult( fingerprinter_thread_t *f )
 {
     fingerprint_request_t *r = NULL;
@@ -132,88 +153,121 @@ static void InputEvent( input_thread_t *p_input,
                         const struct vlc_input_event *p_event, void *p_user_data )
 {
     VLC_UNUSED( p_input );
-    fingerprinter_sys_t *p_sys = p_user_data;
+    struct fingerprint_job *p_job = p_user_data;
+    fingerprinter_sys_t *p_sys = p_job->p_sys;
     if( p_event->type == INPUT_EVENT_STATE )
     {
         if( p_event->state >= PAUSE_S )
         {
             vlc_mutex_lock( &p_sys->processing.lock );
-            p_sys->processing.b_working = false;
-            vlc_cond_signal( &p_sys->processing.cond );
+            p_job->b_working = false;
+            vlc_cond_broadcast( &p_sys->processing.cond );
             vlc_mutex_unlock( &p_sys->processing.lock );
         }
     }
 }
 
+static int AddOption( input_item_t *p_item, const char *psz_fmt, ... )
+{
+    char *psz_option;
+    va_list ap;
+
+    va_start( ap, psz_fmt );
+    int i_ret = vasprintf( &psz_option, psz_fmt, ap );
+    va_end( ap );
+    if( i_ret == -1 )
+        return VLC_ENOMEM;
+
+    i_ret = input_item_AddOption( p_item, psz_option, VLC_INPUT_OPTION_TRUSTED );
+    free( psz_option );
+    return i_ret;
+}
+
+/* Decodes the start of a track as fast as possible. Called with the
+ * processing lock held. */
 static void DoFingerprint( fingerprinter_thread_t *p_fingerprinter,
                            acoustid_fingerprint_t *fp,
                            const char *psz_uri )
 {
+    fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
     input_item_t *p_item = input_item_New( NULL, NULL );
     if ( unlikely(p_item == NULL) )
          return;
 
-    char *psz_sout_option;
-    /* Note: need at -max- 2 channels, but we can't guess it before playing */
-    /* the stereo upmix could make the mono tracks fingerprint to differ :/ */
-    if ( asprintf( &psz_sout_option,
-                   "sout=#transcode{acodec=%s,channels=2}:chromaprint",
+    /* Chromaprint mixes down to mono and resamples to 11025 Hz anyway:
+     * have the transcoder convert once, and feed it 8 times less data than
+     * stereo at 44.1 kHz. Video and subtitles are not even decoded, and the
+     * input runs free, without waiting for the clock. The input stops after
+     * the fingerprinted length, the track length comes from the demuxer. */
+    if( AddOption( p_item, "sout=#transcode{acodec=%s,channels=1,"
+                           "samplerate=11025}:chromaprint",
                    ( VLC_CODEC_S16L == VLC_CODEC_S16N ) ? "s16l" : "s16b" )
-         == -1 )
+     || AddOption( p_item, "duration=%u", p_sys->i_length )
+     || AddOption( p_item, "stop-time=%u", p_sys->i_length + 1 )
+     || AddOption( p_item, "sout-offline" )
+     || AddOption( p_item, "no-sout-video" )
+     || AddOption( p_item, "no-sout-spu" )
+     || AddOption( p_item, "vout=dummy" )
+     || AddOption( p_item, "aout=dummy" ) )
     {
         input_item_Release( p_item );
         return;
     }
-
-    input_item_AddOption( p_item, psz_sout_option, VLC_INPUT_OPTION_TRUSTED );
-    free( psz_sout_option );
-    input_item_AddOption( p_item, "vout=dummy", VLC_INPUT_OPTION_TRUSTED );
-    input_item_AddOption( p_item, "aout=dummy", VLC_INPUT_OPTION_TRUSTED );
-    if ( fp->i_duration )
-    {
-        if ( asprintf( &psz_sout_option, "stop-time=%u", fp->i_duration ) == -1 )
-        {
-            input_item_Release( p_item );
-            return;
-        }
-        input_item_AddOption( p_item, psz_sout_option, VLC_INPUT_OPTION_TRUSTED );
-        free( psz_sout_option );
-    }
     input_item_SetURI( p_item, psz_uri ) ;
 
+    struct fingerprint_job job = { .p_sys = p_sys, .b_working = false };
     input_thread_t *p_input = input_Create( p_fingerprinter, InputEvent,
-                                            p_fingerprinter->p_sys,
-                                            p_item, NULL, NULL );
-    input_item_Release( p_item );
-
+                                            &job, p_item, NULL, NULL );
     if( p_input == NULL )
+    {
+        input_item_Release( p_item );
         return;
+    }
 
     chromaprint_fingerprint_t chroma_fingerprint;
 
     chroma_fingerprint.psz_fingerprint = NULL;
-    chroma_fingerprint.i_duration = fp->i_duration;
+    chroma_fingerprint.i_duration = 0;
 
     var_Create( p_input, "fingerprint-data", VLC_VAR_ADDRESS );
     var_SetAddress( p_input, "fingerprint-data", &chroma_fingerprint );
 
+    job.b_working = true;
     if( input_Start( p_input ) != VLC_SUCCESS )
         input_Close( p_input );
     else
     {
-        p_fingerprinter->p_sys->processing.b_working = true;
-        while( p_fingerprinter->p_sys->processing.b_working )
-        {
-            vlc_cond_wait( &p_fingerprinter->p_sys->processing.cond,
-                           &p_fingerprinter->p_sys->processing.lock );
-        }
+        while( job.b_working && !p_sys->processing.b_exit )
+            vlc_cond_wait( &p_sys->processing.cond, &p_sys->processing.lock );
+
+        vlc_mutex_unlock( &p_sys->processing.lock );
         input_Stop( p_input );
         input_Close( p_input );
+        vlc_mutex_lock( &p_sys->processing.lock );
 
         fp->psz_fingerprint = chroma_fingerprint.psz_fingerprint;
         if( !fp->i_duration ) /* had not given hint */
-            fp->i_duration = chroma_fingerprint.i_duration;
+        {
+            vlc_tick_t i_length = input_item_GetDuration( p_item );
+            fp->i_duration = i_length > 0 ? SEC_FROM_VLC_TICK( i_length )
+                                          : chroma_fingerprint.i_duration;
+        }
     }
+    input_item_Release( p_item );
+}
+
+static void DoLookup( fingerprinter_thread_t *p_fingerprinter,
+                      acoustid_fingerprint_t *fp )
+{
+    fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
+
+    /* Workers take turns, and keep to the rate limit of the service */
+    vlc_mutex_lock( &p_sys->lookup.lock );
+    if( p_sys->lookup.i_last != VLC_TICK_INVALID )
+        vlc_tick_wait( p_sys->lookup.i_last + LOOKUP_INTERVAL );
+    DoAcoustIdWebRequest( VLC_OBJECT(p_fingerprinter), fp );
+    p_sys->lookup.i_last = vlc_tick_now();
+    vlc_mutex_unlock( &p_sys->lookup.lock );
 }
 
 /*****************************************************************************
@@ -229,27 +283,42 @@ static int Open(vlc_object_t *p_this)
 
     p_fingerprinter->p_sys = p_sys;
 
-    vlc_array_init( &p_sys->incoming.queue );
-    vlc_mutex_init( &p_sys->incoming.lock );
-
     vlc_array_init( &p_sys->processing.queue );
     vlc_mutex_init( &p_sys->processing.lock );
     vlc_cond_init( &p_sys->processing.cond );
+    p_sys->processing.b_exit = false;
 
     vlc_array_init( &p_sys->results.queue );
     vlc_mutex_init( &p_sys->results.lock );
 
+    vlc_mutex_init( &p_sys->lookup.lock );
+    p_sys->lookup.i_last = VLC_TICK_INVALID;
+
+    p_sys->i_length = var_InheritInteger( p_fingerprinter,
+                                          "fingerprinter-length" );
+    unsigned i_workers = var_InheritInteger( p_fingerprinter,
+                                             "fingerprinter-threads" );
+    if( i_workers == 0 )
+        i_workers = vlc_GetCPUCount();
+    i_workers = VLC_CLIP( i_workers, 1, MAX_WORKERS );
+
     p_fingerprinter->pf_enqueue = EnqueueRequest;
     p_fingerprinter->pf_getresults = GetResult;
     p_fingerprinter->pf_apply = ApplyResult;
 
     var_Create( p_fingerprinter, "results-available", VLC_VAR_BOOL );
-    if( vlc_clone( &p_sys->thread, Run, p_fingerprinter,
-                   VLC_THREAD_PRIORITY_LOW ) )
+    for( p_sys->i_workers = 0; p_sys->i_workers < i_workers; p_sys->i_workers++ )
+        if( vlc_clone( &p_sys->workers[p_sys->i_workers], Run, p_fingerprinter,
+                       VLC_THREAD_PRIORITY_LOW ) )
+            break;
+
+    if( p_sys->i_workers == 0 )
     {
         msg_Err( p_fingerprinter, "cannot spawn fingerprinter thread" );
         goto error;
     }
+    msg_Dbg( p_fingerprinter, "fingerprinting %u tracks at a time",
+             p_sys->i_workers );
 
     return VLC_SUCCESS;
 
@@ -267,8 +336,14 @@ static void Close(vlc_object_t *p_this)
     fingerprinter_thread_t   *p_fingerprinter = (fingerprinter_thread_t*) p_this;
     fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
 
-    vlc_cancel( p_sys->thread );
-    vlc_join( p_sys->thread, NULL );
+    /* Running fingerprints are stopped, pending requests are dropped */
+    vlc_mutex_lock( &p_sys->processing.lock );
+    p_sys->processing.b_exit = true;
+    vlc_cond_broadcast( &p_sys->processing.cond );
+    vlc_mutex_unlock( &p_sys->processing.lock );
+
+    for( unsigned i = 0; i < p_sys->i_workers; i++ )
+        vlc_join( p_sys->workers[i], NULL );
 
     CleanSys( p_sys );
     free( p_sys );
@@ -276,11 +351,6 @@ static void Close(vlc_object_t *p_this)
 
 static void CleanSys( fingerprinter_sys_t *p_sys )
 {
-    for ( size_t i = 0; i < vlc_array_count( &p_sys->incoming.queue ); i++ )
-        fingerprint_request_Delete( vlc_array_item_at_index( &p_sys->incoming.queue, i ) );
-    vlc_array_clear( &p_sys->incoming.queue );
-    vlc_mutex_destroy( &p_sys->incoming.lock );
-
     for ( size_t i = 0; i < vlc_array_count( &p_sys->processing.queue ); i++ )
         fingerprint_request_Delete( vlc_array_item_at_index( &p_sys->processing.queue, i ) );
     vlc_array_clear( &p_sys->processing.queue );
@@ -291,6 +361,8 @@ static void CleanSys( fingerprinter_sys_t *p_sys )
         fingerprint_request_Delete( vlc_array_item_at_index( &p_sys->results.queue, i ) );
     vlc_array_clear( &p_sys->results.queue );
     vlc_mutex_destroy( &p_sys->results.lock );
+
+    vlc_mutex_destroy( &p_sys->lookup.lock );
 }
 
 static void fill_metas_with_results( fingerprint_request_t *p_r, acoustid_fingerprint_t *p_f )
@@ -315,7 +387,7 @@ static void fill_metas_with_results( fingerprint_request_t *p_r, acoustid_finger
 }
 
 /*****************************************************************************
- * Run :
+ * Run : one worker, requests are processed in parallel by several of them
  *****************************************************************************/
 static void *Run( void *opaque )
 {
@@ -323,69 +395,71 @@ static void *Run( void *opaque )
     fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
 
     vlc_mutex_lock( &p_sys->processing.lock );
-    mutex_cleanup_push( &p_sys->processing.lock );
-
-    /* main loop */
     for (;;)
     {
-        vlc_tick_sleep( VLC_TICK_FROM_SEC(1) );
-
-        QueueIncomingRequests( p_sys );
-
-        vlc_testcancel();
-
-        bool results_available = false;
-        while( vlc_array_count( &p_sys->processing.queue ) )
+        while( !p_sys->processing.b_exit &&
+               vlc_array_count( &p_sys->processing.queue ) == 0 )
+            vlc_cond_wait( &p_sys->processing.cond, &p_sys->processing.lock );
+        if( p_sys->processing.b_exit )
+            break;
+
+        // the fingerprint request must not exist both in the
+        // processing and results queue, so remove it immediately
+        fingerprint_request_t *p_data = vlc_array_item_at_index( &p_sys->processing.queue, 0 );
+        vlc_array_remove( &p_sys->processing.queue, 0 );
+
+        char *psz_uri = input_item_GetURI( p_data->p_item );
+        if ( psz_uri != NULL )
         {
-            int canc = vlc_savecancel();
-            fingerprint_request_t *p_data = vlc_array_item_at_index( &p_sys->processing.queue, 0 );
-
-            char *psz_uri = input_item_GetURI( p_data->p_item );
-            if ( psz_uri != NULL )
-            {
-                 acoustid_fingerprint_t acoustid_print;
+            acoustid_fingerprint_t acoustid_print;
 
-                 memset( &acoustid_print , 0, sizeof (acoustid_print) );
-                /* overwrite with hint, as in this case, fingerprint's session will be truncated */
-                if ( p_data->i_duration )
-                     acoustid_print.i_duration = p_data->i_duration;
+            memset( &acoustid_print , 0, sizeof (acoustid_print) );
+            /* overwrite with hint, as in this case, fingerprint's session will be truncated */
+            if ( p_data->i_duration )
+                acoustid_print.i_duration = p_data->i_duration;
 
-                DoFingerprint( p_fingerprinter, &acoustid_print, psz_uri );
-                free( psz_uri );
+            DoFingerprint( p_fingerprinter, &acoustid_print, psz_uri );
+            free( psz_uri );
 
-                DoAcoustIdWebRequest( VLC_OBJECT(p_fingerprinter), &acoustid_print );
-                fill_metas_with_results( p_data, &acoustid_print );
+            bool b_exit = p_sys->processing.b_exit;
+            vlc_mutex_unlock( &p_sys->processing.lock );
 
-                for( unsigned j = 0; j < acoustid_print.results.count; j++ )
-                     free_acoustid_result_t( &acoustid_print.results.p_results[j] );
-                if( acoustid_print.results.count )
-                    free( acoustid_print.results.p_results );
-                free( acoustid_print.psz_fingerprint );
+            if( acoustid_print.psz_fingerprint != NULL )
+            {
+                p_data->results.psz_fingerprint =
+                    strdup( acoustid_print.psz_fingerprint );
+                if( !p_data->i_duration )
+                    p_data->i_duration = acoustid_print.i_duration;
+                if( !p_data->b_fingerprint_only && !b_exit )
+                {
+                    DoLookup( p_fingerprinter, &acoustid_print );
+                    fill_metas_with_results( p_data, &acoustid_print );
+                }
             }
-            vlc_restorecancel(canc);
-
-            /* copy results */
-            vlc_mutex_lock( &p_sys->results.lock );
-            if( vlc_array_append( &p_sys->results.queue, p_data ) )
-                fingerprint_request_Delete( p_data );
-            else
-                results_available = true;
-            vlc_mutex_unlock( &p_sys->results.lock );
-
-            // the fingerprint request must not exist both in the
-            // processing and results queue, even in case of thread
-            // cancellation, so remove it immediately
-            vlc_array_remove( &p_sys->processing.queue, 0 );
-
-            vlc_testcancel();
+
+            for( unsigned j = 0; j < acoustid_print.results.count; j++ )
+                 free_acoustid_result_t( &acoustid_print.results.p_results[j] );
+            if( acoustid_print.results.count )
+                free( acoustid_print.results.p_results );
+            free( acoustid_print.psz_fingerprint );
         }
+        else
+            vlc_mutex_unlock( &p_sys->processing.lock );
+
+        /* copy results */
+        bool results_available = false;
+        vlc_mutex_lock( &p_sys->results.lock );
+        if( vlc_array_append( &p_sys->results.queue, p_data ) )
+            fingerprint_request_Delete( p_data );
+        else
+            results_available = true;
+        vlc_mutex_unlock( &p_sys->results.lock );
 
         if ( results_available )
-        {
             var_TriggerCallback( p_fingerprinter, "results-available" );
-        }
-    }
 
-    vlc_cleanup_pop();
-    vlc_assert_unreachable();
+        vlc_mutex_lock( &p_sys->processing.lock );
+    }
+    vlc_mutex_unlock( &p_sys->processing.lock );
+    return NULL;
 }
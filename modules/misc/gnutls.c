@@ -41,12 +41,37 @@
 
 #include <gnutls/gnutls.h>
 #include <gnutls/x509.h>
+#if (GNUTLS_VERSION_NUMBER >= 0x030703)
+# include <gnutls/socket.h>
+#endif
+
+#define SESSION_CACHE_SIZE 8
+
+/**
+ * Client-side TLS credentials private data
+ */
+typedef struct vlc_tls_client_sys
+{
+    gnutls_certificate_credentials_t x509;
+    vlc_mutex_t lock;
+    /* Resumption data of recent sessions, by server */
+    struct
+    {
+        char *key; /* host:service */
+        gnutls_datum_t data;
+        vlc_tick_t last_use;
+    } cache[SESSION_CACHE_SIZE];
+} vlc_tls_client_sys_t;
 
 typedef struct vlc_tls_gnutls
 {
     vlc_tls_t tls;
     gnutls_session_t session;
     vlc_object_t *obj;
+    vlc_tls_t *sock;
+    vlc_tls_client_sys_t *client; /* NULL on server side */
+    char *cache_key;
+    bool verified;
 } vlc_tls_gnutls_t;
 
 static void gnutls_Banner(vlc_object_t *obj)
@@ -130,9 +155,8 @@ static ssize_t vlc_gnutls_writev(gnutls_transport_ptr_t ptr,
 static int gnutls_GetFD(vlc_tls_t *tls, short *restrict events)
 {
     vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
-    vlc_tls_t *sock = gnutls_transport_get_ptr(priv->session);
 
-    return vlc_tls_GetPollFD(sock, events);
+    return vlc_tls_GetPollFD(priv->sock, events);
 }
 
 static ssize_t gnutls_Recv(vlc_tls_t *tls, struct iovec *iov, unsigned count)
@@ -203,11 +227,90 @@ static int gnutls_Shutdown(vlc_tls_t *tls, bool duplex)
     return 0;
 }
 
+/**
+ * Saves the resumption data of a verified client session.
+ */
+static void gnutls_SessionSave(vlc_tls_gnutls_t *priv)
+{
+    vlc_tls_client_sys_t *sys = priv->client;
+    gnutls_datum_t data;
+
+    if (priv->cache_key == NULL || !priv->verified
+     || gnutls_session_get_data2(priv->session, &data) != 0)
+        return;
+
+    vlc_mutex_lock(&sys->lock);
+    /* Replace the entry of the same server, else the least recently used */
+    unsigned slot = 0;
+    for (unsigned i = 0; i < SESSION_CACHE_SIZE; i++)
+    {
+        if (sys->cache[i].key != NULL
+         && strcmp(sys->cache[i].key, priv->cache_key) == 0)
+        {
+            slot = i;
+            break;
+        }
+        if (sys->cache[i].last_use < sys->cache[slot].last_use)
+            slot = i;
+    }
+
+    char *key = strdup(priv->cache_key);
+    if (likely(key != NULL))
+    {
+        free(sys->cache[slot].key);
+        gnutls_free(sys->cache[slot].data.data);
+        sys->cache[slot].key = key;
+        sys->cache[slot].data = data;
+        sys->cache[slot].last_use = vlc_tick_now();
+    }
+    else
+        gnutls_free(data.data);
+    vlc_mutex_unlock(&sys->lock);
+}
+
+/**
+ * Sets the resumption data of a previous session with the same server, if any.
+ */
+static void gnutls_SessionResume(vlc_tls_gnutls_t *priv)
+{
+    vlc_tls_client_sys_t *sys = priv->client;
+
+    vlc_mutex_lock(&sys->lock);
+    for (unsigned i = 0; i < SESSION_CACHE_SIZE; i++)
+        if (sys->cache[i].key != NULL
+         && strcmp(sys->cache[i].key, priv->cache_key) == 0)
+        {
+            if (gnutls_session_set_data(priv->session, sys->cache[i].data.data,
+                                        sys->cache[i].data.size) == 0)
+                sys->cache[i].last_use = vlc_tick_now();
+            break;
+        }
+    vlc_mutex_unlock(&sys->lock);
+}
+
+#if (GNUTLS_VERSION_NUMBER >= 0x030603)
+/* TLS 1.3 session tickets are received after the handshake */
+static int gnutls_TicketHook(gnutls_session_t session, unsigned type,
+                             unsigned when, unsigned incoming,
+                             const gnutls_datum_t *msg)
+{
+    vlc_tls_gnutls_t *priv = gnutls_session_get_ptr(session);
+
+    gnutls_SessionSave(priv);
+    (void) type; (void) when; (void) incoming; (void) msg;
+    return 0;
+}
+#endif
+
 static void gnutls_Close (vlc_tls_t *tls)
 {
     vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
 
+    /* With false start, TLS 1.2 sessions are only complete by now */
+    if (priv->client != NULL)
+        gnutls_SessionSave(priv);
     gnutls_deinit(priv->session);
+    free(priv->cache_key);
     free(priv);
 }
 
@@ -231,9 +334,15 @@ static vlc_tls_gnutls_t *gnutls_SessionOpen(vlc_object_t *obj, int type,
 
     gnutls_session_t session;
     const char *errp;
-    int val;
+    int val, fd = -1;
 
     type |= GNUTLS_NONBLOCK;
+#if (GNUTLS_VERSION_NUMBER >= 0x030703)
+    if (var_InheritBool(obj, "gnutls-ktls"))
+        fd = vlc_tls_GetSocketFD(sock);
+    if (fd != -1)
+        type |= GNUTLS_NO_SIGNAL;
+#endif
 #if (GNUTLS_VERSION_NUMBER >= 0x030500)
     type |= GNUTLS_ENABLE_FALSE_START;
 #endif
@@ -292,12 +401,24 @@ static vlc_tls_gnutls_t *gnutls_SessionOpen(vlc_object_t *obj, int type,
         free (protv);
     }
 
-    gnutls_transport_set_ptr(session, sock);
-    gnutls_transport_set_vec_push_function(session, vlc_gnutls_writev);
-    gnutls_transport_set_pull_function(session, vlc_gnutls_read);
+    if (fd != -1)
+    {   /* Let GnuTLS use the socket directly, so that it can hand the record
+         * layer over to the kernel once the handshake is complete. */
+        gnutls_transport_set_int(session, fd);
+    }
+    else
+    {
+        gnutls_transport_set_ptr(session, sock);
+        gnutls_transport_set_vec_push_function(session, vlc_gnutls_writev);
+        gnutls_transport_set_pull_function(session, vlc_gnutls_read);
+    }
 
     priv->session = session;
     priv->obj = obj;
+    priv->sock = sock;
+    priv->client = NULL;
+    priv->cache_key = NULL;
+    priv->verified = false;
 
     vlc_tls_t *tls = &priv->tls;
 
@@ -358,6 +479,14 @@ static int gnutls_Handshake(vlc_tls_t *tls, char **restrict alp)
     if (flags & GNUTLS_SFLAGS_FALSE_START)
         msg_Dbg(obj, " - false start (RFC7918) enabled");
 #endif
+#if (GNUTLS_VERSION_NUMBER >= 0x030703)
+    unsigned ktls = gnutls_transport_is_ktls_enabled(session);
+
+    if (ktls & GNUTLS_KTLS_RECV)
+        msg_Dbg(obj, " - kernel offload of received records enabled");
+    if (ktls & GNUTLS_KTLS_SEND)
+        msg_Dbg(obj, " - kernel offload of sent records enabled");
+#endif
 
     if (alp != NULL)
     {
@@ -383,13 +512,22 @@ static vlc_tls_t *gnutls_ClientSessionOpen(vlc_tls_client_t *crd,
                                            vlc_tls_t *sk, const char *hostname,
                                            const char *const *alpn)
 {
+    vlc_tls_client_sys_t *sys = crd->sys;
     vlc_tls_gnutls_t *priv = gnutls_SessionOpen(VLC_OBJECT(crd), GNUTLS_CLIENT,
-                                                crd->sys, sk, alpn);
+                                                sys->x509, sk, alpn);
     if (priv == NULL)
         return NULL;
 
     gnutls_session_t session = priv->session;
 
+    priv->client = sys;
+    gnutls_session_set_ptr(session, priv);
+#if (GNUTLS_VERSION_NUMBER >= 0x030603)
+    gnutls_handshake_set_hook_function(session,
+                                       GNUTLS_HANDSHAKE_NEW_SESSION_TICKET,
+                                       GNUTLS_HOOK_POST, gnutls_TicketHook);
+#endif
+
     /* minimum DH prime bits */
     gnutls_dh_set_prime_bits (session, 1024);
 
@@ -408,6 +546,15 @@ static int gnutls_ClientHandshake(vlc_tls_t *tls,
     vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
     vlc_object_t *obj = priv->obj;
 
+    /* Resume the last session with the same server on the first call */
+    if (priv->cache_key == NULL && host != NULL && service != NULL)
+    {
+        if (asprintf(&priv->cache_key, "%s:%s", host, service) < 0)
+            priv->cache_key = NULL;
+        else
+            gnutls_SessionResume(priv);
+    }
+
     int val = gnutls_Handshake(tls, alp);
     if (val)
         return val;
@@ -416,6 +563,9 @@ static int gnutls_ClientHandshake(vlc_tls_t *tls,
     gnutls_session_t session = priv->session;
     unsigned status;
 
+    if (gnutls_session_is_resumed(session))
+        msg_Dbg(obj, "TLS session resumed");
+
     val = gnutls_certificate_verify_peers3 (session, host, &status);
     if (val)
     {
@@ -425,7 +575,7 @@ static int gnutls_ClientHandshake(vlc_tls_t *tls,
     }
 
     if (status == 0) /* Good certificate */
-        return 0;
+        goto done;
 
     /* Bad certificate */
     gnutls_datum_t desc;
@@ -527,6 +677,8 @@ static int gnutls_ClientHandshake(vlc_tls_t *tls,
         default:
             goto error;
     }
+done:
+    priv->verified = true;
     return 0;
 
 error:
@@ -537,9 +689,16 @@ error:
 
 static void gnutls_ClientDestroy(vlc_tls_client_t *crd)
 {
-    gnutls_certificate_credentials_t x509 = crd->sys;
+    vlc_tls_client_sys_t *sys = crd->sys;
 
-    gnutls_certificate_free_credentials(x509);
+    for (unsigned i = 0; i < SESSION_CACHE_SIZE; i++)
+    {
+        free(sys->cache[i].key);
+        gnutls_free(sys->cache[i].data.data);
+    }
+    vlc_mutex_destroy(&sys->lock);
+    gnutls_certificate_free_credentials(sys->x509);
+    free(sys);
 }
 
 static const struct vlc_tls_client_operations gnutls_ClientOps =
@@ -558,11 +717,16 @@ static int OpenClient(vlc_tls_client_t *crd)
 
     gnutls_Banner(VLC_OBJECT(crd));
 
+    vlc_tls_client_sys_t *sys = calloc(1, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
     int val = gnutls_certificate_allocate_credentials (&x509);
     if (val != 0)
     {
         msg_Err (crd, "cannot allocate credentials: %s",
                  gnutls_strerror (val));
+        free(sys);
         return VLC_EGENERIC;
     }
 
@@ -592,8 +756,11 @@ static int OpenClient(vlc_tls_client_t *crd)
     gnutls_certificate_set_verify_flags (x509,
                                          GNUTLS_VERIFY_ALLOW_X509_V1_CA_CRT);
 
+    sys->x509 = x509;
+    vlc_mutex_init(&sys->lock);
+
     crd->ops = &gnutls_ClientOps;
-    crd->sys = x509;
+    crd->sys = sys;
     return VLC_SUCCESS;
 }
 
@@ -738,6 +905,12 @@ error:
     "Trust the root certificates of Certificate Authorities stored in " \
     "the specified directory to authenticate TLS sessions.")
 
+#define KTLS_TEXT N_("Kernel TLS")
+#define KTLS_LONGTEXT N_( \
+    "Let the operating system kernel encrypt and decrypt the records of " \
+    "direct TCP connections after the handshake, if both GnuTLS and the " \
+    "kernel support it and it is enabled in the GnuTLS configuration.")
+
 #define PRIORITIES_TEXT N_("TLS cipher priorities")
 #define PRIORITIES_LONGTEXT N_("Ciphers, key exchange methods, " \
     "hash functions and compression methods can be selected. " \
@@ -771,6 +944,7 @@ vlc_module_begin ()
     add_string ("gnutls-priorities", "NORMAL", PRIORITIES_TEXT,
                 PRIORITIES_LONGTEXT, false)
         change_string_list (priorities_values, priorities_text)
+    add_bool("gnutls-ktls", false, KTLS_TEXT, KTLS_LONGTEXT, true)
 #ifdef ENABLE_SOUT
     add_submodule ()
         set_description( N_("GNU TLS server") )
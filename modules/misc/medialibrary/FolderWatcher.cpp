@@ -0,0 +1,276 @@
+/*****************************************************************************
+ * FolderWatcher.cpp: Reload entry points when their content changes
+ *****************************************************************************
+ * Copyright © 2020 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "medialibrary.h"
+
+#include <vlc_fs.h>
+#include <vlc_url.h>
+
+#include <stdexcept>
+#include <vector>
+
+#ifdef HAVE_SYS_INOTIFY_H
+# include <errno.h>
+# include <poll.h>
+# include <unistd.h>
+# include <sys/inotify.h>
+# include <sys/stat.h>
+
+/* Changes are coalesced until a folder has been quiet for that long. */
+#define SETTLE_DELAY VLC_TICK_FROM_SEC( 10 )
+#define MAX_DEPTH 32
+
+static const uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE |
+                                  IN_MOVED_FROM | IN_MOVED_TO |
+                                  IN_DELETE_SELF | IN_ONLYDIR;
+
+FolderWatcher::FolderWatcher( vlc_object_t* obj, medialibrary::IMediaLibrary* ml )
+    : m_obj( obj )
+    , m_ml( ml )
+    , m_stop( false )
+    , m_full( false )
+{
+    m_fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if ( m_fd == -1 )
+        throw std::runtime_error( "Failed to create an inotify instance" );
+    if ( vlc_pipe( m_pipe ) )
+    {
+        close( m_fd );
+        throw std::runtime_error( "Failed to create a pipe" );
+    }
+    if ( vlc_clone( &m_thread, &FolderWatcher::runCb, this,
+                    VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_close( m_pipe[0] );
+        vlc_close( m_pipe[1] );
+        close( m_fd );
+        throw std::runtime_error( "Failed to start the folder watcher" );
+    }
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    {
+        vlc::threads::mutex_locker lock( m_mutex );
+        m_stop = true;
+    }
+    wakeUp();
+    vlc_join( m_thread, nullptr );
+    vlc_close( m_pipe[0] );
+    vlc_close( m_pipe[1] );
+    close( m_fd );
+}
+
+void FolderWatcher::wakeUp()
+{
+    const char c = 0;
+    if ( write( m_pipe[1], &c, 1 ) != 1 )
+        msg_Err( m_obj, "Failed to wake the folder watcher up" );
+}
+
+void FolderWatcher::watch( const std::string& mrl )
+{
+    {
+        vlc::threads::mutex_locker lock( m_mutex );
+        m_toWatch.push_back( mrl );
+    }
+    // Walking the tree can take a while, let the watcher thread do it
+    wakeUp();
+}
+
+void FolderWatcher::unwatch( const std::string& mrl )
+{
+    vlc::threads::mutex_locker lock( m_mutex );
+
+    for ( auto it = m_watches.begin(); it != m_watches.end(); )
+    {
+        if ( it->second.entryPoint == mrl )
+        {
+            inotify_rm_watch( m_fd, it->first );
+            it = m_watches.erase( it );
+        }
+        else
+            ++it;
+    }
+    m_pending.erase( mrl );
+}
+
+/* Must be called with the lock held */
+void FolderWatcher::addTree( const std::string& path,
+                             const std::string& entryPoint, unsigned depth )
+{
+    if ( m_full || depth > MAX_DEPTH )
+        return;
+
+    int wd = inotify_add_watch( m_fd, path.c_str(), WatchMask );
+    if ( wd == -1 )
+    {
+        if ( errno == ENOSPC )
+        {
+            msg_Warn( m_obj, "Too many folders to watch, changes below %s "
+                      "will only be found by rescans (see the "
+                      "fs.inotify.max_user_watches sysctl)", path.c_str() );
+            m_full = true;
+        }
+        return;
+    }
+    m_watches[wd] = Watch{ path, entryPoint };
+
+    auto dir = vlc::wrap_cptr( vlc_opendir( path.c_str() ), &closedir );
+    if ( dir == nullptr )
+        return;
+
+    const char* name;
+    while ( ( name = vlc_readdir( dir.get() ) ) != nullptr )
+    {
+        if ( name[0] == '.' )
+            continue; /* ., .. and hidden folders are not indexed either */
+
+        std::string child = path + "/" + name;
+        struct stat st;
+        if ( vlc_lstat( child.c_str(), &st ) == 0 && S_ISDIR( st.st_mode ) )
+            addTree( child, entryPoint, depth + 1 );
+    }
+}
+
+void FolderWatcher::processEvents()
+{
+    alignas( struct inotify_event ) char buf[4096];
+    ssize_t len;
+
+    vlc::threads::mutex_locker lock( m_mutex );
+    while ( ( len = read( m_fd, buf, sizeof( buf ) ) ) > 0 )
+    {
+        for ( char* p = buf; p < buf + len; )
+        {
+            const struct inotify_event* ev =
+                reinterpret_cast<const struct inotify_event*>( p );
+            p += sizeof( *ev ) + ev->len;
+
+            auto it = m_watches.find( ev->wd );
+            if ( it == m_watches.end() )
+                continue;
+
+            const std::string entryPoint = it->second.entryPoint;
+            if ( ev->mask & IN_IGNORED )
+                m_watches.erase( it );
+            else if ( ( ev->mask & IN_ISDIR ) && ev->len > 0 &&
+                      ( ev->mask & ( IN_CREATE | IN_MOVED_TO ) ) &&
+                      ev->name[0] != '.' )
+                addTree( it->second.path + "/" + ev->name, entryPoint, 0 );
+
+            m_pending[entryPoint] = vlc_tick_now() + SETTLE_DELAY;
+        }
+    }
+}
+
+void FolderWatcher::run()
+{
+    for ( ;; )
+    {
+        std::vector<std::string> toWatch;
+        std::vector<std::string> toReload;
+        int timeout = -1;
+
+        {
+            vlc::threads::mutex_locker lock( m_mutex );
+            if ( m_stop )
+                break;
+            toWatch.swap( m_toWatch );
+
+            auto now = vlc_tick_now();
+            for ( auto it = m_pending.begin(); it != m_pending.end(); )
+            {
+                if ( it->second <= now )
+                {
+                    toReload.push_back( it->first );
+                    it = m_pending.erase( it );
+                    continue;
+                }
+                int ms = MS_FROM_VLC_TICK( it->second - now ) + 1;
+                if ( timeout < 0 || ms < timeout )
+                    timeout = ms;
+                ++it;
+            }
+
+            for ( const auto& mrl : toWatch )
+            {
+                auto path = vlc::wrap_cptr( vlc_uri2path( mrl.c_str() ) );
+                if ( path == nullptr )
+                    continue; /* only local folders can be watched */
+                msg_Dbg( m_obj, "Watching %s for changes", path.get() );
+                addTree( path.get(), mrl, 0 );
+            }
+        }
+
+        for ( const auto& mrl : toReload )
+        {
+            msg_Dbg( m_obj, "Content of %s changed, reloading", mrl.c_str() );
+            m_ml->reload( mrl );
+        }
+
+        struct pollfd ufd[2] = {
+            { m_fd, POLLIN, 0 },
+            { m_pipe[0], POLLIN, 0 },
+        };
+        if ( poll( ufd, 2, timeout ) < 0 )
+            continue;
+
+        if ( ufd[1].revents & POLLIN )
+        {
+            char c;
+            if ( read( m_pipe[0], &c, 1 ) != 1 )
+                msg_Err( m_obj, "Failed to read the folder watcher pipe" );
+        }
+        if ( ufd[0].revents & POLLIN )
+            processEvents();
+    }
+}
+
+void* FolderWatcher::runCb( void* data )
+{
+    static_cast<FolderWatcher*>( data )->run();
+    return nullptr;
+}
+
+#else
+
+FolderWatcher::FolderWatcher( vlc_object_t*, medialibrary::IMediaLibrary* )
+{
+    throw std::runtime_error( "Folder watching is not supported" );
+}
+
+FolderWatcher::~FolderWatcher()
+{
+}
+
+void FolderWatcher::watch( const std::string& )
+{
+}
+
+void FolderWatcher::unwatch( const std::string& )
+{
+}
+
+#endif
@@ -24,8 +24,9 @@
 
 #include "medialibrary.h"
 
-MetadataExtractor::MetadataExtractor( vlc_object_t* parent )
+MetadataExtractor::MetadataExtractor( vlc_object_t* parent, uint8_t nbThreads )
     : m_obj( parent )
+    , m_nbThreads( nbThreads )
 {
 }
 
@@ -208,7 +209,7 @@ const char* MetadataExtractor::name() const
 
 uint8_t MetadataExtractor::nbThreads() const
 {
-    return 1;
+    return m_nbThreads;
 }
 
 medialibrary::parser::Step MetadataExtractor::targetedStep() const
@@ -322,7 +322,10 @@ bool MediaLibrary::Start()
             break;
     }
 
-    ml->addParserService( std::make_shared<MetadataExtractor>( VLC_OBJECT( m_vlc_ml ) ) );
+    auto nbThreads = var_InheritInteger( m_vlc_ml, "ml-parser-threads" );
+    ml->addParserService( std::make_shared<MetadataExtractor>(
+                              VLC_OBJECT( m_vlc_ml ),
+                              VLC_CLIP( nbThreads, 1, 16 ) ) );
     try
     {
         ml->addThumbnailer( std::make_shared<Thumbnailer>(
@@ -368,6 +371,21 @@ bool MediaLibrary::Start()
         if ( varValue.empty() == false )
             config_PutPsz( "ml-folders", varValue.c_str()+1 ); /* skip initial ';' */
     }
+    if ( var_InheritBool( m_vlc_ml, "ml-watch-folders" ) )
+    {
+        try
+        {
+            m_watcher.reset( new FolderWatcher( VLC_OBJECT( m_vlc_ml ),
+                                                ml.get() ) );
+            for ( const auto& entryPoint : ml->entryPoints()->all() )
+                m_watcher->watch( entryPoint->mrl() );
+        }
+        catch ( const std::runtime_error& ex )
+        {
+            msg_Warn( m_vlc_ml, "Entry points will not be watched: %s",
+                      ex.what() );
+        }
+    }
     m_ml = std::move( ml );
     return true;
 }
@@ -389,8 +407,12 @@ int MediaLibrary::Control( int query, va_list args )
             {
                 case VLC_ML_ADD_FOLDER:
                     m_ml->discover( mrl );
+                    if ( m_watcher != nullptr )
+                        m_watcher->watch( mrl );
                     break;
                 case VLC_ML_REMOVE_FOLDER:
+                    if ( m_watcher != nullptr )
+                        m_watcher->unwatch( mrl );
                     m_ml->removeEntryPoint( mrl );
                     break;
                 case VLC_ML_BAN_FOLDER:
@@ -1373,6 +1395,14 @@ static void Close( vlc_medialibrary_module_t* module )
 #define ML_FOLDER_LONGTEXT _( "Semicolon separated list of folders to discover " \
                               "media from" )
 
+#define ML_PARSER_THREADS_TEXT _( "Metadata extraction threads" )
+#define ML_PARSER_THREADS_LONGTEXT _( "Number of files whose metadata are " \
+                                      "extracted concurrently while indexing" )
+
+#define ML_WATCH_TEXT _( "Watch folders for changes" )
+#define ML_WATCH_LONGTEXT _( "Reload the local folders of the media library " \
+                             "when files are added or removed in them" )
+
 vlc_module_begin()
     set_shortname(N_("media library"))
     set_description(N_( "Organize your media" ))
@@ -1381,4 +1411,7 @@ vlc_module_begin()
     set_capability("medialibrary", 100)
     set_callbacks(Open, Close)
     add_string( "ml-folders", nullptr, ML_FOLDER_TEXT, ML_FOLDER_LONGTEXT, false )
+    add_integer_with_range( "ml-parser-threads", 2, 1, 16,
+                            ML_PARSER_THREADS_TEXT, ML_PARSER_THREADS_LONGTEXT, true )
+    add_bool( "ml-watch-folders", true, ML_WATCH_TEXT, ML_WATCH_LONGTEXT, true )
 vlc_module_end()
@@ -36,6 +36,9 @@
 #include <vlc_cxx_helpers.hpp>
 
 #include <cstdarg>
+#include <map>
+#include <string>
+#include <vector>
 
 struct vlc_event_t;
 struct vlc_object_t;
@@ -71,7 +74,7 @@ private:
     };
 
 public:
-    MetadataExtractor( vlc_object_t* parent );
+    MetadataExtractor( vlc_object_t* parent, uint8_t nbThreads );
     virtual ~MetadataExtractor() = default;
 
     // All methods are meant to be accessed through IParserService, not directly
@@ -94,6 +97,7 @@ private:
 
 private:
     vlc_object_t* m_obj;
+    uint8_t m_nbThreads;
 };
 
 class Thumbnailer : public medialibrary::IThumbnailer
@@ -108,6 +112,46 @@ private:
     std::unique_ptr<vlc_thumbnailer_t, void(*)(vlc_thumbnailer_t*)> m_thumbnailer;
 };
 
+/**
+ * Watches local entry points, and reloads them once their content changed,
+ * so that new or removed files are indexed without a full rescan.
+ */
+class FolderWatcher
+{
+public:
+    FolderWatcher( vlc_object_t* obj, medialibrary::IMediaLibrary* ml );
+    ~FolderWatcher();
+    void watch( const std::string& mrl );
+    void unwatch( const std::string& mrl );
+
+private:
+    struct Watch
+    {
+        std::string path;
+        std::string entryPoint;
+    };
+
+    void wakeUp();
+    void addTree( const std::string& path, const std::string& entryPoint,
+                  unsigned depth );
+    void processEvents();
+    void run();
+    static void* runCb( void* data );
+
+    vlc_object_t* m_obj;
+    medialibrary::IMediaLibrary* m_ml;
+    int m_fd;
+    int m_pipe[2];
+    vlc_thread_t m_thread;
+    vlc::threads::mutex m_mutex;
+    bool m_stop;
+    bool m_full;
+    std::map<int, Watch> m_watches;
+    std::vector<std::string> m_toWatch;
+    // Entry points to reload, with the time to do it at
+    std::map<std::string, vlc_tick_t> m_pending;
+};
+
 class MediaLibrary : public medialibrary::IMediaLibraryCb
 {
 public:
@@ -138,6 +182,8 @@ private:
     vlc_medialibrary_module_t* m_vlc_ml;
     std::unique_ptr<Logger> m_logger;
     std::unique_ptr<medialibrary::IMediaLibrary> m_ml;
+    // Must be destroyed before the medialibrary it reloads
+    std::unique_ptr<FolderWatcher> m_watcher;
 
     // IMediaLibraryCb interface
 public:
@@ -0,0 +1,1127 @@
+/*****************************************************************************
+ * mkv.c: Matroska/WebM muxer
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_boxes.h>
+
+#include "../demux/xiph.h"
+#include "../packetizer/hxxx_nal.h"
+#include "../packetizer/h264_nal.h"
+#include "../packetizer/hevc_nal.h"
+#include "av1_pack.h"
+#include "extradata.h"
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define CLUSTER_DURATION_TEXT N_("Cluster duration (ms)")
+#define CLUSTER_DURATION_LONGTEXT N_(\
+    "Target duration of the clusters, in milliseconds. Clusters start on a " \
+    "key frame of the main stream whenever possible.")
+
+#define CLUSTER_SIZE_TEXT N_("Cluster size (KiB)")
+#define CLUSTER_SIZE_LONGTEXT N_(\
+    "Size from which a cluster is closed on the next key frame, even if " \
+    "it is shorter than the cluster duration. Each cluster is written at " \
+    "once.")
+
+#define CUES_TEXT N_("Write cues")
+#define CUES_LONGTEXT N_(\
+    "Index the clusters, and write the index at the end of the file. " \
+    "Files are playable without it, and while they are being recorded.")
+
+static int  Open   (vlc_object_t *);
+static void Close  (vlc_object_t *);
+
+#define SOUT_CFG_PREFIX "sout-mkv-"
+
+vlc_module_begin ()
+    set_description(N_("Matroska/WebM muxer"))
+    set_category(CAT_SOUT)
+    set_subcategory(SUBCAT_SOUT_MUX)
+    set_shortname("Matroska")
+
+    add_integer_with_range(SOUT_CFG_PREFIX "cluster-duration", 5000, 100, 30000,
+                           CLUSTER_DURATION_TEXT, CLUSTER_DURATION_LONGTEXT, true)
+    add_integer_with_range(SOUT_CFG_PREFIX "cluster-size", 4096, 64, 65536,
+                           CLUSTER_SIZE_TEXT, CLUSTER_SIZE_LONGTEXT, true)
+    add_bool(SOUT_CFG_PREFIX "cues", true, CUES_TEXT, CUES_LONGTEXT, true)
+    set_capability("sout mux", 5)
+    add_shortcut("mkv", "mka", "webm")
+    set_callbacks(Open, Close)
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static const char *const ppsz_sout_options[] = {
+    "cluster-duration", "cluster-size", "cues", NULL
+};
+
+static int Control(sout_mux_t *, int, va_list);
+static int AddStream(sout_mux_t *, sout_input_t *);
+static void DelStream(sout_mux_t *, sout_input_t *);
+static int Mux      (sout_mux_t *);
+
+/* EBML and Matroska element IDs */
+#define EBML_ID_HEADER              0x1A45DFA3
+#define EBML_ID_VERSION             0x4286
+#define EBML_ID_READVERSION         0x42F7
+#define EBML_ID_MAXIDLENGTH         0x42F2
+#define EBML_ID_MAXSIZELENGTH       0x42F3
+#define EBML_ID_DOCTYPE             0x4282
+#define EBML_ID_DOCTYPEVERSION      0x4287
+#define EBML_ID_DOCTYPEREADVERSION  0x4285
+#define EBML_ID_VOID                0xEC
+
+#define MKV_ID_SEGMENT              0x18538067
+#define MKV_ID_SEEKHEAD             0x114D9B74
+#define MKV_ID_SEEK                 0x4DBB
+#define MKV_ID_SEEKID               0x53AB
+#define MKV_ID_SEEKPOSITION         0x53AC
+#define MKV_ID_INFO                 0x1549A966
+#define MKV_ID_TIMECODESCALE        0x2AD7B1
+#define MKV_ID_DURATION             0x4489
+#define MKV_ID_MUXINGAPP            0x4D80
+#define MKV_ID_WRITINGAPP           0x5741
+#define MKV_ID_TRACKS               0x1654AE6B
+#define MKV_ID_TRACKENTRY           0xAE
+#define MKV_ID_TRACKNUMBER          0xD7
+#define MKV_ID_TRACKUID             0x73C5
+#define MKV_ID_TRACKTYPE            0x83
+#define MKV_ID_FLAGLACING           0x9C
+#define MKV_ID_DEFAULTDURATION      0x23E383
+#define MKV_ID_LANGUAGE             0x22B59C
+#define MKV_ID_CODECID              0x86
+#define MKV_ID_CODECPRIVATE         0x63A2
+#define MKV_ID_CODECDELAY           0x56AA
+#define MKV_ID_SEEKPREROLL          0x56BB
+#define MKV_ID_VIDEO                0xE0
+#define MKV_ID_PIXELWIDTH           0xB0
+#define MKV_ID_PIXELHEIGHT          0xBA
+#define MKV_ID_DISPLAYWIDTH         0x54B0
+#define MKV_ID_DISPLAYHEIGHT        0x54BA
+#define MKV_ID_AUDIO                0xE1
+#define MKV_ID_SAMPLINGFREQUENCY    0xB5
+#define MKV_ID_CHANNELS             0x9F
+#define MKV_ID_BITDEPTH             0x6264
+#define MKV_ID_CLUSTER              0x1F43B675
+#define MKV_ID_TIMECODE             0xE7
+#define MKV_ID_SIMPLEBLOCK          0xA3
+#define MKV_ID_BLOCKGROUP           0xA0
+#define MKV_ID_BLOCK                0xA1
+#define MKV_ID_BLOCKDURATION        0x9B
+#define MKV_ID_CUES                 0x1C53BB6B
+#define MKV_ID_CUEPOINT             0xBB
+#define MKV_ID_CUETIME              0xB3
+#define MKV_ID_CUETRACKPOSITIONS    0xB7
+#define MKV_ID_CUETRACK             0xF7
+#define MKV_ID_CUECLUSTERPOSITION   0xF1
+
+#define MKV_TRACK_VIDEO     1
+#define MKV_TRACK_AUDIO     2
+#define MKV_TRACK_SUBTITLE  0x11
+
+/* Track numbers are written as one byte long variable size integers */
+#define MKV_MAX_TRACKS      126
+/* Room kept after the EBML header for the seek head, rewritten on closing
+ * to point to the cues */
+#define MKV_SEEKHEAD_SIZE   96
+/* Element ID and 8 bytes long size kept at the start of the clusters */
+#define MKV_CLUSTER_HEADER  12
+
+static const struct
+{
+    vlc_fourcc_t i_codec;
+    const char  *psz_codec_id;
+    bool         b_webm;
+    uint8_t      i_bitdepth; /* PCM only */
+} mkv_codecs[] = {
+    { VLC_CODEC_H264,   "V_MPEG4/ISO/AVC",  false, 0 },
+    { VLC_CODEC_HEVC,   "V_MPEGH/ISO/HEVC", false, 0 },
+    { VLC_CODEC_VP8,    "V_VP8",            true,  0 },
+    { VLC_CODEC_VP9,    "V_VP9",            true,  0 },
+    { VLC_CODEC_AV1,    "V_AV1",            true,  0 },
+    { VLC_CODEC_MP4V,   "V_MPEG4/ISO/ASP",  false, 0 },
+    { VLC_CODEC_MPGV,   "V_MPEG2",          false, 0 },
+    { VLC_CODEC_MJPG,   "V_MJPEG",          false, 0 },
+    { VLC_CODEC_THEORA, "V_THEORA",         false, 0 },
+    { VLC_CODEC_VORBIS, "A_VORBIS",         true,  0 },
+    { VLC_CODEC_OPUS,   "A_OPUS",           true,  0 },
+    { VLC_CODEC_FLAC,   "A_FLAC",           false, 0 },
+    { VLC_CODEC_MP4A,   "A_AAC",            false, 0 },
+    { VLC_CODEC_MPGA,   "A_MPEG/L2",        false, 0 },
+    { VLC_CODEC_MP3,    "A_MPEG/L3",        false, 0 },
+    { VLC_CODEC_A52,    "A_AC3",            false, 0 },
+    { VLC_CODEC_EAC3,   "A_EAC3",           false, 0 },
+    { VLC_CODEC_DTS,    "A_DTS",            false, 0 },
+    { VLC_CODEC_U8,     "A_PCM/INT/LIT",    false, 8 },
+    { VLC_CODEC_S16L,   "A_PCM/INT/LIT",    false, 16 },
+    { VLC_CODEC_S24L,   "A_PCM/INT/LIT",    false, 24 },
+    { VLC_CODEC_S32L,   "A_PCM/INT/LIT",    false, 32 },
+    { VLC_CODEC_S16B,   "A_PCM/INT/BIG",    false, 16 },
+    { VLC_CODEC_S24B,   "A_PCM/INT/BIG",    false, 24 },
+    { VLC_CODEC_S32B,   "A_PCM/INT/BIG",    false, 32 },
+    { VLC_CODEC_F32L,   "A_PCM/FLOAT/IEEE", false, 32 },
+    { VLC_CODEC_SUBT,   "S_TEXT/UTF8",      false, 0 },
+};
+
+typedef struct
+{
+    unsigned     i_track;       /* Matroska track number */
+    size_t       i_codec;       /* Index in mkv_codecs */
+    uint8_t      i_nal_length;  /* NAL length size of H.264/HEVC samples */
+    mux_extradata_builder_t *extrabuilder;
+} mkv_stream_t;
+
+typedef struct
+{
+    uint64_t     i_time;        /* in milliseconds */
+    uint64_t     i_cluster_pos; /* relative to the segment payload */
+    unsigned     i_track;
+} mkv_cue_t;
+
+typedef struct
+{
+    bool         b_webm;
+    bool         b_seekable;
+    bool         b_header_sent;
+    bool         b_cues;
+
+    unsigned     i_nb_streams;
+    mkv_stream_t *p_ref;        /* stream whose key frames start clusters */
+
+    uint64_t     i_pos;         /* bytes written so far */
+    uint64_t     i_segment_size_pos;
+    uint64_t     i_segment_pos; /* start of the segment payload */
+    uint64_t     i_seekhead_pos;
+    uint64_t     i_info_pos;    /* relative to the segment payload */
+    uint64_t     i_tracks_pos;  /* relative to the segment payload */
+    uint64_t     i_duration_pos;
+
+    vlc_tick_t   i_start;       /* time origin of the file */
+    vlc_tick_t   i_end;
+
+    /* current cluster */
+    bo_t         cluster;
+    vlc_tick_t   i_cluster_start;
+    int64_t      i_cluster_time; /* in milliseconds */
+    bool         b_cluster_key;
+
+    vlc_tick_t   i_cluster_duration;
+    size_t       i_cluster_size;
+
+    /* index */
+    mkv_cue_t   *p_cues;
+    size_t       i_cues;
+    size_t       i_cues_max;
+} sout_mux_sys_t;
+
+/*****************************************************************************
+ * EBML writing helpers
+ *****************************************************************************/
+static size_t ebml_id_len(uint32_t i_id)
+{
+    return i_id > 0xFFFFFF ? 4 : i_id > 0xFFFF ? 3 : i_id > 0xFF ? 2 : 1;
+}
+
+static size_t ebml_uint_len(uint64_t i_val)
+{
+    size_t i_len = 1;
+    while(i_len < 8 && (i_val >> (8 * i_len)) != 0)
+        i_len++;
+    return i_len;
+}
+
+static size_t ebml_size_len(uint64_t i_size)
+{
+    /* all bits set is reserved for unknown sizes */
+    size_t i_len = 1;
+    while(i_len < 8 && i_size >= (UINT64_C(1) << (7 * i_len)) - 1)
+        i_len++;
+    return i_len;
+}
+
+static void ebml_add_id(bo_t *bo, uint32_t i_id)
+{
+    for(size_t i = ebml_id_len(i_id); i > 0; i--)
+        bo_add_8(bo, i_id >> (8 * (i - 1)));
+}
+
+static void ebml_add_size(bo_t *bo, uint64_t i_size)
+{
+    const size_t i_len = ebml_size_len(i_size);
+    i_size |= UINT64_C(1) << (7 * i_len);
+    for(size_t i = i_len; i > 0; i--)
+        bo_add_8(bo, i_size >> (8 * (i - 1)));
+}
+
+static void ebml_add_uint_len(bo_t *bo, uint32_t i_id, uint64_t i_val,
+                              size_t i_len)
+{
+    ebml_add_id(bo, i_id);
+    ebml_add_size(bo, i_len);
+    for(size_t i = i_len; i > 0; i--)
+        bo_add_8(bo, i_val >> (8 * (i - 1)));
+}
+
+static void ebml_add_uint(bo_t *bo, uint32_t i_id, uint64_t i_val)
+{
+    ebml_add_uint_len(bo, i_id, i_val, ebml_uint_len(i_val));
+}
+
+static size_t ebml_uint_element_len(uint32_t i_id, uint64_t i_val)
+{
+    return ebml_id_len(i_id) + 1 + ebml_uint_len(i_val);
+}
+
+static void ebml_add_float(bo_t *bo, uint32_t i_id, double f_val)
+{
+    union { double f; uint64_t i; } u = { .f = f_val };
+    ebml_add_id(bo, i_id);
+    ebml_add_size(bo, 8);
+    bo_add_64be(bo, u.i);
+}
+
+static void ebml_add_binary(bo_t *bo, uint32_t i_id, const void *p_data,
+                            size_t i_data)
+{
+    ebml_add_id(bo, i_id);
+    ebml_add_size(bo, i_data);
+    bo_add_mem(bo, i_data, p_data);
+}
+
+static void ebml_add_string(bo_t *bo, uint32_t i_id, const char *psz)
+{
+    ebml_add_binary(bo, i_id, psz, strlen(psz));
+}
+
+/* Master elements are written with 8 bytes long sizes, fixed on closing */
+static size_t ebml_open(bo_t *bo, uint32_t i_id)
+{
+    ebml_add_id(bo, i_id);
+    size_t i_offset = bo_size(bo);
+    bo_add_64be(bo, 0);
+    return i_offset;
+}
+
+static void ebml_close(bo_t *bo, size_t i_offset)
+{
+    bo_set_64be(bo, i_offset, (UINT64_C(1) << 56) |
+                              (bo_size(bo) - i_offset - 8));
+}
+
+static void ebml_add_void(bo_t *bo, size_t i_total)
+{
+    assert(i_total >= 2);
+    ebml_add_id(bo, EBML_ID_VOID);
+    if(i_total - 2 < 127)
+    {
+        bo_add_8(bo, 0x80 | (i_total - 2));
+        i_total -= 2;
+    }
+    else
+    {
+        bo_add_64be(bo, (UINT64_C(1) << 56) | (i_total - 9));
+        i_total -= 9;
+    }
+    while(i_total-- > 0)
+        bo_add_8(bo, 0);
+}
+
+/*****************************************************************************
+ * Open:
+ *****************************************************************************/
+static int Open(vlc_object_t *p_this)
+{
+    sout_mux_t      *p_mux = (sout_mux_t*)p_this;
+    sout_mux_sys_t  *p_sys;
+
+    msg_Dbg(p_mux, "Matroska muxer opened");
+    config_ChainParse(p_mux, SOUT_CFG_PREFIX, ppsz_sout_options, p_mux->p_cfg);
+
+    p_sys = calloc(1, sizeof(sout_mux_sys_t));
+    if(!p_sys)
+        return VLC_ENOMEM;
+
+    p_sys->b_webm = p_mux->psz_mux != NULL && !strcmp(p_mux->psz_mux, "webm");
+    if(sout_AccessOutControl(p_mux->p_access, ACCESS_OUT_CAN_SEEK,
+                             &p_sys->b_seekable))
+        p_sys->b_seekable = false;
+    p_sys->b_cues = var_InheritBool(p_mux, SOUT_CFG_PREFIX "cues");
+    p_sys->i_cluster_duration = VLC_TICK_FROM_MS(
+        var_InheritInteger(p_mux, SOUT_CFG_PREFIX "cluster-duration"));
+    p_sys->i_cluster_size =
+        var_InheritInteger(p_mux, SOUT_CFG_PREFIX "cluster-size") * 1024;
+    p_sys->i_start = VLC_TICK_INVALID;
+    p_sys->i_end = VLC_TICK_INVALID;
+
+    p_mux->pf_control   = Control;
+    p_mux->pf_addstream = AddStream;
+    p_mux->pf_delstream = DelStream;
+    p_mux->pf_mux       = Mux;
+    p_mux->p_sys        = p_sys;
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Clusters and cues
+ *****************************************************************************/
+static void Write(sout_mux_t *p_mux, block_t *p_block)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    p_sys->i_pos += p_block->i_buffer;
+    sout_AccessOutWrite(p_mux->p_access, p_block);
+}
+
+static void FlushCluster(sout_mux_t *p_mux)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    block_t *p_cluster = p_sys->cluster.b;
+
+    if(p_cluster == NULL)
+        return;
+    p_sys->cluster.b = NULL;
+
+    /* The cluster is written at once, its size is thus always known */
+    SetDWBE(p_cluster->p_buffer, MKV_ID_CLUSTER);
+    SetQWBE(&p_cluster->p_buffer[4], (UINT64_C(1) << 56) |
+                        (p_cluster->i_buffer - MKV_CLUSTER_HEADER));
+    if(p_sys->b_cluster_key)
+        p_cluster->i_flags |= BLOCK_FLAG_TYPE_I; /* http sout */
+    Write(p_mux, p_cluster);
+}
+
+static int OpenCluster(sout_mux_t *p_mux, vlc_tick_t i_time, bool b_key,
+                       unsigned i_track)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    int64_t i_time_ms = __MAX(MS_FROM_VLC_TICK(i_time - p_sys->i_start), 0);
+
+    if(!bo_init(&p_sys->cluster, p_sys->i_cluster_size + 65536))
+        return VLC_ENOMEM;
+    p_sys->cluster.b->i_buffer = MKV_CLUSTER_HEADER;
+    ebml_add_uint(&p_sys->cluster, MKV_ID_TIMECODE, i_time_ms);
+
+    p_sys->i_cluster_start = i_time;
+    p_sys->i_cluster_time = i_time_ms;
+    p_sys->b_cluster_key = b_key;
+
+    if(!b_key || !p_sys->b_cues)
+        return VLC_SUCCESS;
+
+    if(p_sys->i_cues == p_sys->i_cues_max)
+    {
+        size_t i_max = p_sys->i_cues_max ? p_sys->i_cues_max * 2 : 1024;
+        mkv_cue_t *p_cues = realloc(p_sys->p_cues, i_max * sizeof(*p_cues));
+        if(!p_cues)
+            return VLC_SUCCESS; /* the index is optional */
+        p_sys->p_cues = p_cues;
+        p_sys->i_cues_max = i_max;
+    }
+    mkv_cue_t *p_cue = &p_sys->p_cues[p_sys->i_cues++];
+    p_cue->i_time = i_time_ms;
+    p_cue->i_cluster_pos = p_sys->i_pos - p_sys->i_segment_pos;
+    p_cue->i_track = i_track;
+
+    return VLC_SUCCESS;
+}
+
+static block_t *CreateCues(sout_mux_t *p_mux)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    bo_t bo;
+
+    if(p_sys->i_cues == 0 || !bo_init(&bo, 16 * p_sys->i_cues + 16))
+        return NULL;
+
+    size_t i_cues = ebml_open(&bo, MKV_ID_CUES);
+    for(size_t i = 0; i < p_sys->i_cues; i++)
+    {
+        const mkv_cue_t *p_cue = &p_sys->p_cues[i];
+        const size_t i_positions =
+            ebml_uint_element_len(MKV_ID_CUETRACK, p_cue->i_track) +
+            ebml_uint_element_len(MKV_ID_CUECLUSTERPOSITION,
+                                  p_cue->i_cluster_pos);
+        const size_t i_point =
+            ebml_uint_element_len(MKV_ID_CUETIME, p_cue->i_time) +
+            ebml_id_len(MKV_ID_CUETRACKPOSITIONS) +
+            ebml_size_len(i_positions) + i_positions;
+
+        ebml_add_id(&bo, MKV_ID_CUEPOINT);
+        ebml_add_size(&bo, i_point);
+        ebml_add_uint(&bo, MKV_ID_CUETIME, p_cue->i_time);
+        ebml_add_id(&bo, MKV_ID_CUETRACKPOSITIONS);
+        ebml_add_size(&bo, i_positions);
+        ebml_add_uint(&bo, MKV_ID_CUETRACK, p_cue->i_track);
+        ebml_add_uint(&bo, MKV_ID_CUECLUSTERPOSITION, p_cue->i_cluster_pos);
+    }
+    ebml_close(&bo, i_cues);
+
+    return bo.b;
+}
+
+static void AddSeek(bo_t *bo, uint32_t i_id, uint64_t i_pos)
+{
+    ebml_add_id(bo, MKV_ID_SEEK);
+    ebml_add_size(bo, 7 + 11);
+    ebml_add_uint_len(bo, MKV_ID_SEEKID, i_id, 4);
+    ebml_add_uint_len(bo, MKV_ID_SEEKPOSITION, i_pos, 8);
+}
+
+static void AddSeekHead(bo_t *bo, const sout_mux_sys_t *p_sys,
+                        uint64_t i_cues_pos)
+{
+    const size_t i_start = bo_size(bo);
+    size_t i_seekhead = ebml_open(bo, MKV_ID_SEEKHEAD);
+    AddSeek(bo, MKV_ID_INFO, p_sys->i_info_pos);
+    AddSeek(bo, MKV_ID_TRACKS, p_sys->i_tracks_pos);
+    if(i_cues_pos)
+        AddSeek(bo, MKV_ID_CUES, i_cues_pos);
+    ebml_close(bo, i_seekhead);
+    ebml_add_void(bo, MKV_SEEKHEAD_SIZE - (bo_size(bo) - i_start));
+}
+
+/*****************************************************************************
+ * Close:
+ *****************************************************************************/
+static void Close(vlc_object_t * p_this)
+{
+    sout_mux_t      *p_mux = (sout_mux_t*)p_this;
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+
+    msg_Dbg(p_mux, "Matroska muxer closed");
+
+    if(p_sys->b_header_sent)
+    {
+        FlushCluster(p_mux);
+
+        uint64_t i_cues_pos = 0;
+        block_t *p_cues = CreateCues(p_mux);
+        if(p_cues)
+        {
+            i_cues_pos = p_sys->i_pos - p_sys->i_segment_pos;
+            Write(p_mux, p_cues);
+        }
+
+        if(p_sys->b_seekable)
+        {
+            bo_t bo;
+            /* Segment size */
+            if(bo_init(&bo, 8))
+            {
+                bo_add_64be(&bo, (UINT64_C(1) << 56) |
+                                 (p_sys->i_pos - p_sys->i_segment_pos));
+                sout_AccessOutSeek(p_mux->p_access, p_sys->i_segment_size_pos);
+                sout_AccessOutWrite(p_mux->p_access, bo.b);
+            }
+            /* Seek head, now that the cues are written */
+            if(i_cues_pos && bo_init(&bo, MKV_SEEKHEAD_SIZE))
+            {
+                AddSeekHead(&bo, p_sys, i_cues_pos);
+                sout_AccessOutSeek(p_mux->p_access, p_sys->i_seekhead_pos);
+                sout_AccessOutWrite(p_mux->p_access, bo.b);
+            }
+            /* Duration */
+            if(p_sys->i_end != VLC_TICK_INVALID && bo_init(&bo, 8))
+            {
+                union { double f; uint64_t i; } u = {
+                    .f = MS_FROM_VLC_TICK(p_sys->i_end - p_sys->i_start)
+                };
+                bo_add_64be(&bo, u.i);
+                sout_AccessOutSeek(p_mux->p_access, p_sys->i_duration_pos);
+                sout_AccessOutWrite(p_mux->p_access, bo.b);
+            }
+        }
+    }
+
+    free(p_sys->p_cues);
+    free(p_sys);
+}
+
+static int Control(sout_mux_t *p_mux, int i_query, va_list args)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    bool *pb_bool;
+    char **ppsz;
+
+    switch(i_query)
+    {
+        case MUX_CAN_ADD_STREAM_WHILE_MUXING:
+            pb_bool = va_arg(args, bool *);
+            *pb_bool = false;
+            return VLC_SUCCESS;
+
+        case MUX_GET_ADD_STREAM_WAIT:
+            pb_bool = va_arg(args, bool *);
+            *pb_bool = true;
+            return VLC_SUCCESS;
+
+        case MUX_GET_MIME:
+            ppsz = va_arg(args, char **);
+            *ppsz = strdup(p_sys->b_webm ? "video/webm" : "video/x-matroska");
+            return VLC_SUCCESS;
+
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static int AddStream(sout_mux_t *p_mux, sout_input_t *p_input)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    const es_format_t *p_fmt = p_input->p_fmt;
+    size_t i_codec;
+
+    if(p_sys->b_header_sent || p_sys->i_nb_streams >= MKV_MAX_TRACKS)
+    {
+        msg_Err(p_mux, "cannot add more streams");
+        return VLC_EGENERIC;
+    }
+
+    for(i_codec = 0; i_codec < ARRAY_SIZE(mkv_codecs); i_codec++)
+        if(mkv_codecs[i_codec].i_codec == p_fmt->i_codec)
+            break;
+    if(i_codec == ARRAY_SIZE(mkv_codecs) ||
+       (p_sys->b_webm && !mkv_codecs[i_codec].b_webm))
+    {
+        msg_Err(p_mux, "unsupported codec %4.4s in %s",
+                (const char *)&p_fmt->i_codec,
+                p_sys->b_webm ? "WebM" : "Matroska");
+        return VLC_EGENERIC;
+    }
+
+    mkv_stream_t *p_stream = calloc(1, sizeof(*p_stream));
+    if(!p_stream)
+        return VLC_ENOMEM;
+
+    p_stream->i_track = ++p_sys->i_nb_streams;
+    p_stream->i_codec = i_codec;
+    p_stream->extrabuilder = mux_extradata_builder_New(p_fmt->i_codec,
+                                                       EXTRADATA_ISOBMFF);
+
+    /* Clusters and cues follow the video key frames, or the audio if
+     * there is no video */
+    if(p_fmt->i_cat == VIDEO_ES &&
+       (p_sys->p_ref == NULL ||
+        p_mux->pp_inputs[0]->p_fmt->i_cat != VIDEO_ES))
+        p_sys->p_ref = p_stream;
+    else if(p_fmt->i_cat == AUDIO_ES && p_sys->p_ref == NULL)
+        p_sys->p_ref = p_stream;
+
+    p_input->p_sys = p_stream;
+    msg_Dbg(p_mux, "adding input %u (%s)", p_stream->i_track,
+            mkv_codecs[i_codec].psz_codec_id);
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Header
+ *****************************************************************************/
+static block_t *GetAvcC(mkv_stream_t *p_stream, const uint8_t *p_buf,
+                        size_t i_buf)
+{
+    const uint8_t *p_sps, *p_pps, *p_ext;
+    size_t i_sps, i_pps, i_ext;
+
+    if(!h264_AnnexB_get_spspps(p_buf, i_buf, &p_sps, &i_sps, &p_pps, &i_pps,
+                               &p_ext, &i_ext) || i_sps == 0 || i_pps == 0)
+        return NULL;
+
+    p_stream->i_nal_length = 4;
+    return h264_NAL_to_avcC(4, &p_sps, &i_sps, 1, &p_pps, &i_pps, 1);
+}
+
+static block_t *GetHvcC(mkv_stream_t *p_stream, const uint8_t *p_buf,
+                        size_t i_buf)
+{
+    struct hevc_dcr_params params = { 0 };
+    const uint8_t *p_nal;
+    size_t i_nal;
+
+    hxxx_iterator_ctx_t it;
+    hxxx_iterator_init(&it, p_buf, i_buf, 0);
+    while(hxxx_annexb_iterate_next(&it, &p_nal, &i_nal))
+    {
+        switch(hevc_getNALType(p_nal))
+        {
+            case HEVC_NAL_VPS:
+                if(params.i_vps_count < ARRAY_SIZE(params.p_vps) && i_nal <= UINT8_MAX)
+                {
+                    params.p_vps[params.i_vps_count] = p_nal;
+                    params.rgi_vps[params.i_vps_count++] = i_nal;
+                }
+                break;
+            case HEVC_NAL_SPS:
+                if(params.i_sps_count < ARRAY_SIZE(params.p_sps) && i_nal <= UINT8_MAX)
+                {
+                    params.p_sps[params.i_sps_count] = p_nal;
+                    params.rgi_sps[params.i_sps_count++] = i_nal;
+                }
+                break;
+            case HEVC_NAL_PPS:
+                if(params.i_pps_count < ARRAY_SIZE(params.p_pps) && i_nal <= UINT8_MAX)
+                {
+                    params.p_pps[params.i_pps_count] = p_nal;
+                    params.rgi_pps[params.i_pps_count++] = i_nal;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    if(params.i_vps_count == 0 || params.i_sps_count == 0 ||
+       params.i_pps_count == 0)
+        return NULL;
+
+    size_t i_dcr;
+    uint8_t *p_dcr = hevc_create_dcr(&params, 4, false, &i_dcr);
+    if(p_dcr == NULL)
+        return NULL;
+
+    p_stream->i_nal_length = 4;
+    return block_heap_Alloc(p_dcr, i_dcr);
+}
+
+/* Returns the codec private data, from the format or from the first block
+ * when the packetizer only has them in band */
+static block_t *GetCodecPrivate(sout_mux_t *p_mux, mkv_stream_t *p_stream,
+                                const es_format_t *p_fmt,
+                                const block_t *p_first)
+{
+    const uint8_t *p_extra = p_fmt->p_extra;
+    size_t i_extra = p_fmt->i_extra;
+    block_t *p_priv = NULL;
+
+    switch(p_fmt->i_codec)
+    {
+        case VLC_CODEC_H264:
+            if(h264_isavcC(p_extra, i_extra))
+            {
+                p_stream->i_nal_length = (p_extra[4] & 0x03) + 1;
+                break;
+            }
+            p_priv = GetAvcC(p_stream, p_extra, i_extra);
+            if(!p_priv && p_first)
+                p_priv = GetAvcC(p_stream, p_first->p_buffer,
+                                 p_first->i_buffer);
+            if(!p_priv)
+                msg_Warn(p_mux, "no SPS/PPS for track %u", p_stream->i_track);
+            return p_priv;
+
+        case VLC_CODEC_HEVC:
+            if(hevc_ishvcC(p_extra, i_extra))
+            {
+                p_stream->i_nal_length = hevc_getNALLengthSize(p_extra);
+                break;
+            }
+            p_priv = GetHvcC(p_stream, p_extra, i_extra);
+            if(!p_priv && p_first)
+                p_priv = GetHvcC(p_stream, p_first->p_buffer,
+                                 p_first->i_buffer);
+            if(!p_priv)
+                msg_Warn(p_mux, "no VPS/SPS/PPS for track %u",
+                         p_stream->i_track);
+            return p_priv;
+
+        case VLC_CODEC_AV1:
+            if(i_extra == 0 && p_stream->extrabuilder && p_first)
+            {
+                mux_extradata_builder_Feed(p_stream->extrabuilder,
+                                           p_first->p_buffer,
+                                           p_first->i_buffer);
+                i_extra = mux_extradata_builder_Get(p_stream->extrabuilder,
+                                                    &p_extra);
+            }
+            break;
+
+        case VLC_CODEC_VORBIS:
+        case VLC_CODEC_THEORA:
+        case VLC_CODEC_OPUS:
+        {
+            /* Matroska uses the Xiph lacing of VLC, but only the
+             * identification header of Opus */
+            unsigned pi_size[XIPH_MAX_HEADER_COUNT];
+            void *pp_data[XIPH_MAX_HEADER_COUNT];
+            unsigned i_count;
+            if(xiph_SplitHeaders(pi_size, pp_data, &i_count,
+                                 i_extra, p_extra) || i_count == 0)
+                return NULL;
+            if(p_fmt->i_codec == VLC_CODEC_OPUS)
+            {
+                p_extra = pp_data[0];
+                i_extra = pi_size[0];
+                break;
+            }
+            int i_packed;
+            void *p_packed;
+            if(xiph_PackHeaders(&i_packed, &p_packed, pi_size,
+                                (const void **)pp_data, i_count))
+                return NULL;
+            return block_heap_Alloc(p_packed, i_packed);
+        }
+
+        case VLC_CODEC_FLAC:
+            /* Only STREAMINFO is in the format, without the marker */
+            if(i_extra == 34)
+            {
+                p_priv = block_Alloc(8 + i_extra);
+                if(p_priv)
+                {
+                    memcpy(p_priv->p_buffer, "fLaC", 4);
+                    SetDWBE(&p_priv->p_buffer[4], 0x80000000 | i_extra);
+                    memcpy(&p_priv->p_buffer[8], p_extra, i_extra);
+                }
+                return p_priv;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if(i_extra == 0)
+        return NULL;
+    p_priv = block_Alloc(i_extra);
+    if(p_priv)
+        memcpy(p_priv->p_buffer, p_extra, i_extra);
+    return p_priv;
+}
+
+static void AddTrack(sout_mux_t *p_mux, bo_t *bo, sout_input_t *p_input)
+{
+    mkv_stream_t *p_stream = p_input->p_sys;
+    const es_format_t *p_fmt = p_input->p_fmt;
+    const block_t *p_first = block_FifoShow(p_input->p_fifo);
+
+    size_t i_entry = ebml_open(bo, MKV_ID_TRACKENTRY);
+    ebml_add_uint(bo, MKV_ID_TRACKNUMBER, p_stream->i_track);
+    ebml_add_uint(bo, MKV_ID_TRACKUID, p_stream->i_track);
+    ebml_add_uint(bo, MKV_ID_TRACKTYPE,
+                  p_fmt->i_cat == VIDEO_ES ? MKV_TRACK_VIDEO :
+                  p_fmt->i_cat == AUDIO_ES ? MKV_TRACK_AUDIO :
+                                             MKV_TRACK_SUBTITLE);
+    ebml_add_uint(bo, MKV_ID_FLAGLACING, 0);
+    ebml_add_string(bo, MKV_ID_CODECID,
+                    mkv_codecs[p_stream->i_codec].psz_codec_id);
+    if(p_fmt->psz_language && strlen(p_fmt->psz_language) == 3)
+        ebml_add_string(bo, MKV_ID_LANGUAGE, p_fmt->psz_language);
+
+    block_t *p_priv = GetCodecPrivate(p_mux, p_stream, p_fmt, p_first);
+    if(p_priv)
+    {
+        ebml_add_binary(bo, MKV_ID_CODECPRIVATE, p_priv->p_buffer,
+                        p_priv->i_buffer);
+        if(p_fmt->i_codec == VLC_CODEC_OPUS && p_priv->i_buffer >= 12)
+        {
+            /* Pre-skip, always at 48 kHz */
+            ebml_add_uint(bo, MKV_ID_CODECDELAY,
+                          GetWLE(&p_priv->p_buffer[10]) * INT64_C(1000000000)
+                          / 48000);
+            ebml_add_uint(bo, MKV_ID_SEEKPREROLL, INT64_C(80000000));
+        }
+        block_Release(p_priv);
+    }
+
+    if(p_fmt->i_cat == VIDEO_ES)
+    {
+        const video_format_t *p_vfmt = &p_fmt->video;
+        unsigned i_width = p_vfmt->i_visible_width ? p_vfmt->i_visible_width
+                                                   : p_vfmt->i_width;
+        unsigned i_height = p_vfmt->i_visible_height ? p_vfmt->i_visible_height
+                                                     : p_vfmt->i_height;
+
+        if(p_vfmt->i_frame_rate && p_vfmt->i_frame_rate_base)
+            ebml_add_uint(bo, MKV_ID_DEFAULTDURATION,
+                          INT64_C(1000000000) * p_vfmt->i_frame_rate_base
+                          / p_vfmt->i_frame_rate);
+
+        size_t i_video = ebml_open(bo, MKV_ID_VIDEO);
+        ebml_add_uint(bo, MKV_ID_PIXELWIDTH, i_width);
+        ebml_add_uint(bo, MKV_ID_PIXELHEIGHT, i_height);
+        if(p_vfmt->i_sar_num && p_vfmt->i_sar_den &&
+           p_vfmt->i_sar_num != p_vfmt->i_sar_den)
+        {
+            ebml_add_uint(bo, MKV_ID_DISPLAYWIDTH, (uint64_t)i_width *
+                          p_vfmt->i_sar_num / p_vfmt->i_sar_den);
+            ebml_add_uint(bo, MKV_ID_DISPLAYHEIGHT, i_height);
+        }
+        ebml_close(bo, i_video);
+    }
+    else if(p_fmt->i_cat == AUDIO_ES)
+    {
+        unsigned i_bitdepth = mkv_codecs[p_stream->i_codec].i_bitdepth;
+        if(i_bitdepth == 0)
+            i_bitdepth = p_fmt->audio.i_bitspersample;
+
+        size_t i_audio = ebml_open(bo, MKV_ID_AUDIO);
+        ebml_add_float(bo, MKV_ID_SAMPLINGFREQUENCY, p_fmt->audio.i_rate);
+        ebml_add_uint(bo, MKV_ID_CHANNELS, p_fmt->audio.i_channels);
+        if(i_bitdepth)
+            ebml_add_uint(bo, MKV_ID_BITDEPTH, i_bitdepth);
+        ebml_close(bo, i_audio);
+    }
+
+    ebml_close(bo, i_entry);
+}
+
+static int WriteHeader(sout_mux_t *p_mux)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    bo_t bo;
+
+    if(!bo_init(&bo, 4096))
+        return VLC_ENOMEM;
+
+    size_t i_ebml = ebml_open(&bo, EBML_ID_HEADER);
+    ebml_add_uint(&bo, EBML_ID_VERSION, 1);
+    ebml_add_uint(&bo, EBML_ID_READVERSION, 1);
+    ebml_add_uint(&bo, EBML_ID_MAXIDLENGTH, 4);
+    ebml_add_uint(&bo, EBML_ID_MAXSIZELENGTH, 8);
+    ebml_add_string(&bo, EBML_ID_DOCTYPE, p_sys->b_webm ? "webm" : "matroska");
+    ebml_add_uint(&bo, EBML_ID_DOCTYPEVERSION, 4);
+    ebml_add_uint(&bo, EBML_ID_DOCTYPEREADVERSION, 2);
+    ebml_close(&bo, i_ebml);
+
+    /* Unknown size, fixed on closing if the output can seek, so that the
+     * file is valid even if the recording is interrupted */
+    ebml_add_id(&bo, MKV_ID_SEGMENT);
+    p_sys->i_segment_size_pos = bo_size(&bo);
+    bo_add_64be(&bo, UINT64_C(0x01FFFFFFFFFFFFFF));
+    p_sys->i_segment_pos = bo_size(&bo);
+
+    /* Room for the seek head, written once the positions are known */
+    if(p_sys->b_seekable)
+    {
+        p_sys->i_seekhead_pos = bo_size(&bo);
+        ebml_add_void(&bo, MKV_SEEKHEAD_SIZE);
+    }
+    p_sys->i_info_pos = bo_size(&bo) - p_sys->i_segment_pos;
+
+    size_t i_info = ebml_open(&bo, MKV_ID_INFO);
+    ebml_add_uint(&bo, MKV_ID_TIMECODESCALE, 1000000);
+    ebml_add_string(&bo, MKV_ID_MUXINGAPP, "VLC " VERSION);
+    ebml_add_string(&bo, MKV_ID_WRITINGAPP,
+                    "VLC Media Player - " VERSION_MESSAGE);
+    if(p_sys->b_seekable)
+    {
+        ebml_add_float(&bo, MKV_ID_DURATION, 0.);
+        p_sys->i_duration_pos = bo_size(&bo) - 8;
+    }
+    ebml_close(&bo, i_info);
+
+    p_sys->i_tracks_pos = bo_size(&bo) - p_sys->i_segment_pos;
+    size_t i_tracks = ebml_open(&bo, MKV_ID_TRACKS);
+    for(int i = 0; i < p_mux->i_nb_inputs; i++)
+        AddTrack(p_mux, &bo, p_mux->pp_inputs[i]);
+    ebml_close(&bo, i_tracks);
+
+    if(bo.b == NULL)
+        return VLC_ENOMEM;
+
+    if(p_sys->b_seekable)
+    {
+        /* Overwrites the reserved area, whose size does not change */
+        size_t i_size = bo.b->i_buffer;
+        bo.b->i_buffer = p_sys->i_seekhead_pos;
+        AddSeekHead(&bo, p_sys, 0);
+        bo.b->i_buffer = i_size;
+    }
+    bo.b->i_flags |= BLOCK_FLAG_HEADER;
+    Write(p_mux, bo.b);
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Mux:
+ *****************************************************************************/
+static block_t *PrepareBlock(const mkv_stream_t *p_stream, block_t *p_block)
+{
+    switch(mkv_codecs[p_stream->i_codec].i_codec)
+    {
+        case VLC_CODEC_H264:
+        case VLC_CODEC_HEVC:
+            if(p_stream->i_nal_length)
+                p_block = hxxx_AnnexB_to_xVC(p_block, p_stream->i_nal_length);
+            break;
+        case VLC_CODEC_AV1:
+            p_block = AV1_Pack_Sample(p_block);
+            break;
+        case VLC_CODEC_SUBT:
+            /* No trailing '\0' */
+            if(p_block->i_buffer > 0 &&
+               p_block->p_buffer[p_block->i_buffer - 1] == '\0')
+                p_block->i_buffer--;
+            break;
+        default:
+            break;
+    }
+    return p_block;
+}
+
+static int MuxBlock(sout_mux_t *p_mux, sout_input_t *p_input, block_t *p_block)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    mkv_stream_t *p_stream = p_input->p_sys;
+    const int i_cat = p_input->p_fmt->i_cat;
+
+    vlc_tick_t i_time = p_block->i_pts != VLC_TICK_INVALID ? p_block->i_pts
+                                                           : p_block->i_dts;
+    if(i_time == VLC_TICK_INVALID)
+    {
+        block_Release(p_block);
+        return VLC_SUCCESS;
+    }
+
+    p_block = PrepareBlock(p_stream, p_block);
+    if(p_block == NULL)
+        return VLC_SUCCESS;
+
+    const bool b_key = i_cat != VIDEO_ES ||
+                       (p_block->i_flags & BLOCK_FLAG_TYPE_I);
+    const bool b_start = b_key && (p_stream == p_sys->p_ref ||
+                                   (p_sys->p_ref == NULL && i_cat != SPU_ES));
+    int64_t i_time_ms = MS_FROM_VLC_TICK(i_time - p_sys->i_start);
+
+    /* Clusters are cut on the key frames of the main stream, unless the
+     * relative timestamps of the blocks would overflow */
+    if(p_sys->cluster.b == NULL ||
+       i_time_ms - p_sys->i_cluster_time > INT16_MAX ||
+       i_time_ms - p_sys->i_cluster_time < INT16_MIN ||
+       (b_start &&
+        (i_time - p_sys->i_cluster_start >= p_sys->i_cluster_duration ||
+         p_sys->cluster.b->i_buffer >= p_sys->i_cluster_size)))
+    {
+        FlushCluster(p_mux);
+        if(OpenCluster(p_mux, i_time, b_start, p_stream->i_track))
+        {
+            block_Release(p_block);
+            return VLC_ENOMEM;
+        }
+    }
+
+    int64_t i_rel = i_time_ms - p_sys->i_cluster_time;
+    i_rel = VLC_CLIP(i_rel, INT16_MIN, INT16_MAX);
+
+    bo_t *bo = &p_sys->cluster;
+    const size_t i_block = 4 + p_block->i_buffer;
+    if(i_cat == SPU_ES)
+    {
+        /* Subtitles need a duration */
+        const uint64_t i_duration = MS_FROM_VLC_TICK(p_block->i_length);
+        ebml_add_id(bo, MKV_ID_BLOCKGROUP);
+        ebml_add_size(bo, ebml_id_len(MKV_ID_BLOCK) + ebml_size_len(i_block) +
+                          i_block +
+                          ebml_uint_element_len(MKV_ID_BLOCKDURATION,
+                                                i_duration));
+        ebml_add_id(bo, MKV_ID_BLOCK);
+    }
+    else
+        ebml_add_id(bo, MKV_ID_SIMPLEBLOCK);
+    ebml_add_size(bo, i_block);
+    bo_add_8(bo, 0x80 | p_stream->i_track);
+    bo_add_16be(bo, (int16_t)i_rel);
+    bo_add_8(bo, (b_key && i_cat != SPU_ES) ? 0x80 : 0x00);
+    bo_add_mem(bo, p_block->i_buffer, p_block->p_buffer);
+    if(i_cat == SPU_ES)
+        ebml_add_uint(bo, MKV_ID_BLOCKDURATION,
+                      MS_FROM_VLC_TICK(p_block->i_length));
+
+    vlc_tick_t i_end = i_time + __MAX(p_block->i_length, 0);
+    if(p_sys->i_end == VLC_TICK_INVALID || i_end > p_sys->i_end)
+        p_sys->i_end = i_end;
+
+    block_Release(p_block);
+    return bo->b ? VLC_SUCCESS : VLC_ENOMEM;
+}
+
+static int Mux(sout_mux_t *p_mux)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    vlc_tick_t i_dts;
+
+    for(;;)
+    {
+        int i_stream = sout_MuxGetStream(p_mux, 1, &i_dts);
+        if(i_stream < 0)
+            return VLC_SUCCESS;
+
+        if(!p_sys->b_header_sent)
+        {
+            /* The first stream by decoding order gives the time origin */
+            const block_t *p_first =
+                block_FifoShow(p_mux->pp_inputs[i_stream]->p_fifo);
+            p_sys->i_start = i_dts != VLC_TICK_INVALID ? i_dts
+                                                       : p_first->i_pts;
+            if(p_sys->i_start == VLC_TICK_INVALID)
+                p_sys->i_start = VLC_TICK_0;
+
+            if(WriteHeader(p_mux))
+                return VLC_EGENERIC;
+            p_sys->b_header_sent = true;
+        }
+
+        sout_input_t *p_input = p_mux->pp_inputs[i_stream];
+        int i_ret = MuxBlock(p_mux, p_input, block_FifoGet(p_input->p_fifo));
+        if(i_ret != VLC_SUCCESS)
+            return i_ret;
+    }
+}
+
+static void DelStream(sout_mux_t *p_mux, sout_input_t *p_input)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    mkv_stream_t *p_stream = p_input->p_sys;
+
+    msg_Dbg(p_mux, "removing input %u", p_stream->i_track);
+
+    if(p_sys->b_header_sent)
+    {
+        for(;;)
+        {
+            vlc_fifo_Lock(p_input->p_fifo);
+            size_t i_count = vlc_fifo_GetCount(p_input->p_fifo);
+            vlc_fifo_Unlock(p_input->p_fifo);
+            if(i_count == 0)
+                break;
+            MuxBlock(p_mux, p_input, block_FifoGet(p_input->p_fifo));
+        }
+    }
+
+    if(p_sys->p_ref == p_stream)
+        p_sys->p_ref = NULL;
+    if(p_stream->extrabuilder)
+        mux_extradata_builder_Delete(p_stream->extrabuilder);
+    free(p_stream);
+}
@@ -2001,17 +2001,13 @@ bo_t * mp4mux_GetMoov(mp4mux_handle_t *h, vlc_object_t *p_obj, vlc_tick_t i_dura
         bo_t *mvex = box_new("mvex");
         if( mvex )
         {
-            if( i_movie_duration )
+            /* Always present, so that a header written before the duration
+             * is known can later be rewritten in place */
+            bo_t *mehd = box_full_new("mehd", 1, 0);
+            if(mehd)
             {
-                bo_t *mehd = box_full_new("mehd", (h->options & USE64BITEXT) ? 1 : 0, 0);
-                if(mehd)
-                {
-                    if((h->options & USE64BITEXT))
-                        bo_add_64be(mehd, i_movie_duration);
-                    else
-                        bo_add_32be(mehd, i_movie_duration);
-                    box_gather(mvex, mehd);
-                }
+                bo_add_64be(mehd, i_movie_duration);
+                box_gather(mvex, mehd);
             }
 
             for (unsigned int i = 0; mvex && i < vlc_array_count(&h->tracks); i++)
@@ -54,6 +54,24 @@
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
 
+#define FRAGMENTED_TEXT N_("Create fragmented files")
+#define FRAGMENTED_LONGTEXT N_(\
+    "Write the samples as a sequence of movie fragments, each indexed by " \
+    "a segment index box. Such files can be read while they are being " \
+    "recorded and do not need to be rewritten when closed.")
+
+#define EXPDURATION_TEXT N_("Expected duration (s)")
+#define EXPDURATION_LONGTEXT N_(\
+    "Expected duration of the recording, in seconds, used to reserve room " \
+    "for the index ahead of the samples of \"Fast Start\" files. The index " \
+    "is then written there on closing, instead of moving all the samples " \
+    "to make room for it. 0 disables the reservation.")
+
+#define FRAGDURATION_TEXT N_("Fragment duration (ms)")
+#define FRAGDURATION_LONGTEXT N_(\
+    "Target duration of the movie fragments, in milliseconds. Fragments " \
+    "start on a key frame whenever possible.")
+
 static int  Open   (vlc_object_t *);
 static void Close  (vlc_object_t *);
 static void CloseFrag  (vlc_object_t *);
@@ -69,6 +87,13 @@ vlc_module_begin ()
     add_bool(SOUT_CFG_PREFIX "faststart", true,
               FASTSTART_TEXT, FASTSTART_LONGTEXT,
               true)
+    add_integer(SOUT_CFG_PREFIX "expected-duration", 0,
+                EXPDURATION_TEXT, EXPDURATION_LONGTEXT, true)
+    add_bool(SOUT_CFG_PREFIX "fragmented", false,
+              FRAGMENTED_TEXT, FRAGMENTED_LONGTEXT,
+              true)
+    add_integer_with_range(SOUT_CFG_PREFIX "fragment-duration", 1500, 100, 60000,
+                           FRAGDURATION_TEXT, FRAGDURATION_LONGTEXT, true)
     set_capability("sout mux", 5)
     add_shortcut("mp4", "mov", "3gp")
     set_callbacks(Open, Close)
@@ -88,7 +113,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "faststart", NULL
+    "faststart", "expected-duration", "fragmented", "fragment-duration", NULL
 };
 
 static int Control(sout_mux_t *, int, va_list);
@@ -164,6 +189,8 @@ typedef struct
 
     uint64_t i_mdat_pos;
     uint64_t i_pos;
+    uint64_t i_reserved_pos; /* free box reserved for the moov */
+    uint64_t i_reserved_size;
     vlc_tick_t  i_read_duration;
     vlc_tick_t  i_start_dts;
 
@@ -174,6 +201,10 @@ typedef struct
     /* mp4frag */
     vlc_tick_t     i_written_duration;
     uint32_t       i_mfhd_sequence;
+    vlc_tick_t     i_fragment_length;
+    bool           b_mfra; /* absolute offsets, not for streamed content */
+    uint64_t       i_moov_pos;
+    size_t         i_moov_size;
 } sout_mux_sys_t;
 
 static void mp4_stream_Delete(mp4_stream_t *p_stream)
@@ -224,6 +255,43 @@ static block_t *ConvertSUBT(block_t *);
 static bool CreateCurrentEdit(mp4_stream_t *, vlc_tick_t, bool);
 static int MuxStream(sout_mux_t *p_mux, sout_input_t *p_input, mp4_stream_t *p_stream);
 
+/* Upper estimate of the moov size for a given duration. Only the sample
+ * tables grow with it, so this depends on the sample rates and not the
+ * bitrate. Chunk offsets are assumed to be 64 bits, and each sample to
+ * start a new chunk. */
+static uint64_t EstimateMoovSize(sout_mux_t *p_mux, uint64_t i_seconds)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    uint64_t i_size = 4096; /* mvhd, udta */
+
+    for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+    {
+        const es_format_t *p_fmt = mp4mux_track_GetFmt(p_sys->pp_streams[i]->tinfo);
+        uint64_t i_samples = i_seconds;
+        unsigned i_entry_size = 4 /* stsz */ + 8 /* co64 */ + 12 /* stsc */;
+
+        switch (p_fmt->i_cat)
+        {
+            case VIDEO_ES:
+                if (p_fmt->video.i_frame_rate_base)
+                    i_samples = i_samples * p_fmt->video.i_frame_rate /
+                                p_fmt->video.i_frame_rate_base;
+                i_entry_size += 8 /* ctts */ + 4 /* stss */ + 8 /* stts */;
+                break;
+            case AUDIO_ES:
+                i_samples = i_samples * p_fmt->audio.i_rate /
+                            (p_fmt->audio.i_frame_length ? p_fmt->audio.i_frame_length : 1024);
+                break;
+            default:
+                i_entry_size += 8 /* stts */;
+                break;
+        }
+        i_size += 1024 /* trak, sample description */ + (i_samples + 1) * i_entry_size;
+    }
+
+    return i_size;
+}
+
 static int WriteSlowStartHeader(sout_mux_t *p_mux)
 {
     sout_mux_sys_t *p_sys = p_mux->p_sys;
@@ -241,6 +309,27 @@ static int WriteSlowStartHeader(sout_mux_t *p_mux)
         box_send(p_mux, box);
     }
 
+    /* Reserve room for the moov, so that the samples won't need to be moved */
+    int64_t i_seconds = var_GetInteger(p_mux, SOUT_CFG_PREFIX "expected-duration");
+    if (i_seconds > 0 && var_GetBool(p_mux, SOUT_CFG_PREFIX "faststart"))
+    {
+        uint64_t i_size = EstimateMoovSize(p_mux, i_seconds);
+        block_t *p_free = i_size <= UINT32_MAX ? block_Alloc(i_size) : NULL;
+        if (p_free)
+        {
+            memset(p_free->p_buffer, 0, p_free->i_buffer);
+            SetDWBE(p_free->p_buffer, i_size);
+            memcpy(&p_free->p_buffer[4], "free", 4);
+            msg_Dbg(p_mux, "reserving %"PRIu64" bytes for the moov", i_size);
+
+            p_sys->i_reserved_pos = p_sys->i_pos;
+            p_sys->i_reserved_size = i_size;
+            p_sys->i_pos += i_size;
+            p_sys->i_mdat_pos = p_sys->i_pos;
+            sout_AccessOutWrite(p_mux->p_access, p_free);
+        }
+    }
+
     /* Now add mdat header */
     box = box_new("mdat");
     if(!box)
@@ -277,6 +366,8 @@ static int Open(vlc_object_t *p_this)
         if(!strcmp(p_mux->psz_mux, "mp4frag") || !strcmp(p_mux->psz_mux, "mp4stream"))
             options |= FRAGMENTED;
     }
+    if(!(options & QUICKTIME) && var_GetBool(p_mux, SOUT_CFG_PREFIX "fragmented"))
+        options |= FRAGMENTED;
 
     p_sys->b_3gp = p_mux->psz_mux && !strcmp(p_mux->psz_mux, "3gp");
 
@@ -286,12 +377,19 @@ static int Open(vlc_object_t *p_this)
     p_sys->i_nb_streams = 0;
     p_sys->pp_streams   = NULL;
     p_sys->i_mdat_pos   = 0;
+    p_sys->i_reserved_pos = 0;
+    p_sys->i_reserved_size = 0;
     p_sys->b_header_sent = false;
 
     p_sys->i_read_duration   = 0;
     p_sys->i_written_duration= 0;
     p_sys->i_start_dts = VLC_TICK_INVALID;
     p_sys->i_mfhd_sequence = 1;
+    p_sys->i_fragment_length = VLC_TICK_FROM_MS(
+                var_GetInteger(p_mux, SOUT_CFG_PREFIX "fragment-duration"));
+    p_sys->b_mfra = !p_mux->psz_mux || strcmp(p_mux->psz_mux, "mp4stream");
+    p_sys->i_moov_pos = 0;
+    p_sys->i_moov_size = 0;
 
     p_mux->p_sys        = p_sys;
     p_mux->pf_control   = Control;
@@ -320,6 +418,12 @@ static void Close(vlc_object_t *p_this)
     sout_mux_t      *p_mux = (sout_mux_t*)p_this;
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
 
+    if (mp4mux_Is(p_sys->muxh, FRAGMENTED))
+    {
+        CloseFrag(p_this);
+        return;
+    }
+
     msg_Dbg(p_mux, "Close");
 
     /* Update mdat size */
@@ -351,6 +455,31 @@ static void Close(vlc_object_t *p_this)
 
     /* Check we need to create "fast start" files */
     p_sys->b_fast_start = var_GetBool(p_this, SOUT_CFG_PREFIX "faststart");
+
+    /* Use the reserved space if the moov fits, leaving a smaller free box */
+    if (p_sys->b_fast_start && moov && moov->b && p_sys->i_reserved_size)
+    {
+        const uint64_t i_left = p_sys->i_reserved_size - __MIN(p_sys->i_reserved_size, bo_size(moov));
+        if (bo_size(moov) <= p_sys->i_reserved_size && (i_left == 0 || i_left >= 8) &&
+            (i_left == 0 || bo_init(&bo, 8)))
+        {
+            if (i_left)
+            {
+                bo_add_32be  (&bo, i_left);
+                bo_add_fourcc(&bo, "free");
+                sout_AccessOutSeek(p_mux->p_access, p_sys->i_reserved_pos + bo_size(moov));
+                sout_AccessOutWrite(p_mux->p_access, bo.b);
+            }
+            i_moov_pos = p_sys->i_reserved_pos;
+            p_sys->b_fast_start = false;
+        }
+        else
+        {
+            msg_Warn(p_this, "reserved space is too small (%"PRIu64" < %zu), moving data",
+                     p_sys->i_reserved_size, bo_size(moov));
+        }
+    }
+
     while (p_sys->b_fast_start && moov && moov->b)
     {
         /* Move data to the end of the file so we can fit the moov header
@@ -893,8 +1022,6 @@ static void box_send(sout_mux_t *p_mux,  bo_t *box)
 /***************************************************************************
     MP4 Live submodule
 ****************************************************************************/
-#define FRAGMENT_LENGTH  VLC_TICK_FROM_MS(1500)
-
 #define ENQUEUE_ENTRY(object, entry) \
     do {\
         if (object.p_last)\
@@ -1138,12 +1265,13 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
                 i_entry_count--;
                 i_sample++;
 
-                /* Add keyframe entry if needed */
-                if (p_stream->b_hasiframes && (p_entry->p_block->i_flags & BLOCK_FLAG_TYPE_I) &&
-                    (mp4mux_track_GetFmt(p_stream->tinfo)->i_cat == VIDEO_ES ||
-                     mp4mux_track_GetFmt(p_stream->tinfo)->i_cat == AUDIO_ES))
+                /* Add keyframe entry if needed, audio samples all being sync ones */
+                const int i_cat = mp4mux_track_GetFmt(p_stream->tinfo)->i_cat;
+                if ((i_cat == VIDEO_ES || i_cat == AUDIO_ES) &&
+                    (p_stream->b_hasiframes ? (p_entry->p_block->i_flags & BLOCK_FLAG_TYPE_I)
+                                            : i_cat == AUDIO_ES))
                 {
-                    AddKeyframeEntry(p_stream, i_write_pos, i_trak, i_sample, i_time);
+                    AddKeyframeEntry(p_stream, i_write_pos, i_trak + 1, i_sample, i_time);
                 }
 
                 i_time += p_entry->p_block->i_length;
@@ -1222,7 +1350,15 @@ static bo_t *GetMfraBox(sout_mux_t *p_mux)
         mp4_stream_t *p_stream = p_sys->pp_streams[i];
         if (p_stream->i_indexentries)
         {
-            bo_t *tfra = box_full_new("tfra", 0, 0x0);
+            const uint32_t i_timescale = mp4mux_track_GetTimescale(p_stream->tinfo);
+            const mp4_fragindex_t *p_lastentry =
+                    &p_stream->p_indexentries[p_stream->i_indexentries - 1];
+            /* entries are sorted, check if the last one fits in 32 bits */
+            const uint8_t i_version =
+                    (p_lastentry->i_moofoffset > UINT32_MAX ||
+                     samples_from_vlc_tick(p_lastentry->i_time, i_timescale) > UINT32_MAX);
+
+            bo_t *tfra = box_full_new("tfra", i_version, 0x0);
             if (!tfra) continue;
             bo_add_32be(tfra, mp4mux_track_GetID(p_stream->tinfo));
             bo_add_32be(tfra, 0x3); // reserved + lengths (1,1,4)=>(0,0,3)
@@ -1230,8 +1366,17 @@ static bo_t *GetMfraBox(sout_mux_t *p_mux)
             for(uint32_t i_index=0; i_index<p_stream->i_indexentries; i_index++)
             {
                 const mp4_fragindex_t *p_indexentry = &p_stream->p_indexentries[i_index];
-                bo_add_32be(tfra, p_indexentry->i_time);
-                bo_add_32be(tfra, p_indexentry->i_moofoffset);
+                const uint64_t i_time = samples_from_vlc_tick(p_indexentry->i_time, i_timescale);
+                if (i_version)
+                {
+                    bo_add_64be(tfra, i_time);
+                    bo_add_64be(tfra, p_indexentry->i_moofoffset);
+                }
+                else
+                {
+                    bo_add_32be(tfra, i_time);
+                    bo_add_32be(tfra, p_indexentry->i_moofoffset);
+                }
                 assert(sizeof(p_indexentry->i_traf)==1); /* guard against sys changes */
                 assert(sizeof(p_indexentry->i_trun)==1);
                 assert(sizeof(p_indexentry->i_sample)==4);
@@ -1252,6 +1397,46 @@ static bo_t *GetMfraBox(sout_mux_t *p_mux)
     return mfra;
 }
 
+/* Fills a segment index box, with the single reference of the moof and
+ * mdat pair following it. The first video track is referenced, as any
+ * random access point is there, or the first track. */
+#define SIDX_BOXSIZE 52
+static void FillSidxBox(sout_mux_t *p_mux, bo_t *sidx, uint32_t i_referenced_size)
+{
+    sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
+
+    const mp4_stream_t *p_ref = p_sys->pp_streams[0];
+    for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+    {
+        if (mp4mux_track_GetFmt(p_sys->pp_streams[i]->tinfo)->i_cat == VIDEO_ES)
+        {
+            p_ref = p_sys->pp_streams[i];
+            break;
+        }
+    }
+
+    const uint32_t i_timescale = mp4mux_track_GetTimescale(p_ref->tinfo);
+    vlc_tick_t i_duration = 0;
+    for (const mp4_fragentry_t *p_entry = p_ref->towrite.p_first;
+         p_entry; p_entry = p_entry->p_next)
+        i_duration += p_entry->p_block->i_length;
+
+    const block_t *p_first = p_ref->towrite.p_first ? p_ref->towrite.p_first->p_block : NULL;
+    const bool b_sap = p_first && (!p_ref->b_hasiframes ||
+                                   (p_first->i_flags & BLOCK_FLAG_TYPE_I));
+
+    bo_add_32be(sidx, mp4mux_track_GetID(p_ref->tinfo)); // reference ID
+    bo_add_32be(sidx, i_timescale);
+    /* same as the tfdt, no composition offset is used for the first sample */
+    bo_add_64be(sidx, samples_from_vlc_tick(p_ref->i_written_duration, i_timescale));
+    bo_add_64be(sidx, 0); // first offset, the moof follows
+    bo_add_16be(sidx, 0); // reserved
+    bo_add_16be(sidx, 1); // reference count
+    bo_add_32be(sidx, i_referenced_size & 0x7FFFFFFF); // media reference
+    bo_add_32be(sidx, samples_from_vlc_tick(i_duration, i_timescale));
+    bo_add_32be(sidx, b_sap ? 0x90000000 : 0x0); // starts with SAP of type 1
+}
+
 static void FlushHeader(sout_mux_t *p_mux)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
@@ -1265,6 +1450,11 @@ static void FlushHeader(sout_mux_t *p_mux)
         return;
 
     bo_t *moov = mp4mux_GetMoov(p_sys->muxh, VLC_OBJECT(p_mux), 0);
+    if(moov && moov->b)
+    {
+        p_sys->i_moov_pos = p_sys->i_pos + bo_size(ftyp);
+        p_sys->i_moov_size = bo_size(moov);
+    }
 
     /* merge into a single block */
     box_gather(ftyp, moov);
@@ -1276,11 +1466,34 @@ static void FlushHeader(sout_mux_t *p_mux)
     p_sys->b_header_sent = true;
 }
 
+/* Rewrites the header with the final duration. Its size does not change,
+ * so this is a single write, provided the output can seek back. */
+static void UpdateFragmentedHeader(sout_mux_t *p_mux)
+{
+    sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
+
+    vlc_tick_t i_duration = 0;
+    for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+        i_duration = __MAX(i_duration, p_sys->pp_streams[i]->i_written_duration);
+
+    bo_t *moov = mp4mux_GetMoov(p_sys->muxh, VLC_OBJECT(p_mux), i_duration);
+    if(!moov)
+        return;
+
+    if(moov->b && bo_size(moov) == p_sys->i_moov_size &&
+       sout_AccessOutSeek(p_mux->p_access, p_sys->i_moov_pos) >= 0)
+    {
+        msg_Dbg(p_mux, "updating moov @ %"PRIu64, p_sys->i_moov_pos);
+        box_send(p_mux, moov);
+    }
+    else bo_free(moov);
+}
+
 static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
     bo_t *moof = NULL;
-    vlc_tick_t i_barrier_time = p_sys->i_written_duration + FRAGMENT_LENGTH;
+    vlc_tick_t i_barrier_time = p_sys->i_written_duration + p_sys->i_fragment_length;
     size_t i_mdat_size = 0;
     bool b_has_samples = false;
 
@@ -1315,8 +1528,14 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
     if (!p_sys->b_header_sent)
         FlushHeader(p_mux);
 
+    bo_t *sidx = NULL;
     if (b_has_samples)
-        moof = GetMoofBox(p_mux, &i_mdat_size, (b_flush)?0:i_barrier_time, p_sys->i_pos);
+    {
+        /* allocated first, as the index entries need the moof position */
+        sidx = box_full_new("sidx", 1, 0);
+        moof = GetMoofBox(p_mux, &i_mdat_size, (b_flush)?0:i_barrier_time,
+                          p_sys->i_pos + (sidx ? SIDX_BOXSIZE : 0));
+    }
 
     if (moof && i_mdat_size == 0)
     {
@@ -1326,9 +1545,36 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 
     if (moof)
     {
+        if (sidx)
+        {
+            FillSidxBox(p_mux, sidx, bo_size(moof) + 8 + i_mdat_size);
+            assert(bo_size(sidx) == SIDX_BOXSIZE);
+            box_fix(sidx, bo_size(sidx));
+            /* single block, so that segmenters do not split the pair */
+            box_gather(sidx, moof);
+            moof = sidx;
+            sidx = NULL;
+            if (!moof->b)
+            {
+                free(moof);
+                return;
+            }
+            moof->b->i_flags |= BLOCK_FLAG_TYPE_I;
+        }
+
         msg_Dbg(p_mux, "writing moof @ %"PRId64, p_sys->i_pos);
         p_sys->i_pos += bo_size(moof);
         assert(moof->b->i_flags & BLOCK_FLAG_TYPE_I); /* http sout */
+        /* date the fragment start, for segmenting outputs (livehttp) */
+        for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+        {
+            const mp4_stream_t *p_stream = p_sys->pp_streams[i];
+            if (p_stream->towrite.p_first &&
+                p_stream->towrite.p_first->p_block->i_dts != VLC_TICK_INVALID &&
+                (moof->b->i_dts == VLC_TICK_INVALID ||
+                 p_stream->towrite.p_first->p_block->i_dts < moof->b->i_dts))
+                moof->b->i_dts = p_stream->towrite.p_first->p_block->i_dts;
+        }
         box_send(p_mux, moof);
         msg_Dbg(p_mux, "writing mdat @ %"PRId64, p_sys->i_pos);
         WriteFragmentMDAT(p_mux, i_mdat_size);
@@ -1340,6 +1586,8 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
             p_stream->i_last_iframe_time = 0;
         }
     }
+
+    bo_free(sidx);
 }
 
 /* Do an entry length fixup using only its own info.
@@ -1398,7 +1646,7 @@ static void CloseFrag(vlc_object_t *p_this)
 
     /* Write indexes, but only for non streamed content
        as they refer to moof by absolute position */
-    if (!strcmp(p_mux->psz_mux, "mp4frag"))
+    if (p_sys->b_mfra)
     {
         bo_t *mfra = GetMfraBox(p_mux);
         if (mfra)
@@ -1407,14 +1655,17 @@ static void CloseFrag(vlc_object_t *p_this)
             if (mfro)
             {
                 if (mfra->b)
-                {
-                    box_fix(mfra, bo_size(mfra));
                     bo_add_32be(mfro, bo_size(mfra) + MP4_MFRO_BOXSIZE);
-                }
                 box_gather(mfra, mfro);
             }
+            /* mfro is the last child of mfra */
+            if (mfra->b)
+                box_fix(mfra, bo_size(mfra));
             box_send(p_mux, mfra);
         }
+
+        if (p_sys->i_moov_size)
+            UpdateFragmentedHeader(p_mux);
     }
 
     for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
@@ -1468,7 +1719,7 @@ static int MuxFrag(sout_mux_t *p_mux)
         p_stream->p_held_entry = NULL;
 
         if (p_stream->b_hasiframes && (p_heldblock->i_flags & BLOCK_FLAG_TYPE_I) &&
-            mp4mux_track_GetDuration(p_stream->tinfo) - p_sys->i_written_duration < FRAGMENT_LENGTH)
+            mp4mux_track_GetDuration(p_stream->tinfo) - p_sys->i_written_duration < p_sys->i_fragment_length)
         {
             /* Flag the last iframe time, we'll use it as boundary so it will start
                next fragment */
@@ -1521,7 +1772,7 @@ static int MuxFrag(sout_mux_t *p_mux)
     p_sys->i_written_duration = i_min_written_duration;
 
     /* we have prerolled enough to know all streams, and have enough date to create a fragment */
-    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= FRAGMENT_LENGTH)
+    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= p_sys->i_fragment_length)
         WriteFragments(p_mux, false);
 
     return VLC_SUCCESS;
@@ -26,6 +26,12 @@
 # include "config.h"
 #endif
 
+#ifdef CSA_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+
 #include <vlc_common.h>
 
 #include "csa.h"
@@ -131,6 +137,8 @@ int csa_UseKey( vlc_object_t *p_caller, csa_t *c, bool use_odd )
 #ifndef TS_NO_CSA_CK_MSG
         msg_Dbg( p_caller, "using the %s key for scrambling",
                  use_odd ? "odd" : "even" );
+#else
+    VLC_UNUSED(p_caller);
 #endif
     return VLC_SUCCESS;
 }
@@ -610,3 +618,471 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+
+/*****************************************************************************
+ * Bitsliced stream cypher
+ *****************************************************************************
+ * The stream cypher dominates the descrambling cost, and is made of 4-bit
+ * registers and tiny s-boxes. It is run on CSA_BATCH packets at once, with
+ * one machine word per state bit, bit k of each word belonging to packet k.
+ * The block cypher is still applied to each 8-byte block with the tables.
+ *****************************************************************************/
+typedef uint64_t csa_word;
+#define CSA_BATCH 64
+
+typedef struct
+{
+    csa_word A[11][4];
+    csa_word B[11][4];
+    csa_word X[4], Y[4], Z[4];
+    csa_word D[4], E[4], F[4];
+    csa_word p, q, r;
+} csa_bs_t;
+
+/* Truth tables of the s-boxes output bits 0 and 1, indexed by their inputs */
+static const uint32_t sbox_bits[7][2] =
+{
+    { 0x78C6B16C, 0x4B368771 },
+    { 0xE41B4B63, 0x58B98679 },
+    { 0xE41B1BE4, 0x69D25879 },
+    { 0x92AD994B, 0x66B492AD },
+    { 0x35E29E58, 0x9C274CF1 },
+    { 0x66D2E61A, 0x691BB46C },
+    { 0x266D9D92, 0xB38C691E },
+};
+
+static inline csa_word csa_BsMux( csa_word s, csa_word a, csa_word b )
+{
+    return (a & ~s) | (b & s);
+}
+
+/* Evaluates both outputs of an s-box: each group of 4 entries of the truth
+ * tables is one of the 16 functions of the 2 low inputs, and the 3 high
+ * inputs select among them with a tree of multiplexers */
+static inline void csa_BsSbox( const uint32_t t[2], csa_word out[2],
+                               csa_word x4, csa_word x3, csa_word x2,
+                               csa_word x1, csa_word x0 )
+{
+    const csa_word m1 = ~x1 & x0, m2 = x1 & ~x0, m3 = x1 & x0;
+    const csa_word f[16] = {
+        0,   ~(x1 | x0), m1,        ~x1,
+        m2,  ~x0,        x1 ^ x0,   ~m3,
+        m3,  ~(x1 ^ x0), x0,        ~m2,
+        x1,  ~m1,        x1 | x0,   ~(csa_word)0,
+    };
+
+    for( int k = 0; k < 2; k++ )
+    {
+        csa_word v[8];
+
+        for( int i = 0; i < 8; i++ )
+            v[i] = f[(t[k] >> (4 * i)) & 15];
+        for( int i = 0; i < 4; i++ )
+            v[i] = csa_BsMux( x2, v[2 * i], v[2 * i + 1] );
+        for( int i = 0; i < 2; i++ )
+            v[i] = csa_BsMux( x3, v[2 * i], v[2 * i + 1] );
+        out[k] = csa_BsMux( x4, v[0], v[1] );
+    }
+}
+
+static void csa_BsStreamInit( csa_bs_t *s, const uint8_t ck[8] )
+{
+    memset( s, 0, sizeof( *s ) );
+
+    // load first 32 bits of CK into A[1]..A[8]
+    // load last  32 bits of CK into B[1]..B[8]
+    for( int i = 0; i < 4; i++ )
+    {
+        for( int b = 0; b < 4; b++ )
+        {
+            s->A[1+2*i+0][b] = ((ck[i]   >> (4 + b)) & 1) ? ~(csa_word)0 : 0;
+            s->A[1+2*i+1][b] = ((ck[i]   >> b) & 1)       ? ~(csa_word)0 : 0;
+            s->B[1+2*i+0][b] = ((ck[4+i] >> (4 + b)) & 1) ? ~(csa_word)0 : 0;
+            s->B[1+2*i+1][b] = ((ck[4+i] >> b) & 1)       ? ~(csa_word)0 : 0;
+        }
+    }
+}
+
+/* Same as csa_StreamCypher(), with bits b of the bytes i of the input (in
+ * initialization mode) and output in sb[i][b] and cb[i][b] */
+static void csa_BsStreamCypher( csa_bs_t *s, bool b_init,
+                                const csa_word sb[8][8], csa_word cb[8][8] )
+{
+#define A(n, b) s->A[n][b]
+    for( int i = 0; i < 8; i++ )
+    {
+        for( int j = 0; j < 4; j++ )
+        {
+            csa_word s1[2], s2[2], s3[2], s4[2], s5[2], s6[2], s7[2];
+
+            csa_BsSbox( sbox_bits[0], s1, A(4,0), A(1,2), A(6,1), A(7,3), A(9,0) );
+            csa_BsSbox( sbox_bits[1], s2, A(2,1), A(3,2), A(6,3), A(7,0), A(9,1) );
+            csa_BsSbox( sbox_bits[2], s3, A(1,3), A(2,0), A(5,1), A(5,3), A(6,2) );
+            csa_BsSbox( sbox_bits[3], s4, A(3,3), A(1,1), A(2,3), A(4,2), A(8,0) );
+            csa_BsSbox( sbox_bits[4], s5, A(5,2), A(4,3), A(6,0), A(8,1), A(9,2) );
+            csa_BsSbox( sbox_bits[5], s6, A(3,1), A(4,1), A(5,0), A(7,2), A(9,3) );
+            csa_BsSbox( sbox_bits[6], s7, A(2,2), A(3,0), A(7,1), A(8,2), A(8,3) );
+
+            /* use 4x4 xor to produce extra nibble for T3 */
+            csa_word extra_B[4];
+            extra_B[3] = s->B[3][0] ^ s->B[6][1] ^ s->B[7][2] ^ s->B[9][3];
+            extra_B[2] = s->B[6][0] ^ s->B[8][1] ^ s->B[3][3] ^ s->B[4][2];
+            extra_B[1] = s->B[5][3] ^ s->B[8][2] ^ s->B[4][0] ^ s->B[5][1];
+            extra_B[0] = s->B[9][2] ^ s->B[6][3] ^ s->B[3][1] ^ s->B[8][0];
+
+            csa_word next_A1[4], next_B1[4], next_F[4];
+            csa_word carry = s->r;
+
+            for( int b = 0; b < 4; b++ )
+            {
+                // T1, T2: in1 (high nibble) and in2 (low nibble) are only
+                // used during initialisation
+                next_A1[b] = s->A[10][b] ^ s->X[b];
+                next_B1[b] = s->B[7][b] ^ s->B[10][b] ^ s->Y[b];
+                if( b_init )
+                {
+                    next_A1[b] ^= s->D[b] ^ sb[i][(j % 2) ? b : 4 + b];
+                    next_B1[b] ^= sb[i][(j % 2) ? 4 + b : b];
+                }
+
+                // T4 = sum, carry of Z + E + r, if q
+                const csa_word half = s->Z[b] ^ s->E[b];
+                next_F[b] = csa_BsMux( s->q, s->E[b], half ^ carry );
+                carry = (s->Z[b] & s->E[b]) | (carry & half);
+            }
+            s->r = csa_BsMux( s->q, s->r, carry );
+
+            // if p=1, rotate left
+            const csa_word b3 = next_B1[3];
+            next_B1[3] = csa_BsMux( s->p, b3, next_B1[2] );
+            next_B1[2] = csa_BsMux( s->p, next_B1[2], next_B1[1] );
+            next_B1[1] = csa_BsMux( s->p, next_B1[1], next_B1[0] );
+            next_B1[0] = csa_BsMux( s->p, next_B1[0], b3 );
+
+            for( int b = 0; b < 4; b++ )
+            {
+                // T3 = xor all inputs
+                s->D[b] = s->E[b] ^ s->Z[b] ^ extra_B[b];
+                s->E[b] = s->F[b];
+                s->F[b] = next_F[b];
+            }
+
+            memmove( &s->A[2], &s->A[1], 9 * sizeof( s->A[0] ) );
+            memmove( &s->B[2], &s->B[1], 9 * sizeof( s->B[0] ) );
+            memcpy( s->A[1], next_A1, sizeof( next_A1 ) );
+            memcpy( s->B[1], next_B1, sizeof( next_B1 ) );
+
+            s->X[0] = s1[1]; s->X[1] = s2[1]; s->X[2] = s3[0]; s->X[3] = s4[0];
+            s->Y[0] = s3[1]; s->Y[1] = s4[1]; s->Y[2] = s5[0]; s->Y[3] = s6[0];
+            s->Z[0] = s5[1]; s->Z[1] = s6[1]; s->Z[2] = s1[0]; s->Z[3] = s2[0];
+            s->p = s7[1];
+            s->q = s7[0];
+
+            // 2 output bits are a function of the 4 bits of D
+            if( !b_init )
+            {
+                cb[i][7-2*j] = s->D[2] ^ s->D[3];
+                cb[i][6-2*j] = s->D[0] ^ s->D[1];
+            }
+        }
+    }
+#undef A
+}
+
+/* Transposes an 8x8 bits matrix, bit c of byte r going to bit r of byte c */
+static inline uint64_t csa_Transpose8x8( uint64_t x )
+{
+    uint64_t t;
+
+    t = (x ^ (x >> 7)) & UINT64_C(0x00AA00AA00AA00AA);
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & UINT64_C(0x0000CCCC0000CCCC);
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & UINT64_C(0x00000000F0F0F0F0);
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+/* Gathers 8 bytes of each packet into bitsliced form */
+static void csa_BsLoad( csa_word w[8][8], uint8_t *const *pp, int n )
+{
+    memset( w, 0, sizeof( csa_word[8][8] ) );
+    for( int i = 0; i < 8; i++ )
+    {
+        for( int g = 0; g < n; g += 8 )
+        {
+            uint64_t x = 0;
+            for( int k = 0; k < 8 && g + k < n; k++ )
+                x |= (uint64_t)pp[g + k][i] << (8 * k);
+            x = csa_Transpose8x8( x );
+            for( int b = 0; b < 8; b++ )
+                w[i][b] |= (csa_word)((x >> (8 * b)) & 0xff) << g;
+        }
+    }
+}
+
+/* Scatters bitsliced bytes back to 8 bytes per packet */
+static void csa_BsStore( uint8_t (*out)[8], const csa_word w[8][8], int n )
+{
+    for( int i = 0; i < 8; i++ )
+    {
+        for( int g = 0; g < n; g += 8 )
+        {
+            uint64_t x = 0;
+            for( int b = 0; b < 8; b++ )
+                x |= (uint64_t)((w[i][b] >> g) & 0xff) << (8 * b);
+            x = csa_Transpose8x8( x );
+            for( int k = 0; k < 8 && g + k < n; k++ )
+                out[g + k][i] = x >> (8 * k);
+        }
+    }
+}
+
+/* Descrambles up to CSA_BATCH packets using the same key */
+static void csa_DecryptLanes( uint8_t ck[8], uint8_t kk[57],
+                              uint8_t *const *pp_payload, const int *pi_size,
+                              int n )
+{
+    csa_bs_t state;
+    csa_word sb[8][8], cb[8][8];
+    uint8_t ib[CSA_BATCH][8], stream[CSA_BATCH][8], block[8];
+    int i_blocks = 0, i_streams = 0;
+
+    for( int k = 0; k < n; k++ )
+    {
+        const int i_blk = pi_size[k] / 8;
+        const int i_str = i_blk - 1 + ((pi_size[k] % 8) ? 1 : 0);
+
+        i_blocks = __MAX( i_blocks, i_blk );
+        i_streams = __MAX( i_streams, i_str );
+        memcpy( ib[k], pp_payload[k], 8 );
+    }
+
+    /* init csa state */
+    csa_BsStreamInit( &state, ck );
+    csa_BsLoad( sb, pp_payload, n );
+    csa_BsStreamCypher( &state, true, sb, NULL );
+
+    for( int i = 1; i <= i_blocks; i++ )
+    {
+        if( i <= i_streams )
+        {
+            csa_BsStreamCypher( &state, false, NULL, cb );
+            csa_BsStore( stream, cb, n );
+        }
+
+        for( int k = 0; k < n; k++ )
+        {
+            uint8_t *pkt = pp_payload[k];
+            const int i_blk = pi_size[k] / 8;
+            const int i_residue = pi_size[k] % 8;
+
+            if( i > i_blk )
+                continue;
+
+            csa_BlockDecypher( kk, ib[k], block );
+            if( i != i_blk )
+            {
+                for( int j = 0; j < 8; j++ )
+                    ib[k][j] = pkt[8*i+j] ^ stream[k][j];
+            }
+            else
+            {
+                /* last block */
+                memset( ib[k], 0, 8 );
+                for( int j = 0; j < i_residue; j++ )
+                    pkt[8*i+j] ^= stream[k][j];
+            }
+            for( int j = 0; j < 8; j++ )
+                pkt[8*(i-1)+j] = ib[k][j] ^ block[j];
+        }
+    }
+}
+
+/*****************************************************************************
+ * csa_DecryptBatch:
+ *****************************************************************************/
+void csa_DecryptBatch( csa_t *c, uint8_t *const *pp_pkts, int i_pkts,
+                       int i_pkt_size )
+{
+    /* pending packets, per key (even, odd) */
+    uint8_t *pp_payload[2][CSA_BATCH];
+    int      pi_size[2][CSA_BATCH];
+    int      pi_count[2] = { 0, 0 };
+
+    for( int i = 0; i < i_pkts; i++ )
+    {
+        uint8_t *pkt = pp_pkts[i];
+
+        /* transport scrambling control */
+        if( (pkt[3]&0x80) == 0 )
+            continue;
+
+        int i_hdr = 4;
+        if( pkt[3]&0x20 )
+            i_hdr += pkt[4] + 1;
+
+        if( 188 - i_hdr < 8 || i_pkt_size - i_hdr < 8 )
+        {   /* nothing or less than a block to descramble */
+            csa_Decrypt( c, pkt, i_pkt_size );
+            continue;
+        }
+
+        const int odd = (pkt[3]&0x40) ? 1 : 0;
+
+        /* clear transport scrambling control */
+        pkt[3] &= 0x3f;
+
+        pp_payload[odd][pi_count[odd]] = &pkt[i_hdr];
+        pi_size[odd][pi_count[odd]] = i_pkt_size - i_hdr;
+        if( ++pi_count[odd] == CSA_BATCH )
+        {
+            csa_DecryptLanes( odd ? c->o_ck : c->e_ck, odd ? c->o_kk : c->e_kk,
+                              pp_payload[odd], pi_size[odd], CSA_BATCH );
+            pi_count[odd] = 0;
+        }
+    }
+
+    if( pi_count[0] > 0 )
+        csa_DecryptLanes( c->e_ck, c->e_kk, pp_payload[0], pi_size[0],
+                          pi_count[0] );
+    if( pi_count[1] > 0 )
+        csa_DecryptLanes( c->o_ck, c->o_kk, pp_payload[1], pi_size[1],
+                          pi_count[1] );
+}
+
+#ifdef CSA_TEST
+const char vlc_module_name[] = "csa";
+
+static void FillPackets( csa_t *c, uint8_t *pkts, int n, unsigned *seed )
+{
+    for( int i = 0; i < n * 188; i++ )
+    {
+        *seed = *seed * 1103515245 + 12345;
+        pkts[i] = *seed >> 16;
+    }
+
+    for( int i = 0; i < n; i++ )
+    {
+        uint8_t *pkt = &pkts[188 * i];
+        const unsigned r = pkt[1];
+
+        pkt[0] = 0x47;
+        pkt[3] &= 0x1f;
+        if( r & 1 )
+        {   /* adaptation field, up to the whole packet */
+            pkt[3] |= 0x20;
+            pkt[4] = pkt[2] % 184;
+        }
+        if( r & 2 )
+            continue; /* in the clear */
+        csa_UseKey( NULL, c, r & 4 );
+        csa_Encrypt( c, pkt, 188 );
+    }
+}
+
+static double Bench( csa_t *c, uint8_t *pkts, const uint8_t *ref, int n,
+                     bool batch, unsigned loops )
+{
+    uint8_t *pp[n];
+    vlc_tick_t duration = 0;
+
+    for( int i = 0; i < n; i++ )
+        pp[i] = &pkts[188 * i];
+
+    for( unsigned l = 0; l < loops; l++ )
+    {
+        memcpy( pkts, ref, n * 188 );
+
+        vlc_tick_t start = vlc_tick_now();
+        if( batch )
+            csa_DecryptBatch( c, pp, n, 188 );
+        else
+            for( int i = 0; i < n; i++ )
+                csa_Decrypt( c, pp[i], 188 );
+        duration += vlc_tick_now() - start;
+    }
+
+    return (double) loops * n * 188 * 8 * CLOCK_FREQ
+           / __MAX(duration, 1) / 1000000.;
+}
+
+/* Checks the batched descrambler against the per-packet one and the
+ * scrambler, and reports the throughput of both with "bench" as first
+ * argument */
+int main( int argc, char **argv )
+{
+    const bool bench = argc > 1 && !strcmp( argv[1], "bench" );
+    const unsigned loops = argc > 2 ? atoi( argv[2] ) : 20;
+    static const int counts[] = { 1, 7, 63, 64, 65, 128, 300 };
+    char even[] = "0x0123456789abcdef", odd[] = "fedcba9876543210";
+    unsigned seed = 1;
+
+    csa_t *c = csa_New();
+    assert( c != NULL );
+    csa_SetCW( NULL, c, even, false );
+    csa_SetCW( NULL, c, odd, true );
+
+    for( size_t i = 0; i < ARRAY_SIZE(counts); i++ )
+    {
+        const int n = counts[i];
+        uint8_t *clear = malloc( n * 188 );
+        uint8_t *ref = malloc( n * 188 );
+        uint8_t *pkts = malloc( n * 188 );
+        uint8_t *pp[n];
+        assert( clear && ref && pkts );
+
+        seed = n;
+        FillPackets( c, ref, n, &seed );
+        seed = n;
+        /* same packets, without scrambling */
+        for( int j = 0; j < n * 188; j++ )
+        {
+            seed = seed * 1103515245 + 12345;
+            clear[j] = seed >> 16;
+        }
+
+        if( bench )
+        {
+            if( n >= 128 )
+                printf( "%3d packets: per packet %8.1f Mbits/s, "
+                        "batch %8.1f Mbits/s\n", n,
+                        Bench( c, pkts, ref, n, false, loops ),
+                        Bench( c, pkts, ref, n, true, loops ) );
+        }
+        else
+        {
+            fprintf( stderr, "testing: %d packets\n", n );
+            memcpy( pkts, ref, n * 188 );
+            for( int j = 0; j < n; j++ )
+            {
+                pp[j] = &pkts[188 * j];
+                csa_Decrypt( c, pp[j], 188 );
+            }
+            memcpy( ref, pkts, n * 188 );
+
+            FillPackets( c, pkts, n, &(unsigned){ n } );
+            csa_DecryptBatch( c, pp, n, 188 );
+            assert( !memcmp( pkts, ref, n * 188 ) );
+
+            /* descrambled packets match the original payloads */
+            for( int j = 0; j < n; j++ )
+            {
+                const uint8_t *pkt = &pkts[188 * j];
+                const int i_hdr = (pkt[3] & 0x20) ? 5 + pkt[4] : 4;
+
+                assert( (pkt[3] & 0xc0) == 0 );
+                if( 188 - i_hdr >= 8 )
+                    assert( !memcmp( &pkt[i_hdr], &clear[188 * j + i_hdr],
+                                     188 - i_hdr ) );
+            }
+        }
+        free( pkts );
+        free( ref );
+        free( clear );
+    }
+
+    csa_Delete( c );
+    return 0;
+}
+#endif /* CSA_TEST */
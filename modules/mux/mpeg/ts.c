@@ -159,6 +159,11 @@ static const char *const ts_standards_list_text[] =
 #define BMAX_TEXT N_( "Maximum B (deprecated)")
 #define BMAX_LONGTEXT N_( "This setting is deprecated and not used anymore")
 
+#define MUXRATE_TEXT N_("Mux rate (bits/s)")
+#define MUXRATE_LONGTEXT N_("If non zero, the stream is muxed at this " \
+  "constant bitrate, null packets are inserted when there is not enough " \
+  "data to send.")
+
 #define DTS_TEXT N_("DTS delay (ms)")
 #define DTS_LONGTEXT N_("Delay the DTS (decoding time " \
   "stamps) and PTS (presentation timestamps) of the data in the " \
@@ -228,6 +233,8 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "pcr", 70, PCR_TEXT, PCR_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmin", 0, BMIN_TEXT, BMIN_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmax", 0, BMAX_TEXT, BMAX_LONGTEXT, true)
+    add_integer( SOUT_CFG_PREFIX "muxrate", 0, MUXRATE_TEXT, MUXRATE_LONGTEXT, true)
+        change_integer_range( 0, 1000000000 )
     add_integer( SOUT_CFG_PREFIX "dts-delay", 400, DTS_TEXT, DTS_LONGTEXT, true)
 
     add_bool( SOUT_CFG_PREFIX "crypt-audio", true, ACRYPT_TEXT, ACRYPT_LONGTEXT, true)
@@ -247,7 +254,7 @@ static const char *const ppsz_sout_options[] = {
     "standard",
     "pid-video", "pid-audio", "pid-spu", "pid-pmt", "tsid",
     "netid", "sdtdesc",
-    "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
+    "es-id-pid", "shaping", "pcr", "bmin", "bmax", "muxrate", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
     "muxpmt", "program-pmt", "alignment",
     NULL
@@ -371,6 +378,13 @@ typedef struct
     int64_t         i_bitrate_min;
     int64_t         i_bitrate_max;
 
+    /* constant bitrate: packets are sent on a fixed timeline */
+    int64_t         i_muxrate;
+    vlc_tick_t      i_cbr_start;    /* date of the first packet */
+    uint64_t        i_cbr_packets;  /* packets sent, nulls included */
+    uint64_t        i_cbr_nulls;
+    uint64_t        i_cbr_overflow; /* packets sent late */
+
     vlc_tick_t      i_shaping_delay;
     vlc_tick_t      i_pcr_delay;
 
@@ -385,8 +399,17 @@ typedef struct
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
     bool            b_crypt_video;
+
+    /* dated TS packets, scrambled and written by the output thread */
+    block_fifo_t    *p_output;
+    vlc_cond_t      output_wait;
+    bool            b_output_end;
+    vlc_thread_t    output_thread;
 } sout_mux_sys_t;
 
+/* Above that, the muxer waits for the output thread to catch up */
+#define TS_OUTPUT_MAX_BYTES (4 * 1024 * 1024)
+
 
 static int GetNextFreePID( sout_mux_t *p_mux, int i_pid_start )
 {
@@ -481,7 +504,10 @@ static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
-static void TSSetPCR( block_t *p_ts, vlc_tick_t i_dts );
+static void TSDateCBR   ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+                          vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts );
+static void TSSetPCR( block_t *p_ts, int64_t i_pcr );
+static void *OutputThread( void * );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -706,6 +732,11 @@ static int Open( vlc_object_t *p_this )
                  "(if you need them report it)" );
     }
 
+    p_sys->i_muxrate = var_GetInteger( p_mux, SOUT_CFG_PREFIX "muxrate" );
+    p_sys->i_cbr_start = VLC_TICK_INVALID;
+    if( p_sys->i_muxrate > 0 )
+        msg_Dbg( p_mux, "constant bitrate of %"PRId64" bits/s", p_sys->i_muxrate );
+
     var_Get( p_mux, SOUT_CFG_PREFIX "shaping", &val );
     if( val.i_int <= 0 )
     {
@@ -742,6 +773,26 @@ static int Open( vlc_object_t *p_this )
 
     p_mux->p_sys        = p_sys;
 
+    p_sys->p_output = block_FifoNew();
+    if( unlikely(p_sys->p_output == NULL) )
+    {
+        dvbpsi_delete( p_sys->p_dvbpsi );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    vlc_cond_init( &p_sys->output_wait );
+    p_sys->b_output_end = false;
+
+    if( vlc_clone( &p_sys->output_thread, OutputThread, p_mux,
+                   VLC_THREAD_PRIORITY_OUTPUT ) )
+    {
+        vlc_cond_destroy( &p_sys->output_wait );
+        block_FifoRelease( p_sys->p_output );
+        dvbpsi_delete( p_sys->p_dvbpsi );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     p_sys->csa = csaSetup(p_this);
 
     p_mux->pf_control   = Control;
@@ -760,6 +811,22 @@ static void Close( vlc_object_t * p_this )
     sout_mux_t          *p_mux = (sout_mux_t*)p_this;
     sout_mux_sys_t      *p_sys = p_mux->p_sys;
 
+    if( p_sys->i_muxrate > 0 && p_sys->i_cbr_packets > 0 )
+        msg_Dbg( p_mux, "sent %"PRIu64" packets at constant bitrate, "
+                 "%"PRIu64" null packets (%u%% headroom), %"PRIu64" late",
+                 p_sys->i_cbr_packets, p_sys->i_cbr_nulls,
+                 (unsigned)(p_sys->i_cbr_nulls * 100 / p_sys->i_cbr_packets),
+                 p_sys->i_cbr_overflow );
+
+    /* let the output thread write what is left */
+    vlc_fifo_Lock( p_sys->p_output );
+    p_sys->b_output_end = true;
+    vlc_fifo_Signal( p_sys->p_output );
+    vlc_fifo_Unlock( p_sys->p_output );
+    vlc_join( p_sys->output_thread, NULL );
+    vlc_cond_destroy( &p_sys->output_wait );
+    block_FifoRelease( p_sys->p_output );
+
     if( p_sys->p_dvbpsi )
         dvbpsi_delete( p_sys->p_dvbpsi );
 
@@ -1576,7 +1643,10 @@ static bool MuxStreams(sout_mux_t *p_mux )
     }
 
     /* 4: date and send */
-    TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    if( p_sys->i_muxrate > 0 )
+        TSDateCBR( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    else
+        TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
     return false;
 }
 
@@ -1711,6 +1781,19 @@ static block_t *Add_ADTS( block_t *p_data, const es_format_t *p_fmt )
     return p_new_block;
 }
 
+/* Queues dated packets to the output thread */
+static void TSOutput( sout_mux_sys_t *p_sys, sout_buffer_chain_t *p_chain )
+{
+    if( p_chain->p_first == NULL )
+        return;
+
+    vlc_fifo_Lock( p_sys->p_output );
+    while( vlc_fifo_GetBytes( p_sys->p_output ) >= TS_OUTPUT_MAX_BYTES )
+        vlc_fifo_WaitCond( p_sys->p_output, &p_sys->output_wait );
+    vlc_fifo_QueueUnlocked( p_sys->p_output, p_chain->p_first );
+    vlc_fifo_Unlock( p_sys->p_output );
+}
+
 static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                         vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
 {
@@ -1792,6 +1875,9 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    sout_buffer_chain_t chain_out;
+    BufferChainInit( &chain_out );
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
     for (int i = 0; i < i_packet_count; i++ )
     {
@@ -1804,20 +1890,155 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
         {
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
-            TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
+            TSSetPCR( p_ts, TO_SCALE_NZ(p_ts->i_dts - p_sys->first_dts) * 300 );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
+
+        /* latency */
+        p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
+
+        BufferChainAppend( &chain_out, p_ts );
+    }
+
+    TSOutput( p_sys, &chain_out );
+}
+
+/* Converts a number of bits at the mux rate to the given clock, without
+ * overflowing on long sessions */
+static int64_t CBRBitsToClock( const sout_mux_sys_t *p_sys, uint64_t i_bits,
+                               int64_t i_clock )
+{
+    return ( i_bits / p_sys->i_muxrate ) * i_clock +
+           ( i_bits % p_sys->i_muxrate ) * i_clock / p_sys->i_muxrate;
+}
+
+static block_t *TSNewNull( void )
+{
+    block_t *p_ts = block_Alloc( 188 );
+    if( unlikely(p_ts == NULL) )
+        return NULL;
+
+    p_ts->p_buffer[0] = 0x47;
+    p_ts->p_buffer[1] = 0x1f;
+    p_ts->p_buffer[2] = 0xff;
+    p_ts->p_buffer[3] = 0x10;
+    memset( &p_ts->p_buffer[4], 0xff, 184 );
+    return p_ts;
+}
+
+/* Constant bitrate: the packets of the interval are spread over the
+ * slots of a fixed timeline, the free slots are filled with null
+ * packets, and the PCRs are the exact 27MHz time of their slot. */
+static void TSDateCBR( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+                       vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
+{
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+    sout_buffer_chain_t chain_out;
+
+    BufferChainInit( &chain_out );
+
+    if( p_sys->i_cbr_start == VLC_TICK_INVALID )
+        p_sys->i_cbr_start = i_pcr_dts;
+
+    /* slots up to the end of the interval */
+    vlc_tick_t i_end = i_pcr_dts + i_pcr_length - p_sys->i_cbr_start;
+    uint64_t i_slots_end = 0;
+    if( i_end > 0 )
+        i_slots_end = ( ( i_end / CLOCK_FREQ ) * p_sys->i_muxrate +
+                        ( i_end % CLOCK_FREQ ) * p_sys->i_muxrate / CLOCK_FREQ )
+                      / ( 188 * 8 );
+
+    uint64_t i_data = p_chain_ts->i_depth;
+    uint64_t i_slots = i_slots_end > p_sys->i_cbr_packets
+                     ? i_slots_end - p_sys->i_cbr_packets : 0;
+    if( i_data > i_slots )
+    {
+        msg_Warn( p_mux, "mux rate exceeded by %"PRIu64" packets",
+                  i_data - i_slots );
+        p_sys->i_cbr_overflow += i_data - i_slots;
+        i_slots = i_data;
+    }
+
+    const vlc_tick_t i_packet_length = CBRBitsToClock( p_sys, 188 * 8, CLOCK_FREQ );
+    const int64_t i_pcr_offset = samples_from_vlc_tick( p_sys->i_cbr_start -
+                                                        p_sys->first_dts, 27000000 );
+    uint64_t i_sent = 0;
+
+    for( uint64_t i = 0; i < i_slots; i++ )
+    {
+        block_t *p_ts;
+        /* evenly interleave the data with the padding */
+        if( i_sent < i_data &&
+            ( i_sent * i_slots <= i * i_data || i_data - i_sent >= i_slots - i ) )
+        {
+            p_ts = BufferChainGet( p_chain_ts );
+            i_sent++;
+        }
+        else
         {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
+            p_ts = TSNewNull();
+            if( unlikely(p_ts == NULL) )
+                continue;
+            p_sys->i_cbr_nulls++;
         }
 
+        uint64_t i_bits = p_sys->i_cbr_packets * 188 * 8;
+        p_ts->i_dts = p_sys->i_cbr_start + CBRBitsToClock( p_sys, i_bits, CLOCK_FREQ );
+        p_ts->i_length = i_packet_length;
+
+        if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
+            TSSetPCR( p_ts, i_pcr_offset + CBRBitsToClock( p_sys, i_bits, 27000000 ) );
+
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
 
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
+        p_sys->i_cbr_packets++;
+        BufferChainAppend( &chain_out, p_ts );
+    }
+
+    TSOutput( p_sys, &chain_out );
+}
+
+/* Scrambles and writes the dated TS packets, so that neither the
+ * encryption nor a slow access output hold the muxing */
+static void *OutputThread( void *data )
+{
+    sout_mux_t      *p_mux = data;
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+    block_fifo_t    *p_fifo = p_sys->p_output;
+
+    vlc_fifo_Lock( p_fifo );
+    for( ;; )
+    {
+        while( vlc_fifo_IsEmpty( p_fifo ) && !p_sys->b_output_end )
+            vlc_fifo_Wait( p_fifo );
+
+        block_t *p_ts = vlc_fifo_DequeueAllUnlocked( p_fifo );
+        if( p_ts == NULL )
+            break;
+        vlc_cond_signal( &p_sys->output_wait );
+        vlc_fifo_Unlock( p_fifo );
+
+        while( p_ts != NULL )
+        {
+            block_t *p_next = p_ts->p_next;
+            p_ts->p_next = NULL;
+
+            if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
+            {
+                vlc_mutex_lock( &p_sys->csa_lock );
+                csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
+                vlc_mutex_unlock( &p_sys->csa_lock );
+            }
+
+            sout_AccessOutWrite( p_mux->p_access, p_ts );
+            p_ts = p_next;
+        }
+
+        vlc_fifo_Lock( p_fifo );
     }
+    vlc_fifo_Unlock( p_fifo );
+
+    return NULL;
 }
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
@@ -1923,17 +2144,19 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
     return p_ts;
 }
 
-static void TSSetPCR( block_t *p_ts, vlc_tick_t i_dts )
+/* i_pcr is in 27MHz units */
+static void TSSetPCR( block_t *p_ts, int64_t i_pcr )
 {
-    int64_t i_pcr = TO_SCALE_NZ(i_dts);
-
-    p_ts->p_buffer[6]  = ( i_pcr >> 25 )&0xff;
-    p_ts->p_buffer[7]  = ( i_pcr >> 17 )&0xff;
-    p_ts->p_buffer[8]  = ( i_pcr >> 9  )&0xff;
-    p_ts->p_buffer[9]  = ( i_pcr >> 1  )&0xff;
-    p_ts->p_buffer[10] = ( i_pcr << 7  )&0x80;
-    p_ts->p_buffer[10] |= 0x7e;
-    p_ts->p_buffer[11] = 0; /* we don't set PCR extension */
+    int64_t i_base = i_pcr / 300;
+    unsigned i_ext = i_pcr % 300;
+
+    p_ts->p_buffer[6]  = ( i_base >> 25 )&0xff;
+    p_ts->p_buffer[7]  = ( i_base >> 17 )&0xff;
+    p_ts->p_buffer[8]  = ( i_base >> 9  )&0xff;
+    p_ts->p_buffer[9]  = ( i_base >> 1  )&0xff;
+    p_ts->p_buffer[10] = ( i_base << 7  )&0x80;
+    p_ts->p_buffer[10] |= 0x7e | ( i_ext >> 8 );
+    p_ts->p_buffer[11] = i_ext & 0xff;
 }
 
 void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
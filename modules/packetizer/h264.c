@@ -203,6 +203,7 @@ static void ActivateSets( decoder_t *p_dec, const h264_sequence_parameter_set_t
                                       &p_dec->fmt_out.video.i_height,
                                       &p_dec->fmt_out.video.i_visible_width,
                                       &p_dec->fmt_out.video.i_visible_height );
+        p_dec->fmt_out.video.i_dpb_size = h264_get_max_dec_frame_buffering( p_sps );
 
         if( p_sps->vui.i_sar_num != 0 && p_sps->vui.i_sar_den != 0 )
         {
@@ -336,6 +337,7 @@ static int Open( vlc_object_t *p_this )
                      p_h264_startcode, sizeof(p_h264_startcode), startcode_FindAnnexB,
                      p_h264_startcode, 1, 5,
                      PacketizeReset, PacketizeParse, PacketizeValidate, p_dec );
+    p_sys->packetizer.i_au_headroom = HXXX_AU_HEADROOM;
 
     p_sys->b_slice = false;
     p_sys->frame.p_head = NULL;
@@ -874,7 +876,7 @@ static block_t *OutputPicture( decoder_t *p_dec )
     p_sys->leading.p_head = NULL;
     p_sys->leading.pp_append = &p_sys->leading.p_head;
 
-    p_pic = block_ChainGather( p_pic );
+    p_pic = hxxx_ChainGather( p_pic );
 
     if( !p_pic )
     {
@@ -1030,6 +1032,8 @@ static block_t *OutputPicture( decoder_t *p_dec )
         default:
             break;
     }
+    if( p_sys->slice.i_nal_ref_idc == 0 )
+        p_pic->i_flags |= BLOCK_FLAG_NON_REFERENCE;
 
     if( !p_sys->b_recovered )
     {
@@ -1179,8 +1183,9 @@ static bool ParseSeiCallback( const hxxx_sei_data_t *p_sei_data, void *cbdata )
         {
             if( p_sei_data->itu_t35.type == HXXX_ITU_T35_TYPE_CC )
             {
-                cc_storage_append( p_sys->p_ccs, true, p_sei_data->itu_t35.u.cc.p_data,
-                                                       p_sei_data->itu_t35.u.cc.i_data );
+                cc_storage_append( p_sys->p_ccs, true, p_dec->b_cc_wanted,
+                                   p_sei_data->itu_t35.u.cc.p_data,
+                                   p_sei_data->itu_t35.u.cc.i_data );
             }
         } break;
 
@@ -528,7 +528,7 @@ static bool h264_parse_sequence_parameter_set_rbsp( bs_t *p_bs,
             bs_read_ue( p_bs ); /* log2 max mv h */
             bs_read_ue( p_bs ); /* log2 max mv v */
             p_sps->vui.i_max_num_reorder_frames = bs_read_ue( p_bs );
-            bs_read_ue( p_bs ); /* max dec frame buffering */
+            p_sps->vui.i_max_dec_frame_buffering = bs_read_ue( p_bs );
         }
     }
 
@@ -758,6 +758,18 @@ bool h264_get_dpb_values( const h264_sequence_parameter_set_t *p_sps,
     return true;
 }
 
+uint8_t h264_get_max_dec_frame_buffering( const h264_sequence_parameter_set_t *p_sps )
+{
+    uint8_t i_max_dpb_frames = h264_get_max_dpb_frames( p_sps );
+    if( p_sps->vui.b_bitstream_restriction_flag &&
+        p_sps->vui.i_max_dec_frame_buffering < i_max_dpb_frames )
+    {
+        /* A conforming stream may not need more than the level limit */
+        i_max_dpb_frames = __MAX( p_sps->vui.i_max_dec_frame_buffering, 1 );
+    }
+    return i_max_dpb_frames;
+}
+
 bool h264_get_picture_size( const h264_sequence_parameter_set_t *p_sps, unsigned *p_w, unsigned *p_h,
                             unsigned *p_vw, unsigned *p_vh )
 {
@@ -135,6 +135,7 @@ struct h264_sequence_parameter_set_t
         /* restrictions */
         uint8_t b_bitstream_restriction_flag;
         uint8_t i_max_num_reorder_frames;
+        uint8_t i_max_dec_frame_buffering;
     } vui;
 };
 
@@ -183,6 +184,8 @@ uint8_t * h264_avcC_to_AnnexB_NAL( const uint8_t *p_buf, size_t i_buf,
 
 bool h264_get_dpb_values( const h264_sequence_parameter_set_t *,
                           uint8_t *pi_depth, unsigned *pi_delay );
+/* Number of reference frames the decoder needs to keep */
+uint8_t h264_get_max_dec_frame_buffering( const h264_sequence_parameter_set_t * );
 
 bool h264_get_picture_size( const h264_sequence_parameter_set_t *, unsigned *p_w, unsigned *p_h,
                             unsigned *p_vw, unsigned *p_vh );
@@ -214,6 +214,7 @@ static int Open(vlc_object_t *p_this)
                     p_hevc_startcode, sizeof(p_hevc_startcode), startcode_FindAnnexB,
                     p_hevc_startcode, 1, 5,
                     PacketizeReset, PacketizeParse, PacketizeValidate, p_dec);
+    p_sys->packetizer.i_au_headroom = HXXX_AU_HEADROOM;
 
     /* Copy properties */
     es_format_Copy(&p_dec->fmt_out, &p_dec->fmt_in);
@@ -520,28 +521,12 @@ static bool XPSReady(decoder_sys_t *p_sys)
     return false;
 }
 
-static void AppendAsAnnexB(const block_t *p_block,
-                           uint8_t **pp_dst, size_t *pi_dst)
-{
-    if(SIZE_MAX - p_block->i_buffer < *pi_dst )
-        return;
-
-    size_t i_realloc = p_block->i_buffer + *pi_dst;
-    uint8_t *p_realloc = realloc(*pp_dst, i_realloc);
-    if(p_realloc)
-    {
-        memcpy(&p_realloc[*pi_dst], p_block->p_buffer, p_block->i_buffer);
-        *pi_dst = i_realloc;
-        *pp_dst = p_realloc;
-    }
-}
-
 #define APPENDIF(idmax, set, rg, b) \
     for(size_t i=0; i<=idmax; i++)\
     {\
         if(((set != rg[i].p_decoded) == !b) && rg[i].p_nal)\
         {\
-            AppendAsAnnexB(rg[i].p_nal, &p_data, &i_data);\
+            p_nals[i_nals++] = rg[i].p_nal;\
             break;\
         }\
     }
@@ -552,8 +537,8 @@ static void SetsToAnnexB(decoder_sys_t *p_sys,
                          const hevc_video_parameter_set_t *p_vps,
                          uint8_t **pp_out, int *pi_out)
 {
-    uint8_t *p_data = NULL;
-    size_t i_data = 0;
+    const block_t *p_nals[6];
+    size_t i_nals = 0;
 
     APPENDIF(HEVC_VPS_ID_MAX, p_vps, p_sys->rg_vps, true);
     APPENDIF(HEVC_VPS_ID_MAX, p_vps, p_sys->rg_vps, false);
@@ -562,13 +547,26 @@ static void SetsToAnnexB(decoder_sys_t *p_sys,
     APPENDIF(HEVC_PPS_ID_MAX, p_pps, p_sys->rg_pps, true);
     APPENDIF(HEVC_PPS_ID_MAX, p_pps, p_sys->rg_pps, false);
 
+    /* Size first, then copy into a single allocation */
+    size_t i_data = 0;
+    for(size_t i=0; i<i_nals; i++)
+        i_data += p_nals[i]->i_buffer;
+
     /* because we copy to i_extra :/ */
-    if(i_data <= INT_MAX)
+    if(i_data == 0 || i_data > INT_MAX)
+        return;
+
+    uint8_t *p_data = malloc(i_data);
+    if(!p_data)
+        return;
+
+    *pp_out = p_data;
+    *pi_out = i_data;
+    for(size_t i=0; i<i_nals; i++)
     {
-        *pp_out = p_data;
-        *pi_out = i_data;
+        memcpy(p_data, p_nals[i]->p_buffer, p_nals[i]->i_buffer);
+        p_data += p_nals[i]->i_buffer;
     }
-    else free(p_data);
 }
 
 static void ActivateSets(decoder_t *p_dec,
@@ -617,6 +615,7 @@ static void ActivateSets(decoder_t *p_dec,
                 p_dec->fmt_out.video.i_visible_height = sizes[3];
             }
         }
+        p_dec->fmt_out.video.i_dpb_size = hevc_get_max_dec_pic_buffering( p_sps );
 
         if(p_dec->fmt_in.i_profile == -1)
         {
@@ -740,6 +739,14 @@ static block_t *ParseVCL(decoder_t *p_dec, uint8_t i_nal_type, block_t *p_frag)
             break;
         }
 
+        /* Sub-layer non-reference pictures of the highest sub-layer are not
+         * referenced at all */
+        if( i_layer == 0 && i_nal_type <= HEVC_NAL_RSV_VCL_N14 &&
+            !(i_nal_type & 1) && p_sys->p_active_sps &&
+            hevc_getNALTemporalId( p_buffer ) + 1 >=
+                hevc_get_sps_max_sub_layers( p_sys->p_active_sps ) )
+            p_frag->i_flags |= BLOCK_FLAG_NON_REFERENCE;
+
         if(p_sli)
             hevc_rbsp_release_slice_header(p_sli);
     }
@@ -863,7 +870,7 @@ static block_t *GatherAndValidateChain(block_t *p_outputchain)
         if(p_outputchain->i_flags & BLOCK_FLAG_DROP)
             p_output = p_outputchain; /* Avoid useless gather */
         else
-            p_output = block_ChainGather(p_outputchain);
+            p_output = hxxx_ChainGather(p_outputchain);
     }
 
     if(p_output && (p_output->i_flags & BLOCK_FLAG_DROP))
@@ -1013,8 +1020,9 @@ static bool ParseSEICallback( const hxxx_sei_data_t *p_sei_data, void *cbdata )
         {
             if( p_sei_data->itu_t35.type == HXXX_ITU_T35_TYPE_CC )
             {
-                cc_storage_append( p_sys->p_ccs, true, p_sei_data->itu_t35.u.cc.p_data,
-                                                       p_sei_data->itu_t35.u.cc.i_data );
+                cc_storage_append( p_sys->p_ccs, true, p_dec->b_cc_wanted,
+                                   p_sei_data->itu_t35.u.cc.p_data,
+                                   p_sei_data->itu_t35.u.cc.i_data );
             }
         } break;
         case HXXX_SEI_RECOVERY_POINT:
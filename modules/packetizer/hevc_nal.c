@@ -1039,6 +1039,11 @@ uint8_t hevc_get_sps_vps_id( const hevc_sequence_parameter_set_t *p_sps )
     return p_sps->sps_video_parameter_set_id;
 }
 
+uint8_t hevc_get_sps_max_sub_layers( const hevc_sequence_parameter_set_t *p_sps )
+{
+    return p_sps->sps_max_sub_layers_minus1 + 1;
+}
+
 uint8_t hevc_get_pps_sps_id( const hevc_picture_parameter_set_t *p_pps )
 {
     return p_pps->pps_seq_parameter_set_id;
@@ -1097,6 +1102,11 @@ uint8_t hevc_get_max_num_reorder( const hevc_video_parameter_set_t *p_vps )
     return p_vps->vps_max[p_vps->vps_max_sub_layers_minus1/* HighestTid */].num_reorder_pics;
 }
 
+uint8_t hevc_get_max_dec_pic_buffering( const hevc_sequence_parameter_set_t *p_sps )
+{
+    return p_sps->sps_max[p_sps->sps_max_sub_layers_minus1/* HighestTid */].dec_pic_buffering_minus1 + 1;
+}
+
 static inline uint8_t vlc_ceil_log2( uint32_t val )
 {
     uint8_t n = 31 - clz(val);
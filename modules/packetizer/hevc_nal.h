@@ -147,6 +147,12 @@ static inline uint8_t hevc_getNALLayer( const uint8_t *p_buf )
     return ((p_buf[0] & 0x01) << 6) | (p_buf[1] >> 3);
 }
 
+static inline uint8_t hevc_getNALTemporalId( const uint8_t *p_buf )
+{
+    const uint8_t i_tid_plus1 = p_buf[1] & 0x07;
+    return i_tid_plus1 ? i_tid_plus1 - 1 : 0;
+}
+
 /* NAL decoding */
 typedef struct hevc_video_parameter_set_t hevc_video_parameter_set_t;
 typedef struct hevc_sequence_parameter_set_t hevc_sequence_parameter_set_t;
@@ -172,6 +178,7 @@ void hevc_rbsp_release_slice_header( hevc_slice_segment_header_t * );
 
 /* set specific */
 uint8_t hevc_get_sps_vps_id( const hevc_sequence_parameter_set_t * );
+uint8_t hevc_get_sps_max_sub_layers( const hevc_sequence_parameter_set_t * );
 uint8_t hevc_get_pps_sps_id( const hevc_picture_parameter_set_t * );
 uint8_t hevc_get_slice_pps_id( const hevc_slice_segment_header_t * );
 
@@ -193,6 +200,7 @@ bool hevc_get_colorimetry( const hevc_sequence_parameter_set_t *p_sps,
                            video_color_space_t *p_colorspace,
                            video_color_range_t *p_full_range );
 uint8_t hevc_get_max_num_reorder( const hevc_video_parameter_set_t *p_vps );
+uint8_t hevc_get_max_dec_pic_buffering( const hevc_sequence_parameter_set_t *p_sps );
 bool hevc_get_slice_type( const hevc_slice_segment_header_t *, enum hevc_slice_type_e * );
 
 /* Get level and Profile from DecoderConfigurationRecord */
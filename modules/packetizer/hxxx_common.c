@@ -67,8 +67,9 @@ void cc_storage_reset( cc_storage_t *p_ccs )
 }
 
 void cc_storage_append( cc_storage_t *p_ccs, bool b_top_field_first,
-                        const uint8_t *p_buf, size_t i_buf )
+                        bool b_data, const uint8_t *p_buf, size_t i_buf )
 {
+    p_ccs->next.b_channels_only = !b_data;
     cc_Extract( &p_ccs->next, CC_PAYLOAD_GA94, b_top_field_first, p_buf, i_buf );
 }
 
@@ -85,8 +86,16 @@ block_t * cc_storage_get_current( cc_storage_t *p_ccs, decoder_cc_desc_t *p_desc
 {
     block_t *p_block;
 
-    if( !p_ccs->current.b_reorder && p_ccs->current.i_data <= 0 )
+    p_desc->i_608_channels = p_ccs->current.i_608channels;
+    p_desc->i_708_channels = p_ccs->current.i_708channels;
+    p_desc->i_reorder_depth = p_ccs->current.b_reorder ? 4 : -1;
+
+    if( p_ccs->current.b_channels_only ||
+        ( !p_ccs->current.b_reorder && p_ccs->current.i_data <= 0 ) )
+    {
+        cc_Flush( &p_ccs->current );
         return NULL;
+    }
 
     p_block = block_Alloc( p_ccs->current.i_data);
     if( p_block )
@@ -95,10 +104,6 @@ block_t * cc_storage_get_current( cc_storage_t *p_ccs, decoder_cc_desc_t *p_desc
         p_block->i_dts =
         p_block->i_pts = p_ccs->current.b_reorder ? p_ccs->i_pts : p_ccs->i_dts;
         p_block->i_flags = p_ccs->i_flags & BLOCK_FLAG_TYPE_MASK;
-
-        p_desc->i_608_channels = p_ccs->current.i_608channels;
-        p_desc->i_708_channels = p_ccs->current.i_708channels;
-        p_desc->i_reorder_depth = p_ccs->current.b_reorder ? 4 : -1;
     }
     cc_Flush( &p_ccs->current );
 
@@ -198,3 +203,66 @@ block_t *PacketizeXXC1( decoder_t *p_dec, uint8_t i_nal_length_size,
 
     return p_ret;
 }
+
+/****************************************************************************
+ * hxxx_ChainGather: Gathers the NAL units of an access unit into one block
+ * Unlike block_ChainGather, the largest unit (normally the slice data) is
+ * expanded in place whenever its buffer has enough room around it, so that
+ * only the smaller units get copied.
+ ****************************************************************************/
+block_t *hxxx_ChainGather( block_t *p_list )
+{
+    if( p_list->p_next == NULL )
+        return p_list; /* Already gathered */
+
+    block_t *p_max = p_list, **pp_max = &p_list;
+    size_t i_total = 0, i_before = 0;
+    vlc_tick_t i_length = 0;
+
+    for( block_t **pp = &p_list; *pp != NULL; pp = &(*pp)->p_next )
+    {
+        block_t *p = *pp;
+
+        if( p->i_buffer > p_max->i_buffer )
+        {
+            p_max = p;
+            pp_max = pp;
+            i_before = i_total;
+        }
+        i_total += p->i_buffer;
+        i_length += p->i_length;
+    }
+
+    const uint32_t i_flags = p_list->i_flags;
+    const vlc_tick_t i_pts = p_list->i_pts;
+    const vlc_tick_t i_dts = p_list->i_dts;
+    const size_t i_max = p_max->i_buffer;
+
+    /* Split the chain around the largest unit */
+    block_t *p_after = p_max->p_next;
+    block_t *p_before = (p_max != p_list) ? p_list : NULL;
+    *pp_max = NULL;
+    p_max->p_next = NULL;
+
+    /* Falls back to a single allocation of the total size if needed */
+    block_t *g = block_TryRealloc( p_max, i_before, i_total - i_before );
+    if( unlikely(g == NULL) )
+    {
+        block_Release( p_max );
+        block_ChainRelease( p_before );
+        block_ChainRelease( p_after );
+        return NULL;
+    }
+
+    block_ChainExtract( p_before, g->p_buffer, i_before );
+    block_ChainExtract( p_after, &g->p_buffer[i_before + i_max],
+                        i_total - i_before - i_max );
+    block_ChainRelease( p_before );
+    block_ChainRelease( p_after );
+
+    g->i_flags = i_flags;
+    g->i_pts = i_pts;
+    g->i_dts = i_dts;
+    g->i_length = i_length;
+    return g;
+}
@@ -30,7 +30,7 @@ void cc_storage_delete( cc_storage_t *p_ccs );
 
 void cc_storage_reset( cc_storage_t *p_ccs );
 void cc_storage_append( cc_storage_t *p_ccs, bool b_top_field_first,
-                                      const uint8_t *p_buf, size_t i_buf );
+                        bool b_data, const uint8_t *p_buf, size_t i_buf );
 void cc_storage_commit( cc_storage_t *p_ccs, block_t *p_pic );
 
 block_t * cc_storage_get_current( cc_storage_t *p_ccs, decoder_cc_desc_t * );
@@ -40,5 +40,12 @@ block_t * cc_storage_get_current( cc_storage_t *p_ccs, decoder_cc_desc_t * );
 typedef block_t * (*pf_annexb_nal_packetizer)(decoder_t *, bool *, block_t *);
 block_t *PacketizeXXC1( decoder_t *, uint8_t, block_t **, pf_annexb_nal_packetizer );
 
+/* Room reserved in front of slice data for the other NAL units of its
+ * access unit (delimiter, parameter sets, SEI) */
+#define HXXX_AU_HEADROOM 4096
+
+/* Gathers an access unit, avoiding to copy its largest NAL when possible */
+block_t *hxxx_ChainGather( block_t * );
+
 #endif // HXXX_COMMON_H
 
@@ -19,6 +19,17 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 #include <vlc_bits.h>
+#include <vlc_cpu.h>
+
+#if defined(HAVE_SSE2_INTRINSICS)
+   #include <emmintrin.h>
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+   #include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+   #include <arm_neon.h>
+#endif
 
 static inline uint8_t *hxxx_ep3b_to_rbsp( uint8_t *p, uint8_t *end, unsigned *pi_prev, size_t i_count )
 {
@@ -66,6 +77,97 @@ static inline uint8_t * hxxx_ep3b_to_rbsp(const uint8_t *p_src, size_t i_src, si
 }
 #endif
 
+/* Looks up the first position p, from p_start, such that p[-1] == 0x00 and
+ * p[0] == 0x03: only those bytes can be emulation prevention three bytes.
+ * p_start[-1] must be readable. */
+static inline const uint8_t * hxxx_ep3b_find_c( const uint8_t *p, const uint8_t *p_end )
+{
+    for( ; p < p_end; p++ )
+    {
+        if( p[0] == 0x03 && p[-1] == 0x00 )
+            return p;
+    }
+    return NULL;
+}
+
+#if defined(HAVE_SSE2_INTRINSICS)
+__attribute__ ((__target__ ("sse2")))
+static inline const uint8_t * hxxx_ep3b_find_sse2( const uint8_t *p, const uint8_t *p_end )
+{
+    const __m128i zeros = _mm_setzero_si128();
+    const __m128i threes = _mm_set1_epi8( 0x03 );
+
+    for( ; p_end - p >= 16; p += 16 )
+    {
+        __m128i prev = _mm_loadu_si128( (const __m128i *)(p - 1) );
+        __m128i cur = _mm_loadu_si128( (const __m128i *)p );
+        __m128i res = _mm_and_si128( _mm_cmpeq_epi8( prev, zeros ),
+                                     _mm_cmpeq_epi8( cur, threes ) );
+
+        unsigned match = _mm_movemask_epi8( res );
+        if( match )
+            return p + ctz( match );
+    }
+    return hxxx_ep3b_find_c( p, p_end );
+}
+#endif
+
+#if defined(HAVE_AVX2_INTRINSICS)
+__attribute__ ((__target__ ("avx2")))
+static inline const uint8_t * hxxx_ep3b_find_avx2( const uint8_t *p, const uint8_t *p_end )
+{
+    const __m256i zeros = _mm256_setzero_si256();
+    const __m256i threes = _mm256_set1_epi8( 0x03 );
+
+    for( ; p_end - p >= 32; p += 32 )
+    {
+        __m256i prev = _mm256_loadu_si256( (const __m256i *)(p - 1) );
+        __m256i cur = _mm256_loadu_si256( (const __m256i *)p );
+        __m256i res = _mm256_and_si256( _mm256_cmpeq_epi8( prev, zeros ),
+                                        _mm256_cmpeq_epi8( cur, threes ) );
+
+        uint32_t match = _mm256_movemask_epi8( res );
+        if( match )
+            return p + ctz( match );
+    }
+    return hxxx_ep3b_find_c( p, p_end );
+}
+#endif
+
+#if defined(__ARM_NEON)
+static inline const uint8_t * hxxx_ep3b_find_neon( const uint8_t *p, const uint8_t *p_end )
+{
+    const uint8x16_t zeros = vdupq_n_u8( 0x00 );
+    const uint8x16_t threes = vdupq_n_u8( 0x03 );
+
+    for( ; p_end - p >= 16; p += 16 )
+    {
+        uint8x16_t res = vandq_u8( vceqq_u8( vld1q_u8( p - 1 ), zeros ),
+                                   vceqq_u8( vld1q_u8( p ), threes ) );
+
+        uint64x2_t wide = vreinterpretq_u64_u8( res );
+        if( vgetq_lane_u64( wide, 0 ) | vgetq_lane_u64( wide, 1 ) )
+            return hxxx_ep3b_find_c( p, p + 16 );
+    }
+    return hxxx_ep3b_find_c( p, p_end );
+}
+
+    #define hxxx_ep3b_find hxxx_ep3b_find_neon
+#elif defined(HAVE_SSE2_INTRINSICS)
+static inline const uint8_t * hxxx_ep3b_find( const uint8_t *p, const uint8_t *p_end )
+{
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+        return hxxx_ep3b_find_avx2( p, p_end );
+#endif
+    if( vlc_CPU_SSE2() )
+        return hxxx_ep3b_find_sse2( p, p_end );
+    return hxxx_ep3b_find_c( p, p_end );
+}
+#else
+    #define hxxx_ep3b_find hxxx_ep3b_find_c
+#endif
+
 /* vlc_bits's bs_t forward callback for stripping emulation prevention three bytes */
 struct hxxx_bsfw_ep3b_ctx_s
 {
@@ -74,7 +176,7 @@ struct hxxx_bsfw_ep3b_ctx_s
     size_t i_bytesize;
 };
 
-static void hxxx_bsfw_ep3b_ctx_init( struct hxxx_bsfw_ep3b_ctx_s *ctx )
+static inline void hxxx_bsfw_ep3b_ctx_init( struct hxxx_bsfw_ep3b_ctx_s *ctx )
 {
     ctx->i_prev = 0;
     ctx->i_bytepos = 0;
@@ -83,17 +185,40 @@ static void hxxx_bsfw_ep3b_ctx_init( struct hxxx_bsfw_ep3b_ctx_s *ctx )
 
 static size_t hxxx_ep3b_total_size( const uint8_t *p, const uint8_t *p_end )
 {
-    /* compute final size */
+    /* compute final size, with the same semantics as hxxx_ep3b_to_rbsp():
+     * the first byte is never part of the history, and the byte following
+     * an escaped one is never checked */
+    const size_t i_size = p_end - p;
+    size_t i_escaped = 0;
     unsigned i_prev = 0;
-    size_t i = 0;
-    while( p < p_end )
+
+    for( size_t i = 1; i < i_size; )
     {
-        uint8_t *n = hxxx_ep3b_to_rbsp( (uint8_t *)p, (uint8_t *)p_end, &i_prev, 1 );
-        if( n > p )
-            ++i;
-        p = n;
+        /* Bytes before the next candidate can neither be escaped, nor
+         * follow an escaped byte: skip them, and rebuild the history */
+        const uint8_t *c = hxxx_ep3b_find( &p[i], p_end );
+        if( c == NULL )
+            break;
+
+        const size_t i_candidate = c - p;
+        if( i_candidate >= i + 4 )
+        {
+            i = i_candidate - 2;
+            i_prev = ((p[i - 2] == 0) << 1) | (p[i - 1] == 0);
+        }
+
+        for( ; i <= i_candidate && i < i_size; i++ )
+        {
+            i_prev = (i_prev << 1) | (p[i] == 0);
+            if( p[i] == 0x03 && i + 1 != i_size && (i_prev & 0x06) == 0x06 )
+            {
+                i++;
+                i_prev = ((i_prev >> 1) << 1) | (p[i] == 0);
+                i_escaped++;
+            }
+        }
     }
-    return i;
+    return i_size - i_escaped;
 }
 
 static size_t hxxx_bsfw_byte_forward_ep3b( bs_t *s, size_t i_count )
@@ -52,6 +52,11 @@ block_t *hxxx_AnnexB_to_xVC( block_t *p_block, uint8_t i_nal_length_size )
         off_t    move; /* move offset */
     } *p_list = NULL;
 
+    /* The NAL are converted in place */
+    p_block = block_Unshare( p_block );
+    if( unlikely(!p_block) )
+        return NULL;
+
     if(!p_block->i_buffer || p_block->p_buffer[0])
         goto error;
 
@@ -329,7 +329,12 @@ static block_t *GetCc( decoder_t *p_dec, decoder_cc_desc_t *p_desc )
     decoder_sys_t *p_sys = p_dec->p_sys;
     block_t *p_cc;
 
-    if( !p_sys->cc.b_reorder && p_sys->cc.i_data <= 0 )
+    p_desc->i_608_channels = p_sys->cc.i_608channels;
+    p_desc->i_708_channels = p_sys->cc.i_708channels;
+    p_desc->i_reorder_depth = p_sys->cc.b_reorder ? 0 : -1;
+
+    if( p_sys->cc.b_channels_only ||
+        ( !p_sys->cc.b_reorder && p_sys->cc.i_data <= 0 ) )
         return NULL;
 
     p_cc = block_Alloc( p_sys->cc.i_data );
@@ -339,10 +344,6 @@ static block_t *GetCc( decoder_t *p_dec, decoder_cc_desc_t *p_desc )
         p_cc->i_dts = 
         p_cc->i_pts = p_sys->cc.b_reorder ? p_sys->i_cc_pts : p_sys->i_cc_dts;
         p_cc->i_flags = p_sys->i_cc_flags & BLOCK_FLAG_TYPE_MASK;
-
-        p_desc->i_608_channels = p_sys->cc.i_608channels;
-        p_desc->i_708_channels = p_sys->cc.i_708channels;
-        p_desc->i_reorder_depth = p_sys->cc.b_reorder ? 0 : -1;
     }
     cc_Flush( &p_sys->cc );
     return p_cc;
@@ -507,7 +508,7 @@ static block_t *ParseMPEGBlock( decoder_t *p_dec, block_t *p_frag )
             p_pic->i_flags |= BLOCK_FLAG_TYPE_P;
             break;
         case 0x03:
-            p_pic->i_flags |= BLOCK_FLAG_TYPE_B;
+            p_pic->i_flags |= BLOCK_FLAG_TYPE_B | BLOCK_FLAG_NON_REFERENCE;
             break;
         }
 
@@ -844,8 +845,11 @@ static block_t *ParseMPEGBlock( decoder_t *p_dec, block_t *p_frag )
             p_dec->fmt_out.video.multiview_mode = mode;
         }
         else
-        cc_ProbeAndExtract( &p_sys->cc, p_sys->i_top_field_first,
-                    &p_frag->p_buffer[4], p_frag->i_buffer - 4 );
+        {
+            p_sys->cc.b_channels_only = !p_dec->b_cc_wanted;
+            cc_ProbeAndExtract( &p_sys->cc, p_sys->i_top_field_first,
+                        &p_frag->p_buffer[4], p_frag->i_buffer - 4 );
+        }
     }
     else if( startcode == PICTURE_STARTCODE )
     {
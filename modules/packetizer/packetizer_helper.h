@@ -54,6 +54,7 @@ typedef struct
     const uint8_t *p_au_prepend;
 
     unsigned i_au_min_size;
+    size_t i_au_headroom;
 
     void *p_private;
     packetizer_reset_t    pf_reset;
@@ -79,6 +80,7 @@ static inline void packetizer_Init( packetizer_t *p_pack,
     p_pack->i_au_prepend = i_au_prepend;
     p_pack->p_au_prepend = p_au_prepend;
     p_pack->i_au_min_size = i_au_min_size;
+    p_pack->i_au_headroom = 0;
 
     p_pack->i_startcode = i_startcode;
     p_pack->p_startcode = p_startcode;
@@ -182,7 +184,15 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
             /* Get the new fragment and set the pts/dts */
             block_t *p_block_bytestream = p_pack->bytestream.p_block;
 
-            p_pic = block_Alloc( p_pack->i_offset + p_pack->i_au_prepend );
+            /* Leave room in front of large units, so that the parser can
+             * prepend the smaller ones when assembling the frame */
+            size_t i_headroom = 0;
+            if( p_pack->i_offset >= 4 * p_pack->i_au_headroom )
+                i_headroom = p_pack->i_au_headroom;
+
+            p_pic = block_Alloc( i_headroom + p_pack->i_offset + p_pack->i_au_prepend );
+            p_pic->p_buffer += i_headroom;
+            p_pic->i_buffer -= i_headroom;
             p_pic->i_pts = p_block_bytestream->i_pts;
             p_pic->i_dts = p_block_bytestream->i_dts;
 
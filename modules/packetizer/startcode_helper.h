@@ -25,6 +25,12 @@
 #if !defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
    #include <emmintrin.h>
 #endif
+#if defined(HAVE_AVX2_INTRINSICS)
+   #include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+   #include <arm_neon.h>
+#endif
 
 /* Looks up efficiently for an AnnexB startcode 0x00 0x00 0x01
  * by using a 4 times faster trick than single byte lookup. */
@@ -109,6 +115,78 @@ static inline const uint8_t * startcode_FindAnnexB_SSE2( const uint8_t *p, const
 
 #endif
 
+#if defined(HAVE_AVX2_INTRINSICS)
+
+/* Compares every position against 00 00 01 at once, using 3 overlapping
+ * unaligned loads: the first matching position is the lowest mask bit. */
+__attribute__ ((__target__ ("avx2")))
+static inline const uint8_t * startcode_FindAnnexB_AVX2( const uint8_t *p, const uint8_t *end )
+{
+    const __m256i zeros = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8( 0x01 );
+
+    for( ; end - p >= 32 + 2; p += 32 )
+    {
+        __m256i v0 = _mm256_loadu_si256( (const __m256i *)p );
+        __m256i v1 = _mm256_loadu_si256( (const __m256i *)(p + 1) );
+        __m256i v2 = _mm256_loadu_si256( (const __m256i *)(p + 2) );
+        __m256i res = _mm256_and_si256( _mm256_cmpeq_epi8( v0, zeros ),
+                                        _mm256_cmpeq_epi8( v1, zeros ) );
+        res = _mm256_and_si256( res, _mm256_cmpeq_epi8( v2, ones ) );
+
+        uint32_t match = _mm256_movemask_epi8( res );
+        if( match )
+            return p + ctz( match );
+    }
+
+    for( ; end - p >= 3; p++ )
+    {
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    }
+
+    return NULL;
+}
+
+#endif
+
+#if defined(__ARM_NEON)
+
+/* Same method as the AVX2 version. NEON has no byte mask extraction, so
+ * the matching vector is only reduced to find out if any position matched. */
+static inline const uint8_t * startcode_FindAnnexB_NEON( const uint8_t *p, const uint8_t *end )
+{
+    const uint8x16_t zeros = vdupq_n_u8( 0x00 );
+    const uint8x16_t ones = vdupq_n_u8( 0x01 );
+
+    for( ; end - p >= 16 + 2; p += 16 )
+    {
+        uint8x16_t res = vandq_u8( vceqq_u8( vld1q_u8( p ), zeros ),
+                                   vceqq_u8( vld1q_u8( p + 1 ), zeros ) );
+        res = vandq_u8( res, vceqq_u8( vld1q_u8( p + 2 ), ones ) );
+
+        uint64x2_t wide = vreinterpretq_u64_u8( res );
+        if( (vgetq_lane_u64( wide, 0 ) | vgetq_lane_u64( wide, 1 )) == 0 )
+            continue;
+
+        for( ;; p++ )
+        {
+            if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+                return p;
+        }
+    }
+
+    for( ; end - p >= 3; p++ )
+    {
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    }
+
+    return NULL;
+}
+
+#endif
+
 /* That code is adapted from libav's ff_avc_find_startcode_internal
  * and i believe the trick originated from
  * https://graphics.stanford.edu/~seander/bithacks.html#ZeroInWord
@@ -140,9 +218,15 @@ static inline const uint8_t * startcode_FindAnnexB_Bits( const uint8_t *p, const
 }
 #undef TRY_MATCH
 
-#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+#if defined(__ARM_NEON)
+    #define startcode_FindAnnexB startcode_FindAnnexB_NEON
+#elif defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
 static inline const uint8_t * startcode_FindAnnexB( const uint8_t *p, const uint8_t *end )
 {
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (vlc_CPU_AVX2())
+        return startcode_FindAnnexB_AVX2(p, end);
+#endif
     if (vlc_CPU_SSE2())
         return startcode_FindAnnexB_SSE2(p, end);
     else
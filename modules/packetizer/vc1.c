@@ -751,6 +751,7 @@ static block_t *ParseIDU( decoder_t *p_dec, bool *pb_ts_used, block_t *p_frag )
             if( i_data >= sizeof(p_DVB1_user_identifier) &&
                 !memcmp( p_data, p_DVB1_user_identifier, sizeof(p_DVB1_user_identifier) ) )
             {
+                p_sys->cc_next.b_channels_only = !p_dec->b_cc_wanted;
                 cc_ProbeAndExtract( &p_sys->cc_next, true, p_data, i_data );
             }
 
@@ -771,6 +772,16 @@ static block_t *GetCc( decoder_t *p_dec, decoder_cc_desc_t *p_desc )
     decoder_sys_t *p_sys = p_dec->p_sys;
     block_t *p_cc;
 
+    p_desc->i_608_channels = p_sys->cc.i_608channels;
+    p_desc->i_708_channels = p_sys->cc.i_708channels;
+    p_desc->i_reorder_depth = p_sys->cc.b_reorder ? 4 : -1;
+
+    if( p_sys->cc.b_channels_only )
+    {
+        cc_Flush( &p_sys->cc );
+        return NULL;
+    }
+
     p_cc = block_Alloc( p_sys->cc.i_data);
     if( p_cc )
     {
@@ -778,10 +789,6 @@ static block_t *GetCc( decoder_t *p_dec, decoder_cc_desc_t *p_desc )
         p_cc->i_dts =
         p_cc->i_pts = p_sys->cc.b_reorder ? p_sys->i_cc_pts : p_sys->i_cc_dts;
         p_cc->i_flags = p_sys->i_cc_flags & BLOCK_FLAG_TYPE_MASK;
-
-        p_desc->i_608_channels = p_sys->cc.i_608channels;
-        p_desc->i_708_channels = p_sys->cc.i_708channels;
-        p_desc->i_reorder_depth = p_sys->cc.b_reorder ? 4 : -1;
     }
     cc_Flush( &p_sys->cc );
     return p_cc;
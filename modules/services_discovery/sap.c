@@ -74,6 +74,10 @@
 /* Link-local SAP address */
 #define SAP_V4_LINK_ADDRESS     "224.0.0.255"
 #define ADD_SESSION 1
+/* Announces are indexed by source address and message identifier hash */
+#define SAP_HASH_BUCKETS 1024
+/* Maximum packets read from one socket at a time */
+#define SAP_MAX_BURST 64
 
 /*****************************************************************************
  * Module descriptor
@@ -204,6 +208,12 @@ struct sap_announce_t
     uint16_t    i_hash;
     uint32_t    i_source[4];
 
+    /* Index key: the message identifier hash, or a digest of the SDP for
+     * SAPv0 announces without a hash. The SDP text is kept for the latter. */
+    uint32_t    i_id;
+    char        *psz_sdp;
+    sap_announce_t *p_next;
+
     /* SAP annnounces must only contain one SDP */
     sdp_t       *p_sdp;
 
@@ -221,6 +231,7 @@ typedef struct
     /* Table of announces */
     int i_announces;
     struct sap_announce_t **pp_announces;
+    struct sap_announce_t *pp_buckets[SAP_HASH_BUCKETS];
 
     /* Modes */
     bool  b_strict;
@@ -248,7 +259,8 @@ typedef struct
     static int ParseConnection( vlc_object_t *p_obj, sdp_t *p_sdp );
     static int ParseSAP( services_discovery_t *p_sd, const uint8_t *p_buffer, size_t i_read );
     static sdp_t *ParseSDP (vlc_object_t *p_sd, const char *psz_sdp);
-    static sap_announce_t *CreateAnnounce( services_discovery_t *, uint32_t *, uint16_t, sdp_t * );
+    static sap_announce_t *CreateAnnounce( services_discovery_t *, uint32_t *, uint16_t,
+                                           uint32_t, sdp_t * );
     static int RemoveAnnounce( services_discovery_t *p_sd, sap_announce_t *p_announce );
 
 /* Helper functions */
@@ -288,7 +300,7 @@ static int Open( vlc_object_t *p_this )
 {
     services_discovery_t *p_sd = ( services_discovery_t* )p_this;
     services_discovery_sys_t *p_sys  = (services_discovery_sys_t *)
-                                malloc( sizeof( services_discovery_sys_t ) );
+                                calloc( 1, sizeof( services_discovery_sys_t ) );
     if( !p_sys )
         return VLC_ENOMEM;
 
@@ -455,6 +467,7 @@ static void *Run( void *data )
     services_discovery_sys_t *p_sys = p_sd->p_sys;
     char *psz_addr;
     int timeout = -1;
+    vlc_tick_t next_check = 0;
     int canc = vlc_savecancel ();
 
     /* Braindead Winsock DNS resolver will get stuck over 2 seconds per failed
@@ -545,15 +558,24 @@ static void *Run( void *data )
         {
             for (unsigned i = 0; i < n; i++)
             {
-                if (ufd[i].revents)
+                if (!ufd[i].revents)
+                    continue;
+
+                /* Read bursts of announces at once (the socket does not
+                 * block), rather than polling again for each of them. */
+                for (unsigned j = 0; j < SAP_MAX_BURST; j++)
                 {
                     uint8_t p_buffer[MAX_SAP_BUFFER+1];
                     ssize_t i_read;
 
                     i_read = recv (ufd[i].fd, p_buffer, MAX_SAP_BUFFER, 0);
                     if (i_read < 0)
-                        msg_Warn (p_sd, "receive error: %s",
-                                  vlc_strerror_c(errno));
+                    {
+                        if (errno != EAGAIN && errno != EINTR)
+                            msg_Warn (p_sd, "receive error: %s",
+                                      vlc_strerror_c(errno));
+                        break;
+                    }
                     if (i_read > 6)
                     {
                         /* Parse the packet */
@@ -566,6 +588,14 @@ static void *Run( void *data )
 
         vlc_tick_t now = vlc_tick_now();
 
+        /* Announces only expire later when refreshed, so there is no need
+         * to go through all of them again before the computed deadline. */
+        if (now < next_check)
+        {
+            timeout = MS_FROM_VLC_TICK(next_check - now) + 1;
+            continue;
+        }
+
         /* A 1 hour timeout correspond to the RFC Implicit timeout.
          * This timeout is tuned in the following loop. */
         timeout = 1000 * 60 * 60;
@@ -597,6 +627,8 @@ static void *Run( void *data )
             timeout = -1; /* We can safely poll indefinitely. */
         else if( timeout < 200 )
             timeout = 200; /* Don't wakeup too fast. */
+
+        next_check = (timeout >= 0) ? now + VLC_TICK_FROM_MS(timeout) : 0;
     }
     vlc_assert_unreachable ();
 }
@@ -649,6 +681,89 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
  **************************************************************/
 
 /* i_read is at least > 6 */
+static uint32_t SDPDigest( const char *psz_sdp )
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261u;
+
+    while( *psz_sdp )
+        h = ( h ^ (uint8_t)*(psz_sdp++) ) * 16777619u;
+    return h;
+}
+
+static unsigned AnnounceBucket( const uint32_t *i_source, uint32_t i_id )
+{
+    uint32_t h = i_id;
+
+    for( int i = 0; i < 4; i++ )
+        h = ( h ^ i_source[i] ) * 0x9E3779B1u;
+    return ( h >> 16 ) % SAP_HASH_BUCKETS;
+}
+
+static void IndexAnnounce( services_discovery_sys_t *p_sys,
+                           sap_announce_t *p_announce )
+{
+    sap_announce_t **pp = &p_sys->pp_buckets[
+        AnnounceBucket( p_announce->i_source, p_announce->i_id )];
+
+    p_announce->p_next = *pp;
+    *pp = p_announce;
+}
+
+static void UnindexAnnounce( services_discovery_sys_t *p_sys,
+                             sap_announce_t *p_announce )
+{
+    sap_announce_t **pp = &p_sys->pp_buckets[
+        AnnounceBucket( p_announce->i_source, p_announce->i_id )];
+
+    while( *pp != p_announce )
+        pp = &(*pp)->p_next;
+    *pp = p_announce->p_next;
+}
+
+/* Looks an announce up from the same source with the same identifier, and
+ * for SAPv0 announces, with the exact same SDP. */
+static sap_announce_t *FindAnnounce( services_discovery_sys_t *p_sys,
+                                     const uint32_t *i_source, uint16_t i_hash,
+                                     uint32_t i_id, const char *psz_sdp )
+{
+    for( sap_announce_t *p_announce =
+             p_sys->pp_buckets[AnnounceBucket( i_source, i_id )];
+         p_announce != NULL; p_announce = p_announce->p_next )
+    {
+        if( p_announce->i_id == i_id && p_announce->i_hash == i_hash
+         && !memcmp( p_announce->i_source, i_source,
+                     sizeof( p_announce->i_source ) )
+         && ( i_hash || !strcmp( p_announce->psz_sdp, psz_sdp ) ) )
+            return p_announce;
+    }
+    return NULL;
+}
+
+static void RefreshAnnounce( sap_announce_t *p_announce, bool b_need_delete )
+{
+    /* We don't support delete announcement as they can easily
+     * Be used to highjack an announcement by a third party.
+     * Instead we cleverly implement Implicit Announcement removal.
+     *
+     * if( b_need_delete )
+     *    RemoveAnnounce( p_sd, p_announce );
+     * else
+     */
+    if( b_need_delete )
+        return;
+
+    /* No need to go after six, as we start to trust the
+     * average period at six */
+    if( p_announce->i_period_trust <= 5 )
+        p_announce->i_period_trust++;
+
+    /* Compute the average period */
+    vlc_tick_t now = vlc_tick_now();
+    p_announce->i_period = ( p_announce->i_period * (p_announce->i_period_trust-1) + (now - p_announce->i_last) ) / p_announce->i_period_trust;
+    p_announce->i_last = now;
+}
+
 static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
                      size_t len )
 {
@@ -706,6 +821,19 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
     if (buf > end)
         return VLC_EGENERIC;
 
+    /* The message identifier hash changes whenever the SDP does, so a known
+     * announce is refreshed without decompressing nor parsing it again. */
+    if( i_hash )
+    {
+        sap_announce_t *p_announce = FindAnnounce( p_sys, i_source, i_hash,
+                                                   i_hash, NULL );
+        if( p_announce != NULL )
+        {
+            RefreshAnnounce( p_announce, b_need_delete );
+            return VLC_SUCCESS;
+        }
+    }
+
     uint8_t *decomp = NULL;
     if( b_compressed )
     {
@@ -750,6 +878,22 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
         psz_sdp += clen;
     }
 
+    /* Without a hash, SAPv0 announces are recognized by their SDP text */
+    uint32_t i_id = i_hash;
+    if( !i_hash )
+    {
+        i_id = SDPDigest( psz_sdp );
+
+        sap_announce_t *p_announce = FindAnnounce( p_sys, i_source, 0,
+                                                   i_id, psz_sdp );
+        if( p_announce != NULL )
+        {
+            RefreshAnnounce( p_announce, b_need_delete );
+            free (decomp);
+            return VLC_SUCCESS;
+        }
+    }
+
     /* Parse SDP info */
     p_sdp = ParseSDP( VLC_OBJECT(p_sd), psz_sdp );
 
@@ -777,42 +921,32 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
         goto error;
     }
 
-    for( int i = 0 ; i < p_sys->i_announces ; i++ )
+    /* A SAPv0 session whose SDP changed (with a hash, it is a new one) */
+    for( int i = 0 ; !i_hash && i < p_sys->i_announces ; i++ )
     {
         sap_announce_t * p_announce = p_sys->pp_announces[i];
-        /* FIXME: slow */
-        if( ( !i_hash && IsSameSession( p_announce->p_sdp, p_sdp ) )
-            || ( i_hash && p_announce->i_hash == i_hash
-                 && !memcmp(p_announce->i_source, i_source, sizeof(i_source)) ) )
+
+        if( !p_announce->i_hash && IsSameSession( p_announce->p_sdp, p_sdp ) )
         {
-            /* We don't support delete announcement as they can easily
-             * Be used to highjack an announcement by a third party.
-             * Instead we cleverly implement Implicit Announcement removal.
-             *
-             * if( b_need_delete )
-             *    RemoveAnnounce( p_sd, p_sys->pp_announces[i]);
-             * else
-             */
-
-            if( !b_need_delete )
+            char *psz_copy = strdup( psz_sdp );
+            if( likely(psz_copy != NULL) )
             {
-                /* No need to go after six, as we start to trust the
-                 * average period at six */
-                if( p_announce->i_period_trust <= 5 )
-                    p_announce->i_period_trust++;
-
-                /* Compute the average period */
-                vlc_tick_t now = vlc_tick_now();
-                p_announce->i_period = ( p_announce->i_period * (p_announce->i_period_trust-1) + (now - p_announce->i_last) ) / p_announce->i_period_trust;
-                p_announce->i_last = now;
+                /* Recognize the new SDP text from now on */
+                UnindexAnnounce( p_sys, p_announce );
+                free( p_announce->psz_sdp );
+                p_announce->psz_sdp = psz_copy;
+                p_announce->i_id = i_id;
+                IndexAnnounce( p_sys, p_announce );
             }
+            RefreshAnnounce( p_announce, b_need_delete );
             FreeSDP( p_sdp );
             free (decomp);
             return VLC_SUCCESS;
         }
     }
 
-    CreateAnnounce( p_sd, i_source, i_hash, p_sdp );
+    if( CreateAnnounce( p_sd, i_source, i_hash, i_id, p_sdp ) == NULL )
+        FreeSDP( p_sdp );
 
     free (decomp);
     return VLC_SUCCESS;
@@ -822,7 +956,7 @@ error:
 }
 
 sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint32_t *i_source, uint16_t i_hash,
-                                sdp_t *p_sdp )
+                                uint32_t i_id, sdp_t *p_sdp )
 {
     input_item_t *p_input;
     const char *psz_value;
@@ -839,6 +973,17 @@ sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint32_t *i_source,
     p_sap->i_period_trust = 0;
     p_sap->i_hash = i_hash;
     memcpy (p_sap->i_source, i_source, sizeof(p_sap->i_source));
+    p_sap->i_id = i_id;
+    p_sap->psz_sdp = NULL;
+    if( !i_hash )
+    {
+        p_sap->psz_sdp = strdup( p_sdp->psz_sdp );
+        if( unlikely(p_sap->psz_sdp == NULL) )
+        {
+            free( p_sap );
+            return NULL;
+        }
+    }
     p_sap->p_sdp = p_sdp;
 
     /* Released in RemoveAnnounce */
@@ -846,6 +991,7 @@ sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint32_t *i_source,
                                     INPUT_DURATION_INDEFINITE );
     if( unlikely(p_input == NULL) )
     {
+        free( p_sap->psz_sdp );
         free( p_sap );
         return NULL;
     }
@@ -902,6 +1048,7 @@ sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint32_t *i_source,
     }
 
     TAB_APPEND( p_sys->i_announces, p_sys->pp_announces, p_sap );
+    IndexAnnounce( p_sys, p_sap );
 
     return p_sap;
 }
@@ -1579,6 +1726,8 @@ static int RemoveAnnounce( services_discovery_t *p_sd,
 
     services_discovery_sys_t *p_sys = p_sd->p_sys;
     TAB_REMOVE(p_sys->i_announces, p_sys->pp_announces, p_announce);
+    UnindexAnnounce( p_sys, p_announce );
+    free( p_announce->psz_sdp );
     free( p_announce );
 
     return VLC_SUCCESS;
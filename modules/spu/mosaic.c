@@ -54,6 +54,14 @@ static int MosaicCallback   ( vlc_object_t *, char const *, vlc_value_t,
 /*****************************************************************************
  * filter_sys_t : filter descriptor
  *****************************************************************************/
+typedef struct
+{
+    picture_t *p_source;      /* Bridged picture, held */
+    picture_t *p_converted;   /* Scaled and converted source picture */
+    vlc_fourcc_t i_chroma;
+    unsigned i_width, i_height;
+} mosaic_tile_t;
+
 typedef struct
 {
     vlc_mutex_t lock;         /* Internal filter lock */
@@ -78,8 +86,20 @@ typedef struct
     int i_offsets_length;
 
     vlc_tick_t i_delay;
+
+    mosaic_tile_t *p_tiles;   /* Conversion cache, per bridged stream */
+    int i_tiles;
 } filter_sys_t;
 
+static void mosaic_TileClean( mosaic_tile_t *p_tile )
+{
+    if( p_tile->p_source != NULL )
+        picture_Release( p_tile->p_source );
+    if( p_tile->p_converted != NULL )
+        picture_Release( p_tile->p_converted );
+    p_tile->p_source = p_tile->p_converted = NULL;
+}
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -367,6 +387,9 @@ static int CreateFilter( vlc_object_t *p_this )
     free( psz_offsets );
     var_AddCallback( p_filter, CFG_PREFIX "offsets", MosaicCallback, p_sys );
 
+    p_sys->p_tiles = NULL;
+    p_sys->i_tiles = 0;
+
     vlc_mutex_unlock( &p_sys->lock );
 
     return VLC_SUCCESS;
@@ -421,6 +444,10 @@ static void DestroyFilter( vlc_object_t *p_this )
         p_sys->i_offsets_length = 0;
     }
 
+    for( int i_index = 0; i_index < p_sys->i_tiles; i_index++ )
+        mosaic_TileClean( &p_sys->p_tiles[i_index] );
+    free( p_sys->p_tiles );
+
     vlc_mutex_destroy( &p_sys->lock );
     free( p_sys );
 }
@@ -519,16 +546,37 @@ static subpicture_t *Filter( filter_t *p_filter, vlc_tick_t date )
     row_inner_height = ( ( p_sys->i_height - ( p_sys->i_rows - 1 )
                        * p_sys->i_borderh ) / p_sys->i_rows );
 
+    if( p_sys->i_tiles < p_bridge->i_es_num )
+    {
+        mosaic_tile_t *p_tiles = realloc( p_sys->p_tiles,
+                                 p_bridge->i_es_num * sizeof( *p_tiles ) );
+        if( p_tiles == NULL )
+        {
+            subpicture_Delete( p_spu );
+            vlc_global_unlock( VLC_MOSAIC_MUTEX );
+            vlc_mutex_unlock( &p_sys->lock );
+            return NULL;
+        }
+        memset( &p_tiles[p_sys->i_tiles], 0,
+                (p_bridge->i_es_num - p_sys->i_tiles) * sizeof( *p_tiles ) );
+        p_sys->p_tiles = p_tiles;
+        p_sys->i_tiles = p_bridge->i_es_num;
+    }
+
     i_real_index = 0;
 
     for( int i_index = 0; i_index < p_bridge->i_es_num; i_index++ )
     {
         bridged_es_t *p_es = p_bridge->pp_es[i_index];
+        mosaic_tile_t *p_tile = &p_sys->p_tiles[i_index];
         video_format_t fmt_in, fmt_out;
         picture_t *p_converted;
 
         if ( p_es->b_empty )
+        {
+            mosaic_TileClean( p_tile );
             continue;
+        }
 
         while ( p_es->p_picture != NULL
                  && p_es->p_picture->date + p_sys->i_delay < date )
@@ -558,7 +606,10 @@ static subpicture_t *Filter( filter_t *p_filter, vlc_tick_t date )
         }
 
         if ( p_es->p_picture == NULL )
+        {
+            mosaic_TileClean( p_tile );
             continue;
+        }
 
         if ( p_sys->i_order_length == 0 )
         {
@@ -618,15 +669,33 @@ static subpicture_t *Filter( filter_t *p_filter, vlc_tick_t date )
             fmt_out.i_visible_width = fmt_out.i_width;
             fmt_out.i_visible_height = fmt_out.i_height;
 
-            p_converted = image_Convert( p_sys->p_image, p_es->p_picture,
-                                         &fmt_in, &fmt_out );
-            if( !p_converted )
+            /* A source picture is shown until the next one is bridged, or
+             * until it is too late: only convert it once. */
+            if( p_tile->p_source == p_es->p_picture
+             && p_tile->i_chroma == fmt_out.i_chroma
+             && p_tile->i_width == fmt_out.i_width
+             && p_tile->i_height == fmt_out.i_height )
+            {
+                p_converted = picture_Hold( p_tile->p_converted );
+            }
+            else
             {
-                msg_Warn( p_filter,
-                           "image resizing and chroma conversion failed" );
-                video_format_Clean( &fmt_in );
-                video_format_Clean( &fmt_out );
-                continue;
+                mosaic_TileClean( p_tile );
+                p_converted = image_Convert( p_sys->p_image, p_es->p_picture,
+                                             &fmt_in, &fmt_out );
+                if( !p_converted )
+                {
+                    msg_Warn( p_filter,
+                               "image resizing and chroma conversion failed" );
+                    video_format_Clean( &fmt_in );
+                    video_format_Clean( &fmt_out );
+                    continue;
+                }
+                p_tile->p_source = picture_Hold( p_es->p_picture );
+                p_tile->p_converted = picture_Hold( p_converted );
+                p_tile->i_chroma = fmt_out.i_chroma;
+                p_tile->i_width = fmt_out.i_width;
+                p_tile->i_height = fmt_out.i_height;
             }
         }
         else
@@ -639,10 +708,9 @@ static subpicture_t *Filter( filter_t *p_filter, vlc_tick_t date )
             fmt_out.i_visible_height = fmt_out.i_height;
         }
 
-        p_region = subpicture_region_New( &fmt_out );
-        /* FIXME the copy is probably not needed anymore */
-        if( p_region )
-            picture_Copy( p_region->p_picture, p_converted );
+        /* The region shares the picture: neither the bridge nor the cache
+         * modify a picture once it is queued. */
+        p_region = subpicture_region_ForPicture( &fmt_out, p_converted );
         if( !p_sys->b_keep )
             picture_Release( p_converted );
 
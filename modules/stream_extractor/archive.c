@@ -76,7 +76,16 @@ struct private_sys_t
 
     uint64_t i_offset;
 
-    uint8_t buffer[ 8192 ];
+    /* pending data block from libarchive */
+    const uint8_t* p_block;
+    size_t i_block;
+    uint64_t i_hole;
+
+    /* stored entry, read straight from the source */
+    bool b_direct;
+    uint64_t i_direct_start;
+
+    uint8_t buffer[ 65536 ];
     bool b_seekable_source;
     bool b_seekable_archive;
 
@@ -398,6 +407,8 @@ static int archive_extractor_reset( stream_extractor_t* p_extractor )
     }
 
     p_sys->i_offset = 0;
+    p_sys->i_block = 0;
+    p_sys->i_hole = 0;
     p_sys->b_eof = false;
     p_sys->b_dead = false;
     return VLC_SUCCESS;
@@ -495,6 +506,9 @@ static int Control( stream_extractor_t* p_extractor, int i_query, va_list args )
     switch( i_query )
     {
         case STREAM_CAN_FASTSEEK:
+            if( p_sys->b_direct )
+                return vlc_stream_vaControl( p_extractor->source, i_query,
+                                             args );
             *va_arg( args, bool* ) = false;
             break;
 
@@ -560,42 +574,184 @@ static int ReadDir( stream_directory_t* p_directory, input_item_node_t* p_node )
     return archive_status == ARCHIVE_EOF ? VLC_SUCCESS : VLC_EGENERIC;
 }
 
-static ssize_t Read( stream_extractor_t *p_extractor, void* p_data, size_t i_size )
+static int archive_fetch_block( stream_extractor_t* p_extractor )
 {
-    char dummy_buffer[ 8192 ];
-
     private_sys_t* p_sys = p_extractor->p_sys;
     libarchive_t* p_arc = p_sys->p_archive;
-    ssize_t       i_ret;
-
-    if( p_sys->b_dead || p_sys->p_entry == NULL )
-        return 0;
-
-    if( p_sys->b_eof )
-        return 0;
 
-    i_ret = archive_read_data( p_arc,
-      p_data ? p_data :                        dummy_buffer,
-      p_data ? i_size : __MIN( i_size, sizeof( dummy_buffer ) ) );
+    const void* p_data;
+    size_t i_size;
+    la_int64_t i_block_offset;
 
+    int i_ret = archive_read_data_block( p_arc, &p_data, &i_size,
+                                         &i_block_offset );
     switch( i_ret )
     {
+        case ARCHIVE_OK:
+            break;
+
+        case ARCHIVE_EOF:
+            return ARCHIVE_EOF;
+
         case ARCHIVE_RETRY:
         case ARCHIVE_FAILED:
             msg_Dbg( p_extractor, "libarchive: %s", archive_error_string( p_arc ) );
-            goto eof;
+            return ARCHIVE_EOF;
 
         case ARCHIVE_WARN:
             msg_Warn( p_extractor, "libarchive: %s", archive_error_string( p_arc ) );
-            goto eof;
+            return ARCHIVE_EOF;
 
-        case ARCHIVE_FATAL:
+        default:
             msg_Err( p_extractor, "libarchive: %s", archive_error_string( p_arc ) );
-            goto fatal_error;
+            return ARCHIVE_FATAL;
     }
 
-    p_sys->i_offset += i_ret;
-    return i_ret;
+    /* blocks of sparse entries are separated by holes */
+    if( i_block_offset >= 0 && (uint64_t)i_block_offset > p_sys->i_offset )
+        p_sys->i_hole = i_block_offset - p_sys->i_offset;
+
+    p_sys->p_block = p_data;
+    p_sys->i_block = i_size;
+    return ARCHIVE_OK;
+}
+
+/**
+ * Checks whether the entry is stored as is, and in one piece, in the source
+ * stream. If so, it is read and seeked in the source directly, rather than
+ * through libarchive.
+ */
+static void archive_probe_direct( stream_extractor_t* p_extractor )
+{
+    private_sys_t* p_sys = p_extractor->p_sys;
+    libarchive_t* p_arc = p_sys->p_archive;
+    struct archive_entry* p_entry = p_sys->p_entry;
+    stream_t* source = p_extractor->source;
+
+    if( !p_sys->b_seekable_source || p_sys->i_callback_data != 1 )
+        return;
+
+    /* the archive itself must not be compressed */
+    if( archive_filter_count( p_arc ) != 1
+     || archive_filter_code( p_arc, 0 ) != ARCHIVE_FILTER_NONE )
+        return;
+
+    switch( archive_format( p_arc ) & ARCHIVE_FORMAT_BASE_MASK )
+    {
+        case ARCHIVE_FORMAT_TAR:
+        case ARCHIVE_FORMAT_ZIP:
+        case ARCHIVE_FORMAT_RAR:
+            break;
+        default: /* entries may be split or interleaved */
+            return;
+    }
+
+    if( !archive_entry_size_is_set( p_entry )
+     || archive_entry_size( p_entry ) <= 0
+     || archive_entry_sparse_count( p_entry ) > 0
+#if ARCHIVE_VERSION_NUMBER >= 3002000
+     || archive_entry_is_encrypted( p_entry )
+#endif
+      )
+        return;
+
+    /* the data starts where libarchive stopped reading the entry header */
+    uint64_t i_start = archive_filter_bytes( p_arc, 0 );
+    uint64_t i_size = archive_entry_size( p_entry );
+    uint64_t i_source_size;
+
+    if( vlc_stream_GetSize( source, &i_source_size )
+     || i_start + i_size > i_source_size )
+        return;
+
+    if( archive_fetch_block( p_extractor ) != ARCHIVE_OK )
+        return;
+    if( p_sys->i_hole > 0 || p_sys->i_block == 0 )
+        return;
+
+    /* compare the first bytes with the source, in case the entry is
+     * compressed or the header had trailing data */
+    uint8_t cmp[ 4096 ];
+    size_t i_cmp = __MIN( p_sys->i_block, sizeof( cmp ) );
+    uint64_t i_pos = vlc_stream_Tell( source );
+
+    bool b_direct = vlc_stream_Seek( source, i_start ) == VLC_SUCCESS
+        && vlc_stream_Read( source, cmp, i_cmp ) == (ssize_t)i_cmp
+        && memcmp( cmp, p_sys->p_block, i_cmp ) == 0
+        && vlc_stream_Seek( source, i_start ) == VLC_SUCCESS;
+
+    if( !b_direct )
+    {   /* keep going with libarchive where it left off */
+        if( vlc_stream_Seek( source, i_pos ) )
+            p_sys->b_dead = true;
+        return;
+    }
+
+    msg_Dbg( p_extractor, "entry is stored at offset %"PRIu64", "
+             "reading it directly", i_start );
+    p_sys->b_direct = true;
+    p_sys->i_direct_start = i_start;
+    p_sys->i_block = 0;
+}
+
+static ssize_t Read( stream_extractor_t *p_extractor, void* p_data, size_t i_size )
+{
+    private_sys_t* p_sys = p_extractor->p_sys;
+
+    if( p_sys->b_dead || p_sys->p_entry == NULL )
+        return 0;
+
+    if( p_sys->b_eof )
+        return 0;
+
+    if( p_sys->b_direct )
+    {
+        uint64_t i_entry_size = archive_entry_size( p_sys->p_entry );
+
+        if( p_sys->i_offset >= i_entry_size )
+            return 0;
+        if( i_size > i_entry_size - p_sys->i_offset )
+            i_size = i_entry_size - p_sys->i_offset;
+
+        ssize_t i_ret = vlc_stream_Read( p_extractor->source, p_data, i_size );
+        if( i_ret > 0 )
+            p_sys->i_offset += i_ret;
+        return i_ret;
+    }
+
+    if( p_sys->i_block == 0 && p_sys->i_hole == 0 )
+    {
+        switch( archive_fetch_block( p_extractor ) )
+        {
+            case ARCHIVE_OK:
+                break;
+            case ARCHIVE_EOF:
+                goto eof;
+            default:
+                goto fatal_error;
+        }
+    }
+
+    if( p_sys->i_hole > 0 )
+    {
+        if( i_size > p_sys->i_hole )
+            i_size = p_sys->i_hole;
+        if( p_data )
+            memset( p_data, 0, i_size );
+        p_sys->i_hole -= i_size;
+    }
+    else
+    {
+        if( i_size > p_sys->i_block )
+            i_size = p_sys->i_block;
+        if( p_data )
+            memcpy( p_data, p_sys->p_block, i_size );
+        p_sys->p_block += i_size;
+        p_sys->i_block -= i_size;
+    }
+
+    p_sys->i_offset += i_size;
+    return i_size;
 
 fatal_error:
     p_sys->b_dead = true;
@@ -636,6 +792,16 @@ static int Seek( stream_extractor_t* p_extractor, uint64_t i_req )
 
     p_sys->b_eof = false;
 
+    if( p_sys->b_direct )
+    {
+        if( vlc_stream_Seek( p_extractor->source,
+                             p_sys->i_direct_start + i_req ) )
+            return VLC_EGENERIC;
+
+        p_sys->i_offset = i_req;
+        return VLC_SUCCESS;
+    }
+
     if( !p_sys->b_seekable_archive || p_sys->b_dead
       || archive_seek_data( p_sys->p_archive, i_req, SEEK_SET ) < 0 )
     {
@@ -661,6 +827,11 @@ static int Seek( stream_extractor_t* p_extractor, uint64_t i_req )
         if( archive_skip_decompressed( p_extractor, i_skip ) )
             msg_Dbg( p_extractor, "failed to skip to seek position" );
     }
+    else
+    {   /* any pending block is stale after seeking */
+        p_sys->i_block = 0;
+        p_sys->i_hole = 0;
+    }
 
     p_sys->i_offset = i_req;
     return VLC_SUCCESS;
@@ -742,6 +913,7 @@ static int ExtractorOpen( vlc_object_t* p_obj )
     }
 
     p_extractor->p_sys = p_sys;
+    archive_probe_direct( p_extractor );
     p_extractor->pf_read = Read;
     p_extractor->pf_control = Control;
     p_extractor->pf_seek = Seek;
@@ -0,0 +1,346 @@
+/*****************************************************************************
+ * cache_adaptive.c: adaptive byte stream cache
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_stream.h>
+#include <vlc_list.h>
+
+/* Method:
+ *  - Data read from upstream is kept in extents, i.e. contiguous byte ranges
+ *    of the source, in least recently used order.
+ *  - Reads are served from the extents whenever possible. A seek only sets
+ *    the downstream offset, so back-seeks within cached data (typically to an
+ *    index or a header) do not cost anything upstream.
+ *  - On a miss, a new extent is read. Its size (the read-ahead window) doubles
+ *    every time the miss continues the previous one, and falls back to the
+ *    minimum after a random access, so that linear playback reads large
+ *    chunks while index jumps do not over-read.
+ *  - Forward jumps shorter than the window are read through rather than
+ *    seeked over, as seeking is usually much slower than reading.
+ */
+#define CACHE_WINDOW_MIN (32 << 10)
+
+struct cache_extent
+{
+    struct vlc_list node; /* in LRU order, most recent first */
+    uint64_t offset;
+    size_t   length;
+    size_t   size;
+    uint8_t  data[];
+};
+
+typedef struct
+{
+    struct vlc_list extents;
+    size_t   cache_used;
+    size_t   cache_size;
+
+    uint64_t pos;           /* downstream offset */
+    uint64_t upstream;      /* upstream offset */
+    size_t   window;
+    size_t   window_max;
+    bool     eof;
+
+    struct
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t bytes_served;
+        uint64_t bytes_read;
+        uint64_t seeks;
+    } stat;
+} stream_sys_t;
+
+static void ExtentRelease(stream_sys_t *sys, struct cache_extent *ext)
+{
+    vlc_list_remove(&ext->node);
+    sys->cache_used -= ext->size;
+    free(ext);
+}
+
+static void CacheFlush(stream_sys_t *sys)
+{
+    struct cache_extent *ext;
+
+    vlc_list_foreach(ext, &sys->extents, node)
+        ExtentRelease(sys, ext);
+    assert(sys->cache_used == 0);
+}
+
+static struct cache_extent *CacheLookup(stream_sys_t *sys, uint64_t offset,
+                                        uint64_t *next)
+{
+    struct cache_extent *ext;
+
+    *next = UINT64_MAX;
+    vlc_list_foreach(ext, &sys->extents, node)
+    {
+        if (offset >= ext->offset && offset - ext->offset < ext->length)
+            return ext;
+        if (ext->offset > offset && ext->offset < *next)
+            *next = ext->offset;
+    }
+    return NULL;
+}
+
+static struct cache_extent *CacheFill(stream_t *s, uint64_t next)
+{
+    stream_sys_t *sys = s->p_sys;
+    uint64_t start = sys->pos;
+
+    /* Track the access pattern: grow the window while misses are contiguous,
+     * shrink it back after a random access. */
+    if (sys->upstream == sys->pos)
+        sys->window = __MIN(sys->window * 2, sys->window_max);
+    else if (sys->upstream < sys->pos
+          && sys->pos - sys->upstream < sys->window)
+        start = sys->upstream; /* read through short forward jumps */
+    else
+        sys->window = CACHE_WINDOW_MIN;
+
+    size_t size = sys->window;
+
+    if (start == sys->upstream && sys->pos - start >= size / 2)
+        size += sys->pos - start;
+    /* Do not read again what is already cached */
+    if (next - start < size)
+        size = next - start;
+    assert(size > sys->pos - start);
+
+    if (start != sys->upstream)
+    {
+        sys->stat.seeks++;
+        if (vlc_stream_Seek(s->s, start))
+        {
+            msg_Err(s, "cannot seek (to offset %"PRIu64")", start);
+            sys->upstream = UINT64_MAX; /* unknown */
+            return NULL;
+        }
+        sys->upstream = start;
+        sys->eof = false;
+    }
+
+    /* Make room */
+    while (sys->cache_used + size > sys->cache_size
+        && !vlc_list_is_empty(&sys->extents))
+        ExtentRelease(sys, vlc_list_last_entry_or_null(&sys->extents,
+                                                       struct cache_extent,
+                                                       node));
+
+    struct cache_extent *ext = malloc(sizeof (*ext) + size);
+    if (unlikely(ext == NULL))
+        return NULL;
+
+    ssize_t val = vlc_stream_Read(s->s, ext->data, size);
+    if (val <= 0)
+    {
+        if (val == 0)
+            sys->eof = true;
+        else
+            sys->upstream = UINT64_MAX; /* unknown */
+        free(ext);
+        return NULL;
+    }
+
+    sys->upstream += val;
+    sys->stat.bytes_read += val;
+    if ((size_t)val < size)
+        sys->eof = true;
+    if (sys->upstream <= sys->pos)
+    {   /* Ended before the requested offset */
+        free(ext);
+        return NULL;
+    }
+
+    ext->offset = start;
+    ext->length = val;
+    ext->size = size;
+    vlc_list_prepend(&ext->node, &sys->extents);
+    sys->cache_used += size;
+    return ext;
+}
+
+static ssize_t Read(stream_t *s, void *buf, size_t len)
+{
+    stream_sys_t *sys = s->p_sys;
+    uint64_t next;
+
+    if (len == 0)
+        return 0;
+
+    struct cache_extent *ext = CacheLookup(sys, sys->pos, &next);
+    if (ext != NULL)
+    {
+        sys->stat.hits++;
+        /* Move to the front of the LRU */
+        vlc_list_remove(&ext->node);
+        vlc_list_prepend(&ext->node, &sys->extents);
+    }
+    else
+    {
+        if (sys->eof && sys->pos >= sys->upstream)
+            return 0;
+
+        sys->stat.misses++;
+        ext = CacheFill(s, next);
+        if (ext == NULL)
+            return sys->eof ? 0 : -1;
+    }
+
+    size_t offset = sys->pos - ext->offset;
+    size_t copy = __MIN(len, ext->length - offset);
+
+    memcpy(buf, ext->data + offset, copy);
+    sys->pos += copy;
+    sys->stat.bytes_served += copy;
+    return copy;
+}
+
+static int Seek(stream_t *s, uint64_t offset)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    sys->pos = offset;
+    return VLC_SUCCESS;
+}
+
+static int Control(stream_t *s, int query, va_list args)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+        case STREAM_GET_SIZE:
+        case STREAM_GET_PTS_DELAY:
+        case STREAM_GET_TITLE_INFO:
+        case STREAM_GET_TITLE:
+        case STREAM_GET_SEEKPOINT:
+        case STREAM_GET_META:
+        case STREAM_GET_CONTENT_TYPE:
+        case STREAM_GET_SIGNAL:
+        case STREAM_GET_TAGS:
+        case STREAM_SET_PAUSE_STATE:
+        case STREAM_SET_PRIVATE_ID_STATE:
+        case STREAM_SET_PRIVATE_ID_CA:
+        case STREAM_GET_PRIVATE_ID_STATE:
+            return vlc_stream_vaControl(s->s, query, args);
+
+        case STREAM_SET_TITLE:
+        case STREAM_SET_SEEKPOINT:
+        {
+            int ret = vlc_stream_vaControl(s->s, query, args);
+            if (ret == VLC_SUCCESS)
+            {   /* Offsets refer to another title now */
+                CacheFlush(sys);
+                sys->pos = sys->upstream = vlc_stream_Tell(s->s);
+                sys->window = CACHE_WINDOW_MIN;
+                sys->eof = false;
+            }
+            return ret;
+        }
+
+        default:
+            msg_Err(s, "invalid vlc_stream_vaControl query=0x%x", query);
+            return VLC_EGENERIC;
+    }
+}
+
+static int Open(vlc_object_t *obj)
+{
+    stream_t *s = (stream_t *)obj;
+    bool can_seek, fast_seek;
+
+    /* Without seeking, there is no access pattern to adapt to: the prefetch
+     * filter is better suited. The operating system already caches local
+     * files better, let the plain cache handle those. */
+    vlc_stream_Control(s->s, STREAM_CAN_SEEK, &can_seek);
+    vlc_stream_Control(s->s, STREAM_CAN_FASTSEEK, &fast_seek);
+    if (!can_seek || fast_seek)
+        return VLC_EGENERIC;
+
+    stream_sys_t *sys = vlc_obj_calloc(obj, 1, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    vlc_list_init(&sys->extents);
+    sys->cache_size = var_InheritInteger(obj, "cache-adaptive-size") << 10;
+    sys->window_max = var_InheritInteger(obj, "cache-adaptive-readahead") << 10;
+    if (sys->window_max > sys->cache_size / 2)
+        sys->window_max = sys->cache_size / 2;
+    if (sys->window_max < CACHE_WINDOW_MIN)
+        sys->window_max = CACHE_WINDOW_MIN;
+    /* The first miss doubles it back to the minimum */
+    sys->window = CACHE_WINDOW_MIN / 2;
+    sys->pos = sys->upstream = vlc_stream_Tell(s->s);
+
+    msg_Dbg(s, "using %zu KiB cache, up to %zu KiB read-ahead",
+            sys->cache_size >> 10, sys->window_max >> 10);
+
+    s->p_sys = sys;
+    s->pf_read = Read;
+    s->pf_seek = Seek;
+    s->pf_control = Control;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    stream_t *s = (stream_t *)obj;
+    stream_sys_t *sys = s->p_sys;
+    uint64_t reads = sys->stat.hits + sys->stat.misses;
+
+    if (reads > 0)
+        msg_Dbg(s, "%"PRIu64" reads, %.1f%% hit ratio, %"PRIu64" seeks, "
+                "%"PRIu64" bytes read for %"PRIu64" bytes served", reads,
+                100. * sys->stat.hits / reads, sys->stat.seeks,
+                sys->stat.bytes_read, sys->stat.bytes_served);
+    CacheFlush(sys);
+}
+
+vlc_module_begin()
+    set_category(CAT_INPUT)
+    set_subcategory(SUBCAT_INPUT_STREAM_FILTER)
+    set_capability("stream_filter", 0)
+
+    set_description(N_("Adaptive byte stream cache"))
+    set_callbacks(Open, Close)
+
+    add_integer("cache-adaptive-size", 1 << 14, N_("Cache size"),
+                N_("Maximum amount of recently read data kept in memory, "
+                   "for seeking back (KiB)"), true)
+        change_integer_range(256, 1 << 20)
+    add_integer("cache-adaptive-readahead", 1 << 12, N_("Maximum read-ahead"),
+                N_("Upper bound of the read-ahead window, reached after "
+                   "sequential reads (KiB)"), true)
+        change_integer_range(32, 1 << 18)
+vlc_module_end()
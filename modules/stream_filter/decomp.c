@@ -52,6 +52,7 @@
 static int  OpenGzip (vlc_object_t *);
 static int  OpenBzip2 (vlc_object_t *);
 static int  OpenXZ (vlc_object_t *);
+static int  OpenZstd (vlc_object_t *);
 static void Close (vlc_object_t *);
 
 vlc_module_begin ()
@@ -70,6 +71,10 @@ vlc_module_begin ()
     add_submodule ()
     set_description (N_("gzip decompression"))
     set_callbacks (OpenGzip, Close)
+
+    add_submodule ()
+    set_description (N_("Zstandard decompression"))
+    set_callbacks (OpenZstd, Close)
 vlc_module_end ()
 
 typedef struct
@@ -424,3 +429,22 @@ static int OpenXZ (vlc_object_t *obj)
     msg_Dbg (obj, "detected xz compressed stream");
     return Open (stream, "xzcat");
 }
+
+/**
+ * Detects Zstandard file format
+ */
+static int OpenZstd (vlc_object_t *obj)
+{
+    stream_t      *stream = (stream_t *)obj;
+    const uint8_t *peek;
+
+    /* (Try to) parse the zstd frame magic number */
+    if (vlc_stream_Peek (stream->s, &peek, 4) < 4)
+        return VLC_EGENERIC;
+
+    if (memcmp (peek, "\x28\xb5\x2f\xfd", 4))
+        return VLC_EGENERIC;
+
+    msg_Dbg (obj, "detected zstd compressed stream");
+    return Open (stream, "zstdcat");
+}
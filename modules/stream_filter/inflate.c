@@ -17,7 +17,6 @@
  * along with this program; if not, write to the Free Software Foundation,
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
-
 #ifdef HAVE_CONFIG_H
 # include "config.h"
 #endif
@@ -29,69 +28,455 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_stream.h>
+#include <vlc_block.h>
+#include <vlc_interrupt.h>
 
-typedef struct
+/* Decompressed data is read ahead by up to that many chunks */
+#define INFLATE_QUEUE_MIN 16
+#define INFLATE_CHUNK_SIZE 65536
+/* BGZF members never expand beyond that (see SAM/BAM specification) */
+#define BGZF_MAX_SIZE 65536
+
+struct inflate_job
 {
+    struct inflate_job *next;
+    block_t *in; /**< Compressed BGZF member, NULL once taken by a worker */
+    block_t *out; /**< Decompressed data, NULL on error */
+    bool done;
+};
+
+struct inflate_worker
+{
+    stream_t *stream;
+    vlc_thread_t thread;
     z_stream zstream;
+};
+
+typedef struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait_data; /**< A decompressed chunk is ready */
+    vlc_cond_t wait_space; /**< The read-ahead queue is no longer full */
+    vlc_cond_t wait_job; /**< A member is waiting for a worker */
+    struct inflate_job *first;
+    struct inflate_job **lastp;
+    unsigned queued;
+    unsigned queue_max;
+    bool paused;
     bool eof;
+    bool error;
+    bool failed;
+    bool closing;
+
+    /* Source */
+    vlc_mutex_t source_lock;
+    vlc_thread_t thread;
+    vlc_interrupt_t *interrupt;
+    bool can_pause;
+    bool can_pace;
+    vlc_tick_t pts_delay;
+
+    /* Sequential decompression (read-ahead thread only) */
+    z_stream zstream;
+    bool gzip;
+    bool stream_end;
     unsigned char buffer[16384];
+
+    /* Parallel decompression of BGZF members */
+    struct inflate_worker *workers;
+    unsigned worker_count;
 } stream_sys_t;
 
-static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
+/**
+ * Returns the size of the BGZF member at the current stream offset,
+ * or 0 if there is no such member.
+ *
+ * BGZF (as produced by bgzip) is a series of independent gzip members, each
+ * with its compressed size in a "BC" extra subfield.
+ */
+static size_t BgzfMemberSize(stream_t *s)
 {
-    stream_sys_t *sys = stream->p_sys;
-    ssize_t val;
+    const uint8_t *peek;
 
-    if (sys->eof || unlikely(buflen == 0))
+    if (vlc_stream_Peek(s, &peek, 12) < 12
+     || memcmp(peek, "\x1F\x8B\x08", 3) || !(peek[3] & 0x04) /* FEXTRA */)
         return 0;
 
-    sys->zstream.next_out = buf;
-    sys->zstream.avail_out = buflen;
+    size_t xlen = GetWLE(peek + 10);
 
-    if (sys->zstream.avail_in == 0)
-        sys->zstream.next_in = sys->buffer;
+    if (vlc_stream_Peek(s, &peek, 12 + xlen) < (ssize_t)(12 + xlen))
+        return 0;
 
-    val = (sys->buffer + sizeof (sys->buffer))
-        - (sys->zstream.next_in + sys->zstream.avail_in);
+    const uint8_t *field = peek + 12, *end = field + xlen;
 
-    if (val > 0)
-    {   /* Fill input buffer if there is space left */
-        val = vlc_stream_Read(stream->s,
-                          sys->zstream.next_in + sys->zstream.avail_in, val);
-        if (val >= 0)
-            sys->zstream.avail_in += val;
+    while (end - field >= 4)
+    {
+        size_t slen = GetWLE(field + 2);
+
+        if (field[0] == 'B' && field[1] == 'C' && slen == 2
+         && end - field >= 6)
+        {
+            size_t size = GetWLE(field + 4) + 1;
+            /* Header, extra field and footer */
+            return (size >= 12 + xlen + 8) ? size : 0;
+        }
+        field += 4 + slen;
     }
+    return 0;
+}
 
-    if (sys->zstream.avail_in == 0)
+/**
+ * Decompresses the next chunk of a non-BGZF stream.
+ */
+static block_t *InflateChunk(stream_t *stream)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    if (sys->stream_end)
+        return NULL;
+
+    block_t *block = block_Alloc(INFLATE_CHUNK_SIZE);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    sys->zstream.next_out = block->p_buffer;
+    sys->zstream.avail_out = block->i_buffer;
+
+    while (sys->zstream.avail_out > 0 && !sys->stream_end)
     {
-        msg_Err(stream, "unexpected end of stream");
-        return 0;
+        if (sys->zstream.avail_in == 0)
+        {
+            ssize_t val = vlc_stream_Read(stream->s, sys->buffer,
+                                          sizeof (sys->buffer));
+            if (val <= 0)
+            {
+                if (!vlc_killed())
+                    msg_Err(stream, "unexpected end of stream");
+                sys->stream_end = true;
+                break;
+            }
+            sys->zstream.next_in = sys->buffer;
+            sys->zstream.avail_in = val;
+        }
+
+        int val = inflate(&sys->zstream, Z_NO_FLUSH);
+        switch (val)
+        {
+            case Z_STREAM_END:
+            {
+                const uint8_t *peek = sys->zstream.next_in;
+
+                /* A gzip file can be a series of members (e.g. from pigz
+                 * or bgzip), look for the next one */
+                if (sys->gzip && sys->zstream.avail_in < 2)
+                {
+                    if (sys->zstream.avail_in > 0)
+                    {   /* Keep the remaining byte as the one to peek at */
+                        sys->buffer[0] = *peek;
+                        sys->zstream.next_in = sys->buffer;
+                        if (vlc_stream_Read(stream->s, sys->buffer + 1,
+                                            1) == 1)
+                            sys->zstream.avail_in = 2;
+                    }
+                    else
+                    {
+                        ssize_t len = vlc_stream_Read(stream->s, sys->buffer,
+                                                      sizeof (sys->buffer));
+                        sys->zstream.next_in = sys->buffer;
+                        sys->zstream.avail_in = (len > 0) ? len : 0;
+                    }
+                    peek = sys->zstream.next_in;
+                }
+
+                if (sys->gzip && sys->zstream.avail_in >= 2
+                 && !memcmp(peek, "\x1F\x8B", 2)
+                 && inflateReset(&sys->zstream) == Z_OK)
+                    break;
+
+                msg_Dbg(stream, "end of stream");
+                sys->stream_end = true;
+                break;
+            }
+            case Z_OK:
+            case Z_BUF_ERROR: /* Out of input, read more */
+                break;
+            case Z_DATA_ERROR:
+                msg_Err(stream, "corrupt stream");
+                block_Release(block);
+                return NULL;
+            default:
+                msg_Err(stream, "unhandled decompression error (%d)", val);
+                block_Release(block);
+                return NULL;
+        }
     }
 
-    val = inflate(&sys->zstream, Z_SYNC_FLUSH);
-    switch (val)
+    block->i_buffer -= sys->zstream.avail_out;
+    if (block->i_buffer == 0)
     {
-        case Z_STREAM_END:
-            msg_Dbg(stream, "end of stream");
-            sys->eof = true;
-            /* fall through */
-        case Z_OK:
-            return buflen - sys->zstream.avail_out;
-        case Z_DATA_ERROR:
-            msg_Err(stream, "corrupt stream");
+        block_Release(block);
+        return NULL;
+    }
+    return block;
+}
+
+/**
+ * Decompresses one BGZF member, from a worker thread.
+ */
+static block_t *InflateMember(z_stream *zstream, block_t *in)
+{
+    size_t size = GetDWLE(in->p_buffer + in->i_buffer - 4);
+
+    if (size > BGZF_MAX_SIZE || inflateReset(zstream) != Z_OK)
+        return NULL;
+
+    /* Allocate one more byte so that the output buffer is never empty */
+    block_t *out = block_Alloc(size + 1);
+    if (unlikely(out == NULL))
+        return NULL;
+
+    zstream->next_in = in->p_buffer;
+    zstream->avail_in = in->i_buffer;
+    zstream->next_out = out->p_buffer;
+    zstream->avail_out = out->i_buffer;
+
+    if (inflate(zstream, Z_FINISH) != Z_STREAM_END
+     || zstream->avail_out != 1 || zstream->avail_in != 0)
+    {
+        block_Release(out);
+        return NULL;
+    }
+
+    out->i_buffer = size;
+    return out;
+}
+
+static void *Worker(void *data)
+{
+    struct inflate_worker *worker = data;
+    stream_sys_t *sys = worker->stream->p_sys;
+
+    vlc_mutex_lock(&sys->lock);
+    while (!sys->closing)
+    {
+        struct inflate_job *job = sys->first;
+
+        while (job != NULL && job->in == NULL)
+            job = job->next;
+
+        if (job == NULL)
+        {
+            vlc_cond_wait(&sys->wait_job, &sys->lock);
+            continue;
+        }
+
+        block_t *in = job->in;
+
+        job->in = NULL;
+        vlc_mutex_unlock(&sys->lock);
+
+        block_t *out = InflateMember(&worker->zstream, in);
+        block_Release(in);
+
+        vlc_mutex_lock(&sys->lock);
+        job->out = out;
+        job->done = true;
+        if (job == sys->first)
+            vlc_cond_signal(&sys->wait_data);
+    }
+    vlc_mutex_unlock(&sys->lock);
+    return NULL;
+}
+
+/**
+ * Reads the next chunk of the compressed stream, and either decompresses it
+ * or returns it as a BGZF member for the worker threads.
+ */
+static struct inflate_job *ReadJob(stream_t *stream, bool *error)
+{
+    stream_sys_t *sys = stream->p_sys;
+    struct inflate_job *job = malloc(sizeof (*job));
+
+    if (unlikely(job == NULL))
+    {
+        *error = true;
+        return NULL;
+    }
+
+    job->next = NULL;
+    job->in = job->out = NULL;
+
+    vlc_mutex_lock(&sys->source_lock);
+    if (sys->worker_count > 0)
+    {
+        size_t size = BgzfMemberSize(stream->s);
+
+        if (size > 0)
+        {
+            job->in = vlc_stream_Block(stream->s, size);
+            if (job->in != NULL && job->in->i_buffer < size)
+            {
+                block_Release(job->in);
+                job->in = NULL;
+            }
+            *error = job->in == NULL;
+        }
+        else
+            *error = vlc_stream_Peek(stream->s,
+                                     &(const uint8_t *){ NULL }, 1) > 0;
+        if (*error)
+            msg_Err(stream, "corrupt BGZF member");
+        job->done = false;
+    }
+    else
+    {
+        job->out = InflateChunk(stream);
+        *error = job->out == NULL && !sys->stream_end;
+        job->done = true;
+    }
+    vlc_mutex_unlock(&sys->source_lock);
+
+    if (job->in == NULL && job->out == NULL)
+    {
+        free(job);
+        job = NULL;
+    }
+    return job;
+}
+
+/**
+ * Reads ahead the compressed stream.
+ */
+static void *Thread(void *data)
+{
+    stream_t *stream = data;
+    stream_sys_t *sys = stream->p_sys;
+    bool paused = false;
+
+    vlc_interrupt_set(sys->interrupt);
+
+    vlc_mutex_lock(&sys->lock);
+    while (!sys->closing)
+    {
+        if (sys->paused != paused)
+        {
+            paused = sys->paused;
+            vlc_mutex_unlock(&sys->lock);
+            vlc_mutex_lock(&sys->source_lock);
+            vlc_stream_Control(stream->s, STREAM_SET_PAUSE_STATE, paused);
+            vlc_mutex_unlock(&sys->source_lock);
+            vlc_mutex_lock(&sys->lock);
+            continue;
+        }
+
+        if (paused || sys->eof || sys->queued >= sys->queue_max)
+        {
+            vlc_cond_wait(&sys->wait_space, &sys->lock);
+            continue;
+        }
+        vlc_mutex_unlock(&sys->lock);
+
+        bool error = false;
+        struct inflate_job *job = ReadJob(stream, &error);
+
+        vlc_mutex_lock(&sys->lock);
+        if (job == NULL)
+        {
             sys->eof = true;
-            return -1;
-        case Z_BUF_ERROR:
-            if (sys->zstream.next_in == sys->buffer)
-                break;
+            sys->error = error;
+            vlc_cond_signal(&sys->wait_data);
+            continue;
+        }
 
-            memmove(sys->buffer, sys->zstream.next_in, sys->zstream.avail_in);
-            sys->zstream.next_in = sys->buffer;
-            return Read(stream, buf, buflen);
+        *sys->lastp = job;
+        sys->lastp = &job->next;
+        sys->queued++;
+        if (job->done)
+            vlc_cond_signal(&sys->wait_data);
+        else
+            vlc_cond_signal(&sys->wait_job);
     }
+    vlc_mutex_unlock(&sys->lock);
+    return NULL;
+}
 
-    msg_Err(stream, "unhandled decompression error (%zd)", val);
-    return -1;
+static void ReadInterrupt(void *data)
+{
+    stream_t *stream = data;
+    stream_sys_t *sys = stream->p_sys;
+
+    vlc_mutex_lock(&sys->lock);
+    vlc_cond_signal(&sys->wait_data);
+    vlc_mutex_unlock(&sys->lock);
+}
+
+static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
+{
+    stream_sys_t *sys = stream->p_sys;
+    ssize_t val = 0;
+
+    if (unlikely(buflen == 0))
+        return 0;
+
+    vlc_interrupt_register(ReadInterrupt, stream);
+    vlc_mutex_lock(&sys->lock);
+    while (!sys->failed)
+    {
+        struct inflate_job *job = sys->first;
+
+        if (job == NULL && sys->eof)
+        {
+            if (sys->error)
+            {   /* Report the error once, then end-of-stream */
+                sys->failed = true;
+                val = -1;
+            }
+            break;
+        }
+
+        if (job != NULL && job->done)
+        {
+            block_t *out = job->out;
+
+            if (out == NULL)
+            {   /* Nothing after a corrupt member is returned */
+                msg_Err(stream, "corrupt stream");
+                sys->failed = true;
+                sys->eof = true;
+                val = -1;
+                break;
+            }
+
+            size_t copy = (buflen < out->i_buffer) ? buflen : out->i_buffer;
+
+            memcpy(buf, out->p_buffer, copy);
+            out->p_buffer += copy;
+            out->i_buffer -= copy;
+            val = copy;
+
+            if (out->i_buffer == 0)
+            {
+                sys->first = job->next;
+                if (sys->first == NULL)
+                    sys->lastp = &sys->first;
+                sys->queued--;
+                block_Release(out);
+                free(job);
+                vlc_cond_signal(&sys->wait_space);
+            }
+
+            if (copy > 0)
+                break;
+            continue; /* empty member, e.g. BGZF end-of-file marker */
+        }
+
+        if (vlc_killed())
+            break;
+        vlc_cond_wait(&sys->wait_data, &sys->lock);
+    }
+    vlc_mutex_unlock(&sys->lock);
+    vlc_interrupt_unregister();
+    return val;
 }
 
 static int Seek(stream_t *stream, uint64_t offset)
@@ -102,6 +487,9 @@ static int Seek(stream_t *stream, uint64_t offset)
 
 static int Control(stream_t *stream, int query, va_list args)
 {
+    stream_sys_t *sys = stream->p_sys;
+    int ret;
+
     switch (query)
     {
         case STREAM_CAN_SEEK:
@@ -109,13 +497,30 @@ static int Control(stream_t *stream, int query, va_list args)
             *va_arg(args, bool *) = false;
             break;
         case STREAM_CAN_PAUSE:
+            *va_arg(args, bool *) = sys->can_pause;
+            break;
         case STREAM_CAN_CONTROL_PACE:
+            *va_arg(args, bool *) = sys->can_pace;
+            break;
         case STREAM_GET_PTS_DELAY:
+            *va_arg(args, vlc_tick_t *) = sys->pts_delay;
+            break;
         case STREAM_GET_META:
         case STREAM_GET_CONTENT_TYPE:
         case STREAM_GET_SIGNAL:
+            /* The source is also accessed by the read-ahead thread */
+            vlc_mutex_lock(&sys->source_lock);
+            ret = vlc_stream_vaControl(stream->s, query, args);
+            vlc_mutex_unlock(&sys->source_lock);
+            return ret;
         case STREAM_SET_PAUSE_STATE:
-            return vlc_stream_vaControl(stream->s, query, args);
+            if (!sys->can_pause)
+                return VLC_EGENERIC;
+            vlc_mutex_lock(&sys->lock);
+            sys->paused = va_arg(args, int);
+            vlc_cond_signal(&sys->wait_space);
+            vlc_mutex_unlock(&sys->lock);
+            break;
         case STREAM_GET_SIZE:
         case STREAM_GET_TITLE_INFO:
         case STREAM_GET_TITLE:
@@ -133,6 +538,61 @@ static int Control(stream_t *stream, int query, va_list args)
     return VLC_SUCCESS;
 }
 
+static void StopWorkers(stream_sys_t *sys)
+{
+    vlc_mutex_lock(&sys->lock);
+    sys->closing = true;
+    vlc_cond_broadcast(&sys->wait_job);
+    vlc_mutex_unlock(&sys->lock);
+
+    for (unsigned i = 0; i < sys->worker_count; i++)
+    {
+        vlc_join(sys->workers[i].thread, NULL);
+        inflateEnd(&sys->workers[i].zstream);
+    }
+    free(sys->workers);
+}
+
+static int StartWorkers(stream_t *stream, unsigned count)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    sys->workers = vlc_alloc(count, sizeof (*sys->workers));
+    if (unlikely(sys->workers == NULL))
+        return VLC_ENOMEM;
+
+    for (sys->worker_count = 0; sys->worker_count < count;
+         sys->worker_count++)
+    {
+        struct inflate_worker *worker = &sys->workers[sys->worker_count];
+
+        worker->stream = stream;
+        worker->zstream.zalloc = Z_NULL;
+        worker->zstream.zfree = Z_NULL;
+        worker->zstream.opaque = Z_NULL;
+        worker->zstream.next_in = Z_NULL;
+        worker->zstream.avail_in = 0;
+
+        if (inflateInit2(&worker->zstream, 15 + 16) != Z_OK)
+            break;
+        if (vlc_clone(&worker->thread, Worker, worker,
+                      VLC_THREAD_PRIORITY_INPUT))
+        {
+            inflateEnd(&worker->zstream);
+            break;
+        }
+    }
+
+    if (sys->worker_count < count)
+    {
+        StopWorkers(sys);
+        sys->worker_count = 0;
+        sys->closing = false;
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
 static int Open(vlc_object_t *obj)
 {
     stream_t *stream = (stream_t *)obj;
@@ -160,7 +620,8 @@ static int Open(vlc_object_t *obj)
     sys->zstream.zalloc = Z_NULL;
     sys->zstream.zfree = Z_NULL;
     sys->zstream.opaque = Z_NULL;
-    sys->eof = false;
+    sys->gzip = bits > 15;
+    sys->stream_end = false;
 
     int ret = inflateInit2(&sys->zstream, bits);
     if (ret != Z_OK)
@@ -169,11 +630,71 @@ static int Open(vlc_object_t *obj)
         return (ret == Z_MEM_ERROR) ? VLC_ENOMEM : VLC_EGENERIC;
     }
 
+    vlc_mutex_init(&sys->lock);
+    vlc_cond_init(&sys->wait_data);
+    vlc_cond_init(&sys->wait_space);
+    vlc_cond_init(&sys->wait_job);
+    vlc_mutex_init(&sys->source_lock);
+    sys->first = NULL;
+    sys->lastp = &sys->first;
+    sys->queued = 0;
+    sys->paused = false;
+    sys->eof = false;
+    sys->error = false;
+    sys->failed = false;
+    sys->closing = false;
+    sys->workers = NULL;
+    sys->worker_count = 0;
     stream->p_sys = sys;
+
+    if (vlc_stream_Control(stream->s, STREAM_CAN_PAUSE, &sys->can_pause))
+        sys->can_pause = false;
+    if (vlc_stream_Control(stream->s, STREAM_CAN_CONTROL_PACE,
+                           &sys->can_pace))
+        sys->can_pace = true;
+    if (vlc_stream_Control(stream->s, STREAM_GET_PTS_DELAY, &sys->pts_delay))
+        sys->pts_delay = DEFAULT_PTS_DELAY;
+
+    /* BGZF members are independent, decompress them in parallel */
+    unsigned threads = var_InheritInteger(stream, "inflate-threads");
+    if (threads == 0)
+        threads = vlc_GetCPUCount();
+
+    if (threads > 1 && sys->gzip && BgzfMemberSize(stream->s) > 0)
+    {
+        if (StartWorkers(stream, threads) == VLC_SUCCESS)
+            msg_Dbg(stream, "decompressing BGZF members with %u threads",
+                    threads);
+        else
+            msg_Warn(stream, "cannot start decompression threads");
+    }
+    sys->queue_max = __MAX(INFLATE_QUEUE_MIN, 2 * sys->worker_count);
+
+    sys->interrupt = vlc_interrupt_create();
+    if (unlikely(sys->interrupt == NULL))
+        goto error;
+
+    if (vlc_clone(&sys->thread, Thread, stream, VLC_THREAD_PRIORITY_INPUT))
+    {
+        vlc_interrupt_destroy(sys->interrupt);
+        goto error;
+    }
+
     stream->pf_read = Read;
     stream->pf_seek = Seek;
     stream->pf_control = Control;
     return VLC_SUCCESS;
+
+error:
+    StopWorkers(sys);
+    vlc_mutex_destroy(&sys->source_lock);
+    vlc_cond_destroy(&sys->wait_job);
+    vlc_cond_destroy(&sys->wait_space);
+    vlc_cond_destroy(&sys->wait_data);
+    vlc_mutex_destroy(&sys->lock);
+    inflateEnd(&sys->zstream);
+    free(sys);
+    return VLC_ENOMEM;
 }
 
 static void Close (vlc_object_t *obj)
@@ -181,10 +702,42 @@ static void Close (vlc_object_t *obj)
     stream_t *stream = (stream_t *)obj;
     stream_sys_t *sys = stream->p_sys;
 
+    vlc_mutex_lock(&sys->lock);
+    sys->closing = true;
+    vlc_cond_signal(&sys->wait_space);
+    vlc_mutex_unlock(&sys->lock);
+
+    vlc_interrupt_kill(sys->interrupt);
+    vlc_join(sys->thread, NULL);
+    vlc_interrupt_destroy(sys->interrupt);
+    StopWorkers(sys);
+
+    while (sys->first != NULL)
+    {
+        struct inflate_job *job = sys->first;
+
+        sys->first = job->next;
+        if (job->in != NULL)
+            block_Release(job->in);
+        if (job->out != NULL)
+            block_Release(job->out);
+        free(job);
+    }
+
+    vlc_mutex_destroy(&sys->source_lock);
+    vlc_cond_destroy(&sys->wait_job);
+    vlc_cond_destroy(&sys->wait_space);
+    vlc_cond_destroy(&sys->wait_data);
+    vlc_mutex_destroy(&sys->lock);
     inflateEnd(&sys->zstream);
     free(sys);
 }
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_( \
+    "Number of threads used to decompress BGZF files, which are made of " \
+    "independent gzip members (0 = automatic).")
+
 vlc_module_begin()
     set_category(CAT_INPUT)
     set_subcategory(SUBCAT_INPUT_STREAM_FILTER)
@@ -192,4 +745,7 @@ vlc_module_begin()
 
     set_description(N_("Zlib decompression filter"))
     set_callbacks(Open, Close)
+
+    add_integer("inflate-threads", 0, THREADS_TEXT, THREADS_LONGTEXT, true)
+        change_integer_range(0, 32)
 vlc_module_end()
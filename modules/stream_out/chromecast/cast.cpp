@@ -38,8 +38,13 @@
 #include <vlc_block.h>
 #include <vlc_modules.h>
 #include <vlc_httpd.h>
+#include <vlc_fs.h>
 
+#include <algorithm>
 #include <cassert>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #define TRANSCODING_NONE 0x0
 #define TRANSCODING_VIDEO 0x1
@@ -60,6 +65,8 @@ struct sout_access_out_sys_t
     void clear();
     void stop();
     void prepare(sout_stream_t *p_stream, const std::string &mime);
+    bool prepareFile(sout_stream_t *p_stream, const std::string &path,
+                     const std::string &mime);
     int url_cb(httpd_client_t *cl, httpd_message_t *answer, const httpd_message_t *query);
     void fifo_put_back(block_t *);
     ssize_t write(sout_access_out_t *p_access, block_t *p_block);
@@ -71,6 +78,7 @@ private:
     void initCopy();
     void putCopy(block_t *p_block);
     void restoreCopy();
+    void fileCb(httpd_message_t *answer, const httpd_message_t *query);
 
     intf_sys_t * const m_intf;
     httpd_url_t       *m_url;
@@ -82,6 +90,9 @@ private:
     size_t             m_copy_size;
     bool               m_eof;
     std::string        m_mime;
+    /* source file served as is, instead of the fifo */
+    int                m_fd;
+    uint64_t           m_file_size;
 };
 
 typedef struct sout_stream_id_sys_t sout_stream_id_sys_t;
@@ -101,6 +112,8 @@ struct sout_stream_sys_t
         , cc_flushing( false )
         , cc_eof( false )
         , has_video( false )
+        , direct_active( false )
+        , direct_failed( false )
         , out_force_reload( false )
         , perf_warning_shown( false )
         , transcoding_state( TRANSCODING_NONE )
@@ -123,6 +136,9 @@ struct sout_stream_sys_t
                         const std::vector<sout_stream_id_sys_t*> &new_streams,
                         const std::string &sout, int new_transcoding_state);
     void stopSoutChain(sout_stream_t* p_stream);
+    bool startDirect(sout_stream_t* p_stream,
+                     const std::vector<sout_stream_id_sys_t*> &new_streams,
+                     bool b_video);
     sout_stream_id_sys_t *GetSubId( sout_stream_t*, sout_stream_id_sys_t*, bool update = true );
     bool isFlushing( sout_stream_t* );
     void setNextTranscodingState();
@@ -148,6 +164,8 @@ struct sout_stream_sys_t
     bool                               cc_flushing;
     bool                               cc_eof;
     bool                               has_video;
+    bool                               direct_active;
+    bool                               direct_failed;
     bool                               out_force_reload;
     bool                               perf_warning_shown;
     int                                transcoding_state;
@@ -187,7 +205,7 @@ static int AccessOpen(vlc_object_t *);
 static void AccessClose(vlc_object_t *);
 
 static const char *const ppsz_sout_options[] = {
-    "ip", "port",  "http-port", "video", NULL
+    "ip", "port",  "http-port", "video", "direct", NULL
 };
 
 /*****************************************************************************
@@ -203,6 +221,13 @@ static const char *const ppsz_sout_options[] = {
 #define PORT_TEXT N_("Chromecast port")
 #define PORT_LONGTEXT N_("The port used to talk to the Chromecast.")
 
+#define DIRECT_TEXT N_("Serve compatible files directly")
+#define DIRECT_LONGTEXT N_("Let the Chromecast read local files as is when " \
+                           "their format and codecs are supported, instead " \
+                           "of remuxing them.")
+
+/* Size of the reads answering requests for files served as is */
+#define HTTPD_FILE_CHUNK (512 * 1024)
 /* Fifo size after we tell the demux to pace */
 #define HTTPD_BUFFER_PACE INT64_C(2 * 1024 * 1024) /* 2 MB */
 /* Fifo size after we drop packets (should not happen) */
@@ -226,6 +251,7 @@ vlc_module_begin ()
     add_bool(SOUT_CFG_PREFIX "video", true, NULL, NULL, false)
         change_private()
     add_integer(SOUT_CFG_PREFIX "http-port", HTTP_PORT, HTTP_PORT_TEXT, HTTP_PORT_LONGTEXT, false)
+    add_bool(SOUT_CFG_PREFIX "direct", false, DIRECT_TEXT, DIRECT_LONGTEXT, true)
     add_obsolete_string(SOUT_CFG_PREFIX "mux")
     add_obsolete_string(SOUT_CFG_PREFIX "mime")
     add_renderer_opts(SOUT_CFG_PREFIX)
@@ -345,6 +371,8 @@ sout_access_out_sys_t::sout_access_out_sys_t(httpd_host_t *httpd_host,
     , m_header(NULL)
     , m_copy_chain(NULL)
     , m_eof(true)
+    , m_fd(-1)
+    , m_file_size(0)
 {
     m_fifo = block_FifoNew();
     if (!m_fifo)
@@ -364,6 +392,8 @@ sout_access_out_sys_t::~sout_access_out_sys_t()
 {
     httpd_UrlDelete(m_url);
     block_FifoRelease(m_fifo);
+    if (m_fd != -1)
+        vlc_close(m_fd);
 }
 
 void sout_access_out_sys_t::clearUnlocked()
@@ -374,6 +404,11 @@ void sout_access_out_sys_t::clearUnlocked()
         block_Release(m_header);
         m_header = NULL;
     }
+    if (m_fd != -1)
+    {
+        vlc_close(m_fd);
+        m_fd = -1;
+    }
     m_eof = true;
     initCopy();
 }
@@ -445,6 +480,37 @@ void sout_access_out_sys_t::prepare(sout_stream_t *p_stream, const std::string &
     vlc_fifo_Unlock(m_fifo);
 }
 
+bool sout_access_out_sys_t::prepareFile(sout_stream_t *p_stream,
+                                        const std::string &path,
+                                        const std::string &mime)
+{
+    int fd = vlc_open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        msg_Warn(p_stream, "cannot open %s: %s", path.c_str(),
+                 vlc_strerror_c(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+    {
+        vlc_close(fd);
+        return false;
+    }
+
+    vlc_fifo_Lock(m_fifo);
+    clearUnlocked();
+    m_intf->setPacing(false);
+    m_mime = mime;
+    m_fd = fd;
+    m_file_size = st.st_size;
+    m_eof = true;
+    vlc_fifo_Unlock(m_fifo);
+    vlc_fifo_Signal(m_fifo);
+    return true;
+}
+
 void sout_access_out_sys_t::fifo_put_back(block_t *p_block)
 {
     block_t *p_fifo = vlc_fifo_DequeueAllUnlocked(m_fifo);
@@ -460,6 +526,13 @@ int sout_access_out_sys_t::url_cb(httpd_client_t *cl, httpd_message_t *answer,
 
     vlc_fifo_Lock(m_fifo);
 
+    if (m_fd != -1)
+    {
+        fileCb(answer, query);
+        vlc_fifo_Unlock(m_fifo);
+        return VLC_SUCCESS;
+    }
+
     if (!answer->i_body_offset)
     {
         /* When doing a lot a load requests, we can serve data to a client that
@@ -555,6 +628,83 @@ int sout_access_out_sys_t::url_cb(httpd_client_t *cl, httpd_message_t *answer,
     return VLC_SUCCESS;
 }
 
+/* Answers range requests for the source file, the Chromecast seeking in it
+ * itself. Called with the fifo locked. */
+void sout_access_out_sys_t::fileCb(httpd_message_t *answer,
+                                   const httpd_message_t *query)
+{
+    uint64_t i_start = 0, i_end = m_file_size;
+    bool b_range = false;
+
+    /* The request is parsed again for each chunk, since the only state
+     * kept by httpd between the calls is the body offset */
+    const char *psz_range = httpd_MsgGet(query, "Range");
+    if (psz_range && !strncasecmp(psz_range, "bytes=", 6))
+    {
+        unsigned long long first, last;
+        int i_ret = sscanf(psz_range + 6, "%llu-%llu", &first, &last);
+        if (i_ret >= 1)
+        {
+            b_range = true;
+            i_start = first;
+            if (i_ret == 2 && last < m_file_size)
+                i_end = last + 1;
+        }
+    }
+
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 0;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+
+    if (i_start >= i_end)
+    {
+        answer->i_status = 416;
+        if (answer->i_body_offset == 0)
+        {
+            httpd_MsgAdd(answer, "Content-Range", "bytes */%" PRIu64,
+                         m_file_size);
+            httpd_MsgAdd(answer, "Content-Length", "0");
+        }
+        httpd_MsgAdd(answer, "Connection", "close");
+        return;
+    }
+
+    answer->i_status = b_range ? 206 : 200;
+
+    uint64_t i_pos = i_start;
+    if (answer->i_body_offset == 0)
+    {
+        httpd_MsgAdd(answer, "Content-type", "%s", m_mime.c_str());
+        httpd_MsgAdd(answer, "Accept-Ranges", "bytes");
+        httpd_MsgAdd(answer, "Content-Length", "%" PRIu64, i_end - i_start);
+        if (b_range)
+            httpd_MsgAdd(answer, "Content-Range", "bytes %" PRIu64 "-%" PRIu64
+                         "/%" PRIu64, i_start, i_end - 1, m_file_size);
+        httpd_MsgAdd(answer, "Connection", "close");
+    }
+    else
+        i_pos = answer->i_body_offset;
+
+    size_t i_chunk = __MIN(i_end - i_pos, (uint64_t) HTTPD_FILE_CHUNK);
+    answer->p_body = (uint8_t *) malloc(i_chunk);
+    if (answer->p_body)
+    {
+        ssize_t i_read = pread(m_fd, answer->p_body, i_chunk, i_pos);
+        if (i_read > 0)
+        {
+            answer->i_body = i_read;
+            answer->i_body_offset = i_pos + i_read;
+        }
+        else
+        {
+            free(answer->p_body);
+            answer->p_body = NULL;
+        }
+    }
+    if (!answer->i_body)
+        httpd_MsgAdd(answer, "Connection", "close");
+}
+
 ssize_t sout_access_out_sys_t::write(sout_access_out_t *p_access, block_t *p_block)
 {
     size_t i_len = p_block->i_buffer;
@@ -694,25 +844,24 @@ static void DelInternal(sout_stream_t *p_stream, void *_id, bool reset_config)
         sout_stream_id_sys_t *p_sys_id = *it;
         if ( p_sys_id == id )
         {
+            /* Streams of files served as is have no sub id */
             if ( p_sys_id->p_sub_id != NULL )
-            {
                 sout_StreamIdDel( p_sys->p_out, p_sys_id->p_sub_id );
-                for (std::vector<sout_stream_id_sys_t*>::iterator out_it = p_sys->out_streams.begin();
-                     out_it != p_sys->out_streams.end(); )
+            for (std::vector<sout_stream_id_sys_t*>::iterator out_it = p_sys->out_streams.begin();
+                 out_it != p_sys->out_streams.end(); )
+            {
+                if (*out_it == id)
                 {
-                    if (*out_it == id)
-                    {
-                        p_sys->out_streams.erase(out_it);
-                        p_sys->es_changed = reset_config;
-                        p_sys->out_force_reload = reset_config;
-                        if( p_sys_id->fmt.i_cat == VIDEO_ES )
-                            p_sys->has_video = false;
-                        else if( p_sys_id->fmt.i_cat == SPU_ES )
-                            p_sys->spu_streams_count--;
-                        break;
-                    }
-                    out_it++;
+                    p_sys->out_streams.erase(out_it);
+                    p_sys->es_changed = reset_config;
+                    p_sys->out_force_reload = reset_config;
+                    if( p_sys_id->fmt.i_cat == VIDEO_ES )
+                        p_sys->has_video = false;
+                    else if( p_sys_id->fmt.i_cat == SPU_ES )
+                        p_sys->spu_streams_count--;
+                    break;
                 }
+                out_it++;
             }
 
             es_format_Clean( &p_sys_id->fmt );
@@ -804,6 +953,82 @@ void sout_stream_sys_t::stopSoutChain(sout_stream_t *p_stream)
         sout_StreamChainDelete( p_out, NULL );
         p_out = NULL;
     }
+    else if ( direct_active )
+    {
+        /* The file stays served until the access out is stopped or
+         * prepared again, the Chromecast may still be reading it */
+        out_streams.clear();
+        direct_active = false;
+    }
+}
+
+/* Container of the files the Chromecast can read as is, given that their
+ * codecs are supported */
+static const char *GetDirectMime( const std::string &path, bool b_video )
+{
+    static const struct
+    {
+        const char *psz_ext;
+        const char *psz_video_mime;
+        const char *psz_audio_mime;
+    } formats[] = {
+        { "mp4",  "video/mp4",        "audio/mp4" },
+        { "m4v",  "video/mp4",        "audio/mp4" },
+        { "m4a",  NULL,               "audio/mp4" },
+        { "webm", "video/webm",       "audio/webm" },
+        { "mkv",  "video/x-matroska", "audio/x-matroska" },
+        { "mka",  NULL,               "audio/x-matroska" },
+        { "mp3",  NULL,               "audio/mpeg" },
+        { "ogg",  NULL,               "audio/ogg" },
+        { "oga",  NULL,               "audio/ogg" },
+        { "opus", NULL,               "audio/ogg" },
+    };
+
+    size_t i_dot = path.rfind( '.' );
+    if ( i_dot == std::string::npos || path.find( '/', i_dot ) != std::string::npos )
+        return NULL;
+    const char *psz_ext = path.c_str() + i_dot + 1;
+
+    for ( size_t i = 0; i < ARRAY_SIZE(formats); ++i )
+    {
+        if ( strcasecmp( psz_ext, formats[i].psz_ext ) == 0 )
+            return b_video ? formats[i].psz_video_mime
+                           : formats[i].psz_audio_mime;
+    }
+    return NULL;
+}
+
+bool sout_stream_sys_t::startDirect(sout_stream_t *p_stream,
+                                    const std::vector<sout_stream_id_sys_t*> &new_streams,
+                                    bool b_video)
+{
+    const std::string path = p_intf->getSourcePath();
+    if ( path.empty() || p_intf->getSourceTime() < 0 )
+        return false;
+
+    const char *psz_mime = GetDirectMime( path, b_video );
+    if ( psz_mime == NULL )
+        return false;
+    /* Video tracks are not added for audio only devices, but the file may
+     * still hold some */
+    if ( !b_supports_video && GetDirectMime( path, true ) != NULL )
+        return false;
+
+    stopSoutChain( p_stream );
+
+    if ( !access_out_live.prepareFile( p_stream, path, psz_mime ) )
+        return false;
+
+    msg_Dbg( p_stream, "Serving %s as is", path.c_str() );
+    out_streams = new_streams;
+    transcoding_state = TRANSCODING_NONE;
+    direct_active = true;
+
+    /* Fall back to remuxing if the Chromecast fails to load the file */
+    p_intf->setRetryOnFail( true );
+    p_intf->setHasInput( psz_mime, true );
+    cc_has_input = true;
+    return true;
 }
 
 bool sout_stream_sys_t::startSoutChain(sout_stream_t *p_stream,
@@ -1014,6 +1239,24 @@ bool sout_stream_sys_t::UpdateOutput( sout_stream_t *p_stream )
 
     out_force_reload = false;
 
+    /* The file can be read as is if the Chromecast handles the container
+     * and all the selected tracks, except subtitles that it ignores */
+    if ( canRemux && !direct_failed
+      && var_InheritBool( p_stream, SOUT_CFG_PREFIX "direct" ) )
+    {
+        bool b_skipped_tracks = false;
+        for ( size_t i = 0; i < streams.size(); ++i )
+        {
+            if ( streams[i]->fmt.i_cat != SPU_ES
+              && std::find( new_streams.begin(), new_streams.end(), streams[i] )
+                 == new_streams.end() )
+                b_skipped_tracks = true;
+        }
+        if ( !b_skipped_tracks
+          && startDirect( p_stream, new_streams, p_original_video != NULL ) )
+            return true;
+    }
+
     std::stringstream ssout;
     int new_transcoding_state = TRANSCODING_NONE;
     if ( !canRemux )
@@ -1149,6 +1392,14 @@ static int Send(sout_stream_t *p_stream, void *_id, block_t *p_buffer)
     }
 
     sout_stream_id_sys_t *next_id = p_sys->GetSubId( p_stream, id );
+    if ( p_sys->direct_active )
+    {
+        /* The Chromecast reads the source file itself: keep the demux
+         * waiting until it is done */
+        block_ChainRelease( p_buffer );
+        p_sys->p_intf->setPacing( true );
+        return VLC_SUCCESS;
+    }
     if ( next_id == NULL )
     {
         block_ChainRelease( p_buffer );
@@ -1209,6 +1460,15 @@ static void on_input_event_cb(void *data, enum cc_input_event event, union cc_in
                 p_sys->out_force_reload = p_sys->es_changed = true;
             break;
         case CC_INPUT_EVENT_RETRY:
+            if( p_sys->direct_active )
+            {
+                msg_Warn(p_stream, "Load failed detected. Remuxing the source "
+                         "file instead of serving it as is");
+                p_sys->direct_failed = true;
+                p_sys->stopSoutChain( p_stream );
+                p_sys->out_force_reload = p_sys->es_changed = true;
+                break;
+            }
             p_sys->stopSoutChain( p_stream );
             if( p_sys->transcodingCanFallback() )
             {
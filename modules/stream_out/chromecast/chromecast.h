@@ -122,7 +122,8 @@ public:
     unsigned msgReceiverClose(const std::string& destinationId);
     unsigned msgAuth();
     unsigned msgPlayerLoad( const std::string& destinationId,
-                            const std::string& mime, const vlc_meta_t *p_meta );
+                            const std::string& mime, const vlc_meta_t *p_meta,
+                            const std::string& currentTime = "" );
     unsigned msgPlayerPlay( const std::string& destinationId, int64_t mediaSessionId );
     unsigned msgPlayerStop( const std::string& destinationId, int64_t mediaSessionId );
     unsigned msgPlayerPause( const std::string& destinationId, int64_t mediaSessionId );
@@ -145,7 +146,8 @@ private:
                      const std::string & destinationId = DEFAULT_CHOMECAST_RECEIVER,
                      castchannel::CastMessage_PayloadType payloadType = castchannel::CastMessage_PayloadType_STRING);
     int pushMediaPlayerMessage( const std::string& destinationId, const std::stringstream & payload );
-    std::string GetMedia( const std::string& mime, const vlc_meta_t *p_meta );
+    std::string GetMedia( const std::string& mime, const vlc_meta_t *p_meta,
+                          bool b_live );
     unsigned getNextReceiverRequestId();
     unsigned getNextRequestId();
 
@@ -174,7 +176,9 @@ struct intf_sys_t
     ~intf_sys_t();
 
     void setRetryOnFail(bool);
-    void setHasInput(const std::string mime_type = "");
+    void setHasInput(const std::string mime_type = "", bool direct = false);
+    std::string getSourcePath() const;
+    vlc_tick_t getSourceTime() const;
 
     void setOnInputEventCb(on_input_event_itf on_input_event, void *on_input_event_data);
     void setDemuxEnabled(bool enabled, on_paused_changed_itf on_paused_changed,
@@ -209,6 +213,7 @@ private:
     void doStop();
 
     void setMeta( vlc_meta_t *p_meta );
+    void setSource( const char *psz_path, vlc_tick_t time );
 
     vlc_tick_t getPlaybackTimestamp();
 
@@ -239,6 +244,8 @@ private:
 
     static void set_meta(void*, vlc_meta_t *p_meta);
 
+    static void set_source(void*, const char *psz_path, vlc_tick_t time);
+
     void prepareHttpArtwork();
 
     static vlc_tick_t   timeCCToVLC(double);
@@ -281,6 +288,13 @@ private:
 
     vlc_meta_t *m_meta;
 
+    /* Source file served as is, and its time when the demux (re)started,
+     * or -1 if unknown */
+    std::string m_source_path;
+    vlc_tick_t  m_source_time;
+    vlc_tick_t  m_direct_time;
+    bool        m_direct;
+
     vlc_interrupt_t *m_ctl_thread_interrupt;
 
     struct httpd_info_t {
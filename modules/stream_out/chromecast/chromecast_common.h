@@ -70,6 +70,8 @@ typedef struct
 
     void (*pf_set_meta)(void*, vlc_meta_t *p_meta);
 
+    void (*pf_set_source)(void*, const char *psz_path, vlc_tick_t i_time);
+
 } chromecast_common;
 
 # ifdef __cplusplus
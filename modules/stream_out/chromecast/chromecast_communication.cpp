@@ -284,7 +284,8 @@ static std::string meta_get_escaped(const vlc_meta_t *p_meta, vlc_meta_type_t ty
 }
 
 std::string ChromecastCommunication::GetMedia( const std::string& mime,
-                                               const vlc_meta_t *p_meta )
+                                               const vlc_meta_t *p_meta,
+                                               bool b_live )
 {
     std::stringstream ss;
 
@@ -350,20 +351,24 @@ std::string ChromecastCommunication::GetMedia( const std::string& mime,
     msg_Dbg( m_module, "s_chromecast_url: %s", chromecast_url.str().c_str());
 
     ss << "\"contentId\":\"" << chromecast_url.str() << "\""
-       << ",\"streamType\":\"LIVE\""
+       << ",\"streamType\":\"" << ( b_live ? "LIVE" : "BUFFERED" ) << "\""
        << ",\"contentType\":\"" << mime << "\"";
 
     return ss.str();
 }
 
 unsigned ChromecastCommunication::msgPlayerLoad( const std::string& destinationId,
-                                             const std::string& mime, const vlc_meta_t *p_meta )
+                                             const std::string& mime, const vlc_meta_t *p_meta,
+                                             const std::string& currentTime )
 {
     unsigned id = getNextRequestId();
     std::stringstream ss;
+    /* Files served as is are seekable, the time is the one of the file */
     ss << "{\"type\":\"LOAD\","
-       <<  "\"media\":{" << GetMedia( mime, p_meta ) << "},"
-       <<  "\"autoplay\":\"false\","
+       <<  "\"media\":{" << GetMedia( mime, p_meta, currentTime.empty() ) << "},";
+    if( !currentTime.empty() )
+        ss << "\"currentTime\":" << currentTime << ",";
+    ss <<  "\"autoplay\":\"false\","
        <<  "\"requestId\":" << id
        << "}";
 
@@ -110,6 +110,9 @@ intf_sys_t::intf_sys_t(vlc_object_t * const p_this, int port, std::string device
  , m_cc_eof( false )
  , m_pace( false )
  , m_meta( NULL )
+ , m_source_time( -1 )
+ , m_direct_time( 0 )
+ , m_direct( false )
  , m_httpd( httpd_host, port )
  , m_httpd_file(NULL)
  , m_art_url(NULL)
@@ -137,6 +140,7 @@ intf_sys_t::intf_sys_t(vlc_object_t * const p_this, int port, std::string device
     m_common.pf_send_input_event = send_input_event;
     m_common.pf_set_pause_state  = set_pause_state;
     m_common.pf_set_meta         = set_meta;
+    m_common.pf_set_source       = set_source;
 
     assert( var_Type( vlc_object_parent(vlc_object_parent(m_module)), CC_SHARED_VAR_NAME) == 0 );
     if (var_Create( vlc_object_parent(vlc_object_parent(m_module)), CC_SHARED_VAR_NAME, VLC_VAR_ADDRESS ) == VLC_SUCCESS )
@@ -365,7 +369,9 @@ void intf_sys_t::tryLoad()
     // Reset the mediaSessionID to allow the new session to become the current one.
     // we cannot start a new load when the last one is still processing
     m_last_request_id =
-        m_communication->msgPlayerLoad( m_appTransportId, m_mime, m_meta );
+        m_communication->msgPlayerLoad( m_appTransportId, m_mime, m_meta,
+                                        m_direct ? timeVLCToCC( m_direct_time )
+                                                 : std::string() );
     if( m_last_request_id != ChromecastCommunication::kInvalidId )
         m_state = Loading;
 }
@@ -376,15 +382,17 @@ void intf_sys_t::setRetryOnFail( bool enabled )
     m_retry_on_fail = enabled;
 }
 
-void intf_sys_t::setHasInput( const std::string mime_type )
+void intf_sys_t::setHasInput( const std::string mime_type, bool direct )
 {
     vlc::threads::mutex_locker locker(m_lock);
-    msg_Dbg( m_module, "Loading content" );
+    msg_Dbg( m_module, "Loading content%s", direct ? " from the source file" : "" );
 
     if( m_state == Dead )
         reinit();
 
     this->m_mime = mime_type;
+    m_direct = direct && m_source_time >= 0;
+    m_direct_time = m_direct ? m_source_time : 0;
 
     /* new input: clear message queue */
     std::queue<QueueableMessages> empty;
@@ -886,6 +894,10 @@ void intf_sys_t::processMediaMessage( const castchannel::CastMessage& msg )
             else if (newPlayerState == "PLAYING")
             {
                 vlc_tick_t currentTime = timeCCToVLC((double) status[0]["currentTime"]);
+                /* The time of files served as is starts from the source
+                 * time, not from the time the demux (re)started */
+                if( m_direct )
+                    currentTime -= m_direct_time;
                 m_cc_time = currentTime;
                 m_cc_time_date = vlc_tick_now();
 
@@ -1156,6 +1168,25 @@ void intf_sys_t::setMeta(vlc_meta_t *p_meta)
     m_meta = p_meta;
 }
 
+void intf_sys_t::setSource(const char *psz_path, vlc_tick_t time)
+{
+    vlc::threads::mutex_locker lock( m_lock );
+    m_source_path = psz_path ? psz_path : "";
+    m_source_time = time;
+}
+
+std::string intf_sys_t::getSourcePath() const
+{
+    vlc::threads::mutex_locker lock( m_lock );
+    return m_source_path;
+}
+
+vlc_tick_t intf_sys_t::getSourceTime() const
+{
+    vlc::threads::mutex_locker lock( m_lock );
+    return m_source_time;
+}
+
 vlc_tick_t intf_sys_t::getPlaybackTimestamp()
 {
     vlc::threads::mutex_locker lock( m_lock );
@@ -1253,3 +1284,9 @@ void intf_sys_t::set_meta(void *pt, vlc_meta_t *p_meta)
     intf_sys_t *p_this = static_cast<intf_sys_t*>(pt);
     p_this->setMeta( p_meta );
 }
+
+void intf_sys_t::set_source(void *pt, const char *psz_path, vlc_tick_t time)
+{
+    intf_sys_t *p_this = static_cast<intf_sys_t*>(pt);
+    p_this->setSource( psz_path, time );
+}
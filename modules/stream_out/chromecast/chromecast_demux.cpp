@@ -141,9 +141,23 @@ struct demux_cc
     {
         assert(p_renderer);
         p_renderer->pf_set_meta( p_renderer->p_opaque, NULL );
+        p_renderer->pf_set_source( p_renderer->p_opaque, NULL, -1 );
         p_renderer->pf_set_demux_enabled(p_renderer->p_opaque, false, NULL, NULL);
     }
 
+    /* Local file read by the demuxer, that the Chromecast may fetch directly */
+    const char *getSourcePath() const
+    {
+        for( demux_t *p_next = p_demux->p_next; p_next != NULL;
+             p_next = p_next->p_next )
+        {
+            if( p_next->psz_url != NULL )
+                return strncmp( p_next->psz_url, "file://", 7 ) == 0 ?
+                       p_next->psz_filepath : NULL;
+        }
+        return NULL;
+    }
+
     void resetTimes()
     {
         m_start_time = m_last_time = -1;
@@ -160,6 +174,9 @@ struct demux_cc
 
         m_last_time = m_start_time;
         m_last_pos = m_start_pos;
+
+        p_renderer->pf_set_source( p_renderer->p_opaque, getSourcePath(),
+                                   m_start_time );
     }
 
     ~demux_cc()
@@ -294,6 +294,9 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
     decoder_Init( p_sys->p_decoder, p_fmt );
 
     p_sys->p_decoder->b_frame_drop_allowed = true;
+    /* Pictures are scaled down to the tile size anyway */
+    p_sys->p_decoder->i_target_width = __MAX( p_sys->i_width, 0 );
+    p_sys->p_decoder->i_target_height = __MAX( p_sys->i_height, 0 );
     p_sys->p_decoder->fmt_out = p_sys->p_decoder->fmt_in;
     p_sys->p_decoder->fmt_out.i_extra = 0;
     p_sys->p_decoder->fmt_out.p_extra = 0;
@@ -534,7 +537,16 @@ static void decoder_queue_video( decoder_t *p_dec, picture_t *p_pic )
         pic_fmt.i_sar_num = p_fmt_in->i_sar_num;
         pic_fmt.i_sar_den = p_fmt_in->i_sar_den;
 
-        p_new_pic = picture_NewFromFormat( &pic_fmt );
+        if( p_sys->p_vf2 == NULL )
+        {
+            /* The decoder does not write to a queued picture, and the
+             * mosaic only reads it: bridge it as is rather than copying
+             * it. Some video filters work in place, hence the copy below. */
+            p_pic->format = pic_fmt;
+            p_new_pic = picture_Hold( p_pic );
+        }
+        else
+            p_new_pic = picture_NewFromFormat( &pic_fmt );
         if( !p_new_pic )
         {
             picture_Release( p_pic );
@@ -542,7 +554,8 @@ static void decoder_queue_video( decoder_t *p_dec, picture_t *p_pic )
             return;
         }
 
-        picture_Copy( p_new_pic, p_pic );
+        if( p_new_pic != p_pic )
+            picture_Copy( p_new_pic, p_pic );
     }
     picture_Release( p_pic );
 
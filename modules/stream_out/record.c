@@ -314,6 +314,14 @@ static int OutputNew( sout_stream_t *p_stream,
     char *psz_output = NULL;
     int i_count;
 
+    /* Probes only look at the accepted streams, do not touch the disk */
+    if( !psz_prefix )
+    {
+        if( asprintf( &psz_output, "std{access=dummy,mux='%s'}", psz_muxer ) < 0 )
+            psz_output = NULL;
+        goto create;
+    }
+
     if( asprintf( &psz_tmp, "%s%s%s",
                   psz_prefix, psz_extension ? "." : "", psz_extension ? psz_extension : "" ) < 0 )
     {
@@ -336,6 +344,10 @@ static int OutputNew( sout_stream_t *p_stream,
         goto error;
     }
 
+create:
+    if( !psz_output )
+        goto error;
+
     /* Create the output */
     msg_Dbg( p_stream, "Using record output `%s'", psz_output );
 
@@ -455,22 +467,13 @@ static void OutputStart( sout_stream_t *p_stream )
         msg_Warn( p_stream, "failed to find an adequate muxer, probing muxers" );
         for( unsigned i = 0; i < sizeof(ppsz_muxers) / sizeof(*ppsz_muxers); i++ )
         {
-            char *psz_file;
             int i_es;
 
-            psz_file = tempnam( NULL, "vlc" );
-            if( !psz_file )
-                continue;
-
             msg_Dbg( p_stream, "probing muxer %s", ppsz_muxers[i][0] );
-            i_es = OutputNew( p_stream, ppsz_muxers[i][0], psz_file, NULL );
+            i_es = OutputNew( p_stream, ppsz_muxers[i][0], NULL, NULL );
 
             if( i_es < 0 )
-            {
-                vlc_unlink( psz_file );
-                free( psz_file );
                 continue;
-            }
 
             /* */
             for( int j = 0; j < p_sys->i_id; j++ )
@@ -493,8 +496,6 @@ static void OutputStart( sout_stream_t *p_stream )
                 if( i_best_es >= p_sys->i_id )
                     break;
             }
-            vlc_unlink( psz_file );
-            free( psz_file );
         }
 
         /* */
@@ -279,6 +279,7 @@ static int   MuxSend( sout_stream_t *, void *, block_t * );
 
 static sout_access_out_t *GrabberCreate( sout_stream_t *p_sout );
 static void* ThreadSend( void * );
+static void SendStop( sout_stream_t * );
 static void *rtp_listen_thread( void * );
 
 static void SDPHandleUrl( sout_stream_t *, const char * );
@@ -338,6 +339,19 @@ typedef struct
     vlc_mutex_t      lock_es;
     int              i_es;
     sout_stream_id_sys_t **es;
+
+    /* One thread sends the packets of all the ES */
+    struct {
+        vlc_thread_t  thread;
+        vlc_mutex_t   lock;
+        vlc_cond_t    wait;   /* new packets, or closing */
+        vlc_cond_t    idle;   /* busy ES done */
+        int           i_es;
+        sout_stream_id_sys_t **es;
+        sout_stream_id_sys_t *busy; /* ES being sent, outside of the lock */
+        bool          started;
+        bool          closing;
+    } send;
 } sout_stream_sys_t;
 
 typedef struct rtp_sink_t
@@ -381,7 +395,9 @@ struct sout_stream_id_sys_t
         vlc_thread_t  thread;
     } listen;
 
-    block_fifo_t     *p_fifo;
+    /* Packets waiting to be sent, protected by the sender lock */
+    block_t          *p_queue;
+    block_t         **pp_queue_last;
     vlc_tick_t        i_caching;
 };
 
@@ -542,6 +558,14 @@ static int Open( vlc_object_t *p_this )
     vlc_mutex_init( &p_sys->lock_sdp );
     vlc_mutex_init( &p_sys->lock_ts );
     vlc_mutex_init( &p_sys->lock_es );
+    vlc_mutex_init( &p_sys->send.lock );
+    vlc_cond_init( &p_sys->send.wait );
+    vlc_cond_init( &p_sys->send.idle );
+    p_sys->send.i_es = 0;
+    p_sys->send.es = NULL;
+    p_sys->send.busy = NULL;
+    p_sys->send.started = false;
+    p_sys->send.closing = false;
 
     psz = var_GetNonEmptyString( p_stream, SOUT_CFG_PREFIX "mux" );
     if( psz != NULL )
@@ -556,6 +580,9 @@ static int Open( vlc_object_t *p_this )
             vlc_mutex_destroy( &p_sys->lock_sdp );
             vlc_mutex_destroy( &p_sys->lock_ts );
             vlc_mutex_destroy( &p_sys->lock_es );
+            vlc_cond_destroy( &p_sys->send.idle );
+            vlc_cond_destroy( &p_sys->send.wait );
+            vlc_mutex_destroy( &p_sys->send.lock );
             free( p_sys->psz_vod_session );
             free( p_sys->psz_destination );
             free( p_sys );
@@ -573,6 +600,9 @@ static int Open( vlc_object_t *p_this )
             vlc_mutex_destroy( &p_sys->lock_sdp );
             vlc_mutex_destroy( &p_sys->lock_ts );
             vlc_mutex_destroy( &p_sys->lock_es );
+            vlc_cond_destroy( &p_sys->send.idle );
+            vlc_cond_destroy( &p_sys->send.wait );
+            vlc_mutex_destroy( &p_sys->send.lock );
             free( p_sys->psz_vod_session );
             free( p_sys->psz_destination );
             free( p_sys );
@@ -662,9 +692,14 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->rtsp != NULL )
         RtspUnsetup( p_sys->rtsp );
 
+    SendStop( p_stream );
+
     vlc_mutex_destroy( &p_sys->lock_sdp );
     vlc_mutex_destroy( &p_sys->lock_ts );
     vlc_mutex_destroy( &p_sys->lock_es );
+    vlc_cond_destroy( &p_sys->send.idle );
+    vlc_cond_destroy( &p_sys->send.wait );
+    vlc_mutex_destroy( &p_sys->send.lock );
 
     if( p_sys->p_httpd_file )
         httpd_FileDelete( p_sys->p_httpd_file );
@@ -973,7 +1008,8 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
     id->sinkc = 0;
     id->sinkv = NULL;
     id->rtsp_id = NULL;
-    id->p_fifo = NULL;
+    id->p_queue = NULL;
+    id->pp_queue_last = &id->p_queue;
     id->listen.fd = NULL;
 
     id->b_first_packet = true;
@@ -1179,15 +1215,19 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
         id->rtsp_id = RtspAddId( p_sys->rtsp, id, GetDWBE( id->ssrc ),
                                  id->rtp_fmt.clock_rate, mcast_fd );
 
-    id->p_fifo = block_FifoNew();
-    if( unlikely(id->p_fifo == NULL) )
-        goto error;
-    if( vlc_clone( &id->thread, ThreadSend, id, VLC_THREAD_PRIORITY_HIGHEST ) )
+    vlc_mutex_lock( &p_sys->send.lock );
+    if( !p_sys->send.started )
     {
-        block_FifoRelease( id->p_fifo );
-        id->p_fifo = NULL;
-        goto error;
+        if( vlc_clone( &p_sys->send.thread, ThreadSend, p_stream,
+                       VLC_THREAD_PRIORITY_HIGHEST ) )
+        {
+            vlc_mutex_unlock( &p_sys->send.lock );
+            goto error;
+        }
+        p_sys->send.started = true;
     }
+    TAB_APPEND( p_sys->send.i_es, p_sys->send.es, id );
+    vlc_mutex_unlock( &p_sys->send.lock );
 
     /* Update p_sys context */
     vlc_mutex_lock( &p_sys->lock_es );
@@ -1223,12 +1263,12 @@ static void Del( sout_stream_t *p_stream, void *_id )
     TAB_REMOVE( p_sys->i_es, p_sys->es, id );
     vlc_mutex_unlock( &p_sys->lock_es );
 
-    if( likely(id->p_fifo != NULL) )
-    {
-        vlc_cancel( id->thread );
-        vlc_join( id->thread, NULL );
-        block_FifoRelease( id->p_fifo );
-    }
+    vlc_mutex_lock( &p_sys->send.lock );
+    TAB_REMOVE( p_sys->send.i_es, p_sys->send.es, id );
+    while( p_sys->send.busy == id )
+        vlc_cond_wait( &p_sys->send.idle, &p_sys->send.lock );
+    vlc_mutex_unlock( &p_sys->send.lock );
+    block_ChainRelease( id->p_queue );
 
     free( id->rtp_fmt.fmtp );
 
@@ -1389,94 +1429,215 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
-static void* ThreadSend( void *data )
+/* Maximum number of packets of one ES sent at once to each sink */
+#define RTP_BATCH_MAX 64
+
+/* Handles a send error, returns true if the sink is broken */
+static bool rtp_send_error( int fd, const block_t *out )
 {
-#ifdef _WIN32
-# define ENOBUFS      WSAENOBUFS
-# define EAGAIN       WSAEWOULDBLOCK
-# define EWOULDBLOCK  WSAEWOULDBLOCK
-#endif
-    sout_stream_id_sys_t *id = data;
-    vlc_tick_t i_caching = id->i_caching;
+    if( net_errno == EAGAIN || net_errno == EWOULDBLOCK
+     || net_errno == ENOBUFS || net_errno == ENOMEM )
+        return false;
+
+    int type;
+    getsockopt( fd, SOL_SOCKET, SO_TYPE, &type, &(socklen_t){ sizeof(type) });
+    if( type != SOCK_DGRAM )
+        return true; /* Broken connection */
+
+    /* ICMP soft error: ignore and retry */
+    send( fd, out->p_buffer, out->i_buffer, 0 );
+    return false;
+}
+
+/* Sends packets to a sink, returns false if the sink is broken */
+static bool rtp_send_packets( int fd, block_t *const *outv, unsigned outc )
+{
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[RTP_BATCH_MAX];
+    struct iovec iovecs[RTP_BATCH_MAX];
 
-    for (;;)
+    assert( outc <= RTP_BATCH_MAX );
+    for( unsigned i = 0; i < outc; i++ )
     {
-        block_t *out = block_FifoGet( id->p_fifo );
-        block_cleanup_push (out);
+        iovecs[i].iov_base = outv[i]->p_buffer;
+        iovecs[i].iov_len = outv[i]->i_buffer;
+        memset( &msgs[i], 0, sizeof( msgs[i] ) );
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 
+    for( unsigned i = 0; i < outc; )
+    {
+        int val = sendmmsg( fd, &msgs[i], outc - i, 0 );
+        if( val > 0 )
+        {
+            i += val;
+            continue;
+        }
+        if( val < 0 && errno == EINTR )
+            continue;
+        /* skip the failing packet */
+        if( rtp_send_error( fd, outv[i] ) )
+            return false;
+        i++;
+    }
+#else
+    for( unsigned i = 0; i < outc; i++ )
+        if( send( fd, outv[i]->p_buffer, outv[i]->i_buffer, 0 ) == -1
+         && rtp_send_error( fd, outv[i] ) )
+            return false;
+#endif
+    return true;
+}
+
+static void rtp_send_batch( sout_stream_id_sys_t *id, block_t **outv,
+                            unsigned outc )
+{
 #ifdef HAVE_SRTP
-        if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
+    if( id->srtp )
+    {   /* FIXME: this is awfully inefficient */
+        unsigned n = 0;
+
+        for( unsigned i = 0; i < outc; i++ )
+        {
+            block_t *out = outv[i];
             size_t len = out->i_buffer;
             out = block_Realloc( out, 0, len + 10 );
+            if( unlikely(out == NULL) )
+                continue;
             out->i_buffer = len;
 
-            int canc = vlc_savecancel ();
             int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            vlc_restorecancel (canc);
             if( val )
             {
                 msg_Dbg( id->p_stream, "SRTP sending error: %s",
                          vlc_strerror_c(val) );
                 block_Release( out );
-                out = NULL;
+                continue;
             }
-            else
-                out->i_buffer = len;
+            out->i_buffer = len;
+            outv[n++] = out;
         }
-        if (out)
-            vlc_tick_wait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
-        if (out == NULL)
-            continue;
-#else
-        vlc_tick_wait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
+        outc = n;
+        if( outc == 0 )
+            return;
+    }
 #endif
 
-        ssize_t len = out->i_buffer;
-        int canc = vlc_savecancel ();
-
-        vlc_mutex_lock( &id->lock_sink );
-        unsigned deadc = 0; /* How many dead sockets? */
-        int deadv[id->sinkc ? id->sinkc : 1]; /* Dead sockets list */
+    vlc_mutex_lock( &id->lock_sink );
+    unsigned deadc = 0; /* How many dead sockets? */
+    int deadv[id->sinkc ? id->sinkc : 1]; /* Dead sockets list */
 
-        for( int i = 0; i < id->sinkc; i++ )
-        {
+    for( int i = 0; i < id->sinkc; i++ )
+    {
 #ifdef HAVE_SRTP
-            if( !id->srtp ) /* FIXME: SRTCP support */
+        if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+            for( unsigned j = 0; j < outc; j++ )
+                SendRTCP( id->sinkv[i].rtcp, outv[j] );
+
+        if( !rtp_send_packets( id->sinkv[i].rtp_fd, outv, outc ) )
+            deadv[deadc++] = id->sinkv[i].rtp_fd;
+    }
+    id->i_seq_sent_next = ntohs(((uint16_t *) outv[outc - 1]->p_buffer)[1]) + 1;
+    vlc_mutex_unlock( &id->lock_sink );
+
+    for( unsigned i = 0; i < outc; i++ )
+        block_Release( outv[i] );
+
+    for( unsigned i = 0; i < deadc; i++ )
+    {
+        msg_Dbg( id->p_stream, "removing socket %d", deadv[i] );
+        rtp_del_sink( id, deadv[i] );
+    }
+}
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
-             && net_errno != EAGAIN && net_errno != EWOULDBLOCK
-             && net_errno != ENOBUFS && net_errno != ENOMEM )
+/* Sends the packets of all the ES in time order, batching those that are
+ * due at the same time. */
+static void* ThreadSend( void *data )
+{
+    sout_stream_t *p_stream = data;
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    vlc_mutex_lock( &p_sys->send.lock );
+    while( !p_sys->send.closing )
+    {
+        /* Find the earliest packet */
+        sout_stream_id_sys_t *id = NULL;
+        vlc_tick_t deadline = INT64_MAX;
+
+        for( int i = 0; i < p_sys->send.i_es; i++ )
+        {
+            sout_stream_id_sys_t *es = p_sys->send.es[i];
+
+            if( es->p_queue != NULL
+             && es->p_queue->i_dts + es->i_caching < deadline )
             {
-                int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
-                            &type, &(socklen_t){ sizeof(type) });
-                if( type == SOCK_DGRAM )
-                    /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
-                else
-                    /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
+                id = es;
+                deadline = es->p_queue->i_dts + es->i_caching;
             }
         }
-        id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
-        vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
 
-        for( unsigned i = 0; i < deadc; i++ )
+        if( id == NULL )
         {
-            msg_Dbg( id->p_stream, "removing socket %d", deadv[i] );
-            rtp_del_sink( id, deadv[i] );
+            vlc_cond_wait( &p_sys->send.wait, &p_sys->send.lock );
+            continue;
         }
-        vlc_restorecancel (canc);
+
+        vlc_tick_t now = vlc_tick_now();
+        if( deadline > now )
+        {
+            vlc_cond_timedwait( &p_sys->send.wait, &p_sys->send.lock,
+                                deadline );
+            continue;
+        }
+
+        /* Dequeue the packets of this ES that are due */
+        block_t *outv[RTP_BATCH_MAX];
+        unsigned outc = 0;
+
+        while( id->p_queue != NULL && outc < RTP_BATCH_MAX
+            && id->p_queue->i_dts + id->i_caching <= now )
+        {
+            block_t *out = id->p_queue;
+
+            id->p_queue = out->p_next;
+            out->p_next = NULL;
+            outv[outc++] = out;
+        }
+        if( id->p_queue == NULL )
+            id->pp_queue_last = &id->p_queue;
+
+        p_sys->send.busy = id;
+        vlc_mutex_unlock( &p_sys->send.lock );
+
+        rtp_send_batch( id, outv, outc );
+
+        vlc_mutex_lock( &p_sys->send.lock );
+        p_sys->send.busy = NULL;
+        vlc_cond_broadcast( &p_sys->send.idle );
     }
+    vlc_mutex_unlock( &p_sys->send.lock );
     return NULL;
 }
 
+static void SendStop( sout_stream_t *p_stream )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( !p_sys->send.started )
+        return;
+
+    vlc_mutex_lock( &p_sys->send.lock );
+    p_sys->send.closing = true;
+    vlc_cond_signal( &p_sys->send.wait );
+    vlc_mutex_unlock( &p_sys->send.lock );
+
+    vlc_join( p_sys->send.thread, NULL );
+    assert( p_sys->send.i_es == 0 );
+    free( p_sys->send.es );
+}
+
 
 /* This thread dequeues incoming connections (DCCP streaming) */
 static void *rtp_listen_thread( void *data )
@@ -1656,7 +1817,15 @@ uint16_t rtp_get_extended_sequence( sout_stream_id_sys_t *id )
 
 void rtp_packetize_send( sout_stream_id_sys_t *id, block_t *out )
 {
-    block_FifoPut( id->p_fifo, out );
+    sout_stream_sys_t *p_sys = id->p_stream->p_sys;
+
+    out->p_next = NULL;
+    vlc_mutex_lock( &p_sys->send.lock );
+    if( id->p_queue == NULL )
+        vlc_cond_signal( &p_sys->send.wait ); /* earliest packet may change */
+    *id->pp_queue_last = out;
+    id->pp_queue_last = &out->p_next;
+    vlc_mutex_unlock( &p_sys->send.lock );
 }
 
 /**
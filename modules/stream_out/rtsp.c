@@ -66,10 +66,11 @@ struct rtsp_stream_t
     unsigned        track_id;
 
     int             sessionc;
-    rtsp_session_t **sessionv;
+    rtsp_session_t **sessionv; /* sorted by session ID */
 
     vlc_tick_t      timeout;
     vlc_timer_t     timer;
+    bool            timer_armed;
 };
 
 
@@ -302,6 +303,9 @@ static void RtspUpdateTimer( rtsp_stream_t *rtsp )
     if (rtsp->timeout == 0)
         return;
 
+    /* Scans all the sessions, so this is only done when the timer fires:
+     * in between, sessions can only become alive later or go away, and
+     * firing too early is harmless. */
     vlc_tick_t timeout = 0;
     for (int i = 0; i < rtsp->sessionc; i++)
     {
@@ -317,6 +321,7 @@ static void RtspUpdateTimer( rtsp_stream_t *rtsp )
     {
         vlc_timer_disarm(rtsp->timer);
     }
+    rtsp->timer_armed = timeout != 0;
 }
 
 
@@ -345,6 +350,33 @@ static void RtspTimeOut( void *data )
 }
 
 
+/** rtsp must be locked
+ * Looks a session up by ID, or the index where it should be inserted. */
+static rtsp_session_t *RtspClientFind( rtsp_stream_t *rtsp, uint64_t id,
+                                       int *pos )
+{
+    int lo = 0, hi = rtsp->sessionc;
+
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        uint64_t mid_id = rtsp->sessionv[mid]->id;
+
+        if (mid_id == id)
+        {
+            *pos = mid;
+            return rtsp->sessionv[mid];
+        }
+        if (mid_id < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *pos = lo;
+    return NULL;
+}
+
+
 /** rtsp must be locked */
 static
 rtsp_session_t *RtspClientNew( rtsp_stream_t *rtsp )
@@ -358,7 +390,13 @@ rtsp_session_t *RtspClientNew( rtsp_stream_t *rtsp )
     s->trackc = 0;
     s->trackv = NULL;
 
-    TAB_APPEND( rtsp->sessionc, rtsp->sessionv, s );
+    int i;
+    if (RtspClientFind(rtsp, s->id, &i) != NULL)
+    {   /* Collision of the random IDs */
+        free(s);
+        return NULL;
+    }
+    TAB_INSERT( rtsp->sessionc, rtsp->sessionv, s, i );
 
     return s;
 }
@@ -380,13 +418,7 @@ rtsp_session_t *RtspClientGet( rtsp_stream_t *rtsp, const char *name )
     if( errno || *end )
         return NULL;
 
-    /* FIXME: use a hash/dictionary */
-    for( i = 0; i < rtsp->sessionc; i++ )
-    {
-        if( rtsp->sessionv[i]->id == id )
-            return rtsp->sessionv[i];
-    }
-    return NULL;
+    return RtspClientFind( rtsp, id, &i );
 }
 
 
@@ -395,7 +427,8 @@ static
 void RtspClientDel( rtsp_stream_t *rtsp, rtsp_session_t *session )
 {
     int i;
-    TAB_REMOVE( rtsp->sessionc, rtsp->sessionv, session );
+    if (RtspClientFind( rtsp, session->id, &i ) == session)
+        TAB_ERASE( rtsp->sessionc, rtsp->sessionv, i );
 
     for( i = 0; i < session->trackc; i++ )
         RtspTrackClose( &session->trackv[i] );
@@ -412,7 +445,13 @@ static void RtspClientAlive( rtsp_session_t *session )
         return;
 
     session->last_seen = vlc_tick_now();
-    RtspUpdateTimer(session->stream);
+    if (!session->stream->timer_armed)
+    {
+        vlc_timer_schedule(session->stream->timer, true,
+                           session->last_seen + session->stream->timeout,
+                           VLC_TIMER_FIRE_ONCE);
+        session->stream->timer_armed = true;
+    }
 }
 
 static int dup_socket(int oldfd)
@@ -854,6 +893,13 @@ static int RtspHandler( rtsp_stream_t *rtsp, rtsp_stream_id_t *id,
                     if( psz_session == NULL )
                     {
                         ses = RtspClientNew( rtsp );
+                        if( ses == NULL )
+                        {
+                            answer->i_status = 500;
+                            vlc_mutex_unlock( &rtsp->lock );
+                            net_Close( fd );
+                            continue;
+                        }
                         snprintf( psz_sesbuf, sizeof( psz_sesbuf ), "%"PRIx64,
                                   ses->id );
                         psz_session = psz_sesbuf;
@@ -1171,7 +1217,6 @@ static int RtspHandler( rtsp_stream_t *rtsp, rtsp_stream_id_t *id,
                     RtspClientDel( rtsp, ses );
                     if (vod)
                         vod_stop(rtsp->vod_media, psz_session);
-                    RtspUpdateTimer(rtsp);
                 }
                 else /* Delete one track from the session */
                 {
@@ -36,6 +36,9 @@
  *
  * the video-data and audio-data pointers will be passed to lock/unlock function
  *
+ * Alternatively, a block callback gets the blocks of all elementary streams,
+ * raw or compressed, as they are. It owns them and must release them.
+ *
  ******************************************************************************/
 
 /*****************************************************************************
@@ -79,6 +82,14 @@
 #define T_AUDIO_DATA N_( "Audio callback data" )
 #define LT_AUDIO_DATA N_( "Data for the audio callback function." )
 
+#define T_BLOCK_CALLBACK N_( "Block callback" )
+#define LT_BLOCK_CALLBACK N_( "Address of the block callback function. " \
+                              "This function will be given the data blocks of " \
+                              "every elementary stream, without any copy." )
+
+#define T_BLOCK_DATA N_( "Block callback data" )
+#define LT_BLOCK_DATA N_( "Data for the block callback function." )
+
 #define T_TIME_SYNC N_( "Time Synchronized output" )
 #define LT_TIME_SYNC N_( "Time Synchronisation option for output. " \
                         "If true, stream will render as usual, else " \
@@ -110,6 +121,10 @@ vlc_module_begin ()
         change_volatile()
     add_string( SOUT_PREFIX_AUDIO "data", "0", T_AUDIO_DATA, LT_VIDEO_DATA, true )
         change_volatile()
+    add_string( SOUT_CFG_PREFIX "block-callback", "0", T_BLOCK_CALLBACK, LT_BLOCK_CALLBACK, true )
+        change_volatile()
+    add_string( SOUT_CFG_PREFIX "block-data", "0", T_BLOCK_DATA, LT_BLOCK_DATA, true )
+        change_volatile()
     add_bool( SOUT_CFG_PREFIX "time-sync", true, T_TIME_SYNC, LT_TIME_SYNC, true )
         change_private()
     set_callbacks( Open, Close )
@@ -121,7 +136,8 @@ vlc_module_end ()
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
     "video-prerender-callback", "audio-prerender-callback",
-    "video-postrender-callback", "audio-postrender-callback", "video-data", "audio-data", "time-sync", NULL
+    "video-postrender-callback", "audio-postrender-callback", "video-data", "audio-data",
+    "block-callback", "block-data", "time-sync", NULL
 };
 
 static void *Add( sout_stream_t *, const es_format_t * );
@@ -147,6 +163,9 @@ typedef struct
     void ( *pf_audio_prerender_callback ) ( void* p_audio_data, uint8_t** pp_pcm_buffer, size_t size );
     void ( *pf_video_postrender_callback ) ( void* p_video_data, uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch, size_t size, vlc_tick_t pts );
     void ( *pf_audio_postrender_callback ) ( void* p_audio_data, uint8_t* p_pcm_buffer, unsigned int channels, unsigned int rate, unsigned int nb_samples, unsigned int bits_per_sample, size_t size, vlc_tick_t pts );
+    /* Takes ownership of the block: no buffer is requested nor copied */
+    void ( *pf_block_callback ) ( void* p_block_data, const es_format_t *p_fmt, block_t *p_block );
+    void *p_block_data;
     bool time_sync;
 } sout_stream_sys_t;
 
@@ -232,6 +251,13 @@ static int Open( vlc_object_t *p_this )
     if (p_sys->pf_audio_postrender_callback == NULL)
         p_sys->pf_audio_postrender_callback = AudioPostrenderDefaultCallback;
 
+    psz_tmp = var_GetString( p_stream, SOUT_CFG_PREFIX "block-callback" );
+    p_sys->pf_block_callback = (void (*) (void*, const es_format_t *, block_t *))(intptr_t)atoll( psz_tmp );
+    free( psz_tmp );
+    psz_tmp = var_GetString( p_stream, SOUT_CFG_PREFIX "block-data" );
+    p_sys->p_block_data = (void *)( intptr_t )atoll( psz_tmp );
+    free( psz_tmp );
+
     /* Setting stream out module callbacks */
     p_stream->pf_add    = Add;
     p_stream->pf_del    = Del;
@@ -252,9 +278,16 @@ static void Close( vlc_object_t * p_this )
 
 static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
 {
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
     sout_stream_id_sys_t *id = NULL;
 
-    if ( p_fmt->i_cat == VIDEO_ES )
+    if ( p_sys->pf_block_callback != NULL )
+    {   /* Any elementary stream, as is */
+        id = calloc( 1, sizeof( sout_stream_id_sys_t ) );
+        if( id )
+            es_format_Copy( &id->format, p_fmt );
+    }
+    else if ( p_fmt->i_cat == VIDEO_ES )
         id = AddVideo( p_stream, p_fmt );
     else if ( p_fmt->i_cat == AUDIO_ES )
         id = AddAudio( p_stream, p_fmt );
@@ -345,7 +378,22 @@ static void Del( sout_stream_t *p_stream, void *_id )
 
 static int Send( sout_stream_t *p_stream, void *_id, block_t *p_buffer )
 {
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
     sout_stream_id_sys_t *id = (sout_stream_id_sys_t *)_id;
+
+    if ( p_sys->pf_block_callback != NULL )
+    {
+        while ( p_buffer != NULL )
+        {
+            block_t *p_next = p_buffer->p_next;
+
+            p_buffer->p_next = NULL;
+            p_sys->pf_block_callback( p_sys->p_block_data, &id->format, p_buffer );
+            p_buffer = p_next;
+        }
+        return VLC_SUCCESS;
+    }
+
     if ( id->format.i_cat == VIDEO_ES )
         return SendVideo( p_stream, id, p_buffer );
     else if ( id->format.i_cat == AUDIO_ES )
@@ -38,6 +38,7 @@ typedef struct
             unsigned int    i_width, i_maxwidth;
             unsigned int    i_height, i_maxheight;
             bool            b_hurry_up;
+            bool            b_drop_late; /* drop pictures when overloaded */
             vlc_rational_t  fps;
             struct
             {
@@ -31,6 +31,16 @@ struct transcode_encoder_t
     /* output buffers */
     block_t         *p_buffers;
     bool b_threaded;
+
+    /* Overload handling (video) */
+    bool            b_drop_late;
+    unsigned        i_queued;     /* pictures waiting for the thread */
+    unsigned        i_pool_size;
+    vlc_tick_t      i_encode_avg; /* moving average of one encode call */
+    unsigned        i_keep_ratio; /* keep one picture out of this many */
+    unsigned        i_drop_phase;
+    uint64_t        i_dropped;
+    vlc_tick_t      i_last_report;
 };
 
 int transcode_encoder_audio_open( transcode_encoder_t *p_enc,
@@ -325,6 +325,74 @@ int transcode_encoder_video_test( vlc_object_t *p_obj,
     return p_module != NULL ? VLC_SUCCESS : VLC_EGENERIC;
 }
 
+static void transcode_encoder_video_account( transcode_encoder_t *p_enc,
+                                             vlc_tick_t i_duration )
+{
+    if( p_enc->i_encode_avg == 0 )
+        p_enc->i_encode_avg = i_duration;
+    else
+        p_enc->i_encode_avg = ( p_enc->i_encode_avg * 7 + i_duration ) / 8;
+}
+
+/* Decides whether a picture is dropped instead of encoded, when the
+ * encoder can not keep up with the input frame rate. The output frame rate
+ * is first lowered to what the encoder sustains, then pictures are dropped
+ * rather than blocking the input when its queue is full. */
+static bool transcode_encoder_video_drop( transcode_encoder_t *p_enc,
+                                          vlc_tick_t i_avg, unsigned i_queued )
+{
+    const video_format_t *p_fmt = &p_enc->p_encoder->fmt_in.video;
+    vlc_tick_t i_interval = 0;
+    if( p_fmt->i_frame_rate && p_fmt->i_frame_rate_base )
+        i_interval = vlc_tick_from_samples( p_fmt->i_frame_rate_base,
+                                            p_fmt->i_frame_rate );
+
+    unsigned i_ratio = p_enc->i_keep_ratio;
+    if( i_interval > 0 )
+    {
+        unsigned i_needed = __MIN( (i_avg + i_interval - 1) / i_interval, 8 );
+        if( i_needed == 0 )
+            i_needed = 1;
+        /* Go up at once, come back down with some margin */
+        if( i_needed > i_ratio ||
+            ( i_needed < i_ratio && i_avg * 10 < i_interval * (i_ratio - 1) * 9 ) )
+            i_ratio = i_needed;
+    }
+
+    if( i_ratio != p_enc->i_keep_ratio )
+    {
+        if( i_ratio > 1 )
+            msg_Warn( p_enc->p_encoder, "encoder is late (%"PRId64" ms per "
+                      "picture), keeping one picture out of %u",
+                      MS_FROM_VLC_TICK(i_avg), i_ratio );
+        else
+            msg_Info( p_enc->p_encoder, "encoder caught up, %"PRIu64
+                      " pictures dropped so far", p_enc->i_dropped );
+        p_enc->i_keep_ratio = i_ratio;
+        p_enc->i_drop_phase = 0;
+    }
+
+    bool b_drop = ( p_enc->i_drop_phase++ % i_ratio ) != 0;
+    if( p_enc->b_threaded && i_queued >= p_enc->i_pool_size )
+        b_drop = true;
+
+    if( b_drop )
+    {
+        p_enc->i_dropped++;
+
+        vlc_tick_t i_now = vlc_tick_now();
+        if( i_now - p_enc->i_last_report >= VLC_TICK_FROM_SEC(10) )
+        {
+            msg_Dbg( p_enc->p_encoder, "encoder lag %"PRId64" ms (%u pictures "
+                     "queued), %"PRIu64" pictures dropped",
+                     MS_FROM_VLC_TICK(i_avg * i_queued), i_queued,
+                     p_enc->i_dropped );
+            p_enc->i_last_report = i_now;
+        }
+    }
+    return b_drop;
+}
+
 static void* EncoderThread( void *obj )
 {
     transcode_encoder_t *p_enc = obj;
@@ -332,6 +400,8 @@ static void* EncoderThread( void *obj )
     int canc = vlc_savecancel ();
     block_t *p_block = NULL;
 
+    vlc_thread_set_affinity( p_enc->p_encoder, "encoder" );
+
     vlc_mutex_lock( &p_enc->lock_out );
 
     for( ;; )
@@ -343,12 +413,17 @@ static void* EncoderThread( void *obj )
 
         if( p_pic )
         {
+            p_enc->i_queued--;
+
             /* release lock while encoding */
             vlc_mutex_unlock( &p_enc->lock_out );
+            vlc_tick_t i_start = vlc_tick_now();
             p_block = p_enc->p_encoder->pf_encode_video( p_enc->p_encoder, p_pic );
+            vlc_tick_t i_duration = vlc_tick_now() - i_start;
             picture_Release( p_pic );
             vlc_mutex_lock( &p_enc->lock_out );
 
+            transcode_encoder_video_account( p_enc, i_duration );
             block_ChainAppend( &p_enc->p_buffers, p_block );
         }
 
@@ -359,6 +434,7 @@ static void* EncoderThread( void *obj )
     /*Encode what we have in the buffer on closing*/
     while( (p_pic = picture_fifo_Pop( p_enc->pp_pics )) != NULL )
     {
+        p_enc->i_queued--;
         vlc_sem_post( &p_enc->picture_pool_has_room );
         p_block = p_enc->p_encoder->pf_encode_video( p_enc->p_encoder, p_pic );
         picture_Release( p_pic );
@@ -414,6 +490,10 @@ void transcode_encoder_video_close( transcode_encoder_t *p_enc )
         vlc_join( p_enc->thread, NULL );
     }
 
+    if( p_enc->i_dropped )
+        msg_Info( p_enc->p_encoder, "%"PRIu64" pictures dropped as the "
+                  "encoder was late", p_enc->i_dropped );
+
     /* Close encoder */
     module_unneed( p_enc->p_encoder, p_enc->p_encoder->p_module );
     p_enc->p_encoder->p_module = NULL;
@@ -444,6 +524,15 @@ int transcode_encoder_video_open( transcode_encoder_t *p_enc,
     p_enc->p_buffers = NULL;
     p_enc->b_abort = false;
 
+    p_enc->b_drop_late = p_cfg->video.b_drop_late;
+    p_enc->i_queued = 0;
+    p_enc->i_pool_size = p_cfg->video.threads.pool_size;
+    p_enc->i_encode_avg = 0;
+    p_enc->i_keep_ratio = 1;
+    p_enc->i_drop_phase = 0;
+    p_enc->i_dropped = 0;
+    p_enc->i_last_report = VLC_TICK_INVALID;
+
     if( p_cfg->video.threads.i_count > 0 )
     {
         if( vlc_clone( &p_enc->thread, EncoderThread, p_enc, p_cfg->video.threads.i_priority ) )
@@ -464,14 +553,34 @@ block_t * transcode_encoder_video_encode( transcode_encoder_t *p_enc, picture_t
 {
     if( !p_enc->b_threaded )
     {
-        return p_enc->p_encoder->pf_encode_video( p_enc->p_encoder, p_pic );
+        if( p_pic && p_enc->b_drop_late &&
+            transcode_encoder_video_drop( p_enc, p_enc->i_encode_avg, 0 ) )
+            return NULL;
+
+        vlc_tick_t i_start = vlc_tick_now();
+        block_t *p_block = p_enc->p_encoder->pf_encode_video( p_enc->p_encoder, p_pic );
+        if( p_pic )
+            transcode_encoder_video_account( p_enc, vlc_tick_now() - i_start );
+        return p_block;
     }
     else
     {
+        if( p_enc->b_drop_late )
+        {
+            vlc_mutex_lock( &p_enc->lock_out );
+            vlc_tick_t i_avg = p_enc->i_encode_avg;
+            unsigned i_queued = p_enc->i_queued;
+            vlc_mutex_unlock( &p_enc->lock_out );
+
+            if( transcode_encoder_video_drop( p_enc, i_avg, i_queued ) )
+                return NULL;
+        }
+
         vlc_sem_wait( &p_enc->picture_pool_has_room );
         vlc_mutex_lock( &p_enc->lock_out );
         picture_Hold( p_pic );
         picture_fifo_Push( p_enc->pp_pics, p_pic );
+        p_enc->i_queued++;
         vlc_cond_signal( &p_enc->cond );
         vlc_mutex_unlock( &p_enc->lock_out );
         return NULL;
@@ -79,6 +79,18 @@
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
     "are applied). You can enter a colon-separated list of filters." )
+#define VFILTER_DEPTH_TEXT N_("Video filter pipeline depth")
+#define VFILTER_DEPTH_LONGTEXT N_( \
+    "Runs each video filter in its own thread, so that consecutive " \
+    "pictures are filtered concurrently, with up to this number of " \
+    "pictures queued for each filter. 0 runs the filters sequentially." )
+#define RENDITIONS_TEXT N_("Additional video renditions")
+#define RENDITIONS_LONGTEXT N_( \
+    "Comma-separated list of extra video streams encoded from the same " \
+    "decoded pictures, each as <width>x<height>@<bitrate>. Width or height " \
+    "can be left out to keep the aspect ratio, as can the bitrate to use " \
+    "the main one (eg: x720@2500,x480@1000). Each rendition is scaled from " \
+    "the previous one and output as its own elementary stream." )
 
 #define AENC_TEXT N_("Audio encoder")
 #define AENC_LONGTEXT N_( \
@@ -126,6 +138,11 @@
 #define HP_LONGTEXT N_( \
     "Runs the optional encoder thread at the OUTPUT priority instead of " \
     "VIDEO." )
+#define DROP_LATE_TEXT N_("Drop pictures when the encoder is late")
+#define DROP_LATE_LONGTEXT N_( \
+    "For live streams: when the video encoder can not keep up with the " \
+    "input frame rate, lower the output frame rate and drop pictures " \
+    "instead of blocking the input and drifting behind real time." )
 #define POOL_TEXT N_("Picture pool size")
 #define POOL_LONGTEXT N_( "Defines how many pictures we allow to be in pool "\
     "between decoder/encoder threads when threads > 0" )
@@ -177,6 +194,11 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list(SOUT_CFG_PREFIX "vfilter", "video filter", NULL,
                     VFILTER_TEXT, VFILTER_LONGTEXT)
+    add_integer( SOUT_CFG_PREFIX "vfilter-depth", 0, VFILTER_DEPTH_TEXT,
+                 VFILTER_DEPTH_LONGTEXT, true )
+        change_integer_range( 0, 64 )
+    add_string( SOUT_CFG_PREFIX "vrenditions", NULL, RENDITIONS_TEXT,
+                RENDITIONS_LONGTEXT, true )
 
     set_section( N_("Audio"), NULL )
     add_module(SOUT_CFG_PREFIX "aenc", "encoder", NULL,
@@ -215,6 +237,8 @@ vlc_module_begin ()
         change_integer_range( 1, 1000 )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
+    add_bool( SOUT_CFG_PREFIX "drop-late", false, DROP_LATE_TEXT,
+              DROP_LATE_LONGTEXT, true )
 
 vlc_module_end ()
 
@@ -224,7 +248,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "vfilter-depth", "vrenditions", "drop-late", NULL
 };
 
 /*****************************************************************************
@@ -325,6 +349,7 @@ static void SetVideoEncoderConfig( sout_stream_t *p_stream, transcode_encoder_co
 
     p_cfg->video.threads.i_count = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_cfg->video.threads.pool_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "pool-size" );
+    p_cfg->video.b_drop_late = var_GetBool( p_stream, SOUT_CFG_PREFIX "drop-late" );
 
     if( var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" ) )
         p_cfg->video.threads.i_priority = VLC_THREAD_PRIORITY_OUTPUT;
@@ -332,6 +357,59 @@ static void SetVideoEncoderConfig( sout_stream_t *p_stream, transcode_encoder_co
         p_cfg->video.threads.i_priority = VLC_THREAD_PRIORITY_VIDEO;
 }
 
+static void SetVideoRenditionsConfig( sout_stream_t *p_stream, sout_stream_sys_t *p_sys )
+{
+    char *psz_string = var_GetNonEmptyString( p_stream, SOUT_CFG_PREFIX "vrenditions" );
+    if( !psz_string )
+        return;
+
+    char *psz_save;
+    for( char *psz_item = strtok_r( psz_string, ",", &psz_save );
+         psz_item != NULL; psz_item = strtok_r( NULL, ",", &psz_save ) )
+    {
+        unsigned i_width = 0, i_height = 0, i_bitrate = p_sys->venc_cfg.video.i_bitrate;
+        char *psz_end = psz_item;
+
+        while( *psz_end == ' ' )
+            psz_end++;
+        i_width = strtoul( psz_end, &psz_end, 10 );
+        if( *psz_end == 'x' )
+            i_height = strtoul( psz_end + 1, &psz_end, 10 );
+        if( *psz_end == '@' )
+        {
+            i_bitrate = strtoul( psz_end + 1, &psz_end, 10 );
+            if( i_bitrate < 16000 )
+                i_bitrate *= 1000;
+        }
+        if( *psz_end != '\0' || ( !i_width && !i_height ) )
+        {
+            msg_Warn( p_stream, "invalid video rendition `%s'", psz_item );
+            continue;
+        }
+
+        transcode_encoder_config_t *p_cfgs =
+            realloc( p_sys->p_vrenditions_cfg,
+                     (p_sys->i_vrenditions + 1) * sizeof(*p_cfgs) );
+        if( unlikely(p_cfgs == NULL) )
+            break;
+        p_sys->p_vrenditions_cfg = p_cfgs;
+
+        /* Same encoder and options as the main output, only the size and
+         * the bitrate differ */
+        transcode_encoder_config_t *p_cfg = &p_cfgs[p_sys->i_vrenditions++];
+        *p_cfg = p_sys->venc_cfg;
+        p_cfg->video.i_bitrate = i_bitrate;
+        p_cfg->video.f_scale = 0;
+        p_cfg->video.i_width = i_width;
+        p_cfg->video.i_height = i_height;
+        p_cfg->video.i_maxwidth = p_cfg->video.i_maxheight = 0;
+
+        msg_Dbg( p_stream, "video rendition %ux%u %ukb/s",
+                 i_width, i_height, i_bitrate / 1000 );
+    }
+    free( psz_string );
+}
+
 static void SetSPUEncoderConfig( sout_stream_t *p_stream, transcode_encoder_config_t *p_cfg )
 {
     char *psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "senc" );
@@ -425,6 +503,7 @@ static int Open( vlc_object_t *p_this )
                  p_sys->venc_cfg.video.f_scale,
                  p_sys->venc_cfg.video.i_bitrate / 1000 );
     }
+    SetVideoRenditionsConfig( p_stream, p_sys );
 
     /* Video Filter Parameters */
     sout_filters_config_init( &p_sys->vfilters_cfg );
@@ -435,6 +514,9 @@ static int Open( vlc_object_t *p_this )
     else
         free( psz_string );
 
+    p_sys->vfilters_cfg.video.i_pipeline =
+        var_GetInteger( p_stream, SOUT_CFG_PREFIX "vfilter-depth" );
+
     if( var_GetBool( p_stream, SOUT_CFG_PREFIX "deinterlace" ) )
     {
         psz_string = var_GetString( p_stream,
@@ -482,6 +564,7 @@ static void Close( vlc_object_t * p_this )
     sout_stream_sys_t   *p_sys = p_stream->p_sys;
 
     transcode_encoder_config_clean( &p_sys->venc_cfg );
+    free( p_sys->p_vrenditions_cfg );
     sout_filters_config_clean( &p_sys->vfilters_cfg );
 
     transcode_encoder_config_clean( &p_sys->aenc_cfg );
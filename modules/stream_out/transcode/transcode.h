@@ -16,6 +16,7 @@ typedef struct
             char            *psz_deinterlace;
             config_chain_t  *p_deinterlace_cfg;
             char            *psz_spu_sources;
+            unsigned         i_pipeline; /* queue depth per filter, 0 = sequential */
         } video;
     };
 } sout_filters_config_t;
@@ -53,6 +54,8 @@ typedef struct
     /* Video */
     transcode_encoder_config_t venc_cfg;
     sout_filters_config_t vfilters_cfg;
+    transcode_encoder_config_t *p_vrenditions_cfg; /* share venc_cfg strings */
+    size_t          i_vrenditions;
 
     /* SPU */
     transcode_encoder_config_t senc_cfg;
@@ -65,6 +68,15 @@ typedef struct
 
 struct aout_filters;
 
+/* Extra video output encoded from the pictures of the main one */
+struct transcode_rendition
+{
+    const transcode_encoder_config_t *p_enccfg;
+    transcode_encoder_t *encoder;
+    filter_chain_t      *p_f_chain; /**< Scaler from the previous output */
+    void                *downstream_id;
+};
+
 struct sout_stream_id_sys_t
 {
     bool            b_transcode;
@@ -123,6 +135,8 @@ struct sout_stream_id_sys_t
              filter_t        *p_spu_blender;
              spu_t           *p_spu;
              video_format_t  fmt_input_video;
+             struct transcode_rendition *p_renditions;
+             size_t          i_renditions;
          };
          struct
          {
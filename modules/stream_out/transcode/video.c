@@ -134,6 +134,71 @@ static picture_t *transcode_dequeue_all_pics( sout_stream_id_sys_t *id )
     return p_pics;
 }
 
+static void transcode_video_renditions_clean( sout_stream_t *p_stream,
+                                              sout_stream_id_sys_t *id )
+{
+    for( size_t i = 0; i < id->i_renditions; i++ )
+    {
+        struct transcode_rendition *r = &id->p_renditions[i];
+
+        transcode_encoder_close( r->encoder );
+        transcode_encoder_delete( r->encoder );
+        if( r->p_f_chain )
+            filter_chain_Delete( r->p_f_chain );
+        if( r->downstream_id )
+            sout_StreamIdDel( p_stream->p_next, r->downstream_id );
+    }
+    free( id->p_renditions );
+    id->p_renditions = NULL;
+    id->i_renditions = 0;
+}
+
+/* Only tests the rendition encoders, like the main one: they are opened
+ * once the format of the pictures to encode is known. */
+static int transcode_video_renditions_init( sout_stream_t *p_stream,
+                                            sout_stream_id_sys_t *id )
+{
+    const sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( p_sys->i_vrenditions == 0 )
+        return VLC_SUCCESS;
+
+    id->p_renditions = calloc( p_sys->i_vrenditions, sizeof(*id->p_renditions) );
+    if( unlikely(id->p_renditions == NULL) )
+        return VLC_ENOMEM;
+
+    for( size_t i = 0; i < p_sys->i_vrenditions; i++ )
+    {
+        struct transcode_rendition *r = &id->p_renditions[i];
+        r->p_enccfg = &p_sys->p_vrenditions_cfg[i];
+
+        es_format_t encoder_tested_fmt_in;
+        es_format_Init( &encoder_tested_fmt_in, VIDEO_ES, 0 );
+
+        if( !transcode_encoder_test( VLC_OBJECT(p_stream), r->p_enccfg,
+                                     &id->p_decoder->fmt_in,
+                                     id->p_decoder->fmt_out.i_codec,
+                                     &encoder_tested_fmt_in ) )
+        {
+            r->encoder = transcode_encoder_new( VLC_OBJECT(p_stream),
+                                                &encoder_tested_fmt_in );
+            if( r->encoder )
+                transcode_encoder_update_format_in( r->encoder,
+                                                    &encoder_tested_fmt_in );
+        }
+        es_format_Clean( &encoder_tested_fmt_in );
+
+        if( !r->encoder )
+        {
+            msg_Err( p_stream, "cannot create encoder for video rendition %zu", i );
+            transcode_video_renditions_clean( p_stream, id );
+            return VLC_EGENERIC;
+        }
+        id->i_renditions++;
+    }
+    return VLC_SUCCESS;
+}
+
 int transcode_video_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
                           sout_stream_id_sys_t *id )
 {
@@ -220,6 +285,16 @@ int transcode_video_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
 
     es_format_Clean( &encoder_tested_fmt_in );
 
+    if( transcode_video_renditions_init( p_stream, id ) )
+    {
+        transcode_encoder_delete( id->encoder );
+        module_unneed( id->p_decoder, id->p_decoder->p_module );
+        id->p_decoder->p_module = NULL;
+        video_format_Clean( &id->fmt_input_video );
+        es_format_Clean( &id->decoder_out );
+        return VLC_EGENERIC;
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -304,11 +379,156 @@ static int conversion_video_filter_append( sout_stream_id_sys_t *id,
     return VLC_SUCCESS;
 }
 
+static void tag_last_block_with_flag( block_t **out, int i_flag )
+{
+    block_t *p_last = *out;
+    if( p_last )
+    {
+        while( p_last->p_next )
+            p_last = p_last->p_next;
+        p_last->i_flags |= i_flag;
+    }
+}
+
+/* Opens the rendition encoders, each one being fed with the pictures of
+ * the previous output scaled down, so that a ladder is built by cascading
+ * cheap scalers on the decoded pictures. */
+static int transcode_video_renditions_open( sout_stream_t *p_stream,
+                                            sout_stream_id_sys_t *id )
+{
+    const es_format_t *p_src = transcode_encoder_format_in( id->encoder );
+
+    for( size_t i = 0; i < id->i_renditions; i++ )
+    {
+        struct transcode_rendition *r = &id->p_renditions[i];
+
+        if( !transcode_encoder_opened( r->encoder ) )
+        {
+            transcode_encoder_video_configure( VLC_OBJECT(p_stream),
+                                               &id->p_decoder->fmt_in.video,
+                                               &id->p_decoder->fmt_out.video,
+                                               r->p_enccfg, &p_src->video,
+                                               r->encoder );
+            if( transcode_encoder_open( r->encoder, r->p_enccfg ) != VLC_SUCCESS )
+            {
+                msg_Err( p_stream, "cannot open encoder for video rendition %zu", i );
+                return VLC_EGENERIC;
+            }
+        }
+
+        const es_format_t *p_dst = transcode_encoder_format_in( r->encoder );
+
+        if( !r->p_f_chain )
+        {
+            filter_owner_t owner = {
+                .video = &transcode_filter_video_cbs,
+                .sys = id,
+            };
+            r->p_f_chain = filter_chain_NewVideo( p_stream, false, &owner );
+            if( !r->p_f_chain )
+                return VLC_ENOMEM;
+            filter_chain_Reset( r->p_f_chain, p_src, p_dst );
+
+            if( ( p_src->video.i_chroma != p_dst->video.i_chroma ||
+                  p_src->video.i_width != p_dst->video.i_width ||
+                  p_src->video.i_height != p_dst->video.i_height ) &&
+                filter_chain_AppendConverter( r->p_f_chain, p_src, p_dst ) )
+            {
+                msg_Err( p_stream, "cannot scale video rendition %zu to %ux%u",
+                         i, p_dst->video.i_visible_width,
+                         p_dst->video.i_visible_height );
+                return VLC_EGENERIC;
+            }
+        }
+
+        if( !r->downstream_id )
+        {
+            es_format_t fmt;
+            es_format_Copy( &fmt, transcode_encoder_format_out( r->encoder ) );
+
+            /* Distinct ES, let the next stream output pick its id */
+            fmt.i_id = -1;
+            fmt.i_group = id->p_decoder->fmt_in.i_group;
+            if( !fmt.psz_language && id->p_decoder->fmt_in.psz_language )
+                fmt.psz_language = strdup( id->p_decoder->fmt_in.psz_language );
+            free( fmt.psz_description );
+            if( asprintf( &fmt.psz_description, "%ux%u",
+                          fmt.video.i_visible_width,
+                          fmt.video.i_visible_height ) == -1 )
+                fmt.psz_description = NULL;
+
+            r->downstream_id = sout_StreamIdAdd( p_stream->p_next, &fmt );
+            es_format_Clean( &fmt );
+            if( !r->downstream_id )
+            {
+                msg_Err( p_stream, "cannot output video rendition %zu", i );
+                return VLC_EGENERIC;
+            }
+        }
+
+        p_src = p_dst;
+    }
+    return VLC_SUCCESS;
+}
+
+static void transcode_video_rendition_send( sout_stream_t *p_stream,
+                                            struct transcode_rendition *r,
+                                            block_t *p_out )
+{
+    if( !p_out )
+        return;
+    if( r->downstream_id )
+        sout_StreamIdSend( p_stream->p_next, r->downstream_id, p_out );
+    else
+        block_ChainRelease( p_out );
+}
+
+static void transcode_video_renditions_encode( sout_stream_t *p_stream,
+                                               sout_stream_id_sys_t *id,
+                                               picture_t *p_pic )
+{
+    picture_t *p_src = picture_Hold( p_pic );
+
+    for( size_t i = 0; p_src && i < id->i_renditions; i++ )
+    {
+        struct transcode_rendition *r = &id->p_renditions[i];
+
+        /* Scale from the previous output, the result feeds the next one */
+        p_src = filter_chain_VideoFilter( r->p_f_chain, p_src );
+        if( p_src )
+            transcode_video_rendition_send( p_stream, r,
+                    transcode_encoder_encode( r->encoder, p_src ) );
+    }
+    if( p_src )
+        picture_Release( p_src );
+}
+
+static void transcode_video_renditions_drain( sout_stream_t *p_stream,
+                                              sout_stream_id_sys_t *id,
+                                              bool b_eos )
+{
+    for( size_t i = 0; i < id->i_renditions; i++ )
+    {
+        struct transcode_rendition *r = &id->p_renditions[i];
+        block_t *p_out = NULL;
+
+        if( !transcode_encoder_opened( r->encoder ) )
+            continue;
+        if( transcode_encoder_drain( r->encoder, &p_out ) != VLC_SUCCESS )
+            msg_Warn( p_stream, "Flushing video rendition %zu failed", i );
+        if( b_eos )
+        {
+            transcode_encoder_close( r->encoder );
+            tag_last_block_with_flag( &p_out, BLOCK_FLAG_END_OF_SEQUENCE );
+        }
+        transcode_video_rendition_send( p_stream, r, p_out );
+    }
+}
 
 void transcode_video_clean( sout_stream_t *p_stream,
                                    sout_stream_id_sys_t *id )
 {
-    VLC_UNUSED(p_stream);
+    transcode_video_renditions_clean( p_stream, id );
 
     /* Close encoder */
     transcode_encoder_close( id->encoder );
@@ -408,17 +628,71 @@ static picture_t * RenderSubpictures( sout_stream_t *p_stream, sout_stream_id_sy
     return p_pic;
 }
 
-static void tag_last_block_with_flag( block_t **out, int i_flag )
+static void transcode_video_filter_pipeline( sout_stream_t *p_stream,
+                                             sout_stream_id_sys_t *id )
 {
-    block_t *p_last = *out;
-    if( p_last )
+    unsigned i_depth = id->p_filterscfg->video.i_pipeline;
+    if( i_depth == 0 )
+        return;
+
+    if( ( id->p_f_chain &&
+          filter_chain_VideoPipeline( id->p_f_chain, i_depth ) != VLC_SUCCESS ) ||
+        ( id->p_uf_chain &&
+          filter_chain_VideoPipeline( id->p_uf_chain, i_depth ) != VLC_SUCCESS ) )
+        msg_Warn( p_stream, "cannot pipeline video filters, "
+                            "running them sequentially" );
+}
+
+static void transcode_video_encode_picture( sout_stream_t *p_stream,
+                                            sout_stream_id_sys_t *id,
+                                            picture_t *p_pic, block_t **out )
+{
+    /* Blend subpictures */
+    p_pic = RenderSubpictures( p_stream, id, p_pic );
+
+    if( p_pic )
     {
-        while( p_last->p_next )
-            p_last = p_last->p_next;
-        p_last->i_flags |= i_flag;
+        block_t *p_encoded = transcode_encoder_encode( id->encoder, p_pic );
+        if( p_encoded )
+            block_ChainAppend( out, p_encoded );
+        transcode_video_renditions_encode( p_stream, id, p_pic );
+        picture_Release( p_pic );
     }
 }
 
+static void transcode_video_user_filter( sout_stream_t *p_stream,
+                                         sout_stream_id_sys_t *id,
+                                         picture_t *p_in, block_t **out )
+{
+    for ( ;; p_in = NULL /* drain second time */ )
+    {
+        /* Run user specified filter chain */
+        if( id->p_uf_chain )
+            p_in = filter_chain_VideoFilter( id->p_uf_chain, p_in );
+
+        if( !p_in )
+            break;
+
+        transcode_video_encode_picture( p_stream, id, p_in, out );
+    }
+}
+
+/* Outputs the pictures still in the filter chains */
+static void transcode_video_filter_drain( sout_stream_t *p_stream,
+                                          sout_stream_id_sys_t *id,
+                                          block_t **out )
+{
+    picture_t *p_pic;
+
+    if( id->p_f_chain )
+        while( ( p_pic = filter_chain_VideoDrain( id->p_f_chain ) ) )
+            transcode_video_user_filter( p_stream, id, p_pic, out );
+
+    if( id->p_uf_chain )
+        while( ( p_pic = filter_chain_VideoDrain( id->p_uf_chain ) ) )
+            transcode_video_encode_picture( p_stream, id, p_pic, out );
+}
+
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                     block_t *in, block_t **out )
 {
@@ -467,6 +741,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                             id->fmt_input_video.i_sar_den, p_pic->format.i_sar_den
                         );
                 /* Close filters, encoder format input can't change */
+                transcode_video_filter_drain( p_stream, id, out );
                 if( id->p_f_chain )
                     filter_chain_Delete( id->p_f_chain );
                 id->p_f_chain = NULL;
@@ -476,6 +751,12 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                 if( id->p_spu_blender )
                     filter_DeleteBlend( id->p_spu_blender );
                 id->p_spu_blender = NULL;
+                for( size_t i = 0; i < id->i_renditions; i++ )
+                {
+                    if( id->p_renditions[i].p_f_chain )
+                        filter_chain_Delete( id->p_renditions[i].p_f_chain );
+                    id->p_renditions[i].p_f_chain = NULL;
+                }
 
                 video_format_Clean( &id->fmt_input_video );
             }
@@ -488,6 +769,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                              (id->p_enccfg->video.fps.num > 0), id );
                 if( conversion_video_filter_append( id, p_pic ) != VLC_SUCCESS )
                     goto error;
+                transcode_video_filter_pipeline( p_stream, id );
             }
 
             /* Start missing encoder */
@@ -516,6 +798,9 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                    (char *) &id->p_enccfg->i_codec );
                 goto error;
             }
+
+            if( transcode_video_renditions_open( p_stream, id ) != VLC_SUCCESS )
+                goto error;
         }
 
         /* Run the filter and output chains; first with the picture,
@@ -531,34 +816,20 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             if( !p_in )
                 break;
 
-            for ( ;; p_in = NULL /* drain second time */ )
-            {
-                /* Run user specified filter chain */
-                if( id->p_uf_chain )
-                    p_in = filter_chain_VideoFilter( id->p_uf_chain, p_in );
-
-                if( !p_in )
-                    break;
-
-                /* Blend subpictures */
-                p_in = RenderSubpictures( p_stream, id, p_in );
-
-                if( p_in )
-                {
-                    block_t *p_encoded = transcode_encoder_encode( id->encoder, p_in );
-                    if( p_encoded )
-                        block_ChainAppend( out, p_encoded );
-                    picture_Release( p_in );
-                }
-            }
+            transcode_video_user_filter( p_stream, id, p_in, out );
         }
+        /* Pick up what a pipelined user chain has ready */
+        if( id->p_uf_chain )
+            transcode_video_user_filter( p_stream, id, NULL, out );
 
         if( b_eos )
         {
             msg_Info( p_stream, "Drain/restart on EOS" );
+            transcode_video_filter_drain( p_stream, id, out );
             if( transcode_encoder_drain( id->encoder, out ) != VLC_SUCCESS )
                 goto error;
             transcode_encoder_close( id->encoder );
+            transcode_video_renditions_drain( p_stream, id, true );
             if( b_eos )
                 tag_last_block_with_flag( out, BLOCK_FLAG_END_OF_SEQUENCE );
         }
@@ -574,16 +845,21 @@ error:
     {
         /* Pick up any return data the encoder thread wants to output. */
         block_ChainAppend( out, transcode_encoder_get_output_async( id->encoder ) );
+        for( size_t i = 0; i < id->i_renditions; i++ )
+            transcode_video_rendition_send( p_stream, &id->p_renditions[i],
+                transcode_encoder_get_output_async( id->p_renditions[i].encoder ) );
     }
 
     /* Drain encoder */
     if( unlikely( !id->b_error && in == NULL ) && transcode_encoder_opened( id->encoder ) )
     {
+        transcode_video_filter_drain( p_stream, id, out );
         msg_Dbg( p_stream, "Flushing thread and waiting that");
         if( transcode_encoder_drain( id->encoder, out ) == VLC_SUCCESS )
             msg_Dbg( p_stream, "Flushing done");
         else
             msg_Warn( p_stream, "Flushing failed");
+        transcode_video_renditions_drain( p_stream, id, false );
     }
 
     if( b_eos )
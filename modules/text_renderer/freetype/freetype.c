@@ -110,6 +110,13 @@ static void Destroy( vlc_object_t * );
 #define TEXT_DIRECTION_LONGTEXT N_("Paragraph base direction for the Unicode bi-directional algorithm.")
 
 
+#define GLYPH_CACHE_TEXT N_("Glyph cache size (KiB)")
+#define GLYPH_CACHE_LONGTEXT N_("Memory used to keep the glyphs loaded and " \
+  "rendered, so that repeated text is not rasterized again. 0 disables it.")
+#define SHAPE_CACHE_TEXT N_("Shaped text cache size (KiB)")
+#define SHAPE_CACHE_LONGTEXT N_("Memory used to keep the output of the text " \
+  "shaping, so that repeated text is not shaped again. 0 disables it.")
+
 #define YUVP_TEXT N_("Use YUVP renderer")
 #define YUVP_LONGTEXT N_("This renders the font using \"paletized YUV\". " \
   "This option is only needed if you want to encode into DVB subtitles" )
@@ -211,6 +218,13 @@ vlc_module_begin ()
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
 
+    add_integer( "freetype-glyph-cache", 4096, GLYPH_CACHE_TEXT,
+                 GLYPH_CACHE_LONGTEXT, true )
+#ifdef HAVE_HARFBUZZ
+    add_integer( "freetype-shape-cache", 512, SHAPE_CACHE_TEXT,
+                 SHAPE_CACHE_LONGTEXT, true )
+#endif
+
 #ifdef HAVE_FRIBIDI
     add_integer_with_range( "freetype-text-direction", 0, 0, 2, TEXT_DIRECTION_TEXT,
                             TEXT_DIRECTION_LONGTEXT, false )
@@ -1442,6 +1456,8 @@ static int Create( vlc_object_t *p_this )
     vlc_dictionary_init( &p_sys->family_map, 50 );
     vlc_dictionary_init( &p_sys->fallback_map, 20 );
 
+    InitLayoutCaches( p_filter );
+
     p_sys->i_scale = 100;
 
     /* default style to apply to uncomplete segmeents styles */
@@ -1566,6 +1582,9 @@ static void Destroy( vlc_object_t *p_this )
     text_style_Delete( p_sys->p_default_style );
     text_style_Delete( p_sys->p_forced_style );
 
+    /* Glyphs and shaped runs of the faces */
+    CleanLayoutCaches( p_filter );
+
     /* Fonts dicts */
     vlc_dictionary_clear( &p_sys->fallback_map, FreeFamilies, p_filter );
     vlc_dictionary_clear( &p_sys->face_map, FreeFace, p_filter );
@@ -41,6 +41,8 @@
 #include <vlc_text_style.h>                             /* text_style_t */
 #include <vlc_arrays.h>                                 /* vlc_dictionary_t */
 
+#include "lru_cache.h"
+
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
@@ -110,6 +112,14 @@ typedef struct
     /** Font face cache */
     vlc_dictionary_t  face_map;
 
+    /** Loaded and rendered glyphs cache */
+    lru_cache_t       glyph_cache;
+
+#ifdef HAVE_HARFBUZZ
+    /** Shaped runs cache */
+    lru_cache_t       shape_cache;
+#endif
+
     int               i_fallback_counter;
 
     /* Current scaling of the text, default is 100 (%) */
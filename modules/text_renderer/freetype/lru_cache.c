@@ -0,0 +1,202 @@
+/*****************************************************************************
+ * lru_cache.c : Least recently used cache for the text renderer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Least recently used cache
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+
+#include "lru_cache.h"
+
+#define LRU_CACHE_MIN_BUCKETS 256
+
+struct lru_cache_entry_t
+{
+    lru_cache_entry_t *p_next;  /**< next entry in the hash bucket */
+    struct vlc_list    node;    /**< position in the usage list */
+    uint32_t           i_hash;
+    size_t             i_cost;
+    void              *p_value;
+    size_t             i_key;
+    unsigned char      key[];
+};
+
+/* FNV-1a */
+static uint32_t Hash( const void *p_key, size_t i_key )
+{
+    const unsigned char *p = p_key;
+    uint32_t i_hash = 2166136261u;
+
+    for( size_t i = 0; i < i_key; i++ )
+        i_hash = ( i_hash ^ p[i] ) * 16777619u;
+    return i_hash;
+}
+
+void LRUCache_Init( lru_cache_t *p_cache, size_t i_max_cost,
+                    void ( *pf_release )( void * ) )
+{
+    p_cache->pp_buckets = NULL;
+    p_cache->i_buckets = 0;
+    p_cache->i_count = 0;
+    p_cache->i_cost = 0;
+    p_cache->i_max_cost = i_max_cost;
+    vlc_list_init( &p_cache->lru );
+    p_cache->pf_release = pf_release;
+    p_cache->i_hits = p_cache->i_misses = p_cache->i_evictions = 0;
+}
+
+static void Unlink( lru_cache_t *p_cache, lru_cache_entry_t *p_entry )
+{
+    lru_cache_entry_t **pp = &p_cache->pp_buckets[p_entry->i_hash
+                                                  & (p_cache->i_buckets - 1)];
+    while( *pp != p_entry )
+        pp = &(*pp)->p_next;
+    *pp = p_entry->p_next;
+
+    vlc_list_remove( &p_entry->node );
+    p_cache->i_count--;
+    p_cache->i_cost -= p_entry->i_cost;
+
+    p_cache->pf_release( p_entry->p_value );
+    free( p_entry );
+}
+
+void LRUCache_Clean( lru_cache_t *p_cache )
+{
+    lru_cache_entry_t *p_entry;
+
+    vlc_list_foreach( p_entry, &p_cache->lru, node )
+    {
+        p_cache->pf_release( p_entry->p_value );
+        free( p_entry );
+    }
+    vlc_list_init( &p_cache->lru );
+    free( p_cache->pp_buckets );
+    p_cache->pp_buckets = NULL;
+    p_cache->i_buckets = p_cache->i_count = 0;
+    p_cache->i_cost = 0;
+}
+
+static lru_cache_entry_t *Find( const lru_cache_t *p_cache, uint32_t i_hash,
+                                const void *p_key, size_t i_key )
+{
+    if( p_cache->i_buckets == 0 )
+        return NULL;
+
+    lru_cache_entry_t *p_entry =
+        p_cache->pp_buckets[i_hash & (p_cache->i_buckets - 1)];
+    for( ; p_entry; p_entry = p_entry->p_next )
+        if( p_entry->i_hash == i_hash && p_entry->i_key == i_key
+         && !memcmp( p_entry->key, p_key, i_key ) )
+            break;
+    return p_entry;
+}
+
+void *LRUCache_Get( lru_cache_t *p_cache, const void *p_key, size_t i_key )
+{
+    lru_cache_entry_t *p_entry = Find( p_cache, Hash( p_key, i_key ),
+                                       p_key, i_key );
+    if( !p_entry )
+    {
+        p_cache->i_misses++;
+        return NULL;
+    }
+
+    p_cache->i_hits++;
+    vlc_list_remove( &p_entry->node );
+    vlc_list_prepend( &p_entry->node, &p_cache->lru );
+    return p_entry->p_value;
+}
+
+static int Grow( lru_cache_t *p_cache )
+{
+    unsigned i_buckets = __MAX( 2 * p_cache->i_buckets,
+                                LRU_CACHE_MIN_BUCKETS );
+    lru_cache_entry_t **pp_buckets = calloc( i_buckets, sizeof( *pp_buckets ) );
+    if( unlikely( !pp_buckets ) )
+        return VLC_ENOMEM;
+
+    lru_cache_entry_t *p_entry;
+    vlc_list_foreach( p_entry, &p_cache->lru, node )
+    {
+        lru_cache_entry_t **pp = &pp_buckets[p_entry->i_hash & (i_buckets - 1)];
+        p_entry->p_next = *pp;
+        *pp = p_entry;
+    }
+
+    free( p_cache->pp_buckets );
+    p_cache->pp_buckets = pp_buckets;
+    p_cache->i_buckets = i_buckets;
+    return VLC_SUCCESS;
+}
+
+void LRUCache_Put( lru_cache_t *p_cache, const void *p_key, size_t i_key,
+                   void *p_value, size_t i_cost )
+{
+    i_cost += sizeof( lru_cache_entry_t ) + i_key;
+    if( i_cost > p_cache->i_max_cost / 2 )
+        goto error;
+
+    if( p_cache->i_count >= p_cache->i_buckets && Grow( p_cache ) )
+        goto error;
+
+    lru_cache_entry_t *p_entry = malloc( sizeof( *p_entry ) + i_key );
+    if( unlikely( !p_entry ) )
+        goto error;
+
+    /* Make room */
+    while( p_cache->i_cost + i_cost > p_cache->i_max_cost )
+    {
+        lru_cache_entry_t *p_last =
+            vlc_list_last_entry_or_null( &p_cache->lru, lru_cache_entry_t, node );
+        Unlink( p_cache, p_last );
+        p_cache->i_evictions++;
+    }
+
+    p_entry->i_hash = Hash( p_key, i_key );
+    p_entry->i_cost = i_cost;
+    p_entry->p_value = p_value;
+    p_entry->i_key = i_key;
+    memcpy( p_entry->key, p_key, i_key );
+
+    lru_cache_entry_t **pp = &p_cache->pp_buckets[p_entry->i_hash
+                                                  & (p_cache->i_buckets - 1)];
+    p_entry->p_next = *pp;
+    *pp = p_entry;
+    vlc_list_prepend( &p_entry->node, &p_cache->lru );
+    p_cache->i_count++;
+    p_cache->i_cost += i_cost;
+    return;
+
+error:
+    p_cache->pf_release( p_value );
+}
+
+/** @} */
@@ -0,0 +1,90 @@
+/*****************************************************************************
+ * lru_cache.h : Least recently used cache for the text renderer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_LRU_CACHE_H
+#define VLC_FREETYPE_LRU_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Least recently used cache
+ *
+ * Values are indexed by binary keys, and charged an approximate memory cost.
+ * The least recently used values are released once the total cost exceeds
+ * the cache capacity.
+ */
+
+#include <vlc_list.h>
+
+typedef struct lru_cache_entry_t lru_cache_entry_t;
+
+typedef struct
+{
+    lru_cache_entry_t **pp_buckets;
+    unsigned            i_buckets;       /**< power of 2 */
+    unsigned            i_count;
+    size_t              i_cost;
+    size_t              i_max_cost;      /**< 0 disables the cache */
+    struct vlc_list     lru;             /**< most recently used first */
+    void             ( *pf_release )( void *p_value );
+
+    uint64_t            i_hits;
+    uint64_t            i_misses;
+    uint64_t            i_evictions;
+} lru_cache_t;
+
+/**
+ * Initializes a cache.
+ *
+ * \param i_max_cost capacity of the cache, in bytes, 0 to disable it
+ * \param pf_release releases the values dropped from the cache
+ */
+void LRUCache_Init( lru_cache_t *p_cache, size_t i_max_cost,
+                    void ( *pf_release )( void * ) );
+
+/**
+ * Releases all the values and the cache resources.
+ */
+void LRUCache_Clean( lru_cache_t *p_cache );
+
+static inline bool LRUCache_IsEnabled( const lru_cache_t *p_cache )
+{
+    return p_cache->i_max_cost > 0;
+}
+
+/**
+ * Looks up a value, and marks it as most recently used.
+ *
+ * \return the value, still owned by the cache, or NULL
+ */
+void *LRUCache_Get( lru_cache_t *p_cache, const void *p_key, size_t i_key );
+
+/**
+ * Adds a value, releasing the least recently used ones if needed.
+ *
+ * The cache takes ownership of the value in all cases: it is released at
+ * once if it cannot be cached. The key must not be in the cache already.
+ */
+void LRUCache_Put( lru_cache_t *p_cache, const void *p_key, size_t i_key,
+                   void *p_value, size_t i_cost );
+
+/** @} */
+
+#endif
@@ -64,6 +64,7 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "lru_cache.h"
 
 #include <stdlib.h>
 
@@ -116,6 +117,39 @@ typedef struct run_desc_t
 
 } run_desc_t;
 
+/**
+ * Key of the glyph cache entries.
+ *
+ * The loaded glyphs depend on the face, which is specific to a font file
+ * and size, on the synthesized styles and on the outline stroke. Their
+ * bitmaps only depend on the subpixel part of their origin as well.
+ */
+typedef struct glyph_key_t
+{
+    FT_Face  p_face;
+    FT_UInt  i_glyph_index;
+    FT_Fixed i_stroke_radius;
+    uint8_t  i_synthesis;           /**< GLYPH_SYNTH_* flags */
+    uint8_t  i_kind;                /**< GLYPH_KIND_* */
+    uint8_t  i_x_frac;              /**< 26.6 fractional origin of bitmaps */
+    uint8_t  i_y_frac;
+} glyph_key_t;
+
+#define GLYPH_SYNTH_BOLD          0x1
+#define GLYPH_SYNTH_ITALIC        0x2
+#define GLYPH_SYNTH_OUTLINE       0x4
+
+#define GLYPH_KIND_LOADED         0 /**< glyph and outline, and advance */
+#define GLYPH_KIND_BITMAP         1 /**< rendered glyph */
+#define GLYPH_KIND_OUTLINE_BITMAP 2 /**< rendered outline */
+
+typedef struct cached_glyph_t
+{
+    FT_Glyph  p_glyph;
+    FT_Glyph  p_outline;
+    FT_Vector advance;
+} cached_glyph_t;
+
 /**
  * Glyph bitmaps. Advance and offset are 26.6 values
  */
@@ -131,6 +165,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_key_t key;
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -739,6 +774,46 @@ static int ItemizeParagraph( filter_t *p_filter, paragraph_t *p_paragraph )
  * Glyph substitutions of base glyphs and diacritics may take place,
  * so the paragraph size may change.
  */
+/**
+ * Key of the shaped runs cache entries, followed by the code points
+ */
+typedef struct shape_key_t
+{
+    FT_Face         p_face;
+    hb_script_t     script;
+    hb_direction_t  direction;
+    int             i_length;
+} shape_key_t;
+
+static void *NewShapeKey( const paragraph_t *p_paragraph,
+                          const run_desc_t *p_run, size_t *pi_key )
+{
+    const int i_length = p_run->i_end_offset - p_run->i_start_offset;
+    const size_t i_key = sizeof( shape_key_t )
+                       + i_length * sizeof( *p_paragraph->p_code_points );
+
+    shape_key_t *p_key = malloc( i_key );
+    if( !p_key )
+        return NULL;
+
+    /* the padding is part of the key */
+    memset( p_key, 0, sizeof( *p_key ) );
+    p_key->p_face = p_run->p_face;
+    p_key->script = p_run->script;
+    p_key->direction = p_run->direction;
+    p_key->i_length = i_length;
+    memcpy( p_key + 1, p_paragraph->p_code_points + p_run->i_start_offset,
+            i_length * sizeof( *p_paragraph->p_code_points ) );
+
+    *pi_key = i_key;
+    return p_key;
+}
+
+static void ReleaseShapedRun( void *p_value )
+{
+    hb_buffer_destroy( p_value );
+}
+
 static int ShapeParagraphHarfBuzz( filter_t *p_filter,
                                    paragraph_t **p_old_paragraph )
 {
@@ -785,11 +860,31 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         else
             p_face = p_run->p_face;
 
+        /* Identical runs are shaped identically: reuse their buffers,
+         * which are not modified past this point */
+        size_t i_key = 0;
+        void *p_key = LRUCache_IsEnabled( &p_sys->shape_cache )
+                    ? NewShapeKey( p_paragraph, p_run, &i_key ) : NULL;
+        hb_buffer_t *p_cached = p_key
+                    ? LRUCache_Get( &p_sys->shape_cache, p_key, i_key ) : NULL;
+        if( p_cached )
+        {
+            free( p_key );
+            p_run->p_buffer = hb_buffer_reference( p_cached );
+            p_run->p_glyph_infos =
+                hb_buffer_get_glyph_infos( p_run->p_buffer, &p_run->i_glyph_count );
+            p_run->p_glyph_positions =
+                hb_buffer_get_glyph_positions( p_run->p_buffer, &p_run->i_glyph_count );
+            i_total_glyphs += p_run->i_glyph_count;
+            continue;
+        }
+
         p_run->p_hb_font = hb_ft_font_create( p_face, 0 );
         if( !p_run->p_hb_font )
         {
             msg_Err( p_filter,
                      "ShapeParagraphHarfBuzz(): hb_ft_font_create() error" );
+            free( p_key );
             goto error;
         }
 
@@ -798,6 +893,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         {
             msg_Err( p_filter,
                      "ShapeParagraphHarfBuzz(): hb_buffer_create() error" );
+            free( p_key );
             goto error;
         }
 
@@ -824,9 +920,19 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         {
             msg_Err( p_filter,
                      "ShapeParagraphHarfBuzz() invalid glyph count in shaped run" );
+            free( p_key );
             goto error;
         }
 
+        if( p_key )
+        {
+            LRUCache_Put( &p_sys->shape_cache, p_key, i_key,
+                          hb_buffer_reference( p_run->p_buffer ),
+                          p_run->i_glyph_count * ( sizeof( hb_glyph_info_t )
+                                            + sizeof( hb_glyph_position_t ) ) );
+            free( p_key );
+        }
+
         i_total_glyphs += p_run->i_glyph_count;
     }
 
@@ -900,7 +1006,8 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
-        hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
+        if( p_paragraph->p_runs[ i ].p_hb_font )
+            hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
         hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
     }
     FreeParagraph( *p_old_paragraph );
@@ -1014,6 +1121,193 @@ static int ZeroNsmAdvance( paragraph_t *p_paragraph )
 #endif
 #endif
 
+static size_t GlyphCost( FT_Glyph p_glyph )
+{
+    if( !p_glyph )
+        return 0;
+
+    switch( p_glyph->format )
+    {
+        case FT_GLYPH_FORMAT_BITMAP:
+        {
+            FT_BitmapGlyph p_bmp = (FT_BitmapGlyph) p_glyph;
+            return sizeof( *p_bmp )
+                 + (size_t) abs( p_bmp->bitmap.pitch ) * p_bmp->bitmap.rows;
+        }
+        case FT_GLYPH_FORMAT_OUTLINE:
+        {
+            FT_OutlineGlyph p_outline = (FT_OutlineGlyph) p_glyph;
+            return sizeof( *p_outline )
+                 + p_outline->outline.n_points * ( sizeof( FT_Vector ) + 1 )
+                 + p_outline->outline.n_contours * sizeof( short );
+        }
+        default:
+            return sizeof( FT_GlyphRec );
+    }
+}
+
+static void ReleaseCachedGlyph( void *p_value )
+{
+    cached_glyph_t *p_cached = p_value;
+
+    if( p_cached->p_glyph )
+        FT_Done_Glyph( p_cached->p_glyph );
+    if( p_cached->p_outline )
+        FT_Done_Glyph( p_cached->p_outline );
+    free( p_cached );
+}
+
+/**
+ * Stores copies of glyphs in the glyph cache
+ */
+static void CacheGlyphs( filter_sys_t *p_sys, const glyph_key_t *p_key,
+                         FT_Glyph p_glyph, FT_Glyph p_outline,
+                         const FT_Vector *p_advance )
+{
+    cached_glyph_t *p_cached = calloc( 1, sizeof( *p_cached ) );
+    if( !p_cached )
+        return;
+
+    if( FT_Glyph_Copy( p_glyph, &p_cached->p_glyph )
+     || ( p_outline && FT_Glyph_Copy( p_outline, &p_cached->p_outline ) ) )
+    {
+        ReleaseCachedGlyph( p_cached );
+        return;
+    }
+    if( p_advance )
+        p_cached->advance = *p_advance;
+
+    LRUCache_Put( &p_sys->glyph_cache, p_key, sizeof( *p_key ), p_cached,
+                  sizeof( *p_cached ) + GlyphCost( p_cached->p_glyph )
+                                      + GlyphCost( p_cached->p_outline ) );
+}
+
+/**
+ * Loads a glyph and its outline, with the synthesized styles, from the cache
+ * if possible.
+ */
+static int LoadGlyph( filter_t *p_filter, FT_Face p_face,
+                      const text_style_t *p_style, FT_UInt i_glyph_index,
+                      bool b_outline, FT_Fixed i_stroke_radius,
+                      glyph_bitmaps_t *p_bitmaps, FT_Vector *p_advance )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    glyph_key_t *p_key = &p_bitmaps->key;
+
+    memset( p_key, 0, sizeof( *p_key ) );
+    p_key->p_face = p_face;
+    p_key->i_glyph_index = i_glyph_index;
+    if( ( p_style->i_style_flags & STYLE_BOLD )
+          && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+        p_key->i_synthesis |= GLYPH_SYNTH_BOLD;
+    if( ( p_style->i_style_flags & STYLE_ITALIC )
+          && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+        p_key->i_synthesis |= GLYPH_SYNTH_ITALIC;
+    if( b_outline )
+    {
+        p_key->i_synthesis |= GLYPH_SYNTH_OUTLINE;
+        p_key->i_stroke_radius = i_stroke_radius;
+    }
+    p_key->i_kind = GLYPH_KIND_LOADED;
+
+    p_bitmaps->p_glyph = 0;
+    p_bitmaps->p_outline = 0;
+
+    const cached_glyph_t *p_cached =
+        LRUCache_Get( &p_sys->glyph_cache, p_key, sizeof( *p_key ) );
+    if( p_cached )
+    {
+        if( FT_Glyph_Copy( p_cached->p_glyph, &p_bitmaps->p_glyph ) )
+            return VLC_EGENERIC;
+        if( p_cached->p_outline
+         && FT_Glyph_Copy( p_cached->p_outline, &p_bitmaps->p_outline ) )
+            p_bitmaps->p_outline = 0;
+        *p_advance = p_cached->advance;
+        return VLC_SUCCESS;
+    }
+
+    if( FT_Load_Glyph( p_face, i_glyph_index,
+                       FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+     && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+        return VLC_EGENERIC;
+
+    if( p_key->i_synthesis & GLYPH_SYNTH_BOLD )
+        FT_GlyphSlot_Embolden( p_face->glyph );
+    if( p_key->i_synthesis & GLYPH_SYNTH_ITALIC )
+        FT_GlyphSlot_Oblique( p_face->glyph );
+
+    if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+    {
+        p_bitmaps->p_glyph = 0;
+        return VLC_EGENERIC;
+    }
+
+    if( b_outline )
+    {
+        p_bitmaps->p_outline = p_bitmaps->p_glyph;
+        if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
+                                   p_sys->p_stroker, 0, 0 ) )
+            p_bitmaps->p_outline = 0;
+    }
+
+    *p_advance = p_face->glyph->advance;
+
+    if( LRUCache_IsEnabled( &p_sys->glyph_cache ) )
+        CacheGlyphs( p_sys, p_key, p_bitmaps->p_glyph, p_bitmaps->p_outline,
+                     p_advance );
+    return VLC_SUCCESS;
+}
+
+/**
+ * Renders a glyph to a bitmap like FT_Glyph_To_Bitmap(), from the cache if
+ * possible.
+ *
+ * The bitmaps are rendered and cached at the subpixel part of the origin,
+ * and then moved by its integer part.
+ */
+static FT_Error RenderGlyph( filter_t *p_filter, FT_Glyph *pp_glyph,
+                             const glyph_key_t *p_source, uint8_t i_kind,
+                             FT_Vector *p_origin, bool b_destroy )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( (*pp_glyph)->format == FT_GLYPH_FORMAT_BITMAP )
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   p_origin, b_destroy );
+
+    FT_Vector frac = { .x = p_origin->x & 63, .y = p_origin->y & 63 };
+    glyph_key_t key = *p_source;
+    key.i_kind = i_kind;
+    key.i_x_frac = frac.x;
+    key.i_y_frac = frac.y;
+
+    FT_Glyph p_bitmap;
+    const cached_glyph_t *p_cached =
+        LRUCache_Get( &p_sys->glyph_cache, &key, sizeof( key ) );
+    if( p_cached )
+    {
+        FT_Error i_error = FT_Glyph_Copy( p_cached->p_glyph, &p_bitmap );
+        if( i_error )
+            return i_error;
+    }
+    else
+    {
+        p_bitmap = *pp_glyph;
+        FT_Error i_error = FT_Glyph_To_Bitmap( &p_bitmap, FT_RENDER_MODE_NORMAL,
+                                               &frac, 0 );
+        if( i_error )
+            return i_error;
+        if( LRUCache_IsEnabled( &p_sys->glyph_cache ) )
+            CacheGlyphs( p_sys, &key, p_bitmap, NULL, NULL );
+    }
+
+    if( b_destroy )
+        FT_Done_Glyph( *pp_glyph );
+    ShiftGlyph( (FT_BitmapGlyph) p_bitmap, p_origin->x >> 6, p_origin->y >> 6 );
+    *pp_glyph = p_bitmap;
+    return 0;
+}
+
 /**
  * Load the glyphs of a paragraph. When shaping with HarfBuzz the glyph indices
  * have already been determined at this point, as well as the advance values.
@@ -1056,14 +1350,17 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
-        if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
+        const bool b_outline = p_sys->p_stroker
+                            && (p_style->i_style_flags & STYLE_OUTLINE);
+        FT_Fixed i_stroke_radius = 0;
+        if( b_outline )
         {
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_stroke_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
-                            i_radius,
+                            i_stroke_radius,
                             FT_STROKER_LINECAP_ROUND,
                             FT_STROKER_LINEJOIN_ROUND, 0 );
         }
@@ -1118,39 +1415,22 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
-
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
-
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+            FT_Vector advance;
+            if( LoadGlyph( p_filter, p_face, p_style, i_glyph_index,
+                           b_outline, i_stroke_radius, p_bitmaps, &advance ) )
                 SKIP_GLYPH( p_bitmaps )
 
 #undef SKIP_GLYPH
 
-            if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
-            }
-
+            p_bitmaps->p_shadow = 0;
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
 
             unsigned i_x_advance = FT_FLOOR( abs( p_bitmaps->i_x_advance ) );
@@ -1257,8 +1537,10 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            const uint8_t i_kind = p_bitmaps->p_shadow == p_bitmaps->p_outline
+                                 ? GLYPH_KIND_OUTLINE_BITMAP : GLYPH_KIND_BITMAP;
+            if( RenderGlyph( p_filter, &p_bitmaps->p_shadow, &p_bitmaps->key,
+                             i_kind, &pen_shadow, false ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1266,8 +1548,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_filter, &p_bitmaps->p_glyph, &p_bitmaps->key,
+                             GLYPH_KIND_BITMAP, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1282,8 +1564,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_filter, &p_bitmaps->p_outline, &p_bitmaps->key,
+                             GLYPH_KIND_OUTLINE_BITMAP, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
@@ -1735,6 +2017,47 @@ static int LayoutRubyText( filter_t *p_filter,
     return VLC_SUCCESS;
 }
 
+void InitLayoutCaches( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    int64_t i_size;
+
+    i_size = var_InheritInteger( p_filter, "freetype-glyph-cache" );
+    LRUCache_Init( &p_sys->glyph_cache, __MAX( i_size, 0 ) * 1024,
+                   ReleaseCachedGlyph );
+#ifdef HAVE_HARFBUZZ
+    i_size = var_InheritInteger( p_filter, "freetype-shape-cache" );
+    LRUCache_Init( &p_sys->shape_cache, __MAX( i_size, 0 ) * 1024,
+                   ReleaseShapedRun );
+#endif
+}
+
+static void DumpCacheStats( filter_t *p_filter, const char *psz_name,
+                            const lru_cache_t *p_cache )
+{
+    const uint64_t i_lookups = p_cache->i_hits + p_cache->i_misses;
+    if( i_lookups == 0 )
+        return;
+
+    msg_Dbg( p_filter, "%s cache: %"PRIu64" hits, %"PRIu64" misses (%.1f%% "
+             "hit rate), %"PRIu64" evictions, %u entries, %zu KiB",
+             psz_name, p_cache->i_hits, p_cache->i_misses,
+             100. * p_cache->i_hits / i_lookups, p_cache->i_evictions,
+             p_cache->i_count, p_cache->i_cost / 1024 );
+}
+
+void CleanLayoutCaches( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    DumpCacheStats( p_filter, "glyph", &p_sys->glyph_cache );
+    LRUCache_Clean( &p_sys->glyph_cache );
+#ifdef HAVE_HARFBUZZ
+    DumpCacheStats( p_filter, "shaped runs", &p_sys->shape_cache );
+    LRUCache_Clean( &p_sys->shape_cache );
+#endif
+}
+
 int LayoutTextBlock( filter_t *p_filter,
                      const layout_text_block_t *p_textblock,
                      line_desc_t **pp_lines, FT_BBox *p_bbox,
@@ -107,3 +107,14 @@ typedef struct
  */
 int LayoutTextBlock( filter_t *p_filter, const layout_text_block_t *p_textblock,
                      line_desc_t **pp_lines, FT_BBox *p_bbox, int *pi_max_face_height );
+
+/**
+ * Sets up the caches of glyphs and shaped runs, sized by the
+ * freetype-glyph-cache and freetype-shape-cache options.
+ */
+void InitLayoutCaches( filter_t *p_filter );
+
+/**
+ * Releases the caches of glyphs and shaped runs.
+ */
+void CleanLayoutCaches( filter_t *p_filter );
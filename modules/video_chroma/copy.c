@@ -35,6 +35,10 @@
 #include <assert.h>
 
 #include "copy.h"
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
 static void CopyPlane(uint8_t *dst, size_t dst_pitch,
                       const uint8_t *src, size_t src_pitch,
                       unsigned height, int bitshift);
@@ -130,6 +134,185 @@ void CopyCleanCache(copy_cache_t *cache)
 # define vlc_CPU_SSSE3() (0)
 # undef vlc_CPU_SSE2
 # define vlc_CPU_SSE2() (0)
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() (0)
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+
+/* AVX2 versions of the copies below, processing 128 bytes per iteration.
+ * The streaming loads from the USWC memory need 32 bytes aligned sources,
+ * the cache and the destination are accessed as unaligned. */
+VLC_AVX2
+static void AVX2_CopyFromUswc(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *src, size_t src_pitch,
+                              unsigned width, unsigned height, int bitshift)
+{
+    const __m128i shift = _mm_cvtsi32_si128(bitshift >= 0 ? bitshift : -bitshift);
+
+#define AVX2_SHIFT(v) \
+    (bitshift > 0 ? _mm256_srl_epi16(v, shift) : \
+     bitshift < 0 ? _mm256_sll_epi16(v, shift) : (v))
+
+    _mm_mfence();
+
+    for (unsigned y = 0; y < height; y++) {
+        const unsigned unaligned = (-(uintptr_t)src) & 0x1f;
+        unsigned x = 0;
+
+        if (width >= 32) {
+            if (unaligned) {
+                __m256i v = _mm256_loadu_si256((const __m256i *)src);
+                _mm256_storeu_si256((__m256i *)dst, AVX2_SHIFT(v));
+            }
+            x = unaligned;
+            for (; x + 127 < width; x += 128) {
+                __m256i v0 = _mm256_stream_load_si256((__m256i *)&src[x]);
+                __m256i v1 = _mm256_stream_load_si256((__m256i *)&src[x + 32]);
+                __m256i v2 = _mm256_stream_load_si256((__m256i *)&src[x + 64]);
+                __m256i v3 = _mm256_stream_load_si256((__m256i *)&src[x + 96]);
+                _mm256_storeu_si256((__m256i *)&dst[x], AVX2_SHIFT(v0));
+                _mm256_storeu_si256((__m256i *)&dst[x + 32], AVX2_SHIFT(v1));
+                _mm256_storeu_si256((__m256i *)&dst[x + 64], AVX2_SHIFT(v2));
+                _mm256_storeu_si256((__m256i *)&dst[x + 96], AVX2_SHIFT(v3));
+            }
+            for (; x + 31 < width; x += 32) {
+                __m256i v = _mm256_stream_load_si256((__m256i *)&src[x]);
+                _mm256_storeu_si256((__m256i *)&dst[x], AVX2_SHIFT(v));
+            }
+        }
+        if (x < width)
+            CopyPlane(&dst[x], dst_pitch - x, &src[x], src_pitch - x, 1, bitshift);
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+#undef AVX2_SHIFT
+
+    _mm_mfence();
+}
+
+VLC_AVX2
+static void AVX2_Copy2d(uint8_t *dst, size_t dst_pitch,
+                        const uint8_t *src, size_t src_pitch,
+                        unsigned width, unsigned height)
+{
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        if (((intptr_t)dst & 0x1f) == 0) {
+            for (; x + 127 < width; x += 128)
+                for (unsigned i = 0; i < 128; i += 32)
+                    _mm256_stream_si256((__m256i *)&dst[x + i],
+                        _mm256_loadu_si256((const __m256i *)&src[x + i]));
+        } else {
+            for (; x + 127 < width; x += 128)
+                for (unsigned i = 0; i < 128; i += 32)
+                    _mm256_storeu_si256((__m256i *)&dst[x + i],
+                        _mm256_loadu_si256((const __m256i *)&src[x + i]));
+        }
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+    _mm_sfence();
+}
+
+VLC_AVX2
+static void AVX2_InterleaveUV(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *srcu, size_t srcu_pitch,
+                              const uint8_t *srcv, size_t srcv_pitch,
+                              unsigned width, unsigned height,
+                              uint8_t pixel_size)
+{
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        for (; x + 31 < width; x += 32) {
+            const __m256i u = _mm256_loadu_si256((const __m256i *)&srcu[x]);
+            const __m256i v = _mm256_loadu_si256((const __m256i *)&srcv[x]);
+            __m256i lo, hi;
+            if (pixel_size == 1) {
+                lo = _mm256_unpacklo_epi8(u, v);
+                hi = _mm256_unpackhi_epi8(u, v);
+            } else {
+                lo = _mm256_unpacklo_epi16(u, v);
+                hi = _mm256_unpackhi_epi16(u, v);
+            }
+            /* the unpacks work within 128-bits lanes */
+            _mm256_storeu_si256((__m256i *)&dst[2 * x],
+                                _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *)&dst[2 * x + 32],
+                                _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+
+        if (pixel_size == 1) {
+            for (; x < width; x++) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcv[x];
+            }
+        } else {
+            for (; x < width; x += 2) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcu[x + 1];
+                dst[2*x+2] = srcv[x];
+                dst[2*x+3] = srcv[x + 1];
+            }
+        }
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst += dst_pitch;
+    }
+}
+
+VLC_AVX2
+static void AVX2_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                         uint8_t *dstv, size_t dstv_pitch,
+                         const uint8_t *src, size_t src_pitch,
+                         unsigned width, unsigned height, uint8_t pixel_size)
+{
+    /* U samples to the low, V samples to the high 64 bits of each lane */
+    const __m256i shuffle = pixel_size == 1 ?
+        _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,
+                         0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15) :
+        _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                         0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        for (; x + 31 < width; x += 32) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)&src[2 * x]);
+            __m256i b = _mm256_loadu_si256((const __m256i *)&src[2 * x + 32]);
+            a = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(a, shuffle), 0xd8);
+            b = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b, shuffle), 0xd8);
+            _mm256_storeu_si256((__m256i *)&dstu[x],
+                                _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256((__m256i *)&dstv[x],
+                                _mm256_permute2x128_si256(a, b, 0x31));
+        }
+
+        if (pixel_size == 1) {
+            for (; x < width; x++) {
+                dstu[x] = src[2*x+0];
+                dstv[x] = src[2*x+1];
+            }
+        } else {
+            for (; x < width; x += 2) {
+                dstu[x] = src[2*x+0];
+                dstu[x+1] = src[2*x+1];
+                dstv[x] = src[2*x+2];
+                dstv[x+1] = src[2*x+3];
+            }
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+}
 #endif
 
 /* Optimized copy from "Uncacheable Speculative Write Combining" memory
@@ -143,6 +326,12 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
 {
     assert(((intptr_t)dst & 0x0f) == 0 && (dst_pitch & 0x0f) == 0);
 
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return AVX2_CopyFromUswc(dst, dst_pitch, src, src_pitch,
+                                 width, height, bitshift);
+#endif
+
     asm volatile ("mfence");
 
 #define SSE_USWC_COPY(shiftstr16, shiftstr64) \
@@ -213,6 +402,11 @@ static void Copy2d(uint8_t *dst, size_t dst_pitch,
 {
     assert(((intptr_t)src & 0x0f) == 0 && (src_pitch & 0x0f) == 0);
 
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return AVX2_Copy2d(dst, dst_pitch, src, src_pitch, width, height);
+#endif
+
     for (unsigned y = 0; y < height; y++) {
         unsigned x = 0;
 
@@ -243,6 +437,12 @@ SSE_InterleaveUV(uint8_t *dst, size_t dst_pitch,
     assert(!((intptr_t)srcu & 0xf) && !(srcu_pitch & 0x0f) &&
            !((intptr_t)srcv & 0xf) && !(srcv_pitch & 0x0f));
 
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return AVX2_InterleaveUV(dst, dst_pitch, srcu, srcu_pitch,
+                                 srcv, srcv_pitch, width, height, pixel_size);
+#endif
+
     static const uint8_t shuffle_8[] = { 0, 8,
                                          1, 9,
                                          2, 10,
@@ -358,6 +558,12 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
     assert(pixel_size == 1 || pixel_size == 2);
     assert(((intptr_t)src & 0xf) == 0 && (src_pitch & 0x0f) == 0);
 
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return AVX2_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                            src, src_pitch, width, height, pixel_size);
+#endif
+
 #define LOAD64 \
     "movdqa  0(%[src]), %%xmm0\n" \
     "movdqa 16(%[src]), %%xmm1\n" \
@@ -1105,8 +1311,82 @@ static picture_t *pic_new_unaligned(const video_format_t *fmt)
     return picture_NewFromResource(fmt, &rsc);
 }
 
-int main(void)
+static size_t pic_size(const picture_t *pic)
+{
+    size_t size = 0;
+    for (int i = 0; i < pic->i_planes; i++)
+        size += (size_t)pic->p[i].i_visible_pitch * pic->p[i].i_visible_lines;
+    return size;
+}
+
+/* Throughput of the conversions on a 4K picture, run with "bench" as the
+ * first argument */
+static int bench(unsigned loops)
 {
+    for (size_t i = 0; i < NB_CONVS; ++i)
+    {
+        const struct test_conv *conv = &convs[i];
+        const vlc_chroma_description_t *src_dsc =
+            vlc_fourcc_GetChromaDescription(conv->src_chroma);
+        assert(src_dsc);
+
+        video_format_t fmt;
+        video_format_Init(&fmt, 0);
+        video_format_Setup(&fmt, conv->src_chroma, 3840, 2160, 3840, 2160, 1, 1);
+        picture_t *src = picture_NewFromFormat(&fmt);
+        assert(src);
+        piccheck(src, src_dsc, true);
+
+        copy_cache_t cache;
+        int ret = CopyInitCache(&cache, src->format.i_width
+                                * src_dsc->pixel_size);
+        assert(ret == VLC_SUCCESS);
+
+        const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
+                                          src->p[U_PLANE].p_pixels,
+                                          src->p[V_PLANE].p_pixels };
+        const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
+                                           src->p[U_PLANE].i_pitch,
+                                           src->p[V_PLANE].i_pitch };
+
+        for (size_t f = 0; conv->dsts[f].chroma != 0; ++f)
+        {
+            const struct test_dst *test_dst = &conv->dsts[f];
+            fmt.i_chroma = test_dst->chroma;
+            picture_t *dst = picture_NewFromFormat(&fmt);
+            assert(dst);
+
+            vlc_tick_t start = vlc_tick_now();
+            for (unsigned n = 0; n < loops; n++)
+            {
+                if (test_dst->bitshift == 0)
+                    test_dst->conv(dst, src_planes, src_pitches,
+                                   src->format.i_visible_height, &cache);
+                else
+                    test_dst->conv16(dst, src_planes, src_pitches,
+                                     src->format.i_visible_height,
+                                     test_dst->bitshift, &cache);
+            }
+            vlc_tick_t duration = __MAX(vlc_tick_now() - start, 1);
+
+            const double frames = (double) loops * CLOCK_FREQ / duration;
+            printf("%4.4s -> %4.4s: %8.1f frames/s, %8.1f MiB/s\n",
+                   (const char *) &src->format.i_chroma,
+                   (const char *) &dst->format.i_chroma, frames,
+                   frames * pic_size(src) / (1024 * 1024));
+            picture_Release(dst);
+        }
+        picture_Release(src);
+        CopyCleanCache(&cache);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        return bench(argc > 2 ? atoi(argv[2]) : 200);
+
     alarm(10);
 
 #ifndef COPY_TEST_NOOPTIM
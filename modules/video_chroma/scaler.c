@@ -0,0 +1,1009 @@
+/*****************************************************************************
+ * scaler.c: separable bilinear, bicubic and Lanczos video scaler
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef SCALER_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+
+/*
+ * The pictures are scaled in two passes: the source rows are first filtered
+ * horizontally into 16-bits intermediate rows of the destination width, which
+ * are then filtered vertically into the destination rows. Both passes are
+ * split in bands of rows processed concurrently.
+ *
+ * The intermediate samples keep (14 - bits) fractional bits, so that the
+ * overshoot of the bicubic and Lanczos kernels still fits in 16 bits.
+ */
+
+/* Fixed point precision of the coefficients, which add up to 1 << COEF_BITS */
+#define COEF_BITS 14
+
+enum scaler_kernel
+{
+    KERNEL_BILINEAR,
+    KERNEL_BICUBIC,
+    KERNEL_LANCZOS,
+};
+
+struct scaler_format
+{
+    vlc_fourcc_t chroma;
+    uint8_t planes;
+    uint8_t bits;
+    /* left shift of the samples within their 16 bits, for P010 */
+    uint8_t msb_shift;
+    /* chroma subsampling */
+    uint8_t w_div, h_div;
+    /* both chroma components interleaved in the second plane */
+    bool semiplanar;
+};
+
+static const struct scaler_format formats[] = {
+    { VLC_CODEC_I420,          3,  8, 0, 2, 2, false },
+    { VLC_CODEC_J420,          3,  8, 0, 2, 2, false },
+    { VLC_CODEC_YV12,          3,  8, 0, 2, 2, false },
+    { VLC_CODEC_I422,          3,  8, 0, 2, 1, false },
+    { VLC_CODEC_J422,          3,  8, 0, 2, 1, false },
+    { VLC_CODEC_I440,          3,  8, 0, 1, 2, false },
+    { VLC_CODEC_J440,          3,  8, 0, 1, 2, false },
+    { VLC_CODEC_I444,          3,  8, 0, 1, 1, false },
+    { VLC_CODEC_J444,          3,  8, 0, 1, 1, false },
+    { VLC_CODEC_GBR_PLANAR,    3,  8, 0, 1, 1, false },
+    { VLC_CODEC_GREY,          1,  8, 0, 1, 1, false },
+    { VLC_CODEC_YUV420A,       4,  8, 0, 2, 2, false },
+    { VLC_CODEC_YUV422A,       4,  8, 0, 2, 1, false },
+    { VLC_CODEC_YUVA,          4,  8, 0, 1, 1, false },
+    { VLC_CODEC_NV12,          2,  8, 0, 2, 2, true  },
+    { VLC_CODEC_NV21,          2,  8, 0, 2, 2, true  },
+    { VLC_CODEC_NV16,          2,  8, 0, 2, 1, true  },
+    { VLC_CODEC_NV61,          2,  8, 0, 2, 1, true  },
+#ifndef WORDS_BIGENDIAN
+    { VLC_CODEC_I420_9L,       3,  9, 0, 2, 2, false },
+    { VLC_CODEC_I420_10L,      3, 10, 0, 2, 2, false },
+    { VLC_CODEC_I420_12L,      3, 12, 0, 2, 2, false },
+    { VLC_CODEC_I422_10L,      3, 10, 0, 2, 1, false },
+    { VLC_CODEC_I422_12L,      3, 12, 0, 2, 1, false },
+    { VLC_CODEC_I444_10L,      3, 10, 0, 1, 1, false },
+    { VLC_CODEC_I444_12L,      3, 12, 0, 1, 1, false },
+    { VLC_CODEC_GBR_PLANAR_10L,3, 10, 0, 1, 1, false },
+    { VLC_CODEC_YUVA_444_10L,  4, 10, 0, 1, 1, false },
+    { VLC_CODEC_P010,          2, 10, 6, 2, 2, true  },
+#endif
+};
+
+struct scaler_params
+{
+    uint8_t bits;
+    uint8_t msb_shift;
+};
+
+/* Filter along one direction: destination sample i is the weighted sum of
+ * the source samples [pos[i], pos[i] + size) with coefs[i * size + k] */
+struct scaler_filter
+{
+    unsigned size;
+    unsigned count;
+    int32_t *pos;
+    int16_t *coefs;
+};
+
+typedef void (*scaler_hline)(int16_t *dst, const void *src,
+                             const struct scaler_filter *,
+                             const struct scaler_params *);
+typedef void (*scaler_vline)(void *dst, const int16_t *src, ptrdiff_t stride,
+                             const int16_t *coefs, unsigned taps,
+                             unsigned width, const struct scaler_params *);
+
+struct scaler_plane
+{
+    unsigned src_x, src_y, src_w, src_h;
+    unsigned dst_x, dst_y, dst_w, dst_h;
+    unsigned components;
+    struct scaler_filter h, v;
+    scaler_hline hline;
+    /* intermediate rows, per component: src_h rows of dst_w samples */
+    int16_t *tmp;
+};
+
+struct scaler
+{
+    const struct scaler_format *format;
+    struct scaler_params params;
+    scaler_vline vline;
+    unsigned planes;
+    struct scaler_plane plane[4];
+};
+
+/*****************************************************************************
+ * Coefficients
+ *****************************************************************************/
+static double Sinc(double x)
+{
+    if (x == 0.)
+        return 1.;
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static double Kernel(enum scaler_kernel kernel, double x)
+{
+    x = fabs(x);
+    switch (kernel)
+    {
+        case KERNEL_BILINEAR:
+            return x < 1. ? 1. - x : 0.;
+        case KERNEL_BICUBIC: /* Keys, a = -0.5 */
+            if (x < 1.)
+                return (1.5 * x - 2.5) * x * x + 1.;
+            if (x < 2.)
+                return ((-0.5 * x + 2.5) * x - 4.) * x + 2.;
+            return 0.;
+        case KERNEL_LANCZOS:
+            return x < 3. ? Sinc(x) * Sinc(x / 3.) : 0.;
+    }
+    vlc_assert_unreachable();
+}
+
+static unsigned KernelRadius(enum scaler_kernel kernel)
+{
+    switch (kernel)
+    {
+        case KERNEL_BILINEAR: return 1;
+        case KERNEL_BICUBIC:  return 2;
+        case KERNEL_LANCZOS:  return 3;
+    }
+    vlc_assert_unreachable();
+}
+
+static void FilterClean(struct scaler_filter *f)
+{
+    free(f->pos);
+    free(f->coefs);
+}
+
+/**
+ * Computes the filter scaling src samples to dst samples.
+ *
+ * The kernel is stretched when downscaling, so that every source sample
+ * contributes. The weights of the samples beyond the edges are folded onto
+ * the edge samples, and the size is rounded up to a multiple of align if the
+ * windows still fit in the source.
+ */
+static int FilterInit(struct scaler_filter *f, unsigned src, unsigned dst,
+                      enum scaler_kernel kernel, unsigned align)
+{
+    const double scale = (double)src / dst;
+    const double stretch = scale > 1. ? scale : 1.;
+    const double support = KernelRadius(kernel) * stretch;
+
+    unsigned size = lround(ceil(2. * support)) + 1;
+    if (size > src)
+        size = src;
+    else if (((size + align - 1) / align) * align <= src)
+        size = ((size + align - 1) / align) * align;
+
+    f->size = size;
+    f->count = dst;
+    f->pos = vlc_alloc(dst, sizeof (*f->pos));
+    f->coefs = vlc_alloc(dst, size * sizeof (*f->coefs));
+    double *weights = vlc_alloc(size, sizeof (*weights));
+    if (unlikely(f->pos == NULL || f->coefs == NULL || weights == NULL))
+    {
+        free(weights);
+        FilterClean(f);
+        return VLC_ENOMEM;
+    }
+
+    for (unsigned i = 0; i < dst; i++)
+    {
+        const double center = (i + .5) * scale - .5;
+        int first = lround(floor(center - support)) + 1;
+        int last = lround(floor(center + support));
+
+        /* center the window on the kernel, and keep it within the source */
+        int pos = (first + last + 1 - (int)size) / 2;
+        if (pos > (int)(src - size))
+            pos = src - size;
+        if (pos < 0)
+            pos = 0;
+        f->pos[i] = pos;
+
+        for (unsigned k = 0; k < size; k++)
+            weights[k] = 0.;
+
+        double sum = 0.;
+        for (int j = first; j <= last; j++)
+        {
+            double w = Kernel(kernel, (j - center) / stretch);
+            int k = VLC_CLIP(j, 0, (int)src - 1) - pos;
+
+            if (k < 0)
+                k = 0;
+            else if (k >= (int)size)
+                k = size - 1;
+            weights[k] += w;
+            sum += w;
+        }
+
+        /* normalize, and put the rounding error on the largest weight */
+        int16_t *coefs = &f->coefs[i * size];
+        int total = 0;
+        unsigned largest = 0;
+        for (unsigned k = 0; k < size; k++)
+        {
+            coefs[k] = lround(weights[k] / sum * (1 << COEF_BITS));
+            total += coefs[k];
+            if (coefs[k] > coefs[largest])
+                largest = k;
+        }
+        coefs[largest] += (1 << COEF_BITS) - total;
+    }
+    free(weights);
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Lines
+ *****************************************************************************/
+static void HScale8_C(int16_t *dst, const void *src8,
+                      const struct scaler_filter *f,
+                      const struct scaler_params *p)
+{
+    const uint8_t *src = src8;
+    const int round = 1 << (p->bits - 1);
+
+    for (unsigned x = 0; x < f->count; x++)
+    {
+        const uint8_t *s = &src[f->pos[x]];
+        const int16_t *c = &f->coefs[x * f->size];
+        int sum = 0;
+
+        for (unsigned k = 0; k < f->size; k++)
+            sum += s[k] * c[k];
+        dst[x] = (sum + round) >> p->bits;
+    }
+}
+
+static void HScale16_C(int16_t *dst, const void *src16,
+                       const struct scaler_filter *f,
+                       const struct scaler_params *p)
+{
+    const uint16_t *src = src16;
+    const int round = 1 << (p->bits - 1);
+
+    for (unsigned x = 0; x < f->count; x++)
+    {
+        const uint16_t *s = &src[f->pos[x]];
+        const int16_t *c = &f->coefs[x * f->size];
+        int sum = 0;
+
+        for (unsigned k = 0; k < f->size; k++)
+            sum += (s[k] >> p->msb_shift) * c[k];
+        dst[x] = (sum + round) >> p->bits;
+    }
+}
+
+static inline int VSum(const int16_t *src, ptrdiff_t stride,
+                       const int16_t *coefs, unsigned taps, unsigned x,
+                       const struct scaler_params *p)
+{
+    const unsigned shift = 2 * COEF_BITS - p->bits;
+    int sum = 1 << (shift - 1);
+
+    for (unsigned k = 0; k < taps; k++)
+        sum += src[k * stride + x] * coefs[k];
+    return VLC_CLIP(sum >> shift, 0, (1 << p->bits) - 1);
+}
+
+static void VScale8_C(void *dst8, const int16_t *src, ptrdiff_t stride,
+                      const int16_t *coefs, unsigned taps, unsigned width,
+                      const struct scaler_params *p)
+{
+    uint8_t *dst = dst8;
+
+    for (unsigned x = 0; x < width; x++)
+        dst[x] = VSum(src, stride, coefs, taps, x, p);
+}
+
+static void VScale16_C(void *dst16, const int16_t *src, ptrdiff_t stride,
+                       const int16_t *coefs, unsigned taps, unsigned width,
+                       const struct scaler_params *p)
+{
+    uint16_t *dst = dst16;
+
+    for (unsigned x = 0; x < width; x++)
+        dst[x] = VSum(src, stride, coefs, taps, x, p) << p->msb_shift;
+}
+
+#ifdef HAVE_AVX2_INTRINSICS
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+
+/* Returns the sums of 8 (8-bits or 16-bits) source samples from the windows of
+ * two consecutive destination samples, one per 128-bits lane */
+VLC_AVX2
+static inline __m256i AVX2_HPair(const uint8_t *src8, const uint16_t *src16,
+                                 const struct scaler_filter *f,
+                                 unsigned x, unsigned k, __m128i shift)
+{
+    __m128i a, b;
+
+    if (src8 != NULL)
+    {
+        a = _mm_cvtepu8_epi16(_mm_loadl_epi64((const void *)
+                                              &src8[f->pos[x] + k]));
+        b = _mm_cvtepu8_epi16(_mm_loadl_epi64((const void *)
+                                              &src8[f->pos[x + 1] + k]));
+    }
+    else
+    {
+        a = _mm_srl_epi16(_mm_loadu_si128((const void *)
+                                          &src16[f->pos[x] + k]), shift);
+        b = _mm_srl_epi16(_mm_loadu_si128((const void *)
+                                          &src16[f->pos[x + 1] + k]), shift);
+    }
+
+    __m256i s = _mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1);
+    __m256i c = _mm256_inserti128_si256(_mm256_castsi128_si256(
+        _mm_loadu_si128((const void *)&f->coefs[x * f->size + k])),
+        _mm_loadu_si128((const void *)&f->coefs[(x + 1) * f->size + k]), 1);
+    return _mm256_madd_epi16(s, c);
+}
+
+/* Requires the filter size to be a multiple of 8 */
+VLC_AVX2
+static inline unsigned AVX2_HScale(int16_t *dst, const uint8_t *src8,
+                                   const uint16_t *src16,
+                                   const struct scaler_filter *f,
+                                   const struct scaler_params *p)
+{
+    const __m128i shift = _mm_cvtsi32_si128(p->msb_shift);
+    const __m128i bits = _mm_cvtsi32_si128(p->bits);
+    const __m256i round = _mm256_set1_epi32(1 << (p->bits - 1));
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    unsigned x = 0;
+
+    for (; x + 8 <= f->count; x += 8)
+    {
+        __m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0;
+
+        for (unsigned k = 0; k < f->size; k += 8)
+        {
+            s0 = _mm256_add_epi32(s0, AVX2_HPair(src8, src16, f, x + 0, k, shift));
+            s1 = _mm256_add_epi32(s1, AVX2_HPair(src8, src16, f, x + 2, k, shift));
+            s2 = _mm256_add_epi32(s2, AVX2_HPair(src8, src16, f, x + 4, k, shift));
+            s3 = _mm256_add_epi32(s3, AVX2_HPair(src8, src16, f, x + 6, k, shift));
+        }
+
+        /* lane 0 ends with the sums of the even samples, lane 1 the odd */
+        __m256i sum = _mm256_hadd_epi32(_mm256_hadd_epi32(s0, s1),
+                                        _mm256_hadd_epi32(s2, s3));
+        sum = _mm256_permutevar8x32_epi32(sum, order);
+        sum = _mm256_sra_epi32(_mm256_add_epi32(sum, round), bits);
+        sum = _mm256_permute4x64_epi64(_mm256_packs_epi32(sum, sum), 0x08);
+        _mm_storeu_si128((void *)&dst[x], _mm256_castsi256_si128(sum));
+    }
+    return x;
+}
+
+VLC_AVX2
+static void HScale8_AVX2(int16_t *dst, const void *src8,
+                         const struct scaler_filter *f,
+                         const struct scaler_params *p)
+{
+    const uint8_t *src = src8;
+    const int round = 1 << (p->bits - 1);
+
+    for (unsigned x = AVX2_HScale(dst, src, NULL, f, p); x < f->count; x++)
+    {
+        const uint8_t *s = &src[f->pos[x]];
+        const int16_t *c = &f->coefs[x * f->size];
+        int sum = 0;
+
+        for (unsigned k = 0; k < f->size; k++)
+            sum += s[k] * c[k];
+        dst[x] = (sum + round) >> p->bits;
+    }
+}
+
+VLC_AVX2
+static void HScale16_AVX2(int16_t *dst, const void *src16,
+                          const struct scaler_filter *f,
+                          const struct scaler_params *p)
+{
+    const uint16_t *src = src16;
+    const int round = 1 << (p->bits - 1);
+
+    for (unsigned x = AVX2_HScale(dst, NULL, src, f, p); x < f->count; x++)
+    {
+        const uint16_t *s = &src[f->pos[x]];
+        const int16_t *c = &f->coefs[x * f->size];
+        int sum = 0;
+
+        for (unsigned k = 0; k < f->size; k++)
+            sum += (s[k] >> p->msb_shift) * c[k];
+        dst[x] = (sum + round) >> p->bits;
+    }
+}
+
+/* Returns the 16 vertically filtered samples from x, in 16 bits */
+VLC_AVX2
+static inline __m256i AVX2_VSum(const int16_t *src, ptrdiff_t stride,
+                                const int16_t *coefs, unsigned taps,
+                                unsigned x, const struct scaler_params *p)
+{
+    const unsigned shift = 2 * COEF_BITS - p->bits;
+    const __m256i round = _mm256_set1_epi32(1 << (shift - 1));
+    __m256i lo = round, hi = round;
+    unsigned k = 0;
+
+    /* interleave the rows by pairs, to multiply them with pairs of taps */
+    for (; k + 2 <= taps; k += 2)
+    {
+        __m256i a = _mm256_loadu_si256((const void *)&src[k * stride + x]);
+        __m256i b = _mm256_loadu_si256((const void *)&src[(k + 1) * stride + x]);
+        __m256i c = _mm256_set1_epi32((uint16_t)coefs[k]
+                                      | ((uint32_t)(uint16_t)coefs[k + 1] << 16));
+
+        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), c));
+        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), c));
+    }
+    if (k < taps)
+    {
+        __m256i a = _mm256_loadu_si256((const void *)&src[k * stride + x]);
+        __m256i z = _mm256_setzero_si256();
+        __m256i c = _mm256_set1_epi32((uint16_t)coefs[k]);
+
+        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, z), c));
+        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, z), c));
+    }
+
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    return _mm256_packs_epi32(_mm256_sra_epi32(lo, count),
+                              _mm256_sra_epi32(hi, count));
+}
+
+VLC_AVX2
+static void VScale8_AVX2(void *dst8, const int16_t *src, ptrdiff_t stride,
+                         const int16_t *coefs, unsigned taps, unsigned width,
+                         const struct scaler_params *p)
+{
+    uint8_t *dst = dst8;
+    unsigned x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i v = AVX2_VSum(src, stride, coefs, taps, x, p);
+
+        v = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+        _mm_storeu_si128((void *)&dst[x], _mm256_castsi256_si128(v));
+    }
+    for (; x < width; x++)
+        dst[x] = VSum(src, stride, coefs, taps, x, p);
+}
+
+VLC_AVX2
+static void VScale16_AVX2(void *dst16, const int16_t *src, ptrdiff_t stride,
+                          const int16_t *coefs, unsigned taps, unsigned width,
+                          const struct scaler_params *p)
+{
+    uint16_t *dst = dst16;
+    const __m256i max = _mm256_set1_epi16((1 << p->bits) - 1);
+    const __m128i shift = _mm_cvtsi32_si128(p->msb_shift);
+    unsigned x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i v = AVX2_VSum(src, stride, coefs, taps, x, p);
+
+        v = _mm256_min_epi16(_mm256_max_epi16(v, _mm256_setzero_si256()), max);
+        _mm256_storeu_si256((void *)&dst[x], _mm256_sll_epi16(v, shift));
+    }
+    for (; x < width; x++)
+        dst[x] = VSum(src, stride, coefs, taps, x, p) << p->msb_shift;
+}
+#endif
+
+/*****************************************************************************
+ * Pictures
+ *****************************************************************************/
+static void ScalerClean(struct scaler *sc)
+{
+    for (unsigned i = 0; i < sc->planes; i++)
+    {
+        FilterClean(&sc->plane[i].h);
+        FilterClean(&sc->plane[i].v);
+        free(sc->plane[i].tmp);
+    }
+}
+
+static void PlaneGeometry(unsigned *x, unsigned *w, unsigned offset,
+                          unsigned visible, unsigned div)
+{
+    *x = offset / div;
+    *w = (offset + visible + div - 1) / div - *x;
+}
+
+static int ScalerInit(struct scaler *sc, const struct scaler_format *format,
+                      const video_format_t *in, const video_format_t *out,
+                      enum scaler_kernel kernel, bool simd)
+{
+    const bool wide = format->bits > 8;
+    scaler_hline hline = wide ? HScale16_C : HScale8_C;
+    scaler_hline hline_simd = hline;
+
+    sc->format = format;
+    sc->params.bits = format->bits;
+    sc->params.msb_shift = format->msb_shift;
+    sc->vline = wide ? VScale16_C : VScale8_C;
+    sc->planes = 0;
+#ifdef HAVE_AVX2_INTRINSICS
+    if (simd)
+    {
+        hline_simd = wide ? HScale16_AVX2 : HScale8_AVX2;
+        sc->vline = wide ? VScale16_AVX2 : VScale8_AVX2;
+    }
+#else
+    VLC_UNUSED(simd);
+#endif
+
+    for (unsigned i = 0; i < format->planes; i++)
+    {
+        struct scaler_plane *p = &sc->plane[i];
+        const bool chroma = i == 1 || i == 2;
+        const unsigned w_div = chroma ? format->w_div : 1;
+        const unsigned h_div = chroma ? format->h_div : 1;
+
+        PlaneGeometry(&p->src_x, &p->src_w, in->i_x_offset,
+                      in->i_visible_width, w_div);
+        PlaneGeometry(&p->src_y, &p->src_h, in->i_y_offset,
+                      in->i_visible_height, h_div);
+        PlaneGeometry(&p->dst_x, &p->dst_w, out->i_x_offset,
+                      out->i_visible_width, w_div);
+        PlaneGeometry(&p->dst_y, &p->dst_h, out->i_y_offset,
+                      out->i_visible_height, h_div);
+        p->components = (format->semiplanar && i == 1) ? 2 : 1;
+        p->tmp = NULL;
+
+        if (FilterInit(&p->h, p->src_w, p->dst_w, kernel, 8))
+            goto error;
+        if (FilterInit(&p->v, p->src_h, p->dst_h, kernel, 1))
+        {
+            FilterClean(&p->h);
+            goto error;
+        }
+        sc->planes++;
+
+        p->hline = (p->h.size % 8) ? hline : hline_simd;
+        p->tmp = vlc_alloc(p->components * p->src_h,
+                           p->dst_w * sizeof (*p->tmp));
+        if (unlikely(p->tmp == NULL))
+            goto error;
+    }
+    return VLC_SUCCESS;
+
+error:
+    ScalerClean(sc);
+    return VLC_ENOMEM;
+}
+
+struct scaler_job
+{
+    const struct scaler *sc;
+    const struct scaler_plane *p;
+    const plane_t *src;
+    plane_t *dst;
+    bool swap_uv;
+};
+
+static void Deinterleave(void *u, void *v, const void *uv, unsigned width,
+                         bool wide)
+{
+    if (wide)
+    {
+        const uint16_t *s = uv;
+        uint16_t *a = u, *b = v;
+        for (unsigned x = 0; x < width; x++)
+        {
+            a[x] = s[2 * x];
+            b[x] = s[2 * x + 1];
+        }
+    }
+    else
+    {
+        const uint8_t *s = uv;
+        uint8_t *a = u, *b = v;
+        for (unsigned x = 0; x < width; x++)
+        {
+            a[x] = s[2 * x];
+            b[x] = s[2 * x + 1];
+        }
+    }
+}
+
+static void HorizontalRows(void *opaque, unsigned first, unsigned count)
+{
+    const struct scaler_job *job = opaque;
+    const struct scaler_plane *p = job->p;
+    const unsigned bytes = job->sc->params.bits > 8 ? 2 : 1;
+    const size_t tmp_plane = (size_t)p->src_h * p->dst_w;
+    uint8_t *split = NULL;
+
+    if (p->components > 1)
+    {
+        split = malloc(2 * p->src_w * bytes);
+        if (unlikely(split == NULL))
+            return;
+    }
+
+    for (unsigned y = first; y < first + count; y++)
+    {
+        const uint8_t *row = &job->src->p_pixels[(p->src_y + y)
+                                                 * job->src->i_pitch
+                                                 + p->src_x * p->components * bytes];
+        int16_t *tmp = &p->tmp[(size_t)y * p->dst_w];
+
+        if (split != NULL)
+        {
+            uint8_t *u = split, *v = split + p->src_w * bytes;
+
+            Deinterleave(u, v, row, p->src_w, bytes > 1);
+            p->hline(tmp, u, &p->h, &job->sc->params);
+            p->hline(tmp + tmp_plane, v, &p->h, &job->sc->params);
+        }
+        else
+            p->hline(tmp, row, &p->h, &job->sc->params);
+    }
+    free(split);
+}
+
+static void VerticalRows(void *opaque, unsigned first, unsigned count)
+{
+    const struct scaler_job *job = opaque;
+    const struct scaler_plane *p = job->p;
+    const struct scaler *sc = job->sc;
+    const unsigned bytes = sc->params.bits > 8 ? 2 : 1;
+    const size_t tmp_plane = (size_t)p->src_h * p->dst_w;
+    uint8_t *split = NULL;
+
+    if (p->components > 1)
+    {
+        split = malloc(2 * p->dst_w * bytes);
+        if (unlikely(split == NULL))
+            return;
+    }
+
+    for (unsigned y = first; y < first + count; y++)
+    {
+        uint8_t *row = &job->dst->p_pixels[(p->dst_y + y) * job->dst->i_pitch
+                                           + p->dst_x * p->components * bytes];
+        const int16_t *tmp = &p->tmp[(size_t)p->v.pos[y] * p->dst_w];
+        const int16_t *coefs = &p->v.coefs[y * p->v.size];
+
+        if (split == NULL)
+        {
+            sc->vline(row, tmp, p->dst_w, coefs, p->v.size, p->dst_w,
+                      &sc->params);
+            continue;
+        }
+
+        uint8_t *u = split, *v = split + p->dst_w * bytes;
+        sc->vline(u, tmp, p->dst_w, coefs, p->v.size, p->dst_w, &sc->params);
+        sc->vline(v, tmp + tmp_plane, p->dst_w, coefs, p->v.size, p->dst_w,
+                  &sc->params);
+
+        if (bytes > 1)
+        {
+            const uint16_t *a = (const uint16_t *)u, *b = (const uint16_t *)v;
+            uint16_t *d = (uint16_t *)row;
+            for (unsigned x = 0; x < p->dst_w; x++)
+            {
+                d[2 * x] = a[x];
+                d[2 * x + 1] = b[x];
+            }
+        }
+        else
+            for (unsigned x = 0; x < p->dst_w; x++)
+            {
+                row[2 * x] = u[x];
+                row[2 * x + 1] = v[x];
+            }
+    }
+    free(split);
+}
+
+static void ScalePicture(const struct scaler *sc, picture_t *dst,
+                         const picture_t *src)
+{
+    for (unsigned i = 0; i < sc->planes; i++)
+    {
+        struct scaler_job job = {
+            .sc = sc,
+            .p = &sc->plane[i],
+            .src = &src->p[i],
+            .dst = &dst->p[i],
+        };
+
+        filter_ParallelRows(job.p->src_h, HorizontalRows, &job);
+        filter_ParallelRows(job.p->dst_h, VerticalRows, &job);
+    }
+}
+
+#ifndef SCALER_TEST
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int Open(vlc_object_t *);
+static void Close(vlc_object_t *);
+
+#define KERNEL_TEXT N_("Scaling kernel")
+#define KERNEL_LONGTEXT N_( \
+    "Interpolation used to resize the pictures. Bilinear is the fastest, " \
+    "Lanczos the sharpest.")
+
+static const char *const kernel_values[] = {
+    "bilinear", "bicubic", "lanczos",
+};
+static const char *const kernel_texts[] = {
+    N_("Bilinear"), N_("Bicubic"), N_("Lanczos"),
+};
+
+vlc_module_begin ()
+    set_description(N_("Video scaling filter"))
+    set_shortname(N_("Scaler"))
+    set_category(CAT_VIDEO)
+    set_subcategory(SUBCAT_VIDEO_VFILTER)
+    set_capability("video converter", 160)
+    add_string("scaler-kernel", "bicubic", KERNEL_TEXT, KERNEL_LONGTEXT, true)
+        change_string_list(kernel_values, kernel_texts)
+    set_callbacks(Open, Close)
+vlc_module_end ()
+
+static const struct scaler_format *FindFormat(vlc_fourcc_t chroma)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(formats); i++)
+        if (formats[i].chroma == chroma)
+            return &formats[i];
+    return NULL;
+}
+
+static void Scale(filter_t *filter, picture_t *src, picture_t *dst)
+{
+    ScalePicture(filter->p_sys, dst, src);
+}
+
+VIDEO_FILTER_WRAPPER(Scale)
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    const video_format_t *in = &filter->fmt_in.video;
+    video_format_t *out = &filter->fmt_out.video;
+
+    /* scaling only */
+    if (in->i_chroma != out->i_chroma
+     || in->orientation != out->orientation
+     || in->i_visible_width == 0 || in->i_visible_height == 0
+     || out->i_visible_width == 0 || out->i_visible_height == 0
+     || (in->i_visible_width == out->i_visible_width
+      && in->i_visible_height == out->i_visible_height))
+        return VLC_EGENERIC;
+
+    const struct scaler_format *format = FindFormat(in->i_chroma);
+    if (format == NULL)
+        return VLC_EGENERIC;
+
+    struct scaler *sc = malloc(sizeof (*sc));
+    if (unlikely(sc == NULL))
+        return VLC_ENOMEM;
+
+    enum scaler_kernel kernel = KERNEL_BICUBIC;
+    char *name = var_InheritString(filter, "scaler-kernel");
+    for (size_t i = 0; name != NULL && i < ARRAY_SIZE(kernel_values); i++)
+        if (!strcmp(name, kernel_values[i]))
+            kernel = i;
+    free(name);
+
+    bool simd = false;
+#ifdef HAVE_AVX2_INTRINSICS
+    simd = vlc_CPU_AVX2();
+#endif
+    if (ScalerInit(sc, format, in, out, kernel, simd))
+    {
+        free(sc);
+        return VLC_ENOMEM;
+    }
+
+    video_format_ScaleCropAr(out, in);
+
+    msg_Dbg(filter, "%4.4s %ux%u to %ux%u, %s kernel, %u taps",
+            (const char *)&in->i_chroma,
+            in->i_visible_width, in->i_visible_height,
+            out->i_visible_width, out->i_visible_height,
+            kernel_values[kernel], sc->plane[0].h.size);
+
+    filter->p_sys = sc;
+    filter->pf_video_filter = Scale_Filter;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    struct scaler *sc = filter->p_sys;
+
+    ScalerClean(sc);
+    free(sc);
+}
+
+#else /* SCALER_TEST */
+
+static void FillRandom(picture_t *pic, const struct scaler_format *format,
+                       unsigned *seed)
+{
+    /* keep the high bytes of the 16-bits samples within their range */
+    const unsigned high_mask = ((1 << format->bits) - 1) << format->msb_shift >> 8;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        for (int j = 0; j < p->i_pitch * p->i_lines; j++)
+        {
+            *seed = *seed * 1103515245 + 12345;
+            p->p_pixels[j] = *seed >> 16;
+            if (format->bits > 8 && (j & 1))
+                p->p_pixels[j] &= high_mask;
+            else if (format->msb_shift)
+                p->p_pixels[j] &= 0xff << format->msb_shift;
+        }
+    }
+}
+
+static double Bench(const struct scaler *sc, picture_t *dst,
+                    const picture_t *src, unsigned loops)
+{
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned n = 0; n < loops; n++)
+        ScalePicture(sc, dst, src);
+    vlc_tick_t duration = __MAX(vlc_tick_now() - start, 1);
+
+    return (double) loops * dst->format.i_visible_width
+           * dst->format.i_visible_height * CLOCK_FREQ / duration / 1000000.;
+}
+
+/* Checks the vectorized scalers against the C ones on random pictures, and
+ * reports the throughput of both with "bench" as first argument */
+int main(int argc, char **argv)
+{
+    const bool bench = argc > 1 && !strcmp(argv[1], "bench");
+    const unsigned loops = argc > 2 ? atoi(argv[2]) : 20;
+    static const unsigned sizes[][4] = {
+        { 2, 2, 5, 3 }, { 17, 5, 2, 2 }, { 33, 17, 64, 40 },
+        { 640, 360, 213, 120 }, { 120, 68, 1280, 720 },
+        { 1920, 1080, 1280, 720 },
+    };
+    unsigned seed = 1;
+
+    alarm(bench ? 0 : 30);
+
+#ifdef HAVE_AVX2_INTRINSICS
+    if (!bench && !vlc_CPU_AVX2())
+#else
+    if (!bench)
+#endif
+    {
+        fprintf(stderr, "WARNING: could not test AVX2\n");
+        return 77;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(formats); i++)
+    {
+        const struct scaler_format *format = &formats[i];
+        const unsigned bytes = format->bits > 8 ? 2 : 1;
+
+        for (size_t j = 0; j < ARRAY_SIZE(sizes); j++)
+        {
+            if (bench && sizes[j][0] != 1920)
+                continue;
+
+            video_format_t in, out;
+            video_format_Init(&in, 0);
+            video_format_Setup(&in, format->chroma, sizes[j][0], sizes[j][1],
+                               sizes[j][0], sizes[j][1], 1, 1);
+            video_format_Init(&out, 0);
+            video_format_Setup(&out, format->chroma, sizes[j][2], sizes[j][3],
+                               sizes[j][2], sizes[j][3], 1, 1);
+
+            picture_t *src = picture_NewFromFormat(&in);
+            picture_t *dst = picture_NewFromFormat(&out);
+            picture_t *ref = picture_NewFromFormat(&out);
+            assert(src && dst && ref);
+            FillRandom(src, format, &seed);
+
+            for (unsigned kernel = KERNEL_BILINEAR; kernel <= KERNEL_LANCZOS;
+                 kernel++)
+            {
+                struct scaler c, simd;
+                int ret = ScalerInit(&c, format, &in, &out, kernel, false);
+                assert(ret == VLC_SUCCESS);
+                ret = ScalerInit(&simd, format, &in, &out, kernel, true);
+                assert(ret == VLC_SUCCESS);
+
+                if (bench)
+                {
+                    printf("%4.4s %ux%u -> %ux%u kernel %u: "
+                           "C %8.1f Mpixels/s",
+                           (const char *)&format->chroma,
+                           sizes[j][0], sizes[j][1], sizes[j][2], sizes[j][3],
+                           kernel, Bench(&c, ref, src, loops));
+#ifdef HAVE_AVX2_INTRINSICS
+                    if (vlc_CPU_AVX2())
+                        printf(", AVX2 %8.1f Mpixels/s",
+                               Bench(&simd, dst, src, loops));
+#endif
+                    printf("\n");
+                }
+                else
+                {
+                    fprintf(stderr, "testing: %ux%u -> %ux%u %4.4s kernel %u\n",
+                            sizes[j][0], sizes[j][1], sizes[j][2],
+                            sizes[j][3], (const char *)&format->chroma,
+                            kernel);
+                    ScalePicture(&c, ref, src);
+                    ScalePicture(&simd, dst, src);
+
+                    for (unsigned p = 0; p < c.planes; p++)
+                    {
+                        const struct scaler_plane *sp = &c.plane[p];
+                        for (unsigned y = 0; y < sp->dst_h; y++)
+                            assert(!memcmp(&ref->p[p].p_pixels[y * ref->p[p].i_pitch],
+                                           &dst->p[p].p_pixels[y * dst->p[p].i_pitch],
+                                           sp->dst_w * sp->components * bytes));
+                    }
+                }
+                ScalerClean(&simd);
+                ScalerClean(&c);
+            }
+            picture_Release(ref);
+            picture_Release(dst);
+            picture_Release(src);
+        }
+    }
+    return 0;
+}
+
+#endif /* SCALER_TEST */
@@ -0,0 +1,664 @@
+/*****************************************************************************
+ * yuv_rgb.c: 8 and 10-bits 4:2:0 YUV to 32-bits RGB conversions
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef YUV_RGB_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+
+/* Fixed point precision of the coefficients. It is limited by the chroma
+ * coefficients being used as signed 16-bits values. */
+#define COEF_BITS 13
+
+struct yuv_rgb_params
+{
+    int32_t y_offset;
+    int32_t y_coef;
+    int32_t uv_offset;
+    /* chroma contributions, as (U, V) pairs */
+    int16_t r[2], g[2], b[2];
+    /* byte offsets of the components in the output pixels */
+    uint8_t offsets[4]; /* R, G, B, A */
+    /* left shift of the samples within their 16 bits, for P010 */
+    uint8_t msb_shift;
+};
+
+typedef void (*yuv_rgb_line)(uint8_t *dst, const uint8_t *y,
+                             const uint8_t *u, const uint8_t *v,
+                             unsigned width, const struct yuv_rgb_params *);
+
+static void SetupParams(struct yuv_rgb_params *p, video_color_space_t space,
+                        bool full_range, unsigned bits)
+{
+    double kr, kb;
+
+    switch (space)
+    {
+        case COLOR_SPACE_BT601:
+            kr = 0.299;  kb = 0.114;  break;
+        case COLOR_SPACE_BT2020:
+            kr = 0.2627; kb = 0.0593; break;
+        case COLOR_SPACE_BT709:
+        default:
+            kr = 0.2126; kb = 0.0722; break;
+    }
+    const double kg = 1. - kr - kb;
+    const double one = 1 << COEF_BITS;
+    const unsigned shift = bits - 8;
+    double y_scale, c_scale;
+
+    if (full_range)
+    {
+        p->y_offset = 0;
+        y_scale = 255. / ((1 << bits) - 1);
+        c_scale = y_scale;
+    }
+    else
+    {
+        p->y_offset = 16 << shift;
+        y_scale = 255. / (219 << shift);
+        c_scale = 255. / (224 << shift);
+    }
+    p->uv_offset = 128 << shift;
+    p->y_coef = lround(y_scale * one);
+
+    p->r[0] = 0;
+    p->r[1] = lround(2. * (1. - kr) * c_scale * one);
+    p->g[0] = lround(-2. * (1. - kb) * kb / kg * c_scale * one);
+    p->g[1] = lround(-2. * (1. - kr) * kr / kg * c_scale * one);
+    p->b[0] = lround(2. * (1. - kb) * c_scale * one);
+    p->b[1] = 0;
+}
+
+static inline uint8_t Clip8(int32_t v)
+{
+    v = (v + (1 << (COEF_BITS - 1))) >> COEF_BITS;
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static inline void PutPixel(uint8_t *dst, int32_t y, int32_t u, int32_t v,
+                            const struct yuv_rgb_params *p)
+{
+    y = (y - p->y_offset) * p->y_coef;
+    u -= p->uv_offset;
+    v -= p->uv_offset;
+    dst[p->offsets[0]] = Clip8(y + p->r[0] * u + p->r[1] * v);
+    dst[p->offsets[1]] = Clip8(y + p->g[0] * u + p->g[1] * v);
+    dst[p->offsets[2]] = Clip8(y + p->b[0] * u + p->b[1] * v);
+    dst[p->offsets[3]] = 0xff;
+}
+
+static void Line8P(uint8_t *dst, const uint8_t *y, const uint8_t *u,
+                   const uint8_t *v, unsigned width,
+                   const struct yuv_rgb_params *p)
+{
+    for (unsigned x = 0; x < width; x++)
+        PutPixel(&dst[4 * x], y[x], u[x / 2], v[x / 2], p);
+}
+
+static void Line16P(uint8_t *dst, const uint8_t *y8, const uint8_t *u8,
+                    const uint8_t *v8, unsigned width,
+                    const struct yuv_rgb_params *p)
+{
+    const uint16_t *y = (const uint16_t *)y8;
+    const uint16_t *u = (const uint16_t *)u8;
+    const uint16_t *v = (const uint16_t *)v8;
+
+    for (unsigned x = 0; x < width; x++)
+        PutPixel(&dst[4 * x], y[x], u[x / 2], v[x / 2], p);
+}
+
+/* Semi-planar lines get the interleaved chroma in u, and NULL for v, the
+ * NV21 order being handled by swapping the chroma coefficients */
+static void Line8SP(uint8_t *dst, const uint8_t *y, const uint8_t *uv,
+                    const uint8_t *unused, unsigned width,
+                    const struct yuv_rgb_params *p)
+{
+    (void) unused;
+    for (unsigned x = 0; x < width; x++)
+        PutPixel(&dst[4 * x], y[x], uv[x & ~1], uv[x | 1], p);
+}
+
+static void Line16SP(uint8_t *dst, const uint8_t *y8, const uint8_t *uv8,
+                     const uint8_t *unused, unsigned width,
+                     const struct yuv_rgb_params *p)
+{
+    const uint16_t *y = (const uint16_t *)y8;
+    const uint16_t *uv = (const uint16_t *)uv8;
+    const unsigned s = p->msb_shift;
+
+    (void) unused;
+    for (unsigned x = 0; x < width; x++)
+        PutPixel(&dst[4 * x], y[x] >> s, uv[x & ~1] >> s, uv[x | 1] >> s, p);
+}
+
+#ifdef HAVE_AVX2_INTRINSICS
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+
+struct avx2_params
+{
+    __m256i y_offset, y_coef, uv_offset, round;
+    __m256i r, g, b; /* (U, V) coefficient pairs */
+    __m256i dup_lo, dup_hi;
+};
+
+VLC_AVX2
+static inline void AVX2_SetupParams(struct avx2_params *a,
+                                    const struct yuv_rgb_params *p)
+{
+    a->y_offset = _mm256_set1_epi32(p->y_offset);
+    a->y_coef = _mm256_set1_epi32(p->y_coef);
+    a->uv_offset = _mm256_set1_epi16(p->uv_offset);
+    a->round = _mm256_set1_epi32(1 << (COEF_BITS - 1));
+    a->r = _mm256_set1_epi32((uint16_t)p->r[0] | ((uint32_t)(uint16_t)p->r[1] << 16));
+    a->g = _mm256_set1_epi32((uint16_t)p->g[0] | ((uint32_t)(uint16_t)p->g[1] << 16));
+    a->b = _mm256_set1_epi32((uint16_t)p->b[0] | ((uint32_t)(uint16_t)p->b[1] << 16));
+    a->dup_lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    a->dup_hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+}
+
+/* One component of 16 pixels, from the scaled luma of pixels 0-7 and 8-15
+ * and the contribution of the 8 chroma samples, as ordered 16-bits values
+ * clipped to 0-255 */
+VLC_AVX2
+static inline __m256i AVX2_Component(__m256i y_lo, __m256i y_hi, __m256i uv,
+                                     __m256i coefs,
+                                     const struct avx2_params *a)
+{
+    const __m256i c = _mm256_madd_epi16(uv, coefs);
+    __m256i lo = _mm256_add_epi32(y_lo, _mm256_permutevar8x32_epi32(c, a->dup_lo));
+    __m256i hi = _mm256_add_epi32(y_hi, _mm256_permutevar8x32_epi32(c, a->dup_hi));
+    lo = _mm256_srai_epi32(_mm256_add_epi32(lo, a->round), COEF_BITS);
+    hi = _mm256_srai_epi32(_mm256_add_epi32(hi, a->round), COEF_BITS);
+
+    /* packs works within 128-bits lanes */
+    __m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xd8);
+    v = _mm256_max_epi16(v, _mm256_setzero_si256());
+    return _mm256_min_epi16(v, _mm256_set1_epi16(255));
+}
+
+/* Converts and stores 16 pixels, from their 16 luma samples as two sets
+ * of 8 32-bits values, and their 8 (U, V) pairs of 16-bits values */
+VLC_AVX2
+static inline void AVX2_Pixels16(uint8_t *dst, __m256i y_lo, __m256i y_hi,
+                                  __m256i uv, const struct avx2_params *a,
+                                  const struct yuv_rgb_params *p)
+{
+    y_lo = _mm256_mullo_epi32(_mm256_sub_epi32(y_lo, a->y_offset), a->y_coef);
+    y_hi = _mm256_mullo_epi32(_mm256_sub_epi32(y_hi, a->y_offset), a->y_coef);
+    uv = _mm256_sub_epi16(uv, a->uv_offset);
+
+    __m256i comp[4];
+    comp[p->offsets[0]] = AVX2_Component(y_lo, y_hi, uv, a->r, a);
+    comp[p->offsets[1]] = AVX2_Component(y_lo, y_hi, uv, a->g, a);
+    comp[p->offsets[2]] = AVX2_Component(y_lo, y_hi, uv, a->b, a);
+    comp[p->offsets[3]] = _mm256_set1_epi16(255);
+
+    const __m256i c01 = _mm256_or_si256(comp[0], _mm256_slli_epi16(comp[1], 8));
+    const __m256i c23 = _mm256_or_si256(comp[2], _mm256_slli_epi16(comp[3], 8));
+    const __m256i lo = _mm256_unpacklo_epi16(c01, c23); /* pixels 0-3, 8-11 */
+    const __m256i hi = _mm256_unpackhi_epi16(c01, c23); /* pixels 4-7, 12-15 */
+    _mm256_storeu_si256((__m256i *)&dst[0], _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *)&dst[32], _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+VLC_AVX2
+static inline __m256i AVX2_PlanarChroma(__m128i u, __m128i v)
+{
+    return _mm256_set_m128i(_mm_unpackhi_epi16(u, v), _mm_unpacklo_epi16(u, v));
+}
+
+VLC_AVX2
+static void AVX2_Line8P(uint8_t *dst, const uint8_t *y, const uint8_t *u,
+                        const uint8_t *v, unsigned width,
+                        const struct yuv_rgb_params *p)
+{
+    struct avx2_params a;
+    AVX2_SetupParams(&a, p);
+
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i y_lo = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&y[x]));
+        const __m256i y_hi = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&y[x + 8]));
+        const __m128i uu = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)&u[x / 2]));
+        const __m128i vv = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)&v[x / 2]));
+        AVX2_Pixels16(&dst[4 * x], y_lo, y_hi, AVX2_PlanarChroma(uu, vv), &a, p);
+    }
+    Line8P(&dst[4 * x], &y[x], &u[x / 2], &v[x / 2], width - x, p);
+}
+
+VLC_AVX2
+static void AVX2_Line16P(uint8_t *dst, const uint8_t *y8, const uint8_t *u8,
+                         const uint8_t *v8, unsigned width,
+                         const struct yuv_rgb_params *p)
+{
+    const uint16_t *y = (const uint16_t *)y8;
+    const uint16_t *u = (const uint16_t *)u8;
+    const uint16_t *v = (const uint16_t *)v8;
+    struct avx2_params a;
+    AVX2_SetupParams(&a, p);
+
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i y_lo = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&y[x]));
+        const __m256i y_hi = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&y[x + 8]));
+        const __m128i uu = _mm_loadu_si128((const __m128i *)&u[x / 2]);
+        const __m128i vv = _mm_loadu_si128((const __m128i *)&v[x / 2]);
+        AVX2_Pixels16(&dst[4 * x], y_lo, y_hi, AVX2_PlanarChroma(uu, vv), &a, p);
+    }
+    Line16P(&dst[4 * x], (const uint8_t *)&y[x], (const uint8_t *)&u[x / 2],
+            (const uint8_t *)&v[x / 2], width - x, p);
+}
+
+VLC_AVX2
+static void AVX2_Line8SP(uint8_t *dst, const uint8_t *y, const uint8_t *uv,
+                         const uint8_t *unused, unsigned width,
+                         const struct yuv_rgb_params *p)
+{
+    struct avx2_params a;
+    AVX2_SetupParams(&a, p);
+
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i y_lo = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&y[x]));
+        const __m256i y_hi = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&y[x + 8]));
+        const __m256i c = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&uv[x]));
+        AVX2_Pixels16(&dst[4 * x], y_lo, y_hi, c, &a, p);
+    }
+    Line8SP(&dst[4 * x], &y[x], &uv[x], unused, width - x, p);
+}
+
+VLC_AVX2
+static void AVX2_Line16SP(uint8_t *dst, const uint8_t *y8, const uint8_t *uv8,
+                          const uint8_t *unused, unsigned width,
+                          const struct yuv_rgb_params *p)
+{
+    const uint16_t *y = (const uint16_t *)y8;
+    const uint16_t *uv = (const uint16_t *)uv8;
+    const __m128i s = _mm_cvtsi32_si128(p->msb_shift);
+    struct avx2_params a;
+    AVX2_SetupParams(&a, p);
+
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i y0 = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)&y[x]), s);
+        const __m128i y1 = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)&y[x + 8]), s);
+        const __m256i c = _mm256_srl_epi16(_mm256_loadu_si256((const __m256i *)&uv[x]), s);
+        AVX2_Pixels16(&dst[4 * x], _mm256_cvtepu16_epi32(y0),
+                      _mm256_cvtepu16_epi32(y1), c, &a, p);
+    }
+    Line16SP(&dst[4 * x], (const uint8_t *)&y[x], (const uint8_t *)&uv[x],
+             unused, width - x, p);
+}
+#endif
+
+static void ConvertPicture(picture_t *dst, const picture_t *src,
+                           unsigned width, unsigned height, yuv_rgb_line line,
+                           const struct yuv_rgb_params *p)
+{
+    const bool planar = src->i_planes == 3;
+
+    for (unsigned j = 0; j < height; j++)
+    {
+        const uint8_t *u = &src->p[1].p_pixels[(j / 2) * src->p[1].i_pitch];
+        const uint8_t *v = planar ?
+            &src->p[2].p_pixels[(j / 2) * src->p[2].i_pitch] : NULL;
+
+        line(&dst->p[0].p_pixels[j * dst->p[0].i_pitch],
+             &src->p[0].p_pixels[j * src->p[0].i_pitch], u, v, width, p);
+    }
+}
+
+struct yuv_rgb_format
+{
+    vlc_fourcc_t chroma;
+    unsigned bits;
+    bool swap_uv;
+    uint8_t msb_shift;
+    yuv_rgb_line line;
+#ifdef HAVE_AVX2_INTRINSICS
+    yuv_rgb_line line_avx2;
+#endif
+};
+
+#ifdef HAVE_AVX2_INTRINSICS
+# define LINES(name) name, AVX2_##name
+#else
+# define LINES(name) name
+#endif
+
+static const struct yuv_rgb_format formats[] = {
+    { VLC_CODEC_I420,     8,  false, 0, LINES(Line8P) },
+    { VLC_CODEC_J420,     8,  false, 0, LINES(Line8P) },
+    { VLC_CODEC_YV12,     8,  true,  0, LINES(Line8P) },
+    { VLC_CODEC_NV12,     8,  false, 0, LINES(Line8SP) },
+    { VLC_CODEC_NV21,     8,  true,  0, LINES(Line8SP) },
+    { VLC_CODEC_I420_10L, 10, false, 0, LINES(Line16P) },
+    { VLC_CODEC_P010,     10, false, 6, LINES(Line16SP) },
+};
+#undef LINES
+
+/* Coefficients, YV12 being handled as I420 and NV21 as NV12 with swapped
+ * chroma coefficients */
+static void SetupFormat(struct yuv_rgb_params *p,
+                        const struct yuv_rgb_format *format,
+                        const video_format_t *fmt)
+{
+    video_color_space_t space = fmt->space;
+    if (space == COLOR_SPACE_UNDEF)
+        space = fmt->i_visible_height > 576 ? COLOR_SPACE_BT709
+                                            : COLOR_SPACE_BT601;
+    bool full_range = fmt->color_range == COLOR_RANGE_FULL
+                   || (fmt->color_range == COLOR_RANGE_UNDEF
+                    && format->chroma == VLC_CODEC_J420);
+
+    SetupParams(p, space, full_range, format->bits);
+    p->msb_shift = format->msb_shift;
+
+    if (format->swap_uv)
+    {
+        int16_t t;
+        t = p->r[0]; p->r[0] = p->r[1]; p->r[1] = t;
+        t = p->g[0]; p->g[0] = p->g[1]; p->g[1] = t;
+        t = p->b[0]; p->b[0] = p->b[1]; p->b[1] = t;
+    }
+}
+
+static int GetRGBOffsets(const video_format_t *fmt, uint8_t offsets[4])
+{
+    static const struct
+    {
+        vlc_fourcc_t chroma;
+        uint8_t offsets[4];
+    } rgbs[] = {
+        { VLC_CODEC_RGBA, { 0, 1, 2, 3 } },
+        { VLC_CODEC_BGRA, { 2, 1, 0, 3 } },
+        { VLC_CODEC_ARGB, { 1, 2, 3, 0 } },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(rgbs); i++)
+        if (rgbs[i].chroma == fmt->i_chroma)
+        {
+            memcpy(offsets, rgbs[i].offsets, 4);
+            return VLC_SUCCESS;
+        }
+
+    if (fmt->i_chroma != VLC_CODEC_RGB32)
+        return VLC_EGENERIC;
+
+    /* The masks are in native endianness */
+    uint32_t masks[3] = { fmt->i_rmask, fmt->i_gmask, fmt->i_bmask };
+    if (!masks[0] && !masks[1] && !masks[2])
+    {
+        masks[0] = 0x00ff0000;
+        masks[1] = 0x0000ff00;
+        masks[2] = 0x000000ff;
+    }
+
+    unsigned used = 0;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        unsigned byte;
+        switch (masks[i])
+        {
+            case 0x000000ff: byte = 0; break;
+            case 0x0000ff00: byte = 1; break;
+            case 0x00ff0000: byte = 2; break;
+            case 0xff000000: byte = 3; break;
+            default: return VLC_EGENERIC;
+        }
+#ifdef WORDS_BIGENDIAN
+        byte = 3 - byte;
+#endif
+        if (used & (1 << byte))
+            return VLC_EGENERIC;
+        used |= 1 << byte;
+        offsets[i] = byte;
+    }
+    offsets[3] = ctz(~used);
+    return VLC_SUCCESS;
+}
+
+#ifndef YUV_RGB_TEST
+static const struct yuv_rgb_format *FindFormat(vlc_fourcc_t chroma)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(formats); i++)
+        if (formats[i].chroma == chroma)
+            return &formats[i];
+    return NULL;
+}
+
+typedef struct
+{
+    yuv_rgb_line line;
+    struct yuv_rgb_params params;
+} filter_sys_t;
+
+static void Convert(filter_t *filter, picture_t *src, picture_t *dst)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const video_format_t *fmt = &filter->fmt_in.video;
+
+    dst->format.i_x_offset = src->format.i_x_offset;
+    dst->format.i_y_offset = src->format.i_y_offset;
+    ConvertPicture(dst, src, fmt->i_x_offset + fmt->i_visible_width,
+                   fmt->i_y_offset + fmt->i_visible_height, sys->line,
+                   &sys->params);
+}
+
+VIDEO_FILTER_WRAPPER(Convert)
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    const video_format_t *in = &filter->fmt_in.video;
+    const video_format_t *out = &filter->fmt_out.video;
+
+    /* resizing not supported */
+    if (in->i_x_offset + in->i_visible_width !=
+            out->i_x_offset + out->i_visible_width
+     || in->i_y_offset + in->i_visible_height !=
+            out->i_y_offset + out->i_visible_height
+     || in->orientation != out->orientation)
+        return VLC_EGENERIC;
+
+    const struct yuv_rgb_format *format = FindFormat(in->i_chroma);
+    if (format == NULL)
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = vlc_obj_malloc(obj, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    if (GetRGBOffsets(out, sys->params.offsets))
+        return VLC_EGENERIC;
+    SetupFormat(&sys->params, format, in);
+
+    sys->line = format->line;
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        sys->line = format->line_avx2;
+#endif
+
+    msg_Dbg(filter, "%4.4s to %4.4s, %u bits %s range",
+            (const char *)&in->i_chroma, (const char *)&out->i_chroma,
+            format->bits, sys->params.y_offset ? "limited" : "full");
+
+    filter->p_sys = sys;
+    filter->pf_video_filter = Convert_Filter;
+    return VLC_SUCCESS;
+}
+
+vlc_module_begin ()
+    set_description(N_("YUV 4:2:0 to RGB32 conversions"))
+    set_capability("video converter", 170)
+    set_callbacks(Open, NULL)
+vlc_module_end ()
+
+#else /* YUV_RGB_TEST */
+
+static void FillRandom(picture_t *pic, const struct yuv_rgb_format *format,
+                       unsigned *seed)
+{
+    /* keep the high bytes of the 16-bits samples within their range */
+    const unsigned high_mask = ((1 << format->bits) - 1) << format->msb_shift >> 8;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        for (int j = 0; j < p->i_pitch * p->i_lines; j++)
+        {
+            *seed = *seed * 1103515245 + 12345;
+            p->p_pixels[j] = *seed >> 16;
+            if (format->bits > 8 && (j & 1))
+                p->p_pixels[j] &= high_mask;
+            else if (format->msb_shift)
+                p->p_pixels[j] &= 0xff << format->msb_shift;
+        }
+    }
+}
+
+static double Bench(picture_t *dst, const picture_t *src, yuv_rgb_line line,
+                    const struct yuv_rgb_params *p, unsigned loops)
+{
+    const unsigned w = src->format.i_visible_width;
+    const unsigned h = src->format.i_visible_height;
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned n = 0; n < loops; n++)
+        ConvertPicture(dst, src, w, h, line, p);
+    vlc_tick_t duration = __MAX(vlc_tick_now() - start, 1);
+
+    return (double) loops * w * h * CLOCK_FREQ / duration / 1000000.;
+}
+
+/* Checks the vectorized conversions against the C ones on random pictures,
+ * and reports the throughput of both with "bench" as first argument */
+int main(int argc, char **argv)
+{
+    const bool bench = argc > 1 && !strcmp(argv[1], "bench");
+    const unsigned loops = argc > 2 ? atoi(argv[2]) : 50;
+    static const unsigned sizes[][2] = {
+        { 2, 2 }, { 17, 5 }, { 33, 17 }, { 65, 39 }, { 1920, 1080 },
+    };
+    static const video_color_space_t spaces[] = {
+        COLOR_SPACE_BT601, COLOR_SPACE_BT709, COLOR_SPACE_BT2020,
+    };
+    unsigned seed = 1;
+
+    alarm(bench ? 0 : 10);
+
+#ifdef HAVE_AVX2_INTRINSICS
+    if (!bench && !vlc_CPU_AVX2())
+#else
+    if (!bench)
+#endif
+    {
+        fprintf(stderr, "WARNING: could not test AVX2\n");
+        return 77;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(formats); i++)
+    {
+        const struct yuv_rgb_format *format = &formats[i];
+
+        for (size_t j = 0; j < ARRAY_SIZE(sizes); j++)
+        {
+            if (bench && sizes[j][0] != 1920)
+                continue;
+
+            video_format_t fmt;
+            video_format_Init(&fmt, 0);
+            video_format_Setup(&fmt, format->chroma, sizes[j][0], sizes[j][1],
+                               sizes[j][0], sizes[j][1], 1, 1);
+            fmt.space = spaces[j % ARRAY_SIZE(spaces)];
+            fmt.color_range = j & 1 ? COLOR_RANGE_FULL : COLOR_RANGE_LIMITED;
+
+            picture_t *src = picture_NewFromFormat(&fmt);
+            assert(src);
+            FillRandom(src, format, &seed);
+
+            fmt.i_chroma = j & 1 ? VLC_CODEC_RGBA : VLC_CODEC_BGRA;
+            picture_t *dst = picture_NewFromFormat(&fmt);
+            assert(dst);
+
+            struct yuv_rgb_params p;
+            int ret = GetRGBOffsets(&fmt, p.offsets);
+            assert(ret == VLC_SUCCESS);
+            SetupFormat(&p, format, &src->format);
+
+            if (bench)
+            {
+                printf("%4.4s -> %4.4s: C %8.1f Mpixels/s",
+                       (const char *)&format->chroma,
+                       (const char *)&fmt.i_chroma,
+                       Bench(dst, src, format->line, &p, loops));
+#ifdef HAVE_AVX2_INTRINSICS
+                if (vlc_CPU_AVX2())
+                    printf(", AVX2 %8.1f Mpixels/s",
+                           Bench(dst, src, format->line_avx2, &p, loops));
+#endif
+                printf("\n");
+            }
+#ifdef HAVE_AVX2_INTRINSICS
+            else
+            {
+                picture_t *ref = picture_NewFromFormat(&fmt);
+                assert(ref);
+
+                fprintf(stderr, "testing: %ux%u %4.4s -> %4.4s\n",
+                        sizes[j][0], sizes[j][1],
+                        (const char *)&format->chroma,
+                        (const char *)&fmt.i_chroma);
+                ConvertPicture(ref, src, sizes[j][0], sizes[j][1],
+                               format->line, &p);
+                ConvertPicture(dst, src, sizes[j][0], sizes[j][1],
+                               format->line_avx2, &p);
+                for (unsigned y = 0; y < sizes[j][1]; y++)
+                    assert(!memcmp(&ref->p[0].p_pixels[y * ref->p[0].i_pitch],
+                                   &dst->p[0].p_pixels[y * dst->p[0].i_pitch],
+                                   4 * sizes[j][0]));
+                picture_Release(ref);
+            }
+#endif
+            picture_Release(dst);
+            picture_Release(src);
+        }
+    }
+    return 0;
+}
+
+#endif /* YUV_RGB_TEST */
@@ -225,6 +225,47 @@ static void Destroy( vlc_object_t *p_this )
     free( p_sys );
 }
 
+struct adjust_luma_job
+{
+    const plane_t *p_in;
+    plane_t *p_out;
+    const int *pi_luma;
+};
+
+static void AdjustLumaRows8( void *opaque, unsigned first, unsigned count )
+{
+    const struct adjust_luma_job *job = opaque;
+    const int *pi_luma = job->pi_luma;
+    const int i_visible_pitch = job->p_in->i_visible_pitch;
+
+    for( unsigned y = first; y < first + count; y++ )
+    {
+        const uint8_t *p_in = &job->p_in->p_pixels[y * job->p_in->i_pitch];
+        uint8_t *p_out = &job->p_out->p_pixels[y * job->p_out->i_pitch];
+
+        for( int x = 0; x < i_visible_pitch; x++ )
+            p_out[x] = pi_luma[ p_in[x] ];
+    }
+}
+
+static void AdjustLumaRows16( void *opaque, unsigned first, unsigned count )
+{
+    const struct adjust_luma_job *job = opaque;
+    const int *pi_luma = job->pi_luma;
+    const int i_visible_width = job->p_in->i_visible_pitch >> 1;
+
+    for( unsigned y = first; y < first + count; y++ )
+    {
+        const uint16_t *p_in = (const uint16_t *)
+            &job->p_in->p_pixels[y * job->p_in->i_pitch];
+        uint16_t *p_out = (uint16_t *)
+            &job->p_out->p_pixels[y * job->p_out->i_pitch];
+
+        for( int x = 0; x < i_visible_width; x++ )
+            p_out[x] = pi_luma[ p_in[x] ];
+    }
+}
+
 /*****************************************************************************
  * Run the filter on a Planar YUV picture
  *****************************************************************************/
@@ -319,78 +360,13 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
     /*
      * Do the Y plane
      */
-    if ( b_16bit )
-    {
-        uint16_t *p_in, *p_in_end, *p_line_end;
-        uint16_t *p_out;
-        p_in = (uint16_t *) p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-            * (p_pic->p[Y_PLANE].i_pitch >> 1) - 8;
-
-        p_out = (uint16_t *) p_outpic->p[Y_PLANE].p_pixels;
-
-        for( ; p_in < p_in_end ; )
-        {
-            p_line_end = p_in + (p_pic->p[Y_PLANE].i_visible_pitch >> 1) - 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                /* Do 8 pixels at a time */
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_line_end += 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_in += (p_pic->p[Y_PLANE].i_pitch >> 1)
-                - (p_pic->p[Y_PLANE].i_visible_pitch >> 1);
-            p_out += (p_outpic->p[Y_PLANE].i_pitch >> 1)
-                - (p_outpic->p[Y_PLANE].i_visible_pitch >> 1);
-        }
-    }
-    else
-    {
-        uint8_t *p_in, *p_in_end, *p_line_end;
-        uint8_t *p_out;
-        p_in = p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-                 * p_pic->p[Y_PLANE].i_pitch - 8;
-
-        p_out = p_outpic->p[Y_PLANE].p_pixels;
-
-        for( ; p_in < p_in_end ; )
-        {
-            p_line_end = p_in + p_pic->p[Y_PLANE].i_visible_pitch - 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                /* Do 8 pixels at a time */
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_line_end += 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_in += p_pic->p[Y_PLANE].i_pitch
-                  - p_pic->p[Y_PLANE].i_visible_pitch;
-            p_out += p_outpic->p[Y_PLANE].i_pitch
-                   - p_outpic->p[Y_PLANE].i_visible_pitch;
-        }
-    }
+    struct adjust_luma_job job = {
+        .p_in = &p_pic->p[Y_PLANE],
+        .p_out = &p_outpic->p[Y_PLANE],
+        .pi_luma = pi_luma,
+    };
+    filter_ParallelRows( p_pic->p[Y_PLANE].i_visible_lines,
+                         b_16bit ? AdjustLumaRows16 : AdjustLumaRows8, &job );
 
     /*
      * Do the U and V planes
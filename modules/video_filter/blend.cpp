@@ -31,8 +31,16 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <tmmintrin.h>
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+# include <immintrin.h>
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -80,6 +88,18 @@ public:
     {
         return fmt;
     }
+    const picture_t *getPicture() const
+    {
+        return picture;
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
     bool isFull(unsigned) const
     {
         return true;
@@ -561,6 +581,398 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
+/* Vectorized blending of the common subpicture formats
+ *
+ * The kernels process one line and produce the same output as the generic
+ * templates: merging with a null alpha leaves the destination unchanged.
+ * - mergeLine: dst[i] with src[i] and alpha a[i]
+ * - mergeLineSub2: dst[i] with src[2i] and alpha a[2i], for the chroma of
+ *   subsampled destinations
+ * - mergeLineSub2Interleaved: dst[2i] and dst[2i+1] with src0[2i] and
+ *   src1[2i], for semi-planar chroma
+ * - mergeLineRGBX: 32-bits pixels, the RGBA source components going to the
+ *   given destination byte offsets, the 4th destination byte is kept
+ */
+static void mergeLineC(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                       unsigned count, unsigned alpha)
+{
+    for (unsigned i = 0; i < count; i++)
+        merge(&dst[i], src[i], div255(alpha * a[i]));
+}
+
+static void mergeLineSub2C(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                           unsigned count, unsigned alpha)
+{
+    for (unsigned i = 0; i < count; i++)
+        merge(&dst[i], src[2 * i], div255(alpha * a[2 * i]));
+}
+
+static void mergeLineSub2InterleavedC(uint8_t *dst, const uint8_t *src0,
+                                      const uint8_t *src1, const uint8_t *a,
+                                      unsigned count, unsigned alpha)
+{
+    for (unsigned i = 0; i < count; i++) {
+        const unsigned f = div255(alpha * a[2 * i]);
+        merge(&dst[2 * i + 0], src0[2 * i], f);
+        merge(&dst[2 * i + 1], src1[2 * i], f);
+    }
+}
+
+static void mergeLineRGBXC(uint8_t *dst, const uint8_t *src, unsigned count,
+                           unsigned alpha, const int offsets[3])
+{
+    for (unsigned i = 0; i < count; i++, dst += 4, src += 4) {
+        const unsigned f = div255(alpha * src[3]);
+        merge(&dst[offsets[0]], src[0], f);
+        merge(&dst[offsets[1]], src[1], f);
+        merge(&dst[offsets[2]], src[2], f);
+    }
+}
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# define VLC_SSSE3 __attribute__ ((__target__ ("ssse3")))
+
+/* div255() on 16-bits lanes, within the 255 * 255 range */
+VLC_SSSE3 static inline __m128i div255_epu16(__m128i v)
+{
+    v = _mm_add_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)),
+                      _mm_set1_epi16(1));
+    return _mm_srli_epi16(v, 8);
+}
+
+/* merge() on 16-bits lanes, a being the alpha source */
+VLC_SSSE3 static inline __m128i merge_epu16(__m128i d, __m128i s, __m128i a,
+                                            __m128i alpha)
+{
+    const __m128i f = div255_epu16(_mm_mullo_epi16(a, alpha));
+    const __m128i v = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_sub_epi16(_mm_set1_epi16(255), f), d),
+        _mm_mullo_epi16(s, f));
+    return div255_epu16(v);
+}
+
+VLC_SSSE3 static inline __m128i merge_epu8(__m128i d, __m128i s, __m128i a,
+                                           __m128i alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = merge_epu16(_mm_unpacklo_epi8(d, zero),
+                                   _mm_unpacklo_epi8(s, zero),
+                                   _mm_unpacklo_epi8(a, zero), alpha);
+    const __m128i hi = merge_epu16(_mm_unpackhi_epi8(d, zero),
+                                   _mm_unpackhi_epi8(s, zero),
+                                   _mm_unpackhi_epi8(a, zero), alpha);
+    return _mm_packus_epi16(lo, hi);
+}
+
+struct KernelsSSSE3 {
+    VLC_SSSE3
+    static void mergeLine(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                          unsigned count, unsigned alpha)
+    {
+        const __m128i valpha = _mm_set1_epi16(alpha);
+        unsigned i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+            d = merge_epu8(d, _mm_loadu_si128((const __m128i *)&src[i]),
+                           _mm_loadu_si128((const __m128i *)&a[i]), valpha);
+            _mm_storeu_si128((__m128i *)&dst[i], d);
+        }
+        mergeLineC(&dst[i], &src[i], &a[i], count - i, alpha);
+    }
+
+    VLC_SSSE3
+    static void mergeLineSub2(uint8_t *dst, const uint8_t *src,
+                              const uint8_t *a, unsigned count, unsigned alpha)
+    {
+        const __m128i valpha = _mm_set1_epi16(alpha);
+        const __m128i even = _mm_set1_epi16(0x00ff);
+        unsigned i = 0;
+        /* one spare source sample, not to read past the last one */
+        for (; i + 9 <= count; i += 8) {
+            const __m128i s = _mm_and_si128(
+                _mm_loadu_si128((const __m128i *)&src[2 * i]), even);
+            const __m128i f = _mm_and_si128(
+                _mm_loadu_si128((const __m128i *)&a[2 * i]), even);
+            __m128i d = _mm_unpacklo_epi8(
+                _mm_loadl_epi64((const __m128i *)&dst[i]),
+                _mm_setzero_si128());
+            d = merge_epu16(d, s, f, valpha);
+            _mm_storel_epi64((__m128i *)&dst[i], _mm_packus_epi16(d, d));
+        }
+        mergeLineSub2C(&dst[i], &src[2 * i], &a[2 * i], count - i, alpha);
+    }
+
+    VLC_SSSE3
+    static void mergeLineSub2Interleaved(uint8_t *dst, const uint8_t *src0,
+                                         const uint8_t *src1, const uint8_t *a,
+                                         unsigned count, unsigned alpha)
+    {
+        const __m128i valpha = _mm_set1_epi16(alpha);
+        const __m128i even = _mm_set1_epi16(0x00ff);
+        const __m128i zero = _mm_setzero_si128();
+        unsigned i = 0;
+        for (; i + 9 <= count; i += 8) {
+            const __m128i s0 = _mm_and_si128(
+                _mm_loadu_si128((const __m128i *)&src0[2 * i]), even);
+            const __m128i s1 = _mm_and_si128(
+                _mm_loadu_si128((const __m128i *)&src1[2 * i]), even);
+            const __m128i f = _mm_and_si128(
+                _mm_loadu_si128((const __m128i *)&a[2 * i]), even);
+            const __m128i d = _mm_loadu_si128((const __m128i *)&dst[2 * i]);
+
+            const __m128i lo = merge_epu16(_mm_unpacklo_epi8(d, zero),
+                                           _mm_unpacklo_epi16(s0, s1),
+                                           _mm_unpacklo_epi16(f, f), valpha);
+            const __m128i hi = merge_epu16(_mm_unpackhi_epi8(d, zero),
+                                           _mm_unpackhi_epi16(s0, s1),
+                                           _mm_unpackhi_epi16(f, f), valpha);
+            _mm_storeu_si128((__m128i *)&dst[2 * i], _mm_packus_epi16(lo, hi));
+        }
+        mergeLineSub2InterleavedC(&dst[2 * i], &src0[2 * i], &src1[2 * i],
+                                  &a[2 * i], count - i, alpha);
+    }
+
+    VLC_SSSE3
+    static void mergeLineRGBX(uint8_t *dst, const uint8_t *src, unsigned count,
+                              unsigned alpha, const int offsets[3])
+    {
+        /* Shuffles placing the source components, and their alpha, at
+         * their destination offsets; the 4th byte gets a null alpha */
+        int8_t color[16], mask[16];
+        for (unsigned p = 0; p < 4; p++) {
+            for (unsigned c = 0; c < 4; c++) {
+                color[4 * p + c] = -1;
+                mask[4 * p + c] = -1;
+            }
+            for (unsigned c = 0; c < 3; c++) {
+                color[4 * p + offsets[c]] = 4 * p + c;
+                mask[4 * p + offsets[c]] = 4 * p + 3;
+            }
+        }
+        const __m128i vcolor = _mm_loadu_si128((const __m128i *)color);
+        const __m128i vmask = _mm_loadu_si128((const __m128i *)mask);
+        const __m128i valpha = _mm_set1_epi16(alpha);
+
+        unsigned i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128i s = _mm_loadu_si128((const __m128i *)&src[4 * i]);
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * i]);
+            d = merge_epu8(d, _mm_shuffle_epi8(s, vcolor),
+                           _mm_shuffle_epi8(s, vmask), valpha);
+            _mm_storeu_si128((__m128i *)&dst[4 * i], d);
+        }
+        mergeLineRGBXC(&dst[4 * i], &src[4 * i], count - i, alpha, offsets);
+    }
+};
+#endif
+
+#if defined(HAVE_AVX2_INTRINSICS)
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+
+VLC_AVX2 static inline __m256i div255_epu16_avx2(__m256i v)
+{
+    v = _mm256_add_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)),
+                         _mm256_set1_epi16(1));
+    return _mm256_srli_epi16(v, 8);
+}
+
+VLC_AVX2 static inline __m256i merge_epu16_avx2(__m256i d, __m256i s,
+                                                __m256i a, __m256i alpha)
+{
+    const __m256i f = div255_epu16_avx2(_mm256_mullo_epi16(a, alpha));
+    const __m256i v = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_sub_epi16(_mm256_set1_epi16(255), f), d),
+        _mm256_mullo_epi16(s, f));
+    return div255_epu16_avx2(v);
+}
+
+/* The unpacks and the pack work within 128-bits lanes, so the order of the
+ * bytes is preserved */
+VLC_AVX2 static inline __m256i merge_epu8_avx2(__m256i d, __m256i s,
+                                               __m256i a, __m256i alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lo = merge_epu16_avx2(_mm256_unpacklo_epi8(d, zero),
+                                        _mm256_unpacklo_epi8(s, zero),
+                                        _mm256_unpacklo_epi8(a, zero), alpha);
+    const __m256i hi = merge_epu16_avx2(_mm256_unpackhi_epi8(d, zero),
+                                        _mm256_unpackhi_epi8(s, zero),
+                                        _mm256_unpackhi_epi8(a, zero), alpha);
+    return _mm256_packus_epi16(lo, hi);
+}
+
+struct KernelsAVX2 {
+    VLC_AVX2
+    static void mergeLine(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                          unsigned count, unsigned alpha)
+    {
+        const __m256i valpha = _mm256_set1_epi16(alpha);
+        unsigned i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+            d = merge_epu8_avx2(d,
+                                _mm256_loadu_si256((const __m256i *)&src[i]),
+                                _mm256_loadu_si256((const __m256i *)&a[i]),
+                                valpha);
+            _mm256_storeu_si256((__m256i *)&dst[i], d);
+        }
+        KernelsSSSE3::mergeLine(&dst[i], &src[i], &a[i], count - i, alpha);
+    }
+
+    VLC_AVX2
+    static void mergeLineSub2(uint8_t *dst, const uint8_t *src,
+                              const uint8_t *a, unsigned count, unsigned alpha)
+    {
+        const __m256i valpha = _mm256_set1_epi16(alpha);
+        const __m256i even = _mm256_set1_epi16(0x00ff);
+        unsigned i = 0;
+        for (; i + 17 <= count; i += 16) {
+            const __m256i s = _mm256_and_si256(
+                _mm256_loadu_si256((const __m256i *)&src[2 * i]), even);
+            const __m256i f = _mm256_and_si256(
+                _mm256_loadu_si256((const __m256i *)&a[2 * i]), even);
+            __m256i d = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)&dst[i]));
+            d = merge_epu16_avx2(d, s, f, valpha);
+            /* keep the low 64 bits of each lane */
+            d = _mm256_permute4x64_epi64(_mm256_packus_epi16(d, d), 0x08);
+            _mm_storeu_si128((__m128i *)&dst[i], _mm256_castsi256_si128(d));
+        }
+        KernelsSSSE3::mergeLineSub2(&dst[i], &src[2 * i], &a[2 * i],
+                                    count - i, alpha);
+    }
+
+    VLC_AVX2
+    static void mergeLineSub2Interleaved(uint8_t *dst, const uint8_t *src0,
+                                         const uint8_t *src1, const uint8_t *a,
+                                         unsigned count, unsigned alpha)
+    {
+        KernelsSSSE3::mergeLineSub2Interleaved(dst, src0, src1, a,
+                                               count, alpha);
+    }
+
+    VLC_AVX2
+    static void mergeLineRGBX(uint8_t *dst, const uint8_t *src, unsigned count,
+                              unsigned alpha, const int offsets[3])
+    {
+        int8_t color[32], mask[32];
+        for (unsigned p = 0; p < 8; p++) {
+            /* the shuffle indexes are relative to each 128-bits lane */
+            const unsigned q = p % 4;
+            for (unsigned c = 0; c < 4; c++) {
+                color[4 * p + c] = -1;
+                mask[4 * p + c] = -1;
+            }
+            for (unsigned c = 0; c < 3; c++) {
+                color[4 * p + offsets[c]] = 4 * q + c;
+                mask[4 * p + offsets[c]] = 4 * q + 3;
+            }
+        }
+        const __m256i vcolor = _mm256_loadu_si256((const __m256i *)color);
+        const __m256i vmask = _mm256_loadu_si256((const __m256i *)mask);
+        const __m256i valpha = _mm256_set1_epi16(alpha);
+
+        unsigned i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m256i s = _mm256_loadu_si256((const __m256i *)&src[4 * i]);
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[4 * i]);
+            d = merge_epu8_avx2(d, _mm256_shuffle_epi8(s, vcolor),
+                                _mm256_shuffle_epi8(s, vmask), valpha);
+            _mm256_storeu_si256((__m256i *)&dst[4 * i], d);
+        }
+        KernelsSSSE3::mergeLineRGBX(&dst[4 * i], &src[4 * i], count - i,
+                                    alpha, offsets);
+    }
+};
+#endif
+
+/* YUVA onto 4:2:0 planar, the U and V planes being swapped for YV12 */
+template <class K, bool swap_uv>
+void BlendYUVAToI420(const CPicture &dst_data, const CPicture &src_data,
+                     unsigned width, unsigned height, int alpha)
+{
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+
+    /* the chroma is merged with the even destination pixels */
+    const unsigned first = dx % 2;
+    const unsigned chroma = (width - first + 1) / 2;
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *s[4];
+        for (unsigned i = 0; i < 4; i++)
+            s[i] = &src->p[i].p_pixels[(sy + y) * src->p[i].i_pitch + sx];
+
+        K::mergeLine(&dst->p[0].p_pixels[(dy + y) * dst->p[0].i_pitch + dx],
+                     s[0], s[3], width, alpha);
+
+        if ((dy + y) % 2 != 0 || chroma == 0)
+            continue;
+        for (unsigned i = 1; i <= 2; i++) {
+            const plane_t *p = &dst->p[swap_uv ? 3 - i : i];
+            K::mergeLineSub2(&p->p_pixels[(dy + y) / 2 * p->i_pitch + (dx + first) / 2],
+                             &s[i][first], &s[3][first], chroma, alpha);
+        }
+    }
+}
+
+/* YUVA onto NV12, or NV21 */
+template <class K, bool swap_uv>
+void BlendYUVAToNV12(const CPicture &dst_data, const CPicture &src_data,
+                     unsigned width, unsigned height, int alpha)
+{
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+
+    const unsigned first = dx % 2;
+    const unsigned chroma = (width - first + 1) / 2;
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *s[4];
+        for (unsigned i = 0; i < 4; i++)
+            s[i] = &src->p[i].p_pixels[(sy + y) * src->p[i].i_pitch + sx];
+
+        K::mergeLine(&dst->p[0].p_pixels[(dy + y) * dst->p[0].i_pitch + dx],
+                     s[0], s[3], width, alpha);
+
+        if ((dy + y) % 2 != 0 || chroma == 0)
+            continue;
+        const plane_t *p = &dst->p[1];
+        K::mergeLineSub2Interleaved(&p->p_pixels[(dy + y) / 2 * p->i_pitch + (dx + first) / 2 * 2],
+                                    &s[swap_uv ? 2 : 1][first],
+                                    &s[swap_uv ? 1 : 2][first],
+                                    &s[3][first], chroma, alpha);
+    }
+}
+
+/* RGBA onto RGB32 */
+template <class K>
+void BlendRGBAToRGB32(const CPicture &dst_data, const CPicture &src_data,
+                      unsigned width, unsigned height, int alpha)
+{
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+
+    int offsets[3];
+    if (GetPackedRgbIndexes(dst_data.getFormat(), &offsets[0], &offsets[1],
+                            &offsets[2]) != VLC_SUCCESS) {
+        offsets[0] = 0;
+        offsets[1] = 1;
+        offsets[2] = 2;
+    }
+
+    for (unsigned y = 0; y < height; y++)
+        K::mergeLineRGBX(&dst->p[0].p_pixels[(dy + y) * dst->p[0].i_pitch + 4 * dx],
+                         &src->p[0].p_pixels[(sy + y) * src->p[0].i_pitch + 4 * sx],
+                         width, alpha, offsets);
+}
+
 namespace {
 
 static const struct {
@@ -637,6 +1049,35 @@ static const struct {
 #undef YUV
 };
 
+#define FAST(K) \
+    { VLC_CODEC_I420, VLC_CODEC_YUVA,  BlendYUVAToI420<K, false> }, \
+    { VLC_CODEC_J420, VLC_CODEC_YUVA,  BlendYUVAToI420<K, false> }, \
+    { VLC_CODEC_YV12, VLC_CODEC_YUVA,  BlendYUVAToI420<K, true> }, \
+    { VLC_CODEC_NV12, VLC_CODEC_YUVA,  BlendYUVAToNV12<K, false> }, \
+    { VLC_CODEC_NV21, VLC_CODEC_YUVA,  BlendYUVAToNV12<K, true> }, \
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, BlendRGBAToRGB32<K> }
+
+#if defined(HAVE_AVX2_INTRINSICS)
+static const struct {
+    vlc_fourcc_t     dst;
+    vlc_fourcc_t     src;
+    blend_function_t blend;
+} blends_avx2[] = {
+    FAST(KernelsAVX2),
+};
+#endif
+
+#if defined(HAVE_SSE2_INTRINSICS)
+static const struct {
+    vlc_fourcc_t     dst;
+    vlc_fourcc_t     src;
+    blend_function_t blend;
+} blends_ssse3[] = {
+    FAST(KernelsSSSE3),
+};
+#endif
+#undef FAST
+
 struct filter_sys_t {
     filter_sys_t() : blend(NULL)
     {
@@ -692,6 +1133,23 @@ static int Open(vlc_object_t *object)
             sys->blend = blends[i].blend;
     }
 
+#if defined(HAVE_SSE2_INTRINSICS)
+    if (vlc_CPU_SSSE3()) {
+        for (size_t i = 0; i < sizeof(blends_ssse3) / sizeof(*blends_ssse3); i++) {
+            if (blends_ssse3[i].src == src && blends_ssse3[i].dst == dst)
+                sys->blend = blends_ssse3[i].blend;
+        }
+    }
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (vlc_CPU_AVX2()) {
+        for (size_t i = 0; i < sizeof(blends_avx2) / sizeof(*blends_avx2); i++) {
+            if (blends_avx2[i].src == src && blends_avx2[i].dst == dst)
+                sys->blend = blends_avx2[i].blend;
+        }
+    }
+#endif
+
     if (!sys->blend) {
        msg_Err(filter, "no matching alpha blending routine (chroma: %4.4s -> %4.4s)",
                (char *)&src, (char *)&dst);
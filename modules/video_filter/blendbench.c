@@ -68,6 +68,17 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
                                  " in")
 
+#define WIDTH_TEXT N_("Width of the generated images")
+#define HEIGHT_TEXT N_("Height of the generated images")
+#define SIZE_LONGTEXT N_("Dimension of the pictures used when no image file " \
+                         "is given")
+
+#define CHROMAS_TEXT N_("Chromas to benchmark")
+#define CHROMAS_LONGTEXT N_("Comma separated list of base:blend chroma " \
+                            "pairs, each of them being benchmarked in turn, " \
+                            "e.g. I420:YUVA,NV12:YUVA,RV32:RGBA. The base " \
+                            "and blend chromas are used if empty.")
+
 #define CFG_PREFIX "blendbench-"
 
 vlc_module_begin ()
@@ -82,6 +93,12 @@ vlc_module_begin ()
               LOOPS_LONGTEXT, false )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "width", 1920, 2, 8192, WIDTH_TEXT,
+              SIZE_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "height", 1080, 2, 8192, HEIGHT_TEXT,
+              SIZE_LONGTEXT, false )
+    add_string( CFG_PREFIX "chromas", NULL, CHROMAS_TEXT,
+              CHROMAS_LONGTEXT, false )
 
     set_section( N_("Base image"), NULL )
     add_loadfile(CFG_PREFIX "base-image", NULL,
@@ -99,31 +116,82 @@ vlc_module_begin ()
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
-    "blend-chroma", NULL
+    "loops", "alpha", "width", "height", "base-image", "base-chroma",
+    "blend-image", "blend-chroma", "chromas", NULL
 };
 
 /*****************************************************************************
  * filter_sys_t: filter method descriptor
  *****************************************************************************/
+#define MAX_CHROMAS 16
+
 typedef struct
 {
     bool b_done;
     int i_loops, i_alpha;
+    unsigned i_width, i_height;
 
-    picture_t *p_base_image;
-    picture_t *p_blend_image;
+    char *psz_base_image;
+    char *psz_blend_image;
 
-    vlc_fourcc_t i_base_chroma;
-    vlc_fourcc_t i_blend_chroma;
+    unsigned i_chromas;
+    struct
+    {
+        vlc_fourcc_t i_base;
+        vlc_fourcc_t i_blend;
+    } chromas[MAX_CHROMAS];
 } filter_sys_t;
 
+static vlc_fourcc_t blendbench_ParseChroma( const char *psz, size_t i_len )
+{
+    if( psz == NULL || i_len != 4 )
+        return 0;
+    return VLC_FOURCC( psz[0], psz[1], psz[2], psz[3] );
+}
+
+/* Synthetic picture, with an alpha varying across the width so that the
+ * transparent, opaque and intermediate cases are all exercised */
+static picture_t *blendbench_NewImage( vlc_fourcc_t i_chroma,
+                                       unsigned i_width, unsigned i_height )
+{
+    video_format_t fmt;
+
+    video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( p_pic == NULL )
+        return NULL;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = ( x * 3 + y ) ^ ( x >> 3 );
+    }
+    return p_pic;
+}
+
 static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
-                                 vlc_fourcc_t i_chroma, char *psz_file, const char *psz_name )
+                                 vlc_fourcc_t i_chroma, const char *psz_file,
+                                 const char *psz_name )
 {
+    filter_sys_t *p_sys = ((filter_t *)p_this)->p_sys;
     image_handler_t *p_image;
     video_format_t fmt_out;
 
+    if( psz_file == NULL || *psz_file == '\0' )
+    {
+        *pp_pic = blendbench_NewImage( i_chroma, p_sys->i_width,
+                                       p_sys->i_height );
+        if( *pp_pic == NULL )
+        {
+            msg_Err( p_this, "Unable to create %s image", psz_name );
+            return VLC_EGENERIC;
+        }
+        return VLC_SUCCESS;
+    }
+
     video_format_Init( &fmt_out, i_chroma );
 
     p_image = image_HandlerCreate( p_this );
@@ -173,37 +241,80 @@ static int Create( vlc_object_t *p_this )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
-
-    psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
-    p_sys->i_base_chroma = !psz_temp || strlen( psz_temp ) != 4 ? 0 :
-        VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
-    i_ret = blendbench_LoadImage( p_this, &p_sys->p_base_image,
-                                  p_sys->i_base_chroma, psz_cmd, "Base" );
-    free( psz_temp );
-    free( psz_cmd );
-    if( i_ret != VLC_SUCCESS )
+    p_sys->i_width = var_CreateGetIntegerCommand( p_filter,
+                                                  CFG_PREFIX "width" );
+    p_sys->i_height = var_CreateGetIntegerCommand( p_filter,
+                                                   CFG_PREFIX "height" );
+    p_sys->psz_base_image = var_CreateGetStringCommand( p_filter,
+                                                CFG_PREFIX "base-image" );
+    p_sys->psz_blend_image = var_CreateGetStringCommand( p_filter,
+                                                CFG_PREFIX "blend-image" );
+
+    p_sys->i_chromas = 0;
+    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "chromas" );
+    for( char *psz_pair = psz_cmd, *psz_next; psz_pair != NULL
+         && *psz_pair != '\0' && p_sys->i_chromas < MAX_CHROMAS;
+         psz_pair = psz_next )
     {
-        free( p_sys );
-        return i_ret;
+        psz_next = strchr( psz_pair, ',' );
+        if( psz_next != NULL )
+            *psz_next++ = '\0';
+
+        char *psz_blend = strchr( psz_pair, ':' );
+        if( psz_blend == NULL )
+        {
+            msg_Warn( p_filter, "ignoring invalid chroma pair %s", psz_pair );
+            continue;
+        }
+        vlc_fourcc_t i_base = blendbench_ParseChroma( psz_pair,
+                                                      psz_blend - psz_pair );
+        psz_blend++;
+        vlc_fourcc_t i_blend = blendbench_ParseChroma( psz_blend,
+                                                       strlen( psz_blend ) );
+        if( i_base == 0 || i_blend == 0 )
+        {
+            msg_Warn( p_filter, "ignoring invalid chroma pair %s", psz_pair );
+            continue;
+        }
+        p_sys->chromas[p_sys->i_chromas].i_base = i_base;
+        p_sys->chromas[p_sys->i_chromas].i_blend = i_blend;
+        p_sys->i_chromas++;
     }
-
-    psz_temp = var_CreateGetStringCommand( p_filter,
-                                           CFG_PREFIX "blend-chroma" );
-    p_sys->i_blend_chroma = !psz_temp || strlen( psz_temp ) != 4
-        ? 0 : VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
-    i_ret = blendbench_LoadImage( p_this, &p_sys->p_blend_image, p_sys->i_blend_chroma,
-                                  psz_cmd, "Blend" );
-
-    free( psz_temp );
     free( psz_cmd );
 
+    if( p_sys->i_chromas == 0 )
+    {
+        psz_temp = var_CreateGetStringCommand( p_filter,
+                                               CFG_PREFIX "base-chroma" );
+        p_sys->chromas[0].i_base = blendbench_ParseChroma( psz_temp,
+                                        psz_temp ? strlen( psz_temp ) : 0 );
+        free( psz_temp );
+        psz_temp = var_CreateGetStringCommand( p_filter,
+                                               CFG_PREFIX "blend-chroma" );
+        p_sys->chromas[0].i_blend = blendbench_ParseChroma( psz_temp,
+                                        psz_temp ? strlen( psz_temp ) : 0 );
+        free( psz_temp );
+        p_sys->i_chromas = 1;
+    }
+
+    /* Check that the images can be loaded before starting */
+    picture_t *p_base, *p_blend;
+    i_ret = blendbench_LoadImage( p_this, &p_base, p_sys->chromas[0].i_base,
+                                  p_sys->psz_base_image, "Base" );
+    if( i_ret == VLC_SUCCESS )
+    {
+        i_ret = blendbench_LoadImage( p_this, &p_blend,
+                                      p_sys->chromas[0].i_blend,
+                                      p_sys->psz_blend_image, "Blend" );
+        if( i_ret == VLC_SUCCESS )
+            picture_Release( p_blend );
+        picture_Release( p_base );
+    }
     if( i_ret != VLC_SUCCESS )
     {
-        picture_Release( p_sys->p_base_image );
+        free( p_sys->psz_base_image );
+        free( p_sys->psz_blend_image );
         free( p_sys );
-
         return VLC_EGENERIC;
     }
 
@@ -218,57 +329,92 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    free( p_sys->psz_base_image );
+    free( p_sys->psz_blend_image );
+    free( p_sys );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * Benchmark: blends one chroma pair and reports the throughput
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static void Benchmark( filter_t *p_filter, vlc_fourcc_t i_base_chroma,
+                       vlc_fourcc_t i_blend_chroma )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    filter_t *p_blend;
-
-    if( p_sys->b_done )
-        return p_pic;
-
-    p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
-    if( !p_blend )
+    picture_t *p_base, *p_blend;
+    filter_t *p_blender;
+
+    if( blendbench_LoadImage( VLC_OBJECT(p_filter), &p_base, i_base_chroma,
+                              p_sys->psz_base_image, "Base" ) )
+        return;
+    if( blendbench_LoadImage( VLC_OBJECT(p_filter), &p_blend, i_blend_chroma,
+                              p_sys->psz_blend_image, "Blend" ) )
     {
-        picture_Release( p_pic );
-        return NULL;
+        picture_Release( p_base );
+        return;
     }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
-    p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
-    if( !p_blend->p_module )
+
+    p_blender = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_blender )
+        goto out;
+    p_blender->fmt_out.video = p_base->format;
+    p_blender->fmt_in.video = p_blend->format;
+    p_blender->p_module = module_need( p_blender, "video blending", NULL,
+                                       false );
+    if( !p_blender->p_module )
     {
-        picture_Release( p_pic );
-        vlc_object_delete(p_blend);
-        return NULL;
+        msg_Err( p_filter, "Cannot blend %4.4s onto %4.4s",
+                 (const char *)&i_blend_chroma, (const char *)&i_base_chroma );
+        vlc_object_delete(p_blender);
+        goto out;
     }
 
     vlc_tick_t time = vlc_tick_now();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
     {
-        p_blend->pf_video_blend( p_blend,
-                                 p_sys->p_base_image, p_sys->p_blend_image,
-                                 0, 0, p_sys->i_alpha );
+        p_blender->pf_video_blend( p_blender, p_base, p_blend,
+                                   0, 0, p_sys->i_alpha );
     }
     time = vlc_tick_now() - time;
-
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
+    if( time <= 0 )
+        time = 1;
+
+    /* The blended area, not the bytes of the planes */
+    const unsigned i_width = __MIN( p_blend->format.i_visible_width,
+                                    p_base->format.i_visible_width );
+    const unsigned i_height = __MIN( p_blend->format.i_visible_height,
+                                     p_base->format.i_visible_height );
+    const double f_images = (double) p_sys->i_loops / time * CLOCK_FREQ;
+
+    msg_Info( p_filter, "%4.4s onto %4.4s: blended %d images of %ux%u "
+              "in %f sec", (const char *)&i_blend_chroma,
+              (const char *)&i_base_chroma, p_sys->i_loops, i_width, i_height,
               secf_from_vlc_tick(time) );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
-              (float) p_sys->i_loops / time * CLOCK_FREQ,
-              (float) p_sys->i_loops / time * CLOCK_FREQ *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+    msg_Info( p_filter, "%4.4s onto %4.4s: %f images/second, "
+              "%f Mpixels/second", (const char *)&i_blend_chroma,
+              (const char *)&i_base_chroma, f_images,
+              f_images * i_width * i_height / 1000000. );
+
+    module_unneed( p_blender, p_blender->p_module );
+    vlc_object_delete(p_blender);
+out:
+    picture_Release( p_blend );
+    picture_Release( p_base );
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
 
-    module_unneed( p_blend, p_blend->p_module );
+    if( p_sys->b_done )
+        return p_pic;
 
-    vlc_object_delete(p_blend);
+    for( unsigned i = 0; i < p_sys->i_chromas; i++ )
+        Benchmark( p_filter, p_sys->chromas[i].i_base,
+                   p_sys->chromas[i].i_blend );
 
     p_sys->b_done = true;
     return p_pic;
@@ -51,6 +51,78 @@ int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
 }
 
+struct yadif_job
+{
+    picture_t *p_dst;
+    const picture_t *p_prev, *p_cur, *p_next;
+    void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
+                   int w, int prefs, int mrefs, int parity, int mode);
+    int i_field;
+    int i_parity;
+    int i_pixel_size;
+};
+
+static void RenderYadifRows( void *opaque, unsigned first, unsigned count )
+{
+    const struct yadif_job *job = opaque;
+    picture_t *p_dst = job->p_dst;
+    const picture_t *p_prev = job->p_prev;
+    const picture_t *p_cur = job->p_cur;
+    const picture_t *p_next = job->p_next;
+    const int i_field = job->i_field;
+    const int yadif_parity = job->i_parity;
+    const unsigned i_lines = p_dst->p[Y_PLANE].i_visible_lines;
+
+    for( int n = 0; n < p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &p_prev->p[n];
+        const plane_t *curp  = &p_cur->p[n];
+        const plane_t *nextp = &p_next->p[n];
+        plane_t *dstp        = &p_dst->p[n];
+
+        /* rows of this plane matching the band of luma rows */
+        const int i_first = __MAX( 1, (int)(first * dstp->i_visible_lines / i_lines) );
+        const int i_end = __MIN( dstp->i_visible_lines - 1,
+                                 (int)((first + count) * dstp->i_visible_lines / i_lines) );
+
+        for( int y = i_first; y < i_end; y++ )
+        {
+            if( (y % 2) == i_field  ||  yadif_parity == 2 )
+            {
+                memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                int mode;
+                /* Spatial checks only when enough data */
+                mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                job->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                             &prevp->p_pixels[y * prevp->i_pitch],
+                             &curp->p_pixels[y * curp->i_pitch],
+                             &nextp->p_pixels[y * nextp->i_pitch],
+                             dstp->i_visible_pitch / job->i_pixel_size,
+                             y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                             y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                             yadif_parity,
+                             mode );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+        }
+    }
+}
+
 int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
                  int i_order, int i_field )
 {
@@ -124,56 +196,37 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
             filter = vlcpriv_yadif_filter_line_mmxext;
         else
 #endif
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+        if( vlc_CPU_AVX2() )
+            filter = vlcpriv_yadif_filter_line_avx2;
+        else
 #endif
             filter = yadif_filter_line_c;
 
         if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
-
-        for( int n = 0; n < p_dst->i_planes; n++ )
         {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
+#ifdef HAVE_AVX2_INTRINSICS
+            if( vlc_CPU_AVX2() )
+                filter = vlcpriv_yadif_filter_line_16bit_avx2;
+            else
+#endif
+                filter = yadif_filter_line_c_16bit;
         }
 
+        struct yadif_job job = {
+            .p_dst = p_dst,
+            .p_prev = p_prev,
+            .p_cur = p_cur,
+            .p_next = p_next,
+            .filter = filter,
+            .i_field = i_field,
+            .i_parity = yadif_parity,
+            .i_pixel_size = p_sys->chroma->pixel_size,
+        };
+        filter_ParallelRows( p_dst->p[Y_PLANE].i_visible_lines,
+                             RenderYadifRows, &job );
+
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
         return VLC_SUCCESS;
@@ -482,6 +482,53 @@ int Mouse( filter_t *p_filter,
 }
 
 
+/*****************************************************************************
+ * Merge routines, most specific first
+ *****************************************************************************/
+
+static const struct vlc_cpu_kernel merge8_kernels[] = {
+#if defined(CAN_COMPILE_C_ALTIVEC)
+    VLC_CPU_KERNEL( "AltiVec", VLC_CPU_ALTIVEC, MergeAltivec ),
+#endif
+#if defined(CAN_COMPILE_SSE2)
+    VLC_CPU_KERNEL( "SSE2", VLC_CPU_SSE2, Merge8BitSSE2 ),
+#endif
+#if defined(CAN_COMPILE_MMXEXT)
+    VLC_CPU_KERNEL( "MMXEXT", VLC_CPU_MMXEXT, MergeMMXEXT ),
+#endif
+#if defined(CAN_COMPILE_3DNOW)
+    VLC_CPU_KERNEL( "3DNow!", VLC_CPU_3dNOW, Merge3DNow ),
+#endif
+#if defined(CAN_COMPILE_ARM)
+    VLC_CPU_KERNEL( "NEON", VLC_CPU_ARM_NEON, merge8_arm_neon ),
+    VLC_CPU_KERNEL( "ARMv6", VLC_CPU_ARMv6, merge8_armv6 ),
+#endif
+#if defined(CAN_COMPILE_SVE)
+    VLC_CPU_KERNEL( "SVE", VLC_CPU_ARM_SVE, merge8_arm_sve ),
+#endif
+#if defined(CAN_COMPILE_ARM64)
+    VLC_CPU_KERNEL( "NEON", VLC_CPU_ARM_NEON, merge8_arm64_neon ),
+#endif
+    VLC_CPU_KERNEL( "C", 0, Merge8BitGeneric ),
+};
+
+static const struct vlc_cpu_kernel merge16_kernels[] = {
+#if defined(CAN_COMPILE_SSE2)
+    VLC_CPU_KERNEL( "SSE2", VLC_CPU_SSE2, Merge16BitSSE2 ),
+#endif
+#if defined(CAN_COMPILE_ARM)
+    VLC_CPU_KERNEL( "NEON", VLC_CPU_ARM_NEON, merge16_arm_neon ),
+    VLC_CPU_KERNEL( "ARMv6", VLC_CPU_ARMv6, merge16_armv6 ),
+#endif
+#if defined(CAN_COMPILE_SVE)
+    VLC_CPU_KERNEL( "SVE", VLC_CPU_ARM_SVE, merge16_arm_sve ),
+#endif
+#if defined(CAN_COMPILE_ARM64)
+    VLC_CPU_KERNEL( "NEON", VLC_CPU_ARM_NEON, merge16_arm64_neon ),
+#endif
+    VLC_CPU_KERNEL( "C", 0, Merge16BitGeneric ),
+};
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -537,59 +584,25 @@ notsupp:
 
     IVTCClearState( p_filter );
 
-#if defined(CAN_COMPILE_C_ALTIVEC)
-    if( pixel_size == 1 && vlc_CPU_ALTIVEC() )
-        p_sys->pf_merge = MergeAltivec;
-    else
-#endif
-#if defined(CAN_COMPILE_SSE2)
-    if( vlc_CPU_SSE2() )
-    {
-        p_sys->pf_merge = pixel_size == 1 ? Merge8BitSSE2 : Merge16BitSSE2;
-        p_sys->pf_end_merge = EndMMX;
-    }
-    else
-#endif
-#if defined(CAN_COMPILE_MMXEXT)
-    if( pixel_size == 1 && vlc_CPU_MMXEXT() )
-    {
-        p_sys->pf_merge = MergeMMXEXT;
-        p_sys->pf_end_merge = EndMMX;
-    }
-    else
-#endif
-#if defined(CAN_COMPILE_3DNOW)
-    if( pixel_size == 1 && vlc_CPU_3dNOW() )
-    {
-        p_sys->pf_merge = Merge3DNow;
-        p_sys->pf_end_merge = End3DNow;
-    }
-    else
-#endif
-#if defined(CAN_COMPILE_ARM)
-    if( vlc_CPU_ARM_NEON() )
-        p_sys->pf_merge = pixel_size == 1 ? merge8_arm_neon : merge16_arm_neon;
-    else
-    if( vlc_CPU_ARMv6() )
-        p_sys->pf_merge = pixel_size == 1 ? merge8_armv6 : merge16_armv6;
-    else
-#endif
-#if defined(CAN_COMPILE_SVE)
-    if( vlc_CPU_ARM_SVE() )
-        p_sys->pf_merge = pixel_size == 1 ? merge8_arm_sve : merge16_arm_sve;
-    else
-#endif
-#if defined(CAN_COMPILE_ARM64)
-    if( vlc_CPU_ARM_NEON() )
-        p_sys->pf_merge = pixel_size == 1 ? merge8_arm64_neon : merge16_arm64_neon;
-    else
-#endif
-    {
-        p_sys->pf_merge = pixel_size == 1 ? Merge8BitGeneric : Merge16BitGeneric;
+    const struct vlc_cpu_kernel *merge =
+        (pixel_size == 1)
+            ? vlc_CPU_SelectKernel( p_filter, "8-bit merge", merge8_kernels,
+                                    ARRAY_SIZE(merge8_kernels) )
+            : vlc_CPU_SelectKernel( p_filter, "16-bit merge", merge16_kernels,
+                                    ARRAY_SIZE(merge16_kernels) );
+    p_sys->pf_merge = (void (*)( void *, const void *, const void *,
+                                 size_t ))merge->func;
 #if defined(__i386__) || defined(__x86_64__)
-        p_sys->pf_end_merge = NULL;
+    p_sys->pf_end_merge = NULL;
+# if defined(CAN_COMPILE_3DNOW)
+    if( merge->flags & VLC_CPU_3dNOW )
+        p_sys->pf_end_merge = End3DNow;
+# endif
+# if defined(CAN_COMPILE_MMXEXT) || defined(CAN_COMPILE_SSE)
+    if( merge->flags & (VLC_CPU_MMXEXT | VLC_CPU_SSE2) )
+        p_sys->pf_end_merge = EndMMX;
+# endif
 #endif
-    }
 
     /* */
     video_format_t fmt;
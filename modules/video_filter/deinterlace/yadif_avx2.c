@@ -0,0 +1,313 @@
+/*****************************************************************************
+ * yadif_avx2.c : AVX2 versions of the Yadif line filters
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef YADIF_TEST
+# undef NDEBUG
+#endif
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_AVX2_INTRINSICS
+#include <immintrin.h>
+
+#include "common.h"      /* FFMIN3 et al. */
+#include "yadif.h"
+
+#define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+
+/* The samples are widened to 32-bits, so that the same code handles 8 and
+ * 16-bits planes: 8 pixels are filtered per iteration, exactly as done by
+ * the FILTER macro of yadif.h. */
+
+static inline VLC_AVX2 __m256i Load(const uint8_t *row, int x, bool wide)
+{
+    if (wide)
+        return _mm256_cvtepu16_epi32(
+            _mm_loadu_si128((const __m128i *)&((const uint16_t *)row)[x]));
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&row[x]));
+}
+
+static inline VLC_AVX2 __m256i AbsDiff(__m256i a, __m256i b)
+{
+    return _mm256_abs_epi32(_mm256_sub_epi32(a, b));
+}
+
+static inline VLC_AVX2 __m256i Average(__m256i a, __m256i b)
+{
+    return _mm256_srai_epi32(_mm256_add_epi32(a, b), 1);
+}
+
+/* CHECK(j) of yadif.h, for the lanes selected by valid */
+static inline VLC_AVX2 __m256i Check(const uint8_t *up, const uint8_t *down,
+                                     int x, int j, bool wide, __m256i valid,
+                                     __m256i *spatial_score,
+                                     __m256i *spatial_pred)
+{
+    __m256i score = _mm256_add_epi32(
+        _mm256_add_epi32(AbsDiff(Load(up, x - 1 + j, wide),
+                                 Load(down, x - 1 - j, wide)),
+                         AbsDiff(Load(up, x + j, wide),
+                                 Load(down, x - j, wide))),
+        AbsDiff(Load(up, x + 1 + j, wide), Load(down, x + 1 - j, wide)));
+    __m256i better = _mm256_and_si256(valid,
+                                      _mm256_cmpgt_epi32(*spatial_score, score));
+
+    *spatial_score = _mm256_blendv_epi8(*spatial_score, score, better);
+    *spatial_pred = _mm256_blendv_epi8(*spatial_pred,
+                                       Average(Load(up, x + j, wide),
+                                               Load(down, x - j, wide)),
+                                       better);
+    return better;
+}
+
+static inline VLC_AVX2 void Store(uint8_t *row, int x, __m256i v, bool wide)
+{
+    /* the values are within range, see FILTER */
+    v = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+
+    __m128i lo = _mm256_castsi256_si128(v);
+    if (wide)
+        _mm_storeu_si128((__m128i *)&((uint16_t *)row)[x], lo);
+    else
+        _mm_storel_epi64((__m128i *)&row[x], _mm_packus_epi16(lo, lo));
+}
+
+static inline VLC_AVX2 int FilterLine(uint8_t *dst, const uint8_t *prev,
+                                      const uint8_t *cur, const uint8_t *next,
+                                      int w, int prefs, int mrefs, int parity,
+                                      int mode, bool wide)
+{
+    const uint8_t *prev2 = parity ? prev : cur;
+    const uint8_t *next2 = parity ? cur  : next;
+    const uint8_t *up = cur + mrefs, *down = cur + prefs;
+    const __m256i all = _mm256_set1_epi32(-1);
+    int x;
+
+    for (x = 0; x + 8 <= w; x += 8)
+    {
+        __m256i c = Load(up, x, wide);
+        __m256i e = Load(down, x, wide);
+        __m256i p2 = Load(prev2, x, wide);
+        __m256i n2 = Load(next2, x, wide);
+        __m256i d = Average(p2, n2);
+
+        __m256i temporal_diff0 = AbsDiff(p2, n2);
+        __m256i temporal_diff1 = _mm256_srai_epi32(_mm256_add_epi32(
+            AbsDiff(Load(prev + mrefs, x, wide), c),
+            AbsDiff(Load(prev + prefs, x, wide), e)), 1);
+        __m256i temporal_diff2 = _mm256_srai_epi32(_mm256_add_epi32(
+            AbsDiff(Load(next + mrefs, x, wide), c),
+            AbsDiff(Load(next + prefs, x, wide), e)), 1);
+        __m256i diff = _mm256_max_epi32(_mm256_max_epi32(
+            _mm256_srai_epi32(temporal_diff0, 1), temporal_diff1),
+            temporal_diff2);
+
+        __m256i spatial_pred = Average(c, e);
+        __m256i spatial_score = _mm256_add_epi32(_mm256_add_epi32(
+            AbsDiff(Load(up, x - 1, wide), Load(down, x - 1, wide)),
+            AbsDiff(c, e)),
+            AbsDiff(Load(up, x + 1, wide), Load(down, x + 1, wide)));
+        spatial_score = _mm256_add_epi32(spatial_score, all); /* - 1 */
+
+        __m256i better = Check(up, down, x, -1, wide, all,
+                               &spatial_score, &spatial_pred);
+        Check(up, down, x, -2, wide, better, &spatial_score, &spatial_pred);
+        better = Check(up, down, x, 1, wide, all,
+                       &spatial_score, &spatial_pred);
+        Check(up, down, x, 2, wide, better, &spatial_score, &spatial_pred);
+
+        if (mode < 2)
+        {
+            __m256i b = Average(Load(prev2 + 2 * mrefs, x, wide),
+                                Load(next2 + 2 * mrefs, x, wide));
+            __m256i f = Average(Load(prev2 + 2 * prefs, x, wide),
+                                Load(next2 + 2 * prefs, x, wide));
+            __m256i de = _mm256_sub_epi32(d, e);
+            __m256i dc = _mm256_sub_epi32(d, c);
+            __m256i bc = _mm256_sub_epi32(b, c);
+            __m256i fe = _mm256_sub_epi32(f, e);
+            __m256i max = _mm256_max_epi32(_mm256_max_epi32(de, dc),
+                                           _mm256_min_epi32(bc, fe));
+            __m256i min = _mm256_min_epi32(_mm256_min_epi32(de, dc),
+                                           _mm256_max_epi32(bc, fe));
+
+            diff = _mm256_max_epi32(_mm256_max_epi32(diff, min),
+                                    _mm256_sub_epi32(_mm256_setzero_si256(),
+                                                     max));
+        }
+
+        /* diff is never negative, so this is the clipping of FILTER */
+        spatial_pred = _mm256_min_epi32(spatial_pred,
+                                        _mm256_add_epi32(d, diff));
+        spatial_pred = _mm256_max_epi32(spatial_pred,
+                                        _mm256_sub_epi32(d, diff));
+        Store(dst, x, spatial_pred, wide);
+    }
+    return x;
+}
+
+void vlcpriv_yadif_filter_line_avx2(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                                    uint8_t *next, int w, int prefs, int mrefs,
+                                    int parity, int mode)
+{
+    int x = FilterLine(dst, prev, cur, next, w, prefs, mrefs, parity, mode,
+                       false);
+    if (x < w)
+        yadif_filter_line_c(dst + x, prev + x, cur + x, next + x, w - x,
+                            prefs, mrefs, parity, mode);
+}
+
+void vlcpriv_yadif_filter_line_16bit_avx2(uint8_t *dst, uint8_t *prev,
+                                          uint8_t *cur, uint8_t *next, int w,
+                                          int prefs, int mrefs, int parity,
+                                          int mode)
+{
+    int x = FilterLine(dst, prev, cur, next, w, prefs, mrefs, parity, mode,
+                       true);
+    if (x < w)
+        yadif_filter_line_c_16bit(dst + 2 * x, prev + 2 * x, cur + 2 * x,
+                                  next + 2 * x, w - x, prefs, mrefs, parity,
+                                  mode);
+}
+#endif /* HAVE_AVX2_INTRINSICS */
+
+#ifdef YADIF_TEST
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef void (*yadif_line_t)(uint8_t *, uint8_t *, uint8_t *, uint8_t *,
+                             int, int, int, int, int);
+
+#define TEST_PITCH 4096
+#define TEST_ROWS  5 /* two rows above and below the filtered one */
+#define TEST_MARGIN 16
+
+struct test_frame
+{
+    uint8_t *base;
+    uint8_t *row; /* filtered row, after the margin */
+};
+
+static void FrameNew(struct test_frame *frame, unsigned bytes, unsigned *seed)
+{
+    const size_t size = TEST_ROWS * TEST_PITCH + 2 * TEST_MARGIN;
+
+    frame->base = malloc(size);
+    assert(frame->base != NULL);
+    for (size_t i = 0; i < size; i++)
+    {
+        *seed = *seed * 1103515245 + 12345;
+        frame->base[i] = *seed >> 16;
+    }
+    if (bytes == 2) /* 10-bits samples */
+        for (size_t i = 1; i < size; i += 2)
+            frame->base[i] &= 3;
+    frame->row = frame->base + TEST_MARGIN + 2 * TEST_PITCH;
+}
+
+static void Filter(yadif_line_t filter, uint8_t *dst,
+                   struct test_frame *frames, int w, int parity, int mode)
+{
+    filter(dst, frames[0].row, frames[1].row, frames[2].row, w,
+           TEST_PITCH, -TEST_PITCH, parity, mode);
+}
+
+int main(int argc, char **argv)
+{
+    static const int widths[] = { 1, 7, 8, 9, 15, 16, 17, 33, 720, 1920 };
+    const bool bench = argc > 1 && !strcmp(argv[1], "bench");
+    const unsigned loops = argc > 2 ? atoi(argv[2]) : 1000;
+    unsigned seed = 1;
+
+    alarm(bench ? 0 : 30);
+
+#ifdef HAVE_AVX2_INTRINSICS
+    if (!vlc_CPU_AVX2())
+#endif
+    {
+        fprintf(stderr, "WARNING: could not test AVX2\n");
+        return 77;
+    }
+
+#ifdef HAVE_AVX2_INTRINSICS
+    for (unsigned bytes = 1; bytes <= 2; bytes++)
+    {
+        yadif_line_t c = bytes == 2 ? yadif_filter_line_c_16bit
+                                    : yadif_filter_line_c;
+        yadif_line_t simd = bytes == 2 ? vlcpriv_yadif_filter_line_16bit_avx2
+                                       : vlcpriv_yadif_filter_line_avx2;
+        struct test_frame frames[3];
+        uint8_t ref[TEST_PITCH], out[TEST_PITCH];
+
+        for (unsigned i = 0; i < 3; i++)
+            FrameNew(&frames[i], bytes, &seed);
+
+        if (bench)
+        {
+            const int w = 1920;
+            vlc_tick_t start = vlc_tick_now();
+            for (unsigned n = 0; n < loops; n++)
+                Filter(c, ref, frames, w, n & 1, 0);
+            vlc_tick_t c_time = vlc_tick_now() - start;
+
+            start = vlc_tick_now();
+            for (unsigned n = 0; n < loops; n++)
+                Filter(simd, out, frames, w, n & 1, 0);
+            vlc_tick_t simd_time = vlc_tick_now() - start;
+
+            printf("%u-bits: C %8.1f Mpixels/s, AVX2 %8.1f Mpixels/s\n",
+                   bytes * 8,
+                   (double)w * loops * CLOCK_FREQ / __MAX(c_time, 1) / 1e6,
+                   (double)w * loops * CLOCK_FREQ / __MAX(simd_time, 1) / 1e6);
+        }
+        else
+        {
+            for (size_t i = 0; i < ARRAY_SIZE(widths); i++)
+                for (int parity = 0; parity < 2; parity++)
+                    for (int mode = 0; mode <= 2; mode += 2)
+                    {
+                        const int w = widths[i];
+
+                        fprintf(stderr, "testing: %u-bits width %d parity %d"
+                                " mode %d\n", bytes * 8, w, parity, mode);
+                        memset(ref, 0, sizeof(ref));
+                        memset(out, 0, sizeof(out));
+                        Filter(c, ref, frames, w, parity, mode);
+                        Filter(simd, out, frames, w, parity, mode);
+                        assert(!memcmp(ref, out, sizeof(ref)));
+                    }
+        }
+
+        for (unsigned i = 0; i < 3; i++)
+            free(frames[i].base);
+    }
+#endif
+    return 0;
+}
+#endif /* YADIF_TEST */
@@ -0,0 +1,408 @@
+/*****************************************************************************
+ * filterbench.c : video filters and converters benchmark plugin for vlc
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_image.h>
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int Create( vlc_object_t * );
+static void Destroy( vlc_object_t * );
+
+static picture_t *Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+
+#define FILTERS_TEXT N_("Filters to benchmark")
+#define FILTERS_LONGTEXT N_("Chain of video filters to benchmark, with the " \
+                            "same syntax as the --video-filter option, " \
+                            "e.g. deinterlace{deinterlace-mode=yadif}")
+
+#define LOOPS_TEXT N_("Number of frames")
+#define LOOPS_LONGTEXT N_("The number of frames fed to the filters")
+
+#define IMAGE_TEXT N_("Source image")
+#define IMAGE_LONGTEXT N_("The image fed to the filters. A synthetic " \
+                          "picture is used if empty.")
+
+#define CHROMAS_TEXT N_("Chromas to benchmark")
+#define CHROMAS_LONGTEXT N_("Comma separated list of source chromas, each " \
+                            "of them being benchmarked in turn, e.g. " \
+                            "I420,NV12,RV32")
+
+#define WIDTH_TEXT N_("Width of the source frames")
+#define HEIGHT_TEXT N_("Height of the source frames")
+#define SIZE_LONGTEXT N_("Dimension of the pictures used when no image file " \
+                         "is given")
+
+#define OUT_CHROMA_TEXT N_("Output chroma")
+#define OUT_WIDTH_TEXT N_("Output width")
+#define OUT_HEIGHT_TEXT N_("Output height")
+#define OUT_LONGTEXT N_("If different from the output of the filters, a " \
+                        "video converter is appended to the chain and " \
+                        "benchmarked with it. The source value is kept if " \
+                        "empty or zero.")
+
+#define CFG_PREFIX "filterbench-"
+
+vlc_module_begin ()
+    set_description( N_("Video filters benchmark") )
+    set_shortname( N_("Filterbench" ))
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_capability( "video filter", 0 )
+
+    set_section( N_("Benchmarking"), NULL )
+    add_string( CFG_PREFIX "filters", NULL, FILTERS_TEXT,
+              FILTERS_LONGTEXT, false )
+    add_integer( CFG_PREFIX "loops", 1000, LOOPS_TEXT,
+              LOOPS_LONGTEXT, false )
+
+    set_section( N_("Source"), NULL )
+    add_loadfile(CFG_PREFIX "image", NULL, IMAGE_TEXT, IMAGE_LONGTEXT)
+    add_string( CFG_PREFIX "chromas", "I420", CHROMAS_TEXT,
+              CHROMAS_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "width", 1920, 2, 8192, WIDTH_TEXT,
+              SIZE_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "height", 1080, 2, 8192, HEIGHT_TEXT,
+              SIZE_LONGTEXT, false )
+
+    set_section( N_("Output"), NULL )
+    add_string( CFG_PREFIX "out-chroma", NULL, OUT_CHROMA_TEXT,
+              OUT_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "out-width", 0, 0, 8192,
+              OUT_WIDTH_TEXT, OUT_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "out-height", 0, 0, 8192,
+              OUT_HEIGHT_TEXT, OUT_LONGTEXT, false )
+
+    set_callbacks( Create, Destroy )
+vlc_module_end ()
+
+static const char *const ppsz_filter_options[] = {
+    "filters", "loops", "image", "chromas", "width", "height",
+    "out-chroma", "out-width", "out-height", NULL
+};
+
+/*****************************************************************************
+ * filter_sys_t: filter method descriptor
+ *****************************************************************************/
+#define MAX_CHROMAS 16
+/* Distinct source pictures, so that filters keeping a history (such as
+ * deinterlacers) see different pictures */
+#define SOURCE_PICTURES 8
+
+typedef struct
+{
+    bool b_done;
+    int i_loops;
+    unsigned i_width, i_height;
+    unsigned i_out_width, i_out_height;
+    vlc_fourcc_t i_out_chroma;
+
+    char *psz_filters;
+    char *psz_image;
+
+    unsigned i_chromas;
+    vlc_fourcc_t chromas[MAX_CHROMAS];
+
+    unsigned i_allocs; /**< Output pictures allocated by the chain */
+} filter_sys_t;
+
+static vlc_fourcc_t filterbench_ParseChroma( const char *psz )
+{
+    if( psz == NULL || strlen( psz ) != 4 )
+        return 0;
+    return VLC_FOURCC( psz[0], psz[1], psz[2], psz[3] );
+}
+
+/* Synthetic picture, with some texture so that the filters do not work on
+ * uniform areas */
+static picture_t *filterbench_NewImage( vlc_fourcc_t i_chroma,
+                                        unsigned i_width, unsigned i_height )
+{
+    video_format_t fmt;
+
+    video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( p_pic == NULL )
+        return NULL;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = ( x * 3 + y ) ^ ( x >> 3 );
+    }
+    return p_pic;
+}
+
+static picture_t *filterbench_LoadImage( filter_t *p_filter,
+                                         vlc_fourcc_t i_chroma )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_pic;
+
+    if( p_sys->psz_image == NULL || *p_sys->psz_image == '\0' )
+        p_pic = filterbench_NewImage( i_chroma, p_sys->i_width,
+                                      p_sys->i_height );
+    else
+    {
+        video_format_t fmt_out;
+        video_format_Init( &fmt_out, i_chroma );
+
+        image_handler_t *p_image = image_HandlerCreate( p_filter );
+        p_pic = image_ReadUrl( p_image, p_sys->psz_image, &fmt_out );
+        video_format_Clean( &fmt_out );
+        image_HandlerDelete( p_image );
+    }
+
+    if( p_pic == NULL )
+        msg_Err( p_filter, "Unable to create %4.4s source image",
+                 (const char *)&i_chroma );
+    return p_pic;
+}
+
+/*****************************************************************************
+ * Create: allocates video thread output method
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys;
+    char *psz_cmd;
+
+    /* Allocate structure */
+    p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
+    if( p_filter->p_sys == NULL )
+        return VLC_ENOMEM;
+
+    p_sys = p_filter->p_sys;
+    p_sys->b_done = false;
+
+    p_filter->pf_video_filter = Filter;
+
+    config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    p_sys->psz_filters = var_CreateGetString( p_filter, CFG_PREFIX "filters" );
+    p_sys->i_loops = var_CreateGetInteger( p_filter, CFG_PREFIX "loops" );
+    p_sys->psz_image = var_CreateGetString( p_filter, CFG_PREFIX "image" );
+    p_sys->i_width = var_CreateGetInteger( p_filter, CFG_PREFIX "width" );
+    p_sys->i_height = var_CreateGetInteger( p_filter, CFG_PREFIX "height" );
+    p_sys->i_out_width = var_CreateGetInteger( p_filter,
+                                               CFG_PREFIX "out-width" );
+    p_sys->i_out_height = var_CreateGetInteger( p_filter,
+                                                CFG_PREFIX "out-height" );
+    psz_cmd = var_CreateGetString( p_filter, CFG_PREFIX "out-chroma" );
+    p_sys->i_out_chroma = filterbench_ParseChroma( psz_cmd );
+    free( psz_cmd );
+
+    p_sys->i_chromas = 0;
+    psz_cmd = var_CreateGetString( p_filter, CFG_PREFIX "chromas" );
+    for( char *psz_chroma = psz_cmd, *psz_next; psz_chroma != NULL
+         && *psz_chroma != '\0' && p_sys->i_chromas < MAX_CHROMAS;
+         psz_chroma = psz_next )
+    {
+        psz_next = strchr( psz_chroma, ',' );
+        if( psz_next != NULL )
+            *psz_next++ = '\0';
+
+        vlc_fourcc_t i_chroma = filterbench_ParseChroma( psz_chroma );
+        if( i_chroma == 0 )
+        {
+            msg_Warn( p_filter, "ignoring invalid chroma %s", psz_chroma );
+            continue;
+        }
+        p_sys->chromas[p_sys->i_chromas++] = i_chroma;
+    }
+    free( psz_cmd );
+
+    if( p_sys->i_chromas == 0 || p_sys->i_loops <= 0 )
+    {
+        msg_Err( p_filter, "nothing to benchmark" );
+        free( p_sys->psz_filters );
+        free( p_sys->psz_image );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Destroy: destroy video thread output method
+ *****************************************************************************/
+static void Destroy( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    free( p_sys->psz_filters );
+    free( p_sys->psz_image );
+    free( p_sys );
+}
+
+static picture_t *BufferNew( filter_t *p_chained )
+{
+    filter_t *p_filter = p_chained->owner.sys;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    p_sys->i_allocs++;
+    return picture_NewFromFormat( &p_chained->fmt_out.video );
+}
+
+static const struct filter_video_callbacks filterbench_cbs =
+{
+    .buffer_new = BufferNew,
+};
+
+/*****************************************************************************
+ * Benchmark: runs the chain on one source chroma and reports the throughput
+ *****************************************************************************/
+static void Benchmark( filter_t *p_filter, vlc_fourcc_t i_chroma )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *pp_src[SOURCE_PICTURES];
+    es_format_t fmt_in, fmt_out;
+    unsigned i_src;
+
+    for( i_src = 0; i_src < SOURCE_PICTURES; i_src++ )
+    {
+        pp_src[i_src] = filterbench_LoadImage( p_filter, i_chroma );
+        if( pp_src[i_src] == NULL )
+            goto out;
+    }
+
+    es_format_Init( &fmt_in, VIDEO_ES, i_chroma );
+    video_format_Copy( &fmt_in.video, &pp_src[0]->format );
+    fmt_in.video.i_frame_rate = 25;
+    fmt_in.video.i_frame_rate_base = 1;
+
+    es_format_Copy( &fmt_out, &fmt_in );
+    if( p_sys->i_out_chroma != 0 )
+        fmt_out.i_codec = fmt_out.video.i_chroma = p_sys->i_out_chroma;
+    if( p_sys->i_out_width != 0 )
+        fmt_out.video.i_width = fmt_out.video.i_visible_width =
+            p_sys->i_out_width;
+    if( p_sys->i_out_height != 0 )
+        fmt_out.video.i_height = fmt_out.video.i_visible_height =
+            p_sys->i_out_height;
+
+    filter_owner_t owner = {
+        .video = &filterbench_cbs,
+        .sys = p_filter,
+    };
+    filter_chain_t *p_chain = filter_chain_NewVideo( p_filter, true, &owner );
+    if( p_chain == NULL )
+        goto clean;
+
+    /* The filters may change the format, the requested output format is
+     * then reached with a converter */
+    filter_chain_Reset( p_chain, &fmt_in, &fmt_in );
+    if( filter_chain_AppendFromString( p_chain, p_sys->psz_filters ) < 0 )
+        goto error;
+
+    const es_format_t *p_fmt_chain = filter_chain_GetFmtOut( p_chain );
+    if( !video_format_IsSimilar( &p_fmt_chain->video, &fmt_out.video )
+     && filter_chain_AppendConverter( p_chain, NULL, &fmt_out ) )
+    {
+        msg_Err( p_filter, "Cannot convert %4.4s to %4.4s",
+                 (const char *)&p_fmt_chain->video.i_chroma,
+                 (const char *)&fmt_out.video.i_chroma );
+        goto error;
+    }
+
+    unsigned i_outputs = 0;
+    p_sys->i_allocs = 0;
+
+    vlc_tick_t time = vlc_tick_now();
+    for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
+    {
+        picture_t *p_pic = picture_Hold( pp_src[i_iter % SOURCE_PICTURES] );
+        p_pic->date = VLC_TICK_0 + vlc_tick_from_samples( i_iter, 25 );
+
+        for( p_pic = filter_chain_VideoFilter( p_chain, p_pic );
+             p_pic != NULL; p_pic = filter_chain_VideoFilter( p_chain, NULL ) )
+        {
+            i_outputs++;
+            picture_Release( p_pic );
+        }
+    }
+    time = vlc_tick_now() - time;
+    if( time <= 0 )
+        time = 1;
+
+    const unsigned i_pixels = fmt_in.video.i_visible_width
+                            * fmt_in.video.i_visible_height;
+    const double f_frames = p_sys->i_loops;
+
+    msg_Info( p_filter, "%4.4s: %d frames of %ux%u in %f sec, %u output "
+              "pictures", (const char *)&i_chroma, p_sys->i_loops,
+              fmt_in.video.i_visible_width, fmt_in.video.i_visible_height,
+              secf_from_vlc_tick(time), i_outputs );
+    msg_Info( p_filter, "%4.4s: %f ns/frame, %f Mpixels/second, "
+              "%f allocations/frame", (const char *)&i_chroma,
+              NS_FROM_VLC_TICK(time) / f_frames,
+              f_frames * i_pixels / secf_from_vlc_tick(time) / 1000000.,
+              p_sys->i_allocs / f_frames );
+
+error:
+    filter_chain_Delete( p_chain );
+clean:
+    es_format_Clean( &fmt_out );
+    es_format_Clean( &fmt_in );
+out:
+    while( i_src > 0 )
+        picture_Release( pp_src[--i_src] );
+}
+
+/*****************************************************************************
+ * Filter: runs the benchmark on the first picture
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done )
+        return p_pic;
+
+    for( unsigned i = 0; i < p_sys->i_chromas; i++ )
+        Benchmark( p_filter, p_sys->chromas[i] );
+
+    p_sys->b_done = true;
+    return p_pic;
+}
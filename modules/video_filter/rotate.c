@@ -197,35 +197,25 @@ static void Destroy( vlc_object_t *p_this )
     free( p_sys );
 }
 
-/*****************************************************************************
- *
- *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+struct rotate_job
 {
+    const picture_t *p_pic;
     picture_t *p_outpic;
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    if( !p_pic ) return NULL;
-
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-
-    if( p_sys->p_motion != NULL )
-    {
-        int i_angle = motion_get_angle( p_sys->p_motion );
-        store_trigo( p_sys, i_angle / 20.f );
-    }
-
     int i_sin, i_cos;
-    fetch_trigo( p_sys, &i_sin, &i_cos );
+    int i_y_offset, i_u_offset, i_v_offset; /* packed YUV */
+};
+
+static void RotateRows( void *opaque, unsigned first, unsigned count )
+{
+    const struct rotate_job *job = opaque;
+    const picture_t *p_pic = job->p_pic;
+    picture_t *p_outpic = job->p_outpic;
+    const int i_sin = job->i_sin, i_cos = job->i_cos;
+    const unsigned i_lines = p_pic->p[Y_PLANE].i_visible_lines;
 
     for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
     {
-        plane_t *p_srcp = &p_pic->p[i_plane];
+        const plane_t *p_srcp = &p_pic->p[i_plane];
         plane_t *p_dstp = &p_outpic->p[i_plane];
 
         const int i_visible_lines = p_srcp->i_visible_lines;
@@ -241,11 +231,17 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 
         const int i_line_next =  i_cos / i_aspect -i_sin*i_visible_pitch;
         const int i_col_next  = -i_sin / i_aspect -i_cos*i_visible_pitch;
+        /* rows of this plane matching the band of luma rows */
+        const int i_first = first * i_visible_lines / i_lines;
+        const int i_end = (first + count) * i_visible_lines / i_lines;
+
         int i_line_orig0 = ( - i_cos * i_line_center / i_aspect
-                             - i_sin * i_col_center + (1<<11) );
+                             - i_sin * i_col_center + (1<<11) )
+                           + i_first * ( i_cos / i_aspect );
         int i_col_orig0 =    i_sin * i_line_center / i_aspect
-                           - i_cos * i_col_center + (1<<11);
-        for( int y = 0; y < i_visible_lines; y++)
+                           - i_cos * i_col_center + (1<<11)
+                           - i_first * ( i_sin / i_aspect );
+        for( int y = i_first; y < i_end; y++)
         {
             uint8_t *p_out = &p_dstp->p_pixels[y * p_dstp->i_pitch];
 
@@ -321,64 +317,63 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
             i_col_orig0 += i_col_next;
         }
     }
-
-    return CopyInfoAndRelease( p_outpic, p_pic );
 }
 
 /*****************************************************************************
  *
  *****************************************************************************/
-static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     picture_t *p_outpic;
     filter_sys_t *p_sys = p_filter->p_sys;
 
     if( !p_pic ) return NULL;
 
-    int i_u_offset, i_v_offset, i_y_offset;
-
-    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
-                             &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
     {
-        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                  (char*)&(p_pic->format.i_chroma) );
         picture_Release( p_pic );
         return NULL;
     }
 
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
+    if( p_sys->p_motion != NULL )
     {
-        picture_Release( p_pic );
-        return NULL;
+        int i_angle = motion_get_angle( p_sys->p_motion );
+        store_trigo( p_sys, i_angle / 20.f );
     }
 
+    struct rotate_job job = { .p_pic = p_pic, .p_outpic = p_outpic };
+    fetch_trigo( p_sys, &job.i_sin, &job.i_cos );
+
+    filter_ParallelRows( p_pic->p[Y_PLANE].i_visible_lines, RotateRows, &job );
+
+    return CopyInfoAndRelease( p_outpic, p_pic );
+}
+
+static void RotatePackedRows( void *opaque, unsigned first, unsigned count )
+{
+    const struct rotate_job *job = opaque;
+    const picture_t *p_pic = job->p_pic;
+    picture_t *p_outpic = job->p_outpic;
+    const int i_sin = job->i_sin, i_cos = job->i_cos;
+
     const int i_visible_pitch = p_pic->p->i_visible_pitch>>1; /* In fact it's i_visible_pixels */
     const int i_visible_lines = p_pic->p->i_visible_lines;
 
-    const uint8_t *p_in   = p_pic->p->p_pixels+i_y_offset;
-    const uint8_t *p_in_u = p_pic->p->p_pixels+i_u_offset;
-    const uint8_t *p_in_v = p_pic->p->p_pixels+i_v_offset;
+    const uint8_t *p_in   = p_pic->p->p_pixels+job->i_y_offset;
+    const uint8_t *p_in_u = p_pic->p->p_pixels+job->i_u_offset;
+    const uint8_t *p_in_v = p_pic->p->p_pixels+job->i_v_offset;
     const int i_in_pitch  = p_pic->p->i_pitch;
 
-    uint8_t *p_out   = p_outpic->p->p_pixels+i_y_offset;
-    uint8_t *p_out_u = p_outpic->p->p_pixels+i_u_offset;
-    uint8_t *p_out_v = p_outpic->p->p_pixels+i_v_offset;
+    uint8_t *p_out   = p_outpic->p->p_pixels+job->i_y_offset;
+    uint8_t *p_out_u = p_outpic->p->p_pixels+job->i_u_offset;
+    uint8_t *p_out_v = p_outpic->p->p_pixels+job->i_v_offset;
     const int i_out_pitch = p_outpic->p->i_pitch;
 
     const int i_line_center = i_visible_lines>>1;
     const int i_col_center  = i_visible_pitch>>1;
 
-    if( p_sys->p_motion != NULL )
-    {
-        int i_angle = motion_get_angle( p_sys->p_motion );
-        store_trigo( p_sys, i_angle / 20.f );
-    }
-
-    int i_sin, i_cos;
-    fetch_trigo( p_sys, &i_sin, &i_cos );
-
-    for( int i_line = 0; i_line < i_visible_lines; i_line++ )
+    for( int i_line = first; i_line < (int)(first + count); i_line++ )
     {
         for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
         {
@@ -428,6 +423,52 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
             }
         }
     }
+}
+
+/*****************************************************************************
+ *
+ *****************************************************************************/
+static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_outpic;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( !p_pic ) return NULL;
+
+    int i_u_offset, i_v_offset, i_y_offset;
+
+    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
+                             &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
+    {
+        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
+                  (char*)&(p_pic->format.i_chroma) );
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    if( p_sys->p_motion != NULL )
+    {
+        int i_angle = motion_get_angle( p_sys->p_motion );
+        store_trigo( p_sys, i_angle / 20.f );
+    }
+
+    struct rotate_job job = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .i_y_offset = i_y_offset,
+        .i_u_offset = i_u_offset,
+        .i_v_offset = i_v_offset,
+    };
+    fetch_trigo( p_sys, &job.i_sin, &job.i_cos );
+
+    filter_ParallelRows( p_pic->p->i_visible_lines, RotatePackedRows, &job );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
@@ -159,24 +159,44 @@ static void Destroy( vlc_object_t *p_this )
 #define IS_YUV_420_10BITS(fmt) (fmt == VLC_CODEC_I420_10L ||    \
                                 fmt == VLC_CODEC_I420_10B)
 
-#define SHARPEN_FRAME(maxval, data_t)                                   \
+struct sharpen_job
+{
+    const picture_t *p_pic;
+    picture_t *p_outpic;
+    int sigma;
+};
+
+#define SHARPEN_ROWS(maxval, data_t)                                    \
     do                                                                  \
     {                                                                   \
         assert((maxval) >= 0);                                          \
+        const struct sharpen_job *job = opaque;                         \
+        const picture_t *p_pic = job->p_pic;                            \
+        picture_t *p_outpic = job->p_outpic;                            \
+        const int v1 = -1;                                              \
+        const int v2 = 3; /* 2^3 = 8 */                                 \
+        const unsigned i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines; \
+        const unsigned i_visible_pitch = p_pic->p[Y_PLANE].i_visible_pitch; \
         data_t *restrict p_src = (data_t *)p_pic->p[Y_PLANE].p_pixels;  \
         data_t *restrict p_out = (data_t *)p_outpic->p[Y_PLANE].p_pixels; \
         const unsigned data_sz = sizeof(data_t);                        \
+        const unsigned i_visible_width = i_visible_pitch / data_sz;     \
         const int i_src_line_len = p_pic->p[Y_PLANE].i_pitch / data_sz; \
         const int i_out_line_len = p_outpic->p[Y_PLANE].i_pitch / data_sz; \
-        const int sigma = atomic_load(&p_sys->sigma);         \
+        const int sigma = job->sigma;                                   \
                                                                         \
-        memcpy(p_out, p_src, i_visible_pitch);                          \
-                                                                        \
-        for( unsigned i = 1; i < i_visible_lines - 1; i++ )             \
+        for( unsigned i = first; i < first + count; i++ )               \
         {                                                               \
+            if( i == 0 || i == i_visible_lines - 1 )                    \
+            {                                                           \
+                memcpy(&p_out[i * i_out_line_len],                      \
+                       &p_src[i * i_src_line_len], i_visible_pitch);    \
+                continue;                                               \
+            }                                                           \
+                                                                        \
             p_out[i * i_out_line_len] = p_src[i * i_src_line_len];      \
                                                                         \
-            for( unsigned j = data_sz; j < i_visible_pitch - 1; j++ )   \
+            for( unsigned j = 1; j < i_visible_width - 1; j++ )         \
             {                                                           \
                 const int line_idx_1 = (i - 1) * i_src_line_len;        \
                 const int line_idx_2 = i * i_src_line_len;              \
@@ -196,21 +216,24 @@ static void Destroy( vlc_object_t *p_this )
                 p_out[i * i_out_line_len + j] =                         \
                     VLC_CLIP( p_src[line_idx_2 + j] + pix, 0, maxval);  \
             }                                                           \
-            p_out[i * i_out_line_len + i_visible_pitch / data_sz - 1] = \
-                p_src[i * i_src_line_len + i_visible_pitch / data_sz - 1];  \
+            p_out[i * i_out_line_len + i_visible_width - 1] =           \
+                p_src[i * i_src_line_len + i_visible_width - 1];        \
         }                                                               \
-        memcpy(&p_out[(i_visible_lines - 1) * i_out_line_len],          \
-               &p_src[(i_visible_lines - 1) * i_src_line_len],          \
-               i_visible_pitch);                                        \
     } while (0)
 
+static void SharpenRows8( void *opaque, unsigned first, unsigned count )
+{
+    SHARPEN_ROWS(255, uint8_t);
+}
+
+static void SharpenRows16( void *opaque, unsigned first, unsigned count )
+{
+    SHARPEN_ROWS(1023, uint16_t);
+}
+
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     picture_t *p_outpic;
-    const int v1 = -1;
-    const int v2 = 3; /* 2^3 = 8 */
-    const unsigned i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
-    const unsigned i_visible_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
 
     p_outpic = filter_NewPicture( p_filter );
     if( !p_outpic )
@@ -220,11 +243,15 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     }
 
     filter_sys_t *p_sys = p_filter->p_sys;
-
-    if (!IS_YUV_420_10BITS(p_pic->format.i_chroma))
-        SHARPEN_FRAME(255, uint8_t);
-    else
-        SHARPEN_FRAME(1023, uint16_t);
+    struct sharpen_job job = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .sigma = atomic_load(&p_sys->sigma),
+    };
+
+    filter_ParallelRows( p_pic->p[Y_PLANE].i_visible_lines,
+                         IS_YUV_420_10BITS(p_pic->format.i_chroma)
+                             ? SharpenRows16 : SharpenRows8, &job );
 
     plane_CopyPixels( &p_outpic->p[U_PLANE], &p_pic->p[U_PLANE] );
     plane_CopyPixels( &p_outpic->p[V_PLANE], &p_pic->p[V_PLANE] );
@@ -32,6 +32,8 @@
 
 #include <vlc_fixups.h>
 #include <cinttypes>
+#include <atomic>
+#include <new>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -890,45 +892,78 @@ static void send_AFD(uint8_t afdcode, uint8_t ar, uint8_t *buf)
     }
 }
 
-static void PrepareVideo(vout_display_t *vd, picture_t *picture, subpicture_t *,
-                         vlc_tick_t date)
+namespace {
+
+/* DeckLink video frame backed by a picture, held until the card is done */
+class PictureVideoFrame : public IDeckLinkVideoFrame
 {
-    decklink_sys_t *sys = (decklink_sys_t *) vd->sys;
-    vlc_tick_t now = vlc_tick_now();
+public:
+    PictureVideoFrame(picture_t *pic, long width, long height)
+        : pic_(picture_Hold(pic)), width_(width), height_(height)
+    {
+        m_ref_.store(1);
+    }
 
-    if (!picture)
-        return;
+    virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, LPVOID *) { return E_NOINTERFACE; }
 
-    if (now - date > vlc_tick_from_sec( sys->video.nosignal_delay )) {
-        msg_Dbg(vd, "no signal");
-        if (sys->video.pic_nosignal) {
-            picture = sys->video.pic_nosignal;
-        } else {
-            if (sys->video.tenbits) { // I422_10L
-                plane_t *y = &picture->p[0];
-                memset(y->p_pixels, 0x0, y->i_lines * y->i_pitch);
-                for (int i = 1; i < picture->i_planes; i++) {
-                    plane_t *p = &picture->p[i];
-                    size_t len = p->i_lines * p->i_pitch / 2;
-                    int16_t *data = (int16_t*)p->p_pixels;
-                    for (size_t j = 0; j < len; j++) // XXX: SIMD
-                        data[j] = 0x200;
-                }
-            } else { // UYVY
-                size_t len = picture->p[0].i_lines * picture->p[0].i_pitch;
-                for (size_t i = 0; i < len; i+= 2) { // XXX: SIMD
-                    picture->p[0].p_pixels[i+0] = 0x80;
-                    picture->p[0].p_pixels[i+1] = 0;
-                }
-            }
-        }
-        date = now;
+    virtual ULONG STDMETHODCALLTYPE AddRef(void)
+    {
+        return m_ref_.fetch_add(1) + 1;
+    }
+
+    virtual ULONG STDMETHODCALLTYPE Release(void)
+    {
+        ULONG ref = m_ref_.fetch_sub(1) - 1;
+        if (ref == 0)
+            delete this;
+        return ref;
+    }
+
+    virtual long STDMETHODCALLTYPE GetWidth(void) { return width_; }
+    virtual long STDMETHODCALLTYPE GetHeight(void) { return height_; }
+    virtual long STDMETHODCALLTYPE GetRowBytes(void) { return pic_->p[0].i_pitch; }
+    virtual BMDPixelFormat STDMETHODCALLTYPE GetPixelFormat(void) { return bmdFormat8BitYUV; }
+    virtual BMDFrameFlags STDMETHODCALLTYPE GetFlags(void) { return bmdFrameFlagDefault; }
+
+    virtual HRESULT STDMETHODCALLTYPE GetBytes(void **buffer)
+    {
+        *buffer = pic_->p[0].p_pixels;
+        return S_OK;
     }
 
+    virtual HRESULT STDMETHODCALLTYPE GetTimecode(BMDTimecodeFormat, IDeckLinkTimecode **timecode)
+    {
+        *timecode = NULL;
+        return S_FALSE;
+    }
+
+    virtual HRESULT STDMETHODCALLTYPE GetAncillaryData(IDeckLinkVideoFrameAncillary **ancillary)
+    {
+        *ancillary = NULL;
+        return S_FALSE;
+    }
+
+private:
+    ~PictureVideoFrame()
+    {
+        picture_Release(pic_);
+    }
+
+    std::atomic<ULONG> m_ref_;
+    picture_t *pic_;
+    long width_;
+    long height_;
+};
+
+} // namespace
+
+/* Copies (and converts) a picture into a new frame of the card */
+static IDeckLinkVideoFrame *CopyVideoFrame(vout_display_t *vd, picture_t *picture,
+                                           int w, int h)
+{
+    decklink_sys_t *sys = (decklink_sys_t *) vd->sys;
     HRESULT result;
-    int w, h, stride, length;
-    w = vd->fmt.i_width;
-    h = vd->fmt.i_height;
+    int stride;
 
     IDeckLinkMutableVideoFrame *pDLVideoFrame;
     result = sys->p_output->CreateVideoFrame(w, h, w*3,
@@ -937,8 +972,7 @@ static void PrepareVideo(vout_display_t *vd, picture_t *picture, subpicture_t *,
 
     if (result != S_OK) {
         msg_Err(vd, "Failed to create video frame: 0x%X", result);
-        pDLVideoFrame = NULL;
-        goto end;
+        return NULL;
     }
 
     void *frame_bytes;
@@ -954,14 +988,15 @@ static void PrepareVideo(vout_display_t *vd, picture_t *picture, subpicture_t *,
                 sys->video.tenbits ? bmdFormat10BitYUV : bmdFormat8BitYUV, &vanc);
         if (result != S_OK) {
             msg_Err(vd, "Failed to create vanc: %d", result);
-            goto end;
+            goto error;
         }
 
         line = var_InheritInteger(vd, VIDEO_CFG_PREFIX "afd-line");
         result = vanc->GetBufferForVerticalBlankingLine(line, &buf);
         if (result != S_OK) {
             msg_Err(vd, "Failed to get VBI line %d: %d", line, result);
-            goto end;
+            vanc->Release();
+            goto error;
         }
         send_AFD(sys->video.afd, sys->video.ar, (uint8_t*)buf);
 
@@ -971,7 +1006,7 @@ static void PrepareVideo(vout_display_t *vd, picture_t *picture, subpicture_t *,
         vanc->Release();
         if (result != S_OK) {
             msg_Err(vd, "Failed to set vanc: %d", result);
-            goto end;
+            goto error;
         }
     }
     else for(int y = 0; y < h; ++y) {
@@ -980,7 +1015,61 @@ static void PrepareVideo(vout_display_t *vd, picture_t *picture, subpicture_t *,
             picture->p[0].i_pitch * y;
         memcpy(dst, src, w * 2 /* bpp */);
     }
+    return pDLVideoFrame;
+
+error:
+    pDLVideoFrame->Release();
+    return NULL;
+}
+
+static void PrepareVideo(vout_display_t *vd, picture_t *picture, subpicture_t *,
+                         vlc_tick_t date)
+{
+    decklink_sys_t *sys = (decklink_sys_t *) vd->sys;
+    vlc_tick_t now = vlc_tick_now();
+
+    if (!picture)
+        return;
+
+    if (now - date > vlc_tick_from_sec( sys->video.nosignal_delay )) {
+        msg_Dbg(vd, "no signal");
+        if (sys->video.pic_nosignal) {
+            picture = sys->video.pic_nosignal;
+        } else {
+            if (sys->video.tenbits) { // I422_10L
+                plane_t *y = &picture->p[0];
+                memset(y->p_pixels, 0x0, y->i_lines * y->i_pitch);
+                for (int i = 1; i < picture->i_planes; i++) {
+                    plane_t *p = &picture->p[i];
+                    size_t len = p->i_lines * p->i_pitch / 2;
+                    int16_t *data = (int16_t*)p->p_pixels;
+                    for (size_t j = 0; j < len; j++) // XXX: SIMD
+                        data[j] = 0x200;
+                }
+            } else { // UYVY
+                size_t len = picture->p[0].i_lines * picture->p[0].i_pitch;
+                for (size_t i = 0; i < len; i+= 2) { // XXX: SIMD
+                    picture->p[0].p_pixels[i+0] = 0x80;
+                    picture->p[0].p_pixels[i+1] = 0;
+                }
+            }
+        }
+        date = now;
+    }
 
+    HRESULT result;
+    int w, h, length;
+    w = vd->fmt.i_width;
+    h = vd->fmt.i_height;
+
+    IDeckLinkVideoFrame *pDLVideoFrame;
+    if (!sys->video.tenbits && picture->p[0].i_pitch == w * 2)
+        /* Same layout as the card: schedule the picture itself */
+        pDLVideoFrame = new (std::nothrow) PictureVideoFrame(picture, w, h);
+    else
+        pDLVideoFrame = CopyVideoFrame(vd, picture, w, h);
+    if (!pDLVideoFrame)
+        goto end;
 
     // compute frame duration in CLOCK_FREQ units
     length = (sys->frameduration * CLOCK_FREQ) / sys->timescale;
@@ -31,7 +31,9 @@
 # include "config.h"
 #endif
 
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/mman.h>
 
 #include <xf86drm.h>
@@ -67,6 +69,23 @@
 
 typedef enum { drvSuccess, drvTryNext, drvFail } deviceRval;
 
+/*
+ * plane properties needed for atomic commits, in the same order as
+ * the values passed by AtomicCommit()
+ */
+enum {
+    PLANE_FB_ID, PLANE_CRTC_ID,
+    PLANE_SRC_X, PLANE_SRC_Y, PLANE_SRC_W, PLANE_SRC_H,
+    PLANE_CRTC_X, PLANE_CRTC_Y, PLANE_CRTC_W, PLANE_CRTC_H,
+    PLANE_PROP_MAX
+};
+
+static const char *const plane_prop_names[PLANE_PROP_MAX] = {
+    "FB_ID", "CRTC_ID",
+    "SRC_X", "SRC_Y", "SRC_W", "SRC_H",
+    "CRTC_X", "CRTC_Y", "CRTC_W", "CRTC_H",
+};
+
 struct vout_display_sys_t {
 /*
  * buffer information
@@ -95,6 +114,16 @@ struct vout_display_sys_t {
  */
     uint32_t        crtc;
     uint32_t        plane_id;
+    vlc_tick_t      period;
+
+/*
+ * atomic modesetting and page flip state
+ */
+    bool            atomic;
+    uint32_t        plane_props[PLANE_PROP_MAX];
+    bool            flip_pending;
+    vlc_tick_t      date;
+    vlc_tick_t      flip_date;
 
 /*
  * other generic stuff
@@ -280,6 +309,10 @@ static deviceRval SetupDevice(vout_display_t *vd, drmModeRes const *res,
 
     sys->width = conn->modes[0].hdisplay;
     sys->height = conn->modes[0].vdisplay;
+    if (conn->modes[0].clock > 0)
+        sys->period = VLC_TICK_FROM_US((uint64_t)conn->modes[0].htotal
+                                       * conn->modes[0].vtotal * 1000
+                                       / conn->modes[0].clock);
     msg_Dbg(vd, "Mode resolution for connector %u is %ux%u",
             conn->connector_id, sys->width, sys->height);
 
@@ -496,6 +529,55 @@ static bool ChromaNegotiation(vout_display_t *vd)
 }
 
 
+/**
+ * Looks up the plane properties for atomic commits. If the driver does not
+ * support atomic modesetting, the legacy SetPlane interface is used.
+ */
+static bool AtomicSetup(vout_display_t *vd)
+{
+    vout_display_sys_t *sys = vd->sys;
+    drmModeObjectProperties *props;
+    unsigned i, j;
+
+    if (drmSetClientCap(sys->drm_fd, DRM_CLIENT_CAP_ATOMIC, 1)) {
+        msg_Dbg(vd, "Atomic modesetting not supported");
+        return false;
+    }
+
+    props = drmModeObjectGetProperties(sys->drm_fd, sys->plane_id,
+                                       DRM_MODE_OBJECT_PLANE);
+    if (props == NULL)
+        goto error;
+
+    memset(sys->plane_props, 0, sizeof(sys->plane_props));
+    for (i = 0; i < props->count_props; i++) {
+        drmModePropertyPtr pp = drmModeGetProperty(sys->drm_fd,
+                                                   props->props[i]);
+        if (pp == NULL)
+            continue;
+
+        for (j = 0; j < PLANE_PROP_MAX; j++)
+            if (strcmp(pp->name, plane_prop_names[j]) == 0)
+                sys->plane_props[j] = pp->prop_id;
+        drmModeFreeProperty(pp);
+    }
+    drmModeFreeObjectProperties(props);
+
+    for (j = 0; j < PLANE_PROP_MAX; j++)
+        if (sys->plane_props[j] == 0) {
+            msg_Dbg(vd, "Plane %u lacks property %s", sys->plane_id,
+                    plane_prop_names[j]);
+            goto error;
+        }
+
+    msg_Dbg(vd, "Using atomic modesetting on plane %u", sys->plane_id);
+    return true;
+error:
+    drmSetClientCap(sys->drm_fd, DRM_CLIENT_CAP_ATOMIC, 0);
+    return false;
+}
+
+
 static int OpenDisplay(vout_display_t *vd)
 {
     vout_display_sys_t *sys = vd->sys;
@@ -573,6 +655,7 @@ static int OpenDisplay(vout_display_t *vd)
     if (!found_connector)
         goto err_out;
 
+    sys->atomic = AtomicSetup(vd);
     return VLC_SUCCESS;
 err_out:
     drmDropMaster(sys->drm_fd);
@@ -656,20 +739,119 @@ static picture_pool_t *Pool(vout_display_t *vd, unsigned count)
 }
 
 
+static void PageFlipHandler(int fd, unsigned int frame, unsigned int sec,
+                            unsigned int usec, void *data)
+{
+    vout_display_t *vd = data;
+    vout_display_sys_t *sys = vd->sys;
+
+    /* DRM event timestamps are from the monotonic clock, like VLC ticks. */
+    vlc_tick_t presented = vlc_tick_from_sec(sec) + VLC_TICK_FROM_US(usec);
+
+    sys->flip_pending = false;
+    if (sys->flip_date != VLC_TICK_INVALID)
+        vout_display_SendEventPresented(vd, sys->flip_date, presented,
+                                        sys->period);
+    (void) fd; (void) frame;
+}
+
+
+/**
+ * Waits for the previous page flip, so that the buffer about to be queued
+ * is not scanned out anymore and the kernel accepts a new commit.
+ */
+static void WaitPageFlip(vout_display_t *vd)
+{
+    vout_display_sys_t *sys = vd->sys;
+    drmEventContext evctx = {
+        .version = 2,
+        .page_flip_handler = PageFlipHandler,
+    };
+    struct pollfd ufd = { .fd = sys->drm_fd, .events = POLLIN };
+
+    while (sys->flip_pending) {
+        /* a few refresh cycles at worst */
+        if (poll(&ufd, 1, 100) <= 0) {
+            msg_Warn(vd, "Page flip timed out");
+            sys->flip_pending = false;
+            break;
+        }
+        drmHandleEvent(sys->drm_fd, &evctx);
+    }
+}
+
+
+static int AtomicCommit(vout_display_t *vd, uint32_t fb)
+{
+    vout_display_sys_t *sys = vd->sys;
+    const uint64_t values[PLANE_PROP_MAX] = {
+        fb, sys->crtc,
+        0, 0, (uint64_t)sys->width << 16, (uint64_t)sys->height << 16,
+        0, 0, sys->width, sys->height,
+    };
+    drmModeAtomicReqPtr req = drmModeAtomicAlloc();
+    int ret;
+
+    if (req == NULL)
+        return -ENOMEM;
+
+    for (unsigned i = 0; i < PLANE_PROP_MAX; i++)
+        if (drmModeAtomicAddProperty(req, sys->plane_id,
+                                     sys->plane_props[i], values[i]) < 0) {
+            drmModeAtomicFree(req);
+            return -ENOMEM;
+        }
+
+    ret = drmModeAtomicCommit(sys->drm_fd, req,
+                              DRM_MODE_ATOMIC_NONBLOCK |
+                              DRM_MODE_PAGE_FLIP_EVENT, vd);
+    drmModeAtomicFree(req);
+    return ret;
+}
+
+
+static void Prepare(vout_display_t *vd, picture_t *picture,
+                    subpicture_t *subpicture, vlc_tick_t date)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    sys->date = date;
+    (void) picture; (void) subpicture;
+}
+
+
 static void Display(vout_display_t *vd, picture_t *picture)
 {
     VLC_UNUSED(picture);
     vout_display_sys_t *sys = vd->sys;
-    int i;
+    uint32_t fb = sys->fb[sys->front_buf];
+    int i, ret = -1;
 
-    if (drmModeSetPlane(sys->drm_fd, sys->plane_id, sys->crtc,
-                         sys->fb[sys->front_buf], 0,
-                         0, 0, sys->width, sys->height,
-                         0, 0, sys->width << 16, sys->height << 16)) {
-        msg_Err(vd, "Cannot do set plane for plane id %u, fb %x",
-                sys->plane_id,
-                sys->fb[sys->front_buf]);
-    } else {
+    if (sys->atomic) {
+        WaitPageFlip(vd);
+
+        ret = AtomicCommit(vd, fb);
+        if (ret == 0) {
+            sys->flip_pending = true;
+            sys->flip_date = sys->date;
+        } else {
+            msg_Warn(vd, "Atomic commit failed, using legacy plane setup");
+            sys->atomic = false;
+            drmSetClientCap(sys->drm_fd, DRM_CLIENT_CAP_ATOMIC, 0);
+        }
+    }
+
+    if (!sys->atomic) {
+        ret = drmModeSetPlane(sys->drm_fd, sys->plane_id, sys->crtc,
+                              fb, 0,
+                              0, 0, sys->width, sys->height,
+                              0, 0, sys->width << 16, sys->height << 16);
+        if (ret)
+            msg_Err(vd, "Cannot do set plane for plane id %u, fb %x",
+                    sys->plane_id, fb);
+    }
+
+    if (ret == 0) {
         sys->front_buf++;
         sys->front_buf %= MAXHWBUF;
 
@@ -687,6 +869,9 @@ static void Close(vout_display_t *vd)
 {
     vout_display_sys_t *sys = vd->sys;
 
+    if (sys->atomic)
+        WaitPageFlip(vd);
+
     if (sys->pool)
         picture_pool_Release(sys->pool);
 
@@ -765,7 +950,7 @@ static int Open(vout_display_t *vd, const vout_display_cfg_t *cfg,
     *fmtp = fmt;
 
     vd->pool    = Pool;
-    vd->prepare = NULL;
+    vd->prepare = Prepare;
     vd->display = Display;
     vd->control = Control;
 
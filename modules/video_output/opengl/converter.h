@@ -271,6 +271,11 @@ struct opengl_tex_converter_t
     /* True to dump shaders, set by the caller */
     bool b_dump_shaders;
 
+    /* True to deinterlace the pictures from the fragment shader, set by the
+     * caller. Converters that do not use opengl_fragment_shader_init() must
+     * reset it from their open function. */
+    bool deinterlace;
+
     /* Function pointer to the shader init command, set by the caller, see
      * opengl_fragment_shader_init() documentation. */
     GLuint (*pf_fragment_shader_init)(opengl_tex_converter_t *, GLenum,
@@ -321,11 +326,14 @@ struct opengl_tex_converter_t
         GLint Texture[PICTURE_PLANE_MAX];
         GLint TexSize[PICTURE_PLANE_MAX]; /* for GL_TEXTURE_RECTANGLE */
         GLint Coefficients;
+        GLint FieldParity; /* if deinterlace */
         GLint FillColor;
         GLint *pl_vars; /* for pl_sh_res */
     } uloc;
     bool yuv_color;
     GLfloat yuv_coefficients[16];
+    /* Parity of the rows to interpolate, -1 for progressive pictures */
+    GLfloat field_parity;
 
     struct pl_shader *pl_sh;
     const struct pl_shader_res *pl_sh_res;
@@ -217,6 +217,7 @@ Open(vlc_object_t *obj)
     tc->texs[0] = (struct opengl_tex_cfg) { { 1, 1 }, { 1, 1 }, 0, 0, 0 };
 
     tc->tex_target   = GL_TEXTURE_EXTERNAL_OES;
+    tc->deinterlace  = false;
 
     /* The transform Matrix (uSTMatrix) given by the SurfaceTexture is not
      * using the same origin than us. Ask the caller to rotate textures
@@ -56,6 +56,9 @@
 #ifndef GL_MAP_PERSISTENT_BIT
 # define GL_MAP_PERSISTENT_BIT 0x0040
 #endif
+#ifndef GL_MAP_COHERENT_BIT
+# define GL_MAP_COHERENT_BIT 0x0080
+#endif
 
 #ifndef GL_CLIENT_STORAGE_BIT
 # define GL_CLIENT_STORAGE_BIT 0x0200
@@ -71,7 +74,8 @@
 # define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
 #endif
 
-#define PBO_DISPLAY_COUNT 2 /* Double buffering */
+#define PBO_DISPLAY_COUNT 3 /* Ring of upload buffers */
+#define UPLOAD_STATS_PERIOD 500 /* pictures */
 typedef struct
 {
     vlc_gl_t    *gl;
@@ -90,13 +94,50 @@ struct priv
     struct {
         picture_t *display_pics[PBO_DISPLAY_COUNT];
         size_t display_idx;
+        bool has_sync;
+        unsigned orphaned;
     } pbo;
     struct {
         picture_t *pics[VLCGL_PICTURE_MAX];
         unsigned long long list;
     } persistent;
+    struct {
+        unsigned count;
+        vlc_tick_t total;
+        vlc_tick_t max;
+    } stats;
 };
 
+static void
+upload_stats_report(const opengl_tex_converter_t *tc)
+{
+    struct priv *priv = tc->priv;
+
+    if (priv->stats.count == 0)
+        return;
+
+    msg_Dbg(tc->gl, "uploaded %u pictures in %"PRId64" us on average "
+            "(max %"PRId64" us), %u reallocated PBO", priv->stats.count,
+            US_FROM_VLC_TICK(priv->stats.total / priv->stats.count),
+            US_FROM_VLC_TICK(priv->stats.max), priv->pbo.orphaned);
+    priv->stats.count = 0;
+    priv->stats.total = priv->stats.max = 0;
+    priv->pbo.orphaned = 0;
+}
+
+static void
+upload_stats_add(const opengl_tex_converter_t *tc, vlc_tick_t start)
+{
+    struct priv *priv = tc->priv;
+    vlc_tick_t duration = vlc_tick_now() - start;
+
+    priv->stats.total += duration;
+    if (duration > priv->stats.max)
+        priv->stats.max = duration;
+    if (++priv->stats.count >= UPLOAD_STATS_PERIOD)
+        upload_stats_report(tc);
+}
+
 static void
 pbo_picture_destroy(picture_t *pic)
 {
@@ -222,17 +263,34 @@ tc_pbo_update(const opengl_tex_converter_t *tc, GLuint *textures,
 {
     (void) plane_offset; assert(plane_offset == NULL);
     struct priv *priv = tc->priv;
+    vlc_tick_t start = vlc_tick_now();
 
     picture_t *display_pic = priv->pbo.display_pics[priv->pbo.display_idx];
     picture_sys_t *p_sys = display_pic->p_sys;
     priv->pbo.display_idx = (priv->pbo.display_idx + 1) % PBO_DISPLAY_COUNT;
 
+    /* If the GPU is still reading from the oldest buffer of the ring, orphan
+     * its storage rather than waiting for the previous upload to complete. */
+    bool orphan = false;
+    if (p_sys->fence != NULL)
+    {
+        GLenum wait = tc->vt->ClientWaitSync(p_sys->fence, 0, 0);
+        orphan = wait != GL_ALREADY_SIGNALED && wait != GL_CONDITION_SATISFIED;
+        tc->vt->DeleteSync(p_sys->fence);
+        p_sys->fence = NULL;
+        if (orphan)
+            priv->pbo.orphaned++;
+    }
+
     for (int i = 0; i < pic->i_planes; i++)
     {
         GLsizeiptr size = pic->p[i].i_lines * pic->p[i].i_pitch;
         const GLvoid *data = pic->p[i].p_pixels;
         tc->vt->BindBuffer(GL_PIXEL_UNPACK_BUFFER,
                            p_sys->buffers[i]);
+        if (orphan)
+            tc->vt->BufferData(GL_PIXEL_UNPACK_BUFFER, p_sys->bytes[i], NULL,
+                               GL_DYNAMIC_DRAW);
         tc->vt->BufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, size, data);
 
         tc->vt->ActiveTexture(GL_TEXTURE0 + i);
@@ -245,9 +303,13 @@ tc_pbo_update(const opengl_tex_converter_t *tc, GLuint *textures,
                               tc->texs[i].format, tc->texs[i].type, NULL);
     }
 
+    if (priv->pbo.has_sync)
+        p_sys->fence = tc->vt->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
     /* turn off pbo */
     tc->vt->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
+    upload_stats_add(tc, start);
     return VLC_SUCCESS;
 }
 
@@ -256,8 +318,10 @@ persistent_map(const opengl_tex_converter_t *tc, picture_t *pic)
 {
     picture_sys_t *picsys = pic->p_sys;
 
+    /* The mapping is coherent: the decoder writes are visible to the GPU
+     * without flushing, and the fence of each picture guards its reuse. */
     const GLbitfield access = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT |
-                              GL_MAP_PERSISTENT_BIT;
+                              GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
     for (int i = 0; i < pic->i_planes; ++i)
     {
         tc->vt->BindBuffer(GL_PIXEL_UNPACK_BUFFER, picsys->buffers[i]);
@@ -266,7 +330,7 @@ persistent_map(const opengl_tex_converter_t *tc, picture_t *pic)
 
         pic->p[i].p_pixels =
             tc->vt->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, picsys->bytes[i],
-                                   access | GL_MAP_FLUSH_EXPLICIT_BIT);
+                                   access);
 
         if (pic->p[i].p_pixels == NULL)
         {
@@ -330,13 +394,11 @@ tc_persistent_update(const opengl_tex_converter_t *tc, GLuint *textures,
     (void) plane_offset; assert(plane_offset == NULL);
     struct priv *priv = tc->priv;
     picture_sys_t *picsys = pic->p_sys;
+    vlc_tick_t start = vlc_tick_now();
 
     for (int i = 0; i < pic->i_planes; i++)
     {
         tc->vt->BindBuffer(GL_PIXEL_UNPACK_BUFFER, picsys->buffers[i]);
-        if (picsys->fence == NULL)
-            tc->vt->FlushMappedBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
-                                            picsys->bytes[i]);
         tc->vt->ActiveTexture(GL_TEXTURE0 + i);
         tc->vt->BindTexture(tc->tex_target, textures[i]);
 
@@ -380,6 +442,7 @@ tc_persistent_update(const opengl_tex_converter_t *tc, GLuint *textures,
     /* turn off pbo */
     tc->vt->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
+    upload_stats_add(tc, start);
     return VLC_SUCCESS;
 }
 
@@ -620,7 +683,7 @@ opengl_tex_converter_generic_init(opengl_tex_converter_t *tc, bool allow_dr)
         GLint min_align = 0;
         tc->vt->GetIntegerv(GL_MIN_MAP_BUFFER_ALIGNMENT, &min_align);
         supports_map_persistent = min_align >= 64 && has_bs && tc->gl->module
-            && tc->vt->BufferStorage && tc->vt->MapBufferRange && tc->vt->FlushMappedBufferRange
+            && tc->vt->BufferStorage && tc->vt->MapBufferRange
             && tc->vt->UnmapBuffer && tc->vt->FenceSync && tc->vt->DeleteSync
             && tc->vt->ClientWaitSync;
         if (supports_map_persistent)
@@ -636,6 +699,8 @@ opengl_tex_converter_generic_init(opengl_tex_converter_t *tc, bool allow_dr)
             if (supports_pbo && pbo_pics_alloc(tc) == VLC_SUCCESS)
             {
                 tc->pf_update  = tc_pbo_update;
+                priv->pbo.has_sync = tc->vt->FenceSync && tc->vt->DeleteSync
+                    && tc->vt->ClientWaitSync;
                 msg_Dbg(tc->gl, "PBO support enabled");
             }
         }
@@ -650,8 +715,14 @@ void
 opengl_tex_converter_generic_deinit(opengl_tex_converter_t *tc)
 {
     struct priv *priv = tc->priv;
+    upload_stats_report(tc);
     for (size_t i = 0; i < PBO_DISPLAY_COUNT && priv->pbo.display_pics[i]; ++i)
+    {
+        picture_sys_t *p_sys = priv->pbo.display_pics[i]->p_sys;
+        if (p_sys->fence != NULL)
+            tc->vt->DeleteSync(p_sys->fence);
         picture_Release(priv->pbo.display_pics[i]);
+    }
     persistent_release_gpupics(tc, true);
     free(priv->texture_temp_buf);
     free(tc->priv);
@@ -345,7 +345,7 @@ tc_base_fetch_locations(opengl_tex_converter_t *tc, GLuint program)
         tc->uloc.Texture[i] = tc->vt->GetUniformLocation(program, name);
         if (tc->uloc.Texture[i] == -1)
             return VLC_EGENERIC;
-        if (tc->tex_target == GL_TEXTURE_RECTANGLE)
+        if (tc->tex_target == GL_TEXTURE_RECTANGLE || tc->deinterlace)
         {
             snprintf(name, sizeof(name), "TexSize%1u", i);
             tc->uloc.TexSize[i] = tc->vt->GetUniformLocation(program, name);
@@ -358,6 +358,14 @@ tc_base_fetch_locations(opengl_tex_converter_t *tc, GLuint program)
     if (tc->uloc.FillColor == -1)
         return VLC_EGENERIC;
 
+    if (tc->deinterlace)
+    {
+        tc->uloc.FieldParity = tc->vt->GetUniformLocation(program,
+                                                           "FieldParity");
+        if (tc->uloc.FieldParity == -1)
+            return VLC_EGENERIC;
+    }
+
 #ifdef HAVE_LIBPLACEBO
     const struct pl_shader_res *res = tc->pl_sh_res;
     for (int i = 0; res && i < res->num_variables; i++) {
@@ -384,13 +392,16 @@ tc_base_prepare_shader(const opengl_tex_converter_t *tc,
 
     tc->vt->Uniform4f(tc->uloc.FillColor, 1.0f, 1.0f, 1.0f, alpha);
 
-    if (tc->tex_target == GL_TEXTURE_RECTANGLE)
+    if (tc->tex_target == GL_TEXTURE_RECTANGLE || tc->deinterlace)
     {
         for (unsigned i = 0; i < tc->tex_count; ++i)
             tc->vt->Uniform2f(tc->uloc.TexSize[i], tex_width[i],
                                tex_height[i]);
     }
 
+    if (tc->deinterlace)
+        tc->vt->Uniform1f(tc->uloc.FieldParity, tc->field_parity);
+
 #ifdef HAVE_LIBPLACEBO
     const struct pl_shader_res *res = tc->pl_sh_res;
     for (int i = 0; res && i < res->num_variables; i++) {
@@ -452,6 +463,7 @@ xyz12_shader_init(opengl_tex_converter_t *tc)
 
     tc->pf_fetch_locations = tc_xyz12_fetch_locations;
     tc->pf_prepare_shader = tc_xyz12_prepare_shader;
+    tc->deinterlace = false;
 
     /* Shader for XYZ to RGB correction
      * 3 steps :
@@ -625,12 +637,63 @@ opengl_fragment_shader_init_impl(opengl_tex_converter_t *tc, GLenum tex_target,
     }
 #endif
 
-    if (tex_target == GL_TEXTURE_RECTANGLE)
+    if (tex_target == GL_TEXTURE_RECTANGLE || tc->deinterlace)
     {
         for (unsigned i = 0; i < tc->tex_count; ++i)
             ADDF("uniform vec2 TexSize%u;\n", i);
     }
 
+    if (tc->deinterlace)
+    {
+        /* Single rate, edge directed interpolation of the rows of the second
+         * field, as done by the spatial prediction of yadif: the rows above
+         * and below are compared along 3 directions, over 3 pixels. The
+         * coordinates are in texels. */
+        ADD("uniform float FieldParity;\n");
+        for (unsigned i = 0; i < tc->tex_count; ++i)
+        {
+            if (tex_target == GL_TEXTURE_RECTANGLE)
+                ADDF("vec4 Fetch%u(float x, float y) {\n"
+                     " return %s(Texture%u, vec2(x, y));\n"
+                     "}\n", i, lookup, i);
+            else
+                ADDF("vec4 Fetch%u(float x, float y) {\n"
+                     " return %s(Texture%u, vec2(x, y) / TexSize%u);\n"
+                     "}\n", i, lookup, i, i);
+
+            ADDF("vec4 Deinterlace%u(vec2 pos) {\n"
+                 " float row = floor(pos.y);\n"
+                 " if (FieldParity < 0.0 || mod(row, 2.0) != FieldParity)\n"
+                 "  return Fetch%u(pos.x, row + 0.5);\n"
+                 " float up = row > 0.0 ? row - 0.5 : row + 1.5;\n"
+                 " float down = row + 1.5 < TexSize%u.y ? row + 1.5 : up;\n"
+                 " vec4 u2 = Fetch%u(pos.x - 2.0, up);\n"
+                 " vec4 u1 = Fetch%u(pos.x - 1.0, up);\n"
+                 " vec4 u0 = Fetch%u(pos.x, up);\n"
+                 " vec4 u3 = Fetch%u(pos.x + 1.0, up);\n"
+                 " vec4 u4 = Fetch%u(pos.x + 2.0, up);\n"
+                 " vec4 d2 = Fetch%u(pos.x - 2.0, down);\n"
+                 " vec4 d1 = Fetch%u(pos.x - 1.0, down);\n"
+                 " vec4 d0 = Fetch%u(pos.x, down);\n"
+                 " vec4 d3 = Fetch%u(pos.x + 1.0, down);\n"
+                 " vec4 d4 = Fetch%u(pos.x + 2.0, down);\n"
+                 " vec4 ones = vec4(1.0);\n"
+                 " vec4 result = 0.5 * (u0 + d0);\n"
+                 " float score = dot(abs(u1 - d1) + abs(u0 - d0)"
+                 " + abs(u3 - d3), ones);\n"
+                 " float left = dot(abs(u2 - d0) + abs(u1 - d3)"
+                 " + abs(u0 - d4), ones);\n"
+                 " float right = dot(abs(u0 - d2) + abs(u3 - d1)"
+                 " + abs(u4 - d0), ones);\n"
+                 " if (left < score && left <= right)\n"
+                 "  result = 0.5 * (u1 + d3);\n"
+                 " else if (right < score)\n"
+                 "  result = 0.5 * (u3 + d1);\n"
+                 " return result;\n"
+                 "}\n", i, i, i, i, i, i, i, i, i, i, i, i, i);
+        }
+    }
+
     if (is_yuv)
         ADD("uniform vec4 Coefficients[4];\n");
 
@@ -649,10 +712,21 @@ opengl_fragment_shader_init_impl(opengl_tex_converter_t *tc, GLenum tex_target,
     for (unsigned i = 0; i < tc->tex_count; ++i)
     {
         const char *swizzle = swizzle_per_tex[i];
+        char fetch[64];
+        if (!tc->deinterlace)
+            snprintf(fetch, sizeof(fetch), "%s(Texture%u, %s%u)",
+                     lookup, i, coord_name, i);
+        else if (tex_target == GL_TEXTURE_RECTANGLE)
+            snprintf(fetch, sizeof(fetch), "Deinterlace%u(TexCoordRect%u)",
+                     i, i);
+        else
+            snprintf(fetch, sizeof(fetch), "Deinterlace%u(TexCoord%u * TexSize%u)",
+                     i, i, i);
+
         if (swizzle)
         {
             size_t swizzle_count = strlen(swizzle);
-            ADDF(" colors = %s(Texture%u, %s%u);\n", lookup, i, coord_name, i);
+            ADDF(" colors = %s;\n", fetch);
             for (unsigned j = 0; j < swizzle_count; ++j)
             {
                 ADDF(" val = colors.%c;\n"
@@ -664,8 +738,7 @@ opengl_fragment_shader_init_impl(opengl_tex_converter_t *tc, GLenum tex_target,
         }
         else
         {
-            ADDF(" vec4 color%u = %s(Texture%u, %s%u);\n",
-                 color_idx, lookup, i, coord_name, i);
+            ADDF(" vec4 color%u = %s;\n", color_idx, fetch);
             color_idx++;
             assert(color_idx <= PICTURE_PLANE_MAX);
         }
@@ -90,6 +90,11 @@ typedef struct {
 
     float    tex_width;
     float    tex_height;
+
+    /* Picture and visible area uploaded to the texture */
+    picture_t *picture;
+    unsigned x_offset;
+    unsigned y_offset;
 } gl_region_t;
 
 struct prgm
@@ -532,6 +537,8 @@ opengl_init_program(vout_display_opengl_t *vgl, vlc_video_context *context,
     tc->gl = vgl->gl;
     tc->vt = &vgl->vt;
     tc->b_dump_shaders = b_dump_shaders;
+    tc->deinterlace = !subpics && var_InheritBool(vgl->gl, "gl-deinterlace");
+    tc->field_parity = -1.f;
     tc->pf_fragment_shader_init = opengl_fragment_shader_init_impl;
     tc->glexts = glexts;
 #if defined(USE_OPENGL_ES2)
@@ -942,6 +949,8 @@ void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
     {
         if (vgl->region[i].texture)
             vgl->vt.DeleteTextures(1, &vgl->region[i].texture);
+        if (vgl->region[i].picture)
+            picture_Release(vgl->region[i].picture);
     }
     free(vgl->region);
     GL_ASSERT_NOERROR();
@@ -949,6 +958,11 @@ void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
     free(vgl);
 }
 
+bool vout_display_opengl_CanDeinterlace(const vout_display_opengl_t *vgl)
+{
+    return vgl->prgm->tc->deinterlace;
+}
+
 static void UpdateZ(vout_display_opengl_t *vgl)
 {
     /* Do trigonometry to calculate the minimal z value
@@ -1076,6 +1090,11 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
 
     opengl_tex_converter_t *tc = vgl->prgm->tc;
 
+    /* Keep the first field, the rows of the second one are interpolated */
+    if (tc->deinterlace)
+        tc->field_parity = picture->b_progressive ? -1.f
+                         : picture->b_top_field_first ? 1.f : 0.f;
+
     /* Update the texture */
     int ret = tc->pf_update(tc, vgl->texture, vgl->tex_width, vgl->tex_height,
                             picture, NULL);
@@ -1121,13 +1140,39 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
             glr->bottom = -2.0 * (r->i_y + r->fmt.i_visible_height) / subpicture->i_original_picture_height + 1.0;
 
             glr->texture = 0;
+            glr->picture = NULL;
+            glr->x_offset = r->fmt.i_x_offset;
+            glr->y_offset = r->fmt.i_y_offset;
+
+            /* The regions of the rendered subpictures reference the same
+             * pictures for as long as their content does not change: keep
+             * the texture where the picture was already uploaded. */
+            int j;
+            for (j = 0; j < last_count; j++) {
+                if (last[j].texture &&
+                    last[j].picture  == r->p_picture &&
+                    last[j].x_offset == glr->x_offset &&
+                    last[j].y_offset == glr->y_offset &&
+                    last[j].width    == glr->width &&
+                    last[j].height   == glr->height) {
+                    glr->texture = last[j].texture;
+                    glr->picture = last[j].picture;
+                    memset(&last[j], 0, sizeof(last[j]));
+                    break;
+                }
+            }
+            if (glr->texture)
+                continue;
+
             /* Try to recycle the textures allocated by the previous
                call to this function. */
-            for (int j = 0; j < last_count; j++) {
+            for (j = 0; j < last_count; j++) {
                 if (last[j].texture &&
                     last[j].width  == glr->width &&
                     last[j].height == glr->height) {
                     glr->texture = last[j].texture;
+                    if (last[j].picture)
+                        picture_Release(last[j].picture);
                     memset(&last[j], 0, sizeof(last[j]));
                     break;
                 }
@@ -1148,11 +1193,15 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
                                                * r->p_picture->p[0].i_pixel_pitch;
             ret = tc->pf_update(tc, &glr->texture, &glr->width, &glr->height,
                                 r->p_picture, &pixels_offset);
+            if (ret == VLC_SUCCESS)
+                glr->picture = picture_Hold(r->p_picture);
         }
     }
     for (int i = 0; i < last_count; i++) {
         if (last[i].texture)
             DelTextures(tc, &last[i].texture);
+        if (last[i].picture)
+            picture_Release(last[i].picture);
     }
     free(last);
 
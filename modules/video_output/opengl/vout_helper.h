@@ -65,8 +65,14 @@
 #define GLCONV_LONGTEXT N_( \
     "Force a \"glconv\" module.")
 
+#define GLDEINT_TEXT N_("Deinterlace in the shader")
+#define GLDEINT_LONGTEXT N_( \
+    "Interpolate the missing field lines of interlaced pictures on the GPU, " \
+    "instead of running the deinterlace video filter.")
+
 #define add_glopts() \
     add_module("glconv", "glconv", NULL, GLCONV_TEXT, GLCONV_LONGTEXT) \
+    add_bool("gl-deinterlace", false, GLDEINT_TEXT, GLDEINT_LONGTEXT, true) \
     add_glopts_placebo ()
 
 typedef struct vout_display_opengl_t vout_display_opengl_t;
@@ -78,6 +84,9 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
                                                vlc_video_context *context);
 void vout_display_opengl_Delete(vout_display_opengl_t *vgl);
 
+/* Whether interlaced pictures are deinterlaced by the fragment shader */
+bool vout_display_opengl_CanDeinterlace(const vout_display_opengl_t *vgl);
+
 picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned);
 
 int vout_display_opengl_SetViewpoint(vout_display_opengl_t *vgl, const vlc_viewpoint_t*);
@@ -94,6 +94,8 @@ struct vout_display_sys_t {
     void (*unlock)(void *sys, void *id, void *const *plane);
     void (*display)(void *sys, void *id);
     void (*cleanup)(void *sys);
+    /* zero-copy mode: the callback holds the picture if it needs it */
+    void (*frame)(void *sys, picture_t *pic);
 
     unsigned pitches[PICTURE_PLANE_MAX];
     unsigned lines[PICTURE_PLANE_MAX];
@@ -106,6 +108,54 @@ static void           Prepare(vout_display_t *, picture_t *, subpicture_t *, vlc
 static void           Display(vout_display_t *, picture_t *);
 static int            Control(vout_display_t *, int, va_list);
 
+static void DisplayFrame(vout_display_t *vd, picture_t *pic)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    sys->frame(sys->opaque, pic);
+}
+
+/* Hands the pictures out as they are, in the decoder chroma if it has pixels
+ * in memory, so that they are not copied. */
+static int OpenFrame(vout_display_t *vd, video_format_t *fmtp,
+                     vout_display_sys_t *sys)
+{
+    sys->opaque = var_InheritAddress(vd, "vmem-data");
+    sys->cleanup = NULL;
+
+    video_format_t fmt;
+    video_format_ApplyRotation(&fmt, fmtp);
+
+    const vlc_chroma_description_t *desc =
+        vlc_fourcc_GetChromaDescription(fmt.i_chroma);
+    if (desc == NULL || desc->plane_count == 0)
+    {   /* Opaque (hardware) surfaces: ask for a conversion to memory */
+        const vlc_fourcc_t *list = vlc_fourcc_GetFallback(fmt.i_chroma);
+        vlc_fourcc_t chroma = VLC_CODEC_I420;
+
+        for (; list != NULL && *list != 0; list++)
+        {
+            desc = vlc_fourcc_GetChromaDescription(*list);
+            if (desc != NULL && desc->plane_count > 0)
+            {
+                chroma = *list;
+                break;
+            }
+        }
+        msg_Dbg(vd, "converting %4.4s to %4.4s", (const char *)&fmt.i_chroma,
+                (const char *)&chroma);
+        fmt.i_chroma = chroma;
+    }
+
+    *fmtp = fmt;
+
+    vd->sys     = sys;
+    vd->prepare = NULL;
+    vd->display = DisplayFrame;
+    vd->control = Control;
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * Open: allocates video thread
  *****************************************************************************
@@ -122,6 +172,9 @@ static int Open(vout_display_t *vd, const vout_display_cfg_t *cfg,
     vlc_format_cb setup = var_InheritAddress(vd, "vmem-setup");
 
     sys->lock = var_InheritAddress(vd, "vmem-lock");
+    sys->frame = var_InheritAddress(vd, "vmem-frame");
+    if (sys->lock == NULL && sys->frame != NULL)
+        return OpenFrame(vd, fmtp, sys);
     if (sys->lock == NULL) {
         msg_Err(vd, "missing lock callback");
         free(sys);
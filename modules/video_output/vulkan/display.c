@@ -52,6 +52,7 @@ struct vout_display_sys_t
     // Pool of textures for the subpictures
     struct pl_overlay *overlays;
     const struct pl_tex **overlay_tex;
+    picture_t **overlay_pics; // last picture uploaded to each texture
     int num_overlays;
 
     // Dynamic during rendering
@@ -175,12 +176,16 @@ static void Close(vout_display_t *vd)
 
     for (int i = 0; i < 4; i++)
         pl_tex_destroy(gpu, &sys->plane_tex[i]);
-    for (int i = 0; i < sys->num_overlays; i++)
+    for (int i = 0; i < sys->num_overlays; i++) {
         pl_tex_destroy(gpu, &sys->overlay_tex[i]);
+        if (sys->overlay_pics[i])
+            picture_Release(sys->overlay_pics[i]);
+    }
 
     if (sys->overlays) {
         free(sys->overlays);
         free(sys->overlay_tex);
+        free(sys->overlay_pics);
     }
 
     pl_renderer_destroy(&sys->renderer);
@@ -435,27 +440,28 @@ static void PictureRender(vout_display_t *vd, picture_t *pic,
         if (num_regions > sys->num_overlays) {
             sys->overlays = realloc(sys->overlays, num_regions * sizeof(struct pl_overlay));
             sys->overlay_tex = realloc(sys->overlay_tex, num_regions * sizeof(struct pl_tex *));
-            if (!sys->overlays || !sys->overlay_tex) {
+            sys->overlay_pics = realloc(sys->overlay_pics, num_regions * sizeof(picture_t *));
+            if (!sys->overlays || !sys->overlay_tex || !sys->overlay_pics) {
                 // Unlikely OOM, just do whatever
                 sys->num_overlays = 0;
                 failed = true;
                 goto done;
             }
             // Clear the newly added texture pointers for pl_upload_plane
-            for (int i = sys->num_overlays; i < num_regions; i++)
+            for (int i = sys->num_overlays; i < num_regions; i++) {
                 sys->overlay_tex[i] = NULL;
+                sys->overlay_pics[i] = NULL;
+            }
             sys->num_overlays = num_regions;
         }
 
         // Upload all of the regions
         subpicture_region_t *r = subpicture->p_region;
-        for (int i = 0; i < num_regions; i++) {
+        for (int i = 0; i < num_regions; i++, r = r->p_next) {
             assert(r->p_picture->i_planes == 1);
-            struct pl_plane_data subdata;
-            if (!vlc_placebo_PlaneData(r->p_picture, &subdata, NULL))
-                assert(!"Failed processing the subpicture_t into pl_plane_data!?");
-
             struct pl_overlay *overlay = &sys->overlays[i];
+            struct pl_plane plane = overlay->plane;
+
             *overlay = (struct pl_overlay) {
                 .rect = {
                     .x0 = target.dst_rect.x0 + r->i_x,
@@ -468,11 +474,28 @@ static void PictureRender(vout_display_t *vd, picture_t *pic,
                 .repr  = vlc_placebo_ColorRepr(&r->fmt),
             };
 
+            // Region pictures are not modified once rendered: the texture
+            // still holds the same picture if it was uploaded last time.
+            if (sys->overlay_pics[i] == r->p_picture) {
+                overlay->plane = plane;
+                continue;
+            }
+
+            if (sys->overlay_pics[i]) {
+                picture_Release(sys->overlay_pics[i]);
+                sys->overlay_pics[i] = NULL;
+            }
+
+            struct pl_plane_data subdata;
+            if (!vlc_placebo_PlaneData(r->p_picture, &subdata, NULL))
+                assert(!"Failed processing the subpicture_t into pl_plane_data!?");
+
             if (!pl_upload_plane(gpu, &overlay->plane, &sys->overlay_tex[i], &subdata)) {
                 msg_Err(vd, "Failed uploading subpicture region!");
                 num_regions = i; // stop here
                 break;
             }
+            sys->overlay_pics[i] = picture_Hold(r->p_picture);
         }
 
         // Update the target information to reference the subpictures
@@ -31,15 +31,18 @@
 
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <wayland-client.h>
 #include "viewporter-client-protocol.h"
+#include "presentation-time-client-protocol.h"
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_vout_display.h>
 #include <vlc_fs.h>
+#include <vlc_list.h>
 
 #define MAX_PICTURES 4
 
@@ -50,8 +53,12 @@ struct vout_display_sys_t
     struct wl_shm *shm;
     struct wp_viewporter *viewporter;
     struct wp_viewport *viewport;
+    struct wp_presentation *presentation;
+    clockid_t presentation_clock;
+    struct vlc_list feedbacks;
 
     size_t active_buffers;
+    vlc_tick_t date;
 
     unsigned display_width;
     unsigned display_height;
@@ -82,15 +89,123 @@ static const struct wl_buffer_listener buffer_cbs =
     buffer_release_cb,
 };
 
+struct feedback_data
+{
+    vout_display_t *vd;
+    struct wp_presentation_feedback *feedback;
+    vlc_tick_t date;
+    struct vlc_list node;
+};
+
+static void feedback_destroy(struct feedback_data *d)
+{
+    wp_presentation_feedback_destroy(d->feedback);
+    vlc_list_remove(&d->node);
+    free(d);
+}
+
+static void feedback_sync_output_cb(void *data,
+                                    struct wp_presentation_feedback *feedback,
+                                    struct wl_output *output)
+{
+    (void) data; (void) feedback; (void) output;
+}
+
+static void feedback_presented_cb(void *data,
+                                  struct wp_presentation_feedback *feedback,
+                                  uint32_t tv_sec_hi, uint32_t tv_sec_lo,
+                                  uint32_t tv_nsec, uint32_t refresh,
+                                  uint32_t seq_hi, uint32_t seq_lo,
+                                  uint32_t flags)
+{
+    struct feedback_data *d = data;
+    vout_display_t *vd = d->vd;
+    vout_display_sys_t *sys = vd->sys;
+    struct timespec ts = {
+        .tv_sec = ((uint64_t)tv_sec_hi << 32) | tv_sec_lo,
+        .tv_nsec = tv_nsec,
+    };
+    vlc_tick_t presented = vlc_tick_from_timespec(&ts);
+
+    if (sys->presentation_clock != CLOCK_MONOTONIC)
+    {   /* Translate to the VLC clock (monotonic) */
+        struct timespec now;
+
+        if (clock_gettime(sys->presentation_clock, &now) == 0)
+            presented += vlc_tick_now() - vlc_tick_from_timespec(&now);
+    }
+
+    /* Without vertical synchronization, e.g. with adaptive sync, there is
+     * no fixed refresh cycle to align to. */
+    vlc_tick_t period = 0;
+    if ((flags & WP_PRESENTATION_FEEDBACK_KIND_VSYNC) && refresh > 0)
+        period = VLC_TICK_FROM_NS(refresh);
+
+    vout_display_SendEventPresented(vd, d->date, presented, period);
+    feedback_destroy(d);
+    (void) feedback; (void) seq_hi; (void) seq_lo;
+}
+
+static void feedback_discarded_cb(void *data,
+                                  struct wp_presentation_feedback *feedback)
+{
+    feedback_destroy(data);
+    (void) feedback;
+}
+
+static const struct wp_presentation_feedback_listener feedback_cbs =
+{
+    feedback_sync_output_cb,
+    feedback_presented_cb,
+    feedback_discarded_cb,
+};
+
+static void presentation_clock_id_cb(void *data,
+                                     struct wp_presentation *presentation,
+                                     uint32_t clock)
+{
+    vout_display_t *vd = data;
+    vout_display_sys_t *sys = vd->sys;
+
+    sys->presentation_clock = clock;
+    (void) presentation;
+}
+
+static const struct wp_presentation_listener presentation_cbs =
+{
+    presentation_clock_id_cb,
+};
+
+static void RequestFeedback(vout_display_t *vd, struct wl_surface *surface)
+{
+    vout_display_sys_t *sys = vd->sys;
+    struct feedback_data *d = malloc(sizeof (*d));
+    if (unlikely(d == NULL))
+        return;
+
+    d->feedback = wp_presentation_feedback(sys->presentation, surface);
+    if (d->feedback == NULL)
+    {
+        free(d);
+        return;
+    }
+
+    d->vd = vd;
+    d->date = sys->date;
+    vlc_list_append(&d->node, &sys->feedbacks);
+    wp_presentation_feedback_add_listener(d->feedback, &feedback_cbs, d);
+}
+
 static void Prepare(vout_display_t *vd, picture_t *pic, subpicture_t *subpic,
                     vlc_tick_t date)
 {
-    VLC_UNUSED(date);
     vout_display_sys_t *sys = vd->sys;
     struct wl_display *display = sys->embed->display.wl;
     struct wl_surface *surface = sys->embed->handle.wl;
     struct picture_buffer_t *picbuf = pic->p_sys;
 
+    sys->date = date;
+
     if (picbuf->fd == -1)
         return;
 
@@ -146,6 +261,8 @@ static void Display(vout_display_t *vd, picture_t *pic)
     struct wl_display *display = sys->embed->display.wl;
     struct wl_surface *surface = sys->embed->handle.wl;
 
+    if (sys->presentation != NULL)
+        RequestFeedback(vd, surface);
     wl_surface_commit(surface);
     wl_display_roundtrip_queue(display, sys->eventq);
 
@@ -253,6 +370,10 @@ static void registry_global_cb(void *data, struct wl_registry *registry,
         sys->viewporter = wl_registry_bind(registry, name,
                                            &wp_viewporter_interface, 1);
     else
+    if (!strcmp(iface, "wp_presentation"))
+        sys->presentation = wl_registry_bind(registry, name,
+                                             &wp_presentation_interface, 1);
+    else
     if (!strcmp(iface, "wl_compositor"))
         sys->use_buffer_transform = vers >= 2;
 }
@@ -287,7 +408,11 @@ static int Open(vout_display_t *vd, const vout_display_cfg_t *cfg,
     sys->eventq = NULL;
     sys->shm = NULL;
     sys->viewporter = NULL;
+    sys->presentation = NULL;
+    sys->presentation_clock = CLOCK_MONOTONIC;
+    vlc_list_init(&sys->feedbacks);
     sys->active_buffers = 0;
+    sys->date = VLC_TICK_INVALID;
     sys->display_width = cfg->display.width;
     sys->display_height = cfg->display.height;
     sys->use_buffer_transform = false;
@@ -315,6 +440,8 @@ static int Open(vout_display_t *vd, const vout_display_cfg_t *cfg,
         goto error;
 
     wl_shm_add_listener(sys->shm, &shm_cbs, vd);
+    if (sys->presentation != NULL)
+        wp_presentation_add_listener(sys->presentation, &presentation_cbs, vd);
     wl_display_roundtrip_queue(display, sys->eventq);
 
     struct wl_surface *surface = sys->embed->handle.wl;
@@ -358,6 +485,9 @@ static int Open(vout_display_t *vd, const vout_display_cfg_t *cfg,
     return VLC_SUCCESS;
 
 error:
+    if (sys->presentation != NULL)
+        wp_presentation_destroy(sys->presentation);
+
     if (sys->viewporter != NULL)
         wp_viewporter_destroy(sys->viewporter);
 
@@ -386,6 +516,11 @@ static void Close(vout_display_t *vd)
     }
     msg_Dbg(vd, "no active buffers left");
 
+    struct feedback_data *d;
+    vlc_list_foreach(d, &sys->feedbacks, node)
+        feedback_destroy(d);
+    if (sys->presentation != NULL)
+        wp_presentation_destroy(sys->presentation);
     if (sys->viewport != NULL)
         wp_viewport_destroy(sys->viewport);
     if (sys->viewporter != NULL)
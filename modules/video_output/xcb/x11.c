@@ -29,6 +29,9 @@
 
 #include <xcb/xcb.h>
 #include <xcb/shm.h>
+#ifdef HAVE_XCB_PRESENT
+# include <xcb/present.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
@@ -38,6 +41,12 @@
 #include "pictures.h"
 #include "events.h"
 
+#ifdef HAVE_XCB_PRESENT
+/* Number of back buffer pixmaps: one on screen, one queued for the next
+ * refresh cycle, and one being drawn. */
+# define PRESENT_RING_SIZE 3
+#endif
+
 struct vout_display_sys_t
 {
     xcb_connection_t *conn;
@@ -48,8 +57,144 @@ struct vout_display_sys_t
     bool attached;
     uint8_t depth; /* useful bits per pixel */
     video_format_t fmt;
+    vlc_tick_t date; /**< deadline of the prepared picture */
+#ifdef HAVE_XCB_PRESENT
+    xcb_special_event_t *present_events; /**< Present events queue */
+    xcb_present_event_t present_eid;
+    uint32_t serial; /**< serial of the last presented pixmap */
+    uint64_t last_msc;
+    vlc_tick_t last_ust;
+    struct {
+        xcb_pixmap_t pixmap; /**< back buffer XID, or 0 if not created */
+        uint32_t serial;
+        vlc_tick_t date;
+        bool busy; /**< until the X server reports it idle */
+    } ring[PRESENT_RING_SIZE];
+#endif
 };
 
+#ifdef HAVE_XCB_PRESENT
+/** Check Present extension support */
+static bool PresentCheck(vout_display_t *vd, xcb_connection_t *conn)
+{
+    const xcb_query_extension_reply_t *ext =
+        xcb_get_extension_data(conn, &xcb_present_id);
+    if (ext == NULL || !ext->present)
+    {
+        msg_Dbg(vd, "Present extension not available");
+        return false;
+    }
+
+    xcb_present_query_version_reply_t *r =
+        xcb_present_query_version_reply(conn,
+            xcb_present_query_version(conn, XCB_PRESENT_MAJOR_VERSION,
+                                      XCB_PRESENT_MINOR_VERSION), NULL);
+    if (r == NULL)
+        return false;
+
+    msg_Dbg(vd, "Present extension version %"PRIu32".%"PRIu32,
+            r->major_version, r->minor_version);
+    free(r);
+    return true;
+}
+
+static void PresentReleasePixmaps(vout_display_sys_t *sys)
+{
+    for (size_t i = 0; i < PRESENT_RING_SIZE; i++)
+    {
+        if (sys->ring[i].pixmap != 0)
+            xcb_free_pixmap(sys->conn, sys->ring[i].pixmap);
+        sys->ring[i].pixmap = 0;
+        sys->ring[i].busy = false;
+    }
+}
+
+static void PresentCompleted(vout_display_t *vd,
+                             const xcb_present_complete_notify_event_t *ev)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    if (ev->kind != XCB_PRESENT_COMPLETE_KIND_PIXMAP
+     || ev->mode == XCB_PRESENT_COMPLETE_MODE_SKIP || ev->ust == 0)
+        return;
+
+    /* The UST is the monotonic clock in microseconds, like VLC ticks. */
+    vlc_tick_t presented = VLC_TICK_FROM_US(ev->ust);
+    vlc_tick_t period = 0;
+
+    if (sys->last_msc != 0 && ev->msc > sys->last_msc)
+        period = (presented - sys->last_ust) / (ev->msc - sys->last_msc);
+    sys->last_msc = ev->msc;
+    sys->last_ust = presented;
+
+    for (size_t i = 0; i < PRESENT_RING_SIZE; i++)
+        if (sys->ring[i].pixmap != 0 && sys->ring[i].serial == ev->serial)
+        {
+            vout_display_SendEventPresented(vd, sys->ring[i].date,
+                                            presented, period);
+            break;
+        }
+}
+
+static void PresentIdle(vout_display_sys_t *sys,
+                        const xcb_present_idle_notify_event_t *ev)
+{
+    for (size_t i = 0; i < PRESENT_RING_SIZE; i++)
+        if (sys->ring[i].pixmap == ev->pixmap)
+            sys->ring[i].busy = false;
+}
+
+static void PresentManage(vout_display_t *vd)
+{
+    vout_display_sys_t *sys = vd->sys;
+    xcb_generic_event_t *ev;
+
+    while ((ev = xcb_poll_for_special_event(sys->conn,
+                                            sys->present_events)) != NULL)
+    {
+        const xcb_present_generic_event_t *ge = (void *)ev;
+
+        switch (ge->evtype)
+        {
+            case XCB_PRESENT_EVENT_COMPLETE_NOTIFY:
+                PresentCompleted(vd, (void *)ev);
+                break;
+            case XCB_PRESENT_EVENT_IDLE_NOTIFY:
+                PresentIdle(sys, (void *)ev);
+                break;
+        }
+        free(ev);
+    }
+}
+
+/**
+ * Gets an idle back buffer pixmap of the current size, creating it if needed.
+ * @return the ring slot, or -1 if all pixmaps are still in use by the server
+ */
+static int PresentGetPixmap(vout_display_t *vd)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    PresentManage(vd);
+
+    for (size_t i = 0; i < PRESENT_RING_SIZE; i++)
+    {
+        if (sys->ring[i].busy)
+            continue;
+
+        if (sys->ring[i].pixmap == 0)
+        {
+            sys->ring[i].pixmap = xcb_generate_id(sys->conn);
+            xcb_create_pixmap(sys->conn, sys->depth, sys->ring[i].pixmap,
+                              sys->window, sys->fmt.i_visible_width,
+                              sys->fmt.i_visible_height);
+        }
+        return i;
+    }
+    return -1;
+}
+#endif
+
 static void Prepare(vout_display_t *vd, picture_t *pic, subpicture_t *subpic,
                     vlc_tick_t date)
 {
@@ -58,6 +203,7 @@ static void Prepare(vout_display_t *vd, picture_t *pic, subpicture_t *subpic,
     xcb_connection_t *conn = sys->conn;
 
     sys->attached = false;
+    sys->date = date;
 
     if (sys->segment == 0)
         return; /* SHM extension not supported */
@@ -77,7 +223,7 @@ static void Prepare(vout_display_t *vd, picture_t *pic, subpicture_t *subpic,
     }
 
     sys->attached = true;
-    (void) subpic; (void) date;
+    (void) subpic;
 }
 
 /**
@@ -89,12 +235,27 @@ static void Display (vout_display_t *vd, picture_t *pic)
     xcb_connection_t *conn = sys->conn;
     const picture_buffer_t *buf = pic->p_sys;
     xcb_shm_seg_t segment = sys->segment;
+    xcb_drawable_t drawable = sys->window;
     xcb_void_cookie_t ck;
 
     vlc_xcb_Manage(vd, sys->conn);
 
+#ifdef HAVE_XCB_PRESENT
+    /* Draw into an idle back buffer, and let the server flip it in on the
+     * next refresh cycle. If all back buffers are still busy, draw straight
+     * into the window as without Present. */
+    int slot = -1;
+
+    if (sys->present_events != NULL)
+    {
+        slot = PresentGetPixmap(vd);
+        if (slot >= 0)
+            drawable = sys->ring[slot].pixmap;
+    }
+#endif
+
     if (sys->attached)
-        ck = xcb_shm_put_image_checked(conn, sys->window, sys->gc,
+        ck = xcb_shm_put_image_checked(conn, drawable, sys->gc,
               /* real width */ pic->p->i_pitch / pic->p->i_pixel_pitch,
              /* real height */ pic->p->i_lines,
                        /* x */ sys->fmt.i_x_offset,
@@ -108,7 +269,7 @@ static void Display (vout_display_t *vd, picture_t *pic)
         const unsigned lines = pic->p->i_lines - sys->fmt.i_y_offset;
 
         ck = xcb_put_image_checked(conn, XCB_IMAGE_FORMAT_Z_PIXMAP,
-                               sys->window, sys->gc,
+                               drawable, sys->gc,
                                pic->p->i_pitch / pic->p->i_pixel_pitch,
                                lines, -sys->fmt.i_x_offset, 0, 0, sys->depth,
                                pic->p->i_pitch * lines,
@@ -125,6 +286,17 @@ static void Display (vout_display_t *vd, picture_t *pic)
        msg_Err(vd, "%s: X11 error %d", "cannot put image", e->error_code);
        free(e);
    }
+#ifdef HAVE_XCB_PRESENT
+    else if (slot >= 0)
+    {
+        sys->ring[slot].serial = ++sys->serial;
+        sys->ring[slot].date = sys->date;
+        sys->ring[slot].busy = true;
+        xcb_present_pixmap(conn, sys->window, drawable, sys->serial,
+                           0, 0, 0, 0, 0, 0, 0, XCB_PRESENT_OPTION_NONE,
+                           0, 0, 0, 0, NULL);
+    }
+#endif
 
     /* FIXME might be WAY better to wait in some case (be carefull with
      * VOUT_DISPLAY_RESET_PICTURES if done) + does not work with
@@ -162,6 +334,10 @@ static int Control(vout_display_t *vd, int query, va_list ap)
         {
             mask |= XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT;
             ret = VLC_EGENERIC;
+#ifdef HAVE_XCB_PRESENT
+            /* Back buffers are reallocated to the new size on demand. */
+            PresentReleasePixmaps(sys);
+#endif
         }
 
         /* Move the picture within the window */
@@ -199,7 +375,11 @@ static void Close(vout_display_t *vd)
 {
     vout_display_sys_t *sys = vd->sys;
 
-    /* colormap, window and context are garbage-collected by X */
+    /* colormap, window, pixmaps and context are garbage-collected by X */
+#ifdef HAVE_XCB_PRESENT
+    if (sys->present_events != NULL)
+        xcb_unregister_for_special_event(sys->conn, sys->present_events);
+#endif
     xcb_disconnect(sys->conn);
     free(sys);
 }
@@ -261,6 +441,9 @@ static int Open (vout_display_t *vd, const vout_display_cfg_t *cfg,
         return VLC_ENOMEM;
 
     vd->sys = sys;
+#ifdef HAVE_XCB_PRESENT
+    sys->present_events = NULL;
+#endif
 
     /* Get window, connect to X server */
     xcb_connection_t *conn;
@@ -332,6 +515,26 @@ static int Open (vout_display_t *vd, const vout_display_cfg_t *cfg,
     else
         sys->segment = 0;
 
+#ifdef HAVE_XCB_PRESENT
+    if (PresentCheck(vd, conn))
+    {
+        sys->present_eid = xcb_generate_id(conn);
+        xcb_present_select_input(conn, sys->present_eid, sys->window,
+                                 XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY |
+                                 XCB_PRESENT_EVENT_MASK_IDLE_NOTIFY);
+        sys->present_events = xcb_register_for_special_xge(conn,
+                                  &xcb_present_id, sys->present_eid, NULL);
+    }
+    sys->serial = 0;
+    sys->last_msc = 0;
+    sys->last_ust = VLC_TICK_INVALID;
+    for (size_t i = 0; i < PRESENT_RING_SIZE; i++)
+    {
+        sys->ring[i].pixmap = 0;
+        sys->ring[i].busy = false;
+    }
+#endif
+    sys->date = VLC_TICK_INVALID;
     sys->fmt = *fmtp;
     /* Setup vout_display_t once everything is fine */
     vd->info.has_pictures_invalid = true;
@@ -33,6 +33,7 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_filter.h>
 #include <vlc_video_splitter.h>
 #include <vlc_vout_window.h>
 
@@ -700,18 +701,92 @@ static void Close( vlc_object_t *p_this )
     free( p_sys );
 }
 
+typedef struct
+{
+    const video_splitter_sys_t *p_sys;
+    picture_t                  *p_src;
+    picture_t                 **pp_dst;
+    const panoramix_output_t   *pp_output[COL_MAX*ROW_MAX];
+} panoramix_job_t;
+
+/**
+ * It creates one output picture, blending its edges
+ */
+static void FilterOutput( void *opaque, unsigned i_job )
+{
+    const panoramix_job_t *p_job = opaque;
+    const video_splitter_sys_t *p_sys = p_job->p_sys;
+    const panoramix_output_t *p_output = p_job->pp_output[i_job];
+    const picture_t *p_src = p_job->p_src;
+
+    /* */
+    picture_t *p_dst = p_job->pp_dst[p_output->i_output];
+
+    /* */
+    picture_CopyProperties( p_dst, p_src );
+
+    /* */
+    for( int i_plane = 0; i_plane < p_src->i_planes; i_plane++ )
+    {
+        const int i_div_w = p_sys->p_chroma->pi_div_w[i_plane];
+        const int i_div_h = p_sys->p_chroma->pi_div_h[i_plane];
+
+        if( !i_div_w || !i_div_h )
+            continue;
+
+        const plane_t *p_srcp = &p_src->p[i_plane];
+        const plane_t *p_dstp = &p_dst->p[i_plane];
+
+        /* */
+        panoramix_filter_t filter;
+        filter.black.i_right  = p_output->filter.black.i_right / i_div_w;
+        filter.black.i_left   = p_output->filter.black.i_left / i_div_w;
+        filter.black.i_top    = p_output->filter.black.i_top / i_div_h;
+        filter.black.i_bottom = p_output->filter.black.i_bottom / i_div_h;
+
+        filter.attenuate.i_right  = p_output->filter.attenuate.i_right / i_div_w;
+        filter.attenuate.i_left   = p_output->filter.attenuate.i_left / i_div_w;
+        filter.attenuate.i_top    = p_output->filter.attenuate.i_top / i_div_h;
+        filter.attenuate.i_bottom = p_output->filter.attenuate.i_bottom / i_div_h;
+
+        /* */
+        const int i_x = p_output->i_src_x/i_div_w;
+        const int i_y = p_output->i_src_y/i_div_h;
+
+        assert( p_sys->p_chroma->b_planar );
+        FilterPlanar( p_dstp->p_pixels, p_dstp->i_pitch,
+                      &p_srcp->p_pixels[i_y * p_srcp->i_pitch + i_x * p_srcp->i_pixel_pitch], p_srcp->i_pitch,
+                      p_output->i_src_width/i_div_w, p_output->i_src_height/i_div_h,
+                      p_sys->p_chroma->pi_black[i_plane],
+                      &filter,
+                      (uint8_t (*)[256])p_sys->p_lut[i_plane],
+                      (int (*)[ACCURACY/2])p_sys->lambdav[i_plane],
+                      (int (*)[ACCURACY/2])p_sys->lambdah[i_plane] );
+    }
+}
+
+/* Whether the output is only a part of the source */
+static bool IsCrop( const panoramix_output_t *p_output )
+{
+    const panoramix_filter_t *p_filter = &p_output->filter;
+
+    return !p_filter->black.i_left && !p_filter->black.i_right &&
+           !p_filter->black.i_top && !p_filter->black.i_bottom &&
+           !p_filter->attenuate.i_left && !p_filter->attenuate.i_right &&
+           !p_filter->attenuate.i_top && !p_filter->attenuate.i_bottom;
+}
+
 /**
  * It creates multiples pictures from the source one
  */
 static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
 {
     video_splitter_sys_t *p_sys = p_splitter->p_sys;
+    panoramix_job_t job = { .p_sys = p_sys, .p_src = p_src, .pp_dst = pp_dst };
+    unsigned i_job = 0;
 
-    if( video_splitter_NewPicture( p_splitter, pp_dst ) )
-    {
-        picture_Release( p_src );
-        return VLC_EGENERIC;
-    }
+    for( int i = 0; i < p_splitter->i_output; i++ )
+        pp_dst[i] = NULL;
 
     for( int y = 0; y < p_sys->i_row; y++ )
     {
@@ -721,53 +796,36 @@ static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t
             if( !p_output->b_active )
                 continue;
 
-            /* */
-            picture_t *p_dst = pp_dst[p_output->i_output];
-
-            /* */
-            picture_CopyProperties( p_dst, p_src );
+            const video_format_t *p_fmt =
+                &p_splitter->p_output[p_output->i_output].fmt;
 
-            /* */
-            for( int i_plane = 0; i_plane < p_src->i_planes; i_plane++ )
+            /* Outputs without borders nor blended edges are views into the
+             * source planes */
+            picture_t *p_dst = NULL;
+            if( IsCrop( p_output ) )
+                p_dst = picture_CloneCrop( p_src, p_fmt, p_output->i_src_x,
+                                           p_output->i_src_y );
+            if( p_dst == NULL )
             {
-                const int i_div_w = p_sys->p_chroma->pi_div_w[i_plane];
-                const int i_div_h = p_sys->p_chroma->pi_div_h[i_plane];
-
-                if( !i_div_w || !i_div_h )
-                    continue;
-
-                const plane_t *p_srcp = &p_src->p[i_plane];
-                const plane_t *p_dstp = &p_dst->p[i_plane];
-
-                /* */
-                panoramix_filter_t filter;
-                filter.black.i_right  = p_output->filter.black.i_right / i_div_w;
-                filter.black.i_left   = p_output->filter.black.i_left / i_div_w;
-                filter.black.i_top    = p_output->filter.black.i_top / i_div_h;
-                filter.black.i_bottom = p_output->filter.black.i_bottom / i_div_h;
-
-                filter.attenuate.i_right  = p_output->filter.attenuate.i_right / i_div_w;
-                filter.attenuate.i_left   = p_output->filter.attenuate.i_left / i_div_w;
-                filter.attenuate.i_top    = p_output->filter.attenuate.i_top / i_div_h;
-                filter.attenuate.i_bottom = p_output->filter.attenuate.i_bottom / i_div_h;
-
-                /* */
-                const int i_x = p_output->i_src_x/i_div_w;
-                const int i_y = p_output->i_src_y/i_div_h;
-
-                assert( p_sys->p_chroma->b_planar );
-                FilterPlanar( p_dstp->p_pixels, p_dstp->i_pitch,
-                              &p_srcp->p_pixels[i_y * p_srcp->i_pitch + i_x * p_srcp->i_pixel_pitch], p_srcp->i_pitch,
-                              p_output->i_src_width/i_div_w, p_output->i_src_height/i_div_h,
-                              p_sys->p_chroma->pi_black[i_plane],
-                              &filter,
-                              p_sys->p_lut[i_plane],
-                              p_sys->lambdav[i_plane],
-                              p_sys->lambdah[i_plane] );
+                p_dst = picture_NewFromFormat( p_fmt );
+                if( p_dst == NULL )
+                {
+                    msg_Warn( p_splitter, "can't get output pictures" );
+                    for( int i = 0; i < p_splitter->i_output; i++ )
+                        if( pp_dst[i] != NULL )
+                            picture_Release( pp_dst[i] );
+                    picture_Release( p_src );
+                    return VLC_EGENERIC;
+                }
+                job.pp_output[i_job++] = p_output;
             }
+            pp_dst[p_output->i_output] = p_dst;
         }
     }
 
+    /* The outputs are independent, create them concurrently */
+    filter_ParallelJobs( i_job, FilterOutput, &job );
+
     picture_Release( p_src );
     return VLC_SUCCESS;
 }
@@ -31,6 +31,7 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_filter.h>
 #include <vlc_video_splitter.h>
 #include <vlc_vout_window.h>
 
@@ -248,44 +249,82 @@ static void Close( vlc_object_t *p_this )
     free( p_sys );
 }
 
-static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
+typedef struct
 {
-    video_splitter_sys_t *p_sys = p_splitter->p_sys;
+    picture_t           *p_src;
+    picture_t          **pp_dst;
+    const wall_output_t *pp_output[COL_MAX*ROW_MAX];
+} wall_copy_t;
+
+static void CopyOutput( void *opaque, unsigned i_copy )
+{
+    const wall_copy_t *p_copy = opaque;
+    const wall_output_t *p_output = p_copy->pp_output[i_copy];
+    picture_t *p_dst = p_copy->pp_dst[p_output->i_output];
 
-    if( video_splitter_NewPicture( p_splitter, pp_dst ) )
+    picture_t tmp = *p_copy->p_src;
+    for( int i = 0; i < tmp.i_planes; i++ )
     {
-        picture_Release( p_src );
-        return VLC_EGENERIC;
+        plane_t *p0 = &tmp.p[0];
+        plane_t *p = &tmp.p[i];
+        const int i_y = p_output->i_top  * p->i_visible_pitch / p0->i_visible_pitch;
+        const int i_x = p_output->i_left * p->i_visible_lines / p0->i_visible_lines;
+
+        p->p_pixels += i_y * p->i_pitch + ( i_x - (i_x % p->i_pixel_pitch));
     }
+    picture_Copy( p_dst, &tmp );
+}
+
+static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
+{
+    video_splitter_sys_t *p_sys = p_splitter->p_sys;
+    wall_copy_t copy = { .p_src = p_src, .pp_dst = pp_dst };
+    unsigned i_copy = 0;
+
+    for( int i = 0; i < p_splitter->i_output; i++ )
+        pp_dst[i] = NULL;
 
     for( int y = 0; y < p_sys->i_row; y++ )
     {
         for( int x = 0; x < p_sys->i_col; x++ )
         {
-            wall_output_t *p_output = &p_sys->pp_output[x][y];
+            const wall_output_t *p_output = &p_sys->pp_output[x][y];
             if( !p_output->b_active )
                 continue;
 
-            picture_t *p_dst = pp_dst[p_output->i_output];
+            const video_format_t *p_fmt =
+                &p_splitter->p_output[p_output->i_output].fmt;
 
-            /* */
-            picture_t tmp = *p_src;
-            for( int i = 0; i < tmp.i_planes; i++ )
+            /* The outputs are views into the source planes, unless they
+             * cannot be mapped in memory */
+            picture_t *p_dst = picture_CloneCrop( p_src, p_fmt,
+                                                  p_output->i_left,
+                                                  p_output->i_top );
+            if( p_dst == NULL )
             {
-                plane_t *p0 = &tmp.p[0];
-                plane_t *p = &tmp.p[i];
-                const int i_y = p_output->i_top  * p->i_visible_pitch / p0->i_visible_pitch;
-                const int i_x = p_output->i_left * p->i_visible_lines / p0->i_visible_lines;
-
-                p->p_pixels += i_y * p->i_pitch + ( i_x - (i_x % p->i_pixel_pitch));
+                p_dst = picture_NewFromFormat( p_fmt );
+                if( p_dst == NULL )
+                {
+                    msg_Warn( p_splitter, "can't get output pictures" );
+                    for( int i = 0; i < p_splitter->i_output; i++ )
+                        if( pp_dst[i] != NULL )
+                            picture_Release( pp_dst[i] );
+                    picture_Release( p_src );
+                    return VLC_EGENERIC;
+                }
+                copy.pp_output[i_copy++] = p_output;
             }
-            picture_Copy( p_dst, &tmp );
+            pp_dst[p_output->i_output] = p_dst;
         }
     }
 
+    /* The outputs are independent, copy them concurrently */
+    filter_ParallelJobs( i_copy, CopyOutput, &copy );
+
     picture_Release( p_src );
     return VLC_SUCCESS;
 }
+
 static int Mouse( video_splitter_t *p_splitter, int i_index,
                   vout_window_mouse_event_t *restrict ev )
 {
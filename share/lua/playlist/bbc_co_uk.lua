@@ -20,6 +20,7 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
 --]]
 
+-- probe-hosts: bbc.co.uk
 -- Probe function.
 function probe()
     local path = vlc.path:gsub("^www%.", "")
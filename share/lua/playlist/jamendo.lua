@@ -22,6 +22,7 @@
 
 require "simplexml"
 
+-- probe-hosts: api.jamendo.com
 -- Probe function.
 function probe()
     return vlc.access == "http"
@@ -21,6 +21,7 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
 --]]
 
+-- probe-hosts: liveleak.com
 -- Probe function.
 function probe()
     return ( vlc.access == "http" or vlc.access == "https" )
@@ -20,6 +20,7 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
 --]]
 
+-- probe-hosts: mpora.com
 -- Probe function.
 function probe()
     return ( vlc.access == "http" or vlc.access == "https" )
@@ -23,6 +23,7 @@
 -- Set to "mp3", "ogg", "flac" or "wav"
 local fmt = "mp3"
 
+-- probe-hosts: vocaroo.com
 -- Probe function.
 function probe()
     return ( vlc.access == "http" or vlc.access == "https" )
@@ -227,6 +227,7 @@ function pick_url( url_map, fmt, js_url )
     return path
 end
 
+-- probe-hosts: youtube.com
 -- Probe function.
 function probe()
     return ( ( vlc.access == "http" or vlc.access == "https" )
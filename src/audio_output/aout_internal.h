@@ -71,6 +71,7 @@ typedef struct
         vlc_tick_t request_delay;
         vlc_tick_t delay;
         vlc_tick_t first_pts;
+        struct vlc_tracer *tracer;
     } sync;
     vlc_tick_t original_pts;
 
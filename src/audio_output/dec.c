@@ -33,6 +33,7 @@
 
 #include <vlc_common.h>
 #include <vlc_aout.h>
+#include <vlc_tracer.h>
 
 #include "aout_internal.h"
 #include "clock/clock.h"
@@ -94,6 +95,7 @@ int aout_DecNew(audio_output_t *p_aout, const audio_sample_format_t *p_format,
     owner->input_format = *p_format;
     owner->mixer_format = owner->input_format;
     owner->sync.clock = clock;
+    owner->sync.tracer = vlc_object_get_tracer(p_aout);
 
     owner->filters_cfg = AOUT_FILTERS_CFG_INIT;
     if (aout_OutputNew (p_aout, &owner->mixer_format, &owner->filters_cfg))
@@ -459,6 +461,12 @@ int aout_DecPlay(audio_output_t *aout, block_t *block)
     const vlc_tick_t play_date =
         vlc_clock_ConvertToSystem(owner->sync.clock, system_now, original_pts,
                                   owner->sync.rate);
+    if (owner->sync.tracer != NULL)
+        vlc_tracer_TraceEntries(owner->sync.tracer,
+                                VLC_TRACE_STRING("name", "audio_play"),
+                                VLC_TRACE_INT("pts", original_pts),
+                                VLC_TRACE_INT("play_date", play_date),
+                                VLC_TRACE_INT("samples", block->i_nb_samples));
     /* Output */
     owner->sync.discontinuity = false;
     aout->play(aout, block, play_date);
@@ -40,16 +40,182 @@
 #include "aout_internal.h"
 #include "../video_output/vout_internal.h" /* for vout_Request */
 
+/*
+ * Output buffers of the filters
+ *
+ * A filter usually outputs blocks of the same size from one period to the
+ * next, so the released blocks are kept by the filter for the next calls.
+ * The blocks can outlive their filter, e.g. in the audio output.
+ */
+#define AOUT_POOL_MAX   4
+#define AOUT_POOL_ALIGN 64
+
+struct aout_pool
+{
+    vlc_mutex_t lock;
+    block_t *blocks;  /**< released blocks */
+    unsigned count;
+    unsigned refs;    /**< one for the filter, one per block in use */
+    bool closed;
+};
+
+struct aout_pool_block
+{
+    block_t self;
+    struct aout_pool *pool;
+};
+
+#define AOUT_POOL_HEADER \
+    ((sizeof (struct aout_pool_block) + AOUT_POOL_ALIGN - 1) \
+     & ~(size_t)(AOUT_POOL_ALIGN - 1))
+
+struct aout_filter
+{
+    filter_t filter;
+    struct aout_pool *pool;
+};
+
+static void aout_PoolRelease(struct aout_pool *pool)
+{
+    vlc_mutex_lock(&pool->lock);
+    bool last = --pool->refs == 0;
+    vlc_mutex_unlock(&pool->lock);
+
+    if (!last)
+        return;
+    assert(pool->blocks == NULL);
+    vlc_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+static void aout_PoolBlockRelease(block_t *block)
+{
+    struct aout_pool_block *b = container_of(block, struct aout_pool_block,
+                                             self);
+    struct aout_pool *pool = b->pool;
+
+    vlc_mutex_lock(&pool->lock);
+    if (!pool->closed && pool->count < AOUT_POOL_MAX)
+    {
+        block->p_next = pool->blocks;
+        pool->blocks = block;
+        pool->count++;
+        b = NULL;
+    }
+    vlc_mutex_unlock(&pool->lock);
+
+    if (b != NULL)
+        aligned_free(b);
+    aout_PoolRelease(pool);
+}
+
+static const struct vlc_block_callbacks aout_pool_block_cbs =
+{
+    aout_PoolBlockRelease,
+};
+
+static block_t *aout_FilterBufferNew(filter_t *filter, size_t size)
+{
+    struct aout_pool *pool = container_of(filter, struct aout_filter,
+                                          filter)->pool;
+    struct aout_pool_block *b = NULL, *unfit = NULL;
+
+    vlc_mutex_lock(&pool->lock);
+    for (block_t **pp = &pool->blocks; *pp != NULL; pp = &(*pp)->p_next)
+    {
+        if ((*pp)->i_size >= size)
+        {
+            b = container_of(*pp, struct aout_pool_block, self);
+            *pp = (*pp)->p_next;
+            pool->count--;
+            break;
+        }
+    }
+    if (b == NULL && pool->blocks != NULL)
+    {   /* The size has changed: drop a block that is too small */
+        unfit = container_of(pool->blocks, struct aout_pool_block, self);
+        pool->blocks = pool->blocks->p_next;
+        pool->count--;
+    }
+    pool->refs++;
+    vlc_mutex_unlock(&pool->lock);
+
+    aligned_free(unfit);
+
+    size_t capacity;
+    if (b == NULL)
+    {
+        capacity = (size + AOUT_POOL_ALIGN - 1) & ~(size_t)(AOUT_POOL_ALIGN - 1);
+        b = aligned_alloc(AOUT_POOL_ALIGN, AOUT_POOL_HEADER + capacity);
+        if (unlikely(b == NULL))
+        {
+            aout_PoolRelease(pool);
+            return NULL;
+        }
+        b->pool = pool;
+    }
+    else
+        capacity = b->self.i_size;
+
+    block_t *block = block_Init(&b->self, &aout_pool_block_cbs,
+                                (unsigned char *)b + AOUT_POOL_HEADER,
+                                capacity);
+    block->i_buffer = size;
+    return block;
+}
+
+static const struct filter_audio_callbacks aout_filter_cbs =
+{
+    aout_FilterBufferNew,
+};
+
+static void DeleteFilter(filter_t *filter)
+{
+    struct aout_pool *pool = container_of(filter, struct aout_filter,
+                                          filter)->pool;
+
+    vlc_mutex_lock(&pool->lock);
+    block_t *blocks = pool->blocks;
+    pool->blocks = NULL;
+    pool->count = 0;
+    pool->closed = true;
+    vlc_mutex_unlock(&pool->lock);
+
+    while (blocks != NULL)
+    {
+        block_t *next = blocks->p_next;
+        aligned_free(container_of(blocks, struct aout_pool_block, self));
+        blocks = next;
+    }
+    aout_PoolRelease(pool);
+    vlc_object_delete(filter);
+}
+
 static filter_t *CreateFilter(vlc_object_t *obj, vlc_clock_t *clock,
                               const char *type, const char *name,
                               const audio_sample_format_t *infmt,
                               const audio_sample_format_t *outfmt,
                               config_chain_t *cfg, bool const_fmt)
 {
-    filter_t *filter = vlc_custom_create (obj, sizeof (*filter), type);
-    if (unlikely(filter == NULL))
+    struct aout_filter *owner = vlc_custom_create(obj, sizeof (*owner), type);
+    if (unlikely(owner == NULL))
         return NULL;
 
+    struct aout_pool *pool = malloc(sizeof (*pool));
+    if (unlikely(pool == NULL))
+    {
+        vlc_object_delete(&owner->filter);
+        return NULL;
+    }
+    vlc_mutex_init(&pool->lock);
+    pool->blocks = NULL;
+    pool->count = 0;
+    pool->refs = 1;
+    pool->closed = false;
+    owner->pool = pool;
+
+    filter_t *filter = &owner->filter;
+    filter->owner.audio = &aout_filter_cbs;
     filter->owner.sys = clock;
     filter->p_cfg = cfg;
     filter->fmt_in.audio = *infmt;
@@ -79,7 +245,7 @@ static filter_t *CreateFilter(vlc_object_t *obj, vlc_clock_t *clock,
 
     if (filter->p_module == NULL)
     {
-        vlc_object_delete(filter);
+        DeleteFilter(filter);
         filter = NULL;
     }
     else
@@ -116,7 +282,7 @@ static void aout_FiltersPipelineDestroy(filter_t *const *filters, unsigned n)
         filter_t *p_filter = filters[i];
 
         module_unneed( p_filter, p_filter->p_module );
-        vlc_object_delete(p_filter);
+        DeleteFilter(p_filter);
     }
 }
 
@@ -429,7 +595,7 @@ static int AppendFilter(vlc_object_t *obj, const char *type, const char *name,
     {
         msg_Err (filter, "cannot add user %s \"%s\" (skipped)", type, name);
         module_unneed (filter, filter->p_module);
-        vlc_object_delete(filter);
+        DeleteFilter(filter);
         return -1;
     }
 
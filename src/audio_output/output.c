@@ -303,6 +303,9 @@ audio_output_t *aout_New (vlc_object_t *parent)
 
     var_Create (aout, "audio-filter", VLC_VAR_STRING | VLC_VAR_DOINHERIT);
     var_AddCallback (aout, "audio-filter", FilterCallback, NULL);
+    /* Measurements of the "loudness" audio filter */
+    var_Create (aout, "loudness", VLC_VAR_ADDRESS);
+    var_AddCallback (aout, "loudness", var_Copy, parent);
     var_Change(aout, "audio-filter", VLC_VAR_SETTEXT, _("Audio filters"));
 
     var_Create (aout, "viewpoint", VLC_VAR_ADDRESS );
@@ -366,6 +369,7 @@ void aout_Destroy (audio_output_t *aout)
 
     var_DelCallback (aout, "viewpoint", ViewpointCallback, NULL);
     var_DelCallback (aout, "audio-filter", FilterCallback, NULL);
+    var_DelCallback(aout, "loudness", var_Copy, vlc_object_parent(aout));
     var_DelCallback(aout, "device", var_CopyDevice, vlc_object_parent(aout));
     var_DelCallback(aout, "mute", var_Copy, vlc_object_parent(aout));
     var_SetFloat (aout, "volume", -1.f);
@@ -23,12 +23,14 @@
 
 #include <vlc_common.h>
 #include <vlc_aout.h>
+#include <vlc_tracer.h>
 #include <assert.h>
 #include "clock.h"
 #include "clock_internal.h"
 
 struct vlc_clock_main_t
 {
+    struct vlc_tracer *tracer;
     vlc_mutex_t lock;
     vlc_cond_t cond;
 
@@ -126,6 +128,15 @@ static vlc_tick_t vlc_clock_master_update(vlc_clock_t *clock,
 
     main_clock->rate = rate;
     vlc_cond_broadcast(&main_clock->cond);
+
+    if (main_clock->tracer != NULL)
+        vlc_tracer_TraceEntries(main_clock->tracer,
+                                VLC_TRACE_STRING("name", "clock_update"),
+                                VLC_TRACE_INT("stream", ts),
+                                VLC_TRACE_INT("system", system_now),
+                                VLC_TRACE_INT("offset", main_clock->offset),
+                                VLC_TRACE_INT("coeff_ppm",
+                                              main_clock->coeff * 1000000.));
     vlc_mutex_unlock(&main_clock->lock);
     return 0;
 }
@@ -323,13 +334,15 @@ static void vlc_clock_slave_set_dejitter(vlc_clock_t *clock, vlc_tick_t delay)
 }
 
 
-vlc_clock_main_t *vlc_clock_main_New(void)
+vlc_clock_main_t *vlc_clock_main_New(struct vlc_tracer *tracer)
 {
     vlc_clock_main_t *main_clock = malloc(sizeof(vlc_clock_main_t));
 
     if (main_clock == NULL)
         return NULL;
 
+    main_clock->tracer = tracer;
+
     vlc_mutex_init(&main_clock->lock);
     vlc_cond_init(&main_clock->cond);
     main_clock->master = NULL;
@@ -394,6 +407,18 @@ void vlc_clock_main_SetInputDejitter(vlc_clock_main_t *main_clock,
     vlc_mutex_unlock(&main_clock->lock);
 }
 
+vlc_tick_t vlc_clock_main_ToSystem(vlc_clock_main_t *main_clock,
+                                   vlc_tick_t ts)
+{
+    vlc_tick_t system = VLC_TICK_INVALID;
+
+    vlc_mutex_lock(&main_clock->lock);
+    if (main_clock->pause_date == VLC_TICK_INVALID)
+        system = main_stream_to_system(main_clock, ts);
+    vlc_mutex_unlock(&main_clock->lock);
+    return system;
+}
+
 void vlc_clock_main_ChangePause(vlc_clock_main_t *main_clock, vlc_tick_t now,
                                 bool paused)
 {
@@ -30,10 +30,14 @@ enum vlc_clock_master_source
 typedef struct vlc_clock_main_t vlc_clock_main_t;
 typedef struct vlc_clock_t vlc_clock_t;
 
+struct vlc_tracer;
+
 /**
  * This function creates the vlc_clock_main_t of the program
+ *
+ * \param tracer tracer recording the master clock updates (or NULL)
  */
-vlc_clock_main_t *vlc_clock_main_New(void);
+vlc_clock_main_t *vlc_clock_main_New(struct vlc_tracer *tracer);
 
 /**
  * Destroy the clock main
@@ -55,6 +59,17 @@ void vlc_clock_main_SetFirstPcr(vlc_clock_main_t *main_clock,
 void vlc_clock_main_SetInputDejitter(vlc_clock_main_t *main_clock,
                                      vlc_tick_t delay);
 
+/**
+ * Converts a stream timestamp to a system date using the master reference
+ *
+ * Unlike vlc_clock_ConvertToSystem(), this never sets a new reference point.
+ *
+ * \return the system date, or VLC_TICK_INVALID if the master clock has not
+ * been updated yet or is paused
+ */
+vlc_tick_t vlc_clock_main_ToSystem(vlc_clock_main_t *main_clock,
+                                   vlc_tick_t ts);
+
 /**
  * This function allows changing the pause status.
  */
@@ -122,6 +122,11 @@ struct input_clock_t
     vlc_tick_t i_next_drift_update;
     average_t drift;
 
+    /* Arrival jitter (mean deviation of the transit time, see RFC 3550
+     * section 6.4.1), only measured when we don't control the source pace */
+    vlc_tick_t i_transit;
+    vlc_tick_t i_arrival_jitter;
+
     /* Late statistics */
     struct
     {
@@ -172,6 +177,9 @@ input_clock_t *input_clock_New( float rate )
     cl->i_next_drift_update = VLC_TICK_INVALID;
     AvgInit( &cl->drift, 10 );
 
+    cl->i_transit = VLC_TICK_INVALID;
+    cl->i_arrival_jitter = 0;
+
     cl->late.i_index = 0;
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
         cl->late.pi_value[i] = 0;
@@ -236,6 +244,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     {
         cl->i_next_drift_update = VLC_TICK_INVALID;
         AvgReset( &cl->drift );
+        cl->i_transit = VLC_TICK_INVALID;
 
         /* Feed synchro with a new reference point. */
         cl->b_has_reference = true;
@@ -255,6 +264,23 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
         cl->i_next_drift_update = i_ck_system + VLC_TICK_FROM_MS(200); /* FIXME why that */
     }
 
+    /* Estimate the arrival jitter */
+    if( !b_can_pace_control )
+    {
+        const vlc_tick_t i_transit = i_ck_system - i_ck_stream;
+
+        if( cl->i_transit != VLC_TICK_INVALID )
+        {
+            vlc_tick_t i_deviation = i_transit - cl->i_transit;
+            if( i_deviation < 0 )
+                i_deviation = -i_deviation;
+            cl->i_arrival_jitter += ( i_deviation - cl->i_arrival_jitter ) / 16;
+        }
+        cl->i_transit = i_transit;
+    }
+    else
+        cl->i_transit = VLC_TICK_INVALID;
+
     /* Update the extra buffering value */
     if( !b_can_pace_control || b_reset_reference )
     {
@@ -560,6 +586,15 @@ vlc_tick_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+vlc_tick_t input_clock_GetArrivalJitter( input_clock_t *cl )
+{
+    vlc_mutex_lock( &cl->lock );
+    vlc_tick_t i_jitter = cl->i_arrival_jitter;
+    vlc_mutex_unlock( &cl->lock );
+
+    return i_jitter;
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
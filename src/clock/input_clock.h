@@ -135,4 +135,10 @@ void input_clock_SetJitter( input_clock_t *,
  */
 vlc_tick_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function returns the estimated jitter of the clock references
+ * arrival, when the source pace is not controlled.
+ */
+vlc_tick_t input_clock_GetArrivalJitter( input_clock_t * );
+
 #endif
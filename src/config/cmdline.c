@@ -63,7 +63,7 @@ int config_LoadCmdLine( vlc_object_t *p_this, int i_argc,
 #define b_ignore_errors (pindex == NULL)
 
     /* Short options */
-    const module_config_t *pp_shortopts[256];
+    const char *pp_shortopts[256];
     char *psz_shortopts;
 
     /*
@@ -114,22 +114,26 @@ int config_LoadCmdLine( vlc_object_t *p_this, int i_argc,
     i_index = 0;
     for (const vlc_plugin_t *p = vlc_plugins; p != NULL; p = p->next)
     {
-        for (const module_config_t *p_item = p->conf.items,
-                                   *p_end = p_item + p->conf.size;
-             p_item < p_end;
-             p_item++)
+        /* Only the names and types are needed here: this does not load the
+         * configuration items of the plug-ins. */
+        for (size_t i = 0; i < p->conf.size; i++)
         {
+            uint8_t i_type;
+            char i_short;
+            const char *psz_item = vlc_plugin_config_name(p, i, &i_type,
+                                                          &i_short);
+
             /* Ignore hints */
-            if( !CONFIG_ITEM(p_item->i_type) )
+            if( !CONFIG_ITEM(i_type) || psz_item == NULL )
                 continue;
 
             /* Add item to long options */
-            p_longopts[i_index].name = strdup( p_item->psz_name );
+            p_longopts[i_index].name = strdup( psz_item );
             if( p_longopts[i_index].name == NULL ) continue;
             p_longopts[i_index].flag = &flag;
             p_longopts[i_index].val = 0;
 
-            if( CONFIG_CLASS(p_item->i_type) != CONFIG_ITEM_BOOL )
+            if( CONFIG_CLASS(i_type) != CONFIG_ITEM_BOOL )
                 p_longopts[i_index].has_arg = true;
             else
             /* Booleans also need --no-foo and --nofoo options */
@@ -139,7 +143,7 @@ int config_LoadCmdLine( vlc_object_t *p_this, int i_argc,
                 p_longopts[i_index].has_arg = false;
                 i_index++;
 
-                if( asprintf( &psz_name, "no%s", p_item->psz_name ) == -1 )
+                if( asprintf( &psz_name, "no%s", psz_item ) == -1 )
                     continue;
                 p_longopts[i_index].name = psz_name;
                 p_longopts[i_index].has_arg = false;
@@ -147,7 +151,7 @@ int config_LoadCmdLine( vlc_object_t *p_this, int i_argc,
                 p_longopts[i_index].val = 1;
                 i_index++;
 
-                if( asprintf( &psz_name, "no-%s", p_item->psz_name ) == -1 )
+                if( asprintf( &psz_name, "no-%s", psz_item ) == -1 )
                     continue;
                 p_longopts[i_index].name = psz_name;
                 p_longopts[i_index].has_arg = false;
@@ -157,13 +161,12 @@ int config_LoadCmdLine( vlc_object_t *p_this, int i_argc,
             i_index++;
 
             /* If item also has a short option, add it */
-            if( p_item->i_short )
+            if( i_short )
             {
-                pp_shortopts[(int)p_item->i_short] = p_item;
-                psz_shortopts[i_shortopts] = p_item->i_short;
+                pp_shortopts[(int)i_short] = psz_item;
+                psz_shortopts[i_shortopts] = i_short;
                 i_shortopts++;
-                if( p_item->i_type != CONFIG_ITEM_BOOL
-                 && p_item->i_short != 'v' )
+                if( i_type != CONFIG_ITEM_BOOL && i_short != 'v' )
                 {
                     psz_shortopts[i_shortopts] = ':';
                     i_shortopts++;
@@ -242,8 +245,9 @@ int config_LoadCmdLine( vlc_object_t *p_this, int i_argc,
         /* A short option has been recognized */
         if( pp_shortopts[i_cmd] != NULL )
         {
-            const char *name = pp_shortopts[i_cmd]->psz_name;
-            switch( CONFIG_CLASS(pp_shortopts[i_cmd]->i_type) )
+            const char *name = pp_shortopts[i_cmd];
+            const module_config_t *p_conf = config_FindConfig( name );
+            switch( p_conf != NULL ? CONFIG_CLASS(p_conf->i_type) : 0 )
             {
                 case CONFIG_ITEM_STRING:
                     var_Create( p_this, name, VLC_VAR_STRING );
@@ -386,26 +386,34 @@ error:
     return -1;
 }
 
-static int confcmp (const void *a, const void *b)
+/**
+ * Index entry of a configuration item
+ *
+ * The index refers to items by plug-in and position, so that it can be built
+ * before the items tables of the plug-ins are loaded.
+ */
+struct config_entry
 {
-    const module_config_t *const *ca = a, *const *cb = b;
+    const char *name;
+    vlc_plugin_t *plugin;
+    size_t index;
+};
 
-    return strcmp ((*ca)->psz_name, (*cb)->psz_name);
-}
+static struct
+{
+    struct config_entry *table; /**< open-addressing hash table */
+    size_t mask; /**< table size minus one (the size is a power of two) */
+} config = { NULL, 0 };
 
-static int confnamecmp (const void *key, const void *elem)
+static size_t confhash (const char *name)
 {
-    const module_config_t *const *conf = elem;
+    size_t h = 5381;
 
-    return strcmp (key, (*conf)->psz_name);
+    while (*name)
+        h = (h * 33) ^ (unsigned char)*(name++);
+    return h;
 }
 
-static struct
-{
-    module_config_t **list;
-    size_t count;
-} config = { NULL, 0 };
-
 /**
  * Index the configuration items by name for faster lookups.
  */
@@ -415,53 +423,78 @@ int config_SortConfig (void)
     size_t nconf = 0;
 
     for (p = vlc_plugins; p != NULL; p = p->next)
-         nconf += p->conf.size;
+         nconf += p->conf.count;
+
+    /* Keep the load factor below one half */
+    size_t size = 16;
+    while (size < 2 * nconf)
+        size *= 2;
 
-    module_config_t **clist = vlc_alloc (nconf, sizeof (*clist));
-    if (unlikely(clist == NULL))
+    struct config_entry *table = calloc (size, sizeof (*table));
+    if (unlikely(table == NULL))
         return VLC_ENOMEM;
 
-    nconf = 0;
     for (p = vlc_plugins; p != NULL; p = p->next)
     {
-        module_config_t *item, *end;
-
-        for (item = p->conf.items, end = item + p->conf.size;
-             item < end;
-             item++)
+        for (size_t i = 0; i < p->conf.size; i++)
         {
-            if (!CONFIG_ITEM(item->i_type))
+            uint8_t type;
+            char shortname;
+            const char *name = vlc_plugin_config_name (p, i, &type,
+                                                       &shortname);
+
+            if (!CONFIG_ITEM(type) || name == NULL)
                 continue; /* ignore hints */
-            clist[nconf++] = item;
+
+            size_t h = confhash (name) & (size - 1);
+            while (table[h].name != NULL && strcmp (table[h].name, name))
+                h = (h + 1) & (size - 1);
+
+            if (table[h].name != NULL)
+                continue; /* duplicate, keep the first one */
+
+            table[h].name = name;
+            table[h].plugin = p;
+            table[h].index = i;
         }
     }
 
-    qsort (clist, nconf, sizeof (*clist), confcmp);
-
-    config.list = clist;
-    config.count = nconf;
+    config.table = table;
+    config.mask = size - 1;
     return VLC_SUCCESS;
 }
 
 void config_UnsortConfig (void)
 {
-    module_config_t **clist;
+    struct config_entry *table;
 
-    clist = config.list;
-    config.list = NULL;
-    config.count = 0;
+    table = config.table;
+    config.table = NULL;
+    config.mask = 0;
 
-    free (clist);
+    free (table);
 }
 
 module_config_t *config_FindConfig(const char *name)
 {
-    if (unlikely(name == NULL))
+    if (unlikely(name == NULL) || config.table == NULL)
         return NULL;
 
-    module_config_t *const *p;
-    p = bsearch (name, config.list, config.count, sizeof (*p), confnamecmp);
-    return p ? *p : NULL;
+    for (size_t h = confhash (name) & config.mask;
+         config.table[h].name != NULL;
+         h = (h + 1) & config.mask)
+    {
+        const struct config_entry *entry = &config.table[h];
+
+        if (strcmp (entry->name, name))
+            continue;
+
+        /* Load the items of the plug-in on first use */
+        if (vlc_plugin_load_config (entry->plugin))
+            return NULL;
+        return entry->plugin->conf.items + entry->index;
+    }
+    return NULL;
 }
 
 /**
@@ -493,6 +526,10 @@ void config_ResetAll(void)
     vlc_rwlock_wrlock (&config_lock);
     for (vlc_plugin_t *p = vlc_plugins; p != NULL; p = p->next)
     {
+#ifdef HAVE_DYNAMIC_PLUGINS
+        if (atomic_load_explicit(&p->conf.deferred, memory_order_acquire))
+            continue; /* not loaded yet, hence still at the default values */
+#endif
         for (size_t i = 0; i < p->conf.size; i++ )
         {
             module_config_t *p_config = p->conf.items + i;
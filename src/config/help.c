@@ -597,7 +597,7 @@ static void Usage (vlc_object_t *p_this, char const *psz_search)
     const bool desc = var_InheritBool(p_this, "help-verbose");
 
     /* Enumerate the config for each module */
-    for (const vlc_plugin_t *p = vlc_plugins; p != NULL; p = p->next)
+    for (vlc_plugin_t *p = vlc_plugins; p != NULL; p = p->next)
     {
         const module_t *m = p->module;
         const module_config_t *section = NULL;
@@ -609,7 +609,7 @@ static void Usage (vlc_object_t *p_this, char const *psz_search)
             continue;
         found = true;
 
-        if (!plugin_show(p))
+        if (vlc_plugin_load_config(p) || !plugin_show(p))
             continue;
 
         /* Print name of module */
@@ -329,10 +329,28 @@ stream_t *stream_AccessNew(vlc_object_t *parent, input_thread_t *input,
         s->pf_control = AStreamControl;
         s->p_sys = access;
 
-        s = stream_FilterChainNew(s, "prefetch,cache");
+        s = stream_FilterChainNew(s, "cache_adaptive,prefetch,cache");
     }
     else
         s = access;
 
     return s;
 }
+
+void stream_AccessSetInput(stream_t *s, input_thread_t *input)
+{
+    input_item_t *item = input_GetItem(input);
+
+    /* Stream filters of the access stream */
+    for (; s->s != NULL; s = s->s)
+        s->p_input_item = item;
+
+    assert(s->pf_read == AStreamReadStream || s->pf_block == AStreamReadBlock);
+
+    struct vlc_access_stream_private *priv = vlc_stream_Private(s);
+    stream_t *access = s->p_sys;
+
+    assert(priv->input == NULL);
+    priv->input = input;
+    s->p_input_item = access->p_input_item = item;
+}
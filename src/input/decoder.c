@@ -41,6 +41,7 @@
 #include <vlc_meta.h>
 #include <vlc_dialog.h>
 #include <vlc_modules.h>
+#include <vlc_tracer.h>
 
 #include "audio_output/aout_internal.h"
 #include "stream_output/stream_output.h"
@@ -78,11 +79,29 @@ struct decoder_owner
     vlc_thread_t     thread;
 
     void (*pf_update_stat)( struct decoder_owner *, unsigned decoded, unsigned lost );
+    /* Latency histograms of the input statistics, NULL if disabled */
+    struct vlc_histogram *latency;
+    /* Tracer of the instance, NULL if disabled */
+    struct vlc_tracer *tracer;
 
     /* Some decoders require already packetized data (ie. not truncated) */
     decoder_t *p_packetizer;
     bool b_packetizer;
 
+    /* Packetizer thread, packetizing ahead of the decoder thread */
+    struct
+    {
+        bool          b_threaded;
+        vlc_thread_t  thread;
+        block_fifo_t *p_fifo; /* blocks to packetize */
+        vlc_cond_t    wait; /* block dequeued or flush done */
+        atomic_bool   b_flushing;
+        bool          b_draining;
+        bool          b_idle;
+        /* Format of the last packetized blocks sent to the decoder thread */
+        es_format_t   fmt;
+    } pkt;
+
     /* Current format in use by the output */
     es_format_t    fmt;
 
@@ -93,6 +112,15 @@ struct decoder_owner
 
     /* fifo */
     block_fifo_t *p_fifo;
+    /* Queuing dates of the last blocks, indexed by order of arrival
+     * (protected by the fifo lock) */
+#define DECODER_FIFO_DATES 64
+    vlc_tick_t fifo_dates[DECODER_FIFO_DATES];
+    uintmax_t fifo_queued;
+    /* Time spent waiting during the current decoding call */
+    vlc_tick_t wait_time;
+    /* Memory budget of the input FIFO(s), in bytes */
+    size_t fifo_budget;
 
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
@@ -116,6 +144,12 @@ struct decoder_owner
     unsigned frames_countdown;
     bool paused;
 
+    /* Trick play (decoder thread only) */
+    float trickplay_rate;
+    bool b_trickplay;
+    bool b_skip_nonkey; /* until the next key frame, after trick play */
+    bool b_thumbnail_key; /* thumbnail from the first key frame */
+
     bool error;
 
     /* Waiting */
@@ -136,6 +170,7 @@ struct decoder_owner
         bool b_supported;
         decoder_cc_desc_t desc;
         decoder_t *pp_decoder[MAX_CC_DECODERS];
+        unsigned i_decoders; /* number of non-NULL pp_decoder */
         bool b_sout_created;
         sout_packetizer_input_t *p_sout_input;
     } cc;
@@ -153,6 +188,47 @@ struct decoder_owner
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION   VLC_TICK_FROM_MS(200)
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
+/* Format change from the packetizer thread, see struct decoder_format_block */
+#define BLOCK_FLAG_CORE_PRIVATE_FORMAT   (2 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
+
+/* Packetizer output format change, queued in order with packetized blocks */
+struct decoder_format_block
+{
+    block_t self;
+    es_format_t fmt;
+};
+
+static void FormatBlockRelease( block_t *p_block )
+{
+    struct decoder_format_block *p_fb =
+        container_of( p_block, struct decoder_format_block, self );
+
+    es_format_Clean( &p_fb->fmt );
+    free( p_fb );
+}
+
+static const struct vlc_block_callbacks format_block_cbs =
+{
+    .free = FormatBlockRelease,
+};
+
+static block_t *FormatBlockNew( const es_format_t *p_fmt )
+{
+    struct decoder_format_block *p_fb = malloc( sizeof( *p_fb ) );
+    if( unlikely(p_fb == NULL) )
+        return NULL;
+
+    if( es_format_Copy( &p_fb->fmt, p_fmt ) != VLC_SUCCESS )
+    {
+        free( p_fb );
+        return NULL;
+    }
+
+    block_t *p_block = block_Init( &p_fb->self, &format_block_cbs,
+                                   &p_fb->fmt, sizeof( p_fb->fmt ) );
+    p_block->i_flags = BLOCK_FLAG_CORE_PRIVATE_FORMAT;
+    return p_block;
+}
 
 static inline struct decoder_owner *dec_get_owner( decoder_t *p_dec )
 {
@@ -172,6 +248,14 @@ static int LoadDecoder( decoder_t *p_dec, bool b_packetizer,
     /* Find a suitable decoder/packetizer module */
     if( !b_packetizer )
     {
+        if( p_dec->fmt_in.i_cat == VIDEO_ES )
+        {
+            p_dec->i_target_width =
+                var_InheritInteger( p_dec, "dec-target-width" );
+            p_dec->i_target_height =
+                var_InheritInteger( p_dec, "dec-target-height" );
+        }
+
         static const char caps[ES_CATEGORY_COUNT][16] = {
             [VIDEO_ES] = "video decoder",
             [AUDIO_ES] = "audio decoder",
@@ -238,8 +322,7 @@ static void DecoderUpdateFormatLocked( decoder_t *p_dec )
 
     vlc_mutex_assert( &p_owner->lock );
 
-    es_format_Clean( &p_owner->fmt );
-    es_format_Copy( &p_owner->fmt, &p_dec->fmt_out );
+    es_format_Update( &p_owner->fmt, &p_dec->fmt_out );
 
     /* Move p_description */
     if( p_dec->p_description != NULL )
@@ -534,6 +617,12 @@ static int vout_update_format( decoder_t *p_dec )
             dpb_size = 2;
             break;
         }
+        /* The packetizer knows the actual needs of the stream: only keep the
+         * worst case of the codec when memory is not scarce. */
+        if( p_dec->fmt_in.video.i_dpb_size != 0
+         && p_dec->fmt_in.video.i_dpb_size < dpb_size
+         && var_InheritBool( p_dec, "video-frugal-pools" ) )
+            dpb_size = p_dec->fmt_in.video.i_dpb_size;
         p_vout = input_resource_GetVout( p_owner->p_resource,
             &(vout_configuration_t) {
                 .vout = p_vout, .clock = p_owner->p_clock, .fmt = &fmt,
@@ -736,12 +825,25 @@ static void DecoderWaitUnblock( decoder_t *p_dec )
 
     vlc_mutex_assert( &p_owner->lock );
 
+    if( !p_owner->b_waiting || !p_owner->b_has_data )
+        return;
+
+    vlc_tick_t start = p_owner->latency != NULL ? vlc_tick_now() : 0;
+
     for( ;; )
     {
         if( !p_owner->b_waiting || !p_owner->b_has_data )
             break;
         vlc_cond_wait( &p_owner->wait_request, &p_owner->lock );
     }
+
+    if( p_owner->latency != NULL )
+    {
+        vlc_tick_t waited = vlc_tick_now() - start;
+
+        vlc_histogram_Add( &p_owner->latency[INPUT_LATENCY_WAIT], waited );
+        p_owner->wait_time += waited;
+    }
 }
 
 static inline void DecoderUpdatePreroll( vlc_tick_t *pi_preroll, const block_t *p )
@@ -932,10 +1034,32 @@ static void PacketizerGetCc( decoder_t *p_dec, decoder_t *p_dec_cc )
 
     assert( p_dec_cc->pf_get_cc != NULL );
 
+    desc.i_608_channels = 0;
+    desc.i_708_channels = 0;
+    desc.i_reorder_depth = -1;
     p_cc = p_dec_cc->pf_get_cc( p_dec_cc, &desc );
-    if( !p_cc )
+    if( p_cc )
+        DecoderPlayCc( p_dec, p_cc, &desc );
+    else if( desc.i_608_channels | desc.i_708_channels )
+    {
+        /* No caption is decoded, but the ES output lists the channels */
+        vlc_mutex_lock( &p_owner->lock );
+        p_owner->cc.desc = desc;
+        vlc_mutex_unlock( &p_owner->lock );
+    }
+}
+
+/* Lets the packetizer skip the captions data while no channel is decoded */
+static void PacketizerWantCc( decoder_t *p_dec, decoder_t *p_dec_cc )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    if( !p_owner->cc.b_supported || p_dec_cc->pf_get_cc == NULL )
         return;
-    DecoderPlayCc( p_dec, p_cc, &desc );
+
+    vlc_mutex_lock( &p_owner->lock );
+    p_dec_cc->b_cc_wanted = p_owner->cc.i_decoders > 0;
+    vlc_mutex_unlock( &p_owner->lock );
 }
 
 static void DecoderQueueCc( decoder_t *p_videodec, block_t *p_cc,
@@ -1028,6 +1152,11 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
             /* Ensure no earlier higher pts breaks still state */
             vout_Flush( p_vout, p_picture->date );
         }
+        if( p_owner->tracer != NULL )
+            vlc_tracer_TraceEntries( p_owner->tracer,
+                                     VLC_TRACE_STRING( "name", "picture_queued" ),
+                                     VLC_TRACE_INT( "es", p_owner->dec.fmt_in.i_id ),
+                                     VLC_TRACE_INT( "pts", p_picture->date ) );
         vout_PutPicture( p_vout, p_picture );
     }
     else
@@ -1061,6 +1190,12 @@ static void DecoderUpdateStatVideo( struct decoder_owner *p_owner,
 
         vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost );
         lost += vout_lost;
+
+        if( p_owner->latency != NULL )
+            vout_GetResetLatency( p_owner->p_vout,
+                                  &p_owner->latency[INPUT_LATENCY_VOUT_QUEUE],
+                                  &p_owner->latency[INPUT_LATENCY_LATE],
+                                  &p_owner->latency[INPUT_LATENCY_PRESENTATION] );
     }
 
     struct input_stats *stats = input_priv(p_input)->stats;
@@ -1171,6 +1306,12 @@ static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
 
     if( p_aout != NULL && p_audio->i_pts != VLC_TICK_INVALID )
     {
+        if( p_owner->tracer != NULL )
+            vlc_tracer_TraceEntries( p_owner->tracer,
+                                     VLC_TRACE_STRING( "name", "audio_queued" ),
+                                     VLC_TRACE_INT( "es", p_owner->dec.fmt_in.i_id ),
+                                     VLC_TRACE_INT( "pts", p_audio->i_pts ),
+                                     VLC_TRACE_INT( "samples", p_audio->i_nb_samples ) );
         int status = aout_DecPlay( p_aout, p_audio );
         if( status == AOUT_DEC_CHANGED )
         {
@@ -1303,8 +1444,82 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block );
 static void DecoderDecode( decoder_t *p_dec, block_t *p_block )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    vlc_tick_t start = 0;
+
+    /* In trick play, only decode key frames. Once back at a lower rate,
+     * the other frames cannot be decoded until the next key frame. */
+    if( p_owner->b_skip_nonkey && p_block != NULL )
+    {
+        if( p_block->i_flags & BLOCK_FLAG_TYPE_I )
+            p_owner->b_skip_nonkey = p_owner->b_trickplay;
+        else if( p_block->i_flags & BLOCK_FLAG_TYPE_MASK )
+        {
+            block_Release( p_block );
+            return;
+        }
+    }
+
+    /* After a fast seek, a thumbnail is the first key frame: the pictures
+     * before it are not decoded. After a precise seek, the pictures up to
+     * the requested time are prerolled, and all of them are needed. */
+    if( p_owner->b_thumbnail_key && p_block != NULL )
+    {
+        vlc_mutex_lock( &p_owner->lock );
+        const bool b_preroll = p_owner->i_preroll_end > (vlc_tick_t)INT64_MIN;
+        vlc_mutex_unlock( &p_owner->lock );
+
+        if( b_preroll || (p_block->i_flags & BLOCK_FLAG_TYPE_I) )
+            p_owner->b_thumbnail_key = false;
+        else if( p_block->i_flags & BLOCK_FLAG_TYPE_MASK )
+        {
+            block_Release( p_block );
+            return;
+        }
+    }
+
+    /* While prerolling, pictures that are not referenced would be decoded
+     * only to be dropped: skip them */
+    if( p_block != NULL && (p_block->i_flags & BLOCK_FLAG_NON_REFERENCE)
+     && p_block->i_pts != VLC_TICK_INVALID )
+    {
+        vlc_mutex_lock( &p_owner->lock );
+        const bool b_preroll = p_block->i_pts < p_owner->i_preroll_end;
+        vlc_mutex_unlock( &p_owner->lock );
+
+        if( b_preroll )
+        {
+            block_Release( p_block );
+            return;
+        }
+    }
+
+    if( p_owner->latency != NULL )
+    {
+        start = vlc_tick_now();
+        p_owner->wait_time = 0;
+    }
+
+    if( p_owner->tracer != NULL )
+        vlc_tracer_TraceEntries( p_owner->tracer,
+                                 VLC_TRACE_STRING( "name", "decode_start" ),
+                                 VLC_TRACE_INT( "es", p_owner->dec.fmt_in.i_id ),
+                                 VLC_TRACE_INT( "pts", p_block != NULL
+                                                ? p_block->i_pts
+                                                : VLC_TICK_INVALID ) );
 
     int ret = p_dec->pf_decode( p_dec, p_block );
+
+    if( p_owner->tracer != NULL )
+        vlc_tracer_TraceEntries( p_owner->tracer,
+                                 VLC_TRACE_STRING( "name", "decode_end" ),
+                                 VLC_TRACE_INT( "es", p_owner->dec.fmt_in.i_id ),
+                                 VLC_TRACE_INT( "status", ret ) );
+
+    if( p_owner->latency != NULL )
+        /* Do not account for the wait for the end of buffering */
+        vlc_histogram_Add( &p_owner->latency[INPUT_LATENCY_DECODE],
+                           vlc_tick_now() - start - p_owner->wait_time );
+
     switch( ret )
     {
         case VLCDEC_SUCCESS:
@@ -1330,6 +1545,19 @@ static void DecoderDecode( decoder_t *p_dec, block_t *p_block )
     }
 }
 
+static int DecoderChangeFormat( decoder_t *p_dec, const es_format_t *p_fmt )
+{
+    if( es_format_IsSimilar( &p_dec->fmt_in, p_fmt ) )
+        return VLC_SUCCESS;
+
+    msg_Dbg( p_dec, "restarting module due to input format change");
+
+    /* Drain the decoder module */
+    DecoderDecode( p_dec, NULL );
+
+    return ReloadDecoder( p_dec, false, p_fmt, RELOAD_DECODER );
+}
+
 /**
  * Decode a block
  *
@@ -1357,15 +1585,29 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
             goto error;
     }
 
-    bool packetize = p_owner->p_packetizer != NULL;
+    /* With a packetizer thread, blocks are already packetized */
+    bool packetize = p_owner->p_packetizer != NULL && !p_owner->pkt.b_threaded;
     if( p_block )
     {
+        if( unlikely( p_block->i_flags & BLOCK_FLAG_CORE_PRIVATE_FORMAT ) )
+        {
+            struct decoder_format_block *p_fb =
+                container_of( p_block, struct decoder_format_block, self );
+
+            DecoderChangeFormat( p_dec, &p_fb->fmt );
+            block_Release( p_block );
+            return;
+        }
+
         if( p_block->i_buffer <= 0 )
             goto error;
 
-        vlc_mutex_lock( &p_owner->lock );
-        DecoderUpdatePreroll( &p_owner->i_preroll_end, p_block );
-        vlc_mutex_unlock( &p_owner->lock );
+        if( !p_owner->pkt.b_threaded )
+        {
+            vlc_mutex_lock( &p_owner->lock );
+            DecoderUpdatePreroll( &p_owner->i_preroll_end, p_block );
+            vlc_mutex_unlock( &p_owner->lock );
+        }
         if( unlikely( p_block->i_flags & BLOCK_FLAG_CORE_PRIVATE_RELOADED ) )
         {
             /* This block has already been packetized */
@@ -1386,22 +1628,14 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
         block_t **pp_block = p_block ? &p_block : NULL;
         decoder_t *p_packetizer = p_owner->p_packetizer;
 
+        PacketizerWantCc( p_dec, p_packetizer );
         while( (p_packetized_block =
                 p_packetizer->pf_packetize( p_packetizer, pp_block ) ) )
         {
-            if( !es_format_IsSimilar( &p_dec->fmt_in, &p_packetizer->fmt_out ) )
+            if( DecoderChangeFormat( p_dec, &p_packetizer->fmt_out ) )
             {
-                msg_Dbg( p_dec, "restarting module due to input format change");
-
-                /* Drain the decoder module */
-                DecoderDecode( p_dec, NULL );
-
-                if( ReloadDecoder( p_dec, false, &p_packetizer->fmt_out,
-                                   RELOAD_DECODER ) != VLC_SUCCESS )
-                {
-                    block_ChainRelease( p_packetized_block );
-                    return;
-                }
+                block_ChainRelease( p_packetized_block );
+                return;
             }
 
             if( p_packetizer->pf_get_cc )
@@ -1443,7 +1677,9 @@ static void DecoderProcessFlush( decoder_t *p_dec )
     if( p_owner->error )
         return;
 
-    if( p_packetizer != NULL && p_packetizer->pf_flush != NULL )
+    /* The packetizer thread, if any, has flushed the packetizer already */
+    if( p_packetizer != NULL && p_packetizer->pf_flush != NULL
+     && !p_owner->pkt.b_threaded )
         p_packetizer->pf_flush( p_packetizer );
 
     if ( p_dec->pf_flush != NULL )
@@ -1483,7 +1719,8 @@ static void DecoderProcessFlush( decoder_t *p_dec )
             vout_FlushSubpictureChannel( p_owner->p_vout, p_owner->i_spu_channel );
     }
 
-    p_owner->i_preroll_end = (vlc_tick_t)INT64_MIN;
+    if( !p_owner->pkt.b_threaded )
+        p_owner->i_preroll_end = (vlc_tick_t)INT64_MIN;
     vlc_mutex_unlock( &p_owner->lock );
 }
 
@@ -1564,6 +1801,54 @@ static void OutputChangeDelay( decoder_t *p_dec, vlc_tick_t delay )
  *
  * \param p_dec the decoder
  */
+static void DecoderFifoLatency( struct decoder_owner *p_owner )
+{
+    /* Blocks are only removed from the head of the FIFO (or all at once), so
+     * the block just dequeued is followed by all the blocks still queued. */
+    size_t queued = vlc_fifo_GetCount( p_owner->p_fifo );
+
+    if( queued >= DECODER_FIFO_DATES )
+        return; /* its queuing date was overwritten */
+
+    vlc_tick_t date =
+        p_owner->fifo_dates[(p_owner->fifo_queued - queued - 1) % DECODER_FIFO_DATES];
+    vlc_histogram_Add( &p_owner->latency[INPUT_LATENCY_FIFO],
+                       vlc_tick_now() - date );
+}
+
+/* Must be called with the FIFO lock held */
+static bool DecoderFifoIsFull( struct decoder_owner *p_owner,
+                               block_fifo_t *p_fifo )
+{
+    /* A few blocks are always allowed so that large frames still flow */
+    size_t count = vlc_fifo_GetCount( p_fifo );
+
+    return count >= 10
+        || ( count >= 2 && vlc_fifo_GetBytes( p_fifo ) >= p_owner->fifo_budget );
+}
+
+static void DecoderFifoQueue( struct decoder_owner *p_owner, block_t *p_block )
+{
+    if( p_owner->latency != NULL )
+    {
+        vlc_tick_t now = vlc_tick_now();
+
+        for( block_t *p = p_block; p != NULL; p = p->p_next )
+            p_owner->fifo_dates[p_owner->fifo_queued++ % DECODER_FIFO_DATES] = now;
+    }
+
+    if( p_owner->tracer != NULL )
+        for( block_t *p = p_block; p != NULL; p = p->p_next )
+            vlc_tracer_TraceEntries( p_owner->tracer,
+                                     VLC_TRACE_STRING( "name", "block_queued" ),
+                                     VLC_TRACE_INT( "es", p_owner->dec.fmt_in.i_id ),
+                                     VLC_TRACE_INT( "pts", p->i_pts ),
+                                     VLC_TRACE_INT( "dts", p->i_dts ),
+                                     VLC_TRACE_INT( "size", p->i_buffer ) );
+
+    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+}
+
 static void *DecoderThread( void *p_data )
 {
     decoder_t *p_dec = (decoder_t *)p_data;
@@ -1572,6 +1857,8 @@ static void *DecoderThread( void *p_data )
     vlc_tick_t delay = 0;
     bool paused = false;
 
+    vlc_thread_set_affinity( p_dec, "decoder" );
+
     /* The decoder's main loop */
     vlc_fifo_Lock( p_owner->p_fifo );
     vlc_fifo_CleanupPush( p_owner->p_fifo );
@@ -1638,6 +1925,12 @@ static void *DecoderThread( void *p_data )
             OutputChangeRate( p_dec, rate );
             vlc_mutex_unlock( &p_owner->lock );
 
+            p_owner->b_trickplay = p_dec->fmt_in.i_cat == VIDEO_ES
+                                && p_owner->trickplay_rate > 0.f
+                                && rate >= p_owner->trickplay_rate;
+            if( p_owner->b_trickplay )
+                p_owner->b_skip_nonkey = true;
+
             vlc_restorecancel( canc );
             vlc_fifo_Lock( p_owner->p_fifo );
         }
@@ -1683,6 +1976,8 @@ static void *DecoderThread( void *p_data )
             /* We have emptied the FIFO and there is a pending request to
              * drain. Pass p_block = NULL to decoder just once. */
         }
+        else if( p_owner->latency != NULL )
+            DecoderFifoLatency( p_owner );
 
         vlc_fifo_Unlock( p_owner->p_fifo );
 
@@ -1712,6 +2007,191 @@ static void *DecoderThread( void *p_data )
     vlc_assert_unreachable();
 }
 
+static void PacketizerQueue( decoder_t *p_dec, block_t *p_block )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    /* Do not packetize too far ahead of the decoder */
+    if( DecoderFifoIsFull( p_owner, p_owner->p_fifo )
+     && !atomic_load( &p_owner->pkt.b_flushing ) )
+    {
+        vlc_tick_t start = vlc_tick_now();
+
+        do
+            vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
+        while( DecoderFifoIsFull( p_owner, p_owner->p_fifo )
+            && !atomic_load( &p_owner->pkt.b_flushing ) );
+
+        if( p_owner->latency != NULL )
+            vlc_histogram_Add( &p_owner->latency[INPUT_LATENCY_PACKETIZER_BLOCKED],
+                               vlc_tick_now() - start );
+    }
+
+    if( atomic_load( &p_owner->pkt.b_flushing ) )
+        block_ChainRelease( p_block );
+    else
+        DecoderFifoQueue( p_owner, p_block );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
+/**
+ * Packetize a block, and queue the result to the decoder thread
+ *
+ * \param p_dec the decoder object
+ * \param p_block the block to packetize, or NULL to drain
+ */
+static void PacketizerProcess( decoder_t *p_dec, block_t *p_block )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    decoder_t *p_packetizer = p_owner->p_packetizer;
+    block_t **pp_block = p_block ? &p_block : NULL;
+    block_t *p_packetized_block;
+
+    if( p_block )
+    {
+        if( p_block->i_buffer <= 0 )
+        {
+            block_Release( p_block );
+            return;
+        }
+
+        vlc_mutex_lock( &p_owner->lock );
+        DecoderUpdatePreroll( &p_owner->i_preroll_end, p_block );
+        vlc_mutex_unlock( &p_owner->lock );
+    }
+
+    PacketizerWantCc( p_dec, p_packetizer );
+    while( (p_packetized_block =
+            p_packetizer->pf_packetize( p_packetizer, pp_block ) ) )
+    {
+        if( !es_format_IsSimilar( &p_owner->pkt.fmt, &p_packetizer->fmt_out ) )
+        {   /* Let the decoder thread restart the decoder module in order */
+            block_t *p_fmt = FormatBlockNew( &p_packetizer->fmt_out );
+            if( p_fmt != NULL )
+            {
+                es_format_Update( &p_owner->pkt.fmt, &p_packetizer->fmt_out );
+                p_fmt->p_next = p_packetized_block;
+                p_packetized_block = p_fmt;
+            }
+        }
+
+        if( p_packetizer->pf_get_cc )
+            PacketizerGetCc( p_dec, p_packetizer );
+
+        PacketizerQueue( p_dec, p_packetized_block );
+    }
+
+    /* Drain the decoder after the packetizer is drained */
+    if( !pp_block )
+    {
+        vlc_fifo_Lock( p_owner->p_fifo );
+        p_owner->b_draining = true;
+        vlc_fifo_Signal( p_owner->p_fifo );
+        vlc_fifo_Unlock( p_owner->p_fifo );
+    }
+}
+
+static void PacketizerProcessFlush( decoder_t *p_dec )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    decoder_t *p_packetizer = p_owner->p_packetizer;
+
+    if( p_packetizer->pf_flush != NULL )
+        p_packetizer->pf_flush( p_packetizer );
+
+    /* The decoder thread may have missed the last format change */
+    es_format_Clean( &p_owner->pkt.fmt );
+    es_format_Init( &p_owner->pkt.fmt, UNKNOWN_ES, 0 );
+
+    vlc_mutex_lock( &p_owner->lock );
+    p_owner->i_preroll_end = (vlc_tick_t)INT64_MIN;
+    vlc_mutex_unlock( &p_owner->lock );
+}
+
+/**
+ * The packetizing loop, when packetizing ahead of the decoder thread
+ *
+ * \param p_dec the decoder
+ */
+static void *PacketizerThread( void *p_data )
+{
+    decoder_t *p_dec = (decoder_t *)p_data;
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    block_fifo_t *p_fifo = p_owner->pkt.p_fifo;
+
+    vlc_thread_set_affinity( p_dec, "decoder" );
+
+    vlc_fifo_Lock( p_fifo );
+    vlc_fifo_CleanupPush( p_fifo );
+
+    for( ;; )
+    {
+        if( atomic_load( &p_owner->pkt.b_flushing ) )
+        {
+            int canc = vlc_savecancel();
+
+            vlc_fifo_Unlock( p_fifo );
+            PacketizerProcessFlush( p_dec );
+            vlc_fifo_Lock( p_fifo );
+            vlc_restorecancel( canc );
+
+            atomic_store( &p_owner->pkt.b_flushing, false );
+            vlc_cond_broadcast( &p_owner->pkt.wait );
+            continue;
+        }
+
+        vlc_testcancel();
+
+        block_t *p_block = vlc_fifo_DequeueUnlocked( p_fifo );
+        if( p_block == NULL && !p_owner->pkt.b_draining )
+        {
+            if( !p_owner->pkt.b_idle )
+            {   /* Wake input_DecoderWait() up, if it waits for data */
+                p_owner->pkt.b_idle = true;
+                vlc_fifo_Unlock( p_fifo );
+                vlc_mutex_lock( &p_owner->lock );
+                vlc_cond_signal( &p_owner->wait_acknowledge );
+                vlc_mutex_unlock( &p_owner->lock );
+                vlc_fifo_Lock( p_fifo );
+                continue;
+            }
+            vlc_fifo_Wait( p_fifo );
+            continue;
+        }
+
+        p_owner->pkt.b_idle = false;
+        vlc_cond_signal( &p_owner->pkt.wait );
+        vlc_fifo_Unlock( p_fifo );
+
+        int canc = vlc_savecancel();
+        PacketizerProcess( p_dec, p_block );
+        vlc_restorecancel( canc );
+
+        vlc_fifo_Lock( p_fifo );
+        if( p_block == NULL )
+            p_owner->pkt.b_draining = false;
+    }
+    vlc_cleanup_pop();
+    vlc_assert_unreachable();
+}
+
+static void PacketizerThreadStop( struct decoder_owner *p_owner )
+{
+    if( !p_owner->pkt.b_threaded )
+        return;
+
+    vlc_cancel( p_owner->pkt.thread );
+
+    /* Unblock the thread if it waits for room in the decoder fifo */
+    atomic_store( &p_owner->pkt.b_flushing, true );
+    vlc_fifo_Lock( p_owner->p_fifo );
+    vlc_cond_broadcast( &p_owner->wait_fifo );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+
+    vlc_join( p_owner->pkt.thread, NULL );
+}
+
 static const struct decoder_owner_callbacks dec_video_cbs =
 {
     .video = {
@@ -1783,6 +2263,12 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->p_sout = p_sout;
     p_owner->p_sout_input = NULL;
     p_owner->p_packetizer = NULL;
+    p_owner->pkt.b_threaded = false;
+    p_owner->pkt.p_fifo = NULL;
+    atomic_init( &p_owner->pkt.b_flushing, false );
+    p_owner->pkt.b_draining = false;
+    p_owner->pkt.b_idle = true;
+    es_format_Init( &p_owner->pkt.fmt, UNKNOWN_ES, 0 );
 
     atomic_init( &p_owner->b_fmt_description, false );
     p_owner->p_description = NULL;
@@ -1791,6 +2277,9 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->delay = 0;
     p_owner->output_rate = p_owner->request_rate = 1.f;
     p_owner->paused = false;
+    p_owner->trickplay_rate = var_InheritFloat( p_dec, "trickplay-rate" );
+    p_owner->b_trickplay = p_owner->b_skip_nonkey = false;
+    p_owner->b_thumbnail_key = false;
     p_owner->pause_date = VLC_TICK_INVALID;
     p_owner->frames_countdown = 0;
 
@@ -1818,12 +2307,21 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         vlc_object_delete(p_dec);
         return NULL;
     }
+    p_owner->fifo_queued = 0;
+    p_owner->wait_time = 0;
+    /* 4096 MiB does not fit in size_t on 32-bit targets */
+    uint64_t fifo_budget =
+        (uint64_t)var_InheritInteger( p_dec, "decoder-fifo-size" ) << 20;
+    p_owner->fifo_budget = fifo_budget < SIZE_MAX ? fifo_budget : SIZE_MAX;
+    p_owner->latency = NULL;
+    p_owner->tracer = vlc_object_get_tracer( p_dec );
 
     vlc_mutex_init( &p_owner->lock );
     vlc_mutex_init( &p_owner->mouse_lock );
     vlc_cond_init( &p_owner->wait_request );
     vlc_cond_init( &p_owner->wait_acknowledge );
     vlc_cond_init( &p_owner->wait_fifo );
+    vlc_cond_init( &p_owner->pkt.wait );
 
     /* Load a packetizer module if the input is not already packetized */
     if( p_sout == NULL && !fmt->b_packetized )
@@ -1845,18 +2343,27 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         }
     }
 
+    struct input_stats *stats = p_input ? input_priv( p_input )->stats : NULL;
+
     switch( fmt->i_cat )
     {
         case VIDEO_ES:
             if( !p_input || !input_priv( p_input )->b_thumbnailing )
                 p_dec->cbs = &dec_video_cbs;
             else
+            {
                 p_dec->cbs = &dec_thumbnailer_cbs;
+                p_owner->b_thumbnail_key = true;
+            }
             p_owner->pf_update_stat = DecoderUpdateStatVideo;
+            if( stats != NULL )
+                p_owner->latency = stats->video_latency;
             break;
         case AUDIO_ES:
             p_dec->cbs = &dec_audio_cbs;
             p_owner->pf_update_stat = DecoderUpdateStatAudio;
+            if( stats != NULL )
+                p_owner->latency = stats->audio_latency;
             break;
         case SPU_ES:
             p_dec->cbs = &dec_spu_cbs;
@@ -1898,6 +2405,7 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->cc.desc.i_708_channels = 0;
     for( unsigned i = 0; i < MAX_CC_DECODERS; i++ )
         p_owner->cc.pp_decoder[i] = NULL;
+    p_owner->cc.i_decoders = 0;
     p_owner->cc.p_sout_input = NULL;
     p_owner->cc.b_sout_created = false;
     return p_dec;
@@ -1921,6 +2429,9 @@ static void DeleteDecoder( decoder_t * p_dec )
 
     /* Free all packets still in the decoder fifo. */
     block_FifoRelease( p_owner->p_fifo );
+    if( p_owner->pkt.p_fifo != NULL )
+        block_FifoRelease( p_owner->pkt.p_fifo );
+    es_format_Clean( &p_owner->pkt.fmt );
 
     /* Cleanup */
 #ifdef ENABLE_SOUT
@@ -1987,6 +2498,7 @@ static void DeleteDecoder( decoder_t * p_dec )
 
     decoder_Destroy( p_owner->p_packetizer );
 
+    vlc_cond_destroy( &p_owner->pkt.wait );
     vlc_cond_destroy( &p_owner->wait_fifo );
     vlc_cond_destroy( &p_owner->wait_acknowledge );
     vlc_cond_destroy( &p_owner->wait_request );
@@ -2065,10 +2577,25 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     }
 #endif
 
+    /* Spawn the packetizer thread, if packetizing ahead is wanted */
+    if( p_owner->p_packetizer != NULL
+     && var_InheritBool( p_dec, "packetizer-thread" ) )
+    {
+        p_owner->pkt.p_fifo = block_FifoNew();
+        if( likely(p_owner->pkt.p_fifo != NULL)
+         && es_format_Copy( &p_owner->pkt.fmt, &p_dec->fmt_in ) == VLC_SUCCESS
+         && vlc_clone( &p_owner->pkt.thread, PacketizerThread, p_dec,
+                       i_priority ) == 0 )
+            p_owner->pkt.b_threaded = true;
+        else
+            msg_Warn( p_dec, "cannot spawn packetizer thread" );
+    }
+
     /* Spawn the decoder thread */
     if( vlc_clone( &p_owner->thread, DecoderThread, p_dec, i_priority ) )
     {
         msg_Err( p_dec, "cannot spawn decoder thread" );
+        PacketizerThreadStop( p_owner );
         DeleteDecoder( p_dec );
         return NULL;
     }
@@ -2113,6 +2640,8 @@ void input_DecoderDelete( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
+    PacketizerThreadStop( p_owner );
+
     vlc_cancel( p_owner->thread );
 
     vlc_fifo_Lock( p_owner->p_fifo );
@@ -2158,18 +2687,23 @@ void input_DecoderDelete( decoder_t *p_dec )
 void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    /* With a packetizer thread, blocks go through its own fifo first */
+    block_fifo_t *p_fifo = p_owner->pkt.b_threaded ? p_owner->pkt.p_fifo
+                                                   : p_owner->p_fifo;
+    vlc_cond_t *p_wait = p_owner->pkt.b_threaded ? &p_owner->pkt.wait
+                                                 : &p_owner->wait_fifo;
 
-    vlc_fifo_Lock( p_owner->p_fifo );
+    vlc_fifo_Lock( p_fifo );
     if( !b_do_pace )
     {
         /* FIXME: ideally we would check the time amount of data
          * in the FIFO instead of its size. */
-        /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
+        /* 400 MiB by default, i.e. ~ 50mb/s for 60s */
+        if( vlc_fifo_GetBytes( p_fifo ) > p_owner->fifo_budget )
         {
             msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
                       "consumed quickly enough), resetting fifo!" );
-            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_fifo ) );
             p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
         }
     }
@@ -2178,12 +2712,25 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
          * Locking is not necessary as b_waiting is only read, not written by
          * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
-            vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
+        if( DecoderFifoIsFull( p_owner, p_fifo ) )
+        {
+            vlc_tick_t start = vlc_tick_now();
+
+            do
+                vlc_fifo_WaitCond( p_fifo, p_wait );
+            while( DecoderFifoIsFull( p_owner, p_fifo ) );
+
+            if( p_owner->latency != NULL )
+                vlc_histogram_Add( &p_owner->latency[INPUT_LATENCY_DEMUX_BLOCKED],
+                                   vlc_tick_now() - start );
+        }
     }
 
-    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
-    vlc_fifo_Unlock( p_owner->p_fifo );
+    if( p_owner->pkt.b_threaded )
+        vlc_fifo_QueueUnlocked( p_fifo, p_block );
+    else
+        DecoderFifoQueue( p_owner, p_block );
+    vlc_fifo_Unlock( p_fifo );
 }
 
 bool input_DecoderIsEmpty( decoder_t * p_dec )
@@ -2192,6 +2739,16 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
 
     assert( !p_owner->b_waiting );
 
+    if( p_owner->pkt.b_threaded )
+    {
+        vlc_fifo_Lock( p_owner->pkt.p_fifo );
+        bool b_busy = !vlc_fifo_IsEmpty( p_owner->pkt.p_fifo )
+                   || !p_owner->pkt.b_idle || p_owner->pkt.b_draining;
+        vlc_fifo_Unlock( p_owner->pkt.p_fifo );
+        if( b_busy )
+            return false;
+    }
+
     vlc_fifo_Lock( p_owner->p_fifo );
     if( !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining )
     {
@@ -2231,6 +2788,15 @@ void input_DecoderDrain( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
+    if( p_owner->pkt.b_threaded )
+    {   /* The packetizer thread drains the decoder once it is drained */
+        vlc_fifo_Lock( p_owner->pkt.p_fifo );
+        p_owner->pkt.b_draining = true;
+        vlc_fifo_Signal( p_owner->pkt.p_fifo );
+        vlc_fifo_Unlock( p_owner->pkt.p_fifo );
+        return;
+    }
+
     vlc_fifo_Lock( p_owner->p_fifo );
     p_owner->b_draining = true;
     vlc_fifo_Signal( p_owner->p_fifo );
@@ -2245,6 +2811,31 @@ void input_DecoderFlush( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
+    if( p_owner->pkt.b_threaded )
+    {
+        block_fifo_t *p_fifo = p_owner->pkt.p_fifo;
+
+        vlc_fifo_Lock( p_fifo );
+        block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_fifo ) );
+        atomic_store( &p_owner->pkt.b_flushing, true );
+        vlc_fifo_Signal( p_fifo );
+        vlc_fifo_Unlock( p_fifo );
+
+        /* Unblock the thread if it waits for room in the decoder fifo */
+        vlc_fifo_Lock( p_owner->p_fifo );
+        vlc_cond_broadcast( &p_owner->wait_fifo );
+        vlc_fifo_Unlock( p_owner->p_fifo );
+
+        /* Wait for the packetizer to be flushed, so that no stale blocks
+         * get queued to the decoder after its fifo is emptied below. */
+        int canc = vlc_savecancel();
+        vlc_fifo_Lock( p_fifo );
+        while( atomic_load( &p_owner->pkt.b_flushing ) )
+            vlc_fifo_WaitCond( p_fifo, &p_owner->pkt.wait );
+        vlc_fifo_Unlock( p_fifo );
+        vlc_restorecancel( canc );
+    }
+
     vlc_fifo_Lock( p_owner->p_fifo );
 
     /* Empty the fifo */
@@ -2338,6 +2929,8 @@ int input_DecoderSetCcState( decoder_t *p_dec, vlc_fourcc_t codec,
         p_ccowner->p_clock = p_owner->p_clock;
 
         vlc_mutex_lock( &p_owner->lock );
+        if( p_owner->cc.pp_decoder[i_channel] == NULL )
+            p_owner->cc.i_decoders++;
         p_owner->cc.pp_decoder[i_channel] = p_cc;
         vlc_mutex_unlock( &p_owner->lock );
     }
@@ -2348,6 +2941,8 @@ int input_DecoderSetCcState( decoder_t *p_dec, vlc_fourcc_t codec,
         vlc_mutex_lock( &p_owner->lock );
         p_cc = p_owner->cc.pp_decoder[i_channel];
         p_owner->cc.pp_decoder[i_channel] = NULL;
+        if( p_cc != NULL )
+            p_owner->cc.i_decoders--;
         vlc_mutex_unlock( &p_owner->lock );
 
         if( p_cc )
@@ -2442,6 +3037,18 @@ void input_DecoderWait( decoder_t *p_dec )
          * owner */
         if( p_owner->paused )
             break;
+        if( p_owner->pkt.b_threaded )
+        {   /* Check the packetizer first: only it feeds the decoder fifo */
+            vlc_fifo_Lock( p_owner->pkt.p_fifo );
+            bool b_busy = !p_owner->pkt.b_idle || p_owner->pkt.b_draining
+                       || !vlc_fifo_IsEmpty( p_owner->pkt.p_fifo );
+            vlc_fifo_Unlock( p_owner->pkt.p_fifo );
+            if( b_busy )
+            {
+                vlc_cond_wait( &p_owner->wait_acknowledge, &p_owner->lock );
+                continue;
+            }
+        }
         vlc_fifo_Lock( p_owner->p_fifo );
         if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
         {
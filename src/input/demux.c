@@ -138,6 +138,47 @@ static const char* DemuxNameFromExtension( char const* ext,
     return result ? result->name : NULL;
 }
 
+static const char *DemuxNameFromSignature( stream_t *s )
+{
+    /* NOTE: Add only formats with an unambiguous magic number here, which
+     * the named demuxer checks in the same way. The mask tells which bytes of
+     * the magic are significant ('x') or ignored ('.'). */
+    static const struct
+    {
+        char magic[12];
+        char mask[13];
+        char name[8];
+    } signatures[] =
+    {
+        { "\x1A\x45\xDF\xA3",                 "xxxx",         "mkv"  },
+        { "\x30\x26\xB2\x75\x8E\x66\xCF\x11", "xxxxxxxx",     "asf"  },
+        { "FORM\0\0\0\0AIFF",                 "xxxx....xxxx", "aiff" },
+        { "MThd",                             "xxxx",         "smf"  },
+        { "OggS",                             "xxxx",         "ogg"  },
+        { "RIFF\0\0\0\0AVI ",                 "xxxx....xxxx", "avi"  },
+        { "\0\0\0\0ftyp",                     "....xxxx",     "mp4"  },
+        { "caff",                             "xxxx",         "caf"  },
+        { "fLaC",                             "xxxx",         "flac" },
+    };
+    const uint8_t *peek;
+    ssize_t len = vlc_stream_Peek( s, &peek, sizeof (signatures[0].magic) );
+
+    for( size_t i = 0; i < ARRAY_SIZE( signatures ); i++ )
+    {
+        const char *mask = signatures[i].mask;
+        size_t j = 0;
+
+        if( len < (ssize_t)strlen( mask ) )
+            continue;
+        while( mask[j] != '\0'
+            && (mask[j] == '.' || peek[j] == (uint8_t)signatures[i].magic[j]) )
+            j++;
+        if( mask[j] == '\0' )
+            return signatures[i].name;
+    }
+    return NULL;
+}
+
 demux_t *demux_New( vlc_object_t *p_obj, const char *psz_name,
                     stream_t *s, es_out_t *out )
 {
@@ -233,13 +274,33 @@ demux_t *demux_NewAdvanced( vlc_object_t *p_obj, input_thread_t *p_input,
     p_demux->p_sys      = NULL;
 
     const char *psz_module = NULL;
+    char modules[sizeof ("aiff,avformat")];
 
-    if( !strcmp( p_demux->psz_name, "any" ) && p_demux->psz_filepath )
+    if( !strcmp( p_demux->psz_name, "any" ) )
     {
-        char const* psz_ext = strrchr( p_demux->psz_filepath, '.' );
+        /* Try the demuxers matching the magic number and the extension
+         * first, then fall back to probing all of them. */
+        const char *psz_sig = DemuxNameFromSignature( s );
+        const char *psz_ext_module = NULL;
+
+        if( p_demux->psz_filepath )
+        {
+            char const* psz_ext = strrchr( p_demux->psz_filepath, '.' );
 
-        if( psz_ext )
-            psz_module = DemuxNameFromExtension( psz_ext + 1, b_preparsing );
+            if( psz_ext )
+                psz_ext_module = DemuxNameFromExtension( psz_ext + 1,
+                                                         b_preparsing );
+        }
+
+        if( psz_sig != NULL && psz_ext_module != NULL
+         && strcmp( psz_sig, psz_ext_module ) )
+        {
+            snprintf( modules, sizeof (modules), "%s,%s",
+                      psz_sig, psz_ext_module );
+            psz_module = modules;
+        }
+        else
+            psz_module = (psz_sig != NULL) ? psz_sig : psz_ext_module;
     }
 
     if( psz_module == NULL )
@@ -381,6 +442,7 @@ int demux_vaControlHelper( stream_t *s,
         case DEMUX_SET_ES:
         case DEMUX_GET_ATTACHMENTS:
         case DEMUX_CAN_RECORD:
+        case DEMUX_SET_KEYFRAMES_ONLY:
         case DEMUX_TEST_AND_CLEAR_FLAGS:
         case DEMUX_GET_TITLE:
         case DEMUX_GET_SEEKPOINT:
@@ -39,6 +39,7 @@
 #include <vlc_fourcc.h>
 #include <vlc_meta.h>
 #include <vlc_list.h>
+#include <vlc_tracer.h>
 
 #include "input_internal.h"
 #include "../clock/input_clock.h"
@@ -189,6 +190,12 @@ typedef struct
     int         i_cr_average;
     float       rate;
 
+    /* Adaptive buffering of live inputs */
+    bool        b_adaptive;
+    vlc_tick_t  i_adaptive_min;
+    vlc_tick_t  i_adaptive_max;
+    float       adaptive_rate; /* decoders rate adjustment factor */
+
     /* */
     bool        b_paused;
     vlc_tick_t  i_pause_date;
@@ -365,6 +372,15 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, float rate )
 
     p_sys->rate = rate;
 
+    p_sys->b_adaptive = var_InheritBool( p_input, "clock-adaptive" );
+    p_sys->i_adaptive_min =
+        VLC_TICK_FROM_MS( var_InheritInteger( p_input, "clock-adaptive-min" ) );
+    p_sys->i_adaptive_max =
+        VLC_TICK_FROM_MS( var_InheritInteger( p_input, "clock-adaptive-max" ) );
+    if( p_sys->i_adaptive_max < p_sys->i_adaptive_min )
+        p_sys->i_adaptive_max = p_sys->i_adaptive_min;
+    p_sys->adaptive_rate = 1.f;
+
     p_sys->b_buffering = true;
     p_sys->i_preroll_end = -1;
     p_sys->i_prev_stream_level = -1;
@@ -706,7 +722,65 @@ static void EsOutChangeRate( es_out_t *out, float rate )
 
     foreach_es_then_es_slaves(es)
         if( es->p_dec != NULL )
-            input_DecoderChangeRate( es->p_dec, rate );
+            input_DecoderChangeRate( es->p_dec, rate * p_sys->adaptive_rate );
+}
+
+/* Rate adjustment used to drain or fill the adaptive buffer. It is small
+ * enough for the audio output to follow by resampling. */
+#define ADAPTIVE_RATE_STEP (0.01f)
+
+static void EsOutAdaptiveSetRate( es_out_t *out, float adaptive_rate )
+{
+    es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
+    es_out_id_t *es;
+
+    if( p_sys->adaptive_rate == adaptive_rate )
+        return;
+
+    p_sys->adaptive_rate = adaptive_rate;
+    foreach_es_then_es_slaves(es)
+        if( es->p_dec != NULL )
+            input_DecoderChangeRate( es->p_dec, p_sys->rate * adaptive_rate );
+}
+
+/**
+ * Steers the buffering delay of a live input toward a target derived from
+ * the measured arrival jitter, by playing slightly faster or slower.
+ */
+static void EsOutAdaptiveUpdate( es_out_t *out, es_out_pgrm_t *p_pgrm,
+                                 vlc_tick_t i_pcr, vlc_tick_t i_system )
+{
+    es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
+
+    const vlc_tick_t i_play = vlc_clock_main_ToSystem( p_pgrm->p_main_clock,
+                                                       i_pcr );
+    if( i_play == VLC_TICK_INVALID )
+        return; /* no master clock reference yet */
+
+    vlc_tick_t i_target =
+        4 * input_clock_GetArrivalJitter( p_pgrm->p_input_clock );
+    i_target = VLC_CLIP( i_target, p_sys->i_adaptive_min,
+                         p_sys->i_adaptive_max );
+
+    const vlc_tick_t i_latency = i_play - i_system;
+    const vlc_tick_t i_margin = __MAX( i_target / 8, VLC_TICK_FROM_MS(10) );
+    float adaptive_rate = p_sys->adaptive_rate;
+
+    if( i_latency > i_target + 2 * i_margin )
+        adaptive_rate = 1.f + ADAPTIVE_RATE_STEP;
+    else if( i_latency < i_target - 2 * i_margin )
+        adaptive_rate = 1.f - ADAPTIVE_RATE_STEP;
+    else if( llabs( i_latency - i_target ) <= i_margin )
+        adaptive_rate = 1.f;
+
+    if( adaptive_rate != p_sys->adaptive_rate )
+    {
+        msg_Dbg( p_sys->p_input, "adaptive buffering: latency %"PRId64
+                 " ms, target %"PRId64" ms, rate %.2f",
+                 MS_FROM_VLC_TICK(i_latency), MS_FROM_VLC_TICK(i_target),
+                 adaptive_rate );
+        EsOutAdaptiveSetRate( out, adaptive_rate );
+    }
 }
 
 static void EsOutChangePosition( es_out_t *out, bool b_flush )
@@ -742,6 +816,7 @@ static void EsOutChangePosition( es_out_t *out, bool b_flush )
     p_sys->i_buffering_extra_system = 0;
     p_sys->i_preroll_end = -1;
     p_sys->i_prev_stream_level = -1;
+    EsOutAdaptiveSetRate( out, 1.f );
 }
 
 
@@ -1148,7 +1223,7 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
 
     p_pgrm->p_master_clock = NULL;
     p_pgrm->p_input_clock = input_clock_New( p_sys->rate );
-    p_pgrm->p_main_clock = vlc_clock_main_New();
+    p_pgrm->p_main_clock = vlc_clock_main_New( vlc_object_get_tracer( p_input ) );
     if( !p_pgrm->p_input_clock || !p_pgrm->p_main_clock )
     {
         if( p_pgrm->p_input_clock )
@@ -1448,10 +1523,15 @@ static void EsOutProgramEpg( es_out_t *out, int i_group, const vlc_epg_t *p_epg
     epg = *p_epg;
     epg.psz_name = EsOutProgramGetProgramName( p_pgrm );
 
-    input_item_SetEpg( p_item, &epg, p_sys->p_pgrm && (p_epg->i_source_id == p_sys->p_pgrm->i_id) );
-    input_SendEventMetaEpg( p_sys->p_input );
-
+    bool b_changed = input_item_SetEpg( p_item, &epg,
+                                        p_sys->p_pgrm && (p_epg->i_source_id == p_sys->p_pgrm->i_id) );
     free( epg.psz_name );
+    if( !b_changed )
+    {
+        free( psz_cat );
+        return;
+    }
+    input_SendEventMetaEpg( p_sys->p_input );
 
     /* Update now playing */
     if( p_epg->b_present && p_pgrm->p_meta &&
@@ -1550,10 +1630,8 @@ static void EsOutMeta( es_out_t *p_out, const vlc_meta_t *p_meta, const vlc_meta
     input_thread_t  *p_input = p_sys->p_input;
     input_item_t *p_item = input_GetItem( p_input );
 
-    vlc_mutex_lock( &p_item->lock );
     if( p_meta )
-        vlc_meta_Merge( p_item->p_meta, p_meta );
-    vlc_mutex_unlock( &p_item->lock );
+        input_item_MergeMeta( p_item, p_meta );
 
     /* Check program meta to not override GROUP_META values */
     if( p_meta && (!p_program_meta || vlc_meta_Get( p_program_meta, vlc_meta_Title ) == NULL) &&
@@ -1825,7 +1903,7 @@ static void EsOutCreateDecoder( es_out_t *out, es_out_id_t *p_es )
                             input_priv(p_input)->p_sout );
     if( dec != NULL )
     {
-        input_DecoderChangeRate( dec, p_sys->rate );
+        input_DecoderChangeRate( dec, p_sys->rate * p_sys->adaptive_rate );
 
         if( p_sys->b_buffering )
             input_DecoderStartWait( dec );
@@ -2270,12 +2348,14 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     {
         /* FIXME review this, proper lock may be missing */
         if( input_priv(p_input)->p_sout->i_out_pace_nocontrol > 0 &&
+            !input_priv(p_input)->b_sout_offline &&
             input_priv(p_input)->b_out_pace_control )
         {
             msg_Dbg( p_input, "switching to sync mode" );
             input_priv(p_input)->b_out_pace_control = false;
         }
-        else if( input_priv(p_input)->p_sout->i_out_pace_nocontrol <= 0 &&
+        else if( ( input_priv(p_input)->p_sout->i_out_pace_nocontrol <= 0 ||
+                   input_priv(p_input)->b_sout_offline ) &&
                  !input_priv(p_input)->b_out_pace_control )
         {
             msg_Dbg( p_input, "switching to async mode" );
@@ -2722,12 +2802,13 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
         }
 
         /* TODO do not use vlc_tick_now() but proper stream acquisition date */
+        const vlc_tick_t i_system = vlc_tick_now();
         bool b_late;
         input_clock_Update( p_pgrm->p_input_clock, VLC_OBJECT(p_sys->p_input),
                             &b_late,
                             input_priv(p_sys->p_input)->b_can_pace_control || p_sys->b_buffering,
                             EsOutIsExtraBufferingAllowed( out ),
-                            i_pcr, vlc_tick_now() );
+                            i_pcr, i_system );
 
         if( !p_sys->p_pgrm )
             return VLC_SUCCESS;
@@ -2778,6 +2859,10 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
                                     i_pts_delay - i_pts_delay_base,
                                     p_sys->i_cr_average );
             }
+            else if( p_sys->b_adaptive
+                  && !input_priv(p_sys->p_input)->b_can_pace_control
+                  && !input_priv(p_sys->p_input)->p_sout )
+                EsOutAdaptiveUpdate( out, p_pgrm, i_pcr, i_system );
         }
         return VLC_SUCCESS;
     }
@@ -2810,8 +2895,7 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
          || es->fmt.i_group != p_fmt->i_group )
             return VLC_EGENERIC;
 
-        es_format_Clean( &es->fmt );
-        int ret = es_format_Copy( &es->fmt, p_fmt );
+        int ret = es_format_Update( &es->fmt, p_fmt );
         if( ret != VLC_SUCCESS )
             return ret;
         EsOutFillEsFmt( out, &es->fmt );
@@ -3368,8 +3452,7 @@ static int EsOutEsUpdateFmt(es_out_t *out, es_out_id_t *es,
         update.p_extra_languages = es->fmt.p_extra_languages;
     }
 
-    es_format_Clean(&es->fmt_out);
-    int ret = es_format_Copy(&es->fmt_out, &update);
+    int ret = es_format_Update(&es->fmt_out, &update);
     if (ret == VLC_SUCCESS)
     {
         EsOutUpdateEsLanguageTitle(es, &es->fmt_out);
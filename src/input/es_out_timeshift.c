@@ -36,9 +36,13 @@
 #endif
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_MMAP
+#  include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
+#include <vlc_memstats.h>
 #include <vlc_mouse.h>
 #ifdef _WIN32
 #  include <vlc_charset.h>
@@ -147,9 +151,17 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_control_t;
 
+/* Size limit (ring) handling, see TsTrimLocked() */
+enum
+{
+    TS_CMD_TRIMMED = 0x1, /* dropped data: execute at once, without payload */
+    TS_CMD_RESUME  = 0x2, /* first command kept after dropped data */
+};
+
 typedef struct attribute_packed
 {
     int8_t  i_type;
+    uint8_t i_trim;
     vlc_tick_t i_date;
     union
     {
@@ -160,6 +172,14 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
+#define TS_STORAGE_CMD_MAX 30000
+
+typedef struct
+{
+    vlc_tick_t i_date;
+    int        i_cmd;
+} ts_key_t;
+
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
@@ -171,14 +191,22 @@ struct ts_storage_t
 #endif
     size_t  i_file_max; /* Max size in bytes */
     int64_t i_file_size;/* Current size in bytes */
-    FILE    *p_filew;   /* FILE handle for data writing */
+    FILE    *p_filew;   /* FILE handle for data writing (NULL once trimmed) */
     FILE    *p_filer;   /* FILE handle for data reading */
+#ifdef HAVE_MMAP
+    void    *p_map;     /* Read-only mapping, once completely written */
+#endif
 
     /* */
     int      i_cmd_r;
     int      i_cmd_w;
     int      i_cmd_max;
     ts_cmd_t *p_cmd;
+
+    /* Keyframes, by increasing date and command index */
+    int      i_key;
+    int      i_key_max;
+    ts_key_t *p_key;
 };
 
 typedef struct
@@ -187,12 +215,16 @@ typedef struct
     input_thread_t *p_input;
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
+    int64_t        i_tmp_total_max;
     const char     *psz_tmp_path;
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
     vlc_cond_t     wait;
 
+    /* Size of all storages */
+    int64_t        i_tmp_total;
+
     /* */
     bool           b_paused;
     vlc_tick_t     i_pause_date;
@@ -226,6 +258,7 @@ typedef struct
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    int64_t        i_tmp_total_max;   /* Maximal total size in byte, or 0 */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -265,7 +298,9 @@ static void         *TsRun( void * );
 
 static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
 static void         TsStorageDelete( ts_storage_t * );
-static void         TsStoragePack( ts_storage_t *p_storage );
+static void         TsStorageSeal( ts_storage_t *p_storage );
+static int64_t      TsStorageTrim( ts_storage_t *p_storage );
+static int          TsStorageFindKey( const ts_storage_t *p_storage, int i_cmd );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
 static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
@@ -330,6 +365,17 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     msg_Dbg( p_input, "using timeshift granularity of %d MiB",
              (int)p_sys->i_tmp_size_max/(1024*1024) );
 
+    const int64_t i_tmp_total_max = var_InheritInteger( p_input, "input-timeshift-size" );
+    p_sys->i_tmp_total_max = __MAX( i_tmp_total_max, 0 ) * 1024 * 1024;
+    if( p_sys->i_tmp_total_max > 0 )
+    {
+        /* Keep room for at least two storages */
+        p_sys->i_tmp_total_max = __MAX( p_sys->i_tmp_total_max,
+                                        2 * p_sys->i_tmp_size_max );
+        msg_Dbg( p_input, "using timeshift size of %"PRId64" MiB",
+                 p_sys->i_tmp_total_max / (1024*1024) );
+    }
+
     p_sys->psz_tmp_path = var_InheritString( p_input, "input-timeshift-path" );
 #if defined (_WIN32) && !VLC_WINSTORE_APP
     if( p_sys->psz_tmp_path == NULL )
@@ -798,6 +844,8 @@ static int TsStart( es_out_t *p_out )
         return VLC_EGENERIC;
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
+    p_ts->i_tmp_total_max = p_sys->i_tmp_total_max;
+    p_ts->i_tmp_total = 0;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
@@ -839,6 +887,12 @@ static void TsAutoStop( es_out_t *p_out )
 
     p_sys->b_delayed = false;
 }
+/* Accounts for the timeshift storage, in memory or on disk */
+static void TsAddTotalLocked( ts_thread_t *p_ts, int64_t i_delta )
+{
+    p_ts->i_tmp_total += i_delta;
+    vlc_memstats_Add( VLC_MEMSTATS_TIMESHIFT, i_delta );
+}
 static void TsStop( ts_thread_t *p_ts )
 {
     vlc_cancel( p_ts->thread );
@@ -857,10 +911,61 @@ static void TsStop( ts_thread_t *p_ts )
     assert( !p_ts->p_storage_r || !p_ts->p_storage_r->p_next );
     if( p_ts->p_storage_r )
         TsStorageDelete( p_ts->p_storage_r );
+    TsAddTotalLocked( p_ts, -p_ts->i_tmp_total );
     vlc_mutex_unlock( &p_ts->lock );
 
     TsDestroy( p_ts );
 }
+/* Drops the oldest data to honor the total size limit, like a ring buffer:
+ * whole storages are trimmed, and playback resumes on the first keyframe
+ * that is kept. Commands other than sends are kept, to preserve the state
+ * of the ES. */
+static void TsTrimLocked( ts_thread_t *p_ts )
+{
+    ts_storage_t *p_storage = p_ts->p_storage_r;
+    bool b_trimmed = false;
+
+    vlc_mutex_assert( &p_ts->lock );
+
+    while( p_storage != p_ts->p_storage_w
+        && p_ts->i_tmp_total > p_ts->i_tmp_total_max )
+    {
+        int64_t i_freed = TsStorageTrim( p_storage );
+        if( i_freed > 0 )
+        {
+            TsAddTotalLocked( p_ts, -i_freed );
+            b_trimmed = true;
+        }
+        p_storage = p_storage->p_next;
+    }
+
+    if( !b_trimmed )
+        return;
+
+    /* Drop the data before the first keyframe of the next storage */
+    int i_first = p_storage->i_cmd_r;
+    while( i_first < p_storage->i_cmd_w
+        && (p_storage->p_cmd[i_first].i_trim & TS_CMD_TRIMMED) )
+        i_first++;
+
+    int i_key = TsStorageFindKey( p_storage, i_first );
+    int i_resume = i_key < p_storage->i_key ? p_storage->p_key[i_key].i_cmd
+                                            : i_first;
+    for( int i = i_first; i < i_resume; i++ )
+    {
+        ts_cmd_t *p_cmd = &p_storage->p_cmd[i];
+
+        p_cmd->i_trim |= TS_CMD_TRIMMED;
+        if( p_cmd->i_type == C_SEND )
+            p_cmd->u.send.i_offset = -1;
+    }
+    if( i_resume < p_storage->i_cmd_w )
+        p_storage->p_cmd[i_resume].i_trim |= TS_CMD_RESUME;
+
+    msg_Warn( p_ts->p_input, "es out timeshift: buffer full, "
+              "dropping the oldest data" );
+}
+
 static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_mutex_lock( &p_ts->lock );
@@ -883,14 +988,19 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
         }
         else
         {
-            TsStoragePack( p_ts->p_storage_w );
+            TsStorageSeal( p_ts->p_storage_w );
             p_ts->p_storage_w->p_next = p_storage;
             p_ts->p_storage_w = p_storage;
         }
     }
 
     /* TODO return error and warn the user (but only once) */
+    const int64_t i_size = p_ts->p_storage_w->i_file_size;
     TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsAddTotalLocked( p_ts, p_ts->p_storage_w->i_file_size - i_size );
+
+    if( p_ts->i_tmp_total_max > 0 && p_ts->i_tmp_total > p_ts->i_tmp_total_max )
+        TsTrimLocked( p_ts );
 
     vlc_cond_signal( &p_ts->wait );
 
@@ -911,6 +1021,7 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
         if( !p_next )
             break;
 
+        TsAddTotalLocked( p_ts, -p_ts->p_storage_r->i_file_size );
         TsStorageDelete( p_ts->p_storage_r );
         p_ts->p_storage_r = p_next;
     }
@@ -1041,6 +1152,12 @@ static void *TsRun( void *p_data )
             const vlc_tick_t i_duration = cmd.i_date - p_ts->i_rate_date;
             p_ts->i_rate_delay = i_duration * p_ts->rate_source / p_ts->rate - i_duration;
         }
+        if( cmd.i_trim & TS_CMD_RESUME )
+        {
+            /* Older data was dropped, resume playback from here now */
+            p_ts->i_cmd_delay = vlc_tick_now() - cmd.i_date
+                              - p_ts->i_rate_delay - p_ts->i_buffering_delay;
+        }
         if( p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay < 0 && p_ts->rate != p_ts->rate_source )
         {
             const int canc = vlc_savecancel();
@@ -1075,7 +1192,9 @@ static void *TsRun( void *p_data )
          * reading  */
         vlc_cleanup_push( cmd_cleanup_routine, &cmd );
 
-        vlc_tick_wait( i_deadline );
+        /* Dropped data is only there to catch up with the ES state */
+        if( !(cmd.i_trim & TS_CMD_TRIMMED) )
+            vlc_tick_wait( i_deadline );
 
         vlc_cleanup_pop();
 
@@ -1156,15 +1275,15 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     /* */
     p_storage->i_cmd_w = 0;
     p_storage->i_cmd_r = 0;
-    p_storage->i_cmd_max = 30000;
-    p_storage->p_cmd = vlc_alloc( p_storage->i_cmd_max, sizeof(*p_storage->p_cmd) );
-    //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
-
-    if( !p_storage->p_cmd )
-    {
-        TsStorageDelete( p_storage );
-        return NULL;
-    }
+    p_storage->i_cmd_max = 0;
+    p_storage->p_cmd = NULL;
+
+    p_storage->i_key = 0;
+    p_storage->i_key_max = 0;
+    p_storage->p_key = NULL;
+#ifdef HAVE_MMAP
+    p_storage->p_map = NULL;
+#endif
     return p_storage;
 error:
     free( psz_file );
@@ -1172,6 +1291,26 @@ error:
     return NULL;
 }
 
+static void TsStorageClose( ts_storage_t *p_storage )
+{
+#ifdef HAVE_MMAP
+    if( p_storage->p_map )
+        munmap( p_storage->p_map, p_storage->i_file_size );
+    p_storage->p_map = NULL;
+#endif
+    if( p_storage->p_filer )
+        fclose( p_storage->p_filer );
+    if( p_storage->p_filew )
+        fclose( p_storage->p_filew );
+    p_storage->p_filer = p_storage->p_filew = NULL;
+#ifdef _WIN32
+    if( p_storage->psz_file )
+        vlc_unlink( p_storage->psz_file );
+    free( p_storage->psz_file );
+    p_storage->psz_file = NULL;
+#endif
+}
+
 static void TsStorageDelete( ts_storage_t *p_storage )
 {
     while( p_storage->i_cmd_r < p_storage->i_cmd_w )
@@ -1183,28 +1322,70 @@ static void TsStorageDelete( ts_storage_t *p_storage )
         CmdClean( &cmd );
     }
     free( p_storage->p_cmd );
+    free( p_storage->p_key );
 
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
-#ifdef _WIN32
-    vlc_unlink( p_storage->psz_file );
-    free( p_storage->psz_file );
-#endif
+    TsStorageClose( p_storage );
     free( p_storage );
 }
 
-static void TsStoragePack( ts_storage_t *p_storage )
+/* Called once the storage is completely written */
+static void TsStorageSeal( ts_storage_t *p_storage )
 {
-    /* Try to release a bit of memory */
-    if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
-        return;
+    fflush( p_storage->p_filew );
 
-    p_storage->i_cmd_max = __MAX( p_storage->i_cmd_w, 1 );
+#ifdef HAVE_MMAP
+    /* Read the data back through the page cache, without copying it twice */
+    if( p_storage->i_file_size > 0 )
+    {
+        void *p_map = mmap( NULL, p_storage->i_file_size, PROT_READ,
+                            MAP_SHARED, fileno( p_storage->p_filew ), 0 );
+        if( p_map != MAP_FAILED )
+            p_storage->p_map = p_map;
+    }
+#endif
+}
 
-    ts_cmd_t *p_new = realloc( p_storage->p_cmd, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
-    if( p_new )
-        p_storage->p_cmd = p_new;
+/* Drops all the pending data, the commands themselves are kept */
+static int64_t TsStorageTrim( ts_storage_t *p_storage )
+{
+    const int64_t i_size = p_storage->i_file_size;
+
+    if( p_storage->p_filew == NULL )
+        return 0; /* Already trimmed */
+
+    for( int i = p_storage->i_cmd_r; i < p_storage->i_cmd_w; i++ )
+    {
+        ts_cmd_t *p_cmd = &p_storage->p_cmd[i];
+
+        p_cmd->i_trim |= TS_CMD_TRIMMED;
+        if( p_cmd->i_type == C_SEND )
+            p_cmd->u.send.i_offset = -1;
+    }
+    p_storage->i_key = 0;
+
+    TsStorageClose( p_storage );
+    p_storage->i_file_size = 0;
+    return i_size;
 }
+
+/* Returns the index of the first keyframe at or after the given command */
+static int TsStorageFindKey( const ts_storage_t *p_storage, int i_cmd )
+{
+    int i_low = 0;
+    int i_high = p_storage->i_key;
+
+    while( i_low < i_high )
+    {
+        const int i_mid = i_low + (i_high - i_low) / 2;
+
+        if( p_storage->p_key[i_mid].i_cmd < i_cmd )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
 static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
@@ -1214,18 +1395,46 @@ static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
         if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
             return true;
     }
-    return p_storage->i_cmd_w >= p_storage->i_cmd_max;
+    return p_storage->i_cmd_w >= TS_STORAGE_CMD_MAX;
 }
 static bool TsStorageIsEmpty( ts_storage_t *p_storage )
 {
     return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
 }
+static void TsStorageAddKey( ts_storage_t *p_storage, vlc_tick_t i_date, int i_cmd )
+{
+    if( p_storage->i_key >= p_storage->i_key_max )
+    {
+        int i_max = __MAX( 2 * p_storage->i_key_max, 64 );
+        ts_key_t *p_new = realloc( p_storage->p_key, i_max * sizeof(*p_new) );
+        if( !p_new )
+            return; /* The index is only an optimization */
+        p_storage->p_key = p_new;
+        p_storage->i_key_max = i_max;
+    }
+    p_storage->p_key[p_storage->i_key++] = (ts_key_t){ i_date, i_cmd };
+}
 static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
 {
     ts_cmd_t cmd = *p_cmd;
 
     assert( !TsStorageIsFull( p_storage, p_cmd ) );
 
+    if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
+    {
+        int i_max = __MIN( __MAX( 2 * p_storage->i_cmd_max, 256 ),
+                           TS_STORAGE_CMD_MAX );
+        ts_cmd_t *p_new = realloc( p_storage->p_cmd, i_max * sizeof(*p_new) );
+        if( !p_new )
+        {
+            CmdClean( &cmd );
+            return;
+        }
+        p_storage->p_cmd = p_new;
+        p_storage->i_cmd_max = i_max;
+    }
+
+    cmd.i_trim = 0;
     if( cmd.i_type == C_SEND )
     {
         block_t *p_block = cmd.u.send.p_block;
@@ -1248,6 +1457,8 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
             }
         }
         p_storage->i_file_size += p_block->i_buffer;
+        if( p_block->i_flags & BLOCK_FLAG_TYPE_I )
+            TsStorageAddKey( p_storage, cmd.i_date, p_storage->i_cmd_w );
         block_Release( p_block );
 
         if( b_flush )
@@ -1255,6 +1466,48 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
     }
     p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
 }
+static block_t *TsStorageReadBlock( ts_storage_t *p_storage, int64_t i_offset )
+{
+    block_t block;
+    block_t *p_block;
+
+#ifdef HAVE_MMAP
+    if( p_storage->p_map )
+    {
+        const uint8_t *p_data = (const uint8_t *)p_storage->p_map + i_offset;
+
+        if( i_offset + (int64_t)sizeof(block) > p_storage->i_file_size )
+            return NULL;
+        memcpy( &block, p_data, sizeof(block) );
+        if( block.i_buffer > (uint64_t)(p_storage->i_file_size - i_offset - sizeof(block)) )
+            return NULL;
+
+        p_block = block_Alloc( block.i_buffer );
+        if( p_block )
+            memcpy( p_block->p_buffer, &p_data[sizeof(block)], block.i_buffer );
+    }
+    else
+#endif
+    {
+        if( fseek( p_storage->p_filer, i_offset, SEEK_SET ) ||
+            fread( &block, sizeof(block), 1, p_storage->p_filer ) != 1 )
+            return NULL;
+
+        p_block = block_Alloc( block.i_buffer );
+        if( p_block )
+            p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
+    }
+
+    if( p_block )
+    {
+        p_block->i_dts      = block.i_dts;
+        p_block->i_pts      = block.i_pts;
+        p_block->i_flags    = block.i_flags;
+        p_block->i_length   = block.i_length;
+        p_block->i_nb_samples = block.i_nb_samples;
+    }
+    return p_block;
+}
 static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
 {
     assert( !TsStorageIsEmpty( p_storage ) );
@@ -1262,28 +1515,17 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
     if( p_cmd->i_type == C_SEND )
     {
-        block_t block;
+        const int64_t i_offset = p_cmd->u.send.i_offset;
 
-        if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
-        {
-            block_t *p_block = block_Alloc( block.i_buffer );
-            if( p_block )
-            {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
-            }
-            p_cmd->u.send.p_block = p_block;
-        }
+        if( i_offset < 0 )
+            p_cmd->u.send.p_block = NULL; /* Trimmed */
+        else if( b_flush )
+            p_cmd->u.send.p_block = block_Alloc( 1 );
         else
         {
-            //perror( "TsStoragePopCmd" );
-            p_cmd->u.send.p_block = block_Alloc( 1 );
+            p_cmd->u.send.p_block = TsStorageReadBlock( p_storage, i_offset );
+            if( !p_cmd->u.send.p_block )
+                p_cmd->u.send.p_block = block_Alloc( 1 );
         }
     }
 }
@@ -332,12 +332,14 @@ static input_thread_t *Create( vlc_object_t *p_parent,
     priv->is_stopped = false;
     priv->b_recording = false;
     priv->rate = 1.f;
+    priv->b_keyframes_only = false;
     memset( &priv->bookmark, 0, sizeof(priv->bookmark) );
     TAB_INIT( priv->i_bookmark, priv->pp_bookmark );
     TAB_INIT( priv->i_attachment, priv->attachment );
     priv->attachment_demux = NULL;
     priv->p_sout   = NULL;
     priv->b_out_pace_control = priv->b_thumbnailing;
+    priv->b_sout_offline = false;
     priv->p_renderer = p_renderer && priv->b_preparsing == false ?
                 vlc_renderer_item_hold( p_renderer ) : NULL;
 
@@ -559,10 +561,12 @@ static void *Run( void *data )
     input_thread_t *p_input = &priv->input;
 
     vlc_interrupt_set(&priv->interrupt);
+    vlc_thread_set_affinity( p_input, "input" );
 
     if( !Init( p_input ) )
     {
-        if( priv->b_can_pace_control && priv->b_out_pace_control )
+        if( priv->b_can_pace_control && priv->b_out_pace_control
+         && !priv->b_sout_offline )
         {
             /* We don't want a high input priority here or we'll
              * end-up sucking up all the CPU time */
@@ -749,6 +753,28 @@ static void MainLoopStatistics( input_thread_t *p_input )
     input_SendEventStatistics( p_input, &new_stats );
 }
 
+/**
+ * Reports the progress of an offline stream output.
+ */
+static void MainLoopProgress( input_thread_t *p_input, vlc_tick_t now,
+                              vlc_tick_t *last_time, vlc_tick_t *last_date )
+{
+    input_thread_private_t *priv = input_priv(p_input);
+    double f_position;
+    vlc_tick_t i_time = priv->i_time;
+
+    if( demux_Control( priv->master->p_demux, DEMUX_GET_POSITION, &f_position ) )
+        f_position = 0.0;
+
+    if( *last_date != VLC_TICK_INVALID && now > *last_date )
+        msg_Info( p_input, "processed %"PRId64" s (%.1f%%), speed %.2fx",
+                  SEC_FROM_VLC_TICK(i_time), f_position * 100.,
+                  (double)(i_time - *last_time) / (now - *last_date) );
+
+    *last_time = i_time;
+    *last_date = now;
+}
+
 /**
  * MainLoop
  * The main input loop.
@@ -757,6 +783,9 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
 {
     vlc_tick_t i_intf_update = 0;
     vlc_tick_t i_last_seek_mdate = 0;
+    vlc_tick_t i_progress_update = 0;
+    vlc_tick_t i_progress_time = 0;
+    vlc_tick_t i_progress_date = VLC_TICK_INVALID;
 
     if( b_interactive && var_InheritBool( p_input, "start-paused" ) )
         ControlPause( p_input, vlc_tick_now() );
@@ -828,6 +857,12 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
                 MainLoopStatistics( p_input );
                 i_intf_update = now + VLC_TICK_FROM_MS(250);
             }
+            if( input_priv(p_input)->b_sout_offline && now >= i_progress_update )
+            {
+                MainLoopProgress( p_input, now, &i_progress_time,
+                                  &i_progress_date );
+                i_progress_update = now + VLC_TICK_FROM_SEC(5);
+            }
         }
 
         /* Handle control */
@@ -1425,13 +1460,16 @@ static int Init( input_thread_t * p_input )
 
     if( !priv->b_preparsing && priv->p_sout )
     {
-        priv->b_out_pace_control = priv->p_sout->i_out_pace_nocontrol > 0;
+        priv->b_sout_offline = var_InheritBool( p_input, "sout-offline" );
+        priv->b_out_pace_control = priv->b_sout_offline
+                                || priv->p_sout->i_out_pace_nocontrol > 0;
 
         msg_Dbg( p_input, "starting in %ssync mode",
                  priv->b_out_pace_control ? "a" : "" );
     }
 
-    vlc_meta_t *p_meta = vlc_meta_New();
+    /* Thumbnails do not need the meta data */
+    vlc_meta_t *p_meta = priv->b_thumbnailing ? NULL : vlc_meta_New();
     if( p_meta != NULL )
     {
         /* Get meta data from users */
@@ -2093,6 +2131,18 @@ static bool Control( input_thread_t *p_input,
 
                 b_force_update = true;
             }
+
+            /* Above the trick play rate, only key frames are decoded: let the
+             * demuxer skip the other ones, if it can */
+            const float trickplay_rate = var_InheritFloat( p_input, "trickplay-rate" );
+            const bool b_keyframes_only = trickplay_rate > 0.f
+                                       && fabsf( rate ) >= trickplay_rate;
+            if( b_keyframes_only != priv->b_keyframes_only )
+            {
+                priv->b_keyframes_only = b_keyframes_only;
+                demux_Control( priv->master->p_demux, DEMUX_SET_KEYFRAMES_ONLY,
+                               b_keyframes_only );
+            }
             break;
         }
 
@@ -2545,11 +2595,23 @@ static demux_t *InputDemuxNew( input_thread_t *p_input,
     input_thread_private_t *priv = input_priv(p_input );
     vlc_object_t *obj = VLC_OBJECT(p_input);
 
-    /* create the underlying access stream */
-    stream_t *p_stream = stream_AccessNew( obj, p_input, priv->p_es_out,
-                                           priv->b_preparsing, url );
-    if( p_stream == NULL )
+    /* use the access opened ahead of time for this media, if any */
+    stream_t *p_stream = NULL;
+    if( !priv->b_preparsing )
+        p_stream = input_resource_TakeAccess( priv->p_resource, url );
+
+    if( p_stream == NULL && vlc_killed() )
         return NULL;
+    if( p_stream != NULL )
+        stream_AccessSetInput( p_stream, p_input );
+    else
+    {
+        /* create the underlying access stream */
+        p_stream = stream_AccessNew( obj, p_input, priv->p_es_out,
+                                     priv->b_preparsing, url );
+        if( p_stream == NULL )
+            return NULL;
+    }
 
     p_stream = stream_FilterAutoNew( p_stream );
 
@@ -2787,7 +2849,11 @@ static input_source_t *InputSourceNew( input_thread_t *p_input,
      * FIXME improve for b_preparsing: move it after GET_META and check psz_arturl */
     if( !input_priv(p_input)->b_preparsing )
     {
-        if( demux_Control( in->p_demux, DEMUX_GET_TITLE_INFO,
+        /* Thumbnails need neither titles nor attachments */
+        const bool b_thumbnailing = input_priv(p_input)->b_thumbnailing;
+
+        if( b_thumbnailing ||
+            demux_Control( in->p_demux, DEMUX_GET_TITLE_INFO,
                            &in->title, &in->i_title,
                            &in->i_title_offset, &in->i_seekpoint_offset ))
         {
@@ -2800,7 +2866,8 @@ static input_source_t *InputSourceNew( input_thread_t *p_input,
 
         int i_attachment;
         input_attachment_t **attachment;
-        if( !demux_Control( in->p_demux, DEMUX_GET_ATTACHMENTS,
+        if( !b_thumbnailing &&
+            !demux_Control( in->p_demux, DEMUX_GET_ATTACHMENTS,
                              &attachment, &i_attachment ) )
         {
             vlc_mutex_lock( &input_priv(p_input)->p_item->lock );
@@ -33,6 +33,7 @@
 #include <libvlc.h>
 #include "input_interface.h"
 #include "misc/interrupt.h"
+#include "misc/histogram.h"
 
 struct input_stats;
 
@@ -133,6 +134,7 @@ typedef struct input_thread_private_t
     bool        b_recording;
     bool        b_thumbnailing;
     float       rate;
+    bool        b_keyframes_only; /* trick play hint given to the demuxer */
 
     /* Playtime configuration and state */
     vlc_tick_t  i_start;    /* :start-time,0 by default */
@@ -145,6 +147,7 @@ typedef struct input_thread_private_t
 
     /* Output */
     bool            b_out_pace_control; /* XXX Move it ot es_sout ? */
+    bool            b_sout_offline; /* never switch to sync mode */
     sout_instance_t *p_sout;            /* Idem ? */
     es_out_t        *p_es_out;
     es_out_t        *p_es_out_display;
@@ -356,6 +359,8 @@ struct input_stats {
     atomic_uintmax_t lost_abuffers;
     atomic_uintmax_t displayed_pictures;
     atomic_uintmax_t lost_pictures;
+    struct vlc_histogram video_latency[INPUT_LATENCY_COUNT];
+    struct vlc_histogram audio_latency[INPUT_LATENCY_COUNT];
 };
 
 struct input_stats *input_stats_Create(void);
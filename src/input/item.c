@@ -47,6 +47,14 @@ struct input_item_opaque
 
 static enum input_item_type_e GuessType( const input_item_t *p_item, bool *p_net );
 
+/* Must be called with the item lock held, after changing the meta */
+static void input_item_MetaChanged( input_item_t *p_i )
+{
+    vlc_mutex_assert( &p_i->lock );
+    atomic_fetch_add_explicit( &item_owner(p_i)->meta_generation, 1,
+                               memory_order_release );
+}
+
 void input_item_SetErrorWhenReading( input_item_t *p_i, bool b_error )
 {
     bool b_changed;
@@ -83,6 +91,7 @@ void input_item_SetPreparsed( input_item_t *p_i, bool b_preparsed )
     if( status != new_status )
     {
         vlc_meta_SetStatus(p_i->p_meta, new_status);
+        input_item_MetaChanged( p_i );
         b_send_event = true;
     }
 
@@ -111,6 +120,7 @@ void input_item_SetArtNotFound( input_item_t *p_i, bool b_not_found )
         status &= ~ITEM_ART_NOTFOUND;
 
     vlc_meta_SetStatus(p_i->p_meta, status);
+    input_item_MetaChanged( p_i );
 
     vlc_mutex_unlock( &p_i->lock );
 }
@@ -130,6 +140,7 @@ void input_item_SetArtFetched( input_item_t *p_i, bool b_art_fetched )
         status &= ~ITEM_ART_FETCHED;
 
     vlc_meta_SetStatus(p_i->p_meta, status);
+    input_item_MetaChanged( p_i );
 
     vlc_mutex_unlock( &p_i->lock );
 }
@@ -140,6 +151,7 @@ void input_item_SetMeta( input_item_t *p_i, vlc_meta_type_t meta_type, const cha
     if( !p_i->p_meta )
         p_i->p_meta = vlc_meta_New();
     vlc_meta_Set( p_i->p_meta, meta_type, psz_val );
+    input_item_MetaChanged( p_i );
     vlc_mutex_unlock( &p_i->lock );
 
     /* Notify interested third parties */
@@ -148,6 +160,46 @@ void input_item_SetMeta( input_item_t *p_i, vlc_meta_type_t meta_type, const cha
         .u.input_item_meta_changed.meta_type = meta_type } );
 }
 
+void input_item_MergeMeta( input_item_t *p_i, const vlc_meta_t *p_meta )
+{
+    vlc_mutex_lock( &p_i->lock );
+    if( !p_i->p_meta )
+        p_i->p_meta = vlc_meta_New();
+    if( p_i->p_meta )
+    {
+        vlc_meta_Merge( p_i->p_meta, p_meta );
+        input_item_MetaChanged( p_i );
+    }
+    vlc_mutex_unlock( &p_i->lock );
+}
+
+unsigned input_item_GetMetaGeneration( input_item_t *p_i )
+{
+    return atomic_load_explicit( &item_owner(p_i)->meta_generation,
+                                 memory_order_acquire );
+}
+
+vlc_meta_t *input_item_GetMetaSnapshot( input_item_t *p_i,
+                                        unsigned *generation )
+{
+    vlc_meta_t *p_meta = NULL;
+
+    vlc_mutex_lock( &p_i->lock );
+    if( generation != NULL )
+        *generation = input_item_GetMetaGeneration( p_i );
+    if( p_i->p_meta != NULL )
+    {
+        p_meta = vlc_meta_New();
+        if( likely(p_meta != NULL) )
+        {
+            vlc_meta_Merge( p_meta, p_i->p_meta );
+            vlc_meta_SetStatus( p_meta, vlc_meta_GetStatus( p_i->p_meta ) );
+        }
+    }
+    vlc_mutex_unlock( &p_i->lock );
+    return p_meta;
+}
+
 void input_item_CopyOptions( input_item_t *p_child,
                              input_item_t *p_parent )
 {
@@ -873,6 +925,9 @@ void input_item_SetEpgEvent( input_item_t *p_item, const vlc_epg_event_t *p_epg_
             /* Same event can exist in more than one table */
             if( p_epg->pp_event[j]->i_id == p_epg_evt->i_id )
             {
+                if( vlc_epg_event_Equals( p_epg->pp_event[j], p_epg_evt ) )
+                    break;
+
                 vlc_epg_event_t *p_dup = vlc_epg_event_Duplicate( p_epg_evt );
                 if( p_dup )
                 {
@@ -912,12 +967,8 @@ static int InputItemAddInfo( input_item_t *p_i,
 }
 #endif
 
-void input_item_SetEpg( input_item_t *p_item, const vlc_epg_t *p_update, bool b_current_source )
+bool input_item_SetEpg( input_item_t *p_item, const vlc_epg_t *p_update, bool b_current_source )
 {
-    vlc_epg_t *p_epg = vlc_epg_Duplicate( p_update );
-    if( !p_epg )
-        return;
-
     vlc_mutex_lock( &p_item->lock );
 
     /* */
@@ -932,6 +983,23 @@ void input_item_SetEpg( input_item_t *p_item, const vlc_epg_t *p_update, bool b_
         }
     }
 
+    /* Tables are sent again as they are repeated in the stream, or as other
+     * tables change: do not copy nor signal unchanged ones */
+    if( pp_epg && vlc_epg_Equals( *pp_epg, p_update ) )
+    {
+        if( b_current_source && (*pp_epg)->b_present )
+            p_item->p_epg_table = *pp_epg;
+        vlc_mutex_unlock( &p_item->lock );
+        return false;
+    }
+
+    vlc_epg_t *p_epg = vlc_epg_Duplicate( p_update );
+    if( !p_epg )
+    {
+        vlc_mutex_unlock( &p_item->lock );
+        return false;
+    }
+
     /* replace with new version */
     if( pp_epg )
     {
@@ -987,6 +1055,7 @@ signal:
 #endif
     vlc_event_send( &p_item->event_manager,
                     &(vlc_event_t){ .type = vlc_InputItemInfoChanged, } );
+    return true;
 }
 
 void input_item_ChangeEPGSource( input_item_t *p_item, int i_source_id )
@@ -1059,6 +1128,7 @@ input_item_NewExt( const char *psz_uri, const char *psz_name,
         return NULL;
 
     vlc_atomic_rc_init( &owner->rc );
+    atomic_init( &owner->meta_generation, 0 );
 
     input_item_t *p_input = &owner->item;
     vlc_event_manager_t * p_em = &p_input->event_manager;
@@ -1298,30 +1368,26 @@ void input_item_node_RemoveNode( input_item_node_t *parent,
 /* Called by es_out when a new Elementary Stream is added or updated. */
 void input_item_UpdateTracksInfo(input_item_t *item, const es_format_t *fmt)
 {
-    int i;
-    es_format_t *fmt_copy = malloc(sizeof *fmt_copy);
-    if (!fmt_copy)
-        return;
-
-    es_format_Copy(fmt_copy, fmt);
-
     vlc_mutex_lock( &item->lock );
 
-    for( i = 0; i < item->i_es; i++ )
+    for( int i = 0; i < item->i_es; i++ )
     {
         if (item->es[i]->i_id != fmt->i_id)
             continue;
 
-        /* We've found the right ES, replace it */
-        es_format_Clean(item->es[i]);
-        free(item->es[i]);
-        item->es[i] = fmt_copy;
+        /* We've found the right ES, update it */
+        es_format_Update(item->es[i], fmt);
         vlc_mutex_unlock( &item->lock );
         return;
     }
 
     /* ES not found, insert it */
-    TAB_APPEND(item->i_es, item->es, fmt_copy);
+    es_format_t *fmt_copy = malloc(sizeof *fmt_copy);
+    if (likely(fmt_copy != NULL))
+    {
+        es_format_Copy(fmt_copy, fmt);
+        TAB_APPEND(item->i_es, item->es, fmt_copy);
+    }
     vlc_mutex_unlock( &item->lock );
 }
 
@@ -27,6 +27,7 @@
 #include <vlc_atomic.h>
 
 void input_item_SetErrorWhenReading( input_item_t *p_i, bool b_error );
+void input_item_MergeMeta( input_item_t *, const vlc_meta_t * );
 void input_item_UpdateTracksInfo( input_item_t *item, const es_format_t *fmt );
 bool input_item_ShouldPreparseSubItems( input_item_t *p_i );
 
@@ -34,6 +35,7 @@ typedef struct input_item_owner
 {
     input_item_t item;
     vlc_atomic_rc_t rc;
+    atomic_uint meta_generation; /**< incremented on meta changes */
 } input_item_owner_t;
 
 # define item_owner(item) ((struct input_item_owner *)(item))
@@ -46,6 +46,169 @@ struct vlc_meta_t
     int i_status;
 };
 
+/*
+ * Values that repeat across many items (the artist of every track of an
+ * album, the genre of a whole playlist...) are interned: all the meta
+ * holding the same value share a single reference counted copy, and copying
+ * one is a reference count increment.
+ */
+typedef struct meta_string
+{
+    struct meta_string *next;
+    size_t hash;
+    unsigned refs;
+    char value[];
+} meta_string_t;
+
+static struct
+{
+    vlc_mutex_t lock;
+    meta_string_t **buckets;
+    size_t size; /* power of 2 */
+    size_t count;
+} meta_strings = { VLC_STATIC_MUTEX, NULL, 0, 0 };
+
+static bool vlc_meta_IsInterned( vlc_meta_type_t type )
+{
+    switch( type )
+    {
+        case vlc_meta_Artist:
+        case vlc_meta_Genre:
+        case vlc_meta_Copyright:
+        case vlc_meta_Album:
+        case vlc_meta_TrackTotal:
+        case vlc_meta_Date:
+        case vlc_meta_Setting:
+        case vlc_meta_Language:
+        case vlc_meta_Publisher:
+        case vlc_meta_EncodedBy:
+        case vlc_meta_Director:
+        case vlc_meta_Season:
+        case vlc_meta_ShowName:
+        case vlc_meta_Actors:
+        case vlc_meta_AlbumArtist:
+        case vlc_meta_DiscNumber:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static size_t vlc_meta_StringHash( const char *psz )
+{
+    size_t hash = 2166136261u; /* FNV-1a */
+
+    while( *psz )
+        hash = ( hash ^ (unsigned char)*psz++ ) * 16777619u;
+    return hash;
+}
+
+static void vlc_meta_StringsResize( size_t size )
+{
+    meta_string_t **buckets = calloc( size, sizeof (*buckets) );
+    if( unlikely(buckets == NULL) )
+        return; /* keep the longer chains */
+
+    for( size_t i = 0; i < meta_strings.size; i++ )
+        for( meta_string_t *e = meta_strings.buckets[i], *next; e; e = next )
+        {
+            next = e->next;
+            e->next = buckets[e->hash & (size - 1)];
+            buckets[e->hash & (size - 1)] = e;
+        }
+
+    free( meta_strings.buckets );
+    meta_strings.buckets = buckets;
+    meta_strings.size = size;
+}
+
+/* Returns the interned copy of a value */
+static char *vlc_meta_StringIntern( const char *psz )
+{
+    size_t hash = vlc_meta_StringHash( psz );
+    meta_string_t *e;
+
+    vlc_mutex_lock( &meta_strings.lock );
+    if( meta_strings.size > 0 )
+        for( e = meta_strings.buckets[hash & (meta_strings.size - 1)];
+             e != NULL; e = e->next )
+            if( e->hash == hash && !strcmp( e->value, psz ) )
+            {
+                e->refs++;
+                goto out;
+            }
+
+    size_t len = strlen( psz ) + 1;
+    e = malloc( sizeof (*e) + len );
+    if( unlikely(e == NULL) )
+        goto out;
+
+    if( meta_strings.count >= meta_strings.size )
+        vlc_meta_StringsResize( meta_strings.size ? meta_strings.size * 2
+                                                  : 256 );
+    if( unlikely(meta_strings.size == 0) )
+    {
+        free( e );
+        e = NULL;
+        goto out;
+    }
+
+    e->hash = hash;
+    e->refs = 1;
+    memcpy( e->value, psz, len );
+    e->next = meta_strings.buckets[hash & (meta_strings.size - 1)];
+    meta_strings.buckets[hash & (meta_strings.size - 1)] = e;
+    meta_strings.count++;
+out:
+    vlc_mutex_unlock( &meta_strings.lock );
+    return e ? e->value : NULL;
+}
+
+static char *vlc_meta_StringHold( char *psz )
+{
+    meta_string_t *e = container_of( psz, meta_string_t, value );
+
+    vlc_mutex_lock( &meta_strings.lock );
+    e->refs++;
+    vlc_mutex_unlock( &meta_strings.lock );
+    return psz;
+}
+
+static void vlc_meta_StringRelease( char *psz )
+{
+    meta_string_t *e = container_of( psz, meta_string_t, value );
+
+    vlc_mutex_lock( &meta_strings.lock );
+    if( --e->refs == 0 )
+    {
+        meta_string_t **pp = &meta_strings.buckets[e->hash
+                                                   & (meta_strings.size - 1)];
+        while( *pp != e )
+            pp = &(*pp)->next;
+        *pp = e->next;
+        free( e );
+
+        if( --meta_strings.count == 0 )
+        {   /* Nothing left: do not leak the table */
+            free( meta_strings.buckets );
+            meta_strings.buckets = NULL;
+            meta_strings.size = 0;
+        }
+    }
+    vlc_mutex_unlock( &meta_strings.lock );
+}
+
+static void vlc_meta_Clear( vlc_meta_t *m, vlc_meta_type_t type )
+{
+    char *psz = m->ppsz_meta[type];
+
+    if( psz != NULL && vlc_meta_IsInterned( type ) )
+        vlc_meta_StringRelease( psz );
+    else
+        free( psz );
+    m->ppsz_meta[type] = NULL;
+}
+
 /* FIXME bad name convention */
 const char * vlc_meta_TypeToLocalizedString( vlc_meta_type_t meta_type )
 {
@@ -109,7 +272,7 @@ static void vlc_meta_FreeExtraKey( void *p_data, void *p_obj )
 void vlc_meta_Delete( vlc_meta_t *m )
 {
     for( int i = 0; i < VLC_META_TYPE_COUNT ; i++ )
-        free( m->ppsz_meta[i] );
+        vlc_meta_Clear( m, i );
     vlc_dictionary_clear( &m->extra_tags, vlc_meta_FreeExtraKey, NULL );
     free( m );
 }
@@ -122,9 +285,14 @@ void vlc_meta_Delete( vlc_meta_t *m )
 
 void vlc_meta_Set( vlc_meta_t *p_meta, vlc_meta_type_t meta_type, const char *psz_val )
 {
-    free( p_meta->ppsz_meta[meta_type] );
+    char *psz_new = NULL;
+
     assert( psz_val == NULL || IsUTF8( psz_val ) );
-    p_meta->ppsz_meta[meta_type] = psz_val ? strdup( psz_val ) : NULL;
+    if( psz_val != NULL )
+        psz_new = vlc_meta_IsInterned( meta_type )
+                ? vlc_meta_StringIntern( psz_val ) : strdup( psz_val );
+    vlc_meta_Clear( p_meta, meta_type );
+    p_meta->ppsz_meta[meta_type] = psz_new;
 }
 
 const char *vlc_meta_Get( const vlc_meta_t *p_meta, vlc_meta_type_t meta_type )
@@ -180,10 +348,12 @@ void vlc_meta_Merge( vlc_meta_t *dst, const vlc_meta_t *src )
 
     for( int i = 0; i < VLC_META_TYPE_COUNT; i++ )
     {
-        if( src->ppsz_meta[i] )
+        if( src->ppsz_meta[i] && src->ppsz_meta[i] != dst->ppsz_meta[i] )
         {
-            free( dst->ppsz_meta[i] );
-            dst->ppsz_meta[i] = strdup( src->ppsz_meta[i] );
+            vlc_meta_Clear( dst, i );
+            dst->ppsz_meta[i] = vlc_meta_IsInterned( i )
+                              ? vlc_meta_StringHold( src->ppsz_meta[i] )
+                              : strdup( src->ppsz_meta[i] );
         }
     }
 
@@ -171,6 +171,11 @@ struct vlc_player_t
     bool releasing_media;
     bool next_media_requested;
     input_item_t *next_media;
+    /* Delay before the end of the current media when the next one is
+     * prepared, 0 if only done once the current media stopped */
+    vlc_tick_t next_media_preload;
+    /* Amount of data of the next media read ahead, 0 to not open it */
+    size_t next_media_prefetch;
 
     enum vlc_player_state global_state;
     bool started;
@@ -723,6 +728,46 @@ vlc_player_PrepareNextMedia(vlc_player_t *player)
     player->next_media_requested = true;
 }
 
+static void
+vlc_player_PreloadNextMedia(vlc_player_t *player,
+                            struct vlc_player_input *input)
+{
+    vlc_player_assert_locked(player);
+
+    if (player->next_media_preload == 0 || input != player->input
+     || player->next_media_requested
+     || input->length == VLC_TICK_INVALID || input->length <= 0
+     || input->length - input->time > player->next_media_preload)
+        return;
+
+    /* Request the next media before the end of the current one. This is only
+     * a prefetch: its demux and decoders are still created by the next input
+     * once the current one stopped. */
+    vlc_player_PrepareNextMedia(player);
+    input_item_t *media = player->next_media;
+    if (media == NULL)
+        return;
+
+    /* Open its access, and buffer its first data, so that the next input
+     * does not wait for the connection setup. The options of the media
+     * apply to the input object only, so it would be opened with the wrong
+     * settings if it has any. */
+    vlc_mutex_lock(&media->lock);
+    bool has_options = media->i_options > 0;
+    vlc_mutex_unlock(&media->lock);
+
+    if (player->next_media_prefetch > 0 && !has_options)
+    {
+        char *url = input_item_GetURI(media);
+        if (url != NULL)
+        {
+            input_resource_PrefetchAccess(player->resource, url,
+                                          player->next_media_prefetch);
+            free(url);
+        }
+    }
+}
+
 static int
 vlc_player_OpenNextMedia(vlc_player_t *player)
 {
@@ -1917,6 +1962,7 @@ input_thread_Events(input_thread_t *input_thread,
                 vlc_player_SendEvent(player, on_position_changed,
                                      input->time,
                                      input->position);
+                vlc_player_PreloadNextMedia(player, input);
 
                 if (input->abloop_state[0].set && input->abloop_state[1].set
                  && input == player->input)
@@ -3511,6 +3557,10 @@ vlc_player_New(vlc_object_t *parent,
     player->releasing_media = false;
     player->next_media_requested = false;
     player->next_media = NULL;
+    player->next_media_preload =
+        VLC_TICK_FROM_MS(var_InheritInteger(player, "next-media-preload"));
+    player->next_media_prefetch =
+        var_InheritInteger(player, "next-media-prefetch") << 10;
 
 #define VAR_CREATE(var, flag) do { \
     if (var_Create(player, var, flag) != VLC_SUCCESS) \
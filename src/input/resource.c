@@ -28,6 +28,7 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
 
 #include <vlc_common.h>
 #include <vlc_atomic.h>
@@ -35,6 +36,7 @@
 #include <vlc_spu.h>
 #include <vlc_aout.h>
 #include <vlc_sout.h>
+#include <vlc_interrupt.h>
 #include "../libvlc.h"
 #include "../stream_output/stream_output.h"
 #include "../audio_output/aout_internal.h"
@@ -42,6 +44,7 @@
 #include "input_interface.h"
 #include "event.h"
 #include "resource.h"
+#include "stream.h"
 
 struct input_resource_t
 {
@@ -73,6 +76,9 @@ struct input_resource_t
 
     bool            b_aout_busy;
     audio_output_t *p_aout;
+
+    /* Access of the next media, opened ahead of time */
+    struct input_prefetch *p_prefetch;
 };
 
 /* */
@@ -321,6 +327,146 @@ void input_resource_ResetAout( input_resource_t *p_resource )
         aout_Destroy( p_aout );
 }
 
+/* Prefetch */
+struct input_prefetch
+{
+    vlc_thread_t     thread;
+    vlc_interrupt_t *interrupt;
+    vlc_object_t    *parent;
+    size_t           size;
+    stream_t        *stream; /* written by the thread until joined */
+    char             url[];
+};
+
+static void *PrefetchThread( void *data )
+{
+    struct input_prefetch *prefetch = data;
+
+    vlc_interrupt_set( prefetch->interrupt );
+
+    stream_t *s = stream_AccessNew( prefetch->parent, NULL, NULL, false,
+                                    prefetch->url );
+    if( s != NULL && s->pf_read == NULL && s->pf_block == NULL )
+    {   /* directory: nothing to read ahead */
+        vlc_stream_Delete( s );
+        s = NULL;
+    }
+
+    if( s != NULL && prefetch->size > 0 )
+    {   /* Buffer the beginning of the data, to be read by the demux probes */
+        const uint8_t *peek;
+        if( vlc_stream_Peek( s, &peek, prefetch->size ) < 0 )
+            msg_Dbg( prefetch->parent, "cannot prefetch %s", prefetch->url );
+    }
+
+    prefetch->stream = s;
+    return NULL;
+}
+
+static void PrefetchKill( void *data )
+{
+    vlc_interrupt_kill( data );
+}
+
+static stream_t *PrefetchJoin( struct input_prefetch *prefetch )
+{
+    /* an interrupted caller does not wait for the open to complete */
+    vlc_interrupt_register( PrefetchKill, prefetch->interrupt );
+    vlc_join( prefetch->thread, NULL );
+    int ret = vlc_interrupt_unregister();
+    vlc_interrupt_destroy( prefetch->interrupt );
+
+    stream_t *s = prefetch->stream;
+    free( prefetch );
+    if( s != NULL && ret == EINTR )
+    {
+        vlc_stream_Delete( s );
+        s = NULL;
+    }
+    return s;
+}
+
+static void PrefetchCancel( struct input_prefetch *prefetch )
+{
+    if( prefetch == NULL )
+        return;
+
+    vlc_interrupt_kill( prefetch->interrupt );
+    stream_t *s = PrefetchJoin( prefetch );
+    if( s != NULL )
+        vlc_stream_Delete( s );
+}
+
+void input_resource_PrefetchAccess( input_resource_t *p_resource,
+                                    const char *psz_url, size_t i_size )
+{
+    vlc_mutex_lock( &p_resource->lock );
+    struct input_prefetch *old = p_resource->p_prefetch;
+    if( old != NULL && !strcmp( old->url, psz_url ) )
+    {   /* already opening or opened */
+        vlc_mutex_unlock( &p_resource->lock );
+        return;
+    }
+    p_resource->p_prefetch = NULL;
+    vlc_mutex_unlock( &p_resource->lock );
+
+    PrefetchCancel( old );
+
+    size_t len = strlen( psz_url ) + 1;
+    struct input_prefetch *prefetch = malloc( sizeof(*prefetch) + len );
+    if( unlikely(prefetch == NULL) )
+        return;
+
+    prefetch->interrupt = vlc_interrupt_create();
+    if( unlikely(prefetch->interrupt == NULL) )
+    {
+        free( prefetch );
+        return;
+    }
+    prefetch->parent = p_resource->p_parent;
+    prefetch->size = i_size;
+    prefetch->stream = NULL;
+    memcpy( prefetch->url, psz_url, len );
+
+    if( vlc_clone( &prefetch->thread, PrefetchThread, prefetch,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_interrupt_destroy( prefetch->interrupt );
+        free( prefetch );
+        return;
+    }
+    msg_Dbg( p_resource->p_parent, "prefetching %s", psz_url );
+
+    vlc_mutex_lock( &p_resource->lock );
+    old = p_resource->p_prefetch;
+    p_resource->p_prefetch = prefetch;
+    vlc_mutex_unlock( &p_resource->lock );
+
+    /* in case of concurrent prefetch requests, the last one wins */
+    PrefetchCancel( old );
+}
+
+stream_t *input_resource_TakeAccess( input_resource_t *p_resource,
+                                     const char *psz_url )
+{
+    vlc_mutex_lock( &p_resource->lock );
+    struct input_prefetch *prefetch = p_resource->p_prefetch;
+    if( prefetch != NULL && !strcmp( prefetch->url, psz_url ) )
+        p_resource->p_prefetch = NULL;
+    else
+        prefetch = NULL;
+    vlc_mutex_unlock( &p_resource->lock );
+
+    if( prefetch == NULL )
+        return NULL;
+
+    /* wait for the access to be opened, rather than opening it again */
+    stream_t *s = PrefetchJoin( prefetch );
+    if( s != NULL )
+        msg_Dbg( p_resource->p_parent, "using prefetched %s", psz_url );
+    return s;
+}
+
 /* Common */
 input_resource_t *input_resource_New( vlc_object_t *p_parent )
 {
@@ -340,6 +486,7 @@ void input_resource_Release( input_resource_t *p_resource )
     if( !vlc_atomic_rc_dec( &p_resource->rc ) )
         return;
 
+    PrefetchCancel( p_resource->p_prefetch );
     DestroySout( p_resource );
     DestroyVout( p_resource );
     if( p_resource->p_aout != NULL )
@@ -493,6 +640,12 @@ void input_resource_TerminateSout( input_resource_t *p_resource )
 
 void input_resource_Terminate( input_resource_t *p_resource )
 {
+    vlc_mutex_lock( &p_resource->lock );
+    struct input_prefetch *prefetch = p_resource->p_prefetch;
+    p_resource->p_prefetch = NULL;
+    vlc_mutex_unlock( &p_resource->lock );
+    PrefetchCancel( prefetch );
+
     input_resource_TerminateSout( p_resource );
     input_resource_ResetAout( p_resource );
     input_resource_TerminateVout( p_resource );
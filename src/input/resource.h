@@ -55,6 +55,30 @@ vout_thread_t *input_resource_HoldVout( input_resource_t * );
  */
 void input_resource_HoldVouts( input_resource_t *, vout_thread_t ***, size_t * );
 
+/**
+ * This function opens the access of a media ahead of time, in the
+ * background, and reads up to the given amount of data from it.
+ *
+ * Only one access is kept: any other one is closed, unless it was taken.
+ */
+void input_resource_PrefetchAccess( input_resource_t *, const char *psz_url,
+                                    size_t i_size );
+
+/**
+ * This function returns the access opened by input_resource_PrefetchAccess()
+ * if the URL matches, waiting for it to be opened if needed.
+ *
+ * The caller must bind it to its input with stream_AccessSetInput(), and
+ * owns it.
+ *
+ * If the calling thread is interrupted while the access is being opened,
+ * the prefetch is killed and abandoned.
+ *
+ * \return the access stream, or NULL if none (no matching prefetch,
+ * failure to open it, or interruption)
+ */
+stream_t *input_resource_TakeAccess( input_resource_t *, const char *psz_url );
+
 /**
  * This function releases all resources (object).
  */
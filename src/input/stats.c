@@ -24,10 +24,12 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <vlc_common.h>
+#include <vlc_memstats.h>
 #include "input/input_internal.h"
 
 /**
@@ -67,6 +69,11 @@ struct input_stats *input_stats_Create(void)
     atomic_init(&stats->lost_abuffers, 0);
     atomic_init(&stats->displayed_pictures, 0);
     atomic_init(&stats->lost_pictures, 0);
+    for (size_t i = 0; i < INPUT_LATENCY_COUNT; i++)
+    {
+        vlc_histogram_Init(&stats->video_latency[i]);
+        vlc_histogram_Init(&stats->audio_latency[i]);
+    }
     return stats;
 }
 
@@ -77,6 +84,19 @@ void input_stats_Destroy(struct input_stats *stats)
     free(stats);
 }
 
+static_assert(INPUT_LATENCY_BUCKETS == VLC_HISTOGRAM_BUCKETS,
+              "Mismatched latency histogram size");
+
+static void stats_GetLatency(struct vlc_histogram *h, input_latency_t *lat)
+{
+    lat->i_count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    lat->i_total = atomic_load_explicit(&h->total, memory_order_relaxed);
+    lat->i_max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    for (size_t i = 0; i < INPUT_LATENCY_BUCKETS; i++)
+        lat->i_buckets[i] = atomic_load_explicit(&h->buckets[i],
+                                                 memory_order_relaxed);
+}
+
 void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
 {
     /* Input */
@@ -110,6 +130,20 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
                                                     memory_order_relaxed);
     st->i_lost_pictures = atomic_load_explicit(&stats->lost_pictures,
                                                memory_order_relaxed);
+
+    /* Memory */
+    st->i_fifo_bytes = vlc_memstats_Get(VLC_MEMSTATS_FIFO);
+    st->i_picture_pool_bytes = vlc_memstats_Get(VLC_MEMSTATS_PICTURE_POOL);
+    st->i_timeshift_bytes = vlc_memstats_Get(VLC_MEMSTATS_TIMESHIFT);
+    st->i_adaptive_bytes = vlc_memstats_Get(VLC_MEMSTATS_ADAPTIVE);
+    st->i_httpd_bytes = vlc_memstats_Get(VLC_MEMSTATS_HTTPD);
+
+    /* Latencies */
+    for (size_t i = 0; i < INPUT_LATENCY_COUNT; i++)
+    {
+        stats_GetLatency(&stats->video_latency[i], &st->video_latency[i]);
+        stats_GetLatency(&stats->audio_latency[i], &st->audio_latency[i]);
+    }
 }
 
 /** Update a counter element with new values
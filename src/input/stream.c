@@ -703,9 +703,57 @@ int vlc_stream_vaControl(stream_t *s, int cmd, va_list args)
     return s->pf_control(s, cmd, args);
 }
 
+/* Payloads smaller than that are copied rather than shared */
+#define STREAM_SHARE_MIN 4096
+
+/**
+ * Returns the next bytes of the stream as a reference to the stream buffer.
+ *
+ * This only succeeds if the payload is contiguous in the peek buffer, or in
+ * the last block from the underlying stream, otherwise NULL is returned and
+ * the stream is left untouched.
+ */
+static block_t *vlc_stream_ShareBlock(stream_t *s, size_t size)
+{
+    stream_priv_t *priv = (stream_priv_t *)s;
+    block_t **pp = (priv->peek != NULL) ? &priv->peek : &priv->block;
+
+    if (size < STREAM_SHARE_MIN)
+        return NULL;
+
+    if (*pp == NULL && s->pf_block != NULL && !priv->eof && !vlc_killed())
+    {
+        bool eof = false;
+
+        *pp = s->pf_block(s, &eof);
+    }
+
+    if (*pp == NULL || (*pp)->i_buffer < size)
+        return NULL;
+
+    block_t *block = block_Share(pp);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    /* Only the payload is shared, not the properties of the stream buffer */
+    block->i_buffer = size;
+    block->i_flags = 0;
+    block->i_nb_samples = 0;
+    block->i_pts = block->i_dts = VLC_TICK_INVALID;
+    block->i_length = 0;
+
+    vlc_stream_CopyBlock(pp, NULL, size);
+    priv->offset += size;
+    return block;
+}
+
 /**
  * Read data into a block.
  *
+ * If the data is already buffered by the stream, the returned block may
+ * reference the stream buffer rather than a copy of it. The stream never
+ * reads those bytes again, so the payload can still be modified in place.
+ *
  * @param s stream to read data from
  * @param size number of bytes to read
  * @return a block of data, or NULL on error
@@ -717,7 +765,11 @@ block_t *vlc_stream_Block( stream_t *s, size_t size )
     if( unlikely(size > SSIZE_MAX) )
         return NULL;
 
-    block_t *block = block_Alloc( size );
+    block_t *block = vlc_stream_ShareBlock( s, size );
+    if( block != NULL )
+        return block;
+
+    block = block_Alloc( size );
     if( unlikely(block == NULL) )
         return NULL;
 
@@ -44,6 +44,16 @@ stream_t *vlc_stream_AttachmentNew(vlc_object_t *p_this,
 stream_t *stream_AccessNew(vlc_object_t *, input_thread_t *, es_out_t *, bool,
                            const char *);
 
+/**
+ * Binds a raw stream, created by stream_AccessNew() without input, to an
+ * input thread.
+ *
+ * The stream must have been returned by stream_AccessNew(), and must be a
+ * byte or block stream (not a directory). Its stream filters, if any, are
+ * bound as well.
+ */
+void stream_AccessSetInput(stream_t *, input_thread_t *);
+
 /**
  * Probes stream filters automatically.
  *
@@ -264,7 +264,8 @@ vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t* parent)
     thumbnailer->parent = parent;
     struct background_worker_config cfg = {
         .default_timeout = -1,
-        .max_threads = 1,
+        .max_threads = var_InheritInteger( parent, "thumbnailer-threads" ),
+        .priority = VLC_EXECUTOR_PRIORITY_HIGH,
         .pf_release = thumbnailer_request_Release,
         .pf_hold = thumbnailer_request_Hold,
         .pf_start = thumbnailer_request_Start,
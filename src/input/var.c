@@ -759,6 +759,7 @@ void input_ConfigVarInit ( input_thread_t *p_input )
         var_Create( p_input, "sout-video", VLC_VAR_BOOL | VLC_VAR_DOINHERIT );
         var_Create( p_input, "sout-spu", VLC_VAR_BOOL | VLC_VAR_DOINHERIT );
         var_Create( p_input, "sout-keep",  VLC_VAR_BOOL | VLC_VAR_DOINHERIT );
+        var_Create( p_input, "sout-offline", VLC_VAR_BOOL | VLC_VAR_DOINHERIT );
 
         var_Create( p_input, "input-repeat",
                     VLC_VAR_INTEGER|VLC_VAR_DOINHERIT );
@@ -804,6 +805,11 @@ void input_ConfigVarInit ( input_thread_t *p_input )
 
     /* Inherited by demux/subtitle.c */
     var_Create( p_input, "sub-original-fps", VLC_VAR_FLOAT );
+
+    /* Inherited by demuxers, thumbnails only need to start decoding */
+    var_Create( p_input, "demux-headers-only", VLC_VAR_BOOL | VLC_VAR_DOINHERIT );
+    if( input_priv(p_input)->b_thumbnailing )
+        var_SetBool( p_input, "demux-headers-only", true );
 }
 
 /*****************************************************************************
@@ -47,6 +47,7 @@
 #include <vlc_vod.h>
 #include <vlc_sout.h>
 #include <vlc_url.h>
+#include <vlc_memstream.h>
 #include "../stream_output/stream_output.h"
 #include "../libvlc.h"
 
@@ -148,6 +149,7 @@ vlm_t *vlm_New( libvlc_int_t *libvlc, const char *psz_vlmconf )
     p_vlm->input_state_changed = false;
     p_vlm->i_id = 1;
     TAB_INIT( p_vlm->i_media, p_vlm->media );
+    TAB_INIT( p_vlm->i_source, p_vlm->source );
     TAB_INIT( p_vlm->i_schedule, p_vlm->schedule );
     p_vlm->p_vod = NULL;
     var_Create( p_vlm, "intf-event", VLC_VAR_ADDRESS );
@@ -211,6 +213,7 @@ void vlm_Delete( vlm_t *p_vlm )
     vlc_mutex_lock( &p_vlm->lock );
     vlm_ControlInternal( p_vlm, VLM_CLEAR_MEDIAS );
     TAB_CLEAN( p_vlm->i_media, p_vlm->media );
+    assert( p_vlm->i_source == 0 );
 
     vlm_ControlInternal( p_vlm, VLM_CLEAR_SCHEDULES );
     TAB_CLEAN( p_vlm->i_schedule, p_vlm->schedule );
@@ -860,6 +863,374 @@ static int vlm_ControlMediaGetId( vlm_t *p_vlm, const char *psz_name, int64_t *p
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Shared inputs: broadcast instances with the same input and options are
+ * fed by a single input thread, whose "share" stream output duplicates the
+ * elementary streams to one stream output instance per broadcast.
+ *****************************************************************************/
+struct vlm_output_t
+{
+    vlm_media_sys_t          *p_media;
+    vlm_media_instance_sys_t *p_instance;
+    sout_instance_t          *p_sout;
+
+    /* one sout input per source ES (NULL if the output refused it) */
+    int                      i_id;
+    sout_packetizer_input_t  **id;
+};
+
+struct vlm_source_t
+{
+    char              *psz_key; /* input URI and options */
+    bool              b_started;
+
+    vlc_object_t      *p_parent;
+    input_item_t      *p_item;
+    input_thread_t    *p_input;
+    input_resource_t  *p_input_resource;
+    sout_share_data_t share;
+
+    /* protects the ES and outputs against the input thread */
+    vlc_mutex_t       lock;
+    int               i_es;
+    es_format_t       **es;
+    int               i_output;
+    vlm_output_t      **output;
+};
+
+static void *SourceAdd( void *opaque, const es_format_t *p_fmt )
+{
+    vlm_source_t *p_source = opaque;
+    es_format_t *p_es = malloc( sizeof( *p_es ) );
+
+    if( unlikely(p_es == NULL) )
+        return NULL;
+    es_format_Copy( p_es, p_fmt );
+
+    vlc_mutex_lock( &p_source->lock );
+    TAB_APPEND( p_source->i_es, p_source->es, p_es );
+    for( int i = 0; i < p_source->i_output; i++ )
+    {
+        vlm_output_t *p_output = p_source->output[i];
+
+        TAB_APPEND( p_output->i_id, p_output->id,
+                    sout_InputNew( p_output->p_sout, p_es ) );
+    }
+    vlc_mutex_unlock( &p_source->lock );
+
+    return p_es;
+}
+
+static void SourceDel( void *opaque, void *id )
+{
+    vlm_source_t *p_source = opaque;
+    es_format_t *p_es = id;
+    int i_es;
+
+    vlc_mutex_lock( &p_source->lock );
+    TAB_FIND( p_source->i_es, p_source->es, p_es, i_es );
+    assert( i_es >= 0 );
+    for( int i = 0; i < p_source->i_output; i++ )
+    {
+        vlm_output_t *p_output = p_source->output[i];
+
+        if( p_output->id[i_es] != NULL )
+            sout_InputDelete( p_output->id[i_es] );
+        TAB_ERASE( p_output->i_id, p_output->id, i_es );
+    }
+    TAB_ERASE( p_source->i_es, p_source->es, i_es );
+    vlc_mutex_unlock( &p_source->lock );
+
+    es_format_Clean( p_es );
+    free( p_es );
+}
+
+static int SourceSend( void *opaque, void *id, block_t *p_chain )
+{
+    vlm_source_t *p_source = opaque;
+    int i_es;
+
+    vlc_mutex_lock( &p_source->lock );
+    TAB_FIND( p_source->i_es, p_source->es, (es_format_t *)id, i_es );
+    assert( i_es >= 0 );
+
+    while( p_chain != NULL )
+    {
+        block_t *p_block = p_chain;
+        sout_packetizer_input_t *p_last = NULL;
+
+        p_chain = p_chain->p_next;
+        p_block->p_next = NULL;
+
+        /* The last output gets the original block */
+        for( int i = 0; i < p_source->i_output; i++ )
+        {
+            sout_packetizer_input_t *p_id = p_source->output[i]->id[i_es];
+            if( p_id == NULL )
+                continue;
+
+            if( p_last != NULL )
+            {
+                block_t *p_dup = block_Duplicate( p_block );
+                if( likely(p_dup != NULL) )
+                    sout_InputSendBuffer( p_last, p_dup );
+            }
+            p_last = p_id;
+        }
+
+        if( p_last != NULL )
+            sout_InputSendBuffer( p_last, p_block );
+        else
+            block_Release( p_block );
+    }
+    vlc_mutex_unlock( &p_source->lock );
+
+    return VLC_SUCCESS;
+}
+
+static int SourceEvent( vlc_object_t *p_this, char const *psz_cmd,
+                        vlc_value_t oldval, vlc_value_t newval,
+                        void *p_data )
+{
+    VLC_UNUSED(psz_cmd);
+    VLC_UNUSED(oldval);
+    input_thread_t *p_input = (input_thread_t *)p_this;
+    vlm_t *p_vlm = libvlc_priv( vlc_object_instance(p_input) )->p_vlm;
+    assert( p_vlm );
+    vlm_source_t *p_source = p_data;
+
+    if( newval.i_int == INPUT_EVENT_STATE )
+    {
+        int state = var_GetInteger( p_input, "state" );
+
+        vlc_mutex_lock( &p_source->lock );
+        for( int i = 0; i < p_source->i_output; i++ )
+        {
+            vlm_output_t *p_output = p_source->output[i];
+
+            vlm_SendEventMediaInstanceState( p_vlm, p_output->p_media->cfg.id,
+                                             p_output->p_media->cfg.psz_name,
+                                             p_output->p_instance->psz_name,
+                                             state );
+        }
+        vlc_mutex_unlock( &p_source->lock );
+
+        vlc_mutex_lock( &p_vlm->lock_manage );
+        p_vlm->input_state_changed = true;
+        vlc_cond_signal( &p_vlm->wait_manage );
+        vlc_mutex_unlock( &p_vlm->lock_manage );
+    }
+    return VLC_SUCCESS;
+}
+
+static void vlm_SourceDelete( vlm_t *p_vlm, vlm_source_t *p_source )
+{
+    assert( p_source->i_output == 0 );
+
+    if( p_source->p_input != NULL )
+    {
+        var_DelCallback( p_source->p_input, "intf-event", SourceEvent,
+                         p_source );
+        if( p_source->b_started )
+            input_Stop( p_source->p_input );
+        input_Close( p_source->p_input );
+    }
+    /* This destroys the share stream output */
+    input_resource_Terminate( p_source->p_input_resource );
+    input_resource_Release( p_source->p_input_resource );
+    assert( p_source->i_es == 0 );
+
+    TAB_REMOVE( p_vlm->i_source, p_vlm->source, p_source );
+    input_item_Release( p_source->p_item );
+    vlc_object_delete( p_source->p_parent );
+    vlc_mutex_destroy( &p_source->lock );
+    free( p_source->psz_key );
+    free( p_source );
+}
+
+/* Finds a running source for that input and those options, or creates a
+ * new one, not started yet */
+static vlm_source_t *vlm_SourceGet( vlm_t *p_vlm, vlm_media_sys_t *p_media,
+                                    const char *psz_uri )
+{
+    vlm_media_t *p_cfg = &p_media->cfg;
+    struct vlc_memstream key;
+
+    vlc_memstream_open( &key );
+    vlc_memstream_puts( &key, psz_uri );
+    for( int i = 0; i < p_cfg->i_option; i++ )
+        vlc_memstream_printf( &key, "\n%s", p_cfg->ppsz_option[i] );
+    if( vlc_memstream_close( &key ) )
+        return NULL;
+
+    for( int i = 0; i < p_vlm->i_source; i++ )
+    {
+        vlm_source_t *p_source = p_vlm->source[i];
+
+        if( strcmp( p_source->psz_key, key.ptr ) )
+            continue;
+
+        /* Instances moving on from an ended input need a new one */
+        int state = var_GetInteger( p_source->p_input, "state" );
+        if( state != END_S && state != ERROR_S )
+        {
+            free( key.ptr );
+            return p_source;
+        }
+    }
+
+    vlm_source_t *p_source = malloc( sizeof( *p_source ) );
+    if( unlikely(p_source == NULL) )
+    {
+        free( key.ptr );
+        return NULL;
+    }
+
+    p_source->psz_key = key.ptr;
+    p_source->b_started = false;
+    p_source->share.opaque = p_source;
+    p_source->share.add = SourceAdd;
+    p_source->share.del = SourceDel;
+    p_source->share.send = SourceSend;
+    vlc_mutex_init( &p_source->lock );
+    TAB_INIT( p_source->i_es, p_source->es );
+    TAB_INIT( p_source->i_output, p_source->output );
+
+    p_source->p_parent = vlc_object_create( p_vlm, sizeof (vlc_object_t) );
+    var_Create( p_source->p_parent, "sout-share-data", VLC_VAR_ADDRESS );
+    var_SetAddress( p_source->p_parent, "sout-share-data", &p_source->share );
+
+    p_source->p_item = input_item_New( psz_uri, p_cfg->psz_name );
+    input_item_AddOption( p_source->p_item, "sout=#share",
+                          VLC_INPUT_OPTION_TRUSTED );
+    for( int i = 0; i < p_cfg->i_option; i++ )
+        if( strcmp( p_cfg->ppsz_option[i], "sout-keep" )
+         && strcmp( p_cfg->ppsz_option[i], "nosout-keep" )
+         && strcmp( p_cfg->ppsz_option[i], "no-sout-keep" ) )
+            input_item_AddOption( p_source->p_item, p_cfg->ppsz_option[i],
+                                  VLC_INPUT_OPTION_TRUSTED );
+
+    p_source->p_input_resource = input_resource_New( p_source->p_parent );
+    p_source->p_input = input_Create( p_source->p_parent,
+                                      input_LegacyEvents, NULL,
+                                      p_source->p_item,
+                                      p_source->p_input_resource, NULL );
+    TAB_APPEND( p_vlm->i_source, p_vlm->source, p_source );
+    if( p_source->p_input == NULL )
+    {
+        vlm_SourceDelete( p_vlm, p_source );
+        return NULL;
+    }
+
+    input_LegacyVarInit( p_source->p_input );
+    var_AddCallback( p_source->p_input, "intf-event", SourceEvent, p_source );
+    msg_Dbg( p_vlm, "new shared input %s", psz_uri );
+    return p_source;
+}
+
+static vlm_output_t *vlm_SourceAttach( vlm_source_t *p_source,
+                                       vlm_media_sys_t *p_media,
+                                       vlm_media_instance_sys_t *p_instance )
+{
+    vlm_output_t *p_output = malloc( sizeof( *p_output ) );
+    if( unlikely(p_output == NULL) )
+        return NULL;
+
+    p_output->p_media = p_media;
+    p_output->p_instance = p_instance;
+    TAB_INIT( p_output->i_id, p_output->id );
+    p_output->p_sout = sout_NewInstance( p_instance->p_parent,
+                                         p_media->cfg.psz_output );
+    if( p_output->p_sout == NULL )
+    {
+        free( p_output );
+        return NULL;
+    }
+
+    /* Join the ES already running */
+    vlc_mutex_lock( &p_source->lock );
+    for( int i = 0; i < p_source->i_es; i++ )
+        TAB_APPEND( p_output->i_id, p_output->id,
+                    sout_InputNew( p_output->p_sout, p_source->es[i] ) );
+    TAB_APPEND( p_source->i_output, p_source->output, p_output );
+    vlc_mutex_unlock( &p_source->lock );
+
+    return p_output;
+}
+
+static void vlm_SourceDetach( vlm_t *p_vlm, vlm_source_t *p_source,
+                              vlm_output_t *p_output )
+{
+    /* Once removed, the input thread cannot reach the output anymore */
+    vlc_mutex_lock( &p_source->lock );
+    TAB_REMOVE( p_source->i_output, p_source->output, p_output );
+    vlc_mutex_unlock( &p_source->lock );
+
+    for( int i = 0; i < p_output->i_id; i++ )
+        if( p_output->id[i] != NULL )
+            sout_InputDelete( p_output->id[i] );
+    TAB_CLEAN( p_output->i_id, p_output->id );
+    sout_DeleteInstance( p_output->p_sout );
+    free( p_output );
+
+    if( p_source->i_output == 0 )
+        vlm_SourceDelete( p_vlm, p_source );
+}
+
+/* Feeds a broadcast instance from a shared input */
+static int vlm_MediaInstanceShare( vlm_t *p_vlm, vlm_media_sys_t *p_media,
+                                   vlm_media_instance_sys_t *p_instance )
+{
+    char *psz_uri = input_item_GetURI( p_instance->p_item );
+    if( unlikely(psz_uri == NULL) )
+        return VLC_ENOMEM;
+
+    vlm_source_t *p_source = vlm_SourceGet( p_vlm, p_media, psz_uri );
+    free( psz_uri );
+    if( p_source == NULL )
+        return VLC_EGENERIC;
+
+    vlm_output_t *p_output = vlm_SourceAttach( p_source, p_media, p_instance );
+    if( p_output == NULL )
+    {
+        if( p_source->i_output == 0 )
+            vlm_SourceDelete( p_vlm, p_source );
+        return VLC_EGENERIC;
+    }
+
+    if( !p_source->b_started )
+    {
+        if( input_Start( p_source->p_input ) != VLC_SUCCESS )
+        {
+            vlm_SourceDetach( p_vlm, p_source, p_output );
+            return VLC_EGENERIC;
+        }
+        p_source->b_started = true;
+    }
+
+    p_instance->p_source = p_source;
+    p_instance->p_output = p_output;
+    p_instance->p_input = p_source->p_input;
+    return VLC_SUCCESS;
+}
+
+static void vlm_MediaInstanceStopInput( vlm_t *p_vlm,
+                                        vlm_media_instance_sys_t *p_instance )
+{
+    if( p_instance->p_source != NULL )
+    {
+        vlm_SourceDetach( p_vlm, p_instance->p_source, p_instance->p_output );
+        p_instance->p_source = NULL;
+        p_instance->p_output = NULL;
+    }
+    else
+    {
+        input_Stop( p_instance->p_input );
+        input_Close( p_instance->p_input );
+    }
+    p_instance->p_input = NULL;
+}
+
 static vlm_media_instance_sys_t *vlm_ControlMediaInstanceGetByName( vlm_media_sys_t *p_media, const char *psz_id )
 {
     for( int i = 0; i < p_media->i_instance; i++ )
@@ -889,16 +1260,16 @@ static vlm_media_instance_sys_t *vlm_MediaInstanceNew( vlm_media_sys_t *p_media,
     p_instance->p_parent = vlc_object_create( p_media, sizeof (vlc_object_t) );
     p_instance->p_input = NULL;
     p_instance->p_input_resource = input_resource_New( p_instance->p_parent );
+    p_instance->p_source = NULL;
+    p_instance->p_output = NULL;
 
     return p_instance;
 }
 static void vlm_MediaInstanceDelete( vlm_t *p_vlm, int64_t id, vlm_media_instance_sys_t *p_instance, vlm_media_sys_t *p_media )
 {
-    input_thread_t *p_input = p_instance->p_input;
-    if( p_input )
+    if( p_instance->p_input )
     {
-        input_Stop( p_input );
-        input_Close( p_input );
+        vlm_MediaInstanceStopInput( p_vlm, p_instance );
 
         vlm_SendEventMediaInstanceStopped( p_vlm, id, p_media->cfg.psz_name );
     }
@@ -979,13 +1350,12 @@ static int vlm_ControlMediaInstanceStart( vlm_t *p_vlm, int64_t id, const char *
         if( p_instance->i_index == i_input_index )
         {
             int state = var_GetInteger( p_input, "state" );
-            if( state == PAUSE_S )
+            if( state == PAUSE_S && p_instance->p_source == NULL )
                 var_SetInteger( p_input, "state",  PLAYING_S );
             return VLC_SUCCESS;
         }
 
-        input_Stop( p_input );
-        input_Close( p_input );
+        vlm_MediaInstanceStopInput( p_vlm, p_instance );
 
         if( !p_instance->b_sout_keep )
             input_resource_TerminateSout( p_instance->p_input_resource );
@@ -1006,11 +1376,20 @@ static int vlm_ControlMediaInstanceStart( vlm_t *p_vlm, int64_t id, const char *
     else
         input_item_SetURI( p_instance->p_item, p_media->cfg.ppsz_input[p_instance->i_index] ) ;
 
-    p_instance->p_input = input_Create( p_instance->p_parent,
-                                        input_LegacyEvents, NULL,
-                                        p_instance->p_item,
-                                        p_instance->p_input_resource, NULL );
-    if( p_instance->p_input )
+    if( !p_media->cfg.b_vod && p_media->cfg.psz_output != NULL
+     && var_InheritBool( p_vlm, "vlm-share-inputs" ) )
+    {
+        if( vlm_MediaInstanceShare( p_vlm, p_media, p_instance ) )
+            msg_Err( p_vlm, "cannot share input %s",
+                     p_media->cfg.ppsz_input[p_instance->i_index] );
+    }
+    else
+        p_instance->p_input = input_Create( p_instance->p_parent,
+                                            input_LegacyEvents, NULL,
+                                            p_instance->p_item,
+                                            p_instance->p_input_resource,
+                                            NULL );
+    if( p_instance->p_input && p_instance->p_source == NULL )
     {
         input_LegacyVarInit( p_instance->p_input );
         var_AddCallback( p_instance->p_input, "intf-event", InputEvent, p_media );
@@ -1064,6 +1443,10 @@ static int vlm_ControlMediaInstancePause( vlm_t *p_vlm, int64_t id, const char *
     if( !p_instance || !p_instance->p_input )
         return VLC_EGENERIC;
 
+    /* A shared input is never paused on behalf of one of its outputs */
+    if( p_instance->p_source != NULL )
+        return VLC_EGENERIC;
+
     /* Toggle pause state */
     i_state = var_GetInteger( p_instance->p_input, "state" );
     if( i_state == PAUSE_S && !p_media->cfg.b_vod )
@@ -1099,7 +1482,7 @@ static int vlm_ControlMediaInstanceSetTimePosition( vlm_t *p_vlm, int64_t id, co
         return VLC_EGENERIC;
 
     p_instance = vlm_ControlMediaInstanceGetByName( p_media, psz_id );
-    if( !p_instance || !p_instance->p_input )
+    if( !p_instance || !p_instance->p_input || p_instance->p_source != NULL )
         return VLC_EGENERIC;
 
     if( i_time >= 0 )
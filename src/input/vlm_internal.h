@@ -27,6 +27,9 @@
 #include "input_interface.h"
 
 /* Private */
+typedef struct vlm_source_t vlm_source_t;
+typedef struct vlm_output_t vlm_output_t;
+
 typedef struct
 {
     /* instance name */
@@ -42,6 +45,10 @@ typedef struct
     input_thread_t    *p_input;
     input_resource_t *p_input_resource;
 
+    /* shared input (p_input then belongs to the source) */
+    vlm_source_t      *p_source;
+    vlm_output_t      *p_output;
+
 } vlm_media_instance_sys_t;
 
 
@@ -103,6 +110,10 @@ struct vlm_t
     int                i_media;
     vlm_media_sys_t    **media;
 
+    /* Inputs shared between broadcast instances */
+    int            i_source;
+    vlm_source_t   **source;
+
     /* Schedule list */
     int            i_schedule;
     vlm_schedule_sys_t **schedule;
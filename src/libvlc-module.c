@@ -89,6 +89,22 @@ static const char *const ppsz_snap_formats[] =
     "This is the verbosity level (0=only errors and " \
     "standard messages, 1=warnings, 2=debug).")
 
+#define LOG_ASYNC_TEXT N_("Asynchronous logging")
+#define LOG_ASYNC_LONGTEXT N_( \
+    "Write log messages from a separate thread, so that threads emitting " \
+    "them do not wait for the logger output.")
+
+#define LOG_RATE_TEXT N_("Debug messages rate limit")
+#define LOG_RATE_LONGTEXT N_( \
+    "Maximum number of debug messages per second and per object with " \
+    "asynchronous logging. Further messages are dropped and counted " \
+    "(0 = unlimited).")
+
+#define TRACER_TEXT N_("Tracer module")
+#define TRACER_LONGTEXT N_( \
+    "Record timestamped events about the playback pipeline with this " \
+    "module, for offline latency and synchronization analysis.")
+
 #define OPEN_TEXT N_("Default stream")
 #define OPEN_LONGTEXT N_( \
     "This stream will always be opened at VLC startup." )
@@ -159,6 +175,14 @@ static const char *ppsz_roles_text[] = {
     "This delays the audio output. The delay must be given in milliseconds. " \
     "This can be handy if you notice a lag between the video and the audio.")
 
+#define AUDIO_PERIOD_TEXT N_("Audio output period (ms)")
+#define AUDIO_PERIOD_LONGTEXT N_( \
+    "This sets the period of the audio output, that is to say the amount " \
+    "of audio given to the device at a time, in milliseconds. Short periods " \
+    "lower the output latency, e.g. for live monitoring, at the expense of " \
+    "more frequent wake-ups and a higher risk of underruns. " \
+    "0 uses the default of the audio output module.")
+
 #define AUDIO_RESAMPLER_TEXT N_("Audio resampler")
 #define AUDIO_RESAMPLER_LONGTEXT N_( \
     "This selects which plugin to use for audio resampling." )
@@ -458,6 +482,13 @@ static const char *const ppsz_pos_descriptions[] =
     "You should only disable this option if your video has a " \
     "non-standard format requiring all 1088 lines.")
 
+#define FRUGAL_POOLS_TEXT N_("Memory-frugal picture pools")
+#define FRUGAL_POOLS_LONGTEXT N_( \
+    "This sizes the picture pools from the reference frames actually " \
+    "needed by the stream, instead of the worst case of the codec, and " \
+    "shrinks them after format changes. This saves memory when decoding " \
+    "many videos at once, but some filters or video outputs might stall.")
+
 #define MASPECT_RATIO_TEXT N_("Monitor pixel aspect ratio")
 #define MASPECT_RATIO_LONGTEXT N_( \
     "This forces the monitor aspect ratio. Most monitors have square " \
@@ -474,6 +505,12 @@ static const char *const ppsz_pos_descriptions[] =
     "This drops frames that are late (arrive to the video output after " \
     "their intended display date)." )
 
+#define VIDEO_FILTER_PIPELINE_TEXT N_("Threaded video filters")
+#define VIDEO_FILTER_PIPELINE_LONGTEXT N_( \
+    "This runs the deinterlacing and post-processing filters of the video " \
+    "output on their own threads, so that the next pictures are filtered " \
+    "while the current one waits for its display date." )
+
 #define QUIET_SYNCHRO_TEXT N_("Quiet synchro")
 #define QUIET_SYNCHRO_LONGTEXT N_( \
     "This avoids flooding the message log with debug output from the " \
@@ -529,6 +566,18 @@ static const char *const ppsz_pos_descriptions[] =
     "This defines the maximum input delay jitter that the synchronization " \
     "algorithms should try to compensate (in milliseconds)." )
 
+#define CLOCK_ADAPTIVE_TEXT N_("Adaptive buffering")
+#define CLOCK_ADAPTIVE_LONGTEXT N_( \
+    "Continuously adjust the buffering of live inputs to the observed " \
+    "arrival jitter, by playing slightly faster or slower. This requires " \
+    "audio as the clock master source." )
+#define CLOCK_ADAPTIVE_MIN_TEXT N_("Adaptive buffering minimum (ms)")
+#define CLOCK_ADAPTIVE_MIN_LONGTEXT N_( \
+    "Lowest buffering delay that adaptive buffering will aim for.")
+#define CLOCK_ADAPTIVE_MAX_TEXT N_("Adaptive buffering maximum (ms)")
+#define CLOCK_ADAPTIVE_MAX_LONGTEXT N_( \
+    "Highest buffering delay that adaptive buffering will aim for.")
+
 #define CLOCK_MASTER_TEXT N_("Clock master source")
 
 static const int pi_clock_master_values[] = {
@@ -671,10 +720,27 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
 
+#define PACKETIZER_THREAD_TEXT N_("Packetize in a separate thread")
+#define PACKETIZER_THREAD_LONGTEXT N_( \
+    "Run the packetizer of each elementary stream in its own thread, ahead " \
+    "of the decoder. This helps when the decoder is fast, typically with " \
+    "hardware decoding, and packetizing is the bottleneck.")
+
+#define DECODER_FIFO_SIZE_TEXT N_("Decoder input memory budget (MiB)")
+#define DECODER_FIFO_SIZE_LONGTEXT N_( \
+    "Maximum amount of data queued ahead of each elementary stream decoder. " \
+    "When the input is paced by the outputs, the demuxer waits for room. " \
+    "Otherwise, the queued data is dropped when the budget is exceeded.")
+
 #define INPUT_RATE_TEXT N_("Playback speed")
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
 
+#define TRICKPLAY_RATE_TEXT N_("Trick play speed")
+#define TRICKPLAY_RATE_LONGTEXT N_( \
+    "From this playback speed on, only the video key frames are demuxed " \
+    "and decoded, so that fast playback is cheap. 0 disables trick play." )
+
 #define INPUT_LIST_TEXT N_("Input list")
 #define INPUT_LIST_LONGTEXT N_( \
     "You can give a comma-separated list " \
@@ -710,6 +776,12 @@ static const char *const ppsz_prefres[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_SIZE_TEXT N_("Timeshift size")
+#define INPUT_TIMESHIFT_SIZE_LONGTEXT N_( \
+    "This is the maximum total size in MiB of the timeshift temporary " \
+    "files. Once reached, the oldest data is dropped. " \
+    "0 means no limit." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -951,6 +1023,13 @@ static const char *const ppsz_prefres[] = {
 
 #define DEC_DEV_TEXT N_("Preferred decoder hardware device")
 
+#define DEC_TARGET_WIDTH_TEXT N_("Decoded video width hint")
+#define DEC_TARGET_HEIGHT_TEXT N_("Decoded video height hint")
+#define DEC_TARGET_LONGTEXT N_( \
+    "Size the video will be shown at, if much smaller than the original " \
+    "video, e.g. for thumbnails or mosaic tiles. Decoders supporting it " \
+    "will then decode pictures at a reduced resolution (0 = full size)." )
+
 /*****************************************************************************
  * Sout
  ****************************************************************************/
@@ -995,6 +1074,12 @@ static const char *const ppsz_prefres[] = {
     "multiple playlist item (automatically insert the gather stream output " \
     "if not specified)" )
 
+#define SOUT_OFFLINE_TEXT N_("Offline stream output")
+#define SOUT_OFFLINE_LONGTEXT N_( \
+    "Process the input as fast as the stream output accepts it, never " \
+    "waiting for the clock, and report the progress periodically. This is " \
+    "meant for file to file transcoding batches." )
+
 #define SOUT_MUX_CACHING_TEXT N_("Stream output muxer caching (ms)")
 #define SOUT_MUX_CACHING_LONGTEXT N_( \
     "This allow you to configure the initial caching amount for stream output " \
@@ -1080,6 +1165,12 @@ static const char *const ppsz_prefres[] = {
 #define VLM_CONF_LONGTEXT N_( \
     "Read a VLM configuration file as soon as VLM is started." )
 
+#define VLM_SHARE_TEXT N_("Share identical VLM inputs")
+#define VLM_SHARE_LONGTEXT N_( \
+    "Broadcast media with the same input and options share a single " \
+    "input, each feeding its own output. Shared instances cannot be " \
+    "paused or seeked individually." )
+
 #define PLUGINS_CACHE_TEXT N_("Use a plugins cache")
 #define PLUGINS_CACHE_LONGTEXT N_( \
     "Use a plugins cache which will greatly improve the startup time of VLC.")
@@ -1089,6 +1180,48 @@ static const char *const ppsz_prefres[] = {
     "Scan plugin directories for new plugins at startup. " \
     "This increases the startup time of VLC.")
 
+#define BLOCK_POOL_TEXT N_("Recycle data blocks")
+#define BLOCK_POOL_LONGTEXT N_( \
+    "Keep released data blocks in per-thread caches for reuse, instead of " \
+    "returning them to the system allocator. This reduces allocation " \
+    "overhead with high packet rate streams, at the cost of memory usage.")
+
+#define PICTURE_HUGEPAGES_TEXT N_("Huge pages for pictures")
+#define PICTURE_HUGEPAGES_LONGTEXT N_( \
+    "Back the picture buffers with huge pages, to reduce TLB misses with " \
+    "very high resolution video. Transparent huge pages must be enabled " \
+    "for shared memory (\"advise\" mode), while explicit huge pages must " \
+    "be reserved beforehand. In either case, released picture buffers are " \
+    "kept for reuse when the picture pools are recreated.")
+static const int pi_picture_hugepages_values[] = { 0, 1, 2 };
+static const char *const ppsz_picture_hugepages_texts[] = {
+    N_("Disable"), N_("Transparent"), N_("Explicit") };
+
+#define CPU_LEVEL_TEXT N_("Maximum CPU instruction set")
+#define CPU_LEVEL_LONGTEXT N_( \
+    "Do not use optimized code requiring instructions above this level, " \
+    "even if the CPU supports them, to benchmark or test slower code " \
+    "paths. The levels are \"c\" for portable code, \"sse2\", " \
+    "\"ssse3\", \"sse4\", \"avx\", \"avx2\" and \"avx512\" on x86, " \
+    "\"neon\", \"sve\" and \"sve2\" on ARM. This only applies to code " \
+    "using the CPU dispatch facility.")
+
+#define CPU_AFFINITY_TEXT N_("CPU affinity")
+#define CPU_AFFINITY_LONGTEXT N_( \
+    "Run the pipeline threads on the given CPUs only, as a comma-separated " \
+    "list of CPU numbers and ranges (e.g. \"0-3,8\"), or \"node<N>\" for " \
+    "all the CPUs of a NUMA node. As memory is normally allocated on the " \
+    "node of the thread that first uses it, this also keeps the data blocks " \
+    "and pictures of a pinned input local to its CPUs.")
+#define INPUT_CPU_AFFINITY_TEXT N_("Input thread CPU affinity")
+#define DECODER_CPU_AFFINITY_TEXT N_("Decoder threads CPU affinity")
+#define VOUT_CPU_AFFINITY_TEXT N_("Video output thread CPU affinity")
+#define ENCODER_CPU_AFFINITY_TEXT N_("Encoder threads CPU affinity")
+#define SOUT_CPU_AFFINITY_TEXT N_("Stream output threads CPU affinity")
+#define SUBSYSTEM_CPU_AFFINITY_LONGTEXT N_( \
+    "Overrides the CPU affinity for these threads. The syntax is the same " \
+    "as for the CPU affinity option.")
+
 #define KEYSTORE_TEXT N_("Preferred keystore list")
 #define KEYSTORE_LONGTEXT N_( \
     "List of keystores that VLC will use in priority." )
@@ -1165,6 +1298,10 @@ static const char *const ppsz_prefres[] = {
 #define FETCH_ART_THREADS_LONGTEXT N_( \
     "Maximum number of threads used to fetch art" )
 
+#define THUMBNAILER_THREADS_TEXT N_( "Thumbnailing threads" )
+#define THUMBNAILER_THREADS_LONGTEXT N_( \
+    "Maximum number of thumbnails generated in parallel" )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
 static const char *const psz_recursive_list[] = {
@@ -1223,6 +1360,18 @@ static const char *const psz_recursive_list_text[] = {
 #define SP_LONGTEXT N_( \
     "Pause each item in the playlist on the first frame." )
 
+#define PRELOAD_TEXT N_("Next item preload delay")
+#define PRELOAD_LONGTEXT N_( \
+    "Request the next item of the playlist this many milliseconds before " \
+    "the end of the current one, and prefetch its data, so that it starts " \
+    "faster (0 = disable)." )
+
+#define PREFETCH_TEXT N_("Next item prefetch size")
+#define PREFETCH_LONGTEXT N_( \
+    "Amount of data of the next item of the playlist read ahead when it is " \
+    "requested, in KiB. Its access is then opened in advance as well " \
+    "(0 = only request the item)." )
+
 #define AUTOSTART_TEXT N_( "Auto start" )
 #define AUTOSTART_LONGTEXT N_( "Automatically start playing the playlist " \
                 "content once it's loaded." )
@@ -1577,6 +1726,8 @@ vlc_module_begin ()
         change_short('A')
     add_string( "role", "video", ROLE_TEXT, ROLE_LONGTEXT, true )
         change_string_list( ppsz_roles, ppsz_roles_text )
+    add_integer_with_range( "audio-period", 0, 0, 1000,
+                            AUDIO_PERIOD_TEXT, AUDIO_PERIOD_LONGTEXT, true )
 
     set_subcategory( SUBCAT_AUDIO_AFILTER )
     add_module_list("audio-filter", "audio filter", NULL,
@@ -1608,6 +1759,8 @@ vlc_module_begin ()
         change_private ()
     add_bool( "drop-late-frames", 1, DROP_LATE_FRAMES_TEXT,
               DROP_LATE_FRAMES_LONGTEXT, true )
+    add_bool( "video-filter-pipeline", true, VIDEO_FILTER_PIPELINE_TEXT,
+              VIDEO_FILTER_PIPELINE_LONGTEXT, true )
     /* Used in vout_synchro */
     add_bool( "skip-frames", 1, SKIP_FRAMES_TEXT,
               SKIP_FRAMES_LONGTEXT, true )
@@ -1681,6 +1834,8 @@ vlc_module_begin ()
     add_string( "custom-aspect-ratios", NULL, CUSTOM_ASPECT_RATIOS_TEXT,
                 CUSTOM_ASPECT_RATIOS_LONGTEXT, false )
     add_bool( "hdtv-fix", 1, HDTV_FIX_TEXT, HDTV_FIX_LONGTEXT, true )
+    add_bool( "video-frugal-pools", false, FRUGAL_POOLS_TEXT,
+              FRUGAL_POOLS_LONGTEXT, true )
     add_bool( "video-deco", 1, VIDEO_DECO_TEXT,
               VIDEO_DECO_LONGTEXT, true )
     add_string( "video-title", NULL, VIDEO_TITLE_TEXT,
@@ -1818,8 +1973,18 @@ vlc_module_begin ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT, false )
         change_safe ()
+    add_bool( "packetizer-thread", false,
+              PACKETIZER_THREAD_TEXT, PACKETIZER_THREAD_LONGTEXT, true )
+    add_integer_with_range( "decoder-fifo-size", 400, 1, 4096,
+                            DECODER_FIFO_SIZE_TEXT, DECODER_FIFO_SIZE_LONGTEXT,
+                            true )
+    add_bool( "demux-headers-only", false,
+              "Only parse the headers needed to start decoding", NULL, true )
+        change_volatile ()
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT, false )
+    add_float( "trickplay-rate", 4.,
+               TRICKPLAY_RATE_TEXT, TRICKPLAY_RATE_LONGTEXT, true )
 
     add_string( "input-list", NULL,
                  INPUT_LIST_TEXT, INPUT_LIST_LONGTEXT, true )
@@ -1912,6 +2077,9 @@ vlc_module_begin ()
     add_integer( "file-caching", MS_FROM_VLC_TICK(DEFAULT_PTS_DELAY),
                  CACHING_TEXT, CACHING_LONGTEXT, true )
         change_integer_range( 0, 60000 )
+    add_integer( "next-media-prefetch", 512, PREFETCH_TEXT, PREFETCH_LONGTEXT,
+                 true )
+        change_integer_range( 0, 65536 )
         change_safe()
     add_obsolete_integer( "vdr-caching" ) /* 2.0.0 */
     add_integer( "live-caching", MS_FROM_VLC_TICK(DEFAULT_PTS_DELAY),
@@ -1962,6 +2130,17 @@ vlc_module_begin ()
     add_integer( "clock-jitter", 5000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
+    add_bool( "clock-adaptive", false, CLOCK_ADAPTIVE_TEXT,
+              CLOCK_ADAPTIVE_LONGTEXT, true )
+        change_safe()
+    add_integer( "clock-adaptive-min", 300, CLOCK_ADAPTIVE_MIN_TEXT,
+                 CLOCK_ADAPTIVE_MIN_LONGTEXT, true )
+        change_integer_range( 0, 60000 )
+        change_safe()
+    add_integer( "clock-adaptive-max", 3000, CLOCK_ADAPTIVE_MAX_TEXT,
+                 CLOCK_ADAPTIVE_MAX_LONGTEXT, true )
+        change_integer_range( 0, 60000 )
+        change_safe()
     add_integer( "clock-master", VLC_CLOCK_MASTER_DEFAULT,
                  CLOCK_MASTER_TEXT, NULL, true )
         change_integer_list( pi_clock_master_values, ppsz_clock_master_descriptions )
@@ -1978,6 +2157,9 @@ vlc_module_begin ()
                   INPUT_TIMESHIFT_PATH_TEXT, INPUT_TIMESHIFT_PATH_LONGTEXT)
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-size", 0, INPUT_TIMESHIFT_SIZE_TEXT,
+                 INPUT_TIMESHIFT_SIZE_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -1991,6 +2173,14 @@ vlc_module_begin ()
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
     add_string( "dec-dev", NULL, DEC_DEV_TEXT, NULL, true )
+    add_integer( "dec-target-width", 0, DEC_TARGET_WIDTH_TEXT,
+                 DEC_TARGET_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
+        change_safe()
+    add_integer( "dec-target-height", 0, DEC_TARGET_HEIGHT_TEXT,
+                 DEC_TARGET_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
+        change_safe()
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint(N_("Input"), INPUT_CAT_LONGTEXT)
@@ -2018,6 +2208,8 @@ vlc_module_begin ()
                                 SOUT_DISPLAY_LONGTEXT, true )
     add_bool( "sout-keep", false, SOUT_KEEP_TEXT,
                                 SOUT_KEEP_LONGTEXT, true )
+    add_bool( "sout-offline", false, SOUT_OFFLINE_TEXT,
+                                SOUT_OFFLINE_LONGTEXT, true )
     add_bool( "sout-all", true, SOUT_ALL_TEXT,
                                 SOUT_ALL_LONGTEXT, true )
     add_bool( "sout-audio", 1, SOUT_AUDIO_TEXT,
@@ -2031,6 +2223,8 @@ vlc_module_begin ()
 
     set_section( N_("VLM"), NULL )
     add_loadfile("vlm-conf", NULL, VLM_CONF_TEXT, VLM_CONF_LONGTEXT)
+    add_bool( "vlm-share-inputs", false, VLM_SHARE_TEXT,
+              VLM_SHARE_LONGTEXT, true )
 
 
     set_subcategory( SUBCAT_SOUT_STREAM )
@@ -2094,6 +2288,28 @@ vlc_module_begin ()
 
     set_section( N_("Performance options"), NULL )
 
+    add_bool( "block-pool", false, BLOCK_POOL_TEXT,
+              BLOCK_POOL_LONGTEXT, true )
+    add_integer( "picture-hugepages", 0, PICTURE_HUGEPAGES_TEXT,
+                 PICTURE_HUGEPAGES_LONGTEXT, true )
+        change_integer_list( pi_picture_hugepages_values,
+                             ppsz_picture_hugepages_texts )
+
+    add_string( "cpu-level", NULL, CPU_LEVEL_TEXT,
+                CPU_LEVEL_LONGTEXT, true )
+    add_string( "cpu-affinity", NULL, CPU_AFFINITY_TEXT,
+                CPU_AFFINITY_LONGTEXT, true )
+    add_string( "input-cpu-affinity", NULL, INPUT_CPU_AFFINITY_TEXT,
+                SUBSYSTEM_CPU_AFFINITY_LONGTEXT, true )
+    add_string( "decoder-cpu-affinity", NULL, DECODER_CPU_AFFINITY_TEXT,
+                SUBSYSTEM_CPU_AFFINITY_LONGTEXT, true )
+    add_string( "vout-cpu-affinity", NULL, VOUT_CPU_AFFINITY_TEXT,
+                SUBSYSTEM_CPU_AFFINITY_LONGTEXT, true )
+    add_string( "encoder-cpu-affinity", NULL, ENCODER_CPU_AFFINITY_TEXT,
+                SUBSYSTEM_CPU_AFFINITY_LONGTEXT, true )
+    add_string( "sout-cpu-affinity", NULL, SOUT_CPU_AFFINITY_TEXT,
+                SUBSYSTEM_CPU_AFFINITY_LONGTEXT, true )
+
 #if defined (LIBVLC_USE_PTHREAD)
     add_bool( "rt-priority", false, RT_PRIORITY_TEXT,
               RT_PRIORITY_LONGTEXT, true )
@@ -2135,6 +2351,9 @@ vlc_module_begin ()
     add_bool( "play-and-pause", 0, PAP_TEXT, PAP_LONGTEXT, true )
         change_safe()
     add_bool( "start-paused", 0, SP_TEXT, SP_LONGTEXT, false )
+    add_integer( "next-media-preload", 0, PRELOAD_TEXT, PRELOAD_LONGTEXT,
+                 true )
+        change_integer_range( 0, 60000 )
     add_bool( "playlist-autostart", true,
               AUTOSTART_TEXT, AUTOSTART_LONGTEXT, false )
     add_bool( "playlist-cork", true, CORK_TEXT, CORK_LONGTEXT, false )
@@ -2170,6 +2389,10 @@ vlc_module_begin ()
     add_integer( "fetch-art-threads", 1, FETCH_ART_THREADS_TEXT,
                  FETCH_ART_THREADS_LONGTEXT, false )
 
+    add_integer( "thumbnailer-threads", 1, THUMBNAILER_THREADS_TEXT,
+                 THUMBNAILER_THREADS_LONGTEXT, false )
+        change_integer_range( 1, 32 )
+
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
                  METADATA_NETWORK_TEXT, false )
@@ -2199,6 +2422,10 @@ vlc_module_begin ()
         change_short('v')
         change_volatile ()
     add_obsolete_string( "verbose-objects" ) /* since 2.1.0 */
+    add_bool( "log-async", false, LOG_ASYNC_TEXT, LOG_ASYNC_LONGTEXT, true )
+    add_integer( "log-rate-limit", 0, LOG_RATE_TEXT, LOG_RATE_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
+    add_module( "tracer", "tracer", NULL, TRACER_TEXT, TRACER_LONGTEXT )
 #if !defined(_WIN32) && !defined(__OS2__)
     add_bool( "daemon", 0, DAEMON_TEXT, DAEMON_LONGTEXT, true )
         change_short('d')
@@ -2814,6 +3041,8 @@ vlc_module_begin ()
     N_("use alternate config file")
 #define RESET_PLUGINS_CACHE_TEXT \
     N_("resets the current plugins cache")
+#define UPDATE_PLUGINS_CACHE_TEXT \
+    N_("updates the current plugins cache with modified plugins only")
 #define VERSION_TEXT \
     N_("print version information")
 
@@ -2846,6 +3075,9 @@ vlc_module_begin ()
     add_bool( "reset-plugins-cache", false,
               RESET_PLUGINS_CACHE_TEXT, "", false )
         change_volatile ()
+    add_bool( "update-plugins-cache", false,
+              UPDATE_PLUGINS_CACHE_TEXT, "", false )
+        change_volatile ()
 #endif
     add_bool( "version", false, VERSION_TEXT, "", false )
         change_volatile ()
@@ -98,6 +98,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->main_playlist = NULL;
     priv->p_vlm = NULL;
     priv->media_source_provider = NULL;
+    priv->block_pool = false;
 
     vlc_ExitInit( &priv->exit );
 
@@ -168,6 +169,7 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
         goto error;
 
     vlc_LogInit(p_libvlc);
+    vlc_TracerInit(p_libvlc);
 
     /*
      * Support for gettext
@@ -222,6 +224,8 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
         msg_Warn( p_libvlc, "memory keystore init failed" );
 
     vlc_CPU_dump( VLC_OBJECT(p_libvlc) );
+    vlc_block_pool_Init( p_libvlc );
+    vlc_picture_cache_Init( p_libvlc );
 
     if( var_InheritBool( p_libvlc, "media-library") )
     {
@@ -428,6 +432,9 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
 
+    vlc_picture_cache_Deinit( p_libvlc );
+    vlc_block_pool_Deinit( p_libvlc );
+    vlc_TracerDestroy(p_libvlc);
     vlc_LogDestroy(p_libvlc->obj.logger);
     /* Free module bank. It is refcounted, so we call this each time  */
     module_EndBank (true);
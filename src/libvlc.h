@@ -72,6 +72,39 @@ void vlc_mutex_unmark(const vlc_mutex_t *);
 # define vlc_mutex_unmark(m) ((void)(m))
 #endif
 
+/*
+ * Data blocks
+ */
+
+/**
+ * Enables the data block pool if the "block-pool" option is set.
+ */
+void vlc_block_pool_Init(libvlc_int_t *);
+
+/**
+ * Releases the data block pool reference taken by vlc_block_pool_Init().
+ *
+ * The pool is flushed when the last user is gone.
+ */
+void vlc_block_pool_Deinit(libvlc_int_t *);
+
+/*
+ * Pictures
+ */
+
+/**
+ * Enables the picture buffers cache if the "picture-hugepages" option is set.
+ */
+void vlc_picture_cache_Init(libvlc_int_t *);
+
+/**
+ * Releases the picture buffers cache reference taken by
+ * vlc_picture_cache_Init().
+ *
+ * The cache is flushed when the last user is gone.
+ */
+void vlc_picture_cache_Deinit(libvlc_int_t *);
+
 /*
  * Logging
  */
@@ -80,6 +113,12 @@ typedef struct vlc_logger vlc_logger_t;
 int vlc_LogPreinit(libvlc_int_t *) VLC_USED;
 void vlc_LogInit(libvlc_int_t *);
 
+/*
+ * Tracing
+ */
+void vlc_TracerInit(libvlc_int_t *);
+void vlc_TracerDestroy(libvlc_int_t *);
+
 /*
  * LibVLC exit event handling
  */
@@ -189,6 +228,9 @@ typedef struct libvlc_priv_t
     vlc_actions_t *actions; ///< Hotkeys handler
     struct vlc_medialibrary_t *p_media_library; ///< Media library instance
     struct vlc_thumbnailer_t *p_thumbnailer; ///< Lazily instantiated media thumbnailer
+    struct vlc_tracer *tracer; ///< Tracer (or NULL)
+    bool block_pool; ///< Whether this instance uses the data block pool
+    bool picture_cache; ///< Whether this instance uses the picture cache
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -56,6 +56,9 @@ static void vlc_CPU_init (void)
     {
         char *p = line, *cap;
         uint_fast32_t core_caps = 0;
+#if defined (__i386__) || defined (__x86_64__)
+        unsigned avx512 = 0;
+#endif
 
 #if defined (__arm__)
         unsigned ver;
@@ -73,6 +76,8 @@ static void vlc_CPU_init (void)
 # if defined (__aarch64__)
             if (!strcmp (cap, "sve"))
                 core_caps |= VLC_CPU_ARM_SVE;
+            if (!strcmp (cap, "sve2"))
+                core_caps |= VLC_CPU_ARM_SVE2;
 # endif
 
 #elif defined (__i386__) || defined (__x86_64__)
@@ -104,12 +109,26 @@ static void vlc_CPU_init (void)
                 core_caps |= VLC_CPU_XOP;
             if (!strcmp (cap, "fma4"))
                 core_caps |= VLC_CPU_FMA4;
+            if (!strcmp (cap, "avx512f"))
+                avx512 |= 0x01;
+            if (!strcmp (cap, "avx512cd"))
+                avx512 |= 0x02;
+            if (!strcmp (cap, "avx512bw"))
+                avx512 |= 0x04;
+            if (!strcmp (cap, "avx512dq"))
+                avx512 |= 0x08;
+            if (!strcmp (cap, "avx512vl"))
+                avx512 |= 0x10;
 
 #elif defined (__powerpc__) || defined (__powerpc64__)
             if (!strcmp (cap, "altivec supported"))
                 core_caps |= VLC_CPU_ALTIVEC;
 #endif
         }
+#if defined (__i386__) || defined (__x86_64__)
+        if (avx512 == 0x1F)
+            core_caps |= VLC_CPU_AVX512;
+#endif
 
         /* Take the intersection of capabilities of each processor */
         all_caps &= core_caps;
@@ -28,6 +28,7 @@
 
 #include "libvlc.h"
 #include "background_worker.h"
+#include "executor.h"
 
 struct task {
     struct vlc_list node;
@@ -44,12 +45,14 @@ struct background_thread {
     bool probe; /**< true if a probe is requested */
     bool cancel; /**< true if a cancel is requested */
     struct task *task; /**< current task */
+    struct vlc_executor_task runnable; /**< run by the shared executor */
     struct vlc_list node;
 };
 
 struct background_worker {
     void* owner;
     struct background_worker_config conf;
+    struct vlc_executor *executor;
 
     vlc_mutex_t lock;
 
@@ -58,7 +61,6 @@ struct background_worker {
     struct vlc_list threads; /**< list of active background_thread instances */
 
     struct vlc_list queue; /**< queue of tasks */
-    vlc_cond_t queue_wait; /**< wait for the queue to be non-empty */
 
     vlc_cond_t nothreads_wait; /**< wait for nthreads == 0 */
     bool closing; /**< true if background worker deletion is requested */
@@ -84,23 +86,17 @@ static void task_Destroy(struct background_worker *worker, struct task *task)
     free(task);
 }
 
-static struct task *QueueTake(struct background_worker *worker, int timeout_ms)
+static struct task *QueueTake(struct background_worker *worker)
 {
     vlc_mutex_assert(&worker->lock);
 
-    vlc_tick_t deadline = vlc_tick_now() + VLC_TICK_FROM_MS(timeout_ms);
-    bool timeout = false;
-    while (!timeout && !worker->closing && vlc_list_is_empty(&worker->queue))
-        timeout = vlc_cond_timedwait(&worker->queue_wait,
-                                     &worker->lock, deadline) != 0;
-
-    if (worker->closing || timeout)
+    if (worker->closing)
         return NULL;
 
     struct task *task = vlc_list_first_entry_or_null(&worker->queue,
                                                      struct task, node);
-    assert(task);
-    vlc_list_remove(&task->node);
+    if (task)
+        vlc_list_remove(&task->node);
 
     return task;
 }
@@ -109,7 +105,6 @@ static void QueuePush(struct background_worker *worker, struct task *task)
 {
     vlc_mutex_assert(&worker->lock);
     vlc_list_append(&task->node, &worker->queue);
-    vlc_cond_signal(&worker->queue_wait);
 }
 
 static void QueueRemoveAll(struct background_worker *worker, void *id)
@@ -154,6 +149,13 @@ static struct background_worker *background_worker_Create(void *owner,
     if (unlikely(!worker))
         return NULL;
 
+    worker->executor = vlc_executor_Hold();
+    if (unlikely(!worker->executor))
+    {
+        free(worker);
+        return NULL;
+    }
+
     worker->conf = *conf;
     worker->owner = owner;
 
@@ -162,7 +164,6 @@ static struct background_worker *background_worker_Create(void *owner,
     worker->nthreads = 0;
     vlc_list_init(&worker->threads);
     vlc_list_init(&worker->queue);
-    vlc_cond_init(&worker->queue_wait);
     vlc_cond_init(&worker->nothreads_wait);
     worker->closing = false;
     return worker;
@@ -170,7 +171,8 @@ static struct background_worker *background_worker_Create(void *owner,
 
 static void background_worker_Destroy(struct background_worker *worker)
 {
-    vlc_cond_destroy(&worker->queue_wait);
+    vlc_executor_Release(worker->executor);
+    vlc_cond_destroy(&worker->nothreads_wait);
     vlc_mutex_destroy(&worker->lock);
     free(worker);
 }
@@ -187,24 +189,20 @@ static void TerminateTask(struct background_thread *thread, struct task *task)
     vlc_mutex_unlock(&worker->lock);
 }
 
-static void RemoveThread(struct background_thread *thread)
+static void RemoveThreadLocked(struct background_thread *thread)
 {
     struct background_worker *worker = thread->owner;
 
-    vlc_mutex_lock(&worker->lock);
+    vlc_mutex_assert(&worker->lock);
 
     vlc_list_remove(&thread->node);
     worker->nthreads--;
     assert(worker->nthreads >= 0);
     if (!worker->nthreads)
         vlc_cond_signal(&worker->nothreads_wait);
-
-    vlc_mutex_unlock(&worker->lock);
-
-    background_thread_Destroy(thread);
 }
 
-static void* Thread( void* data )
+static void Thread( void* data )
 {
     struct background_thread *thread = data;
     struct background_worker *worker = thread->owner;
@@ -212,11 +210,13 @@ static void* Thread( void* data )
     for (;;)
     {
         vlc_mutex_lock(&worker->lock);
-        struct task *task = QueueTake(worker, 5000);
+        struct task *task = QueueTake(worker);
         if (!task)
         {
+            /* give the executor thread back, atomically with the queue check
+             * so that a concurrent push spawns a new task */
+            RemoveThreadLocked(thread);
             vlc_mutex_unlock(&worker->lock);
-            /* terminate this thread */
             break;
         }
 
@@ -261,9 +261,7 @@ static void* Thread( void* data )
         }
     }
 
-    RemoveThread(thread);
-
-    return NULL;
+    background_thread_Destroy(thread);
 }
 
 static bool SpawnThread(struct background_worker *worker)
@@ -274,13 +272,13 @@ static bool SpawnThread(struct background_worker *worker)
     if (!thread)
         return false;
 
-    if (vlc_clone_detach(NULL, Thread, thread, VLC_THREAD_PRIORITY_LOW))
-    {
-        free(thread);
-        return false;
-    }
+    thread->runnable.pf_run = Thread;
+    thread->runnable.opaque = thread;
+    thread->runnable.priority = worker->conf.priority;
+
     worker->nthreads++;
     vlc_list_append(&thread->node, &worker->threads);
+    vlc_executor_Submit(worker->executor, &thread->runnable);
 
     return true;
 }
@@ -353,8 +351,18 @@ void background_worker_Delete( struct background_worker* worker )
 
     worker->closing = true;
     BackgroundWorkerCancelLocked(worker, NULL);
-    /* closing is now true, this will wake up any QueueTake() */
-    vlc_cond_broadcast(&worker->queue_wait);
+
+    /* closing is now true: withdraw the executor tasks that did not start
+     * yet, the running ones will terminate on their own */
+    struct background_thread *thread;
+    vlc_list_foreach(thread, &worker->threads, node)
+    {
+        if (vlc_executor_Cancel(worker->executor, &thread->runnable))
+        {
+            RemoveThreadLocked(thread);
+            background_thread_Destroy(thread);
+        }
+    }
 
     while (worker->nthreads)
         vlc_cond_wait(&worker->nothreads_wait, &worker->lock);
@@ -19,6 +19,8 @@
 #ifndef BACKGROUND_WORKER_H__
 #define BACKGROUND_WORKER_H__
 
+#include "executor.h"
+
 struct background_worker_config {
     /**
      * Default timeout for completing a task
@@ -34,6 +36,13 @@ struct background_worker_config {
      */
     int max_threads;
 
+    /**
+     * Priority of the tasks on the shared executor
+     *
+     * One of \ref vlc_executor_priority (0 is the normal priority).
+     */
+    int priority;
+
     /**
      * Release an entity
      *
@@ -27,6 +27,7 @@
 
 #include <sys/stat.h>
 #include <assert.h>
+#include <limits.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -34,6 +35,8 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
+#include "libvlc.h"
 
 #ifndef NDEBUG
 static void block_Check (block_t *block)
@@ -105,6 +108,265 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*
+ * Data block pool
+ *
+ * When enabled, blocks with a payload of up to BLOCK_POOL_MAX_SIZE bytes are
+ * allocated from power-of-two size classes. Released blocks are kept in a
+ * small per-thread cache, and overflow into a global depot shared by all
+ * threads, which is only accessed in batches.
+ */
+#define BLOCK_POOL_MIN_SHIFT 8 /* 256 bytes */
+#define BLOCK_POOL_MAX_SHIFT 16 /* 64 KiB */
+#define BLOCK_POOL_MAX_SIZE (1u << BLOCK_POOL_MAX_SHIFT)
+#define BLOCK_POOL_CLASSES (BLOCK_POOL_MAX_SHIFT - BLOCK_POOL_MIN_SHIFT + 1)
+/** Maximum number of blocks per size class in a thread cache */
+#define BLOCK_POOL_CACHE_MAX 64
+/** Maximum number of blocks per size class in the global depot */
+#define BLOCK_POOL_DEPOT_MAX 1024
+
+struct block_pool_cache
+{
+    block_t *blocks[BLOCK_POOL_CLASSES];
+    unsigned count[BLOCK_POOL_CLASSES];
+    uint64_t hits;
+    uint64_t misses;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    unsigned users;
+    bool has_key;
+    vlc_threadvar_t key;
+    atomic_bool enabled;
+    block_t *depot[BLOCK_POOL_CLASSES];
+    unsigned depot_count[BLOCK_POOL_CLASSES];
+    uint64_t hits;
+    uint64_t misses;
+} block_pool = {
+    .lock = VLC_STATIC_MUTEX,
+    .enabled = ATOMIC_VAR_INIT(false),
+};
+
+static size_t block_pool_ClassSize(unsigned cls)
+{
+    return (size_t)1 << (cls + BLOCK_POOL_MIN_SHIFT);
+}
+
+static unsigned block_pool_ClassOf(size_t size)
+{
+    unsigned cls = 0;
+
+    while (block_pool_ClassSize(cls) < size)
+        cls++;
+    assert(cls < BLOCK_POOL_CLASSES);
+    return cls;
+}
+
+/* Moves up to count blocks from a list to the global depot.
+ * Must be called with the pool lock held. */
+static block_t *block_pool_Deposit(unsigned cls, block_t *list,
+                                   unsigned count)
+{
+    while (list != NULL && count-- > 0)
+    {
+        block_t *next = list->p_next;
+
+        if (atomic_load_explicit(&block_pool.enabled, memory_order_relaxed)
+         && block_pool.depot_count[cls] < BLOCK_POOL_DEPOT_MAX)
+        {
+            list->p_next = block_pool.depot[cls];
+            block_pool.depot[cls] = list;
+            block_pool.depot_count[cls]++;
+        }
+        else
+            free(list);
+        list = next;
+    }
+    return list;
+}
+
+/* Returns a thread cache to the depot. Must be called with the lock held. */
+static void block_pool_FlushCache(struct block_pool_cache *cache)
+{
+    for (unsigned cls = 0; cls < BLOCK_POOL_CLASSES; cls++)
+    {
+        block_pool_Deposit(cls, cache->blocks[cls], UINT_MAX);
+        cache->blocks[cls] = NULL;
+        cache->count[cls] = 0;
+    }
+    block_pool.hits += cache->hits;
+    block_pool.misses += cache->misses;
+    cache->hits = cache->misses = 0;
+}
+
+static void block_pool_DestroyCache(void *data)
+{
+    struct block_pool_cache *cache = data;
+
+    vlc_mutex_lock(&block_pool.lock);
+    block_pool_FlushCache(cache);
+    vlc_mutex_unlock(&block_pool.lock);
+    free(cache);
+}
+
+static void block_pool_Release(block_t *block)
+{
+    size_t size = block->i_size - BLOCK_ALIGN - (2 * BLOCK_PADDING);
+    unsigned cls = block_pool_ClassOf(size);
+    struct block_pool_cache *cache = vlc_threadvar_get(block_pool.key);
+
+    assert(block->p_start == (unsigned char *)(block + 1));
+
+    if (!atomic_load_explicit(&block_pool.enabled, memory_order_relaxed))
+    {
+        free(block);
+        return;
+    }
+
+    if (likely(cache != NULL))
+    {
+        if (cache->count[cls] >= BLOCK_POOL_CACHE_MAX)
+        {   /* Return half of the cache to the depot */
+            vlc_mutex_lock(&block_pool.lock);
+            cache->blocks[cls] = block_pool_Deposit(cls, cache->blocks[cls],
+                                                    BLOCK_POOL_CACHE_MAX / 2);
+            vlc_mutex_unlock(&block_pool.lock);
+            cache->count[cls] -= BLOCK_POOL_CACHE_MAX / 2;
+        }
+
+        block->p_next = cache->blocks[cls];
+        cache->blocks[cls] = block;
+        cache->count[cls]++;
+    }
+    else
+    {
+        block->p_next = NULL;
+        vlc_mutex_lock(&block_pool.lock);
+        block_pool_Deposit(cls, block, 1);
+        vlc_mutex_unlock(&block_pool.lock);
+    }
+}
+
+static const struct vlc_block_callbacks block_pool_cbs =
+{
+    block_pool_Release,
+};
+
+static block_t *block_pool_Alloc(size_t size)
+{
+    struct block_pool_cache *cache = vlc_threadvar_get(block_pool.key);
+
+    if (unlikely(cache == NULL))
+    {
+        cache = calloc(1, sizeof (*cache));
+        if (unlikely(cache == NULL))
+            return NULL;
+        if (unlikely(vlc_threadvar_set(block_pool.key, cache)))
+        {
+            free(cache);
+            return NULL;
+        }
+    }
+
+    unsigned cls = block_pool_ClassOf(size);
+    block_t *b = cache->blocks[cls];
+
+    if (b == NULL)
+    {   /* Refill from the depot */
+        vlc_mutex_lock(&block_pool.lock);
+        for (unsigned i = 0; i < BLOCK_POOL_CACHE_MAX / 2; i++)
+        {
+            block_t *next = block_pool.depot[cls];
+            if (next == NULL)
+                break;
+
+            block_pool.depot[cls] = next->p_next;
+            block_pool.depot_count[cls]--;
+            next->p_next = b;
+            b = next;
+            cache->count[cls]++;
+        }
+        vlc_mutex_unlock(&block_pool.lock);
+    }
+
+    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                       + block_pool_ClassSize(cls);
+    if (b != NULL)
+    {
+        cache->blocks[cls] = b->p_next;
+        cache->count[cls]--;
+        cache->hits++;
+    }
+    else
+    {
+        b = malloc(alloc);
+        if (unlikely(b == NULL))
+            return NULL;
+        cache->misses++;
+    }
+
+    block_Init(b, &block_pool_cbs, b + 1, alloc - sizeof (*b));
+    b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
+    b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
+    b->i_buffer = size;
+    return b;
+}
+
+void vlc_block_pool_Init(libvlc_int_t *libvlc)
+{
+    if (!var_InheritBool(libvlc, "block-pool"))
+        return;
+
+    vlc_mutex_lock(&block_pool.lock);
+    if (!block_pool.has_key)
+        block_pool.has_key = !vlc_threadvar_create(&block_pool.key,
+                                                   block_pool_DestroyCache);
+    if (block_pool.has_key)
+    {
+        if (block_pool.users++ == 0)
+            atomic_store(&block_pool.enabled, true);
+        libvlc_priv(libvlc)->block_pool = true;
+    }
+    vlc_mutex_unlock(&block_pool.lock);
+
+    if (!libvlc_priv(libvlc)->block_pool)
+        msg_Err(libvlc, "cannot enable the data block pool");
+}
+
+void vlc_block_pool_Deinit(libvlc_int_t *libvlc)
+{
+    if (!libvlc_priv(libvlc)->block_pool)
+        return;
+
+    libvlc_priv(libvlc)->block_pool = false;
+
+    vlc_mutex_lock(&block_pool.lock);
+    struct block_pool_cache *cache = vlc_threadvar_get(block_pool.key);
+    if (cache != NULL)
+        block_pool_FlushCache(cache);
+
+    uint64_t total = block_pool.hits + block_pool.misses;
+    if (total > 0)
+        msg_Dbg(libvlc, "data block pool: %"PRIu64" allocations, "
+                "%.1f%% recycled", total, 100. * block_pool.hits / total);
+
+    if (--block_pool.users == 0)
+    {
+        /* Blocks still cached by other threads will be freed on exit */
+        atomic_store(&block_pool.enabled, false);
+        for (unsigned cls = 0; cls < BLOCK_POOL_CLASSES; cls++)
+        {
+            block_pool_Deposit(cls, block_pool.depot[cls], UINT_MAX);
+            block_pool.depot[cls] = NULL;
+            block_pool.depot_count[cls] = 0;
+        }
+        block_pool.hits = block_pool.misses = 0;
+    }
+    vlc_mutex_unlock(&block_pool.lock);
+}
+
 block_t *block_Alloc (size_t size)
 {
     if (unlikely(size >> 27))
@@ -113,6 +375,14 @@ block_t *block_Alloc (size_t size)
         return NULL;
     }
 
+    if (size <= BLOCK_POOL_MAX_SIZE
+     && atomic_load_explicit(&block_pool.enabled, memory_order_relaxed))
+    {
+        block_t *b = block_pool_Alloc(size);
+        if (likely(b != NULL))
+            return b;
+    }
+
     /* 2 * BLOCK_PADDING: pre + post padding */
     const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
                        + size;
@@ -141,6 +411,107 @@ void block_Release(block_t *block)
     block->cbs->free(block);
 }
 
+struct block_share
+{
+    atomic_uint refs;
+    block_t *block; /**< block owning the payload */
+};
+
+typedef struct
+{
+    block_t self;
+    struct block_share *share;
+} block_shared_t;
+
+static void block_shared_Release(block_t *block)
+{
+    block_shared_t *sb = container_of(block, block_shared_t, self);
+    struct block_share *share = sb->share;
+
+    if (atomic_fetch_sub_explicit(&share->refs, 1, memory_order_acq_rel) == 1)
+    {
+        block_Release(share->block);
+        free(share);
+    }
+    free(sb);
+}
+
+static const struct vlc_block_callbacks block_shared_cbs =
+{
+    block_shared_Release,
+};
+
+/* Whether another block references the same payload */
+static bool block_IsShared(const block_t *block)
+{
+    if (block->cbs != &block_shared_cbs)
+        return false;
+
+    const block_shared_t *sb = container_of(block, block_shared_t, self);
+    return atomic_load_explicit(&sb->share->refs, memory_order_acquire) > 1;
+}
+
+/* The shared block can only use the payload of the block it is made from:
+ * anything beyond may belong to another share. */
+static block_t *block_shared_New(struct block_share *share, const block_t *from)
+{
+    block_shared_t *sb = malloc(sizeof (*sb));
+    if (unlikely(sb == NULL))
+        return NULL;
+
+    block_Init(&sb->self, &block_shared_cbs, from->p_buffer, from->i_buffer);
+    block_CopyProperties(&sb->self, from);
+    sb->share = share;
+    return &sb->self;
+}
+
+block_t *block_Share(block_t **pp_block)
+{
+    block_t *block = *pp_block;
+    struct block_share *share;
+
+    block_Check(block);
+
+    if (block->cbs == &block_shared_cbs)
+        share = container_of(block, block_shared_t, self)->share;
+    else
+    {
+        share = malloc(sizeof (*share));
+        if (unlikely(share == NULL))
+            return NULL;
+
+        atomic_init(&share->refs, 1);
+        share->block = block;
+
+        block_t *owner = block_shared_New(share, block);
+        if (unlikely(owner == NULL))
+        {
+            free(share);
+            return NULL;
+        }
+        owner->p_next = block->p_next;
+        block->p_next = NULL;
+        *pp_block = block = owner;
+    }
+
+    block_t *dup = block_shared_New(share, block);
+    if (likely(dup != NULL))
+        atomic_fetch_add_explicit(&share->refs, 1, memory_order_relaxed);
+    return dup;
+}
+
+block_t *block_Unshare(block_t *block)
+{
+    if (!block_IsShared(block))
+        return block;
+
+    block_t *copy = block_Duplicate(block);
+    if (likely(copy != NULL))
+        copy->p_next = block->p_next;
+    block_Release(block);
+    return copy;
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
@@ -177,7 +548,7 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 
     if( p_block->i_buffer == 0 )
     {   /* Corner case: nothing to preserve */
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && !block_IsShared( p_block ) )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -199,6 +570,12 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
     uint8_t *p_start = p_block->p_start;
     uint8_t *p_end = p_start + p_block->i_size;
 
+    if( block_IsShared( p_block ) )
+    {   /* Copy on write: never expand over the shared payload */
+        p_start = p_block->p_buffer;
+        p_end = p_start + p_block->i_buffer;
+    }
+
     /* Second, reallocate the buffer if we lack space. */
     assert( i_prebody >= 0 );
     if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
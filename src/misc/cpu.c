@@ -122,6 +122,7 @@ static void vlc_CPU_init(void)
 
 #if defined( __i386__ ) || defined( __x86_64__ )
      unsigned int i_eax, i_ebx, i_ecx, i_edx;
+     unsigned int i_max;
      bool b_amd;
 
     /* Needed for x86 CPU capabilities detection */
@@ -131,13 +132,13 @@ static void vlc_CPU_init(void)
                    "cpuid\n\t" \
                    "xchgl %%ebx,%1\n\t" \
                    : "=a" (i_eax), "=r" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-                   : "a" (reg) \
+                   : "a" (reg), "c" (0) \
                    : "cc");
 # else
 #  define cpuid(reg) \
      asm volatile ("cpuid\n\t" \
                    : "=a" (i_eax), "=b" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-                   : "a" (reg) \
+                   : "a" (reg), "c" (0) \
                    : "cc");
 # endif
      /* Check if the OS really supports the requested instructions */
@@ -167,6 +168,7 @@ static void vlc_CPU_init(void)
 
     /* the CPU supports the CPUID instruction - get its level */
     cpuid( 0x00000000 );
+    i_max = i_eax;
 
 # if defined (__i386__) && !defined (__i586__) \
   && !defined (__i686__) && !defined (__pentium4__) \
@@ -207,6 +209,30 @@ static void vlc_CPU_init(void)
             i_capabilities |= VLC_CPU_SSE4_2;
     }
 
+    /* AVX needs the OS to save the extended registers (OSXSAVE and XCR0) */
+    if ((i_ecx & 0x18000000) == 0x18000000)
+    {
+        unsigned int i_xcr0, i_xcr0_hi;
+
+        asm volatile ("xgetbv\n\t" : "=a" (i_xcr0), "=d" (i_xcr0_hi)
+                                   : "c" (0));
+        if ((i_xcr0 & 0x06) == 0x06) /* XMM and YMM state */
+        {
+            i_capabilities |= VLC_CPU_AVX;
+
+            if (i_max >= 7)
+            {
+                cpuid( 0x00000007 );
+                if (i_ebx & 0x00000020)
+                    i_capabilities |= VLC_CPU_AVX2;
+                /* F, DQ, CD, BW and VL, with opmask and ZMM state */
+                if ((i_ebx & 0xD0030000) == 0xD0030000
+                 && (i_xcr0 & 0xE6) == 0xE6)
+                    i_capabilities |= VLC_CPU_AVX512;
+            }
+        }
+    }
+
     /* test for additional capabilities */
     cpuid( 0x80000000 );
 
@@ -297,6 +323,8 @@ void vlc_CPU_dump (vlc_object_t *obj)
         vlc_memstream_puts(&stream, "XOP ");
     if (vlc_CPU_FMA4())
         vlc_memstream_puts(&stream, "FMA4 ");
+    if (vlc_CPU_AVX512())
+        vlc_memstream_puts(&stream, "AVX512 ");
 
 #elif defined (__powerpc__) || defined (__ppc__) || defined (__ppc64__)
     if (vlc_CPU_ALTIVEC())
@@ -306,6 +334,14 @@ void vlc_CPU_dump (vlc_object_t *obj)
     if (vlc_CPU_ARM_NEON())
         vlc_memstream_puts(&stream, "ARM_NEON ");
 
+#elif defined (__aarch64__)
+    if (vlc_CPU_ARM_NEON())
+        vlc_memstream_puts(&stream, "ARM_NEON ");
+    if (vlc_CPU_ARM_SVE())
+        vlc_memstream_puts(&stream, "ARM_SVE ");
+    if (vlc_CPU_ARM_SVE2())
+        vlc_memstream_puts(&stream, "ARM_SVE2 ");
+
 #endif
 
 #if HAVE_FPU
@@ -318,3 +354,129 @@ void vlc_CPU_dump (vlc_object_t *obj)
         free(stream.ptr);
     }
 }
+
+/**
+ * Instruction set levels for the "cpu-level" option, each including the
+ * previous ones.
+ */
+static const struct
+{
+    char name[8];
+    unsigned flags;
+} cpu_levels[] = {
+    { "c", 0 },
+#if defined (__i386__) || defined (__x86_64__)
+# define CPU_LEVEL_SSE2 (VLC_CPU_MMX | VLC_CPU_MMXEXT | VLC_CPU_SSE \
+                         | VLC_CPU_SSE2)
+# define CPU_LEVEL_SSSE3 (CPU_LEVEL_SSE2 | VLC_CPU_SSE3 | VLC_CPU_SSSE3)
+# define CPU_LEVEL_SSE4 (CPU_LEVEL_SSSE3 | VLC_CPU_SSE4_1 | VLC_CPU_SSE4_2)
+# define CPU_LEVEL_AVX2 (CPU_LEVEL_SSE4 | VLC_CPU_AVX | VLC_CPU_AVX2)
+    { "mmx", VLC_CPU_MMX },
+    { "sse2", CPU_LEVEL_SSE2 },
+    { "ssse3", CPU_LEVEL_SSSE3 },
+    { "sse4", CPU_LEVEL_SSE4 },
+    { "avx", CPU_LEVEL_SSE4 | VLC_CPU_AVX },
+    { "avx2", CPU_LEVEL_AVX2 },
+    { "avx512", CPU_LEVEL_AVX2 | VLC_CPU_AVX512 },
+#elif defined (__powerpc__) || defined (__ppc__) || defined (__ppc64__)
+    { "altivec", VLC_CPU_ALTIVEC },
+#elif defined (__arm__)
+    { "armv6", VLC_CPU_ARMv6 },
+    { "neon", VLC_CPU_ARMv6 | VLC_CPU_ARM_NEON },
+#elif defined (__aarch64__)
+    { "neon", VLC_CPU_ARM_NEON },
+    { "sve", VLC_CPU_ARM_NEON | VLC_CPU_ARM_SVE },
+    { "sve2", VLC_CPU_ARM_NEON | VLC_CPU_ARM_SVE | VLC_CPU_ARM_SVE2 },
+#endif
+};
+
+/**
+ * Returns the CPU flags that the compiler already assumes, which are
+ * available even if run-time detection failed.
+ */
+static unsigned vlc_CPU_baseline(void)
+{
+    unsigned flags = 0;
+#if defined (__i386__) || defined (__x86_64__)
+# ifdef __MMX__
+    flags |= VLC_CPU_MMX;
+# endif
+# ifdef __SSE__
+    flags |= VLC_CPU_MMXEXT | VLC_CPU_SSE;
+# endif
+# ifdef __SSE2__
+    flags |= VLC_CPU_SSE2;
+# endif
+# ifdef __SSE3__
+    flags |= VLC_CPU_SSE3;
+# endif
+# ifdef __SSSE3__
+    flags |= VLC_CPU_SSSE3;
+# endif
+# ifdef __SSE4_1__
+    flags |= VLC_CPU_SSE4_1;
+# endif
+# ifdef __SSE4_2__
+    flags |= VLC_CPU_SSE4_2;
+# endif
+# ifdef __AVX__
+    flags |= VLC_CPU_AVX;
+# endif
+# ifdef __AVX2__
+    flags |= VLC_CPU_AVX2;
+# endif
+#elif defined (__powerpc__) || defined (__ppc__) || defined (__ppc64__)
+# ifdef ALTIVEC
+    flags |= VLC_CPU_ALTIVEC;
+# endif
+#elif defined (__arm__)
+# if (VLC_CPU_ARM_ARCH >= 6)
+    flags |= VLC_CPU_ARMv6;
+# endif
+# ifdef __ARM_NEON__
+    flags |= VLC_CPU_ARM_NEON;
+# endif
+#elif defined (__aarch64__)
+# ifdef __ARM_NEON
+    flags |= VLC_CPU_ARM_NEON;
+# endif
+# ifdef __ARM_FEATURE_SVE
+    flags |= VLC_CPU_ARM_SVE;
+# endif
+#endif
+    return flags;
+}
+
+#undef vlc_CPU_SelectKernel
+const struct vlc_cpu_kernel *
+vlc_CPU_SelectKernel(vlc_object_t *obj, const char *name,
+                     const struct vlc_cpu_kernel *table, size_t count)
+{
+    unsigned flags = vlc_CPU() | vlc_CPU_baseline();
+    char *level = var_InheritString(obj, "cpu-level");
+
+    if (level != NULL)
+    {
+        size_t i = 0;
+
+        while (i < ARRAY_SIZE(cpu_levels)
+            && strcasecmp(level, cpu_levels[i].name))
+            i++;
+
+        if (i < ARRAY_SIZE(cpu_levels))
+            flags &= cpu_levels[i].flags;
+        else
+            msg_Warn(obj, "unknown CPU level \"%s\"", level);
+        free(level);
+    }
+
+    for (size_t i = 0; i < count; i++)
+        if ((table[i].flags & ~flags) == 0)
+        {
+            msg_Dbg(obj, "using %s implementation of %s", table[i].isa, name);
+            return &table[i];
+        }
+
+    msg_Err(obj, "no supported implementation of %s", name);
+    return NULL;
+}
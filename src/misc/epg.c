@@ -130,40 +130,67 @@ static void vlc_epg_Clean( vlc_epg_t *p_epg )
     free( p_epg->psz_name );
 }
 
-bool vlc_epg_AddEvent( vlc_epg_t *p_epg, vlc_epg_event_t *p_evt )
+/* Returns the position of the first event starting at or after i_start,
+ * or -1 if all of the events start before */
+static ssize_t vlc_epg_Bisect( const vlc_epg_t *p_epg, int64_t i_start )
 {
-    ssize_t i_pos = -1;
+    if( p_epg->i_event == 0 )
+        return -1;
 
     /* Insertions are supposed in sequential order first */
-    if( p_epg->i_event )
+    if( p_epg->pp_event[0]->i_start > i_start )
+        return 0;
+    if( p_epg->pp_event[p_epg->i_event - 1]->i_start < i_start )
+        return -1;
+
+    /* Do bisect search lower start time entry */
+    size_t i_lower = 0;
+    size_t i_upper = p_epg->i_event - 1;
+
+    while( i_lower < i_upper )
     {
-        if( p_epg->pp_event[0]->i_start > p_evt->i_start )
-        {
-            i_pos = 0;
-        }
-        else if ( p_epg->pp_event[p_epg->i_event - 1]->i_start >= p_evt->i_start )
-        {
-            /* Do bisect search lower start time entry */
-            size_t i_lower = 0;
-            size_t i_upper = p_epg->i_event - 1;
+        size_t i_split = ( i_lower + i_upper ) / 2;
+        vlc_epg_event_t *p_cur = p_epg->pp_event[i_split];
 
-            while( i_lower < i_upper )
-            {
-                size_t i_split = ( i_lower + i_upper ) / 2;
-                vlc_epg_event_t *p_cur = p_epg->pp_event[i_split];
+        if( p_cur->i_start < i_start )
+            i_lower = i_split + 1;
+        else
+            i_upper = i_split;
+    }
+    return i_lower;
+}
 
-                if( p_cur->i_start < p_evt->i_start )
-                {
-                    i_lower = i_split + 1;
-                }
-                else if ( p_cur->i_start >= p_evt->i_start )
-                {
-                    i_upper = i_split;
-                }
-            }
-            i_pos = i_lower;
-        }
+static bool vlc_epg_StrEquals( const char *a, const char *b )
+{
+    if( a == NULL || b == NULL )
+        return a == b;
+    return !strcmp( a, b );
+}
+
+bool vlc_epg_event_Equals( const vlc_epg_event_t *a, const vlc_epg_event_t *b )
+{
+    if( a->i_start != b->i_start || a->i_duration != b->i_duration ||
+        a->i_id != b->i_id || a->i_rating != b->i_rating ||
+        a->i_description_items != b->i_description_items ||
+        !vlc_epg_StrEquals( a->psz_name, b->psz_name ) ||
+        !vlc_epg_StrEquals( a->psz_short_description, b->psz_short_description ) ||
+        !vlc_epg_StrEquals( a->psz_description, b->psz_description ) )
+        return false;
+
+    for( int i = 0; i < a->i_description_items; i++ )
+    {
+        if( !vlc_epg_StrEquals( a->description_items[i].psz_key,
+                                b->description_items[i].psz_key ) ||
+            !vlc_epg_StrEquals( a->description_items[i].psz_value,
+                                b->description_items[i].psz_value ) )
+            return false;
     }
+    return true;
+}
+
+bool vlc_epg_AddEvent( vlc_epg_t *p_epg, vlc_epg_event_t *p_evt )
+{
+    ssize_t i_pos = vlc_epg_Bisect( p_epg, p_evt->i_start );
 
     if( i_pos != -1 )
     {
@@ -203,19 +230,30 @@ void vlc_epg_Delete( vlc_epg_t *p_epg )
 
 void vlc_epg_SetCurrent( vlc_epg_t *p_epg, int64_t i_start )
 {
-    size_t i;
     p_epg->p_current = NULL;
     if( i_start < 0 )
         return;
 
-    for( i = 0; i < p_epg->i_event; i++ )
-    {
-        if( p_epg->pp_event[i]->i_start == i_start )
-        {
-            p_epg->p_current = p_epg->pp_event[i];
-            break;
-        }
-    }
+    ssize_t i_pos = vlc_epg_Bisect( p_epg, i_start );
+    if( i_pos != -1 && p_epg->pp_event[i_pos]->i_start == i_start )
+        p_epg->p_current = p_epg->pp_event[i_pos];
+}
+
+bool vlc_epg_Equals( const vlc_epg_t *a, const vlc_epg_t *b )
+{
+    if( a->i_id != b->i_id || a->i_source_id != b->i_source_id ||
+        a->b_present != b->b_present || a->i_event != b->i_event ||
+        !vlc_epg_StrEquals( a->psz_name, b->psz_name ) )
+        return false;
+
+    if( ( a->p_current == NULL ) != ( b->p_current == NULL ) ||
+        ( a->p_current && a->p_current->i_start != b->p_current->i_start ) )
+        return false;
+
+    for( size_t i = 0; i < a->i_event; i++ )
+        if( !vlc_epg_event_Equals( a->pp_event[i], b->pp_event[i] ) )
+            return false;
+    return true;
 }
 
 vlc_epg_t * vlc_epg_Duplicate( const vlc_epg_t *p_src )
@@ -410,6 +410,32 @@ void es_format_InitFromVideo( es_format_t *p_es, const video_format_t *p_fmt )
     video_format_Copy( &p_es->video, p_fmt );
 }
 
+static int es_format_CopyExtraLanguages(es_format_t *restrict dst,
+                                       const es_format_t *src)
+{
+    if (src->i_extra_languages == 0)
+        return VLC_SUCCESS;
+
+    assert(src->p_extra_languages != NULL);
+    dst->p_extra_languages = calloc(src->i_extra_languages,
+                                    sizeof (*dst->p_extra_languages));
+    if (unlikely(dst->p_extra_languages == NULL))
+    {
+        dst->i_extra_languages = 0;
+        return VLC_ENOMEM;
+    }
+
+    for (unsigned i = 0; i < src->i_extra_languages; i++)
+    {
+        if (src->p_extra_languages[i].psz_language != NULL)
+            dst->p_extra_languages[i].psz_language = strdup(src->p_extra_languages[i].psz_language);
+        if (src->p_extra_languages[i].psz_description != NULL)
+            dst->p_extra_languages[i].psz_description = strdup(src->p_extra_languages[i].psz_description);
+    }
+    dst->i_extra_languages = src->i_extra_languages;
+    return VLC_SUCCESS;
+}
+
 int es_format_Copy(es_format_t *restrict dst, const es_format_t *src)
 {
     int ret = VLC_SUCCESS;
@@ -458,28 +484,105 @@ int es_format_Copy(es_format_t *restrict dst, const es_format_t *src)
         }
     }
 
-    if (src->i_extra_languages > 0)
+    if (es_format_CopyExtraLanguages(dst, src))
+        ret = VLC_ENOMEM;
+    return ret;
+}
+
+/* Duplicates a string, or takes *old instead if it is the same string */
+static char *es_format_KeepString(char **old, const char *src, int *ret)
+{
+    if (src == NULL)
+        return NULL;
+
+    char *str = *old;
+    if (str != NULL && strcmp(str, src) == 0)
+    {
+        *old = NULL;
+        return str;
+    }
+
+    str = strdup(src);
+    if (unlikely(str == NULL))
+        *ret = VLC_ENOMEM;
+    return str;
+}
+
+int es_format_Update(es_format_t *restrict dst, const es_format_t *src)
+{
+    int ret = VLC_SUCCESS;
+    es_format_t old = *dst;
+
+    assert(dst != src);
+    *dst = *src;
+
+    /* The buffers taken from the old format are cleared from it, and the
+     * remaining ones are released at the end */
+    dst->psz_language = es_format_KeepString(&old.psz_language,
+                                             src->psz_language, &ret);
+    dst->psz_description = es_format_KeepString(&old.psz_description,
+                                                src->psz_description, &ret);
+
+    if (src->i_extra > 0)
     {
-        assert(src->p_extra_languages != NULL);
-        dst->p_extra_languages = calloc(dst->i_extra_languages,
-                                        sizeof (*dst->p_extra_languages));
-        if (likely(dst->p_extra_languages != NULL))
+        assert(src->p_extra != NULL);
+        if (old.i_extra == src->i_extra
+         && memcmp(old.p_extra, src->p_extra, src->i_extra) == 0)
+        {
+            dst->p_extra = old.p_extra;
+            old.p_extra = NULL;
+            old.i_extra = 0;
+        }
+        else
         {
-            for (unsigned i = 0; i < dst->i_extra_languages; i++)
+            dst->p_extra = malloc(src->i_extra);
+            if (likely(dst->p_extra != NULL))
+                memcpy(dst->p_extra, src->p_extra, src->i_extra);
+            else
             {
-                if (src->p_extra_languages[i].psz_language != NULL)
-                    dst->p_extra_languages[i].psz_language = strdup(src->p_extra_languages[i].psz_language);
-                if (src->p_extra_languages[i].psz_description != NULL)
-                    dst->p_extra_languages[i].psz_description = strdup(src->p_extra_languages[i].psz_description);
+                dst->i_extra = 0;
+                ret = VLC_ENOMEM;
             }
-            dst->i_extra_languages = src->i_extra_languages;
+        }
+    }
+    else
+        dst->p_extra = NULL;
+
+    if (src->i_cat == VIDEO_ES && src->video.p_palette != NULL)
+    {
+        if (old.i_cat == VIDEO_ES && old.video.p_palette != NULL
+         && memcmp(old.video.p_palette, src->video.p_palette,
+                   sizeof (*src->video.p_palette)) == 0)
+        {
+            dst->video.p_palette = old.video.p_palette;
+            old.video.p_palette = NULL;
         }
         else
         {
-            dst->i_extra_languages = 0;
-            ret = VLC_ENOMEM;
+            dst->video.p_palette = malloc(sizeof (*dst->video.p_palette));
+            if (likely(dst->video.p_palette != NULL))
+                memcpy(dst->video.p_palette, src->video.p_palette,
+                       sizeof (*dst->video.p_palette));
+            else
+                ret = VLC_ENOMEM;
         }
     }
+
+    if (src->i_cat == SPU_ES)
+    {
+        char *none = NULL;
+        dst->subs.psz_encoding =
+            es_format_KeepString(old.i_cat == SPU_ES ? &old.subs.psz_encoding
+                                                     : &none,
+                                 src->subs.psz_encoding, &ret);
+    }
+
+    dst->i_extra_languages = 0;
+    dst->p_extra_languages = NULL;
+    if (es_format_CopyExtraLanguages(dst, src))
+        ret = VLC_ENOMEM;
+
+    es_format_Clean(&old);
     return ret;
 }
 
@@ -0,0 +1,326 @@
+/*****************************************************************************
+ * executor.c: process-wide pool of worker threads
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <vlc_common.h>
+#include <vlc_list.h>
+#include <vlc_threads.h>
+#include <vlc_interrupt.h>
+
+#include "executor.h"
+
+/* Idle threads exit after this delay */
+#define EXECUTOR_IDLE_TIMEOUT VLC_TICK_FROM_SEC(5)
+
+/* The tasks of the shared executor typically block for the whole duration of
+ * a preparsing or a fetch, so keep a few threads even on small machines. */
+#define EXECUTOR_MIN_SHARED_THREADS 4
+
+#define EXECUTOR_PRIORITY_COUNT \
+    (VLC_EXECUTOR_PRIORITY_HIGH - VLC_EXECUTOR_PRIORITY_LOW + 1)
+
+struct executor_thread
+{
+    struct vlc_executor *owner;
+    vlc_thread_t thread;
+    bool terminated; /**< true once the thread exited, and must be joined */
+    struct vlc_executor_task *task; /**< running task, or NULL */
+    vlc_interrupt_t *interrupt; /**< interrupt context of the running task */
+    struct vlc_list node;
+};
+
+struct vlc_executor
+{
+    vlc_mutex_t lock;
+
+    /** queues of pending tasks, indexed by priority (highest first) */
+    struct vlc_list queues[EXECUTOR_PRIORITY_COUNT];
+    unsigned pending; /**< number of queued tasks */
+    vlc_cond_t queue_wait; /**< wait for the queues to be non-empty */
+
+    struct vlc_list threads; /**< list of executor_thread instances */
+    unsigned nthreads; /**< number of non-terminated threads */
+    unsigned idle; /**< number of threads waiting for a task */
+    unsigned max_threads;
+    bool closing;
+};
+
+static vlc_mutex_t shared_lock = VLC_STATIC_MUTEX;
+static struct vlc_executor *shared_executor;
+static unsigned shared_refs;
+
+static struct vlc_list *QueueOf(struct vlc_executor *executor, int priority)
+{
+    if (priority > VLC_EXECUTOR_PRIORITY_HIGH)
+        priority = VLC_EXECUTOR_PRIORITY_HIGH;
+    if (priority < VLC_EXECUTOR_PRIORITY_LOW)
+        priority = VLC_EXECUTOR_PRIORITY_LOW;
+
+    return &executor->queues[VLC_EXECUTOR_PRIORITY_HIGH - priority];
+}
+
+static struct vlc_executor_task *QueueTake(struct vlc_executor *executor)
+{
+    vlc_mutex_assert(&executor->lock);
+
+    vlc_tick_t deadline = vlc_tick_now() + EXECUTOR_IDLE_TIMEOUT;
+    bool timeout = false;
+
+    executor->idle++;
+    while (!timeout && !executor->closing && executor->pending == 0)
+        timeout = vlc_cond_timedwait(&executor->queue_wait,
+                                     &executor->lock, deadline) != 0;
+    executor->idle--;
+
+    /* Do not drop a task that was queued right as the timeout expired */
+    if (executor->pending == 0)
+        return NULL;
+
+    for (size_t i = 0; i < ARRAY_SIZE(executor->queues); ++i)
+    {
+        struct vlc_executor_task *task =
+            vlc_list_first_entry_or_null(&executor->queues[i],
+                                         struct vlc_executor_task, node);
+        if (task != NULL)
+        {
+            vlc_list_remove(&task->node);
+            executor->pending--;
+            return task;
+        }
+    }
+    vlc_assert_unreachable();
+}
+
+static void *Thread(void *data)
+{
+    struct executor_thread *thread = data;
+    struct vlc_executor *executor = thread->owner;
+
+    vlc_mutex_lock(&executor->lock);
+    for (;;)
+    {
+        struct vlc_executor_task *task = QueueTake(executor);
+        if (task == NULL)
+            break;
+
+        /* An interrupt context cannot be revived once killed, so each task
+         * gets a fresh one. */
+        vlc_interrupt_t *interrupt = vlc_interrupt_create();
+        thread->task = task;
+        thread->interrupt = interrupt;
+        vlc_mutex_unlock(&executor->lock);
+
+        vlc_interrupt_t *old = vlc_interrupt_set(interrupt);
+        task->pf_run(task->opaque);
+        /* the task may have been released by the callback */
+        vlc_interrupt_set(old);
+
+        vlc_mutex_lock(&executor->lock);
+        thread->task = NULL;
+        thread->interrupt = NULL;
+        vlc_mutex_unlock(&executor->lock);
+
+        if (interrupt != NULL)
+            vlc_interrupt_destroy(interrupt);
+
+        vlc_mutex_lock(&executor->lock);
+    }
+
+    /* joined by the next spawn, or on deletion */
+    thread->terminated = true;
+    assert(executor->nthreads > 0);
+    executor->nthreads--;
+    vlc_mutex_unlock(&executor->lock);
+
+    return NULL;
+}
+
+static void ReapThreads(struct vlc_executor *executor)
+{
+    vlc_mutex_assert(&executor->lock);
+
+    struct executor_thread *thread;
+    vlc_list_foreach(thread, &executor->threads, node)
+    {
+        if (thread->terminated)
+        {
+            vlc_join(thread->thread, NULL);
+            vlc_list_remove(&thread->node);
+            free(thread);
+        }
+    }
+}
+
+static void SpawnThread(struct vlc_executor *executor)
+{
+    vlc_mutex_assert(&executor->lock);
+
+    ReapThreads(executor);
+
+    struct executor_thread *thread = malloc(sizeof(*thread));
+    if (unlikely(thread == NULL))
+        return;
+
+    thread->owner = executor;
+    thread->terminated = false;
+    thread->task = NULL;
+    thread->interrupt = NULL;
+
+    if (vlc_clone(&thread->thread, Thread, thread, VLC_THREAD_PRIORITY_LOW))
+    {
+        free(thread);
+        return;
+    }
+    executor->nthreads++;
+    vlc_list_append(&thread->node, &executor->threads);
+}
+
+struct vlc_executor *vlc_executor_New(unsigned max_threads)
+{
+    assert(max_threads > 0);
+
+    struct vlc_executor *executor = malloc(sizeof(*executor));
+    if (unlikely(executor == NULL))
+        return NULL;
+
+    vlc_mutex_init(&executor->lock);
+    for (size_t i = 0; i < ARRAY_SIZE(executor->queues); ++i)
+        vlc_list_init(&executor->queues[i]);
+    executor->pending = 0;
+    vlc_cond_init(&executor->queue_wait);
+    vlc_list_init(&executor->threads);
+    executor->nthreads = 0;
+    executor->idle = 0;
+    executor->max_threads = max_threads;
+    executor->closing = false;
+    return executor;
+}
+
+void vlc_executor_Delete(struct vlc_executor *executor)
+{
+    vlc_mutex_lock(&executor->lock);
+    assert(executor->pending == 0);
+
+    executor->closing = true;
+    vlc_cond_broadcast(&executor->queue_wait);
+    vlc_mutex_unlock(&executor->lock);
+
+    /* no new threads can be spawned anymore */
+    struct executor_thread *thread;
+    vlc_list_foreach(thread, &executor->threads, node)
+    {
+        vlc_join(thread->thread, NULL);
+        free(thread);
+    }
+
+    vlc_cond_destroy(&executor->queue_wait);
+    vlc_mutex_destroy(&executor->lock);
+    free(executor);
+}
+
+struct vlc_executor *vlc_executor_Hold(void)
+{
+    struct vlc_executor *executor;
+
+    vlc_mutex_lock(&shared_lock);
+    if (shared_executor == NULL)
+    {
+        unsigned max_threads = vlc_GetCPUCount();
+        if (max_threads < EXECUTOR_MIN_SHARED_THREADS)
+            max_threads = EXECUTOR_MIN_SHARED_THREADS;
+
+        shared_executor = vlc_executor_New(max_threads);
+    }
+    executor = shared_executor;
+    if (likely(executor != NULL))
+        shared_refs++;
+    vlc_mutex_unlock(&shared_lock);
+
+    return executor;
+}
+
+void vlc_executor_Release(struct vlc_executor *executor)
+{
+    vlc_mutex_lock(&shared_lock);
+    assert(executor == shared_executor);
+    assert(shared_refs > 0);
+    if (--shared_refs == 0)
+    {
+        vlc_executor_Delete(executor);
+        shared_executor = NULL;
+    }
+    vlc_mutex_unlock(&shared_lock);
+}
+
+void vlc_executor_Submit(struct vlc_executor *executor,
+                         struct vlc_executor_task *task)
+{
+    vlc_mutex_lock(&executor->lock);
+    assert(!executor->closing);
+
+    vlc_list_append(&task->node, QueueOf(executor, task->priority));
+    executor->pending++;
+
+    if (executor->pending > executor->idle
+     && executor->nthreads < executor->max_threads)
+        SpawnThread(executor);
+    vlc_cond_signal(&executor->queue_wait);
+    vlc_mutex_unlock(&executor->lock);
+}
+
+bool vlc_executor_Cancel(struct vlc_executor *executor,
+                         struct vlc_executor_task *task)
+{
+    bool dequeued = false;
+
+    vlc_mutex_lock(&executor->lock);
+
+    struct vlc_executor_task *queued;
+    for (size_t i = 0; i < ARRAY_SIZE(executor->queues) && !dequeued; ++i)
+    {
+        vlc_list_foreach(queued, &executor->queues[i], node)
+        {
+            if (queued == task)
+            {
+                vlc_list_remove(&task->node);
+                executor->pending--;
+                dequeued = true;
+                break;
+            }
+        }
+    }
+
+    if (!dequeued)
+    {
+        struct executor_thread *thread;
+        vlc_list_foreach(thread, &executor->threads, node)
+        {
+            if (thread->task == task && thread->interrupt != NULL)
+                vlc_interrupt_kill(thread->interrupt);
+        }
+    }
+
+    vlc_mutex_unlock(&executor->lock);
+    return dequeued;
+}
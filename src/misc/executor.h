@@ -0,0 +1,114 @@
+/*****************************************************************************
+ * executor.h: process-wide pool of worker threads
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_EXECUTOR_H
+# define LIBVLC_EXECUTOR_H 1
+
+#include <vlc_list.h>
+
+/**
+ * Pool of worker threads executing queued tasks.
+ *
+ * Threads are spawned on demand, up to a fixed limit, and exit after being
+ * idle for a few seconds. Each task runs with its own interrupt context
+ * (see \ref vlc_interrupt_set), which is killed if the task is canceled
+ * while running.
+ */
+struct vlc_executor;
+
+enum vlc_executor_priority
+{
+    VLC_EXECUTOR_PRIORITY_LOW = -1,
+    VLC_EXECUTOR_PRIORITY_NORMAL = 0,
+    VLC_EXECUTOR_PRIORITY_HIGH = 1,
+};
+
+struct vlc_executor_task
+{
+    /**
+     * Callback executing the task on an executor thread
+     *
+     * The task structure is not accessed by the executor once this callback
+     * has been called, so it may be released from within the callback.
+     */
+    void (*pf_run)(void *opaque);
+    void *opaque;
+    /** One of \ref vlc_executor_priority */
+    int priority;
+
+    /* Private, owned by the executor */
+    struct vlc_list node;
+};
+
+/**
+ * Create an executor with its own threads
+ *
+ * \param max_threads maximum number of concurrent threads (at least 1)
+ */
+struct vlc_executor *vlc_executor_New(unsigned max_threads);
+
+/**
+ * Delete an executor
+ *
+ * All tasks must have been executed or canceled. This waits for the idle
+ * threads to exit.
+ */
+void vlc_executor_Delete(struct vlc_executor *executor);
+
+/**
+ * Get a reference to the process-wide executor
+ *
+ * The shared executor is bounded by the number of CPUs, so that all its users
+ * (preparser, art fetcher, thumbnailer...) compete for the same threads
+ * instead of each oversubscribing the machine.
+ *
+ * \return the shared executor, or NULL on error
+ */
+struct vlc_executor *vlc_executor_Hold(void);
+
+/**
+ * Release a reference obtained with \ref vlc_executor_Hold
+ */
+void vlc_executor_Release(struct vlc_executor *executor);
+
+/**
+ * Queue a task
+ *
+ * Tasks of higher priority are started first; tasks of equal priority are
+ * started in submission order. The task structure must remain valid until its
+ * callback is called or until it is successfully canceled.
+ */
+void vlc_executor_Submit(struct vlc_executor *executor,
+                         struct vlc_executor_task *task);
+
+/**
+ * Cancel a task
+ *
+ * If the task is still queued, it is removed and will never run. If it is
+ * running, its interrupt context is killed, so that interruptible waits
+ * (vlc_poll_i11e(), vlc_mwait_i11e()...) abort and vlc_killed() returns true.
+ *
+ * \retval true if the task was dequeued (its callback will not be called)
+ * \retval false if the task was running or already finished
+ */
+bool vlc_executor_Cancel(struct vlc_executor *executor,
+                         struct vlc_executor_task *task);
+
+#endif
@@ -27,11 +27,26 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_memstats.h>
 #include "libvlc.h"
 
+#define FIFO_SEGMENT_SIZE 256
+
+/**
+ * Segment of a lock-less single producer single consumer queue
+ */
+struct fifo_segment
+{
+    _Atomic(struct fifo_segment *) next;
+    atomic_uint written; /**< Slots published by the producer */
+    unsigned read; /**< Slots consumed by the consumer */
+    block_t *slots[FIFO_SEGMENT_SIZE];
+};
+
 /**
  * Internal state for block queues
  */
@@ -44,10 +59,130 @@ struct block_fifo_t
     block_t             **pp_last;
     size_t              i_depth;
     size_t              i_size;
+
+    /* Single producer single consumer mode */
+    struct
+    {
+        struct fifo_segment *head; /**< Consumer segment */
+        struct fifo_segment *tail; /**< Producer segment */
+        atomic_size_t depth;
+        atomic_size_t size;
+        atomic_bool waiting; /**< Consumer is parked on the condition */
+    } spsc;
 };
 
+static bool vlc_fifo_IsSPSC(const vlc_fifo_t *fifo)
+{
+    return fifo->spsc.head != NULL;
+}
+
+static struct fifo_segment *fifo_segment_New(void)
+{
+    struct fifo_segment *seg = malloc(sizeof (*seg));
+    if (likely(seg != NULL))
+    {
+        atomic_init(&seg->next, NULL);
+        atomic_init(&seg->written, 0);
+        seg->read = 0;
+    }
+    return seg;
+}
+
+/* Producer side */
+static void fifo_spsc_Push(block_fifo_t *fifo, block_t *block)
+{
+    struct fifo_segment *seg = fifo->spsc.tail;
+    unsigned w = atomic_load_explicit(&seg->written, memory_order_relaxed);
+
+    if (w == FIFO_SEGMENT_SIZE)
+    {
+        struct fifo_segment *next = fifo_segment_New();
+        if (unlikely(next == NULL))
+        {
+            block_Release(block);
+            return;
+        }
+
+        atomic_store_explicit(&seg->next, next, memory_order_release);
+        fifo->spsc.tail = seg = next;
+        w = 0;
+    }
+
+    atomic_fetch_add_explicit(&fifo->spsc.depth, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&fifo->spsc.size, block->i_buffer,
+                              memory_order_relaxed);
+    vlc_memstats_Add(VLC_MEMSTATS_FIFO, block->i_buffer);
+    seg->slots[w] = block;
+    /* Sequentially consistent, to be ordered with the waiting flag load */
+    atomic_store(&seg->written, w + 1);
+}
+
+/* Consumer side: returns the segment holding the next block, if any */
+static struct fifo_segment *fifo_spsc_Front(block_fifo_t *fifo)
+{
+    struct fifo_segment *seg = fifo->spsc.head;
+
+    if (seg->read == FIFO_SEGMENT_SIZE)
+    {
+        struct fifo_segment *next =
+            atomic_load_explicit(&seg->next, memory_order_acquire);
+        if (next == NULL)
+            return NULL;
+
+        fifo->spsc.head = next;
+        free(seg);
+        seg = next;
+    }
+
+    if (seg->read == atomic_load(&seg->written))
+        return NULL;
+    return seg;
+}
+
+static block_t *fifo_spsc_Pop(block_fifo_t *fifo)
+{
+    struct fifo_segment *seg = fifo_spsc_Front(fifo);
+    if (seg == NULL)
+        return NULL;
+
+    block_t *block = seg->slots[seg->read++];
+
+    atomic_fetch_sub_explicit(&fifo->spsc.depth, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&fifo->spsc.size, block->i_buffer,
+                              memory_order_relaxed);
+    vlc_memstats_Add(VLC_MEMSTATS_FIFO, -(ssize_t)block->i_buffer);
+    block->p_next = NULL;
+    return block;
+}
+
+static void fifo_spsc_CleanupWait(void *data)
+{
+    block_fifo_t *fifo = data;
+
+    atomic_store(&fifo->spsc.waiting, false);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+static block_t *fifo_spsc_Get(block_fifo_t *fifo)
+{
+    block_t *block = fifo_spsc_Pop(fifo);
+    if (block != NULL)
+        return block;
+
+    /* Park until the producer publishes a block */
+    vlc_mutex_lock(&fifo->lock);
+    atomic_store(&fifo->spsc.waiting, true);
+    vlc_cleanup_push(fifo_spsc_CleanupWait, fifo);
+    while ((block = fifo_spsc_Pop(fifo)) == NULL)
+        vlc_cond_wait(&fifo->wait, &fifo->lock);
+    vlc_cleanup_pop();
+    fifo_spsc_CleanupWait(fifo);
+    return block;
+}
+
 void vlc_fifo_Lock(vlc_fifo_t *fifo)
 {
+    assert(!vlc_fifo_IsSPSC(fifo));
     vlc_mutex_lock(&fifo->lock);
 }
 
@@ -95,15 +230,19 @@ void vlc_fifo_QueueUnlocked(block_fifo_t *fifo, block_t *block)
 
     *(fifo->pp_last) = block;
 
+    size_t size = 0;
+
     while (block != NULL)
     {
         fifo->pp_last = &block->p_next;
         fifo->i_depth++;
-        fifo->i_size += block->i_buffer;
+        size += block->i_buffer;
 
         block = block->p_next;
     }
 
+    fifo->i_size += size;
+    vlc_memstats_Add(VLC_MEMSTATS_FIFO, size);
     vlc_fifo_Signal(fifo);
 }
 
@@ -125,6 +264,7 @@ block_t *vlc_fifo_DequeueUnlocked(block_fifo_t *fifo)
     fifo->i_depth--;
     assert(fifo->i_size >= block->i_buffer);
     fifo->i_size -= block->i_buffer;
+    vlc_memstats_Add(VLC_MEMSTATS_FIFO, -(ssize_t)block->i_buffer);
 
     return block;
 }
@@ -138,6 +278,7 @@ block_t *vlc_fifo_DequeueAllUnlocked(block_fifo_t *fifo)
     fifo->p_first = NULL;
     fifo->pp_last = &fifo->p_first;
     fifo->i_depth = 0;
+    vlc_memstats_Add(VLC_MEMSTATS_FIFO, -(ssize_t)fifo->i_size);
     fifo->i_size = 0;
 
     return block;
@@ -154,13 +295,40 @@ block_fifo_t *block_FifoNew( void )
     p_fifo->p_first = NULL;
     p_fifo->pp_last = &p_fifo->p_first;
     p_fifo->i_depth = p_fifo->i_size = 0;
+    p_fifo->spsc.head = p_fifo->spsc.tail = NULL;
+
+    return p_fifo;
+}
+
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    block_fifo_t *p_fifo = block_FifoNew();
+    if( !p_fifo )
+        return NULL;
 
+    struct fifo_segment *seg = fifo_segment_New();
+    if( unlikely(seg == NULL) )
+    {
+        block_FifoRelease( p_fifo );
+        return NULL;
+    }
+
+    p_fifo->spsc.head = p_fifo->spsc.tail = seg;
+    atomic_init( &p_fifo->spsc.depth, 0 );
+    atomic_init( &p_fifo->spsc.size, 0 );
+    atomic_init( &p_fifo->spsc.waiting, false );
     return p_fifo;
 }
 
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
+    if( vlc_fifo_IsSPSC( p_fifo ) )
+    {
+        block_FifoEmpty( p_fifo );
+        free( p_fifo->spsc.head );
+    }
     block_ChainRelease( p_fifo->p_first );
+    vlc_memstats_Add( VLC_MEMSTATS_FIFO, -(ssize_t)p_fifo->i_size );
     vlc_cond_destroy( &p_fifo->wait );
     vlc_mutex_destroy( &p_fifo->lock );
     free( p_fifo );
@@ -170,6 +338,13 @@ void block_FifoEmpty(block_fifo_t *fifo)
 {
     block_t *block;
 
+    if (vlc_fifo_IsSPSC(fifo))
+    {
+        while ((block = fifo_spsc_Pop(fifo)) != NULL)
+            block_Release(block);
+        return;
+    }
+
     vlc_fifo_Lock(fifo);
     block = vlc_fifo_DequeueAllUnlocked(fifo);
     vlc_fifo_Unlock(fifo);
@@ -178,6 +353,26 @@ void block_FifoEmpty(block_fifo_t *fifo)
 
 void block_FifoPut(block_fifo_t *fifo, block_t *block)
 {
+    if (vlc_fifo_IsSPSC(fifo))
+    {
+        while (block != NULL)
+        {
+            block_t *next = block->p_next;
+
+            block->p_next = NULL;
+            fifo_spsc_Push(fifo, block);
+            block = next;
+        }
+
+        if (atomic_load(&fifo->spsc.waiting))
+        {
+            vlc_mutex_lock(&fifo->lock);
+            vlc_cond_signal(&fifo->wait);
+            vlc_mutex_unlock(&fifo->lock);
+        }
+        return;
+    }
+
     vlc_fifo_Lock(fifo);
     vlc_fifo_QueueUnlocked(fifo, block);
     vlc_fifo_Unlock(fifo);
@@ -189,6 +384,9 @@ block_t *block_FifoGet(block_fifo_t *fifo)
 
     vlc_testcancel();
 
+    if (vlc_fifo_IsSPSC(fifo))
+        return fifo_spsc_Get(fifo);
+
     vlc_fifo_Lock(fifo);
     while (vlc_fifo_IsEmpty(fifo))
     {
@@ -202,10 +400,31 @@ block_t *block_FifoGet(block_fifo_t *fifo)
     return block;
 }
 
+block_t *block_FifoTryGet(block_fifo_t *fifo)
+{
+    block_t *block;
+
+    if (vlc_fifo_IsSPSC(fifo))
+        return fifo_spsc_Pop(fifo);
+
+    vlc_fifo_Lock(fifo);
+    block = vlc_fifo_DequeueUnlocked(fifo);
+    vlc_fifo_Unlock(fifo);
+
+    return block;
+}
+
 block_t *block_FifoShow( block_fifo_t *p_fifo )
 {
     block_t *b;
 
+    if( vlc_fifo_IsSPSC( p_fifo ) )
+    {
+        struct fifo_segment *seg = fifo_spsc_Front( p_fifo );
+        assert(seg != NULL);
+        return seg->slots[seg->read];
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     assert(p_fifo->p_first != NULL);
     b = p_fifo->p_first;
@@ -219,6 +438,9 @@ size_t block_FifoSize (block_fifo_t *fifo)
 {
     size_t size;
 
+    if (vlc_fifo_IsSPSC(fifo))
+        return atomic_load_explicit(&fifo->spsc.size, memory_order_relaxed);
+
     vlc_mutex_lock (&fifo->lock);
     size = fifo->i_size;
     vlc_mutex_unlock (&fifo->lock);
@@ -230,6 +452,9 @@ size_t block_FifoCount (block_fifo_t *fifo)
 {
     size_t depth;
 
+    if (vlc_fifo_IsSPSC(fifo))
+        return atomic_load_explicit(&fifo->spsc.depth, memory_order_relaxed);
+
     vlc_mutex_lock (&fifo->lock);
     depth = fifo->i_depth;
     vlc_mutex_unlock (&fifo->lock);
@@ -27,10 +27,12 @@
 #include <assert.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <libvlc.h>
 #include <vlc_filter.h>
 #include <vlc_modules.h>
 #include "../misc/variables.h"
+#include "../misc/executor.h"
 
 /* */
 
@@ -176,6 +178,148 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_delete(p_blend);
 }
 
+/* Row bands */
+#define FILTER_ROWS_MIN_BAND  16 /* rows, not worth a thread below */
+#define FILTER_ROWS_MAX_TASKS 15 /* threads helping the caller */
+
+struct filter_rows
+{
+    void (*pf_band)( void *, unsigned, unsigned );
+    void *opaque;
+    unsigned rows;
+    unsigned band;
+    unsigned bands;
+    atomic_uint next; /**< next band to process */
+
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    unsigned pending; /**< submitted tasks not finished nor canceled */
+};
+
+static void FilterRowsRun( struct filter_rows *r )
+{
+    unsigned i;
+    while( (i = atomic_fetch_add_explicit( &r->next, 1,
+                                           memory_order_relaxed )) < r->bands )
+    {
+        unsigned first = i * r->band;
+        r->pf_band( r->opaque, first, __MIN(r->band, r->rows - first) );
+    }
+}
+
+static void FilterRowsTask( void *opaque )
+{
+    struct filter_rows *r = opaque;
+
+    FilterRowsRun( r );
+
+    vlc_mutex_lock( &r->lock );
+    if( --r->pending == 0 )
+        vlc_cond_signal( &r->wait );
+    vlc_mutex_unlock( &r->lock );
+}
+
+static void FilterParallel( unsigned rows, unsigned band, unsigned helpers,
+                            void (*pf_band)( void *, unsigned, unsigned ),
+                            void *opaque )
+{
+    unsigned bands = (rows + band - 1) / band;
+
+    struct vlc_executor *executor = NULL;
+    if( helpers > 0 && bands > 1 )
+        executor = vlc_executor_Hold();
+    if( executor == NULL )
+    {
+        pf_band( opaque, 0, rows );
+        return;
+    }
+
+    struct filter_rows r = {
+        .pf_band = pf_band,
+        .opaque = opaque,
+        .rows = rows,
+        .band = band,
+        .bands = bands,
+    };
+    atomic_init( &r.next, 0 );
+    vlc_mutex_init( &r.lock );
+    vlc_cond_init( &r.wait );
+
+    helpers = __MIN(helpers, r.bands - 1);
+    struct vlc_executor_task tasks[FILTER_ROWS_MAX_TASKS];
+    r.pending = helpers;
+    for( unsigned i = 0; i < helpers; i++ )
+    {
+        tasks[i].pf_run = FilterRowsTask;
+        tasks[i].opaque = &r;
+        tasks[i].priority = VLC_EXECUTOR_PRIORITY_HIGH;
+        vlc_executor_Submit( executor, &tasks[i] );
+    }
+
+    FilterRowsRun( &r );
+
+    /* All bands are taken: the helpers that did not start have nothing to
+     * do, do not wait for the executor to schedule them */
+    for( unsigned i = 0; i < helpers; i++ )
+        if( vlc_executor_Cancel( executor, &tasks[i] ) )
+        {
+            vlc_mutex_lock( &r.lock );
+            r.pending--;
+            vlc_mutex_unlock( &r.lock );
+        }
+
+    vlc_mutex_lock( &r.lock );
+    while( r.pending > 0 )
+        vlc_cond_wait( &r.wait, &r.lock );
+    vlc_mutex_unlock( &r.lock );
+
+    vlc_cond_destroy( &r.wait );
+    vlc_mutex_destroy( &r.lock );
+    vlc_executor_Release( executor );
+}
+
+void filter_ParallelRows( unsigned rows,
+                          void (*pf_band)( void *, unsigned, unsigned ),
+                          void *opaque )
+{
+    unsigned helpers = __MIN(vlc_GetCPUCount(), FILTER_ROWS_MAX_TASKS + 1) - 1;
+    unsigned bands = __MIN(rows / FILTER_ROWS_MIN_BAND, 4 * (helpers + 1));
+
+    if( bands <= 1 )
+    {
+        pf_band( opaque, 0, rows );
+        return;
+    }
+    /* even, for subsampled chroma planes */
+    FilterParallel( rows, ((rows + bands - 1) / bands + 1) & ~1u, helpers,
+                    pf_band, opaque );
+}
+
+struct filter_jobs
+{
+    void (*pf_job)( void *, unsigned );
+    void *opaque;
+};
+
+static void FilterJobsBand( void *opaque, unsigned first, unsigned count )
+{
+    const struct filter_jobs *j = opaque;
+
+    for( unsigned i = first; i < first + count; i++ )
+        j->pf_job( j->opaque, i );
+}
+
+void filter_ParallelJobs( unsigned jobs,
+                          void (*pf_job)( void *, unsigned ),
+                          void *opaque )
+{
+    unsigned helpers = __MIN(vlc_GetCPUCount(), FILTER_ROWS_MAX_TASKS + 1) - 1;
+    struct filter_jobs j = { .pf_job = pf_job, .opaque = opaque };
+
+    if( jobs > 0 )
+        FilterParallel( jobs, 1, helpers, FilterJobsBand, &j );
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
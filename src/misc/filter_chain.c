@@ -40,6 +40,12 @@ typedef struct chained_filter_t
     struct chained_filter_t *prev, *next;
     vlc_mouse_t *mouse;
     picture_t *pending;
+    /* Pipelined mode, protected by the chain pipe lock */
+    vlc_thread_t thread;
+    vlc_cond_t wait; /**< Input queued or state change */
+    picture_t *queue, **queue_last; /**< Pictures waiting for this filter */
+    unsigned queue_count;
+    bool busy; /**< A picture is being filtered */
 } chained_filter_t;
 
 /* Only use this with filter objects from _this_ C module */
@@ -61,12 +67,25 @@ struct filter_chain_t
     bool b_allow_fmt_out_change; /**< Can the output format be changed? */
     const char *filter_cap; /**< Filter modules capability */
     const char *conv_cap; /**< Converter modules capability */
+
+    struct
+    {
+        vlc_mutex_t lock;
+        vlc_cond_t wait; /**< Queue space, output or idle filter */
+        picture_t *out, **out_last; /**< Pictures out of the last filter */
+        unsigned depth; /**< Maximum pictures queued before each filter */
+        unsigned in_flight; /**< Pictures queued or being filtered */
+        bool running;
+        bool stopping;
+        bool flushing;
+    } pipe; /**< Pipelined mode, one thread per filter */
 };
 
 /**
  * Local prototypes
  */
 static void FilterDeletePictures( picture_t * );
+static void FilterChainPipeStop( filter_chain_t * );
 
 static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     const char *cap, const char *conv_cap, bool fmt_out_change,
@@ -91,6 +110,15 @@ static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     chain->b_allow_fmt_out_change = fmt_out_change;
     chain->filter_cap = cap;
     chain->conv_cap = conv_cap;
+    vlc_mutex_init( &chain->pipe.lock );
+    vlc_cond_init( &chain->pipe.wait );
+    chain->pipe.out = NULL;
+    chain->pipe.out_last = &chain->pipe.out;
+    chain->pipe.depth = 0;
+    chain->pipe.in_flight = 0;
+    chain->pipe.running = false;
+    chain->pipe.stopping = false;
+    chain->pipe.flushing = false;
     return chain;
 }
 
@@ -153,12 +181,15 @@ filter_chain_t *filter_chain_NewVideo( vlc_object_t *obj, bool allow_change,
  */
 void filter_chain_Delete( filter_chain_t *p_chain )
 {
+    FilterChainPipeStop( p_chain );
     while( p_chain->first != NULL )
         filter_chain_DeleteFilter( p_chain, &p_chain->first->filter );
 
     es_format_Clean( &p_chain->fmt_in );
     es_format_Clean( &p_chain->fmt_out );
 
+    vlc_cond_destroy( &p_chain->pipe.wait );
+    vlc_mutex_destroy( &p_chain->pipe.lock );
     free( p_chain );
 }
 /**
@@ -167,6 +198,7 @@ void filter_chain_Delete( filter_chain_t *p_chain )
 void filter_chain_Reset( filter_chain_t *p_chain, const es_format_t *p_fmt_in,
                          const es_format_t *p_fmt_out )
 {
+    FilterChainPipeStop( p_chain );
     while( p_chain->first != NULL )
         filter_chain_DeleteFilter( p_chain, &p_chain->first->filter );
 
@@ -187,6 +219,7 @@ static filter_t *filter_chain_AppendInner( filter_chain_t *chain,
     const es_format_t *fmt_in, const es_format_t *fmt_out )
 {
     vlc_object_t *parent = chain->callbacks.sys;
+    assert( !chain->pipe.running );
     chained_filter_t *chained =
         vlc_custom_create( parent, sizeof(*chained), "filter" );
     if( unlikely(chained == NULL) )
@@ -289,6 +322,7 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
     vlc_object_t *obj = chain->callbacks.sys;
     chained_filter_t *chained = (chained_filter_t *)filter;
 
+    assert( !chain->pipe.running );
     /* Remove it from the chain */
     if( chained->prev != NULL )
         chained->prev->next = chained->next;
@@ -414,8 +448,169 @@ static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic
     return p_pic;
 }
 
+/* Queues a picture before the given filter, or as chain output if NULL.
+ * Waits for queue space, and drops the picture on flush or stop.
+ * Must be called with the pipe lock held. */
+static void FilterChainPipePush( filter_chain_t *chain, chained_filter_t *f,
+                                 picture_t *pic )
+{
+    if( f == NULL )
+    {
+        *chain->pipe.out_last = pic;
+        chain->pipe.out_last = &pic->p_next;
+        vlc_cond_broadcast( &chain->pipe.wait );
+        return;
+    }
+
+    while( f->queue_count >= chain->pipe.depth
+        && !chain->pipe.stopping && !chain->pipe.flushing )
+        vlc_cond_wait( &chain->pipe.wait, &chain->pipe.lock );
+
+    if( chain->pipe.stopping || chain->pipe.flushing )
+    {
+        picture_Release( pic );
+        return;
+    }
+
+    *f->queue_last = pic;
+    f->queue_last = &pic->p_next;
+    f->queue_count++;
+    chain->pipe.in_flight++;
+    vlc_cond_signal( &f->wait );
+}
+
+static picture_t *FilterChainPipePop( filter_chain_t *chain )
+{
+    picture_t *pic = chain->pipe.out;
+    if( pic != NULL )
+    {
+        chain->pipe.out = pic->p_next;
+        if( chain->pipe.out == NULL )
+            chain->pipe.out_last = &chain->pipe.out;
+        pic->p_next = NULL;
+    }
+    return pic;
+}
+
+static void *FilterChainPipeThread( void *data )
+{
+    chained_filter_t *f = data;
+    filter_t *filter = &f->filter;
+    filter_chain_t *chain = filter->owner.sys;
+
+    vlc_mutex_lock( &chain->pipe.lock );
+    for( ;; )
+    {
+        while( !chain->pipe.stopping
+            && ( f->queue == NULL || chain->pipe.flushing ) )
+            vlc_cond_wait( &f->wait, &chain->pipe.lock );
+        if( chain->pipe.stopping )
+            break;
+
+        picture_t *pic = f->queue;
+        f->queue = pic->p_next;
+        if( f->queue == NULL )
+            f->queue_last = &f->queue;
+        f->queue_count--;
+        pic->p_next = NULL;
+        f->busy = true;
+        vlc_cond_broadcast( &chain->pipe.wait );
+        vlc_mutex_unlock( &chain->pipe.lock );
+
+        pic = filter->pf_video_filter( filter, pic );
+
+        vlc_mutex_lock( &chain->pipe.lock );
+        while( pic != NULL )
+        {
+            picture_t *next = pic->p_next;
+            pic->p_next = NULL;
+            FilterChainPipePush( chain, f->next, pic );
+            pic = next;
+        }
+        /* Only accounted out once the outputs are queued, so that a drain
+         * cannot miss them */
+        chain->pipe.in_flight--;
+        f->busy = false;
+        vlc_cond_broadcast( &chain->pipe.wait );
+    }
+    vlc_mutex_unlock( &chain->pipe.lock );
+    return NULL;
+}
+
+/* Joins the threads of the filters before the given one */
+static void FilterChainPipeJoin( filter_chain_t *chain, chained_filter_t *end )
+{
+    vlc_mutex_lock( &chain->pipe.lock );
+    chain->pipe.stopping = true;
+    vlc_cond_broadcast( &chain->pipe.wait );
+    for( chained_filter_t *f = chain->first; f != end; f = f->next )
+        vlc_cond_signal( &f->wait );
+    vlc_mutex_unlock( &chain->pipe.lock );
+
+    for( chained_filter_t *f = chain->first; f != end; f = f->next )
+    {
+        vlc_join( f->thread, NULL );
+        vlc_cond_destroy( &f->wait );
+        FilterDeletePictures( f->queue );
+        f->queue = NULL;
+    }
+
+    FilterDeletePictures( chain->pipe.out );
+    chain->pipe.out = NULL;
+    chain->pipe.out_last = &chain->pipe.out;
+    chain->pipe.in_flight = 0;
+    chain->pipe.stopping = false;
+}
+
+static void FilterChainPipeStop( filter_chain_t *chain )
+{
+    if( !chain->pipe.running )
+        return;
+    FilterChainPipeJoin( chain, NULL );
+    chain->pipe.running = false;
+}
+
+int filter_chain_VideoPipeline( filter_chain_t *chain, unsigned depth )
+{
+    FilterChainPipeStop( chain );
+    if( depth == 0 || chain->first == NULL )
+        return VLC_SUCCESS;
+
+    chain->pipe.depth = depth;
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+    {
+        FilterDeletePictures( f->pending );
+        f->pending = NULL;
+        f->queue = NULL;
+        f->queue_last = &f->queue;
+        f->queue_count = 0;
+        f->busy = false;
+        vlc_cond_init( &f->wait );
+
+        if( vlc_clone( &f->thread, FilterChainPipeThread, f,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            vlc_cond_destroy( &f->wait );
+            FilterChainPipeJoin( chain, f );
+            return VLC_ENOMEM;
+        }
+    }
+    chain->pipe.running = true;
+    return VLC_SUCCESS;
+}
+
 picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
 {
+    if( p_chain->pipe.running )
+    {
+        vlc_mutex_lock( &p_chain->pipe.lock );
+        if( p_pic )
+            FilterChainPipePush( p_chain, p_chain->first, p_pic );
+        p_pic = FilterChainPipePop( p_chain );
+        vlc_mutex_unlock( &p_chain->pipe.lock );
+        return p_pic;
+    }
+
     if( p_pic )
     {
         p_pic = FilterChainVideoFilter( p_chain->first, p_pic );
@@ -437,8 +632,56 @@ picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
     return NULL;
 }
 
+picture_t *filter_chain_VideoDrain( filter_chain_t *p_chain )
+{
+    if( !p_chain->pipe.running )
+        return filter_chain_VideoFilter( p_chain, NULL );
+
+    vlc_mutex_lock( &p_chain->pipe.lock );
+    while( p_chain->pipe.out == NULL && p_chain->pipe.in_flight > 0 )
+        vlc_cond_wait( &p_chain->pipe.wait, &p_chain->pipe.lock );
+    picture_t *p_pic = FilterChainPipePop( p_chain );
+    vlc_mutex_unlock( &p_chain->pipe.lock );
+    return p_pic;
+}
+
+unsigned filter_chain_VideoPipelineCount( filter_chain_t *p_chain )
+{
+    if( !p_chain->pipe.running )
+        return 0;
+
+    vlc_mutex_lock( &p_chain->pipe.lock );
+    unsigned count = p_chain->pipe.in_flight;
+    for( picture_t *pic = p_chain->pipe.out; pic != NULL; pic = pic->p_next )
+        count++;
+    vlc_mutex_unlock( &p_chain->pipe.lock );
+    return count;
+}
+
 void filter_chain_VideoFlush( filter_chain_t *p_chain )
 {
+    if( p_chain->pipe.running )
+    {
+        /* Park the threads, so that the filters can be flushed from here */
+        vlc_mutex_lock( &p_chain->pipe.lock );
+        p_chain->pipe.flushing = true;
+        vlc_cond_broadcast( &p_chain->pipe.wait );
+        for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
+        {
+            while( f->busy )
+                vlc_cond_wait( &p_chain->pipe.wait, &p_chain->pipe.lock );
+            FilterDeletePictures( f->queue );
+            f->queue = NULL;
+            f->queue_last = &f->queue;
+            f->queue_count = 0;
+        }
+        FilterDeletePictures( p_chain->pipe.out );
+        p_chain->pipe.out = NULL;
+        p_chain->pipe.out_last = &p_chain->pipe.out;
+        p_chain->pipe.in_flight = 0;
+        vlc_mutex_unlock( &p_chain->pipe.lock );
+    }
+
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
@@ -448,6 +691,13 @@ void filter_chain_VideoFlush( filter_chain_t *p_chain )
 
         filter_Flush( p_filter );
     }
+
+    if( p_chain->pipe.running )
+    {
+        vlc_mutex_lock( &p_chain->pipe.lock );
+        p_chain->pipe.flushing = false;
+        vlc_mutex_unlock( &p_chain->pipe.lock );
+    }
 }
 
 void filter_chain_SubSource( filter_chain_t *p_chain, spu_t *spu,
@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * histogram.h: lock-free latency histograms
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_HISTOGRAM_H
+# define LIBVLC_HISTOGRAM_H 1
+
+# include <stdatomic.h>
+
+/**
+ * Number of buckets of a histogram
+ *
+ * Bucket 0 counts durations below 1 microsecond, bucket n counts durations
+ * from 2^(n-1) to 2^n - 1 microseconds, and the last bucket also counts all
+ * longer durations (about 8 seconds and more).
+ */
+#define VLC_HISTOGRAM_BUCKETS 24
+
+/**
+ * Distribution of durations
+ *
+ * Samples can be added and read concurrently from any thread without locking.
+ * Each field is atomic on its own, so a reader may see a sample in the count
+ * but not yet in its bucket; this is fine for statistics.
+ */
+struct vlc_histogram
+{
+    atomic_uintmax_t count;
+    atomic_uintmax_t total; /**< sum of all samples (in vlc_tick_t) */
+    atomic_uintmax_t max; /**< longest sample (in vlc_tick_t) */
+    atomic_uintmax_t buckets[VLC_HISTOGRAM_BUCKETS];
+};
+
+static inline void vlc_histogram_Init(struct vlc_histogram *h)
+{
+    atomic_init(&h->count, 0);
+    atomic_init(&h->total, 0);
+    atomic_init(&h->max, 0);
+    for (size_t i = 0; i < VLC_HISTOGRAM_BUCKETS; i++)
+        atomic_init(&h->buckets[i], 0);
+}
+
+static inline size_t vlc_histogram_Bucket(uintmax_t duration)
+{
+    unsigned long long us = US_FROM_VLC_TICK(duration);
+    if (us == 0)
+        return 0;
+
+    size_t i = sizeof (us) * 8 - vlc_clzll(us);
+    return (i < VLC_HISTOGRAM_BUCKETS) ? i : VLC_HISTOGRAM_BUCKETS - 1;
+}
+
+static inline void vlc_histogram_UpdateMax(struct vlc_histogram *h,
+                                           uintmax_t value)
+{
+    uintmax_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+
+    while (value > max
+        && !atomic_compare_exchange_weak_explicit(&h->max, &max, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed));
+}
+
+/**
+ * Add a sample
+ *
+ * Negative durations are accounted as zero.
+ */
+static inline void vlc_histogram_Add(struct vlc_histogram *h,
+                                     vlc_tick_t duration)
+{
+    uintmax_t value = (duration > 0) ? duration : 0;
+
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->total, value, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->buckets[vlc_histogram_Bucket(value)], 1,
+                              memory_order_relaxed);
+    vlc_histogram_UpdateMax(h, value);
+}
+
+/**
+ * Move all samples from a histogram to another one
+ *
+ * The source histogram is reset.
+ */
+static inline void vlc_histogram_Merge(struct vlc_histogram *restrict dst,
+                                       struct vlc_histogram *restrict src)
+{
+    atomic_fetch_add_explicit(&dst->count,
+        atomic_exchange_explicit(&src->count, 0, memory_order_relaxed),
+        memory_order_relaxed);
+    atomic_fetch_add_explicit(&dst->total,
+        atomic_exchange_explicit(&src->total, 0, memory_order_relaxed),
+        memory_order_relaxed);
+    vlc_histogram_UpdateMax(dst,
+        atomic_exchange_explicit(&src->max, 0, memory_order_relaxed));
+
+    for (size_t i = 0; i < VLC_HISTOGRAM_BUCKETS; i++)
+        atomic_fetch_add_explicit(&dst->buckets[i],
+            atomic_exchange_explicit(&src->buckets[i], 0,
+                                     memory_order_relaxed),
+            memory_order_relaxed);
+}
+
+#endif
@@ -73,12 +73,15 @@ static picture_t *ImageConvert( image_handler_t *, picture_t *,
                                 const video_format_t *, video_format_t * );
 
 static decoder_t *CreateDecoder( image_handler_t *, const es_format_t * );
+static decoder_t *GetDecoder( image_handler_t *, const es_format_t * );
 static encoder_t *CreateEncoder( vlc_object_t *, const video_format_t *,
                                  const video_format_t * );
 static void DeleteEncoder( encoder_t * );
 static filter_t *CreateConverter( vlc_object_t *, const es_format_t *,
                                const video_format_t * );
 static void DeleteConverter( filter_t * );
+static filter_t *GetConverter( image_handler_t *, const es_format_t *,
+                               const video_format_t * );
 
 vlc_fourcc_t image_Type2Fourcc( const char * );
 vlc_fourcc_t image_Ext2Fourcc( const char * );
@@ -116,9 +119,13 @@ void image_HandlerDelete( image_handler_t *p_image )
 {
     if( !p_image ) return;
 
-    decoder_Destroy( p_image->p_dec );
+    for( unsigned i = 0; i < IMAGE_HANDLER_CACHE_SIZE; i++ )
+    {
+        decoder_Destroy( p_image->pp_dec[i] );
+        if( p_image->pp_converter[i] )
+            DeleteConverter( p_image->pp_converter[i] );
+    }
     if( p_image->p_enc ) DeleteEncoder( p_image->p_enc );
-    if( p_image->p_converter ) DeleteConverter( p_image->p_converter );
 
     picture_fifo_Delete( p_image->outfifo );
 
@@ -149,38 +156,19 @@ static picture_t *ImageRead( image_handler_t *p_image, block_t *p_block,
         return NULL;
     }
 
-    /* Check if we can reuse the current decoder */
-    if( p_image->p_dec &&
-        p_image->p_dec->fmt_in.i_codec != p_es_in->video.i_chroma )
-    {
-        decoder_Destroy( p_image->p_dec );
-        p_image->p_dec = NULL;
-    }
-
-    /* Start a decoder */
-    if( !p_image->p_dec )
+    decoder_t *p_dec = GetDecoder( p_image, p_es_in );
+    if( !p_dec )
     {
-        p_image->p_dec = CreateDecoder( p_image, p_es_in );
-        if( !p_image->p_dec )
-        {
-            block_Release(p_block);
-            return NULL;
-        }
-        if( p_image->p_dec->fmt_out.i_cat != VIDEO_ES )
-        {
-            decoder_Destroy( p_image->p_dec );
-            p_image->p_dec = NULL;
-            block_Release(p_block);
-            return NULL;
-        }
+        block_Release(p_block);
+        return NULL;
     }
 
     p_block->i_pts = p_block->i_dts = vlc_tick_now();
-    int ret = p_image->p_dec->pf_decode( p_image->p_dec, p_block );
+    int ret = p_dec->pf_decode( p_dec, p_block );
     if( ret == VLCDEC_SUCCESS )
     {
         /* Drain */
-        p_image->p_dec->pf_decode( p_image->p_dec, NULL );
+        p_dec->pf_decode( p_dec, NULL );
 
         p_pic = picture_fifo_Pop( p_image->outfifo );
 
@@ -203,72 +191,48 @@ static picture_t *ImageRead( image_handler_t *p_image, block_t *p_block,
     }
 
     if( !p_fmt_out->i_chroma )
-        p_fmt_out->i_chroma = p_image->p_dec->fmt_out.video.i_chroma;
+        p_fmt_out->i_chroma = p_dec->fmt_out.video.i_chroma;
     if( !p_fmt_out->i_width && p_fmt_out->i_height )
-        p_fmt_out->i_width = (int64_t)p_image->p_dec->fmt_out.video.i_width *
-                             p_image->p_dec->fmt_out.video.i_sar_num *
+        p_fmt_out->i_width = (int64_t)p_dec->fmt_out.video.i_width *
+                             p_dec->fmt_out.video.i_sar_num *
                              p_fmt_out->i_height /
-                             p_image->p_dec->fmt_out.video.i_height /
-                             p_image->p_dec->fmt_out.video.i_sar_den;
+                             p_dec->fmt_out.video.i_height /
+                             p_dec->fmt_out.video.i_sar_den;
 
     if( !p_fmt_out->i_height && p_fmt_out->i_width )
-        p_fmt_out->i_height = (int64_t)p_image->p_dec->fmt_out.video.i_height *
-                              p_image->p_dec->fmt_out.video.i_sar_den *
+        p_fmt_out->i_height = (int64_t)p_dec->fmt_out.video.i_height *
+                              p_dec->fmt_out.video.i_sar_den *
                               p_fmt_out->i_width /
-                              p_image->p_dec->fmt_out.video.i_width /
-                              p_image->p_dec->fmt_out.video.i_sar_num;
+                              p_dec->fmt_out.video.i_width /
+                              p_dec->fmt_out.video.i_sar_num;
     if( !p_fmt_out->i_width )
-        p_fmt_out->i_width = p_image->p_dec->fmt_out.video.i_width;
+        p_fmt_out->i_width = p_dec->fmt_out.video.i_width;
     if( !p_fmt_out->i_height )
-        p_fmt_out->i_height = p_image->p_dec->fmt_out.video.i_height;
+        p_fmt_out->i_height = p_dec->fmt_out.video.i_height;
     if( !p_fmt_out->i_visible_width )
         p_fmt_out->i_visible_width = p_fmt_out->i_width;
     if( !p_fmt_out->i_visible_height )
         p_fmt_out->i_visible_height = p_fmt_out->i_height;
 
     /* Check if we need chroma conversion or resizing */
-    if( p_image->p_dec->fmt_out.video.i_chroma != p_fmt_out->i_chroma ||
-        p_image->p_dec->fmt_out.video.i_width != p_fmt_out->i_width ||
-        p_image->p_dec->fmt_out.video.i_height != p_fmt_out->i_height )
+    if( p_dec->fmt_out.video.i_chroma != p_fmt_out->i_chroma ||
+        p_dec->fmt_out.video.i_width != p_fmt_out->i_width ||
+        p_dec->fmt_out.video.i_height != p_fmt_out->i_height )
     {
-        if( p_image->p_converter &&
-            ( p_image->p_converter->fmt_in.video.i_chroma !=
-              p_image->p_dec->fmt_out.video.i_chroma ||
-              p_image->p_converter->fmt_out.video.i_chroma != p_fmt_out->i_chroma ) )
-        {
-            /* We need to restart a new filter */
-            DeleteConverter( p_image->p_converter );
-            p_image->p_converter = NULL;
-        }
-
-        /* Start a filter */
-        if( !p_image->p_converter )
-        {
-            p_image->p_converter =
-                CreateConverter( p_image->p_parent, &p_image->p_dec->fmt_out,
-                              p_fmt_out );
-
-            if( !p_image->p_converter )
-            {
-                picture_Release( p_pic );
-                return NULL;
-            }
-        }
-        else
+        filter_t *p_converter = GetConverter( p_image, &p_dec->fmt_out,
+                                              p_fmt_out );
+        if( !p_converter )
         {
-            /* Filters should handle on-the-fly size changes */
-            es_format_Clean( &p_image->p_converter->fmt_in );
-            es_format_Copy( &p_image->p_converter->fmt_in, &p_image->p_dec->fmt_out );
-            video_format_Clean( &p_image->p_converter->fmt_out.video );
-            video_format_Copy( &p_image->p_converter->fmt_out.video, p_fmt_out);
+            picture_Release( p_pic );
+            return NULL;
         }
 
-        p_pic = p_image->p_converter->pf_video_filter( p_image->p_converter, p_pic );
+        p_pic = p_converter->pf_video_filter( p_converter, p_pic );
     }
     else
     {
         video_format_Clean( p_fmt_out );
-        video_format_Copy( p_fmt_out, &p_image->p_dec->fmt_out.video );
+        video_format_Copy( p_fmt_out, &p_dec->fmt_out.video );
     }
 
     return p_pic;
@@ -387,47 +351,18 @@ static block_t *ImageWrite( image_handler_t *p_image, picture_t *p_pic,
        !BitMapFormatIsSimilar( &p_image->p_enc->fmt_in.video, p_fmt_in ) )
     {
         picture_t *p_tmp_pic;
+        es_format_t fmt_in;
+        es_format_Init( &fmt_in, VIDEO_ES, p_fmt_in->i_chroma );
+        fmt_in.video = *p_fmt_in;
 
-        if( p_image->p_converter &&
-            ( p_image->p_converter->fmt_in.video.i_chroma != p_fmt_in->i_chroma ||
-              p_image->p_converter->fmt_out.video.i_chroma !=
-              p_image->p_enc->fmt_in.video.i_chroma ||
-             !BitMapFormatIsSimilar( &p_image->p_converter->fmt_in.video, p_fmt_in ) ) )
-        {
-            /* We need to restart a new filter */
-            DeleteConverter( p_image->p_converter );
-            p_image->p_converter = NULL;
-        }
-
-        /* Start a filter */
-        if( !p_image->p_converter )
-        {
-            es_format_t fmt_in;
-            es_format_Init( &fmt_in, VIDEO_ES, p_fmt_in->i_chroma );
-            fmt_in.video = *p_fmt_in;
-
-            p_image->p_converter =
-                CreateConverter( p_image->p_parent, &fmt_in,
-                              &p_image->p_enc->fmt_in.video );
-
-            if( !p_image->p_converter )
-            {
-                return NULL;
-            }
-        }
-        else
-        {
-            /* Filters should handle on-the-fly size changes */
-            es_format_Clean( &p_image->p_converter->fmt_in );
-            es_format_InitFromVideo( &p_image->p_converter->fmt_in, p_fmt_in );
-            es_format_Clean( &p_image->p_converter->fmt_out );
-            es_format_Copy( &p_image->p_converter->fmt_out, &p_image->p_enc->fmt_in );
-        }
+        filter_t *p_converter = GetConverter( p_image, &fmt_in,
+                                              &p_image->p_enc->fmt_in.video );
+        if( !p_converter )
+            return NULL;
 
         picture_Hold( p_pic );
 
-        p_tmp_pic =
-            p_image->p_converter->pf_video_filter( p_image->p_converter, p_pic );
+        p_tmp_pic = p_converter->pf_video_filter( p_converter, p_pic );
 
         if( likely(p_tmp_pic != NULL) )
         {
@@ -526,42 +461,17 @@ static picture_t *ImageConvert( image_handler_t *p_image, picture_t *p_pic,
     if( !p_fmt_out->i_sar_num ) p_fmt_out->i_sar_num = p_fmt_in->i_sar_num;
     if( !p_fmt_out->i_sar_den ) p_fmt_out->i_sar_den = p_fmt_in->i_sar_den;
 
-    if( p_image->p_converter &&
-        ( p_image->p_converter->fmt_in.video.i_chroma != p_fmt_in->i_chroma ||
-          p_image->p_converter->fmt_out.video.i_chroma != p_fmt_out->i_chroma ) )
-    {
-        /* We need to restart a new filter */
-        DeleteConverter( p_image->p_converter );
-        p_image->p_converter = NULL;
-    }
-
-    /* Start a filter */
-    if( !p_image->p_converter )
-    {
-        es_format_t fmt_in;
-        es_format_Init( &fmt_in, VIDEO_ES, p_fmt_in->i_chroma );
-        fmt_in.video = *p_fmt_in;
-
-        p_image->p_converter =
-            CreateConverter( p_image->p_parent, &fmt_in, p_fmt_out );
+    es_format_t fmt_in;
+    es_format_Init( &fmt_in, VIDEO_ES, p_fmt_in->i_chroma );
+    fmt_in.video = *p_fmt_in;
 
-        if( !p_image->p_converter )
-        {
-            return NULL;
-        }
-    }
-    else
-    {
-        /* Filters should handle on-the-fly size changes */
-        es_format_Clean( &p_image->p_converter->fmt_in );
-        es_format_InitFromVideo( &p_image->p_converter->fmt_in, p_fmt_in );
-        es_format_Clean( &p_image->p_converter->fmt_out );
-        es_format_InitFromVideo( &p_image->p_converter->fmt_out, p_fmt_out );
-    }
+    filter_t *p_converter = GetConverter( p_image, &fmt_in, p_fmt_out );
+    if( !p_converter )
+        return NULL;
 
     picture_Hold( p_pic );
 
-    return p_image->p_converter->pf_video_filter( p_image->p_converter, p_pic );
+    return p_converter->pf_video_filter( p_converter, p_pic );
 }
 
 /**
@@ -699,6 +609,42 @@ static decoder_t *CreateDecoder( image_handler_t *p_image, const es_format_t *fm
     return p_dec;
 }
 
+/**
+ * Returns a decoder for the given format, reusing a cached one if possible.
+ */
+static decoder_t *GetDecoder( image_handler_t *p_image, const es_format_t *fmt )
+{
+    decoder_t **cache = p_image->pp_dec;
+    decoder_t *p_dec;
+    unsigned i;
+
+    for( i = 0; i < IMAGE_HANDLER_CACHE_SIZE && cache[i] != NULL; i++ )
+        if( cache[i]->fmt_in.i_codec == fmt->i_codec &&
+            cache[i]->fmt_in.video.i_chroma == fmt->video.i_chroma )
+            break;
+
+    if( i < IMAGE_HANDLER_CACHE_SIZE && cache[i] != NULL )
+        p_dec = cache[i];
+    else
+    {
+        p_dec = CreateDecoder( p_image, fmt );
+        if( !p_dec )
+            return NULL;
+        if( p_dec->fmt_out.i_cat != VIDEO_ES )
+        {
+            decoder_Destroy( p_dec );
+            return NULL;
+        }
+
+        if( i == IMAGE_HANDLER_CACHE_SIZE )
+            decoder_Destroy( cache[--i] ); /* Evict the least recently used */
+    }
+
+    memmove( &cache[1], &cache[0], i * sizeof( *cache ) );
+    cache[0] = p_dec;
+    return p_dec;
+}
+
 
 static encoder_t *CreateEncoder( vlc_object_t *p_this, const video_format_t *fmt_in,
                                  const video_format_t *fmt_out )
@@ -827,3 +773,49 @@ static void DeleteConverter( filter_t * p_filter )
 
     vlc_object_delete(p_filter);
 }
+
+/**
+ * Returns a converter between the given formats, reusing a cached one for
+ * the same chromas if possible.
+ */
+static filter_t *GetConverter( image_handler_t *p_image,
+                               const es_format_t *p_fmt_in,
+                               const video_format_t *p_fmt_out )
+{
+    filter_t **cache = p_image->pp_converter;
+    filter_t *p_filter;
+    unsigned i;
+
+    for( i = 0; i < IMAGE_HANDLER_CACHE_SIZE && cache[i] != NULL; i++ )
+        if( cache[i]->fmt_in.video.i_chroma == p_fmt_in->video.i_chroma &&
+            cache[i]->fmt_out.video.i_chroma == p_fmt_out->i_chroma &&
+            BitMapFormatIsSimilar( &cache[i]->fmt_in.video, &p_fmt_in->video ) &&
+            BitMapFormatIsSimilar( &cache[i]->fmt_out.video, p_fmt_out ) )
+            break;
+
+    if( i < IMAGE_HANDLER_CACHE_SIZE && cache[i] != NULL )
+    {
+        p_filter = cache[i];
+
+        /* Filters should handle on-the-fly size changes */
+        es_format_Clean( &p_filter->fmt_in );
+        es_format_Copy( &p_filter->fmt_in, p_fmt_in );
+        video_format_Clean( &p_filter->fmt_out.video );
+        video_format_Copy( &p_filter->fmt_out.video, p_fmt_out );
+        p_filter->fmt_out.video.i_x_offset = 0;
+        p_filter->fmt_out.video.i_y_offset = 0;
+    }
+    else
+    {
+        p_filter = CreateConverter( p_image->p_parent, p_fmt_in, p_fmt_out );
+        if( !p_filter )
+            return NULL;
+
+        if( i == IMAGE_HANDLER_CACHE_SIZE )
+            DeleteConverter( cache[--i] ); /* Evict the least recently used */
+    }
+
+    memmove( &cache[1], &cache[0], i * sizeof( *cache ) );
+    cache[0] = p_filter;
+    return p_filter;
+}
@@ -54,6 +54,9 @@ void vlc_interrupt_init(vlc_interrupt_t *ctx)
     ctx->interrupted = false;
     atomic_init(&ctx->killed, false);
     ctx->callback = NULL;
+#ifndef _WIN32
+    ctx->wakeup[0] = ctx->wakeup[1] = -1;
+#endif
 }
 
 vlc_interrupt_t *vlc_interrupt_create(void)
@@ -71,6 +74,12 @@ vlc_interrupt_t *vlc_interrupt_create(void)
 void vlc_interrupt_deinit(vlc_interrupt_t *ctx)
 {
     assert(ctx->callback == NULL);
+#ifndef _WIN32
+    if (ctx->wakeup[1] != ctx->wakeup[0])
+        vlc_close(ctx->wakeup[1]);
+    if (ctx->wakeup[0] != -1)
+        vlc_close(ctx->wakeup[0]);
+#endif
     vlc_mutex_destroy(&ctx->lock);
 }
 
@@ -284,6 +293,8 @@ int vlc_interrupt_forward_stop(void *const data[2])
 }
 
 #ifndef _WIN32
+# include <fcntl.h>
+
 static void vlc_poll_i11e_wake(void *opaque)
 {
     uint64_t value = 1;
@@ -295,35 +306,70 @@ static void vlc_poll_i11e_wake(void *opaque)
     vlc_restorecancel(canc);
 }
 
+/**
+ * Creates the wake-up file descriptors of an interruption context, if not
+ * done yet. They remain open and are reused until the context is
+ * deinitialized, so that interruptible waits need no extra system calls.
+ */
+static int vlc_poll_i11e_setup(vlc_interrupt_t *ctx)
+{
+    if (likely(ctx->wakeup[0] != -1))
+        return 0;
+
+    int fd[2];
+    int canc = vlc_savecancel();
+
+# if defined (HAVE_EVENTFD) && defined (EFD_CLOEXEC) && defined (EFD_NONBLOCK)
+    fd[0] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd[0] != -1)
+        fd[1] = fd[0];
+    else
+# endif
+    if (vlc_pipe(fd) == 0)
+    {
+        fcntl(fd[0], F_SETFL, fcntl(fd[0], F_GETFL) | O_NONBLOCK);
+        fcntl(fd[1], F_SETFL, fcntl(fd[1], F_GETFL) | O_NONBLOCK);
+    }
+    else
+    {
+        vlc_restorecancel(canc);
+        return -1;
+    }
+    vlc_restorecancel(canc);
+
+    ctx->wakeup[0] = fd[0];
+    ctx->wakeup[1] = fd[1];
+    return 0;
+}
+
+/**
+ * Consumes pending wake-ups, so that the next wait does not return early.
+ * The callback can no longer write once vlc_interrupt_finish() returned.
+ */
+static void vlc_poll_i11e_drain(vlc_interrupt_t *ctx)
+{
+    uint64_t dummy[4];
+    int canc = vlc_savecancel();
+
+    while (read(ctx->wakeup[0], dummy, sizeof (dummy)) > 0);
+    vlc_restorecancel(canc);
+}
+
 static void vlc_poll_i11e_cleanup(void *opaque)
 {
     vlc_interrupt_t *ctx = opaque;
-    int *fd = ctx->data;
 
-    vlc_interrupt_finish(ctx);
-    if (fd[1] != fd[0])
-        vlc_close(fd[1]);
-    vlc_close(fd[0]);
+    if (vlc_interrupt_finish(ctx))
+        vlc_poll_i11e_drain(ctx);
 }
 
 static int vlc_poll_i11e_inner(struct pollfd *restrict fds, unsigned nfds,
                                int timeout, vlc_interrupt_t *ctx,
                                struct pollfd *restrict ufd)
 {
-    int fd[2];
     int ret = -1;
-    int canc;
 
-    /* TODO: cache this */
-# if defined (HAVE_EVENTFD) && defined (EFD_CLOEXEC)
-    canc = vlc_savecancel();
-    fd[0] = eventfd(0, EFD_CLOEXEC);
-    vlc_restorecancel(canc);
-    if (fd[0] != -1)
-        fd[1] = fd[0];
-    else
-# endif
-    if (vlc_pipe(fd))
+    if (unlikely(vlc_poll_i11e_setup(ctx)))
     {
         vlc_testcancel();
         errno = ENOMEM;
@@ -335,10 +381,10 @@ static int vlc_poll_i11e_inner(struct pollfd *restrict fds, unsigned nfds,
         ufd[i].fd = fds[i].fd;
         ufd[i].events = fds[i].events;
     }
-    ufd[nfds].fd = fd[0];
+    ufd[nfds].fd = ctx->wakeup[0];
     ufd[nfds].events = POLLIN;
 
-    vlc_interrupt_prepare(ctx, vlc_poll_i11e_wake, fd);
+    vlc_interrupt_prepare(ctx, vlc_poll_i11e_wake, ctx->wakeup);
 
     vlc_cleanup_push(vlc_poll_i11e_cleanup, ctx);
     ret = poll(ufd, nfds + 1, timeout);
@@ -347,28 +393,37 @@ static int vlc_poll_i11e_inner(struct pollfd *restrict fds, unsigned nfds,
         fds[i].revents = ufd[i].revents;
 
     if (ret > 0 && ufd[nfds].revents)
-    {
-        uint64_t dummy;
-
-        read(fd[0], &dummy, sizeof (dummy));
         ret--;
-    }
     vlc_cleanup_pop();
 
+    /* The wake-up descriptor is only written upon interruption */
     if (vlc_interrupt_finish(ctx))
     {
+        vlc_poll_i11e_drain(ctx);
         errno = EINTR;
         ret = -1;
     }
-
-    canc = vlc_savecancel();
-    if (fd[1] != fd[0])
-        vlc_close(fd[1]);
-    vlc_close(fd[0]);
-    vlc_restorecancel(canc);
     return ret;
 }
 
+/**
+ * Checks whether the calling thread has a pending interruption, without
+ * waiting. Socket I/O can then be attempted without polling first.
+ */
+static bool vlc_interrupt_pending(void)
+{
+    vlc_interrupt_t *ctx = vlc_interrupt_var;
+    bool pending = false;
+
+    if (ctx != NULL)
+    {
+        vlc_mutex_lock(&ctx->lock);
+        pending = ctx->interrupted;
+        vlc_mutex_unlock(&ctx->lock);
+    }
+    return pending;
+}
+
 int vlc_poll_i11e(struct pollfd *fds, unsigned nfds, int timeout)
 {
     vlc_interrupt_t *ctx = vlc_interrupt_var;
@@ -397,7 +452,6 @@ int vlc_poll_i11e(struct pollfd *fds, unsigned nfds, int timeout)
     return ret;
 }
 
-# include <fcntl.h>
 # include <sys/uio.h>
 # ifdef HAVE_SYS_SOCKET_H
 #  include <sys/socket.h>
@@ -472,6 +526,16 @@ ssize_t vlc_write_i11e(int fd, const void *buf, size_t count)
 
 ssize_t vlc_recvmsg_i11e(int fd, struct msghdr *msg, int flags)
 {
+# ifdef MSG_DONTWAIT
+    /* Common case: data is already queued, a single system call is enough */
+    if (!vlc_interrupt_pending())
+    {
+        ssize_t val = recvmsg(fd, msg, flags | MSG_DONTWAIT);
+        if (val >= 0 || errno != EAGAIN)
+            return val;
+    }
+# endif
+
     struct pollfd ufd;
 
     ufd.fd = fd;
@@ -503,6 +567,16 @@ ssize_t vlc_recvfrom_i11e(int fd, void *buf, size_t len, int flags,
 
 ssize_t vlc_sendmsg_i11e(int fd, const struct msghdr *msg, int flags)
 {
+# ifdef MSG_DONTWAIT
+    /* Common case: there is room in the send buffer */
+    if (!vlc_interrupt_pending())
+    {
+        ssize_t val = sendmsg(fd, msg, flags | MSG_DONTWAIT);
+        if (val >= 0 || errno != EAGAIN)
+            return val;
+    }
+# endif
+
     struct pollfd ufd;
 
     ufd.fd = fd;
@@ -36,5 +36,8 @@ struct vlc_interrupt
     atomic_bool killed;
     void (*callback)(void *);
     void *data;
+#ifndef _WIN32
+    int wakeup[2]; /**< wake-up file descriptors for vlc_poll_i11e(), or -1 */
+#endif
 };
 #endif
@@ -0,0 +1,45 @@
+/*****************************************************************************
+ * memstats.c: memory accounting
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdatomic.h>
+
+#include <vlc_common.h>
+#include <vlc_memstats.h>
+
+static atomic_size_t counters[VLC_MEMSTATS_COUNT];
+
+void vlc_memstats_Add(enum vlc_memstats_type type, ssize_t bytes)
+{
+    assert(type < VLC_MEMSTATS_COUNT);
+    /* Unsigned wrap-around makes negative deltas subtract */
+    atomic_fetch_add_explicit(&counters[type], (size_t)bytes,
+                              memory_order_relaxed);
+}
+
+size_t vlc_memstats_Get(enum vlc_memstats_type type)
+{
+    assert(type < VLC_MEMSTATS_COUNT);
+    return atomic_load_explicit(&counters[type], memory_order_relaxed);
+}
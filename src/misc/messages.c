@@ -440,6 +440,293 @@ static struct vlc_logger *vlc_LogModuleCreate(vlc_object_t *parent)
     return &module->frontend;
 }
 
+/**
+ * Asynchronous message log.
+ *
+ * A message log that formats messages in the emitting thread, and passes them
+ * to its sink from a single writer thread. The queue is bounded: past the
+ * bound, and past the per-object debug rate limit, debug messages are
+ * dropped and counted. Errors, warnings and informations are never dropped.
+ */
+#define LOG_ASYNC_QUEUE_MAX 4096
+#define LOG_ASYNC_RATE_SLOTS 64
+
+typedef struct vlc_log_async_t
+{
+    struct vlc_log_async_t *next;
+    int type;
+    vlc_log_t meta;
+    char *module;
+    char *header;
+    char msg[];
+} vlc_log_async_t;
+
+struct vlc_log_rate
+{
+    uintptr_t object_id;
+    unsigned count;
+    unsigned dropped;
+    const char *object_type;
+};
+
+struct vlc_logger_async {
+    struct vlc_logger logger;
+    struct vlc_logger *sink;
+    vlc_thread_t thread;
+
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    vlc_log_async_t *head;
+    vlc_log_async_t **tailp;
+    unsigned length;
+    unsigned dropped; /* debug messages dropped because the queue was full */
+    bool closing;
+
+    /* Per-object debug messages rate limiting, in one second windows */
+    unsigned rate_limit;
+    vlc_tick_t rate_window;
+    struct vlc_log_rate rates[LOG_ASYNC_RATE_SLOTS];
+};
+
+static void vlc_LogAsyncQueue(struct vlc_logger_async *async,
+                              vlc_log_async_t *log)
+{
+    log->next = NULL;
+    *(async->tailp) = log;
+    async->tailp = &log->next;
+    async->length++;
+}
+
+static vlc_log_async_t *vlc_LogAsyncNew(int type, const vlc_log_t *item,
+                                        const char *format, va_list ap)
+{
+    va_list aq;
+
+    va_copy(aq, ap);
+    int len = vsnprintf(NULL, 0, format, aq);
+    va_end(aq);
+    if (len < 0)
+        return NULL;
+
+    vlc_log_async_t *log = malloc(sizeof (*log) + len + 1);
+    if (unlikely(log == NULL))
+        return NULL;
+
+    vsnprintf(log->msg, len + 1, format, ap);
+    log->type = type;
+    log->meta = *item;
+    /* The module name may be on the emitter stack */
+    log->module = strdup(item->psz_module);
+    log->header = item->psz_header ? strdup(item->psz_header) : NULL;
+    log->meta.psz_module = log->module ? log->module : "?";
+    log->meta.psz_header = log->header;
+    return log;
+}
+
+static void vlc_LogAsyncFree(vlc_log_async_t *log)
+{
+    free(log->module);
+    free(log->header);
+    free(log);
+}
+
+/* Returns true if the debug message is over its emitter rate limit */
+static bool vlc_LogAsyncRateExceeded(struct vlc_logger_async *async,
+                                     const vlc_log_t *item)
+{
+    vlc_tick_t now = vlc_tick_now();
+
+    if (now - async->rate_window >= VLC_TICK_FROM_SEC(1))
+    {   /* New window: report what was dropped in the last one */
+        for (size_t i = 0; i < LOG_ASYNC_RATE_SLOTS; i++)
+        {
+            struct vlc_log_rate *rate = &async->rates[i];
+            char buf[64];
+
+            if (rate->dropped == 0)
+                continue;
+
+            snprintf(buf, sizeof (buf), "%u debug message(s) dropped",
+                     rate->dropped);
+            vlc_log_t meta = {
+                .i_object_id = rate->object_id,
+                .psz_object_type = rate->object_type,
+                .psz_module = "logger",
+                .line = -1,
+                .tid = vlc_thread_id(),
+            };
+            vlc_log_async_t *log = malloc(sizeof (*log) + strlen(buf) + 1);
+            if (log != NULL)
+            {
+                strcpy(log->msg, buf);
+                log->type = VLC_MSG_WARN;
+                log->meta = meta;
+                log->module = NULL;
+                log->header = NULL;
+                vlc_LogAsyncQueue(async, log);
+            }
+        }
+        memset(async->rates, 0, sizeof (async->rates));
+        async->rate_window = now;
+    }
+
+    size_t slot = (item->i_object_id >> 4) % LOG_ASYNC_RATE_SLOTS;
+    struct vlc_log_rate *rate = &async->rates[slot];
+
+    if (rate->object_id != item->i_object_id)
+    {
+        if (rate->count > 0)
+            return false; /* collision: leave the other object unlimited */
+        rate->object_id = item->i_object_id;
+        rate->object_type = item->psz_object_type;
+    }
+    if (rate->count >= async->rate_limit)
+    {
+        rate->dropped++;
+        return true;
+    }
+    rate->count++;
+    return false;
+}
+
+static void vlc_vaLogAsync(void *d, int type, const vlc_log_t *item,
+                           const char *format, va_list ap)
+{
+    struct vlc_logger *logger = d;
+    struct vlc_logger_async *async =
+        container_of(logger, struct vlc_logger_async, logger);
+
+    if (type == VLC_MSG_DBG)
+    {
+        bool drop;
+
+        vlc_mutex_lock(&async->lock);
+        drop = async->length >= LOG_ASYNC_QUEUE_MAX;
+        if (drop)
+            async->dropped++;
+        else if (async->rate_limit > 0)
+            drop = vlc_LogAsyncRateExceeded(async, item);
+        vlc_mutex_unlock(&async->lock);
+        if (drop)
+            return;
+    }
+
+    /* Format outside the lock */
+    vlc_log_async_t *log = vlc_LogAsyncNew(type, item, format, ap);
+    if (unlikely(log == NULL))
+        return;
+
+    vlc_mutex_lock(&async->lock);
+    vlc_LogAsyncQueue(async, log);
+    vlc_cond_signal(&async->wait);
+    vlc_mutex_unlock(&async->lock);
+}
+
+static void *vlc_LogAsyncThread(void *data)
+{
+    struct vlc_logger_async *async = data;
+    struct vlc_logger *sink = async->sink;
+
+    vlc_mutex_lock(&async->lock);
+    for (;;)
+    {
+        while (async->head == NULL && !async->closing)
+            vlc_cond_wait(&async->wait, &async->lock);
+
+        /* Take the whole batch */
+        vlc_log_async_t *log = async->head;
+        unsigned dropped = async->dropped;
+
+        async->head = NULL;
+        async->tailp = &async->head;
+        async->length = 0;
+        async->dropped = 0;
+
+        if (log == NULL && async->closing)
+            break;
+        vlc_mutex_unlock(&async->lock);
+
+        if (dropped > 0)
+        {
+            vlc_log_t meta = {
+                .psz_object_type = "logger",
+                .psz_module = "logger",
+                .line = -1,
+                .tid = vlc_thread_id(),
+            };
+            vlc_LogCallback(sink, VLC_MSG_WARN, &meta,
+                            "%u debug message(s) dropped (queue full)",
+                            dropped);
+        }
+
+        for (vlc_log_async_t *next; log != NULL; log = next)
+        {
+            next = log->next;
+            vlc_LogCallback(sink, log->type, &log->meta, "%s", log->msg);
+            vlc_LogAsyncFree(log);
+        }
+        vlc_mutex_lock(&async->lock);
+    }
+    vlc_mutex_unlock(&async->lock);
+    return NULL;
+}
+
+static void vlc_LogAsyncClose(void *d)
+{
+    struct vlc_logger *logger = d;
+    struct vlc_logger_async *async =
+        container_of(logger, struct vlc_logger_async, logger);
+    struct vlc_logger *sink = async->sink;
+
+    /* The writer thread drains the queue before exiting */
+    vlc_mutex_lock(&async->lock);
+    async->closing = true;
+    vlc_cond_signal(&async->wait);
+    vlc_mutex_unlock(&async->lock);
+    vlc_join(async->thread, NULL);
+
+    vlc_cond_destroy(&async->wait);
+    vlc_mutex_destroy(&async->lock);
+    free(async);
+    sink->ops->destroy(sink);
+}
+
+static const struct vlc_logger_operations async_ops = {
+    vlc_vaLogAsync,
+    vlc_LogAsyncClose,
+};
+
+static struct vlc_logger *vlc_LogAsyncCreate(struct vlc_logger *sink,
+                                             unsigned rate_limit)
+{
+    struct vlc_logger_async *async = malloc(sizeof (*async));
+    if (unlikely(async == NULL))
+        return NULL;
+
+    async->logger.ops = &async_ops;
+    async->sink = sink;
+    vlc_mutex_init(&async->lock);
+    vlc_cond_init(&async->wait);
+    async->head = NULL;
+    async->tailp = &async->head;
+    async->length = 0;
+    async->dropped = 0;
+    async->closing = false;
+    async->rate_limit = rate_limit;
+    async->rate_window = vlc_tick_now();
+    memset(async->rates, 0, sizeof (async->rates));
+
+    if (vlc_clone(&async->thread, vlc_LogAsyncThread, async,
+                  VLC_THREAD_PRIORITY_LOW))
+    {
+        vlc_cond_destroy(&async->wait);
+        vlc_mutex_destroy(&async->lock);
+        free(async);
+        return NULL;
+    }
+    return &async->logger;
+}
+
 /**
  * Initializes the messages logging subsystem and drain the early messages to
  * the configured log.
@@ -450,6 +737,15 @@ void vlc_LogInit(libvlc_int_t *vlc)
     if (logger == NULL)
         logger = &discard_log;
 
+    else if (var_InheritBool(vlc, "log-async"))
+    {
+        struct vlc_logger *async =
+            vlc_LogAsyncCreate(logger, var_InheritInteger(vlc,
+                                                          "log-rate-limit"));
+        if (async != NULL)
+            logger = async;
+    }
+
     vlc_LogSwitch(vlc->obj.logger, logger);
 }
 
@@ -83,6 +83,12 @@ static const struct
     { ".webm",  "video/webm" },
     { ".mp4",   "video/mp4" },
 
+    /* adaptive streaming mime */
+    { ".m3u8",  "application/vnd.apple.mpegurl" },
+    { ".mpd",   "application/dash+xml" },
+    { ".ts",    "video/mp2t" },
+    { ".m4s",   "video/iso.segment" },
+
     /* end */
     { "",       "" }
 };
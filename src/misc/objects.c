@@ -172,7 +172,9 @@ void *vlc_custom_create (vlc_object_t *parent, size_t length,
 
     priv->parent = parent;
     priv->typename = typename;
-    priv->var_root = NULL;
+    priv->vars.slots = NULL;
+    priv->vars.mask = 0;
+    priv->vars.count = 0;
     vlc_mutex_init (&priv->var_lock);
     vlc_cond_init (&priv->var_wait);
     priv->resources = NULL;
@@ -32,11 +32,16 @@
 #endif
 #include <assert.h>
 #include <limits.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 
 #include <vlc_common.h>
 #include "picture.h"
+#include "libvlc.h"
 #include <vlc_image.h>
 #include <vlc_block.h>
+#include <vlc_filter.h>
 
 static void PictureDestroyContext( picture_t *p_picture )
 {
@@ -57,22 +62,13 @@ static void picture_DestroyDummy( picture_t *p_picture )
     (void) p_picture;
 }
 
-/**
- * Destroys a picture allocated with picture_NewFromFormat().
- */
-static void picture_DestroyFromFormat(picture_t *pic)
+VLC_WEAK void *picture_Allocate(int *restrict fdp, size_t *restrict sizep,
+                                int hugepages)
 {
-    picture_buffer_t *res = pic->p_sys;
-
-    if (res != NULL)
-        picture_Deallocate(res->fd, res->base, res->size);
-}
-
-VLC_WEAK void *picture_Allocate(int *restrict fdp, size_t size)
-{
-    assert((size % 64) == 0);
+    assert((*sizep % 64) == 0);
     *fdp = -1;
-    return aligned_alloc(64, size);
+    (void) hugepages;
+    return aligned_alloc(64, *sizep);
 }
 
 VLC_WEAK void picture_Deallocate(int fd, void *base, size_t size)
@@ -82,6 +78,177 @@ VLC_WEAK void picture_Deallocate(int fd, void *base, size_t size)
     assert((size % 64) == 0);
 }
 
+/*****************************************************************************
+ * Picture buffers cache
+ *****************************************************************************
+ * Picture pools are recreated whenever the video format changes, and very
+ * large buffers are expensive to map and fault in, especially with huge
+ * pages. While the cache is enabled, released buffers are kept and handed
+ * out again for pictures of the same size class.
+ *****************************************************************************/
+#define PICTURE_HUGE_PAGE_SIZE (UINT32_C(1) << 21)
+#define PICTURE_CACHE_MAX 32
+#define PICTURE_CACHE_BYTES_MAX \
+    ((SIZE_MAX >> 3) < (UINT32_C(1) << 30) ? (SIZE_MAX >> 3) \
+                                           : (UINT32_C(1) << 30))
+
+static struct
+{
+    vlc_mutex_t lock;
+    unsigned users;
+    int hugepages;
+    unsigned count;
+    size_t bytes;
+    picture_buffer_t buffers[PICTURE_CACHE_MAX]; /**< oldest first */
+    uint64_t hits;
+    uint64_t misses;
+} picture_cache = {
+    .lock = VLC_STATIC_MUTEX,
+};
+
+/* A cached buffer is reused for a smaller picture if it wastes less than an
+ * eighth of its size. Must be called with the cache lock held. */
+static int picture_cache_Find(size_t size)
+{
+    for (unsigned i = picture_cache.count; i-- > 0;)
+    {
+        size_t cached = picture_cache.buffers[i].size;
+
+        if (cached >= size && cached - size <= cached / 8)
+            return i;
+    }
+    return -1;
+}
+
+/* Removes a buffer from the cache. Must be called with the lock held. */
+static void picture_cache_Remove(unsigned i, picture_buffer_t *res)
+{
+    assert(i < picture_cache.count);
+    *res = picture_cache.buffers[i];
+    picture_cache.bytes -= res->size;
+    picture_cache.count--;
+    memmove(picture_cache.buffers + i, picture_cache.buffers + i + 1,
+            (picture_cache.count - i) * sizeof (*res));
+}
+
+static void *picture_buffer_Get(picture_buffer_t *res, size_t size)
+{
+    int hugepages = PICTURE_HUGEPAGES_NONE;
+
+    vlc_mutex_lock(&picture_cache.lock);
+    if (picture_cache.users > 0)
+    {
+        hugepages = picture_cache.hugepages;
+        if (hugepages != PICTURE_HUGEPAGES_NONE)
+            size = (size + PICTURE_HUGE_PAGE_SIZE - 1)
+                 & ~(size_t)(PICTURE_HUGE_PAGE_SIZE - 1);
+
+        int i = picture_cache_Find(size);
+        if (i >= 0)
+        {
+            picture_cache_Remove(i, res);
+            picture_cache.hits++;
+            vlc_mutex_unlock(&picture_cache.lock);
+            return res->base;
+        }
+        picture_cache.misses++;
+    }
+    vlc_mutex_unlock(&picture_cache.lock);
+
+    res->size = size;
+    return picture_Allocate(&res->fd, &res->size, hugepages);
+}
+
+static void picture_buffer_Put(const picture_buffer_t *res)
+{
+    picture_buffer_t evicted[PICTURE_CACHE_MAX];
+    unsigned n = 0;
+    bool cached = false;
+
+    vlc_mutex_lock(&picture_cache.lock);
+    if (picture_cache.users > 0 && res->size <= PICTURE_CACHE_BYTES_MAX)
+    {
+        /* Evict the oldest buffers to make room */
+        while (picture_cache.count >= PICTURE_CACHE_MAX
+            || picture_cache.bytes + res->size > PICTURE_CACHE_BYTES_MAX)
+            picture_cache_Remove(0, &evicted[n++]);
+
+        picture_cache.buffers[picture_cache.count++] = *res;
+        picture_cache.bytes += res->size;
+        cached = true;
+    }
+    vlc_mutex_unlock(&picture_cache.lock);
+
+    while (n > 0)
+    {
+        n--;
+        picture_Deallocate(evicted[n].fd, evicted[n].base, evicted[n].size);
+    }
+    if (!cached)
+        picture_Deallocate(res->fd, res->base, res->size);
+}
+
+void vlc_picture_cache_Init(libvlc_int_t *libvlc)
+{
+    int hugepages = var_InheritInteger(libvlc, "picture-hugepages");
+
+    if (hugepages <= PICTURE_HUGEPAGES_NONE
+     || hugepages > PICTURE_HUGEPAGES_EXPLICIT)
+        return;
+
+    vlc_mutex_lock(&picture_cache.lock);
+    if (picture_cache.users++ == 0)
+        picture_cache.hugepages = hugepages;
+    else if (picture_cache.hugepages != hugepages)
+        msg_Warn(libvlc, "picture huge pages mode already set by another "
+                 "instance");
+    vlc_mutex_unlock(&picture_cache.lock);
+    libvlc_priv(libvlc)->picture_cache = true;
+}
+
+void vlc_picture_cache_Deinit(libvlc_int_t *libvlc)
+{
+    if (!libvlc_priv(libvlc)->picture_cache)
+        return;
+
+    libvlc_priv(libvlc)->picture_cache = false;
+
+    picture_buffer_t evicted[PICTURE_CACHE_MAX];
+    unsigned n = 0;
+
+    vlc_mutex_lock(&picture_cache.lock);
+    uint64_t total = picture_cache.hits + picture_cache.misses;
+    if (total > 0)
+        msg_Dbg(libvlc, "picture buffers cache: %"PRIu64" allocations, "
+                "%.1f%% recycled", total, 100. * picture_cache.hits / total);
+
+    if (--picture_cache.users == 0)
+    {
+        /* Pictures still alive will be deallocated when released */
+        while (picture_cache.count > 0)
+            picture_cache_Remove(0, &evicted[n++]);
+        picture_cache.hits = picture_cache.misses = 0;
+    }
+    vlc_mutex_unlock(&picture_cache.lock);
+
+    while (n > 0)
+    {
+        n--;
+        picture_Deallocate(evicted[n].fd, evicted[n].base, evicted[n].size);
+    }
+}
+
+/**
+ * Destroys a picture allocated with picture_NewFromFormat().
+ */
+static void picture_DestroyFromFormat(picture_t *pic)
+{
+    picture_buffer_t *res = pic->p_sys;
+
+    if (res != NULL)
+        picture_buffer_Put(res);
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -280,12 +447,11 @@ picture_t *picture_NewFromFormat(const video_format_t *restrict fmt)
 
     picture_buffer_t *res = (void *)priv->extra;
 
-    unsigned char *buf = picture_Allocate(&res->fd, pic_size);
+    unsigned char *buf = picture_buffer_Get(res, pic_size);
     if (unlikely(buf == NULL))
         goto error;
 
     res->base = buf;
-    res->size = pic_size;
     res->offset = 0;
     pic->p_sys = res;
 
@@ -334,6 +500,102 @@ void picture_Destroy(picture_t *picture)
 /*****************************************************************************
  *
  *****************************************************************************/
+/* Planes below that size are copied by the calling thread alone */
+#define PLANE_COPY_PARALLEL_MIN (4 << 20)
+/* Planes above that size do not fit in the caches anyway: bypass them */
+#define PLANE_COPY_STREAM_MIN   (16 << 20)
+
+typedef void *(*plane_copy_fn)( void *, const void *, size_t );
+
+#ifdef __SSE2__
+static void *CopyStream( void *p_dst, const void *p_src, size_t i_size )
+{
+    uint8_t *dst = p_dst;
+    const uint8_t *src = p_src;
+    size_t i_head = -(uintptr_t)dst & 15;
+
+    if( i_head > i_size )
+        i_head = i_size;
+    memcpy( dst, src, i_head );
+    dst += i_head;
+    src += i_head;
+    i_size -= i_head;
+
+    for( ; i_size >= 64; i_size -= 64, src += 64, dst += 64 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)src );
+        __m128i b = _mm_loadu_si128( (const __m128i *)(src + 16) );
+        __m128i c = _mm_loadu_si128( (const __m128i *)(src + 32) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(src + 48) );
+        _mm_stream_si128( (__m128i *)dst, a );
+        _mm_stream_si128( (__m128i *)(dst + 16), b );
+        _mm_stream_si128( (__m128i *)(dst + 32), c );
+        _mm_stream_si128( (__m128i *)(dst + 48), d );
+    }
+    memcpy( dst, src, i_size );
+    return p_dst;
+}
+#endif
+
+struct plane_copy
+{
+    uint8_t       *p_dst;
+    const uint8_t *p_src;
+    size_t        i_dst_pitch;
+    size_t        i_src_pitch;
+    size_t        i_width;
+    bool          b_contiguous;
+    bool          b_stream;
+};
+
+static void plane_CopyBand( void *opaque, unsigned i_first, unsigned i_count )
+{
+    const struct plane_copy *c = opaque;
+    uint8_t *p_out = c->p_dst + i_first * c->i_dst_pitch;
+    const uint8_t *p_in = c->p_src + i_first * c->i_src_pitch;
+    plane_copy_fn copy = memcpy;
+
+#ifdef __SSE2__
+    if( c->b_stream )
+        copy = CopyStream;
+#endif
+
+    if( c->b_contiguous )
+    {
+        /* There are margins, but with the same width : perfect ! */
+        copy( p_out, p_in, c->i_src_pitch * i_count );
+    }
+    else
+    {
+        /* We need to proceed line by line */
+        for( unsigned i_line = i_count; i_line--; )
+        {
+            copy( p_out, p_in, c->i_width );
+            p_in += c->i_src_pitch;
+            p_out += c->i_dst_pitch;
+        }
+    }
+
+#ifdef __SSE2__
+    if( c->b_stream )
+        _mm_sfence();
+#endif
+}
+
+static void plane_CopyLines( struct plane_copy *c, unsigned i_height )
+{
+    const size_t i_size = c->i_width * i_height;
+
+    assert( c->p_src );
+    assert( c->p_dst );
+
+    c->b_stream = i_size >= PLANE_COPY_STREAM_MIN;
+    if( i_size >= PLANE_COPY_PARALLEL_MIN )
+        filter_ParallelRows( i_height, plane_CopyBand, c );
+    else
+        plane_CopyBand( c, 0, i_height );
+}
+
 void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src )
 {
     const unsigned i_width  = __MIN( p_dst->i_visible_pitch,
@@ -341,33 +603,48 @@ void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src )
     const unsigned i_height = __MIN( p_dst->i_visible_lines,
                                      p_src->i_visible_lines );
 
+    struct plane_copy c = {
+        .p_dst = p_dst->p_pixels,
+        .p_src = p_src->p_pixels,
+        .i_dst_pitch = p_dst->i_pitch,
+        .i_src_pitch = p_src->i_pitch,
+        .i_width = i_width,
+    };
+
     /* The 2x visible pitch check does two things:
        1) Makes field plane_t's work correctly (see the deinterlacer module)
        2) Moves less data if the pitch and visible pitch differ much.
     */
-    if( p_src->i_pitch == p_dst->i_pitch  &&
-        p_src->i_pitch < 2*p_src->i_visible_pitch )
-    {
-        /* There are margins, but with the same width : perfect ! */
-        memcpy( p_dst->p_pixels, p_src->p_pixels,
-                    p_src->i_pitch * i_height );
-    }
-    else
-    {
-        /* We need to proceed line by line */
-        uint8_t *p_in = p_src->p_pixels;
-        uint8_t *p_out = p_dst->p_pixels;
+    c.b_contiguous = p_src->i_pitch == p_dst->i_pitch &&
+                     p_src->i_pitch < 2*p_src->i_visible_pitch;
 
-        assert( p_in );
-        assert( p_out );
+    plane_CopyLines( &c, i_height );
+}
 
-        for( int i_line = i_height; i_line--; )
-        {
-            memcpy( p_out, p_in, i_width );
-            p_in += p_src->i_pitch;
-            p_out += p_dst->i_pitch;
-        }
-    }
+void plane_CopyPixelsRect( plane_t *p_dst, const plane_t *p_src,
+                           unsigned x, unsigned y,
+                           unsigned i_width, unsigned i_height )
+{
+    const unsigned i_pixel = p_src->i_pixel_pitch;
+    const unsigned i_pitch = __MIN( p_dst->i_visible_pitch,
+                                    p_src->i_visible_pitch );
+    const unsigned i_lines = __MIN( p_dst->i_visible_lines,
+                                    p_src->i_visible_lines );
+
+    assert( (unsigned)p_dst->i_pixel_pitch == i_pixel );
+    if( i_pixel == 0 || x >= i_pitch / i_pixel || y >= i_lines )
+        return;
+
+    struct plane_copy c = {
+        .p_dst = p_dst->p_pixels + y * p_dst->i_pitch + x * i_pixel,
+        .p_src = p_src->p_pixels + y * p_src->i_pitch + x * i_pixel,
+        .i_dst_pitch = p_dst->i_pitch,
+        .i_src_pitch = p_src->i_pitch,
+        .i_width = __MIN( i_width, i_pitch / i_pixel - x ) * i_pixel,
+        .b_contiguous = false,
+    };
+
+    plane_CopyLines( &c, __MIN( i_height, i_lines - y ) );
 }
 
 void picture_CopyProperties( picture_t *p_dst, const picture_t *p_src )
@@ -392,6 +669,30 @@ void picture_CopyPixels( picture_t *p_dst, const picture_t *p_src )
         p_dst->context = p_src->context->copy( p_src->context );
 }
 
+void picture_CopyPixelsRect( picture_t *p_dst, const picture_t *p_src,
+                             unsigned x, unsigned y,
+                             unsigned i_width, unsigned i_height )
+{
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( p_src->format.i_chroma );
+
+    assert( p_dst->format.i_chroma == p_src->format.i_chroma );
+    if( p_dsc == NULL )
+        return;
+
+    for( int i = 0; i < p_src->i_planes && i < p_dst->i_planes; i++ )
+    {
+        const vlc_rational_t w = p_dsc->p[i].w, h = p_dsc->p[i].h;
+        /* Round outwards so that the chroma of the edge pixels is copied */
+        unsigned x0 = x * w.num / w.den, y0 = y * h.num / h.den;
+        unsigned x1 = ((x + i_width) * w.num + w.den - 1) / w.den;
+        unsigned y1 = ((y + i_height) * h.num + h.den - 1) / h.den;
+
+        plane_CopyPixelsRect( &p_dst->p[i], &p_src->p[i],
+                              x0, y0, x1 - x0, y1 - y0 );
+    }
+}
+
 void picture_Copy( picture_t *p_dst, const picture_t *p_src )
 {
     picture_CopyPixels( p_dst, p_src );
@@ -430,6 +731,50 @@ picture_t *picture_Clone(picture_t *picture)
     return clone;
 }
 
+picture_t *picture_CloneCrop(picture_t *picture, const video_format_t *fmt,
+                             unsigned x, unsigned y)
+{
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription(picture->format.i_chroma);
+
+    if (dsc == NULL || dsc->plane_count == 0 || picture->context != NULL
+     || fmt->i_chroma != picture->format.i_chroma)
+        return NULL;
+
+    picture_resource_t res = {
+        .p_sys = picture->p_sys,
+        .pf_destroy = picture_DestroyClone,
+    };
+
+    for (int i = 0; i < picture->i_planes; i++) {
+        const plane_t *p = &picture->p[i];
+        const vlc_rational_t w = dsc->p[i].w, h = dsc->p[i].h;
+        unsigned x0 = x * w.num / w.den, y0 = y * h.num / h.den;
+        unsigned width = (fmt->i_width * w.num + w.den - 1) / w.den;
+        unsigned lines = (fmt->i_height * h.num + h.den - 1) / h.den;
+
+        /* The last line of the clone must not be the last line of the
+         * plane, unless it starts at its left edge: users may read whole
+         * pitches */
+        if ((x0 + width) * p->i_pixel_pitch > (unsigned)p->i_pitch
+         || y0 + lines + (x0 > 0) > (unsigned)p->i_lines)
+            return NULL;
+
+        res.p[i].p_pixels = p->p_pixels + y0 * p->i_pitch
+                          + x0 * p->i_pixel_pitch;
+        res.p[i].i_lines = p->i_lines - y0 - (x0 > 0);
+        res.p[i].i_pitch = p->i_pitch;
+    }
+
+    picture_t *clone = picture_NewFromResource(fmt, &res);
+    if (likely(clone != NULL)) {
+        ((picture_priv_t *)clone)->gc.opaque = picture;
+        picture_Hold(picture);
+        picture_CopyProperties(clone, picture);
+    }
+    return clone;
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
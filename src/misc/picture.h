@@ -31,9 +31,25 @@ typedef struct
         void (*destroy)(picture_t *);
         void *opaque;
     } gc;
+    vlc_tick_t queued; /**< date queued for display (video output) */
 
     max_align_t extra[];
 } picture_priv_t;
 
-void *picture_Allocate(int *, size_t);
+/** Huge pages usage for picture buffers ("picture-hugepages" option) */
+enum
+{
+    PICTURE_HUGEPAGES_NONE,
+    PICTURE_HUGEPAGES_TRANSPARENT,
+    PICTURE_HUGEPAGES_EXPLICIT,
+};
+
+/**
+ * Allocates a picture buffer.
+ *
+ * \param fdp storage for the file descriptor of the buffer, or -1
+ * \param sizep requested size on entry, allocated size on return
+ * \param hugepages PICTURE_HUGEPAGES_* mode (may be ignored)
+ */
+void *picture_Allocate(int *fdp, size_t *sizep, int hugepages);
 void picture_Deallocate(int, void *, size_t);
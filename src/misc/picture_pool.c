@@ -31,6 +31,7 @@
 #include <stdlib.h>
 
 #include <vlc_common.h>
+#include <vlc_memstats.h>
 #include <vlc_picture_pool.h>
 #include "picture.h"
 
@@ -44,10 +45,12 @@ struct picture_pool_t {
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
-    bool               canceled;
-    unsigned long long available;
+    atomic_bool        canceled;
+    atomic_ullong      available; /**< Bitmap of free pictures */
+    atomic_uint        waiters; /**< Threads sleeping in picture_pool_Wait() */
     atomic_ushort      refs;
     unsigned short     picture_count;
+    size_t             bytes; /**< Pixels memory allocated by the pool */
     picture_t  *picture[];
 };
 
@@ -57,6 +60,7 @@ static void picture_pool_Destroy(picture_pool_t *pool)
         return;
 
     atomic_thread_fence(memory_order_acquire);
+    vlc_memstats_Add(VLC_MEMSTATS_PICTURE_POOL, -(ssize_t)pool->bytes);
     vlc_cond_destroy(&pool->wait);
     vlc_mutex_destroy(&pool->lock);
     aligned_free(pool);
@@ -69,6 +73,50 @@ void picture_pool_Release(picture_pool_t *pool)
     picture_pool_Destroy(pool);
 }
 
+/**
+ * Marks a picture as available again, and wakes up a waiting thread if any.
+ */
+static void picture_pool_Put(picture_pool_t *pool, unsigned offset)
+{
+    unsigned long long mask = 1ULL << offset;
+    unsigned long long prev;
+
+    /* Sequentially consistent, to be ordered with the waiters load */
+    prev = atomic_fetch_or(&pool->available, mask);
+    assert(!(prev & mask));
+    (void) prev;
+
+    if (atomic_load(&pool->waiters) > 0) {
+        vlc_mutex_lock(&pool->lock);
+        vlc_cond_signal(&pool->wait);
+        vlc_mutex_unlock(&pool->lock);
+    }
+}
+
+/**
+ * Takes a picture out of the availability bitmap.
+ *
+ * \param exclude pictures not to consider
+ * \return the offset of the picture, or -1 if none is available
+ */
+static int picture_pool_Take(picture_pool_t *pool, unsigned long long exclude)
+{
+    /* Sequentially consistent, to be ordered with the waiters store */
+    unsigned long long available = atomic_load(&pool->available);
+
+    for (;;) {
+        unsigned long long candidates = available & ~exclude;
+        if (candidates == 0)
+            return -1;
+
+        int i = ctz(candidates);
+        if (atomic_compare_exchange_weak_explicit(&pool->available,
+                        &available, available & ~(1ULL << i),
+                        memory_order_acquire, memory_order_relaxed))
+            return i;
+    }
+}
+
 static void picture_pool_ReleasePicture(picture_t *clone)
 {
     picture_priv_t *priv = (picture_priv_t *)clone;
@@ -81,12 +129,7 @@ static void picture_pool_ReleasePicture(picture_t *clone)
         pool->pic_unlock(picture);
     picture_Release(picture);
 
-    vlc_mutex_lock(&pool->lock);
-    assert(!(pool->available & (1ULL << offset)));
-    pool->available |= 1ULL << offset;
-    vlc_cond_signal(&pool->wait);
-    vlc_mutex_unlock(&pool->lock);
-
+    picture_pool_Put(pool, offset);
     picture_pool_Destroy(pool);
 }
 
@@ -108,8 +151,10 @@ static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
 
     picture_t *clone = picture_NewFromResource(&picture->format, &res);
     if (likely(clone != NULL)) {
+        assert(clone->p_next == NULL);
         ((picture_priv_t *)clone)->gc.opaque = (void *)sys;
         picture_Hold(picture);
+        atomic_fetch_add_explicit(&pool->refs, 1, memory_order_relaxed);
     }
     return clone;
 }
@@ -132,14 +177,16 @@ picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg
     vlc_mutex_init(&pool->lock);
     vlc_cond_init(&pool->wait);
     if (cfg->picture_count == POOL_MAX)
-        pool->available = ~0ULL;
+        atomic_init(&pool->available, ~0ULL);
     else
-        pool->available = (1ULL << cfg->picture_count) - 1;
+        atomic_init(&pool->available, (1ULL << cfg->picture_count) - 1);
+    atomic_init(&pool->waiters, 0);
     atomic_init(&pool->refs,  1);
     pool->picture_count = cfg->picture_count;
+    pool->bytes = 0;
     memcpy(pool->picture, cfg->picture,
            cfg->picture_count * sizeof (picture_t *));
-    pool->canceled = false;
+    atomic_init(&pool->canceled, false);
     return pool;
 }
 
@@ -169,6 +216,13 @@ picture_pool_t *picture_pool_NewFromFormat(const video_format_t *fmt,
     if (!pool)
         goto error;
 
+    /* Only pools owning their pictures are accounted: reserved pools share
+     * the pictures of their master, and the others wrap external buffers. */
+    for (i = 0; i < count; i++)
+        for (int j = 0; j < picture[i]->i_planes; j++)
+            pool->bytes += (size_t)picture[i]->p[j].i_pitch
+                         * picture[i]->p[j].i_lines;
+    vlc_memstats_Add(VLC_MEMSTATS_PICTURE_POOL, pool->bytes);
     return pool;
 
 error:
@@ -202,78 +256,63 @@ error:
 
 picture_t *picture_pool_Get(picture_pool_t *pool)
 {
-    unsigned long long available;
+    unsigned long long tried = 0;
 
-    vlc_mutex_lock(&pool->lock);
     assert(pool->refs > 0);
-    available = pool->available;
 
-    while (available != 0)
+    for (;;)
     {
-        int i = ctz(available);
-
-        if (unlikely(pool->canceled))
-            break;
+        if (unlikely(atomic_load_explicit(&pool->canceled,
+                                          memory_order_relaxed)))
+            return NULL;
 
-        pool->available &= ~(1ULL << i);
-        vlc_mutex_unlock(&pool->lock);
-        available &= ~(1ULL << i);
+        int i = picture_pool_Take(pool, tried);
+        if (i < 0)
+            return NULL;
 
         picture_t *picture = pool->picture[i];
 
         if (pool->pic_lock != NULL && pool->pic_lock(picture) != VLC_SUCCESS) {
-            vlc_mutex_lock(&pool->lock);
-            pool->available |= 1ULL << i;
+            picture_pool_Put(pool, i);
+            tried |= 1ULL << i;
             continue;
         }
 
-        picture_t *clone = picture_pool_ClonePicture(pool, i);
-        if (clone != NULL) {
-            assert(clone->p_next == NULL);
-            atomic_fetch_add_explicit(&pool->refs, 1, memory_order_relaxed);
-        }
-        return clone;
+        return picture_pool_ClonePicture(pool, i);
     }
-
-    vlc_mutex_unlock(&pool->lock);
-    return NULL;
 }
 
 picture_t *picture_pool_Wait(picture_pool_t *pool)
 {
-    vlc_mutex_lock(&pool->lock);
+    int i;
+
     assert(pool->refs > 0);
 
-    while (pool->available == 0)
+    vlc_mutex_lock(&pool->lock);
+    atomic_fetch_add(&pool->waiters, 1);
+
+    while ((i = picture_pool_Take(pool, 0)) < 0)
     {
-        if (pool->canceled)
+        if (atomic_load_explicit(&pool->canceled, memory_order_relaxed))
         {
+            atomic_fetch_sub(&pool->waiters, 1);
             vlc_mutex_unlock(&pool->lock);
             return NULL;
         }
         vlc_cond_wait(&pool->wait, &pool->lock);
     }
 
-    int i = ctz(pool->available);
-    pool->available &= ~(1ULL << i);
+    atomic_fetch_sub(&pool->waiters, 1);
     vlc_mutex_unlock(&pool->lock);
 
     picture_t *picture = pool->picture[i];
 
     if (pool->pic_lock != NULL && pool->pic_lock(picture) != VLC_SUCCESS) {
-        vlc_mutex_lock(&pool->lock);
-        pool->available |= 1ULL << i;
-        vlc_cond_signal(&pool->wait);
-        vlc_mutex_unlock(&pool->lock);
+        picture_pool_Put(pool, i);
         return NULL;
     }
 
-    picture_t *clone = picture_pool_ClonePicture(pool, i);
-    if (clone != NULL) {
-        assert(clone->p_next == NULL);
-        atomic_fetch_add_explicit(&pool->refs, 1, memory_order_relaxed);
-    }
-    return clone;
+    return picture_pool_ClonePicture(pool, i);
 }
 
 void picture_pool_Cancel(picture_pool_t *pool, bool canceled)
@@ -281,7 +320,7 @@ void picture_pool_Cancel(picture_pool_t *pool, bool canceled)
     vlc_mutex_lock(&pool->lock);
     assert(pool->refs > 0);
 
-    pool->canceled = canceled;
+    atomic_store_explicit(&pool->canceled, canceled, memory_order_relaxed);
     if (canceled)
         vlc_cond_broadcast(&pool->wait);
     vlc_mutex_unlock(&pool->lock);
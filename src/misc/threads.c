@@ -438,3 +438,124 @@ void vlc_sem_wait (vlc_sem_t *sem)
     vlc_mutex_unlock (&sem->lock);
 }
 #endif /* LIBVLC_NEED_SEMAPHORE */
+
+/*** Decoding threads budget ***/
+static vlc_mutex_t cpu_threads_lock = VLC_STATIC_MUTEX;
+static unsigned cpu_threads_used;
+static unsigned cpu_threads_holders;
+
+unsigned vlc_ReserveCPUThreads(unsigned wanted)
+{
+    unsigned budget = vlc_GetCPUCount();
+    unsigned count;
+
+    if (wanted == 0)
+        wanted = 1;
+
+    vlc_mutex_lock(&cpu_threads_lock);
+    /* Whatever is left, but no less than a fair share of all CPUs */
+    count = budget / (cpu_threads_holders + 1);
+    if (cpu_threads_used < budget && budget - cpu_threads_used > count)
+        count = budget - cpu_threads_used;
+    count = VLC_CLIP(count, 1, wanted);
+    cpu_threads_used += count;
+    cpu_threads_holders++;
+    vlc_mutex_unlock(&cpu_threads_lock);
+    return count;
+}
+
+void vlc_ReleaseCPUThreads(unsigned count)
+{
+    vlc_mutex_lock(&cpu_threads_lock);
+    assert(cpu_threads_holders > 0 && cpu_threads_used >= count);
+    cpu_threads_used -= count;
+    cpu_threads_holders--;
+    vlc_mutex_unlock(&cpu_threads_lock);
+}
+
+/*** CPU affinity ***/
+#ifdef HAVE_SCHED_GETAFFINITY
+# include <sched.h>
+# include <stdio.h>
+
+static int vlc_cpuset_parse(cpu_set_t *set, const char *str)
+{
+    while (*str != '\0' && *str != '\n')
+    {
+        char *end;
+
+        if (!strncmp(str, "node", 4))
+        {
+            /* All CPUs of a NUMA node, as listed by the kernel (Linux) */
+            unsigned long node = strtoul(str + 4, &end, 10);
+            char path[64], buf[1024];
+
+            if (end == str + 4)
+                return -1;
+            snprintf(path, sizeof (path),
+                     "/sys/devices/system/node/node%lu/cpulist", node);
+
+            FILE *stream = fopen(path, "rte");
+            if (stream == NULL)
+                return -1;
+
+            bool ok = fgets(buf, sizeof (buf), stream) != NULL
+                   && strstr(buf, "node") == NULL
+                   && vlc_cpuset_parse(set, buf) == 0;
+            fclose(stream);
+            if (!ok)
+                return -1;
+        }
+        else
+        {
+            unsigned long first = strtoul(str, &end, 10), last = first;
+
+            if (end == str)
+                return -1;
+            if (*end == '-')
+            {
+                str = end + 1;
+                last = strtoul(str, &end, 10);
+                if (end == str || last < first)
+                    return -1;
+            }
+            for (unsigned long i = first; i <= last && i < CPU_SETSIZE; i++)
+                CPU_SET(i, set);
+        }
+
+        str = end;
+        if (*str == ',')
+            str++;
+    }
+    return 0;
+}
+#endif
+
+#undef vlc_thread_set_affinity
+void vlc_thread_set_affinity(vlc_object_t *obj, const char *subsystem)
+{
+    char name[32];
+    snprintf(name, sizeof (name), "%s-cpu-affinity", subsystem);
+
+    char *str = var_InheritString(obj, name);
+    if (str == NULL)
+        str = var_InheritString(obj, "cpu-affinity");
+    if (str == NULL)
+        return;
+
+#ifdef HAVE_SCHED_GETAFFINITY
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    if (vlc_cpuset_parse(&set, str) || CPU_COUNT(&set) == 0)
+        msg_Err(obj, "invalid CPU affinity \"%s\"", str);
+    else if (sched_setaffinity(0, sizeof (set), &set))
+        msg_Warn(obj, "cannot set %s thread CPU affinity: %s", subsystem,
+                 vlc_strerror_c(errno));
+    else
+        msg_Dbg(obj, "%s thread pinned to CPUs %s", subsystem, str);
+#else
+    msg_Warn(obj, "CPU affinity not supported on this platform");
+#endif
+    free(str);
+}
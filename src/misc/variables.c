@@ -27,9 +27,6 @@
 # include "config.h"
 #endif
 
-#ifdef HAVE_SEARCH_H
-# include <search.h>
-#endif
 #include <assert.h>
 #include <float.h>
 #include <math.h>
@@ -67,7 +64,8 @@ typedef struct variable_ops_t
  */
 struct variable_t
 {
-    char *       psz_name; /**< The variable unique name (must be first) */
+    char *       psz_name; /**< The variable unique name */
+    uint32_t     hash; /**< Hash of the name */
 
     /** The variable's exported value */
     vlc_value_t  val;
@@ -136,23 +134,118 @@ int_ops    = { CmpInt,     DupDummy,  FreeDummy,  },
 string_ops = { CmpString,  DupString, FreeString, },
 coords_ops = { NULL,       DupDummy,  FreeDummy,  };
 
-static int varcmp( const void *a, const void *b )
+static uint32_t VarHash( const char *psz_name )
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+
+    while( *psz_name )
+        hash = (hash ^ (unsigned char)*(psz_name++)) * 16777619u;
+    return hash;
+}
+
+/**
+ * Finds the hash table slot of a variable, or the empty slot where it
+ * would be inserted. The table must not be empty.
+ */
+static variable_t **VarSlot( vlc_object_internals_t *priv,
+                             const char *psz_name, uint32_t hash )
+{
+    size_t mask = priv->vars.mask;
+    variable_t **slots = priv->vars.slots;
+
+    for( size_t i = hash & mask;; i = (i + 1) & mask )
+    {
+        variable_t *var = slots[i];
+
+        if( var == NULL
+         || (var->hash == hash && !strcmp( var->psz_name, psz_name )) )
+            return &slots[i];
+    }
+}
+
+static variable_t *VarFind( vlc_object_internals_t *priv,
+                            const char *psz_name, uint32_t hash )
+{
+    vlc_mutex_assert( &priv->var_lock );
+
+    if( priv->vars.slots == NULL )
+        return NULL;
+    return *VarSlot( priv, psz_name, hash );
+}
+
+static int VarInsert( vlc_object_internals_t *priv, variable_t *p_var )
+{
+    vlc_mutex_assert( &priv->var_lock );
+
+    size_t size = priv->vars.slots != NULL ? priv->vars.mask + 1 : 0;
+
+    /* Keep the load factor below three quarters */
+    if( (priv->vars.count + 1) * 4 > size * 3 )
+    {
+        size_t newsize = size ? 2 * size : 8;
+        variable_t **slots = calloc( newsize, sizeof (*slots) );
+        if( unlikely(slots == NULL) )
+            return VLC_ENOMEM;
+
+        for( size_t i = 0; i < size; i++ )
+        {
+            variable_t *var = priv->vars.slots[i];
+            if( var == NULL )
+                continue;
+
+            size_t j = var->hash & (newsize - 1);
+            while( slots[j] != NULL )
+                j = (j + 1) & (newsize - 1);
+            slots[j] = var;
+        }
+
+        free( priv->vars.slots );
+        priv->vars.slots = slots;
+        priv->vars.mask = newsize - 1;
+    }
+
+    variable_t **slot = VarSlot( priv, p_var->psz_name, p_var->hash );
+    assert( *slot == NULL );
+    *slot = p_var;
+    priv->vars.count++;
+    return VLC_SUCCESS;
+}
+
+static void VarRemove( vlc_object_internals_t *priv, variable_t *p_var )
 {
-    const variable_t *va = a, *vb = b;
+    vlc_mutex_assert( &priv->var_lock );
 
-    /* psz_name must be first */
-    assert( va == (const void *)&va->psz_name );
-    return strcmp( va->psz_name, vb->psz_name );
+    size_t mask = priv->vars.mask;
+    variable_t **slots = priv->vars.slots;
+    size_t i = VarSlot( priv, p_var->psz_name, p_var->hash ) - slots;
+
+    assert( slots[i] == p_var );
+    slots[i] = NULL;
+    priv->vars.count--;
+
+    /* Shift back the following entries of the cluster, so that lookups
+     * never stop early (no tombstones). */
+    for( size_t j = (i + 1) & mask; slots[j] != NULL; j = (j + 1) & mask )
+    {
+        size_t home = slots[j]->hash & mask;
+
+        /* Move the entry unless its home slot is cyclically in (i, j] */
+        if( ((j - home) & mask) >= ((j - i) & mask) )
+        {
+            slots[i] = slots[j];
+            slots[j] = NULL;
+            i = j;
+        }
+    }
 }
 
 static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
-    variable_t **pp_var;
 
     vlc_mutex_lock(&priv->var_lock);
-    pp_var = tfind( &psz_name, &priv->var_root, varcmp );
-    return (pp_var != NULL) ? *pp_var : NULL;
+    return VarFind( priv, psz_name, VarHash( psz_name ) );
 }
 
 static void Destroy( variable_t *p_var )
@@ -295,6 +388,7 @@ int (var_Create)( vlc_object_t *p_this, const char *psz_name, int i_type )
         return VLC_ENOMEM;
 
     p_var->psz_name = strdup( psz_name );
+    p_var->hash = VarHash( psz_name );
     p_var->psz_text = NULL;
 
     p_var->i_type = i_type & ~VLC_VAR_DOINHERIT;
@@ -352,16 +446,18 @@ int (var_Create)( vlc_object_t *p_this, const char *psz_name, int i_type )
         var_Inherit(p_this, psz_name, i_type, &p_var->val);
 
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
-    variable_t **pp_var, *p_oldvar;
+    variable_t *p_oldvar;
     int ret = VLC_SUCCESS;
 
     vlc_mutex_lock( &p_priv->var_lock );
 
-    pp_var = tsearch( p_var, &p_priv->var_root, varcmp );
-    if( unlikely(pp_var == NULL) )
-        ret = VLC_ENOMEM;
-    else if( (p_oldvar = *pp_var) == p_var ) /* Variable create */
-        p_var = NULL; /* Variable created */
+    p_oldvar = VarFind( p_priv, p_var->psz_name, p_var->hash );
+    if( p_oldvar == NULL ) /* Variable create */
+    {
+        ret = VarInsert( p_priv, p_var );
+        if( ret == VLC_SUCCESS )
+            p_var = NULL; /* Variable created */
+    }
     else /* Variable already exists */
     {
         assert (((i_type ^ p_oldvar->i_type) & VLC_VAR_CLASS) == 0);
@@ -391,7 +487,7 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
     else if( --p_var->i_usage == 0 )
     {
         assert(!p_var->b_incallback);
-        tdelete( p_var, &p_priv->var_root, varcmp );
+        VarRemove( p_priv, p_var );
     }
     else
     {
@@ -404,17 +500,19 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
         Destroy( p_var );
 }
 
-static void CleanupVar( void *var )
-{
-    Destroy( var );
-}
-
 void var_DestroyAll( vlc_object_t *obj )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
 
-    tdestroy( priv->var_root, CleanupVar );
-    priv->var_root = NULL;
+    if( priv->vars.slots != NULL )
+        for( size_t i = 0; i <= priv->vars.mask; i++ )
+            if( priv->vars.slots[i] != NULL )
+                Destroy( priv->vars.slots[i] );
+
+    free( priv->vars.slots );
+    priv->vars.slots = NULL;
+    priv->vars.mask = 0;
+    priv->vars.count = 0;
 }
 
 int (var_Change)(vlc_object_t *p_this, const char *psz_name, int i_action, ...)
@@ -720,16 +818,15 @@ int (var_Set)(vlc_object_t *p_this, const char *psz_name, vlc_value_t val)
     return var_SetChecked( p_this, psz_name, 0, val );
 }
 
-int (var_GetChecked)(vlc_object_t *p_this, const char *psz_name,
-                     int expected_type, vlc_value_t *p_val)
+static int GetChecked( vlc_object_t *p_this, const char *psz_name,
+                       uint32_t hash, int expected_type, vlc_value_t *p_val )
 {
-    assert( p_this );
-
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
     variable_t *p_var;
     int err = VLC_SUCCESS;
 
-    p_var = Lookup( p_this, psz_name );
+    vlc_mutex_lock( &p_priv->var_lock );
+    p_var = VarFind( p_priv, psz_name, hash );
     if( p_var != NULL )
     {
         assert( expected_type == 0 ||
@@ -749,6 +846,15 @@ int (var_GetChecked)(vlc_object_t *p_this, const char *psz_name,
     return err;
 }
 
+int (var_GetChecked)(vlc_object_t *p_this, const char *psz_name,
+                     int expected_type, vlc_value_t *p_val)
+{
+    assert( p_this );
+
+    return GetChecked( p_this, psz_name, VarHash( psz_name ), expected_type,
+                       p_val );
+}
+
 int (var_Get)(vlc_object_t *p_this, const char *psz_name, vlc_value_t *p_val)
 {
     return var_GetChecked( p_this, psz_name, 0, p_val );
@@ -1036,10 +1142,13 @@ int (var_LocationParse)(vlc_object_t *obj, const char *mrl, const char *pref)
 int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
                  vlc_value_t *p_val )
 {
+    /* Hash the name once for the whole chain of parents */
+    uint32_t hash = VarHash( psz_name );
+
     i_type &= VLC_VAR_CLASS;
     for (vlc_object_t *obj = p_this; obj != NULL; obj = vlc_object_parent(obj))
     {
-        if( var_GetChecked( obj, psz_name, i_type, p_val ) == VLC_SUCCESS )
+        if( GetChecked( obj, psz_name, hash, i_type, p_val ) == VLC_SUCCESS )
             return VLC_SUCCESS;
     }
 
@@ -1134,13 +1243,8 @@ error:
     return VLC_EGENERIC;
 }
 
-static void DumpVariable(const void *data, const VISIT which, const int depth)
+static void DumpVariable(const variable_t *var)
 {
-    if (which != postorder && which != leaf)
-        return;
-    (void) depth;
-
-    const variable_t *var = *(const variable_t **)data;
     const char *typename = "unknown";
 
     switch (var->i_type & VLC_VAR_TYPE)
@@ -1202,29 +1306,54 @@ static void DumpVariable(const void *data, const VISIT which, const int depth)
     putchar('\n');
 }
 
-void DumpVariables(vlc_object_t *obj)
+static int varcmp(const void *a, const void *b)
 {
-    vlc_mutex_lock(&vlc_internals(obj)->var_lock);
-    if (vlc_internals(obj)->var_root == NULL)
-        puts(" `-o No variables");
-    else
-        twalk(vlc_internals(obj)->var_root, DumpVariable);
-    vlc_mutex_unlock(&vlc_internals(obj)->var_lock);
+    const variable_t *const *va = a, *const *vb = b;
+
+    return strcmp((*va)->psz_name, (*vb)->psz_name);
 }
 
-static thread_local void *twalk_ctx;
+/**
+ * Gets the variables of an object sorted by name.
+ */
+static variable_t **GetSortedVars(vlc_object_internals_t *priv, size_t *count)
+{
+    vlc_mutex_assert(&priv->var_lock);
+
+    size_t n = 0;
+    variable_t **vars = vlc_alloc(priv->vars.count, sizeof (*vars));
+    if (vars == NULL)
+        return NULL;
+
+    for (size_t i = 0; n < priv->vars.count; i++)
+        if (priv->vars.slots[i] != NULL)
+            vars[n++] = priv->vars.slots[i];
+
+    qsort(vars, n, sizeof (*vars), varcmp);
+    *count = n;
+    return vars;
+}
 
-static void TwalkGetNames(const void *data, const VISIT which, const int depth)
+void DumpVariables(vlc_object_t *obj)
 {
-    if (which != postorder && which != leaf)
-        return;
-    (void) depth;
+    vlc_object_internals_t *priv = vlc_internals(obj);
+
+    vlc_mutex_lock(&priv->var_lock);
+    if (priv->vars.count == 0)
+        puts(" `-o No variables");
+    else
+    {
+        size_t count;
+        variable_t **vars = GetSortedVars(priv, &count);
 
-    const variable_t *var = *(const variable_t **)data;
-    DECL_ARRAY(char *) *names = twalk_ctx;
-    char *dup = strdup(var->psz_name);
-    if (dup != NULL)
-        ARRAY_APPEND(*names, dup);
+        if (vars != NULL)
+        {
+            for (size_t i = 0; i < count; i++)
+                DumpVariable(vars[i]);
+            free(vars);
+        }
+    }
+    vlc_mutex_unlock(&priv->var_lock);
 }
 
 char **var_GetAllNames(vlc_object_t *obj)
@@ -1234,9 +1363,23 @@ char **var_GetAllNames(vlc_object_t *obj)
     DECL_ARRAY(char *) names;
     ARRAY_INIT(names);
 
-    twalk_ctx = &names;
     vlc_mutex_lock(&priv->var_lock);
-    twalk(priv->var_root, TwalkGetNames);
+    if (priv->vars.count > 0)
+    {
+        size_t count;
+        variable_t **vars = GetSortedVars(priv, &count);
+
+        if (vars != NULL)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                char *dup = strdup(vars[i]->psz_name);
+                if (dup != NULL)
+                    ARRAY_APPEND(names, dup);
+            }
+            free(vars);
+        }
+    }
     vlc_mutex_unlock(&priv->var_lock);
 
     if (names.i_size == 0)
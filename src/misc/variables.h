@@ -40,7 +40,12 @@ struct vlc_object_internals
     const char *typename; /**< Object type human-readable name */
 
     /* Object variables */
-    void           *var_root;
+    struct
+    {
+        struct variable_t **slots; /**< Open-addressing hash table or NULL */
+        size_t mask; /**< Number of slots minus one */
+        size_t count; /**< Number of variables */
+    } vars;
     vlc_mutex_t     var_lock;
     vlc_cond_t      var_wait;
 
@@ -249,6 +249,16 @@ typedef enum
     CACHE_WRITE_FILE = 0x4,
 } cache_mode_t;
 
+/** Plug-in file found while browsing, in browsing order */
+typedef struct module_file
+{
+    char         *abspath;
+    char         *relpath;
+    int64_t       mtime;
+    uint64_t      size;
+    vlc_plugin_t *plugin; /**< from the cache, or once loaded */
+} module_file_t;
+
 typedef struct module_bank
 {
     vlc_object_t *obj;
@@ -258,10 +268,17 @@ typedef struct module_bank
     size_t        size;
     vlc_plugin_t **plugins;
     vlc_plugin_t *cache;
+
+    size_t        filec;
+    module_file_t *filev;
+    atomic_size_t next; /**< next file to load */
 } module_bank_t;
 
 /**
  * Scans a plug-in from a file.
+ *
+ * Up-to-date plug-ins are taken from the cache right away. Others are only
+ * queued, to be loaded by LoadPluginFiles().
  */
 static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
                                const char *relpath, const struct stat *st)
@@ -284,33 +301,120 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
         }
     }
 
-    if (plugin == NULL)
+    module_file_t *file;
+
+    bank->filev = xrealloc(bank->filev,
+                           (bank->filec + 1) * sizeof (*bank->filev));
+    file = &bank->filev[bank->filec++];
+    file->abspath = xstrdup(abspath);
+    file->relpath = xstrdup(relpath);
+    file->mtime = st->st_mtime;
+    file->size = st->st_size;
+    file->plugin = plugin;
+    return 0;
+}
+
+static void *LoadPluginThread(void *data)
+{
+    module_bank_t *bank = data;
+
+    for (;;)
     {
-        plugin = module_InitDynamic(bank->obj, abspath, true);
+        size_t i = atomic_fetch_add_explicit(&bank->next, 1,
+                                             memory_order_relaxed);
+        if (i >= bank->filec)
+            break;
 
-        if (plugin != NULL)
-        {
-            plugin->path = xstrdup(relpath);
-            plugin->mtime = st->st_mtime;
-            plugin->size = st->st_size;
-        }
+        module_file_t *file = &bank->filev[i];
+
+        if (file->plugin == NULL)
+            file->plugin = module_InitDynamic(bank->obj, file->abspath, true);
     }
+    return NULL;
+}
 
-    if (plugin == NULL)
-        return -1;
+/**
+ * Loads the queued plug-in files, then adds them to the bank.
+ *
+ * Loading the shared objects and running their descriptors dominates the
+ * start-up time when the cache is missing or stale, so it is spread across
+ * threads. The plug-ins are stored in browsing order regardless, so that the
+ * bank (and the saved cache) does not depend on thread scheduling.
+ */
+static void LoadPluginFiles(module_bank_t *bank)
+{
+    size_t missing = 0;
+
+    for (size_t i = 0; i < bank->filec; i++)
+        if (bank->filev[i].plugin == NULL)
+            missing++;
+
+    /* Threads are only worth it if there are a few plug-ins to load. */
+    unsigned threads = vlc_GetCPUCount();
+    if (threads > 8)
+        threads = 8;
+    if (threads > missing / 8)
+        threads = missing / 8;
+
+    vlc_thread_t *thv = NULL;
+    if (threads > 1)
+    {
+        thv = vlc_alloc(threads - 1, sizeof (*thv));
+        if (thv == NULL)
+            threads = 1;
+    }
+
+    atomic_init(&bank->next, 0);
+
+    unsigned started = 0;
+    while (started + 1 < threads
+        && vlc_clone(&thv[started], LoadPluginThread, bank,
+                     VLC_THREAD_PRIORITY_LOW) == 0)
+        started++;
 
-    vlc_plugin_store(plugin);
+    if (missing > 0)
+        msg_Dbg(bank->obj, "loading %zu plug-ins with %u thread(s)", missing,
+                started + 1);
 
-    if (bank->mode & CACHE_WRITE_FILE) /* Add entry to to-be-saved cache */
+    LoadPluginThread(bank);
+
+    for (unsigned i = 0; i < started; i++)
+        vlc_join(thv[i], NULL);
+    free(thv);
+
+    for (size_t i = 0; i < bank->filec; i++)
     {
-        bank->plugins = xrealloc(bank->plugins,
-                                 (bank->size + 1) * sizeof (vlc_plugin_t *));
-        bank->plugins[bank->size] = plugin;
-        bank->size++;
+        module_file_t *file = &bank->filev[i];
+        vlc_plugin_t *plugin = file->plugin;
+
+        if (plugin != NULL)
+        {
+            if (plugin->path == NULL) /* not from the cache */
+            {
+                plugin->path = file->relpath;
+                file->relpath = NULL;
+                plugin->mtime = file->mtime;
+                plugin->size = file->size;
+            }
+
+            vlc_plugin_store(plugin);
+
+            if (bank->mode & CACHE_WRITE_FILE) /* Add to to-be-saved cache */
+            {
+                bank->plugins = xrealloc(bank->plugins, (bank->size + 1)
+                                                     * sizeof (vlc_plugin_t *));
+                bank->plugins[bank->size] = plugin;
+                bank->size++;
+            }
+        }
+
+        free(file->abspath);
+        free(file->relpath);
     }
 
-    /* TODO: deal with errors */
-    return  0;
+    free(bank->filev);
+    bank->filev = NULL;
+    bank->filec = 0;
 }
 
 /**
@@ -415,6 +519,7 @@ static void AllocatePluginPath(vlc_object_t *obj, const char *path,
 
         /* Don't go deeper than 5 subdirectories */
         AllocatePluginDir(&bank, 5, path, NULL);
+        LoadPluginFiles(&bank);
     }
 
     /* Deal with unmatched cache entries from cache file */
@@ -454,6 +559,9 @@ static void AllocateAllPlugins (vlc_object_t *p_this)
         mode |= CACHE_SCAN_DIR;
     if (var_InheritBool(p_this, "reset-plugins-cache"))
         mode = (mode | CACHE_WRITE_FILE) & ~CACHE_READ_FILE;
+    else if (var_InheritBool(p_this, "update-plugins-cache"))
+        /* Reuse the cache entries of unmodified plug-ins */
+        mode |= CACHE_READ_FILE | CACHE_SCAN_DIR | CACHE_WRITE_FILE;
 
 #if VLC_WINSTORE_APP
     /* Windows Store Apps can not load external plugins with absolute paths. */
@@ -56,7 +56,7 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 35
+#define CACHE_SUBVERSION_NUM 36
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
@@ -64,38 +64,148 @@
 #define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION
 
 
-static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
+/*
+ * Cache file layout (version 36 and later)
+ *
+ * After the textual header, the file consists of fixed-size records which
+ * refer to strings and arrays by offset, so that the cache can be used in
+ * place from its (read-only, shared) memory mapping: loading builds the
+ * plug-in and module descriptors, but does not parse nor copy any string.
+ *
+ *   struct vlc_cache_header
+ *   struct vlc_cache_plugin[plugins]
+ *   struct vlc_cache_module[modules] (consecutive for a given plug-in)
+ *   struct vlc_cache_config[configs] (consecutive for a given plug-in)
+ *   data (arrays of uint32_t string offsets or of int choices)
+ *   strings (nul-terminated, the first one is empty)
+ *
+ * String offset zero stands for NULL.
+ */
+typedef uint32_t vlc_cache_str_t;
+
+struct vlc_cache_header
 {
-    if (in->i_buffer < size)
-        return -1;
+    uint32_t plugins;
+    uint32_t modules;
+    uint32_t configs;
+    uint32_t data_size;
+    uint32_t strings_size;
+    uint32_t reserved;
+};
 
-    memcpy(out, in->p_buffer, size);
-    in->p_buffer += size;
-    in->i_buffer -= size;
-    return 0;
+struct vlc_cache_plugin
+{
+    int64_t mtime;
+    uint64_t size;
+    vlc_cache_str_t path;
+    vlc_cache_str_t textdomain;
+    uint32_t modules;
+    uint32_t configs;
+    uint8_t unloadable;
+    uint8_t padding[7];
+};
+
+struct vlc_cache_module
+{
+    vlc_cache_str_t shortname;
+    vlc_cache_str_t longname;
+    vlc_cache_str_t help;
+    vlc_cache_str_t capability;
+    vlc_cache_str_t activate;
+    vlc_cache_str_t deactivate;
+    uint32_t shortcuts; /**< data offset of the shortcut strings */
+    uint32_t shortcuts_count;
+    int32_t score;
+    uint32_t padding;
+};
+
+typedef union
+{
+    int64_t i;
+    float f;
+    vlc_cache_str_t psz;
+} vlc_cache_value_t;
+
+struct vlc_cache_config
+{
+    vlc_cache_value_t orig;
+    vlc_cache_value_t min;
+    vlc_cache_value_t max;
+    uint8_t type;
+    char shortname;
+    uint8_t flags;
+    uint8_t padding;
+    uint16_t list_count;
+    uint16_t padding2;
+    vlc_cache_str_t psz_type;
+    vlc_cache_str_t name;
+    vlc_cache_str_t text;
+    vlc_cache_str_t longtext;
+    vlc_cache_str_t list_cb_name;
+    uint32_t list; /**< data offset of the choices */
+    uint32_t list_text; /**< data offset of the choices names */
+    uint32_t padding3;
+};
+
+#define CACHE_CONFIG_INTERNAL   0x1
+#define CACHE_CONFIG_UNSAVEABLE 0x2
+#define CACHE_CONFIG_SAFE       0x4
+#define CACHE_CONFIG_REMOVED    0x8
+
+static_assert(sizeof (struct vlc_cache_header) % 8 == 0, "Misaligned");
+static_assert(sizeof (struct vlc_cache_plugin) % 8 == 0, "Misaligned");
+static_assert(sizeof (struct vlc_cache_module) % 8 == 0, "Misaligned");
+static_assert(sizeof (struct vlc_cache_config) % 8 == 0, "Misaligned");
+
+#define CACHE_ALIGN 8
+
+struct vlc_cache_map
+{
+    const struct vlc_cache_plugin *plugins;
+    const struct vlc_cache_module *modules;
+    const struct vlc_cache_config *configs;
+    const uint8_t *data;
+    const char *strings;
+    struct vlc_cache_header hdr;
+};
+
+/** Plugins cache file, with its sections */
+struct vlc_cache_file
+{
+    block_t self;
+    block_t *file;
+    struct vlc_cache_map map;
+};
+
+static void vlc_cache_file_Release(block_t *block)
+{
+    struct vlc_cache_file *cf = container_of(block, struct vlc_cache_file,
+                                             self);
+
+    block_Release(cf->file);
+    free(cf);
 }
 
-static int vlc_cache_load_bool(bool *out, block_t *in)
+static const struct vlc_block_callbacks vlc_cache_file_cbs =
 {
-    unsigned char b;
+    vlc_cache_file_Release,
+};
 
-    if (vlc_cache_load_immediate(&b, in, 1) || b > 1)
+static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
+{
+    if (in->i_buffer < size)
         return -1;
 
-    *out = b;
+    memcpy(out, in->p_buffer, size);
+    in->p_buffer += size;
+    in->i_buffer -= size;
     return 0;
 }
 
-static int vlc_cache_load_array(const void **p, size_t size, size_t n,
-                                block_t *file)
+static int vlc_cache_load_section(const void **p, size_t size, size_t n,
+                                  block_t *file)
 {
-    if (n == 0)
-    {
-        *p = NULL;
-        return 0;
-    }
-
-    if (unlikely(size * n < size))
+    if (unlikely(n != 0 && size * n / n != size))
         return -1;
 
     size *= n;
@@ -109,233 +219,283 @@ static int vlc_cache_load_array(const void **p, size_t size, size_t n,
     return 0;
 }
 
-static int vlc_cache_load_string(const char **restrict p, block_t *file)
+static int vlc_cache_map_string(const struct vlc_cache_map *map,
+                                vlc_cache_str_t offset, const char **p)
 {
-    uint16_t size;
-
-    if (vlc_cache_load_immediate(&size, file, sizeof (size)) || size > 16384)
+    if (offset >= map->hdr.strings_size)
         return -1;
 
-    if (size == 0)
-    {
-        *p = NULL;
-        return 0;
-    }
-
-    const char *str = (char *)file->p_buffer;
-
-    if (file->i_buffer < size || str[size - 1] != '\0')
-        return -1;
-
-    file->p_buffer += size;
-    file->i_buffer -= size;
-    *p = str;
+    /* The string table starts and ends with a nul byte, so any offset within
+     * the table is a valid nul-terminated string. */
+    *p = (offset != 0) ? map->strings + offset : NULL;
     return 0;
 }
 
-static int vlc_cache_load_align(size_t align, block_t *file)
+static const void *vlc_cache_map_array(const struct vlc_cache_map *map,
+                                       uint32_t offset, size_t size, size_t n)
 {
-    assert(align > 0);
-
-    size_t skip = (-(uintptr_t)file->p_buffer) % align;
-    if (skip == 0)
-        return 0;
+    if (offset % CACHE_ALIGN || offset > map->hdr.data_size
+     || n * size > map->hdr.data_size - offset)
+        return NULL;
+    return map->data + offset;
+}
 
-    assert(skip < align);
+/**
+ * Resolves an array of string offsets into a heap-allocated table of string
+ * pointers. NULL entries are mapped to the empty string.
+ */
+static const char **vlc_cache_map_strings(const struct vlc_cache_map *map,
+                                          uint32_t offset, size_t n)
+{
+    const uint32_t *offsets = vlc_cache_map_array(map, offset,
+                                                  sizeof (*offsets), n);
+    if (offsets == NULL)
+        return NULL;
 
-    if (file->i_buffer < skip)
-        return -1;
+    const char **tab = vlc_alloc(n, sizeof (*tab));
+    if (unlikely(tab == NULL))
+        return NULL;
 
-    file->p_buffer += skip;
-    file->i_buffer -= skip;
-    assert((((uintptr_t)file->p_buffer) % align) == 0);
-    return 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (offsets[i] >= map->hdr.strings_size)
+        {
+            free(tab);
+            return NULL;
+        }
+        tab[i] = map->strings + offsets[i];
+    }
+    return tab;
 }
 
-#define LOAD_IMMEDIATE(a) \
-    if (vlc_cache_load_immediate(&(a), file, sizeof (a))) \
-        goto error
-#define LOAD_FLAG(a) \
-    do \
-    { \
-        bool b; \
-        if (vlc_cache_load_bool(&b, file)) \
-            goto error; \
-        (a) = b; \
-    } while (0)
-#define LOAD_ARRAY(a,n) \
-    do \
-    { \
-        const void *base; \
-        if (vlc_cache_load_array(&base, sizeof (*(a)), (n), file)) \
-            goto error; \
-        (a) = base; \
-    } while (0)
-#define LOAD_STRING(a) \
-    if (vlc_cache_load_string(&(a), file)) \
-        goto error
-#define LOAD_ALIGNOF(t) \
-    if (vlc_cache_load_align(alignof(t), file)) \
+#define MAP_STRING(a, s) \
+    if (vlc_cache_map_string(map, (s), &(a))) \
         goto error
 
-static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
+static int vlc_cache_load_item(module_config_t *cfg,
+                               const struct vlc_cache_map *map,
+                               const struct vlc_cache_config *rec)
 {
-    LOAD_IMMEDIATE (cfg->i_type);
-    LOAD_IMMEDIATE (cfg->i_short);
-    LOAD_FLAG (cfg->b_internal);
-    LOAD_FLAG (cfg->b_unsaveable);
-    LOAD_FLAG (cfg->b_safe);
-    LOAD_FLAG (cfg->b_removed);
-    LOAD_STRING (cfg->psz_type);
-    LOAD_STRING (cfg->psz_name);
-    LOAD_STRING (cfg->psz_text);
-    LOAD_STRING (cfg->psz_longtext);
-    LOAD_IMMEDIATE (cfg->list_count);
+    cfg->i_type = rec->type;
+    cfg->i_short = rec->shortname;
+    cfg->b_internal = (rec->flags & CACHE_CONFIG_INTERNAL) != 0;
+    cfg->b_unsaveable = (rec->flags & CACHE_CONFIG_UNSAVEABLE) != 0;
+    cfg->b_safe = (rec->flags & CACHE_CONFIG_SAFE) != 0;
+    cfg->b_removed = (rec->flags & CACHE_CONFIG_REMOVED) != 0;
+    MAP_STRING(cfg->psz_type, rec->psz_type);
+    MAP_STRING(cfg->psz_name, rec->name);
+    MAP_STRING(cfg->psz_text, rec->text);
+    MAP_STRING(cfg->psz_longtext, rec->longtext);
+    cfg->list_count = rec->list_count;
+
+    if (cfg->list_count == 0)
+        MAP_STRING(cfg->list_cb_name, rec->list_cb_name);
 
     if (IsConfigStringType (cfg->i_type))
     {
         const char *psz;
-        LOAD_STRING(psz);
+        MAP_STRING(psz, rec->orig.psz);
         cfg->orig.psz = (char *)psz;
         cfg->value.psz = (psz != NULL) ? strdup (cfg->orig.psz) : NULL;
 
         if (cfg->list_count)
-            cfg->list.psz = xmalloc (cfg->list_count * sizeof (char *));
-        else
-            LOAD_STRING(cfg->list_cb_name);
-        for (unsigned i = 0; i < cfg->list_count; i++)
         {
-            LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
+            cfg->list.psz = vlc_cache_map_strings(map, rec->list,
+                                                  cfg->list_count);
+            if (cfg->list.psz == NULL)
                 goto error;
         }
     }
     else
     {
-        LOAD_IMMEDIATE (cfg->orig);
-        LOAD_IMMEDIATE (cfg->min);
-        LOAD_IMMEDIATE (cfg->max);
+        if (IsConfigFloatType (cfg->i_type))
+        {
+            cfg->orig.f = rec->orig.f;
+            cfg->min.f = rec->min.f;
+            cfg->max.f = rec->max.f;
+        }
+        else
+        {
+            cfg->orig.i = rec->orig.i;
+            cfg->min.i = rec->min.i;
+            cfg->max.i = rec->max.i;
+        }
         cfg->value = cfg->orig;
 
         if (cfg->list_count)
         {
-            LOAD_ALIGNOF(*cfg->list.i);
+            /* used in place */
+            cfg->list.i = vlc_cache_map_array(map, rec->list,
+                                              sizeof (*cfg->list.i),
+                                              cfg->list_count);
+            if (cfg->list.i == NULL)
+                goto error;
         }
-        else
-            LOAD_STRING(cfg->list_cb_name);
-
-        LOAD_ARRAY(cfg->list.i, cfg->list_count);
     }
 
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
-    for (unsigned i = 0; i < cfg->list_count; i++)
+    if (cfg->list_count)
     {
-        LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
+        cfg->list_text = vlc_cache_map_strings(map, rec->list_text,
+                                               cfg->list_count);
+        if (cfg->list_text == NULL)
             goto error;
     }
 
     return 0;
 error:
-    return -1; /* FIXME: leaks */
+    return -1;
 }
 
-static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
+/**
+ * Checks the configuration records of a plug-in, and defers their loading
+ * until the plug-in configuration is actually used.
+ */
+static int vlc_cache_defer_plugin_config(vlc_plugin_t *plugin,
+                                         const struct vlc_cache_map *map,
+                                         const struct vlc_cache_config *recs,
+                                         size_t lines)
 {
-    uint16_t lines;
+    for (size_t i = 0; i < lines; i++)
+    {
+        const struct vlc_cache_config *rec = recs + i;
 
-    /* Calculate the structure length */
-    LOAD_IMMEDIATE (lines);
+        if (rec->name >= map->hdr.strings_size)
+            return -1;
 
-    /* Allocate memory */
-    if (lines)
-    {
-        plugin->conf.items = calloc(sizeof (module_config_t), lines);
-        if (unlikely(plugin->conf.items == NULL))
+        if (CONFIG_ITEM(rec->type))
         {
-            plugin->conf.size = 0;
-            return -1;
+            if (rec->name == 0)
+                return -1;
+
+            plugin->conf.count++;
+            if (rec->type == CONFIG_ITEM_BOOL)
+                plugin->conf.booleans++;
         }
     }
-    else
-        plugin->conf.items = NULL;
 
+    plugin->conf.items = NULL;
     plugin->conf.size = lines;
+    plugin->cache = map;
+    if (lines > 0)
+        atomic_store_explicit(&plugin->conf.deferred, (uintptr_t)recs,
+                              memory_order_relaxed);
+    return 0;
+}
 
-    /* Do the duplication job */
-    for (size_t i = 0; i < lines; i++)
+/**
+ * Loads the configuration items table of a plug-in from its deferred
+ * cache records.
+ */
+int vlc_cache_load_config(vlc_plugin_t *plugin)
+{
+    static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+    int ret = 0;
+
+    vlc_mutex_lock(&lock);
+
+    const struct vlc_cache_config *recs = (const void *)
+        atomic_load_explicit(&plugin->conf.deferred, memory_order_relaxed);
+    if (recs == NULL)
+        goto out; /* loaded by another thread in the mean time */
+
+    size_t lines = plugin->conf.size;
+    module_config_t *items = calloc(lines, sizeof (*items));
+    if (unlikely(items == NULL))
     {
-        module_config_t *item = plugin->conf.items + i;
+        ret = -1;
+        goto out;
+    }
 
-        if (vlc_cache_load_config(item, file))
-            return -1;
+    for (size_t i = 0; i < lines; i++)
+    {
+        module_config_t *item = items + i;
 
-        if (CONFIG_ITEM(item->i_type))
+        item->owner = plugin;
+        if (vlc_cache_load_item(item, plugin->cache, recs + i))
         {
-            plugin->conf.count++;
-            if (item->i_type == CONFIG_ITEM_BOOL)
-                plugin->conf.booleans++;
+            config_Free(items, lines);
+            ret = -1;
+            goto out;
         }
-        item->owner = plugin;
     }
 
-    return 0;
-error:
-    return -1; /* FIXME: leaks */
+    plugin->conf.items = items;
+    atomic_store_explicit(&plugin->conf.deferred, 0, memory_order_release);
+out:
+    vlc_mutex_unlock(&lock);
+    return ret;
 }
 
-static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
+const char *vlc_cache_config_name(const vlc_plugin_t *plugin,
+                                  const struct vlc_cache_config *rec, size_t i,
+                                  uint8_t *type, char *shortname)
+{
+    const struct vlc_cache_map *map = plugin->cache;
+
+    rec += i;
+    *type = rec->type;
+    *shortname = rec->shortname;
+    /* checked by vlc_cache_defer_plugin_config() */
+    return (rec->name != 0) ? map->strings + rec->name : NULL;
+}
+
+static int vlc_cache_load_module(vlc_plugin_t *plugin,
+                                 const struct vlc_cache_map *map,
+                                 const struct vlc_cache_module *rec)
 {
     module_t *module = vlc_module_create(plugin);
     if (unlikely(module == NULL))
         return -1;
 
-    LOAD_STRING(module->psz_shortname);
-    LOAD_STRING(module->psz_longname);
-    LOAD_STRING(module->psz_help);
+    MAP_STRING(module->psz_shortname, rec->shortname);
+    MAP_STRING(module->psz_longname, rec->longname);
+    MAP_STRING(module->psz_help, rec->help);
 
-    LOAD_IMMEDIATE(module->i_shortcuts);
-    if (module->i_shortcuts > MODULE_SHORTCUT_MAX)
+    if (rec->shortcuts_count > MODULE_SHORTCUT_MAX)
         goto error;
-    else
-    {
-        module->pp_shortcuts =
-            xmalloc (sizeof (*module->pp_shortcuts) * module->i_shortcuts);
-        for (unsigned j = 0; j < module->i_shortcuts; j++)
-            LOAD_STRING(module->pp_shortcuts[j]);
-    }
 
-    LOAD_STRING(module->activate_name);
-    LOAD_STRING(module->deactivate_name);
-    LOAD_STRING(module->psz_capability);
-    LOAD_IMMEDIATE(module->i_score);
+    module->i_shortcuts = rec->shortcuts_count;
+    module->pp_shortcuts = vlc_cache_map_strings(map, rec->shortcuts,
+                                                 module->i_shortcuts);
+    if (module->pp_shortcuts == NULL && module->i_shortcuts > 0)
+        goto error;
+
+    MAP_STRING(module->activate_name, rec->activate);
+    MAP_STRING(module->deactivate_name, rec->deactivate);
+    MAP_STRING(module->psz_capability, rec->capability);
+    module->i_score = rec->score;
     return 0;
 error:
     return -1;
 }
 
-static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
+static vlc_plugin_t *vlc_cache_load_plugin(const struct vlc_cache_map *map,
+                                           const struct vlc_cache_plugin *rec,
+                                           size_t *restrict modules,
+                                           size_t *restrict configs)
 {
+    if (rec->modules > map->hdr.modules - *modules
+     || rec->configs > map->hdr.configs - *configs)
+        return NULL;
+
     vlc_plugin_t *plugin = vlc_plugin_create();
     if (unlikely(plugin == NULL))
         return NULL;
 
-    uint32_t modules;
-    LOAD_IMMEDIATE(modules);
-
-    for (size_t i = 0; i < modules; i++)
-        if (vlc_cache_load_module(plugin, file))
+    for (size_t i = 0; i < rec->modules; i++)
+        if (vlc_cache_load_module(plugin, map, map->modules + *modules + i))
             goto error;
+    *modules += rec->modules;
 
-    if (vlc_cache_load_plugin_config(plugin, file))
+    if (vlc_cache_defer_plugin_config(plugin, map, map->configs + *configs,
+                                      rec->configs))
         goto error;
+    *configs += rec->configs;
 
-    LOAD_STRING(plugin->textdomain);
+    MAP_STRING(plugin->textdomain, rec->textdomain);
 
     const char *path;
-    LOAD_STRING(path);
+    MAP_STRING(path, rec->path);
     if (path == NULL)
         goto error;
 
@@ -343,9 +503,9 @@ static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
     if (unlikely(plugin->path == NULL))
         goto error;
 
-    LOAD_FLAG(plugin->unloadable);
-    LOAD_IMMEDIATE(plugin->mtime);
-    LOAD_IMMEDIATE(plugin->size);
+    plugin->unloadable = rec->unloadable != 0;
+    plugin->mtime = rec->mtime;
+    plugin->size = rec->size;
 
     if (plugin->textdomain != NULL)
         vlc_bindtextdomain(plugin->textdomain);
@@ -357,6 +517,48 @@ error:
     return NULL;
 }
 
+/**
+ * Maps the sections of a plugins cache file, after its textual header.
+ */
+static int vlc_cache_map(struct vlc_cache_map *map, block_t *file)
+{
+    const void *section;
+
+    if (((uintptr_t)file->p_buffer % CACHE_ALIGN) != 0
+     || vlc_cache_load_immediate(&map->hdr, file, sizeof (map->hdr)))
+        return -1;
+
+    if (vlc_cache_load_section(&section, sizeof (*map->plugins),
+                               map->hdr.plugins, file))
+        return -1;
+    map->plugins = section;
+
+    if (vlc_cache_load_section(&section, sizeof (*map->modules),
+                               map->hdr.modules, file))
+        return -1;
+    map->modules = section;
+
+    if (vlc_cache_load_section(&section, sizeof (*map->configs),
+                               map->hdr.configs, file))
+        return -1;
+    map->configs = section;
+
+    if ((map->hdr.data_size % CACHE_ALIGN) != 0
+     || vlc_cache_load_section(&section, 1, map->hdr.data_size, file))
+        return -1;
+    map->data = section;
+
+    if (vlc_cache_load_section(&section, 1, map->hdr.strings_size, file))
+        return -1;
+    map->strings = section;
+
+    if (file->i_buffer != 0 || map->hdr.strings_size == 0
+     || map->strings[0] != '\0'
+     || map->strings[map->hdr.strings_size - 1] != '\0')
+        return -1;
+    return 0;
+}
+
 /**
  * Loads a plugins cache file.
  *
@@ -385,6 +587,8 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
     if (file == NULL)
         return NULL;
 
+    const uint8_t *base = file->p_buffer;
+
     /* Check the file is a plugins cache */
     char cachestr[sizeof (CACHE_STRING) - 1];
 
@@ -422,13 +626,17 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
     }
 
     /* Check header marker */
-    if (vlc_cache_load_immediate(&marker, file, sizeof (marker))
 #ifdef DISTRO_VERSION
-     || marker != (sizeof (cachestr) + sizeof (distrostr) + sizeof (marker))
+    uint32_t header_size = sizeof (cachestr) + sizeof (distrostr)
+                         + 2 * sizeof (marker);
 #else
-     || marker != (sizeof (cachestr) + sizeof (marker))
+    uint32_t header_size = sizeof (cachestr) + 2 * sizeof (marker);
 #endif
-        )
+    header_size = (header_size + CACHE_ALIGN - 1) & ~(CACHE_ALIGN - 1);
+
+    if (vlc_cache_load_immediate(&marker, file, sizeof (marker))
+     || marker != header_size
+     || file->i_buffer < header_size - (size_t)(file->p_buffer - base))
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(corrupted header)" );
@@ -436,11 +644,34 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
         return NULL;
     }
 
+    /* Skip the alignment padding */
+    file->i_buffer -= header_size - (file->p_buffer - base);
+    file->p_buffer += header_size - (file->p_buffer - base);
+
     vlc_plugin_t *cache = NULL;
+    size_t modules = 0, configs = 0;
+
+    /* The mapping must outlive the plug-ins, for their deferred
+     * configuration: keep it with the file. */
+    struct vlc_cache_file *cf = malloc(sizeof (*cf));
+    if (unlikely(cf == NULL))
+    {
+        block_Release(file);
+        return NULL;
+    }
+
+    block_Init(&cf->self, &vlc_cache_file_cbs, NULL, 0);
+    cf->file = file;
+
+    const struct vlc_cache_map *map = &cf->map;
 
-    while (file->i_buffer > 0)
+    if (vlc_cache_map(&cf->map, file))
+        goto error;
+
+    for (size_t i = 0; i < map->hdr.plugins; i++)
     {
-        vlc_plugin_t *plugin = vlc_cache_load_plugin(file);
+        vlc_plugin_t *plugin = vlc_cache_load_plugin(map, map->plugins + i,
+                                                     &modules, &configs);
         if (plugin == NULL)
             goto error;
 
@@ -456,144 +687,248 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
         cache = plugin;
     }
 
-    file->p_next = *backingp;
-    *backingp = file;
+    cf->self.p_next = *backingp;
+    *backingp = &cf->self;
     return cache;
 
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
 
-    /* TODO: cleanup */
-    block_Release(file);
+    while (cache != NULL)
+    {
+        vlc_plugin_t *plugin = cache;
+
+        cache = plugin->next;
+        vlc_plugin_destroy(plugin);
+    }
+    block_Release(&cf->self);
     return NULL;
 }
 
-#define SAVE_IMMEDIATE( a ) \
-    if (fwrite (&(a), sizeof(a), 1, file) != 1) \
-        goto error
-#define SAVE_FLAG(a) \
-    do { \
-        char b = (a); \
-        SAVE_IMMEDIATE(b); \
-    } while (0)
+/**
+ * Growable buffer for the cache file sections.
+ */
+struct cache_buf
+{
+    uint8_t *data;
+    size_t size;
+    size_t alloc;
+    bool error;
+};
+
+static void CacheBufInit(struct cache_buf *buf)
+{
+    buf->data = NULL;
+    buf->size = 0;
+    buf->alloc = 0;
+    buf->error = false;
+}
 
-static int CacheSaveString (FILE *file, const char *str)
+/**
+ * Appends aligned data to a buffer.
+ *
+ * \return the offset of the data within the buffer
+ */
+static uint32_t CacheBufAppend(struct cache_buf *buf, const void *data,
+                               size_t len, size_t align)
 {
-    uint16_t size = (str != NULL) ? (strlen (str) + 1) : 0;
+    size_t offset = (buf->size + align - 1) & ~(align - 1);
 
-    SAVE_IMMEDIATE (size);
-    if (size != 0 && fwrite(str, 1, size, file) != size)
+    if (offset + len > UINT32_MAX)
+        buf->error = true;
+    if (buf->error)
+        return 0;
+
+    if (offset + len > buf->alloc)
     {
-error:
-        return -1;
+        size_t alloc = buf->alloc ? buf->alloc : 4096;
+
+        while (alloc < offset + len)
+            alloc *= 2;
+
+        uint8_t *p = realloc(buf->data, alloc);
+        if (unlikely(p == NULL))
+        {
+            buf->error = true;
+            return 0;
+        }
+        buf->data = p;
+        buf->alloc = alloc;
     }
-    return 0;
-}
 
-#define SAVE_STRING( a ) \
-    if (CacheSaveString (file, (a))) \
-        goto error
+    memset(buf->data + buf->size, 0, offset - buf->size);
+    if (len > 0)
+        memcpy(buf->data + offset, data, len);
+    buf->size = offset + len;
+    return offset;
+}
 
-static int CacheSaveAlign(FILE *file, size_t align)
+struct cache_writer
 {
-    assert(align > 0);
+    struct cache_buf modules;
+    struct cache_buf configs;
+    struct cache_buf data;
+    struct cache_buf strings;
+};
 
-    size_t skip = (-ftell(file)) % align;
-    if (skip == 0)
+static vlc_cache_str_t CacheSaveString(struct cache_writer *w, const char *str)
+{
+    if (str == NULL)
         return 0;
-
-    assert(((ftell(file) + skip) % align) == 0);
-    return fseek(file, skip, SEEK_CUR);
+    return CacheBufAppend(&w->strings, str, strlen(str) + 1, 1);
 }
 
-#define SAVE_ALIGNOF(t) \
-    if (CacheSaveAlign(file, alignof (t))) \
-        goto error
+static uint32_t CacheSaveStrings(struct cache_writer *w,
+                                 const char *const *tab, size_t n)
+{
+    uint32_t offsets[n > 0 ? n : 1];
+
+    for (size_t i = 0; i < n; i++)
+        offsets[i] = CacheSaveString(w, tab[i]);
+    return CacheBufAppend(&w->data, offsets, n * sizeof (*offsets),
+                          CACHE_ALIGN);
+}
 
-static int CacheSaveConfig (FILE *file, const module_config_t *cfg)
+static void CacheSaveConfig(struct cache_writer *w, const module_config_t *cfg)
 {
-    SAVE_IMMEDIATE (cfg->i_type);
-    SAVE_IMMEDIATE (cfg->i_short);
-    SAVE_FLAG (cfg->b_internal);
-    SAVE_FLAG (cfg->b_unsaveable);
-    SAVE_FLAG (cfg->b_safe);
-    SAVE_FLAG (cfg->b_removed);
-    SAVE_STRING (cfg->psz_type);
-    SAVE_STRING (cfg->psz_name);
-    SAVE_STRING (cfg->psz_text);
-    SAVE_STRING (cfg->psz_longtext);
-    SAVE_IMMEDIATE (cfg->list_count);
+    struct vlc_cache_config rec;
+
+    memset(&rec, 0, sizeof (rec));
+    rec.type = cfg->i_type;
+    rec.shortname = cfg->i_short;
+    rec.flags = (cfg->b_internal ? CACHE_CONFIG_INTERNAL : 0)
+              | (cfg->b_unsaveable ? CACHE_CONFIG_UNSAVEABLE : 0)
+              | (cfg->b_safe ? CACHE_CONFIG_SAFE : 0)
+              | (cfg->b_removed ? CACHE_CONFIG_REMOVED : 0);
+    rec.psz_type = CacheSaveString(w, cfg->psz_type);
+    rec.name = CacheSaveString(w, cfg->psz_name);
+    rec.text = CacheSaveString(w, cfg->psz_text);
+    rec.longtext = CacheSaveString(w, cfg->psz_longtext);
+    rec.list_count = cfg->list_count;
+
+    if (cfg->list_count == 0)
+        rec.list_cb_name = CacheSaveString(w, cfg->list_cb_name);
 
     if (IsConfigStringType (cfg->i_type))
     {
-        SAVE_STRING (cfg->orig.psz);
-        if (cfg->list_count == 0)
-            SAVE_STRING(cfg->list_cb_name);
-
-        for (unsigned i = 0; i < cfg->list_count; i++)
-            SAVE_STRING (cfg->list.psz[i]);
+        rec.orig.psz = CacheSaveString(w, cfg->orig.psz);
+        if (cfg->list_count > 0)
+            rec.list = CacheSaveStrings(w, cfg->list.psz, cfg->list_count);
     }
     else
     {
-        SAVE_IMMEDIATE (cfg->orig);
-        SAVE_IMMEDIATE (cfg->min);
-        SAVE_IMMEDIATE (cfg->max);
-
-        if (cfg->list_count > 0)
+        if (IsConfigFloatType (cfg->i_type))
         {
-            SAVE_ALIGNOF(*cfg->list.i);
+            rec.orig.f = cfg->orig.f;
+            rec.min.f = cfg->min.f;
+            rec.max.f = cfg->max.f;
         }
         else
-            SAVE_STRING(cfg->list_cb_name);
+        {
+            rec.orig.i = cfg->orig.i;
+            rec.min.i = cfg->min.i;
+            rec.max.i = cfg->max.i;
+        }
 
-        for (unsigned i = 0; i < cfg->list_count; i++)
-             SAVE_IMMEDIATE (cfg->list.i[i]);
+        if (cfg->list_count > 0)
+            rec.list = CacheBufAppend(&w->data, cfg->list.i,
+                                      cfg->list_count * sizeof (*cfg->list.i),
+                                      CACHE_ALIGN);
     }
-    for (unsigned i = 0; i < cfg->list_count; i++)
-        SAVE_STRING (cfg->list_text[i]);
 
-    return 0;
-error:
-    return -1;
+    if (cfg->list_count > 0)
+        rec.list_text = CacheSaveStrings(w, cfg->list_text, cfg->list_count);
+
+    CacheBufAppend(&w->configs, &rec, sizeof (rec), CACHE_ALIGN);
 }
 
-static int CacheSaveModuleConfig(FILE *file, const vlc_plugin_t *plugin)
+static void CacheSaveModule(struct cache_writer *w, const module_t *module)
 {
-    uint16_t lines = plugin->conf.size;
-
-    SAVE_IMMEDIATE (lines);
-
-    for (size_t i = 0; i < lines; i++)
-        if (CacheSaveConfig(file, plugin->conf.items + i))
-           goto error;
-
-    return 0;
-error:
-    return -1;
+    struct vlc_cache_module rec;
+
+    memset(&rec, 0, sizeof (rec));
+    rec.shortname = CacheSaveString(w, module->psz_shortname);
+    rec.longname = CacheSaveString(w, module->psz_longname);
+    rec.help = CacheSaveString(w, module->psz_help);
+    rec.shortcuts = CacheSaveStrings(w, module->pp_shortcuts,
+                                     module->i_shortcuts);
+    rec.shortcuts_count = module->i_shortcuts;
+    rec.activate = CacheSaveString(w, module->activate_name);
+    rec.deactivate = CacheSaveString(w, module->deactivate_name);
+    rec.capability = CacheSaveString(w, module->psz_capability);
+    rec.score = module->i_score;
+
+    CacheBufAppend(&w->modules, &rec, sizeof (rec), CACHE_ALIGN);
 }
 
-static int CacheSaveModule(FILE *file, const module_t *module)
+/**
+ * Saves the submodules in reverse order: vlc_module_create() inserts each
+ * of them right after the main module, so that the modules are loaded back
+ * in the same order. Otherwise the order would flip whenever a cached
+ * plug-in is saved again.
+ */
+static void CacheSaveSubmodules(struct cache_writer *w, const module_t *module)
 {
-    SAVE_STRING(module->psz_shortname);
-    SAVE_STRING(module->psz_longname);
-    SAVE_STRING(module->psz_help);
-    SAVE_IMMEDIATE(module->i_shortcuts);
-
-    for (size_t j = 0; j < module->i_shortcuts; j++)
-         SAVE_STRING(module->pp_shortcuts[j]);
+    if (module == NULL)
+        return;
 
-    SAVE_STRING(module->activate_name);
-    SAVE_STRING(module->deactivate_name);
-    SAVE_STRING(module->psz_capability);
-    SAVE_IMMEDIATE(module->i_score);
-    return 0;
-error:
-    return -1;
+    CacheSaveSubmodules(w, module->next);
+    CacheSaveModule(w, module);
 }
 
 static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
 {
+    struct cache_writer w;
+    struct cache_buf plugins;
     uint32_t i_file_size = 0;
+    size_t modules = 0, configs = 0;
+    int ret = -1;
+
+    CacheBufInit(&plugins);
+    CacheBufInit(&w.modules);
+    CacheBufInit(&w.configs);
+    CacheBufInit(&w.data);
+    CacheBufInit(&w.strings);
+    /* offset zero is reserved for NULL */
+    CacheBufAppend(&w.strings, "", 1, 1);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const vlc_plugin_t *plugin = cache[i];
+        struct vlc_cache_plugin rec;
+
+        memset(&rec, 0, sizeof (rec));
+        rec.modules = plugin->modules_count;
+
+        if (plugin->module != NULL)
+        {
+            CacheSaveModule(&w, plugin->module);
+            CacheSaveSubmodules(&w, plugin->module->next);
+        }
+
+        /* Config stuff */
+        if (vlc_plugin_load_config(cache[i]))
+            goto error;
+
+        rec.configs = plugin->conf.size;
+        for (size_t j = 0; j < plugin->conf.size; j++)
+            CacheSaveConfig(&w, plugin->conf.items + j);
+
+        /* Save common info */
+        rec.textdomain = CacheSaveString(&w, plugin->textdomain);
+        rec.path = CacheSaveString(&w, plugin->path);
+        rec.unloadable = plugin->unloadable;
+        rec.mtime = plugin->mtime;
+        rec.size = plugin->size;
+
+        modules += rec.modules;
+        configs += rec.configs;
+        CacheBufAppend(&plugins, &rec, sizeof (rec), CACHE_ALIGN);
+    }
+
+    if (plugins.error || w.modules.error || w.configs.error || w.data.error
+     || w.strings.error)
+        goto error;
 
     /* Contains version number */
     if (fputs (CACHE_STRING, file) == EOF)
@@ -609,42 +944,51 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1 )
         goto error;
 
-    /* Header marker */
-    i_file_size = ftell( file );
+    /* Header marker (the records start aligned after it) */
+    i_file_size = ftell( file ) + sizeof (i_file_size);
+    i_file_size = (i_file_size + CACHE_ALIGN - 1) & ~(CACHE_ALIGN - 1);
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
-    for (size_t i = 0; i < n; i++)
-    {
-        const vlc_plugin_t *plugin = cache[i];
-        uint32_t count = plugin->modules_count;
-
-        SAVE_IMMEDIATE(count);
-
-        for (module_t *module = plugin->module;
-             module != NULL;
-             module = module->next)
-            if (CacheSaveModule(file, module))
-                goto error;
-
-        /* Config stuff */
-        if (CacheSaveModuleConfig(file, plugin))
-            goto error;
+    static const uint8_t padding[CACHE_ALIGN];
+    size_t skip = i_file_size - ftell(file);
+    if (skip > 0 && fwrite(padding, skip, 1, file) != 1)
+        goto error;
 
-        /* Save common info */
-        SAVE_STRING(plugin->textdomain);
-        SAVE_STRING(plugin->path);
-        SAVE_FLAG(plugin->unloadable);
-        SAVE_IMMEDIATE(plugin->mtime);
-        SAVE_IMMEDIATE(plugin->size);
-    }
+    /* pad the data so that the string table ends the file */
+    CacheBufAppend(&w.data, NULL, 0, CACHE_ALIGN);
+
+    struct vlc_cache_header hdr = {
+        .plugins = n,
+        .modules = modules,
+        .configs = configs,
+        .data_size = w.data.size,
+        .strings_size = w.strings.size,
+    };
+
+    if (fwrite(&hdr, sizeof (hdr), 1, file) != 1
+     || (plugins.size > 0
+      && fwrite(plugins.data, plugins.size, 1, file) != 1)
+     || (w.modules.size > 0
+      && fwrite(w.modules.data, w.modules.size, 1, file) != 1)
+     || (w.configs.size > 0
+      && fwrite(w.configs.data, w.configs.size, 1, file) != 1)
+     || (w.data.size > 0
+      && fwrite(w.data.data, w.data.size, 1, file) != 1)
+     || fwrite(w.strings.data, w.strings.size, 1, file) != 1)
+        goto error;
 
     if (fflush (file)) /* flush libc buffers */
         goto error;
-    return 0; /* success! */
+    ret = 0; /* success! */
 
 error:
-    return -1;
+    free(plugins.data);
+    free(w.modules.data);
+    free(w.configs.data);
+    free(w.data.data);
+    free(w.strings.data);
+    return ret;
 }
 
 /**
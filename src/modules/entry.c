@@ -109,6 +109,8 @@ vlc_plugin_t *vlc_plugin_create(void)
     atomic_init(&plugin->handle, 0);
     plugin->abspath = NULL;
     plugin->path = NULL;
+    plugin->cache = NULL;
+    atomic_init(&plugin->conf.deferred, 0);
 #endif
     plugin->module = NULL;
 
@@ -130,7 +132,8 @@ void vlc_plugin_destroy(vlc_plugin_t *plugin)
     if (plugin->module != NULL)
         vlc_module_destroy(plugin->module);
 
-    config_Free(plugin->conf.items, plugin->conf.size);
+    if (plugin->conf.items != NULL)
+        config_Free(plugin->conf.items, plugin->conf.size);
 #ifdef HAVE_DYNAMIC_PLUGINS
     free(plugin->abspath);
     free(plugin->path);
@@ -138,6 +141,32 @@ void vlc_plugin_destroy(vlc_plugin_t *plugin)
     free(plugin);
 }
 
+int vlc_plugin_load_config(vlc_plugin_t *plugin)
+{
+#ifdef HAVE_DYNAMIC_PLUGINS
+    if (atomic_load_explicit(&plugin->conf.deferred, memory_order_acquire))
+        return vlc_cache_load_config(plugin);
+#endif
+    return (plugin->conf.items != NULL || plugin->conf.size == 0) ? 0 : -1;
+}
+
+const char *vlc_plugin_config_name(const vlc_plugin_t *plugin, size_t i,
+                                   uint8_t *type, char *shortname)
+{
+    assert(i < plugin->conf.size);
+#ifdef HAVE_DYNAMIC_PLUGINS
+    const struct vlc_cache_config *deferred = (const void *)
+        atomic_load_explicit(&plugin->conf.deferred, memory_order_acquire);
+    if (deferred != NULL)
+        return vlc_cache_config_name(plugin, deferred, i, type, shortname);
+#endif
+    const module_config_t *item = plugin->conf.items + i;
+
+    *type = item->i_type;
+    *shortname = item->i_short;
+    return item->psz_name;
+}
+
 static module_config_t *vlc_config_create(vlc_plugin_t *plugin, int type)
 {
     unsigned confsize = plugin->conf.size;
@@ -603,6 +632,9 @@ int vlc_plugin_resolve(vlc_plugin_t *plugin, vlc_plugin_cb entry)
     }
 
     /* Resolve configuration callbacks */
+    if (vlc_plugin_load_config(plugin))
+        goto error;
+
     for (size_t i = 0; i < plugin->conf.size; i++)
     {
         module_config_t *item = plugin->conf.items + i;
@@ -324,9 +324,10 @@ bool module_exists (const char * psz_name)
 
 module_config_t *module_config_get( const module_t *module, unsigned *restrict psize )
 {
-    const vlc_plugin_t *plugin = module->plugin;
+    vlc_plugin_t *plugin = module->plugin;
 
-    if (plugin->module != module)
+    if (plugin->module != module
+     || vlc_plugin_load_config(plugin))
     {   /* For backward compatibility, pretend non-first modules have no
          * configuration items. */
         *psize = 0;
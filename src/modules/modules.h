@@ -43,6 +43,15 @@ typedef struct vlc_plugin_t
         size_t size; /**< Size of items table */
         size_t count; /**< Number of configuration items */
         size_t booleans; /**< Number of booleal config items */
+#ifdef HAVE_DYNAMIC_PLUGINS
+        /**
+         * Records of the configuration items not loaded yet (or nul)
+         *
+         * Plug-ins read from the plugins cache only get their items table
+         * on first use, see vlc_plugin_load_config().
+         */
+        atomic_uintptr_t deferred;
+#endif
     } conf;
 
 #ifdef HAVE_DYNAMIC_PLUGINS
@@ -53,6 +62,7 @@ typedef struct vlc_plugin_t
     char *path; /**< Relative path (within plug-in directory) */
     int64_t mtime; /**< Last modification time */
     uint64_t size; /**< File size */
+    const struct vlc_cache_map *cache; /**< Backing plugins cache (or NULL) */
 #endif
 } vlc_plugin_t;
 
@@ -106,6 +116,25 @@ void vlc_module_destroy (module_t *);
 vlc_plugin_t *vlc_plugin_describe(vlc_plugin_cb);
 int vlc_plugin_resolve(vlc_plugin_t *, vlc_plugin_cb);
 
+/**
+ * Makes sure the configuration items table of a plug-in is loaded.
+ *
+ * This must be called before accessing plugin->conf.items.
+ * \return 0 on success, -1 on error (the table must not be used then).
+ */
+int vlc_plugin_load_config(vlc_plugin_t *);
+
+/**
+ * Describes a configuration item of a plug-in without loading the table.
+ *
+ * \param i index of the item, less than plugin->conf.size
+ * \param type [out] type of the item
+ * \param shortname [out] short option name of the item (or nul)
+ * \return the name of the item (or NULL for hints)
+ */
+const char *vlc_plugin_config_name(const vlc_plugin_t *, size_t i,
+                                   uint8_t *type, char *shortname);
+
 void module_InitBank (void);
 void module_LoadPlugins(vlc_object_t *);
 #define module_LoadPlugins(a) module_LoadPlugins(VLC_OBJECT(a))
@@ -163,6 +192,11 @@ char *vlc_dlerror(void) VLC_USED;
 /* Plugins cache */
 vlc_plugin_t *vlc_cache_load(vlc_object_t *, const char *, block_t **);
 vlc_plugin_t *vlc_cache_lookup(vlc_plugin_t **, const char *relpath);
+struct vlc_cache_config;
+int vlc_cache_load_config(vlc_plugin_t *);
+const char *vlc_cache_config_name(const vlc_plugin_t *,
+                                  const struct vlc_cache_config *, size_t i,
+                                  uint8_t *type, char *shortname);
 
 void CacheSave(vlc_object_t *, const char *, vlc_plugin_t *const *, size_t);
 
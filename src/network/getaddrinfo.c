@@ -35,6 +35,7 @@
 
 #include <sys/types.h>
 #include <vlc_network.h>
+#include "network.h"
 
 int vlc_getnameinfo( const struct sockaddr *sa, int salen,
                      char *host, int hostlen, int *portnum, int flags )
@@ -129,3 +130,186 @@ int vlc_getaddrinfo_i11e(const char *node, unsigned port,
     return vlc_getaddrinfo(node, port, hints, res);
 }
 #endif
+
+/*
+ * Resolver cache.
+ *
+ * getaddrinfo() does not return the time-to-live of the DNS records, so
+ * entries are kept for a short fixed time, below the usual TTL of content
+ * delivery networks.
+ */
+#define RESOLVER_CACHE_SIZE     16
+#define RESOLVER_CACHE_LIFETIME VLC_TICK_FROM_SEC(30)
+
+struct vlc_resolver_entry
+{
+    char *node;
+    unsigned port;
+    int family;
+    int socktype;
+    int protocol;
+    int flags;
+    vlc_tick_t expiry;
+    struct addrinfo *res;
+};
+
+static vlc_mutex_t resolver_lock = VLC_STATIC_MUTEX;
+static struct vlc_resolver_entry resolver_cache[RESOLVER_CACHE_SIZE];
+
+void vlc_freeaddrinfo_cached(struct addrinfo *res)
+{
+    while (res != NULL)
+    {
+        struct addrinfo *next = res->ai_next;
+
+        /* the address and canonical name are in the same allocation */
+        free(res);
+        res = next;
+    }
+}
+
+static struct addrinfo *vlc_addrinfo_dup(const struct addrinfo *src)
+{
+    struct addrinfo *res = NULL, **pp = &res;
+
+    for (const struct addrinfo *p = src; p != NULL; p = p->ai_next)
+    {
+        size_t namelen = (p->ai_canonname != NULL)
+                       ? strlen(p->ai_canonname) + 1 : 0;
+        struct addrinfo *ai = malloc(sizeof (*ai) + p->ai_addrlen + namelen);
+        if (unlikely(ai == NULL))
+        {
+            vlc_freeaddrinfo_cached(res);
+            return NULL;
+        }
+
+        *ai = *p;
+        ai->ai_addr = (struct sockaddr *)(ai + 1);
+        memcpy(ai->ai_addr, p->ai_addr, p->ai_addrlen);
+        if (namelen > 0)
+        {
+            ai->ai_canonname = (char *)ai->ai_addr + p->ai_addrlen;
+            memcpy(ai->ai_canonname, p->ai_canonname, namelen);
+        }
+        ai->ai_next = NULL;
+        *pp = ai;
+        pp = &ai->ai_next;
+    }
+    return res;
+}
+
+static bool vlc_resolver_match(const struct vlc_resolver_entry *e,
+                               const char *node, unsigned port,
+                               const struct addrinfo *hints)
+{
+    if (e->node == NULL || strcmp(e->node, node) || e->port != port)
+        return false;
+    if (hints == NULL)
+        return e->family == AF_UNSPEC && e->socktype == 0
+            && e->protocol == 0 && e->flags == 0;
+    return e->family == hints->ai_family && e->socktype == hints->ai_socktype
+        && e->protocol == hints->ai_protocol && e->flags == hints->ai_flags;
+}
+
+static void vlc_resolver_clear(struct vlc_resolver_entry *e)
+{
+    free(e->node);
+    vlc_freeaddrinfo_cached(e->res);
+    e->node = NULL;
+    e->res = NULL;
+}
+
+int vlc_getaddrinfo_cached(const char *node, unsigned port,
+                           const struct addrinfo *hints,
+                           struct addrinfo **res)
+{
+    struct addrinfo *info;
+
+    if (node != NULL && node[0] != '\0')
+    {
+        vlc_tick_t now = vlc_tick_now();
+
+        vlc_mutex_lock(&resolver_lock);
+        for (size_t i = 0; i < RESOLVER_CACHE_SIZE; i++)
+        {
+            struct vlc_resolver_entry *e = &resolver_cache[i];
+
+            if (!vlc_resolver_match(e, node, port, hints))
+                continue;
+            if (e->expiry > now)
+            {
+                info = vlc_addrinfo_dup(e->res);
+                vlc_mutex_unlock(&resolver_lock);
+                if (unlikely(info == NULL))
+                    return EAI_MEMORY;
+                *res = info;
+                return 0;
+            }
+            vlc_resolver_clear(e);
+            break;
+        }
+        vlc_mutex_unlock(&resolver_lock);
+    }
+
+    int val = vlc_getaddrinfo_i11e(node, port, hints, &info);
+    if (val)
+        return val;
+
+    *res = vlc_addrinfo_dup(info);
+    freeaddrinfo(info);
+    if (unlikely(*res == NULL))
+        return EAI_MEMORY;
+
+    if (node == NULL || node[0] == '\0')
+        return 0;
+
+    char *name = strdup(node);
+    info = vlc_addrinfo_dup(*res);
+    if (unlikely(name == NULL || info == NULL))
+    {
+        free(name);
+        vlc_freeaddrinfo_cached(info);
+        return 0;
+    }
+
+    vlc_mutex_lock(&resolver_lock);
+    /* Replace the same name resolved concurrently, a free entry, or else
+     * the entry closest to expiry. */
+    struct vlc_resolver_entry *e = &resolver_cache[0];
+    for (size_t i = 0; i < RESOLVER_CACHE_SIZE; i++)
+    {
+        struct vlc_resolver_entry *c = &resolver_cache[i];
+
+        if (vlc_resolver_match(c, node, port, hints) || c->node == NULL)
+        {
+            e = c;
+            break;
+        }
+        if (c->expiry < e->expiry)
+            e = c;
+    }
+    vlc_resolver_clear(e);
+    e->node = name;
+    e->port = port;
+    e->family = (hints != NULL) ? hints->ai_family : AF_UNSPEC;
+    e->socktype = (hints != NULL) ? hints->ai_socktype : 0;
+    e->protocol = (hints != NULL) ? hints->ai_protocol : 0;
+    e->flags = (hints != NULL) ? hints->ai_flags : 0;
+    e->expiry = vlc_tick_now() + RESOLVER_CACHE_LIFETIME;
+    e->res = info;
+    vlc_mutex_unlock(&resolver_lock);
+    return 0;
+}
+
+void vlc_getaddrinfo_forget(const char *node, unsigned port,
+                            const struct addrinfo *hints)
+{
+    if (node == NULL)
+        return;
+
+    vlc_mutex_lock(&resolver_lock);
+    for (size_t i = 0; i < RESOLVER_CACHE_SIZE; i++)
+        if (vlc_resolver_match(&resolver_cache[i], node, port, hints))
+            vlc_resolver_clear(&resolver_cache[i]);
+    vlc_mutex_unlock(&resolver_lock);
+}
@@ -42,11 +42,15 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_memstats.h>
 #include "../libvlc.h"
 
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
 #endif
@@ -70,6 +74,9 @@
 
 static void httpd_ClientDestroy(httpd_client_t *cl);
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static void httpd_HostWakeUp(httpd_host_t *host);
+static httpd_url_t *httpd_UrlNewPrefix(httpd_host_t *, const char *,
+                                       const char *, const char *);
 
 /* each host run in his own thread */
 struct httpd_host_t
@@ -89,6 +96,10 @@ struct httpd_host_t
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
+    /* wakes the thread up when stream data is available, -1 if unsupported */
+    int         wakeup[2];
+    atomic_bool wakeup_pending;
+
     /* all registered url (becarefull that 2 httpd_url_t could point at the same url)
      * This will slow down the url research but make my live easier
      * All url will have their cb trigger, but only the first one can answer
@@ -112,6 +123,7 @@ struct httpd_url_t
     char      *psz_url;
     char      *psz_user;
     char      *psz_password;
+    bool       b_prefix; /* also matches the URLs below psz_url */
 
     struct
     {
@@ -147,6 +159,9 @@ struct httpd_client_t
     bool    b_stream_mode;
     uint8_t i_state;
 
+    /* stream sent straight from its buffer, or NULL */
+    httpd_stream_t *stream;
+
     vlc_tick_t i_activity_date;
     vlc_tick_t i_activity_timeout;
 
@@ -288,6 +303,14 @@ static size_t httpd_HtmlError (char **body, int code, const char *url)
 }
 
 
+/* Whether the client asked to close the connection after the answer */
+static bool httpd_MsgWantsClose(const httpd_message_t *query)
+{
+    const char *psz_connection = httpd_MsgGet(query, "Connection");
+
+    return psz_connection != NULL && strcasestr(psz_connection, "close");
+}
+
 /*****************************************************************************
  * High Level Functions: httpd_file_t
  *****************************************************************************/
@@ -341,7 +364,7 @@ httpd_FileCallBack(httpd_callback_sys_t *p_sys, httpd_client_t *cl,
         free(p_body);
 
     /* We respect client request */
-    if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+    if (httpd_MsgWantsClose(&cl->query))
         httpd_MsgAdd(answer, "Connection", "close");
 
     httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
@@ -545,7 +568,7 @@ static int httpd_RedirectCallBack(httpd_callback_sys_t *p_sys,
 
     httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
 
-    if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+    if (httpd_MsgWantsClose(&cl->query))
         httpd_MsgAdd(answer, "Connection", "close");
 
     return VLC_SUCCESS;
@@ -585,6 +608,268 @@ void httpd_RedirectDelete(httpd_redirect_t *rdir)
     free(rdir);
 }
 
+/*****************************************************************************
+ * High Level Functions: httpd_dir_t
+ *****************************************************************************/
+/* Files are read and sent per chunk of that size */
+#define HTTPD_DIR_CHUNK (512 * 1024)
+
+struct httpd_dir_t
+{
+    httpd_url_t *url;
+    char         path[1];
+};
+
+/* Opens the regular file matching the URL, never outside of the directory */
+static int httpd_DirOpen(const httpd_dir_t *dir, const char *psz_url,
+                         struct stat *st)
+{
+    size_t urllen = strlen(dir->url->psz_url);
+    char *psz_name = vlc_uri_decode_duplicate(psz_url + urllen);
+    if (psz_name == NULL)
+        return -1;
+
+    for (const char *p = psz_name; *p != '\0'; p += strcspn(p, "/"))
+    {
+        p += strspn(p, "/");
+        if (!strncmp(p, "..", 2) && (p[2] == '/' || p[2] == '\0'))
+        {
+            free(psz_name);
+            return -1;
+        }
+    }
+
+    char *psz_path;
+    if (psz_name[0] == '\0' || strchr(psz_name, '\\') != NULL
+     || asprintf(&psz_path, "%s/%s", dir->path, psz_name) < 0)
+    {
+        free(psz_name);
+        return -1;
+    }
+    free(psz_name);
+
+    int fd = vlc_open(psz_path, O_RDONLY);
+    free(psz_path);
+    if (fd == -1)
+        return -1;
+
+    if (fstat(fd, st) || !S_ISREG(st->st_mode))
+    {
+        vlc_close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Parses a single byte range, returns 1 if the whole file shall be sent */
+static int httpd_DirRange(const char *psz_range, uint64_t i_size,
+                          uint64_t *pi_start, uint64_t *pi_end)
+{
+    unsigned long long start, end;
+
+    *pi_start = 0;
+    *pi_end = i_size;
+
+    if (psz_range == NULL || strncasecmp(psz_range, "bytes=", 6))
+        return 1;
+    psz_range += 6;
+    if (strchr(psz_range, ',') != NULL)
+        return 1; /* multiple ranges are not supported, send everything */
+
+    if (sscanf(psz_range, " -%llu", &end) == 1)
+    {   /* suffix */
+        if (end == 0)
+            return -1;
+        *pi_start = (end < i_size) ? i_size - end : 0;
+    }
+    else if (sscanf(psz_range, " %llu-%llu", &start, &end) == 2)
+    {
+        if (end < start)
+            return 1;
+        *pi_start = start;
+        if (end + 1 < i_size)
+            *pi_end = end + 1;
+    }
+    else if (sscanf(psz_range, " %llu-", &start) == 1)
+        *pi_start = start;
+    else
+        return 1;
+
+    return (*pi_start < i_size) ? 0 : -1;
+}
+
+/* Whether the (comma-separated) If-None-Match list contains the entity tag */
+static bool httpd_DirMatch(const char *psz_list, const char *psz_etag)
+{
+    size_t len = strlen(psz_etag);
+
+    while (*psz_list != '\0')
+    {
+        psz_list += strspn(psz_list, " \t,");
+        if (!strncmp(psz_list, "W/", 2))
+            psz_list += 2;
+        if (*psz_list == '*' || (!strncmp(psz_list, psz_etag, len)
+         && strchr(" \t,", psz_list[len]) != NULL))
+            return true;
+        psz_list += strcspn(psz_list, ",");
+    }
+    return false;
+}
+
+static int httpd_DirCallBack(httpd_callback_sys_t *p_sys, httpd_client_t *cl,
+                             httpd_message_t *answer,
+                             const httpd_message_t *query)
+{
+    httpd_dir_t *dir = (httpd_dir_t *)p_sys;
+    struct stat st;
+    uint64_t i_start, i_end;
+    (void) cl;
+
+    if (!answer || !query)
+        return VLC_SUCCESS;
+
+    int fd = httpd_DirOpen(dir, query->psz_url, &st);
+    if (fd == -1)
+        return VLC_EGENERIC; /* not found */
+
+    const char *psz_range = httpd_MsgGet(query, "Range");
+    int i_range = httpd_DirRange(psz_range, st.st_size, &i_start, &i_end);
+
+    if (answer->i_body_offset > 0)
+    {   /* next chunk of an answer in progress */
+        i_start = answer->i_body_offset;
+        answer->i_body_offset = 0;
+    }
+    else
+    {
+        char psz_etag[2 + 3 * 16 + 3];
+        uint64_t i_mtime = (uint64_t)st.st_mtime;
+        uint64_t i_mtime_ns = 0;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+        i_mtime_ns = st.st_mtim.tv_nsec;
+#endif
+
+        answer->i_proto  = HTTPD_PROTO_HTTP;
+        answer->i_version= 1;
+        answer->i_type   = HTTPD_MSG_ANSWER;
+        answer->i_status = 200;
+
+        /* Size and date identify the content. Whole seconds are too coarse
+         * for files rewritten in place, such as live playlists. */
+        snprintf(psz_etag, sizeof (psz_etag),
+                 "\"%"PRIx64"-%"PRIx64"-%"PRIx64"\"", (uint64_t)st.st_size,
+                 i_mtime, i_mtime_ns);
+        httpd_MsgAdd(answer, "ETag", "%s", psz_etag);
+        httpd_MsgAdd(answer, "Accept-Ranges", "bytes");
+        httpd_MsgAdd(answer, "Content-Type", "%s",
+                     vlc_mime_Ext2Mime(query->psz_url));
+
+        const char *psz_ext = strrchr(query->psz_url, '.');
+        if (psz_ext != NULL && (!strcasecmp(psz_ext, ".m3u8")
+                             || !strcasecmp(psz_ext, ".mpd")))
+            /* Live playlists are updated in place */
+            httpd_MsgAdd(answer, "Cache-Control", "%s", "no-cache");
+
+        if (httpd_MsgWantsClose(query))
+            httpd_MsgAdd(answer, "Connection", "close");
+
+        const char *psz_match = httpd_MsgGet(query, "If-None-Match");
+        if (psz_match != NULL && httpd_DirMatch(psz_match, psz_etag))
+        {
+            answer->i_status = 304;
+            vlc_close(fd);
+            return VLC_SUCCESS;
+        }
+
+        if (i_range < 0)
+        {
+            answer->i_status = 416;
+            httpd_MsgAdd(answer, "Content-Range", "bytes */%"PRIu64,
+                         (uint64_t)st.st_size);
+            httpd_MsgAdd(answer, "Content-Length", "0");
+            vlc_close(fd);
+            return VLC_SUCCESS;
+        }
+
+        if (i_range == 0)
+        {
+            answer->i_status = 206;
+            httpd_MsgAdd(answer, "Content-Range",
+                         "bytes %"PRIu64"-%"PRIu64"/%"PRIu64, i_start,
+                         i_end - 1, (uint64_t)st.st_size);
+        }
+        httpd_MsgAdd(answer, "Content-Length", "%"PRIu64, i_end - i_start);
+
+        if (query->i_type == HTTPD_MSG_HEAD)
+        {
+            vlc_close(fd);
+            return VLC_SUCCESS;
+        }
+    }
+
+    if (i_start >= i_end)
+    {   /* done, or the file was truncated meanwhile */
+        vlc_close(fd);
+        return VLC_SUCCESS;
+    }
+
+    size_t i_chunk = __MIN(i_end - i_start, HTTPD_DIR_CHUNK);
+    uint8_t *p_body = malloc(i_chunk);
+    ssize_t i_read = -1;
+
+    if (likely(p_body != NULL)
+     && lseek(fd, i_start, SEEK_SET) == (off_t)i_start)
+        i_read = read(fd, p_body, i_chunk);
+    vlc_close(fd);
+
+    if (i_read <= 0)
+    {
+        free(p_body);
+        return VLC_SUCCESS;
+    }
+
+    answer->p_body = p_body;
+    answer->i_body = i_read;
+    if (i_start + i_read < i_end)
+        answer->i_body_offset = i_start + i_read; /* call back for more */
+    return VLC_SUCCESS;
+}
+
+httpd_dir_t *httpd_DirNew(httpd_host_t *host, const char *psz_url,
+                          const char *psz_path, const char *psz_user,
+                          const char *psz_password)
+{
+    size_t pathlen = strlen(psz_path);
+
+    while (pathlen > 1 && psz_path[pathlen - 1] == '/')
+        pathlen--;
+
+    httpd_dir_t *dir = malloc(sizeof (*dir) + pathlen);
+    if (unlikely(dir == NULL))
+        return NULL;
+
+    dir->url = httpd_UrlNewPrefix(host, psz_url, psz_user, psz_password);
+    if (!dir->url) {
+        free(dir);
+        return NULL;
+    }
+    memcpy(dir->path, psz_path, pathlen);
+    dir->path[pathlen] = '\0';
+
+    httpd_UrlCatch(dir->url, HTTPD_MSG_HEAD, httpd_DirCallBack,
+                    (httpd_callback_sys_t*)dir);
+    httpd_UrlCatch(dir->url, HTTPD_MSG_GET, httpd_DirCallBack,
+                    (httpd_callback_sys_t*)dir);
+
+    return dir;
+}
+
+void httpd_DirDelete(httpd_dir_t *dir)
+{
+    httpd_UrlDelete(dir->url);
+    free(dir);
+}
+
 /*****************************************************************************
  * High Level Funtions: httpd_stream_t
  *****************************************************************************/
@@ -602,22 +887,41 @@ struct httpd_stream_t
     /* Some muxes, in particular the avformat mux, can mark given blocks
      * as keyframes, to ensure that the stream starts with one.
      * (This is particularly important for WebM streaming to certain
-     * browsers.) Store if we've ever seen any such keyframe blocks,
-     * and if so, the byte position of the start of the last one. */
-    bool        b_has_keyframes;
-    int64_t     i_last_keyframe_seen_pos;
-
-    /* circular buffer */
+     * browsers.) Store the byte position of the start of the last one,
+     * or 0 if we've never seen any such keyframe blocks. */
+    atomic_int_least64_t i_last_keyframe_seen_pos;
+
+    /* circular buffer, written by httpd_StreamSend() under the lock, and
+     * read by the clients without locking: they check whether the data was
+     * overwritten while they were sending it, see httpd_StreamClientSend().
+     * Positions are absolute from the beginning. */
     int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
     uint8_t     *p_buffer;          /* buffer */
-    int64_t     i_buffer_pos;       /* absolute position from beginning */
-    int64_t     i_buffer_last_pos;  /* a new connection will start with that */
+    atomic_int_least64_t i_buffer_pos;       /* end of the available data */
+    atomic_int_least64_t i_buffer_write_pos; /* end of the data being written */
+    atomic_int_least64_t i_buffer_last_pos;  /* start of the last block */
 
     /* custom headers */
     size_t        i_http_headers;
     httpd_header * p_http_headers;
 };
 
+/* Position where a new or too slow client should start reading, that is the
+ * last keyframe if there is one and it is recent enough, otherwise the start
+ * of the last block. Data older than half of the buffer is never read, so
+ * that the writer has room to go on while a client is sending. */
+static int64_t httpd_StreamStartPos(httpd_stream_t *stream, int64_t i_pos)
+{
+    int64_t i_keyframe =
+        atomic_load_explicit(&stream->i_last_keyframe_seen_pos,
+                             memory_order_relaxed);
+
+    if (i_keyframe > 0 && i_keyframe + stream->i_buffer_size / 2 >= i_pos)
+        return i_keyframe;
+    return atomic_load_explicit(&stream->i_buffer_last_pos,
+                                memory_order_relaxed);
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -628,46 +932,32 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
+        int64_t i_pos = atomic_load_explicit(&stream->i_buffer_pos,
+                                             memory_order_acquire);
 
-        if (answer->i_body_offset >= stream->i_buffer_pos)
+        if (answer->i_body_offset >= i_pos)
             return VLC_EGENERIC;    /* wait, no data available */
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            int64_t i_keyframe =
+                atomic_load_explicit(&stream->i_last_keyframe_seen_pos,
+                                     memory_order_relaxed);
+            if (i_keyframe <= cl->i_keyframe_wait_to_pass)
                 /* still waiting for the next keyframe */
                 return VLC_EGENERIC;
 
             /* seek to the new keyframe */
-            answer->i_body_offset = stream->i_last_keyframe_seen_pos;
+            answer->i_body_offset = i_keyframe;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
-
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
-
-        /* using HTTPD_MSG_ANSWER -> data available */
+        /* using HTTPD_MSG_ANSWER -> data available. The data is not copied,
+         * but sent straight from the circular buffer by httpd_ClientSend(),
+         * so that all the clients share it. */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
-
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
-        answer->i_body_offset += i_write;
-
+        cl->stream = stream;
         return VLC_SUCCESS;
     } else {
         answer->i_proto  = HTTPD_PROTO_HTTP;
@@ -701,12 +991,21 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                 answer->p_body = xmalloc(stream->i_header);
                 memcpy(answer->p_body, stream->p_header, stream->i_header);
             }
-            answer->i_body_offset = stream->i_buffer_last_pos;
-            if (stream->b_has_keyframes)
-                cl->i_keyframe_wait_to_pass = stream->i_last_keyframe_seen_pos;
+            vlc_mutex_unlock(&stream->lock);
+
+            /* start at once with the last keyframe if it is still there,
+             * otherwise wait for the next one */
+            int64_t i_pos = atomic_load_explicit(&stream->i_buffer_pos,
+                                                 memory_order_acquire);
+            int64_t i_keyframe =
+                atomic_load_explicit(&stream->i_last_keyframe_seen_pos,
+                                     memory_order_relaxed);
+
+            answer->i_body_offset = httpd_StreamStartPos(stream, i_pos);
+            if (i_keyframe > 0 && answer->i_body_offset != i_keyframe)
+                cl->i_keyframe_wait_to_pass = i_keyframe;
             else
                 cl->i_keyframe_wait_to_pass = -1;
-            vlc_mutex_unlock(&stream->lock);
         } else {
             httpd_MsgAdd(answer, "Content-Length", "0");
             answer->i_body_offset = 0;
@@ -766,12 +1065,13 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
     stream->p_buffer = xmalloc(stream->i_buffer_size);
+    vlc_memstats_Add(VLC_MEMSTATS_HTTPD, stream->i_buffer_size);
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
-    stream->i_buffer_pos = 1;
-    stream->i_buffer_last_pos = 1;
-    stream->b_has_keyframes = false;
-    stream->i_last_keyframe_seen_pos = 0;
+    atomic_init(&stream->i_buffer_pos, 1);
+    atomic_init(&stream->i_buffer_write_pos, 1);
+    atomic_init(&stream->i_buffer_last_pos, 1);
+    atomic_init(&stream->i_last_keyframe_seen_pos, 0);
     stream->i_http_headers = 0;
     stream->p_http_headers = NULL;
 
@@ -803,8 +1103,16 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
 
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
+    int64_t i_end = atomic_load_explicit(&stream->i_buffer_pos,
+                                         memory_order_relaxed) + i_data;
+    int i_pos = (i_end - i_data) % stream->i_buffer_size;
     int i_count = i_data;
+
+    /* tell the readers which data is overwritten, before overwriting it */
+    atomic_store_explicit(&stream->i_buffer_write_pos, i_end,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
     while (i_count > 0) {
         int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
 
@@ -816,7 +1124,7 @@ static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data
         p_data  += i_copy;
     }
 
-    stream->i_buffer_pos += i_data;
+    atomic_store_explicit(&stream->i_buffer_pos, i_end, memory_order_release);
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
@@ -827,19 +1135,76 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
     vlc_mutex_lock(&stream->lock);
 
     /* save this pointer (to be used by new connection) */
-    stream->i_buffer_last_pos = stream->i_buffer_pos;
+    int64_t i_pos = atomic_load_explicit(&stream->i_buffer_pos,
+                                         memory_order_relaxed);
+    atomic_store_explicit(&stream->i_buffer_last_pos, i_pos,
+                          memory_order_relaxed);
 
-    if (p_block->i_flags & BLOCK_FLAG_TYPE_I) {
-        stream->b_has_keyframes = true;
-        stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
-    }
+    if (p_block->i_flags & BLOCK_FLAG_TYPE_I)
+        atomic_store_explicit(&stream->i_last_keyframe_seen_pos, i_pos,
+                              memory_order_relaxed);
 
     httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
 
     vlc_mutex_unlock(&stream->lock);
+
+    /* the waiting clients are served by the host thread */
+    httpd_HostWakeUp(stream->url->host);
     return VLC_SUCCESS;
 }
 
+/* Sends the available stream data to the client, without copying it nor
+ * locking the stream */
+static void httpd_StreamClientSend(httpd_client_t *cl)
+{
+    httpd_stream_t *stream = cl->stream;
+    ssize_t val;
+
+    int64_t i_end = atomic_load_explicit(&stream->i_buffer_pos,
+                                         memory_order_acquire);
+    int64_t i_offset = cl->answer.i_body_offset;
+
+    if (i_offset + stream->i_buffer_size / 2 < i_end)
+        /* this client isn't fast enough, skip forward */
+        i_offset = httpd_StreamStartPos(stream, i_end);
+
+    size_t i_pos = i_offset % stream->i_buffer_size;
+    /* the start position may be ahead of the data read so far */
+    size_t i_len = (i_end > i_offset) ? i_end - i_offset : 0;
+    size_t i_first = __MIN(i_len, stream->i_buffer_size - i_pos);
+    struct iovec iov[2] = {
+        { .iov_base = &stream->p_buffer[i_pos], .iov_len = i_first },
+        { .iov_base = stream->p_buffer, .iov_len = i_len - i_first },
+    };
+
+    if (i_len > 0)
+        val = cl->sock->ops->writev(cl->sock, iov, (i_len > i_first) ? 2 : 1);
+    else
+        val = 0;
+
+    /* If the writer caught up with the data while it was being sent, the
+     * client got garbage: drop it. */
+    atomic_thread_fence(memory_order_acquire);
+    if (i_offset + stream->i_buffer_size
+      < atomic_load_explicit(&stream->i_buffer_write_pos, memory_order_relaxed))
+        cl->i_state = HTTPD_CLIENT_DEAD;
+    else if (i_len == 0) {
+        /* wait for more data */
+        cl->answer.i_body_offset = i_offset;
+        cl->i_state = HTTPD_CLIENT_SEND_DONE;
+    } else if (val > 0) {
+        cl->answer.i_body_offset = i_offset + val;
+        if ((size_t)val == i_len)
+            cl->i_state = HTTPD_CLIENT_SEND_DONE;
+    } else
+#if defined(_WIN32)
+    if (val == 0 || WSAGetLastError() != WSAEWOULDBLOCK)
+#else
+    if (val == 0 || errno != EAGAIN)
+#endif
+        cl->i_state = HTTPD_CLIENT_DEAD;
+}
+
 void httpd_StreamDelete(httpd_stream_t *stream)
 {
     httpd_UrlDelete(stream->url);
@@ -852,6 +1217,7 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     free(stream->psz_mime);
     free(stream->p_header);
     free(stream->p_buffer);
+    vlc_memstats_Add(VLC_MEMSTATS_HTTPD, -stream->i_buffer_size);
     free(stream);
 }
 
@@ -938,6 +1304,11 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     vlc_mutex_init(&host->lock);
     vlc_cond_init(&host->wait);
     atomic_init(&host->ref, 1);
+    atomic_init(&host->wakeup_pending, false);
+#ifndef _WIN32
+    if (vlc_pipe(host->wakeup))
+#endif
+        host->wakeup[0] = host->wakeup[1] = -1;
 
     char *hostname = var_InheritString(p_this, hostvar);
 
@@ -974,6 +1345,10 @@ error:
 
     if (host) {
         net_ListenClose(host->fds);
+        if (host->wakeup[0] != -1) {
+            vlc_close(host->wakeup[1]);
+            vlc_close(host->wakeup[0]);
+        }
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
         vlc_object_delete(host);
@@ -1011,15 +1386,21 @@ void httpd_HostDelete(httpd_host_t *host)
     assert(vlc_list_is_empty(&host->urls));
     vlc_tls_ServerDelete(host->p_tls);
     net_ListenClose(host->fds);
+    if (host->wakeup[0] != -1) {
+        vlc_close(host->wakeup[1]);
+        vlc_close(host->wakeup[0]);
+    }
     vlc_cond_destroy(&host->wait);
     vlc_mutex_destroy(&host->lock);
     vlc_object_delete(host);
     vlc_mutex_unlock(&httpd.mutex);
 }
 
-/* register a new url */
-httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
-                           const char *psz_user, const char *psz_password)
+static httpd_url_t *httpd_UrlNewInternal(httpd_host_t *host,
+                                         const char *psz_url,
+                                         const char *psz_user,
+                                         const char *psz_password,
+                                         bool b_prefix)
 {
     httpd_url_t *url;
 
@@ -1045,6 +1426,7 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
     url->psz_url = xstrdup(psz_url);
     url->psz_user = xstrdup(psz_user ? psz_user : "");
     url->psz_password = xstrdup(psz_password ? psz_password : "");
+    url->b_prefix = b_prefix;
     for (int i = 0; i < HTTPD_MSG_MAX; i++) {
         url->catch[i].cb = NULL;
         url->catch[i].p_sys = NULL;
@@ -1057,6 +1439,21 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
     return url;
 }
 
+/* register a new url */
+httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
+                           const char *psz_user, const char *psz_password)
+{
+    return httpd_UrlNewInternal(host, psz_url, psz_user, psz_password, false);
+}
+
+/* register a new url and everything below it */
+static httpd_url_t *httpd_UrlNewPrefix(httpd_host_t *host, const char *psz_url,
+                                       const char *psz_user,
+                                       const char *psz_password)
+{
+    return httpd_UrlNewInternal(host, psz_url, psz_user, psz_password, true);
+}
+
 /* register callback on a url */
 int httpd_UrlCatch(httpd_url_t *url, int i_msg, httpd_callback_t cb,
                     httpd_callback_sys_t *p_sys)
@@ -1175,6 +1572,7 @@ static void httpd_ClientInit(httpd_client_t *cl, vlc_tick_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->stream = NULL;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1541,6 +1939,11 @@ static void httpd_ClientSend(httpd_client_t *cl)
 {
     int i_len;
 
+    if (cl->stream != NULL) {
+        httpd_StreamClientSend(cl);
+        return;
+    }
+
     if (cl->i_buffer < 0) {
         /* We need to create the header */
         int i_size = 0;
@@ -1668,13 +2071,17 @@ auth_failed:
 
 static void httpdLoop(httpd_host_t *host)
 {
-    struct pollfd ufd[host->nfd + host->client_count];
+    struct pollfd ufd[host->nfd + 1 + host->client_count];
     unsigned nfd;
     for (nfd = 0; nfd < host->nfd; nfd++) {
         ufd[nfd].fd = host->fds[nfd];
         ufd[nfd].events = POLLIN;
         ufd[nfd].revents = 0;
     }
+    ufd[nfd].fd = host->wakeup[0];
+    ufd[nfd].events = POLLIN;
+    ufd[nfd].revents = 0;
+    nfd++;
 
     vlc_mutex_lock(&host->lock);
     /* add all socket that should be read/write and close dead connection */
@@ -1686,6 +2093,7 @@ static void httpdLoop(httpd_host_t *host)
 
     vlc_tick_t now = vlc_tick_now();
     bool b_low_delay = false;
+    bool b_pending = false;
     httpd_client_t *cl;
 
     int canc = vlc_savecancel();
@@ -1766,7 +2174,7 @@ static void httpdLoop(httpd_host_t *host)
                             break;
                         }
 
-                        if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+                        if (httpd_MsgWantsClose(&cl->query))
                             httpd_MsgAdd(answer, "Connection", "close");
 
                         cl->i_buffer = -1;  /* Force the creation of the answer in
@@ -1803,7 +2211,10 @@ static void httpdLoop(httpd_host_t *host)
 
                         /* Search the url and trigger callbacks */
                         vlc_list_foreach(url, &host->urls, node) {
-                            if (strcmp(url->psz_url, query->psz_url))
+                            if (url->b_prefix
+                             ? strncmp(url->psz_url, query->psz_url,
+                                       strlen(url->psz_url))
+                             : strcmp(url->psz_url, query->psz_url))
                                 continue;
                             if (!url->catch[i_msg].cb)
                                 continue;
@@ -1850,7 +2261,7 @@ static void httpdLoop(httpd_host_t *host)
                             cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
                             httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
                             httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
-                            if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+                            if (httpd_MsgWantsClose(&cl->query))
                                 httpd_MsgAdd(answer, "Connection", "close");
                         }
 
@@ -1928,25 +2339,42 @@ static void httpdLoop(httpd_host_t *host)
 
         if (pufd->events != 0)
             nfd++;
-        else
+        else if (cl->i_state == HTTPD_CLIENT_WAITING)
             b_low_delay = true;
+        else
+            b_pending = true; /* state changed, handle it at once */
     }
     vlc_mutex_unlock(&host->lock);
     vlc_restorecancel(canc);
 
-    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-    while (poll(ufd, nfd, b_low_delay ? 20 : -1) < 0)
+    /* The streams wake us up when they get new data for the waiting clients.
+     * Without the wake up pipe, we will wait 20ms (not too big). */
+    int timeout = -1;
+    if (b_pending)
+        timeout = 0;
+    else if (b_low_delay && host->wakeup[0] == -1)
+        timeout = 20;
+
+    while (poll(ufd, nfd, timeout) < 0)
     {
         if (errno != EINTR)
             msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
     }
 
+    if (ufd[host->nfd].revents) {
+        char dummy;
+
+        if (read(host->wakeup[0], &dummy, 1) < 0)
+            msg_Err(host, "wake up error: %s", vlc_strerror_c(errno));
+        atomic_store(&host->wakeup_pending, false);
+    }
+
     canc = vlc_savecancel();
     vlc_mutex_lock(&host->lock);
 
     /* Handle client sockets */
     now = vlc_tick_now();
-    nfd = host->nfd;
+    nfd = host->nfd + 1;
 
     vlc_list_foreach(cl, &host->clients, node) {
         const struct pollfd *pufd = &ufd[nfd];
@@ -2021,6 +2449,16 @@ static void httpdLoop(httpd_host_t *host)
     vlc_restorecancel(canc);
 }
 
+static void httpd_HostWakeUp(httpd_host_t *host)
+{
+    if (host->wakeup[1] == -1
+     || atomic_exchange(&host->wakeup_pending, true))
+        return; /* unsupported, or already pending */
+
+    if (write(host->wakeup[1], &(char){ 0 }, 1) < 0)
+        atomic_store(&host->wakeup_pending, false);
+}
+
 static void* httpd_HostThread(void *data)
 {
     httpd_host_t *host = data;
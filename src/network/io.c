@@ -50,6 +50,7 @@
 #include <vlc_common.h>
 #include <vlc_network.h>
 #include <vlc_interrupt.h>
+#include "network.h"
 #if defined (_WIN32)
 #   undef EINPROGRESS
 #   define EINPROGRESS WSAEWOULDBLOCK
@@ -112,99 +113,211 @@ int net_Socket (vlc_object_t *p_this, int family, int socktype,
     return fd;
 }
 
-int (net_Connect)(vlc_object_t *obj, const char *host, int serv,
-                  int type, int proto)
+/* RFC 8305 "Connection Attempt Delay" */
+#define CONNECT_ATTEMPT_DELAY VLC_TICK_FROM_MS(250)
+#define CONNECT_ATTEMPTS_MAX  8
+
+static const struct addrinfo *net_NextAddrInfo(const struct addrinfo *p,
+                                               int family, bool same)
 {
-    struct addrinfo hints = {
-        .ai_socktype = type,
-        .ai_protocol = proto,
-        .ai_flags = AI_NUMERICSERV | AI_IDN,
-    }, *res;
-    int ret = -1;
+    while (p != NULL && (p->ai_family == family) != same)
+        p = p->ai_next;
+    return p;
+}
 
-    int val = vlc_getaddrinfo_i11e(host, serv, &hints, &res);
-    if (val)
-    {
-        msg_Err(obj, "cannot resolve %s port %d : %s", host, serv,
-                gai_strerror (val));
-        return -1;
-    }
+/**
+ * Orders the candidate addresses by alternating address families, starting
+ * with the family of the most preferred address (RFC 8305 §4).
+ */
+static const struct addrinfo **net_SortAddrInfo(const struct addrinfo *res,
+                                                size_t *restrict countp)
+{
+    size_t count = 0;
 
-    vlc_tick_t timeout = VLC_TICK_FROM_MS(var_InheritInteger(obj,
-                                                             "ipv4-timeout"));
+    for (const struct addrinfo *p = res; p != NULL; p = p->ai_next)
+        count++;
 
-    for (struct addrinfo *ptr = res; ptr != NULL; ptr = ptr->ai_next)
+    const struct addrinfo **tab = vlc_alloc(count, sizeof (*tab));
+    if (unlikely(tab == NULL))
+        return NULL;
+
+    const struct addrinfo *first = res, *other = res;
+    const int family = res->ai_family;
+    size_t i = 0;
+
+    while (i < count)
     {
-        int fd = net_Socket(obj, ptr->ai_family,
-                            ptr->ai_socktype, ptr->ai_protocol);
-        if (fd == -1)
+        first = net_NextAddrInfo(first, family, true);
+        if (first != NULL)
         {
-            msg_Dbg(obj, "socket error: %s", vlc_strerror_c(net_errno));
-            continue;
+            tab[i++] = first;
+            first = first->ai_next;
         }
 
-        if (connect(fd, ptr->ai_addr, ptr->ai_addrlen))
+        other = net_NextAddrInfo(other, family, false);
+        if (other != NULL)
         {
+            tab[i++] = other;
+            other = other->ai_next;
+        }
+    }
+
+    *countp = count;
+    return tab;
+}
+
+int net_ConnectAddrInfo(vlc_object_t *obj, const struct addrinfo *res,
+                        vlc_tick_t timeout)
+{
+    struct pollfd ufd[CONNECT_ATTEMPTS_MAX];
+    vlc_tick_t deadlines[CONNECT_ATTEMPTS_MAX];
+    unsigned pending = 0;
+    size_t count, next = 0;
+    int ret = -1;
+
+    if (res == NULL)
+        return -1;
+
+    const struct addrinfo **tab = net_SortAddrInfo(res, &count);
+    if (unlikely(tab == NULL))
+        return -1;
+
+    vlc_tick_t next_attempt = vlc_tick_now();
+
+    for (;;)
+    {
+        vlc_tick_t now = vlc_tick_now();
+
+        /* Start the next connection attempt, if the previous one has not
+         * completed within the attempt delay, or has failed already. */
+        while (next < count && pending < CONNECT_ATTEMPTS_MAX
+            && (pending == 0 || now >= next_attempt))
+        {
+            const struct addrinfo *ptr = tab[next++];
+            int fd = net_Socket(obj, ptr->ai_family,
+                                ptr->ai_socktype, ptr->ai_protocol);
+            if (fd == -1)
+            {
+                msg_Dbg(obj, "socket error: %s", vlc_strerror_c(net_errno));
+                continue;
+            }
+
+            if (connect(fd, ptr->ai_addr, ptr->ai_addrlen) == 0)
+            {
+                ret = fd;
+                goto done;
+            }
+
             if (net_errno != EINPROGRESS && errno != EINTR)
             {
                 msg_Err(obj, "connection failed: %s",
                         vlc_strerror_c(net_errno));
-                goto next_ai;
+                net_Close(fd);
+                continue;
             }
 
-            struct pollfd ufd;
-            vlc_tick_t deadline = VLC_TICK_INVALID;
+            ufd[pending].fd = fd;
+            ufd[pending].events = POLLOUT;
+            deadlines[pending] = (timeout != VLC_TICK_INVALID)
+                               ? now + timeout : INT64_MAX;
+            pending++;
+            next_attempt = now + CONNECT_ATTEMPT_DELAY;
+            break;
+        }
 
-            ufd.fd = fd;
-            ufd.events = POLLOUT;
-            deadline = vlc_tick_now() + timeout;
+        if (pending == 0 || vlc_killed())
+            break; /* all attempts failed, or interrupted */
 
-            do
-            {
-                vlc_tick_t now = vlc_tick_now();
+        vlc_tick_t wakeup = (next < count) ? next_attempt : INT64_MAX;
+        for (unsigned i = 0; i < pending; i++)
+            if (deadlines[i] < wakeup)
+                wakeup = deadlines[i];
 
-                if (vlc_killed())
-                    goto next_ai;
+        int delay = -1;
+        if (wakeup != INT64_MAX)
+            delay = (wakeup > now)
+                  ? (int)MS_FROM_VLC_TICK(wakeup - now + 999) : 0;
 
-                if (now > deadline)
-                    now = deadline;
+        int val = vlc_poll_i11e(ufd, pending, delay);
+        if (val == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            msg_Err(obj, "polling error: %s", vlc_strerror_c(net_errno));
+            break;
+        }
 
-                val = vlc_poll_i11e(&ufd, 1, MS_FROM_VLC_TICK(deadline - now));
-            }
-            while (val == -1 && errno == EINTR);
+        now = vlc_tick_now();
 
-            switch (val)
+        for (unsigned i = 0; i < pending;)
+        {
+            if (ufd[i].revents)
             {
-                 case -1: /* error */
-                     msg_Err(obj, "polling error: %s",
-                             vlc_strerror_c(net_errno));
-                     goto next_ai;
-
-                 case 0: /* timeout */
-                     msg_Warn(obj, "connection timed out");
-                     goto next_ai;
-            }
+                /* There is NO WAY around checking SO_ERROR.
+                 * Don't ifdef it out!!! */
+                if (getsockopt(ufd[i].fd, SOL_SOCKET, SO_ERROR, &val,
+                               &(socklen_t){ sizeof (val) }) == 0 && val == 0)
+                {
+                    ret = ufd[i].fd;
+                    ufd[i] = ufd[--pending];
+                    goto done;
+                }
 
-            /* There is NO WAY around checking SO_ERROR.
-             * Don't ifdef it out!!! */
-            if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &val,
-                           &(socklen_t){ sizeof (val) }) || val)
-            {
                 msg_Err(obj, "connection failed: %s", vlc_strerror_c(val));
-                goto next_ai;
+                /* do not wait for the delay to try the next address */
+                next_attempt = now;
             }
+            else if (now >= deadlines[i])
+                msg_Warn(obj, "connection timed out");
+            else
+            {
+                i++;
+                continue;
+            }
+
+            net_Close(ufd[i].fd);
+            pending--;
+            ufd[i] = ufd[pending];
+            deadlines[i] = deadlines[pending];
         }
+    }
 
-        msg_Dbg(obj, "connection succeeded (socket = %d)", fd);
-        ret = fd; /* success! */
-        break;
+done:
+    while (pending > 0)
+        net_Close(ufd[--pending].fd);
+    free(tab);
 
-next_ai: /* failure */
-        net_Close(fd);
+    if (ret != -1)
+        msg_Dbg(obj, "connection succeeded (socket = %d)", ret);
+    return ret;
+}
+
+int (net_Connect)(vlc_object_t *obj, const char *host, int serv,
+                  int type, int proto)
+{
+    struct addrinfo hints = {
+        .ai_socktype = type,
+        .ai_protocol = proto,
+        .ai_flags = AI_NUMERICSERV | AI_IDN,
+    }, *res;
+
+    int val = vlc_getaddrinfo_cached(host, serv, &hints, &res);
+    if (val)
+    {
+        msg_Err(obj, "cannot resolve %s port %d : %s", host, serv,
+                gai_strerror (val));
+        return -1;
     }
 
-    freeaddrinfo(res);
-    return ret;
+    vlc_tick_t timeout = VLC_TICK_FROM_MS(var_InheritInteger(obj,
+                                                             "ipv4-timeout"));
+
+    int fd = net_ConnectAddrInfo(obj, res, timeout);
+    vlc_freeaddrinfo_cached(res);
+
+    if (fd == -1 && !vlc_killed())
+        vlc_getaddrinfo_forget(host, serv, &hints);
+    return fd;
 }
 
 int *net_Listen (vlc_object_t *p_this, const char *psz_host,
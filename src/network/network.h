@@ -0,0 +1,68 @@
+/*****************************************************************************
+ * network.h: core network internal functions
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_NETWORK_H
+#define LIBVLC_NETWORK_H 1
+
+#include <vlc_common.h>
+#include <vlc_network.h>
+
+/**
+ * Resolves a host name, through the process-wide resolver cache.
+ *
+ * This is the same as vlc_getaddrinfo_i11e(), except that the results of
+ * recent successful resolutions of the same name with the same hints are
+ * reused.
+ *
+ * @return 0 on success, a getaddrinfo() error otherwise.
+ * On success, *res must be freed with vlc_freeaddrinfo_cached(), not with
+ * freeaddrinfo().
+ */
+int vlc_getaddrinfo_cached(const char *node, unsigned port,
+                           const struct addrinfo *hints,
+                           struct addrinfo **res);
+
+/**
+ * Releases a list returned by vlc_getaddrinfo_cached().
+ */
+void vlc_freeaddrinfo_cached(struct addrinfo *res);
+
+/**
+ * Drops the cached resolution of a host name, e.g. if none of its addresses
+ * could be reached.
+ */
+void vlc_getaddrinfo_forget(const char *node, unsigned port,
+                            const struct addrinfo *hints);
+
+/**
+ * Connects a socket to one of a list of addresses.
+ *
+ * Connection attempts are staggered and raced as per RFC 8305 ("Happy
+ * Eyeballs"), alternating address families. The first established
+ * connection wins, and the other ones are aborted.
+ *
+ * @param res list of candidate addresses, in order of preference
+ * @param timeout timeout of each connection attempt, or VLC_TICK_INVALID
+ * @return a connected socket, or -1 on error
+ */
+int net_ConnectAddrInfo(vlc_object_t *obj, const struct addrinfo *res,
+                        vlc_tick_t timeout);
+
+#endif
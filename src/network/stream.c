@@ -49,6 +49,7 @@
 #include <vlc_common.h>
 #include <vlc_tls.h>
 #include <vlc_interrupt.h>
+#include "network.h"
 
 ssize_t vlc_tls_Read(vlc_tls_t *session, void *buf, size_t len, bool waitall)
 {
@@ -252,6 +253,15 @@ vlc_tls_t *vlc_tls_SocketOpen(int fd)
     return vlc_tls_SocketAlloc(fd, NULL, 0);
 }
 
+int vlc_tls_GetSocketFD(vlc_tls_t *tls)
+{
+    /* Not a socket, or not connected yet (fast open) */
+    if (tls->ops != &vlc_tls_socket_ops)
+        return -1;
+
+    return ((vlc_tls_socket_t *)tls)->fd;
+}
+
 int vlc_tls_SocketPair(int family, int protocol, vlc_tls_t *pair[2])
 {
     int fds[2];
@@ -438,7 +448,7 @@ vlc_tls_t *vlc_tls_SocketOpenTCP(vlc_object_t *obj, const char *name,
     assert(name != NULL);
     msg_Dbg(obj, "resolving %s ...", name);
 
-    int val = vlc_getaddrinfo_i11e(name, port, &hints, &res);
+    int val = vlc_getaddrinfo_cached(name, port, &hints, &res);
     if (val != 0)
     {   /* TODO: C locale for gai_strerror() */
         msg_Err(obj, "cannot resolve %s port %u: %s", name, port,
@@ -448,20 +458,20 @@ vlc_tls_t *vlc_tls_SocketOpenTCP(vlc_object_t *obj, const char *name,
 
     msg_Dbg(obj, "connecting to %s port %u ...", name, port);
 
-    /* TODO: implement RFC8305 */
-    for (const struct addrinfo *p = res; p != NULL; p = p->ai_next)
-    {
-        vlc_tls_t *tls = vlc_tls_SocketOpenAddrInfo(p, false);
-        if (tls == NULL)
-        {
-            msg_Err(obj, "connection error: %s", vlc_strerror_c(errno));
-            continue;
-        }
+    int fd = net_ConnectAddrInfo(obj, res, VLC_TICK_INVALID);
+    vlc_freeaddrinfo_cached(res);
 
-        freeaddrinfo(res);
-        return tls;
+    if (fd == -1)
+    {
+        if (!vlc_killed())
+            vlc_getaddrinfo_forget(name, port, &hints);
+        return NULL;
     }
 
-    freeaddrinfo(res);
-    return NULL;
+    setsockopt(fd, SOL_TCP, TCP_NODELAY, &(int){ 1 }, sizeof (int));
+
+    vlc_tls_t *tls = vlc_tls_SocketOpen(fd);
+    if (unlikely(tls == NULL))
+        net_Close(fd);
+    return tls;
 }
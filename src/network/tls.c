@@ -33,6 +33,9 @@
 #endif
 #include <assert.h>
 #include <errno.h>
+#ifdef HAVE_NETINET_TCP_H
+# include <netinet/tcp.h>
+#endif
 #ifndef SOL_TCP
 # define SOL_TCP IPPROTO_TCP
 #endif
@@ -43,6 +46,7 @@
 #include <vlc_tls.h>
 #include <vlc_modules.h>
 #include <vlc_interrupt.h>
+#include "network.h"
 
 /*** TLS credentials ***/
 
@@ -230,7 +234,7 @@ vlc_tls_t *vlc_tls_SocketOpenTLS(vlc_tls_client_t *creds, const char *name,
 
     msg_Dbg(creds, "resolving %s ...", name);
 
-    int val = vlc_getaddrinfo_i11e(name, port, &hints, &res);
+    int val = vlc_getaddrinfo_cached(name, port, &hints, &res);
     if (val != 0)
     {   /* TODO: C locale for gai_strerror() */
         msg_Err(creds, "cannot resolve %s port %u: %s", name, port,
@@ -238,28 +242,44 @@ vlc_tls_t *vlc_tls_SocketOpenTLS(vlc_tls_client_t *creds, const char *name,
         return NULL;
     }
 
-    for (const struct addrinfo *p = res; p != NULL; p = p->ai_next)
-    {
-        vlc_tls_t *tcp = vlc_tls_SocketOpenAddrInfo(p, true);
+    vlc_tls_t *tcp;
+
+    if (res->ai_next == NULL)
+    {   /* Single address: send the TLS handshake with TCP Fast Open */
+        tcp = vlc_tls_SocketOpenAddrInfo(res, true);
         if (tcp == NULL)
-        {
             msg_Err(creds, "socket error: %s", vlc_strerror_c(errno));
-            continue;
+    }
+    else
+    {   /* Race the connections to the different addresses (RFC 8305) */
+        vlc_tick_t timeout =
+            VLC_TICK_FROM_MS(var_InheritInteger(creds, "ipv4-timeout"));
+        int fd = net_ConnectAddrInfo(VLC_OBJECT(creds), res, timeout);
+
+        tcp = NULL;
+        if (fd != -1)
+        {
+            setsockopt(fd, SOL_TCP, TCP_NODELAY, &(int){ 1 }, sizeof (int));
+            tcp = vlc_tls_SocketOpen(fd);
+            if (unlikely(tcp == NULL))
+                net_Close(fd);
         }
+    }
+    vlc_freeaddrinfo_cached(res);
 
-        vlc_tls_t *tls = vlc_tls_ClientSessionCreate(creds, tcp, name, service,
-                                                     alpn, alp);
-        if (tls != NULL)
-        {   /* Success! */
-            freeaddrinfo(res);
-            return tls;
-        }
+    if (tcp == NULL)
+    {
+        if (!vlc_killed())
+            vlc_getaddrinfo_forget(name, port, &hints);
+        return NULL;
+    }
 
+    vlc_tls_t *tls = vlc_tls_ClientSessionCreate(creds, tcp, name, service,
+                                                 alpn, alp);
+    if (tls == NULL)
+    {
         msg_Err(creds, "connection error: %s", vlc_strerror_c(errno));
         vlc_tls_SessionDelete(tcp);
     }
-
-    /* Failure! */
-    freeaddrinfo(res);
-    return NULL;
+    return tls;
 }
@@ -38,6 +38,14 @@ vlc_playlist_ClearItems(vlc_playlist_t *playlist)
     vlc_vector_clear(&playlist->items);
 }
 
+void
+vlc_playlist_UpdateIndexHints(vlc_playlist_t *playlist, size_t index,
+                              size_t count)
+{
+    for (size_t i = index; i < index + count; ++i)
+        playlist->items.data[i]->index_hint = i;
+}
+
 static void
 vlc_playlist_ItemsReset(vlc_playlist_t *playlist)
 {
@@ -63,6 +71,8 @@ vlc_playlist_ItemsInserted(vlc_playlist_t *playlist, size_t index, size_t count)
         randomizer_Add(&playlist->randomizer,
                        &playlist->items.data[index], count);
 
+    vlc_playlist_UpdateIndexHints(playlist, index, count);
+
     struct vlc_playlist_state state;
     vlc_playlist_state_Save(playlist, &state);
 
@@ -80,6 +90,8 @@ static void
 vlc_playlist_ItemsMoved(vlc_playlist_t *playlist, size_t index, size_t count,
                         size_t target)
 {
+    vlc_playlist_UpdateIndexHints(playlist, target, count);
+
     struct vlc_playlist_state state;
     vlc_playlist_state_Save(playlist, &state);
 
@@ -188,9 +200,22 @@ vlc_playlist_IndexOf(vlc_playlist_t *playlist, const vlc_playlist_item_t *item)
 {
     vlc_playlist_AssertLocked(playlist);
 
-    ssize_t index;
-    vlc_vector_index_of(&playlist->items, item, &index);
-    return index;
+    vlc_playlist_item_t *const *data = playlist->items.data;
+    size_t size = playlist->items.size;
+    if (size == 0)
+        return -1;
+
+    /* Insertions and removals only shift the following items, so look
+     * around the last known index first, in both directions */
+    size_t hint = item->index_hint < size ? item->index_hint : size - 1;
+    for (size_t d = 0; d <= hint || hint + d < size; ++d)
+    {
+        if (d <= hint && data[hint - d] == item)
+            return hint - d;
+        if (d > 0 && hint + d < size && data[hint + d] == item)
+            return hint + d;
+    }
+    return -1;
 }
 
 ssize_t
@@ -320,6 +345,7 @@ vlc_playlist_Replace(vlc_playlist_t *playlist, size_t index,
 
     vlc_playlist_item_Release(playlist->items.data[index]);
     playlist->items.data[index] = item;
+    item->index_hint = index;
 
     vlc_playlist_ItemReplaced(playlist, index);
     return VLC_SUCCESS;
@@ -28,6 +28,11 @@ typedef struct input_item_t input_item_t;
 void
 vlc_playlist_ClearItems(vlc_playlist_t *playlist);
 
+/* record the current index of the items in the range, after they moved */
+void
+vlc_playlist_UpdateIndexHints(vlc_playlist_t *playlist, size_t index,
+                              size_t count);
+
 /* expand an item (replace it by the given media array) */
 int
 vlc_playlist_Expand(vlc_playlist_t *playlist, size_t index,
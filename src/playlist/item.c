@@ -36,6 +36,7 @@ vlc_playlist_item_New(input_item_t *media)
 
     vlc_atomic_rc_init(&item->rc);
     item->media = media;
+    item->index_hint = 0;
     input_item_Hold(media);
     return item;
 }
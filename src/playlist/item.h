@@ -30,6 +30,9 @@ struct vlc_playlist_item
 {
     input_item_t *media;
     vlc_atomic_rc_t rc;
+    /* Last known index in the playlist, possibly stale, used as a starting
+     * point for vlc_playlist_IndexOf() */
+    size_t index_hint;
 };
 
 /* _New() is private, it is called when inserting new media in the playlist */
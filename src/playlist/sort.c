@@ -25,6 +25,7 @@
 #include <vlc_common.h>
 #include <vlc_rand.h>
 #include <vlc_sort.h>
+#include "content.h"
 #include "control.h"
 #include "item.h"
 #include "notify.h"
@@ -53,14 +54,20 @@ struct vlc_playlist_item_meta {
     bool has_rating;
 };
 
+/* Copy a string as a sort key: comparisons are case-insensitive, so fold the
+ * case once per item rather than on every comparison */
 static int
 vlc_playlist_item_meta_CopyString(const char **to, const char *from)
 {
     if (from)
     {
-        *to = strdup(from);
-        if (unlikely(!*to))
+        char *key = strdup(from);
+        if (unlikely(!key))
             return VLC_ENOMEM;
+        for (char *p = key; *p; ++p)
+            if (*p >= 'A' && *p <= 'Z')
+                *p += 'a' - 'A';
+        *to = key;
     }
     else
         *to = NULL;
@@ -179,51 +186,34 @@ vlc_playlist_item_meta_InitFields(struct vlc_playlist_item_meta *meta,
         const struct vlc_playlist_sort_criterion *criterion = &criteria[i];
         int ret = vlc_playlist_item_meta_InitField(meta, criterion->key);
         if (unlikely(ret != VLC_SUCCESS))
-        {
-            vlc_playlist_item_meta_DestroyFields(meta);
+            /* the fields are destroyed along with the whole meta array */
             return ret;
-        }
     }
     return VLC_SUCCESS;
 }
 
-static struct vlc_playlist_item_meta *
-vlc_playlist_item_meta_New(vlc_playlist_item_t *item,
-                           const struct vlc_playlist_sort_criterion criteria[],
-                           size_t count)
+static int
+vlc_playlist_item_meta_Init(struct vlc_playlist_item_meta *meta,
+                            vlc_playlist_item_t *item,
+                            const struct vlc_playlist_sort_criterion criteria[],
+                            size_t count)
 {
-    /* assume that NULL representation is all-zeros */
-    struct vlc_playlist_item_meta *meta = calloc(1, sizeof(*meta));
-    if (unlikely(!meta))
-        return NULL;
-
+    /* the meta is zero-initialized, assume that NULL representation is
+     * all-zeros */
     meta->item = item;
 
     vlc_mutex_lock(&item->media->lock);
     int ret = vlc_playlist_item_meta_InitFields(meta, criteria, count);
     vlc_mutex_unlock(&item->media->lock);
 
-    if (unlikely(ret != VLC_SUCCESS))
-    {
-        free(meta);
-        return NULL;
-    }
-
-    return meta;
-}
-
-static void
-vlc_playlist_item_meta_Delete(struct vlc_playlist_item_meta *meta)
-{
-    vlc_playlist_item_meta_DestroyFields(meta);
-    free(meta);
+    return ret;
 }
 
 static inline int
 CompareStrings(const char *a, const char *b)
 {
     if (a && b)
-        return strcasecmp(a, b);
+        return strcmp(a, b); /* sort keys are case-folded */
     if (!a && !b)
         return 0;
     return a ? 1 : -1;
@@ -322,41 +312,188 @@ compare_meta(const void *lhs, const void *rhs, void *userdata)
 }
 
 static void
-vlc_playlist_DeleteMetaArray(struct vlc_playlist_item_meta *array[],
+vlc_playlist_DeleteMetaArray(struct vlc_playlist_item_meta *metas,
                              size_t count)
 {
     for (size_t i = 0; i < count; ++i)
-        vlc_playlist_item_meta_Delete(array[i]);
-    free(array);
+        vlc_playlist_item_meta_DestroyFields(&metas[i]);
+    free(metas);
 }
 
-static struct vlc_playlist_item_meta **
-vlc_playlist_NewMetaArray(vlc_playlist_t *playlist,
-        const struct vlc_playlist_sort_criterion criteria[], size_t count)
+/* Large playlists are processed by several threads, each one handling
+ * a contiguous chunk of at least SORT_CHUNK_MIN items */
+#define SORT_CHUNK_MIN 8192
+#define SORT_THREADS_MAX 8
+
+struct sort_context
+{
+    vlc_playlist_t *playlist;
+    struct vlc_playlist_item_meta *metas;
+    struct vlc_playlist_item_meta **array;
+    struct sort_request req;
+};
+
+struct sort_chunk
+{
+    vlc_thread_t thread;
+    const struct sort_context *ctx;
+    void (*run)(struct sort_chunk *);
+    size_t begin;
+    size_t end;
+    int ret;
+};
+
+static void *
+sort_chunk_Thread(void *userdata)
+{
+    struct sort_chunk *chunk = userdata;
+    chunk->run(chunk);
+    return NULL;
+}
+
+/* Split [begin, end) in chunks, and run them in parallel; return the number
+ * of chunks */
+static size_t
+vlc_playlist_RunChunks(const struct sort_context *ctx,
+                       void (*run)(struct sort_chunk *),
+                       size_t begin, size_t end,
+                       struct sort_chunk chunks[SORT_THREADS_MAX])
+{
+    size_t count = (end - begin) / SORT_CHUNK_MIN;
+    size_t cpus = vlc_GetCPUCount();
+    if (count > cpus)
+        count = cpus;
+    if (count > SORT_THREADS_MAX)
+        count = SORT_THREADS_MAX;
+    if (count == 0)
+        count = 1;
+
+    bool started[SORT_THREADS_MAX];
+    for (size_t i = 0; i < count; ++i)
+    {
+        struct sort_chunk *chunk = &chunks[i];
+        chunk->ctx = ctx;
+        chunk->run = run;
+        chunk->begin = begin + (end - begin) * i / count;
+        chunk->end = begin + (end - begin) * (i + 1) / count;
+        chunk->ret = VLC_SUCCESS;
+        /* the first chunk is processed by the calling thread */
+        started[i] = i > 0 && !vlc_clone(&chunk->thread, sort_chunk_Thread,
+                                         chunk, VLC_THREAD_PRIORITY_LOW);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        if (!started[i])
+            run(&chunks[i]);
+
+    for (size_t i = 0; i < count; ++i)
+        if (started[i])
+            vlc_join(chunks[i].thread, NULL);
+
+    return count;
+}
+
+static void
+vlc_playlist_InitMetaChunk(struct sort_chunk *chunk)
 {
-    struct vlc_playlist_item_meta **array =
-            vlc_alloc(playlist->items.size, sizeof(*array));
+    const struct sort_context *ctx = chunk->ctx;
+    for (size_t i = chunk->begin; i < chunk->end; ++i)
+    {
+        int ret = vlc_playlist_item_meta_Init(&ctx->metas[i],
+                                              ctx->playlist->items.data[i],
+                                              ctx->req.criteria,
+                                              ctx->req.count);
+        if (unlikely(ret != VLC_SUCCESS))
+        {
+            chunk->ret = ret;
+            return;
+        }
+        ctx->array[i] = &ctx->metas[i];
+    }
+}
 
-    if (unlikely(!array))
-        return NULL;
+static void
+vlc_playlist_SortChunk(struct sort_chunk *chunk)
+{
+    const struct sort_context *ctx = chunk->ctx;
+    void *req = (void *) &ctx->req;
 
-    size_t i;
-    for (i = 0; i < playlist->items.size; ++i)
+    vlc_qsort(&ctx->array[chunk->begin], chunk->end - chunk->begin,
+              sizeof(*ctx->array), compare_meta, req);
+}
+
+static void
+vlc_playlist_MergeRuns(struct vlc_playlist_item_meta *dst[],
+                       struct vlc_playlist_item_meta *const src[],
+                       size_t begin, size_t middle, size_t end,
+                       struct sort_request *req)
+{
+    size_t i = begin, j = middle, k = begin;
+    while (i < middle && j < end)
+        /* take from the left run on equality, to keep the merge stable */
+        dst[k++] = compare_meta(&src[j], &src[i], req) < 0 ? src[j++]
+                                                            : src[i++];
+    while (i < middle)
+        dst[k++] = src[i++];
+    while (j < end)
+        dst[k++] = src[j++];
+}
+
+/* Sort the meta array, whose items before the index "sorted" are already in
+ * order, and the items from chunks[] are each sorted */
+static void
+vlc_playlist_MergeChunks(struct sort_context *ctx, size_t sorted,
+                         const struct sort_chunk chunks[], size_t count)
+{
+    size_t size = ctx->playlist->items.size;
+
+    /* boundaries of the sorted runs */
+    size_t bounds[SORT_THREADS_MAX + 2];
+    size_t runs = 0;
+    if (sorted > 0)
+        bounds[runs++] = 0;
+    for (size_t i = 0; i < count; ++i)
+        bounds[runs++] = chunks[i].begin;
+    bounds[runs] = size;
+
+    if (runs == 1)
+        return;
+
+    struct vlc_playlist_item_meta **tmp = vlc_alloc(size, sizeof(*tmp));
+    if (unlikely(!tmp))
     {
-        array[i] = vlc_playlist_item_meta_New(playlist->items.data[i],
-                                              criteria, count);
-        if (unlikely(!array[i]))
-            break;
+        /* no memory to merge, sort the whole array in place */
+        vlc_qsort(ctx->array, size, sizeof(*ctx->array), compare_meta,
+                  &ctx->req);
+        return;
     }
 
-    if (i < playlist->items.size)
+    struct vlc_playlist_item_meta **src = ctx->array;
+    struct vlc_playlist_item_meta **dst = tmp;
+    while (runs > 1)
     {
-        /* allocation failure */
-        vlc_playlist_DeleteMetaArray(array, i);
-        return NULL;
+        size_t merged = 0;
+        for (size_t i = 0; i < runs; i += 2)
+        {
+            if (i + 1 < runs)
+                vlc_playlist_MergeRuns(dst, src, bounds[i], bounds[i + 1],
+                                       bounds[i + 2], &ctx->req);
+            else
+                memcpy(&dst[bounds[i]], &src[bounds[i]],
+                       (bounds[i + 1] - bounds[i]) * sizeof(*dst));
+            bounds[merged++] = bounds[i];
+        }
+        bounds[merged] = size;
+        runs = merged;
+
+        struct vlc_playlist_item_meta **swap = src;
+        src = dst;
+        dst = swap;
     }
 
-    return array;
+    if (src != ctx->array)
+        memcpy(ctx->array, src, size * sizeof(*src));
+    free(tmp);
 }
 
 int
@@ -371,20 +508,57 @@ vlc_playlist_Sort(vlc_playlist_t *playlist,
                                  ? playlist->items.data[playlist->current]
                                  : NULL;
 
-    struct vlc_playlist_item_meta **array =
-        vlc_playlist_NewMetaArray(playlist, criteria, count);
-    if (unlikely(!array))
+    size_t size = playlist->items.size;
+    struct sort_context ctx = {
+        .playlist = playlist,
+        .req = { criteria, count },
+    };
+
+    /* one allocation for all the metas, rather than one per item */
+    ctx.metas = calloc(size, sizeof(*ctx.metas));
+    ctx.array = vlc_alloc(size, sizeof(*ctx.array));
+    if (unlikely((!ctx.metas || !ctx.array) && size > 0))
+    {
+        free(ctx.metas);
+        free(ctx.array);
         return VLC_ENOMEM;
+    }
+
+    /* compute the sort keys once per item */
+    struct sort_chunk chunks[SORT_THREADS_MAX];
+    size_t chunk_count = vlc_playlist_RunChunks(&ctx,
+                                                vlc_playlist_InitMetaChunk,
+                                                0, size, chunks);
+    for (size_t i = 0; i < chunk_count; ++i)
+        if (unlikely(chunks[i].ret != VLC_SUCCESS))
+        {
+            vlc_playlist_DeleteMetaArray(ctx.metas, size);
+            free(ctx.array);
+            return chunks[i].ret;
+        }
 
-    struct sort_request req = { criteria, count };
+    /* Items already in order, typically a sorted playlist to which items
+     * have been appended, are not sorted again, but merged with the others */
+    size_t sorted = size > 0 ? 1 : 0;
+    while (sorted < size
+        && compare_meta(&ctx.array[sorted - 1], &ctx.array[sorted],
+                        &ctx.req) <= 0)
+        ++sorted;
 
-    vlc_qsort(array, playlist->items.size, sizeof(*array), compare_meta, &req);
+    if (sorted < size)
+    {
+        chunk_count = vlc_playlist_RunChunks(&ctx, vlc_playlist_SortChunk,
+                                             sorted, size, chunks);
+        vlc_playlist_MergeChunks(&ctx, sorted, chunks, chunk_count);
+    }
 
     /* apply the sorting result to the playlist */
-    for (size_t i = 0; i < playlist->items.size; ++i)
-        playlist->items.data[i] = array[i]->item;
+    for (size_t i = 0; i < size; ++i)
+        playlist->items.data[i] = ctx.array[i]->item;
+    vlc_playlist_UpdateIndexHints(playlist, 0, size);
 
-    vlc_playlist_DeleteMetaArray(array, playlist->items.size);
+    free(ctx.array);
+    vlc_playlist_DeleteMetaArray(ctx.metas, size);
 
     struct vlc_playlist_state state;
     if (current)
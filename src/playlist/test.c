@@ -1054,8 +1054,20 @@ test_index_of(void)
     vlc_playlist_item_t *item = vlc_playlist_Get(playlist, 4);
     assert(vlc_playlist_IndexOf(playlist, item) == 4);
 
+    /* the items following an insertion or a removal are shifted */
+    ret = vlc_playlist_InsertOne(playlist, 0, media[9]);
+    assert(ret == VLC_SUCCESS);
+    assert(vlc_playlist_IndexOf(playlist, item) == 5);
+    vlc_playlist_RemoveOne(playlist, 0);
+    vlc_playlist_RemoveOne(playlist, 0);
+    assert(vlc_playlist_IndexOf(playlist, item) == 3);
+
+    vlc_playlist_Move(playlist, 3, 1, 7);
+    assert(vlc_playlist_IndexOf(playlist, item) == 7);
+    assert(vlc_playlist_Get(playlist, 7) == item);
+
     vlc_playlist_item_Hold(item);
-    vlc_playlist_RemoveOne(playlist, 4);
+    vlc_playlist_RemoveOne(playlist, 7);
     assert(vlc_playlist_IndexOf(playlist, item) == -1);
     vlc_playlist_item_Release(item);
 
@@ -2244,6 +2256,61 @@ test_sort(void)
     vlc_playlist_Delete(playlist);
 }
 
+static void
+test_sort_large(void)
+{
+    vlc_playlist_t *playlist = vlc_playlist_New(NULL);
+    assert(playlist);
+
+    /* large enough to be sorted in parallel */
+    enum { COUNT = 50000, APPENDED = 1000 };
+    input_item_t **media = malloc((COUNT + APPENDED) * sizeof(*media));
+    assert(media);
+
+    for (int i = 0; i < COUNT + APPENDED; ++i)
+    {
+        media[i] = CreateDummyMedia(i);
+        assert(media[i]);
+        /* pseudo-random durations, with duplicates */
+        media[i]->i_duration = (i * 7919) % 10007;
+    }
+
+    int ret = vlc_playlist_Append(playlist, media, COUNT);
+    assert(ret == VLC_SUCCESS);
+
+    struct vlc_playlist_sort_criterion criteria[] = {
+        { VLC_PLAYLIST_SORT_KEY_DURATION, VLC_PLAYLIST_SORT_ORDER_ASCENDING },
+        { VLC_PLAYLIST_SORT_KEY_URL, VLC_PLAYLIST_SORT_ORDER_ASCENDING },
+    };
+
+    ret = vlc_playlist_Sort(playlist, criteria, 2);
+    assert(ret == VLC_SUCCESS);
+
+    for (size_t i = 1; i < COUNT; ++i)
+        assert(vlc_playlist_Get(playlist, i - 1)->media->i_duration
+            <= vlc_playlist_Get(playlist, i)->media->i_duration);
+
+    /* sort again after appending items to the sorted playlist */
+    ret = vlc_playlist_Append(playlist, &media[COUNT], APPENDED);
+    assert(ret == VLC_SUCCESS);
+
+    ret = vlc_playlist_Sort(playlist, criteria, 2);
+    assert(ret == VLC_SUCCESS);
+
+    assert(vlc_playlist_Count(playlist) == COUNT + APPENDED);
+    for (size_t i = 1; i < COUNT + APPENDED; ++i)
+        assert(vlc_playlist_Get(playlist, i - 1)->media->i_duration
+            <= vlc_playlist_Get(playlist, i)->media->i_duration);
+
+    /* no item has been lost (check a sample, the lookup is linear) */
+    for (int i = 0; i < COUNT + APPENDED; i += 997)
+        assert(vlc_playlist_IndexOfMedia(playlist, media[i]) != -1);
+
+    vlc_playlist_Delete(playlist);
+    DestroyMediaArray(media, COUNT + APPENDED);
+    free(media);
+}
+
 #undef EXPECT_AT
 
 int main(void)
@@ -2278,5 +2345,6 @@ int main(void)
     test_random();
     test_shuffle();
     test_sort();
+    test_sort_large();
     return 0;
 }
@@ -25,27 +25,72 @@
 #include <assert.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
 #include "misc/picture.h"
 
-void *picture_Allocate(int *restrict fdp, size_t size)
+static void *picture_Map(int fd, size_t size)
 {
+    if (ftruncate(fd, size))
+        return NULL;
+
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return (base != MAP_FAILED) ? base : NULL;
+}
+
+void *picture_Allocate(int *restrict fdp, size_t *restrict sizep,
+                       int hugepages)
+{
+    size_t size = *sizep;
+
+#if defined (HAVE_MEMFD_CREATE) && defined (MFD_HUGETLB)
+    if (hugepages == PICTURE_HUGEPAGES_EXPLICIT)
+    {
+        int fd = memfd_create(PACKAGE_NAME"-picture",
+                              MFD_CLOEXEC | MFD_HUGETLB);
+        if (fd != -1)
+        {
+            struct stat st;
+
+            /* The size must be a multiple of the huge page size */
+            if (fstat(fd, &st) == 0 && st.st_blksize > 0)
+            {
+                size_t page = st.st_blksize;
+                size_t hsize = (size + page - 1) / page * page;
+                void *base = picture_Map(fd, hsize);
+
+                if (base != NULL)
+                {
+                    *fdp = fd;
+                    *sizep = hsize;
+                    return base;
+                }
+            }
+            vlc_close(fd);
+        }
+        /* Fall back to normal pages, e.g. if no huge pages are reserved */
+    }
+#endif
+
     int fd = vlc_memfd();
     if (fd == -1)
         return NULL;
 
-    if (ftruncate(fd, size)) {
-error:
+    void *base = picture_Map(fd, size);
+    if (base == NULL)
+    {
         vlc_close(fd);
         return NULL;
     }
 
-    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (base == MAP_FAILED)
-        goto error;
-
+#ifdef MADV_HUGEPAGE
+    if (hugepages == PICTURE_HUGEPAGES_TRANSPARENT)
+        madvise(base, size, MADV_HUGEPAGE);
+#else
+    (void) hugepages;
+#endif
     *fdp = fd;
     return base;
 }
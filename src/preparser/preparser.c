@@ -31,12 +31,28 @@
 #include "preparser.h"
 #include "fetcher.h"
 
+struct preparser_stage_stats
+{
+    unsigned count;
+    vlc_tick_t total;
+    vlc_tick_t max;
+};
+
 struct input_preparser_t
 {
     vlc_object_t* owner;
     input_fetcher_t* fetcher;
     struct background_worker* worker;
     atomic_bool deactivated;
+
+    vlc_mutex_t stats_lock;
+    struct
+    {
+        struct preparser_stage_stats open;  /* input creation and start */
+        struct preparser_stage_stats parse; /* until the input ended */
+        struct preparser_stage_stats fetch; /* art and meta fetchers */
+        unsigned done, failed, timeout;
+    } stats;
 };
 
 typedef struct input_preparser_req_t
@@ -53,6 +69,7 @@ typedef struct input_preparser_task_t
     input_preparser_t* preparser;
     int preparse_status;
     input_thread_t* input;
+    vlc_tick_t start;
     atomic_int state;
     atomic_bool done;
 } input_preparser_task_t;
@@ -89,6 +106,30 @@ static void ReqRelease(input_preparser_req_t *req)
     }
 }
 
+static void StageAdd( input_preparser_t *preparser,
+                      struct preparser_stage_stats *stage, vlc_tick_t start )
+{
+    vlc_tick_t duration = vlc_tick_now() - start;
+
+    vlc_mutex_lock( &preparser->stats_lock );
+    stage->count++;
+    stage->total += duration;
+    if( duration > stage->max )
+        stage->max = duration;
+    vlc_mutex_unlock( &preparser->stats_lock );
+}
+
+static void StageLog( input_preparser_t *preparser, const char *name,
+                      const struct preparser_stage_stats *stage )
+{
+    if( stage->count == 0 )
+        return;
+    msg_Dbg( preparser->owner, "preparser %s: %u item(s), %"PRId64" ms average,"
+             " %"PRId64" ms max", name, stage->count,
+             MS_FROM_VLC_TICK( stage->total / stage->count ),
+             MS_FROM_VLC_TICK( stage->max ) );
+}
+
 static void InputEvent( input_thread_t *input,
                         const struct vlc_input_event *event, void *task_ )
 {
@@ -129,6 +170,7 @@ static int PreparserOpenInput( void* preparser_, void* req_, void** out )
     atomic_init( &task->done, false );
 
     task->preparser = preparser_;
+    task->start = vlc_tick_now();
     task->input = input_CreatePreparser( preparser->owner, InputEvent,
                                          task, req->item );
     if( !task->input )
@@ -142,6 +184,7 @@ static int PreparserOpenInput( void* preparser_, void* req_, void** out )
         input_Close( task->input );
         goto error;
     }
+    StageAdd( preparser, &preparser->stats.open, task->start );
 
     *out = task;
 
@@ -168,6 +211,7 @@ static void on_art_fetch_ended(input_item_t *item, bool fetched, void *userdata)
     input_preparser_task_t *task = userdata;
     input_preparser_req_t *req = task->req;
 
+    StageAdd(task->preparser, &task->preparser->stats.fetch, task->start);
     input_item_SetPreparsed(req->item, true);
 
     if (req->cbs && req->cbs->on_preparse_ended)
@@ -206,15 +250,26 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
     input_Stop( input );
     input_Close( input );
 
+    StageAdd( preparser, &preparser->stats.parse, task->start );
+    vlc_mutex_lock( &preparser->stats_lock );
+    switch( status )
+    {
+        case ITEM_PREPARSE_DONE:    preparser->stats.done++;    break;
+        case ITEM_PREPARSE_FAILED:  preparser->stats.failed++;  break;
+        default:                    preparser->stats.timeout++; break;
+    }
+    vlc_mutex_unlock( &preparser->stats_lock );
+
     if( preparser->fetcher )
     {
         task->preparse_status = status;
+        task->start = vlc_tick_now();
+        /* the fetcher may end, and free the task, before Push returns */
+        ReqHold(req);
         if (!input_fetcher_Push(preparser->fetcher, item, 0,
                                &input_fetcher_callbacks, task))
-        {
-            ReqHold(task->req);
             return;
-        }
+        ReqRelease(req);
     }
 
     free(task);
@@ -234,6 +289,7 @@ input_preparser_t* input_preparser_New( vlc_object_t *parent )
     struct background_worker_config conf = {
         .default_timeout = VLC_TICK_FROM_MS(var_InheritInteger( parent, "preparse-timeout" )),
         .max_threads = var_InheritInteger( parent, "preparse-threads" ),
+        .priority = VLC_EXECUTOR_PRIORITY_NORMAL,
         .pf_start = PreparserOpenInput,
         .pf_probe = PreparserProbeInput,
         .pf_stop = PreparserCloseInput,
@@ -254,6 +310,8 @@ input_preparser_t* input_preparser_New( vlc_object_t *parent )
     preparser->owner = parent;
     preparser->fetcher = input_fetcher_New( parent );
     atomic_init( &preparser->deactivated, false );
+    vlc_mutex_init( &preparser->stats_lock );
+    memset( &preparser->stats, 0, sizeof( preparser->stats ) );
 
     if( unlikely( !preparser->fetcher ) )
         msg_Warn( parent, "unable to create art fetcher" );
@@ -325,5 +383,14 @@ void input_preparser_Delete( input_preparser_t *preparser )
     if( preparser->fetcher )
         input_fetcher_Delete( preparser->fetcher );
 
+    if( preparser->stats.parse.count > 0 )
+        msg_Dbg( preparser->owner, "preparsed %u item(s): %u done, %u failed, "
+                 "%u timed out", preparser->stats.parse.count,
+                 preparser->stats.done, preparser->stats.failed,
+                 preparser->stats.timeout );
+    StageLog( preparser, "open", &preparser->stats.open );
+    StageLog( preparser, "parse", &preparser->stats.parse );
+    StageLog( preparser, "fetch", &preparser->stats.fetch );
+    vlc_mutex_destroy( &preparser->stats_lock );
     free( preparser );
 }
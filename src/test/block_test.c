@@ -86,11 +86,102 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_Share (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = 42;
+
+    block_t *orig = block;
+    block_t *share = block_Share (&block);
+    assert (share != NULL);
+    assert (block != orig);
+    assert (share->p_buffer == block->p_buffer);
+    assert (share->i_buffer == sizeof (text));
+    assert (share->i_pts == 42);
+
+    block_t *share2 = block_Share (&share);
+    assert (share2 != NULL);
+    assert (share2->p_buffer == block->p_buffer);
+
+    /* Growing must not write over the shared payload */
+    share = block_Realloc (share, -5, sizeof (text) - 5);
+    assert (share != NULL);
+    share = block_Realloc (share, 5, sizeof (text));
+    assert (share != NULL);
+    memset (share->p_buffer, 'A', 5);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    assert (!memcmp (share2->p_buffer, text, sizeof (text)));
+    block_Release (share);
+
+    share2 = block_Unshare (share2);
+    assert (share2 != NULL);
+    assert (share2->p_buffer != block->p_buffer);
+    memset (share2->p_buffer, 'B', share2->i_buffer);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (share2);
+
+    /* The last reference is writable */
+    uint8_t *p = block->p_buffer;
+    block = block_Unshare (block);
+    assert (block != NULL && block->p_buffer == p);
+    block_Release (block);
+}
+
+#define FIFO_BLOCKS 100000
+
+static void *test_fifo_producer (void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        block_t *block = block_Alloc (sizeof (i));
+        assert (block != NULL);
+        memcpy (block->p_buffer, &i, sizeof (i));
+        block_FifoPut (fifo, block);
+    }
+    return NULL;
+}
+
+static void test_fifo_spsc (void)
+{
+    block_fifo_t *fifo = block_FifoNewSPSC ();
+    vlc_thread_t th;
+
+    assert (fifo != NULL);
+
+    if (vlc_clone (&th, test_fifo_producer, fifo, VLC_THREAD_PRIORITY_LOW))
+        abort ();
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        block_t *block = block_FifoGet (fifo);
+        unsigned val;
+
+        assert (block->i_buffer == sizeof (val));
+        memcpy (&val, block->p_buffer, sizeof (val));
+        assert (val == i);
+        block_Release (block);
+    }
+    vlc_join (th, NULL);
+
+    assert (block_FifoTryGet (fifo) == NULL);
+
+    /* Leftover blocks are destroyed along with the FIFO */
+    test_fifo_producer (fifo);
+    assert (block_FifoShow (fifo)->i_buffer == sizeof (unsigned));
+    block_FifoRelease (fifo);
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_Share ();
+    test_fifo_spsc ();
     return 0;
 }
 
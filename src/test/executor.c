@@ -0,0 +1,205 @@
+/*****************************************************************************
+ * executor.c: Test for the worker threads pool
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+#include <vlc_interrupt.h>
+
+#include "../misc/executor.h"
+
+#define TASK_COUNT 1000
+
+static vlc_sem_t done;
+static atomic_uint counter;
+
+static void run_count(void *opaque)
+{
+    (void) opaque;
+    atomic_fetch_add(&counter, 1);
+    vlc_sem_post(&done);
+}
+
+static void test_many(void)
+{
+    struct vlc_executor *executor = vlc_executor_New(4);
+    assert(executor != NULL);
+
+    static struct vlc_executor_task tasks[TASK_COUNT];
+    atomic_init(&counter, 0);
+
+    for (size_t i = 0; i < TASK_COUNT; ++i)
+    {
+        tasks[i].pf_run = run_count;
+        tasks[i].opaque = NULL;
+        tasks[i].priority = i % 3 - 1;
+        vlc_executor_Submit(executor, &tasks[i]);
+    }
+
+    for (size_t i = 0; i < TASK_COUNT; ++i)
+        vlc_sem_wait(&done);
+    assert(atomic_load(&counter) == TASK_COUNT);
+
+    vlc_executor_Delete(executor);
+}
+
+struct blocker
+{
+    vlc_sem_t started;
+    vlc_sem_t release;
+    int ret;
+};
+
+static void run_block(void *opaque)
+{
+    struct blocker *blocker = opaque;
+    vlc_sem_post(&blocker->started);
+    blocker->ret = vlc_sem_wait_i11e(&blocker->release);
+    vlc_sem_post(&done);
+}
+
+static int order[3];
+static unsigned order_count;
+
+static void run_record(void *opaque)
+{
+    order[order_count++] = (intptr_t) opaque;
+    vlc_sem_post(&done);
+}
+
+static void test_priorities(void)
+{
+    struct vlc_executor *executor = vlc_executor_New(1);
+    assert(executor != NULL);
+
+    struct blocker blocker;
+    vlc_sem_init(&blocker.started, 0);
+    vlc_sem_init(&blocker.release, 0);
+
+    struct vlc_executor_task block = {
+        .pf_run = run_block, .opaque = &blocker,
+    };
+    vlc_executor_Submit(executor, &block);
+    /* wait for the only thread to be busy */
+    vlc_sem_wait(&blocker.started);
+
+    struct vlc_executor_task tasks[3];
+    static const int prios[] = {
+        VLC_EXECUTOR_PRIORITY_LOW,
+        VLC_EXECUTOR_PRIORITY_NORMAL,
+        VLC_EXECUTOR_PRIORITY_HIGH,
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(tasks); ++i)
+    {
+        tasks[i].pf_run = run_record;
+        tasks[i].opaque = (void *)(intptr_t) prios[i];
+        tasks[i].priority = prios[i];
+        vlc_executor_Submit(executor, &tasks[i]);
+    }
+
+    /* a queued task can be withdrawn */
+    struct vlc_executor_task canceled = {
+        .pf_run = run_record, .opaque = NULL,
+    };
+    vlc_executor_Submit(executor, &canceled);
+    assert(vlc_executor_Cancel(executor, &canceled));
+
+    order_count = 0;
+    vlc_sem_post(&blocker.release);
+    for (int i = 0; i < 4; ++i)
+        vlc_sem_wait(&done);
+
+    assert(blocker.ret == 0);
+    assert(order_count == 3);
+    assert(order[0] == VLC_EXECUTOR_PRIORITY_HIGH);
+    assert(order[1] == VLC_EXECUTOR_PRIORITY_NORMAL);
+    assert(order[2] == VLC_EXECUTOR_PRIORITY_LOW);
+
+    vlc_sem_destroy(&blocker.release);
+    vlc_sem_destroy(&blocker.started);
+    vlc_executor_Delete(executor);
+}
+
+static void test_interrupt(void)
+{
+    struct vlc_executor *executor = vlc_executor_New(1);
+    assert(executor != NULL);
+
+    struct blocker blocker;
+    vlc_sem_init(&blocker.started, 0);
+    vlc_sem_init(&blocker.release, 0);
+
+    struct vlc_executor_task task = {
+        .pf_run = run_block, .opaque = &blocker,
+    };
+    vlc_executor_Submit(executor, &task);
+    vlc_sem_wait(&blocker.started);
+
+    /* a running task is interrupted */
+    assert(!vlc_executor_Cancel(executor, &task));
+    vlc_sem_wait(&done);
+    assert(blocker.ret == EINTR);
+
+    /* the next task gets a fresh interrupt context */
+    vlc_executor_Submit(executor, &task);
+    vlc_sem_wait(&blocker.started);
+    vlc_sem_post(&blocker.release);
+    vlc_sem_wait(&done);
+    assert(blocker.ret == 0);
+
+    vlc_sem_destroy(&blocker.release);
+    vlc_sem_destroy(&blocker.started);
+    vlc_executor_Delete(executor);
+}
+
+static void test_shared(void)
+{
+    struct vlc_executor *a = vlc_executor_Hold();
+    struct vlc_executor *b = vlc_executor_Hold();
+    assert(a != NULL && a == b);
+
+    struct vlc_executor_task task = { .pf_run = run_count };
+    vlc_executor_Submit(a, &task);
+    vlc_sem_wait(&done);
+
+    vlc_executor_Release(b);
+    vlc_executor_Release(a);
+}
+
+int main(void)
+{
+    vlc_sem_init(&done, 0);
+
+    test_many();
+    test_priorities();
+    test_interrupt();
+    test_shared();
+
+    vlc_sem_destroy(&done);
+    return 0;
+}
@@ -23,6 +23,7 @@
 #endif
 
 #include <stdbool.h>
+#include <stdio.h>
 #undef NDEBUG
 #include <assert.h>
 
@@ -106,6 +107,59 @@ static void test(bool zombie)
             picture_Release(pics[i]);
 }
 
+#define THREADS 4
+#define ITERATIONS 100000
+
+static void *worker(void *data)
+{
+    picture_pool_t *p = data;
+
+    for (unsigned i = 0; i < ITERATIONS; i++) {
+        picture_t *pic = (i & 1) ? picture_pool_Wait(p) : picture_pool_Get(p);
+        if (pic == NULL)
+            continue;
+
+        /* Pictures must not be handed out twice */
+        uint8_t *pixel = pic->p[0].p_pixels;
+        assert(*pixel == 0);
+        *pixel = 1;
+        *pixel = 0;
+        picture_Release(pic);
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    vlc_thread_t th[THREADS];
+
+    pool = picture_pool_NewFromFormat(&fmt, THREADS / 2);
+    assert(pool != NULL);
+
+    for (unsigned i = 0; i < THREADS / 2; i++) {
+        picture_t *pic = picture_pool_Get(pool);
+        assert(pic != NULL);
+        *pic->p[0].p_pixels = 0;
+        picture_Release(pic);
+    }
+
+    vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned i = 0; i < THREADS; i++)
+        if (vlc_clone(&th[i], worker, pool, VLC_THREAD_PRIORITY_LOW))
+            abort();
+    for (unsigned i = 0; i < THREADS; i++)
+        vlc_join(th[i], NULL);
+
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    printf("%u threads, %u pictures: %.0f get/release per second\n",
+           THREADS, THREADS / 2,
+           (double)(THREADS * ITERATIONS) * CLOCK_FREQ / elapsed);
+
+    picture_pool_Release(pool);
+}
+
 int main(void)
 {
     video_format_Setup(&fmt, VLC_CODEC_I420, 320, 200, 320, 200, 1, 1);
@@ -122,6 +176,7 @@ int main(void)
 
     test(false);
     test(true);
+    test_threads();
 
     return 0;
 }
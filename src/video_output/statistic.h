@@ -23,6 +23,7 @@
 #ifndef LIBVLC_VOUT_STATISTIC_H
 # define LIBVLC_VOUT_STATISTIC_H
 # include <stdatomic.h>
+# include "../misc/histogram.h"
 
 /* NOTE: Both statistics are atomic on their own, so one might be older than
  * the other one. Currently, only one of them is updated at a time, so this
@@ -30,12 +31,21 @@
 typedef struct {
     atomic_uint displayed;
     atomic_uint lost;
+
+    bool latency; /**< whether latencies are collected */
+    struct vlc_histogram queue; /**< residency of pictures in the queue */
+    struct vlc_histogram late; /**< lateness of displayed pictures */
+    struct vlc_histogram presentation; /**< presentation error on screen */
 } vout_statistic_t;
 
-static inline void vout_statistic_Init(vout_statistic_t *stat)
+static inline void vout_statistic_Init(vout_statistic_t *stat, bool latency)
 {
     atomic_init(&stat->displayed, 0);
     atomic_init(&stat->lost, 0);
+    stat->latency = latency;
+    vlc_histogram_Init(&stat->queue);
+    vlc_histogram_Init(&stat->late);
+    vlc_histogram_Init(&stat->presentation);
 }
 
 static inline void vout_statistic_Clean(vout_statistic_t *stat)
@@ -52,6 +62,16 @@ static inline void vout_statistic_GetReset(vout_statistic_t *stat,
     *lost = atomic_exchange_explicit(&stat->lost, 0, memory_order_relaxed);
 }
 
+static inline void vout_statistic_GetResetLatency(vout_statistic_t *stat,
+                                                  struct vlc_histogram *queue,
+                                                  struct vlc_histogram *late,
+                                                  struct vlc_histogram *presentation)
+{
+    vlc_histogram_Merge(queue, &stat->queue);
+    vlc_histogram_Merge(late, &stat->late);
+    vlc_histogram_Merge(presentation, &stat->presentation);
+}
+
 static inline void vout_statistic_AddDisplayed(vout_statistic_t *stat,
                                                int displayed)
 {
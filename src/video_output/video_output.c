@@ -47,6 +47,7 @@
 #include <vlc_vout_osd.h>
 #include <vlc_image.h>
 #include <vlc_plugin.h>
+#include <vlc_tracer.h>
 
 #include <libvlc.h>
 #include "vout_internal.h"
@@ -55,6 +56,7 @@
 #include "snapshot.h"
 #include "window.h"
 #include "../misc/variables.h"
+#include "../misc/picture.h"
 #include "../clock/clock.h"
 
 /* Maximum delay between 2 displayed pictures.
@@ -215,6 +217,37 @@ void vout_GetResetStatistic(vout_thread_t *vout, unsigned *restrict displayed,
     vout_statistic_GetReset( &vout->p->statistic, displayed, lost );
 }
 
+void vout_GetResetLatency(vout_thread_t *vout, struct vlc_histogram *queue,
+                          struct vlc_histogram *late,
+                          struct vlc_histogram *presentation)
+{
+    vout_statistic_GetResetLatency(&vout->p->statistic, queue, late,
+                                   presentation);
+}
+
+void vout_ReportPresented(vout_thread_t *vout, vlc_tick_t date,
+                          vlc_tick_t presented, vlc_tick_t period)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    if (sys->statistic.latency && date != VLC_TICK_INVALID)
+        vlc_histogram_Add(&sys->statistic.presentation,
+                          presented >= date ? presented - date
+                                            : date - presented);
+
+    if (sys->tracer != NULL)
+        vlc_tracer_TraceEntries(sys->tracer,
+                                VLC_TRACE_STRING("name", "picture_presented"),
+                                VLC_TRACE_INT("system", date),
+                                VLC_TRACE_INT("presented", presented),
+                                VLC_TRACE_INT("period", period));
+
+    vlc_mutex_lock(&sys->vsync.lock);
+    sys->vsync.date = presented;
+    sys->vsync.period = period;
+    vlc_mutex_unlock(&sys->vsync.lock);
+}
+
 bool vout_IsEmpty(vout_thread_t *vout)
 {
     picture_t *picture = picture_fifo_Peek(vout->p->decoder_fifo);
@@ -326,6 +359,8 @@ picture_t *vout_GetPicture(vout_thread_t *vout)
 void vout_PutPicture(vout_thread_t *vout, picture_t *picture)
 {
     picture->p_next = NULL;
+    if (vout->p->statistic.latency)
+        ((picture_priv_t *)picture)->queued = vlc_tick_now();
     picture_fifo_Push(vout->p->decoder_fifo, picture);
     vout_control_Wake(&vout->p->control);
 }
@@ -671,9 +706,14 @@ static picture_t *VoutVideoFilterStaticNewPicture(filter_t *filter)
 {
     vout_thread_t *vout = filter->owner.sys;
 
-    vlc_mutex_assert(&vout->p->filter.lock);
-    if (filter_chain_IsEmpty(vout->p->filter.chain_interactive))
-        return VoutVideoFilterInteractiveNewPicture(filter);
+    /* Pipelined, the static filters run on their own threads without the
+     * filter lock (the chains are not changed while pipelined), and their
+     * pictures stay too long in flight to be taken from the private pool. */
+    if (!vout->p->filter.pipelined) {
+        vlc_mutex_assert(&vout->p->filter.lock);
+        if (filter_chain_IsEmpty(vout->p->filter.chain_interactive))
+            return VoutVideoFilterInteractiveNewPicture(filter);
+    }
 
     return picture_NewFromFormat(&filter->fmt_out.video);
 }
@@ -690,6 +730,9 @@ static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
 
     if (!is_locked)
         vlc_mutex_lock(&vout->p->filter.lock);
+    if (vout->p->filter.queued)
+        picture_Release(vout->p->filter.queued);
+    vout->p->filter.queued = NULL;
     filter_chain_VideoFlush(vout->p->filter.chain_static);
     filter_chain_VideoFlush(vout->p->filter.chain_interactive);
     if (!is_locked)
@@ -719,7 +762,9 @@ static void ThreadChangeFilters(vout_thread_t *vout,
     vout->p->filter.has_deint =
          deinterlace == 1 || (deinterlace == -1 && vout->p->filter.has_deint);
 
-    if (vout->p->filter.has_deint)
+    /* The display may interpolate the missing fields while rendering */
+    const vout_display_t *vd = vout->p->display;
+    if (vout->p->filter.has_deint && !(vd != NULL && vd->info.can_deinterlace))
     {
         vout_filter_t *e = malloc(sizeof(*e));
 
@@ -767,6 +812,9 @@ static void ThreadChangeFilters(vout_thread_t *vout,
     es_format_t fmt_target;
     es_format_InitFromVideo(&fmt_target, source ? source : &vout->p->filter.format);
 
+    /* Resetting the static chain stops its threads */
+    vout->p->filter.pipelined = false;
+
     const es_format_t *p_fmt_current = &fmt_target;
 
     for (int a = 0; a < 2; a++) {
@@ -809,6 +857,13 @@ static void ThreadChangeFilters(vout_thread_t *vout,
 
     es_format_Clean(&fmt_target);
 
+    /* Filter the next pictures while the current one is displayed */
+    if (vout->p->filter.use_pipeline
+     && !filter_chain_IsEmpty(vout->p->filter.chain_static))
+        vout->p->filter.pipelined =
+            filter_chain_VideoPipeline(vout->p->filter.chain_static, 1)
+                == VLC_SUCCESS;
+
     if (vout->p->filter.configuration != filters) {
         free(vout->p->filter.configuration);
         vout->p->filter.configuration = filters ? strdup(filters) : NULL;
@@ -823,6 +878,51 @@ static void ThreadChangeFilters(vout_thread_t *vout,
 }
 
 
+/**
+ * Queues the next decoded picture in the pipelined static filters, if they
+ * are idle, so that it is filtered while the current picture is displayed.
+ *
+ * Late pictures and format changes are left to ThreadDisplayPreparePicture().
+ */
+static void ThreadFeedPipeline(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    vlc_mutex_assert(&sys->filter.lock);
+    if (filter_chain_VideoPipelineCount(sys->filter.chain_static) > 0)
+        return;
+
+    /* Only this thread pops, so the peeked picture is the popped one */
+    picture_t *decoded = picture_fifo_Peek(sys->decoder_fifo);
+    if (!decoded)
+        return;
+
+    const vlc_tick_t system_now = vlc_tick_now();
+    const bool early = decoded->b_force ||
+        vlc_clock_ConvertToSystem(sys->clock, system_now, decoded->date,
+                                  sys->rate) > system_now;
+    const bool same = VideoFormatIsCropArEqual(&decoded->format,
+                                               &sys->filter.format);
+    picture_Release(decoded);
+    if (!early || !same)
+        return;
+
+    decoded = picture_fifo_Pop(sys->decoder_fifo);
+    if (sys->statistic.latency)
+        vlc_histogram_Add(&sys->statistic.queue, vlc_tick_now()
+                          - ((picture_priv_t *)decoded)->queued);
+
+    /* It becomes the displayed picture only once drained */
+    assert(sys->filter.queued == NULL);
+    sys->filter.queued = picture_Hold(decoded);
+
+    /* The chain is idle, so nothing can come out of it yet */
+    picture_t *picture = filter_chain_VideoFilter(sys->filter.chain_static,
+                                                  decoded);
+    assert(picture == NULL);
+    (void) picture;
+}
+
 /* */
 static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool frame_by_frame)
 {
@@ -831,9 +931,21 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
 
     vlc_mutex_lock(&vout->p->filter.lock);
 
-    picture_t *picture = filter_chain_VideoFilter(vout->p->filter.chain_static, NULL);
+    picture_t *picture = filter_chain_VideoDrain(vout->p->filter.chain_static);
     assert(!reuse || !picture);
 
+    picture_t *queued = vout->p->filter.queued;
+    if (queued) {
+        vout->p->filter.queued = NULL;
+
+        if (vout->p->displayed.decoded)
+            picture_Release(vout->p->displayed.decoded);
+
+        vout->p->displayed.decoded       = queued;
+        vout->p->displayed.timestamp     = queued->date;
+        vout->p->displayed.is_interlaced = !queued->b_progressive;
+    }
+
     while (!picture) {
         picture_t *decoded;
         if (reuse && vout->p->displayed.decoded) {
@@ -841,6 +953,10 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         } else {
             decoded = picture_fifo_Pop(vout->p->decoder_fifo);
 
+            if (decoded && sys->statistic.latency)
+                vlc_histogram_Add(&sys->statistic.queue, vlc_tick_now()
+                                  - ((picture_priv_t *)decoded)->queued);
+
             if (decoded) {
                 if (is_late_dropped && !decoded->b_force) {
                     const vlc_tick_t date = vlc_tick_now();
@@ -879,8 +995,14 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         vout->p->displayed.is_interlaced = !decoded->b_progressive;
 
         picture = filter_chain_VideoFilter(vout->p->filter.chain_static, decoded);
+        if (!picture && vout->p->filter.pipelined)
+            picture = filter_chain_VideoDrain(vout->p->filter.chain_static);
     }
 
+    if (picture && vout->p->filter.pipelined
+     && !vout->p->pause.is_on && !frame_by_frame)
+        ThreadFeedPipeline(vout);
+
     vlc_mutex_unlock(&vout->p->filter.lock);
 
     if (!picture)
@@ -949,6 +1071,81 @@ static picture_t *ConvertRGB32AndBlend(vout_thread_t *vout, picture_t *pic,
     return NULL;
 }
 
+/**
+ * Returns a copy of the picture with the subpictures blended in, for the
+ * snapshots of the displays that blend the subpictures themselves.
+ */
+static picture_t *SnapshotBlend(vout_thread_t *vout, picture_t *pic,
+                                vlc_tick_t system_now,
+                                vlc_tick_t render_subtitle_date)
+{
+    vout_thread_sys_t *sys = vout->p;
+    vout_display_t *vd = sys->display;
+
+    /* Same limitation as the early blending, see ThreadDisplayRenderPicture */
+    if (vd->source.orientation != ORIENT_NORMAL)
+        return NULL;
+
+    subpicture_t *subpic = spu_Render(sys->spu, NULL, &vd->source,
+                                      &vd->source, system_now,
+                                      render_subtitle_date, sys->spu_rate,
+                                      true, false);
+    if (subpic == NULL)
+        return NULL;
+
+    picture_t *blent = NULL;
+    filter_t *blend = filter_NewBlend(VLC_OBJECT(vout), &pic->format);
+    if (blend != NULL) {
+        blent = picture_NewFromFormat(&pic->format);
+        if (blent != NULL) {
+            picture_Copy(blent, pic);
+            /* Opaque pictures cannot be blended, keep them as is */
+            if (picture_BlendSubpicture(blent, blend, subpic) <= 0) {
+                picture_Release(blent);
+                blent = NULL;
+            }
+        }
+        filter_DeleteBlend(blend);
+    }
+    subpicture_Delete(subpic);
+    return blent;
+}
+
+/* Maximum age of the presentation feedback to extrapolate the refresh cycle
+ * of the screen from */
+#define VOUT_VSYNC_MAX_AGE VLC_TICK_FROM_SEC(1)
+
+/**
+ * Returns when to hand a picture due at the given system date to the
+ * display, so that it reaches the screen on the nearest refresh.
+ *
+ * Without presentation feedback, or with a variable refresh rate, the
+ * picture is handed over at its due date.
+ */
+static vlc_tick_t ThreadVsyncDeadline(vout_thread_sys_t *sys,
+                                      vlc_tick_t system_now, vlc_tick_t date)
+{
+    vlc_mutex_lock(&sys->vsync.lock);
+    const vlc_tick_t last = sys->vsync.date;
+    const vlc_tick_t period = sys->vsync.period;
+    vlc_mutex_unlock(&sys->vsync.lock);
+
+    if (last == VLC_TICK_INVALID || period <= 0
+     || system_now - last > VOUT_VSYNC_MAX_AGE)
+        return date;
+
+    /* Refresh closest to the due date, rounded down on ties */
+    vlc_tick_t offset = date - last + (period - 1) / 2;
+    vlc_tick_t cycles = offset / period;
+    if (offset < 0 && offset % period != 0)
+        cycles--;
+
+    /* Hand the picture over in the middle of the previous refresh cycle, so
+     * that it is neither too early (and shown one refresh before it is due)
+     * nor too late to make it to that refresh. */
+    return last + cycles * period - period / 2;
+}
+
 static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 {
     vout_thread_sys_t *sys = vout->p;
@@ -984,8 +1181,7 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     /*
      * Get the subpicture to be displayed
      */
-    const bool do_dr_spu = !do_snapshot &&
-                           vd->info.subpicture_chromas &&
+    const bool do_dr_spu = vd->info.subpicture_chromas &&
                            *vd->info.subpicture_chromas != 0;
 
     //FIXME: Denying do_early_spu if vd->source.orientation != ORIENT_NORMAL
@@ -1042,7 +1238,8 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
                                       subpicture_chromas, &fmt_spu_rot,
                                       &vd->source, system_now,
                                       render_subtitle_date, sys->spu_rate,
-                                      do_snapshot, vd->info.can_scale_spu);
+                                      do_snapshot && !do_dr_spu,
+                                      vd->info.can_scale_spu);
     /*
      * Perform rendering
      *
@@ -1086,6 +1283,12 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     if (do_snapshot)
     {
         assert(snap_pic);
+        if (do_dr_spu) {
+            picture_t *blent = SnapshotBlend(vout, snap_pic, system_now,
+                                             render_subtitle_date);
+            if (blent != NULL)
+                snap_pic = blent;
+        }
         vout_snapshot_Set(sys->snapshot, &vd->source, snap_pic);
         if (snap_pic != todisplay)
             picture_Release(snap_pic);
@@ -1125,8 +1328,15 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     if (!is_forced)
     {
         system_now = vlc_tick_now();
-        vlc_clock_Wait(sys->clock, system_now, pts, sys->rate,
-                       VOUT_REDISPLAY_DELAY);
+        const vlc_tick_t deadline =
+            ThreadVsyncDeadline(sys, system_now, system_pts);
+        vlc_clock_Wait(sys->clock, system_now,
+                       pts + (vlc_tick_t)((deadline - system_pts) * sys->rate),
+                       sys->rate, VOUT_REDISPLAY_DELAY);
+
+        if (sys->statistic.latency)
+            vlc_histogram_Add(&sys->statistic.late,
+                              vlc_tick_now() - system_pts);
     }
 
     /* Display the direct buffer returned by vout_RenderPicture */
@@ -1144,6 +1354,13 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     }
     sys->displayed.date = system_now;
 
+    if (sys->tracer != NULL)
+        vlc_tracer_TraceEntries(sys->tracer,
+                                VLC_TRACE_STRING("name", "picture_displayed"),
+                                VLC_TRACE_INT("pts", pts),
+                                VLC_TRACE_INT("system", system_now),
+                                VLC_TRACE_INT("forced", is_forced));
+
     vout_statistic_AddDisplayed(&sys->statistic, 1);
 
     return VLC_SUCCESS;
@@ -1413,6 +1630,9 @@ static int vout_Start(vout_thread_t *vout, const vout_configuration_t *cfg)
 
     sys->filter.configuration = NULL;
     video_format_Copy(&sys->filter.format, &sys->original);
+    sys->filter.use_pipeline = var_InheritBool(vout, "video-filter-pipeline");
+    sys->filter.pipelined = false;
+    sys->filter.queued = NULL;
 
     static const struct filter_video_callbacks static_cbs = {
         .buffer_new = VoutVideoFilterStaticNewPicture,
@@ -1443,6 +1663,11 @@ static int vout_Start(vout_thread_t *vout, const vout_configuration_t *cfg)
      */
     vlc_mutex_unlock(&sys->window_lock);
 
+    vlc_mutex_lock(&sys->vsync.lock);
+    sys->vsync.date = VLC_TICK_INVALID;
+    sys->vsync.period = 0;
+    vlc_mutex_unlock(&sys->vsync.lock);
+
     if (vout_OpenWrapper(vout, sys->splitter_name, &dcfg))
         goto error;
 
@@ -1528,6 +1753,8 @@ static void ThreadStop(vout_thread_t *vout)
 
     /* Destroy the video filters */
     ThreadDelAllFilterCallbacks(vout);
+    if (vout->p->filter.queued)
+        picture_Release(vout->p->filter.queued);
     filter_chain_Delete(vout->p->filter.chain_interactive);
     filter_chain_Delete(vout->p->filter.chain_static);
     video_format_Clean(&vout->p->filter.format);
@@ -1622,6 +1849,8 @@ static void *Thread(void *object)
     vlc_tick_t deadline = VLC_TICK_INVALID;
     bool wait = false;
 
+    vlc_thread_set_affinity(vout, "vout");
+
     for (;;) {
         vout_control_cmd_t cmd;
 
@@ -1714,6 +1943,7 @@ void vout_Release(vout_thread_t *vout)
     vlc_mutex_destroy(&vout->p->window_lock);
     vlc_mutex_destroy(&vout->p->spu_lock);
     vlc_mutex_destroy(&vout->p->filter.lock);
+    vlc_mutex_destroy(&vout->p->vsync.lock);
     vout_control_Clean(&vout->p->control);
 
     /* */
@@ -1760,7 +1990,8 @@ vout_thread_t *vout_Create(vlc_object_t *object)
     sys->source.dar.den = 0;
     sys->source.crop.mode = VOUT_CROP_NONE;
     sys->snapshot = vout_snapshot_New();
-    vout_statistic_Init(&sys->statistic);
+    vout_statistic_Init(&sys->statistic, var_InheritBool(vout, "stats"));
+    sys->tracer = vlc_object_get_tracer(vout);
 
     /* Initialize subpicture unit */
     vlc_mutex_init(&sys->spu_lock);
@@ -1794,6 +2025,10 @@ vout_thread_t *vout_Create(vlc_object_t *object)
     /* Arbitrary initial time */
     vout_chrono_Init(&sys->render, 5, VLC_TICK_FROM_MS(10));
 
+    vlc_mutex_init(&sys->vsync.lock);
+    sys->vsync.date = VLC_TICK_INVALID;
+    sys->vsync.period = 0;
+
     /* */
     atomic_init(&sys->refs, 0);
 
@@ -1832,12 +2067,18 @@ int vout_Request(const vout_configuration_t *cfg, input_thread_t *input)
      * ratio and crop settings, instead of recreating a display.
      */
     if (video_format_IsSimilar(&original, &sys->original)) {
-        if (cfg->dpb_size <= sys->dpb_size) {
+        /* In frugal mode, pools twice larger than needed are shrunk */
+        if (cfg->dpb_size <= sys->dpb_size
+         && (2 * cfg->dpb_size >= sys->dpb_size
+          || !var_InheritBool(vout, "video-frugal-pools"))) {
             video_format_Clean(&original);
             /* It is assumed that the SPU input matches input already. */
             return 0;
         }
-        msg_Warn(vout, "DPB need to be increased");
+        if (cfg->dpb_size <= sys->dpb_size)
+            msg_Dbg(vout, "DPB can be decreased");
+        else
+            msg_Warn(vout, "DPB need to be increased");
     }
 
     if (sys->original.i_chroma != 0)
@@ -109,6 +109,7 @@ struct vout_thread_sys_t
 
     /* Statistics */
     vout_statistic_t statistic;
+    struct vlc_tracer *tracer;
 
     /* Subpicture unit */
     vlc_mutex_t     spu_lock;
@@ -162,6 +163,9 @@ struct vout_thread_sys_t
         struct filter_chain_t *chain_static;
         struct filter_chain_t *chain_interactive;
         bool            has_deint;
+        bool            use_pipeline; /**< whether to thread chain_static */
+        bool            pipelined; /**< whether chain_static is threaded */
+        picture_t       *queued; /**< decoded picture ahead in chain_static */
     } filter;
 
     /* */
@@ -184,6 +188,13 @@ struct vout_thread_sys_t
     picture_fifo_t  *decoder_fifo;
     vout_chrono_t   render;           /**< picture render time estimator */
 
+    /* Refresh cycle of the screen, from the display presentation feedback */
+    struct {
+        vlc_mutex_t lock;
+        vlc_tick_t  date;   /**< last reported refresh */
+        vlc_tick_t  period; /**< refresh period, 0 if variable or unknown */
+    } vsync;
+
     atomic_uintptr_t refs;
 };
 
@@ -308,6 +319,23 @@ void spu_OffsetSubtitleDate( spu_t *p_spu, vlc_tick_t i_duration );
 void vout_GetResetStatistic( vout_thread_t *p_vout, unsigned *pi_displayed,
                              unsigned *pi_lost );
 
+/**
+ * This function will move the latency histograms to the given ones.
+ *
+ * Latencies are only collected if statistics are enabled.
+ */
+void vout_GetResetLatency( vout_thread_t *p_vout, struct vlc_histogram *queue,
+                           struct vlc_histogram *late,
+                           struct vlc_histogram *presentation );
+
+/**
+ * This function records the presentation feedback of the display.
+ *
+ * \see vout_display_SendEventPresented
+ */
+void vout_ReportPresented( vout_thread_t *p_vout, vlc_tick_t date,
+                           vlc_tick_t presented, vlc_tick_t period );
+
 /*
  * Cancel the vout, if cancel is true, it won't return any pictures after this
  * call.
@@ -1028,14 +1028,14 @@ static void SpuRenderRegion(spu_t *spu,
         }
     }
 
-    subpicture_region_t *dst = *dst_ptr = subpicture_region_New(&region_fmt);
+    /* The output region only references the rendered (or cached scaled)
+     * picture: allocating a new one for each displayed frame is useless */
+    subpicture_region_t *dst = *dst_ptr =
+        subpicture_region_ForPicture(&region_fmt, region_picture);
     if (dst) {
         dst->i_x       = x_offset;
         dst->i_y       = y_offset;
         dst->i_align   = 0;
-        if (dst->p_picture)
-            picture_Release(dst->p_picture);
-        dst->p_picture = picture_Hold(region_picture);
         int fade_alpha = 255;
         if (subpic->b_fade) {
             vlc_tick_t fade_start = entry->start + 3 * (entry->stop - entry->start) / 4;
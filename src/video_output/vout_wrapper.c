@@ -51,6 +51,14 @@ static void VoutDisplayEvent(vout_display_t *vd, int event, va_list args)
         var_SetAddress(vout, "viewpoint-moved",
                        (void *)va_arg(args, const vlc_viewpoint_t *));
         break;
+    case VOUT_DISPLAY_EVENT_PRESENTED: {
+        vlc_tick_t date = va_arg(args, vlc_tick_t);
+        vlc_tick_t presented = va_arg(args, vlc_tick_t);
+        vlc_tick_t period = va_arg(args, vlc_tick_t);
+
+        vout_ReportPresented(vout, date, presented, period);
+        break;
+    }
     default:
         msg_Err(vd, "VoutDisplayEvent received event %d", event);
         /* TODO add an assert when all event are handled */
@@ -100,7 +108,11 @@ int vout_OpenWrapper(vout_thread_t *vout,
     const unsigned reserved_picture = DISPLAY_PICTURE_COUNT +
                                       private_picture +
                                       kept_picture;
-    const unsigned display_pool_size = allow_dr ? __MAX(VOUT_MAX_PICTURES,
+    /* In frugal mode, the pools are sized from the DPB of the stream only,
+     * instead of being rounded up to VOUT_MAX_PICTURES. */
+    const unsigned min_pictures = var_InheritBool(vout, "video-frugal-pools")
+                                  ? 0 : VOUT_MAX_PICTURES;
+    const unsigned display_pool_size = allow_dr ? __MAX(min_pictures,
                                                         reserved_picture + decoder_picture) : 3;
     picture_pool_t *display_pool = vout_GetPool(vd, display_pool_size);
     if (display_pool == NULL)
@@ -121,7 +133,7 @@ int vout_OpenWrapper(vout_thread_t *vout,
     } else {
         sys->decoder_pool = decoder_pool =
             picture_pool_NewFromFormat(&vd->source,
-                                       __MAX(VOUT_MAX_PICTURES,
+                                       __MAX(min_pictures,
                                              reserved_picture + decoder_picture - DISPLAY_PICTURE_COUNT));
         if (!sys->decoder_pool)
             goto error;
@@ -22,6 +22,8 @@
 
 #include "test.h"
 
+#include <errno.h>
+
 static void wait_playing(libvlc_media_player_t *mp)
 {
     libvlc_state_t state;
@@ -189,6 +191,83 @@ static void test_media_player_pause_stop(const char** argv, int argc)
     libvlc_release (vlc);
 }
 
+static bool in_dispatch;
+
+static void on_queued_event(const libvlc_event_t *event, void *data)
+{
+    unsigned *count = data;
+
+    /* Queued events are only delivered while dispatching */
+    assert(in_dispatch);
+    assert(event->type == libvlc_MediaPlayerPlaying
+        || event->type == libvlc_MediaPlayerTimeChanged);
+    if (event->type == libvlc_MediaPlayerPlaying)
+        (*count)++;
+}
+
+static void test_media_player_queued_events(const char** argv, int argc)
+{
+    libvlc_instance_t *vlc;
+    libvlc_media_t *md;
+    libvlc_media_player_t *mi;
+    libvlc_event_queue_t *queue;
+    const char * file = test_default_sample;
+    unsigned playing = 0;
+
+    test_log ("Testing queued events with %s\n", file);
+
+    vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    md = libvlc_media_new_path (vlc, file);
+    assert (md != NULL);
+
+    mi = libvlc_media_player_new_from_media (md);
+    assert (mi != NULL);
+
+    libvlc_media_release (md);
+
+    queue = libvlc_event_queue_new ();
+    assert (queue != NULL);
+
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager (mi);
+    int ret = libvlc_event_attach_queued (em, libvlc_MediaPlayerPlaying,
+                                          on_queued_event, &playing, queue);
+    assert (ret == 0);
+    ret = libvlc_event_attach_queued (em, libvlc_MediaPlayerTimeChanged,
+                                      on_queued_event, &playing, queue);
+    assert (ret == 0);
+    /* Events pointing to objects cannot be queued */
+    ret = libvlc_event_attach_queued (em, libvlc_MediaPlayerMediaChanged,
+                                      on_queued_event, &playing, queue);
+    assert (ret == EINVAL);
+    /* The queue lives on until its listeners are detached */
+    libvlc_event_queue_release (queue);
+
+    libvlc_media_player_play (mi);
+    wait_playing (mi);
+
+    in_dispatch = true;
+    while (playing == 0)
+        libvlc_event_queue_dispatch (queue, 100);
+    in_dispatch = false;
+    assert (playing == 1);
+
+    libvlc_event_queue_wakeup (queue);
+    in_dispatch = true;
+    libvlc_event_queue_dispatch (queue, -1);
+    in_dispatch = false;
+
+    libvlc_event_detach (em, libvlc_MediaPlayerTimeChanged,
+                         on_queued_event, &playing);
+    libvlc_event_detach (em, libvlc_MediaPlayerPlaying,
+                         on_queued_event, &playing);
+
+    libvlc_media_player_stop (mi);
+    libvlc_media_player_release (mi);
+    libvlc_release (vlc);
+}
+
 
 int main (void)
 {
@@ -197,6 +276,7 @@ int main (void)
     test_media_player_set_media (test_defaults_args, test_defaults_nargs);
     test_media_player_play_stop (test_defaults_args, test_defaults_nargs);
     test_media_player_pause_stop (test_defaults_args, test_defaults_nargs);
+    test_media_player_queued_events (test_defaults_args, test_defaults_nargs);
 
     return 0;
 }
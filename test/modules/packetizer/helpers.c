@@ -25,11 +25,54 @@
 #undef NDEBUG
 #include <assert.h>
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_block_helper.h>
+#include <vlc_tick.h>
 
 #include "../modules/packetizer/startcode_helper.h"
+#include "../modules/packetizer/hxxx_ep3b.h"
+
+typedef const uint8_t *(*startcode_find_t)(const uint8_t *, const uint8_t *);
+
+static const struct
+{
+    const char *name;
+    startcode_find_t find;
+    startcode_find_t find_ep3b;
+} variants[] = {
+    { "bits", startcode_FindAnnexB_Bits, hxxx_ep3b_find_c },
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    { "sse2", startcode_FindAnnexB_SSE2,
+#if defined(HAVE_SSE2_INTRINSICS)
+      hxxx_ep3b_find_sse2,
+#else
+      hxxx_ep3b_find_c,
+#endif
+    },
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    { "avx2", startcode_FindAnnexB_AVX2, hxxx_ep3b_find_avx2 },
+#endif
+#if defined(__ARM_NEON)
+    { "neon", startcode_FindAnnexB_NEON, hxxx_ep3b_find_neon },
+#endif
+};
+
+static bool variant_supported( const char *name )
+{
+    if( !strcmp( name, "sse2" ) )
+        return vlc_CPU_SSE2();
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( !strcmp( name, "avx2" ) )
+        return vlc_CPU_AVX2();
+#endif
+    return true;
+}
 
 struct results_s
 {
@@ -70,28 +113,186 @@ static int run_annexb_sets( const uint8_t *p_set, const uint8_t *p_end,
 {
     int i_ret;
 
-    printf("checking bits code:\n");
-    i_ret = check_set( p_set, p_end, p_results, i_results, i_results_offset,
-                       startcode_FindAnnexB_Bits );
-    if( i_ret != 0 )
-        return i_ret;
-
-    /* Perform same tests on simd optimized code */
-    if( startcode_FindAnnexB_Bits != startcode_FindAnnexB )
+    /* Perform same tests on all built in variants */
+    for( size_t i = 0; i < ARRAY_SIZE(variants); i++ )
     {
-        printf("checking asm:\n");
+        if( !variant_supported( variants[i].name ) )
+        {
+            printf("%s not supported, skipping test:\n", variants[i].name);
+            continue;
+        }
+        printf("checking %s code:\n", variants[i].name);
         i_ret = check_set( p_set, p_end, p_results, i_results, i_results_offset,
-                           startcode_FindAnnexB );
+                           variants[i].find );
         if( i_ret != 0 )
             return i_ret;
     }
-    else printf("asm not built in, skipping test:\n");
 
     return 0;
 }
 
-int main( void )
+static void fill_random( uint8_t *p, size_t i_size, unsigned *seed,
+                         uint8_t rare )
+{
+    /* mostly zeroes and the rare byte, so that there are many matches,
+     * partial matches and near misses */
+    for( size_t i = 0; i < i_size; i++ )
+    {
+        *seed = *seed * 1103515245 + 12345;
+        unsigned v = *seed >> 16;
+        p[i] = (v & 3) ? 0x00 : (v & 4) ? rare : v >> 8;
+    }
+}
+
+/* Reference size computation, as done before hxxx_ep3b_find() */
+static size_t ep3b_total_size_ref( const uint8_t *p, const uint8_t *p_end )
+{
+    unsigned i_prev = 0;
+    size_t i = 0;
+    while( p < p_end )
+    {
+        uint8_t *n = hxxx_ep3b_to_rbsp( (uint8_t *)p, (uint8_t *)p_end, &i_prev, 1 );
+        if( n > p )
+            ++i;
+        p = n;
+    }
+    return i;
+}
+
+static int run_random_sets( void )
 {
+    uint8_t *p_data = malloc( 1024 );
+    unsigned seed = 1;
+
+    if( p_data == NULL )
+        return 1;
+
+    printf("* Running tests on random sets:\n");
+    for( unsigned n = 0; n < 20000; n++ )
+    {
+        size_t i_offset = n % 67;
+        size_t i_size = (n * 7) % (1024 - 67);
+        const uint8_t *p = &p_data[i_offset], *p_end = p + i_size;
+
+        fill_random( p_data, 1024, &seed, (n & 1) ? 0x01 : 0x03 );
+
+        const uint8_t *p_ref = startcode_FindAnnexB_Bits( p, p_end );
+        const uint8_t *p_ref_ep3b = (i_size > 0)
+                                  ? hxxx_ep3b_find_c( p + 1, p_end ) : NULL;
+        for( size_t i = 1; i < ARRAY_SIZE(variants); i++ )
+        {
+            if( !variant_supported( variants[i].name ) )
+                continue;
+            if( variants[i].find( p, p_end ) != p_ref
+             || (i_size > 0
+              && variants[i].find_ep3b( p + 1, p_end ) != p_ref_ep3b) )
+            {
+                printf("%s mismatch, offset %zu size %zu\n",
+                       variants[i].name, i_offset, i_size);
+                free( p_data );
+                return 1;
+            }
+        }
+
+        if( hxxx_ep3b_total_size( p, p_end ) != ep3b_total_size_ref( p, p_end ) )
+        {
+            printf("ep3b size mismatch, offset %zu size %zu\n",
+                   i_offset, i_size);
+            free( p_data );
+            return 1;
+        }
+    }
+
+    free( p_data );
+    return 0;
+}
+
+/* Benchmarks the lookups over an elementary stream file, or random data */
+static int run_bench( const char *psz_file, unsigned i_loops )
+{
+    size_t i_size = 16 << 20;
+    uint8_t *p_data;
+
+    if( psz_file != NULL )
+    {
+        FILE *stream = fopen( psz_file, "rb" );
+        if( stream == NULL )
+        {
+            perror( psz_file );
+            return 1;
+        }
+        fseek( stream, 0, SEEK_END );
+        i_size = ftell( stream );
+        rewind( stream );
+        p_data = malloc( i_size + 1 );
+        if( p_data != NULL && fread( p_data, 1, i_size, stream ) != i_size )
+        {
+            free( p_data );
+            p_data = NULL;
+        }
+        fclose( stream );
+    }
+    else
+    {
+        unsigned seed = 1;
+        p_data = malloc( i_size + 1 );
+        if( p_data != NULL )
+            for( size_t i = 0; i < i_size; i++ )
+            {
+                seed = seed * 1103515245 + 12345;
+                p_data[i] = seed >> 16; /* few start codes, as in slices */
+            }
+    }
+    if( p_data == NULL || i_size == 0 )
+    {
+        free( p_data );
+        return 1;
+    }
+
+    const uint8_t *p_end = p_data + i_size;
+
+    for( size_t i = 0; i < ARRAY_SIZE(variants); i++ )
+    {
+        if( !variant_supported( variants[i].name ) )
+            continue;
+
+        size_t i_found = 0;
+        vlc_tick_t start = vlc_tick_now();
+        for( unsigned n = 0; n < i_loops; n++ )
+            for( const uint8_t *p = p_data;
+                 (p = variants[i].find( p, p_end )) != NULL; p += 3 )
+                i_found++;
+        vlc_tick_t duration = vlc_tick_now() - start;
+
+        printf("%4s startcodes: %8.1f MB/s (%zu found)\n", variants[i].name,
+               (double) i_size * i_loops * CLOCK_FREQ / __MAX(duration, 1)
+               / 1000000., i_found / i_loops);
+    }
+
+    for( int i = 0; i < 2; i++ )
+    {
+        size_t i_total = 0;
+        vlc_tick_t start = vlc_tick_now();
+        for( unsigned n = 0; n < i_loops; n++ )
+            i_total += i ? hxxx_ep3b_total_size( p_data, p_end )
+                         : ep3b_total_size_ref( p_data, p_end );
+        vlc_tick_t duration = vlc_tick_now() - start;
+
+        printf("%4s ep3b size:  %8.1f MB/s (%zu bytes)\n", i ? "simd" : "ref",
+               (double) i_size * i_loops * CLOCK_FREQ / __MAX(duration, 1)
+               / 1000000., i_total / i_loops);
+    }
+
+    free( p_data );
+    return 0;
+}
+
+int main( int argc, char **argv )
+{
+    if( argc > 1 && !strcmp( argv[1], "bench" ) )
+        return run_bench( argc > 2 ? argv[2] : NULL,
+                          argc > 3 ? atoi( argv[3] ) : 10 );
+
     const uint8_t test1_annexbdata[] = { 0, 0, 0, 1, 0x55, 0x55, 0x55, 0x55, 0x55, // 9
                                          0, 0, 1, 0x22, 0x22, //14
                                          0, 0, 1, 0x0, 0x0, //19
@@ -134,5 +335,5 @@ int main( void )
             return i_ret;
     }
 
-    return 0;
+    return run_random_sets();
 }
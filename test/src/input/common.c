@@ -22,6 +22,8 @@
 # include "config.h"
 #endif
 
+#include <time.h>
+
 #include "../lib/libvlc_internal.h"
 
 #include "common.h"
@@ -41,6 +43,21 @@ void vlc_run_args_init(struct vlc_run_args *args)
 
     args->name = getenv("VLC_TARGET");
     args->test_demux_controls = getenv_atoi("VLC_DEMUX_CONTROLS");
+    args->seeks = getenv_atoi("VLC_DEMUX_SEEKS");
+    args->video_filters = getenv("VLC_VIDEO_FILTER");
+    if (args->video_filters != NULL && args->video_filters[0] == '\0')
+        args->video_filters = NULL;
+}
+
+uint64_t vlc_run_cputime(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#endif
+    return 0;
 }
 
 libvlc_instance_t *libvlc_create(const struct vlc_run_args *args)
@@ -18,6 +18,7 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 
+#include <stdint.h>
 #include <vlc/vlc.h>
 
 #if 0
@@ -26,6 +27,29 @@
 #define debug(...) (void)0
 #endif
 
+/* Nested CPU times include the ones of the following stages, e.g. the
+ * decoders run from within the demuxer and the filters from the decoders. */
+struct vlc_run_stats
+{
+    int64_t open_time; /* wall time to open the demuxer, in microseconds */
+    uintmax_t demux_calls;
+    uintmax_t stream_bytes; /* consumed by the demuxer */
+    uintmax_t es_packets; /* sent by the demuxer */
+    uintmax_t es_bytes;
+    uintmax_t video_pictures; /* out of the decoders */
+    uintmax_t filtered_pictures; /* out of the video filters */
+    uintmax_t picture_allocs;
+    uintmax_t audio_blocks;
+    uintmax_t audio_samples;
+    uintmax_t subpictures;
+    uint64_t demux_ns; /* CPU time demuxing, decoding and filtering */
+    uint64_t decode_ns; /* CPU time packetizing, decoding and filtering */
+    uint64_t filter_ns; /* CPU time filtering */
+    unsigned seeks; /* completed seeks */
+    int64_t seek_time; /* total wall time of the seeks, in microseconds */
+    int64_t seek_time_max;
+};
+
 struct vlc_run_args
 {
     /* force specific target name (demux or decoder name). NULL to don't force
@@ -37,8 +61,20 @@ struct vlc_run_args
 
     /* true to test demux controls */
     bool test_demux_controls;
+
+    /* video filter chain to apply to decoded pictures, NULL for none */
+    const char *video_filters;
+
+    /* number of seeks to time once the end of the stream is reached */
+    unsigned seeks;
+
+    /* statistics to update, NULL to not collect any */
+    struct vlc_run_stats *stats;
 };
 
 void vlc_run_args_init(struct vlc_run_args *args);
 
 libvlc_instance_t *libvlc_create(const struct vlc_run_args *args);
+
+/* CPU time of the calling thread, in nanoseconds */
+uint64_t vlc_run_cputime(void);
@@ -27,6 +27,7 @@
 #include <vlc_common.h>
 #include <vlc_modules.h>
 #include <vlc_codec.h>
+#include <vlc_filter.h>
 #include <vlc_stream.h>
 #include <vlc_access.h>
 #include <vlc_meta.h>
@@ -43,6 +44,9 @@ struct decoder_owner
 {
     decoder_t dec;
     decoder_t *packetizer;
+    const struct vlc_run_args *args;
+    filter_chain_t *filters;
+    es_format_t filters_fmt;
 };
 
 static inline struct decoder_owner *dec_get_owner(decoder_t *dec)
@@ -50,8 +54,24 @@ static inline struct decoder_owner *dec_get_owner(decoder_t *dec)
     return container_of(dec, struct decoder_owner, dec);
 }
 
+static int video_update_format(decoder_t *dec)
+{
+    dec->fmt_out.video.i_chroma = dec->fmt_out.i_codec;
+    return 0;
+}
+
+static int audio_update_format(decoder_t *dec)
+{
+    dec->fmt_out.audio.i_format = dec->fmt_out.i_codec;
+    return 0;
+}
+
 static picture_t *video_new_buffer_decoder(decoder_t *dec)
 {
+    struct vlc_run_stats *stats = dec_get_owner(dec)->args->stats;
+
+    if (stats != NULL)
+        stats->picture_allocs++;
     return picture_NewFromFormat(&dec->fmt_out.video);
 }
 
@@ -62,15 +82,90 @@ static subpicture_t *spu_new_buffer_decoder(decoder_t *dec,
     return subpicture_New (p_subpic);
 }
 
+static picture_t *video_new_buffer_filter(filter_t *filter)
+{
+    return picture_NewFromFormat(&filter->fmt_out.video);
+}
+
+static filter_chain_t *video_filters(struct decoder_owner *owner)
+{
+    decoder_t *dec = &owner->dec;
+
+    if (owner->filters != NULL)
+    {
+        if (video_format_IsSimilar(&owner->filters_fmt.video,
+                                   &dec->fmt_out.video))
+            return owner->filters;
+        es_format_Clean(&owner->filters_fmt);
+    }
+    else
+    {
+        static const struct filter_video_callbacks cbs =
+        {
+            .buffer_new = video_new_buffer_filter,
+        };
+        const filter_owner_t filter_owner = { .video = &cbs };
+
+        owner->filters = filter_chain_NewVideo(dec, false, &filter_owner);
+        if (owner->filters == NULL)
+            return NULL;
+    }
+
+    es_format_Copy(&owner->filters_fmt, &dec->fmt_out);
+    filter_chain_Reset(owner->filters, &owner->filters_fmt,
+                       &owner->filters_fmt);
+    if (filter_chain_AppendFromString(owner->filters,
+                                      owner->args->video_filters) < 0)
+        debug("cannot create video filters %s\n", owner->args->video_filters);
+    return owner->filters;
+}
+
 static void queue_video(decoder_t *dec, picture_t *pic)
 {
-    (void) dec;
+    struct decoder_owner *owner = dec_get_owner(dec);
+    struct vlc_run_stats *stats = owner->args->stats;
+
+    if (stats != NULL)
+        stats->video_pictures++;
+
+    if (owner->args->video_filters != NULL)
+    {
+        uint64_t start = vlc_run_cputime();
+        filter_chain_t *filters = video_filters(owner);
+
+        if (filters != NULL)
+            pic = filter_chain_VideoFilter(filters, pic);
+
+        while (pic != NULL)
+        {
+            picture_t *next = pic->p_next;
+
+            pic->p_next = NULL;
+            picture_Release(pic);
+            if (stats != NULL)
+                stats->filtered_pictures++;
+            pic = next;
+        }
+
+        if (stats != NULL)
+            stats->filter_ns += vlc_run_cputime() - start;
+        return;
+    }
+
+    if (stats != NULL)
+        stats->filtered_pictures++;
     picture_Release(pic);
 }
 
 static void queue_audio(decoder_t *dec, block_t *p_block)
 {
-    (void) dec;
+    struct vlc_run_stats *stats = dec_get_owner(dec)->args->stats;
+
+    if (stats != NULL)
+    {
+        stats->audio_blocks++;
+        stats->audio_samples += p_block->i_nb_samples;
+    }
     block_Release(p_block);
 }
 static void queue_cc(decoder_t *dec, block_t *p_block, const decoder_cc_desc_t *desc)
@@ -80,7 +175,10 @@ static void queue_cc(decoder_t *dec, block_t *p_block, const decoder_cc_desc_t *
 }
 static void queue_sub(decoder_t *dec, subpicture_t *p_subpic)
 {
-    (void) dec;
+    struct vlc_run_stats *stats = dec_get_owner(dec)->args->stats;
+
+    if (stats != NULL)
+        stats->subpictures++;
     subpicture_Delete(p_subpic);
 }
 
@@ -116,11 +214,17 @@ void test_decoder_destroy(decoder_t *decoder)
 {
     struct decoder_owner *owner = dec_get_owner(decoder);
 
+    if (owner->filters != NULL)
+    {
+        filter_chain_Delete(owner->filters);
+        es_format_Clean(&owner->filters_fmt);
+    }
     decoder_Destroy(owner->packetizer);
     decoder_Destroy(decoder);
 }
 
-decoder_t *test_decoder_create(vlc_object_t *parent, const es_format_t *fmt)
+decoder_t *test_decoder_create(vlc_object_t *parent, const es_format_t *fmt,
+                               const struct vlc_run_args *args)
 {
     assert(parent && fmt);
     decoder_t *packetizer = NULL;
@@ -137,10 +241,13 @@ decoder_t *test_decoder_create(vlc_object_t *parent, const es_format_t *fmt)
     }
     decoder = &owner->dec;
     owner->packetizer = packetizer;
+    owner->args = args;
+    owner->filters = NULL;
 
     static const struct decoder_owner_callbacks dec_video_cbs =
     {
         .video = {
+            .format_update = video_update_format,
             .buffer_new = video_new_buffer_decoder,
             .queue = queue_video,
             .queue_cc = queue_cc,
@@ -149,6 +256,7 @@ decoder_t *test_decoder_create(vlc_object_t *parent, const es_format_t *fmt)
     static const struct decoder_owner_callbacks dec_audio_cbs =
     {
         .audio = {
+            .format_update = audio_update_format,
             .queue = queue_audio,
         },
     };
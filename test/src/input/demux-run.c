@@ -53,6 +53,7 @@ struct test_es_out_t
 {
     struct es_out_t out;
     struct es_out_id_t *ids;
+    const struct vlc_run_args *args;
 #ifdef HAVE_DECODERS
     vlc_object_t *parent;
 #endif
@@ -82,7 +83,7 @@ static es_out_id_t *EsOutAdd(es_out_t *out, const es_format_t *fmt)
     ctx->ids = id;
 #ifdef HAVE_DECODERS
     es_format_Copy(&id->fmt, fmt);
-    id->decoder = test_decoder_create(ctx->parent, &id->fmt);
+    id->decoder = test_decoder_create(ctx->parent, &id->fmt, ctx->args);
     if (id->decoder == NULL)
         es_format_Clean(&id->fmt);
 #endif
@@ -106,9 +107,21 @@ static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
 
     //debug("[%p] Sent    ES: %zu\n", (void *)idd, block->i_buffer);
     EsOutCheckId(ctx, id);
+    if (ctx->args->stats != NULL)
+    {
+        ctx->args->stats->es_packets++;
+        ctx->args->stats->es_bytes += block->i_buffer;
+    }
 #ifdef HAVE_DECODERS
     if (id->decoder)
+    {
+        struct vlc_run_stats *stats = ctx->args->stats;
+        uint64_t start = (stats != NULL) ? vlc_run_cputime() : 0;
+
         test_decoder_process(id->decoder, block);
+        if (stats != NULL)
+            stats->decode_ns += vlc_run_cputime() - start;
+    }
     else
 #endif
         block_Release(block);
@@ -160,7 +173,8 @@ static int EsOutControl(es_out_t *out, int query, va_list args)
             es_out_id_t* id = va_arg(args, es_out_id_t*);
             EsOutCheckId(ctx, id);
             test_decoder_destroy(id->decoder);
-            test_decoder_create(ctx->parent, &id->fmt);
+            id->decoder = test_decoder_create(ctx->parent, &id->fmt,
+                                              ctx->args);
 #endif
             break;
         }
@@ -220,7 +234,8 @@ static const struct es_out_callbacks es_out_cbs =
     .destroy = EsOutDestroy,
 };
 
-static es_out_t *test_es_out_create(vlc_object_t *parent)
+static es_out_t *test_es_out_create(vlc_object_t *parent,
+                                    const struct vlc_run_args *args)
 {
     struct test_es_out_t *ctx = malloc(sizeof (*ctx));
     if (ctx == NULL)
@@ -230,6 +245,7 @@ static es_out_t *test_es_out_create(vlc_object_t *parent)
     }
 
     ctx->ids = NULL;
+    ctx->args = args;
 
     es_out_t *out = &ctx->out;
     out->cbs = &es_out_cbs;
@@ -277,6 +293,34 @@ static void demux_get_meta(demux_t *demux)
     vlc_meta_Delete(p_meta);
 }
 
+static void demux_time_seeks(demux_t *demux, unsigned count,
+                             struct vlc_run_stats *stats)
+{
+    bool can_seek;
+
+    if (demux_Control(demux, DEMUX_CAN_SEEK, &can_seek) || !can_seek)
+        return;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        /* Spread the positions over the stream, the same way on every run */
+        double pos = (i + 1) * 0.6180339887;
+        pos -= (unsigned)pos;
+
+        vlc_tick_t start = vlc_tick_now();
+        if (demux_SetPosition(demux, pos, true, true) != VLC_SUCCESS)
+            continue;
+        /* Include getting the first data after the seek */
+        demux_Demux(demux);
+
+        vlc_tick_t duration = vlc_tick_now() - start;
+        stats->seeks++;
+        stats->seek_time += duration;
+        if (duration > stats->seek_time_max)
+            stats->seek_time_max = duration;
+    }
+}
+
 static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
 {
     const char *name = args->name;
@@ -286,11 +330,15 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
     if (s == NULL)
         return -1;
 
-    es_out_t *out = test_es_out_create(VLC_OBJECT(s));
+    es_out_t *out = test_es_out_create(VLC_OBJECT(s), args);
     if (out == NULL)
         return -1;
 
+    struct vlc_run_stats *stats = args->stats;
+    vlc_tick_t open_start = vlc_tick_now();
     demux_t *demux = demux_New(VLC_OBJECT(s), name, s, out);
+    if (stats != NULL)
+        stats->open_time = vlc_tick_now() - open_start;
     if (demux == NULL)
     {
         es_out_Delete(out);
@@ -302,8 +350,19 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
     uintmax_t i = 0;
     int val;
 
-    while ((val = demux_Demux(demux)) == VLC_DEMUXER_SUCCESS)
+    for (;;)
     {
+        uint64_t start = (stats != NULL) ? vlc_run_cputime() : 0;
+
+        val = demux_Demux(demux);
+        if (stats != NULL)
+        {
+            stats->demux_ns += vlc_run_cputime() - start;
+            stats->demux_calls++;
+        }
+        if (val != VLC_DEMUXER_SUCCESS)
+            break;
+
         if (args->test_demux_controls)
         {
             if (demux_test_and_clear_flags(demux, INPUT_UPDATE_TITLE_LIST))
@@ -326,6 +385,13 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
         i++;
     }
 
+    if (stats != NULL)
+    {
+        stats->stream_bytes = vlc_stream_Tell(s);
+        if (args->seeks > 0)
+            demux_time_seeks(demux, args->seeks, stats);
+    }
+
     demux_Delete(demux);
     es_out_Delete(out);
 
@@ -344,6 +344,36 @@ test( struct reader **pp_readers, unsigned int i_readers, const char *psz_md5 )
 }
 
 #ifndef TEST_NET
+static void
+test_block( struct reader *p_libc, struct reader *p_stream, uint64_t i_offset )
+{
+    stream_t *s = p_stream->u.s;
+    uint8_t p_ref[8192 + 42], p_buf[42];
+    const uint8_t *p_peek;
+
+    test_log( "block 8192 @ %"PRIu64" after peek\n", i_offset );
+    assert( p_libc->pf_seek( p_libc, i_offset ) == 0 );
+    assert( p_libc->pf_read( p_libc, p_ref, sizeof(p_ref) ) == sizeof(p_ref) );
+    assert( vlc_stream_Seek( s, i_offset ) == 0 );
+
+    /* The block payload is buffered, so it can reference the peek buffer */
+    assert( vlc_stream_Peek( s, &p_peek, 16384 ) == 16384 );
+    block_t *p_block = vlc_stream_Block( s, 8192 );
+    assert( p_block != NULL );
+    assert( p_block->i_buffer == 8192 );
+    assert( memcmp( p_block->p_buffer, p_ref, 8192 ) == 0 );
+    assert( vlc_stream_Tell( s ) == i_offset + 8192 );
+
+    /* The stream must neither see nor affect the block payload */
+    memset( p_block->p_buffer, 0, 8192 );
+    assert( vlc_stream_Peek( s, &p_peek, 42 ) == 42 );
+    assert( memcmp( p_peek, p_ref + 8192, 42 ) == 0 );
+    assert( vlc_stream_Read( s, p_buf, 42 ) == 42 );
+    assert( memcmp( p_buf, p_ref + 8192, 42 ) == 0 );
+    assert( vlc_stream_Peek( s, &p_peek, 65536 ) == 65536 );
+    block_Release( p_block );
+}
+
 static void
 fill_rand( int i_fd, size_t i_size )
 {
@@ -385,6 +415,8 @@ main( void )
     assert( ( pp_readers[1] = stream_open( psz_url ) ) );
 
     test( pp_readers, 2, NULL );
+    test_block( pp_readers[0], pp_readers[1], 4242 );
+    test_block( pp_readers[0], pp_readers[1], RAND_FILE_SIZE / 2 );
     for( unsigned int i = 0; i < 2; ++i )
         pp_readers[i]->pf_close( pp_readers[i] );
     free( psz_url );
@@ -135,5 +135,33 @@ int main( void )
     assert_current( p_epg, "B" );
     vlc_epg_Delete( p_epg );
 
+    /* Test bisect lookup of current event and change detection */
+    printf("--test %d\n", i++);
+    p_epg = vlc_epg_New( 0, 0 );
+    assert(p_epg);
+    EPG_ADD( p_epg,  42, 20, "A" );
+    EPG_ADD( p_epg,  62, 20, "B" );
+    EPG_ADD( p_epg,  82, 20, "C" );
+    vlc_epg_SetCurrent( p_epg, 72 );
+    assert_current( p_epg, NULL );
+    vlc_epg_SetCurrent( p_epg, 102 );
+    assert_current( p_epg, NULL );
+    vlc_epg_SetCurrent( p_epg, 42 );
+    assert_current( p_epg, "A" );
+
+    vlc_epg_t *p_dup = vlc_epg_Duplicate( p_epg );
+    assert(p_dup);
+    assert( vlc_epg_Equals( p_epg, p_dup ) );
+    vlc_epg_SetCurrent( p_dup, 62 );
+    assert( !vlc_epg_Equals( p_epg, p_dup ) );
+    vlc_epg_SetCurrent( p_dup, 42 );
+    assert( vlc_epg_Equals( p_epg, p_dup ) );
+    EPG_ADD( p_dup,  62, 20, "X" );
+    assert( !vlc_epg_Equals( p_epg, p_dup ) );
+    assert( !vlc_epg_event_Equals( p_epg->pp_event[1], p_dup->pp_event[1] ) );
+    assert( vlc_epg_event_Equals( p_epg->pp_event[2], p_dup->pp_event[2] ) );
+    vlc_epg_Delete( p_dup );
+    vlc_epg_Delete( p_epg );
+
     return 0;
 }
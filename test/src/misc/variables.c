@@ -444,6 +444,45 @@ static void test_creation_and_type( libvlc_int_t *p_libvlc )
     assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOVAR );
 }
 
+static void test_many( libvlc_int_t *p_libvlc )
+{
+    char name[16];
+    const unsigned n = 1000;
+
+    /* Enough variables to grow the table several times */
+    for( unsigned i = 0; i < n; i++ )
+    {
+        snprintf( name, sizeof (name), "many-%u", i );
+        var_Create( p_libvlc, name, VLC_VAR_INTEGER );
+        var_SetInteger( p_libvlc, name, i );
+    }
+
+    /* Remove every other variable, then check the remaining ones */
+    for( unsigned i = 0; i < n; i += 2 )
+    {
+        snprintf( name, sizeof (name), "many-%u", i );
+        var_Destroy( p_libvlc, name );
+    }
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        vlc_value_t val;
+
+        snprintf( name, sizeof (name), "many-%u", i );
+        if( i & 1 )
+            assert( var_GetInteger( p_libvlc, name ) == i );
+        else
+            assert( var_Get( p_libvlc, name, &val ) == VLC_ENOVAR );
+    }
+
+    for( unsigned i = 1; i < n; i += 2 )
+    {
+        snprintf( name, sizeof (name), "many-%u", i );
+        var_Destroy( p_libvlc, name );
+    }
+    assert( var_Type( p_libvlc, "many-1" ) == 0 );
+}
+
 static void test_variables( libvlc_instance_t *p_vlc )
 {
     libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
@@ -481,6 +520,9 @@ static void test_variables( libvlc_instance_t *p_vlc )
 
     test_log( "Testing type at creation\n" );
     test_creation_and_type( p_libvlc );
+
+    test_log( "Testing many variables\n" );
+    test_many( p_libvlc );
 }
 
 
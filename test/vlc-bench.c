@@ -0,0 +1,239 @@
+/**
+ * @file vlc-bench.c
+ */
+/*****************************************************************************
+ * Copyright © 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Runs each input file through the demuxer, packetizers, decoders and
+ * optionally video filters, as fast as possible (there is no clock), and
+ * prints the throughput and the time spent in each stage as JSON.
+ * vlc-demux-bench is the same without decoders, to measure demuxers alone.
+ *
+ * The same environment variables as vlc-demux-run apply, notably
+ * VLC_TARGET to force a demuxer and VLC_VIDEO_FILTER to filter the decoded
+ * pictures, as well as VLC_BENCH_RUNS to repeat each input and
+ * VLC_DEMUX_SEEKS to time seeks once the end of each input is reached.
+ *
+ * An argument starting with '@' names a corpus manifest, listing one input
+ * per line, optionally followed by a tab and the demuxer to force for it.
+ * Empty lines and lines starting with '#' are ignored.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "src/input/demux-run.h"
+
+static double elapsed(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec)
+         + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static double rusage_cpu(const struct rusage *ru)
+{
+    return ru->ru_utime.tv_sec + ru->ru_utime.tv_usec / 1e6
+         + ru->ru_stime.tv_sec + ru->ru_stime.tv_usec / 1e6;
+}
+
+static void print_string(const char *str)
+{
+    putchar('"');
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++)
+    {
+        if (*p == '"' || *p == '\\')
+            printf("\\%c", *p);
+        else if (*p < 0x20)
+            printf("\\u%04x", *p);
+        else
+            putchar(*p);
+    }
+    putchar('"');
+}
+
+static double rate(uintmax_t count, double seconds)
+{
+    return (seconds > 0.) ? count / seconds : 0.;
+}
+
+static int bench(struct vlc_run_args *args, const char *path, unsigned run)
+{
+    struct vlc_run_stats stats = { 0 };
+    struct rusage before, after;
+    struct timespec start;
+
+    args->stats = &stats;
+    getrusage(RUSAGE_SELF, &before);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int ret = vlc_demux_process_path(args, path);
+
+    double wall = elapsed(&start);
+    getrusage(RUSAGE_SELF, &after);
+    args->stats = NULL;
+
+    printf("    {\n      \"input\": ");
+    print_string(path);
+    printf(",\n      \"run\": %u,\n", run);
+    printf("      \"demux\": ");
+    if (args->name != NULL)
+        print_string(args->name);
+    else
+        printf("null");
+    printf(",\n      \"filters\": ");
+    if (args->video_filters != NULL)
+        print_string(args->video_filters);
+    else
+        printf("null");
+    printf(",\n      \"success\": %s,\n", ret == 0 ? "true" : "false");
+    printf("      \"wall_seconds\": %.6f,\n", wall);
+    printf("      \"open_seconds\": %.6f,\n", stats.open_time / 1e6);
+    printf("      \"demux_calls\": %ju,\n", stats.demux_calls);
+    printf("      \"stream_bytes\": %ju,\n", stats.stream_bytes);
+    printf("      \"megabytes_per_second\": %.2f,\n",
+           rate(stats.stream_bytes, wall) / 1e6);
+    printf("      \"es_packets\": %ju,\n", stats.es_packets);
+    printf("      \"es_bytes\": %ju,\n", stats.es_bytes);
+    printf("      \"packets_per_second\": %.2f,\n",
+           rate(stats.es_packets, wall));
+    printf("      \"video_pictures\": %ju,\n", stats.video_pictures);
+    printf("      \"filtered_pictures\": %ju,\n", stats.filtered_pictures);
+    printf("      \"pictures_per_second\": %.2f,\n",
+           rate(stats.filtered_pictures, wall));
+    printf("      \"picture_allocations\": %ju,\n", stats.picture_allocs);
+    printf("      \"audio_blocks\": %ju,\n", stats.audio_blocks);
+    printf("      \"audio_samples\": %ju,\n", stats.audio_samples);
+    printf("      \"subpictures\": %ju,\n", stats.subpictures);
+    /* Stage times exclude the nested stages, see struct vlc_run_stats */
+    printf("      \"cpu_seconds\": {\n");
+    printf("        \"demux\": %.6f,\n",
+           (stats.demux_ns - stats.decode_ns) / 1e9);
+    printf("        \"decode\": %.6f,\n",
+           (stats.decode_ns - stats.filter_ns) / 1e9);
+    printf("        \"filter\": %.6f,\n", stats.filter_ns / 1e9);
+    printf("        \"process\": %.6f\n",
+           rusage_cpu(&after) - rusage_cpu(&before));
+    printf("      },\n");
+    printf("      \"seeks\": %u,\n", stats.seeks);
+    printf("      \"seek_seconds_mean\": %.6f,\n",
+           stats.seeks ? stats.seek_time / 1e6 / stats.seeks : 0.);
+    printf("      \"seek_seconds_max\": %.6f,\n", stats.seek_time_max / 1e6);
+    printf("      \"peak_rss_kib\": %ld\n", after.ru_maxrss);
+    printf("    }");
+    return ret;
+}
+
+static unsigned runs = 1;
+static bool first = true;
+
+static int bench_runs(struct vlc_run_args *args, const char *path)
+{
+    int ret = 0;
+
+    for (unsigned run = 0; run < runs; run++)
+    {
+        if (!first)
+            printf(",\n");
+        first = false;
+        if (bench(args, path, run))
+            ret = 1;
+    }
+    return ret;
+}
+
+static int bench_manifest(struct vlc_run_args *args, const char *manifest)
+{
+    FILE *stream = fopen(manifest, "rt");
+    if (stream == NULL)
+    {
+        fprintf(stderr, "Error: cannot open corpus manifest: %s\n", manifest);
+        return 1;
+    }
+
+    const char *name = args->name;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    int ret = 0;
+
+    while ((len = getline(&line, &size, stream)) != -1)
+    {
+        if (len > 0 && line[len - 1] == '\n')
+            line[--len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+
+        char *tab = strchr(line, '\t');
+        if (tab != NULL)
+        {
+            *tab = '\0';
+            args->name = tab + 1;
+        }
+        else
+            args->name = name;
+
+        if (bench_runs(args, line))
+            ret = 1;
+    }
+
+    args->name = name;
+    free(line);
+    fclose(stream);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    struct vlc_run_args args;
+    vlc_run_args_init(&args);
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: [VLC_TARGET=demux] [VLC_VIDEO_FILTER=filter] "
+                "[VLC_BENCH_RUNS=count] [VLC_DEMUX_SEEKS=count] "
+                "%s <filename|@manifest>...\n", argv[0]);
+        return 1;
+    }
+
+    const char *env = getenv("VLC_BENCH_RUNS");
+    if (env != NULL)
+        runs = strtoul(env, NULL, 10);
+
+    int ret = 0;
+
+    printf("{\n  \"results\": [\n");
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '@')
+            ret |= bench_manifest(&args, argv[i] + 1);
+        else
+            ret |= bench_runs(&args, argv[i]);
+    }
+    printf("\n  ]\n}\n");
+    return ret;
+}